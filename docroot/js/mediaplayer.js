@@ -23,6 +23,7 @@ LMS.mediaplayer = function () {
 	let _duration = 0;
 	let _audioNativeSrc;
 	let _audioTranscodingSrc;
+	let _audioHlsSrc;
 	let _settings = {};
 	let _playedDuration = 0;
 	let _lastStartPlaying = null;
@@ -374,6 +375,7 @@ LMS.mediaplayer = function () {
 		_duration = params.duration;
 		_audioNativeSrc = params.nativeResource;
 		_audioTranscodingSrc = params.transcodingResource + "&bitrate=" + _settings.transcoding.bitrate + "&format=" + _settings.transcoding.format;
+		_audioHlsSrc = params.hlsResource + "&bitrate=" + _settings.transcoding.bitrate;
 
 		_elems.seek.max = _duration;
 
@@ -385,6 +387,9 @@ LMS.mediaplayer = function () {
 		}
 		if (_settings.transcoding.mode == TranscodingMode.Always || _settings.transcoding.mode == TranscodingMode.IfFormatNotSupported)
 		{
+			// HLS segments are fetched on seek, instead of restarting the transcode (hence seen as Mode.File)
+			if (_elems.audio.canPlayType("application/vnd.apple.mpegurl") != "")
+				_addAudioSource(_audioHlsSrc);
 			_addAudioSource(_audioTranscodingSrc);
 		}
 		_elems.audio.load();
@@ -0,0 +1,367 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+#include <benchmark/benchmark.h>
+
+#include "av/IAudioFile.hpp"
+#include "av/TranscodingParameters.hpp"
+#include "av/Types.hpp"
+#include "utils/IChildProcessManager.hpp"
+#include "utils/IConfig.hpp"
+#include "utils/Service.hpp"
+#include "LibAvTranscoder.hpp"
+#include "Transcoder.hpp"
+
+using namespace Av::Transcoding;
+
+namespace
+{
+    enum class Backend
+    {
+        Ffmpeg,     // forked ffmpeg process
+        LibAv,      // in process
+    };
+
+    struct CorpusFile
+    {
+        std::filesystem::path path;
+        std::chrono::milliseconds duration;
+    };
+
+    // Set up once and shared by all the benchmarks
+    // The corpus can be set using the LMS_BENCH_TRANSCODING_CORPUS environment variable (directory of audio files)
+    // Otherwise, a one minute FLAC file is generated
+    // The ffmpeg executable can be set using the LMS_BENCH_FFMPEG_FILE environment variable
+    class BenchEnvironment
+    {
+    public:
+        static BenchEnvironment& get()
+        {
+            static BenchEnvironment env;
+            return env;
+        }
+
+        ~BenchEnvironment()
+        {
+            _work.reset();
+            for (std::thread& thread : _ioThreads)
+                thread.join();
+
+            std::error_code ec;
+            std::filesystem::remove_all(_workDir, ec);
+        }
+
+        const std::vector<CorpusFile>& getCorpus() const { return _corpus; }
+
+    private:
+        BenchEnvironment()
+            : _workDir{ std::filesystem::temp_directory_path() / ("lms-bench-transcoding-" + std::to_string(std::random_device{}())) }
+        {
+            std::filesystem::create_directories(_workDir);
+
+            const std::filesystem::path ffmpegFile{ getEnv("LMS_BENCH_FFMPEG_FILE", "/usr/bin/ffmpeg") };
+            {
+                std::ofstream config{ _workDir / "lms.conf" };
+                config << "ffmpeg-file = \"" << ffmpegFile.string() << "\";" << std::endl;
+            }
+            _config.assign(createConfig(_workDir / "lms.conf"));
+            _childProcessManager.assign(createChildProcessManager(_ioContext));
+
+            for (std::size_t i{}; i < 2; ++i)
+                _ioThreads.emplace_back([this] { _ioContext.run(); });
+
+            const std::string corpusDir{ getEnv("LMS_BENCH_TRANSCODING_CORPUS", "") };
+            if (!corpusDir.empty())
+                loadCorpus(corpusDir);
+            else
+                generateCorpus(ffmpegFile);
+
+            if (_corpus.empty())
+                throw std::runtime_error{ "No audio file in corpus" };
+
+            std::cerr << "Corpus: " << _corpus.size() << " file(s)" << std::endl;
+        }
+
+        static std::string getEnv(const char* name, const char* defaultValue)
+        {
+            const char* value{ std::getenv(name) };
+            return value ? value : defaultValue;
+        }
+
+        void loadCorpus(const std::filesystem::path& corpusDir)
+        {
+            for (const std::filesystem::directory_entry& entry : std::filesystem::recursive_directory_iterator{ corpusDir })
+            {
+                if (!entry.is_regular_file())
+                    continue;
+
+                addCorpusFile(entry.path());
+            }
+        }
+
+        void generateCorpus(const std::filesystem::path& ffmpegFile)
+        {
+            const std::filesystem::path path{ _workDir / "sine.flac" };
+            const std::string command{ ffmpegFile.string() + " -loglevel quiet -f lavfi -i sine=frequency=440:duration=60 -ac 2 -ar 44100 " + path.string() };
+
+            std::cerr << "Generating " << path.string() << "..." << std::endl;
+            if (std::system(command.c_str()) != 0)
+                throw std::runtime_error{ "Cannot generate corpus file using '" + command + "'" };
+
+            addCorpusFile(path);
+        }
+
+        void addCorpusFile(const std::filesystem::path& path)
+        {
+            try
+            {
+                const auto audioFile{ Av::parseAudioFile(path) };
+                if (!audioFile->getBestStreamInfo())
+                    return;
+
+                _corpus.push_back(CorpusFile{ path, audioFile->getContainerInfo().duration });
+            }
+            catch (const Av::Exception&)
+            {
+                // not an audio file
+            }
+        }
+
+        const std::filesystem::path _workDir;
+        std::vector<CorpusFile> _corpus;
+
+        boost::asio::io_context _ioContext;
+        std::optional<boost::asio::executor_work_guard<boost::asio::io_context::executor_type>> _work{ boost::asio::make_work_guard(_ioContext) };
+        std::vector<std::thread> _ioThreads;
+
+        Service<IConfig> _config;
+        Service<IChildProcessManager> _childProcessManager;
+    };
+
+    std::unique_ptr<ITranscoder> createTranscoder(Backend backend, const InputParameters& inputParameters, const OutputParameters& outputParameters)
+    {
+        switch (backend)
+        {
+        case Backend::Ffmpeg:
+            return std::make_unique<Transcoder>(inputParameters, outputParameters, false);
+        case Backend::LibAv:
+            return std::make_unique<LibAvTranscoder>(inputParameters, outputParameters, false);
+        }
+
+        throw std::logic_error{ "Unhandled backend" };
+    }
+
+    // Drains the output of a transcoder as fast as possible, as a client with an unlimited bandwidth would do
+    class StreamReader
+    {
+    public:
+        StreamReader(std::unique_ptr<ITranscoder> transcoder, std::function<void()> onFinished)
+            : _transcoder{ std::move(transcoder) }
+            , _onFinished{ std::move(onFinished) }
+        {}
+
+        void start()
+        {
+            _startTime = std::chrono::steady_clock::now();
+            issueRead();
+        }
+
+        std::chrono::steady_clock::duration getTimeToFirstByte() const { return _firstByteTime - _startTime; }
+        std::chrono::steady_clock::duration getDuration() const { return _endTime - _startTime; }
+        std::size_t getOutputSize() const { return _outputSize; }
+
+    private:
+        void issueRead()
+        {
+            _transcoder->asyncRead(_buffer.data(), _buffer.size(), [this](std::size_t nbBytesRead)
+                {
+                    if (nbBytesRead > 0 && _outputSize == 0)
+                        _firstByteTime = std::chrono::steady_clock::now();
+                    _outputSize += nbBytesRead;
+
+                    if (!_transcoder->finished())
+                    {
+                        issueRead();
+                        return;
+                    }
+
+                    _endTime = std::chrono::steady_clock::now();
+                    if (_outputSize == 0)
+                        _firstByteTime = _endTime;
+                    _onFinished();
+                });
+        }
+
+        std::unique_ptr<ITranscoder> _transcoder;
+        std::function<void()> _onFinished;
+        std::vector<std::byte> _buffer = std::vector<std::byte>(262'144); // same chunk size as the transcoding resource handler
+        std::chrono::steady_clock::time_point _startTime;
+        std::chrono::steady_clock::time_point _firstByteTime;
+        std::chrono::steady_clock::time_point _endTime;
+        std::size_t _outputSize{};
+    };
+
+    // Includes the ffmpeg child processes, once they have been waited for
+    std::chrono::duration<double> getCpuTime()
+    {
+        auto toDuration{ [](const timeval& tv) { return std::chrono::duration<double>{ tv.tv_sec + tv.tv_usec / 1'000'000. }; } };
+
+        std::chrono::duration<double> res{};
+        for (const int who : { RUSAGE_SELF, RUSAGE_CHILDREN })
+        {
+            rusage usage{};
+            if (getrusage(who, &usage) == 0)
+                res += toDuration(usage.ru_utime) + toDuration(usage.ru_stime);
+        }
+
+        return res;
+    }
+}
+
+// Each iteration runs args[1] concurrent transcodes of the corpus files, at args[0] kbps
+// Counters:
+//  ttfb_ms: mean time between the transcoder creation and the first output byte
+//  ttfb_max_ms: worst time to first byte among the concurrent transcodes
+//  realtime_factor: mean audio duration / transcode duration, per stream
+//  cpu_s_per_stream: CPU time used per transcode (bench process + ffmpeg processes)
+//  audio_s_per_s: audio duration transcoded per second, all streams included
+template <Backend backend, OutputFormat format>
+static void BM_Transcode(benchmark::State& state)
+{
+    const std::vector<CorpusFile>& corpus{ BenchEnvironment::get().getCorpus() };
+    const std::size_t bitrate{ static_cast<std::size_t>(state.range(0)) * 1000 };
+    const std::size_t concurrency{ static_cast<std::size_t>(state.range(1)) };
+
+    std::size_t corpusIndex{};
+    std::size_t streamCount{};
+    double totalTimeToFirstByte{};
+    double maxTimeToFirstByte{};
+    double totalRealtimeFactor{};
+    std::chrono::duration<double> totalAudioDuration{};
+    std::size_t totalOutputSize{};
+    std::chrono::duration<double> totalCpuTime{};
+
+    for (auto _ : state)
+    {
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::size_t runningCount{ concurrency };
+
+        std::vector<std::unique_ptr<StreamReader>> readers;
+        std::vector<std::chrono::milliseconds> audioDurations;
+
+        const auto cpuTimeBefore{ getCpuTime() };
+        for (std::size_t i{}; i < concurrency; ++i)
+        {
+            const CorpusFile& file{ corpus[corpusIndex++ % corpus.size()] };
+
+            InputParameters inputParameters;
+            inputParameters.trackPath = file.path;
+            inputParameters.duration = file.duration;
+
+            OutputParameters outputParameters;
+            outputParameters.format = format;
+            outputParameters.bitrate = bitrate;
+
+            audioDurations.push_back(file.duration);
+            readers.push_back(std::make_unique<StreamReader>(createTranscoder(backend, inputParameters, outputParameters), [&]
+                {
+                    // notified under the lock: the waiter may destroy the condition variable as soon as it is released
+                    const std::scoped_lock lock{ mutex };
+                    runningCount--;
+                    cv.notify_all();
+                }));
+            readers.back()->start();
+        }
+
+        {
+            std::unique_lock lock{ mutex };
+            cv.wait(lock, [&] { return runningCount == 0; });
+        }
+
+        for (std::size_t i{}; i < readers.size(); ++i)
+        {
+            const StreamReader& reader{ *readers[i] };
+            const double timeToFirstByte{ std::chrono::duration<double>(reader.getTimeToFirstByte()).count() };
+            const double duration{ std::chrono::duration<double>(reader.getDuration()).count() };
+
+            totalTimeToFirstByte += timeToFirstByte;
+            maxTimeToFirstByte = std::max(maxTimeToFirstByte, timeToFirstByte);
+            if (duration > 0)
+                totalRealtimeFactor += std::chrono::duration<double>(audioDurations[i]).count() / duration;
+            totalAudioDuration += audioDurations[i];
+            totalOutputSize += reader.getOutputSize();
+        }
+        streamCount += readers.size();
+
+        readers.clear(); // waits for the ffmpeg processes
+        totalCpuTime += getCpuTime() - cpuTimeBefore;
+    }
+
+    if (streamCount == 0)
+        return;
+
+    state.counters["ttfb_ms"] = totalTimeToFirstByte * 1000 / streamCount;
+    state.counters["ttfb_max_ms"] = maxTimeToFirstByte * 1000;
+    state.counters["realtime_factor"] = totalRealtimeFactor / streamCount;
+    state.counters["cpu_s_per_stream"] = totalCpuTime.count() / streamCount;
+    state.counters["audio_s_per_s"] = benchmark::Counter(totalAudioDuration.count(), benchmark::Counter::kIsRate);
+    state.SetBytesProcessed(totalOutputSize);
+}
+
+static void TranscodeArgs(benchmark::internal::Benchmark* benchmark)
+{
+    benchmark->ArgNames({ "kbps", "streams" });
+    for (const std::int64_t bitrate : { 96, 192 })
+    {
+        for (const std::int64_t concurrency : { 1, 4, 16 })
+            benchmark->Args({ bitrate, concurrency });
+    }
+    benchmark->Unit(benchmark::kMillisecond)->UseRealTime()->MeasureProcessCPUTime();
+}
+
+BENCHMARK_TEMPLATE(BM_Transcode, Backend::Ffmpeg, OutputFormat::MP3)->Apply(TranscodeArgs);
+BENCHMARK_TEMPLATE(BM_Transcode, Backend::LibAv, OutputFormat::MP3)->Apply(TranscodeArgs);
+BENCHMARK_TEMPLATE(BM_Transcode, Backend::Ffmpeg, OutputFormat::OGG_OPUS)->Apply(TranscodeArgs);
+BENCHMARK_TEMPLATE(BM_Transcode, Backend::LibAv, OutputFormat::OGG_OPUS)->Apply(TranscodeArgs);
+BENCHMARK_TEMPLATE(BM_Transcode, Backend::Ffmpeg, OutputFormat::OGG_VORBIS)->Apply(TranscodeArgs);
+BENCHMARK_TEMPLATE(BM_Transcode, Backend::LibAv, OutputFormat::OGG_VORBIS)->Apply(TranscodeArgs);
+
+BENCHMARK_MAIN();
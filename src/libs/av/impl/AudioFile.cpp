@@ -99,6 +99,15 @@ namespace Av
         return std::make_unique<AudioFile>(p);
     }
 
+    DecodingCodec getDecodingCodec(std::string_view codecName)
+    {
+        const AVCodecDescriptor* descriptor{ ::avcodec_descriptor_get_by_name(std::string{ codecName }.c_str()) };
+        if (!descriptor)
+            return DecodingCodec::UNKNOWN;
+
+        return avcodecToDecodingCodec(descriptor->id);
+    }
+
     AudioFile::AudioFile(const std::filesystem::path& p)
         : _p{ p }
     {
@@ -284,6 +293,8 @@ namespace Av
         res->codec = avcodecToDecodingCodec(avstream->codecpar->codec_id);
         res->codecName = ::avcodec_get_name(avstream->codecpar->codec_id);
         assert(!res->codecName.empty()); // doc says it is never NULL
+        res->sampleRate = avstream->codecpar->sample_rate > 0 ? static_cast<std::size_t>(avstream->codecpar->sample_rate) : 0;
+        res->channelCount = avstream->codecpar->ch_layout.nb_channels > 0 ? static_cast<std::size_t>(avstream->codecpar->ch_layout.nb_channels) : 0;
 
         return res;
     }
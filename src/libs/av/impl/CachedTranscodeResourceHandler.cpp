@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CachedTranscodeResourceHandler.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "utils/ILogger.hpp"
+#include "TranscodingResourceHandler.hpp"
+
+namespace Av::Transcoding
+{
+    CachedTranscodeResourceHandler::CachedTranscodeResourceHandler(std::shared_ptr<TranscodeCache::Entry> entry, std::string_view mimeType, std::optional<std::size_t> estimatedContentLength)
+        : _entry{ std::move(entry) }
+        , _mimeType{ mimeType }
+        , _estimatedContentLength{ estimatedContentLength }
+    {
+    }
+
+    CachedTranscodeResourceHandler::~CachedTranscodeResourceHandler()
+    {
+        _entry->cancelWait(this);
+        if (_fd >= 0)
+            ::close(_fd);
+    }
+
+    Wt::Http::ResponseContinuation* CachedTranscodeResourceHandler::processRequest(const Wt::Http::Request& /*request*/, Wt::Http::Response& response)
+    {
+        if (_fd < 0)
+        {
+            _fd = _entry->open();
+            if (_fd < 0)
+            {
+                LMS_LOG(TRANSCODING, ERROR, "Cannot open transcode cache file: " << ::strerror(errno));
+                response.setStatus(404);
+                return {};
+            }
+            _buffer.resize(_chunkSize);
+        }
+
+        response.addHeader("Accept-Ranges", "none");
+        if (_estimatedContentLength)
+            response.setContentLength(*_estimatedContentLength);
+        response.setMimeType(_mimeType);
+
+        // state must be fetched before reading: everything is written once finished
+        const TranscodeCache::Entry::State state{ _entry->getState() };
+        if (_readByteCount < state.writtenSize)
+        {
+            const std::size_t pieceSize{ std::min(_buffer.size(), state.writtenSize - _readByteCount) };
+
+            ::ssize_t readSize;
+            do
+            {
+                readSize = ::pread(_fd, _buffer.data(), pieceSize, static_cast<::off_t>(_readByteCount));
+            } while (readSize < 0 && errno == EINTR);
+
+            if (readSize <= 0)
+            {
+                LMS_LOG(TRANSCODING, ERROR, "Cannot read transcode cache file: " << (readSize < 0 ? ::strerror(errno) : "unexpected end of file"));
+                return {};
+            }
+
+            const std::size_t writableSize{ getWritableSize(_estimatedContentLength, _totalServedByteCount, static_cast<std::size_t>(readSize)) };
+            LMS_LOG(TRANSCODING, DEBUG, "Writing " << writableSize << " cached bytes back to client");
+
+            response.out().write(_buffer.data(), writableSize);
+            _totalServedByteCount += writableSize;
+            _readByteCount += static_cast<std::size_t>(readSize);
+        }
+
+        if (_readByteCount < state.writtenSize)
+            return response.createContinuation();
+
+        if (!state.finished)
+        {
+            Wt::Http::ResponseContinuation* continuation{ response.createContinuation() };
+            continuation->waitForMoreData();
+            _entry->waitForData(this, _readByteCount, [continuation]
+                {
+                    continuation->haveMoreData();
+                });
+
+            return continuation;
+        }
+
+        _totalServedByteCount += writePadding(response.out(), _estimatedContentLength, _totalServedByteCount);
+
+        LMS_LOG(TRANSCODING, DEBUG, "Cached transcode served. Total served byte count = " << _totalServedByteCount);
+        return {};
+    }
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "utils/IResourceHandler.hpp"
+#include "TranscodeCache.hpp"
+
+namespace Av::Transcoding
+{
+    // Serves a transcode being written to the cache by another request
+    class CachedTranscodeResourceHandler final : public IResourceHandler
+    {
+    public:
+        CachedTranscodeResourceHandler(std::shared_ptr<TranscodeCache::Entry> entry, std::string_view mimeType, std::optional<std::size_t> estimatedContentLength);
+        ~CachedTranscodeResourceHandler() override;
+
+        CachedTranscodeResourceHandler(const CachedTranscodeResourceHandler&) = delete;
+        CachedTranscodeResourceHandler& operator=(const CachedTranscodeResourceHandler&) = delete;
+
+    private:
+        Wt::Http::ResponseContinuation* processRequest(const Wt::Http::Request& request, Wt::Http::Response& response) override;
+        void abort() override {};
+
+        static constexpr std::size_t _chunkSize{ 262'144 };
+
+        const std::shared_ptr<TranscodeCache::Entry> _entry;
+        const std::string _mimeType;
+        const std::optional<std::size_t> _estimatedContentLength;
+        int _fd{ -1 };
+        std::vector<char> _buffer;
+        std::size_t _readByteCount{};
+        std::size_t _totalServedByteCount{};
+    };
+}
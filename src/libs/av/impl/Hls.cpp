@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "av/Hls.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+#include "utils/IConfig.hpp"
+#include "utils/Service.hpp"
+
+namespace Av::Transcoding::Hls
+{
+    namespace
+    {
+        constexpr std::chrono::seconds defaultSegmentDuration{ 10 };
+        constexpr std::chrono::seconds minSegmentDuration{ 2 };
+    }
+
+    std::chrono::milliseconds getSegmentDuration()
+    {
+        static const std::chrono::milliseconds segmentDuration{ std::max<std::chrono::seconds>(std::chrono::seconds{ Service<IConfig>::get()->getULong("transcoding-hls-segment-duration", defaultSegmentDuration.count()) }, minSegmentDuration) };
+        return segmentDuration;
+    }
+
+    std::size_t getSegmentCount(std::chrono::milliseconds trackDuration)
+    {
+        if (trackDuration.count() <= 0)
+            return 0;
+
+        const std::chrono::milliseconds segmentDuration{ getSegmentDuration() };
+        return static_cast<std::size_t>((trackDuration.count() + segmentDuration.count() - 1) / segmentDuration.count());
+    }
+
+    std::string_view getPlaylistMimeType()
+    {
+        return "application/vnd.apple.mpegurl";
+    }
+
+    std::string createPlaylist(std::chrono::milliseconds trackDuration, std::function<std::string(std::size_t segmentIndex)> segmentUrlFunc)
+    {
+        const std::chrono::milliseconds segmentDuration{ getSegmentDuration() };
+        const std::size_t segmentCount{ getSegmentCount(trackDuration) };
+
+        std::ostringstream oss;
+        oss << "#EXTM3U\n"
+            << "#EXT-X-VERSION:3\n"
+            << "#EXT-X-PLAYLIST-TYPE:VOD\n"
+            << "#EXT-X-TARGETDURATION:" << std::chrono::ceil<std::chrono::seconds>(segmentDuration).count() << "\n"
+            << "#EXT-X-MEDIA-SEQUENCE:0\n";
+
+        oss << std::fixed << std::setprecision(3);
+        for (std::size_t segmentIndex{}; segmentIndex < segmentCount; ++segmentIndex)
+        {
+            const std::chrono::milliseconds remainingDuration{ trackDuration - segmentDuration * segmentIndex };
+            const std::chrono::milliseconds duration{ std::min(segmentDuration, remainingDuration) };
+
+            oss << "#EXTINF:" << duration.count() / 1000.f << ",\n"
+                << segmentUrlFunc(segmentIndex) << "\n";
+        }
+        oss << "#EXT-X-ENDLIST\n";
+
+        return oss.str();
+    }
+
+    OutputParameters createSegmentOutputParameters(std::size_t bitrate, std::optional<std::size_t> stream, std::size_t segmentIndex)
+    {
+        const std::chrono::milliseconds segmentDuration{ getSegmentDuration() };
+
+        OutputParameters outputParameters;
+        outputParameters.format = OutputFormat::MPEGTS_MP3;
+        outputParameters.bitrate = bitrate;
+        outputParameters.stream = stream;
+        outputParameters.offset = segmentDuration * segmentIndex;
+        outputParameters.duration = segmentDuration;
+        outputParameters.stripMetadata = true;
+
+        return outputParameters;
+    }
+} // namespace Av::Transcoding::Hls
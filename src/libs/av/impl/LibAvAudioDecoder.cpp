@@ -0,0 +1,234 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "LibAvAudioDecoder.hpp"
+
+extern "C"
+{
+#define __STDC_CONSTANT_MACROS
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/error.h>
+#include <libavutil/samplefmt.h>
+#include <libswresample/swresample.h>
+}
+
+#include <array>
+#include <string>
+
+#include "av/Types.hpp"
+#include "utils/ILogger.hpp"
+
+namespace Av
+{
+    namespace
+    {
+        std::string averrorToString(int error)
+        {
+            std::array<char, 128> buf{};
+
+            if (::av_strerror(error, buf.data(), buf.size()) == 0)
+                return buf.data();
+            else
+                return "Unknown error";
+        }
+
+        class LibAvException : public Av::Exception
+        {
+        public:
+            LibAvException(std::string_view what, int avError)
+                : Av::Exception{ std::string{ what } + ": " + averrorToString(avError) }
+            {}
+        };
+    }
+
+    void decodeAudioFile(const std::filesystem::path& p, const DecodingParameters& parameters, const DecodedSamplesCallback& callback)
+    {
+        LibAvAudioDecoder decoder{ p, parameters };
+        decoder.decode(callback);
+    }
+
+    LibAvAudioDecoder::LibAvAudioDecoder(const std::filesystem::path& p, const DecodingParameters& parameters)
+        : _path{ p }
+    {
+        try
+        {
+            openInput();
+            openDecoder();
+            openResampler(parameters);
+
+            _packet = ::av_packet_alloc();
+            _decodedFrame = ::av_frame_alloc();
+            if (!_packet || !_decodedFrame)
+                throw LibAvException{ "Cannot allocate frame", AVERROR(ENOMEM) };
+        }
+        catch (...)
+        {
+            release();
+            throw;
+        }
+    }
+
+    LibAvAudioDecoder::~LibAvAudioDecoder()
+    {
+        release();
+    }
+
+    void LibAvAudioDecoder::release()
+    {
+        ::av_frame_free(&_decodedFrame);
+        ::av_packet_free(&_packet);
+        ::swr_free(&_resampler);
+        ::av_channel_layout_uninit(&_outputChannelLayout);
+        ::avcodec_free_context(&_decoderContext);
+        ::avformat_close_input(&_inputContext);
+    }
+
+    void LibAvAudioDecoder::openInput()
+    {
+        const std::string path{ _path.string() };
+
+        int error{ ::avformat_open_input(&_inputContext, path.c_str(), nullptr, nullptr) };
+        if (error < 0)
+            throw LibAvException{ "Cannot open '" + path + "'", error };
+
+        error = ::avformat_find_stream_info(_inputContext, nullptr);
+        if (error < 0)
+            throw LibAvException{ "Cannot find stream information on '" + path + "'", error };
+
+        _inputStreamIndex = ::av_find_best_stream(_inputContext, AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0);
+        if (_inputStreamIndex < 0)
+            throw Exception{ "Cannot find audio stream in '" + path + "'" };
+
+        // only the audio stream has to be demuxed
+        for (unsigned i{}; i < _inputContext->nb_streams; ++i)
+        {
+            if (static_cast<int>(i) != _inputStreamIndex)
+                _inputContext->streams[i]->discard = AVDISCARD_ALL;
+        }
+    }
+
+    void LibAvAudioDecoder::openDecoder()
+    {
+        const AVStream* inputStream{ _inputContext->streams[_inputStreamIndex] };
+
+        const AVCodec* decoder{ ::avcodec_find_decoder(inputStream->codecpar->codec_id) };
+        if (!decoder)
+            throw Exception{ "Cannot find decoder" };
+
+        _decoderContext = ::avcodec_alloc_context3(decoder);
+        if (!_decoderContext)
+            throw LibAvException{ "Cannot allocate decoder", AVERROR(ENOMEM) };
+
+        int error{ ::avcodec_parameters_to_context(_decoderContext, inputStream->codecpar) };
+        if (error < 0)
+            throw LibAvException{ "Cannot set decoder parameters", error };
+        _decoderContext->pkt_timebase = inputStream->time_base;
+
+        error = ::avcodec_open2(_decoderContext, decoder, nullptr);
+        if (error < 0)
+            throw LibAvException{ "Cannot open decoder", error };
+
+        if (_decoderContext->ch_layout.order == AV_CHANNEL_ORDER_UNSPEC)
+            ::av_channel_layout_default(&_decoderContext->ch_layout, _decoderContext->ch_layout.nb_channels);
+
+        if (_decoderContext->sample_rate <= 0 || _decoderContext->ch_layout.nb_channels <= 0)
+            throw Exception{ "Unsupported audio stream in '" + _path.string() + "'" };
+    }
+
+    void LibAvAudioDecoder::openResampler(const DecodingParameters& parameters)
+    {
+        int error{};
+        if (parameters.channelCount)
+            ::av_channel_layout_default(&_outputChannelLayout, static_cast<int>(parameters.channelCount));
+        else
+            error = ::av_channel_layout_copy(&_outputChannelLayout, &_decoderContext->ch_layout);
+        if (error < 0)
+            throw LibAvException{ "Cannot set output channel layout", error };
+
+        _outputSampleRate = parameters.sampleRate ? static_cast<int>(parameters.sampleRate) : _decoderContext->sample_rate;
+
+        error = ::swr_alloc_set_opts2(&_resampler,
+            &_outputChannelLayout, AV_SAMPLE_FMT_FLT, _outputSampleRate,
+            &_decoderContext->ch_layout, _decoderContext->sample_fmt, _decoderContext->sample_rate,
+            0, nullptr);
+        if (error < 0)
+            throw LibAvException{ "Cannot allocate resampler", error };
+
+        error = ::swr_init(_resampler);
+        if (error < 0)
+            throw LibAvException{ "Cannot init resampler", error };
+    }
+
+    void LibAvAudioDecoder::decode(const DecodedSamplesCallback& callback)
+    {
+        while (true)
+        {
+            const int error{ ::av_read_frame(_inputContext, _packet) };
+            if (error < 0)
+            {
+                if (error != AVERROR_EOF)
+                    throw LibAvException{ "Cannot read '" + _path.string() + "'", error };
+                break;
+            }
+
+            if (_packet->stream_index == _inputStreamIndex)
+            {
+                const int sendError{ ::avcodec_send_packet(_decoderContext, _packet) };
+                if (sendError < 0)
+                    LMS_LOG(AV, DEBUG, "Cannot decode packet in '" << _path.string() << "': " << averrorToString(sendError));
+            }
+            ::av_packet_unref(_packet);
+
+            receiveDecodedFrames(callback);
+        }
+
+        ::avcodec_send_packet(_decoderContext, nullptr);
+        receiveDecodedFrames(callback);
+        resample(nullptr, callback);
+    }
+
+    void LibAvAudioDecoder::receiveDecodedFrames(const DecodedSamplesCallback& callback)
+    {
+        while (::avcodec_receive_frame(_decoderContext, _decodedFrame) == 0)
+        {
+            resample(_decodedFrame, callback);
+            ::av_frame_unref(_decodedFrame);
+        }
+    }
+
+    void LibAvAudioDecoder::resample(const AVFrame* frame, const DecodedSamplesCallback& callback)
+    {
+        const int maxSampleCount{ ::swr_get_out_samples(_resampler, frame ? frame->nb_samples : 0) };
+        if (maxSampleCount <= 0)
+            return;
+
+        const std::size_t channelCount{ static_cast<std::size_t>(_outputChannelLayout.nb_channels) };
+        _samples.resize(static_cast<std::size_t>(maxSampleCount) * channelCount);
+
+        std::uint8_t* output{ reinterpret_cast<std::uint8_t*>(_samples.data()) };
+        const int sampleCount{ ::swr_convert(_resampler, &output, maxSampleCount,
+            frame ? const_cast<const std::uint8_t**>(frame->extended_data) : nullptr, frame ? frame->nb_samples : 0) };
+        if (sampleCount < 0)
+            throw LibAvException{ "Cannot convert samples", sampleCount };
+
+        if (sampleCount > 0)
+            callback(std::span{ _samples }.first(static_cast<std::size_t>(sampleCount) * channelCount));
+    }
+} // namespace Av
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+extern "C"
+{
+#include <libavutil/channel_layout.h>
+}
+
+#include <filesystem>
+#include <vector>
+
+#include "av/AudioDecoding.hpp"
+
+struct AVCodecContext;
+struct AVFormatContext;
+struct AVFrame;
+struct AVPacket;
+struct SwrContext;
+
+namespace Av
+{
+    // Decodes in process using libavformat/libavcodec, the samples are converted into interleaved floats
+    class LibAvAudioDecoder
+    {
+    public:
+        LibAvAudioDecoder(const std::filesystem::path& p, const DecodingParameters& parameters);
+        ~LibAvAudioDecoder();
+
+        LibAvAudioDecoder(const LibAvAudioDecoder&) = delete;
+        LibAvAudioDecoder& operator=(const LibAvAudioDecoder&) = delete;
+
+        // output format
+        std::size_t getSampleRate() const { return static_cast<std::size_t>(_outputSampleRate); }
+        const AVChannelLayout& getChannelLayout() const { return _outputChannelLayout; }
+
+        // can be called only once
+        void decode(const DecodedSamplesCallback& callback);
+
+    private:
+        void openInput();
+        void openDecoder();
+        void openResampler(const DecodingParameters& parameters);
+        void release();
+
+        void receiveDecodedFrames(const DecodedSamplesCallback& callback);
+        void resample(const AVFrame* frame, const DecodedSamplesCallback& callback);
+
+        const std::filesystem::path _path;
+        AVFormatContext* _inputContext{};
+        int _inputStreamIndex{ -1 };
+        AVCodecContext* _decoderContext{};
+        SwrContext* _resampler{};
+        AVPacket* _packet{};
+        AVFrame* _decodedFrame{};
+        AVChannelLayout _outputChannelLayout{};
+        int _outputSampleRate{};
+        std::vector<float> _samples;
+    };
+} // namespace Av
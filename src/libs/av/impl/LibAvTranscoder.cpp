@@ -0,0 +1,802 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "LibAvTranscoder.hpp"
+
+extern "C"
+{
+#define __STDC_CONSTANT_MACROS
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/audio_fifo.h>
+#include <libavutil/channel_layout.h>
+#include <libavutil/error.h>
+#include <libswresample/swresample.h>
+}
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/post.hpp>
+
+#include "utils/IConfig.hpp"
+#include "utils/ILogger.hpp"
+#include "utils/IOContextRunner.hpp"
+#include "utils/Service.hpp"
+
+namespace Av::Transcoding
+{
+#define LOG(severity, message)	LMS_LOG(TRANSCODING, severity, "[" << _debugId << "] - " << message)
+
+    namespace
+    {
+        std::atomic<std::size_t> globalId{};
+
+        // Amount of output produced by a worker before letting other transcoders run
+        constexpr std::size_t outputChunkSize{ 65'536 };
+        constexpr std::size_t ioBufferSize{ 32'768 };
+
+        std::string averrorToString(int error)
+        {
+            std::array<char, 128> buf{};
+
+            if (::av_strerror(error, buf.data(), buf.size()) == 0)
+                return buf.data();
+            else
+                return "Unknown error";
+        }
+
+        class LibAvException : public Av::Exception
+        {
+        public:
+            LibAvException(std::string_view what, int avError)
+                : Av::Exception{ std::string{ what } + ": " + averrorToString(avError) }
+            {}
+        };
+
+        struct FormatInfo
+        {
+            const char* muxerName;
+            const char* encoderName;
+        };
+
+        FormatInfo getFormatInfo(OutputFormat format)
+        {
+            switch (format)
+            {
+            case OutputFormat::MP3:             return { "mp3", "libmp3lame" };
+            case OutputFormat::OGG_OPUS:        return { "ogg", "libopus" };
+            case OutputFormat::MATROSKA_OPUS:   return { "matroska", "libopus" };
+            case OutputFormat::OGG_VORBIS:      return { "ogg", "libvorbis" };
+            case OutputFormat::WEBM_VORBIS:     return { "webm", "libvorbis" };
+            case OutputFormat::MPEGTS_MP3:      return { "mpegts", "libmp3lame" };
+            }
+
+            throw Exception{ "Unhandled format (" + std::to_string(static_cast<int>(format)) + ")" };
+        }
+
+        int selectSampleRate(const AVCodec* encoder, int inputSampleRate)
+        {
+            if (!encoder->supported_samplerates)
+                return inputSampleRate;
+
+            for (const int* sampleRate{ encoder->supported_samplerates }; *sampleRate; ++sampleRate)
+            {
+                if (*sampleRate == inputSampleRate)
+                    return inputSampleRate;
+            }
+
+            // first one is the preferred one
+            return encoder->supported_samplerates[0];
+        }
+
+        // Shared pool of worker threads
+        class WorkerPool
+        {
+        public:
+            static WorkerPool& get()
+            {
+                static WorkerPool pool;
+                return pool;
+            }
+
+            boost::asio::io_service& getIoService() { return _ioService; }
+
+        private:
+            WorkerPool()
+                : _ioContextRunner{ _ioService, readThreadCount() }
+            {
+                LMS_LOG(TRANSCODING, INFO, "Using " << _ioContextRunner.getThreadCount() << " threads for in-process transcoding");
+            }
+
+            static std::size_t readThreadCount()
+            {
+                const std::size_t threadCount{ Service<IConfig>::get()->getULong("transcoder-libav-thread-count", 0) };
+                return threadCount ? threadCount : std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+            }
+
+            boost::asio::io_service _ioService;
+            IOContextRunner _ioContextRunner;
+        };
+    }
+
+    class LibAvTranscoder::Job : public std::enable_shared_from_this<Job>
+    {
+    public:
+        Job(std::size_t debugId, const InputParameters& inputParameters, const OutputParameters& outputParameters, bool copyAudioStream);
+        ~Job();
+
+        Job(const Job&) = delete;
+        Job& operator=(const Job&) = delete;
+
+        void asyncRead(std::byte* buffer, std::size_t bufferSize, ReadCallback callback);
+        std::size_t readSome(std::byte* buffer, std::size_t bufferSize);
+        bool finished() const;
+        void abort();
+
+    private:
+        void openInput(const InputParameters& inputParameters, const OutputParameters& outputParameters);
+        void openDecoder();
+        void openEncoder(const OutputParameters& outputParameters);
+        void openOutput(const OutputParameters& outputParameters);
+        void openResampler();
+        void release();
+
+        void schedule(); // must be locked
+        void work();
+        void deliver(); // must be locked
+        std::size_t consumeOutput(std::byte* buffer, std::size_t bufferSize); // must be locked
+
+        // run by the worker only
+        void processNextPacket();
+        void copyPacket();
+        void flush();
+        void receiveDecodedFrames();
+        void resample(const AVFrame* frame);
+        void encodeFromFifo(bool flush);
+        void encode(AVFrame* frame);
+
+#if LIBAVFORMAT_VERSION_MAJOR >= 61
+        static int writeOutput(void* opaque, const std::uint8_t* buffer, int bufferSize);
+#else
+        static int writeOutput(void* opaque, std::uint8_t* buffer, int bufferSize);
+#endif
+
+        const std::size_t _debugId;
+        const bool _copyAudioStream;
+
+        AVFormatContext* _inputContext{};
+        int _inputStreamIndex{ -1 };
+        AVCodecContext* _decoderContext{};
+        AVFormatContext* _outputContext{};
+        AVIOContext* _ioContext{};
+        AVStream* _outputStream{};
+        AVCodecContext* _encoderContext{};
+        bool _encoderAcceptsAnyFrameSize{};
+        int _encoderFrameSize{};
+        SwrContext* _resampler{};
+        AVAudioFifo* _fifo{};
+        AVPacket* _packet{};
+        AVFrame* _decodedFrame{};
+        std::vector<std::uint8_t*> _resampledData;  // one entry per plane
+        int _resampledCapacity{};                   // in samples
+        std::int64_t _nextPts{};
+        std::optional<std::int64_t> _remainingSampleCount;   // set if the output duration is limited
+        std::int64_t _copyStartTimestamp{ AV_NOPTS_VALUE }; // copied packets are shifted to start at 0
+        bool _inputDone{};                          // all the output has been produced
+
+        mutable std::recursive_mutex _mutex; // read callbacks are called with the lock held, and may issue the next read
+        bool _scheduled{};
+        bool _aborted{};
+        bool _finished{};                           // all the output has been consumed
+        std::vector<std::byte> _output;
+        std::size_t _outputOffset{};
+        struct PendingRead
+        {
+            std::byte* buffer;
+            std::size_t bufferSize;
+            ReadCallback callback;
+        };
+        std::optional<PendingRead> _pendingRead;
+    };
+
+    LibAvTranscoder::Job::Job(std::size_t debugId, const InputParameters& inputParameters, const OutputParameters& outputParameters, bool copyAudioStream)
+        : _debugId{ debugId }
+        , _copyAudioStream{ copyAudioStream }
+    {
+        try
+        {
+            openInput(inputParameters, outputParameters);
+            openOutput(outputParameters);
+            if (!_copyAudioStream)
+                openResampler();
+
+            _packet = ::av_packet_alloc();
+            _decodedFrame = ::av_frame_alloc();
+            if (!_packet || !_decodedFrame)
+                throw LibAvException{ "Cannot allocate frames", AVERROR(ENOMEM) };
+        }
+        catch (...)
+        {
+            release();
+            throw;
+        }
+    }
+
+    LibAvTranscoder::Job::~Job()
+    {
+        release();
+    }
+
+    void LibAvTranscoder::Job::release()
+    {
+        if (!_resampledData.empty())
+            ::av_freep(&_resampledData[0]);
+        _resampledData.clear();
+
+        ::av_frame_free(&_decodedFrame);
+        ::av_packet_free(&_packet);
+        if (_fifo)
+        {
+            ::av_audio_fifo_free(_fifo);
+            _fifo = nullptr;
+        }
+        ::swr_free(&_resampler);
+        ::avcodec_free_context(&_encoderContext);
+        if (_outputContext)
+        {
+            ::avformat_free_context(_outputContext);
+            _outputContext = nullptr;
+        }
+        if (_ioContext)
+        {
+            ::av_freep(&_ioContext->buffer);
+            ::avio_context_free(&_ioContext);
+        }
+        ::avcodec_free_context(&_decoderContext);
+        ::avformat_close_input(&_inputContext);
+    }
+
+    void LibAvTranscoder::Job::openInput(const InputParameters& inputParameters, const OutputParameters& outputParameters)
+    {
+        const std::string path{ inputParameters.trackPath.string() };
+
+        int error{ ::avformat_open_input(&_inputContext, path.c_str(), nullptr, nullptr) };
+        if (error < 0)
+            throw LibAvException{ "Cannot open '" + path + "'", error };
+
+        error = ::avformat_find_stream_info(_inputContext, nullptr);
+        if (error < 0)
+            throw LibAvException{ "Cannot find stream information on '" + path + "'", error };
+
+        if (outputParameters.stream)
+            _inputStreamIndex = static_cast<int>(*outputParameters.stream);
+        else
+            _inputStreamIndex = ::av_find_best_stream(_inputContext, AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0);
+
+        if (_inputStreamIndex < 0 || static_cast<unsigned>(_inputStreamIndex) >= _inputContext->nb_streams
+            || _inputContext->streams[_inputStreamIndex]->codecpar->codec_type != AVMEDIA_TYPE_AUDIO)
+            throw Exception{ "Cannot find audio stream in '" + path + "'" };
+
+        if (!_copyAudioStream)
+            openDecoder();
+
+        if (outputParameters.offset.count() > 0)
+        {
+            const std::int64_t timestamp{ std::chrono::duration_cast<std::chrono::microseconds>(outputParameters.offset).count() * AV_TIME_BASE / 1'000'000 };
+            error = ::avformat_seek_file(_inputContext, -1, INT64_MIN, timestamp, timestamp, 0);
+            if (error < 0)
+                LOG(ERROR, "Cannot seek in '" << path << "': " << averrorToString(error));
+        }
+    }
+
+    void LibAvTranscoder::Job::openDecoder()
+    {
+        const AVStream* inputStream{ _inputContext->streams[_inputStreamIndex] };
+
+        const AVCodec* decoder{ ::avcodec_find_decoder(inputStream->codecpar->codec_id) };
+        if (!decoder)
+            throw Exception{ "Cannot find decoder" };
+
+        _decoderContext = ::avcodec_alloc_context3(decoder);
+        if (!_decoderContext)
+            throw LibAvException{ "Cannot allocate decoder", AVERROR(ENOMEM) };
+
+        int error{ ::avcodec_parameters_to_context(_decoderContext, inputStream->codecpar) };
+        if (error < 0)
+            throw LibAvException{ "Cannot set decoder parameters", error };
+        _decoderContext->pkt_timebase = inputStream->time_base;
+
+        error = ::avcodec_open2(_decoderContext, decoder, nullptr);
+        if (error < 0)
+            throw LibAvException{ "Cannot open decoder", error };
+
+        if (_decoderContext->ch_layout.order == AV_CHANNEL_ORDER_UNSPEC)
+            ::av_channel_layout_default(&_decoderContext->ch_layout, _decoderContext->ch_layout.nb_channels);
+    }
+
+    void LibAvTranscoder::Job::openOutput(const OutputParameters& outputParameters)
+    {
+        const FormatInfo formatInfo{ getFormatInfo(outputParameters.format) };
+
+        int error{ ::avformat_alloc_output_context2(&_outputContext, nullptr, formatInfo.muxerName, nullptr) };
+        if (error < 0)
+            throw LibAvException{ std::string{ "Cannot create output '" } + formatInfo.muxerName + "'", error };
+
+        if (_copyAudioStream)
+        {
+            const AVStream* inputStream{ _inputContext->streams[_inputStreamIndex] };
+
+            _outputStream = ::avformat_new_stream(_outputContext, nullptr);
+            if (!_outputStream)
+                throw LibAvException{ "Cannot create output stream", AVERROR(ENOMEM) };
+
+            error = ::avcodec_parameters_copy(_outputStream->codecpar, inputStream->codecpar);
+            if (error < 0)
+                throw LibAvException{ "Cannot set output stream parameters", error };
+            _outputStream->codecpar->codec_tag = 0; // let the muxer choose
+            _outputStream->time_base = inputStream->time_base;
+        }
+        else
+        {
+            openEncoder(outputParameters);
+        }
+
+        if (!outputParameters.stripMetadata)
+            ::av_dict_copy(&_outputContext->metadata, _inputContext->metadata, 0);
+
+        // The output is written in memory, to be read by the client
+        std::uint8_t* ioBuffer{ static_cast<std::uint8_t*>(::av_malloc(ioBufferSize)) };
+        if (!ioBuffer)
+            throw LibAvException{ "Cannot allocate output buffer", AVERROR(ENOMEM) };
+
+        _ioContext = ::avio_alloc_context(ioBuffer, ioBufferSize, 1 /* write */, this, nullptr, &Job::writeOutput, nullptr);
+        if (!_ioContext)
+        {
+            ::av_free(ioBuffer);
+            throw LibAvException{ "Cannot allocate output context", AVERROR(ENOMEM) };
+        }
+        _ioContext->seekable = 0;
+        _outputContext->pb = _ioContext;
+        _outputContext->flags |= AVFMT_FLAG_CUSTOM_IO;
+
+        error = ::avformat_write_header(_outputContext, nullptr);
+        if (error < 0)
+            throw LibAvException{ "Cannot write output header", error };
+    }
+
+    void LibAvTranscoder::Job::openEncoder(const OutputParameters& outputParameters)
+    {
+        const FormatInfo formatInfo{ getFormatInfo(outputParameters.format) };
+
+        const AVCodec* encoder{ ::avcodec_find_encoder_by_name(formatInfo.encoderName) };
+        if (!encoder)
+            throw Exception{ std::string{ "Cannot find encoder '" } + formatInfo.encoderName + "'" };
+
+        _encoderContext = ::avcodec_alloc_context3(encoder);
+        if (!_encoderContext)
+            throw LibAvException{ "Cannot allocate encoder", AVERROR(ENOMEM) };
+
+        // Downmix to stereo at most
+        ::av_channel_layout_default(&_encoderContext->ch_layout, std::min(_decoderContext->ch_layout.nb_channels, 2));
+        _encoderContext->sample_rate = selectSampleRate(encoder, _decoderContext->sample_rate);
+        _encoderContext->sample_fmt = encoder->sample_fmts ? encoder->sample_fmts[0] : AV_SAMPLE_FMT_FLTP;
+        _encoderContext->bit_rate = static_cast<std::int64_t>(outputParameters.bitrate);
+        _encoderContext->time_base = AVRational{ 1, _encoderContext->sample_rate };
+
+        if (outputParameters.duration)
+            _remainingSampleCount = outputParameters.duration->count() * _encoderContext->sample_rate / 1000;
+        // keep the timestamps of consecutive segments continuous
+        if (outputParameters.format == OutputFormat::MPEGTS_MP3)
+            _nextPts = outputParameters.offset.count() * _encoderContext->sample_rate / 1000;
+        if (_outputContext->oformat->flags & AVFMT_GLOBALHEADER)
+            _encoderContext->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+
+        int error{ ::avcodec_open2(_encoderContext, encoder, nullptr) };
+        if (error < 0)
+            throw LibAvException{ std::string{ "Cannot open encoder '" } + formatInfo.encoderName + "'", error };
+
+        _encoderAcceptsAnyFrameSize = (encoder->capabilities & AV_CODEC_CAP_VARIABLE_FRAME_SIZE) || _encoderContext->frame_size <= 0;
+        _encoderFrameSize = _encoderContext->frame_size > 0 ? _encoderContext->frame_size : 1024;
+
+        _outputStream = ::avformat_new_stream(_outputContext, nullptr);
+        if (!_outputStream)
+            throw LibAvException{ "Cannot create output stream", AVERROR(ENOMEM) };
+
+        error = ::avcodec_parameters_from_context(_outputStream->codecpar, _encoderContext);
+        if (error < 0)
+            throw LibAvException{ "Cannot set output stream parameters", error };
+        _outputStream->time_base = _encoderContext->time_base;
+    }
+
+    void LibAvTranscoder::Job::openResampler()
+    {
+        int error{ ::swr_alloc_set_opts2(&_resampler,
+            &_encoderContext->ch_layout, _encoderContext->sample_fmt, _encoderContext->sample_rate,
+            &_decoderContext->ch_layout, _decoderContext->sample_fmt, _decoderContext->sample_rate,
+            0, nullptr) };
+        if (error < 0)
+            throw LibAvException{ "Cannot allocate resampler", error };
+
+        error = ::swr_init(_resampler);
+        if (error < 0)
+            throw LibAvException{ "Cannot init resampler", error };
+
+        _fifo = ::av_audio_fifo_alloc(_encoderContext->sample_fmt, _encoderContext->ch_layout.nb_channels, _encoderFrameSize);
+        if (!_fifo)
+            throw LibAvException{ "Cannot allocate sample fifo", AVERROR(ENOMEM) };
+    }
+
+#if LIBAVFORMAT_VERSION_MAJOR >= 61
+    int LibAvTranscoder::Job::writeOutput(void* opaque, const std::uint8_t* buffer, int bufferSize)
+#else
+    int LibAvTranscoder::Job::writeOutput(void* opaque, std::uint8_t* buffer, int bufferSize)
+#endif
+    {
+        Job& job{ *static_cast<Job*>(opaque) };
+
+        const std::scoped_lock lock{ job._mutex };
+        const std::byte* data{ reinterpret_cast<const std::byte*>(buffer) };
+        try
+        {
+            job._output.insert(std::end(job._output), data, data + bufferSize);
+        }
+        catch (const std::bad_alloc&)
+        {
+            return AVERROR(ENOMEM);
+        }
+
+        return bufferSize;
+    }
+
+    void LibAvTranscoder::Job::asyncRead(std::byte* buffer, std::size_t bufferSize, ReadCallback callback)
+    {
+        const std::scoped_lock lock{ _mutex };
+
+        assert(!_pendingRead);
+        _pendingRead = PendingRead{ buffer, bufferSize, std::move(callback) };
+        schedule();
+    }
+
+    std::size_t LibAvTranscoder::Job::readSome(std::byte* buffer, std::size_t bufferSize)
+    {
+        const std::scoped_lock lock{ _mutex };
+        return consumeOutput(buffer, bufferSize);
+    }
+
+    bool LibAvTranscoder::Job::finished() const
+    {
+        const std::scoped_lock lock{ _mutex };
+        return _finished;
+    }
+
+    void LibAvTranscoder::Job::abort()
+    {
+        // callbacks are called with the lock held: none will be called once returned
+        const std::scoped_lock lock{ _mutex };
+
+        _aborted = true;
+        _pendingRead.reset();
+    }
+
+    void LibAvTranscoder::Job::schedule()
+    {
+        if (_scheduled || _aborted)
+            return;
+
+        _scheduled = true;
+        boost::asio::post(WorkerPool::get().getIoService(), [job{ shared_from_this() }]
+            {
+                job->work();
+            });
+    }
+
+    void LibAvTranscoder::Job::work()
+    {
+        try
+        {
+            // produce a chunk at most, to let other transcoders run
+            while (true)
+            {
+                {
+                    const std::scoped_lock lock{ _mutex };
+                    if (_aborted || _inputDone || _output.size() - _outputOffset >= outputChunkSize)
+                        break;
+                }
+
+                processNextPacket();
+            }
+        }
+        catch (const Exception& e)
+        {
+            LOG(ERROR, "Transcode failed: " << e.what());
+
+            const std::scoped_lock lock{ _mutex };
+            _inputDone = true;
+        }
+
+        const std::scoped_lock lock{ _mutex };
+        _scheduled = false;
+        deliver();
+
+        if (_pendingRead)
+            schedule();
+    }
+
+    void LibAvTranscoder::Job::deliver()
+    {
+        if (!_pendingRead || _aborted)
+            return;
+
+        if (_output.size() == _outputOffset && !_inputDone)
+            return;
+
+        PendingRead pendingRead{ std::move(*_pendingRead) };
+        _pendingRead.reset();
+
+        const std::size_t readSize{ consumeOutput(pendingRead.buffer, pendingRead.bufferSize) };
+        pendingRead.callback(readSize);
+    }
+
+    std::size_t LibAvTranscoder::Job::consumeOutput(std::byte* buffer, std::size_t bufferSize)
+    {
+        const std::size_t readSize{ std::min(bufferSize, _output.size() - _outputOffset) };
+        std::memcpy(buffer, _output.data() + _outputOffset, readSize);
+        _outputOffset += readSize;
+
+        if (_outputOffset == _output.size())
+        {
+            _output.clear();
+            _outputOffset = 0;
+
+            if (_inputDone)
+                _finished = true;
+        }
+
+        return readSize;
+    }
+
+    void LibAvTranscoder::Job::processNextPacket()
+    {
+        if (_remainingSampleCount && *_remainingSampleCount == 0)
+        {
+            flush();
+            return;
+        }
+
+        const int error{ ::av_read_frame(_inputContext, _packet) };
+        if (error < 0)
+        {
+            if (error != AVERROR_EOF)
+                LOG(ERROR, "Cannot read input: " << averrorToString(error));
+
+            flush();
+            return;
+        }
+
+        if (_copyAudioStream)
+        {
+            if (_packet->stream_index == _inputStreamIndex)
+                copyPacket();
+            ::av_packet_unref(_packet);
+            return;
+        }
+
+        if (_packet->stream_index == _inputStreamIndex)
+        {
+            const int sendError{ ::avcodec_send_packet(_decoderContext, _packet) };
+            if (sendError < 0)
+                LOG(DEBUG, "Cannot decode packet: " << averrorToString(sendError));
+        }
+        ::av_packet_unref(_packet);
+
+        receiveDecodedFrames();
+    }
+
+    void LibAvTranscoder::Job::copyPacket()
+    {
+        if (_copyStartTimestamp == AV_NOPTS_VALUE)
+            _copyStartTimestamp = _packet->dts != AV_NOPTS_VALUE ? _packet->dts : _packet->pts;
+
+        if (_copyStartTimestamp != AV_NOPTS_VALUE)
+        {
+            if (_packet->pts != AV_NOPTS_VALUE)
+                _packet->pts -= _copyStartTimestamp;
+            if (_packet->dts != AV_NOPTS_VALUE)
+                _packet->dts -= _copyStartTimestamp;
+        }
+
+        ::av_packet_rescale_ts(_packet, _inputContext->streams[_inputStreamIndex]->time_base, _outputStream->time_base);
+        _packet->stream_index = _outputStream->index;
+        _packet->pos = -1;
+
+        const int error{ ::av_interleaved_write_frame(_outputContext, _packet) }; // takes ownership of the packet content
+        if (error < 0)
+            throw LibAvException{ "Cannot write copied packet", error };
+    }
+
+    void LibAvTranscoder::Job::flush()
+    {
+        if (!_copyAudioStream)
+        {
+            ::avcodec_send_packet(_decoderContext, nullptr);
+            receiveDecodedFrames();
+
+            resample(nullptr);
+            encodeFromFifo(true);
+            encode(nullptr);
+        }
+
+        const int error{ ::av_write_trailer(_outputContext) };
+        if (error < 0)
+            LOG(ERROR, "Cannot write output trailer: " << averrorToString(error));
+        ::avio_flush(_ioContext);
+
+        const std::scoped_lock lock{ _mutex };
+        _inputDone = true;
+    }
+
+    void LibAvTranscoder::Job::receiveDecodedFrames()
+    {
+        while (::avcodec_receive_frame(_decoderContext, _decodedFrame) == 0)
+        {
+            resample(_decodedFrame);
+            ::av_frame_unref(_decodedFrame);
+
+            encodeFromFifo(false);
+        }
+    }
+
+    void LibAvTranscoder::Job::resample(const AVFrame* frame)
+    {
+        const int maxSampleCount{ ::swr_get_out_samples(_resampler, frame ? frame->nb_samples : 0) };
+        if (maxSampleCount <= 0)
+            return;
+
+        if (maxSampleCount > _resampledCapacity)
+        {
+            if (!_resampledData.empty())
+                ::av_freep(&_resampledData[0]);
+
+            _resampledData.resize(_encoderContext->ch_layout.nb_channels);
+            const int error{ ::av_samples_alloc(_resampledData.data(), nullptr, _encoderContext->ch_layout.nb_channels, maxSampleCount, _encoderContext->sample_fmt, 0) };
+            if (error < 0)
+            {
+                _resampledData.clear();
+                _resampledCapacity = 0;
+                throw LibAvException{ "Cannot allocate samples", error };
+            }
+            _resampledCapacity = maxSampleCount;
+        }
+
+        const int sampleCount{ ::swr_convert(_resampler, _resampledData.data(), _resampledCapacity,
+            frame ? const_cast<const std::uint8_t**>(frame->extended_data) : nullptr, frame ? frame->nb_samples : 0) };
+        if (sampleCount < 0)
+            throw LibAvException{ "Cannot resample", sampleCount };
+
+        int writeSampleCount{ sampleCount };
+        if (_remainingSampleCount)
+        {
+            writeSampleCount = static_cast<int>(std::min<std::int64_t>(writeSampleCount, *_remainingSampleCount));
+            *_remainingSampleCount -= writeSampleCount;
+        }
+
+        if (writeSampleCount > 0 && ::av_audio_fifo_write(_fifo, reinterpret_cast<void**>(_resampledData.data()), writeSampleCount) < writeSampleCount)
+            throw LibAvException{ "Cannot write samples", AVERROR(ENOMEM) };
+    }
+
+    void LibAvTranscoder::Job::encodeFromFifo(bool flush)
+    {
+        while (::av_audio_fifo_size(_fifo) >= _encoderFrameSize || (flush && ::av_audio_fifo_size(_fifo) > 0))
+        {
+            const int sampleCount{ std::min(::av_audio_fifo_size(_fifo), _encoderFrameSize) };
+            // fixed frame size encoders: complete the last frame with silence
+            const int frameSampleCount{ _encoderAcceptsAnyFrameSize ? sampleCount : _encoderFrameSize };
+
+            AVFrame* frame{ ::av_frame_alloc() };
+            if (!frame)
+                throw LibAvException{ "Cannot allocate frame", AVERROR(ENOMEM) };
+
+            frame->nb_samples = frameSampleCount;
+            frame->format = _encoderContext->sample_fmt;
+            frame->sample_rate = _encoderContext->sample_rate;
+            ::av_channel_layout_copy(&frame->ch_layout, &_encoderContext->ch_layout);
+
+            int error{ ::av_frame_get_buffer(frame, 0) };
+            if (error >= 0)
+            {
+                ::av_audio_fifo_read(_fifo, reinterpret_cast<void**>(frame->data), sampleCount);
+                if (frameSampleCount > sampleCount)
+                    ::av_samples_set_silence(frame->data, sampleCount, frameSampleCount - sampleCount, frame->ch_layout.nb_channels, _encoderContext->sample_fmt);
+
+                frame->pts = _nextPts;
+                _nextPts += frameSampleCount;
+
+                encode(frame);
+            }
+            ::av_frame_free(&frame);
+
+            if (error < 0)
+                throw LibAvException{ "Cannot allocate frame buffer", error };
+        }
+    }
+
+    void LibAvTranscoder::Job::encode(AVFrame* frame)
+    {
+        int error{ ::avcodec_send_frame(_encoderContext, frame) };
+        if (error < 0)
+            throw LibAvException{ "Cannot encode frame", error };
+
+        while (true)
+        {
+            error = ::avcodec_receive_packet(_encoderContext, _packet);
+            if (error == AVERROR(EAGAIN) || error == AVERROR_EOF)
+                break;
+            if (error < 0)
+                throw LibAvException{ "Cannot receive encoded packet", error };
+
+            ::av_packet_rescale_ts(_packet, _encoderContext->time_base, _outputStream->time_base);
+            _packet->stream_index = _outputStream->index;
+
+            error = ::av_interleaved_write_frame(_outputContext, _packet); // takes ownership of the packet content
+            if (error < 0)
+                throw LibAvException{ "Cannot write encoded packet", error };
+        }
+    }
+
+    LibAvTranscoder::LibAvTranscoder(const InputParameters& inputParameters, const OutputParameters& outputParameters, bool copyAudioStream)
+        : _debugId{ globalId++ }
+        , _outputParameters{ outputParameters }
+        , _outputMimeType{ toMimetype(outputParameters.format) }
+    {
+        LOG(INFO, (copyAudioStream ? "Remuxing" : "Transcoding") << " file '" << inputParameters.trackPath.string() << "' in process");
+
+        _job = std::make_shared<Job>(_debugId, inputParameters, outputParameters, copyAudioStream);
+    }
+
+    LibAvTranscoder::~LibAvTranscoder()
+    {
+        // the job may still be processed by a worker
+        _job->abort();
+    }
+
+    void LibAvTranscoder::asyncRead(std::byte* buffer, std::size_t bufferSize, ReadCallback callback)
+    {
+        _job->asyncRead(buffer, bufferSize, std::move(callback));
+    }
+
+    std::size_t LibAvTranscoder::readSome(std::byte* buffer, std::size_t bufferSize)
+    {
+        return _job->readSome(buffer, bufferSize);
+    }
+
+    bool LibAvTranscoder::finished() const
+    {
+        return _job->finished();
+    }
+} // namespace Av::Transcoding
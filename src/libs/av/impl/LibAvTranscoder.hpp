@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "av/TranscodingParameters.hpp"
+#include "ITranscoder.hpp"
+
+namespace Av::Transcoding
+{
+    // Transcodes in process using libavformat/libavcodec
+    // The work is done by a bounded pool of threads shared by all the transcoders
+    class LibAvTranscoder final : public ITranscoder
+    {
+    public:
+        // copyAudioStream: only change the container, the audio stream must already be encoded with the output format codec
+        LibAvTranscoder(const InputParameters& inputParameters, const OutputParameters& outputParameters, bool copyAudioStream);
+        ~LibAvTranscoder() override;
+
+        LibAvTranscoder(const LibAvTranscoder&) = delete;
+        LibAvTranscoder& operator=(const LibAvTranscoder&) = delete;
+
+        void            asyncRead(std::byte* buffer, std::size_t bufferSize, ReadCallback) override;
+        std::size_t     readSome(std::byte* buffer, std::size_t bufferSize) override;
+
+        const std::string& getOutputMimeType() const override { return _outputMimeType; }
+        const OutputParameters& getOutputParameters() const override { return _outputParameters; }
+
+        bool            finished() const override;
+
+    private:
+        class Job; // shared with the worker threads, may outlive the transcoder
+
+        const std::size_t       _debugId;
+        const OutputParameters  _outputParameters;
+        const std::string       _outputMimeType;
+        std::shared_ptr<Job>    _job;
+    };
+} // namespace Av::Transcoding
@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "av/Loudness.hpp"
+
+#include <vector>
+
+#include "LibAvAudioDecoder.hpp"
+#include "LoudnessMeter.hpp"
+
+namespace Av
+{
+    namespace
+    {
+        double getChannelWeight(AVChannel channel)
+        {
+            switch (channel)
+            {
+            case AV_CHAN_LOW_FREQUENCY:
+            case AV_CHAN_LOW_FREQUENCY_2:
+                return 0.0;
+
+            case AV_CHAN_BACK_LEFT:
+            case AV_CHAN_BACK_RIGHT:
+            case AV_CHAN_SIDE_LEFT:
+            case AV_CHAN_SIDE_RIGHT:
+            case AV_CHAN_SURROUND_DIRECT_LEFT:
+            case AV_CHAN_SURROUND_DIRECT_RIGHT:
+                return 1.41;
+
+            default:
+                return 1.0;
+            }
+        }
+    }
+
+    std::optional<Loudness> computeLoudness(const std::filesystem::path& p)
+    {
+        // the loudness is measured on the original channels
+        LibAvAudioDecoder decoder{ p, DecodingParameters{} };
+
+        const AVChannelLayout& layout{ decoder.getChannelLayout() };
+        std::vector<double> channelWeights(static_cast<std::size_t>(layout.nb_channels));
+        for (int i{}; i < layout.nb_channels; ++i)
+            channelWeights[i] = getChannelWeight(::av_channel_layout_channel_from_index(&layout, i));
+
+        LoudnessMeter meter{ decoder.getSampleRate(), channelWeights };
+        decoder.decode([&](std::span<const float> samples) { meter.process(samples); });
+
+        const std::optional<double> integratedLoudness{ meter.getIntegratedLoudness() };
+        if (!integratedLoudness)
+            return std::nullopt;
+
+        return Loudness{ *integratedLoudness, meter.getSamplePeak() };
+    }
+} // namespace Av
@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "LoudnessMeter.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <numbers>
+#include <numeric>
+
+namespace Av
+{
+    namespace
+    {
+        constexpr double absoluteGate{ -70.0 }; // LUFS
+        constexpr double relativeGate{ -10.0 }; // LU
+
+        double energyToLoudness(double energy)
+        {
+            return -0.691 + 10.0 * std::log10(energy);
+        }
+
+        double loudnessToEnergy(double loudness)
+        {
+            return std::pow(10.0, (loudness + 0.691) / 10.0);
+        }
+    }
+
+    LoudnessMeter::LoudnessMeter(std::size_t sampleRate, std::span<const double> channelWeights)
+        : _shelvingFilter{ computeShelvingFilter(static_cast<double>(sampleRate)) }
+        , _highPassFilter{ computeHighPassFilter(static_cast<double>(sampleRate)) }
+        , _segmentFrameCount{ std::max<std::size_t>(sampleRate / 10, 1) }
+    {
+        assert(!channelWeights.empty());
+
+        _channelStates.reserve(channelWeights.size());
+        for (const double weight : channelWeights)
+            _channelStates.push_back(ChannelState{ weight, {}, {} });
+    }
+
+    void LoudnessMeter::process(std::span<const float> samples)
+    {
+        const std::size_t channelCount{ _channelStates.size() };
+        assert(samples.size() % channelCount == 0);
+
+        for (std::size_t offset{}; offset + channelCount <= samples.size(); offset += channelCount)
+        {
+            for (std::size_t channel{}; channel < channelCount; ++channel)
+            {
+                const float sample{ samples[offset + channel] };
+                _samplePeak = std::max(_samplePeak, std::abs(sample));
+
+                ChannelState& state{ _channelStates[channel] };
+                const double filtered{ state.highPassState.process(_highPassFilter, state.shelvingState.process(_shelvingFilter, sample)) };
+                _currentSegmentEnergy += state.weight * filtered * filtered;
+            }
+
+            if (++_currentSegmentFrameCount == _segmentFrameCount)
+                completeSegment();
+        }
+    }
+
+    // Coefficients are given at 48 kHz in BS.1770, compute them for any sample rate
+    LoudnessMeter::Biquad LoudnessMeter::computeShelvingFilter(double sampleRate)
+    {
+        constexpr double f0{ 1681.974450955533 };
+        constexpr double gain{ 3.999843853973347 };
+        constexpr double q{ 0.7071752369554196 };
+
+        const double k{ std::tan(std::numbers::pi * f0 / sampleRate) };
+        const double vh{ std::pow(10.0, gain / 20.0) };
+        const double vb{ std::pow(vh, 0.4996667741545416) };
+        const double a0{ 1.0 + k / q + k * k };
+
+        return Biquad{
+            (vh + vb * k / q + k * k) / a0,
+            2.0 * (k * k - vh) / a0,
+            (vh - vb * k / q + k * k) / a0,
+            2.0 * (k * k - 1.0) / a0,
+            (1.0 - k / q + k * k) / a0,
+        };
+    }
+
+    LoudnessMeter::Biquad LoudnessMeter::computeHighPassFilter(double sampleRate)
+    {
+        constexpr double f0{ 38.13547087602444 };
+        constexpr double q{ 0.5003270373238773 };
+
+        const double k{ std::tan(std::numbers::pi * f0 / sampleRate) };
+        const double a0{ 1.0 + k / q + k * k };
+
+        return Biquad{
+            1.0,
+            -2.0,
+            1.0,
+            2.0 * (k * k - 1.0) / a0,
+            (1.0 - k / q + k * k) / a0,
+        };
+    }
+
+    void LoudnessMeter::completeSegment()
+    {
+        _lastSegmentEnergies[_segmentCount % segmentCountPerBlock] = _currentSegmentEnergy;
+        _segmentCount++;
+        _currentSegmentEnergy = 0;
+        _currentSegmentFrameCount = 0;
+
+        if (_segmentCount >= segmentCountPerBlock)
+        {
+            const double blockEnergy{ std::accumulate(std::cbegin(_lastSegmentEnergies), std::cend(_lastSegmentEnergies), 0.0) };
+            _blockEnergies.push_back(blockEnergy / static_cast<double>(segmentCountPerBlock * _segmentFrameCount));
+        }
+    }
+
+    std::optional<double> LoudnessMeter::getIntegratedLoudness() const
+    {
+        auto computeGatedMeanEnergy{ [this](double gateEnergy) -> std::optional<double>
+            {
+                double sum{};
+                std::size_t count{};
+                for (const double blockEnergy : _blockEnergies)
+                {
+                    if (blockEnergy > gateEnergy)
+                    {
+                        sum += blockEnergy;
+                        count++;
+                    }
+                }
+
+                if (count == 0)
+                    return std::nullopt;
+
+                return sum / static_cast<double>(count);
+            } };
+
+        const double absoluteGateEnergy{ loudnessToEnergy(absoluteGate) };
+        const std::optional<double> absoluteGatedEnergy{ computeGatedMeanEnergy(absoluteGateEnergy) };
+        if (!absoluteGatedEnergy)
+            return std::nullopt;
+
+        const double relativeGateEnergy{ loudnessToEnergy(energyToLoudness(*absoluteGatedEnergy) + relativeGate) };
+        const std::optional<double> gatedEnergy{ computeGatedMeanEnergy(std::max(absoluteGateEnergy, relativeGateEnergy)) };
+        if (!gatedEnergy)
+            return std::nullopt;
+
+        return energyToLoudness(*gatedEnergy);
+    }
+} // namespace Av
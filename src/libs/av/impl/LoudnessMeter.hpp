@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace Av
+{
+    // Integrated loudness measurement, see ITU-R BS.1770-4 and EBU Tech 3341
+    class LoudnessMeter
+    {
+    public:
+        // channelWeights: one weight per channel (1.0 for front channels, 1.41 for surround channels, 0 for LFE)
+        LoudnessMeter(std::size_t sampleRate, std::span<const double> channelWeights);
+
+        LoudnessMeter(const LoudnessMeter&) = delete;
+        LoudnessMeter& operator=(const LoudnessMeter&) = delete;
+
+        // interleaved samples, the last frame must be complete
+        void process(std::span<const float> samples);
+
+        std::optional<double> getIntegratedLoudness() const; // none if nothing is above the absolute gate
+        float getSamplePeak() const { return _samplePeak; }
+
+    private:
+        struct Biquad
+        {
+            double b0, b1, b2, a1, a2;
+        };
+
+        struct BiquadState
+        {
+            double z1{};
+            double z2{};
+
+            double process(const Biquad& filter, double x)
+            {
+                const double y{ filter.b0 * x + z1 };
+                z1 = filter.b1 * x - filter.a1 * y + z2;
+                z2 = filter.b2 * x - filter.a2 * y;
+                return y;
+            }
+        };
+
+        struct ChannelState
+        {
+            double weight;
+            BiquadState shelvingState;
+            BiquadState highPassState;
+        };
+
+        // K-weighting filters
+        static Biquad computeShelvingFilter(double sampleRate);
+        static Biquad computeHighPassFilter(double sampleRate);
+
+        void completeSegment();
+
+        const Biquad _shelvingFilter;
+        const Biquad _highPassFilter;
+        std::vector<ChannelState> _channelStates;
+
+        // Blocks of 400ms overlapping by 75% are made of 4 segments of 100ms
+        static constexpr std::size_t segmentCountPerBlock{ 4 };
+        const std::size_t _segmentFrameCount;
+        std::size_t _currentSegmentFrameCount{};
+        double _currentSegmentEnergy{};
+        std::array<double, segmentCountPerBlock> _lastSegmentEnergies{};
+        std::size_t _segmentCount{};
+
+        std::vector<double> _blockEnergies; // mean square of the weighted channels
+        float _samplePeak{};
+    };
+} // namespace Av
@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PreTranscoder.hpp"
+
+#include <algorithm>
+#include <array>
+
+#include <boost/asio/post.hpp>
+
+#include "av/Types.hpp"
+#include "utils/ILogger.hpp"
+#include "ITranscoder.hpp"
+#include "TranscodeCache.hpp"
+#include "TranscodingScheduler.hpp"
+
+namespace Av::Transcoding
+{
+    // Self owned once started: kept alive by the pending reads
+    class PreTranscodeJob : public std::enable_shared_from_this<PreTranscodeJob>
+    {
+    public:
+        PreTranscodeJob(boost::asio::io_service& ioService, const PreTranscodeRequest& request)
+            : _ioService{ ioService }
+            , _request{ request }
+        {}
+
+        ~PreTranscodeJob()
+        {
+            // no effect if complete
+            if (_cacheEntry)
+                _cacheEntry->abort();
+        }
+
+        PreTranscodeJob(const PreTranscodeJob&) = delete;
+        PreTranscodeJob& operator=(const PreTranscodeJob&) = delete;
+
+        void setTicket(std::unique_ptr<TranscodingScheduler::Ticket> ticket) { _ticket = std::move(ticket); }
+        bool isGranted() const { return _ticket->isGranted(); }
+
+        void start(TranscodeCache& cache)
+        {
+            // the track may have been requested in the meantime
+            TranscodeCache::LookupResult lookupResult{ cache.lookup(_request.inputParameters, _request.outputParameters) };
+            if (!lookupResult.mustWrite)
+                return;
+
+            LMS_LOG(TRANSCODING, DEBUG, "Pre transcoding '" << _request.inputParameters.trackPath.string() << "'");
+
+            _cacheEntry = std::move(lookupResult.entry);
+            try
+            {
+                _transcoder = createTranscoder(_request.inputParameters, _request.outputParameters);
+            }
+            catch (const Exception& e)
+            {
+                LMS_LOG(TRANSCODING, ERROR, "Cannot pre transcode '" << _request.inputParameters.trackPath.string() << "': " << e.what());
+                return;
+            }
+
+            readMore();
+        }
+
+    private:
+        void readMore()
+        {
+            _transcoder->asyncRead(_buffer.data(), _buffer.size(), [job{ shared_from_this() }](std::size_t nbBytesRead)
+                {
+                    // do not write to the disk from the transcoder threads
+                    boost::asio::post(job->_ioService, [job, nbBytesRead] { job->onDataRead(nbBytesRead); });
+                });
+        }
+
+        void onDataRead(std::size_t nbBytesRead)
+        {
+            if (nbBytesRead > 0)
+                _cacheEntry->write(_buffer.data(), nbBytesRead);
+
+            if (!_transcoder->finished())
+            {
+                readMore();
+                return;
+            }
+
+            _cacheEntry->complete();
+            LMS_LOG(TRANSCODING, DEBUG, "Pre transcoding '" << _request.inputParameters.trackPath.string() << "' complete");
+        }
+
+        boost::asio::io_service& _ioService;
+        const PreTranscodeRequest _request;
+        std::unique_ptr<TranscodingScheduler::Ticket> _ticket;
+        std::shared_ptr<TranscodeCache::Entry> _cacheEntry;
+        std::unique_ptr<ITranscoder> _transcoder;
+        std::array<std::byte, 65'536> _buffer;
+    };
+
+    namespace
+    {
+        PreTranscoder* getPreTranscoder()
+        {
+            static const std::unique_ptr<PreTranscoder> preTranscoder{ getTranscodeCache() ? std::make_unique<PreTranscoder>() : nullptr };
+            return preTranscoder.get();
+        }
+    }
+
+    void schedulePreTranscodes(std::string_view clientId, std::span<const PreTranscodeRequest> requests)
+    {
+        if (PreTranscoder* preTranscoder{ getPreTranscoder() })
+            preTranscoder->schedule(clientId, requests);
+    }
+
+    PreTranscoder::PreTranscoder()
+        : _scheduler{ getTranscodingScheduler() } // must outlive the pending jobs
+        , _ioContextRunner{ _ioService, 1 }
+    {
+    }
+
+    PreTranscoder::~PreTranscoder()
+    {
+        _ioContextRunner.stop();
+    }
+
+    void PreTranscoder::schedule(std::string_view clientId, std::span<const PreTranscodeRequest> requests)
+    {
+        const std::scoped_lock lock{ _mutex };
+
+        // destroying the jobs cancels their scheduling
+        std::vector<std::shared_ptr<PreTranscodeJob>>& pendingJobs{ _pendingJobsByClient[std::string{ clientId }] };
+        pendingJobs.clear();
+
+        for (const PreTranscodeRequest& request : requests)
+        {
+            auto job{ std::make_shared<PreTranscodeJob>(_ioService, request) };
+            auto onGranted{ [this, clientId = std::string{ clientId }, weakJob = std::weak_ptr<PreTranscodeJob>{ job }]
+                {
+                    boost::asio::post(_ioService, [this, clientId, weakJob] { onJobGranted(clientId, weakJob); });
+                } };
+
+            job->setTicket(_scheduler.request(clientId, TranscodingScheduler::Priority::Background, onGranted));
+            if (job->isGranted())
+                onGranted();
+
+            pendingJobs.push_back(std::move(job));
+        }
+
+        if (pendingJobs.empty())
+            _pendingJobsByClient.erase(std::string{ clientId });
+    }
+
+    void PreTranscoder::onJobGranted(const std::string& clientId, const std::weak_ptr<PreTranscodeJob>& weakJob)
+    {
+        std::shared_ptr<PreTranscodeJob> job;
+        {
+            const std::scoped_lock lock{ _mutex };
+
+            auto itJobs{ _pendingJobsByClient.find(clientId) };
+            if (itJobs == std::cend(_pendingJobsByClient))
+                return;
+
+            std::vector<std::shared_ptr<PreTranscodeJob>>& pendingJobs{ itJobs->second };
+            auto itJob{ std::find(std::begin(pendingJobs), std::end(pendingJobs), weakJob.lock()) };
+            if (itJob == std::end(pendingJobs)) // cancelled in the meantime
+                return;
+
+            job = std::move(*itJob);
+            pendingJobs.erase(itJob);
+            if (pendingJobs.empty())
+                _pendingJobsByClient.erase(itJobs);
+        }
+
+        job->start(*getTranscodeCache());
+    }
+} // namespace Av::Transcoding
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/asio/io_service.hpp>
+
+#include "av/PreTranscoding.hpp"
+#include "utils/IOContextRunner.hpp"
+
+namespace Av::Transcoding
+{
+    class PreTranscodeJob;
+    class TranscodingScheduler;
+
+    class PreTranscoder
+    {
+    public:
+        PreTranscoder();
+        ~PreTranscoder();
+
+        PreTranscoder(const PreTranscoder&) = delete;
+        PreTranscoder& operator=(const PreTranscoder&) = delete;
+
+        void schedule(std::string_view clientId, std::span<const PreTranscodeRequest> requests);
+
+    private:
+        void onJobGranted(const std::string& clientId, const std::weak_ptr<PreTranscodeJob>& job);
+
+        TranscodingScheduler& _scheduler;
+        boost::asio::io_service _ioService;
+
+        std::mutex _mutex;
+        std::unordered_map<std::string, std::vector<std::shared_ptr<PreTranscodeJob>>> _pendingJobsByClient;
+
+        IOContextRunner _ioContextRunner;
+    };
+} // namespace Av::Transcoding
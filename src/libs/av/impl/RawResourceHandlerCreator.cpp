@@ -21,12 +21,13 @@
 
 #include "av/IAudioFile.hpp"
 #include "utils/FileResourceHandlerCreator.hpp"
+#include "StreamResourceHandler.hpp"
 
 namespace Av
 {
     std::unique_ptr<IResourceHandler> createRawResourceHandler(const std::filesystem::path& path)
     {
         std::string_view mimeType{ Av::getMimeType(path.extension()) };
-        return createFileResourceHandler(path, mimeType.empty() ? "application/octet-stream" : mimeType);
+        return std::make_unique<StreamResourceHandler>(createFileResourceHandler(path, mimeType.empty() ? "application/octet-stream" : mimeType));
     }
 }
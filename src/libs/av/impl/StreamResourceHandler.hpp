@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <memory>
+
+#include "utils/IResourceGovernor.hpp"
+#include "utils/IResourceHandler.hpp"
+
+namespace Av
+{
+    // Reports the wrapped handler as a live stream to the resource governor, as long as it is alive
+    class StreamResourceHandler final : public IResourceHandler
+    {
+    public:
+        StreamResourceHandler(std::unique_ptr<IResourceHandler> handler)
+            : _handler{ std::move(handler) }
+        {
+        }
+
+    private:
+        Wt::Http::ResponseContinuation* processRequest(const Wt::Http::Request& request, Wt::Http::Response& response) override
+        {
+            return _handler->processRequest(request, response);
+        }
+
+        void abort() override
+        {
+            _handler->abort();
+        }
+
+        std::unique_ptr<IResourceHandler> _handler;
+        ScopedForegroundStream _foregroundStream;
+    };
+} // namespace Av
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ThroughputEstimator.hpp"
+
+#include "utils/ILogger.hpp"
+
+namespace Av::Transcoding
+{
+    namespace
+    {
+        // weight of the new measurements: recent ones matter more, but a single one must not be enough to switch
+        constexpr double smoothingFactor{ 0.5 };
+        constexpr std::size_t maxEntryCount{ 1000 };
+    }
+
+    ThroughputEstimator& getThroughputEstimator()
+    {
+        static ThroughputEstimator estimator{ std::chrono::minutes{ 15 } };
+        return estimator;
+    }
+
+    ThroughputEstimator::ThroughputEstimator(std::chrono::steady_clock::duration maxAge)
+        : _maxAge{ maxAge }
+    {
+    }
+
+    void ThroughputEstimator::addMeasurement(std::string_view deviceId, std::size_t byteCount, std::chrono::steady_clock::duration duration)
+    {
+        const double seconds{ std::chrono::duration<double>(duration).count() };
+        if (seconds <= 0)
+            return;
+
+        const double throughput{ static_cast<double>(byteCount) * 8 / seconds };
+        const auto now{ std::chrono::steady_clock::now() };
+
+        const std::scoped_lock lock{ _mutex };
+
+        auto itEntry{ _entries.find(std::string{ deviceId }) };
+        if (itEntry == std::end(_entries) || now - itEntry->second.lastUpdate > _maxAge)
+        {
+            if (_entries.size() >= maxEntryCount)
+                purgeOutdatedEntries(now);
+            if (_entries.size() >= maxEntryCount)
+                _entries.clear();
+
+            _entries[std::string{ deviceId }] = Entry{ throughput, now };
+        }
+        else
+        {
+            itEntry->second.throughput = smoothingFactor * throughput + (1 - smoothingFactor) * itEntry->second.throughput;
+            itEntry->second.lastUpdate = now;
+        }
+
+        LMS_LOG(TRANSCODING, DEBUG, "Device '" << deviceId << "': measured throughput = " << static_cast<std::size_t>(throughput) << " bps");
+    }
+
+    std::optional<std::size_t> ThroughputEstimator::getThroughput(std::string_view deviceId) const
+    {
+        const std::scoped_lock lock{ _mutex };
+
+        auto itEntry{ _entries.find(std::string{ deviceId }) };
+        if (itEntry == std::cend(_entries) || std::chrono::steady_clock::now() - itEntry->second.lastUpdate > _maxAge)
+            return std::nullopt;
+
+        return static_cast<std::size_t>(itEntry->second.throughput);
+    }
+
+    void ThroughputEstimator::purgeOutdatedEntries(std::chrono::steady_clock::time_point now)
+    {
+        std::erase_if(_entries, [&](const auto& entry) { return now - entry.second.lastUpdate > _maxAge; });
+    }
+} // namespace Av::Transcoding
@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace Av::Transcoding
+{
+    // Keeps track of the rate at which each device drains the transcoded streams
+    class ThroughputEstimator
+    {
+    public:
+        ThroughputEstimator(std::chrono::steady_clock::duration maxAge);
+
+        ThroughputEstimator(const ThroughputEstimator&) = delete;
+        ThroughputEstimator& operator=(const ThroughputEstimator&) = delete;
+
+        void addMeasurement(std::string_view deviceId, std::size_t byteCount, std::chrono::steady_clock::duration duration);
+        std::optional<std::size_t> getThroughput(std::string_view deviceId) const; // in bits per second
+
+    private:
+        void purgeOutdatedEntries(std::chrono::steady_clock::time_point now); // must be locked
+
+        const std::chrono::steady_clock::duration _maxAge;
+
+        struct Entry
+        {
+            double throughput; // smoothed, bits per second
+            std::chrono::steady_clock::time_point lastUpdate;
+        };
+
+        mutable std::mutex _mutex;
+        std::unordered_map<std::string, Entry> _entries;
+    };
+
+    ThroughputEstimator& getThroughputEstimator();
+} // namespace Av::Transcoding
@@ -0,0 +1,356 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TranscodeCache.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+
+#include "utils/IConfig.hpp"
+#include "utils/ILogger.hpp"
+#include "utils/Service.hpp"
+
+namespace Av::Transcoding
+{
+    namespace
+    {
+        constexpr std::string_view cacheFileExtension{ ".transcode" };
+        constexpr std::string_view tmpFileExtension{ ".tmp" };
+        // the recent temporary files may still be written by the other worker processes sharing the directory
+        constexpr std::chrono::minutes tmpFileMaxAge{ 10 };
+    }
+
+    TranscodeCache* getTranscodeCache()
+    {
+        static const std::unique_ptr<TranscodeCache> cache{ []() -> std::unique_ptr<TranscodeCache>
+            {
+                const std::size_t maxSize{ Service<IConfig>::get()->getULong("transcode-cache-max-size", 512) * 1000 * 1000 };
+                if (maxSize == 0)
+                    return {};
+
+                return std::make_unique<TranscodeCache>(Service<IConfig>::get()->getPath("working-dir") / "cache" / "transcode", maxSize);
+            }() };
+
+        return cache.get();
+    }
+
+    TranscodeCache::Entry::Entry(TranscodeCache& cache, const std::string& key, const std::filesystem::path& tmpFile)
+        : _cache{ cache }
+        , _key{ key }
+        , _tmpFile{ tmpFile }
+        , _ofs{ tmpFile, std::ios::out | std::ios::binary | std::ios::trunc }
+        , _currentFile{ tmpFile }
+    {
+        if (!_ofs)
+            LMS_LOG(TRANSCODING, ERROR, "Cannot create transcode cache file '" << _tmpFile.string() << "'");
+    }
+
+    TranscodeCache::Entry::~Entry()
+    {
+        abort();
+    }
+
+    void TranscodeCache::Entry::write(const std::byte* data, std::size_t size)
+    {
+        std::vector<std::pair<const void*, std::function<void()>>> waiters;
+        {
+            const std::scoped_lock lock{ _mutex };
+            if (_finished || !_ofs)
+                return;
+
+            _ofs.write(reinterpret_cast<const char*>(data), size);
+            _ofs.flush(); // make it visible to readers
+            if (!_ofs)
+            {
+                LMS_LOG(TRANSCODING, ERROR, "Cannot write transcode cache file '" << _tmpFile.string() << "'");
+                return;
+            }
+
+            _writtenSize += size;
+            waiters.swap(_waiters);
+        }
+
+        for (const auto& [waiter, callback] : waiters)
+            callback();
+    }
+
+    void TranscodeCache::Entry::complete()
+    {
+        finish(true);
+    }
+
+    void TranscodeCache::Entry::abort()
+    {
+        finish(false);
+    }
+
+    void TranscodeCache::Entry::finish(bool success)
+    {
+        std::vector<std::pair<const void*, std::function<void()>>> waiters;
+        std::size_t size;
+        {
+            const std::scoped_lock lock{ _mutex };
+            if (_finished)
+                return;
+
+            _finished = true;
+            _ofs.close();
+            success = success && _ofs && _writtenSize > 0;
+
+            std::error_code ec;
+            if (success)
+            {
+                const std::filesystem::path cacheFile{ _cache.getCacheFile(_key) };
+                std::filesystem::rename(_tmpFile, cacheFile, ec);
+                if (ec)
+                {
+                    LMS_LOG(TRANSCODING, ERROR, "Cannot rename transcode cache file '" << _tmpFile.string() << "': " << ec.message());
+                    success = false;
+                }
+                else
+                {
+                    _currentFile = cacheFile;
+                }
+            }
+
+            if (!success)
+                std::filesystem::remove(_tmpFile, ec); // readers keep their file descriptors
+
+            size = _writtenSize;
+            waiters.swap(_waiters);
+        }
+
+        _cache.onEntryFinished(_key, size, success);
+
+        for (const auto& [waiter, callback] : waiters)
+            callback();
+    }
+
+    int TranscodeCache::Entry::open() const
+    {
+        const std::scoped_lock lock{ _mutex };
+        return ::open(_currentFile.c_str(), O_RDONLY | O_CLOEXEC);
+    }
+
+    TranscodeCache::Entry::State TranscodeCache::Entry::getState() const
+    {
+        const std::scoped_lock lock{ _mutex };
+        return State{ _writtenSize, _finished };
+    }
+
+    void TranscodeCache::Entry::waitForData(const void* waiter, std::size_t offset, std::function<void()> callback)
+    {
+        {
+            const std::scoped_lock lock{ _mutex };
+            if (!_finished && _writtenSize <= offset)
+            {
+                _waiters.emplace_back(waiter, std::move(callback));
+                return;
+            }
+        }
+
+        callback();
+    }
+
+    void TranscodeCache::Entry::cancelWait(const void* waiter)
+    {
+        const std::scoped_lock lock{ _mutex };
+        std::erase_if(_waiters, [=](const auto& entry) { return entry.first == waiter; });
+    }
+
+    TranscodeCache::TranscodeCache(const std::filesystem::path& directory, std::size_t maxSize)
+        : _directory{ directory }
+        , _maxSize{ maxSize }
+    {
+        std::filesystem::create_directories(_directory);
+        loadEntries();
+
+        LMS_LOG(TRANSCODING, INFO, "Transcode cache: " << _completeEntries.size() << " entries, size = " << _currentSize << "/" << _maxSize << " bytes");
+    }
+
+    TranscodeCache::LookupResult TranscodeCache::lookup(const InputParameters& inputParameters, const OutputParameters& outputParameters)
+    {
+        const std::optional<std::string> key{ computeKey(inputParameters, outputParameters) };
+        if (!key)
+            return {};
+
+        const std::scoped_lock lock{ _mutex };
+
+        if (auto it{ _completeEntriesByKey.find(*key) }; it != std::cend(_completeEntriesByKey))
+        {
+            _completeEntries.splice(std::begin(_completeEntries), _completeEntries, it->second);
+
+            // used as access time, so that the eviction order survives restarts
+            const std::filesystem::path cacheFile{ getCacheFile(*key) };
+            std::error_code ec;
+            std::filesystem::last_write_time(cacheFile, std::filesystem::file_time_type::clock::now(), ec);
+
+            LMS_LOG(TRANSCODING, DEBUG, "Transcode cache hit for '" << inputParameters.trackPath.string() << "'");
+            return LookupResult{ cacheFile, {}, false };
+        }
+
+        // may have been written by another worker process sharing the directory
+        {
+            const std::filesystem::path cacheFile{ getCacheFile(*key) };
+            std::error_code ec;
+            if (const std::uintmax_t size{ std::filesystem::file_size(cacheFile, ec) }; !ec && size > 0)
+            {
+                _completeEntries.push_front(CompleteEntry{ *key, static_cast<std::size_t>(size) });
+                _completeEntriesByKey[*key] = std::begin(_completeEntries);
+                _currentSize += size;
+                evict();
+
+                LMS_LOG(TRANSCODING, DEBUG, "Transcode cache hit for '" << inputParameters.trackPath.string() << "' (shared)");
+                return LookupResult{ cacheFile, {}, false };
+            }
+        }
+
+        if (auto it{ _entriesInProgress.find(*key) }; it != std::cend(_entriesInProgress))
+        {
+            if (std::shared_ptr<Entry> entry{ it->second.lock() })
+            {
+                LMS_LOG(TRANSCODING, DEBUG, "Transcode of '" << inputParameters.trackPath.string() << "' already in progress");
+                return LookupResult{ std::nullopt, entry, false };
+            }
+        }
+
+        // the other worker processes may transcode the same key
+        auto entry{ std::make_shared<Entry>(*this, *key, getCacheFile(*key).concat("." + std::to_string(::getpid())).concat(tmpFileExtension)) };
+        _entriesInProgress[*key] = entry;
+
+        return LookupResult{ std::nullopt, entry, true };
+    }
+
+    std::optional<std::string> TranscodeCache::computeKey(const InputParameters& inputParameters, const OutputParameters& outputParameters)
+    {
+        // transcodes with an offset are not cached, unless they are segments: segments always start at the same offsets
+        if (outputParameters.offset.count() != 0 && !outputParameters.duration)
+            return std::nullopt;
+
+        std::error_code ec;
+        const auto lastWriteTime{ std::filesystem::last_write_time(inputParameters.trackPath, ec) };
+        if (ec)
+            return std::nullopt;
+        const auto fileSize{ std::filesystem::file_size(inputParameters.trackPath, ec) };
+        if (ec)
+            return std::nullopt;
+
+        std::ostringstream oss;
+        oss << inputParameters.trackPath.string()
+            << '\n' << lastWriteTime.time_since_epoch().count()
+            << '\n' << fileSize
+            << '\n' << static_cast<int>(outputParameters.format)
+            << '\n' << outputParameters.bitrate
+            << '\n' << (outputParameters.stream ? static_cast<long long>(*outputParameters.stream) : -1)
+            << '\n' << outputParameters.stripMetadata;
+        if (outputParameters.duration)
+            oss << '\n' << outputParameters.offset.count() << '\n' << outputParameters.duration->count();
+
+        std::ostringstream key;
+        key << std::hex << std::setw(16) << std::setfill('0') << std::hash<std::string>{}(oss.str());
+        return key.str();
+    }
+
+    std::filesystem::path TranscodeCache::getCacheFile(const std::string& key) const
+    {
+        return _directory / (key + std::string{ cacheFileExtension });
+    }
+
+    void TranscodeCache::loadEntries()
+    {
+        struct FileInfo
+        {
+            std::string key;
+            std::size_t size;
+            std::filesystem::file_time_type lastWriteTime;
+        };
+        std::vector<FileInfo> files;
+
+        std::error_code ec;
+        for (const std::filesystem::directory_entry& dirEntry : std::filesystem::directory_iterator{ _directory, ec })
+        {
+            const std::filesystem::path& path{ dirEntry.path() };
+            if (path.extension() != cacheFileExtension)
+            {
+                // unfinished transcodes from a previous run
+                if (dirEntry.last_write_time(ec) < std::filesystem::file_time_type::clock::now() - tmpFileMaxAge)
+                    std::filesystem::remove(path, ec);
+                continue;
+            }
+
+            const auto size{ dirEntry.file_size(ec) };
+            if (ec)
+                continue;
+            const auto lastWriteTime{ dirEntry.last_write_time(ec) };
+            if (ec)
+                continue;
+
+            files.push_back(FileInfo{ path.stem().string(), static_cast<std::size_t>(size), lastWriteTime });
+        }
+
+        std::sort(std::begin(files), std::end(files), [](const FileInfo& lhs, const FileInfo& rhs) { return lhs.lastWriteTime > rhs.lastWriteTime; });
+
+        for (const FileInfo& file : files)
+        {
+            _completeEntries.push_back(CompleteEntry{ file.key, file.size });
+            _completeEntriesByKey.emplace(file.key, std::prev(std::end(_completeEntries)));
+            _currentSize += file.size;
+        }
+
+        evict();
+    }
+
+    void TranscodeCache::onEntryFinished(const std::string& key, std::size_t size, bool success)
+    {
+        const std::scoped_lock lock{ _mutex };
+
+        _entriesInProgress.erase(key);
+        if (!success)
+            return;
+
+        _completeEntries.push_front(CompleteEntry{ key, size });
+        _completeEntriesByKey[key] = std::begin(_completeEntries);
+        _currentSize += size;
+
+        LMS_LOG(TRANSCODING, DEBUG, "Added transcode cache entry, size = " << size << ", cache size = " << _currentSize << "/" << _maxSize);
+
+        evict();
+    }
+
+    void TranscodeCache::evict()
+    {
+        while (_currentSize > _maxSize && !_completeEntries.empty())
+        {
+            const CompleteEntry& entry{ _completeEntries.back() };
+
+            // readers keep their file descriptors
+            std::error_code ec;
+            std::filesystem::remove(getCacheFile(entry.key), ec);
+
+            _currentSize -= entry.size;
+            _completeEntriesByKey.erase(entry.key);
+            _completeEntries.pop_back();
+        }
+    }
+} // namespace Av::Transcoding
@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "av/TranscodingParameters.hpp"
+
+namespace Av::Transcoding
+{
+    // On disk cache of transcoded outputs, the least recently used entries are evicted first
+    // Transcodes in progress can be read concurrently while they are being written
+    class TranscodeCache
+    {
+    public:
+        TranscodeCache(const std::filesystem::path& directory, std::size_t maxSize);
+
+        TranscodeCache(const TranscodeCache&) = delete;
+        TranscodeCache& operator=(const TranscodeCache&) = delete;
+
+        // Transcode in progress
+        class Entry
+        {
+        public:
+            Entry(TranscodeCache& cache, const std::string& key, const std::filesystem::path& tmpFile);
+            ~Entry();
+
+            Entry(const Entry&) = delete;
+            Entry& operator=(const Entry&) = delete;
+
+            // Writer side, only one writer per entry
+            void write(const std::byte* data, std::size_t size);
+            void complete();
+            void abort();
+
+            // Reader side
+            int open() const; // returns a file descriptor, or -1 on error
+            struct State
+            {
+                std::size_t writtenSize;
+                bool finished; // either completed or aborted
+            };
+            State getState() const;
+            // callback is called as soon as more than offset bytes have been written or the transcode is finished
+            void waitForData(const void* waiter, std::size_t offset, std::function<void()> callback);
+            void cancelWait(const void* waiter);
+
+        private:
+            void finish(bool success);
+
+            TranscodeCache& _cache;
+            const std::string _key;
+            const std::filesystem::path _tmpFile;
+
+            mutable std::mutex _mutex;
+            std::ofstream _ofs;
+            std::filesystem::path _currentFile; // moved to its final location once completed
+            std::size_t _writtenSize{};
+            bool _finished{};
+            std::vector<std::pair<const void*, std::function<void()>>> _waiters;
+        };
+
+        struct LookupResult
+        {
+            std::optional<std::filesystem::path> completeFile;   // set if the transcode is complete
+            std::shared_ptr<Entry> entry;                        // set if the transcode is in progress
+            bool mustWrite{};                                    // true if the entry has just been created: the caller must transcode it
+        };
+        LookupResult lookup(const InputParameters& inputParameters, const OutputParameters& outputParameters);
+
+    private:
+        static std::optional<std::string> computeKey(const InputParameters& inputParameters, const OutputParameters& outputParameters);
+        std::filesystem::path getCacheFile(const std::string& key) const;
+        void loadEntries();
+        void onEntryFinished(const std::string& key, std::size_t size, bool success);
+        void evict(); // must be locked
+
+        const std::filesystem::path _directory;
+        const std::size_t _maxSize;
+
+        std::mutex _mutex;
+        struct CompleteEntry
+        {
+            std::string key;
+            std::size_t size;
+        };
+        using CompleteEntries = std::list<CompleteEntry>; // most recently used first
+        CompleteEntries _completeEntries;
+        std::unordered_map<std::string, CompleteEntries::iterator> _completeEntriesByKey;
+        std::unordered_map<std::string, std::weak_ptr<Entry>> _entriesInProgress;
+        std::size_t _currentSize{};
+    };
+
+    // nullptr if the cache is disabled
+    TranscodeCache* getTranscodeCache();
+} // namespace Av::Transcoding
@@ -21,6 +21,7 @@
 
 #include <atomic>
 #include <iomanip>
+#include <sstream>
 
 #include "utils/IChildProcessManager.hpp"
 #include "utils/IConfig.hpp"
@@ -36,7 +37,38 @@ namespace Av::Transcoding
     static std::atomic<size_t>		globalId{};
     static std::filesystem::path	ffmpegPath;
 
-    std::string_view formatToMimetype(OutputFormat format)
+    namespace
+    {
+        struct FfmpegFormat
+        {
+            const char* codec; // default codec of the format if not set
+            const char* format;
+        };
+
+        FfmpegFormat getFfmpegFormat(OutputFormat format)
+        {
+            switch (format)
+            {
+            case OutputFormat::MP3:             return { nullptr, "mp3" };
+            case OutputFormat::OGG_OPUS:        return { "libopus", "ogg" };
+            case OutputFormat::MATROSKA_OPUS:   return { "libopus", "matroska" };
+            case OutputFormat::OGG_VORBIS:      return { "libvorbis", "ogg" };
+            case OutputFormat::WEBM_VORBIS:     return { "libvorbis", "webm" };
+            case OutputFormat::MPEGTS_MP3:      return { "libmp3lame", "mpegts" };
+            }
+
+            throw Exception{ "Unhandled format (" + std::to_string(static_cast<int>(format)) + ")" };
+        }
+
+        std::string toSecondsString(std::chrono::milliseconds duration)
+        {
+            std::ostringstream oss;
+            oss << std::fixed << std::showpoint << std::setprecision(3) << (duration.count() / float{ 1000 });
+            return oss.str();
+        }
+    }
+
+    std::string_view toMimetype(OutputFormat format)
     {
         switch (format)
         {
@@ -45,6 +77,7 @@ namespace Av::Transcoding
         case OutputFormat::MATROSKA_OPUS:   return "audio/x-matroska";
         case OutputFormat::OGG_VORBIS:      return "audio/ogg";
         case OutputFormat::WEBM_VORBIS:     return "audio/webm";
+        case OutputFormat::MPEGTS_MP3:      return "video/mp2t";
         }
 
         throw Exception{ "Invalid encoding" };
@@ -57,10 +90,11 @@ namespace Av::Transcoding
             throw Exception{ "File '" + ffmpegPath.string() + "' does not exist!" };
     }
 
-    Transcoder::Transcoder(const InputParameters& inputParameters, const OutputParameters& outputParameters)
+    Transcoder::Transcoder(const InputParameters& inputParameters, const OutputParameters& outputParameters, bool copyAudioStream)
         : _debugId{ globalId++ }
         , _inputParameters{ inputParameters }
         , _outputParameters{ outputParameters }
+        , _copyAudioStream{ copyAudioStream }
     {
         start();
     }
@@ -84,7 +118,7 @@ namespace Av::Transcoding
             throw Exception{ "File error '" + _inputParameters.trackPath.string() + "': " + e.what() };
         }
 
-        LOG(INFO, "Transcoding file '" << _inputParameters.trackPath.string() << "'");
+        LOG(INFO, (_copyAudioStream ? "Remuxing" : "Transcoding") << " file '" << _inputParameters.trackPath.string() << "'");
 
         std::vector<std::string> args;
 
@@ -99,13 +133,8 @@ namespace Av::Transcoding
         args.emplace_back("-nostdin");
 
         // input Offset
-        {
-            args.emplace_back("-ss");
-
-            std::ostringstream oss;
-            oss << std::fixed << std::showpoint << std::setprecision(3) << (_outputParameters.offset.count() / float{ 1000 });
-            args.emplace_back(oss.str());
-        }
+        args.emplace_back("-ss");
+        args.emplace_back(toSecondsString(_outputParameters.offset));
 
         // Input file
         args.emplace_back("-i");
@@ -128,51 +157,42 @@ namespace Av::Transcoding
         // Skip video flows (including covers)
         args.emplace_back("-vn");
 
-        // Output bitrates
-        args.emplace_back("-b:a");
-        args.emplace_back(std::to_string(_outputParameters.bitrate));
-
-        // Codecs and formats
-        switch (_outputParameters.format)
+        if (_outputParameters.duration)
         {
-        case OutputFormat::MP3:
-            args.emplace_back("-f");
-            args.emplace_back("mp3");
-            break;
-
-        case OutputFormat::OGG_OPUS:
-            args.emplace_back("-acodec");
-            args.emplace_back("libopus");
-            args.emplace_back("-f");
-            args.emplace_back("ogg");
-            break;
-
-        case OutputFormat::MATROSKA_OPUS:
-            args.emplace_back("-acodec");
-            args.emplace_back("libopus");
-            args.emplace_back("-f");
-            args.emplace_back("matroska");
-            break;
+            args.emplace_back("-t");
+            args.emplace_back(toSecondsString(*_outputParameters.duration));
+        }
 
-        case OutputFormat::OGG_VORBIS:
-            args.emplace_back("-acodec");
-            args.emplace_back("libvorbis");
-            args.emplace_back("-f");
-            args.emplace_back("ogg");
-            break;
+        // keep the timestamps of consecutive segments continuous
+        if (_outputParameters.format == OutputFormat::MPEGTS_MP3)
+        {
+            args.emplace_back("-output_ts_offset");
+            args.emplace_back(toSecondsString(_outputParameters.offset));
+        }
 
-        case OutputFormat::WEBM_VORBIS:
+        const FfmpegFormat ffmpegFormat{ getFfmpegFormat(_outputParameters.format) };
+        if (_copyAudioStream)
+        {
             args.emplace_back("-acodec");
-            args.emplace_back("libvorbis");
-            args.emplace_back("-f");
-            args.emplace_back("webm");
-            break;
+            args.emplace_back("copy");
+        }
+        else
+        {
+            // Output bitrates
+            args.emplace_back("-b:a");
+            args.emplace_back(std::to_string(_outputParameters.bitrate));
 
-        default:
-            throw Exception{ "Unhandled format (" + std::to_string(static_cast<int>(_outputParameters.format)) + ")" };
+            if (ffmpegFormat.codec)
+            {
+                args.emplace_back("-acodec");
+                args.emplace_back(ffmpegFormat.codec);
+            }
         }
 
-        _outputMimeType = formatToMimetype(_outputParameters.format);
+        args.emplace_back("-f");
+        args.emplace_back(ffmpegFormat.format);
+
+        _outputMimeType = toMimetype(_outputParameters.format);
 
         args.emplace_back("pipe:1");
 
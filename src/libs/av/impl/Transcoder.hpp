@@ -24,31 +24,32 @@
 
 #include "av/TranscodingParameters.hpp"
 #include "av/Types.hpp"
+#include "ITranscoder.hpp"
 
 class IChildProcess;
 
 namespace Av::Transcoding
 {
-    class Transcoder
+    // Transcodes using a forked ffmpeg process
+    class Transcoder final : public ITranscoder
     {
     public:
-        Transcoder(const InputParameters& inputParameters, const OutputParameters& outputParameters);
-        ~Transcoder();
+        // copyAudioStream: only change the container, the audio stream must already be encoded with the output format codec
+        Transcoder(const InputParameters& inputParameters, const OutputParameters& outputParameters, bool copyAudioStream);
+        ~Transcoder() override;
 
         Transcoder(const Transcoder&) = delete;
         Transcoder& operator=(const Transcoder&) = delete;
         Transcoder(Transcoder&&) = delete;
         Transcoder& operator=(Transcoder&&) = delete;
 
-        // non blocking calls
-        using ReadCallback = std::function<void(std::size_t nbReadBytes)>;
-        void            asyncRead(std::byte* buffer, std::size_t bufferSize, ReadCallback);
-        std::size_t     readSome(std::byte* buffer, std::size_t bufferSize);
+        void            asyncRead(std::byte* buffer, std::size_t bufferSize, ReadCallback) override;
+        std::size_t     readSome(std::byte* buffer, std::size_t bufferSize) override;
 
-        const std::string& getOutputMimeType() const { return _outputMimeType; }
-        const OutputParameters& getOutputParameters() const { return _outputParameters; }
+        const std::string& getOutputMimeType() const override { return _outputMimeType; }
+        const OutputParameters& getOutputParameters() const override { return _outputParameters; }
 
-        bool            finished() const;
+        bool            finished() const override;
 
     private:
         static void init();
@@ -58,6 +59,7 @@ namespace Av::Transcoding
         const std::size_t           _debugId{};
         const InputParameters       _inputParameters;
         const OutputParameters      _outputParameters;
+        const bool                  _copyAudioStream;
         std::string                 _outputMimeType;
 
         std::unique_ptr<IChildProcess>  _childProcess;
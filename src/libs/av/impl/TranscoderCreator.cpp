@@ -0,0 +1,174 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ITranscoder.hpp"
+
+#include "utils/IConfig.hpp"
+#include "utils/ILogger.hpp"
+#include "utils/IMetricsRegistry.hpp"
+#include "utils/Service.hpp"
+#include "av/IAudioFile.hpp"
+#include "av/Types.hpp"
+#include "LibAvTranscoder.hpp"
+#include "Transcoder.hpp"
+
+namespace Av::Transcoding
+{
+    namespace
+    {
+        enum class TranscoderBackend
+        {
+            Ffmpeg,
+            LibAv,
+        };
+
+        TranscoderBackend readTranscoderBackend()
+        {
+            const std::string backend{ Service<IConfig>::get()->getString("transcoder-backend", "ffmpeg") };
+            if (backend == "ffmpeg")
+                return TranscoderBackend::Ffmpeg;
+            if (backend == "libav")
+                return TranscoderBackend::LibAv;
+
+            throw Exception{ "Transcoder backend '" + backend + "' is not supported!" };
+        }
+
+        // Keeps track of the running transcoders
+        class MonitoredTranscoder final : public ITranscoder
+        {
+        public:
+            MonitoredTranscoder(std::unique_ptr<ITranscoder> transcoder, Metrics::Gauge& activeTranscoders)
+                : _transcoder{ std::move(transcoder) }
+                , _activeTranscoders{ activeTranscoders }
+            {
+                _activeTranscoders.inc();
+            }
+
+            ~MonitoredTranscoder() override
+            {
+                _activeTranscoders.dec();
+            }
+
+            MonitoredTranscoder(const MonitoredTranscoder&) = delete;
+            MonitoredTranscoder& operator=(const MonitoredTranscoder&) = delete;
+
+        private:
+            void asyncRead(std::byte* buffer, std::size_t bufferSize, ReadCallback callback) override { _transcoder->asyncRead(buffer, bufferSize, std::move(callback)); }
+            std::size_t readSome(std::byte* buffer, std::size_t bufferSize) override { return _transcoder->readSome(buffer, bufferSize); }
+            const std::string& getOutputMimeType() const override { return _transcoder->getOutputMimeType(); }
+            const OutputParameters& getOutputParameters() const override { return _transcoder->getOutputParameters(); }
+            bool finished() const override { return _transcoder->finished(); }
+
+            const std::unique_ptr<ITranscoder> _transcoder;
+            Metrics::Gauge& _activeTranscoders;
+        };
+
+        std::unique_ptr<ITranscoder> createBackendTranscoder(TranscoderBackend backend, const InputParameters& inputParameters, const OutputParameters& outputParameters, bool copyAudioStream)
+        {
+            switch (backend)
+            {
+            case TranscoderBackend::Ffmpeg:
+                return std::make_unique<Transcoder>(inputParameters, outputParameters, copyAudioStream);
+            case TranscoderBackend::LibAv:
+                return std::make_unique<LibAvTranscoder>(inputParameters, outputParameters, copyAudioStream);
+            }
+
+            throw Exception{ "Unhandled transcoder backend" };
+        }
+
+        DecodingCodec getOutputCodec(OutputFormat format)
+        {
+            switch (format)
+            {
+            case OutputFormat::MP3:             return DecodingCodec::MP3;
+            case OutputFormat::OGG_OPUS:        return DecodingCodec::OPUS;
+            case OutputFormat::MATROSKA_OPUS:   return DecodingCodec::OPUS;
+            case OutputFormat::OGG_VORBIS:      return DecodingCodec::VORBIS;
+            case OutputFormat::WEBM_VORBIS:     return DecodingCodec::VORBIS;
+            case OutputFormat::MPEGTS_MP3:      return DecodingCodec::MP3;
+            }
+
+            return DecodingCodec::UNKNOWN;
+        }
+
+        // Re-encoding a stream that already uses the output codec at a lower bitrate is a waste of CPU and quality
+        bool canCopyAudioStream(const InputParameters& inputParameters, const OutputParameters& outputParameters)
+        {
+            // copied streams can only be cut on packet boundaries, segments must be sample accurate to play back to back
+            if (outputParameters.duration)
+                return false;
+
+            if (inputParameters.codec)
+            {
+                if (*inputParameters.codec != getOutputCodec(outputParameters.format))
+                    return false;
+
+                return inputParameters.bitrate > 0 && inputParameters.bitrate <= outputParameters.bitrate;
+            }
+
+            try
+            {
+                const auto audioFile{ parseAudioFile(inputParameters.trackPath) };
+
+                std::optional<StreamInfo> streamInfo;
+                if (outputParameters.stream)
+                {
+                    for (const StreamInfo& info : audioFile->getStreamInfo())
+                    {
+                        if (info.index == *outputParameters.stream)
+                            streamInfo = info;
+                    }
+                }
+                else
+                {
+                    streamInfo = audioFile->getBestStreamInfo();
+                }
+
+                if (!streamInfo || streamInfo->codec != getOutputCodec(outputParameters.format))
+                    return false;
+
+                // unknown bitrate: cannot tell
+                return streamInfo->bitrate > 0 && streamInfo->bitrate <= outputParameters.bitrate;
+            }
+            catch (const Exception& e)
+            {
+                LMS_LOG(TRANSCODING, DEBUG, "Cannot parse '" << inputParameters.trackPath.string() << "': " << e.what());
+                return false;
+            }
+        }
+    }
+
+    std::unique_ptr<ITranscoder> createTranscoder(const InputParameters& inputParameters, const OutputParameters& outputParameters)
+    {
+        static const TranscoderBackend backend{ readTranscoderBackend() };
+        static const bool enableAudioStreamCopy{ Service<IConfig>::get()->getBool("transcoding-copy-compatible-streams", true) };
+
+        const bool copyAudioStream{ enableAudioStreamCopy && canCopyAudioStream(inputParameters, outputParameters) };
+
+        std::unique_ptr<ITranscoder> transcoder{ createBackendTranscoder(backend, inputParameters, outputParameters, copyAudioStream) };
+        if (Metrics::IRegistry * registry{ Service<Metrics::IRegistry>::get() })
+        {
+            registry->getCounter("lms_transcoders_started_total", "Transcoders started", { { "mode", copyAudioStream ? "copy" : "encode" } }).inc();
+            Metrics::Gauge& activeTranscoders{ registry->getGauge("lms_transcoders_active", "Transcoders currently running") };
+            transcoder = std::make_unique<MonitoredTranscoder>(std::move(transcoder), activeTranscoders);
+        }
+
+        return transcoder;
+    }
+} // namespace Av::Transcoding
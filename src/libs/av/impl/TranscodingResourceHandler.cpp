@@ -18,29 +18,144 @@
  */
 
 #include "TranscodingResourceHandler.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <utility>
+
+#include "utils/FileResourceHandlerCreator.hpp"
+#include "utils/IConfig.hpp"
 #include "utils/ILogger.hpp"
+#include "utils/Service.hpp"
+#include "CachedTranscodeResourceHandler.hpp"
+#include "StreamResourceHandler.hpp"
+#include "ThroughputEstimator.hpp"
 
 namespace Av::Transcoding
 {
     namespace
     {
+        constexpr std::size_t adaptiveBitrateThroughputRatio{ 75 }; // in percent
+        constexpr std::size_t minAdaptiveBitrate{ 32'000 };
+        // shorter measurements are not significant
+        constexpr std::chrono::seconds minThroughputMeasurementDuration{ 5 };
+
         std::size_t doEstimateContentLength(const InputParameters& inputParameters, const OutputParameters& outputParameters)
         {
             const std::size_t estimatedContentLength{ outputParameters.bitrate / 8 * static_cast<std::size_t>(std::chrono::duration_cast<std::chrono::milliseconds>(inputParameters.duration).count()) / 1000 };
             return estimatedContentLength;
         }
+
+        bool isBitrateAdaptable(OutputFormat format)
+        {
+            // Opus performs well over a wide range of bitrates
+            switch (format)
+            {
+            case OutputFormat::OGG_OPUS:
+            case OutputFormat::MATROSKA_OPUS:
+                return true;
+            case OutputFormat::MP3:
+            case OutputFormat::OGG_VORBIS:
+            case OutputFormat::WEBM_VORBIS:
+                return false;
+            }
+
+            return false;
+        }
+
+        OutputParameters adaptOutputParameters(const OutputParameters& outputParameters, const SchedulingParameters& schedulingParameters)
+        {
+            static const bool enableAdaptiveBitrate{ Service<IConfig>::get()->getBool("transcoding-adaptive-bitrate", true) };
+            if (!enableAdaptiveBitrate || schedulingParameters.deviceId.empty() || !isBitrateAdaptable(outputParameters.format))
+                return outputParameters;
+
+            const std::optional<std::size_t> throughput{ getThroughputEstimator().getThroughput(schedulingParameters.deviceId) };
+            if (!throughput)
+                return outputParameters;
+
+            // keep some margin for the throughput variations, never go above the requested bitrate
+            const std::size_t targetBitrate{ std::clamp<std::size_t>(*throughput * adaptiveBitrateThroughputRatio / 100, minAdaptiveBitrate, outputParameters.bitrate) };
+            if (targetBitrate >= outputParameters.bitrate)
+                return outputParameters;
+
+            LMS_LOG(TRANSCODING, INFO, "Lowering bitrate from " << outputParameters.bitrate << " to " << targetBitrate << " bps for device '" << schedulingParameters.deviceId << "' (observed throughput = " << *throughput << " bps)");
+            OutputParameters adaptedOutputParameters{ outputParameters };
+            adaptedOutputParameters.bitrate = targetBitrate;
+            return adaptedOutputParameters;
+        }
     }
 
-    std::unique_ptr<IResourceHandler> createResourceHandler(const InputParameters& inputParameters, const OutputParameters& outputParameters, bool estimateContentLength)
+    std::size_t getWritableSize(std::optional<std::size_t> estimatedContentLength, std::size_t totalServedByteCount, std::size_t size)
     {
-        return std::make_unique<TranscodingResourceHandler>(inputParameters, outputParameters, estimateContentLength);
+        if (!estimatedContentLength)
+            return size;
+
+        // never write more than the reported content length
+        const std::size_t writableSize{ totalServedByteCount < *estimatedContentLength ? std::min(size, *estimatedContentLength - totalServedByteCount) : 0 };
+        if (writableSize < size)
+            LMS_LOG(TRANSCODING, DEBUG, "Dropping " << size - writableSize << " bytes exceeding the estimated content length");
+
+        return writableSize;
+    }
+
+    std::size_t writePadding(std::ostream& os, std::optional<std::size_t> estimatedContentLength, std::size_t totalServedByteCount)
+    {
+        // pad with 0 if necessary as duration may not be accurate
+        if (!estimatedContentLength || *estimatedContentLength <= totalServedByteCount)
+            return 0;
+
+        const std::size_t padSize{ *estimatedContentLength - totalServedByteCount };
+        LMS_LOG(TRANSCODING, DEBUG, "Adding " << padSize << " padding bytes");
+
+        static constexpr std::array<char, 4096> zeroes{};
+        for (std::size_t remainingSize{ padSize }; remainingSize > 0;)
+        {
+            const std::size_t writeSize{ std::min(remainingSize, zeroes.size()) };
+            os.write(zeroes.data(), writeSize);
+            remainingSize -= writeSize;
+        }
+
+        return padSize;
+    }
+
+    namespace
+    {
+        std::unique_ptr<IResourceHandler> doCreateResourceHandler(const InputParameters& inputParameters, const OutputParameters& outputParameters, const SchedulingParameters& schedulingParameters, bool estimateContentLength)
+        {
+            if (TranscodeCache* cache{ getTranscodeCache() })
+            {
+                TranscodeCache::LookupResult lookupResult{ cache->lookup(inputParameters, outputParameters) };
+                if (lookupResult.completeFile)
+                    return createFileResourceHandler(*lookupResult.completeFile, toMimetype(outputParameters.format));
+
+                if (lookupResult.entry)
+                {
+                    if (!lookupResult.mustWrite)
+                        return std::make_unique<CachedTranscodeResourceHandler>(std::move(lookupResult.entry), toMimetype(outputParameters.format), estimateContentLength ? std::make_optional(doEstimateContentLength(inputParameters, outputParameters)) : std::nullopt);
+
+                    return std::make_unique<TranscodingResourceHandler>(inputParameters, outputParameters, schedulingParameters, estimateContentLength, std::move(lookupResult.entry));
+                }
+            }
+
+            return std::make_unique<TranscodingResourceHandler>(inputParameters, outputParameters, schedulingParameters, estimateContentLength);
+        }
+    }
+
+    std::unique_ptr<IResourceHandler> createResourceHandler(const InputParameters& inputParameters, const OutputParameters& requestedOutputParameters, const SchedulingParameters& schedulingParameters, bool estimateContentLength)
+    {
+        const OutputParameters outputParameters{ adaptOutputParameters(requestedOutputParameters, schedulingParameters) };
+        return std::make_unique<StreamResourceHandler>(doCreateResourceHandler(inputParameters, outputParameters, schedulingParameters, estimateContentLength));
     }
 
     // TODO set some nice HTTP return code
 
-    TranscodingResourceHandler::TranscodingResourceHandler(const InputParameters& inputParameters, const OutputParameters& outputParameters, bool estimateContentLength)
-        : _estimatedContentLength{ estimateContentLength ? std::make_optional(doEstimateContentLength(inputParameters, outputParameters)) : std::nullopt }
-        , _transcoder{ inputParameters, outputParameters }
+    TranscodingResourceHandler::TranscodingResourceHandler(const InputParameters& inputParameters, const OutputParameters& outputParameters, const SchedulingParameters& schedulingParameters, bool estimateContentLength, std::shared_ptr<TranscodeCache::Entry> cacheEntry)
+        : _inputParameters{ inputParameters }
+        , _outputParameters{ outputParameters }
+        , _schedulingParameters{ schedulingParameters }
+        , _estimatedContentLength{ estimateContentLength ? std::make_optional(doEstimateContentLength(inputParameters, outputParameters)) : std::nullopt }
+        , _cacheEntry{ std::move(cacheEntry) }
     {
         if (_estimatedContentLength)
             LMS_LOG(TRANSCODING, DEBUG, "Estimated content length = " << *_estimatedContentLength);
@@ -48,56 +163,145 @@ namespace Av::Transcoding
             LMS_LOG(TRANSCODING, DEBUG, "Not using estimated content length");
     }
 
+    TranscodingResourceHandler::~TranscodingResourceHandler()
+    {
+        // time between two writes is the time taken by the client to drain the first one (or to get it transcoded)
+        if (!_schedulingParameters.deviceId.empty() && _firstWriteTime && _lastWriteTime - *_firstWriteTime >= minThroughputMeasurementDuration)
+            getThroughputEstimator().addMeasurement(_schedulingParameters.deviceId, _servedByteCountBeforeLastWrite, _lastWriteTime - *_firstWriteTime);
+
+        // no effect if complete
+        if (_cacheEntry)
+            _cacheEntry->abort();
+    }
+
+    TranscodingScheduler::Priority TranscodingResourceHandler::getPriority() const
+    {
+        if (_schedulingParameters.background)
+            return TranscodingScheduler::Priority::Background;
+
+        // fresh plays are more urgent than seeks
+        return _outputParameters.offset == std::chrono::milliseconds{ 0 } ? TranscodingScheduler::Priority::Play : TranscodingScheduler::Priority::Seek;
+    }
+
     Wt::Http::ResponseContinuation* TranscodingResourceHandler::processRequest(const Wt::Http::Request& /*request*/, Wt::Http::Response& response)
     {
+        // Ranges can only be served once the transcode is complete (from the cache)
+        response.addHeader("Accept-Ranges", "none");
         if (_estimatedContentLength)
             response.setContentLength(*_estimatedContentLength);
-        response.setMimeType(_transcoder.getOutputMimeType());
-        LMS_LOG(TRANSCODING, DEBUG, "Transcoder finished = " << _transcoder.finished() << ", total served bytes = " << _totalServedByteCount << ", mime type = " << _transcoder.getOutputMimeType());
+        response.setMimeType(std::string{ toMimetype(_outputParameters.format) });
 
-        if (_bytesReadyCount > 0)
+        if (!_transcoder)
         {
-            LMS_LOG(TRANSCODING, DEBUG, "Writing " << _bytesReadyCount << " bytes back to client");
+            if (!_schedulerTicket)
+            {
+                Wt::Http::ResponseContinuation* continuation{ response.createContinuation() };
+                continuation->waitForMoreData();
+                _schedulerTicket = getTranscodingScheduler().request(_schedulingParameters.clientId, getPriority(), [continuation] { continuation->haveMoreData(); });
+                if (!_schedulerTicket->isGranted())
+                    return continuation;
+            }
 
-            response.out().write(reinterpret_cast<const char*>(&_buffer[0]), _bytesReadyCount);
-            _totalServedByteCount += _bytesReadyCount;
-            _bytesReadyCount = 0;
+            assert(_schedulerTicket->isGranted());
+            _transcoder = createTranscoder(_inputParameters, _outputParameters);
         }
 
-        if (!_transcoder.finished())
+        bool mustRead{};
+        bool finished{};
+        Wt::Http::ResponseContinuation* continuation{};
         {
-            Wt::Http::ResponseContinuation* continuation{ response.createContinuation() };
-            continuation->waitForMoreData();
-            _transcoder.asyncRead(_buffer.data(), _buffer.size(), [this, continuation](std::size_t nbBytesRead)
-                {
-                    LMS_LOG(TRANSCODING, DEBUG, "Have " << nbBytesRead << " more bytes to send back");
+            const std::scoped_lock lock{ _mutex };
 
-                    assert(_bytesReadyCount == 0);
-                    _bytesReadyCount = nbBytesRead;
-                    continuation->haveMoreData();
-                });
+            LMS_LOG(TRANSCODING, DEBUG, "Transcoder finished = " << _transcoderFinished << ", total served bytes = " << _totalServedByteCount << ", ready buffers = " << _readyBufferCount << ", mime type = " << _transcoder->getOutputMimeType());
 
-            return continuation;
-        }
-        else
-        {
-            // pad with 0 if necessary as duration may not be accurate
-            if (_estimatedContentLength && *_estimatedContentLength > _totalServedByteCount)
+            for (; _readyBufferCount > 0; --_readyBufferCount, _firstReadyBufferIndex = (_firstReadyBufferIndex + 1) % _bufferCount)
             {
-                const std::size_t padSize{ *_estimatedContentLength - _totalServedByteCount };
+                const Buffer& buffer{ _buffers[_firstReadyBufferIndex] };
+
+                const std::size_t writableSize{ getWritableSize(_estimatedContentLength, _totalServedByteCount, buffer.size) };
+                LMS_LOG(TRANSCODING, DEBUG, "Writing " << writableSize << " bytes back to client");
 
-                LMS_LOG(TRANSCODING, DEBUG, "Adding " << padSize << " padding bytes");
+                response.out().write(reinterpret_cast<const char*>(buffer.data.data()), writableSize);
 
-                for (std::size_t i{}; i < padSize; ++i)
-                    response.out().put(0);
+                _lastWriteTime = std::chrono::steady_clock::now();
+                if (!_firstWriteTime)
+                    _firstWriteTime = _lastWriteTime;
+                _servedByteCountBeforeLastWrite = _totalServedByteCount;
 
-                _totalServedByteCount += padSize;
+                _totalServedByteCount += writableSize;
             }
 
-            LMS_LOG(TRANSCODING, DEBUG, "Transcoding finished. Total served byte count = " << _totalServedByteCount);
+            mustRead = prepareRead();
+            finished = _transcoderFinished && !_readPending;
+            if (!finished)
+            {
+                continuation = response.createContinuation();
+                continuation->waitForMoreData();
+                _waitingContinuation = continuation;
+            }
         }
 
+        if (mustRead)
+            issueRead();
+
+        if (!finished)
+            return continuation;
+
+        _schedulerTicket.reset();
+
+        if (_cacheEntry)
+            _cacheEntry->complete();
+
+        _totalServedByteCount += writePadding(response.out(), _estimatedContentLength, _totalServedByteCount);
+
+        LMS_LOG(TRANSCODING, DEBUG, "Transcoding finished. Total served byte count = " << _totalServedByteCount);
+
         return {};
     }
+
+    bool TranscodingResourceHandler::prepareRead()
+    {
+        if (_readPending || _transcoderFinished || _readyBufferCount == _bufferCount)
+            return false;
+
+        _readPending = true;
+        _readBufferIndex = (_firstReadyBufferIndex + _readyBufferCount) % _bufferCount;
+        return true;
+    }
+
+    void TranscodingResourceHandler::issueRead()
+    {
+        // only one read is pending at a time: the buffer is not touched by anyone else until the callback is called
+        Buffer& buffer{ _buffers[_readBufferIndex] };
+        _transcoder->asyncRead(buffer.data.data(), buffer.data.size(), [this, &buffer](std::size_t nbBytesRead)
+            {
+                LMS_LOG(TRANSCODING, DEBUG, "Have " << nbBytesRead << " more bytes to send back");
+
+                const bool transcoderFinished{ _transcoder->finished() };
+                if (_cacheEntry && nbBytesRead > 0)
+                    _cacheEntry->write(buffer.data.data(), nbBytesRead);
+
+                bool mustRead{};
+                Wt::Http::ResponseContinuation* continuation{};
+                {
+                    const std::scoped_lock lock{ _mutex };
+
+                    buffer.size = nbBytesRead;
+                    _readyBufferCount++;
+                    _readPending = false;
+                    _transcoderFinished = transcoderFinished;
+
+                    // keep draining the transcoder while the client is being served
+                    mustRead = prepareRead();
+                    continuation = std::exchange(_waitingContinuation, nullptr);
+                }
+
+                if (mustRead)
+                    issueRead();
+
+                if (continuation)
+                    continuation->haveMoreData();
+            });
+    }
 }
 
@@ -20,30 +20,67 @@
 #pragma once
 
 #include <array>
+#include <chrono>
 #include <filesystem>
+#include <memory>
+#include <mutex>
 #include <optional>
 
 #include "av/TranscodingParameters.hpp"
 #include "utils/IResourceHandler.hpp"
-#include "Transcoder.hpp"
+#include "TranscodeCache.hpp"
+#include "TranscodingScheduler.hpp"
+#include "ITranscoder.hpp"
 
 namespace Av::Transcoding
 {
+    // Transcoded outputs are streamed before their size is known: the estimated length is the one reported to clients
+    std::size_t getWritableSize(std::optional<std::size_t> estimatedContentLength, std::size_t totalServedByteCount, std::size_t size);
+    std::size_t writePadding(std::ostream& os, std::optional<std::size_t> estimatedContentLength, std::size_t totalServedByteCount);
+
     class TranscodingResourceHandler final : public IResourceHandler
     {
     public:
-        TranscodingResourceHandler(const InputParameters& inputParameters, const OutputParameters& outputParameters, bool estimateContentLength);
+        // if set, the transcoded output is also written to the cache entry
+        TranscodingResourceHandler(const InputParameters& inputParameters, const OutputParameters& outputParameters, const SchedulingParameters& schedulingParameters, bool estimateContentLength, std::shared_ptr<TranscodeCache::Entry> cacheEntry = {});
+        ~TranscodingResourceHandler() override;
 
     private:
         Wt::Http::ResponseContinuation* processRequest(const Wt::Http::Request& request, Wt::Http::Response& reponse) override;
         void abort() override {};
+        TranscodingScheduler::Priority getPriority() const;
+        bool prepareRead(); // must be locked, returns true if a read must be issued
+        void issueRead();
 
         static constexpr std::size_t _chunkSize{ 262'144 };
+        // the transcoder output is read ahead while the previous chunks are being served
+        static constexpr std::size_t _bufferCount{ 2 };
+        const InputParameters _inputParameters;
+        const OutputParameters _outputParameters;
+        const SchedulingParameters _schedulingParameters;
         std::optional<std::size_t> _estimatedContentLength;
-        std::array<std::byte, _chunkSize> _buffer;
-        std::size_t _bytesReadyCount{};
+        struct Buffer
+        {
+            std::array<std::byte, _chunkSize> data;
+            std::size_t size{};
+        };
+        std::array<Buffer, _bufferCount> _buffers;
+
+        std::mutex _mutex; // never held while calling the transcoder, as it may call back with its own lock held
+        std::size_t _firstReadyBufferIndex{};
+        std::size_t _readyBufferCount{};
+        std::size_t _readBufferIndex{};
+        bool _readPending{};
+        bool _transcoderFinished{};
+        Wt::Http::ResponseContinuation* _waitingContinuation{};
+
         std::size_t _totalServedByteCount{};
-        Transcoder _transcoder;
+        std::optional<std::chrono::steady_clock::time_point> _firstWriteTime;
+        std::chrono::steady_clock::time_point _lastWriteTime;
+        std::size_t _servedByteCountBeforeLastWrite{};
+        std::shared_ptr<TranscodeCache::Entry> _cacheEntry;
+        std::unique_ptr<TranscodingScheduler::Ticket> _schedulerTicket; // the transcoder is created once granted
+        std::unique_ptr<ITranscoder> _transcoder;
     };
 }
 
@@ -0,0 +1,191 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TranscodingScheduler.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <thread>
+#include <vector>
+
+#include "utils/IConfig.hpp"
+#include "utils/ILogger.hpp"
+#include "utils/Service.hpp"
+
+namespace Av::Transcoding
+{
+    namespace
+    {
+        constexpr std::size_t statsLogPeriod{ 100 }; // in number of requests that had to wait
+
+        std::size_t readMaxConcurrentCount()
+        {
+            std::size_t count{ Service<IConfig>::get()->getULong("transcoding-max-concurrent-count", 0) };
+            if (count == 0)
+                count = std::max<std::size_t>(1, std::thread::hardware_concurrency());
+
+            return count;
+        }
+
+        long long toMs(std::chrono::steady_clock::duration duration)
+        {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
+        }
+    }
+
+    TranscodingScheduler& getTranscodingScheduler()
+    {
+        static TranscodingScheduler scheduler{ readMaxConcurrentCount() };
+        return scheduler;
+    }
+
+    TranscodingScheduler::Ticket::Ticket(TranscodingScheduler& scheduler, RequestList::iterator itRequest)
+        : _scheduler{ scheduler }
+        , _itRequest{ itRequest }
+    {
+    }
+
+    TranscodingScheduler::Ticket::~Ticket()
+    {
+        _scheduler.release(_itRequest);
+    }
+
+    bool TranscodingScheduler::Ticket::isGranted() const
+    {
+        const std::scoped_lock lock{ _scheduler._mutex };
+        return _itRequest->granted;
+    }
+
+    TranscodingScheduler::TranscodingScheduler(std::size_t maxConcurrentCount)
+        : _maxConcurrentCount{ maxConcurrentCount }
+    {
+        assert(_maxConcurrentCount > 0);
+        LMS_LOG(TRANSCODING, INFO, "Max concurrent transcode count = " << _maxConcurrentCount);
+    }
+
+    std::unique_ptr<TranscodingScheduler::Ticket> TranscodingScheduler::request(std::string_view clientId, Priority priority, GrantedCallback callback)
+    {
+        std::unique_lock lock{ _mutex };
+
+        // no callback until queued: not supposed to be called if granted right now
+        _pendingRequests.push_back(Request{ std::string{ clientId }, priority, {}, std::chrono::steady_clock::now() });
+        const RequestList::iterator itRequest{ std::prev(std::end(_pendingRequests)) };
+
+        std::vector<GrantedCallback> callbacks;
+        grantPendingRequests(callbacks);
+        if (!itRequest->granted)
+        {
+            itRequest->callback = std::move(callback);
+
+            _maxPendingCount = std::max(_maxPendingCount, _pendingRequests.size());
+            LMS_LOG(TRANSCODING, DEBUG, "Transcoding request queued: running = " << _grantedRequests.size() << "/" << _maxConcurrentCount << ", queue depth = " << _pendingRequests.size());
+        }
+
+        std::unique_ptr<Ticket> ticket{ new Ticket{ *this, itRequest } };
+
+        lock.unlock();
+        for (const GrantedCallback& grantedCallback : callbacks)
+            grantedCallback();
+
+        return ticket;
+    }
+
+    void TranscodingScheduler::release(RequestList::iterator itRequest)
+    {
+        std::unique_lock lock{ _mutex };
+
+        if (!itRequest->granted)
+        {
+            LMS_LOG(TRANSCODING, DEBUG, "Transcoding request cancelled after " << toMs(std::chrono::steady_clock::now() - itRequest->requestTime) << " ms");
+            _pendingRequests.erase(itRequest);
+            return;
+        }
+
+        auto itCount{ _grantedCountByClient.find(itRequest->clientId) };
+        assert(itCount != std::cend(_grantedCountByClient));
+        if (--itCount->second == 0)
+            _grantedCountByClient.erase(itCount);
+
+        _grantedRequests.erase(itRequest);
+
+        std::vector<GrantedCallback> callbacks;
+        grantPendingRequests(callbacks);
+
+        // callbacks may reenter the scheduler
+        lock.unlock();
+        for (const GrantedCallback& callback : callbacks)
+            callback();
+    }
+
+    void TranscodingScheduler::grantPendingRequests(std::vector<GrantedCallback>& callbacks)
+    {
+        while (_grantedRequests.size() < _maxConcurrentCount && !_pendingRequests.empty())
+        {
+            auto getGrantedCount{ [this](const Request& request) -> std::size_t {
+                auto itCount{ _grantedCountByClient.find(request.clientId) };
+                return itCount == std::cend(_grantedCountByClient) ? 0 : itCount->second;
+            } };
+
+            // first best candidate in arrival order
+            RequestList::iterator itBestRequest{ std::begin(_pendingRequests) };
+            std::size_t bestGrantedCount{ getGrantedCount(*itBestRequest) };
+            for (auto itRequest{ std::next(itBestRequest) }; itRequest != std::end(_pendingRequests); ++itRequest)
+            {
+                if (itRequest->priority < itBestRequest->priority)
+                    continue;
+
+                const std::size_t grantedCount{ getGrantedCount(*itRequest) };
+                if (itRequest->priority > itBestRequest->priority || grantedCount < bestGrantedCount)
+                {
+                    itBestRequest = itRequest;
+                    bestGrantedCount = grantedCount;
+                }
+            }
+
+            grant(itBestRequest);
+            if (itBestRequest->callback)
+                callbacks.push_back(std::move(itBestRequest->callback));
+        }
+    }
+
+    void TranscodingScheduler::grant(RequestList::iterator itRequest)
+    {
+        itRequest->granted = true;
+        _grantedRequests.splice(std::end(_grantedRequests), _pendingRequests, itRequest);
+        _grantedCountByClient[itRequest->clientId]++;
+
+        const std::chrono::steady_clock::duration waitDuration{ std::chrono::steady_clock::now() - itRequest->requestTime };
+        if (waitDuration < std::chrono::milliseconds{ 1 })
+            return;
+
+        LMS_LOG(TRANSCODING, DEBUG, "Transcoding request granted after " << toMs(waitDuration) << " ms, queue depth = " << _pendingRequests.size());
+
+        _grantedAfterWaitCount++;
+        _totalWaitDuration += waitDuration;
+        _maxWaitDuration = std::max(_maxWaitDuration, waitDuration);
+        if (_grantedAfterWaitCount == statsLogPeriod)
+        {
+            LMS_LOG(TRANSCODING, INFO, "Transcoding queue stats over the last " << _grantedAfterWaitCount << " queued requests: average wait = " << toMs(_totalWaitDuration / _grantedAfterWaitCount) << " ms, max wait = " << toMs(_maxWaitDuration) << " ms, max queue depth = " << _maxPendingCount);
+            _grantedAfterWaitCount = 0;
+            _totalWaitDuration = {};
+            _maxWaitDuration = {};
+            _maxPendingCount = 0;
+        }
+    }
+} // namespace Av::Transcoding
@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace Av::Transcoding
+{
+    // Limits the number of concurrent transcodes
+    // Pending requests are served by priority, then by giving the slot to the client using the fewest slots, then by arrival order
+    class TranscodingScheduler
+    {
+    public:
+        enum class Priority
+        {
+            Background, // ex: pre transcodes
+            Seek,       // offset != 0
+            Play,       // offset == 0
+        };
+
+        class Ticket;
+
+        TranscodingScheduler(std::size_t maxConcurrentCount);
+
+        TranscodingScheduler(const TranscodingScheduler&) = delete;
+        TranscodingScheduler& operator=(const TranscodingScheduler&) = delete;
+
+        // If the returned ticket is not granted yet, the callback is called once it is (from any thread)
+        // Destroying the ticket cancels the request or releases the slot
+        using GrantedCallback = std::function<void()>;
+        std::unique_ptr<Ticket> request(std::string_view clientId, Priority priority, GrantedCallback callback);
+
+    private:
+        struct Request
+        {
+            std::string clientId;
+            Priority priority;
+            GrantedCallback callback;
+            std::chrono::steady_clock::time_point requestTime;
+            bool granted{};
+        };
+        using RequestList = std::list<Request>;
+
+        void release(RequestList::iterator itRequest);
+        void grantPendingRequests(std::vector<GrantedCallback>& callbacks);
+        void grant(RequestList::iterator itRequest);
+
+        const std::size_t _maxConcurrentCount;
+
+        std::mutex _mutex;
+        RequestList _pendingRequests; // arrival order
+        RequestList _grantedRequests;
+        std::unordered_map<std::string, std::size_t> _grantedCountByClient;
+
+        // stats
+        std::size_t _grantedAfterWaitCount{};
+        std::chrono::steady_clock::duration _totalWaitDuration{};
+        std::chrono::steady_clock::duration _maxWaitDuration{};
+        std::size_t _maxPendingCount{};
+    };
+
+    class TranscodingScheduler::Ticket
+    {
+    public:
+        ~Ticket();
+        Ticket(const Ticket&) = delete;
+        Ticket& operator=(const Ticket&) = delete;
+
+        bool isGranted() const;
+
+    private:
+        friend class TranscodingScheduler;
+        Ticket(TranscodingScheduler& scheduler, RequestList::iterator itRequest);
+
+        TranscodingScheduler& _scheduler;
+        RequestList::iterator _itRequest;
+    };
+
+    TranscodingScheduler& getTranscodingScheduler();
+} // namespace Av::Transcoding
@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <span>
+
+namespace Av
+{
+    struct DecodingParameters
+    {
+        std::size_t sampleRate{}; // 0 means same as the input stream
+        std::size_t channelCount{}; // 0 means same as the input stream, downmixed/upmixed otherwise
+    };
+
+    // Decodes the whole best audio stream of the file into interleaved float samples
+    // Throws Av::Exception on failure
+    using DecodedSamplesCallback = std::function<void(std::span<const float> samples)>;
+    void decodeAudioFile(const std::filesystem::path& p, const DecodingParameters& parameters, const DecodedSamplesCallback& callback);
+} // namespace Av
@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "av/TranscodingParameters.hpp"
+
+namespace Av::Transcoding::Hls
+{
+    // Tracks are split into segments of the same duration (except the last one), transcoded and cached independently
+    // so that seeking only requires to fetch the matching segment
+    std::chrono::milliseconds getSegmentDuration(); // "transcoding-hls-segment-duration" config key
+    std::size_t getSegmentCount(std::chrono::milliseconds trackDuration);
+
+    std::string_view getPlaylistMimeType();
+    // VOD playlist, segmentUrlFunc must return the URL of the given segment
+    std::string createPlaylist(std::chrono::milliseconds trackDuration, std::function<std::string(std::size_t segmentIndex)> segmentUrlFunc);
+
+    // The format is forced to a HLS compatible one
+    OutputParameters createSegmentOutputParameters(std::size_t bitrate, std::optional<std::size_t> stream, std::size_t segmentIndex);
+} // namespace Av::Transcoding::Hls
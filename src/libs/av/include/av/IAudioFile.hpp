@@ -77,6 +77,8 @@ namespace Av
         std::size_t     bitrate{};
         DecodingCodec   codec;
         std::string 	codecName;
+        std::size_t     sampleRate{};
+        std::size_t     channelCount{};
     };
 
     class IAudioFile
@@ -99,6 +101,9 @@ namespace Av
 
     std::unique_ptr<IAudioFile> parseAudioFile(const std::filesystem::path& p);
 
+    // From a libavcodec codec name (see StreamInfo::codecName)
+    DecodingCodec getDecodingCodec(std::string_view codecName);
+
     struct AudioFileFormat
     {
         std::string mimeType;
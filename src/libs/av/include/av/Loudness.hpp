@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <filesystem>
+#include <optional>
+
+namespace Av
+{
+    struct Loudness
+    {
+        double  integratedLoudness{}; // in LUFS, as defined by EBU R128
+        float   samplePeak{}; // 1.0 is full scale
+    };
+
+    // ReplayGain 2.0 reference level
+    static inline constexpr double replayGainReferenceLoudness{ -18.0 };
+
+    // Decodes the whole best audio stream of the file, throws Av::Exception on failure
+    // Returns std::nullopt if the stream is silent or too short to be measured
+    std::optional<Loudness> computeLoudness(const std::filesystem::path& p);
+} // namespace Av
@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <span>
+#include <string_view>
+
+#include "av/TranscodingParameters.hpp"
+
+namespace Av::Transcoding
+{
+    struct PreTranscodeRequest
+    {
+        InputParameters     inputParameters;
+        OutputParameters    outputParameters;
+    };
+
+    // Transcodes in background into the transcode cache, so that upcoming requests with the same parameters do not have to wait
+    // Replaces the pre transcodes not started yet that were previously scheduled for the same client
+    // No effect if the transcode cache is disabled
+    void schedulePreTranscodes(std::string_view clientId, std::span<const PreTranscodeRequest> requests);
+} // namespace Av::Transcoding
@@ -22,7 +22,9 @@
 #include <chrono>
 #include <filesystem>
 #include <optional>
+#include <string>
 
+#include "IAudioFile.hpp"
 #include "Types.hpp"
 
 namespace Av::Transcoding
@@ -31,6 +33,8 @@ namespace Av::Transcoding
     {
         std::filesystem::path trackPath;
         std::chrono::milliseconds duration; // used to estimate content length
+        std::optional<DecodingCodec> codec; // if set, codec and bitrate of the stream are trusted and the file is not probed
+        std::size_t bitrate{};
     };
 
     enum class OutputFormat
@@ -40,6 +44,7 @@ namespace Av::Transcoding
         MATROSKA_OPUS,
         OGG_VORBIS,
         WEBM_VORBIS,
+        MPEGTS_MP3, // used for HLS segments
     };
 
     std::string_view toMimetype(OutputFormat format);
@@ -50,7 +55,16 @@ namespace Av::Transcoding
         std::size_t                 bitrate{ 128000 };
         std::optional<std::size_t>  stream; // Id of the stream to be transcoded (auto detect by default)
         std::chrono::milliseconds   offset{ 0 };
+        std::optional<std::chrono::milliseconds> duration; // if set, only this duration of the input is transcoded (HLS segments)
         bool                        stripMetadata{ true };
     };
+
+    // Concurrent transcodes are limited: pending ones are served fairly between clients
+    struct SchedulingParameters
+    {
+        std::string                 clientId;       // typically the user
+        bool                        background{};   // served after all the interactive requests
+        std::string                 deviceId;       // if set, the bitrate may be lowered to fit the throughput observed for this device
+    };
 } // namespace Av::Transcoding
 
@@ -27,6 +27,7 @@ namespace Av::Transcoding
 {
 	struct InputParameters;
 	struct OutputParameters;
+	struct SchedulingParameters;
 
-	std::unique_ptr<IResourceHandler> createResourceHandler(const InputParameters& inputParameters, const OutputParameters& outputParameters, bool estimateContentLength);
+	std::unique_ptr<IResourceHandler> createResourceHandler(const InputParameters& inputParameters, const OutputParameters& outputParameters, const SchedulingParameters& schedulingParameters, bool estimateContentLength);
 }
@@ -0,0 +1,494 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+#include <benchmark/benchmark.h>
+
+#include "database/Artist.hpp"
+#include "database/Cluster.hpp"
+#include "database/Db.hpp"
+#include "database/Listen.hpp"
+#include "database/Release.hpp"
+#include "database/Session.hpp"
+#include "database/StarredRelease.hpp"
+#include "database/Track.hpp"
+#include "database/TrackArtistLink.hpp"
+#include "database/Types.hpp"
+#include "database/User.hpp"
+#include "utils/String.hpp"
+
+using namespace Database;
+
+namespace
+{
+    // Generated once and shared by all the benchmarks
+    // Size can be set using the LMS_BENCH_DB_RELEASE_COUNT environment variable (10 tracks per release)
+    class BenchDatabase
+    {
+    public:
+        static BenchDatabase& get()
+        {
+            static BenchDatabase db;
+            return db;
+        }
+
+        ~BenchDatabase()
+        {
+            _session.reset();
+            _db.reset();
+            std::filesystem::remove(_dbPath);
+        }
+
+        Session& getSession() { return *_session; }
+
+        std::vector<ClusterId> genres;
+        std::vector<ArtistId> artists;
+        std::vector<ReleaseId> releases;
+        std::vector<std::filesystem::path> trackPaths;
+        UserId user;
+
+    private:
+        static constexpr std::size_t trackCountPerRelease{ 10 };
+
+        BenchDatabase()
+            : _dbPath{ std::filesystem::temp_directory_path() / ("lms-bench-" + std::to_string(std::random_device{}()) + ".db") }
+            , _db{ std::make_unique<Db>(_dbPath) }
+            , _session{ std::make_unique<Session>(*_db) }
+        {
+            _session->prepareTables();
+            generate(getReleaseCount());
+            _session->analyze();
+        }
+
+        static std::size_t getReleaseCount()
+        {
+            if (const char* releaseCount{ std::getenv("LMS_BENCH_DB_RELEASE_COUNT") })
+            {
+                if (const auto count{ StringUtils::readAs<std::size_t>(releaseCount) })
+                    return *count;
+            }
+
+            return 5000;
+        }
+
+        void generate(std::size_t releaseCount)
+        {
+            std::cerr << "Generating " << releaseCount << " releases..." << std::endl;
+
+            std::minstd_rand randomEngine{ 42 };
+
+            {
+                auto transaction{ _session->createWriteTransaction() };
+
+                ClusterType::pointer genre{ _session->create<ClusterType>("GENRE") };
+                for (std::size_t i{}; i < 50; ++i)
+                    genres.push_back(_session->create<Cluster>(genre, "Genre " + std::to_string(i))->getId());
+
+                for (std::size_t i{}; i < std::max<std::size_t>(releaseCount / 3, 1); ++i)
+                    artists.push_back(_session->create<Artist>("Artist " + std::to_string(i))->getId());
+
+                user = _session->create<User>("bench-user")->getId();
+            }
+
+            // skewed distributions: a few artists and genres are much more used than the others
+            std::geometric_distribution<std::size_t> genreDistrib{ 0.1 };
+            std::geometric_distribution<std::size_t> artistDistrib{ std::min(1.0, 10.0 / artists.size()) };
+            std::uniform_int_distribution<int> durationDistrib{ 30, 600 };
+
+            std::vector<Listen::TimedTrack> listens;
+            const Wt::WDateTime now{ Wt::WDateTime::currentDateTime() };
+
+            constexpr std::size_t releaseCountPerBatch{ 1000 };
+            for (std::size_t batchOffset{}; batchOffset < releaseCount; batchOffset += releaseCountPerBatch)
+            {
+                auto transaction{ _session->createWriteTransaction() };
+
+                for (std::size_t releaseIndex{ batchOffset }; releaseIndex < std::min(releaseCount, batchOffset + releaseCountPerBatch); ++releaseIndex)
+                {
+                    Release::pointer release{ _session->create<Release>("Release " + std::to_string(releaseIndex)) };
+                    releases.push_back(release->getId());
+
+                    const Artist::pointer artist{ Artist::find(*_session, artists[artistDistrib(randomEngine) % artists.size()]) };
+                    const std::vector<ObjectPtr<Cluster>> clusters{ Cluster::find(*_session, genres[genreDistrib(randomEngine) % genres.size()]) };
+
+                    for (std::size_t trackIndex{}; trackIndex < trackCountPerRelease; ++trackIndex)
+                    {
+                        const std::filesystem::path path{ "/bench/release-" + std::to_string(releaseIndex) + "/track-" + std::to_string(trackIndex) + ".flac" };
+                        trackPaths.push_back(path);
+
+                        Track::pointer track{ _session->create<Track>(path) };
+                        track.modify()->setName("Track " + std::to_string(releaseIndex * trackCountPerRelease + trackIndex));
+                        track.modify()->setTrackNumber(trackIndex + 1);
+                        track.modify()->setDuration(std::chrono::seconds{ durationDistrib(randomEngine) });
+                        track.modify()->setRelease(release);
+                        track.modify()->setClusters(clusters);
+                        TrackArtistLink::create(*_session, track, artist, TrackArtistLinkType::Artist);
+                        TrackArtistLink::create(*_session, track, artist, TrackArtistLinkType::ReleaseArtist);
+
+                        // popular releases get more listens
+                        const std::size_t listenCount{ releaseIndex % 10 == 0 ? 10 : 1 };
+                        for (std::size_t i{}; i < listenCount; ++i)
+                            listens.push_back(Listen::TimedTrack{ track->getId(), now.addSecs(-static_cast<int>(listens.size())) });
+                    }
+
+                    if (releaseIndex % 20 == 0)
+                        _session->create<StarredRelease>(release, User::find(*_session, user), FeedbackBackend::Internal);
+                }
+            }
+
+            {
+                auto transaction{ _session->createWriteTransaction() };
+                Listen::createIfNotExist(*_session, user, ScrobblingBackend::Internal, SyncState::Synchronized, listens);
+            }
+        }
+
+        const std::filesystem::path _dbPath;
+        std::unique_ptr<Db> _db;
+        std::unique_ptr<Session> _session;
+    };
+
+    template <typename Container>
+    const typename Container::value_type& pick(const Container& container, std::size_t index)
+    {
+        return container[index % container.size()];
+    }
+}
+
+static void BM_Track_FindByCluster(benchmark::State& state)
+{
+    BenchDatabase& db{ BenchDatabase::get() };
+    Session& session{ db.getSession() };
+
+    std::size_t i{};
+    for (auto _ : state)
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        Track::FindParameters params;
+        params.setClusters({ pick(db.genres, i++) });
+        params.setSortMethod(TrackSortMethod::Name);
+        params.setRange(Range{ 0, 50 });
+        benchmark::DoNotOptimize(Track::findIds(session, params));
+    }
+}
+BENCHMARK(BM_Track_FindByCluster);
+
+static void BM_Track_FindByKeywords(benchmark::State& state)
+{
+    BenchDatabase& db{ BenchDatabase::get() };
+    Session& session{ db.getSession() };
+
+    std::size_t i{};
+    for (auto _ : state)
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        const std::string keyword{ std::to_string(i++ % 1000) };
+        Track::FindParameters params;
+        params.setKeywords({ keyword });
+        params.setRange(Range{ 0, 20 });
+        benchmark::DoNotOptimize(Track::findIds(session, params));
+    }
+}
+BENCHMARK(BM_Track_FindByKeywords);
+
+static void BM_Track_FindByArtist(benchmark::State& state)
+{
+    BenchDatabase& db{ BenchDatabase::get() };
+    Session& session{ db.getSession() };
+
+    std::size_t i{};
+    for (auto _ : state)
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        Track::FindParameters params;
+        params.setArtist(pick(db.artists, i++), { TrackArtistLinkType::Artist });
+        params.setSortMethod(TrackSortMethod::Release);
+        benchmark::DoNotOptimize(Track::findIds(session, params));
+    }
+}
+BENCHMARK(BM_Track_FindByArtist);
+
+static void BM_Track_FindRandom(benchmark::State& state)
+{
+    Session& session{ BenchDatabase::get().getSession() };
+
+    for (auto _ : state)
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        Track::FindParameters params;
+        params.setSortMethod(TrackSortMethod::Random);
+        params.setRange(Range{ 0, 50 });
+        benchmark::DoNotOptimize(Track::findIds(session, params));
+    }
+}
+BENCHMARK(BM_Track_FindRandom);
+
+// args: page offset
+static void BM_Release_FindByName(benchmark::State& state)
+{
+    Session& session{ BenchDatabase::get().getSession() };
+
+    for (auto _ : state)
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        Release::FindParameters params;
+        params.setSortMethod(ReleaseSortMethod::Name);
+        params.setRange(Range{ static_cast<std::size_t>(state.range(0)), 50 });
+        benchmark::DoNotOptimize(Release::findIds(session, params));
+    }
+}
+BENCHMARK(BM_Release_FindByName)->Arg(0)->Arg(1000)->Arg(4000);
+
+static void BM_Release_FindByCluster(benchmark::State& state)
+{
+    BenchDatabase& db{ BenchDatabase::get() };
+    Session& session{ db.getSession() };
+
+    std::size_t i{};
+    for (auto _ : state)
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        Release::FindParameters params;
+        params.setClusters({ pick(db.genres, i++) });
+        params.setSortMethod(ReleaseSortMethod::Name);
+        params.setRange(Range{ 0, 50 });
+        benchmark::DoNotOptimize(Release::findIds(session, params));
+    }
+}
+BENCHMARK(BM_Release_FindByCluster);
+
+static void BM_Release_FindByArtist(benchmark::State& state)
+{
+    BenchDatabase& db{ BenchDatabase::get() };
+    Session& session{ db.getSession() };
+
+    std::size_t i{};
+    for (auto _ : state)
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        Release::FindParameters params;
+        params.setArtist(pick(db.artists, i++), { TrackArtistLinkType::ReleaseArtist });
+        params.setSortMethod(ReleaseSortMethod::Date);
+        benchmark::DoNotOptimize(Release::findIds(session, params));
+    }
+}
+BENCHMARK(BM_Release_FindByArtist);
+
+static void BM_Release_FindStarred(benchmark::State& state)
+{
+    BenchDatabase& db{ BenchDatabase::get() };
+    Session& session{ db.getSession() };
+
+    for (auto _ : state)
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        Release::FindParameters params;
+        params.setStarringUser(db.user, FeedbackBackend::Internal);
+        params.setSortMethod(ReleaseSortMethod::StarredDateDesc);
+        params.setRange(Range{ 0, 50 });
+        benchmark::DoNotOptimize(Release::findIds(session, params));
+    }
+}
+BENCHMARK(BM_Release_FindStarred);
+
+static void BM_Release_GetSimilarReleases(benchmark::State& state)
+{
+    BenchDatabase& db{ BenchDatabase::get() };
+    Session& session{ db.getSession() };
+
+    std::size_t i{};
+    for (auto _ : state)
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        const Release::pointer release{ Release::find(session, pick(db.releases, i++)) };
+        benchmark::DoNotOptimize(release->getSimilarReleases(0, 10));
+    }
+}
+BENCHMARK(BM_Release_GetSimilarReleases);
+
+// args: link type (-1 for none)
+static void BM_Artist_FindByName(benchmark::State& state)
+{
+    Session& session{ BenchDatabase::get().getSession() };
+
+    for (auto _ : state)
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        Artist::FindParameters params;
+        params.setSortMethod(ArtistSortMethod::BySortName);
+        if (state.range(0) >= 0)
+            params.setLinkType(static_cast<TrackArtistLinkType>(state.range(0)));
+        params.setRange(Range{ 0, 50 });
+        benchmark::DoNotOptimize(Artist::findIds(session, params));
+    }
+}
+BENCHMARK(BM_Artist_FindByName)->Arg(-1)->Arg(static_cast<int>(TrackArtistLinkType::ReleaseArtist));
+
+static void BM_Listen_GetTopTracks(benchmark::State& state)
+{
+    BenchDatabase& db{ BenchDatabase::get() };
+    Session& session{ db.getSession() };
+
+    for (auto _ : state)
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        Listen::StatsFindParameters params;
+        params.setUser(db.user);
+        params.setRange(Range{ 0, 50 });
+        benchmark::DoNotOptimize(Listen::getTopTracks(session, params));
+    }
+}
+BENCHMARK(BM_Listen_GetTopTracks);
+
+static void BM_Listen_GetTopReleasesByCluster(benchmark::State& state)
+{
+    BenchDatabase& db{ BenchDatabase::get() };
+    Session& session{ db.getSession() };
+
+    std::size_t i{};
+    for (auto _ : state)
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        Listen::StatsFindParameters params;
+        params.setUser(db.user);
+        params.setClusters({ pick(db.genres, i++) });
+        params.setRange(Range{ 0, 50 });
+        benchmark::DoNotOptimize(Listen::getTopReleases(session, params));
+    }
+}
+BENCHMARK(BM_Listen_GetTopReleasesByCluster);
+
+// Write benchmarks: the created entities are removed outside of the measured section
+// args: track count per transaction
+static void BM_Track_BulkInsert(benchmark::State& state)
+{
+    BenchDatabase& db{ BenchDatabase::get() };
+    Session& session{ db.getSession() };
+
+    std::size_t generation{};
+    for (auto _ : state)
+    {
+        std::vector<TrackId> createdTracks;
+        {
+            auto transaction{ session.createWriteTransaction() };
+
+            const Release::pointer release{ Release::find(session, db.releases.front()) };
+            for (std::int64_t i{}; i < state.range(0); ++i)
+            {
+                Track::pointer track{ session.create<Track>("/bench/insert/" + std::to_string(generation) + "/" + std::to_string(i) + ".flac") };
+                track.modify()->setName("Inserted track " + std::to_string(i));
+                track.modify()->setRelease(release);
+                createdTracks.push_back(track->getId());
+            }
+        }
+        generation++;
+
+        state.PauseTiming();
+        {
+            auto transaction{ session.createWriteTransaction() };
+            Track::remove(session, createdTracks);
+        }
+        state.ResumeTiming();
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Track_BulkInsert)->Arg(100)->Arg(1000)->Unit(benchmark::kMillisecond);
+
+// args: listen count per transaction
+static void BM_Listen_BulkInsert(benchmark::State& state)
+{
+    BenchDatabase& db{ BenchDatabase::get() };
+    Session& session{ db.getSession() };
+
+    std::vector<TrackId> tracks;
+    {
+        auto transaction{ session.createReadTransaction() };
+        Track::FindParameters params;
+        params.setRange(Range{ 0, 1000 });
+        tracks = Track::findIds(session, params).results;
+    }
+
+    // always in the future, so that listens are never skipped as duplicates
+    Wt::WDateTime dateTime{ Wt::WDateTime::currentDateTime().addDays(1) };
+    for (auto _ : state)
+    {
+        std::vector<Listen::TimedTrack> listens;
+        for (std::int64_t i{}; i < state.range(0); ++i)
+        {
+            dateTime = dateTime.addSecs(1);
+            listens.push_back(Listen::TimedTrack{ pick(tracks, i), dateTime });
+        }
+
+        auto transaction{ session.createWriteTransaction() };
+        benchmark::DoNotOptimize(Listen::createIfNotExist(session, db.user, ScrobblingBackend::Internal, SyncState::PendingAdd, listens));
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Listen_BulkInsert)->Arg(100)->Arg(10000)->Unit(benchmark::kMillisecond);
+
+// Same access pattern as the scanner when rescanning files: lookup by path, then update the track and its links
+// args: track count per transaction
+static void BM_Track_Upsert(benchmark::State& state)
+{
+    BenchDatabase& db{ BenchDatabase::get() };
+    Session& session{ db.getSession() };
+
+    std::size_t offset{};
+    for (auto _ : state)
+    {
+        auto transaction{ session.createWriteTransaction() };
+
+        for (std::int64_t i{}; i < state.range(0); ++i)
+        {
+            Track::pointer track{ Track::findByPath(session, pick(db.trackPaths, offset++)) };
+            track.modify()->setName("Updated track " + std::to_string(offset));
+            track.modify()->setDuration(std::chrono::seconds{ 100 + offset % 100 });
+            track.modify()->setLastWriteTime(Wt::WDateTime::currentDateTime());
+            track.modify()->setClusters({ Cluster::find(session, pick(db.genres, offset)) });
+
+            track.modify()->clearArtistLinks();
+            TrackArtistLink::create(session, track, Artist::find(session, pick(db.artists, offset)), TrackArtistLinkType::Artist);
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Track_Upsert)->Arg(100)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
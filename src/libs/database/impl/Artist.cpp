@@ -26,6 +26,7 @@
 #include "database/Track.hpp"
 #include "database/User.hpp"
 #include "utils/ILogger.hpp"
+#include "utils/String.hpp"
 #include "SqlQuery.hpp"
 #include "Utils.hpp"
 #include "EnumSetTraits.hpp"
@@ -35,31 +36,69 @@ namespace Database
 {
     namespace
     {
+        // keyset pagination is only supported by name based sort methods
+        std::optional<std::string_view> getCursorSortKeyColumn(ArtistSortMethod sortMethod)
+        {
+            switch (sortMethod)
+            {
+            case ArtistSortMethod::ByName:
+                return "name_sort_key";
+            case ArtistSortMethod::BySortName:
+                return "sort_name_sort_key";
+            default:
+                return std::nullopt;
+            }
+        }
+
         template <typename ResultType>
         Wt::Dbo::Query<ResultType> createQuery(Session& session, std::string_view itemToSelect, const Artist::FindParameters& params)
         {
             session.checkReadTransaction();
 
             auto query{ session.getDboSession().query<ResultType>("SELECT DISTINCT " + std::string{ itemToSelect } + " FROM artist a") };
-            if (params.sortMethod == ArtistSortMethod::LastWritten
+            const bool needsTrackJoin{ params.sortMethod == ArtistSortMethod::LastWritten
                 || params.writtenAfter.isValid()
-                || params.linkType
                 || params.track.isValid()
                 || params.release.isValid()
-                || params.clusters.size() == 1
-                || params.mediaLibrary.isValid())
+                || params.clusters.size() == 1 };
+
+            // Link type only filters use the precomputed link types, to avoid joining all the tracks of the artists
+            const bool useLinkTypes{ params.linkType && !needsTrackJoin };
+            if (needsTrackJoin || (params.mediaLibrary.isValid() && !useLinkTypes))
             {
                 query.join("track t ON t.id = t_a_l.track_id");
                 query.join("track_artist_link t_a_l ON t_a_l.artist_id = a.id");
             }
 
-            if (params.linkType)
+            if (useLinkTypes)
+            {
+                const long long linkTypeMask{ static_cast<long long>(EnumSet<TrackArtistLinkType>{ *params.linkType }.getBitfield()) };
+
+                if (params.mediaLibrary.isValid())
+                {
+                    query.join("artist_media_library a_m_l ON a_m_l.artist_id = a.id")
+                        .where("a_m_l.media_library_id = ?").bind(params.mediaLibrary)
+                        .where("(a_m_l.link_types & ?) <> 0").bind(linkTypeMask);
+                }
+                else
+                    query.where("(a.link_types & ?) <> 0").bind(linkTypeMask);
+            }
+            else if (params.linkType)
                 query.where("t_a_l.type = ?").bind(*params.linkType);
 
             if (params.writtenAfter.isValid())
                 query.where("t.file_last_write > ?").bind(params.writtenAfter);
 
-            if (!params.keywords.empty())
+            const bool useFullTextSearch{ Utils::canUseFullTextSearch(params.keywords) };
+            if (useFullTextSearch)
+            {
+                // all keywords must match either the name or the sort name
+                const std::string keywordsQuery{ Utils::createFullTextSearchQuery(params.keywords) };
+
+                query.join("artist_fts ON artist_fts.rowid = a.id")
+                    .where("artist_fts MATCH ?").bind("name : (" + keywordsQuery + ") OR sort_name : (" + keywordsQuery + ")");
+            }
+            else if (!params.keywords.empty())
             {
                 std::vector<std::string> clauses;
                 std::vector<std::string> sortClauses;
@@ -121,21 +160,29 @@ namespace Database
             if (params.release.isValid())
                 query.where("t.release_id = ?").bind(params.release);
 
-            if (params.mediaLibrary.isValid())
+            if (params.mediaLibrary.isValid() && !useLinkTypes)
                 query.where("t.media_library_id = ?").bind(params.mediaLibrary);
 
+            if (params.cursor)
+            {
+                assert(getCursorSortKeyColumn(params.sortMethod));
+                Utils::applyCursor(query, "a." + std::string{ *getCursorSortKeyColumn(params.sortMethod) }, "a.id", *params.cursor);
+            }
+
             switch (params.sortMethod)
             {
             case ArtistSortMethod::None:
+                if (useFullTextSearch)
+                    query.orderBy("artist_fts.rank");
                 break;
             case ArtistSortMethod::ByName:
-                query.orderBy("a.name COLLATE NOCASE");
+                query.orderBy("a.name_sort_key, a.id");
                 break;
             case ArtistSortMethod::BySortName:
-                query.orderBy("a.sort_name COLLATE NOCASE");
+                query.orderBy("a.sort_name_sort_key, a.id");
                 break;
             case ArtistSortMethod::Random:
-                query.orderBy("RANDOM()");
+                // results are sampled afterwards, see Utils::execRandomQuery
                 break;
             case ArtistSortMethod::LastWritten:
                 query.orderBy("t.file_last_write DESC");
@@ -167,8 +214,10 @@ namespace Database
 
     Artist::Artist(const std::string& name, const std::optional<UUID>& MBID)
         : _name{ std::string(name, 0 , _maxNameLength) },
+        _nameSortKey{ StringUtils::computeSortKey(_name) },
         _sortName{ _name },
-        _MBID{ MBID ? MBID->getAsString() : "" }
+        _sortNameSortKey{ _nameSortKey },
+        _MBID{ toMBIDBlob(MBID) }
     {
     }
 
@@ -195,16 +244,54 @@ namespace Database
         return std::vector<Artist::pointer>(res.begin(), res.end());
     }
 
+    std::vector<Artist::pointer> Artist::findByMBIDs(Session& session, std::span<const UUID> mbids)
+    {
+        session.checkReadTransaction();
+
+        std::vector<Artist::pointer> res;
+        Utils::forEachBindChunk(mbids, [&](std::span<const UUID> mbidChunk)
+            {
+                auto query{ session.getDboSession().find<Artist>().where("mbid IN (" + Utils::createBindPlaceholders(mbidChunk.size()) + ")") };
+                for (const UUID& mbid : mbidChunk)
+                    query.bind(toMBIDBlob(mbid));
+
+                for (const Wt::Dbo::ptr<Artist>& artist : query.resultList())
+                    res.push_back(artist);
+            });
+
+        return res;
+    }
+
+    std::vector<Artist::pointer> Artist::findByNames(Session& session, std::span<const std::string> names)
+    {
+        session.checkReadTransaction();
+
+        std::vector<Artist::pointer> res;
+        Utils::forEachBindChunk(names, [&](std::span<const std::string> nameChunk)
+            {
+                auto query{ session.getDboSession().find<Artist>()
+                    .where("name IN (" + Utils::createBindPlaceholders(nameChunk.size()) + ")")
+                    .orderBy("LENGTH(mbid) DESC") }; // put mbid entries first
+                for (const std::string& name : nameChunk)
+                    query.bind(std::string{ name, 0, _maxNameLength });
+
+                for (const Wt::Dbo::ptr<Artist>& artist : query.resultList())
+                    res.push_back(artist);
+            });
+
+        return res;
+    }
+
     Artist::pointer Artist::find(Session& session, const UUID& mbid)
     {
         session.checkReadTransaction();
-        return session.getDboSession().find<Artist>().where("mbid = ?").bind(std::string{ mbid.getAsString() }).resultValue();
+        return session.getDboSession().find<Artist>().where("mbid = ?").bind(toMBIDBlob(mbid)).resultValue();
     }
 
     Artist::pointer Artist::find(Session& session, ArtistId id)
     {
         session.checkReadTransaction();
-        return session.getDboSession().find<Artist>().where("id = ?").bind(id).resultValue();
+        return Utils::findById<Artist>(session.getDboSession(), id);
     }
 
     bool Artist::exists(Session& session, ArtistId id)
@@ -221,28 +308,107 @@ namespace Database
         return Utils::execQuery<ArtistId>(query, range);
     }
 
+    void Artist::findNames(Session& session, std::function<void(ArtistId, std::string_view name, std::string_view sortName)> func)
+    {
+        using QueryResultType = std::tuple<ArtistId, std::string, std::string>;
+        session.checkReadTransaction();
+
+        auto query{ session.getDboSession().query<QueryResultType>("SELECT id, name, sort_name FROM artist").orderBy("name_sort_key, id") };
+        Utils::execQuery<QueryResultType>(query, std::nullopt, [&](const QueryResultType& queryResult)
+            {
+                func(std::get<0>(queryResult), std::get<1>(queryResult), std::get<2>(queryResult));
+            });
+    }
+
+    std::size_t Artist::removeOrphans(Session& session)
+    {
+        session.checkWriteTransaction();
+
+        Wt::Dbo::Session& dboSession{ session.getDboSession() };
+        dboSession.flush();
+        dboSession.execute("DELETE FROM artist WHERE NOT EXISTS (SELECT 1 FROM track_artist_link t_a_l WHERE t_a_l.artist_id = artist.id)");
+        const std::size_t removedCount{ Utils::getChangeCount(dboSession) };
+
+        // Loaded artists may have been removed
+        dboSession.rereadAll("artist");
+
+        return removedCount;
+    }
+
+    void Artist::updateLinkTypes(Session& session)
+    {
+        session.checkWriteTransaction();
+
+        Wt::Dbo::Session& dboSession{ session.getDboSession() };
+        dboSession.flush();
+
+        // Link types are distinct powers of two, summing them is the same as or'ing them
+        dboSession.execute(
+            "UPDATE artist SET link_types = stats.link_types"
+            " FROM (SELECT artist_id, SUM(DISTINCT 1 << type) AS link_types FROM track_artist_link GROUP BY artist_id) AS stats"
+            " WHERE artist.id = stats.artist_id AND artist.link_types <> stats.link_types");
+        dboSession.execute("UPDATE artist SET link_types = 0 WHERE link_types <> 0 AND NOT EXISTS (SELECT 1 FROM track_artist_link t_a_l WHERE t_a_l.artist_id = artist.id)");
+
+        dboSession.execute(
+            "INSERT INTO artist_media_library (media_library_id, artist_id, link_types)"
+            " SELECT t.media_library_id, t_a_l.artist_id, SUM(DISTINCT 1 << t_a_l.type) FROM track_artist_link t_a_l"
+                " INNER JOIN track t ON t.id = t_a_l.track_id"
+                " WHERE t.media_library_id IS NOT NULL"
+                " GROUP BY t.media_library_id, t_a_l.artist_id"
+            " ON CONFLICT(media_library_id, artist_id) DO UPDATE SET link_types = excluded.link_types WHERE link_types <> excluded.link_types");
+        dboSession.execute(
+            "DELETE FROM artist_media_library WHERE NOT EXISTS (SELECT 1 FROM track_artist_link t_a_l"
+                " INNER JOIN track t ON t.id = t_a_l.track_id"
+                " WHERE t_a_l.artist_id = artist_media_library.artist_id AND t.media_library_id = artist_media_library.media_library_id)");
+
+        // Loaded artists are now outdated
+        dboSession.rereadAll("artist");
+    }
+
     RangeResults<ArtistId> Artist::findIds(Session& session, const FindParameters& params)
     {
         session.checkReadTransaction();
 
         auto query{ createQuery<ArtistId>(session, params) };
-        return Utils::execQuery<ArtistId>(query, params.range);
+        if (params.sortMethod == ArtistSortMethod::Random)
+            return Utils::execRandomQuery<ArtistId>(query, params.range);
+
+        RangeResults<ArtistId> res{ Utils::execQuery<ArtistId>(query, params.range, params.cursor) };
+        if (const auto sortKeyColumn{ getCursorSortKeyColumn(params.sortMethod) })
+            Utils::setNextCursor(session.getDboSession(), res, "artist", *sortKeyColumn);
+
+        return res;
     }
 
     RangeResults<Artist::pointer> Artist::find(Session& session, const FindParameters& params)
     {
         session.checkReadTransaction();
 
+        // only load the picked artists
+        if (params.sortMethod == ArtistSortMethod::Random)
+            return Utils::findByIds<Artist>(session.getDboSession(), findIds(session, params));
+
         auto query{ createQuery<Wt::Dbo::ptr<Artist>>(session, params) };
-        return Utils::execQuery<Artist::pointer>(query, params.range);
+        RangeResults<Artist::pointer> res{ Utils::execQuery<Artist::pointer>(query, params.range, params.cursor) };
+        if (const auto sortKeyColumn{ getCursorSortKeyColumn(params.sortMethod) })
+            Utils::setNextCursor(session.getDboSession(), res, "artist", *sortKeyColumn);
+
+        return res;
     }
 
     void Artist::find(Session& session, const FindParameters& params, std::function<void(const pointer&)> func)
     {
         session.checkReadTransaction();
 
+        if (params.sortMethod == ArtistSortMethod::Random)
+        {
+            for (const pointer& artist : find(session, params).results)
+                func(artist);
+            return;
+        }
+
         auto query{ createQuery<Wt::Dbo::ptr<Artist>>(session, params) };
-        Utils::execQuery(query, params.range, func);
+        Utils::execQuery(query, params.range, params.cursor, func);
     }
 
     RangeResults<ArtistId> Artist::findSimilarArtistIds(EnumSet<TrackArtistLinkType> artistLinkTypes, std::optional<Range> range) const
@@ -333,9 +499,28 @@ namespace Database
         return res;
     }
 
+    std::string Artist::getIndexLetter() const
+    {
+        return StringUtils::getSortKeyIndexLetter(_sortNameSortKey);
+    }
+
+    EnumSet<TrackArtistLinkType> Artist::getLinkTypes() const
+    {
+        EnumSet<TrackArtistLinkType> res;
+        res.setBitfield(static_cast<EnumSet<TrackArtistLinkType>::ValueType>(_linkTypes));
+        return res;
+    }
+
+    void Artist::setName(std::string_view name)
+    {
+        _name = name;
+        _nameSortKey = StringUtils::computeSortKey(_name);
+    }
+
     void Artist::setSortName(const std::string& sortName)
     {
         _sortName = std::string(sortName, 0, _maxNameLength);
+        _sortNameSortKey = StringUtils::computeSortKey(_sortName);
     }
 
 } // namespace Database
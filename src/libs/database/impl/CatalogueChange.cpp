@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "database/CatalogueChange.hpp"
+
+#include <tuple>
+
+#include "database/Session.hpp"
+#include "Utils.hpp"
+
+namespace Database
+{
+    std::int64_t CatalogueChange::getLastChangeId(Session& session)
+    {
+        session.checkReadTransaction();
+
+        return session.getDboSession().query<long long>("SELECT COALESCE(MAX(id), 0) FROM catalogue_change").resultValue();
+    }
+
+    std::vector<CatalogueChange::Entry> CatalogueChange::find(Session& session, EntityType type, bool removed, std::int64_t afterChangeId, std::int64_t upToChangeId, std::size_t maxCount)
+    {
+        using QueryResultType = std::tuple<long long, long long>;
+        session.checkReadTransaction();
+
+        auto query{ session.getDboSession().query<QueryResultType>("SELECT id, entity_id FROM catalogue_change")
+            .where("entity_type = ?").bind(static_cast<int>(type))
+            .where("removed = ?").bind(removed)
+            .where("id > ?").bind(static_cast<long long>(afterChangeId))
+            .where("id <= ?").bind(static_cast<long long>(upToChangeId))
+            .orderBy("id") };
+
+        std::vector<Entry> entries;
+        Utils::execQuery<QueryResultType>(query, Range{ 0, maxCount }, [&](const QueryResultType& queryResult)
+            {
+                entries.push_back(Entry{ std::get<0>(queryResult), std::get<1>(queryResult) });
+            });
+
+        return entries;
+    }
+}
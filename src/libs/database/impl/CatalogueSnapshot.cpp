@@ -0,0 +1,546 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "database/CatalogueSnapshot.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+#include "database/Session.hpp"
+#include "utils/ILogger.hpp"
+#include "IdTypeTraits.hpp"
+
+namespace Database
+{
+    namespace
+    {
+        template <typename IdType>
+        void loadIds(Wt::Dbo::Session& session, const std::string& sql, std::vector<IdType>& ids)
+        {
+            auto res{ session.query<IdType>(sql).resultList() };
+            ids.assign(res.begin(), res.end());
+        }
+
+        template <typename IdType>
+        std::optional<std::uint32_t> findIndex(const std::vector<IdType>& ids, IdType id)
+        {
+            if (!id.isValid())
+                return std::nullopt;
+
+            const auto it{ std::lower_bound(std::cbegin(ids), std::cend(ids), id) };
+            if (it == std::cend(ids) || *it != id)
+                return std::nullopt;
+
+            return static_cast<std::uint32_t>(std::distance(std::cbegin(ids), it));
+        }
+
+        std::vector<std::uint32_t> intersect(const std::vector<std::uint32_t>& sortedIndexes1, const std::vector<std::uint32_t>& sortedIndexes2)
+        {
+            std::vector<std::uint32_t> res;
+            std::set_intersection(std::cbegin(sortedIndexes1), std::cend(sortedIndexes1), std::cbegin(sortedIndexes2), std::cend(sortedIndexes2), std::back_inserter(res));
+            return res;
+        }
+
+        void sortUnique(std::vector<std::uint32_t>& indexes)
+        {
+            std::sort(std::begin(indexes), std::end(indexes));
+            indexes.erase(std::unique(std::begin(indexes), std::end(indexes)), std::end(indexes));
+        }
+    }
+
+    std::shared_ptr<const CatalogueSnapshot> CatalogueSnapshot::build(Session& session)
+    {
+        session.checkReadTransaction();
+
+        LMS_LOG(DB, DEBUG, "Building catalogue snapshot...");
+
+        Wt::Dbo::Session& dboSession{ session.getDboSession() };
+        std::shared_ptr<CatalogueSnapshot> snapshot{ new CatalogueSnapshot };
+
+        loadIds(dboSession, "SELECT id FROM release ORDER BY id", snapshot->_releaseIds);
+        loadIds(dboSession, "SELECT id FROM artist ORDER BY id", snapshot->_artistIds);
+        loadIds(dboSession, "SELECT id FROM cluster ORDER BY id", snapshot->_clusterIds);
+        loadIds(dboSession, "SELECT id FROM media_library ORDER BY id", snapshot->_mediaLibraryIds);
+
+        {
+            auto res{ dboSession.query<std::tuple<TrackId, ReleaseId, MediaLibraryId>>("SELECT id, release_id, media_library_id FROM track ORDER BY id").resultList() };
+            for (const auto& [trackId, releaseId, mediaLibraryId] : res)
+            {
+                snapshot->_trackIds.push_back(trackId);
+                snapshot->_trackReleases.push_back(snapshot->findReleaseIndex(releaseId).value_or(invalidIndex));
+                snapshot->_trackMediaLibraries.push_back(snapshot->findMediaLibraryIndex(mediaLibraryId).value_or(invalidIndex));
+            }
+        }
+
+        // rows must be ordered by row
+        auto appendLink{ [](auto& links, Index row, auto value)
+            {
+                while (links.offsets.size() <= row)
+                    links.offsets.push_back(static_cast<Index>(links.values.size()));
+                links.values.push_back(value);
+            } };
+        auto finalizeLinks{ [](auto& links, std::size_t rowCount)
+            {
+                while (links.offsets.size() <= rowCount)
+                    links.offsets.push_back(static_cast<Index>(links.values.size()));
+            } };
+
+        {
+            auto res{ dboSession.query<std::tuple<ReleaseId, TrackId>>("SELECT release_id, id FROM track WHERE release_id IS NOT NULL ORDER BY release_id, disc_number, track_number, id").resultList() };
+            for (const auto& [releaseId, trackId] : res)
+            {
+                const std::optional<Index> release{ snapshot->findReleaseIndex(releaseId) };
+                const std::optional<Index> track{ snapshot->findTrackIndex(trackId) };
+                if (release && track)
+                    appendLink(snapshot->_releaseTracks, *release, *track);
+            }
+            finalizeLinks(snapshot->_releaseTracks, snapshot->_releaseIds.size());
+        }
+
+        {
+            auto res{ dboSession.query<std::tuple<ArtistId, TrackId, TrackArtistLinkType>>("SELECT artist_id, track_id, type FROM track_artist_link ORDER BY artist_id, track_id").resultList() };
+            for (const auto& [artistId, trackId, linkType] : res)
+            {
+                const std::optional<Index> artist{ snapshot->findArtistIndex(artistId) };
+                const std::optional<Index> track{ snapshot->findTrackIndex(trackId) };
+                if (artist && track)
+                    appendLink(snapshot->_artistTracks, *artist, ArtistTrackLink{ *track, linkType });
+            }
+            finalizeLinks(snapshot->_artistTracks, snapshot->_artistIds.size());
+        }
+
+        {
+            auto res{ dboSession.query<std::tuple<TrackId, ArtistId>>("SELECT DISTINCT track_id, artist_id FROM track_artist_link ORDER BY track_id, artist_id").resultList() };
+            for (const auto& [trackId, artistId] : res)
+            {
+                const std::optional<Index> track{ snapshot->findTrackIndex(trackId) };
+                const std::optional<Index> artist{ snapshot->findArtistIndex(artistId) };
+                if (track && artist)
+                    appendLink(snapshot->_trackArtists, *track, *artist);
+            }
+            finalizeLinks(snapshot->_trackArtists, snapshot->_trackIds.size());
+        }
+
+        {
+            snapshot->_clusterTracks.resize(snapshot->_clusterIds.size());
+
+            // track indexes follow the track ids: bitmaps are filled in increasing order
+            auto res{ dboSession.query<std::tuple<ClusterId, TrackId>>("SELECT cluster_id, track_id FROM track_cluster ORDER BY cluster_id, track_id").resultList() };
+            for (const auto& [clusterId, trackId] : res)
+            {
+                const std::optional<Index> cluster{ findIndex(snapshot->_clusterIds, clusterId) };
+                const std::optional<Index> track{ snapshot->findTrackIndex(trackId) };
+                if (cluster && track)
+                    snapshot->_clusterTracks[*cluster].add(*track);
+            }
+
+            std::size_t linkCount{};
+            std::size_t memoryUsage{};
+            for (const ::Utils::CompressedBitmap& clusterTracks : snapshot->_clusterTracks)
+            {
+                linkCount += clusterTracks.getCount();
+                memoryUsage += clusterTracks.getMemoryUsage();
+            }
+            LMS_LOG(DB, DEBUG, "Cluster track bitmaps: " << memoryUsage << " bytes for " << linkCount << " links");
+        }
+
+        // same orders as the database queries
+        auto loadSortOrder{ [&](const std::string& sql, const auto& ids, SortOrder& sortOrder)
+            {
+                using IdType = typename std::decay_t<decltype(ids)>::value_type;
+
+                sortOrder.ranks.assign(ids.size(), invalidIndex);
+                auto res{ dboSession.query<IdType>(sql).resultList() };
+                for (const IdType id : res)
+                {
+                    if (const std::optional<Index> index{ findIndex(ids, id) })
+                    {
+                        sortOrder.ranks[*index] = static_cast<Index>(sortOrder.indexes.size());
+                        sortOrder.indexes.push_back(*index);
+                    }
+                }
+            } };
+
+        loadSortOrder("SELECT id FROM track ORDER BY name_sort_key, id", snapshot->_trackIds, snapshot->_tracksByName);
+        loadSortOrder("SELECT id FROM release ORDER BY name_sort_key, id", snapshot->_releaseIds, snapshot->_releasesByName);
+        loadSortOrder("SELECT id FROM artist ORDER BY name_sort_key, id", snapshot->_artistIds, snapshot->_artistsByName);
+        loadSortOrder("SELECT id FROM artist ORDER BY sort_name_sort_key, id", snapshot->_artistIds, snapshot->_artistsBySortName);
+
+        LMS_LOG(DB, DEBUG, "Catalogue snapshot built: " << snapshot->getTrackCount() << " tracks, " << snapshot->getReleaseCount() << " releases, " << snapshot->getArtistCount() << " artists");
+
+        return snapshot;
+    }
+
+    namespace
+    {
+        // candidates: sorted indexes, or nullopt for all the entities
+        template <typename IdType>
+        RangeResults<IdType> createResults(const std::vector<IdType>& ids, std::optional<std::vector<std::uint32_t>> candidates, const std::vector<std::uint32_t>* sortedIndexes, const std::vector<std::uint32_t>* ranks, std::optional<Range> range)
+        {
+            std::vector<std::uint32_t> ordered;
+            if (!candidates)
+            {
+                if (sortedIndexes)
+                {
+                    ordered = *sortedIndexes;
+                }
+                else
+                {
+                    ordered.resize(ids.size());
+                    std::iota(std::begin(ordered), std::end(ordered), 0);
+                }
+            }
+            else
+            {
+                ordered = std::move(*candidates);
+                if (ranks)
+                    std::sort(std::begin(ordered), std::end(ordered), [&](std::uint32_t lhs, std::uint32_t rhs) { return (*ranks)[lhs] < (*ranks)[rhs]; });
+            }
+
+            const std::size_t offset{ range ? std::min(range->offset, ordered.size()) : 0 };
+            const std::size_t size{ range ? std::min(range->size, ordered.size() - offset) : ordered.size() - offset };
+
+            RangeResults<IdType> res;
+            res.results.reserve(size);
+            for (std::size_t i{ offset }; i < offset + size; ++i)
+                res.results.push_back(ids[ordered[i]]);
+
+            res.range = Range{ range ? range->offset : 0, res.results.size() };
+            res.moreResults = offset + size < ordered.size();
+
+            return res;
+        }
+
+        std::optional<std::vector<std::uint32_t>> intersect(std::optional<std::vector<std::uint32_t>> candidates, std::vector<std::uint32_t> sortedIndexes)
+        {
+            if (!candidates)
+                return sortedIndexes;
+
+            return intersect(*candidates, sortedIndexes);
+        }
+    }
+
+    std::optional<RangeResults<TrackId>> CatalogueSnapshot::findTrackIds(const Track::FindParameters& params) const
+    {
+        if (!params.keywords.empty()
+            || !params.name.empty()
+            || params.cursor
+            || params.writtenAfter.isValid()
+            || params.starringUser.isValid()
+            || !params.artistName.empty()
+            || params.nonRelease
+            || !params.releaseName.empty()
+            || params.trackList.isValid()
+            || params.trackNumber
+            || params.discNumber)
+        {
+            return std::nullopt;
+        }
+
+        if (params.sortMethod != TrackSortMethod::None
+            && params.sortMethod != TrackSortMethod::Name
+            && !(params.sortMethod == TrackSortMethod::Release && params.release.isValid()))
+        {
+            return std::nullopt;
+        }
+
+        std::optional<std::vector<Index>> candidates;
+        if (params.release.isValid())
+        {
+            std::vector<Index> releaseTracks;
+            if (const std::optional<Index> release{ findReleaseIndex(params.release) })
+            {
+                const std::span<const Index> tracks{ _releaseTracks.get(*release) };
+                releaseTracks.assign(std::cbegin(tracks), std::cend(tracks));
+            }
+            sortUnique(releaseTracks);
+            candidates = std::move(releaseTracks);
+        }
+
+        if (params.artist.isValid())
+        {
+            const std::optional<Index> artist{ findArtistIndex(params.artist) };
+            candidates = intersect(std::move(candidates), artist ? getArtistTracks(*artist, params.trackArtistLinkTypes) : std::vector<Index>{});
+        }
+
+        if (!params.clusters.empty())
+        {
+            const std::optional<::Utils::CompressedBitmap> clusterTracks{ getTracksInAllClusters(params.clusters) };
+            candidates = intersect(std::move(candidates), clusterTracks ? clusterTracks->toVector() : std::vector<Index>{});
+        }
+
+        if (params.mediaLibrary.isValid())
+        {
+            const std::optional<Index> mediaLibrary{ findMediaLibraryIndex(params.mediaLibrary) };
+
+            std::vector<Index> libraryTracks;
+            for (Index track{}; track < _trackIds.size(); ++track)
+            {
+                if (mediaLibrary && _trackMediaLibraries[track] == *mediaLibrary && (!candidates || std::binary_search(std::cbegin(*candidates), std::cend(*candidates), track)))
+                    libraryTracks.push_back(track);
+            }
+            candidates = std::move(libraryTracks);
+        }
+
+        if (params.sortMethod == TrackSortMethod::Release)
+        {
+            // keep the release order
+            std::vector<Index> ordered;
+            const std::optional<Index> release{ findReleaseIndex(params.release) };
+            const std::span<const Index> releaseTracks{ release ? _releaseTracks.get(*release) : std::span<const Index>{} };
+            std::copy_if(std::cbegin(releaseTracks), std::cend(releaseTracks), std::back_inserter(ordered), [&](Index track) { return std::binary_search(std::cbegin(*candidates), std::cend(*candidates), track); });
+
+            return createResults(_trackIds, std::move(ordered), nullptr, nullptr, params.range);
+        }
+
+        const bool sortByName{ params.sortMethod == TrackSortMethod::Name };
+        return createResults(_trackIds, std::move(candidates), sortByName ? &_tracksByName.indexes : nullptr, sortByName ? &_tracksByName.ranks : nullptr, params.range);
+    }
+
+    std::optional<RangeResults<ReleaseId>> CatalogueSnapshot::findReleaseIds(const Release::FindParameters& params) const
+    {
+        if (!params.keywords.empty()
+            || params.cursor
+            || params.writtenAfter.isValid()
+            || params.dateRange
+            || params.starringUser.isValid()
+            || !params.excludedTrackArtistLinkTypes.empty()
+            || !params.releaseType.empty())
+        {
+            return std::nullopt;
+        }
+
+        if (params.sortMethod != ReleaseSortMethod::None && params.sortMethod != ReleaseSortMethod::Name)
+            return std::nullopt;
+
+        // the database matches the artist and the clusters on the same track, we would need to do the same
+        const std::size_t trackFilterCount{ static_cast<std::size_t>(params.artist.isValid()) + static_cast<std::size_t>(!params.clusters.empty()) + static_cast<std::size_t>(params.mediaLibrary.isValid()) };
+        if (trackFilterCount > 1)
+            return std::nullopt;
+
+        std::optional<std::vector<Index>> candidates;
+        auto setCandidatesFromTracks{ [&](std::span<const Index> tracks)
+            {
+                std::vector<Index> releases;
+                for (const Index track : tracks)
+                {
+                    if (_trackReleases[track] != invalidIndex)
+                        releases.push_back(_trackReleases[track]);
+                }
+                sortUnique(releases);
+                candidates = std::move(releases);
+            } };
+
+        if (params.artist.isValid())
+        {
+            const std::optional<Index> artist{ findArtistIndex(params.artist) };
+            setCandidatesFromTracks(artist ? getArtistTracks(*artist, params.trackArtistLinkTypes) : std::vector<Index>{});
+        }
+        else if (!params.clusters.empty())
+        {
+            const std::optional<::Utils::CompressedBitmap> clusterTracks{ getTracksInAllClusters(params.clusters) };
+            candidates = clusterTracks ? getReleasesOfTracks(*clusterTracks) : std::vector<Index>{};
+        }
+        else if (params.mediaLibrary.isValid())
+        {
+            const std::optional<Index> mediaLibrary{ findMediaLibraryIndex(params.mediaLibrary) };
+
+            std::vector<Index> libraryTracks;
+            for (Index track{}; track < _trackIds.size(); ++track)
+            {
+                if (mediaLibrary && _trackMediaLibraries[track] == *mediaLibrary)
+                    libraryTracks.push_back(track);
+            }
+            setCandidatesFromTracks(libraryTracks);
+        }
+
+        const bool sortByName{ params.sortMethod == ReleaseSortMethod::Name };
+        return createResults(_releaseIds, std::move(candidates), sortByName ? &_releasesByName.indexes : nullptr, sortByName ? &_releasesByName.ranks : nullptr, params.range);
+    }
+
+    std::optional<RangeResults<ArtistId>> CatalogueSnapshot::findArtistIds(const Artist::FindParameters& params) const
+    {
+        if (!params.keywords.empty()
+            || params.cursor
+            || params.writtenAfter.isValid()
+            || params.starringUser.isValid()
+            || params.track.isValid()
+            || params.release.isValid())
+        {
+            return std::nullopt;
+        }
+
+        if (params.sortMethod != ArtistSortMethod::None
+            && params.sortMethod != ArtistSortMethod::ByName
+            && params.sortMethod != ArtistSortMethod::BySortName)
+        {
+            return std::nullopt;
+        }
+
+        // the database matches the link type and the clusters on the same track, we would need to do the same
+        const std::size_t trackFilterCount{ static_cast<std::size_t>(params.linkType.has_value()) + static_cast<std::size_t>(!params.clusters.empty()) + static_cast<std::size_t>(params.mediaLibrary.isValid()) };
+        if (trackFilterCount > 1)
+            return std::nullopt;
+
+        std::optional<std::vector<Index>> candidates;
+        if (params.linkType)
+        {
+            std::vector<Index> artists;
+            for (Index artist{}; artist < _artistIds.size(); ++artist)
+            {
+                const std::span<const ArtistTrackLink> links{ _artistTracks.get(artist) };
+                if (std::any_of(std::cbegin(links), std::cend(links), [&](const ArtistTrackLink& link) { return link.type == *params.linkType; }))
+                    artists.push_back(artist);
+            }
+            candidates = std::move(artists);
+        }
+        else if (!params.clusters.empty() || params.mediaLibrary.isValid())
+        {
+            std::vector<Index> tracks;
+            if (!params.clusters.empty())
+            {
+                if (const std::optional<::Utils::CompressedBitmap> clusterTracks{ getTracksInAllClusters(params.clusters) })
+                    tracks = clusterTracks->toVector();
+            }
+            else if (const std::optional<Index> mediaLibrary{ findMediaLibraryIndex(params.mediaLibrary) })
+            {
+                for (Index track{}; track < _trackIds.size(); ++track)
+                {
+                    if (_trackMediaLibraries[track] == *mediaLibrary)
+                        tracks.push_back(track);
+                }
+            }
+
+            std::vector<Index> artists;
+            for (const Index track : tracks)
+            {
+                const std::span<const Index> trackArtists{ _trackArtists.get(track) };
+                artists.insert(std::end(artists), std::cbegin(trackArtists), std::cend(trackArtists));
+            }
+            sortUnique(artists);
+            candidates = std::move(artists);
+        }
+
+        const SortOrder* sortOrder{};
+        if (params.sortMethod == ArtistSortMethod::ByName)
+            sortOrder = &_artistsByName;
+        else if (params.sortMethod == ArtistSortMethod::BySortName)
+            sortOrder = &_artistsBySortName;
+
+        return createResults(_artistIds, std::move(candidates), sortOrder ? &sortOrder->indexes : nullptr, sortOrder ? &sortOrder->ranks : nullptr, params.range);
+    }
+
+    std::optional<CatalogueSnapshot::Index> CatalogueSnapshot::findTrackIndex(TrackId trackId) const
+    {
+        return findIndex(_trackIds, trackId);
+    }
+
+    std::optional<CatalogueSnapshot::Index> CatalogueSnapshot::findReleaseIndex(ReleaseId releaseId) const
+    {
+        return findIndex(_releaseIds, releaseId);
+    }
+
+    std::optional<CatalogueSnapshot::Index> CatalogueSnapshot::findArtistIndex(ArtistId artistId) const
+    {
+        return findIndex(_artistIds, artistId);
+    }
+
+    std::optional<CatalogueSnapshot::Index> CatalogueSnapshot::findMediaLibraryIndex(MediaLibraryId mediaLibraryId) const
+    {
+        return findIndex(_mediaLibraryIds, mediaLibraryId);
+    }
+
+    std::optional<std::vector<TrackId>> CatalogueSnapshot::findTrackIdsInAllClusters(std::span<const ClusterId> clusters) const
+    {
+        const std::optional<::Utils::CompressedBitmap> tracks{ getTracksInAllClusters(clusters) };
+        if (!tracks)
+            return std::nullopt;
+
+        std::vector<TrackId> res;
+        res.reserve(tracks->getCount());
+        tracks->visit([&](Index track) { res.push_back(_trackIds[track]); });
+
+        return res;
+    }
+
+    std::optional<std::vector<ReleaseId>> CatalogueSnapshot::findReleaseIdsInAllClusters(std::span<const ClusterId> clusters) const
+    {
+        const std::optional<::Utils::CompressedBitmap> tracks{ getTracksInAllClusters(clusters) };
+        if (!tracks)
+            return std::nullopt;
+
+        std::vector<ReleaseId> res;
+        for (const Index release : getReleasesOfTracks(*tracks))
+            res.push_back(_releaseIds[release]);
+
+        return res;
+    }
+
+    std::optional<::Utils::CompressedBitmap> CatalogueSnapshot::getTracksInAllClusters(std::span<const ClusterId> clusters) const
+    {
+        std::vector<const ::Utils::CompressedBitmap*> clusterTracks;
+        for (const ClusterId clusterId : clusters)
+        {
+            const std::optional<Index> cluster{ findIndex(_clusterIds, clusterId) };
+            if (!cluster)
+                return std::nullopt;
+
+            clusterTracks.push_back(&_clusterTracks[*cluster]);
+        }
+
+        if (clusterTracks.empty())
+            return ::Utils::CompressedBitmap{};
+
+        // start with the smallest sets to keep the intermediate results small
+        std::sort(std::begin(clusterTracks), std::end(clusterTracks), [](const ::Utils::CompressedBitmap* lhs, const ::Utils::CompressedBitmap* rhs) { return lhs->getCount() < rhs->getCount(); });
+
+        ::Utils::CompressedBitmap tracks{ *clusterTracks.front() };
+        for (std::size_t i{ 1 }; i < clusterTracks.size() && !tracks.isEmpty(); ++i)
+            tracks = ::Utils::CompressedBitmap::intersect(tracks, *clusterTracks[i]);
+
+        return tracks;
+    }
+
+    std::vector<CatalogueSnapshot::Index> CatalogueSnapshot::getReleasesOfTracks(const ::Utils::CompressedBitmap& tracks) const
+    {
+        std::vector<Index> releases;
+        tracks.visit([&](Index track)
+            {
+                if (_trackReleases[track] != invalidIndex)
+                    releases.push_back(_trackReleases[track]);
+            });
+        sortUnique(releases);
+
+        return releases;
+    }
+
+    std::vector<CatalogueSnapshot::Index> CatalogueSnapshot::getArtistTracks(Index artist, EnumSet<TrackArtistLinkType> linkTypes) const
+    {
+        std::vector<Index> tracks;
+        for (const ArtistTrackLink& link : _artistTracks.get(artist))
+        {
+            if (linkTypes.empty() || linkTypes.contains(link.type))
+                tracks.push_back(link.track);
+        }
+        // a track may be linked several times to the same artist
+        tracks.erase(std::unique(std::begin(tracks), std::end(tracks)), std::end(tracks));
+
+        return tracks;
+    }
+} // namespace Database
@@ -112,6 +112,33 @@ namespace Database
         return Utils::execQuery<Cluster::pointer>(query, params.range);
     }
 
+    void Cluster::find(Session& session, std::span<const TrackId> tracks, std::span<const std::string> clusterTypeNames, std::function<void(TrackId track, const pointer& cluster)> func)
+    {
+        session.checkReadTransaction();
+
+        if (clusterTypeNames.empty())
+            return;
+
+        Utils::forEachBindChunk(tracks, [&](std::span<const TrackId> trackChunk)
+            {
+                // also load the cluster types, as callers are likely to need them
+                auto query{ session.getDboSession().query<std::tuple<TrackId, Wt::Dbo::ptr<Cluster>, Wt::Dbo::ptr<ClusterType>>>("SELECT t_c.track_id, c, c_t FROM cluster c")
+                    .join("track_cluster t_c ON t_c.cluster_id = c.id")
+                    .join("cluster_type c_t ON c_t.id = c.cluster_type_id")
+                    .where("t_c.track_id IN (" + Utils::createBindPlaceholders(trackChunk.size()) + ")")
+                    .orderBy("t_c.track_id, c.id") };
+                for (const TrackId trackId : trackChunk)
+                    query.bind(trackId);
+
+                query.where("c_t.name IN (" + Utils::createBindPlaceholders(clusterTypeNames.size()) + ")");
+                for (const std::string& clusterTypeName : clusterTypeNames)
+                    query.bind(clusterTypeName);
+
+                for (const auto& [trackId, cluster, clusterType] : query.resultList())
+                    func(trackId, cluster);
+            });
+    }
+
     RangeResults<ClusterId> Cluster::findOrphanIds(Session& session, std::optional<Range> range)
     {
         session.checkReadTransaction();
@@ -120,11 +147,26 @@ namespace Database
         return Utils::execQuery<ClusterId>(query, range);
     }
 
+    std::size_t Cluster::removeOrphans(Session& session)
+    {
+        session.checkWriteTransaction();
+
+        Wt::Dbo::Session& dboSession{ session.getDboSession() };
+        dboSession.flush();
+        dboSession.execute("DELETE FROM cluster WHERE NOT EXISTS (SELECT 1 FROM track_cluster t_c WHERE t_c.cluster_id = cluster.id)");
+        const std::size_t removedCount{ Utils::getChangeCount(dboSession) };
+
+        // Loaded clusters may have been removed
+        dboSession.rereadAll("cluster");
+
+        return removedCount;
+    }
+
     Cluster::pointer Cluster::find(Session& session, ClusterId id)
     {
         session.checkReadTransaction();
 
-        return session.getDboSession().find<Cluster>().where("id = ?").bind(id).resultValue();
+        return Utils::findById<Cluster>(session.getDboSession(), id);
     }
 
     std::size_t Cluster::computeTrackCount(Session& session, ClusterId id)
@@ -143,6 +185,29 @@ namespace Database
             .where("t_c.cluster_id = ?").bind(id).resultValue();
     }
 
+    void Cluster::updateCounts(Session& session)
+    {
+        session.checkWriteTransaction();
+
+        Wt::Dbo::Session& dboSession{ session.getDboSession() };
+        dboSession.flush();
+
+        // Only write the clusters whose counts actually changed
+        dboSession.execute(
+            "UPDATE cluster SET track_count = stats.track_count, release_count = stats.release_count"
+            " FROM (SELECT t_c.cluster_id AS cluster_id, COUNT(t.id) AS track_count, COUNT(DISTINCT t.release_id) AS release_count"
+                " FROM track_cluster t_c INNER JOIN track t ON t.id = t_c.track_id"
+                " GROUP BY t_c.cluster_id) AS stats"
+            " WHERE cluster.id = stats.cluster_id AND (cluster.track_count IS NOT stats.track_count OR cluster.release_count IS NOT stats.release_count)");
+
+        dboSession.execute(
+            "UPDATE cluster SET track_count = 0, release_count = 0"
+            " WHERE (track_count <> 0 OR release_count <> 0) AND NOT EXISTS (SELECT 1 FROM track_cluster t_c WHERE t_c.cluster_id = cluster.id)");
+
+        // Loaded clusters are now outdated
+        dboSession.rereadAll("cluster");
+    }
+
     void Cluster::addTrack(ObjectPtr<Track> track)
     {
         _tracks.insert(getDboPtr(track));
@@ -188,6 +253,21 @@ namespace Database
         return Utils::execQuery<ClusterTypeId>(query, range);
     }
 
+    std::size_t ClusterType::removeOrphans(Session& session)
+    {
+        session.checkWriteTransaction();
+
+        Wt::Dbo::Session& dboSession{ session.getDboSession() };
+        dboSession.flush();
+        dboSession.execute("DELETE FROM cluster_type WHERE NOT EXISTS (SELECT 1 FROM cluster c WHERE c.cluster_type_id = cluster_type.id)");
+        const std::size_t removedCount{ Utils::getChangeCount(dboSession) };
+
+        // Loaded cluster types may have been removed
+        dboSession.rereadAll("cluster_type");
+
+        return removedCount;
+    }
+
     RangeResults<ClusterTypeId> ClusterType::findUsed(Session& session, std::optional<Range> range)
     {
         session.checkReadTransaction();
@@ -206,11 +286,29 @@ namespace Database
         return session.getDboSession().find<ClusterType>().where("name = ?").bind(std::string{ name }).resultValue();
     }
 
+    std::vector<ClusterType::pointer> ClusterType::findByNames(Session& session, std::span<const std::string> names)
+    {
+        session.checkReadTransaction();
+
+        std::vector<ClusterType::pointer> res;
+        Utils::forEachBindChunk(names, [&](std::span<const std::string> nameChunk)
+            {
+                auto query{ session.getDboSession().find<ClusterType>().where("name IN (" + Utils::createBindPlaceholders(nameChunk.size()) + ")") };
+                for (const std::string& name : nameChunk)
+                    query.bind(name);
+
+                for (const Wt::Dbo::ptr<ClusterType>& clusterType : query.resultList())
+                    res.push_back(clusterType);
+            });
+
+        return res;
+    }
+
     ClusterType::pointer ClusterType::find(Session& session, ClusterTypeId id)
     {
         session.checkReadTransaction();
 
-        return session.getDboSession().find<ClusterType>().where("id = ?").bind(id).resultValue();
+        return Utils::findById<ClusterType>(session.getDboSession(), id);
     }
 
     RangeResults<ClusterTypeId> ClusterType::findIds(Session& session, std::optional<Range> range)
@@ -232,6 +330,27 @@ namespace Database
             .where("cluster_type_id = ?").bind(getId()).resultValue();
     }
 
+    std::vector<Cluster::pointer> ClusterType::getClusters(std::span<const std::string> names) const
+    {
+        assert(self());
+        assert(session());
+
+        std::vector<Cluster::pointer> res;
+        Utils::forEachBindChunk(names, [&](std::span<const std::string> nameChunk)
+            {
+                auto query{ session()->find<Cluster>()
+                    .where("cluster_type_id = ?").bind(getId())
+                    .where("name IN (" + Utils::createBindPlaceholders(nameChunk.size()) + ")") };
+                for (const std::string& name : nameChunk)
+                    query.bind(name);
+
+                for (const Wt::Dbo::ptr<Cluster>& cluster : query.resultList())
+                    res.push_back(cluster);
+            });
+
+        return res;
+    }
+
     std::vector<Cluster::pointer> ClusterType::getClusters() const
     {
         assert(self());
@@ -19,25 +19,237 @@
 
 #include "database/Db.hpp"
 
+#include <array>
+#include <chrono>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <sqlite3.h>
 #include <Wt/Dbo/FixedSqlConnectionPool.h>
+#include <Wt/Dbo/SqlStatement.h>
 #include <Wt/Dbo/backend/Sqlite3.h>
+#include <Wt/WDateTime.h>
 
+#include "database/Object.hpp"
+#include "database/QueryDeadline.hpp"
 #include "database/Session.hpp"
+#include "database/SlowQueryLog.hpp"
 #include "database/User.hpp"
 #include "utils/IConfig.hpp"
+#include "utils/IMetricsRegistry.hpp"
 #include "utils/Service.hpp"
 #include "utils/ILogger.hpp"
+#include "utils/String.hpp"
+#include "UserSettingsCache.hpp"
 
 namespace Database
 {
     namespace
     {
+        thread_local bool writeTransactionStarting{};
+        thread_local bool userModified{}; // in the current write transaction
+        thread_local std::uint64_t executedStatementCount{};
+        thread_local Wt::Dbo::SqlConnection* transactionConnection{}; // connection of the SQL transaction started by the calling thread
+        std::atomic<std::uint64_t> totalExecutedStatementCount{};
+
+        // SQLite waits for locks at most this duration before reporting the database as busy
+        constexpr std::chrono::milliseconds busyTimeout{ 5'000 };
+        constexpr std::size_t beginImmediateMaxAttemptCount{ 6 };
+        constexpr int queryDeadlineCheckPeriod{ 1000 }; // in SQLite virtual machine instructions
+
+        constexpr std::size_t defaultMaxLoadedObjectCount{ 50'000 };
+        constexpr std::size_t slowQueryLogMaxEntryCount{ 256 }; // query shapes
+        constexpr std::size_t slowQueryParameterMaxSize{ 64 };
+
+        // Per-connection pragmas, see the db-* settings in lms.conf
+        struct ConnectionSettings
+        {
+            long long cacheSizeKiB{ 16 * 1024 };
+            long long mmapSize{ 256 * 1024 * 1024 };
+            std::string tempStore{ "default" };
+            long long walAutoCheckpoint{ 1000 }; // in pages
+            long long journalSizeLimit{ 64 * 1024 * 1024 };
+        };
+
+        std::optional<std::string> parseTempStore(std::string_view tempStore)
+        {
+            if (tempStore == "default" || tempStore == "file" || tempStore == "memory")
+                return std::string{ tempStore };
+
+            return std::nullopt;
+        }
+
+        ConnectionSettings readConnectionSettings()
+        {
+            ConnectionSettings settings;
+
+            IConfig* config{ Service<IConfig>::get() };
+            if (!config) // may not be here on testU
+                return settings;
+
+            settings.cacheSizeKiB = config->getULong("db-cache-size", settings.cacheSizeKiB);
+            settings.mmapSize = config->getULong("db-mmap-size", settings.mmapSize);
+            settings.walAutoCheckpoint = config->getULong("db-wal-autocheckpoint", settings.walAutoCheckpoint);
+            settings.journalSizeLimit = config->getULong("db-journal-size-limit", settings.journalSizeLimit);
+
+            const std::string tempStore{ config->getString("db-temp-store", settings.tempStore) };
+            if (std::optional<std::string> parsedTempStore{ parseTempStore(tempStore) })
+                settings.tempStore = *parsedTempStore;
+            else
+                LMS_LOG(DB, WARNING, "Unhandled db-temp-store value '" << tempStore << "', using '" << settings.tempStore << "'");
+
+            return settings;
+        }
+
+        long long queryValue(Wt::Dbo::SqlConnection* connection, const std::string& sql)
+        {
+            std::unique_ptr<Wt::Dbo::SqlStatement> statement{ connection->prepareStatement(sql) };
+            statement->execute();
+
+            long long value{};
+            if (statement->nextRow())
+                statement->getResult(0, &value);
+            statement->done();
+
+            return value;
+        }
+
+        // statement must be an "EXPLAIN QUERY PLAN" one
+        std::vector<std::string> readQueryPlan(Wt::Dbo::SqlStatement& statement)
+        {
+            statement.execute();
+
+            std::vector<std::string> details;
+            std::string detail;
+            while (statement.nextRow())
+            {
+                // columns are: id, parent, notused, detail
+                if (statement.getResult(3, &detail, 0))
+                    details.push_back(detail);
+            }
+            statement.done();
+
+            return details;
+        }
+
+        // Called by SQLite while running a statement on a read only connection, a non zero value interrupts it
+        int onQueryProgress(void*)
+        {
+            return ScopedQueryDeadline::isCurrentExceeded() ? 1 : 0;
+        }
+
+        class Connection;
+
+        // Measures the time spent in SQLite by the wrapped statement, from its execution to its last fetched row
+        // Executions that exceed the slow query threshold are logged and recorded, along with their bound parameters
+        class SlowQueryStatement : public Wt::Dbo::SqlStatement
+        {
+        public:
+            SlowQueryStatement(std::unique_ptr<Wt::Dbo::SqlStatement> statement, Connection& connection, SlowQueryLog& slowQueryLog)
+                : _statement{ std::move(statement) }
+                , _connection{ connection }
+                , _slowQueryLog{ slowQueryLog }
+            {}
+
+            // a pending measurement is dropped: the cached statements are destroyed along with their connection
+            ~SlowQueryStatement() override = default;
+
+            void reset() override
+            {
+                flush();
+                _statement->reset();
+            }
+
+            void bind(int column, const std::string& value) override
+            {
+                setParameter(column, "'" + (value.size() > slowQueryParameterMaxSize ? value.substr(0, slowQueryParameterMaxSize) + "..." : value) + "'");
+                _statement->bind(column, value);
+            }
+            void bind(int column, short value) override { setParameter(column, std::to_string(value)); _statement->bind(column, value); }
+            void bind(int column, int value) override { setParameter(column, std::to_string(value)); _statement->bind(column, value); }
+            void bind(int column, long long value) override { setParameter(column, std::to_string(value)); _statement->bind(column, value); }
+            void bind(int column, float value) override { setParameter(column, std::to_string(value)); _statement->bind(column, value); }
+            void bind(int column, double value) override { setParameter(column, std::to_string(value)); _statement->bind(column, value); }
+            void bind(int column, const std::chrono::system_clock::time_point& value, Wt::Dbo::SqlDateTimeType type) override
+            {
+                setParameter(column, StringUtils::toISO8601String(Wt::WDateTime::fromTimePoint(value)));
+                _statement->bind(column, value, type);
+            }
+            void bind(int column, const std::chrono::duration<int, std::milli>& value) override { setParameter(column, std::to_string(value.count()) + "ms"); _statement->bind(column, value); }
+            void bind(int column, const std::vector<unsigned char>& value) override { setParameter(column, "<" + std::to_string(value.size()) + " bytes>"); _statement->bind(column, value); }
+            void bindNull(int column) override { setParameter(column, "NULL"); _statement->bindNull(column); }
+
+            void execute() override
+            {
+                flush();
+
+                const auto startTime{ std::chrono::steady_clock::now() };
+                _statement->execute();
+                _pendingQuery = SlowQueryLog::Query{ _statement->sql(), _parameters, 0, std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime) };
+            }
+
+            long long insertedId() override { return _statement->insertedId(); }
+            int affectedRowCount() override { return _statement->affectedRowCount(); }
+
+            bool nextRow() override
+            {
+                const auto startTime{ std::chrono::steady_clock::now() };
+                const bool hasRow{ _statement->nextRow() };
+                if (_pendingQuery)
+                {
+                    _pendingQuery->duration += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime);
+                    if (hasRow)
+                        _pendingQuery->rowCount++;
+                    else
+                        flush();
+                }
+
+                return hasRow;
+            }
+
+            int columnCount() const override { return _statement->columnCount(); }
+
+            bool getResult(int column, std::string* value, int size) override { return _statement->getResult(column, value, size); }
+            bool getResult(int column, short* value) override { return _statement->getResult(column, value); }
+            bool getResult(int column, int* value) override { return _statement->getResult(column, value); }
+            bool getResult(int column, long long* value) override { return _statement->getResult(column, value); }
+            bool getResult(int column, float* value) override { return _statement->getResult(column, value); }
+            bool getResult(int column, double* value) override { return _statement->getResult(column, value); }
+            bool getResult(int column, std::chrono::system_clock::time_point* value, Wt::Dbo::SqlDateTimeType type) override { return _statement->getResult(column, value, type); }
+            bool getResult(int column, std::chrono::duration<int, std::milli>* value) override { return _statement->getResult(column, value); }
+            bool getResult(int column, std::vector<unsigned char>* value, int size) override { return _statement->getResult(column, value, size); }
+
+            std::string sql() const override { return _statement->sql(); }
+
+        private:
+            void setParameter(int column, std::string value)
+            {
+                if (static_cast<std::size_t>(column) >= _parameters.size())
+                    _parameters.resize(column + 1);
+                _parameters[column] = std::move(value);
+            }
+
+            // the statement execution is over (last row fetched, reset or executed again)
+            void flush();
+
+            std::unique_ptr<Wt::Dbo::SqlStatement> _statement;
+            Connection& _connection;
+            SlowQueryLog& _slowQueryLog;
+            std::vector<std::string> _parameters;
+            std::optional<SlowQueryLog::Query> _pendingQuery;
+        };
+
         class Connection : public Wt::Dbo::backend::Sqlite3
         {
         public:
-            Connection(const std::filesystem::path& dbPath)
+            Connection(const std::filesystem::path& dbPath, bool readOnly, const ConnectionSettings& settings, SlowQueryLog* slowQueryLog = nullptr)
                 : Wt::Dbo::backend::Sqlite3{ dbPath.string() }
                 , _dbPath{ dbPath }
+                , _readOnly{ readOnly }
+                , _settings{ settings }
+                , _slowQueryLog{ slowQueryLog }
             {
                 prepare();
             }
@@ -45,14 +257,29 @@ namespace Database
             Connection(const Connection& other)
                 : Wt::Dbo::backend::Sqlite3{ other }
                 , _dbPath{ other._dbPath }
+                , _readOnly{ other._readOnly }
+                , _settings{ other._settings }
+                , _slowQueryLog{ other._slowQueryLog }
             {
                 prepare();
             }
 
-            ~Connection()
+            bool isReadOnly() const { return _readOnly; }
+
+            std::unique_ptr<Wt::Dbo::SqlStatement> prepareStatement(const std::string& sql) override
             {
-                // make use of per-connection usage stats to optimize
-                optimize();
+                std::unique_ptr<Wt::Dbo::SqlStatement> statement{ Wt::Dbo::backend::Sqlite3::prepareStatement(sql) };
+                if (!_slowQueryLog)
+                    return statement;
+
+                return std::make_unique<SlowQueryStatement>(std::move(statement), *this, *_slowQueryLog);
+            }
+
+            // not measured, since not made using a SlowQueryStatement
+            std::vector<std::string> explainQueryPlan(const std::string& sql)
+            {
+                std::unique_ptr<Wt::Dbo::SqlStatement> statement{ Wt::Dbo::backend::Sqlite3::prepareStatement("EXPLAIN QUERY PLAN " + sql) };
+                return readQueryPlan(*statement);
             }
 
         private:
@@ -63,47 +290,452 @@ namespace Database
                 return std::make_unique<Connection>(*this);
             }
 
+            // Dbo gets (or prepares) a statement each time it executes one, including for lazy loads
+            Wt::Dbo::SqlStatement* getStatement(const std::string& id) override
+            {
+                executedStatementCount++;
+                totalExecutedStatementCount.fetch_add(1, std::memory_order_relaxed);
+                return Wt::Dbo::backend::Sqlite3::getStatement(id);
+            }
+
+            void startTransaction() override
+            {
+                doStartTransaction();
+                transactionConnection = this;
+            }
+
+            void commitTransaction() override
+            {
+                transactionConnection = nullptr;
+                Wt::Dbo::backend::Sqlite3::commitTransaction();
+            }
+
+            void rollbackTransaction() override
+            {
+                transactionConnection = nullptr;
+                Wt::Dbo::backend::Sqlite3::rollbackTransaction();
+            }
+
+            void doStartTransaction()
+            {
+                if (!writeTransactionStarting)
+                {
+                    Wt::Dbo::backend::Sqlite3::startTransaction();
+                    return;
+                }
+
+                // Take the write lock upfront: a deferred transaction that reads before writing could not wait for it
+                for (std::size_t attempt{ 1 }; ; ++attempt)
+                {
+                    try
+                    {
+                        executeSql("BEGIN IMMEDIATE");
+                        return;
+                    }
+                    catch (const Wt::Dbo::Exception& e)
+                    {
+                        if (attempt == beginImmediateMaxAttemptCount)
+                            throw;
+
+                        LMS_LOG(DB, WARNING, "Database busy, retrying to start write transaction (attempt " << attempt << "): " << e.what());
+                    }
+                }
+            }
+
             void prepare()
             {
                 LMS_LOG(DB, DEBUG, "Setting per-connection settings...");
                 executeSql("pragma journal_mode=WAL");
                 executeSql("pragma synchronous=normal");
+                executeSql("pragma busy_timeout=" + std::to_string(busyTimeout.count()));
                 executeSql("pragma analysis_limit=2000"); // to help make analyze command faster, 1000 does not seem to be enough to speed up all queries
+                executeSql("pragma cache_size=-" + std::to_string(_settings.cacheSizeKiB)); // negative value means KiB
+                executeSql("pragma mmap_size=" + std::to_string(_settings.mmapSize));
+                executeSql("pragma temp_store=" + _settings.tempStore);
+                executeSql("pragma wal_autocheckpoint=" + std::to_string(_settings.walAutoCheckpoint));
+                executeSql("pragma journal_size_limit=" + std::to_string(_settings.journalSizeLimit)); // truncate the WAL file once reset
+                if (_readOnly)
+                {
+                    executeSql("pragma query_only=1");
+                    // the statements are run by the thread owning the transaction, so its query deadline can be used
+                    ::sqlite3_progress_handler(connection(), queryDeadlineCheckPeriod, &onQueryProgress, nullptr);
+                }
                 LMS_LOG(DB, DEBUG, "Setting per-connection settings done!");
             }
 
-            void optimize()
+            std::filesystem::path _dbPath;
+            const bool _readOnly;
+            const ConnectionSettings _settings;
+            SlowQueryLog* const _slowQueryLog; // null if slow queries are not recorded
+        };
+
+        void SlowQueryStatement::flush()
+        {
+            if (!_pendingQuery)
+                return;
+
+            const SlowQueryLog::Query query{ std::move(*_pendingQuery) };
+            _pendingQuery.reset();
+            if (query.duration < _slowQueryLog.getThreshold())
+                return;
+
+            LMS_LOG(DB, INFO, "Slow query (" << query.duration.count() / 1000 << " ms, " << query.rowCount << " rows): " << query.sql << " [" << StringUtils::joinStrings(query.parameters, ", ") << "]");
+            if (!_slowQueryLog.record(query))
+                return;
+
+            // first time this query shape is seen
+            try
+            {
+                std::vector<std::string> queryPlan{ _connection.explainQueryPlan(query.sql) };
+                LMS_LOG(DB, INFO, "Slow query plan: " << StringUtils::joinStrings(queryPlan, " | "));
+                _slowQueryLog.setQueryPlan(query.sql, std::move(queryPlan));
+            }
+            catch (const Wt::Dbo::Exception& e)
             {
-                LMS_LOG(DB, DEBUG, "connection close: Running pragma optimize...");
-                executeSql("pragma optimize");
-                LMS_LOG(DB, DEBUG, "connection close: pragma optimize complete");
+                LMS_LOG(DB, DEBUG, "Cannot explain slow query: " << e.what());
             }
+        }
 
-            std::filesystem::path _dbPath;
+        // Hands out the write connection to write transactions, and read only connections to the others
+        class ConnectionPoolDispatcher : public Wt::Dbo::SqlConnectionPool
+        {
+        public:
+            ConnectionPoolDispatcher(Wt::Dbo::SqlConnectionPool& readConnectionPool, Wt::Dbo::SqlConnectionPool& writeConnectionPool)
+                : _readConnectionPool{ readConnectionPool }
+                , _writeConnectionPool{ writeConnectionPool }
+            {
+                if (Metrics::IRegistry * registry{ Service<Metrics::IRegistry>::get() }) // may not be here on testU
+                {
+                    constexpr std::string_view help{ "Time spent waiting for a free database connection" };
+                    _readConnectionWaitHistogram = &registry->getHistogram("lms_db_connection_wait_seconds", help, Metrics::defaultDurationBuckets, { { "pool", "read" } });
+                    _writeConnectionWaitHistogram = &registry->getHistogram("lms_db_connection_wait_seconds", help, Metrics::defaultDurationBuckets, { { "pool", "write" } });
+                }
+            }
+
+        private:
+            std::unique_ptr<Wt::Dbo::SqlConnection> getConnection() override
+            {
+                Wt::Dbo::SqlConnectionPool& connectionPool{ writeTransactionStarting ? _writeConnectionPool : _readConnectionPool };
+                Metrics::Histogram* waitHistogram{ writeTransactionStarting ? _writeConnectionWaitHistogram : _readConnectionWaitHistogram };
+                if (!waitHistogram)
+                    return connectionPool.getConnection();
+
+                const auto startTime{ std::chrono::steady_clock::now() };
+                std::unique_ptr<Wt::Dbo::SqlConnection> connection{ connectionPool.getConnection() };
+                waitHistogram->observe(std::chrono::steady_clock::now() - startTime);
+
+                return connection;
+            }
+
+            void returnConnection(std::unique_ptr<Wt::Dbo::SqlConnection> connection) override
+            {
+                if (static_cast<const Connection&>(*connection).isReadOnly())
+                    _readConnectionPool.returnConnection(std::move(connection));
+                else
+                    _writeConnectionPool.returnConnection(std::move(connection));
+            }
+
+            void prepareForDropTables() const override
+            {
+                _readConnectionPool.prepareForDropTables();
+                _writeConnectionPool.prepareForDropTables();
+            }
+
+            Wt::Dbo::SqlConnectionPool& _readConnectionPool;
+            Wt::Dbo::SqlConnectionPool& _writeConnectionPool;
+            Metrics::Histogram* _readConnectionWaitHistogram{};
+            Metrics::Histogram* _writeConnectionWaitHistogram{};
         };
+
+        std::unique_ptr<Wt::Dbo::SqlConnectionPool> createConnectionPool(const std::filesystem::path& dbPath, bool readOnly, std::size_t connectionCount, const ConnectionSettings& settings, SlowQueryLog* slowQueryLog)
+        {
+            auto connection{ std::make_unique<Connection>(dbPath, readOnly, settings, slowQueryLog) };
+            if (IConfig * config{ Service<IConfig>::get() })// may not be here on testU
+                connection->setProperty("show-queries", config->getBool("db-show-queries", false) ? "true" : "false");
+
+            auto connectionPool{ std::make_unique<Wt::Dbo::FixedSqlConnectionPool>(std::move(connection), connectionCount) };
+            // write transactions are serialized: wait for the ongoing one as long as we would wait for another process
+            connectionPool->setTimeout(readOnly ? std::chrono::seconds{ 10 } : busyTimeout * beginImmediateMaxAttemptCount);
+
+            return connectionPool;
+        }
     }
 
     // Session living class handling the database and the login
-    Db::Db(const std::filesystem::path& dbPath, std::size_t connectionCount)
+    Db::Db(const std::filesystem::path& dbPath, std::size_t readConnectionCount)
+        : _dbPath{ dbPath }
+        , _maxLoadedObjectCount{ defaultMaxLoadedObjectCount }
+        , _userSettingsCache{ std::make_unique<UserSettingsCache>() }
+    {
+        LMS_LOG(DB, INFO, "Creating connection pools on file " << dbPath.string() << " (" << readConnectionCount << " read connections)");
+
+        const ConnectionSettings settings{ readConnectionSettings() };
+
+        if (IConfig * config{ Service<IConfig>::get() }) // may not be here on testU
+        {
+            if (const std::chrono::milliseconds slowQueryThreshold{ config->getULong("db-slow-query-threshold", 0) }; slowQueryThreshold.count() > 0)
+            {
+                LMS_LOG(DB, INFO, "Recording queries slower than " << slowQueryThreshold.count() << " ms");
+                _slowQueryLog = std::make_unique<SlowQueryLog>(slowQueryThreshold, slowQueryLogMaxEntryCount);
+            }
+        }
+
+        // The write connection first, since it may have to create the database file
+        _writeConnectionPool = createConnectionPool(dbPath, false, 1, settings, _slowQueryLog.get());
+        _readConnectionPool = createConnectionPool(dbPath, true, readConnectionCount, settings, _slowQueryLog.get());
+        _connectionPool = std::make_unique<ConnectionPoolDispatcher>(*_readConnectionPool, *_writeConnectionPool);
+
+        // before the tables get created
+        setupAutoVacuum(Service<IConfig>::get() && Service<IConfig>::get()->getBool("db-auto-vacuum-convert", false));
+
+        if (Metrics::IRegistry * registry{ Service<Metrics::IRegistry>::get() }) // may not be here on testU
+        {
+            constexpr std::string_view help{ "Duration of the database transactions, including the commit" };
+            _readTransactionDurationHistogram = &registry->getHistogram("lms_db_transaction_duration_seconds", help, Metrics::defaultDurationBuckets, { { "type", "read" } });
+            _writeTransactionDurationHistogram = &registry->getHistogram("lms_db_transaction_duration_seconds", help, Metrics::defaultDurationBuckets, { { "type", "write" } });
+
+            constexpr std::array<double, 6> loadedObjectCountBuckets{ 10, 100, 1'000, 10'000, 100'000, 1'000'000 };
+            _loadedObjectCountHistogram = &registry->getHistogram("lms_db_session_loaded_objects", "Objects loaded by the thread session at the end of the outermost transactions", loadedObjectCountBuckets);
+            _loadedObjectDiscardCounter = &registry->getCounter("lms_db_session_loaded_objects_discards_total", "Number of times the loaded objects of a thread session have been discarded, see db-session-max-loaded-objects");
+        }
+
+        std::chrono::seconds walCheckpointPeriod{ 60 };
+        if (IConfig * config{ Service<IConfig>::get() }) // may not be here on testU
+        {
+            walCheckpointPeriod = std::chrono::seconds{ config->getULong("db-wal-checkpoint-period", walCheckpointPeriod.count()) };
+            _maxLoadedObjectCount = config->getULong("db-session-max-loaded-objects", _maxLoadedObjectCount);
+        }
+
+        if (walCheckpointPeriod.count() > 0)
+        {
+            // Dedicated connection: checkpointing must neither wait for the write connection nor be refused by a query only connection
+            _walCheckpointConnection = std::make_unique<Connection>(dbPath, false, settings);
+            _walCheckpointThread = std::thread{ [this, walCheckpointPeriod] { runWalCheckpoints(walCheckpointPeriod); } };
+        }
+    }
+
+    Db::~Db()
+    {
+        if (_walCheckpointThread.joinable())
+        {
+            {
+                std::scoped_lock lock{ _walCheckpointMutex };
+                _walCheckpointStopRequested = true;
+            }
+            _walCheckpointCondVar.notify_all();
+            _walCheckpointThread.join();
+        }
+    }
+
+    void Db::setupAutoVacuum(bool convert)
+    {
+        // 0: none, 1: full, 2: incremental
+        ScopedConnection connection{ *_writeConnectionPool };
+        const long long autoVacuum{ queryValue(connection.get(), "pragma auto_vacuum") };
+        if (autoVacuum == 2)
+            return;
+
+        // the database file already exists, as it has been set to WAL mode: the VACUUM is instantaneous while there is no table
+        if (queryValue(connection.get(), "SELECT COUNT(*) FROM sqlite_master") == 0)
+        {
+            connection->executeSql("pragma auto_vacuum=INCREMENTAL");
+            connection->executeSql("VACUUM");
+            LMS_LOG(DB, INFO, "Incremental vacuum enabled");
+            return;
+        }
+
+        if (autoVacuum != 0)
+            return;
+
+        if (!convert)
+        {
+            LMS_LOG(DB, INFO, "Incremental vacuum not enabled on this database, see db-auto-vacuum-convert");
+            return;
+        }
+
+        LMS_LOG(DB, INFO, "Converting database to incremental vacuum, this may take a while...");
+        const auto startTime{ std::chrono::steady_clock::now() };
+        connection->executeSql("pragma auto_vacuum=INCREMENTAL");
+        connection->executeSql("VACUUM");
+        LMS_LOG(DB, INFO, "Database converted to incremental vacuum in " << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count() << " ms");
+    }
+
+    Db::StorageStats Db::getStorageStats()
+    {
+        ScopedConnection connection{ *_readConnectionPool };
+
+        StorageStats stats;
+        stats.pageSize = queryValue(connection.get(), "pragma page_size");
+        stats.pageCount = queryValue(connection.get(), "pragma page_count");
+        stats.freePageCount = queryValue(connection.get(), "pragma freelist_count");
+        stats.incrementalVacuum = queryValue(connection.get(), "pragma auto_vacuum") == 2;
+
+        return stats;
+    }
+
+    std::uint64_t Db::incrementalVacuum(std::uint64_t maxPageCount)
+    {
+        ScopedConnection connection{ *_writeConnectionPool };
+
+        // each step releases one page
+        std::unique_ptr<Wt::Dbo::SqlStatement> statement{ connection->prepareStatement("pragma incremental_vacuum(" + std::to_string(maxPageCount) + ")") };
+        statement->execute();
+        while (statement->nextRow())
+        {}
+        statement->done();
+
+        return queryValue(connection.get(), "pragma freelist_count");
+    }
+
+    void Db::backup(const std::filesystem::path& destination)
     {
-        LMS_LOG(DB, INFO, "Creating connection pool on file " << dbPath.string());
+        // VACUUM INTO refuses to overwrite an existing file, and the destination must never be left half written
+        std::filesystem::path tmpDestination{ destination };
+        tmpDestination += ".tmp";
+        std::filesystem::remove(tmpDestination);
 
-        auto connection{ std::make_unique<Connection>(dbPath.string()) };
-        if (IConfig * config{ Service<IConfig>::get() })// may not be here on testU
-            connection->setProperty("show-queries", config->getBool("db-show-queries", false) ? "true" : "false");
+        LMS_LOG(DB, INFO, "Backing up database into " << destination.string() << "...");
+        const auto startTime{ std::chrono::steady_clock::now() };
+        try
+        {
+            // not a query only connection, VACUUM INTO would be refused
+            Connection connection{ _dbPath, false, readConnectionSettings() };
+            std::unique_ptr<Wt::Dbo::SqlStatement> statement{ connection.prepareStatement("VACUUM INTO ?") };
+            statement->bind(0, tmpDestination.string());
+            statement->execute();
+            statement->done();
+        }
+        catch (...)
+        {
+            std::error_code ec;
+            std::filesystem::remove(tmpDestination, ec);
+            throw;
+        }
+
+        std::filesystem::rename(tmpDestination, destination);
+        LMS_LOG(DB, INFO, "Database backup complete in " << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count() << " ms");
+    }
+
+    void Db::runWalCheckpoints(std::chrono::seconds period)
+    {
+        std::uint64_t lastCheckpointedWriteGeneration{ getWriteGeneration() };
+
+        std::unique_lock lock{ _walCheckpointMutex };
+        while (!_walCheckpointCondVar.wait_for(lock, period, [this] { return _walCheckpointStopRequested; }))
+        {
+            // nothing new to move back into the database
+            const std::uint64_t writeGeneration{ getWriteGeneration() };
+            if (writeGeneration == lastCheckpointedWriteGeneration)
+                continue;
+
+            lock.unlock();
+            if (walCheckpoint())
+                lastCheckpointedWriteGeneration = writeGeneration;
+            lock.lock();
+        }
+    }
+
+    bool Db::walCheckpoint()
+    {
+        // passive mode: never waits for readers nor writers, WAL frames still in use by long running read transactions are left for the next run
+        try
+        {
+            std::unique_ptr<Wt::Dbo::SqlStatement> statement{ _walCheckpointConnection->prepareStatement("pragma wal_checkpoint(PASSIVE)") };
+            statement->execute();
 
-        auto connectionPool{ std::make_unique<Wt::Dbo::FixedSqlConnectionPool>(std::move(connection), connectionCount) };
-        connectionPool->setTimeout(std::chrono::seconds{ 10 });
+            // columns are: busy, WAL frame count, checkpointed frame count
+            int busy{};
+            int walFrameCount{};
+            int checkpointedFrameCount{};
+            if (statement->nextRow())
+            {
+                statement->getResult(0, &busy);
+                statement->getResult(1, &walFrameCount);
+                statement->getResult(2, &checkpointedFrameCount);
+            }
+            statement->done();
 
-        _connectionPool = std::move(connectionPool);
+            LMS_LOG(DB, DEBUG, "WAL checkpoint: busy = " << busy << ", " << checkpointedFrameCount << "/" << walFrameCount << " frames checkpointed");
+            return !busy && checkpointedFrameCount == walFrameCount;
+        }
+        catch (const Wt::Dbo::Exception& e)
+        {
+            LMS_LOG(DB, ERROR, "WAL checkpoint failed: " << e.what());
+            return false;
+        }
     }
 
     void Db::executeSql(const std::string& sql)
     {
-        ScopedConnection connection{ *_connectionPool };
+        ScopedConnection connection{ *_writeConnectionPool };
         connection->executeSql(sql);
     }
 
+    std::vector<std::string> Db::explainQueryPlan(const std::string& sql)
+    {
+        ScopedConnection connection{ *_readConnectionPool };
+
+        std::unique_ptr<Wt::Dbo::SqlStatement> statement{ connection->prepareStatement("EXPLAIN QUERY PLAN " + sql) };
+        return readQueryPlan(*statement);
+    }
+
+    void Db::setWriteTransactionStarting(bool value)
+    {
+        writeTransactionStarting = value;
+    }
+
+    std::uint64_t Db::getExecutedStatementCount()
+    {
+        return executedStatementCount;
+    }
+
+    Wt::Dbo::SqlConnection* Db::getTransactionConnection()
+    {
+        return transactionConnection;
+    }
+
+    std::uint64_t Db::getTotalExecutedStatementCount()
+    {
+        return totalExecutedStatementCount.load(std::memory_order_relaxed);
+    }
+
+    void Db::onWriteTransactionEnded(bool outermost)
+    {
+        _lastWriteTime.store(std::chrono::system_clock::now());
+        _writeGeneration.fetch_add(1);
+
+        // nested transactions are only committed along with the outermost one
+        if (outermost && std::exchange(userModified, false))
+            _userSettingsCache->invalidate();
+    }
+
+    void Db::onOutermostTransactionStarting(Wt::Dbo::Session& session)
+    {
+        if (_maxLoadedObjectCount == 0)
+            return;
+
+        const std::size_t loadedObjectCount{ LoadedObjectCounter::get() };
+        if (loadedObjectCount <= _maxLoadedObjectCount)
+            return;
+
+        // Nothing is pending at this point: the held objects are only marked as to be reloaded on their next access
+        LMS_LOG(DB, DEBUG, "Discarding " << loadedObjectCount << " loaded objects (max = " << _maxLoadedObjectCount << ")");
+        session.rereadAll();
+        if (_loadedObjectDiscardCounter)
+            _loadedObjectDiscardCounter->inc();
+    }
+
+    void Db::onOutermostTransactionEnding()
+    {
+        if (_loadedObjectCountHistogram)
+            _loadedObjectCountHistogram->observe(static_cast<double>(LoadedObjectCounter::get()));
+    }
+
+    void Db::onUserModified()
+    {
+        userModified = true;
+    }
+
     Session& Db::getTLSSession()
     {
         static thread_local Session* tlsSession{};
@@ -138,4 +770,9 @@ namespace Database
         return _connection.get();
     }
 
+    Wt::Dbo::SqlConnection* Db::ScopedConnection::get() const
+    {
+        return _connection.get();
+    }
+
 } // namespace Database
@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "database/DirectReads.hpp"
+
+#include "database/Session.hpp"
+#include "utils/ITraceLogger.hpp"
+#include "DirectStatement.hpp"
+
+namespace Database::DirectReads
+{
+    ReleaseYears getReleaseYears(Session& session, ReleaseId release)
+    {
+        LMS_SCOPED_TRACE_DETAILED("Database", "GetReleaseYears");
+
+        // various values (NULL included) => no year
+        DirectStatement statement{ session.getDboSession(),
+            "SELECT COUNT(DISTINCT t.year) + MAX(t.year IS NULL), MIN(t.year),"
+            " COUNT(DISTINCT t.original_year) + MAX(t.original_year IS NULL), MIN(t.original_year)"
+            " FROM track t WHERE t.release_id = ?" };
+        statement.bind(release);
+
+        ReleaseYears res;
+        if (statement.nextRow())
+        {
+            if (statement.getInt(0).value_or(0) == 1)
+                res.year = statement.getInt(1);
+            if (statement.getInt(2).value_or(0) == 1)
+                res.originalYear = statement.getInt(3);
+        }
+
+        return res;
+    }
+
+    std::vector<std::string> getReleaseClusterNames(Session& session, ReleaseId release, std::string_view clusterTypeName)
+    {
+        LMS_SCOPED_TRACE_DETAILED("Database", "GetReleaseClusterNames");
+
+        DirectStatement statement{ session.getDboSession(),
+            "SELECT DISTINCT c.id, c.name FROM cluster c"
+            " INNER JOIN track_cluster t_c ON t_c.cluster_id = c.id"
+            " INNER JOIN track t ON t.id = t_c.track_id"
+            " INNER JOIN cluster_type c_t ON c_t.id = c.cluster_type_id"
+            " WHERE t.release_id = ? AND c_t.name = ?" };
+        statement.bind(release).bind(std::string{ clusterTypeName });
+
+        std::vector<std::string> names;
+        while (statement.nextRow())
+        {
+            if (std::optional<std::string> name{ statement.getString(1) })
+                names.push_back(std::move(*name));
+        }
+
+        return names;
+    }
+}
@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "DirectStatement.hpp"
+
+#include <cassert>
+#include <memory>
+
+#include <Wt/Dbo/Session.h>
+#include <Wt/Dbo/SqlConnection.h>
+#include <Wt/Dbo/SqlStatement.h>
+
+#include "database/Db.hpp"
+#include "database/TransactionChecker.hpp"
+
+namespace Database
+{
+    DirectStatement::DirectStatement(Wt::Dbo::Session& session, const std::string& sql)
+    {
+        TransactionChecker::checkReadTransaction(session);
+
+        // Dbo flushes the modified objects before running its own queries
+        session.flush();
+
+        Wt::Dbo::SqlConnection* connection{ Db::getTransactionConnection() };
+        if (!connection)
+        {
+            // Dbo only starts the SQL transaction on its first statement
+            session.execute("SELECT 1");
+            connection = Db::getTransactionConnection();
+        }
+        assert(connection);
+
+        _statement = connection->getStatement(sql);
+        if (!_statement)
+        {
+            std::unique_ptr<Wt::Dbo::SqlStatement> statement{ connection->prepareStatement(sql) };
+            _statement = statement.get();
+            _statement->use();
+            connection->saveStatement(sql, std::move(statement));
+        }
+        _statement->reset();
+    }
+
+    DirectStatement::~DirectStatement()
+    {
+        _statement->done();
+    }
+
+    DirectStatement& DirectStatement::bind(int value)
+    {
+        _statement->bind(_bindIndex++, value);
+        return *this;
+    }
+
+    DirectStatement& DirectStatement::bind(long long value)
+    {
+        _statement->bind(_bindIndex++, value);
+        return *this;
+    }
+
+    DirectStatement& DirectStatement::bind(const std::string& value)
+    {
+        _statement->bind(_bindIndex++, value);
+        return *this;
+    }
+
+    bool DirectStatement::nextRow()
+    {
+        if (!_executed)
+        {
+            _statement->execute();
+            _executed = true;
+        }
+
+        return _statement->nextRow();
+    }
+
+    std::optional<int> DirectStatement::getInt(int column)
+    {
+        int value{};
+        if (!_statement->getResult(column, &value))
+            return std::nullopt;
+
+        return value;
+    }
+
+    std::optional<long long> DirectStatement::getLongLong(int column)
+    {
+        long long value{};
+        if (!_statement->getResult(column, &value))
+            return std::nullopt;
+
+        return value;
+    }
+
+    std::optional<std::string> DirectStatement::getString(int column)
+    {
+        std::string value;
+        if (!_statement->getResult(column, &value, 0))
+            return std::nullopt;
+
+        return value;
+    }
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <optional>
+#include <string>
+
+#include "database/IdType.hpp"
+
+namespace Wt::Dbo
+{
+    class Session;
+    class SqlStatement;
+}
+
+namespace Database
+{
+    // Executes a read query on the connection of the ongoing transaction, without any Dbo query building nor object mapping
+    // Statements are prepared once per connection and kept in its statement cache
+    // Must be used within a transaction, the pending changes of the session are flushed first
+    class DirectStatement
+    {
+    public:
+        DirectStatement(Wt::Dbo::Session& session, const std::string& sql);
+        ~DirectStatement();
+
+        // Parameters are bound in order
+        DirectStatement& bind(int value);
+        DirectStatement& bind(long long value);
+        DirectStatement& bind(const std::string& value);
+        DirectStatement& bind(IdType id) { return bind(static_cast<long long>(id.getValue())); }
+
+        bool nextRow(); // the first call executes the statement
+
+        // std::nullopt if the column value is NULL
+        std::optional<int> getInt(int column);
+        std::optional<long long> getLongLong(int column);
+        std::optional<std::string> getString(int column);
+
+    private:
+        DirectStatement(const DirectStatement&) = delete;
+        DirectStatement& operator=(const DirectStatement&) = delete;
+
+        Wt::Dbo::SqlStatement* _statement{};
+        int _bindIndex{};
+        bool _executed{};
+    };
+}
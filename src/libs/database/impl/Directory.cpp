@@ -0,0 +1,325 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "database/Directory.hpp"
+
+#include <algorithm>
+#include <optional>
+#include <span>
+#include <tuple>
+
+#include "database/MediaLibrary.hpp"
+#include "database/Session.hpp"
+#include "IdTypeTraits.hpp"
+#include "StringViewTraits.hpp"
+#include "Utils.hpp"
+
+namespace Database
+{
+    namespace
+    {
+        // "." and ".." resolved, without trailing separator
+        std::filesystem::path normalizePath(const std::filesystem::path& path)
+        {
+            std::filesystem::path res{ path.lexically_normal() };
+            if (!res.has_filename() && res.has_relative_path())
+                res = res.parent_path();
+
+            return res;
+        }
+
+        // Components of the path located after the root path, std::nullopt if the path is not located in the root path
+        std::optional<std::vector<std::string>> getRelativeComponents(const std::filesystem::path& rootPath, const std::filesystem::path& path)
+        {
+            if (rootPath.root_path() != path.root_path())
+                return std::nullopt;
+
+            auto itPath{ std::cbegin(path) };
+            for (const std::filesystem::path& rootComponent : rootPath)
+            {
+                if (itPath == std::cend(path) || *itPath != rootComponent)
+                    return std::nullopt;
+                ++itPath;
+            }
+
+            std::vector<std::string> res;
+            for (; itPath != std::cend(path); ++itPath)
+                res.push_back(itPath->string());
+
+            return res;
+        }
+
+        struct RootDirectoryInfo
+        {
+            DirectoryId id;
+            std::filesystem::path path;
+        };
+
+        std::vector<RootDirectoryInfo> findRootDirectoryInfos(Session& session)
+        {
+            using QueryResultType = std::tuple<DirectoryId, std::string>;
+
+            auto query{ session.getDboSession().query<QueryResultType>("SELECT id, name FROM directory").where("parent_directory_id IS NULL") };
+
+            std::vector<RootDirectoryInfo> res;
+            Utils::execQuery<QueryResultType>(query, std::nullopt, [&](const QueryResultType& queryResult)
+                {
+                    res.push_back(RootDirectoryInfo{ std::get<DirectoryId>(queryResult), std::get<std::string>(queryResult) });
+                });
+
+            return res;
+        }
+
+        struct ContainingRootDirectory
+        {
+            DirectoryId id;
+            std::vector<std::string> components; // of the path, relative to the root directory
+        };
+
+        // Root directories the path is located in, the most nested ones first
+        std::vector<ContainingRootDirectory> findContainingRootDirectories(Session& session, const std::filesystem::path& path)
+        {
+            std::vector<ContainingRootDirectory> res;
+            for (RootDirectoryInfo& rootDirectory : findRootDirectoryInfos(session))
+            {
+                if (std::optional<std::vector<std::string>> components{ getRelativeComponents(rootDirectory.path, path) })
+                    res.push_back(ContainingRootDirectory{ rootDirectory.id, std::move(*components) });
+            }
+
+            std::sort(std::begin(res), std::end(res), [](const ContainingRootDirectory& lhs, const ContainingRootDirectory& rhs) { return lhs.components.size() < rhs.components.size(); });
+
+            return res;
+        }
+
+        Directory::pointer findRootDirectory(Session& session, const std::filesystem::path& path)
+        {
+            return session.getDboSession().find<Directory>()
+                .where("parent_directory_id IS NULL")
+                .where("name = ?").bind(path.string())
+                .resultValue();
+        }
+
+        Directory::pointer findChildDirectory(Session& session, DirectoryId parentDirectoryId, std::string_view name)
+        {
+            return session.getDboSession().find<Directory>()
+                .where("parent_directory_id = ?").bind(parentDirectoryId)
+                .where("name = ?").bind(name)
+                .resultValue();
+        }
+
+        // invalid id if one of the components is missing
+        DirectoryId findDirectoryId(Session& session, DirectoryId rootDirectoryId, std::span<const std::string> components)
+        {
+            DirectoryId directoryId{ rootDirectoryId };
+            for (const std::string& component : components)
+            {
+                directoryId = session.getDboSession().query<DirectoryId>("SELECT id FROM directory")
+                    .where("parent_directory_id = ?").bind(directoryId)
+                    .where("name = ?").bind(component)
+                    .resultValue();
+
+                if (!directoryId.isValid())
+                    break;
+            }
+
+            return directoryId;
+        }
+    }
+
+    Directory::Directory(std::string_view name, ObjectPtr<Directory> parentDirectory, ObjectPtr<MediaLibrary> mediaLibrary)
+        : _name{ name }
+        , _parentDirectory{ getDboPtr(parentDirectory) }
+        , _mediaLibrary{ getDboPtr(mediaLibrary) }
+    {
+    }
+
+    Directory::pointer Directory::create(Session& session, std::string_view name, ObjectPtr<Directory> parentDirectory, ObjectPtr<MediaLibrary> mediaLibrary)
+    {
+        return session.getDboSession().add(std::unique_ptr<Directory>{ new Directory{ name, parentDirectory, mediaLibrary } });
+    }
+
+    std::size_t Directory::getCount(Session& session)
+    {
+        session.checkReadTransaction();
+
+        return session.getDboSession().query<int>("SELECT COUNT(*) FROM directory");
+    }
+
+    Directory::pointer Directory::find(Session& session, DirectoryId id)
+    {
+        session.checkReadTransaction();
+
+        return Utils::findById<Directory>(session.getDboSession(), id);
+    }
+
+    Directory::pointer Directory::find(Session& session, const std::filesystem::path& path)
+    {
+        session.checkReadTransaction();
+
+        const std::filesystem::path normalizedPath{ normalizePath(path) };
+        for (const ContainingRootDirectory& rootDirectory : findContainingRootDirectories(session, normalizedPath))
+        {
+            if (const DirectoryId directoryId{ findDirectoryId(session, rootDirectory.id, rootDirectory.components) }; directoryId.isValid())
+                return find(session, directoryId);
+        }
+
+        return {};
+    }
+
+    std::vector<DirectoryId> Directory::findIds(Session& session, const std::filesystem::path& path)
+    {
+        session.checkReadTransaction();
+
+        std::vector<DirectoryId> res;
+
+        const std::filesystem::path normalizedPath{ normalizePath(path) };
+        for (const ContainingRootDirectory& rootDirectory : findContainingRootDirectories(session, normalizedPath))
+        {
+            if (const DirectoryId directoryId{ findDirectoryId(session, rootDirectory.id, rootDirectory.components) }; directoryId.isValid())
+                res.push_back(directoryId);
+        }
+
+        return res;
+    }
+
+    std::vector<DirectoryId> Directory::findTreeIds(Session& session, const std::filesystem::path& path)
+    {
+        session.checkReadTransaction();
+
+        std::vector<DirectoryId> res{ findIds(session, path) };
+
+        const std::filesystem::path normalizedPath{ normalizePath(path) };
+        for (const RootDirectoryInfo& rootDirectory : findRootDirectoryInfos(session))
+        {
+            const std::optional<std::vector<std::string>> components{ getRelativeComponents(normalizedPath, rootDirectory.path) };
+            if (components && !components->empty())
+                res.push_back(rootDirectory.id);
+        }
+
+        return res;
+    }
+
+    std::vector<Directory::pointer> Directory::findRootDirectories(Session& session)
+    {
+        session.checkReadTransaction();
+
+        auto results{ session.getDboSession().find<Directory>().where("parent_directory_id IS NULL").resultList() };
+        return std::vector<pointer>(std::cbegin(results), std::cend(results));
+    }
+
+    Directory::pointer Directory::getOrCreate(Session& session, const std::filesystem::path& path, const ObjectPtr<MediaLibrary>& mediaLibrary)
+    {
+        session.checkWriteTransaction();
+
+        const std::filesystem::path normalizedPath{ normalizePath(path) };
+
+        pointer directory;
+        std::vector<std::string> components;
+
+        std::optional<std::vector<std::string>> mediaLibraryComponents;
+        if (mediaLibrary)
+            mediaLibraryComponents = getRelativeComponents(normalizePath(mediaLibrary->getPath()), normalizedPath);
+
+        if (mediaLibraryComponents)
+        {
+            const std::filesystem::path rootPath{ normalizePath(mediaLibrary->getPath()) };
+
+            directory = findRootDirectory(session, rootPath);
+            if (!directory)
+                directory = session.create<Directory>(rootPath.string(), pointer{}, mediaLibrary);
+            else if (directory->getMediaLibrary() != mediaLibrary)
+                directory.modify()->setMediaLibrary(mediaLibrary);
+
+            components = std::move(*mediaLibraryComponents);
+        }
+        else if (std::vector<ContainingRootDirectory> rootDirectories{ findContainingRootDirectories(session, normalizedPath) }; !rootDirectories.empty())
+        {
+            directory = find(session, rootDirectories.front().id);
+            components = std::move(rootDirectories.front().components);
+        }
+        else
+        {
+            // new tree, from the root of the path
+            const std::filesystem::path rootPath{ normalizedPath.root_path() };
+
+            directory = session.create<Directory>(rootPath.string(), pointer{}, ObjectPtr<MediaLibrary>{});
+            components = std::move(*getRelativeComponents(rootPath, normalizedPath));
+        }
+
+        for (const std::string& component : components)
+        {
+            pointer childDirectory{ findChildDirectory(session, directory->getId(), component) };
+            if (!childDirectory)
+                childDirectory = session.create<Directory>(component, directory, mediaLibraryComponents ? mediaLibrary : ObjectPtr<MediaLibrary>{});
+            else if (mediaLibraryComponents && childDirectory->getMediaLibrary() != mediaLibrary)
+                childDirectory.modify()->setMediaLibrary(mediaLibrary);
+
+            directory = childDirectory;
+        }
+
+        return directory;
+    }
+
+    bool Directory::moveRootDirectory(Session& session, const std::filesystem::path& oldPath, const std::filesystem::path& newPath)
+    {
+        session.checkWriteTransaction();
+
+        const std::filesystem::path newRootPath{ normalizePath(newPath) };
+
+        pointer directory{ findRootDirectory(session, normalizePath(oldPath)) };
+        if (!directory || findRootDirectory(session, newRootPath))
+            return false;
+
+        directory.modify()->_name = newRootPath.string();
+        return true;
+    }
+
+    std::size_t Directory::removeOrphans(Session& session)
+    {
+        session.checkWriteTransaction();
+
+        // pending track moves must be taken into account
+        session.getDboSession().flush();
+
+        // removing a directory may make its parent directory orphan
+        std::size_t removedCount{};
+        while (true)
+        {
+            session.getDboSession().execute("DELETE FROM directory"
+                " WHERE NOT EXISTS (SELECT 1 FROM track t WHERE t.directory_id = directory.id)"
+                " AND NOT EXISTS (SELECT 1 FROM directory d WHERE d.parent_directory_id = directory.id)");
+
+            const std::size_t changeCount{ Utils::getChangeCount(session.getDboSession()) };
+            if (changeCount == 0)
+                break;
+
+            removedCount += changeCount;
+        }
+
+        return removedCount;
+    }
+
+    std::filesystem::path Directory::getPath() const
+    {
+        if (!_parentDirectory)
+            return _name;
+
+        return _parentDirectory->getPath() / _name;
+    }
+} // namespace Database
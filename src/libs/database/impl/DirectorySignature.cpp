@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "database/DirectorySignature.hpp"
+
+#include <algorithm>
+#include <tuple>
+
+#include <Wt/Dbo/WtSqlTraits.h>
+
+#include "database/Session.hpp"
+#include "PathTraits.hpp"
+#include "Utils.hpp"
+
+namespace Database
+{
+    void DirectorySignature::visitAll(Session& session, const std::function<void(const Entry& entry)>& func)
+    {
+        using QueryResultType = std::tuple<std::filesystem::path, long long, long long, Wt::WDateTime>;
+        session.checkReadTransaction();
+
+        auto query{ session.getDboSession().query<QueryResultType>("SELECT path, last_write_time, file_count, check_time FROM directory_signature") };
+        Utils::execQuery<QueryResultType>(query, std::nullopt, [&](const QueryResultType& queryResult)
+            {
+                func(Entry{ std::get<0>(queryResult), std::get<1>(queryResult), static_cast<std::size_t>(std::get<2>(queryResult)), std::get<3>(queryResult) });
+            });
+    }
+
+    void DirectorySignature::setAll(Session& session, std::span<const Entry> entries)
+    {
+        session.checkWriteTransaction();
+
+        Wt::Dbo::Session& dboSession{ session.getDboSession() };
+        dboSession.execute("DELETE FROM directory_signature");
+
+        constexpr std::size_t bindCountPerRow{ 4 };
+        constexpr std::size_t maxRowCount{ Utils::maxBindArgCount / bindCountPerRow };
+
+        for (std::size_t offset{}; offset < entries.size(); offset += maxRowCount)
+        {
+            const std::span<const Entry> chunk{ entries.subspan(offset, std::min(maxRowCount, entries.size() - offset)) };
+
+            std::string sql{ "INSERT INTO directory_signature(path, last_write_time, file_count, check_time) VALUES " };
+            for (std::size_t i{}; i < chunk.size(); ++i)
+            {
+                if (i > 0)
+                    sql += ", ";
+                sql += "(?, ?, ?, ?)";
+            }
+
+            auto call{ dboSession.execute(sql) };
+            for (const Entry& entry : chunk)
+            {
+                call.bind(entry.path);
+                call.bind(entry.lastWriteTime);
+                call.bind(static_cast<long long>(entry.fileCount));
+                call.bind(entry.checkTime);
+            }
+            call.run();
+        }
+    }
+}
@@ -0,0 +1,235 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "database/Facet.hpp"
+
+#include "database/Session.hpp"
+#include "utils/ITraceLogger.hpp"
+#include "DirectStatement.hpp"
+#include "IdTypeTraits.hpp"
+#include "StringViewTraits.hpp"
+#include "Utils.hpp"
+
+namespace Database
+{
+    namespace
+    {
+        struct FacetTables
+        {
+            std::string table;      // "genre"
+            std::string linkTable;  // "track_genre"
+            std::string linkColumn; // "genre_id"
+        };
+
+        const FacetTables& getTables(FacetType type)
+        {
+            // indexed by FacetType
+            static const FacetTables tables[]
+            {
+                { "genre", "track_genre", "genre_id" },
+                { "mood", "track_mood", "mood_id" },
+                { "language", "track_language", "language_id" },
+            };
+
+            return tables[static_cast<std::size_t>(type)];
+        }
+
+        constexpr FacetType facetTypes[]{ FacetType::Genre, FacetType::Mood, FacetType::Language };
+
+        // invalid id if not found
+        long long findValueId(Session& session, const FacetTables& tables, std::string_view value)
+        {
+            DirectStatement statement{ session.getDboSession(), "SELECT id FROM " + tables.table + " WHERE name = ?" };
+            statement.bind(std::string{ value, 0, Facet::maxValueLength });
+
+            return statement.nextRow() ? statement.getLongLong(0).value_or(-1) : -1;
+        }
+    }
+
+    void Facet::setTrackValues(Session& session, TrackId track, FacetType type, std::span<const std::string> values)
+    {
+        session.checkWriteTransaction();
+
+        const FacetTables& tables{ getTables(type) };
+        Wt::Dbo::Session& dboSession{ session.getDboSession() };
+
+        dboSession.execute("DELETE FROM " + tables.linkTable + " WHERE track_id = ?").bind(track);
+        for (const std::string& value : values)
+        {
+            const std::string name{ value, 0, maxValueLength };
+
+            dboSession.execute("INSERT INTO " + tables.table + " (name) VALUES (?) ON CONFLICT(name) DO NOTHING").bind(name);
+            // same value may be present several times in the tags
+            dboSession.execute("INSERT OR IGNORE INTO " + tables.linkTable + " (track_id, " + tables.linkColumn + ") SELECT ?, id FROM " + tables.table + " WHERE name = ?")
+                .bind(track)
+                .bind(name);
+        }
+    }
+
+    std::vector<std::string> Facet::getTrackValues(Session& session, TrackId track, FacetType type)
+    {
+        std::vector<std::string> res;
+        getTrackValues(session, std::span{ &track, 1 }, type, [&](TrackId, std::string_view value) { res.emplace_back(value); });
+
+        return res;
+    }
+
+    void Facet::getTrackValues(Session& session, std::span<const TrackId> tracks, FacetType type, std::function<void(TrackId track, std::string_view value)> func)
+    {
+        LMS_SCOPED_TRACE_DETAILED("Database", "GetTrackFacetValues");
+
+        session.checkReadTransaction();
+
+        const FacetTables& tables{ getTables(type) };
+        Utils::forEachBindChunk(tracks, [&](std::span<const TrackId> trackChunk)
+            {
+                // ordered by value id: values created first come first
+                DirectStatement statement{ session.getDboSession(),
+                    "SELECT l.track_id, v.name FROM " + tables.linkTable + " l"
+                    " INNER JOIN " + tables.table + " v ON v.id = l." + tables.linkColumn +
+                    " WHERE l.track_id IN (" + Utils::createBindPlaceholders(trackChunk.size()) + ")"
+                    " ORDER BY l.track_id, v.id" };
+                for (const TrackId track : trackChunk)
+                    statement.bind(track);
+
+                while (statement.nextRow())
+                {
+                    const std::optional<long long> trackId{ statement.getLongLong(0) };
+                    const std::optional<std::string> name{ statement.getString(1) };
+                    if (trackId && name)
+                        func(TrackId{ *trackId }, *name);
+                }
+            });
+    }
+
+    std::vector<std::string> Facet::getReleaseValues(Session& session, ReleaseId release, FacetType type)
+    {
+        LMS_SCOPED_TRACE_DETAILED("Database", "GetReleaseFacetValues");
+
+        session.checkReadTransaction();
+
+        const FacetTables& tables{ getTables(type) };
+        DirectStatement statement{ session.getDboSession(),
+            "SELECT DISTINCT v.name FROM " + tables.table + " v"
+            " INNER JOIN " + tables.linkTable + " l ON l." + tables.linkColumn + " = v.id"
+            " INNER JOIN track t ON t.id = l.track_id"
+            " WHERE t.release_id = ?"
+            " ORDER BY v.name" };
+        statement.bind(release);
+
+        std::vector<std::string> res;
+        while (statement.nextRow())
+        {
+            if (std::optional<std::string> name{ statement.getString(0) })
+                res.push_back(std::move(*name));
+        }
+
+        return res;
+    }
+
+    void Facet::visitAll(Session& session, FacetType type, std::function<void(const Entry& entry)> func)
+    {
+        session.checkReadTransaction();
+
+        const FacetTables& tables{ getTables(type) };
+        DirectStatement statement{ session.getDboSession(), "SELECT name, track_count, release_count FROM " + tables.table + " ORDER BY name" };
+        while (statement.nextRow())
+        {
+            Entry entry;
+            entry.name = statement.getString(0).value_or("");
+            entry.trackCount = static_cast<std::size_t>(statement.getLongLong(1).value_or(0));
+            entry.releaseCount = static_cast<std::size_t>(statement.getLongLong(2).value_or(0));
+
+            func(entry);
+        }
+    }
+
+    RangeResults<TrackId> Facet::findTrackIds(Session& session, FacetType type, std::string_view value, MediaLibraryId mediaLibrary, std::optional<Range> range)
+    {
+        session.checkReadTransaction();
+
+        const FacetTables& tables{ getTables(type) };
+        const long long valueId{ findValueId(session, tables, value) };
+        if (valueId < 0)
+            return {};
+
+        auto query{ session.getDboSession().query<TrackId>("SELECT l.track_id FROM " + tables.linkTable + " l")
+            .where("l." + tables.linkColumn + " = ?").bind(valueId)
+            .orderBy("l.track_id") };
+
+        if (mediaLibrary.isValid())
+            query.where("EXISTS (SELECT 1 FROM track t WHERE t.id = l.track_id AND t.media_library_id = ?)").bind(mediaLibrary);
+
+        return Utils::execQuery<TrackId>(query, range);
+    }
+
+    RangeResults<ReleaseId> Facet::findReleaseIds(Session& session, FacetType type, std::string_view value, MediaLibraryId mediaLibrary, std::optional<Range> range)
+    {
+        session.checkReadTransaction();
+
+        const FacetTables& tables{ getTables(type) };
+        const long long valueId{ findValueId(session, tables, value) };
+        if (valueId < 0)
+            return {};
+
+        std::string linkedTrackCondition{ "EXISTS (SELECT 1 FROM track t INNER JOIN " + tables.linkTable + " l ON l.track_id = t.id"
+            " WHERE t.release_id = r.id AND l." + tables.linkColumn + " = ?" };
+        if (mediaLibrary.isValid())
+            linkedTrackCondition += " AND t.media_library_id = ?";
+        linkedTrackCondition += ")";
+
+        auto query{ session.getDboSession().query<ReleaseId>("SELECT r.id FROM release r")
+            .where(linkedTrackCondition).bind(valueId)
+            .orderBy("r.name_sort_key, r.id") };
+        if (mediaLibrary.isValid())
+            query.bind(mediaLibrary);
+
+        return Utils::execQuery<ReleaseId>(query, range);
+    }
+
+    std::size_t Facet::removeOrphans(Session& session)
+    {
+        session.checkWriteTransaction();
+
+        std::size_t removedCount{};
+        for (const FacetType type : facetTypes)
+        {
+            const FacetTables& tables{ getTables(type) };
+
+            session.getDboSession().execute("DELETE FROM " + tables.table + " WHERE NOT EXISTS (SELECT 1 FROM " + tables.linkTable + " l WHERE l." + tables.linkColumn + " = " + tables.table + ".id)");
+            removedCount += Utils::getChangeCount(session.getDboSession());
+        }
+
+        return removedCount;
+    }
+
+    void Facet::updateCounts(Session& session)
+    {
+        session.checkWriteTransaction();
+
+        for (const FacetType type : facetTypes)
+        {
+            const FacetTables& tables{ getTables(type) };
+
+            session.getDboSession().execute("UPDATE " + tables.table + " SET"
+                " track_count = (SELECT COUNT(*) FROM " + tables.linkTable + " l WHERE l." + tables.linkColumn + " = " + tables.table + ".id),"
+                " release_count = (SELECT COUNT(DISTINCT t.release_id) FROM " + tables.linkTable + " l INNER JOIN track t ON t.id = l.track_id WHERE l." + tables.linkColumn + " = " + tables.table + ".id)");
+        }
+    }
+}
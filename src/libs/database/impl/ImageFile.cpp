@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "database/ImageFile.hpp"
+
+#include <algorithm>
+#include <tuple>
+
+#include "database/Session.hpp"
+#include "PathTraits.hpp"
+#include "Utils.hpp"
+
+namespace Database
+{
+    namespace
+    {
+        using QueryResultType = std::tuple<std::filesystem::path, long long, long long>;
+
+        template<typename Query>
+        void visitEntries(Query& query, const std::function<void(const ImageFile::Entry& entry)>& func)
+        {
+            Utils::execQuery<QueryResultType>(query, std::nullopt, [&](const QueryResultType& queryResult)
+                {
+                    func(ImageFile::Entry{ std::get<0>(queryResult), static_cast<std::size_t>(std::get<1>(queryResult)), std::get<2>(queryResult) });
+                });
+        }
+
+        void addEntries(Wt::Dbo::Session& dboSession, std::span<const ImageFile::Entry> entries)
+        {
+            constexpr std::size_t bindCountPerRow{ 4 };
+            constexpr std::size_t maxRowCount{ Utils::maxBindArgCount / bindCountPerRow };
+
+            for (std::size_t offset{}; offset < entries.size(); offset += maxRowCount)
+            {
+                const std::span<const ImageFile::Entry> chunk{ entries.subspan(offset, std::min(maxRowCount, entries.size() - offset)) };
+
+                std::string sql{ "INSERT OR REPLACE INTO image_file(path, directory, file_size, last_write_time) VALUES " };
+                for (std::size_t i{}; i < chunk.size(); ++i)
+                {
+                    if (i > 0)
+                        sql += ", ";
+                    sql += "(?, ?, ?, ?)";
+                }
+
+                auto call{ dboSession.execute(sql) };
+                for (const ImageFile::Entry& entry : chunk)
+                {
+                    call.bind(entry.path);
+                    call.bind(entry.path.parent_path());
+                    call.bind(static_cast<long long>(entry.fileSize));
+                    call.bind(entry.lastWriteTime);
+                }
+                call.run();
+            }
+        }
+    }
+
+    bool ImageFile::hasAny(Session& session)
+    {
+        session.checkReadTransaction();
+
+        return session.getDboSession().query<int>("SELECT 1 FROM image_file").limit(1).resultValue() == 1;
+    }
+
+    void ImageFile::visitAll(Session& session, const std::function<void(const Entry& entry)>& func)
+    {
+        session.checkReadTransaction();
+
+        auto query{ session.getDboSession().query<QueryResultType>("SELECT path, file_size, last_write_time FROM image_file") };
+        visitEntries(query, func);
+    }
+
+    void ImageFile::visitAllInDirectory(Session& session, const std::filesystem::path& directory, const std::function<void(const Entry& entry)>& func)
+    {
+        session.checkReadTransaction();
+
+        const auto [lowerBound, upperBound] { Utils::getDirectoryPathRange(directory) };
+        auto query{ session.getDboSession().query<QueryResultType>("SELECT path, file_size, last_write_time FROM image_file")
+            .where("path >= ? AND path < ?").bind(lowerBound).bind(upperBound) };
+        visitEntries(query, func);
+    }
+
+    void ImageFile::visitDirectory(Session& session, const std::filesystem::path& directory, const std::function<void(const Entry& entry)>& func)
+    {
+        session.checkReadTransaction();
+
+        auto query{ session.getDboSession().query<QueryResultType>("SELECT path, file_size, last_write_time FROM image_file")
+            .where("directory = ?").bind(directory) };
+        visitEntries(query, func);
+    }
+
+    void ImageFile::setAll(Session& session, std::span<const Entry> entries)
+    {
+        session.checkWriteTransaction();
+
+        Wt::Dbo::Session& dboSession{ session.getDboSession() };
+        dboSession.execute("DELETE FROM image_file");
+        addEntries(dboSession, entries);
+    }
+
+    void ImageFile::setAllInDirectory(Session& session, const std::filesystem::path& directory, std::span<const Entry> entries)
+    {
+        session.checkWriteTransaction();
+
+        const auto [lowerBound, upperBound] { Utils::getDirectoryPathRange(directory) };
+
+        Wt::Dbo::Session& dboSession{ session.getDboSession() };
+        dboSession.execute("DELETE FROM image_file WHERE path >= ? AND path < ?").bind(lowerBound).bind(upperBound);
+        addEntries(dboSession, entries);
+    }
+}
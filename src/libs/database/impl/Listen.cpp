@@ -18,6 +18,9 @@
  */
 
 #include "database/Listen.hpp"
+
+#include <Wt/Dbo/WtSqlTraits.h>
+
 #include "database/Session.hpp"
 #include "database/Track.hpp"
 #include "database/User.hpp"
@@ -29,18 +32,33 @@ namespace Database
 {
     namespace
     {
+        // all time stats, or per month stats if a period is requested
+        std::string getStatsTable(const Listen::StatsFindParameters& params)
+        {
+            return params.period ? "listen_period_stats" : "listen_stats";
+        }
+
+        template <typename ResultType>
+        void applyStatsFilters(Wt::Dbo::Query<ResultType>& query, const Listen::StatsFindParameters& params)
+        {
+            if (params.user.isValid())
+                query.where("l_s.user_id = ?").bind(params.user);
+
+            if (params.backend)
+                query.where("l_s.backend = ?").bind(*params.backend);
+
+            if (params.period)
+                query.where("l_s.period BETWEEN ? AND ?").bind(params.period->begin).bind(params.period->end);
+        }
+
         Wt::Dbo::Query<ArtistId> createArtistsQuery(Wt::Dbo::Session& session, const Listen::ArtistStatsFindParameters& params)
         {
             auto query{ session.query<ArtistId>("SELECT a.id from artist a")
                             .join("track t ON t.id = t_a_l.track_id")
                             .join("track_artist_link t_a_l ON t_a_l.artist_id = a.id")
-                            .join("listen l ON l.track_id = t.id") };
+                            .join(getStatsTable(params) + " l_s ON l_s.track_id = t.id") };
 
-            if (params.user.isValid())
-                query.where("l.user_id = ?").bind(params.user);
-
-            if (params.backend)
-                query.where("l.backend = ?").bind(*params.backend);
+            applyStatsFilters(query, params);
 
             assert(!params.artist.isValid()); // poor check
 
@@ -75,17 +93,13 @@ namespace Database
             return query;
         }
 
-        Wt::Dbo::Query<ReleaseId> createReleasesQuery(Wt::Dbo::Session& session, const Listen::StatsFindParameters& params)
+        Wt::Dbo::Query<ReleaseId> createReleasesQuery(Session& session, const Listen::StatsFindParameters& params)
         {
-            auto query{ session.query<ReleaseId>("SELECT r.id from release r")
+            auto query{ session.getDboSession().query<ReleaseId>("SELECT r.id from release r")
                             .join("track t ON t.release_id = r.id")
-                            .join("listen l ON l.track_id = t.id") };
+                            .join(getStatsTable(params) + " l_s ON l_s.track_id = t.id") };
 
-            if (params.user.isValid())
-                query.where("l.user_id = ?").bind(params.user);
-
-            if (params.backend)
-                query.where("l.backend = ?").bind(*params.backend);
+            applyStatsFilters(query, params);
 
             if (params.artist.isValid())
             {
@@ -96,7 +110,11 @@ namespace Database
             if (params.library.isValid())
                 query.where("t.media_library_id = ?").bind(params.library);
 
-            if (!params.clusters.empty())
+            if (const auto snapshotClause{ Utils::createReleasesInAllClustersClause(session, "r.id", params.clusters) })
+            {
+                query.where(*snapshotClause);
+            }
+            else if (!params.clusters.empty())
             {
                 std::ostringstream oss;
                 oss << "r.id IN (SELECT DISTINCT r.id FROM release r"
@@ -120,16 +138,12 @@ namespace Database
             return query;
         }
 
-        Wt::Dbo::Query<TrackId> createTracksQuery(Wt::Dbo::Session& session, const Listen::StatsFindParameters& params)
+        Wt::Dbo::Query<TrackId> createTracksQuery(Session& session, const Listen::StatsFindParameters& params)
         {
-            auto query{ session.query<TrackId>("SELECT t.id from track t")
-                        .join("listen l ON l.track_id = t.id") };
-
-            if (params.user.isValid())
-                query.where("l.user_id = ?").bind(params.user);
+            auto query{ session.getDboSession().query<TrackId>("SELECT t.id from track t")
+                        .join(getStatsTable(params) + " l_s ON l_s.track_id = t.id") };
 
-            if (params.backend)
-                query.where("l.backend = ?").bind(*params.backend);
+            applyStatsFilters(query, params);
 
             if (params.artist.isValid())
             {
@@ -140,7 +154,11 @@ namespace Database
             if (params.library.isValid())
                 query.where("t.media_library_id = ?").bind(params.library);
 
-            if (!params.clusters.empty())
+            if (const auto snapshotClause{ Utils::createTracksInAllClustersClause(session, "t.id", params.clusters) })
+            {
+                query.where(*snapshotClause);
+            }
+            else if (!params.clusters.empty())
             {
                 std::ostringstream oss;
                 oss << "t.id IN (SELECT DISTINCT t.id FROM track t"
@@ -186,7 +204,7 @@ namespace Database
     Listen::pointer Listen::find(Session& session, ListenId id)
     {
         session.checkReadTransaction();
-        return session.getDboSession().find<Listen>().where("id = ?").bind(id).resultValue();
+        return Utils::findById<Listen>(session.getDboSession(), id);
     }
 
     RangeResults<ListenId> Listen::find(Session& session, const FindParameters& parameters)
@@ -220,13 +238,59 @@ namespace Database
             .resultValue();
     }
 
+    std::size_t Listen::createIfNotExist(Session& session, UserId userId, ScrobblingBackend backend, SyncState syncState, std::span<const TimedTrack> entries)
+    {
+        session.checkWriteTransaction();
+
+        Wt::Dbo::Session& dboSession{ session.getDboSession() };
+        dboSession.flush();
+
+        constexpr std::size_t bindCountPerRow{ 2 };
+        constexpr std::size_t maxRowCount{ Utils::maxBindArgCount / bindCountPerRow };
+
+        std::size_t createdCount{};
+        for (std::size_t offset{}; offset < entries.size(); offset += maxRowCount)
+        {
+            const std::span<const TimedTrack> chunk{ entries.subspan(offset, std::min(maxRowCount, entries.size() - offset)) };
+
+            std::string sql{ "WITH new_listen(track_id, date_time) AS (VALUES " };
+            for (std::size_t i{}; i < chunk.size(); ++i)
+            {
+                if (i > 0)
+                    sql += ", ";
+                sql += "(?, ?)";
+            }
+            sql += ") INSERT INTO listen (version, date_time, backend, sync_state, track_id, user_id)"
+                " SELECT DISTINCT 0, n_l.date_time, ?, ?, n_l.track_id, u.id FROM new_listen n_l"
+                " INNER JOIN track t ON t.id = n_l.track_id"
+                " INNER JOIN user u ON u.id = ?"
+                " WHERE NOT EXISTS (SELECT 1 FROM listen l WHERE l.user_id = u.id AND l.track_id = n_l.track_id AND l.backend = ? AND l.date_time = n_l.date_time)";
+
+            auto call{ dboSession.execute(sql) };
+            for (const TimedTrack& entry : chunk)
+            {
+                call.bind(entry.trackId);
+                call.bind(Wt::WDateTime::fromTime_t(entry.dateTime.toTime_t())); // same precision as the created listens
+            }
+            call.bind(backend);
+            call.bind(syncState);
+            call.bind(userId);
+            call.bind(backend);
+            call.run();
+
+            createdCount += Utils::getChangeCount(dboSession);
+        }
+
+        return createdCount;
+    }
+
     RangeResults<ArtistId> Listen::getTopArtists(Session& session, const ArtistStatsFindParameters& params)
     {
         session.checkReadTransaction();
         auto query{ createArtistsQuery(session.getDboSession(), params) };
 
         auto collection{ query
-            .orderBy("COUNT(a.id) DESC")
+            .orderBy("SUM(l_s.count) DESC")
             .groupBy("a.id") };
 
         return Utils::execQuery<ArtistId>(query, params.range);
@@ -235,8 +299,8 @@ namespace Database
     RangeResults<ReleaseId> Listen::getTopReleases(Session& session, const StatsFindParameters& params)
     {
         session.checkReadTransaction();
-        auto query{ createReleasesQuery(session.getDboSession(), params)
-                        .orderBy("COUNT(r.id) DESC")
+        auto query{ createReleasesQuery(session, params)
+                        .orderBy("SUM(l_s.count) DESC")
                         .groupBy("r.id") };
 
         return Utils::execQuery<ReleaseId>(query, params.range);
@@ -245,9 +309,9 @@ namespace Database
     RangeResults<TrackId> Listen::getTopTracks(Session& session, const StatsFindParameters& params)
     {
         session.checkReadTransaction();
-        auto query{ createTracksQuery(session.getDboSession(), params)
-                        .orderBy("COUNT(t.id) DESC")
-                        .groupBy("t.id") };
+        auto query{ createTracksQuery(session, params)
+                        .orderBy("SUM(l_s.count) DESC")
+                        .groupBy("l_s.track_id") }; // not t.id, so that the stats of the user are range scanned
 
         return Utils::execQuery<TrackId>(query, params.range);
     }
@@ -256,8 +320,8 @@ namespace Database
     {
         session.checkReadTransaction();
         auto query{ createArtistsQuery(session.getDboSession(), params)
-                        .groupBy("a.id").having("l.date_time = MAX(l.date_time)")
-                        .orderBy("l.date_time DESC") };
+                        .groupBy("a.id")
+                        .orderBy("MAX(l_s.last_date_time) DESC") };
 
         return Utils::execQuery<ArtistId>(query, params.range);
     }
@@ -265,9 +329,9 @@ namespace Database
     RangeResults<ReleaseId> Listen::getRecentReleases(Session& session, const StatsFindParameters& params)
     {
         session.checkReadTransaction();
-        auto query{ createReleasesQuery(session.getDboSession(), params)
-                        .groupBy("r.id").having("l.date_time = MAX(l.date_time)")
-                        .orderBy("l.date_time DESC") };
+        auto query{ createReleasesQuery(session, params)
+                        .groupBy("r.id")
+                        .orderBy("MAX(l_s.last_date_time) DESC") };
 
         return Utils::execQuery<ReleaseId>(query, params.range);
     }
@@ -275,9 +339,9 @@ namespace Database
     RangeResults<TrackId> Listen::getRecentTracks(Session& session, const StatsFindParameters& params)
     {
         session.checkReadTransaction();
-        auto query{ createTracksQuery(session.getDboSession(), params)
-                        .groupBy("t.id").having("l.date_time = MAX(l.date_time)")
-                        .orderBy("l.date_time DESC") };
+        auto query{ createTracksQuery(session, params)
+                        .groupBy("l_s.track_id") // not t.id, so that the stats of the user are range scanned
+                        .orderBy("MAX(l_s.last_date_time) DESC") };
 
         return Utils::execQuery<TrackId>(query, params.range);
     }
@@ -286,11 +350,11 @@ namespace Database
     {
         session.checkReadTransaction();
 
-        return session.getDboSession().query<int>("SELECT COUNT(*) from listen l")
-            .join("user u ON u.id = l.user_id")
-            .where("l.track_id = ?").bind(trackId)
-            .where("l.user_id = ?").bind(userId)
-            .where("l.backend = u.scrobbling_backend")
+        return session.getDboSession().query<int>("SELECT COALESCE(SUM(l_s.count), 0) from listen_stats l_s")
+            .join("user u ON u.id = l_s.user_id")
+            .where("l_s.track_id = ?").bind(trackId)
+            .where("l_s.user_id = ?").bind(userId)
+            .where("l_s.backend = u.scrobbling_backend")
             .resultValue();
     }
 
@@ -299,19 +363,47 @@ namespace Database
         session.checkReadTransaction();
 
         return session.getDboSession().query<int>(
-            "SELECT IFNULL(MIN(count_result), 0)"
-            " FROM ("
-            " SELECT COUNT(l.track_id) AS count_result"
+            "SELECT COALESCE(MIN(COALESCE(l_s.count, 0)), 0)"
             " FROM track t"
-            " LEFT JOIN listen l ON t.id = l.track_id AND l.backend = (SELECT scrobbling_backend FROM user WHERE id = ?) AND l.user_id = ?"
-            " WHERE t.release_id = ?"
-            " GROUP BY t.id)")
+            " LEFT JOIN listen_stats l_s ON t.id = l_s.track_id AND l_s.backend = (SELECT scrobbling_backend FROM user WHERE id = ?) AND l_s.user_id = ?"
+            " WHERE t.release_id = ?")
             .bind(userId)
             .bind(userId)
             .bind(releaseId)
             .resultValue();
     }
 
+    void Listen::getTrackStats(Session& session, UserId userId, std::span<const TrackId> tracks, std::function<void(const TrackStats&)> func)
+    {
+        session.checkReadTransaction();
+
+        Utils::forEachBindChunk(tracks, [&](std::span<const TrackId> trackChunk)
+            {
+                auto query{ session.getDboSession().query<std::tuple<TrackId, int, Wt::WDateTime>>("SELECT l_s.track_id, l_s.count, l_s.last_date_time from listen_stats l_s")
+                    .join("user u ON u.id = l_s.user_id")
+                    .where("l_s.user_id = ?").bind(userId)
+                    .where("l_s.backend = u.scrobbling_backend")
+                    .where("l_s.track_id IN (" + Utils::createBindPlaceholders(trackChunk.size()) + ")") };
+                for (const TrackId trackId : trackChunk)
+                    query.bind(trackId);
+
+                for (const auto& [trackId, count, lastListenDateTime] : query.resultList())
+                    func(TrackStats{ trackId, static_cast<std::size_t>(count), lastListenDateTime });
+            });
+    }
+
+    void Listen::getTrackStats(Session& session, UserId userId, ScrobblingBackend backend, std::function<void(const TrackStats&)> func)
+    {
+        session.checkReadTransaction();
+
+        auto query{ session.getDboSession().query<std::tuple<TrackId, int, Wt::WDateTime>>("SELECT track_id, count, last_date_time from listen_stats")
+            .where("user_id = ?").bind(userId)
+            .where("backend = ?").bind(backend) };
+
+        for (const auto& [trackId, count, lastListenDateTime] : query.resultList())
+            func(TrackStats{ trackId, static_cast<std::size_t>(count), lastListenDateTime });
+    }
+
     Listen::pointer Listen::getMostRecentListen(Session& session, UserId userId, ScrobblingBackend backend, ReleaseId releaseId)
     {
         session.checkReadTransaction();
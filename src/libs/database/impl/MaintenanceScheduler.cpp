@@ -0,0 +1,331 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "database/MaintenanceScheduler.hpp"
+
+#include <algorithm>
+#include <string_view>
+#include <vector>
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/post.hpp>
+#include <Wt/WDateTime.h>
+
+#include "database/Db.hpp"
+#include "database/Session.hpp"
+#include "utils/Exception.hpp"
+#include "utils/IConfig.hpp"
+#include "utils/ILogger.hpp"
+#include "utils/IResourceGovernor.hpp"
+#include "utils/Service.hpp"
+#include "Migration.hpp"
+
+namespace Database
+{
+    namespace
+    {
+        // Rows inserted/updated/deleted using the write connection since it has been opened
+        std::uint64_t getTotalChangeCount(Session& session)
+        {
+            session.checkWriteTransaction();
+            return session.getDboSession().query<long long>("SELECT total_changes()").resultValue();
+        }
+
+        // the timestamp makes the backups sorted by name from the oldest to the newest
+        constexpr std::string_view backupFilePrefix{ "lms-" };
+        constexpr std::string_view backupFileExtension{ ".db" };
+
+        bool isBackupFile(const std::filesystem::path& path)
+        {
+            const std::string fileName{ path.filename().string() };
+            return fileName.starts_with(backupFilePrefix) && path.extension() == backupFileExtension;
+        }
+    }
+
+    MaintenanceScheduler::MaintenanceScheduler(boost::asio::io_context& ioContext, Db& db)
+        : _ioContext{ ioContext }
+        , _db{ db }
+        , _checkPeriod{ Service<IConfig>::get()->getULong("db-maintenance-check-period", 60) }
+        , _changeThreshold{ Service<IConfig>::get()->getULong("db-maintenance-change-threshold", 10'000) }
+        , _migrationChunkSize{ std::max<std::size_t>(1, Service<IConfig>::get()->getULong("db-background-migration-chunk-size", 10'000)) }
+        , _vacuumMinFreePageCount{ Service<IConfig>::get()->getULong("db-incremental-vacuum-min-free-pages", 1'000) }
+        , _vacuumStepPageCount{ std::max<std::uint64_t>(1, Service<IConfig>::get()->getULong("db-incremental-vacuum-step-pages", 256)) }
+        , _backupPeriod{ Service<IConfig>::get()->getULong("db-backup-period", 0) }
+        , _backupCount{ std::max<std::size_t>(1, Service<IConfig>::get()->getULong("db-backup-count", 7)) }
+        , _backupDirectory{ Service<IConfig>::get()->getPath("working-dir") / "backups" }
+        , _lastCheckedWriteGeneration{ db.getWriteGeneration() }
+    {
+        boost::asio::post(_strand, [this] { runBackgroundMigrations(); });
+
+        if (_backupPeriod.count() > 0)
+            scheduleBackup(_backupPeriod);
+
+        if (_checkPeriod.count() == 0)
+        {
+            LMS_LOG(DB, INFO, "Database maintenance disabled");
+            return;
+        }
+
+        scheduleCheck(_checkPeriod);
+    }
+
+    MaintenanceScheduler::~MaintenanceScheduler()
+    {
+        _checkTimer.cancel();
+        _migrationTimer.cancel();
+        _backupTimer.cancel();
+    }
+
+    void MaintenanceScheduler::requestAnalyze()
+    {
+        boost::asio::post(_strand, [this] { analyze(); });
+    }
+
+    void MaintenanceScheduler::scheduleCheck(std::chrono::seconds fromNow)
+    {
+        _checkTimer.expires_after(fromNow);
+        _checkTimer.async_wait(boost::asio::bind_executor(_strand, [this](const boost::system::error_code& ec)
+            {
+                if (ec == boost::asio::error::operation_aborted)
+                    return;
+                else if (ec)
+                    throw LmsException{ "Maintenance timer failure: " + std::string{ ec.message() } };
+
+                check();
+                startIncrementalVacuum();
+                scheduleCheck(_checkPeriod);
+            }));
+    }
+
+    void MaintenanceScheduler::check()
+    {
+        // cheap check first, does not require to wait for the write connection
+        if (_db.getWriteGeneration() == _lastCheckedWriteGeneration)
+            return;
+
+        try
+        {
+            Session& session{ _db.getTLSSession() };
+            {
+                auto transaction{ session.createWriteTransaction() };
+
+                const std::uint64_t changeCount{ getTotalChangeCount(session) - _lastOptimizedChangeCount };
+                LMS_LOG(DB, DEBUG, changeCount << " changes made since last optimize");
+                if (changeCount >= _changeThreshold)
+                {
+                    LMS_LOG(DB, INFO, "Optimizing database (" << changeCount << " changes)...");
+                    // 0x10000: consider all the tables, not only the ones used by the queries of the write connection
+                    session.getDboSession().execute("PRAGMA optimize=0x10002");
+                    _lastOptimizedChangeCount = getTotalChangeCount(session);
+                    LMS_LOG(DB, INFO, "Database optimizing complete");
+                }
+            }
+            // our own transaction must not trigger the next check
+            _lastCheckedWriteGeneration = _db.getWriteGeneration();
+        }
+        catch (const Wt::Dbo::Exception& e)
+        {
+            // will retry on next check
+            LMS_LOG(DB, ERROR, "Database optimize failed: " << e.what());
+        }
+    }
+
+    void MaintenanceScheduler::analyze()
+    {
+        try
+        {
+            Session& session{ _db.getTLSSession() };
+
+            LMS_LOG(DB, INFO, "Analyzing database...");
+            {
+                auto transaction{ session.createWriteTransaction() };
+                session.getDboSession().execute("ANALYZE");
+                _lastOptimizedChangeCount = getTotalChangeCount(session);
+            }
+            _lastCheckedWriteGeneration = _db.getWriteGeneration();
+            LMS_LOG(DB, INFO, "Database analyze complete");
+        }
+        catch (const Wt::Dbo::Exception& e)
+        {
+            LMS_LOG(DB, ERROR, "Database analyze failed: " << e.what());
+        }
+    }
+
+    void MaintenanceScheduler::startIncrementalVacuum()
+    {
+        if (_vacuumInProgress || _vacuumMinFreePageCount == 0 || isForegroundBusy())
+            return;
+
+        try
+        {
+            const Db::StorageStats stats{ _db.getStorageStats() };
+            if (!stats.incrementalVacuum || stats.freePageCount < _vacuumMinFreePageCount)
+                return;
+
+            LMS_LOG(DB, INFO, "Releasing " << stats.freePageCount << " free pages (" << (stats.freePageCount * stats.pageSize) / (1024 * 1024) << " MiB)...");
+        }
+        catch (const Wt::Dbo::Exception& e)
+        {
+            LMS_LOG(DB, ERROR, "Cannot get database storage stats: " << e.what());
+            return;
+        }
+
+        _vacuumInProgress = true;
+        incrementalVacuumStep();
+    }
+
+    void MaintenanceScheduler::incrementalVacuumStep()
+    {
+        // stopped while the foreground is busy, resumed on a next check
+        if (isForegroundBusy())
+        {
+            LMS_LOG(DB, DEBUG, "Foreground busy, pausing incremental vacuum");
+            _vacuumInProgress = false;
+            return;
+        }
+
+        try
+        {
+            const std::uint64_t freePageCount{ _db.incrementalVacuum(_vacuumStepPageCount) };
+            if (freePageCount > 0)
+            {
+                // one step at a time, so that the writers can interleave
+                boost::asio::post(_strand, [this] { incrementalVacuumStep(); });
+                return;
+            }
+
+            LMS_LOG(DB, INFO, "Free pages released");
+        }
+        catch (const Wt::Dbo::Exception& e)
+        {
+            LMS_LOG(DB, ERROR, "Incremental vacuum failed: " << e.what());
+        }
+
+        _vacuumInProgress = false;
+    }
+
+    void MaintenanceScheduler::scheduleBackgroundMigrations(std::chrono::seconds fromNow)
+    {
+        _migrationTimer.expires_after(fromNow);
+        _migrationTimer.async_wait(boost::asio::bind_executor(_strand, [this](const boost::system::error_code& ec)
+            {
+                if (ec == boost::asio::error::operation_aborted)
+                    return;
+                else if (ec)
+                    throw LmsException{ "Migration timer failure: " + std::string{ ec.message() } };
+
+                runBackgroundMigrations();
+            }));
+    }
+
+    void MaintenanceScheduler::runBackgroundMigrations()
+    {
+        // not urgent, let the live streams and requests go first
+        if (isForegroundBusy())
+        {
+            scheduleBackgroundMigrations(std::chrono::seconds{ 1 });
+            return;
+        }
+
+        try
+        {
+            // one chunk at a time, so that the other maintenance jobs and the writers can interleave
+            if (Migration::runBackgroundMigrationChunk(_db.getTLSSession(), _migrationChunkSize))
+                boost::asio::post(_strand, [this] { runBackgroundMigrations(); });
+        }
+        catch (const Wt::Dbo::Exception& e)
+        {
+            LMS_LOG(DB, ERROR, "Background migration failed: " << e.what() << ", retrying later");
+            scheduleBackgroundMigrations(std::chrono::seconds{ 60 });
+        }
+    }
+
+    void MaintenanceScheduler::scheduleBackup(std::chrono::seconds fromNow)
+    {
+        _backupTimer.expires_after(fromNow);
+        _backupTimer.async_wait(boost::asio::bind_executor(_strand, [this](const boost::system::error_code& ec)
+            {
+                if (ec == boost::asio::error::operation_aborted)
+                    return;
+                else if (ec)
+                    throw LmsException{ "Backup timer failure: " + std::string{ ec.message() } };
+
+                backup();
+            }));
+    }
+
+    void MaintenanceScheduler::backup()
+    {
+        // The copy reads the whole database: postponed while the foreground is busy
+        if (isForegroundBusy())
+        {
+            LMS_LOG(DB, DEBUG, "Foreground busy, postponing database backup");
+            scheduleBackup(std::chrono::seconds{ 60 });
+            return;
+        }
+
+        const std::uint64_t writeGeneration{ _db.getWriteGeneration() };
+        if (_lastBackupWriteGeneration && *_lastBackupWriteGeneration == writeGeneration)
+        {
+            LMS_LOG(DB, DEBUG, "Database unchanged since last backup, skipping");
+            scheduleBackup(_backupPeriod);
+            return;
+        }
+
+        try
+        {
+            std::filesystem::create_directories(_backupDirectory);
+
+            const std::string timestamp{ Wt::WDateTime::currentDateTime().toString("yyyyMMdd-hhmmss", false).toUTF8() };
+            _db.backup(_backupDirectory / (std::string{ backupFilePrefix } + timestamp + std::string{ backupFileExtension }));
+            _lastBackupWriteGeneration = writeGeneration;
+
+            removeOldBackups();
+        }
+        catch (const Wt::Dbo::Exception& e)
+        {
+            LMS_LOG(DB, ERROR, "Database backup failed: " << e.what());
+        }
+        catch (const std::filesystem::filesystem_error& e)
+        {
+            LMS_LOG(DB, ERROR, "Database backup failed: " << e.what());
+        }
+
+        scheduleBackup(_backupPeriod);
+    }
+
+    void MaintenanceScheduler::removeOldBackups()
+    {
+        std::vector<std::filesystem::path> backupFiles;
+        for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator{ _backupDirectory })
+        {
+            if (entry.is_regular_file() && isBackupFile(entry.path()))
+                backupFiles.push_back(entry.path());
+        }
+
+        if (backupFiles.size() <= _backupCount)
+            return;
+
+        std::sort(std::begin(backupFiles), std::end(backupFiles));
+        for (std::size_t i{}; i < backupFiles.size() - _backupCount; ++i)
+        {
+            LMS_LOG(DB, INFO, "Removing old database backup " << backupFiles[i].string());
+            std::filesystem::remove(backupFiles[i]);
+        }
+    }
+} // namespace Database
@@ -25,6 +25,7 @@
 #include "IdTypeTraits.hpp"
 #include "PathTraits.hpp"
 #include "StringViewTraits.hpp"
+#include "Utils.hpp"
 
 namespace Database
 {
@@ -50,7 +51,7 @@ namespace Database
     {
         session.checkReadTransaction();
 
-        return session.getDboSession().find<MediaLibrary>().where("id = ?").bind(id).resultValue();
+        return Utils::findById<MediaLibrary>(session.getDboSession(), id);
     }
 
     MediaLibrary::pointer MediaLibrary::find(Session& session, std::string_view name)
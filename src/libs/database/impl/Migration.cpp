@@ -19,20 +19,31 @@
 
 #include "Migration.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <tuple>
 #include <Wt/Dbo/WtSqlTraits.h>
 
+#include "database/Artist.hpp"
 #include "database/Db.hpp"
+#include "database/Directory.hpp"
+#include "database/MediaLibrary.hpp"
+#include "database/Release.hpp"
 #include "database/ScanSettings.hpp"
 #include "database/Session.hpp"
+#include "database/TrackList.hpp"
+#include "database/Types.hpp"
 #include "database/User.hpp"
 #include "utils/Exception.hpp"
 #include "utils/ILogger.hpp"
+#include "utils/String.hpp"
 
 namespace Database
 {
     namespace
     {
-        static constexpr Version LMS_DATABASE_VERSION{ 54 };
+        static constexpr Version LMS_DATABASE_VERSION{ 79 };
     }
 
     VersionInfo::VersionInfo()
@@ -81,6 +92,45 @@ namespace Database::Migration
         Db& _db;
     };
 
+    namespace
+    {
+        // Data only migrations, done in the background once the server is started:
+        // the rows of the table are processed by increasing id ranges, each range in its own write transaction
+        // Their readers must cope with the partially migrated data meanwhile
+        struct BackgroundMigration
+        {
+            std::string_view name;
+            std::string_view table;
+            void (*processIdRange)(Session& session, long long firstId, long long lastId);
+        };
+
+        void fillListenPeriodStats(Session& session, long long firstId, long long lastId)
+        {
+            // Recompute the whole stats of the months touched by these listens: the triggers keep on updating the stats meanwhile
+            session.getDboSession().execute("INSERT OR REPLACE INTO listen_period_stats(user_id, backend, period, track_id, count, last_date_time)"
+                " SELECT l.user_id, l.backend, CAST(SUBSTR(l.date_time, 1, 4) || SUBSTR(l.date_time, 6, 2) AS INTEGER) AS period, l.track_id, COUNT(*), MAX(l.date_time)"
+                " FROM (SELECT DISTINCT user_id, backend, track_id, SUBSTR(date_time, 1, 7) AS month FROM listen WHERE id BETWEEN ? AND ?) k"
+                " JOIN listen l ON l.user_id = k.user_id AND l.track_id = k.track_id AND l.backend = k.backend AND SUBSTR(l.date_time, 1, 7) = k.month"
+                " GROUP BY l.user_id, l.backend, period, l.track_id").bind(firstId).bind(lastId);
+        }
+
+        constexpr BackgroundMigration backgroundMigrations[]
+        {
+            {"listen_period_stats", "listen", fillListenPeriodStats},
+        };
+
+        // Only the rows that exist at this time are processed, the newer ones are expected to be handled by the regular code
+        void enqueueBackgroundMigration(Session& session, std::string_view name)
+        {
+            const auto itMigration{ std::find_if(std::cbegin(backgroundMigrations), std::cend(backgroundMigrations), [&](const BackgroundMigration& migration) { return migration.name == name; }) };
+            assert(itMigration != std::cend(backgroundMigrations));
+
+            session.getDboSession().execute("CREATE TABLE IF NOT EXISTS background_migration (name TEXT NOT NULL PRIMARY KEY, next_id INTEGER NOT NULL, last_id INTEGER NOT NULL) WITHOUT ROWID");
+            session.getDboSession().execute("INSERT OR REPLACE INTO background_migration (name, next_id, last_id) SELECT ?, IFNULL(MIN(id), 0), IFNULL(MAX(id), -1) FROM " + std::string{ itMigration->table })
+                .bind(std::string{ name });
+        }
+    }
+
     static void migrateFromV33(Session& session)
     {
         // remove name from track_artist_link
@@ -428,6 +478,359 @@ SELECT
         session.getDboSession().execute("UPDATE scan_settings SET scan_version = scan_version + 1");
     }
 
+    void migrateFromV54(Session& session)
+    {
+        // Full text search indexes for artists, releases and tracks (triggers are created when preparing tables)
+        session.getDboSession().execute("CREATE VIRTUAL TABLE IF NOT EXISTS artist_fts USING fts5(name, sort_name, content='artist', content_rowid='id', tokenize='trigram')");
+        session.getDboSession().execute("CREATE VIRTUAL TABLE IF NOT EXISTS release_fts USING fts5(name, content='release', content_rowid='id', tokenize='trigram')");
+        session.getDboSession().execute("CREATE VIRTUAL TABLE IF NOT EXISTS track_fts USING fts5(name, content='track', content_rowid='id', tokenize='trigram')");
+
+        // Populate from existing content
+        session.getDboSession().execute("INSERT INTO artist_fts(artist_fts) VALUES('rebuild')");
+        session.getDboSession().execute("INSERT INTO release_fts(release_fts) VALUES('rebuild')");
+        session.getDboSession().execute("INSERT INTO track_fts(track_fts) VALUES('rebuild')");
+    }
+
+    void migrateFromV55(Session& session)
+    {
+        // Pre-extracted track features, filled in by the recommendation engine
+        session.getDboSession().execute("ALTER TABLE track_features ADD packed_features BLOB NOT NULL DEFAULT x''");
+        session.getDboSession().execute("ALTER TABLE track_features ADD packed_features_version INTEGER NOT NULL DEFAULT 0");
+    }
+
+    void migrateFromV56(Session& session)
+    {
+        // Per track listen stats (indexes and triggers are created when preparing tables)
+        session.getDboSession().execute("CREATE TABLE IF NOT EXISTS listen_stats (user_id INTEGER NOT NULL REFERENCES user(id) ON DELETE CASCADE, backend INTEGER NOT NULL, track_id INTEGER NOT NULL REFERENCES track(id) ON DELETE CASCADE, count INTEGER NOT NULL, last_date_time TEXT, PRIMARY KEY(user_id, backend, track_id)) WITHOUT ROWID");
+
+        // Populate from existing listens
+        session.getDboSession().execute("INSERT INTO listen_stats(user_id, backend, track_id, count, last_date_time) SELECT user_id, backend, track_id, COUNT(*), MAX(date_time) FROM listen GROUP BY user_id, backend, track_id");
+    }
+
+    void migrateFromV57(Session& session)
+    {
+        // Add file size and content fingerprint, used to detect moved files
+        session.getDboSession().execute("ALTER TABLE track ADD file_size INTEGER NOT NULL DEFAULT 0");
+        session.getDboSession().execute("ALTER TABLE track ADD content_fingerprint INTEGER");
+
+        // Just increment the scan version of the settings to make the next scheduled scan rescan everything
+        session.getDboSession().execute("UPDATE scan_settings SET scan_version = scan_version + 1");
+    }
+
+    void migrateFromV58(Session& session)
+    {
+        // Scan checkpoints, to resume interrupted scans
+        session.getDboSession().execute("ALTER TABLE scan_settings ADD interrupted_scan_version INTEGER");
+        session.getDboSession().execute("ALTER TABLE scan_settings ADD interrupted_scan_force BOOLEAN NOT NULL DEFAULT 0");
+        session.getDboSession().execute("ALTER TABLE media_library ADD scan_checkpoint TEXT NOT NULL DEFAULT ''");
+    }
+
+    void migrateFromV59(Session& session)
+    {
+        // Media directory signatures, saved by the scanner
+        session.getDboSession().execute("CREATE TABLE IF NOT EXISTS directory_signature (path TEXT NOT NULL PRIMARY KEY, last_write_time INTEGER NOT NULL, file_count INTEGER NOT NULL, check_time TEXT) WITHOUT ROWID");
+    }
+
+    void migrateFromV60(Session& session)
+    {
+        // Per library scan settings
+        session.getDboSession().execute("ALTER TABLE media_library ADD scan_thread_count INTEGER NOT NULL DEFAULT 0");
+        session.getDboSession().execute("ALTER TABLE media_library ADD scan_max_files_per_second INTEGER NOT NULL DEFAULT 0");
+        session.getDboSession().execute("ALTER TABLE media_library ADD scan_max_bytes_per_second INTEGER NOT NULL DEFAULT 0");
+    }
+
+    void migrateFromV61(Session& session)
+    {
+        // Media directory image files, indexed by the scanner
+        session.getDboSession().execute("CREATE TABLE IF NOT EXISTS image_file (path TEXT NOT NULL PRIMARY KEY, directory TEXT NOT NULL, file_size INTEGER NOT NULL, last_write_time INTEGER NOT NULL) WITHOUT ROWID");
+    }
+
+    void migrateFromV62(Session& session)
+    {
+        // Estimated durations, refined by the scanner
+        session.getDboSession().execute("ALTER TABLE track ADD duration_estimated BOOLEAN NOT NULL DEFAULT 0");
+    }
+
+    void migrateFromV63(Session& session)
+    {
+        // Loudness analysis of the tracks without ReplayGain tags, done by the scanner
+        session.getDboSession().execute("ALTER TABLE track ADD loudness_analysis_pending BOOLEAN NOT NULL DEFAULT 0");
+        session.getDboSession().execute("UPDATE track SET loudness_analysis_pending = 1 WHERE track_replay_gain IS NULL");
+    }
+
+    void migrateFromV64(Session& session)
+    {
+        // Catalogue change journal (triggers are created when preparing tables), the existing entities are reported as new changes
+        session.getDboSession().execute("CREATE TABLE IF NOT EXISTS catalogue_change (id INTEGER PRIMARY KEY AUTOINCREMENT, entity_type INTEGER NOT NULL, entity_id INTEGER NOT NULL, removed BOOLEAN NOT NULL, UNIQUE(entity_type, entity_id))");
+        session.getDboSession().execute("INSERT INTO catalogue_change(entity_type, entity_id, removed) SELECT 0, id, 0 FROM artist ORDER BY id");
+        session.getDboSession().execute("INSERT INTO catalogue_change(entity_type, entity_id, removed) SELECT 1, id, 0 FROM release ORDER BY id");
+        session.getDboSession().execute("INSERT INTO catalogue_change(entity_type, entity_id, removed) SELECT 2, id, 0 FROM track ORDER BY id");
+    }
+
+    void migrateFromV65(Session& session)
+    {
+        // MBIDs are now stored as 16-byte BLOBs instead of their text form (the existing indexes are kept)
+        // Columns declared as text are fine: SQLite stores BLOB values as they are, whatever the column affinity
+        struct MBIDColumn
+        {
+            std::string_view table;
+            std::string_view column;
+        };
+
+        constexpr MBIDColumn mbidColumns[]
+        {
+            { "artist", "mbid" },
+            { "release", "mbid" },
+            { "release", "group_mbid" },
+            { "track", "mbid" },
+            { "track", "recording_mbid" },
+        };
+
+        for (const MBIDColumn& mbidColumn : mbidColumns)
+        {
+            const std::string table{ mbidColumn.table };
+            const std::string column{ mbidColumn.column };
+
+            using QueryResultType = std::tuple<long long, std::string>;
+            const Wt::Dbo::collection<QueryResultType> queryResults{ session.getDboSession().query<QueryResultType>("SELECT id, " + column + " FROM " + table).where("typeof(" + column + ") = 'text'").resultList() };
+            const std::vector<QueryResultType> entries(queryResults.begin(), queryResults.end()); // not updating the table while iterating it
+
+            for (const QueryResultType& entry : entries)
+            {
+                // invalid values are removed, as they were never reported by the getters
+                const std::optional<UUID> mbid{ UUID::fromString(std::get<std::string>(entry)) };
+                session.getDboSession().execute("UPDATE " + table + " SET " + column + " = ? WHERE id = ?").bind(toMBIDBlob(mbid)).bind(std::get<long long>(entry));
+            }
+        }
+    }
+
+    void migrateFromV66(Session& session)
+    {
+        // Precomputed sort keys, to make alphabetical listings index scans with accent/case insensitive ordering
+        struct SortKeyColumn
+        {
+            std::string_view table;
+            std::string_view sourceColumn;
+            std::string_view sortKeyColumn;
+        };
+
+        constexpr SortKeyColumn sortKeyColumns[]
+        {
+            { "artist", "name", "name_sort_key" },
+            { "artist", "sort_name", "sort_name_sort_key" },
+            { "release", "name", "name_sort_key" },
+            { "track", "name", "name_sort_key" },
+        };
+
+        session.getDboSession().execute("DROP INDEX IF EXISTS artist_name_nocase_idx");
+        session.getDboSession().execute("DROP INDEX IF EXISTS artist_sort_name_nocase_idx");
+        session.getDboSession().execute("DROP INDEX IF EXISTS release_name_nocase_idx");
+        session.getDboSession().execute("DROP INDEX IF EXISTS track_name_nocase_idx");
+
+        for (const SortKeyColumn& sortKeyColumn : sortKeyColumns)
+        {
+            const std::string table{ sortKeyColumn.table };
+            const std::string sourceColumn{ sortKeyColumn.sourceColumn };
+            const std::string column{ sortKeyColumn.sortKeyColumn };
+
+            session.getDboSession().execute("ALTER TABLE " + table + " ADD " + column + " TEXT NOT NULL DEFAULT ''");
+
+            using QueryResultType = std::tuple<long long, std::string>;
+            const Wt::Dbo::collection<QueryResultType> queryResults{ session.getDboSession().query<QueryResultType>("SELECT id, " + sourceColumn + " FROM " + table).resultList() };
+            const std::vector<QueryResultType> entries(queryResults.begin(), queryResults.end()); // not updating the table while iterating it
+
+            for (const QueryResultType& entry : entries)
+                session.getDboSession().execute("UPDATE " + table + " SET " + column + " = ? WHERE id = ?").bind(StringUtils::computeSortKey(std::get<std::string>(entry))).bind(std::get<long long>(entry));
+        }
+    }
+
+    void migrateFromV67(Session& session)
+    {
+        // Audio stream properties, to avoid probing the files on each stream request
+        session.getDboSession().execute("ALTER TABLE track ADD codec TEXT NOT NULL DEFAULT ''");
+        session.getDboSession().execute("ALTER TABLE track ADD container TEXT NOT NULL DEFAULT ''");
+        session.getDboSession().execute("ALTER TABLE track ADD sample_rate INTEGER NOT NULL DEFAULT 0");
+        session.getDboSession().execute("ALTER TABLE track ADD channel_count INTEGER NOT NULL DEFAULT 0");
+        session.getDboSession().execute("ALTER TABLE track ADD audio_stream_index INTEGER");
+
+        // Just increment the scan version of the settings to make the next scheduled scan rescan everything
+        session.getDboSession().execute("UPDATE scan_settings SET scan_version = scan_version + 1");
+    }
+
+    void migrateFromV68(Session& session)
+    {
+        // Cached release and tracklist aggregates, to avoid per object aggregate queries in listings
+        session.getDboSession().execute("ALTER TABLE release ADD track_count INTEGER NOT NULL DEFAULT 0");
+        session.getDboSession().execute("ALTER TABLE release ADD duration BIGINT NOT NULL DEFAULT 0");
+        session.getDboSession().execute("ALTER TABLE release ADD disc_count INTEGER NOT NULL DEFAULT 0");
+        session.getDboSession().execute("ALTER TABLE release ADD last_written TEXT");
+        session.getDboSession().execute("ALTER TABLE release ADD primary_genre TEXT NOT NULL DEFAULT ''");
+        session.getDboSession().execute("ALTER TABLE tracklist ADD track_count INTEGER NOT NULL DEFAULT 0");
+        session.getDboSession().execute("ALTER TABLE tracklist ADD duration BIGINT NOT NULL DEFAULT 0");
+
+        // the release aggregates are computed by migrateFromV70, once all their columns exist
+        TrackList::updateAggregates(session);
+    }
+
+    void migrateFromV69(Session& session)
+    {
+        // Rarely read track information moved to a side table, to keep the track rows narrow
+        session.getDboSession().execute("CREATE TABLE IF NOT EXISTS track_extra (track_id INTEGER NOT NULL PRIMARY KEY REFERENCES track(id) ON DELETE CASCADE, disc_subtitle TEXT NOT NULL DEFAULT '', copyright TEXT NOT NULL DEFAULT '', copyright_url TEXT NOT NULL DEFAULT '')");
+        session.getDboSession().execute("INSERT INTO track_extra (track_id, disc_subtitle, copyright, copyright_url)"
+            " SELECT id, IFNULL(disc_subtitle, ''), IFNULL(copyright, ''), IFNULL(copyright_url, '') FROM track"
+            " WHERE IFNULL(disc_subtitle, '') <> '' OR IFNULL(copyright, '') <> '' OR IFNULL(copyright_url, '') <> ''");
+        session.getDboSession().execute("ALTER TABLE track DROP COLUMN disc_subtitle");
+        session.getDboSession().execute("ALTER TABLE track DROP COLUMN copyright");
+        session.getDboSession().execute("ALTER TABLE track DROP COLUMN copyright_url");
+    }
+
+    void migrateFromV70(Session& session)
+    {
+        // Integer sort dates (YYYYMMDD), so that date sorts and filters can use indexes
+        session.getDboSession().execute("ALTER TABLE track ADD sort_date INTEGER");
+        session.getDboSession().execute("ALTER TABLE track ADD original_sort_date INTEGER");
+        session.getDboSession().execute("ALTER TABLE release ADD sort_date INTEGER");
+        session.getDboSession().execute("ALTER TABLE release ADD original_sort_date INTEGER");
+
+        // dates are stored as 'YYYY-MM-DD'
+        session.getDboSession().execute("UPDATE track SET sort_date = COALESCE(NULLIF(CAST(REPLACE(SUBSTR(date, 1, 10), '-', '') AS INTEGER), 0), year * 10000)");
+        session.getDboSession().execute("UPDATE track SET original_sort_date = COALESCE(NULLIF(CAST(REPLACE(SUBSTR(original_date, 1, 10), '-', '') AS INTEGER), 0), original_year * 10000, sort_date)");
+
+        Release::updateAggregates(session);
+    }
+
+    void migrateFromV71(Session& session)
+    {
+        // Precomputed artist link types, to filter artists by link type without joining their tracks
+        session.getDboSession().execute("ALTER TABLE artist ADD link_types INTEGER NOT NULL DEFAULT 0");
+        session.getDboSession().execute("CREATE TABLE IF NOT EXISTS artist_media_library (media_library_id INTEGER NOT NULL REFERENCES media_library(id) ON DELETE CASCADE, artist_id INTEGER NOT NULL REFERENCES artist(id) ON DELETE CASCADE, link_types INTEGER NOT NULL, PRIMARY KEY(media_library_id, artist_id)) WITHOUT ROWID");
+
+        Artist::updateLinkTypes(session);
+    }
+
+    void migrateFromV72(Session& session)
+    {
+        // Interned link sub types (performer roles), so that link rows only have integer columns
+        session.getDboSession().execute(R"(CREATE TABLE IF NOT EXISTS "track_artist_link_subtype" (
+  "id" integer primary key autoincrement,
+  "version" integer not null,
+  "name" text not null))");
+        session.getDboSession().execute("INSERT INTO track_artist_link_subtype (version, name) SELECT DISTINCT 0, subtype FROM track_artist_link WHERE subtype IS NOT NULL AND subtype <> ''");
+
+        session.getDboSession().execute(R"(
+CREATE TABLE IF NOT EXISTS "track_artist_link_backup" (
+  "id" integer primary key autoincrement,
+  "version" integer not null,
+  "type" integer not null,
+  "subtype_id" bigint,
+  "track_id" bigint,
+  "artist_id" bigint,
+  constraint "fk_track_artist_link_subtype" foreign key ("subtype_id") references "track_artist_link_subtype" ("id") on delete set null deferrable initially deferred,
+  constraint "fk_track_artist_link_track" foreign key ("track_id") references "track" ("id") on delete cascade deferrable initially deferred,
+  constraint "fk_track_artist_link_artist" foreign key ("artist_id") references "artist" ("id") on delete cascade deferrable initially deferred
+))");
+        session.getDboSession().execute("INSERT INTO track_artist_link_backup (id, version, type, subtype_id, track_id, artist_id)"
+            " SELECT t_a_l.id, t_a_l.version, t_a_l.type, t_a_l_s.id, t_a_l.track_id, t_a_l.artist_id FROM track_artist_link t_a_l"
+            " LEFT JOIN track_artist_link_subtype t_a_l_s ON t_a_l_s.name = t_a_l.subtype");
+        session.getDboSession().execute("DROP TABLE track_artist_link");
+        session.getDboSession().execute("ALTER TABLE track_artist_link_backup RENAME TO track_artist_link");
+        // indexes are recreated afterwards, see Session::prepareTables
+    }
+
+    void migrateFromV73(Session& session)
+    {
+        // Per month listen stats, the triggers are created afterwards (see Session::prepareTables)
+        // Filled in background, the listen table may be huge
+        session.getDboSession().execute("CREATE TABLE IF NOT EXISTS listen_period_stats (user_id INTEGER NOT NULL REFERENCES user(id) ON DELETE CASCADE, backend INTEGER NOT NULL, period INTEGER NOT NULL, track_id INTEGER NOT NULL REFERENCES track(id) ON DELETE CASCADE, count INTEGER NOT NULL, last_date_time TEXT, PRIMARY KEY(user_id, backend, period, track_id)) WITHOUT ROWID");
+        enqueueBackgroundMigration(session, "listen_period_stats");
+    }
+
+    void migrateFromV74(Session& session)
+    {
+        // Feedback sync watermark
+        session.getDboSession().execute("ALTER TABLE user ADD listenbrainz_feedbacks_sync_date_time TEXT");
+    }
+
+    void migrateFromV75(Session& session)
+    {
+        // The listen period stats triggers now recompute the stats on delete, so that they are accurate while being filled in background
+        // They are recreated afterwards (see Session::prepareTables)
+        session.getDboSession().execute("DROP TRIGGER IF EXISTS listen_period_stats_delete");
+        session.getDboSession().execute("DROP TRIGGER IF EXISTS listen_period_stats_update");
+    }
+
+    void migrateFromV76(Session& session)
+    {
+        // Track paths stored as a directory tree plus file names
+        session.getDboSession().execute(R"(CREATE TABLE IF NOT EXISTS "directory" (
+  "id" integer primary key autoincrement,
+  "version" integer not null,
+  "name" text not null,
+  "parent_directory_id" bigint,
+  "media_library_id" bigint,
+  constraint "fk_directory_parent_directory" foreign key ("parent_directory_id") references "directory" ("id") on delete cascade deferrable initially deferred,
+  constraint "fk_directory_media_library" foreign key ("media_library_id") references "media_library" ("id") on delete set null deferrable initially deferred
+))");
+        session.getDboSession().execute("ALTER TABLE track ADD directory_id BIGINT REFERENCES directory(id) ON DELETE CASCADE DEFERRABLE INITIALLY DEFERRED");
+        session.getDboSession().execute("ALTER TABLE track ADD file_name TEXT NOT NULL DEFAULT ''");
+
+        using TrackInfo = std::tuple<long long, std::string, std::optional<long long>>;
+        const auto trackInfos{ session.getDboSession().query<TrackInfo>("SELECT id, file_path, media_library_id FROM track").resultList() };
+
+        // most tracks share their directory with other tracks
+        std::map<std::pair<std::filesystem::path, std::optional<long long>>, DirectoryId> directories;
+        for (const TrackInfo& trackInfo : trackInfos)
+        {
+            const std::filesystem::path trackPath{ std::get<std::string>(trackInfo) };
+            const std::optional<long long>& mediaLibraryId{ std::get<std::optional<long long>>(trackInfo) };
+
+            auto itDirectory{ directories.find({ trackPath.parent_path(), mediaLibraryId }) };
+            if (itDirectory == std::cend(directories))
+            {
+                const MediaLibrary::pointer mediaLibrary{ mediaLibraryId ? MediaLibrary::find(session, MediaLibraryId{ *mediaLibraryId }) : MediaLibrary::pointer{} };
+                const DirectoryId directoryId{ Directory::getOrCreate(session, trackPath.parent_path(), mediaLibrary)->getId() };
+                itDirectory = directories.emplace(std::make_pair(trackPath.parent_path(), mediaLibraryId), directoryId).first;
+            }
+
+            session.getDboSession().execute("UPDATE track SET directory_id = ?, file_name = ? WHERE id = ?")
+                .bind(itDirectory->second.getValue())
+                .bind(trackPath.filename().string())
+                .bind(std::get<long long>(trackInfo));
+        }
+
+        session.getDboSession().execute("DROP INDEX IF EXISTS track_path_idx");
+        session.getDboSession().execute("ALTER TABLE track DROP COLUMN file_path");
+    }
+
+    void migrateFromV77(Session& session)
+    {
+        // Dedicated tables for the genres, moods and languages, filled from their clusters (see Facet)
+        // indexes are created afterwards, see Session::prepareTables
+        const std::pair<std::string, std::string> facets[]{ { "genre", "GENRE" }, { "mood", "MOOD" }, { "language", "LANGUAGE" } };
+        for (const auto& [table, clusterTypeName] : facets)
+        {
+            session.getDboSession().execute("CREATE TABLE IF NOT EXISTS " + table + " (id INTEGER PRIMARY KEY, name TEXT NOT NULL UNIQUE, track_count INTEGER NOT NULL DEFAULT 0, release_count INTEGER NOT NULL DEFAULT 0)");
+            session.getDboSession().execute("CREATE TABLE IF NOT EXISTS track_" + table + " (track_id INTEGER NOT NULL REFERENCES track(id) ON DELETE CASCADE, " + table + "_id INTEGER NOT NULL REFERENCES " + table + "(id) ON DELETE CASCADE, PRIMARY KEY(track_id, " + table + "_id)) WITHOUT ROWID");
+
+            session.getDboSession().execute("INSERT OR IGNORE INTO " + table + " (name, track_count, release_count)"
+                " SELECT c.name, c.track_count, c.release_count FROM cluster c"
+                " INNER JOIN cluster_type c_t ON c_t.id = c.cluster_type_id"
+                " WHERE c_t.name = ?").bind(clusterTypeName);
+            session.getDboSession().execute("INSERT OR IGNORE INTO track_" + table + " (track_id, " + table + "_id)"
+                " SELECT t_c.track_id, v.id FROM track_cluster t_c"
+                " INNER JOIN cluster c ON c.id = t_c.cluster_id"
+                " INNER JOIN cluster_type c_t ON c_t.id = c.cluster_type_id"
+                " INNER JOIN " + table + " v ON v.name = c.name"
+                " WHERE c_t.name = ?").bind(clusterTypeName);
+        }
+    }
+
+    void migrateFromV78(Session& session)
+    {
+        // Errors of the last scan, no longer only kept in memory (see ScanError)
+        session.getDboSession().execute("CREATE TABLE IF NOT EXISTS scan_error (id INTEGER PRIMARY KEY, path TEXT NOT NULL, type INTEGER NOT NULL, system_error TEXT NOT NULL)");
+    }
+
     void doDbMigration(Session& session)
     {
         static const std::string outdatedMsg{ "Outdated database, please rebuild it (delete the .db file and restart)" };
@@ -459,6 +862,31 @@ SELECT
             {51, migrateFromV51},
             {52, migrateFromV52},
             {53, migrateFromV53},
+            {54, migrateFromV54},
+            {55, migrateFromV55},
+            {56, migrateFromV56},
+            {57, migrateFromV57},
+            {58, migrateFromV58},
+            {59, migrateFromV59},
+            {60, migrateFromV60},
+            {61, migrateFromV61},
+            {62, migrateFromV62},
+            {63, migrateFromV63},
+            {64, migrateFromV64},
+            {65, migrateFromV65},
+            {66, migrateFromV66},
+            {67, migrateFromV67},
+            {68, migrateFromV68},
+            {69, migrateFromV69},
+            {70, migrateFromV70},
+            {71, migrateFromV71},
+            {72, migrateFromV72},
+            {73, migrateFromV73},
+            {74, migrateFromV74},
+            {75, migrateFromV75},
+            {76, migrateFromV76},
+            {77, migrateFromV77},
+            {78, migrateFromV78},
         };
 
         {
@@ -482,9 +910,11 @@ SELECT
             if (version < migrationFunctions.begin()->first)
                 throw LmsException{ outdatedMsg };
 
+            const Version initialVersion{ version };
             while (version < LMS_DATABASE_VERSION)
             {
-                LMS_LOG(DB, INFO, "Migrating database from version " << version << " to " << version + 1 << "...");
+                LMS_LOG(DB, INFO, "Migrating database from version " << version << " to " << version + 1 << " (step " << (version - initialVersion + 1) << "/" << (LMS_DATABASE_VERSION - initialVersion) << ")...");
+                const auto startTime{ std::chrono::steady_clock::now() };
 
                 auto itMigrationFunc{ migrationFunctions.find(version) };
                 assert(itMigrationFunc != std::cend(migrationFunctions));
@@ -492,8 +922,47 @@ SELECT
 
                 VersionInfo::get(session).modify()->setVersion(++version);
 
-                LMS_LOG(DB, INFO, "Migration complete to version " << version);
+                LMS_LOG(DB, INFO, "Migration complete to version " << version << " in " << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count() << " ms");
             }
         }
     }
+
+    bool runBackgroundMigrationChunk(Session& session, std::size_t rowCount)
+    {
+        assert(rowCount > 0);
+
+        auto transaction{ session.createWriteTransaction() };
+
+        std::string name;
+        long long nextId{};
+        long long lastId{};
+        std::tie(name, nextId, lastId) = session.getDboSession().query<std::tuple<std::string, long long, long long>>("SELECT name, next_id, last_id FROM background_migration").limit(1).resultValue();
+        if (name.empty())
+            return false;
+
+        const auto itMigration{ std::find_if(std::cbegin(backgroundMigrations), std::cend(backgroundMigrations), [&](const BackgroundMigration& migration) { return migration.name == name; }) };
+        if (itMigration == std::cend(backgroundMigrations))
+        {
+            LMS_LOG(DB, WARNING, "Unknown background migration '" << name << "', dropping it");
+            session.getDboSession().execute("DELETE FROM background_migration WHERE name = ?").bind(name);
+            return true;
+        }
+
+        const long long chunkLastId{ std::min(nextId + static_cast<long long>(rowCount) - 1, lastId) };
+        if (nextId <= chunkLastId)
+            itMigration->processIdRange(session, nextId, chunkLastId);
+
+        if (chunkLastId >= lastId)
+        {
+            session.getDboSession().execute("DELETE FROM background_migration WHERE name = ?").bind(name);
+            LMS_LOG(DB, INFO, "Background migration '" << name << "' complete");
+        }
+        else
+        {
+            session.getDboSession().execute("UPDATE background_migration SET next_id = ? WHERE name = ?").bind(chunkLastId + 1).bind(name);
+            LMS_LOG(DB, DEBUG, "Background migration '" << name << "': processed " << itMigration->table << " ids up to " << chunkLastId << "/" << lastId);
+        }
+
+        return true;
+    }
 }
@@ -53,5 +53,8 @@ namespace Database
     namespace Migration
     {
         void doDbMigration(Session& session);
+
+        // Processes the next rows of the pending background migrations, returns false once there is nothing left to do
+        bool runBackgroundMigrationChunk(Session& session, std::size_t rowCount);
     }
 }
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "database/QueryDeadline.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace Database
+{
+    namespace
+    {
+        thread_local std::optional<QueryDeadline> currentDeadline;
+    }
+
+    QueryDeadline::QueryDeadline(Clock::time_point expiry, std::shared_ptr<const std::atomic<bool>> cancelled)
+        : _expiry{ expiry }
+        , _cancelled{ std::move(cancelled) }
+    {
+    }
+
+    QueryDeadline QueryDeadline::narrowedTo(Clock::time_point expiry) const
+    {
+        return QueryDeadline{ std::min(_expiry, expiry), _cancelled };
+    }
+
+    ScopedQueryDeadline::ScopedQueryDeadline(std::optional<QueryDeadline> deadline)
+        : _previousDeadline{ std::exchange(currentDeadline, std::move(deadline)) }
+    {
+    }
+
+    ScopedQueryDeadline::~ScopedQueryDeadline()
+    {
+        currentDeadline = std::move(_previousDeadline);
+    }
+
+    const std::optional<QueryDeadline>& ScopedQueryDeadline::getCurrent()
+    {
+        return currentDeadline;
+    }
+
+    bool ScopedQueryDeadline::isCurrentExceeded()
+    {
+        return currentDeadline && currentDeadline->isExceeded();
+    }
+} // namespace Database
@@ -23,10 +23,12 @@
 
 #include "database/Artist.hpp"
 #include "database/Cluster.hpp"
+#include "database/Directory.hpp"
 #include "database/Session.hpp"
 #include "database/Track.hpp"
 #include "database/User.hpp"
 #include "utils/ILogger.hpp"
+#include "utils/String.hpp"
 #include "SqlQuery.hpp"
 #include "EnumSetTraits.hpp"
 #include "IdTypeTraits.hpp"
@@ -37,6 +39,15 @@ namespace Database
 {
     namespace
     {
+        // keyset pagination is only supported by name based sort methods
+        std::optional<std::string_view> getCursorSortKeyColumn(ReleaseSortMethod sortMethod)
+        {
+            if (sortMethod == ReleaseSortMethod::Name)
+                return "name_sort_key";
+
+            return std::nullopt;
+        }
+
         template <typename ResultType>
         Wt::Dbo::Query<ResultType> createQuery(Session& session, std::string_view itemToSelect, const Release::FindParameters& params)
         {
@@ -44,9 +55,6 @@ namespace Database
 
             if (params.sortMethod == ReleaseSortMethod::ArtistNameThenName
                 || params.sortMethod == ReleaseSortMethod::LastWritten
-                || params.sortMethod == ReleaseSortMethod::Date
-                || params.sortMethod == ReleaseSortMethod::OriginalDate
-                || params.sortMethod == ReleaseSortMethod::OriginalDateDesc
                 || params.writtenAfter.isValid()
                 || params.dateRange
                 || params.artist.isValid()
@@ -71,12 +79,22 @@ namespace Database
 
             if (params.dateRange)
             {
-                query.where("COALESCE(CAST(SUBSTR(t.date, 1, 4) AS INTEGER), t.year) >= ?").bind(params.dateRange->begin);
-                query.where("COALESCE(CAST(SUBSTR(t.date, 1, 4) AS INTEGER), t.year) <= ?").bind(params.dateRange->end);
+                const auto [beginSortDate, endSortDate]{ Utils::getSortDateRange(*params.dateRange) };
+                query.where("t.sort_date >= ?").bind(beginSortDate);
+                query.where("t.sort_date <= ?").bind(endSortDate);
             }
 
-            for (std::string_view keyword : params.keywords)
-                query.where("r.name LIKE ? ESCAPE '" ESCAPE_CHAR_STR "'").bind("%" + Utils::escapeLikeKeyword(keyword) + "%");
+            const bool useFullTextSearch{ Utils::canUseFullTextSearch(params.keywords) };
+            if (useFullTextSearch)
+            {
+                query.join("release_fts ON release_fts.rowid = r.id")
+                    .where("release_fts MATCH ?").bind(Utils::createFullTextSearchQuery(params.keywords));
+            }
+            else
+            {
+                for (std::string_view keyword : params.keywords)
+                    query.where("r.name LIKE ? ESCAPE '" ESCAPE_CHAR_STR "'").bind("%" + Utils::escapeLikeKeyword(keyword) + "%");
+            }
 
             if (params.starringUser.isValid())
             {
@@ -142,6 +160,10 @@ namespace Database
                 query.join("track_cluster t_c ON t_c.track_id = t.id")
                     .where("t_c.cluster_id = ?").bind(params.clusters.front());
             }
+            else if (const auto snapshotClause{ Utils::createReleasesInAllClustersClause(session, "r.id", params.clusters) })
+            {
+                query.where(*snapshotClause);
+            }
             else if (params.clusters.size() > 1)
             {
                 std::ostringstream oss;
@@ -162,30 +184,38 @@ namespace Database
                 query.where(oss.str());
             }
 
+            if (params.cursor)
+            {
+                assert(getCursorSortKeyColumn(params.sortMethod));
+                Utils::applyCursor(query, "r." + std::string{ *getCursorSortKeyColumn(params.sortMethod) }, "r.id", *params.cursor);
+            }
+
             switch (params.sortMethod)
             {
             case ReleaseSortMethod::None:
+                if (useFullTextSearch)
+                    query.orderBy("release_fts.rank");
                 break;
             case ReleaseSortMethod::Name:
-                query.orderBy("r.name COLLATE NOCASE");
+                query.orderBy("r.name_sort_key, r.id");
                 break;
             case ReleaseSortMethod::ArtistNameThenName:
-                query.orderBy("a.name COLLATE NOCASE, r.name COLLATE NOCASE");
+                query.orderBy("a.name_sort_key, r.name_sort_key");
                 break;
             case ReleaseSortMethod::Random:
-                query.orderBy("RANDOM()");
+                // results are sampled afterwards, see Utils::execRandomQuery
                 break;
             case ReleaseSortMethod::LastWritten:
                 query.orderBy("t.file_last_write DESC");
                 break;
             case ReleaseSortMethod::Date:
-                query.orderBy("COALESCE(t.date, CAST(t.year AS TEXT)), r.name COLLATE NOCASE");
+                query.orderBy("r.sort_date, r.name_sort_key");
                 break;
             case ReleaseSortMethod::OriginalDate:
-                query.orderBy("COALESCE(original_date, CAST(original_year AS TEXT), date, CAST(year AS TEXT)), r.name COLLATE NOCASE");
+                query.orderBy("r.original_sort_date, r.name_sort_key");
                 break;
             case ReleaseSortMethod::OriginalDateDesc:
-                query.orderBy("COALESCE(original_date, CAST(original_year AS TEXT), date, CAST(year AS TEXT)) DESC, r.name COLLATE NOCASE");
+                query.orderBy("r.original_sort_date DESC, r.name_sort_key");
                 break;
             case ReleaseSortMethod::StarredDateDesc:
                 assert(params.starringUser.isValid());
@@ -211,10 +241,7 @@ namespace Database
     {
         session.checkReadTransaction();
 
-        return session.getDboSession()
-            .find<ReleaseType>()
-            .where("id = ?").bind(id)
-            .resultValue();
+        return Utils::findById<ReleaseType>(session.getDboSession(), id);
     }
 
     ReleaseType::pointer ReleaseType::find(Session& session, std::string_view name)
@@ -229,7 +256,8 @@ namespace Database
 
     Release::Release(const std::string& name, const std::optional<UUID>& MBID)
         : _name{ std::string(name, 0 , _maxNameLength) },
-        _MBID{ MBID ? MBID->getAsString() : "" }
+        _nameSortKey{ StringUtils::computeSortKey(_name) },
+        _MBID{ toMBIDBlob(MBID) }
     {
     }
 
@@ -242,12 +270,19 @@ namespace Database
     {
         session.checkReadTransaction();
 
-        auto res{ session.getDboSession()
+        const std::vector<DirectoryId> directoryIds{ Directory::findTreeIds(session, releaseDirectory) };
+        if (directoryIds.empty())
+            return {};
+
+        auto query{ session.getDboSession()
                             .query<Wt::Dbo::ptr<Release>>("SELECT DISTINCT r from release r")
                             .join("track t ON t.release_id = r.id")
                             .where("r.name = ?").bind(std::string(name, 0, _maxNameLength))
-                            .where("t.file_path LIKE ? ESCAPE '" ESCAPE_CHAR_STR "'").bind(Utils::escapeLikeKeyword(releaseDirectory.string()) + "%")
-                            .resultList() };
+                            .where(Utils::createDirectoryTreeCondition("t.directory_id", directoryIds.size())) };
+        for (const DirectoryId directoryId : directoryIds)
+            query.bind(directoryId);
+
+        auto res{ query.resultList() };
 
         return std::vector<Release::pointer>(res.begin(), res.end());
     }
@@ -258,18 +293,51 @@ namespace Database
 
         return session.getDboSession()
             .find<Release>()
-            .where("mbid = ?").bind(std::string{ mbid.getAsString() })
+            .where("mbid = ?").bind(toMBIDBlob(mbid))
             .resultValue();;
     }
 
+    std::vector<Release::pointer> Release::findByMBIDs(Session& session, std::span<const UUID> mbids)
+    {
+        session.checkReadTransaction();
+
+        std::vector<Release::pointer> res;
+        Utils::forEachBindChunk(mbids, [&](std::span<const UUID> mbidChunk)
+            {
+                auto query{ session.getDboSession().find<Release>().where("mbid IN (" + Utils::createBindPlaceholders(mbidChunk.size()) + ")") };
+                for (const UUID& mbid : mbidChunk)
+                    query.bind(toMBIDBlob(mbid));
+
+                for (const Wt::Dbo::ptr<Release>& release : query.resultList())
+                    res.push_back(release);
+            });
+
+        return res;
+    }
+
     Release::pointer Release::find(Session& session, ReleaseId id)
     {
         session.checkReadTransaction();
 
-        return session.getDboSession()
-            .find<Release>()
-            .where("id = ?").bind(id)
-            .resultValue();
+        return Utils::findById<Release>(session.getDboSession(), id);
+    }
+
+    std::vector<Release::pointer> Release::find(Session& session, std::span<const ReleaseId> ids)
+    {
+        session.checkReadTransaction();
+
+        std::vector<Release::pointer> res;
+        Utils::forEachBindChunk(ids, [&](std::span<const ReleaseId> idChunk)
+            {
+                auto query{ session.getDboSession().find<Release>().where("id IN (" + Utils::createBindPlaceholders(idChunk.size()) + ")") };
+                for (const ReleaseId id : idChunk)
+                    query.bind(id);
+
+                for (const Wt::Dbo::ptr<Release>& release : query.resultList())
+                    res.push_back(release);
+            });
+
+        return res;
     }
 
     bool Release::exists(Session& session, ReleaseId id)
@@ -293,20 +361,109 @@ namespace Database
         return Utils::execQuery<ReleaseId>(query, range);
     }
 
+    void Release::findNames(Session& session, std::function<void(ReleaseId, std::string_view name)> func)
+    {
+        using QueryResultType = std::tuple<ReleaseId, std::string>;
+        session.checkReadTransaction();
+
+        auto query{ session.getDboSession().query<QueryResultType>("SELECT id, name FROM release").orderBy("name_sort_key, id") };
+        Utils::execQuery<QueryResultType>(query, std::nullopt, [&](const QueryResultType& queryResult)
+            {
+                func(std::get<0>(queryResult), std::get<1>(queryResult));
+            });
+    }
+
+    std::size_t Release::removeOrphans(Session& session)
+    {
+        session.checkWriteTransaction();
+
+        Wt::Dbo::Session& dboSession{ session.getDboSession() };
+        dboSession.flush();
+        dboSession.execute("DELETE FROM release WHERE NOT EXISTS (SELECT 1 FROM track t WHERE t.release_id = release.id)");
+        const std::size_t removedCount{ Utils::getChangeCount(dboSession) };
+
+        // Loaded releases may have been removed
+        dboSession.rereadAll("release");
+
+        return removedCount;
+    }
+
+    void Release::updateAggregates(Session& session)
+    {
+        session.checkWriteTransaction();
+
+        Wt::Dbo::Session& dboSession{ session.getDboSession() };
+        dboSession.flush();
+
+        // Only write the releases whose aggregates actually changed
+        dboSession.execute(
+            "UPDATE release SET track_count = stats.track_count, duration = stats.duration, disc_count = stats.disc_count, last_written = stats.last_written, sort_date = stats.sort_date, original_sort_date = stats.original_sort_date"
+            " FROM (SELECT t.release_id AS release_id, COUNT(t.id) AS track_count, COALESCE(SUM(t.duration), 0) AS duration, COUNT(DISTINCT t.disc_number) AS disc_count, MAX(t.file_last_write) AS last_written, MIN(t.sort_date) AS sort_date, MIN(t.original_sort_date) AS original_sort_date"
+                " FROM track t WHERE t.release_id IS NOT NULL"
+                " GROUP BY t.release_id) AS stats"
+            " WHERE release.id = stats.release_id"
+                " AND (release.track_count IS NOT stats.track_count OR release.duration IS NOT stats.duration OR release.disc_count IS NOT stats.disc_count OR release.last_written IS NOT stats.last_written"
+                    " OR release.sort_date IS NOT stats.sort_date OR release.original_sort_date IS NOT stats.original_sort_date)");
+
+        dboSession.execute(
+            "UPDATE release SET track_count = 0, duration = 0, disc_count = 0, last_written = NULL, sort_date = NULL, original_sort_date = NULL"
+            " WHERE track_count <> 0 AND NOT EXISTS (SELECT 1 FROM track t WHERE t.release_id = release.id)");
+
+        // Same ordering as getClusterGroups: most used genre first
+        dboSession.execute(
+            "UPDATE release SET primary_genre = genre.name"
+            " FROM (SELECT release_id, name FROM"
+                " (SELECT t.release_id AS release_id, c.name AS name, ROW_NUMBER() OVER (PARTITION BY t.release_id ORDER BY COUNT(c.id) DESC, c.id) AS genre_rank"
+                    " FROM track t"
+                    " INNER JOIN track_cluster t_c ON t_c.track_id = t.id"
+                    " INNER JOIN cluster c ON c.id = t_c.cluster_id"
+                    " INNER JOIN cluster_type c_type ON c_type.id = c.cluster_type_id"
+                    " WHERE t.release_id IS NOT NULL AND c_type.name = 'GENRE'"
+                    " GROUP BY t.release_id, c.id)"
+                " WHERE genre_rank = 1) AS genre"
+            " WHERE release.id = genre.release_id AND release.primary_genre IS NOT genre.name");
+
+        dboSession.execute(
+            "UPDATE release SET primary_genre = ''"
+            " WHERE primary_genre <> '' AND NOT EXISTS (SELECT 1 FROM track t"
+                " INNER JOIN track_cluster t_c ON t_c.track_id = t.id"
+                " INNER JOIN cluster c ON c.id = t_c.cluster_id"
+                " INNER JOIN cluster_type c_type ON c_type.id = c.cluster_type_id"
+                " WHERE t.release_id = release.id AND c_type.name = 'GENRE')");
+
+        // Loaded releases are now outdated
+        dboSession.rereadAll("release");
+    }
+
     RangeResults<Release::pointer> Release::find(Session& session, const FindParameters& params)
     {
         session.checkReadTransaction();
 
+        // only load the picked releases
+        if (params.sortMethod == ReleaseSortMethod::Random)
+            return Utils::findByIds<Release>(session.getDboSession(), findIds(session, params));
+
         auto query{ createQuery<Wt::Dbo::ptr<Release>>(session, "DISTINCT r", params) };
-        return Utils::execQuery<pointer>(query, params.range);
+        RangeResults<pointer> res{ Utils::execQuery<pointer>(query, params.range, params.cursor) };
+        if (const auto sortKeyColumn{ getCursorSortKeyColumn(params.sortMethod) })
+            Utils::setNextCursor(session.getDboSession(), res, "release", *sortKeyColumn);
+
+        return res;
     }
 
     void Release::find(Session& session, const FindParameters& params, std::function<void(const pointer&)> func)
     {
         session.checkReadTransaction();
 
+        if (params.sortMethod == ReleaseSortMethod::Random)
+        {
+            for (const pointer& release : find(session, params).results)
+                func(release);
+            return;
+        }
+
         auto query{ createQuery<Wt::Dbo::ptr<Release>>(session, "DISTINCT r", params) };
-        Utils::execQuery<pointer>(query, params.range, func);
+        Utils::execQuery<pointer>(query, params.range, params.cursor, func);
     }
 
     RangeResults<ReleaseId> Release::findIds(Session& session, const FindParameters& params)
@@ -314,7 +471,14 @@ namespace Database
         session.checkReadTransaction();
 
         auto query{ createQuery<ReleaseId>(session, "DISTINCT r.id", params) };
-        return Utils::execQuery<ReleaseId>(query, params.range);
+        if (params.sortMethod == ReleaseSortMethod::Random)
+            return Utils::execRandomQuery<ReleaseId>(query, params.range);
+
+        RangeResults<ReleaseId> res{ Utils::execQuery<ReleaseId>(query, params.range, params.cursor) };
+        if (const auto sortKeyColumn{ getCursorSortKeyColumn(params.sortMethod) })
+            Utils::setNextCursor(session.getDboSession(), res, "release", *sortKeyColumn);
+
+        return res;
     }
 
     std::size_t Release::getCount(Session& session, const FindParameters& params)
@@ -324,25 +488,13 @@ namespace Database
         return createQuery<int>(session, "COUNT(DISTINCT r.id)", params).resultValue();
     }
 
-    std::size_t Release::getDiscCount() const
-    {
-        assert(session());
-        int res{ session()->query<int>("SELECT COUNT(DISTINCT disc_number) FROM track t")
-            .join("release r ON r.id = t.release_id")
-            .where("r.id = ?")
-            .bind(getId()) };
-
-        return res;
-    }
-
     std::vector<DiscInfo> Release::getDiscs() const
     {
         assert(session());
         using ResultType = std::tuple<int, std::string>;
-        auto results{ session()->query<ResultType>("SELECT DISTINCT disc_number, disc_subtitle FROM track t")
-            .join("release r ON r.id = t.release_id")
-            .where("r.id = ?")
-            .orderBy("disc_number")
+        auto results{ session()->query<ResultType>("SELECT DISTINCT t.disc_number, COALESCE(t_e.disc_subtitle, '') FROM track t LEFT JOIN track_extra t_e ON t_e.track_id = t.id")
+            .where("t.release_id = ?")
+            .orderBy("t.disc_number")
             .bind(getId())
             .resultList() };
 
@@ -417,9 +569,8 @@ namespace Database
         assert(session());
 
         Wt::Dbo::collection<std::string> copyrights = session()->query<std::string>
-            ("SELECT copyright FROM track t INNER JOIN release r ON r.id = t.release_id")
-            .where("r.id = ?")
-            .groupBy("copyright")
+            ("SELECT DISTINCT COALESCE(t_e.copyright, '') FROM track t LEFT JOIN track_extra t_e ON t_e.track_id = t.id")
+            .where("t.release_id = ?")
             .bind(getId());
 
         std::vector<std::string> values(copyrights.begin(), copyrights.end());
@@ -436,9 +587,8 @@ namespace Database
         assert(session());
 
         Wt::Dbo::collection<std::string> copyrights = session()->query<std::string>
-            ("SELECT copyright_url FROM track t INNER JOIN release r ON r.id = t.release_id")
-            .where("r.id = ?").bind(getId())
-            .groupBy("copyright_url");
+            ("SELECT DISTINCT COALESCE(t_e.copyright_url, '') FROM track t LEFT JOIN track_extra t_e ON t_e.track_id = t.id")
+            .where("t.release_id = ?").bind(getId());
 
         std::vector<std::string> values(copyrights.begin(), copyrights.end());
 
@@ -504,6 +654,12 @@ namespace Database
         return std::vector<pointer>(res.begin(), res.end());
     }
 
+    void Release::setName(std::string_view name)
+    {
+        _name = name;
+        _nameSortKey = StringUtils::computeSortKey(_name);
+    }
+
     void Release::clearReleaseTypes()
     {
         _releaseTypes.clear();
@@ -520,11 +676,6 @@ namespace Database
         return getArtists().size() > 1;
     }
 
-    std::size_t Release::getTracksCount() const
-    {
-        return _tracks.size();
-    }
-
     std::vector<ObjectPtr<ReleaseType>> Release::getReleaseTypes() const
     {
         return std::vector<ObjectPtr<ReleaseType>>(_releaseTypes.begin(), _releaseTypes.end());
@@ -540,28 +691,6 @@ namespace Database
         return res;
     }
 
-    std::chrono::milliseconds Release::getDuration() const
-    {
-        assert(session());
-
-        using milli = std::chrono::duration<int, std::milli>;
-
-        Wt::Dbo::Query<milli> query{ session()->query<milli>("SELECT COALESCE(SUM(duration), 0) FROM track t INNER JOIN release r ON t.release_id = r.id")
-                .where("r.id = ?").bind(getId()) };
-
-        return query.resultValue();
-    }
-
-    Wt::WDateTime Release::getLastWritten() const
-    {
-        assert(session());
-
-        Wt::Dbo::Query<Wt::WDateTime> query{ session()->query<Wt::WDateTime>("SELECT COALESCE(MAX(file_last_write), '1970-01-01T00:00:00') FROM track t INNER JOIN release r ON t.release_id = r.id")
-                .where("r.id = ?").bind(getId()) };
-
-        return query.resultValue();
-    }
-
     std::vector<std::vector<Cluster::pointer>> Release::getClusterGroups(const std::vector<ClusterTypeId>& clusterTypeIds, std::size_t size) const
     {
         assert(session());
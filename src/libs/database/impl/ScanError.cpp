@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "database/ScanError.hpp"
+
+#include <algorithm>
+#include <tuple>
+
+#include "database/Session.hpp"
+#include "PathTraits.hpp"
+#include "Utils.hpp"
+
+namespace Database
+{
+    void ScanError::add(Session& session, std::span<const Entry> entries)
+    {
+        session.checkWriteTransaction();
+
+        Wt::Dbo::Session& dboSession{ session.getDboSession() };
+
+        constexpr std::size_t bindCountPerRow{ 3 };
+        constexpr std::size_t maxRowCount{ Utils::maxBindArgCount / bindCountPerRow };
+
+        for (std::size_t offset{}; offset < entries.size(); offset += maxRowCount)
+        {
+            const std::span<const Entry> chunk{ entries.subspan(offset, std::min(maxRowCount, entries.size() - offset)) };
+
+            std::string sql{ "INSERT INTO scan_error(path, type, system_error) VALUES " };
+            for (std::size_t i{}; i < chunk.size(); ++i)
+            {
+                if (i > 0)
+                    sql += ", ";
+                sql += "(?, ?, ?)";
+            }
+
+            auto call{ dboSession.execute(sql) };
+            for (const Entry& entry : chunk)
+            {
+                call.bind(entry.path);
+                call.bind(entry.type);
+                call.bind(entry.systemError);
+            }
+            call.run();
+        }
+    }
+
+    void ScanError::clear(Session& session)
+    {
+        session.checkWriteTransaction();
+
+        session.getDboSession().execute("DELETE FROM scan_error");
+    }
+
+    std::size_t ScanError::getCount(Session& session)
+    {
+        session.checkReadTransaction();
+
+        return session.getDboSession().query<int>("SELECT COUNT(*) FROM scan_error");
+    }
+
+    void ScanError::find(Session& session, std::optional<Range> range, const std::function<void(const Entry& entry)>& func)
+    {
+        using QueryResultType = std::tuple<std::filesystem::path, int, std::string>;
+        session.checkReadTransaction();
+
+        auto query{ session.getDboSession().query<QueryResultType>("SELECT path, type, system_error FROM scan_error").orderBy("id") };
+        Utils::execQuery<QueryResultType>(query, range, [&](const QueryResultType& queryResult)
+            {
+                func(Entry{ std::get<0>(queryResult), std::get<1>(queryResult), std::get<2>(queryResult) });
+            });
+    }
+}
@@ -70,6 +70,14 @@ namespace Database
         return StringUtils::splitEscapedStrings(_defaultTagDelimiters, ';', '\\');
     }
 
+    std::optional<std::size_t> ScanSettings::getInterruptedScanVersion() const
+    {
+        if (!_interruptedScanVersion)
+            return std::nullopt;
+
+        return static_cast<std::size_t>(*_interruptedScanVersion);
+    }
+
     void ScanSettings::setExtraTagsToScan(const std::vector<std::string_view>& extraTags)
     {
         std::string newTagsToScan{ StringUtils::joinStrings(extraTags, ";") };
@@ -23,11 +23,14 @@
 
 #include "utils/Exception.hpp"
 #include "utils/ILogger.hpp"
+#include "utils/IMetricsRegistry.hpp"
 
 #include "database/Artist.hpp"
 #include "database/AuthToken.hpp"
+#include "database/CatalogueChange.hpp"
 #include "database/Cluster.hpp"
 #include "database/Db.hpp"
+#include "database/Directory.hpp"
 #include "database/Listen.hpp"
 #include "database/MediaLibrary.hpp"
 #include "database/Release.hpp"
@@ -48,27 +51,81 @@
 
 namespace Database
 {
+    namespace
+    {
+        thread_local std::size_t transactionDepth{};
+    }
+
+    TransactionDurationRecorder::TransactionDurationRecorder(Metrics::Histogram* histogram)
+        : _histogram{ transactionDepth++ == 0 ? histogram : nullptr }
+        , _startTime{ _histogram ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{} }
+    {
+    }
+
+    TransactionDurationRecorder::~TransactionDurationRecorder()
+    {
+        --transactionDepth;
+        if (_histogram)
+            _histogram->observe(std::chrono::steady_clock::now() - _startTime);
+    }
+
+    WriteTransaction::EndNotifier::~EndNotifier()
+    {
+        db.onWriteTransactionEnded(transactionDepth == 0); // the duration recorder has already been destroyed
+    }
 
-    WriteTransaction::WriteTransaction(RecursiveSharedMutex& mutex, Wt::Dbo::Session& session)
-        : _lock{ mutex },
-        _transaction{ session }
+    WriteTransaction::WriteTransaction(Db& db, Wt::Dbo::Session& session)
+        : _endNotifier{ db }
+        , _durationRecorder{ db._writeTransactionDurationHistogram }
+        , _trace{ Tracing::Level::Overview, "Database", "WriteTransaction" }
+        , _transaction{ session }
     {
+        if (transactionDepth == 1)
+            db.onOutermostTransactionStarting(session);
+
         TransactionChecker::pushWriteTransaction(_transaction.session());
+
+        // Dbo starts the SQL transaction on the first statement: force it now to start it as immediate, on the write connection
+        // No effect if the transaction is already started (nested transactions)
+        Db::setWriteTransactionStarting(true);
+        try
+        {
+            _transaction.session().execute("SELECT 1");
+        }
+        catch (...)
+        {
+            Db::setWriteTransactionStarting(false);
+            TransactionChecker::popWriteTransaction(_transaction.session());
+            throw;
+        }
+        Db::setWriteTransactionStarting(false);
     }
 
     WriteTransaction::~WriteTransaction()
     {
+        if (transactionDepth == 1)
+            _endNotifier.db.onOutermostTransactionEnding();
+
         TransactionChecker::popWriteTransaction(_transaction.session());
     }
 
-    ReadTransaction::ReadTransaction(Wt::Dbo::Session& session)
-        : _transaction{ session }
+    ReadTransaction::ReadTransaction(Db& db, Wt::Dbo::Session& session)
+        : _db{ db }
+        , _durationRecorder{ db._readTransactionDurationHistogram }
+        , _trace{ Tracing::Level::Overview, "Database", "ReadTransaction" }
+        , _transaction{ session }
     {
+        if (transactionDepth == 1)
+            db.onOutermostTransactionStarting(session);
+
         TransactionChecker::pushReadTransaction(_transaction.session());
     }
 
     ReadTransaction::~ReadTransaction()
     {
+        if (transactionDepth == 1)
+            _db.onOutermostTransactionEnding();
+
         TransactionChecker::popReadTransaction(_transaction.session());
     }
 
@@ -82,6 +139,7 @@ namespace Database
         _session.mapClass<AuthToken>("auth_token");
         _session.mapClass<Cluster>("cluster");
         _session.mapClass<ClusterType>("cluster_type");
+        _session.mapClass<Directory>("directory");
         _session.mapClass<Listen>("listen");
         _session.mapClass<MediaLibrary>("media_library");
         _session.mapClass<Release>("release");
@@ -93,6 +151,7 @@ namespace Database
         _session.mapClass<Track>("track");
         _session.mapClass<TrackBookmark>("track_bookmark");
         _session.mapClass<TrackArtistLink>("track_artist_link");
+        _session.mapClass<TrackArtistLinkSubType>("track_artist_link_subtype");
         _session.mapClass<TrackFeatures>("track_features");
         _session.mapClass<TrackList>("tracklist");
         _session.mapClass<TrackListEntry>("tracklist_entry");
@@ -101,12 +160,22 @@ namespace Database
 
     WriteTransaction Session::createWriteTransaction()
     {
-        return WriteTransaction{ _db.getMutex(), _session };
+        return WriteTransaction{ _db, _session };
     }
 
     ReadTransaction Session::createReadTransaction()
     {
-        return ReadTransaction{ _session };
+        return ReadTransaction{ _db, _session };
+    }
+
+    std::uint64_t Session::getExecutedStatementCount() const
+    {
+        return Db::getExecutedStatementCount();
+    }
+
+    std::size_t Session::getLoadedObjectCount() const
+    {
+        return LoadedObjectCounter::get();
     }
 
     void Session::prepareTables()
@@ -116,6 +185,7 @@ namespace Database
         // Initial creation case
         try
         {
+            auto transaction{ createWriteTransaction() };
             _session.createTables();
             LMS_LOG(DB, INFO, "Tables created");
         }
@@ -135,7 +205,8 @@ namespace Database
         {
             auto transaction{ createWriteTransaction() };
             _session.execute("CREATE INDEX IF NOT EXISTS artist_name_idx ON artist(name)");
-            _session.execute("CREATE INDEX IF NOT EXISTS artist_sort_name_nocase_idx ON artist(sort_name COLLATE NOCASE)");
+            _session.execute("CREATE INDEX IF NOT EXISTS artist_name_sort_key_idx ON artist(name_sort_key)");
+            _session.execute("CREATE INDEX IF NOT EXISTS artist_sort_name_sort_key_idx ON artist(sort_name_sort_key)");
             _session.execute("CREATE INDEX IF NOT EXISTS artist_mbid_idx ON artist(mbid)");
             _session.execute("CREATE INDEX IF NOT EXISTS auth_token_user_idx ON auth_token(user_id)");
             _session.execute("CREATE INDEX IF NOT EXISTS auth_token_expiry_idx ON auth_token(expiry)");
@@ -143,43 +214,222 @@ namespace Database
             _session.execute("CREATE INDEX IF NOT EXISTS cluster_name_idx ON cluster(name)");
             _session.execute("CREATE INDEX IF NOT EXISTS cluster_cluster_type_idx ON cluster(cluster_type_id)");
             _session.execute("CREATE INDEX IF NOT EXISTS cluster_type_name_idx ON cluster_type(name)");
+            _session.execute("CREATE UNIQUE INDEX IF NOT EXISTS directory_parent_name_idx ON directory(parent_directory_id, name)");
+            _session.execute("CREATE UNIQUE INDEX IF NOT EXISTS directory_root_name_idx ON directory(name) WHERE parent_directory_id IS NULL");
+            _session.execute("CREATE INDEX IF NOT EXISTS directory_media_library_idx ON directory(media_library_id)");
             _session.execute("CREATE INDEX IF NOT EXISTS release_name_idx ON release(name)");
-            _session.execute("CREATE INDEX IF NOT EXISTS release_name_nocase_idx ON release(name COLLATE NOCASE)");
+            _session.execute("CREATE INDEX IF NOT EXISTS release_name_sort_key_idx ON release(name_sort_key)");
             _session.execute("CREATE INDEX IF NOT EXISTS release_mbid_idx ON release(mbid)");
+            _session.execute("CREATE INDEX IF NOT EXISTS release_sort_date_idx ON release(sort_date, name_sort_key)");
+            _session.execute("CREATE INDEX IF NOT EXISTS release_original_sort_date_idx ON release(original_sort_date, name_sort_key)");
+            _session.execute("CREATE INDEX IF NOT EXISTS release_original_sort_date_desc_idx ON release(original_sort_date DESC, name_sort_key)");
             _session.execute("CREATE INDEX IF NOT EXISTS release_type_name_idx ON release_type(name)");
-            _session.execute("CREATE INDEX IF NOT EXISTS track_path_idx ON track(file_path)");
+            _session.execute("CREATE INDEX IF NOT EXISTS track_directory_file_name_idx ON track(directory_id, file_name)");
             _session.execute("CREATE INDEX IF NOT EXISTS track_name_idx ON track(name)");
-            _session.execute("CREATE INDEX IF NOT EXISTS track_name_nocase_idx ON track(name COLLATE NOCASE)");
+            _session.execute("CREATE INDEX IF NOT EXISTS track_name_sort_key_idx ON track(name_sort_key)");
             _session.execute("CREATE INDEX IF NOT EXISTS track_mbid_idx ON track(mbid)");
             _session.execute("CREATE INDEX IF NOT EXISTS track_recording_mbid_idx ON track(recording_mbid)");
             _session.execute("CREATE INDEX IF NOT EXISTS track_release_idx ON track(release_id)");
+            _session.execute("CREATE INDEX IF NOT EXISTS track_release_disc_number_track_number_idx ON track(release_id,disc_number,track_number)");
             _session.execute("CREATE INDEX IF NOT EXISTS track_file_last_write_idx ON track(file_last_write)");
             _session.execute("CREATE INDEX IF NOT EXISTS track_date_idx ON track(date)");
             _session.execute("CREATE INDEX IF NOT EXISTS track_year_idx ON track(year)");
             _session.execute("CREATE INDEX IF NOT EXISTS track_original_date_idx ON track(original_date)");
             _session.execute("CREATE INDEX IF NOT EXISTS track_original_year_idx ON track(original_year)");
+            _session.execute("CREATE INDEX IF NOT EXISTS track_sort_date_idx ON track(sort_date DESC, release_id, disc_number, track_number)");
             _session.execute("CREATE INDEX IF NOT EXISTS track_media_library_idx ON track(media_library_id)");
+            _session.execute("CREATE INDEX IF NOT EXISTS track_duration_estimated_idx ON track(id) WHERE duration_estimated <> 0");
+            _session.execute("CREATE INDEX IF NOT EXISTS track_loudness_analysis_pending_idx ON track(id) WHERE loudness_analysis_pending <> 0");
             _session.execute("CREATE INDEX IF NOT EXISTS tracklist_name_idx ON tracklist(name)");
             _session.execute("CREATE INDEX IF NOT EXISTS tracklist_user_idx ON tracklist(user_id)");
+            _session.execute("CREATE INDEX IF NOT EXISTS tracklist_entry_tracklist_idx ON tracklist_entry(tracklist_id)");
+            _session.execute("CREATE INDEX IF NOT EXISTS tracklist_entry_track_idx ON tracklist_entry(track_id)");
             _session.execute("CREATE INDEX IF NOT EXISTS track_features_track_idx ON track_features(track_id)");
             _session.execute("CREATE INDEX IF NOT EXISTS track_artist_link_artist_idx ON track_artist_link(artist_id)");
             _session.execute("CREATE INDEX IF NOT EXISTS track_artist_link_track_idx ON track_artist_link(track_id)");
             _session.execute("CREATE INDEX IF NOT EXISTS track_artist_link_type_idx ON track_artist_link(type)");
             _session.execute("CREATE INDEX IF NOT EXISTS track_artist_link_artist_type_idx ON track_artist_link(artist_id,type)");
+            _session.execute("CREATE INDEX IF NOT EXISTS track_artist_link_subtype_idx ON track_artist_link(subtype_id)");
+            _session.execute("CREATE UNIQUE INDEX IF NOT EXISTS track_artist_link_subtype_name_idx ON track_artist_link_subtype(name)");
             _session.execute("CREATE INDEX IF NOT EXISTS track_bookmark_user_idx ON track_bookmark(user_id)");
             _session.execute("CREATE INDEX IF NOT EXISTS track_bookmark_user_track_idx ON track_bookmark(user_id,track_id)");
             _session.execute("CREATE INDEX IF NOT EXISTS listen_backend_idx ON listen(backend)");
             _session.execute("CREATE INDEX IF NOT EXISTS listen_user_backend_idx ON listen(user_id,backend)");
             _session.execute("CREATE INDEX IF NOT EXISTS listen_track_user_backend_idx ON listen(track_id,user_id,backend)");
             _session.execute("CREATE INDEX IF NOT EXISTS listen_user_track_backend_date_time_idx ON listen(user_id,track_id,backend,date_time)");
+            _session.execute("CREATE INDEX IF NOT EXISTS listen_user_backend_sync_state_date_time_idx ON listen(user_id,backend,sync_state,date_time)");
             _session.execute("CREATE INDEX IF NOT EXISTS starred_artist_user_backend_idx ON starred_artist(user_id,backend)");
+            _session.execute("CREATE INDEX IF NOT EXISTS starred_artist_user_backend_date_time_idx ON starred_artist(user_id,backend,date_time)");
             _session.execute("CREATE INDEX IF NOT EXISTS starred_artist_artist_user_backend_idx ON starred_artist(artist_id,user_id,backend)");
             _session.execute("CREATE INDEX IF NOT EXISTS starred_release_user_backend_idx ON starred_release(user_id,backend)");
+            _session.execute("CREATE INDEX IF NOT EXISTS starred_release_user_backend_date_time_idx ON starred_release(user_id,backend,date_time)");
             _session.execute("CREATE INDEX IF NOT EXISTS starred_release_release_user_backend_idx ON starred_release(release_id,user_id,backend)");
             _session.execute("CREATE INDEX IF NOT EXISTS starred_track_user_backend_idx ON starred_track(user_id,backend)");
+            _session.execute("CREATE INDEX IF NOT EXISTS starred_track_user_backend_date_time_idx ON starred_track(user_id,backend,date_time)");
             _session.execute("CREATE INDEX IF NOT EXISTS starred_track_track_user_backend_idx ON starred_track(track_id,user_id,backend)");
         }
 
+        // Rarely read track information, kept out of the track table (see Track::ExtraInfo)
+        {
+            auto transaction{ createWriteTransaction() };
+            _session.execute("CREATE TABLE IF NOT EXISTS track_extra (track_id INTEGER NOT NULL PRIMARY KEY REFERENCES track(id) ON DELETE CASCADE, disc_subtitle TEXT NOT NULL DEFAULT '', copyright TEXT NOT NULL DEFAULT '', copyright_url TEXT NOT NULL DEFAULT '')");
+        }
+
+        // Similarities precomputed by the scanner
+        {
+            auto transaction{ createWriteTransaction() };
+            _session.execute("CREATE TABLE IF NOT EXISTS release_similarity (release_id INTEGER NOT NULL REFERENCES release(id) ON DELETE CASCADE, similar_release_id INTEGER NOT NULL REFERENCES release(id) ON DELETE CASCADE, score INTEGER NOT NULL, PRIMARY KEY(release_id, similar_release_id)) WITHOUT ROWID");
+            _session.execute("CREATE TABLE IF NOT EXISTS artist_similarity (artist_id INTEGER NOT NULL REFERENCES artist(id) ON DELETE CASCADE, type INTEGER NOT NULL, similar_artist_id INTEGER NOT NULL REFERENCES artist(id) ON DELETE CASCADE, score INTEGER NOT NULL, PRIMARY KEY(artist_id, type, similar_artist_id)) WITHOUT ROWID");
+            _session.execute("CREATE TABLE IF NOT EXISTS track_similarity (track_id INTEGER NOT NULL REFERENCES track(id) ON DELETE CASCADE, similar_track_id INTEGER NOT NULL REFERENCES track(id) ON DELETE CASCADE, score INTEGER NOT NULL, PRIMARY KEY(track_id, similar_track_id)) WITHOUT ROWID");
+            // needed by the cascaded deletes
+            _session.execute("CREATE INDEX IF NOT EXISTS release_similarity_similar_release_idx ON release_similarity(similar_release_id)");
+            _session.execute("CREATE INDEX IF NOT EXISTS artist_similarity_similar_artist_idx ON artist_similarity(similar_artist_id)");
+            _session.execute("CREATE INDEX IF NOT EXISTS track_similarity_similar_track_idx ON track_similarity(similar_track_id)");
+        }
+
+        // Per track listen stats, kept in sync by triggers
+        {
+            auto transaction{ createWriteTransaction() };
+            _session.execute("CREATE TABLE IF NOT EXISTS listen_stats (user_id INTEGER NOT NULL REFERENCES user(id) ON DELETE CASCADE, backend INTEGER NOT NULL, track_id INTEGER NOT NULL REFERENCES track(id) ON DELETE CASCADE, count INTEGER NOT NULL, last_date_time TEXT, PRIMARY KEY(user_id, backend, track_id)) WITHOUT ROWID");
+            _session.execute("CREATE INDEX IF NOT EXISTS listen_stats_user_backend_count_idx ON listen_stats(user_id, backend, count)");
+            _session.execute("CREATE INDEX IF NOT EXISTS listen_stats_user_backend_last_date_time_idx ON listen_stats(user_id, backend, last_date_time)");
+            _session.execute("CREATE INDEX IF NOT EXISTS listen_stats_track_idx ON listen_stats(track_id)");
+
+            _session.execute("CREATE TRIGGER IF NOT EXISTS listen_stats_insert AFTER INSERT ON listen BEGIN"
+                " INSERT INTO listen_stats(user_id, backend, track_id, count, last_date_time) VALUES (new.user_id, new.backend, new.track_id, 1, new.date_time)"
+                " ON CONFLICT(user_id, backend, track_id) DO UPDATE SET count = count + 1, last_date_time = MAX(last_date_time, excluded.last_date_time);"
+                " END");
+            _session.execute("CREATE TRIGGER IF NOT EXISTS listen_stats_delete AFTER DELETE ON listen BEGIN"
+                " UPDATE listen_stats SET count = count - 1, last_date_time = (SELECT MAX(date_time) FROM listen WHERE user_id = old.user_id AND track_id = old.track_id AND backend = old.backend)"
+                " WHERE user_id = old.user_id AND backend = old.backend AND track_id = old.track_id;"
+                " DELETE FROM listen_stats WHERE user_id = old.user_id AND backend = old.backend AND track_id = old.track_id AND count <= 0;"
+                " END");
+            _session.execute("CREATE TRIGGER IF NOT EXISTS listen_stats_update AFTER UPDATE OF user_id, backend, track_id, date_time ON listen BEGIN"
+                " UPDATE listen_stats SET count = count - 1, last_date_time = (SELECT MAX(date_time) FROM listen WHERE user_id = old.user_id AND track_id = old.track_id AND backend = old.backend)"
+                " WHERE user_id = old.user_id AND backend = old.backend AND track_id = old.track_id;"
+                " DELETE FROM listen_stats WHERE user_id = old.user_id AND backend = old.backend AND track_id = old.track_id AND count <= 0;"
+                " INSERT INTO listen_stats(user_id, backend, track_id, count, last_date_time) VALUES (new.user_id, new.backend, new.track_id, 1, new.date_time)"
+                " ON CONFLICT(user_id, backend, track_id) DO UPDATE SET count = count + 1, last_date_time = MAX(last_date_time, excluded.last_date_time);"
+                " END");
+        }
+
+        // Per media library artist link types, see Artist::updateLinkTypes
+        {
+            auto transaction{ createWriteTransaction() };
+            _session.execute("CREATE TABLE IF NOT EXISTS artist_media_library (media_library_id INTEGER NOT NULL REFERENCES media_library(id) ON DELETE CASCADE, artist_id INTEGER NOT NULL REFERENCES artist(id) ON DELETE CASCADE, link_types INTEGER NOT NULL, PRIMARY KEY(media_library_id, artist_id)) WITHOUT ROWID");
+            // needed by the cascaded deletes
+            _session.execute("CREATE INDEX IF NOT EXISTS artist_media_library_artist_idx ON artist_media_library(artist_id)");
+        }
+
+        // Per month listen stats, kept in sync by triggers, so that the period stats only read the requested months
+        {
+            auto transaction{ createWriteTransaction() };
+            _session.execute("CREATE TABLE IF NOT EXISTS listen_period_stats (user_id INTEGER NOT NULL REFERENCES user(id) ON DELETE CASCADE, backend INTEGER NOT NULL, period INTEGER NOT NULL, track_id INTEGER NOT NULL REFERENCES track(id) ON DELETE CASCADE, count INTEGER NOT NULL, last_date_time TEXT, PRIMARY KEY(user_id, backend, period, track_id)) WITHOUT ROWID");
+            _session.execute("CREATE INDEX IF NOT EXISTS listen_period_stats_track_idx ON listen_period_stats(track_id)");
+
+            // period is YYYYMM, listen date times are stored as 'YYYY-MM-DD...'
+            // On delete, the stats of the month are recomputed, as they may not be complete yet (see migrateFromV73)
+            _session.execute("CREATE TRIGGER IF NOT EXISTS listen_period_stats_insert AFTER INSERT ON listen BEGIN"
+                " INSERT INTO listen_period_stats(user_id, backend, period, track_id, count, last_date_time) VALUES (new.user_id, new.backend, CAST(SUBSTR(new.date_time, 1, 4) || SUBSTR(new.date_time, 6, 2) AS INTEGER), new.track_id, 1, new.date_time)"
+                " ON CONFLICT(user_id, backend, period, track_id) DO UPDATE SET count = count + 1, last_date_time = MAX(last_date_time, excluded.last_date_time);"
+                " END");
+            _session.execute("CREATE TRIGGER IF NOT EXISTS listen_period_stats_delete AFTER DELETE ON listen BEGIN"
+                " UPDATE listen_period_stats SET (count, last_date_time) = (SELECT COUNT(*), MAX(date_time) FROM listen WHERE user_id = old.user_id AND track_id = old.track_id AND backend = old.backend AND SUBSTR(date_time, 1, 7) = SUBSTR(old.date_time, 1, 7))"
+                " WHERE user_id = old.user_id AND backend = old.backend AND period = CAST(SUBSTR(old.date_time, 1, 4) || SUBSTR(old.date_time, 6, 2) AS INTEGER) AND track_id = old.track_id;"
+                " DELETE FROM listen_period_stats WHERE user_id = old.user_id AND backend = old.backend AND period = CAST(SUBSTR(old.date_time, 1, 4) || SUBSTR(old.date_time, 6, 2) AS INTEGER) AND track_id = old.track_id AND count <= 0;"
+                " END");
+            _session.execute("CREATE TRIGGER IF NOT EXISTS listen_period_stats_update AFTER UPDATE OF user_id, backend, track_id, date_time ON listen BEGIN"
+                " UPDATE listen_period_stats SET (count, last_date_time) = (SELECT COUNT(*), MAX(date_time) FROM listen WHERE user_id = old.user_id AND track_id = old.track_id AND backend = old.backend AND SUBSTR(date_time, 1, 7) = SUBSTR(old.date_time, 1, 7))"
+                " WHERE user_id = old.user_id AND backend = old.backend AND period = CAST(SUBSTR(old.date_time, 1, 4) || SUBSTR(old.date_time, 6, 2) AS INTEGER) AND track_id = old.track_id;"
+                " DELETE FROM listen_period_stats WHERE user_id = old.user_id AND backend = old.backend AND period = CAST(SUBSTR(old.date_time, 1, 4) || SUBSTR(old.date_time, 6, 2) AS INTEGER) AND track_id = old.track_id AND count <= 0;"
+                " INSERT INTO listen_period_stats(user_id, backend, period, track_id, count, last_date_time) VALUES (new.user_id, new.backend, CAST(SUBSTR(new.date_time, 1, 4) || SUBSTR(new.date_time, 6, 2) AS INTEGER), new.track_id, 1, new.date_time)"
+                " ON CONFLICT(user_id, backend, period, track_id) DO UPDATE SET count = count + 1, last_date_time = MAX(last_date_time, excluded.last_date_time);"
+                " END");
+        }
+
+        // Data migrations done in background, see Migration::runBackgroundMigrationChunk
+        {
+            auto transaction{ createWriteTransaction() };
+            _session.execute("CREATE TABLE IF NOT EXISTS background_migration (name TEXT NOT NULL PRIMARY KEY, next_id INTEGER NOT NULL, last_id INTEGER NOT NULL) WITHOUT ROWID");
+        }
+
+        // Media directory signatures, saved by the scanner
+        {
+            auto transaction{ createWriteTransaction() };
+            _session.execute("CREATE TABLE IF NOT EXISTS directory_signature (path TEXT NOT NULL PRIMARY KEY, last_write_time INTEGER NOT NULL, file_count INTEGER NOT NULL, check_time TEXT) WITHOUT ROWID");
+        }
+
+        // Errors of the last scan, see ScanError
+        {
+            auto transaction{ createWriteTransaction() };
+            _session.execute("CREATE TABLE IF NOT EXISTS scan_error (id INTEGER PRIMARY KEY, path TEXT NOT NULL, type INTEGER NOT NULL, system_error TEXT NOT NULL)");
+        }
+
+        // Media directory image files, indexed by the scanner
+        {
+            auto transaction{ createWriteTransaction() };
+            _session.execute("CREATE TABLE IF NOT EXISTS image_file (path TEXT NOT NULL PRIMARY KEY, directory TEXT NOT NULL, file_size INTEGER NOT NULL, last_write_time INTEGER NOT NULL) WITHOUT ROWID");
+            _session.execute("CREATE INDEX IF NOT EXISTS image_file_directory_idx ON image_file(directory)");
+        }
+
+        // Genres, moods and languages, see Facet
+        {
+            auto transaction{ createWriteTransaction() };
+            _session.execute("CREATE TABLE IF NOT EXISTS genre (id INTEGER PRIMARY KEY, name TEXT NOT NULL UNIQUE, track_count INTEGER NOT NULL DEFAULT 0, release_count INTEGER NOT NULL DEFAULT 0)");
+            _session.execute("CREATE TABLE IF NOT EXISTS track_genre (track_id INTEGER NOT NULL REFERENCES track(id) ON DELETE CASCADE, genre_id INTEGER NOT NULL REFERENCES genre(id) ON DELETE CASCADE, PRIMARY KEY(track_id, genre_id)) WITHOUT ROWID");
+            _session.execute("CREATE INDEX IF NOT EXISTS track_genre_genre_idx ON track_genre(genre_id, track_id)");
+            _session.execute("CREATE TABLE IF NOT EXISTS mood (id INTEGER PRIMARY KEY, name TEXT NOT NULL UNIQUE, track_count INTEGER NOT NULL DEFAULT 0, release_count INTEGER NOT NULL DEFAULT 0)");
+            _session.execute("CREATE TABLE IF NOT EXISTS track_mood (track_id INTEGER NOT NULL REFERENCES track(id) ON DELETE CASCADE, mood_id INTEGER NOT NULL REFERENCES mood(id) ON DELETE CASCADE, PRIMARY KEY(track_id, mood_id)) WITHOUT ROWID");
+            _session.execute("CREATE INDEX IF NOT EXISTS track_mood_mood_idx ON track_mood(mood_id, track_id)");
+            _session.execute("CREATE TABLE IF NOT EXISTS language (id INTEGER PRIMARY KEY, name TEXT NOT NULL UNIQUE, track_count INTEGER NOT NULL DEFAULT 0, release_count INTEGER NOT NULL DEFAULT 0)");
+            _session.execute("CREATE TABLE IF NOT EXISTS track_language (track_id INTEGER NOT NULL REFERENCES track(id) ON DELETE CASCADE, language_id INTEGER NOT NULL REFERENCES language(id) ON DELETE CASCADE, PRIMARY KEY(track_id, language_id)) WITHOUT ROWID");
+            _session.execute("CREATE INDEX IF NOT EXISTS track_language_language_idx ON track_language(language_id, track_id)");
+        }
+
+        // Full text search indexes, kept in sync by triggers
+        {
+            auto transaction{ createWriteTransaction() };
+            _session.execute("CREATE VIRTUAL TABLE IF NOT EXISTS artist_fts USING fts5(name, sort_name, content='artist', content_rowid='id', tokenize='trigram')");
+            _session.execute("CREATE VIRTUAL TABLE IF NOT EXISTS release_fts USING fts5(name, content='release', content_rowid='id', tokenize='trigram')");
+            _session.execute("CREATE VIRTUAL TABLE IF NOT EXISTS track_fts USING fts5(name, content='track', content_rowid='id', tokenize='trigram')");
+
+            _session.execute("CREATE TRIGGER IF NOT EXISTS artist_fts_insert AFTER INSERT ON artist BEGIN INSERT INTO artist_fts(rowid, name, sort_name) VALUES (new.id, new.name, new.sort_name); END");
+            _session.execute("CREATE TRIGGER IF NOT EXISTS artist_fts_delete AFTER DELETE ON artist BEGIN INSERT INTO artist_fts(artist_fts, rowid, name, sort_name) VALUES ('delete', old.id, old.name, old.sort_name); END");
+            _session.execute("CREATE TRIGGER IF NOT EXISTS artist_fts_update AFTER UPDATE OF name, sort_name ON artist BEGIN INSERT INTO artist_fts(artist_fts, rowid, name, sort_name) VALUES ('delete', old.id, old.name, old.sort_name); INSERT INTO artist_fts(rowid, name, sort_name) VALUES (new.id, new.name, new.sort_name); END");
+            _session.execute("CREATE TRIGGER IF NOT EXISTS release_fts_insert AFTER INSERT ON release BEGIN INSERT INTO release_fts(rowid, name) VALUES (new.id, new.name); END");
+            _session.execute("CREATE TRIGGER IF NOT EXISTS release_fts_delete AFTER DELETE ON release BEGIN INSERT INTO release_fts(release_fts, rowid, name) VALUES ('delete', old.id, old.name); END");
+            _session.execute("CREATE TRIGGER IF NOT EXISTS release_fts_update AFTER UPDATE OF name ON release BEGIN INSERT INTO release_fts(release_fts, rowid, name) VALUES ('delete', old.id, old.name); INSERT INTO release_fts(rowid, name) VALUES (new.id, new.name); END");
+            _session.execute("CREATE TRIGGER IF NOT EXISTS track_fts_insert AFTER INSERT ON track BEGIN INSERT INTO track_fts(rowid, name) VALUES (new.id, new.name); END");
+            _session.execute("CREATE TRIGGER IF NOT EXISTS track_fts_delete AFTER DELETE ON track BEGIN INSERT INTO track_fts(track_fts, rowid, name) VALUES ('delete', old.id, old.name); END");
+            _session.execute("CREATE TRIGGER IF NOT EXISTS track_fts_update AFTER UPDATE OF name ON track BEGIN INSERT INTO track_fts(track_fts, rowid, name) VALUES ('delete', old.id, old.name); INSERT INTO track_fts(rowid, name) VALUES (new.id, new.name); END");
+        }
+
+        // Catalogue change journal, kept in sync by triggers (see CatalogueChange)
+        {
+            auto transaction{ createWriteTransaction() };
+            _session.execute("CREATE TABLE IF NOT EXISTS catalogue_change (id INTEGER PRIMARY KEY AUTOINCREMENT, entity_type INTEGER NOT NULL, entity_id INTEGER NOT NULL, removed BOOLEAN NOT NULL, UNIQUE(entity_type, entity_id))");
+            _session.execute("CREATE INDEX IF NOT EXISTS catalogue_change_type_removed_idx ON catalogue_change(entity_type, removed, id)");
+
+            // the previous change of the entity is removed, so that the new one gets a higher id
+            const auto createChangeTriggers{ [&](std::string_view table, CatalogueChange::EntityType type)
+                {
+                    const std::string entityType{ std::to_string(static_cast<int>(type)) };
+                    auto changeStatements{ [&](std::string_view row, bool removed)
+                        {
+                            return " DELETE FROM catalogue_change WHERE entity_type = " + entityType + " AND entity_id = " + std::string{ row } + ".id;"
+                                " INSERT INTO catalogue_change(entity_type, entity_id, removed) VALUES (" + entityType + ", " + std::string{ row } + ".id, " + (removed ? "1" : "0") + ");";
+                        } };
+
+                    _session.execute("CREATE TRIGGER IF NOT EXISTS " + std::string{ table } + "_change_insert AFTER INSERT ON " + std::string{ table } + " BEGIN" + changeStatements("new", false) + " END");
+                    _session.execute("CREATE TRIGGER IF NOT EXISTS " + std::string{ table } + "_change_update AFTER UPDATE ON " + std::string{ table } + " BEGIN" + changeStatements("new", false) + " END");
+                    _session.execute("CREATE TRIGGER IF NOT EXISTS " + std::string{ table } + "_change_delete AFTER DELETE ON " + std::string{ table } + " BEGIN" + changeStatements("old", true) + " END");
+                } };
+
+            createChangeTriggers("artist", CatalogueChange::EntityType::Artist);
+            createChangeTriggers("release", CatalogueChange::EntityType::Release);
+            createChangeTriggers("track", CatalogueChange::EntityType::Track);
+        }
+
         // Singletons
         {
             auto uniqueTransaction{ createWriteTransaction() };
@@ -197,14 +447,4 @@ namespace Database
         LMS_LOG(DB, INFO, "Database Analyze complete");
     }
 
-    void Session::optimize()
-    {
-        LMS_LOG(DB, INFO, "Optimizing database...");
-        {
-            auto transaction{ createWriteTransaction() };
-            _session.execute("PRAGMA optimize");
-        }
-        LMS_LOG(DB, INFO, "Database optimizing complete");
-    }
-
 } // namespace Database
@@ -0,0 +1,252 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "database/Similarity.hpp"
+
+#include <algorithm>
+#include <tuple>
+
+#include "database/Session.hpp"
+#include "IdTypeTraits.hpp"
+#include "Utils.hpp"
+
+namespace Database
+{
+    namespace
+    {
+        template <typename IdType, typename Key, typename Query, typename Func>
+        void visitGroupedEntries(Query& query, Func&& func)
+        {
+            std::optional<Key> currentKey;
+            Similarity::Entries<IdType> entries;
+
+            for (const auto& [key, similarId, score] : query.resultList())
+            {
+                if (currentKey && *currentKey != key)
+                {
+                    func(*currentKey, entries);
+                    entries.clear();
+                }
+
+                currentKey = key;
+                entries.push_back(Similarity::Entry<IdType>{ similarId, static_cast<std::size_t>(score) });
+            }
+
+            if (currentKey)
+                func(*currentKey, entries);
+        }
+
+        // Each row binds the key values, then the similar id and the score
+        template <typename IdType, typename BindKeyFunc>
+        void insertEntries(Session& session, std::string_view insertStatement, std::string_view rowPlaceholders, std::size_t bindCountPerRow, std::span<const Similarity::Entry<IdType>> entries, BindKeyFunc&& bindKey)
+        {
+            const std::size_t maxRowCount{ Utils::maxBindArgCount / bindCountPerRow };
+
+            for (std::size_t offset{}; offset < entries.size(); offset += maxRowCount)
+            {
+                const std::span<const Similarity::Entry<IdType>> chunk{ entries.subspan(offset, std::min(maxRowCount, entries.size() - offset)) };
+
+                std::string sql{ insertStatement };
+                for (std::size_t i{}; i < chunk.size(); ++i)
+                {
+                    if (i > 0)
+                        sql += ", ";
+                    sql += rowPlaceholders;
+                }
+
+                auto call{ session.getDboSession().execute(sql) };
+                for (const Similarity::Entry<IdType>& entry : chunk)
+                {
+                    bindKey(call);
+                    call.bind(entry.id);
+                    call.bind(static_cast<long long>(entry.score));
+                }
+                call.run();
+            }
+        }
+    }
+
+    void Similarity::visitTrackClusters(Session& session, const std::function<void(TrackId track, ClusterId cluster)>& func)
+    {
+        session.checkReadTransaction();
+
+        auto query{ session.getDboSession().query<std::tuple<TrackId, ClusterId>>("SELECT t_c.track_id, t_c.cluster_id FROM track_cluster t_c")
+            .orderBy("t_c.track_id, t_c.cluster_id") };
+
+        for (const auto& [trackId, clusterId] : query.resultList())
+            func(trackId, clusterId);
+    }
+
+    void Similarity::visitTrackReleases(Session& session, const std::function<void(TrackId track, ReleaseId release)>& func)
+    {
+        session.checkReadTransaction();
+
+        auto query{ session.getDboSession().query<std::tuple<TrackId, ReleaseId>>("SELECT t.id, t.release_id FROM track t")
+            .where("t.release_id IS NOT NULL") };
+
+        for (const auto& [trackId, releaseId] : query.resultList())
+            func(trackId, releaseId);
+    }
+
+    void Similarity::visitTrackArtistLinks(Session& session, const std::function<void(TrackId track, ArtistId artist, TrackArtistLinkType linkType)>& func)
+    {
+        session.checkReadTransaction();
+
+        auto query{ session.getDboSession().query<std::tuple<TrackId, ArtistId, TrackArtistLinkType>>("SELECT DISTINCT t_a_l.track_id, t_a_l.artist_id, t_a_l.type FROM track_artist_link t_a_l") };
+
+        for (const auto& [trackId, artistId, linkType] : query.resultList())
+            func(trackId, artistId, linkType);
+    }
+
+    void Similarity::visitReleaseSimilarities(Session& session, const std::function<void(ReleaseId release, const Entries<ReleaseId>& entries)>& func)
+    {
+        session.checkReadTransaction();
+
+        auto query{ session.getDboSession().query<std::tuple<ReleaseId, ReleaseId, long long>>("SELECT r_s.release_id, r_s.similar_release_id, r_s.score FROM release_similarity r_s")
+            .orderBy("r_s.release_id, r_s.score DESC, r_s.similar_release_id") };
+
+        visitGroupedEntries<ReleaseId, ReleaseId>(query, func);
+    }
+
+    void Similarity::visitArtistSimilarities(Session& session, const std::function<void(ArtistId artist, TrackArtistLinkType linkType, const Entries<ArtistId>& entries)>& func)
+    {
+        session.checkReadTransaction();
+
+        auto query{ session.getDboSession().query<std::tuple<ArtistId, TrackArtistLinkType, ArtistId, long long>>("SELECT a_s.artist_id, a_s.type, a_s.similar_artist_id, a_s.score FROM artist_similarity a_s")
+            .orderBy("a_s.artist_id, a_s.type, a_s.score DESC, a_s.similar_artist_id") };
+
+        std::optional<std::pair<ArtistId, TrackArtistLinkType>> currentKey;
+        Entries<ArtistId> entries;
+
+        for (const auto& [artistId, linkType, similarArtistId, score] : query.resultList())
+        {
+            const std::pair<ArtistId, TrackArtistLinkType> key{ artistId, linkType };
+            if (currentKey && *currentKey != key)
+            {
+                func(currentKey->first, currentKey->second, entries);
+                entries.clear();
+            }
+
+            currentKey = key;
+            entries.push_back(Entry<ArtistId>{ similarArtistId, static_cast<std::size_t>(score) });
+        }
+
+        if (currentKey)
+            func(currentKey->first, currentKey->second, entries);
+    }
+
+    void Similarity::visitTrackSimilarities(Session& session, const std::function<void(TrackId track, const Entries<TrackId>& entries)>& func)
+    {
+        session.checkReadTransaction();
+
+        auto query{ session.getDboSession().query<std::tuple<TrackId, TrackId, long long>>("SELECT t_s.track_id, t_s.similar_track_id, t_s.score FROM track_similarity t_s")
+            .orderBy("t_s.track_id, t_s.score DESC, t_s.similar_track_id") };
+
+        visitGroupedEntries<TrackId, TrackId>(query, func);
+    }
+
+    void Similarity::setReleaseSimilarities(Session& session, ReleaseId release, std::span<const Entry<ReleaseId>> entries)
+    {
+        session.checkWriteTransaction();
+
+        session.getDboSession().execute("DELETE FROM release_similarity WHERE release_id = ?").bind(release);
+        insertEntries<ReleaseId>(session, "INSERT INTO release_similarity (release_id, similar_release_id, score) VALUES ", "(?, ?, ?)", 3, entries, [&](auto& call) { call.bind(release); });
+    }
+
+    void Similarity::setArtistSimilarities(Session& session, ArtistId artist, TrackArtistLinkType linkType, std::span<const Entry<ArtistId>> entries)
+    {
+        session.checkWriteTransaction();
+
+        session.getDboSession().execute("DELETE FROM artist_similarity WHERE artist_id = ? AND type = ?").bind(artist).bind(linkType);
+        insertEntries<ArtistId>(session, "INSERT INTO artist_similarity (artist_id, type, similar_artist_id, score) VALUES ", "(?, ?, ?, ?)", 4, entries, [&](auto& call) { call.bind(artist); call.bind(linkType); });
+    }
+
+    void Similarity::setTrackSimilarities(Session& session, TrackId track, std::span<const Entry<TrackId>> entries)
+    {
+        session.checkWriteTransaction();
+
+        session.getDboSession().execute("DELETE FROM track_similarity WHERE track_id = ?").bind(track);
+        insertEntries<TrackId>(session, "INSERT INTO track_similarity (track_id, similar_track_id, score) VALUES ", "(?, ?, ?)", 3, entries, [&](auto& call) { call.bind(track); });
+    }
+
+    bool Similarity::isEmpty(Session& session)
+    {
+        session.checkReadTransaction();
+
+        return session.getDboSession().query<int>("SELECT (SELECT COUNT(*) FROM (SELECT 1 FROM release_similarity LIMIT 1)) + (SELECT COUNT(*) FROM (SELECT 1 FROM artist_similarity LIMIT 1)) + (SELECT COUNT(*) FROM (SELECT 1 FROM track_similarity LIMIT 1))").resultValue() == 0;
+    }
+
+    RangeResults<ReleaseId> Similarity::findSimilarReleaseIds(Session& session, ReleaseId release, std::optional<Range> range)
+    {
+        session.checkReadTransaction();
+
+        auto query{ session.getDboSession().query<ReleaseId>("SELECT r_s.similar_release_id FROM release_similarity r_s")
+            .where("r_s.release_id = ?").bind(release)
+            .orderBy("r_s.score DESC, RANDOM()") };
+
+        return Utils::execQuery<ReleaseId>(query, range);
+    }
+
+    RangeResults<ArtistId> Similarity::findSimilarArtistIds(Session& session, ArtistId artist, EnumSet<TrackArtistLinkType> linkTypes, std::optional<Range> range)
+    {
+        session.checkReadTransaction();
+
+        auto query{ session.getDboSession().query<ArtistId>("SELECT a_s.similar_artist_id FROM artist_similarity a_s")
+            .where("a_s.artist_id = ?").bind(artist)
+            .groupBy("a_s.similar_artist_id")
+            .orderBy("SUM(a_s.score) DESC, RANDOM()") };
+
+        if (!linkTypes.empty())
+        {
+            std::size_t linkTypeCount{};
+            for ([[maybe_unused]] TrackArtistLinkType linkType : linkTypes)
+                ++linkTypeCount;
+
+            query.where("a_s.type IN (" + Utils::createBindPlaceholders(linkTypeCount) + ")");
+            for (TrackArtistLinkType linkType : linkTypes)
+                query.bind(linkType);
+        }
+
+        return Utils::execQuery<ArtistId>(query, range);
+    }
+
+    RangeResults<TrackId> Similarity::findSimilarTrackIds(Session& session, std::span<const TrackId> tracks, std::optional<Range> range)
+    {
+        session.checkReadTransaction();
+
+        // Each track is bound twice, only keep the most recent ones of long lists
+        if (tracks.size() > Utils::maxBindArgCount / 2)
+            tracks = tracks.last(Utils::maxBindArgCount / 2);
+
+        const std::string placeholders{ Utils::createBindPlaceholders(tracks.size()) };
+
+        auto query{ session.getDboSession().query<TrackId>("SELECT t_s.similar_track_id FROM track_similarity t_s")
+            .where("t_s.track_id IN (" + placeholders + ")")
+            .where("t_s.similar_track_id NOT IN (" + placeholders + ")")
+            .groupBy("t_s.similar_track_id")
+            .orderBy("SUM(t_s.score) DESC, RANDOM()") };
+
+        for (const TrackId trackId : tracks)
+            query.bind(trackId);
+        for (const TrackId trackId : tracks)
+            query.bind(trackId);
+
+        return Utils::execQuery<TrackId>(query, range);
+    }
+}
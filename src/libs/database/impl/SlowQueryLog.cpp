@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "database/SlowQueryLog.hpp"
+
+#include <algorithm>
+#include <cctype>
+
+namespace Database
+{
+    namespace
+    {
+        bool isIdentifierChar(char c)
+        {
+            return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+        }
+
+        // "?, ?, ?" is folded into "?", so that IN lists of various sizes share the same shape
+        void appendPlaceholder(std::string& shape)
+        {
+            shape += '?';
+
+            for (std::string_view separator : { ",?", ", ?" })
+            {
+                if (shape.size() > separator.size() && std::string_view{ shape }.ends_with(separator) && shape[shape.size() - separator.size() - 1] == '?')
+                {
+                    shape.resize(shape.size() - separator.size());
+                    return;
+                }
+            }
+        }
+    }
+
+    SlowQueryLog::SlowQueryLog(std::chrono::microseconds threshold, std::size_t maxEntryCount)
+        : _threshold{ threshold }
+        , _maxEntryCount{ maxEntryCount }
+    {
+    }
+
+    bool SlowQueryLog::record(const Query& query)
+    {
+        std::string shape{ computeQueryShape(query.sql) };
+
+        const std::scoped_lock lock{ _mutex };
+
+        auto it{ _entries.find(shape) };
+        if (it == std::end(_entries))
+        {
+            if (_entries.size() >= _maxEntryCount)
+                return false;
+
+            it = _entries.emplace(shape, Entry{}).first;
+            it->second.shape = std::move(shape);
+        }
+
+        Entry& entry{ it->second };
+        entry.count++;
+        entry.totalDuration += query.duration;
+        entry.maxDuration = std::max(entry.maxDuration, query.duration);
+        entry.lastQuery = query;
+        entry.lastDateTime = Wt::WDateTime::currentDateTime();
+
+        return entry.count == 1;
+    }
+
+    void SlowQueryLog::setQueryPlan(std::string_view sql, std::vector<std::string> queryPlan)
+    {
+        const std::string shape{ computeQueryShape(sql) };
+
+        const std::scoped_lock lock{ _mutex };
+
+        auto it{ _entries.find(shape) };
+        if (it != std::end(_entries))
+            it->second.queryPlan = std::move(queryPlan);
+    }
+
+    std::vector<SlowQueryLog::Entry> SlowQueryLog::getEntries() const
+    {
+        std::vector<Entry> entries;
+        {
+            const std::scoped_lock lock{ _mutex };
+
+            entries.reserve(_entries.size());
+            for (const auto& [shape, entry] : _entries)
+                entries.push_back(entry);
+        }
+
+        std::sort(std::begin(entries), std::end(entries), [](const Entry& lhs, const Entry& rhs) { return lhs.totalDuration > rhs.totalDuration; });
+
+        return entries;
+    }
+
+    void SlowQueryLog::clear()
+    {
+        const std::scoped_lock lock{ _mutex };
+        _entries.clear();
+    }
+
+    std::string SlowQueryLog::computeQueryShape(std::string_view sql)
+    {
+        std::string shape;
+        shape.reserve(sql.size());
+
+        std::size_t i{};
+        while (i < sql.size())
+        {
+            const char c{ sql[i] };
+
+            if (c == '\'')
+            {
+                // string literal, quotes are escaped by doubling them
+                for (++i; i < sql.size(); ++i)
+                {
+                    if (sql[i] == '\'')
+                    {
+                        if (i + 1 < sql.size() && sql[i + 1] == '\'')
+                            ++i;
+                        else
+                            break;
+                    }
+                }
+                ++i;
+                appendPlaceholder(shape);
+            }
+            else if (c == '"')
+            {
+                // quoted identifier, kept as is
+                const std::size_t end{ std::min(sql.find('"', i + 1), sql.size() - 1) };
+                shape.append(sql.substr(i, end - i + 1));
+                i = end + 1;
+            }
+            else if (std::isdigit(static_cast<unsigned char>(c)) && (shape.empty() || !isIdentifierChar(shape.back())))
+            {
+                while (i < sql.size() && (isIdentifierChar(sql[i]) || sql[i] == '.'))
+                    ++i;
+                appendPlaceholder(shape);
+            }
+            else if (c == '?')
+            {
+                ++i;
+                appendPlaceholder(shape);
+            }
+            else if (std::isspace(static_cast<unsigned char>(c)))
+            {
+                while (i < sql.size() && std::isspace(static_cast<unsigned char>(sql[i])))
+                    ++i;
+                if (!shape.empty())
+                    shape += ' ';
+            }
+            else
+            {
+                shape += c;
+                ++i;
+            }
+        }
+
+        while (!shape.empty() && shape.back() == ' ')
+            shape.pop_back();
+
+        return shape;
+    }
+} // namespace Database
@@ -50,7 +50,7 @@ namespace Database
     StarredArtist::pointer StarredArtist::find(Session& session, StarredArtistId id)
     {
         session.checkReadTransaction();
-        return session.getDboSession().find<StarredArtist>().where("id = ?").bind(id).resultValue();
+        return Utils::findById<StarredArtist>(session.getDboSession(), id);
     }
 
     StarredArtist::pointer StarredArtist::find(Session& session, ArtistId artistId, UserId userId)
@@ -74,6 +74,19 @@ namespace Database
             .resultValue();
     }
 
+    void StarredArtist::getStarredDateTimes(Session& session, UserId userId, FeedbackBackend backend, std::function<void(ArtistId artistId, const Wt::WDateTime& dateTime)> func)
+    {
+        session.checkReadTransaction();
+
+        auto query{ session.getDboSession().query<std::tuple<ArtistId, Wt::WDateTime>>("SELECT artist_id, date_time from starred_artist")
+            .where("user_id = ?").bind(userId)
+            .where("backend = ?").bind(backend)
+            .where("sync_state <> ?").bind(SyncState::PendingRemove) };
+
+        for (const auto& [artistId, dateTime] : query.resultList())
+            func(artistId, dateTime);
+    }
+
     void StarredArtist::setDateTime(const Wt::WDateTime& dateTime)
     {
         _dateTime = Utils::normalizeDateTime(dateTime);
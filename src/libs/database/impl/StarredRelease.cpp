@@ -50,7 +50,7 @@ namespace Database
     StarredRelease::pointer StarredRelease::find(Session& session, StarredReleaseId id)
     {
         session.checkReadTransaction();
-        return session.getDboSession().find<StarredRelease>().where("id = ?").bind(id).resultValue();
+        return Utils::findById<StarredRelease>(session.getDboSession(), id);
     }
 
     StarredRelease::pointer StarredRelease::find(Session& session, ReleaseId releaseId, UserId userId)
@@ -74,6 +74,19 @@ namespace Database
             .resultValue();
     }
 
+    void StarredRelease::getStarredDateTimes(Session& session, UserId userId, FeedbackBackend backend, std::function<void(ReleaseId releaseId, const Wt::WDateTime& dateTime)> func)
+    {
+        session.checkReadTransaction();
+
+        auto query{ session.getDboSession().query<std::tuple<ReleaseId, Wt::WDateTime>>("SELECT release_id, date_time from starred_release")
+            .where("user_id = ?").bind(userId)
+            .where("backend = ?").bind(backend)
+            .where("sync_state <> ?").bind(SyncState::PendingRemove) };
+
+        for (const auto& [releaseId, dateTime] : query.resultList())
+            func(releaseId, dateTime);
+    }
+
     void StarredRelease::setDateTime(const Wt::WDateTime& dateTime)
     {
         _dateTime = Utils::normalizeDateTime(dateTime);
@@ -50,7 +50,7 @@ namespace Database
     StarredTrack::pointer StarredTrack::find(Session& session, StarredTrackId id)
     {
         session.checkReadTransaction();
-        return session.getDboSession().find<StarredTrack>().where("id = ?").bind(id).resultValue();
+        return Utils::findById<StarredTrack>(session.getDboSession(), id);
     }
 
     StarredTrack::pointer StarredTrack::find(Session& session, TrackId trackId, UserId userId)
@@ -74,6 +74,25 @@ namespace Database
             .resultValue();
     }
 
+    void StarredTrack::find(Session& session, std::span<const TrackId> trackIds, UserId userId, std::function<void(TrackId trackId, const pointer& starredTrack)> func)
+    {
+        session.checkReadTransaction();
+
+        Utils::forEachBindChunk(trackIds, [&](std::span<const TrackId> trackIdChunk)
+            {
+                auto query{ session.getDboSession().query<std::tuple<TrackId, Wt::Dbo::ptr<StarredTrack>>>("SELECT s_t.track_id, s_t from starred_track s_t")
+                    .join("user u ON u.id = s_t.user_id")
+                    .where("s_t.user_id = ?").bind(userId)
+                    .where("s_t.backend = u.feedback_backend")
+                    .where("s_t.track_id IN (" + Utils::createBindPlaceholders(trackIdChunk.size()) + ")") };
+                for (const TrackId trackId : trackIdChunk)
+                    query.bind(trackId);
+
+                for (const auto& [trackId, starredTrack] : query.resultList())
+                    func(trackId, starredTrack);
+            });
+    }
+
     bool StarredTrack::exists(Session& session, TrackId trackId, UserId userId, FeedbackBackend backend)
     {
         return session.getDboSession().query<int>("SELECT 1 from starred_track")
@@ -83,6 +102,40 @@ namespace Database
             .resultValue() == 1;
     }
 
+    void StarredTrack::getStarredDateTimes(Session& session, UserId userId, FeedbackBackend backend, std::function<void(TrackId trackId, const Wt::WDateTime& dateTime)> func)
+    {
+        session.checkReadTransaction();
+
+        auto query{ session.getDboSession().query<std::tuple<TrackId, Wt::WDateTime>>("SELECT track_id, date_time from starred_track")
+            .where("user_id = ?").bind(userId)
+            .where("backend = ?").bind(backend)
+            .where("sync_state <> ?").bind(SyncState::PendingRemove) };
+
+        for (const auto& [trackId, dateTime] : query.resultList())
+            func(trackId, dateTime);
+    }
+
+    std::vector<TrackId> StarredTrack::findStarredTrackIds(Session& session, std::span<const TrackId> trackIds, UserId userId, FeedbackBackend backend)
+    {
+        session.checkReadTransaction();
+
+        std::vector<TrackId> res;
+        Utils::forEachBindChunk(trackIds, [&](std::span<const TrackId> trackIdChunk)
+            {
+                auto query{ session.getDboSession().query<TrackId>("SELECT track_id from starred_track")
+                    .where("user_id = ?").bind(userId)
+                    .where("backend = ?").bind(backend)
+                    .where("track_id IN (" + Utils::createBindPlaceholders(trackIdChunk.size()) + ")") };
+                for (const TrackId trackId : trackIdChunk)
+                    query.bind(trackId);
+
+                for (const TrackId trackId : query.resultList())
+                    res.push_back(trackId);
+            });
+
+        return res;
+    }
+
     RangeResults<StarredTrackId> StarredTrack::find(Session& session, const FindParameters& params)
     {
         session.checkReadTransaction();
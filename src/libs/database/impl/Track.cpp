@@ -19,10 +19,16 @@
 
 #include "database/Track.hpp"
 
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+
 #include <Wt/Dbo/WtSqlTraits.h>
 
 #include "database/Artist.hpp"
+#include "database/CatalogueChange.hpp"
 #include "database/Cluster.hpp"
+#include "database/Directory.hpp"
 #include "database/MediaLibrary.hpp"
 #include "database/Release.hpp"
 #include "database/TrackArtistLink.hpp"
@@ -30,6 +36,7 @@
 #include "database/Session.hpp"
 #include "database/User.hpp"
 #include "utils/ILogger.hpp"
+#include "utils/String.hpp"
 
 #include "IdTypeTraits.hpp"
 #include "SqlQuery.hpp"
@@ -40,6 +47,15 @@ namespace Database
 {
     namespace
     {
+        // keyset pagination is only supported by name based sort methods
+        std::optional<std::string_view> getCursorSortKeyColumn(TrackSortMethod sortMethod)
+        {
+            if (sortMethod == TrackSortMethod::Name)
+                return "name_sort_key";
+
+            return std::nullopt;
+        }
+
         template <typename ResultType>
         Wt::Dbo::Query<ResultType> createQuery(Session& session, std::string_view itemToSelect, const Track::FindParameters& params)
         {
@@ -48,8 +64,17 @@ namespace Database
             auto query{ session.getDboSession().query<ResultType>("SELECT " + std::string{ itemToSelect } + " FROM track t") };
 
             assert(params.keywords.empty() || params.name.empty());
-            for (std::string_view keyword : params.keywords)
-                query.where("t.name LIKE ? ESCAPE '" ESCAPE_CHAR_STR "'").bind("%" + Utils::escapeLikeKeyword(keyword) + "%");
+            const bool useFullTextSearch{ Utils::canUseFullTextSearch(params.keywords) };
+            if (useFullTextSearch)
+            {
+                query.join("track_fts ON track_fts.rowid = t.id")
+                    .where("track_fts MATCH ?").bind(Utils::createFullTextSearchQuery(params.keywords));
+            }
+            else
+            {
+                for (std::string_view keyword : params.keywords)
+                    query.where("t.name LIKE ? ESCAPE '" ESCAPE_CHAR_STR "'").bind("%" + Utils::escapeLikeKeyword(keyword) + "%");
+            }
 
             if (!params.name.empty())
                 query.where("t.name = ?").bind(params.name);
@@ -72,6 +97,10 @@ namespace Database
                 query.join("track_cluster t_c ON t_c.track_id = t.id")
                     .where("t_c.cluster_id = ?").bind(params.clusters.front());
             }
+            else if (const auto snapshotClause{ Utils::createTracksInAllClustersClause(session, "t.id", params.clusters) })
+            {
+                query.where(*snapshotClause);
+            }
             else if (params.clusters.size() > 1)
             {
                 std::ostringstream oss;
@@ -148,25 +177,33 @@ namespace Database
             if (params.mediaLibrary.isValid())
                 query.where("t.media_library_id = ?").bind(params.mediaLibrary);
 
+            if (params.cursor)
+            {
+                assert(getCursorSortKeyColumn(params.sortMethod));
+                Utils::applyCursor(query, "t." + std::string{ *getCursorSortKeyColumn(params.sortMethod) }, "t.id", *params.cursor);
+            }
+
             switch (params.sortMethod)
             {
             case TrackSortMethod::None:
+                if (useFullTextSearch)
+                    query.orderBy("track_fts.rank");
                 break;
             case TrackSortMethod::LastWritten:
                 query.orderBy("t.file_last_write DESC");
                 break;
             case TrackSortMethod::Random:
-                query.orderBy("RANDOM()");
+                // results are sampled afterwards, see Utils::execRandomQuery
                 break;
             case TrackSortMethod::StarredDateDesc:
                 assert(params.starringUser.isValid());
                 query.orderBy("s_t.date_time DESC");
                 break;
             case TrackSortMethod::Name:
-                query.orderBy("t.name COLLATE NOCASE");
+                query.orderBy("t.name_sort_key, t.id");
                 break;
             case TrackSortMethod::DateDescAndRelease:
-                query.orderBy("COALESCE(t.date, CAST(t.year AS TEXT)) DESC,t.release_id,t.disc_number,t.track_number");
+                query.orderBy("t.sort_date DESC,t.release_id,t.disc_number,t.track_number");
                 break;
             case TrackSortMethod::Release:
                 query.orderBy("t.disc_number,t.track_number");
@@ -193,16 +230,101 @@ namespace Database
 
             return createQuery<ResultType>(session, itemToSelect, params);
         }
+
+        std::vector<Track::MBIDResult> findIdsByMBIDColumn(Session& session, std::string_view mbidColumn, std::span<const UUID> mbids)
+        {
+            session.checkReadTransaction();
+
+            using QueryResultType = std::tuple<TrackId, MBIDBlob>;
+
+            std::vector<Track::MBIDResult> res;
+            Utils::forEachBindChunk(mbids, [&](std::span<const UUID> mbidChunk)
+                {
+                    auto query{ session.getDboSession().query<QueryResultType>("SELECT t.id, t." + std::string{ mbidColumn } + " FROM track t")
+                        .where("t." + std::string{ mbidColumn } + " IN (" + Utils::createBindPlaceholders(mbidChunk.size()) + ")") };
+                    for (const UUID& mbid : mbidChunk)
+                        query.bind(toMBIDBlob(mbid));
+
+                    for (const QueryResultType& queryResult : query.resultList())
+                    {
+                        if (std::optional<UUID> mbid{ fromMBIDBlob(std::get<MBIDBlob>(queryResult)) })
+                            res.push_back(Track::MBIDResult{ std::get<TrackId>(queryResult), std::move(*mbid) });
+                    }
+                });
+
+            return res;
+        }
+
+        // Rebuilds the paths of the directories, each directory is read once
+        class DirectoryPathResolver
+        {
+        public:
+            DirectoryPathResolver(Session& session) : _session{ session } {}
+
+            const std::filesystem::path& getPath(DirectoryId directoryId)
+            {
+                if (auto it{ _paths.find(directoryId) }; it != std::cend(_paths))
+                    return it->second;
+
+                using QueryResultType = std::tuple<DirectoryId, std::string>;
+                const QueryResultType queryResult{ _session.getDboSession().query<QueryResultType>("SELECT parent_directory_id, name FROM directory")
+                    .where("id = ?").bind(directoryId)
+                    .resultValue() };
+
+                const DirectoryId parentDirectoryId{ std::get<DirectoryId>(queryResult) };
+                std::filesystem::path path{ parentDirectoryId.isValid() ? getPath(parentDirectoryId) / std::get<std::string>(queryResult) : std::filesystem::path{ std::get<std::string>(queryResult) } };
+
+                return _paths.emplace(directoryId, std::move(path)).first->second;
+            }
+
+        private:
+            Session& _session;
+            std::unordered_map<DirectoryId, std::filesystem::path> _paths;
+        };
+
+        using PathQueryResultType = std::tuple<TrackId, DirectoryId, std::string>;
+
+        RangeResults<Track::PathResult> toPathResults(Session& session, const RangeResults<PathQueryResultType>& queryResults)
+        {
+            DirectoryPathResolver directoryPathResolver{ session };
+
+            RangeResults<Track::PathResult> res;
+            res.range = queryResults.range;
+            res.moreResults = queryResults.moreResults;
+            res.results.reserve(queryResults.results.size());
+
+            std::transform(std::cbegin(queryResults.results), std::cend(queryResults.results), std::back_inserter(res.results),
+                [&](const PathQueryResultType& queryResult)
+                {
+                    return Track::PathResult{ std::get<TrackId>(queryResult), directoryPathResolver.getPath(std::get<DirectoryId>(queryResult)) / std::get<std::string>(queryResult) };
+                });
+
+            return res;
+        }
     }
 
-    Track::Track(const std::filesystem::path& p)
-        : _filePath{ p.string() }
+    Track::Track(ObjectPtr<Directory> directory, std::string_view fileName)
+        : _fileName{ fileName }
+        , _directory{ getDboPtr(directory) }
     {
     }
 
-    Track::pointer Track::create(Session& session, const std::filesystem::path& p)
+    void Track::updateSortDates()
     {
-        return session.getDboSession().add(std::unique_ptr<Track> {new Track{ p }});
+        _sortDate = Utils::computeSortDate(_date, _year);
+        _originalSortDate = Utils::computeSortDate(_originalDate, _originalYear);
+        if (!_originalSortDate)
+            _originalSortDate = _sortDate;
+    }
+
+    Track::pointer Track::create(Session& session, const std::filesystem::path& p, const ObjectPtr<MediaLibrary>& mediaLibrary)
+    {
+        const Directory::pointer directory{ Directory::getOrCreate(session, p.parent_path(), mediaLibrary) };
+
+        Track::pointer track{ session.getDboSession().add(std::unique_ptr<Track> {new Track{ directory, p.filename().string() }}) };
+        track.modify()->setMediaLibrary(mediaLibrary);
+
+        return track;
     }
 
     std::size_t Track::getCount(Session& session)
@@ -216,16 +338,82 @@ namespace Database
     {
         session.checkReadTransaction();
 
-        return session.getDboSession().find<Track>().where("file_path = ?").bind(p.string()).resultValue();
+        // the path may be located in several directory trees (nested media libraries)
+        for (const DirectoryId directoryId : Directory::findIds(session, p.parent_path()))
+        {
+            Track::pointer track{ session.getDboSession().find<Track>()
+                .where("directory_id = ?").bind(directoryId)
+                .where("file_name = ?").bind(p.filename().string())
+                .resultValue() };
+
+            if (track)
+                return track;
+        }
+
+        return {};
+    }
+
+    std::vector<Track::pointer> Track::findByPaths(Session& session, std::span<const std::filesystem::path> paths)
+    {
+        session.checkReadTransaction();
+
+        std::map<std::filesystem::path, std::vector<std::string>> fileNamesByDirectory;
+        for (const std::filesystem::path& path : paths)
+            fileNamesByDirectory[path.parent_path()].push_back(path.filename().string());
+
+        std::vector<Track::pointer> res;
+        for (const auto& [directoryPath, fileNames] : fileNamesByDirectory)
+        {
+            for (const DirectoryId directoryId : Directory::findIds(session, directoryPath))
+            {
+                Utils::forEachBindChunk(std::span<const std::string>{ fileNames }, [&](std::span<const std::string> fileNameChunk)
+                    {
+                        auto query{ session.getDboSession().find<Track>()
+                            .where("directory_id = ?").bind(directoryId)
+                            .where("file_name IN (" + Utils::createBindPlaceholders(fileNameChunk.size()) + ")") };
+                        for (const std::string& fileName : fileNameChunk)
+                            query.bind(fileName);
+
+                        for (const Wt::Dbo::ptr<Track>& track : query.resultList())
+                            res.push_back(track);
+                    });
+            }
+        }
+
+        return res;
     }
 
     Track::pointer Track::find(Session& session, TrackId id)
     {
         session.checkReadTransaction();
 
-        return session.getDboSession().find<Track>()
-            .where("id = ?").bind(id)
-            .resultValue();
+        return Utils::findById<Track>(session.getDboSession(), id);
+    }
+
+    std::vector<Track::pointer> Track::find(Session& session, std::span<const TrackId> ids)
+    {
+        session.checkReadTransaction();
+
+        std::unordered_map<TrackId, Track::pointer> tracks;
+        Utils::forEachBindChunk(ids, [&](std::span<const TrackId> idChunk)
+            {
+                auto query{ session.getDboSession().find<Track>().where("id IN (" + Utils::createBindPlaceholders(idChunk.size()) + ")") };
+                for (const TrackId id : idChunk)
+                    query.bind(id);
+
+                for (const Wt::Dbo::ptr<Track>& track : query.resultList())
+                    tracks.emplace(track->getId(), track);
+            });
+
+        std::vector<Track::pointer> res;
+        res.reserve(tracks.size());
+        for (const TrackId id : ids)
+        {
+            if (auto it{ tracks.find(id) }; it != std::cend(tracks))
+                res.push_back(it->second);
+        }
+
+        return res;
     }
 
     bool Track::exists(Session& session, TrackId id)
@@ -240,7 +428,7 @@ namespace Database
         session.checkReadTransaction();
 
         auto res{ session.getDboSession().find<Track>()
-            .where("mbid = ?").bind(std::string {mbid.getAsString()})
+            .where("mbid = ?").bind(toMBIDBlob(mbid))
             .resultList() };
 
         return std::vector<Track::pointer>(res.begin(), res.end());
@@ -251,55 +439,270 @@ namespace Database
         session.checkReadTransaction();
 
         auto res{ session.getDboSession().find<Track>()
-            .where("recording_mbid = ?").bind(std::string {mbid.getAsString()})
+            .where("recording_mbid = ?").bind(toMBIDBlob(mbid))
             .resultList() };
 
         return std::vector<Track::pointer>(res.begin(), res.end());
     }
 
+    std::vector<Track::MBIDResult> Track::findIdsByRecordingMBIDs(Session& session, std::span<const UUID> mbids)
+    {
+        return findIdsByMBIDColumn(session, "recording_mbid", mbids);
+    }
+
+    std::vector<Track::MBIDResult> Track::findIdsByMBIDs(Session& session, std::span<const UUID> mbids)
+    {
+        return findIdsByMBIDColumn(session, "mbid", mbids);
+    }
+
+    std::size_t Track::remove(Session& session, std::span<const TrackId> trackIds)
+    {
+        session.checkWriteTransaction();
+
+        Wt::Dbo::Session& dboSession{ session.getDboSession() };
+        dboSession.flush();
+
+        // linked entries are removed by the database (on delete cascade)
+        std::size_t removedCount{};
+        Utils::forEachBindChunk(trackIds, [&](std::span<const TrackId> chunk)
+            {
+                auto call{ dboSession.execute("DELETE FROM track WHERE id IN (" + Utils::createBindPlaceholders(chunk.size()) + ")") };
+                for (const TrackId trackId : chunk)
+                    call.bind(trackId);
+                call.run();
+
+                removedCount += Utils::getChangeCount(dboSession);
+            });
+
+        // Loaded tracks may have been removed
+        dboSession.rereadAll("track");
+
+        return removedCount;
+    }
+
+    void Track::setExtraInfo(Session& session, const pointer& track, const ExtraInfo& extraInfo)
+    {
+        session.checkWriteTransaction();
+
+        Wt::Dbo::Session& dboSession{ session.getDboSession() };
+        dboSession.flush();
+
+        // most tracks have no extra info: do not store empty rows
+        if (extraInfo == ExtraInfo{})
+        {
+            dboSession.execute("DELETE FROM track_extra WHERE track_id = ?").bind(track->getId());
+            return;
+        }
+
+        dboSession.execute("INSERT INTO track_extra (track_id, disc_subtitle, copyright, copyright_url) VALUES (?, ?, ?, ?)"
+            " ON CONFLICT(track_id) DO UPDATE SET disc_subtitle = excluded.disc_subtitle, copyright = excluded.copyright, copyright_url = excluded.copyright_url")
+            .bind(track->getId())
+            .bind(extraInfo.discSubtitle)
+            .bind(std::string{ extraInfo.copyright, 0, _maxCopyrightLength })
+            .bind(std::string{ extraInfo.copyrightURL, 0, _maxCopyrightURLLength });
+    }
+
+    void Track::move(Session& session, const pointer& track, const std::filesystem::path& p, const ObjectPtr<MediaLibrary>& mediaLibrary)
+    {
+        session.checkWriteTransaction();
+
+        const Directory::pointer directory{ Directory::getOrCreate(session, p.parent_path(), mediaLibrary) };
+
+        Track* modifiedTrack{ track.modify() };
+        modifiedTrack->_directory = getDboPtr(directory);
+        modifiedTrack->_fileName = p.filename().string();
+        modifiedTrack->_mediaLibrary = getDboPtr(mediaLibrary);
+    }
+
     RangeResults<Track::PathResult> Track::findPaths(Session& session, std::optional<Range> range)
     {
-        using QueryResultType = std::tuple<TrackId, std::string>;
         session.checkReadTransaction();
 
-        // TODO Dbo traits on filesystem
-        auto query{ session.getDboSession().query<QueryResultType>("SELECT id, file_path FROM track") };
+        auto query{ session.getDboSession().query<PathQueryResultType>("SELECT id, directory_id, file_name FROM track") };
 
-        RangeResults<QueryResultType> queryResults{ Utils::execQuery<QueryResultType>(query, range) };
+        return toPathResults(session, Utils::execQuery<PathQueryResultType>(query, range));
+    }
 
-        RangeResults<PathResult> res;
-        res.range = queryResults.range;
-        res.moreResults = queryResults.moreResults;
-        res.results.reserve(queryResults.results.size());
+    RangeResults<Track::PathResult> Track::findPathsWithEstimatedDuration(Session& session, std::optional<Range> range)
+    {
+        session.checkReadTransaction();
+
+        auto query{ session.getDboSession().query<PathQueryResultType>("SELECT id, directory_id, file_name FROM track")
+            .where("duration_estimated <> 0")
+            .orderBy("id") };
+
+        return toPathResults(session, Utils::execQuery<PathQueryResultType>(query, range));
+    }
+
+    RangeResults<Track::PathResult> Track::findPathsWithPendingLoudnessAnalysis(Session& session, std::optional<Range> range)
+    {
+        session.checkReadTransaction();
+
+        auto query{ session.getDboSession().query<PathQueryResultType>("SELECT id, directory_id, file_name FROM track")
+            .where("loudness_analysis_pending <> 0")
+            .orderBy("id") };
+
+        return toPathResults(session, Utils::execQuery<PathQueryResultType>(query, range));
+    }
+
+    RangeResults<Track::PathResult> Track::findPathsWithoutFeatures(Session& session, std::optional<Range> range)
+    {
+        session.checkReadTransaction();
+
+        auto query{ session.getDboSession().query<PathQueryResultType>("SELECT t.id, t.directory_id, t.file_name FROM track t")
+            .where("NOT EXISTS (SELECT 1 FROM track_features t_f WHERE t_f.track_id = t.id)")
+            .orderBy("t.id") };
+
+        return toPathResults(session, Utils::execQuery<PathQueryResultType>(query, range));
+    }
+
+    RangeResults<Track::PathResult> Track::findPathsInDirectory(Session& session, const std::filesystem::path& directory, std::optional<Range> range)
+    {
+        session.checkReadTransaction();
+
+        const std::vector<DirectoryId> directoryIds{ Directory::findTreeIds(session, directory) };
+        if (directoryIds.empty())
+            return {};
+
+        auto query{ session.getDboSession().query<PathQueryResultType>("SELECT id, directory_id, file_name FROM track")
+            .where(Utils::createDirectoryTreeCondition("directory_id", directoryIds.size()))
+            .orderBy("id") };
+        for (const DirectoryId directoryId : directoryIds)
+            query.bind(directoryId);
+
+        return toPathResults(session, Utils::execQuery<PathQueryResultType>(query, range));
+    }
+
+    RangeResults<ReleaseId> Track::findReleaseIdsInDirectory(Session& session, const std::filesystem::path& directory, std::optional<Range> range)
+    {
+        session.checkReadTransaction();
+
+        const std::vector<DirectoryId> directoryIds{ Directory::findTreeIds(session, directory) };
+        if (directoryIds.empty())
+            return {};
+
+        auto query{ session.getDboSession().query<ReleaseId>("SELECT DISTINCT release_id FROM track")
+            .where(Utils::createDirectoryTreeCondition("directory_id", directoryIds.size()))
+            .where("release_id IS NOT NULL")
+            .orderBy("release_id") };
+        for (const DirectoryId directoryId : directoryIds)
+            query.bind(directoryId);
+
+        return Utils::execQuery<ReleaseId>(query, range);
+    }
+
+    RangeResults<ArtistId> Track::findArtistIdsInDirectory(Session& session, const std::filesystem::path& directory, std::optional<Range> range)
+    {
+        session.checkReadTransaction();
 
-        std::transform(std::cbegin(queryResults.results), std::cend(queryResults.results), std::back_inserter(res.results),
-            [](const QueryResultType& queryResult)
+        const std::vector<DirectoryId> directoryIds{ Directory::findTreeIds(session, directory) };
+        if (directoryIds.empty())
+            return {};
+
+        auto query{ session.getDboSession().query<ArtistId>("SELECT DISTINCT t_a_l.artist_id FROM track t INNER JOIN track_artist_link t_a_l ON t_a_l.track_id = t.id")
+            .where(Utils::createDirectoryTreeCondition("t.directory_id", directoryIds.size()))
+            .orderBy("t_a_l.artist_id") };
+        for (const DirectoryId directoryId : directoryIds)
+            query.bind(directoryId);
+
+        return Utils::execQuery<ArtistId>(query, range);
+    }
+
+    void Track::findFileScanInfos(Session& session, std::function<void(const FileScanInfo&)> func)
+    {
+        using QueryResultType = std::tuple<TrackId, DirectoryId, std::string, Wt::WDateTime, int, MediaLibraryId, long long, std::optional<long long>>;
+        session.checkReadTransaction();
+
+        DirectoryPathResolver directoryPathResolver{ session };
+
+        auto query{ session.getDboSession().query<QueryResultType>("SELECT id, directory_id, file_name, file_last_write, scan_version, media_library_id, file_size, content_fingerprint FROM track") };
+        Utils::execQuery<QueryResultType>(query, std::nullopt, [&](const QueryResultType& queryResult)
             {
-                return PathResult{ std::get<TrackId>(queryResult), std::move(std::get<std::string>(queryResult)) };
+                const std::optional<long long>& contentFingerprint{ std::get<7>(queryResult) };
+                func(FileScanInfo{ std::get<0>(queryResult), directoryPathResolver.getPath(std::get<1>(queryResult)) / std::get<2>(queryResult), std::get<3>(queryResult), static_cast<std::size_t>(std::get<4>(queryResult)), std::get<5>(queryResult),
+                    static_cast<std::uintmax_t>(std::get<6>(queryResult)), contentFingerprint ? std::optional<std::uint32_t>{ static_cast<std::uint32_t>(*contentFingerprint) } : std::nullopt });
             });
+    }
 
-        return res;
+    void Track::findNames(Session& session, std::function<void(TrackId, std::string_view name)> func)
+    {
+        using QueryResultType = std::tuple<TrackId, std::string>;
+        session.checkReadTransaction();
+
+        auto query{ session.getDboSession().query<QueryResultType>("SELECT id, name FROM track").orderBy("name_sort_key, id") };
+        Utils::execQuery<QueryResultType>(query, std::nullopt, [&](const QueryResultType& queryResult)
+            {
+                func(std::get<0>(queryResult), std::get<1>(queryResult));
+            });
     }
 
-    RangeResults<TrackId> Track::findIdsTrackMBIDDuplicates(Session& session, std::optional<Range> range)
+    std::vector<Track::MBIDDuplicates> Track::findTrackMBIDDuplicates(Session& session, std::int64_t afterChangeId, const std::optional<UUID>& afterMBID, std::size_t maxCount)
     {
+        using QueryResultType = std::tuple<MBIDBlob, std::string>;
         session.checkReadTransaction();
 
-        auto query{ session.getDboSession().query<TrackId>("SELECT track.id FROM track WHERE mbid in (SELECT mbid FROM track WHERE mbid <> '' GROUP BY mbid HAVING COUNT (*) > 1)")
-            .orderBy("track.release_id,track.disc_number,track.track_number,track.mbid") };
+        // the changed tracks only select the MBIDs to check, each MBID is reported along with all its tracks
+        auto query{ session.getDboSession().query<QueryResultType>("SELECT t.mbid, GROUP_CONCAT(t.id) FROM track t")
+            .where("t.mbid IN (SELECT c_t.mbid FROM catalogue_change c_c INNER JOIN track c_t ON c_t.id = c_c.entity_id WHERE c_c.entity_type = ? AND c_c.removed = 0 AND c_c.id > ? AND LENGTH(c_t.mbid) > 0)")
+            .bind(static_cast<int>(CatalogueChange::EntityType::Track))
+            .bind(static_cast<long long>(afterChangeId))
+            .groupBy("t.mbid")
+            .having("COUNT(*) > 1")
+            .orderBy("t.mbid") };
 
-        return Utils::execQuery<TrackId>(query, range);
+        if (afterMBID)
+            query.where("t.mbid > ?").bind(toMBIDBlob(*afterMBID));
+
+        std::vector<MBIDDuplicates> res;
+        Utils::execQuery<QueryResultType>(query, Range{ 0, maxCount }, [&](const QueryResultType& queryResult)
+            {
+                std::optional<UUID> mbid{ fromMBIDBlob(std::get<MBIDBlob>(queryResult)) };
+                if (!mbid)
+                    return;
+
+                MBIDDuplicates duplicates{ std::move(*mbid), {} };
+                for (std::string_view trackId : StringUtils::splitString(std::get<std::string>(queryResult), ','))
+                {
+                    if (const std::optional<TrackId::ValueType> value{ StringUtils::readAs<TrackId::ValueType>(trackId) })
+                        duplicates.trackIds.push_back(TrackId{ *value });
+                }
+                std::sort(std::begin(duplicates.trackIds), std::end(duplicates.trackIds));
+
+                res.push_back(std::move(duplicates));
+            });
+
+        return res;
     }
 
-    RangeResults<TrackId> Track::findIdsWithRecordingMBIDAndMissingFeatures(Session& session, std::optional<Range> range)
+    RangeResults<Track::MBIDResult> Track::findRecordingMBIDsWithMissingFeatures(Session& session, std::optional<Range> range)
     {
+        using QueryResultType = std::tuple<TrackId, MBIDBlob>;
         session.checkReadTransaction();
 
-        auto query{ session.getDboSession().query<TrackId>("SELECT t.id FROM track t")
+        auto query{ session.getDboSession().query<QueryResultType>("SELECT t.id, t.recording_mbid FROM track t")
             .where("LENGTH(t.recording_mbid) > 0")
-            .where("NOT EXISTS (SELECT * FROM track_features t_f WHERE t_f.track_id = t.id)") };
+            .where("NOT EXISTS (SELECT 1 FROM track_features t_f WHERE t_f.track_id = t.id)")
+            .orderBy("t.id") };
 
-        return Utils::execQuery<TrackId>(query, range);
+        RangeResults<QueryResultType> queryResults{ Utils::execQuery<QueryResultType>(query, range) };
+
+        RangeResults<MBIDResult> res;
+        res.range = queryResults.range;
+        res.moreResults = queryResults.moreResults;
+        res.results.reserve(queryResults.results.size());
+
+        for (const QueryResultType& queryResult : queryResults.results)
+        {
+            if (std::optional<UUID> recordingMBID{ fromMBIDBlob(std::get<MBIDBlob>(queryResult)) })
+                res.results.push_back(MBIDResult{ std::get<TrackId>(queryResult), std::move(*recordingMBID) });
+        }
+
+        return res;
+    }
+
+    std::filesystem::path Track::getPath() const
+    {
+        return _directory->getPath() / _fileName;
     }
 
     std::vector<Cluster::pointer> Track::getClusters() const
@@ -324,23 +727,102 @@ namespace Database
         session.checkReadTransaction();
 
         auto query{ createQuery<TrackId>(session, parameters) };
-        return Utils::execQuery<TrackId>(query, parameters.range);
+        if (parameters.sortMethod == TrackSortMethod::Random)
+            return Utils::execRandomQuery<TrackId>(query, parameters.range);
+
+        RangeResults<TrackId> res{ Utils::execQuery<TrackId>(query, parameters.range, parameters.cursor) };
+        if (const auto sortKeyColumn{ getCursorSortKeyColumn(parameters.sortMethod) })
+            Utils::setNextCursor(session.getDboSession(), res, "track", *sortKeyColumn);
+
+        return res;
     }
 
     RangeResults<Track::pointer> Track::find(Session& session, const FindParameters& parameters)
     {
         session.checkReadTransaction();
 
+        // only load the picked tracks
+        if (parameters.sortMethod == TrackSortMethod::Random)
+            return Utils::findByIds<Track>(session.getDboSession(), findIds(session, parameters));
+
         auto query{ createQuery<Wt::Dbo::ptr<Track>>(session, parameters) };
-        return Utils::execQuery<Track::pointer>(query, parameters.range);
+        RangeResults<Track::pointer> res{ Utils::execQuery<Track::pointer>(query, parameters.range, parameters.cursor) };
+        if (const auto sortKeyColumn{ getCursorSortKeyColumn(parameters.sortMethod) })
+            Utils::setNextCursor(session.getDboSession(), res, "track", *sortKeyColumn);
+
+        return res;
     }
 
     void Track::find(Session& session, const FindParameters& params, std::function<void(const Track::pointer&)> func)
     {
         session.checkReadTransaction();
 
+        if (params.sortMethod == TrackSortMethod::Random)
+        {
+            for (const Track::pointer& track : find(session, params).results)
+                func(track);
+            return;
+        }
+
         auto query{ createQuery<Wt::Dbo::ptr<Track>>(session, params)};
-        Utils::execQuery(query, params.range, func);
+        Utils::execQuery(query, params.range, params.cursor, func);
+    }
+
+    void Track::findSummaries(Session& session, const FindParameters& params, std::function<void(const Summary&)> func)
+    {
+        using QueryResultType = std::tuple<TrackId, DirectoryId, std::string, std::chrono::duration<int, std::milli>, ReleaseId>;
+        session.checkReadTransaction();
+
+        DirectoryPathResolver directoryPathResolver{ session };
+
+        auto query{ createQuery<QueryResultType>(session, "t.id, t.directory_id, t.file_name, t.duration, t.release_id", params) };
+        auto visitResult{ [&](const QueryResultType& queryResult)
+            {
+                func(Summary{ std::get<0>(queryResult), directoryPathResolver.getPath(std::get<1>(queryResult)) / std::get<2>(queryResult), std::get<3>(queryResult), std::get<4>(queryResult) });
+            } };
+
+        if (params.sortMethod == TrackSortMethod::Random)
+        {
+            for (const QueryResultType& queryResult : Utils::execRandomQuery<QueryResultType>(query, params.range).results)
+                visitResult(queryResult);
+            return;
+        }
+
+        Utils::execQuery<QueryResultType>(query, params.range, params.cursor, visitResult);
+    }
+
+    void Track::findArtistLinkIds(Session& session, std::function<void(const ArtistLinkIds&)> func)
+    {
+        using QueryResultType = std::tuple<TrackId, ReleaseId, ArtistId, TrackArtistLinkType>;
+        session.checkReadTransaction();
+
+        auto query{ session.getDboSession().query<QueryResultType>("SELECT t.id, t.release_id, t_a_l.artist_id, t_a_l.type FROM track t LEFT JOIN track_artist_link t_a_l ON t_a_l.track_id = t.id")
+            .orderBy("t.id") };
+
+        Utils::execQuery<QueryResultType>(query, std::nullopt, [&](const QueryResultType& queryResult)
+            {
+                func(ArtistLinkIds{ std::get<0>(queryResult), std::get<1>(queryResult), std::get<2>(queryResult), std::get<3>(queryResult) });
+            });
+    }
+
+    void Track::findArtistLinkIds(Session& session, std::span<const TrackId> tracks, std::function<void(const ArtistLinkIds&)> func)
+    {
+        using QueryResultType = std::tuple<TrackId, ReleaseId, ArtistId, TrackArtistLinkType>;
+        session.checkReadTransaction();
+
+        Utils::forEachBindChunk(tracks, [&](std::span<const TrackId> trackChunk)
+            {
+                auto query{ session.getDboSession().query<QueryResultType>("SELECT t.id, t.release_id, t_a_l.artist_id, t_a_l.type FROM track t LEFT JOIN track_artist_link t_a_l ON t_a_l.track_id = t.id")
+                    .where("t.id IN (" + Utils::createBindPlaceholders(trackChunk.size()) + ")")
+                    .orderBy("t.id") };
+                for (const TrackId trackId : trackChunk)
+                    query.bind(trackId);
+
+                Utils::execQuery<QueryResultType>(query, std::nullopt, [&](const QueryResultType& queryResult)
+                    {
+                        func(ArtistLinkIds{ std::get<0>(queryResult), std::get<1>(queryResult), std::get<2>(queryResult), std::get<3>(queryResult) });
+                    });
+            });
     }
 
     RangeResults<TrackId> Track::findSimilarTrackIds(Session& session, const std::vector<TrackId>& tracks, std::optional<Range> range)
@@ -373,6 +855,12 @@ namespace Database
         return Utils::execQuery<TrackId>(query, range);
     }
 
+    void Track::setName(const std::string& name)
+    {
+        _name = std::string(name, 0, _maxNameLength);
+        _nameSortKey = StringUtils::computeSortKey(_name);
+    }
+
     void Track::clearArtistLinks()
     {
         _trackArtistLinks.clear();
@@ -390,14 +878,25 @@ namespace Database
             _clusters.insert(getDboPtr(cluster));
     }
 
-    std::optional<std::string> Track::getCopyright() const
+    Track::ExtraInfo Track::getExtraInfo() const
     {
-        return _copyright != "" ? std::make_optional<std::string>(_copyright) : std::nullopt;
-    }
+        assert(session());
 
-    std::optional<std::string> Track::getCopyrightURL() const
-    {
-        return _copyrightURL != "" ? std::make_optional<std::string>(_copyrightURL) : std::nullopt;
+        using ResultType = std::tuple<std::string, std::string, std::string>;
+        auto results{ session()->query<ResultType>("SELECT disc_subtitle, copyright, copyright_url FROM track_extra")
+            .where("track_id = ?").bind(getId())
+            .resultList() };
+
+        ExtraInfo extraInfo;
+        if (!results.empty())
+        {
+            const ResultType& result{ results.front() };
+            extraInfo.discSubtitle = std::get<0>(result);
+            extraInfo.copyright = std::get<1>(result);
+            extraInfo.copyrightURL = std::get<2>(result);
+        }
+
+        return extraInfo;
     }
 
     std::vector<Artist::pointer> Track::getArtists(EnumSet<TrackArtistLinkType> linkTypes) const
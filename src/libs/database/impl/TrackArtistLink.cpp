@@ -55,9 +55,47 @@ namespace Database
         }
     }
 
-    TrackArtistLink::TrackArtistLink(ObjectPtr<Track> track, ObjectPtr<Artist> artist, TrackArtistLinkType type, std::string_view subType)
+    TrackArtistLinkSubType::TrackArtistLinkSubType(std::string_view name)
+        : _name{ std::string(name, 0, _maxNameLength) }
+    {
+    }
+
+    TrackArtistLinkSubType::pointer TrackArtistLinkSubType::create(Session& session, std::string_view name)
+    {
+        return session.getDboSession().add(std::unique_ptr<TrackArtistLinkSubType>{ new TrackArtistLinkSubType{ name } });
+    }
+
+    TrackArtistLinkSubType::pointer TrackArtistLinkSubType::find(Session& session, TrackArtistLinkSubTypeId id)
+    {
+        session.checkReadTransaction();
+
+        return Utils::findById<TrackArtistLinkSubType>(session.getDboSession(), id);
+    }
+
+    TrackArtistLinkSubType::pointer TrackArtistLinkSubType::find(Session& session, std::string_view name)
+    {
+        session.checkReadTransaction();
+
+        return session.getDboSession()
+            .find<TrackArtistLinkSubType>()
+            .where("name = ?").bind(std::string(name, 0, _maxNameLength))
+            .resultValue();
+    }
+
+    TrackArtistLinkSubType::pointer TrackArtistLinkSubType::getOrCreate(Session& session, std::string_view name)
+    {
+        session.checkWriteTransaction();
+
+        pointer subType{ find(session, name) };
+        if (!subType)
+            subType = create(session, name);
+
+        return subType;
+    }
+
+    TrackArtistLink::TrackArtistLink(ObjectPtr<Track> track, ObjectPtr<Artist> artist, TrackArtistLinkType type, ObjectPtr<TrackArtistLinkSubType> subType)
         : _type{ type }
-        , _subType{ subType }
+        , _subType{ getDboPtr(subType) }
         , _track{ getDboPtr(track) }
         , _artist{ getDboPtr(artist) }
     {
@@ -67,6 +105,13 @@ namespace Database
     {
         session.checkWriteTransaction();
 
+        return create(session, track, artist, type, subType.empty() ? TrackArtistLinkSubType::pointer{} : TrackArtistLinkSubType::getOrCreate(session, subType));
+    }
+
+    TrackArtistLink::pointer TrackArtistLink::create(Session& session, ObjectPtr<Track> track, ObjectPtr<Artist> artist, TrackArtistLinkType type, ObjectPtr<TrackArtistLinkSubType> subType)
+    {
+        session.checkWriteTransaction();
+
         TrackArtistLink::pointer res{ session.getDboSession().add(std::make_unique<TrackArtistLink>(track, artist, type, subType)) };
         session.getDboSession().flush();
 
@@ -76,7 +121,7 @@ namespace Database
     TrackArtistLink::pointer TrackArtistLink::find(Session& session, TrackArtistLinkId id)
     {
         session.checkReadTransaction();
-        return session.getDboSession().find<TrackArtistLink>().where("id = ?").bind(id).resultValue();
+        return Utils::findById<TrackArtistLink>(session.getDboSession(), id);
     }
 
     RangeResults<TrackArtistLinkId> TrackArtistLink::find(Session& session, const FindParameters& params)
@@ -87,6 +132,24 @@ namespace Database
         return Utils::execQuery<TrackArtistLinkId>(query, params.range);
     }
 
+    void TrackArtistLink::find(Session& session, std::span<const TrackId> tracks, std::function<void(TrackId track, const pointer& link, const ObjectPtr<Artist>& artist)> func)
+    {
+        session.checkReadTransaction();
+
+        Utils::forEachBindChunk(tracks, [&](std::span<const TrackId> trackChunk)
+            {
+                auto query{ session.getDboSession().query<std::tuple<TrackId, Wt::Dbo::ptr<TrackArtistLink>, Wt::Dbo::ptr<Artist>>>("SELECT t_a_l.track_id, t_a_l, a FROM track_artist_link t_a_l")
+                    .join("artist a ON a.id = t_a_l.artist_id")
+                    .where("t_a_l.track_id IN (" + Utils::createBindPlaceholders(trackChunk.size()) + ")")
+                    .orderBy("t_a_l.track_id, t_a_l.id") };
+                for (const TrackId trackId : trackChunk)
+                    query.bind(trackId);
+
+                for (const auto& [trackId, link, artist] : query.resultList())
+                    func(trackId, link, artist);
+            });
+    }
+
     EnumSet<TrackArtistLinkType> TrackArtistLink::findUsedTypes(Session& session)
     {
         session.checkReadTransaction();
@@ -69,9 +69,7 @@ namespace Database {
     {
         session.checkReadTransaction();
 
-        return session.getDboSession().find<TrackBookmark>()
-            .where("id = ?").bind(id)
-            .resultValue();
+        return Utils::findById<TrackBookmark>(session.getDboSession(), id);
     }
 
 } // namespace Database
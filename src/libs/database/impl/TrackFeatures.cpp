@@ -19,6 +19,8 @@
 
 #include "database/TrackFeatures.hpp"
 
+#include <cstring>
+
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/json_parser.hpp>
 
@@ -52,9 +54,7 @@ namespace Database {
     {
         session.checkReadTransaction();
 
-        return session.getDboSession().find<TrackFeatures>()
-            .where("id = ?").bind(id)
-            .resultValue();
+        return Utils::findById<TrackFeatures>(session.getDboSession(), id);
     }
 
     TrackFeatures::pointer TrackFeatures::find(Session& session, TrackId trackId)
@@ -75,6 +75,43 @@ namespace Database {
         return Utils::execQuery<TrackFeaturesId>(query, range);
     }
 
+    void TrackFeatures::findRawFeatures(Session& session, TrackFeaturesId& lastRetrievedId, std::size_t count, long long packedFeaturesVersion, std::function<void(RawFeatures&&)> func)
+    {
+        using QueryResultType = std::tuple<TrackFeaturesId, TrackId, std::string, std::vector<unsigned char>>;
+        session.checkReadTransaction();
+
+        auto query{ session.getDboSession().query<QueryResultType>(
+            "SELECT id, track_id,"
+            " CASE WHEN packed_features_version = ? THEN '' ELSE data END,"
+            " CASE WHEN packed_features_version = ? THEN packed_features ELSE x'' END"
+            " FROM track_features")
+            .bind(packedFeaturesVersion)
+            .bind(packedFeaturesVersion)
+            .orderBy("id")
+            .limit(static_cast<int>(count)) };
+        if (lastRetrievedId.isValid())
+            query.where("id > ?").bind(lastRetrievedId);
+
+        for (auto& queryResult : query.resultList())
+        {
+            lastRetrievedId = std::get<0>(queryResult);
+
+            const std::vector<unsigned char>& packedData{ std::get<3>(queryResult) };
+            std::vector<float> packedFeatures(packedData.size() / sizeof(float));
+            std::memcpy(packedFeatures.data(), packedData.data(), packedFeatures.size() * sizeof(float));
+
+            func(RawFeatures{ std::get<0>(queryResult), std::get<1>(queryResult), std::move(std::get<2>(queryResult)), std::move(packedFeatures) });
+        }
+    }
+
+    void TrackFeatures::updatePackedFeatures(Session& session, TrackFeaturesId id, std::span<const float> packedFeatures, long long packedFeaturesVersion)
+    {
+        session.checkWriteTransaction();
+
+        const std::vector<unsigned char> packedData(reinterpret_cast<const unsigned char*>(packedFeatures.data()), reinterpret_cast<const unsigned char*>(packedFeatures.data() + packedFeatures.size()));
+        session.getDboSession().execute("UPDATE track_features SET packed_features = ?, packed_features_version = ? WHERE id = ?").bind(packedData).bind(packedFeaturesVersion).bind(id);
+    }
+
     FeatureValues TrackFeatures::getFeatureValues(const FeatureName& featureNode) const
     {
         FeatureValuesMap featuresValuesMap{ getFeatureValuesMap({featureNode}) };
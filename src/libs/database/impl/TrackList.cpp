@@ -18,7 +18,11 @@
  */
 #include "database/TrackList.hpp"
 
+#include <algorithm>
 #include <cassert>
+#include <span>
+#include <tuple>
+#include <utility>
 
 #include "utils/ILogger.hpp"
 
@@ -58,6 +62,28 @@ namespace Database
         return session.getDboSession().query<int>("SELECT COUNT(*) FROM tracklist");
     }
 
+    void TrackList::updateAggregates(Session& session)
+    {
+        session.checkWriteTransaction();
+
+        Wt::Dbo::Session& dboSession{ session.getDboSession() };
+        dboSession.flush();
+
+        // Only write the tracklists whose aggregates actually changed
+        dboSession.execute(
+            "UPDATE tracklist SET track_count = stats.track_count, duration = stats.duration"
+            " FROM (SELECT p_e.tracklist_id AS tracklist_id, COUNT(p_e.id) AS track_count, COALESCE(SUM(t.duration), 0) AS duration"
+                " FROM tracklist_entry p_e INNER JOIN track t ON t.id = p_e.track_id"
+                " GROUP BY p_e.tracklist_id) AS stats"
+            " WHERE tracklist.id = stats.tracklist_id AND (tracklist.track_count IS NOT stats.track_count OR tracklist.duration IS NOT stats.duration)");
+
+        dboSession.execute(
+            "UPDATE tracklist SET track_count = 0, duration = 0"
+            " WHERE (track_count <> 0 OR duration <> 0) AND NOT EXISTS (SELECT 1 FROM tracklist_entry p_e WHERE p_e.tracklist_id = tracklist.id)");
+
+        // Loaded tracklists are now outdated
+        dboSession.rereadAll("tracklist");
+    }
 
     TrackList::pointer TrackList::find(Session& session, std::string_view name, TrackListType type, UserId userId)
     {
@@ -87,22 +113,29 @@ namespace Database
             query.join("tracklist_entry t_l_e ON t_l_e.tracklist_id = t_l.id");
             query.join("track t ON t.id = t_l_e.track_id");
 
-            std::ostringstream oss;
-            oss << "t.id IN (SELECT DISTINCT t.id FROM track t"
-                " INNER JOIN track_cluster t_c ON t_c.track_id = t.id"
-                " INNER JOIN cluster c ON c.id = t_c.cluster_id";
-
-            WhereClause clusterClause;
-            for (const ClusterId clusterId : params.clusters)
+            if (const auto snapshotClause{ Utils::createTracksInAllClustersClause(session, "t.id", params.clusters) })
             {
-                clusterClause.Or(WhereClause("c.id = ?"));
-                query.bind(clusterId);
+                query.where(*snapshotClause);
+            }
+            else
+            {
+                std::ostringstream oss;
+                oss << "t.id IN (SELECT DISTINCT t.id FROM track t"
+                    " INNER JOIN track_cluster t_c ON t_c.track_id = t.id"
+                    " INNER JOIN cluster c ON c.id = t_c.cluster_id";
+
+                WhereClause clusterClause;
+                for (const ClusterId clusterId : params.clusters)
+                {
+                    clusterClause.Or(WhereClause("c.id = ?"));
+                    query.bind(clusterId);
+                }
+
+                oss << " " << clusterClause.get();
+                oss << " GROUP BY t.id HAVING COUNT(*) = " << params.clusters.size() << ")";
+
+                query.where(oss.str());
             }
-
-            oss << " " << clusterClause.get();
-            oss << " GROUP BY t.id HAVING COUNT(*) = " << params.clusters.size() << ")";
-
-            query.where(oss.str());
         }
 
         switch (params.sortMethod)
@@ -124,7 +157,7 @@ namespace Database
     {
         session.checkReadTransaction();
 
-        return session.getDboSession().find<TrackList>().where("id = ?").bind(id).resultValue();
+        return Utils::findById<TrackList>(session.getDboSession(), id);
     }
 
     bool TrackList::isEmpty() const
@@ -132,11 +165,6 @@ namespace Database
         return _entries.empty();
     }
 
-    std::size_t TrackList::getCount() const
-    {
-        return _entries.size();
-    }
-
     TrackListEntry::pointer TrackList::getEntry(std::size_t pos) const
     {
         TrackListEntry::pointer res;
@@ -275,26 +303,157 @@ namespace Database
         assert(session());
 
         Wt::Dbo::collection<TrackId> res = session()->query<TrackId>("SELECT p_e.track_id from tracklist_entry p_e INNER JOIN tracklist p ON p_e.tracklist_id = p.id")
-            .where("p.id = ?").bind(getId());
+            .where("p.id = ?").bind(getId())
+            .orderBy("p_e.id");
 
         return std::vector<TrackId>(res.begin(), res.end());
     }
 
-    std::chrono::milliseconds TrackList::getDuration() const
+    void TrackList::setLastModifiedDateTime(const Wt::WDateTime& dateTime)
+    {
+        _lastModifiedDateTime = Utils::normalizeDateTime(dateTime);
+    }
+
+    void TrackList::clear()
+    {
+        _entries.clear();
+        _trackCount = 0;
+        _duration = 0;
+    }
+
+    void TrackList::refreshAggregates()
     {
         assert(session());
 
-        using milli = std::chrono::duration<int, std::milli>;
+        using ResultType = std::tuple<int, long long>;
+        const ResultType res{ session()->query<ResultType>("SELECT COUNT(p_e.id), COALESCE(SUM(t.duration), 0) FROM tracklist_entry p_e INNER JOIN track t ON t.id = p_e.track_id")
+            .where("p_e.tracklist_id = ?").bind(getId())
+            .resultValue() };
 
-        Wt::Dbo::Query<milli> query{ session()->query<milli>("SELECT COALESCE(SUM(duration), 0) FROM track t INNER JOIN tracklist_entry p_e ON t.id = p_e.track_id")
-                .where("p_e.tracklist_id = ?").bind(getId()) };
+        _trackCount = std::get<0>(res);
+        _duration = std::get<1>(res);
+    }
+
+    void TrackList::appendTracks(const std::vector<TrackId>& trackIds)
+    {
+        assert(session());
 
-        return query.resultValue();
+        if (trackIds.empty())
+            return;
+
+        session()->flush();
+
+        // entries are ordered by id: insert the rows in the requested order
+        Utils::forEachBindChunk(std::span<const TrackId>{ trackIds }, [&](std::span<const TrackId> chunk)
+            {
+                std::ostringstream oss;
+                oss << "WITH new_entry(pos, track_id) AS (VALUES ";
+                for (std::size_t i{}; i < chunk.size(); ++i)
+                    oss << (i > 0 ? ", " : "") << "(" << i << ", ?)";
+                oss << ") INSERT INTO tracklist_entry (version, track_id, tracklist_id)"
+                    " SELECT 0, t.id, " << getId().getValue() << " FROM new_entry"
+                    " INNER JOIN track t ON t.id = new_entry.track_id"
+                    " ORDER BY new_entry.pos";
+
+                auto call{ session()->execute(oss.str()) };
+                for (const TrackId trackId : chunk)
+                    call.bind(trackId);
+                call.run();
+            });
+
+        refreshAggregates();
+        setLastModifiedDateTime(Wt::WDateTime::currentDateTime());
     }
 
-    void TrackList::setLastModifiedDateTime(const Wt::WDateTime& dateTime)
+    void TrackList::replaceTracks(const std::vector<TrackId>& trackIds)
     {
-        _lastModifiedDateTime = Utils::normalizeDateTime(dateTime);
+        assert(session());
+
+        session()->flush();
+        session()->execute("DELETE FROM tracklist_entry WHERE tracklist_id = ?").bind(getId());
+        // Loaded entries may have been removed
+        session()->rereadAll("tracklist_entry");
+        _trackCount = 0;
+        _duration = 0;
+
+        appendTracks(trackIds);
+        setLastModifiedDateTime(Wt::WDateTime::currentDateTime());
+    }
+
+    void TrackList::removeEntries(const std::vector<std::size_t>& positions)
+    {
+        assert(session());
+
+        if (positions.empty())
+            return;
+
+        session()->flush();
+
+        // resolve all the positions first, since removing entries shifts the next ones
+        const auto allEntryIds{ session()->query<TrackListEntryId>("SELECT id FROM tracklist_entry")
+            .where("tracklist_id = ?").bind(getId())
+            .orderBy("id")
+            .resultList() };
+        const std::vector<TrackListEntryId> entryIds(allEntryIds.begin(), allEntryIds.end());
+
+        std::vector<TrackListEntryId> entryIdsToRemove;
+        for (const std::size_t position : positions)
+        {
+            if (position < entryIds.size())
+                entryIdsToRemove.push_back(entryIds[position]);
+        }
+
+        if (entryIdsToRemove.empty())
+            return;
+
+        Utils::forEachBindChunk(std::span<const TrackListEntryId>{ entryIdsToRemove }, [&](std::span<const TrackListEntryId> chunk)
+            {
+                auto call{ session()->execute("DELETE FROM tracklist_entry WHERE id IN (" + Utils::createBindPlaceholders(chunk.size()) + ")") };
+                for (const TrackListEntryId entryId : chunk)
+                    call.bind(entryId);
+                call.run();
+            });
+
+        // Loaded entries may have been removed
+        session()->rereadAll("tracklist_entry");
+        refreshAggregates();
+        setLastModifiedDateTime(Wt::WDateTime::currentDateTime());
+    }
+
+    void TrackList::moveEntry(std::size_t fromPos, std::size_t toPos)
+    {
+        assert(session());
+
+        if (fromPos == toPos)
+            return;
+
+        const std::size_t firstPos{ std::min(fromPos, toPos) };
+        const std::size_t entryCount{ std::max(fromPos, toPos) - firstPos + 1 };
+
+        std::vector<TrackListEntry::pointer> entries{ getEntries(Range{ firstPos, entryCount }) };
+        if (entries.size() < entryCount)
+            return;
+        entries.resize(entryCount);
+
+        // Entries are ordered by id: keep the ids in place and rotate the contents of the affected entries
+        std::vector<std::pair<Wt::Dbo::ptr<Track>, Wt::WDateTime>> contents;
+        contents.reserve(entries.size());
+        for (const TrackListEntry::pointer& entry : entries)
+            contents.emplace_back(entry->_track, entry->_dateTime);
+
+        if (fromPos < toPos)
+            std::rotate(std::begin(contents), std::begin(contents) + 1, std::end(contents));
+        else
+            std::rotate(std::rbegin(contents), std::rbegin(contents) + 1, std::rend(contents));
+
+        for (std::size_t i{}; i < entries.size(); ++i)
+        {
+            TrackListEntry* entry{ entries[i].modify() };
+            entry->_track = contents[i].first;
+            entry->_dateTime = contents[i].second;
+        }
+
+        setLastModifiedDateTime(Wt::WDateTime::currentDateTime());
     }
 
     TrackListEntry::TrackListEntry(ObjectPtr<Track> track, ObjectPtr<TrackList> tracklist, const Wt::WDateTime& dateTime)
@@ -313,19 +472,28 @@ namespace Database
 
     void TrackListEntry::onPostCreated()
     {
-        _tracklist.modify()->setLastModifiedDateTime(Utils::normalizeDateTime(Wt::WDateTime::currentDateTime()));
+        TrackList* tracklist{ _tracklist.modify() };
+        tracklist->setLastModifiedDateTime(Utils::normalizeDateTime(Wt::WDateTime::currentDateTime()));
+        tracklist->_trackCount++;
+        tracklist->_duration += _track->getDuration().count();
     }
 
     void TrackListEntry::onPreRemove()
     {
-        _tracklist.modify()->setLastModifiedDateTime(Utils::normalizeDateTime(Wt::WDateTime::currentDateTime()));
+        TrackList* tracklist{ _tracklist.modify() };
+        tracklist->setLastModifiedDateTime(Utils::normalizeDateTime(Wt::WDateTime::currentDateTime()));
+        if (tracklist->_trackCount > 0)
+        {
+            tracklist->_trackCount--;
+            tracklist->_duration = std::max<long long>(tracklist->_duration - _track->getDuration().count(), 0);
+        }
     }
 
     TrackListEntry::pointer TrackListEntry::getById(Session& session, TrackListEntryId id)
     {
         session.checkReadTransaction();
 
-        return session.getDboSession().find<TrackListEntry>().where("id = ?").bind(id).resultValue();
+        return Utils::findById<TrackListEntry>(session.getDboSession(), id);
     }
 
 } // namespace Database
@@ -68,6 +68,8 @@ namespace Database
     {
 #if LMS_CHECK_TRANSACTION_ACCESSES
         assert(transactionStack.empty() || transactionStack.back().session == &session);
+        // read transactions use read only connections: cannot write from there
+        assert(type != TransactionType::Write || transactionStack.empty() || transactionStack.back().type == TransactionType::Write);
         transactionStack.push_back(StackEntry{ type, &session });
 #endif // LMS_CHECK_TRANSACTION_ACCESSES
     }
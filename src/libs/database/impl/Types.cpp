@@ -47,5 +47,15 @@ namespace Database
     {
         return DateRange{ from, to };
     }
+
+    MonthRange MonthRange::fromMonth(int year, int month)
+    {
+        return MonthRange{ year * 100 + month, year * 100 + month };
+    }
+
+    MonthRange MonthRange::fromYear(int year)
+    {
+        return MonthRange{ year * 100 + 1, year * 100 + 12 };
+    }
 }
 
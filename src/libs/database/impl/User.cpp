@@ -20,12 +20,14 @@
 #include "database/User.hpp"
 
 #include "database/Artist.hpp"
+#include "database/Db.hpp"
 #include "database/Release.hpp"
 #include "database/Session.hpp"
 #include "database/Track.hpp"
 #include "utils/ILogger.hpp"
 #include "IdTypeTraits.hpp"
 #include "StringViewTraits.hpp"
+#include "UserSettingsCache.hpp"
 #include "Utils.hpp"
 
 namespace Database {
@@ -70,7 +72,7 @@ namespace Database {
 
     User::pointer User::find(Session& session, UserId id)
     {
-        return session.getDboSession().find<User>().where("id = ?").bind(id).resultValue();
+        return Utils::findById<User>(session.getDboSession(), id);
     }
 
     User::pointer User::find(Session& session, std::string_view name)
@@ -80,12 +82,59 @@ namespace Database {
             .resultValue();
     }
 
+    std::optional<User::Settings> User::getSettings(Session& session, UserId id)
+    {
+        UserSettingsCache& cache{ session.getDb().getUserSettingsCache() };
+        if (std::optional<Settings> settings{ cache.get(id) })
+            return settings;
+
+        const std::uint64_t generation{ cache.getGeneration() };
+
+        std::optional<Settings> settings;
+        {
+            auto transaction{ session.createReadTransaction() };
+
+            const pointer user{ find(session, id) };
+            if (!user)
+                return std::nullopt;
+
+            settings = Settings{
+                user->getType(),
+                user->getFeedbackBackend(),
+                user->getScrobblingBackend(),
+                user->getSubsonicArtistListMode(),
+                user->getSubsonicEnableTranscodingByDefault(),
+                user->getSubsonicDefaultTranscodingOutputFormat(),
+                user->getSubsonicDefaultTranscodingOutputBitrate(),
+            };
+        }
+
+        cache.put(id, *settings, generation);
+        return settings;
+    }
+
+    void User::onPreModify()
+    {
+        Db::onUserModified();
+    }
+
     void User::setSubsonicDefaultTranscodingOutputBitrate(Bitrate bitrate)
     {
         assert(isAudioBitrateAllowed(bitrate));
         _subsonicDefaultTranscodingOutputBitrate = bitrate;
     }
 
+    void User::setListenBrainzToken(const std::optional<UUID>& MBID)
+    {
+        std::string token{ MBID ? MBID->getAsString() : "" };
+        if (token == _listenbrainzToken)
+            return;
+
+        // the feedbacks of the new account have never been fetched
+        _listenbrainzToken = std::move(token);
+        _listenbrainzFeedbacksSyncDateTime = {};
+    }
+
     void User::clearAuthTokens()
     {
         _authTokens.clear();
@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "UserSettingsCache.hpp"
+
+#include <mutex>
+
+namespace Database
+{
+    std::optional<User::Settings> UserSettingsCache::get(UserId userId) const
+    {
+        const std::shared_lock lock{ _mutex };
+
+        const auto it{ _settings.find(userId) };
+        if (it == std::cend(_settings))
+            return std::nullopt;
+
+        return it->second;
+    }
+
+    std::uint64_t UserSettingsCache::getGeneration() const
+    {
+        const std::shared_lock lock{ _mutex };
+        return _generation;
+    }
+
+    void UserSettingsCache::put(UserId userId, const User::Settings& settings, std::uint64_t generation)
+    {
+        const std::unique_lock lock{ _mutex };
+
+        if (generation != _generation) // a user has been modified meanwhile
+            return;
+
+        _settings.insert_or_assign(userId, settings);
+    }
+
+    void UserSettingsCache::invalidate()
+    {
+        const std::unique_lock lock{ _mutex };
+
+        _generation++;
+        _settings.clear();
+    }
+} // namespace Database
@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <shared_mutex>
+#include <unordered_map>
+
+#include "database/User.hpp"
+#include "database/UserId.hpp"
+
+namespace Database
+{
+    // Settings of the users read so far, cleared each time a user is modified
+    // Entries are tagged with the generation in use when their read started: stale reads are not cached
+    class UserSettingsCache
+    {
+    public:
+        UserSettingsCache() = default;
+
+        UserSettingsCache(const UserSettingsCache&) = delete;
+        UserSettingsCache& operator=(const UserSettingsCache&) = delete;
+
+        std::optional<User::Settings> get(UserId userId) const;
+        std::uint64_t getGeneration() const;
+        void put(UserId userId, const User::Settings& settings, std::uint64_t generation);
+
+        void invalidate();
+
+    private:
+        mutable std::shared_mutex _mutex;
+        std::uint64_t _generation{};
+        std::unordered_map<UserId, User::Settings> _settings;
+    };
+} // namespace Database
@@ -19,6 +19,11 @@
 
 #include "Utils.hpp"
 
+#include <algorithm>
+
+#include "database/CatalogueSnapshot.hpp"
+#include "database/Db.hpp"
+#include "database/Session.hpp"
 #include "utils/String.hpp"
 
 namespace Database::Utils
@@ -29,11 +34,166 @@ namespace Database::Utils
 		return StringUtils::escapeString(keyword, "%_", escapeChar);
 	}
 
+	bool
+	canUseFullTextSearch(const std::vector<std::string_view>& keywords)
+	{
+		if (keywords.empty())
+			return false;
+
+		return std::all_of(std::cbegin(keywords), std::cend(keywords), [](std::string_view keyword)
+		{
+			// count code points, not bytes
+			const std::size_t codePointCount {static_cast<std::size_t>(std::count_if(std::cbegin(keyword), std::cend(keyword), [](char c) { return (static_cast<unsigned char>(c) & 0xC0) != 0x80; }))};
+			return codePointCount >= minFullTextSearchKeywordSize;
+		});
+	}
+
+	std::string
+	createFullTextSearchQuery(const std::vector<std::string_view>& keywords)
+	{
+		std::string query;
+
+		for (std::string_view keyword : keywords)
+		{
+			if (!query.empty())
+				query += " AND ";
+
+			// each keyword is a quoted string, so that no FTS5 operator is interpreted
+			query += '"';
+			query += StringUtils::replaceInString(keyword, "\"", "\"\"");
+			query += '"';
+		}
+
+		return query;
+	}
+
+	std::string
+	createBindPlaceholders(std::size_t count)
+	{
+		std::string res;
+		res.reserve(count * 3);
+
+		for (std::size_t i {}; i < count; ++i)
+		{
+			if (i != 0)
+				res += ", ";
+			res += '?';
+		}
+
+		return res;
+	}
+
+	std::size_t
+	getChangeCount(Wt::Dbo::Session& session)
+	{
+		return session.query<long long>("SELECT changes()").resultValue();
+	}
+
+	Cursor
+	createCursor(Wt::Dbo::Session& session, std::string_view table, std::string_view sortKeyColumn, long long id)
+	{
+		const std::string sortKey {session.query<std::string>("SELECT " + std::string {sortKeyColumn} + " FROM " + std::string {table}).where("id = ?").bind(id).resultValue()};
+
+		return Cursor {sortKey, id};
+	}
+
+	std::pair<std::string, std::string>
+	getDirectoryPathRange(const std::filesystem::path& directory)
+	{
+		std::string directoryPath {directory.string()};
+		if (!directoryPath.empty() && directoryPath.back() == '/')
+			directoryPath.pop_back();
+
+		return {directoryPath + '/', directoryPath + '0'};
+	}
+
+	std::string
+	createDirectoryTreeCondition(std::string_view column, std::size_t directoryCount)
+	{
+		return std::string {column} + " IN ("
+			"WITH RECURSIVE d_t(id) AS ("
+			"SELECT id FROM directory WHERE id IN (" + createBindPlaceholders(directoryCount) + ")"
+			" UNION ALL"
+			" SELECT d.id FROM directory d INNER JOIN d_t ON d.parent_directory_id = d_t.id)"
+			" SELECT id FROM d_t)";
+	}
+
 	Wt::WDateTime
 	normalizeDateTime(const Wt::WDateTime& dateTime)
 	{
 		// force second resolution
 		return Wt::WDateTime::fromTime_t(dateTime.toTime_t());
 	}
+
+	std::optional<int>
+	computeSortDate(const Wt::WDate& date, std::optional<int> year)
+	{
+		if (date.isValid())
+			return date.year() * 10'000 + date.month() * 100 + date.day();
+		if (year)
+			return *year * 10'000;
+
+		return std::nullopt;
+	}
+
+	std::pair<int, int>
+	getSortDateRange(const DateRange& dateRange)
+	{
+		return {dateRange.begin * 10'000, dateRange.end * 10'000 + 9'999};
+	}
+
+	namespace
+	{
+		template <typename IdType>
+		std::optional<std::string>
+		createInClause(std::string_view column, const std::optional<std::vector<IdType>>& ids)
+		{
+			if (!ids || ids->size() > maxInlinedIdCount)
+				return std::nullopt;
+
+			std::string res {column};
+			res.reserve(column.size() + ids->size() * 8);
+			res += " IN (";
+			for (std::size_t i {}; i < ids->size(); ++i)
+			{
+				if (i != 0)
+					res += ", ";
+				res += std::to_string((*ids)[i].getValue());
+			}
+			res += ')';
+
+			return res;
+		}
+
+		std::shared_ptr<const CatalogueSnapshot>
+		getSnapshotForClusters(Session& session, std::span<const ClusterId> clusters)
+		{
+			// single cluster filters are already cheap using the track_cluster index
+			if (clusters.size() < 2)
+				return {};
+
+			return session.getDb().getCatalogueSnapshot();
+		}
+	}
+
+	std::optional<std::string>
+	createTracksInAllClustersClause(Session& session, std::string_view trackIdColumn, std::span<const ClusterId> clusters)
+	{
+		const auto snapshot {getSnapshotForClusters(session, clusters)};
+		if (!snapshot)
+			return std::nullopt;
+
+		return createInClause(trackIdColumn, snapshot->findTrackIdsInAllClusters(clusters));
+	}
+
+	std::optional<std::string>
+	createReleasesInAllClustersClause(Session& session, std::string_view releaseIdColumn, std::span<const ClusterId> clusters)
+	{
+		const auto snapshot {getSnapshotForClusters(session, clusters)};
+		if (!snapshot)
+			return std::nullopt;
+
+		return createInClause(releaseIdColumn, snapshot->findReleaseIdsInAllClusters(clusters));
+	}
 } // namespace Database::Utils
 
@@ -19,14 +19,30 @@
 
 #pragma once
 
+#include <algorithm>
+#include <filesystem>
 #include <functional>
+#include <limits>
+#include <optional>
+#include <random>
+#include <span>
 #include <string>
 #include <string_view>
+#include <utility>
+#include <vector>
 
 #include <Wt/Dbo/Dbo.h>
 #include <Wt/WDateTime.h>
 
+#include "database/ClusterId.hpp"
 #include "database/Types.hpp"
+#include "utils/ITraceLogger.hpp"
+#include "utils/Random.hpp"
+
+namespace Database
+{
+    class Session;
+}
 
 namespace Database::Utils
 {
@@ -34,6 +50,19 @@ namespace Database::Utils
     static inline constexpr char escapeChar{ '\\' };
     std::string escapeLikeKeyword(std::string_view keywords);
 
+    // Full text search indexes use the trigram tokenizer: keywords must be at least 3 characters long to be matched
+    static inline constexpr std::size_t minFullTextSearchKeywordSize{ 3 };
+    bool canUseFullTextSearch(const std::vector<std::string_view>& keywords);
+    std::string createFullTextSearchQuery(const std::vector<std::string_view>& keywords); // all keywords must match
+
+    // Bounds of the paths located in a directory, recursively: "directory/" <= path < "directory0" ('0' follows '/')
+    // Path indexes can be used with such ranges, unlike with LIKE patterns
+    std::pair<std::string, std::string> getDirectoryPathRange(const std::filesystem::path& directory);
+
+    // "column IN (...)" condition, true for the ids of the given directories and of all their sub directories, recursively (see Directory::findTreeIds)
+    // One bind argument is expected for each directory
+    std::string createDirectoryTreeCondition(std::string_view column, std::size_t directoryCount);
+
     template <typename Query>
     void applyRange(Query& query, std::optional<Range> range)
     {
@@ -47,6 +76,8 @@ namespace Database::Utils
     template <typename ResultType, typename Query>
     RangeResults<ResultType> execQuery(Query& query, std::optional<Range> range)
     {
+        LMS_SCOPED_TRACE_DETAILED("Database", "ExecQuery");
+
         RangeResults<ResultType> res;
 
         if (range)
@@ -72,6 +103,8 @@ namespace Database::Utils
     template <typename ResultType, typename Query>
     void execQuery(Query& query, std::optional<Range> range, std::function<void(const ResultType&)> func)
     {
+        LMS_SCOPED_TRACE_DETAILED("Database", "ExecQuery");
+
         if (range)
             applyRange(query, range);
 
@@ -79,6 +112,155 @@ namespace Database::Utils
             func(res);
     }
 
+    // Keyset pagination (see Cursor): the query must be sorted on the sort key column (NOCASE collation), then on the id column
+    template <typename Query>
+    void applyCursor(Query& query, std::string_view sortKeyColumn, std::string_view idColumn, const Cursor& cursor)
+    {
+        query.where("(" + std::string{ sortKeyColumn } + ", " + std::string{ idColumn } + ") > (?, ?)").bind(cursor.sortKey).bind(cursor.id);
+    }
+
+    // Same as execQuery, but the cursor (if any) replaces the range offset
+    template <typename ResultType, typename Query>
+    RangeResults<ResultType> execQuery(Query& query, std::optional<Range> range, const std::optional<Cursor>& cursor)
+    {
+        if (!cursor || !range)
+            return execQuery<ResultType>(query, range);
+
+        RangeResults<ResultType> res{ execQuery<ResultType>(query, Range{ 0, range->size }) };
+        res.range.offset = range->offset;
+        return res;
+    }
+
+    template <typename ResultType, typename Query>
+    void execQuery(Query& query, std::optional<Range> range, const std::optional<Cursor>& cursor, std::function<void(const ResultType&)> func)
+    {
+        if (cursor && range)
+            range->offset = 0;
+
+        execQuery<ResultType>(query, range, func);
+    }
+
+    // Cursor to resume after the given object
+    Cursor createCursor(Wt::Dbo::Session& session, std::string_view table, std::string_view sortKeyColumn, long long id);
+
+    // Set the cursor to resume after the last result, if any more results
+    template <typename ResultType>
+    void setNextCursor(Wt::Dbo::Session& session, RangeResults<ResultType>& res, std::string_view table, std::string_view sortKeyColumn)
+    {
+        if (!res.moreResults || res.results.empty())
+            return;
+
+        long long id;
+        if constexpr (requires { res.results.back()->getId(); })
+            id = res.results.back()->getId().getValue();
+        else
+            id = res.results.back().getValue();
+
+        res.nextCursor = createCursor(session, table, sortKeyColumn, id);
+    }
+
+    // Random order without sorting the whole result set (as "ORDER BY RANDOM()" does):
+    // results are sampled on the fly (reservoir sampling), only the requested range is kept in memory
+    template <typename ResultType, typename Query>
+    RangeResults<ResultType> execRandomQuery(Query& query, std::optional<Range> range)
+    {
+        LMS_SCOPED_TRACE_DETAILED("Database", "ExecRandomQuery");
+
+        // one more result to tell if there are more results
+        const std::size_t sampleSize{ range ? range->offset + range->size + 1 : std::numeric_limits<std::size_t>::max() };
+
+        std::vector<ResultType> samples;
+        std::size_t resultCount{};
+        for (const ResultType& result : query.resultList())
+        {
+            if (samples.size() < sampleSize)
+                samples.push_back(result);
+            else
+            {
+                std::uniform_int_distribution<std::size_t> dist{ 0, resultCount };
+                if (const std::size_t index{ dist(Random::getRandGenerator()) }; index < sampleSize)
+                    samples[index] = result;
+            }
+            ++resultCount;
+        }
+        Random::shuffleContainer(samples);
+
+        RangeResults<ResultType> res;
+        res.range.offset = range ? range->offset : 0;
+        if (res.range.offset < samples.size())
+        {
+            const std::size_t size{ std::min(samples.size() - res.range.offset, range ? range->size : samples.size()) };
+            res.results.assign(std::cbegin(samples) + res.range.offset, std::cbegin(samples) + res.range.offset + size);
+        }
+        res.range.size = res.results.size();
+        res.moreResults = resultCount > res.range.offset + res.range.size;
+
+        return res;
+    }
+
+    // Loads the objects in the order of the given ids
+    template <typename T, typename ObjectIdType>
+    RangeResults<typename T::pointer> findByIds(Wt::Dbo::Session& session, const RangeResults<ObjectIdType>& ids);
+
+    // Some SQLite builds are limited to 999 bind arguments per statement
+    static inline constexpr std::size_t maxBindArgCount{ 500 };
+    std::string createBindPlaceholders(std::size_t count); // "?, ?, ..."
+    std::size_t getChangeCount(Wt::Dbo::Session& session); // rows modified by the last statement
+
+    // call func for each chunk of at most maxBindArgCount values
+    template <typename T, typename Func>
+    void forEachBindChunk(std::span<const T> values, Func&& func)
+    {
+        for (std::size_t offset{}; offset < values.size(); offset += maxBindArgCount)
+            func(values.subspan(offset, std::min(maxBindArgCount, values.size() - offset)));
+    }
+
+    // Goes through the "select by id" statement Wt::Dbo prepares once per connection for each mapped class
+    // instead of building and compiling a query on each call. Objects already loaded in the session are not reread
+    template <typename T, typename ObjectIdType>
+    Wt::Dbo::ptr<T> findById(Wt::Dbo::Session& session, ObjectIdType id)
+    {
+        if (!id.isValid())
+            return {};
+
+        try
+        {
+            return session.load<T>(id.getValue());
+        }
+        catch (const Wt::Dbo::ObjectNotFoundException&)
+        {
+            return {};
+        }
+    }
+
+    template <typename T, typename ObjectIdType>
+    RangeResults<typename T::pointer> findByIds(Wt::Dbo::Session& session, const RangeResults<ObjectIdType>& ids)
+    {
+        RangeResults<typename T::pointer> res;
+        res.range = ids.range;
+        res.moreResults = ids.moreResults;
+
+        res.results.reserve(ids.results.size());
+        for (const ObjectIdType id : ids.results)
+        {
+            if (Wt::Dbo::ptr<T> object{ findById<T>(session, id) })
+                res.results.push_back(object);
+        }
+
+        return res;
+    }
+
     Wt::WDateTime normalizeDateTime(const Wt::WDateTime& dateTime);
+
+    // Date stored as an integer, so that date sorts and filters can use indexes: YYYYMMDD, MMDD = 0000 if only the year is known
+    std::optional<int> computeSortDate(const Wt::WDate& date, std::optional<int> year);
+    // Bounds of the sort dates within the years of the range
+    std::pair<int, int> getSortDateRange(const DateRange& dateRange);
+
+    // Multi-cluster filters resolved using the bitmaps of the published catalogue snapshot: "column IN (id1, id2, ...)"
+    // std::nullopt if the snapshot cannot answer (not published yet, unknown cluster, too many results): the caller must use SQL
+    static inline constexpr std::size_t maxInlinedIdCount{ 50'000 };
+    std::optional<std::string> createTracksInAllClustersClause(Session& session, std::string_view trackIdColumn, std::span<const ClusterId> clusters);
+    std::optional<std::string> createReleasesInAllClustersClause(Session& session, std::string_view releaseIdColumn, std::span<const ClusterId> clusters);
 } // namespace Database::Utils
 
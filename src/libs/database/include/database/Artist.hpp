@@ -20,6 +20,7 @@
 #pragma once
 
 #include <optional>
+#include <span>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -57,9 +58,10 @@ namespace Database
         {
             std::vector<ClusterId>				clusters;	// if non empty, at least one artist that belongs to these clusters
             std::vector<std::string_view>		keywords;	// if non empty, name must match all of these keywords (on either name field OR sort name field)
-            std::optional<TrackArtistLinkType>	linkType;	// if set, only artists that have produced at least one track with this link type
+            std::optional<TrackArtistLinkType>	linkType;	// if set, only artists that have produced at least one track with this link type (see updateLinkTypes)
             ArtistSortMethod					sortMethod{ ArtistSortMethod::None };
             std::optional<Range>				range;
+            std::optional<Cursor>				cursor;		// if set, resume after this cursor instead of using the range offset (ByName and BySortName sort methods only)
             Wt::WDateTime						writtenAfter;
             UserId								starringUser;	// only artists starred by this user
             std::optional<FeedbackBackend>		feedbackBackend; // and for this feedback backend
@@ -72,6 +74,7 @@ namespace Database
             FindParameters& setLinkType(std::optional<TrackArtistLinkType> _linkType) { linkType = _linkType; return *this; }
             FindParameters& setSortMethod(ArtistSortMethod _sortMethod) { sortMethod = _sortMethod; return *this; }
             FindParameters& setRange(std::optional<Range> _range) { range = _range; return *this; }
+            FindParameters& setCursor(const std::optional<Cursor>& _cursor) { cursor = _cursor; return *this; }
             FindParameters& setWrittenAfter(const Wt::WDateTime& _after) { writtenAfter = _after; return *this; }
             FindParameters& setStarringUser(UserId _user, FeedbackBackend _feedbackBackend) { starringUser = _user; feedbackBackend = _feedbackBackend; return *this; }
             FindParameters& setTrack(TrackId _track) { track = _track; return *this; }
@@ -86,16 +89,23 @@ namespace Database
         static pointer					find(Session& session, const UUID& MBID);
         static pointer					find(Session& session, ArtistId id);
         static std::vector<pointer>		find(Session& session, std::string_view name);		// exact match on name field
+        static std::vector<pointer>		findByMBIDs(Session& session, std::span<const UUID> MBIDs);
+        static std::vector<pointer>		findByNames(Session& session, std::span<const std::string> names);	// exact match on name field, MBID entries first
         static RangeResults<pointer>	find(Session& session, const FindParameters& parameters);
         static void					    find(Session& session, const FindParameters& parameters, std::function<void(const pointer&)> func);
         static RangeResults<ArtistId>	findIds(Session& session, const FindParameters& parameters);
         static RangeResults<ArtistId>	findOrphanIds(Session& session, std::optional<Range> range = std::nullopt); // No track related
+        static void						findNames(Session& session, std::function<void(ArtistId, std::string_view name, std::string_view sortName)> func); // ordered by name sort key, then id
+        static std::size_t				removeOrphans(Session& session); // returns the removed artist count
+        static void						updateLinkTypes(Session& session); // recomputes the link types from the track artist links, see getLinkTypes
         static bool						exists(Session& session, ArtistId id);
 
         // Accessors
         const std::string& getName() const { return _name; }
         const std::string& getSortName() const { return _sortName; }
-        std::optional<UUID>	getMBID() const { return UUID::fromString(_MBID); }
+        std::string getIndexLetter() const; // from the sort name
+        std::optional<UUID>	getMBID() const { return fromMBIDBlob(_MBID); }
+        EnumSet<TrackArtistLinkType> getLinkTypes() const; // the link types of all the tracks involving this artist, as of the last updateLinkTypes
 
         // No artistLinkTypes means get them all
         RangeResults<ArtistId>          findSimilarArtistIds(EnumSet<TrackArtistLinkType> artistLinkTypes = {}, std::optional<Range> range = std::nullopt) const;
@@ -105,16 +115,19 @@ namespace Database
         // size is the max number of cluster per cluster type
         std::vector<std::vector<ObjectPtr<Cluster>>> getClusterGroups(std::vector<ClusterTypeId> clusterTypeIds, std::size_t size) const;
 
-        void setName(std::string_view name) { _name = name; }
-        void setMBID(const std::optional<UUID>& mbid) { _MBID = mbid ? mbid->getAsString() : ""; }
+        void setName(std::string_view name);
+        void setMBID(const std::optional<UUID>& mbid) { _MBID = toMBIDBlob(mbid); }
         void setSortName(const std::string& sortName);
 
         template<class Action>
         void persist(Action& a)
         {
             Wt::Dbo::field(a, _name, "name");
+            Wt::Dbo::field(a, _nameSortKey, "name_sort_key");
             Wt::Dbo::field(a, _sortName, "sort_name");
+            Wt::Dbo::field(a, _sortNameSortKey, "sort_name_sort_key");
             Wt::Dbo::field(a, _MBID, "mbid");
+            Wt::Dbo::field(a, _linkTypes, "link_types");
 
             Wt::Dbo::hasMany(a, _trackArtistLinks, Wt::Dbo::ManyToOne, "artist");
             Wt::Dbo::hasMany(a, _starredArtists, Wt::Dbo::ManyToMany, "user_starred_artists", "", Wt::Dbo::OnDeleteCascade);
@@ -129,8 +142,11 @@ namespace Database
         static pointer create(Session& session, const std::string& name, const std::optional<UUID>& UUID = {});
 
         std::string _name;
+        std::string _nameSortKey; // see StringUtils::computeSortKey
         std::string _sortName;
-        std::string _MBID;	// Musicbrainz Identifier
+        std::string _sortNameSortKey;
+        MBIDBlob _MBID;	// Musicbrainz Identifier
+        long long _linkTypes{}; // bitfield of TrackArtistLinkType, maintained by updateLinkTypes
 
         Wt::Dbo::collection<Wt::Dbo::ptr<TrackArtistLink>>	_trackArtistLinks;	// Tracks involving this artist
         Wt::Dbo::collection<Wt::Dbo::ptr<StarredArtist>>	_starredArtists; 	// starred entries for this artist
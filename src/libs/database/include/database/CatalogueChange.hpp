@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "database/IdType.hpp"
+
+namespace Database
+{
+    class Session;
+
+    // Journal of the changes made to the artists, releases and tracks, kept in sync by triggers
+    // Only the last change of each entity is kept, with a change id that increases each time the entity is created, modified or removed
+    // Removed entities are kept in the journal, so that clients can be told about them
+    class CatalogueChange
+    {
+    public:
+        enum class EntityType
+        {
+            Artist = 0,
+            Release = 1,
+            Track = 2,
+        };
+
+        struct Entry
+        {
+            std::int64_t        changeId{};
+            IdType::ValueType   entityId{};
+        };
+
+        static std::int64_t getLastChangeId(Session& session); // 0 if no change has been made
+
+        // Entities of the given type changed in (afterChangeId, upToChangeId], ordered by change id
+        static std::vector<Entry> find(Session& session, EntityType type, bool removed, std::int64_t afterChangeId, std::int64_t upToChangeId, std::size_t maxCount);
+    };
+}
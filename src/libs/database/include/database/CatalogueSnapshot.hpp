@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "database/Artist.hpp"
+#include "database/ArtistId.hpp"
+#include "database/ClusterId.hpp"
+#include "database/MediaLibraryId.hpp"
+#include "database/Release.hpp"
+#include "database/ReleaseId.hpp"
+#include "database/Track.hpp"
+#include "database/TrackId.hpp"
+#include "database/Types.hpp"
+#include "utils/CompressedBitmap.hpp"
+
+namespace Database
+{
+    class Session;
+
+    // Immutable, column oriented copy of the catalogue: tracks, releases, artists, clusters and their links, stored as flat arrays
+    // Built at the end of each scan and published using Db::publishCatalogueSnapshot
+    // Since a snapshot may be outdated while a scan is in progress, callers must cope with ids that no longer exist
+    class CatalogueSnapshot
+    {
+    public:
+        static std::shared_ptr<const CatalogueSnapshot> build(Session& session); // needs a read transaction
+
+        std::size_t getTrackCount() const { return _trackIds.size(); }
+        std::size_t getReleaseCount() const { return _releaseIds.size(); }
+        std::size_t getArtistCount() const { return _artistIds.size(); }
+
+        // Same results as the database queries, without touching the database
+        // nullopt if some of the given parameters are not handled: the database has to be used instead
+        std::optional<RangeResults<TrackId>> findTrackIds(const Track::FindParameters& params) const;
+        std::optional<RangeResults<ReleaseId>> findReleaseIds(const Release::FindParameters& params) const;
+        std::optional<RangeResults<ArtistId>> findArtistIds(const Artist::FindParameters& params) const;
+
+        // Tracks that belong to all the given clusters, and releases that have at least one such track, sorted by id
+        // nullopt if one of the clusters is unknown to the snapshot (created after it was built)
+        std::optional<std::vector<TrackId>> findTrackIdsInAllClusters(std::span<const ClusterId> clusters) const;
+        std::optional<std::vector<ReleaseId>> findReleaseIdsInAllClusters(std::span<const ClusterId> clusters) const;
+
+    private:
+        CatalogueSnapshot() = default;
+
+        // position in the id arrays
+        using Index = std::uint32_t;
+        static constexpr Index invalidIndex{ std::numeric_limits<Index>::max() };
+
+        // Compressed rows: values of row i are stored in [offsets[i], offsets[i + 1])
+        template <typename T>
+        struct Links
+        {
+            std::vector<Index> offsets;
+            std::vector<T> values;
+
+            std::span<const T> get(Index row) const { return std::span<const T>{ values }.subspan(offsets[row], offsets[row + 1] - offsets[row]); }
+        };
+
+        struct ArtistTrackLink
+        {
+            Index track;
+            TrackArtistLinkType type;
+        };
+
+        std::optional<Index> findTrackIndex(TrackId trackId) const;
+        std::optional<Index> findReleaseIndex(ReleaseId releaseId) const;
+        std::optional<Index> findArtistIndex(ArtistId artistId) const;
+        std::optional<Index> findMediaLibraryIndex(MediaLibraryId mediaLibraryId) const;
+        std::optional<::Utils::CompressedBitmap> getTracksInAllClusters(std::span<const ClusterId> clusters) const; // nullopt if a cluster is unknown
+        std::vector<Index> getReleasesOfTracks(const ::Utils::CompressedBitmap& tracks) const; // sorted
+        std::vector<Index> getArtistTracks(Index artist, EnumSet<TrackArtistLinkType> linkTypes) const; // sorted, empty link types means all
+
+        // sorted by id, the index of an entity is its position in these arrays
+        std::vector<TrackId> _trackIds;
+        std::vector<ReleaseId> _releaseIds;
+        std::vector<ArtistId> _artistIds;
+        std::vector<ClusterId> _clusterIds;
+        std::vector<MediaLibraryId> _mediaLibraryIds;
+
+        // track columns
+        std::vector<Index> _trackReleases; // invalidIndex if not part of a release
+        std::vector<Index> _trackMediaLibraries; // invalidIndex if not part of a media library
+
+        Links<Index> _releaseTracks; // ordered by disc number, then track number
+        Links<ArtistTrackLink> _artistTracks; // ordered by track
+        Links<Index> _trackArtists; // ordered by artist
+        std::vector<::Utils::CompressedBitmap> _clusterTracks; // track indexes, by cluster index: multi cluster filters are bitmap intersections
+
+        // name based sort orders: sorted entity indexes, and the rank of each entity
+        struct SortOrder
+        {
+            std::vector<Index> indexes;
+            std::vector<Index> ranks;
+        };
+        SortOrder _tracksByName;
+        SortOrder _releasesByName;
+        SortOrder _artistsByName;
+        SortOrder _artistsBySortName;
+    };
+} // namespace Database
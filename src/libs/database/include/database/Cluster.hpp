@@ -19,7 +19,9 @@
 
 #pragma once
 
+#include <functional>
 #include <optional>
+#include <span>
 #include <string>
 #include <string_view>
 #include <tuple>
@@ -66,11 +68,16 @@ namespace Database {
         static RangeResults<pointer>            find(Session& session, const FindParameters& params);
         static void                             find(Session& session, const FindParameters& params, std::function<void(const pointer& cluster)> _func);
         static pointer                          find(Session& session, ClusterId id);
+        // Clusters of several tracks at once, restricted to the given cluster types
+        static void                             find(Session& session, std::span<const TrackId> tracks, std::span<const std::string> clusterTypeNames, std::function<void(TrackId track, const pointer& cluster)> func);
         static RangeResults<ClusterId>          findOrphanIds(Session& session, std::optional<Range> range = std::nullopt);
+        static std::size_t                      removeOrphans(Session& session); // returns the removed cluster count
 
         // May be very slow
         static std::size_t                      computeTrackCount(Session& session, ClusterId id);
         static std::size_t                      computeReleaseCount(Session& session, ClusterId id);
+        // Recompute the cached track/release counts of all the clusters at once
+        static void                             updateCounts(Session& session);
 
         // Accessors
         std::string_view                getName() const { return _name; }
@@ -120,8 +127,10 @@ namespace Database {
         static std::size_t					getCount(Session& session);
         static RangeResults<ClusterTypeId>	findIds(Session& session, std::optional<Range> range = std::nullopt);
         static pointer 						find(Session& session, std::string_view name);
+        static std::vector<pointer>			findByNames(Session& session, std::span<const std::string> names);
         static pointer						find(Session& session, ClusterTypeId id);
         static RangeResults<ClusterTypeId>	findOrphanIds(Session& session, std::optional<Range> range = std::nullopt);
+        static std::size_t					removeOrphans(Session& session); // returns the removed cluster type count
         static RangeResults<ClusterTypeId>	findUsed(Session& session, std::optional<Range> range = std::nullopt);
 
         static void remove(Session& session, const std::string& name);
@@ -130,6 +139,7 @@ namespace Database {
         std::string_view getName() const { return _name; }
         std::vector<Cluster::pointer>	getClusters() const;
         Cluster::pointer				getCluster(const std::string& name) const;
+        std::vector<Cluster::pointer>	getClusters(std::span<const std::string> names) const;
 
         template<class Action>
         void persist(Action& a)
@@ -19,33 +19,113 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
 
 #include <Wt/Dbo/SqlConnectionPool.h>
 
-#include "utils/RecursiveSharedMutex.hpp"
+namespace Metrics
+{
+    class Counter;
+    class Histogram;
+}
+
+namespace Wt::Dbo
+{
+    class Session;
+}
 
 namespace Database {
 
+    class CatalogueSnapshot;
     class Session;
+    class SlowQueryLog;
+    class User;
+    class UserSettingsCache;
     class Db
     {
     public:
-        Db(const std::filesystem::path& dbPath, std::size_t connectionCount = 10);
+        // SQLite only: besides the connection settings, the schema relies on FTS5 trigram tables, triggers and WITHOUT ROWID tables
+        // Write transactions use a single dedicated connection, read transactions use a pool of read only connections
+        Db(const std::filesystem::path& dbPath, std::size_t readConnectionCount = 10);
+        ~Db();
 
         Session& getTLSSession();
 
         void executeSql(const std::string& sql);
+        std::vector<std::string> explainQueryPlan(const std::string& sql); // details of each step of the query plan, parameters are left unbound
+
+        // SQL statements executed so far by all the threads of the process, see Session::getExecutedStatementCount for the calling thread only
+        static std::uint64_t getTotalExecutedStatementCount();
+
+        // Incremented each time a write transaction ends: can be used to detect any change made in the database
+        std::uint64_t getWriteGeneration() const { return _writeGeneration.load(); }
+        std::chrono::system_clock::time_point getLastWriteTime() const { return _lastWriteTime.load(); }
+
+        // Space used by the database file
+        struct StorageStats
+        {
+            std::uint64_t pageSize{};
+            std::uint64_t pageCount{};
+            std::uint64_t freePageCount{};
+            bool incrementalVacuum{}; // free pages can be given back to the file system using incrementalVacuum
+        };
+        StorageStats getStorageStats();
+        // Releases at most maxPageCount free pages, returns the number of free pages left
+        std::uint64_t incrementalVacuum(std::uint64_t maxPageCount);
+
+        // Writes a consistent copy of the database into destination, which is replaced if it exists
+        // Uses a dedicated connection: in WAL mode the copy only holds a read snapshot, the writers are not blocked
+        void backup(const std::filesystem::path& destination);
+
+        // null if slow queries are not recorded, see db-slow-query-threshold
+        SlowQueryLog* getSlowQueryLog() const { return _slowQueryLog.get(); }
+
+        // Latest published catalogue snapshot, may be null
+        std::shared_ptr<const CatalogueSnapshot> getCatalogueSnapshot() const { return _catalogueSnapshot.load(); }
+        void publishCatalogueSnapshot(std::shared_ptr<const CatalogueSnapshot> snapshot) { _catalogueSnapshot.store(std::move(snapshot)); }
 
     private:
         Db(const Db&) = delete;
         Db& operator=(const Db&) = delete;
 
+        friend class DirectStatement;
         friend class Session;
+        friend class ReadTransaction;
+        friend class WriteTransaction;
+        friend class User;
+
+        // The next transaction started by this thread will use the write connection and will be started using "BEGIN IMMEDIATE"
+        static void setWriteTransactionStarting(bool writeTransactionStarting);
+        static std::uint64_t getExecutedStatementCount(); // by the calling thread
+        static Wt::Dbo::SqlConnection* getTransactionConnection(); // of the SQL transaction started by the calling thread, null if none
+        void onWriteTransactionEnded(bool outermost);
+
+        // Loaded objects are kept alive by the pointers held across transactions (caches, widgets, etc.)
+        // Past the db-session-max-loaded-objects threshold, they are all discarded (and reloaded on demand)
+        void onOutermostTransactionStarting(Wt::Dbo::Session& session);
+        void onOutermostTransactionEnding(); // the objects loaded by the transaction are still alive
+
+        // The user settings cache is invalidated once the current write transaction of the calling thread is committed
+        static void onUserModified();
+        UserSettingsCache& getUserSettingsCache() { return *_userSettingsCache; }
 
-        RecursiveSharedMutex& getMutex() { return _sharedMutex; }
         Wt::Dbo::SqlConnectionPool& getConnectionPool() { return *_connectionPool; }
 
+        // auto_vacuum can only be changed on an empty database, or by a full VACUUM (see db-auto-vacuum-convert)
+        void setupAutoVacuum(bool convert);
+
+        // Periodically moves the WAL content back into the database, so that the WAL does not grow unbounded
+        void runWalCheckpoints(std::chrono::seconds period);
+        bool walCheckpoint(); // true if the whole WAL has been checkpointed
+
         class ScopedConnection
         {
         public:
@@ -53,6 +133,7 @@ namespace Database {
             ~ScopedConnection();
 
             Wt::Dbo::SqlConnection* operator->() const;
+            Wt::Dbo::SqlConnection* get() const;
 
         private:
             ScopedConnection(const ScopedConnection&) = delete;
@@ -62,11 +143,33 @@ namespace Database {
             std::unique_ptr<Wt::Dbo::SqlConnection> _connection;
         };
 
-        RecursiveSharedMutex				_sharedMutex;
-        std::unique_ptr<Wt::Dbo::SqlConnectionPool>	_connectionPool;
+        const std::filesystem::path _dbPath;
+        std::unique_ptr<SlowQueryLog> _slowQueryLog; // must outlive the connections
+        std::unique_ptr<Wt::Dbo::SqlConnectionPool>	_readConnectionPool;
+        std::unique_ptr<Wt::Dbo::SqlConnectionPool>	_writeConnectionPool;
+        std::unique_ptr<Wt::Dbo::SqlConnectionPool>	_connectionPool; // dispatches to the read or write pool, depending on the transaction being started
+
+        // null if metrics are not collected
+        Metrics::Histogram* _readTransactionDurationHistogram{};
+        Metrics::Histogram* _writeTransactionDurationHistogram{};
+        Metrics::Histogram* _loadedObjectCountHistogram{};
+        Metrics::Counter* _loadedObjectDiscardCounter{};
+
+        std::size_t _maxLoadedObjectCount{}; // 0 means no limit
 
         std::mutex _tlsSessionsMutex;
         std::vector<std::unique_ptr<Session>> _tlsSessions;
+
+        std::atomic<std::uint64_t> _writeGeneration{};
+        std::atomic<std::chrono::system_clock::time_point> _lastWriteTime{ std::chrono::system_clock::now() };
+        std::atomic<std::shared_ptr<const CatalogueSnapshot>> _catalogueSnapshot;
+        std::unique_ptr<UserSettingsCache> _userSettingsCache;
+
+        std::unique_ptr<Wt::Dbo::SqlConnection> _walCheckpointConnection;
+        std::mutex _walCheckpointMutex;
+        std::condition_variable _walCheckpointCondVar;
+        bool _walCheckpointStopRequested{};
+        std::thread _walCheckpointThread;
     };
 
 } // namespace Database
@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "database/ReleaseId.hpp"
+
+namespace Database
+{
+    class Session;
+}
+
+// Typed read only queries for the hot paths: rows are decoded into plain structs, without any Dbo object mapping
+// Must be called within a transaction
+namespace Database::DirectReads
+{
+    struct ReleaseYears
+    {
+        std::optional<int> year;            // set only if all the tracks of the release share the same year
+        std::optional<int> originalYear;    // same for the original year
+    };
+    ReleaseYears getReleaseYears(Session& session, ReleaseId release);
+
+    // Names of the clusters of the given type used by the tracks of the release
+    std::vector<std::string> getReleaseClusterNames(Session& session, ReleaseId release, std::string_view clusterTypeName);
+}
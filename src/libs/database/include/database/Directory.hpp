@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <Wt/Dbo/Dbo.h>
+
+#include "database/DirectoryId.hpp"
+#include "database/Object.hpp"
+
+namespace Database
+{
+    class MediaLibrary;
+    class Session;
+
+    // Directories of the tracks, stored as a tree
+    // Root directories are named after their absolute path (usually the root path of a media library), the other ones after their last path component
+    // A path may be located in several trees if media libraries are nested
+    class Directory final : public Object<Directory, DirectoryId>
+    {
+    public:
+        Directory() = default;
+
+        // find
+        static std::size_t          getCount(Session& session);
+        static pointer              find(Session& session, DirectoryId id);
+        static pointer              find(Session& session, const std::filesystem::path& path); // the most nested tree is preferred
+        static std::vector<DirectoryId> findIds(Session& session, const std::filesystem::path& path); // in all the trees
+        static std::vector<DirectoryId> findTreeIds(Session& session, const std::filesystem::path& path); // directories whose trees cover the path: the ones that have this path and the root directories located in it
+        static std::vector<pointer> findRootDirectories(Session& session);
+
+        // Creates the missing directories
+        // If the path is located in the media library, the directories are created in the tree of its root path
+        static pointer              getOrCreate(Session& session, const std::filesystem::path& path, const ObjectPtr<MediaLibrary>& mediaLibrary = {});
+
+        // Renames the root directory, so that all the tracks located in its tree follow (single row update)
+        // Returns false if there is no such root directory or if the new path is already used by a root directory
+        static bool                 moveRootDirectory(Session& session, const std::filesystem::path& oldPath, const std::filesystem::path& newPath);
+
+        // Removes the directories that no longer have any track nor sub directory, returns the removed directory count
+        static std::size_t          removeOrphans(Session& session);
+
+        // accessors
+        std::string_view            getName() const { return _name; }
+        std::filesystem::path       getPath() const; // walks up the parent directories
+        ObjectPtr<Directory>        getParentDirectory() const { return _parentDirectory; }
+        ObjectPtr<MediaLibrary>     getMediaLibrary() const { return _mediaLibrary; }
+
+        void                        setMediaLibrary(ObjectPtr<MediaLibrary> mediaLibrary) { _mediaLibrary = getDboPtr(mediaLibrary); }
+
+        template<class Action>
+        void persist(Action& a)
+        {
+            Wt::Dbo::field(a, _name, "name");
+            Wt::Dbo::belongsTo(a, _parentDirectory, "parent_directory", Wt::Dbo::OnDeleteCascade);
+            Wt::Dbo::belongsTo(a, _mediaLibrary, "media_library", Wt::Dbo::OnDeleteSetNull); // same as tracks, see Track
+        }
+
+    private:
+        friend class ::Database::Session;
+        Directory(std::string_view name, ObjectPtr<Directory> parentDirectory, ObjectPtr<MediaLibrary> mediaLibrary);
+        static pointer create(Session& session, std::string_view name, ObjectPtr<Directory> parentDirectory, ObjectPtr<MediaLibrary> mediaLibrary);
+
+        std::string                 _name;
+        Wt::Dbo::ptr<Directory>     _parentDirectory;
+        Wt::Dbo::ptr<MediaLibrary>  _mediaLibrary;
+    };
+} // namespace Database
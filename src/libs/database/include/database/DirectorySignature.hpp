@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <filesystem>
+#include <functional>
+#include <span>
+
+#include <Wt/WDateTime.h>
+
+namespace Database
+{
+    class Session;
+
+    // Media directory signatures, saved by the scanner to detect the directories whose content has not changed
+    class DirectorySignature
+    {
+    public:
+        struct Entry
+        {
+            std::filesystem::path   path;
+            long long               lastWriteTime{};    // directory last write time, in file clock ticks
+            std::size_t             fileCount{};        // audio files directly in the directory
+            Wt::WDateTime           checkTime;          // last time the files of the directory have been checked one by one
+
+            bool operator==(const Entry& other) const = default;
+        };
+
+        static void visitAll(Session& session, const std::function<void(const Entry& entry)>& func);
+
+        // Replace all the stored signatures (no entries means clear)
+        static void setAll(Session& session, std::span<const Entry> entries);
+    };
+}
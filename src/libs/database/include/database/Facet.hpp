@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "database/MediaLibraryId.hpp"
+#include "database/ReleaseId.hpp"
+#include "database/TrackId.hpp"
+#include "database/Types.hpp"
+
+namespace Database
+{
+    class Session;
+
+    // Most common track tags, stored in dedicated tables ("genre", "mood", "language") with compact link tables ("track_genre", ...)
+    // so that their queries do not have to join the cluster types by name
+    enum class FacetType
+    {
+        Genre,
+        Mood,
+        Language,
+    };
+
+    class Facet
+    {
+    public:
+        struct Entry
+        {
+            std::string name;
+            std::size_t trackCount{};   // cached, see updateCounts
+            std::size_t releaseCount{}; // cached, see updateCounts
+        };
+
+        // Replaces the values of the track, the missing values are created
+        static void                     setTrackValues(Session& session, TrackId track, FacetType type, std::span<const std::string> values);
+
+        static std::vector<std::string> getTrackValues(Session& session, TrackId track, FacetType type);
+        static void                     getTrackValues(Session& session, std::span<const TrackId> tracks, FacetType type, std::function<void(TrackId track, std::string_view value)> func);
+        static std::vector<std::string> getReleaseValues(Session& session, ReleaseId release, FacetType type); // distinct values of the tracks of the release, ordered by name
+
+        static void                     visitAll(Session& session, FacetType type, std::function<void(const Entry& entry)> func); // ordered by name
+        static RangeResults<TrackId>    findTrackIds(Session& session, FacetType type, std::string_view value, MediaLibraryId mediaLibrary, std::optional<Range> range); // ordered by id
+        static RangeResults<ReleaseId>  findReleaseIds(Session& session, FacetType type, std::string_view value, MediaLibraryId mediaLibrary, std::optional<Range> range); // ordered by name
+
+        static std::size_t              removeOrphans(Session& session); // values no longer used by any track, returns the removed value count
+        static void                     updateCounts(Session& session);
+
+        static constexpr std::size_t    maxValueLength{ 128 }; // same as cluster names
+    };
+}
@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <filesystem>
+#include <functional>
+#include <span>
+
+namespace Database
+{
+    class Session;
+
+    // Image files (covers, artist images) found in the media directories, indexed by the scanner
+    class ImageFile
+    {
+    public:
+        struct Entry
+        {
+            std::filesystem::path   path;
+            std::size_t             fileSize{};
+            long long               lastWriteTime{};    // in file clock ticks
+
+            bool operator==(const Entry& other) const = default;
+        };
+
+        static bool hasAny(Session& session);
+
+        static void visitAll(Session& session, const std::function<void(const Entry& entry)>& func);
+        static void visitAllInDirectory(Session& session, const std::filesystem::path& directory, const std::function<void(const Entry& entry)>& func); // recursively
+        static void visitDirectory(Session& session, const std::filesystem::path& directory, const std::function<void(const Entry& entry)>& func); // files directly in the directory
+
+        // Replace all the stored entries (no entries means clear)
+        static void setAll(Session& session, std::span<const Entry> entries);
+        // Replace the stored entries located in the directory, recursively
+        static void setAllInDirectory(Session& session, const std::filesystem::path& directory, std::span<const Entry> entries);
+    };
+}
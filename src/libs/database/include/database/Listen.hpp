@@ -19,7 +19,9 @@
 
 #pragma once
 
+#include <functional>
 #include <optional>
+#include <span>
 
 #include <Wt/Dbo/Dbo.h>
 #include <Wt/WDateTime.h>
@@ -65,6 +67,15 @@ namespace Database
         static pointer                  find(Session& session, UserId userId, TrackId trackId, ScrobblingBackend backend, const Wt::WDateTime& dateTime);
         static RangeResults<ListenId>   find(Session& session, const FindParameters& parameters);
 
+        // Bulk creation: listens that already exist (same user, track, backend and date time) or that refer to missing tracks are skipped
+        // Returns the number of created listens
+        struct TimedTrack
+        {
+            TrackId         trackId;
+            Wt::WDateTime   dateTime;
+        };
+        static std::size_t              createIfNotExist(Session& session, UserId userId, ScrobblingBackend backend, SyncState syncState, std::span<const TimedTrack> entries);
+
         // Stats
         struct StatsFindParameters
         {
@@ -74,6 +85,7 @@ namespace Database
             std::optional<Range>                range;
             ArtistId                            artist; // if set, matching this artist
             MediaLibraryId                      library;
+            std::optional<MonthRange>           period; // if set, only the listens of these months
 
             StatsFindParameters& setUser(UserId _user) { user = _user; return *this; }
             StatsFindParameters& setScrobblingBackend(std::optional<ScrobblingBackend> _backend) { backend = _backend; return *this; }
@@ -81,6 +93,7 @@ namespace Database
             StatsFindParameters& setRange(std::optional<Range> _range) { range = _range; return *this; }
             StatsFindParameters& setArtist(ArtistId _artist) { artist = _artist; return *this; }
             StatsFindParameters& setMediaLibrary(MediaLibraryId _library) { library = _library; return *this; }
+            StatsFindParameters& setPeriod(std::optional<MonthRange> _period) { period = _period; return *this; }
         };
 
         struct ArtistStatsFindParameters : public StatsFindParameters
@@ -101,6 +114,17 @@ namespace Database
         static std::size_t              getCount(Session& session, UserId userId, TrackId trackId); // for the current backend
         static std::size_t              getCount(Session& session, UserId userId, ReleaseId trackId); // for the current backend
 
+        struct TrackStats
+        {
+            TrackId         track;
+            std::size_t     count{};
+            Wt::WDateTime   lastListenDateTime;
+        };
+        // Stats of several tracks at once, for the current backend. Tracks that have never been listened to are not reported
+        static void                     getTrackStats(Session& session, UserId userId, std::span<const TrackId> tracks, std::function<void(const TrackStats&)> func);
+        // Stats of all the tracks listened to by the user for this backend
+        static void                     getTrackStats(Session& session, UserId userId, ScrobblingBackend backend, std::function<void(const TrackStats&)> func);
+
         static pointer          getMostRecentListen(Session& session, UserId userId, ScrobblingBackend backend, ReleaseId releaseId);
         static pointer          getMostRecentListen(Session& session, UserId userId, ScrobblingBackend backend, TrackId releaseId);
 
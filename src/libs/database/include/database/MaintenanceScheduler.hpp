@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/io_context_strand.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+namespace Database
+{
+    class Db;
+
+    // Keeps the query planner statistics up to date, off the hot path:
+    // periodically checks how many rows have been changed and runs "PRAGMA optimize" once enough changes have been made
+    // Also runs the data migrations left to be done in background after an upgrade, by chunks
+    // and gives the free pages back to the file system by small steps (incremental vacuum), while the foreground is not busy
+    // Periodically backs up the database into working-dir/backups, if changed since the last backup
+    class MaintenanceScheduler
+    {
+    public:
+        MaintenanceScheduler(boost::asio::io_context& ioContext, Db& db);
+        ~MaintenanceScheduler();
+
+        // Runs a full ANALYZE in background, as soon as possible (bounded by the per-table analysis limit)
+        void requestAnalyze();
+
+    private:
+        MaintenanceScheduler(const MaintenanceScheduler&) = delete;
+        MaintenanceScheduler& operator=(const MaintenanceScheduler&) = delete;
+
+        void scheduleCheck(std::chrono::seconds fromNow);
+        void check();
+        void analyze();
+        void startIncrementalVacuum();
+        void incrementalVacuumStep();
+        void scheduleBackgroundMigrations(std::chrono::seconds fromNow);
+        void runBackgroundMigrations();
+        void scheduleBackup(std::chrono::seconds fromNow);
+        void backup();
+        void removeOldBackups();
+
+        boost::asio::io_context& _ioContext;
+        boost::asio::io_context::strand _strand{ _ioContext };
+        boost::asio::steady_timer _checkTimer{ _ioContext };
+        boost::asio::steady_timer _migrationTimer{ _ioContext };
+        boost::asio::steady_timer _backupTimer{ _ioContext };
+        Db& _db;
+
+        const std::chrono::seconds _checkPeriod;
+        const std::uint64_t _changeThreshold;
+        const std::size_t _migrationChunkSize;
+        const std::uint64_t _vacuumMinFreePageCount; // 0 to disable
+        const std::uint64_t _vacuumStepPageCount;
+        bool _vacuumInProgress{};
+        const std::chrono::hours _backupPeriod; // 0 to disable
+        const std::size_t _backupCount; // number of backups to keep
+        const std::filesystem::path _backupDirectory;
+        std::optional<std::uint64_t> _lastBackupWriteGeneration;
+
+        std::uint64_t _lastCheckedWriteGeneration{};
+        std::uint64_t _lastOptimizedChangeCount{};
+    };
+} // namespace Database
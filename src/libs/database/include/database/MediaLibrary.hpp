@@ -50,16 +50,28 @@ namespace Database
         // getters
         std::string_view getName() const { return _name; }
         const std::filesystem::path& getPath() const { return _path; }
+        const std::filesystem::path& getScanCheckpoint() const { return _scanCheckpoint; } // last file processed by an interrupted scan
+        std::size_t getScanThreadCount() const { return static_cast<std::size_t>(_scanThreadCount); } // 0 means use the default thread count
+        std::size_t getScanMaxFilesPerSecond() const { return static_cast<std::size_t>(_scanMaxFilesPerSecond); } // 0 means unlimited
+        std::size_t getScanMaxBytesPerSecond() const { return static_cast<std::size_t>(_scanMaxBytesPerSecond); } // 0 means unlimited
 
         // setters
         void setName(std::string_view name) { _name = name; }
-        void setPath(const std::filesystem::path& p) { _path = p; }
+        void setPath(const std::filesystem::path& p) { _path = p; _scanCheckpoint.clear(); }
+        void setScanCheckpoint(const std::filesystem::path& p) { _scanCheckpoint = p; }
+        void setScanThreadCount(std::size_t threadCount) { _scanThreadCount = static_cast<int>(threadCount); }
+        void setScanMaxFilesPerSecond(std::size_t maxFilesPerSecond) { _scanMaxFilesPerSecond = static_cast<int>(maxFilesPerSecond); }
+        void setScanMaxBytesPerSecond(std::size_t maxBytesPerSecond) { _scanMaxBytesPerSecond = static_cast<long long>(maxBytesPerSecond); }
 
         template<class Action>
         void persist(Action& a)
         {
             Wt::Dbo::field(a, _path, "path");
             Wt::Dbo::field(a, _name, "name");
+            Wt::Dbo::field(a, _scanCheckpoint, "scan_checkpoint");
+            Wt::Dbo::field(a, _scanThreadCount, "scan_thread_count");
+            Wt::Dbo::field(a, _scanMaxFilesPerSecond, "scan_max_files_per_second");
+            Wt::Dbo::field(a, _scanMaxBytesPerSecond, "scan_max_bytes_per_second");
         }
 
     private:
@@ -69,5 +81,9 @@ namespace Database
 
         std::filesystem::path       _path;
         std::string                 _name;
+        std::filesystem::path       _scanCheckpoint;
+        int                         _scanThreadCount{};
+        int                         _scanMaxFilesPerSecond{};
+        long long                   _scanMaxBytesPerSecond{};
     };
 } // namespace Database
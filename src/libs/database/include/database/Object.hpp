@@ -19,6 +19,8 @@
 
 #pragma once
 
+#include <cstddef>
+
 #include <Wt/WSignal.h>
 #include <Wt/Dbo/ptr.h>
 #include "database/IdType.hpp"
@@ -39,11 +41,20 @@ namespace Database
         bool operator==(const ObjectPtr& other) const { return _obj == other._obj; }
         bool operator!=(const ObjectPtr& other) const { return other._obj != _obj; }
 
-        auto modify() { TransactionChecker::checkWriteTransaction(*_obj.session()); return _obj.modify(); }
+        auto modify()
+        {
+            TransactionChecker::checkWriteTransaction(*_obj.session());
+
+            if (_obj->hasOnPreModify())
+                _obj.modify()->onPreModify();
+            return _obj.modify();
+        }
         void remove()
         {
             TransactionChecker::checkWriteTransaction(*_obj.session());
 
+            if (_obj->hasOnPreModify())
+                _obj.modify()->onPreModify();
             if (_obj->hasOnPreRemove())
                 _obj.modify()->onPreRemove();
             _obj.remove();
@@ -54,6 +65,18 @@ namespace Database
         Wt::Dbo::ptr<T> _obj;
     };
 
+    // Objects currently alive on the calling thread: each thread uses its own session (see Db::getTLSSession)
+    // and Wt::Dbo drops the objects that are no longer referenced, so this is the size of the object cache of the thread session
+    class LoadedObjectCounter
+    {
+    public:
+        static std::size_t get() { return _count > 0 ? static_cast<std::size_t>(_count) : 0; }
+
+    private:
+        template <typename, typename> friend class Object;
+        static inline thread_local std::ptrdiff_t _count{}; // objects may be released by another thread
+    };
+
     template <typename T, typename ObjectIdType>
     class Object : public Wt::Dbo::Dbo<T>
     {
@@ -64,6 +87,10 @@ namespace Database
         using pointer = ObjectPtr<T>;
         using IdType = ObjectIdType;
 
+        Object() { ++LoadedObjectCounter::_count; }
+        Object(const Object& other) : Wt::Dbo::Dbo<T>{ other } { ++LoadedObjectCounter::_count; }
+        ~Object() { --LoadedObjectCounter::_count; }
+
         IdType getId() const { return Wt::Dbo::Dbo<T>::self()->Wt::Dbo::template Dbo<T>::id(); }
 
         // catch some misuses
@@ -72,6 +99,10 @@ namespace Database
     protected:
         template <typename> friend class ObjectPtr;
 
+        // also called before removals
+        virtual bool hasOnPreModify() const { return false; }
+        virtual void onPreModify() {}
+
         virtual bool hasOnPreRemove() const { return false; }
         virtual void onPreRemove() {}
 
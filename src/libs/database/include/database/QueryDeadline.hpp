@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <optional>
+
+namespace Database
+{
+    // Time budget of the read queries, the running SQLite statement is interrupted once it is exceeded
+    // An interrupted query throws a Wt::Dbo::Exception: use isExceeded to tell it apart from the other errors
+    // Write transactions are never interrupted
+    class QueryDeadline
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        // The deadline is also exceeded once cancelled is set (for instance when the client has gone away)
+        QueryDeadline(Clock::time_point expiry, std::shared_ptr<const std::atomic<bool>> cancelled = {});
+
+        Clock::time_point getExpiry() const { return _expiry; }
+        bool isCancelled() const { return _cancelled && _cancelled->load(std::memory_order_relaxed); }
+        bool isExceeded() const { return isCancelled() || Clock::now() >= _expiry; }
+
+        // Same cancellation, earliest expiry
+        QueryDeadline narrowedTo(Clock::time_point expiry) const;
+
+    private:
+        Clock::time_point _expiry;
+        std::shared_ptr<const std::atomic<bool>> _cancelled; // may be null
+    };
+
+    // Applies the deadline to the queries run by the calling thread, the previous deadline is restored on destruction
+    class ScopedQueryDeadline
+    {
+    public:
+        ScopedQueryDeadline(std::optional<QueryDeadline> deadline); // std::nullopt for no limit
+        ~ScopedQueryDeadline();
+
+        // Of the calling thread, std::nullopt if none
+        static const std::optional<QueryDeadline>& getCurrent();
+        static bool isCurrentExceeded();
+
+    private:
+        ScopedQueryDeadline(const ScopedQueryDeadline&) = delete;
+        ScopedQueryDeadline& operator=(const ScopedQueryDeadline&) = delete;
+
+        std::optional<QueryDeadline> _previousDeadline;
+    };
+} // namespace Database
@@ -19,8 +19,10 @@
 
 #pragma once
 
+#include <chrono>
 #include <filesystem>
 #include <optional>
+#include <span>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -86,6 +88,7 @@ namespace Database
             std::vector<std::string_view>       keywords; // if non empty, name must match all of these keywords
             ReleaseSortMethod                   sortMethod{ ReleaseSortMethod::None };
             std::optional<Range>                range;
+            std::optional<Cursor>               cursor;     // if set, resume after this cursor instead of using the range offset (Name sort method only)
             Wt::WDateTime                       writtenAfter;
             std::optional<DateRange>            dateRange;
             UserId                              starringUser;				// only releases starred by this user
@@ -100,6 +103,7 @@ namespace Database
             FindParameters& setKeywords(const std::vector<std::string_view>& _keywords) { keywords = _keywords; return *this; }
             FindParameters& setSortMethod(ReleaseSortMethod _sortMethod) { sortMethod = _sortMethod; return *this; }
             FindParameters& setRange(std::optional<Range> _range) { range = _range; return *this; }
+            FindParameters& setCursor(const std::optional<Cursor>& _cursor) { cursor = _cursor; return *this; }
             FindParameters& setWrittenAfter(const Wt::WDateTime& _after) { writtenAfter = _after; return *this; }
             FindParameters& setDateRange(const std::optional<DateRange>& _dateRange) { dateRange = _dateRange; return *this; }
             FindParameters& setStarringUser(UserId _user, FeedbackBackend _feedbackBackend) { starringUser = _user; feedbackBackend = _feedbackBackend; return *this; }
@@ -120,13 +124,19 @@ namespace Database
         static std::size_t              getCount(Session& session);
         static bool                     exists(Session& session, ReleaseId id);
         static pointer                  find(Session& session, const UUID& MBID);
+        static std::vector<pointer>     findByMBIDs(Session& session, std::span<const UUID> MBIDs);
         static std::vector<pointer>     find(Session& session, const std::string& name, const std::filesystem::path& releaseDirectory);
         static pointer                  find(Session& session, ReleaseId id);
+        static std::vector<pointer>     find(Session& session, std::span<const ReleaseId> ids); // unspecified order, missing releases are skipped
         static RangeResults<pointer>    find(Session& session, const FindParameters& parameters);
         static void                     find(Session& session, const FindParameters& parameters, std::function<void(const pointer&)> func);
         static RangeResults<ReleaseId>  findIds(Session& session, const FindParameters& parameters);
         static std::size_t              getCount(Session& session, const FindParameters& parameters);
         static RangeResults<ReleaseId>  findOrphanIds(Session& session, std::optional<Range> range = std::nullopt); // not track related
+        static void                     findNames(Session& session, std::function<void(ReleaseId, std::string_view name)> func); // ordered by name sort key, then id
+        static std::size_t              removeOrphans(Session& session); // returns the removed release count
+        // Recompute the cached aggregates (track count, duration, disc count, last written, primary genre) of all the releases at once
+        static void                     updateAggregates(Session& session);
 
         // Get the cluster of the tracks that belong to this release
         // Each clusters are grouped by cluster type, sorted by the number of occurence (max to min)
@@ -145,23 +155,26 @@ namespace Database
         // Accessors
         std::string_view                    getName() const { return _name; }
         std::string_view                    getSortName() const { return _sortName; }
-        std::optional<UUID>                 getMBID() const { return UUID::fromString(_MBID); }
-        std::optional<UUID>                 getGroupMBID() const { return UUID::fromString(_groupMBID); }
+        std::optional<UUID>                 getMBID() const { return fromMBIDBlob(_MBID); }
+        std::optional<UUID>                 getGroupMBID() const { return fromMBIDBlob(_groupMBID); }
         std::optional<std::size_t>          getTotalDisc() const { return _totalDisc; }
-        std::size_t                         getDiscCount() const; // may not be total disc (if incomplete for example)
         std::vector<DiscInfo>               getDiscs() const;
-        std::chrono::milliseconds           getDuration() const;
-        Wt::WDateTime                       getLastWritten() const;
         std::string_view                    getArtistDisplayName() const { return _artistDisplayName; }
-        std::size_t                         getTracksCount() const;
         std::vector<ObjectPtr<ReleaseType>> getReleaseTypes() const;
         std::vector<std::string>            getReleaseTypeNames() const;
 
+        // Cached aggregates, see updateAggregates
+        std::size_t                         getTracksCount() const { return _trackCount; }
+        std::chrono::milliseconds           getDuration() const { return std::chrono::milliseconds{ _duration }; }
+        std::size_t                         getDiscCount() const { return _discCount; } // may not be total disc (if incomplete for example)
+        const Wt::WDateTime&                getLastWritten() const { return _lastWritten; }
+        std::string_view                    getPrimaryGenre() const { return _primaryGenre; } // most used genre of the tracks, empty if none
+
         // Setters
-        void setName(std::string_view name) { _name = name; }
+        void setName(std::string_view name);
         void setSortName(std::string_view sortName) { _sortName = sortName; }
-        void setMBID(const std::optional<UUID>& mbid) { _MBID = mbid ? mbid->getAsString() : ""; }
-        void setGroupMBID(const std::optional<UUID>& mbid) { _groupMBID = mbid ? mbid->getAsString() : ""; }
+        void setMBID(const std::optional<UUID>& mbid) { _MBID = toMBIDBlob(mbid); }
+        void setGroupMBID(const std::optional<UUID>& mbid) { _groupMBID = toMBIDBlob(mbid); }
         void setTotalDisc(std::optional<int> totalDisc) { _totalDisc = totalDisc; }
         void setArtistDisplayName(std::string_view name) { _artistDisplayName = name; }
         void clearReleaseTypes();
@@ -177,11 +190,19 @@ namespace Database
         void persist(Action& a)
         {
             Wt::Dbo::field(a, _name, "name");
+            Wt::Dbo::field(a, _nameSortKey, "name_sort_key");
             Wt::Dbo::field(a, _sortName, "sort_name");
             Wt::Dbo::field(a, _MBID, "mbid");
             Wt::Dbo::field(a, _groupMBID, "group_mbid");
             Wt::Dbo::field(a, _totalDisc, "total_disc");
             Wt::Dbo::field(a, _artistDisplayName, "artist_display_name");
+            Wt::Dbo::field(a, _trackCount, "track_count");
+            Wt::Dbo::field(a, _duration, "duration");
+            Wt::Dbo::field(a, _discCount, "disc_count");
+            Wt::Dbo::field(a, _lastWritten, "last_written");
+            Wt::Dbo::field(a, _primaryGenre, "primary_genre");
+            Wt::Dbo::field(a, _sortDate, "sort_date");
+            Wt::Dbo::field(a, _originalSortDate, "original_sort_date");
             Wt::Dbo::hasMany(a, _tracks, Wt::Dbo::ManyToOne, "release");
             Wt::Dbo::hasMany(a, _releaseTypes, Wt::Dbo::ManyToMany, "release_release_type", "", Wt::Dbo::OnDeleteCascade);
         }
@@ -197,11 +218,19 @@ namespace Database
         static constexpr std::size_t _maxNameLength{ 256 };
 
         std::string                         _name;
+        std::string                         _nameSortKey; // see StringUtils::computeSortKey
         std::string                         _sortName;
-        std::string                         _MBID;
-        std::string                         _groupMBID;
+        MBIDBlob                            _MBID;
+        MBIDBlob                            _groupMBID;
         std::optional<int>                  _totalDisc{};
         std::string                         _artistDisplayName;
+        int                                 _trackCount{};
+        long long                           _duration{}; // in ms
+        int                                 _discCount{};
+        Wt::WDateTime                       _lastWritten;
+        std::string                         _primaryGenre;
+        std::optional<int>                  _sortDate; // earliest sort date of the tracks, to sort releases using an index
+        std::optional<int>                  _originalSortDate; // same with the original sort date
 
         Wt::Dbo::collection<Wt::Dbo::ptr<Track>>        _tracks; // Tracks in the release
         Wt::Dbo::collection<Wt::Dbo::ptr<ReleaseType>>  _releaseTypes; // Release types
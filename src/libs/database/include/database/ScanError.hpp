@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+
+#include "database/Types.hpp"
+
+namespace Database
+{
+    class Session;
+
+    // Errors of the last scan, stored so that the scanner only has to keep a few of them in memory
+    class ScanError
+    {
+    public:
+        struct Entry
+        {
+            std::filesystem::path   path;
+            int                     type{};     // see Scanner::ScanErrorType
+            std::string             systemError;
+
+            bool operator==(const Entry& other) const = default;
+        };
+
+        static void         add(Session& session, std::span<const Entry> entries);
+        static void         clear(Session& session);
+
+        static std::size_t  getCount(Session& session);
+        static void         find(Session& session, std::optional<Range> range, const std::function<void(const Entry& entry)>& func); // in insertion order
+    };
+}
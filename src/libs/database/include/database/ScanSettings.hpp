@@ -20,6 +20,7 @@
 #pragma once
 
 #include <filesystem>
+#include <optional>
 #include <span>
 #include <string>
 #include <string_view>
@@ -56,6 +57,7 @@ namespace Database
             Clusters = 0,
             Features,
             None,
+            NearestNeighbours,
         };
 
         static void init(Session& session);
@@ -71,6 +73,9 @@ namespace Database
         SimilarityEngineType	            getSimilarityEngineType() const { return _similarityEngineType; }
         std::vector<std::string>            getArtistTagDelimiters() const;
         std::vector<std::string>            getDefaultTagDelimiters() const;
+        // Scan interrupted before completion, progress is saved in the media library scan checkpoints
+        std::optional<std::size_t>          getInterruptedScanVersion() const;
+        bool                                isInterruptedScanForced() const { return _interruptedScanForce; }
 
         // Setters
         void setUpdateStartTime(Wt::WTime t) { _startTime = t; }
@@ -80,6 +85,8 @@ namespace Database
         void setArtistTagDelimiters(std::span<const std::string_view> delimiters);
         void setDefaultTagDelimiters(std::span<const std::string_view> delimiters);
         void incScanVersion();
+        void setInterruptedScan(std::size_t scanVersion, bool force) { _interruptedScanVersion = static_cast<int>(scanVersion); _interruptedScanForce = force; }
+        void clearInterruptedScan() { _interruptedScanVersion.reset(); _interruptedScanForce = false; }
 
         template<class Action>
         void persist(Action& a)
@@ -92,6 +99,8 @@ namespace Database
             Wt::Dbo::field(a, _extraTagsToScan, "extra_tags_to_scan");
             Wt::Dbo::field(a, _artistTagDelimiters, "artist_tag_delimiters");
             Wt::Dbo::field(a, _defaultTagDelimiters, "default_tag_delimiters");
+            Wt::Dbo::field(a, _interruptedScanVersion, "interrupted_scan_version");
+            Wt::Dbo::field(a, _interruptedScanForce, "interrupted_scan_force");
         }
 
     private:
@@ -103,5 +112,7 @@ namespace Database
         std::string             _extraTagsToScan;
         std::string             _artistTagDelimiters;
         std::string             _defaultTagDelimiters;
+        std::optional<int>      _interruptedScanVersion;
+        bool                    _interruptedScanForce{};
     };
 } // namespace Database
@@ -19,27 +19,62 @@
 
 #pragma once
 
+#include <chrono>
+#include <cstdint>
+
 #include <Wt/Dbo/Dbo.h>
 #include <Wt/Dbo/SqlConnectionPool.h>
 
-#include "utils/RecursiveSharedMutex.hpp"
 #include "database/Object.hpp"
 #include "database/TransactionChecker.hpp"
+#include "utils/ITraceLogger.hpp"
+
+namespace Metrics
+{
+    class Histogram;
+}
 
 namespace Database
 {
+    class Db;
+
+    // Reports the duration of the outermost transaction of the calling thread, until it is committed
+    class TransactionDurationRecorder
+    {
+    public:
+        TransactionDurationRecorder(Metrics::Histogram* histogram); // may be null
+        ~TransactionDurationRecorder();
+
+    private:
+        TransactionDurationRecorder(const TransactionDurationRecorder&) = delete;
+        TransactionDurationRecorder& operator=(const TransactionDurationRecorder&) = delete;
+
+        Metrics::Histogram* _histogram{}; // null for nested transactions
+        const std::chrono::steady_clock::time_point _startTime;
+    };
+
+    // Relies on SQLite locking (WAL mode): the write lock is taken when the transaction starts
+    // There may be only one write transaction at a time, others wait for it (busy timeout)
     class WriteTransaction
     {
     public:
         ~WriteTransaction();
     private:
         friend class Session;
-        WriteTransaction(RecursiveSharedMutex& mutex, Wt::Dbo::Session& session);
+        WriteTransaction(Db& db, Wt::Dbo::Session& session);
 
         WriteTransaction(const WriteTransaction&) = delete;
         WriteTransaction& operator=(const WriteTransaction&) = delete;
 
-        std::unique_lock<RecursiveSharedMutex> _lock;
+        // Declared before the transaction: notifies the db once the transaction is committed
+        struct EndNotifier
+        {
+            Db& db;
+            ~EndNotifier();
+        };
+        EndNotifier _endNotifier;
+        TransactionDurationRecorder _durationRecorder; // declared before the transaction
+        Tracing::ScopedTrace _trace;
         Wt::Dbo::Transaction _transaction;
     };
 
@@ -49,16 +84,17 @@ namespace Database
         ~ReadTransaction();
     private:
         friend class Session;
-        ReadTransaction(Wt::Dbo::Session& session);
-
+        ReadTransaction(Db& db, Wt::Dbo::Session& session);
 
         ReadTransaction(const ReadTransaction&) = delete;
         ReadTransaction& operator=(const ReadTransaction&) = delete;
 
+        Db& _db;
+        TransactionDurationRecorder _durationRecorder; // declared before the transaction
+        Tracing::ScopedTrace _trace;
         Wt::Dbo::Transaction _transaction;
     };
 
-    class Db;
     class Session
     {
     public:
@@ -71,13 +107,19 @@ namespace Database
         void checkReadTransaction() { TransactionChecker::checkReadTransaction(_session); }
 
         void analyze();
-        void optimize();
 
         void prepareTables(); // need to run only once at startup
 
         Wt::Dbo::Session& getDboSession() { return _session; }
         Db& getDb() { return _db; }
 
+        // SQL statements executed so far by the calling thread (each thread uses its own session, see Db::getTLSSession)
+        // Can be used to spot the code paths that execute too many queries
+        std::uint64_t getExecutedStatementCount() const;
+
+        // Objects currently loaded by the calling thread, see LoadedObjectCounter
+        std::size_t getLoadedObjectCount() const;
+
         template <typename Object, typename... Args>
         typename Object::pointer create(Args&&... args)
         {
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "database/ArtistId.hpp"
+#include "database/ClusterId.hpp"
+#include "database/ReleaseId.hpp"
+#include "database/TrackId.hpp"
+#include "database/Types.hpp"
+#include "utils/EnumSet.hpp"
+
+namespace Database
+{
+    class Session;
+
+    // Cluster based similarities, precomputed by the scanner so that lookups are simple indexed reads
+    class Similarity
+    {
+    public:
+        template <typename IdType>
+        struct Entry
+        {
+            IdType id;
+            std::size_t score{};
+
+            bool operator==(const Entry& other) const = default;
+        };
+
+        template <typename IdType>
+        using Entries = std::vector<Entry<IdType>>;
+
+        // Relations the similarities are computed from
+        static void visitTrackClusters(Session& session, const std::function<void(TrackId track, ClusterId cluster)>& func);
+        static void visitTrackReleases(Session& session, const std::function<void(TrackId track, ReleaseId release)>& func);
+        static void visitTrackArtistLinks(Session& session, const std::function<void(TrackId track, ArtistId artist, TrackArtistLinkType linkType)>& func);
+
+        // Stored similarities, entries ordered by decreasing score
+        static void visitReleaseSimilarities(Session& session, const std::function<void(ReleaseId release, const Entries<ReleaseId>& entries)>& func);
+        static void visitArtistSimilarities(Session& session, const std::function<void(ArtistId artist, TrackArtistLinkType linkType, const Entries<ArtistId>& entries)>& func);
+        static void visitTrackSimilarities(Session& session, const std::function<void(TrackId track, const Entries<TrackId>& entries)>& func);
+
+        // Replace the stored similarities (no entries means clear)
+        static void setReleaseSimilarities(Session& session, ReleaseId release, std::span<const Entry<ReleaseId>> entries);
+        // entries are the artists that have the given link type on similar tracks
+        static void setArtistSimilarities(Session& session, ArtistId artist, TrackArtistLinkType linkType, std::span<const Entry<ArtistId>> entries);
+        static void setTrackSimilarities(Session& session, TrackId track, std::span<const Entry<TrackId>> entries);
+
+        static bool isEmpty(Session& session);
+
+        static RangeResults<ReleaseId> findSimilarReleaseIds(Session& session, ReleaseId release, std::optional<Range> range = std::nullopt);
+        // no link type means all link types
+        static RangeResults<ArtistId> findSimilarArtistIds(Session& session, ArtistId artist, EnumSet<TrackArtistLinkType> linkTypes, std::optional<Range> range = std::nullopt);
+        // scores are summed over the given tracks, which are excluded from the results
+        static RangeResults<TrackId> findSimilarTrackIds(Session& session, std::span<const TrackId> tracks, std::optional<Range> range = std::nullopt);
+    };
+}
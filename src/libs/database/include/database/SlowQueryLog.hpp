@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <Wt/WDateTime.h>
+
+namespace Database
+{
+    // Statements that took longer than a threshold, grouped by query shape (literals and parameter lists are folded)
+    // The query plan is captured the first time a shape is seen
+    class SlowQueryLog
+    {
+    public:
+        struct Query
+        {
+            std::string sql;
+            std::vector<std::string> parameters; // bound values, as text
+            std::size_t rowCount{};
+            std::chrono::microseconds duration{}; // spent in SQLite, from the execution to the last row
+        };
+
+        struct Entry
+        {
+            std::string shape;
+            std::vector<std::string> queryPlan;
+            std::size_t count{};
+            std::chrono::microseconds totalDuration{};
+            std::chrono::microseconds maxDuration{};
+            Query lastQuery;
+            Wt::WDateTime lastDateTime;
+        };
+
+        SlowQueryLog(std::chrono::microseconds threshold, std::size_t maxEntryCount);
+
+        std::chrono::microseconds getThreshold() const { return _threshold; }
+
+        // Returns true if the query plan of this query shape is not known yet, see setQueryPlan
+        // Queries of new shapes are dropped once maxEntryCount shapes are recorded
+        bool record(const Query& query);
+        void setQueryPlan(std::string_view sql, std::vector<std::string> queryPlan);
+
+        // Sorted by total duration, the most costly first
+        std::vector<Entry> getEntries() const;
+        void clear();
+
+        static std::string computeQueryShape(std::string_view sql);
+
+    private:
+        SlowQueryLog(const SlowQueryLog&) = delete;
+        SlowQueryLog& operator=(const SlowQueryLog&) = delete;
+
+        const std::chrono::microseconds _threshold;
+        const std::size_t _maxEntryCount;
+
+        mutable std::mutex _mutex;
+        std::unordered_map<std::string, Entry> _entries; // by shape
+    };
+} // namespace Database
@@ -19,6 +19,8 @@
 
 #pragma once
 
+#include <functional>
+
 #include <Wt/WDateTime.h>
 #include <Wt/Dbo/Dbo.h>
 
@@ -44,6 +46,7 @@ namespace Database
         static pointer		find(Session& session, StarredArtistId id);
         static pointer		find(Session& session, ArtistId artistId, UserId userId); // current backend
         static pointer		find(Session& session, ArtistId artistId, UserId userId, FeedbackBackend backend);
+        static void			getStarredDateTimes(Session& session, UserId userId, FeedbackBackend backend, std::function<void(ArtistId artistId, const Wt::WDateTime& dateTime)> func); // pending removals are skipped
 
         // Accessors
         ObjectPtr<Artist>	getArtist() const { return _artist; }
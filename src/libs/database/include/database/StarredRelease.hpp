@@ -19,6 +19,8 @@
 
 #pragma once
 
+#include <functional>
+
 #include <Wt/WDateTime.h>
 #include <Wt/Dbo/Dbo.h>
 
@@ -44,6 +46,7 @@ namespace Database
         static pointer find(Session& session, StarredReleaseId id);
         static pointer find(Session& session, ReleaseId releaseId, UserId userId); // current feedback backend
         static pointer find(Session& session, ReleaseId releaseId, UserId userId, FeedbackBackend backend);
+        static void getStarredDateTimes(Session& session, UserId userId, FeedbackBackend backend, std::function<void(ReleaseId releaseId, const Wt::WDateTime& dateTime)> func); // pending removals are skipped
 
         // Accessors
         ObjectPtr<Release> getRelease() const { return _release; }
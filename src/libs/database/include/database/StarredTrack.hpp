@@ -19,6 +19,10 @@
 
 #pragma once
 
+#include <functional>
+#include <span>
+#include <vector>
+
 #include <Wt/WDateTime.h>
 #include <Wt/Dbo/Dbo.h>
 
@@ -57,7 +61,10 @@ namespace Database
         static pointer      find(Session& session, StarredTrackId id);
         static pointer      find(Session& session, TrackId trackId, UserId userId); // current feedback backend
         static pointer      find(Session& session, TrackId trackId, UserId userId, FeedbackBackend backend);
+        static void         find(Session& session, std::span<const TrackId> trackIds, UserId userId, std::function<void(TrackId trackId, const pointer& starredTrack)> func); // current feedback backend
         static bool         exists(Session& session, TrackId trackId, UserId userId, FeedbackBackend backend);
+        static void         getStarredDateTimes(Session& session, UserId userId, FeedbackBackend backend, std::function<void(TrackId trackId, const Wt::WDateTime& dateTime)> func); // pending removals are skipped
+        static std::vector<TrackId> findStarredTrackIds(Session& session, std::span<const TrackId> trackIds, UserId userId, FeedbackBackend backend); // subset of trackIds starred by the user for this backend
         static RangeResults<StarredTrackId>	find(Session& session, const FindParameters& findParams);
 
         // Accessors
@@ -20,9 +20,11 @@
 #pragma once
 
 #include <chrono>
+#include <cstdint>
 #include <filesystem>
 #include <ostream>
 #include <optional>
+#include <span>
 #include <string>
 #include <string_view>
 #include <utility>
@@ -37,6 +39,7 @@
 
 #include "database/ArtistId.hpp"
 #include "database/ClusterId.hpp"
+#include "database/DirectoryId.hpp"
 #include "database/MediaLibraryId.hpp"
 #include "database/Object.hpp"
 #include "database/ReleaseId.hpp"
@@ -50,6 +53,7 @@ namespace Database {
     class Artist;
     class Cluster;
     class ClusterType;
+    class Directory;
     class MediaLibrary;
     class Release;
     class Session;
@@ -67,6 +71,7 @@ namespace Database {
             std::string							name;			// if non empty, must match this name
             TrackSortMethod						sortMethod{ TrackSortMethod::None };
             std::optional<Range>    			range;
+            std::optional<Cursor>				cursor;			// if set, resume after this cursor instead of using the range offset (Name sort method only)
             Wt::WDateTime						writtenAfter;
             UserId								starringUser;	// only tracks starred by this user
             std::optional<FeedbackBackend>		feedbackBackend;	// and for this feedback backend
@@ -86,6 +91,7 @@ namespace Database {
             FindParameters& setName(std::string_view _name) { name = _name; return *this; }
             FindParameters& setSortMethod(TrackSortMethod _method) { sortMethod = _method; return *this; }
             FindParameters& setRange(std::optional<Range> _range) { range = _range; return *this; }
+            FindParameters& setCursor(const std::optional<Cursor>& _cursor) { cursor = _cursor; return *this; }
             FindParameters& setWrittenAfter(const Wt::WDateTime& _after) { writtenAfter = _after; return *this; }
             FindParameters& setStarringUser(UserId _user, FeedbackBackend _feedbackBackend) { starringUser = _user; feedbackBackend = _feedbackBackend; return *this; }
             FindParameters& setArtist(ArtistId _artist, EnumSet<TrackArtistLinkType> _trackArtistLinkTypes = {}) { artist = _artist; trackArtistLinkTypes = _trackArtistLinkTypes; return *this; }
@@ -105,47 +111,125 @@ namespace Database {
             std::filesystem::path	path;
         };
 
+        struct MBIDResult
+        {
+            TrackId					trackId;
+            UUID					mbid; // track or recording MBID, depending on the query
+        };
+
+        // Tracks sharing the same track MBID
+        struct MBIDDuplicates
+        {
+            UUID					mbid;
+            std::vector<TrackId>	trackIds; // ordered by id
+        };
+
+        // Minimal information needed to decide whether a file has to be rescanned
+        struct FileScanInfo
+        {
+            TrackId					trackId;
+            std::filesystem::path	path;
+            Wt::WDateTime			lastWriteTime;
+            std::size_t				scanVersion{};
+            MediaLibraryId			mediaLibrary;
+            std::uintmax_t			fileSize{};
+            std::optional<std::uint32_t>	contentFingerprint;
+        };
+
+        // Lightweight track description, read directly from the selected columns (no track object is loaded)
+        struct Summary
+        {
+            TrackId						trackId;
+            std::filesystem::path		path;
+            std::chrono::milliseconds	duration{};
+            ReleaseId					release;
+        };
+
+        // Release and artist of one of the artist links of a track, read directly from the selected columns (no object is loaded)
+        struct ArtistLinkIds
+        {
+            TrackId						trackId;
+            ReleaseId					releaseId;	// may be invalid
+            ArtistId					artistId;	// invalid if the track has no artist link
+            TrackArtistLinkType			linkType{};	// only meaningful if artistId is valid
+        };
+
+        // Rarely read information, stored in the track_extra side table to keep the track rows narrow
+        struct ExtraInfo
+        {
+            std::string                 discSubtitle;
+            std::string                 copyright;
+            std::string                 copyrightURL;
+
+            bool operator==(const ExtraInfo&) const = default;
+        };
+
         Track() = default;
 
         // Find utility functions
         static std::size_t				getCount(Session& session);
         static pointer					findByPath(Session& session, const std::filesystem::path& p);
+        static std::vector<pointer>		findByPaths(Session& session, std::span<const std::filesystem::path> paths);
         static pointer 					find(Session& session, TrackId id);
+        static std::vector<pointer>		find(Session& session, std::span<const TrackId> ids); // same order as ids, missing tracks are skipped
         static bool						exists(Session& session, TrackId id);
         static std::vector<pointer>		findByRecordingMBID(Session& session, const UUID& MBID);
         static std::vector<pointer>		findByMBID(Session& session, const UUID& MBID);
+        static std::vector<MBIDResult>	findIdsByRecordingMBIDs(Session& session, std::span<const UUID> MBIDs);
+        static std::vector<MBIDResult>	findIdsByMBIDs(Session& session, std::span<const UUID> MBIDs);
         static RangeResults<TrackId>	findSimilarTrackIds(Session& session, const std::vector<TrackId>& trackIds, std::optional<Range> range = std::nullopt);
 
         static RangeResults<TrackId>	findIds(Session& session, const FindParameters& parameters);
         static RangeResults<pointer>	find(Session& session, const FindParameters& parameters);
         static void						find(Session& session, const FindParameters& parameters, std::function<void(const Track::pointer&)> func);
+        static void						findSummaries(Session& session, const FindParameters& parameters, std::function<void(const Summary&)> func); // rows are streamed as they are stepped
+        static void						findArtistLinkIds(Session& session, std::function<void(const ArtistLinkIds&)> func); // all the tracks, grouped by track, rows are streamed as they are stepped
+        static void						findArtistLinkIds(Session& session, std::span<const TrackId> tracks, std::function<void(const ArtistLinkIds&)> func); // only the given tracks, grouped by track
         static RangeResults<PathResult>	findPaths(Session& session, std::optional<Range> range = std::nullopt);
-        static RangeResults<TrackId>	findIdsTrackMBIDDuplicates(Session& session, std::optional<Range> range = std::nullopt);
-        static RangeResults<TrackId>	findIdsWithRecordingMBIDAndMissingFeatures(Session& session, std::optional<Range> range = std::nullopt);
+        static RangeResults<PathResult>	findPathsWithEstimatedDuration(Session& session, std::optional<Range> range = std::nullopt);
+        static RangeResults<PathResult>	findPathsWithPendingLoudnessAnalysis(Session& session, std::optional<Range> range = std::nullopt);
+        static RangeResults<PathResult>	findPathsWithoutFeatures(Session& session, std::optional<Range> range = std::nullopt); // see TrackFeatures
+        static RangeResults<PathResult>	findPathsInDirectory(Session& session, const std::filesystem::path& directory, std::optional<Range> range = std::nullopt); // recursive
+        static RangeResults<ReleaseId>	findReleaseIdsInDirectory(Session& session, const std::filesystem::path& directory, std::optional<Range> range = std::nullopt); // releases of the tracks in the directory, recursive
+        static RangeResults<ArtistId>	findArtistIdsInDirectory(Session& session, const std::filesystem::path& directory, std::optional<Range> range = std::nullopt); // artists linked to the tracks in the directory, recursive
+        static void						findFileScanInfos(Session& session, std::function<void(const FileScanInfo&)> func);
+        static void						findNames(Session& session, std::function<void(TrackId, std::string_view name)> func); // ordered by name sort key, then id
+        // Only the MBIDs of the tracks changed after afterChangeId are considered (see CatalogueChange), ordered by MBID
+        // At most maxCount MBIDs are returned, starting right after afterMBID (to fetch the next ones)
+        static std::vector<MBIDDuplicates> findTrackMBIDDuplicates(Session& session, std::int64_t afterChangeId, const std::optional<UUID>& afterMBID, std::size_t maxCount);
+        static RangeResults<MBIDResult> findRecordingMBIDsWithMissingFeatures(Session& session, std::optional<Range> range = std::nullopt); // see TrackFeatures
+        static std::size_t				remove(Session& session, std::span<const TrackId> trackIds); // bulk removal, returns the removed track count
+        static void						setExtraInfo(Session& session, const pointer& track, const ExtraInfo& extraInfo); // flushes the session, so that new tracks get their id
+        static void						move(Session& session, const pointer& track, const std::filesystem::path& p, const ObjectPtr<MediaLibrary>& mediaLibrary); // new path, and new media library
 
         // Accessors
         void setScanVersion(std::size_t version) { _scanVersion = version; }
         void setTrackNumber(std::optional<int> num) { _trackNumber = num; }
         void setDiscNumber(std::optional<int> num) { _discNumber = num; }
         void setTotalTrack(std::optional<int> totalTrack) { _totalTrack = totalTrack; }
-        void setDiscSubtitle(const std::string& name) { _discSubtitle = name; }
-        void setName(const std::string& name) { _name = std::string(name, 0, _maxNameLength); }
-        void setPath(const std::filesystem::path& filePath) { _filePath = filePath; }
+        void setName(const std::string& name);
         void setDuration(std::chrono::milliseconds duration) { _duration = duration; }
         void setBitrate(std::size_t bitrate) { _bitrate = bitrate; }
+        void setDurationEstimated(bool estimated) { _durationEstimated = estimated; } // duration and bitrate to be refined later by the scanner
+        void setCodec(std::string_view codec) { _codec = codec; }
+        void setContainer(std::string_view container) { _container = container; }
+        void setSampleRate(std::size_t sampleRate) { _sampleRate = static_cast<int>(sampleRate); }
+        void setChannelCount(std::size_t channelCount) { _channelCount = static_cast<int>(channelCount); }
+        void setAudioStreamIndex(std::optional<std::size_t> index) { _audioStreamIndex = index ? std::optional<int>{ static_cast<int>(*index) } : std::nullopt; }
         void setLastWriteTime(Wt::WDateTime time) { _fileLastWrite = time; }
+        void setFileSize(std::uintmax_t fileSize) { _fileSize = static_cast<long long>(fileSize); }
+        void setContentFingerprint(std::optional<std::uint32_t> fingerprint) { _contentFingerprint = fingerprint; } // see PathUtils::computeFileFingerprint
         void setAddedTime(Wt::WDateTime time) { _fileAdded = time; }
-        void setDate(const Wt::WDate& date) { _date = date; }
-        void setYear(std::optional<int> year) { _year = year; }
-        void setOriginalDate(const Wt::WDate& date) { _originalDate = date; }
-        void setOriginalYear(std::optional<int> year) { _originalYear = year; }
+        void setDate(const Wt::WDate& date) { _date = date; updateSortDates(); }
+        void setYear(std::optional<int> year) { _year = year; updateSortDates(); }
+        void setOriginalDate(const Wt::WDate& date) { _originalDate = date; updateSortDates(); }
+        void setOriginalYear(std::optional<int> year) { _originalYear = year; updateSortDates(); }
         void setHasCover(bool hasCover) { _hasCover = hasCover; }
-        void setTrackMBID(const std::optional<UUID>& MBID) { _trackMBID = MBID ? MBID->getAsString() : ""; }
-        void setRecordingMBID(const std::optional<UUID>& MBID) { _recordingMBID = MBID ? MBID->getAsString() : ""; }
-        void setCopyright(const std::string& copyright) { _copyright = std::string(copyright, 0, _maxCopyrightLength); }
-        void setCopyrightURL(const std::string& copyrightURL) { _copyrightURL = std::string(copyrightURL, 0, _maxCopyrightURLLength); }
+        void setTrackMBID(const std::optional<UUID>& MBID) { _trackMBID = toMBIDBlob(MBID); }
+        void setRecordingMBID(const std::optional<UUID>& MBID) { _recordingMBID = toMBIDBlob(MBID); }
         void setTrackReplayGain(std::optional<float> replayGain) { _trackReplayGain = replayGain; }
         void setReleaseReplayGain(std::optional<float> replayGain) { _releaseReplayGain = replayGain; } // may be by disc!
+        void setLoudnessAnalysisPending(bool pending) { _loudnessAnalysisPending = pending; } // track replay gain to be computed later by the scanner
         void setArtistDisplayName(std::string_view name) { _artistDisplayName = name; }
         void clearArtistLinks();
         void addArtistLink(const ObjectPtr<TrackArtistLink>& artistLink);
@@ -157,11 +241,18 @@ namespace Database {
         std::optional<std::size_t>	getTrackNumber() const { return _trackNumber; }
         std::optional<std::size_t>	getTotalTrack() const { return _totalTrack; }
         std::optional<std::size_t>	getDiscNumber() const { return _discNumber; }
-        const std::string& getDiscSubtitle() const { return _discSubtitle; }
         std::string 				getName() const { return _name; }
-        std::filesystem::path		getPath() const { return _filePath; }
+        std::filesystem::path		getPath() const; // walks up the directories
+        std::string_view			getFileName() const { return _fileName; }
         std::chrono::milliseconds	getDuration() const { return _duration; }
         std::size_t                 getBitrate() const { return _bitrate; }
+        bool                        isDurationEstimated() const { return _durationEstimated; }
+        // Stream properties stored at scan time, empty/zero if unknown (the file has to be probed in that case)
+        std::string_view            getCodec() const { return _codec; } // libavcodec name
+        std::string_view            getContainer() const { return _container; } // libavformat name
+        std::size_t                 getSampleRate() const { return static_cast<std::size_t>(_sampleRate); }
+        std::size_t                 getChannelCount() const { return static_cast<std::size_t>(_channelCount); }
+        std::optional<std::size_t>  getAudioStreamIndex() const { return _audioStreamIndex ? std::optional<std::size_t>{ static_cast<std::size_t>(*_audioStreamIndex) } : std::nullopt; }
         const Wt::WDateTime& getLastWritten() const { return _fileLastWrite; }
         const Wt::WDate& getDate() const { return _date; }
         std::optional<int>			getYear() const { return _year; }
@@ -169,13 +260,15 @@ namespace Database {
         std::optional<int>			getOriginalYear() const { return _originalYear; };
         Wt::WDateTime				getLastWriteTime() const { return _fileLastWrite; }
         Wt::WDateTime				getAddedTime() const { return _fileAdded; }
+        std::uintmax_t				getFileSize() const { return static_cast<std::uintmax_t>(_fileSize); }
+        std::optional<std::uint32_t>	getContentFingerprint() const { return _contentFingerprint ? std::optional<std::uint32_t>{ static_cast<std::uint32_t>(*_contentFingerprint) } : std::nullopt; }
         bool						hasCover() const { return _hasCover; }
-        std::optional<UUID>			getTrackMBID() const { return UUID::fromString(_trackMBID); }
-        std::optional<UUID>			getRecordingMBID() const { return UUID::fromString(_recordingMBID); }
-        std::optional<std::string>	getCopyright() const;
-        std::optional<std::string>	getCopyrightURL() const;
+        std::optional<UUID>			getTrackMBID() const { return fromMBIDBlob(_trackMBID); }
+        std::optional<UUID>			getRecordingMBID() const { return fromMBIDBlob(_recordingMBID); }
+        ExtraInfo					getExtraInfo() const; // queried on each call, see setExtraInfo
         std::optional<float>		getTrackReplayGain() const { return _trackReplayGain; }
         std::optional<float>		getReleaseReplayGain() const { return _releaseReplayGain; }
+        bool                        isLoudnessAnalysisPending() const { return _loudnessAnalysisPending; }
         std::string_view			getArtistDisplayName() const { return _artistDisplayName; }
         // no artistLinkTypes means get all
         std::vector<ObjectPtr<Artist>>			getArtists(EnumSet<TrackArtistLinkType> artistLinkTypes) const; // no type means all
@@ -185,6 +278,7 @@ namespace Database {
         std::vector<ObjectPtr<Cluster>>			getClusters() const;
         std::vector<ClusterId>					getClusterIds() const;
         ObjectPtr<MediaLibrary>                 getMediaLibrary() const { return _mediaLibrary; }
+        ObjectPtr<Directory>                    getDirectory() const { return _directory; }
 
         std::vector<std::vector<ObjectPtr<Cluster>>> getClusterGroups(const std::vector<ClusterTypeId>& clusterTypes, std::size_t size) const;
 
@@ -195,35 +289,47 @@ namespace Database {
             Wt::Dbo::field(a, _trackNumber, "track_number");
             Wt::Dbo::field(a, _discNumber, "disc_number");
             Wt::Dbo::field(a, _totalTrack, "total_track"); // here in Track since Release does not have concept of "disc" (yet?)
-            Wt::Dbo::field(a, _discSubtitle, "disc_subtitle"); // here in Track since Release does not have concept of "disc" (yet?)
             Wt::Dbo::field(a, _name, "name");
+            Wt::Dbo::field(a, _nameSortKey, "name_sort_key");
             Wt::Dbo::field(a, _duration, "duration");
             Wt::Dbo::field(a, _bitrate, "bitrate");
+            Wt::Dbo::field(a, _durationEstimated, "duration_estimated");
+            Wt::Dbo::field(a, _codec, "codec");
+            Wt::Dbo::field(a, _container, "container");
+            Wt::Dbo::field(a, _sampleRate, "sample_rate");
+            Wt::Dbo::field(a, _channelCount, "channel_count");
+            Wt::Dbo::field(a, _audioStreamIndex, "audio_stream_index");
             Wt::Dbo::field(a, _date, "date");
             Wt::Dbo::field(a, _year, "year");
             Wt::Dbo::field(a, _originalDate, "original_date");
             Wt::Dbo::field(a, _originalYear, "original_year");
-            Wt::Dbo::field(a, _filePath, "file_path");
+            Wt::Dbo::field(a, _sortDate, "sort_date");
+            Wt::Dbo::field(a, _originalSortDate, "original_sort_date");
+            Wt::Dbo::field(a, _fileName, "file_name");
             Wt::Dbo::field(a, _fileLastWrite, "file_last_write");
             Wt::Dbo::field(a, _fileAdded, "file_added");
+            Wt::Dbo::field(a, _fileSize, "file_size");
+            Wt::Dbo::field(a, _contentFingerprint, "content_fingerprint");
             Wt::Dbo::field(a, _hasCover, "has_cover");
             Wt::Dbo::field(a, _trackMBID, "mbid");
             Wt::Dbo::field(a, _recordingMBID, "recording_mbid");
-            Wt::Dbo::field(a, _copyright, "copyright");
-            Wt::Dbo::field(a, _copyrightURL, "copyright_url");
             Wt::Dbo::field(a, _trackReplayGain, "track_replay_gain");
             Wt::Dbo::field(a, _releaseReplayGain, "release_replay_gain"); // here in Track since Release does not have concept of "disc" (yet?)
+            Wt::Dbo::field(a, _loudnessAnalysisPending, "loudness_analysis_pending");
             Wt::Dbo::field(a, _artistDisplayName, "artist_display_name");
             Wt::Dbo::belongsTo(a, _release, "release", Wt::Dbo::OnDeleteCascade);
             Wt::Dbo::belongsTo(a, _mediaLibrary, "media_library", Wt::Dbo::OnDeleteSetNull); // don't delete track on media library removal, we want to wait for the next scan to have a chance to migrate files
+            Wt::Dbo::belongsTo(a, _directory, "directory", Wt::Dbo::OnDeleteCascade);
             Wt::Dbo::hasMany(a, _trackArtistLinks, Wt::Dbo::ManyToOne, "track");
             Wt::Dbo::hasMany(a, _clusters, Wt::Dbo::ManyToMany, "track_cluster", "", Wt::Dbo::OnDeleteCascade);
         }
 
     private:
         friend class ::Database::Session;
-        Track(const std::filesystem::path& p);
-        static pointer create(Session& session, const std::filesystem::path& p);
+        Track(ObjectPtr<Directory> directory, std::string_view fileName);
+        static pointer create(Session& session, const std::filesystem::path& p, const ObjectPtr<MediaLibrary>& mediaLibrary = {});
+
+        void updateSortDates();
 
         static constexpr std::size_t _maxNameLength{ 256 };
         static constexpr std::size_t _maxCopyrightLength{ 256 };
@@ -233,28 +339,38 @@ namespace Database {
         std::optional<int>		_trackNumber{};
         std::optional<int>		_discNumber{};
         std::optional<int>		_totalTrack{};
-        std::string				_discSubtitle;
         std::string				_name;
+        std::string				_nameSortKey; // see StringUtils::computeSortKey
         std::chrono::duration<int, std::milli>	_duration{};
         int                     _bitrate; // in bps
+        bool                    _durationEstimated{};
+        std::string             _codec;
+        std::string             _container;
+        int                     _sampleRate{};
+        int                     _channelCount{};
+        std::optional<int>      _audioStreamIndex;
         Wt::WDate				_date;
         std::optional<int>      _year;
         Wt::WDate				_originalDate;
         std::optional<int>      _originalYear;
-        std::string				_filePath;
+        std::optional<int>      _sortDate; // YYYYMMDD from the date, or else from the year (MMDD = 0000)
+        std::optional<int>      _originalSortDate; // same from the original date or year, or else the sort date
+        std::string				_fileName; // in the directory
         Wt::WDateTime			_fileLastWrite;
         Wt::WDateTime			_fileAdded;
+        long long				_fileSize{};
+        std::optional<long long>	_contentFingerprint;
         bool					_hasCover{};
-        std::string				_trackMBID;
-        std::string				_recordingMBID;
-        std::string				_copyright;
-        std::string				_copyrightURL;
+        MBIDBlob				_trackMBID;
+        MBIDBlob				_recordingMBID;
         std::optional<float>	_trackReplayGain;
         std::optional<float>	_releaseReplayGain;
+        bool                    _loudnessAnalysisPending{};
         std::string				_artistDisplayName;
 
         Wt::Dbo::ptr<Release>                               _release;
         Wt::Dbo::ptr<MediaLibrary>                          _mediaLibrary;
+        Wt::Dbo::ptr<Directory>                             _directory;
         Wt::Dbo::collection<Wt::Dbo::ptr<TrackArtistLink>>  _trackArtistLinks;
         Wt::Dbo::collection<Wt::Dbo::ptr<Cluster>>          _clusters;
     };
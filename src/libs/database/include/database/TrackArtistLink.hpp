@@ -19,7 +19,9 @@
 
 #pragma once
 
+#include <functional>
 #include <optional>
+#include <span>
 #include <string>
 #include <string_view>
 
@@ -34,12 +36,44 @@
 #include "utils/EnumSet.hpp"
 
 LMS_DECLARE_IDTYPE(TrackArtistLinkId)
+LMS_DECLARE_IDTYPE(TrackArtistLinkSubTypeId)
 
 namespace Database
 {
     class Artist;
     class Session;
     class Track;
+    class TrackArtistLink;
+
+    // Interned link sub types (performer roles), shared by all the links
+    class TrackArtistLinkSubType final : public Object<TrackArtistLinkSubType, TrackArtistLinkSubTypeId>
+    {
+    public:
+        TrackArtistLinkSubType() = default;
+        static pointer  find(Session& session, TrackArtistLinkSubTypeId id);
+        static pointer  find(Session& session, std::string_view name);
+        static pointer  getOrCreate(Session& session, std::string_view name);
+
+        // Accessors
+        std::string_view getName() const { return _name; }
+
+        template<class Action>
+        void persist(Action& a)
+        {
+            Wt::Dbo::field(a, _name, "name");
+            Wt::Dbo::hasMany(a, _links, Wt::Dbo::ManyToOne, "subtype");
+        }
+
+    private:
+        static constexpr std::size_t _maxNameLength{ 128 };
+
+        friend class Session;
+        TrackArtistLinkSubType(std::string_view name);
+        static pointer create(Session& session, std::string_view name);
+
+        std::string _name;
+        Wt::Dbo::collection<Wt::Dbo::ptr<TrackArtistLink>> _links; // links having this sub type
+    };
 
     class TrackArtistLink final : public Object<TrackArtistLink, TrackArtistLinkId>
     {
@@ -60,33 +94,36 @@ namespace Database
         };
 
         TrackArtistLink() = default;
-        TrackArtistLink(ObjectPtr<Track> track, ObjectPtr<Artist> artist, TrackArtistLinkType type, std::string_view subType);
+        TrackArtistLink(ObjectPtr<Track> track, ObjectPtr<Artist> artist, TrackArtistLinkType type, ObjectPtr<TrackArtistLinkSubType> subType);
 
         static RangeResults<TrackArtistLinkId>	find(Session& session, const FindParameters& parameters);
         static pointer 							find(Session& session, TrackArtistLinkId linkId);
-        static pointer							create(Session& session, ObjectPtr<Track> track, ObjectPtr<Artist> artist, TrackArtistLinkType type, std::string_view subType = {});
+        // Links of several tracks at once, along with their artist
+        static void                             find(Session& session, std::span<const TrackId> tracks, std::function<void(TrackId track, const pointer& link, const ObjectPtr<Artist>& artist)> func);
+        static pointer							create(Session& session, ObjectPtr<Track> track, ObjectPtr<Artist> artist, TrackArtistLinkType type, std::string_view subType = {}); // subType is interned
+        static pointer							create(Session& session, ObjectPtr<Track> track, ObjectPtr<Artist> artist, TrackArtistLinkType type, ObjectPtr<TrackArtistLinkSubType> subType);
         static EnumSet<TrackArtistLinkType>     findUsedTypes(Session& session);
         static EnumSet<TrackArtistLinkType>     findUsedTypes(Session& session, ArtistId _artist);
 
         ObjectPtr<Track>		getTrack() const { return _track; }
         ObjectPtr<Artist>		getArtist() const { return _artist; }
         TrackArtistLinkType		getType() const { return _type; }
-        std::string_view		getSubType() const { return _subType; }
+        std::string_view		getSubType() const { return _subType ? _subType->getName() : std::string_view{}; }
 
         template<class Action>
         void persist(Action& a)
         {
             Wt::Dbo::field(a, _type, "type");
-            Wt::Dbo::field(a, _subType, "subtype");
 
+            Wt::Dbo::belongsTo(a, _subType, "subtype", Wt::Dbo::OnDeleteSetNull);
             Wt::Dbo::belongsTo(a, _track, "track", Wt::Dbo::OnDeleteCascade);
             Wt::Dbo::belongsTo(a, _artist, "artist", Wt::Dbo::OnDeleteCascade);
         }
 
     private:
         TrackArtistLinkType _type;
-        std::string _subType;
 
+        Wt::Dbo::ptr<TrackArtistLinkSubType> _subType;
         Wt::Dbo::ptr<Track> _track;
         Wt::Dbo::ptr<Artist> _artist;
     };
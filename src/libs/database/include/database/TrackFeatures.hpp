@@ -19,7 +19,9 @@
 
 #pragma once
 
+#include <functional>
 #include <optional>
+#include <span>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
@@ -48,11 +50,25 @@ class TrackFeatures final : public Object<TrackFeatures, TrackFeaturesId>
 	public:
 		TrackFeatures() = default;
 
+		// Undecoded features, to be processed outside of the transaction
+		struct RawFeatures
+		{
+			TrackFeaturesId	id;
+			TrackId			trackId;
+			std::string		data;			// json encoded features, empty if the packed features are up to date
+			std::vector<float>	packedFeatures;	// empty if not up to date
+		};
+
 		// Find utilities
 		static std::size_t						getCount(Session& session);
 		static pointer							find(Session& session, TrackFeaturesId id);
 		static pointer							find(Session& session, TrackId trackId);
 		static RangeResults<TrackFeaturesId>	find(Session& session, std::optional<Range> range = std::nullopt);
+		// at most count entries by ascending id, starting after lastRetrievedId (updated, may be invalid to start from the first one)
+		// json data is only retrieved for entries whose packed features do not match packedFeaturesVersion
+		static void								findRawFeatures(Session& session, TrackFeaturesId& lastRetrievedId, std::size_t count, long long packedFeaturesVersion, std::function<void(RawFeatures&&)> func);
+		// Packed features are pre-extracted values, the version identifies their layout
+		static void								updatePackedFeatures(Session& session, TrackFeaturesId id, std::span<const float> packedFeatures, long long packedFeaturesVersion);
 
 		FeatureValues		getFeatureValues(const FeatureName& feature) const;
 		FeatureValuesMap	getFeatureValuesMap(const std::unordered_set<FeatureName>& featureNames) const;
@@ -64,6 +80,8 @@ class TrackFeatures final : public Object<TrackFeatures, TrackFeaturesId>
 		void persist(Action& a)
 		{
 			Wt::Dbo::field(a, _data,	"data");
+			Wt::Dbo::field(a, _packedFeatures,	"packed_features");
+			Wt::Dbo::field(a, _packedFeaturesVersion,	"packed_features_version");
 			Wt::Dbo::belongsTo(a, _track, "track", Wt::Dbo::OnDeleteCascade);
 		}
 
@@ -73,6 +91,8 @@ class TrackFeatures final : public Object<TrackFeatures, TrackFeaturesId>
 		static pointer create(Session& session, ObjectPtr<Track> track, const std::string& jsonEncodedFeatures);
 
 		std::string _data;
+		std::vector<unsigned char> _packedFeatures;
+		long long _packedFeaturesVersion {};
 		Wt::Dbo::ptr<Track> _track;
 };
 
@@ -19,6 +19,7 @@
 
 #pragma once
 
+#include <chrono>
 #include <optional>
 #include <string>
 #include <string_view>
@@ -69,6 +70,8 @@ namespace Database {
         static pointer						find(Session& session, std::string_view name, TrackListType type, UserId userId);
         static pointer						find(Session& session, TrackListId tracklistId);
         static RangeResults<TrackListId>	find(Session& session, const FindParameters& params);
+        // Recompute the cached track counts and durations of all the tracklists at once (tracks may have been removed or modified by the scanner)
+        static void							updateAggregates(Session& session);
 
         // Accessors
         std::string_view	getName() const { return _name; }
@@ -79,17 +82,23 @@ namespace Database {
         // Modifiers
         void		setName(const std::string& name) { _name = name; }
         void		setIsPublic(bool isPublic) { _isPublic = isPublic; }
-        void		clear() { _entries.clear(); }
+        void		clear();
+
+        // Bulk modifiers: a few statements whatever the entry count (unknown tracks are skipped)
+        void		appendTracks(const std::vector<TrackId>& trackIds);
+        void		replaceTracks(const std::vector<TrackId>& trackIds);
+        void		removeEntries(const std::vector<std::size_t>& positions); // out of range positions are ignored
+        void		moveEntry(std::size_t fromPos, std::size_t toPos); // only rewrites the entries in between
 
         // Get tracks, ordered by position
         bool										isEmpty() const;
-        std::size_t									getCount() const;
+        std::size_t									getCount() const { return _trackCount; } // cached
         ObjectPtr<TrackListEntry>					getEntry(std::size_t pos) const;
         std::vector<ObjectPtr<TrackListEntry>>		getEntries(std::optional<Range> range = {}) const;
         ObjectPtr<TrackListEntry>					getEntryByTrackAndDateTime(ObjectPtr<Track> track, const Wt::WDateTime& dateTime) const;
 
         std::vector<TrackId>						getTrackIds() const;
-        std::chrono::milliseconds					getDuration() const;
+        std::chrono::milliseconds					getDuration() const { return std::chrono::milliseconds{ _duration }; } // cached
 
         void										setLastModifiedDateTime(const Wt::WDateTime& dateTime);
 
@@ -110,6 +119,8 @@ namespace Database {
             Wt::Dbo::field(a, _isPublic, "public");
             Wt::Dbo::field(a, _creationDateTime, "creation_date_time");
             Wt::Dbo::field(a, _lastModifiedDateTime, "last_modified_date_time");
+            Wt::Dbo::field(a, _trackCount, "track_count");
+            Wt::Dbo::field(a, _duration, "duration");
 
             Wt::Dbo::belongsTo(a, _user, "user", Wt::Dbo::OnDeleteCascade);
             Wt::Dbo::hasMany(a, _entries, Wt::Dbo::ManyToOne, "tracklist");
@@ -117,14 +128,19 @@ namespace Database {
 
     private:
         friend class Session;
+        friend class TrackListEntry;
         TrackList(std::string_view name, TrackListType type, bool isPublic, ObjectPtr<User> user);
         static pointer create(Session& session, std::string_view name, TrackListType type, bool isPublic, ObjectPtr<User> user);
 
+        void refreshAggregates(); // after bulk modifications
+
         std::string		_name;
         TrackListType	_type{ TrackListType::Playlist };
         bool			_isPublic{ false };
         Wt::WDateTime	_creationDateTime;
         Wt::WDateTime	_lastModifiedDateTime;
+        int				_trackCount{};
+        long long		_duration{}; // in ms
 
         Wt::Dbo::ptr<User>	_user;
         Wt::Dbo::collection<Wt::Dbo::ptr<TrackListEntry>> _entries;
@@ -159,6 +175,7 @@ namespace Database {
 
     private:
         friend class Session;
+        friend class TrackList;
         TrackListEntry(ObjectPtr<Track> track, ObjectPtr<TrackList> tracklist, const Wt::WDateTime& dateTime);
         TrackListEntry(ObjectPtr<Track> track, ObjectPtr<TrackList> tracklist);
         static pointer create(Session& session, ObjectPtr<Track> track, ObjectPtr<TrackList> tracklist, const Wt::WDateTime& dateTime = {});
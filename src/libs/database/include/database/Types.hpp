@@ -19,11 +19,18 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cstdint>
 #include <cassert>
 #include <functional>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
 #include <Wt/WDate.h>
 
+#include "utils/UUID.hpp"
+
 namespace Database
 {
     // Caution: do not change enum values if they are set!
@@ -57,14 +64,60 @@ namespace Database
         }
     }
 
+    // MBIDs are stored as 16-byte BLOBs, empty if not set
+    using MBIDBlob = std::vector<unsigned char>;
+
+    inline MBIDBlob toMBIDBlob(const UUID& mbid)
+    {
+        return MBIDBlob(std::cbegin(mbid.getAsBytes()), std::cend(mbid.getAsBytes()));
+    }
+
+    inline MBIDBlob toMBIDBlob(const std::optional<UUID>& mbid)
+    {
+        return mbid ? toMBIDBlob(*mbid) : MBIDBlob{};
+    }
+
+    inline std::optional<UUID> fromMBIDBlob(const MBIDBlob& blob)
+    {
+        return UUID::fromBytes(blob);
+    }
+
+    // Keyset pagination: resumes right after the last result of the previous page, instead of
+    // skipping the range offset results. Only supported by the name based sort methods
+    // Opaque, just get it from the previous RangeResults
+    struct Cursor
+    {
+        std::string sortKey;
+        long long id{};
+
+        bool operator==(const Cursor& other) const = default;
+    };
+
+    // Non owning view on (some of) the results of a RangeResults, must not outlive them
+    template <typename T>
+    struct RangeResultsView
+    {
+        Range range;
+        std::span<const T> results;
+        bool moreResults{};
+        std::optional<Cursor> nextCursor; // set if more results and if the query supports cursors
+    };
+
     template <typename T>
     struct RangeResults
     {
         Range range;
         std::vector<T> results;
         bool moreResults{};
+        std::optional<Cursor> nextCursor; // set if more results and if the query supports cursors
 
-        RangeResults getSubRange(Range subRange)
+        RangeResultsView<T> getView() const
+        {
+            return RangeResultsView<T>{ range, results, moreResults, nextCursor };
+        }
+
+        // subRange.size = 0 means up to the end of the results
+        RangeResultsView<T> getSubRangeView(Range subRange) const
         {
             assert(subRange.offset >= range.offset);
 
@@ -74,21 +127,37 @@ namespace Database
             subRange.offset = std::min(subRange.offset, range.offset + range.size);
             subRange.size = std::min(subRange.size, range.offset + range.size - subRange.offset);
 
-            RangeResults subResults;
-
-            auto itBegin{ std::cbegin(results) + subRange.offset - range.offset };
-            auto itEnd{ itBegin + subRange.size };
-            subResults.results.reserve(std::distance(itBegin, itEnd));
-            std::copy(itBegin, itEnd, std::back_inserter(subResults.results));
-
+            RangeResultsView<T> subResults;
             subResults.range = subRange;
+            subResults.results = std::span<const T>{ results }.subspan(subRange.offset - range.offset, subRange.size);
             if (subRange.offset + subRange.size == range.offset + range.size)
+            {
                 subResults.moreResults = moreResults;
+                subResults.nextCursor = nextCursor;
+            }
             else
                 subResults.moreResults = true;
 
             return subResults;
         }
+
+        RangeResults getSubRange(Range subRange) const &
+        {
+            const RangeResultsView<T> view{ getSubRangeView(subRange) };
+            return RangeResults{ view.range, std::vector<T>(std::cbegin(view.results), std::cend(view.results)), view.moreResults, view.nextCursor };
+        }
+
+        // The selected results are moved out, no copy is made
+        RangeResults getSubRange(Range subRange) &&
+        {
+            RangeResultsView<T> view{ getSubRangeView(subRange) };
+            const std::size_t begin{ static_cast<std::size_t>(view.results.data() - results.data()) };
+
+            results.erase(std::begin(results) + begin + view.results.size(), std::end(results));
+            results.erase(std::begin(results), std::begin(results) + begin);
+
+            return RangeResults{ view.range, std::move(results), view.moreResults, std::move(view.nextCursor) };
+        }
     };
 
     struct DateRange
@@ -99,6 +168,16 @@ namespace Database
         static DateRange fromYearRange(int from, int to);
     };
 
+    // Inclusive range of months, as YYYYMM (see the listen period stats)
+    struct MonthRange
+    {
+        int begin;
+        int end;
+
+        static MonthRange fromMonth(int year, int month);
+        static MonthRange fromYear(int year);
+    };
+
     struct DiscInfo
     {
         std::size_t position;
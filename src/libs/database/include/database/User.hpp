@@ -56,6 +56,18 @@ namespace Database {
             FindParameters& setRange(std::optional<Range> _range) { range = _range; return *this; }
         };
 
+        // Settings read on hot paths, cached in memory: see getSettings
+        struct Settings
+        {
+            UserType                type;
+            FeedbackBackend         feedbackBackend;
+            ScrobblingBackend       scrobblingBackend;
+            SubsonicArtistListMode  subsonicArtistListMode;
+            bool                    subsonicEnableTranscodingByDefault;
+            TranscodingOutputFormat subsonicDefaultTranscodingOutputFormat;
+            Bitrate                 subsonicDefaultTranscodingOutputBitrate;
+        };
+
         static inline constexpr std::size_t             MinNameLength{ 3 };
         static inline constexpr std::size_t             MaxNameLength{ 15 };
         static inline constexpr bool                    defaultSubsonicEnableTranscodingByDefault{ false };
@@ -68,11 +80,16 @@ namespace Database {
 
         User() = default;
 
+        bool hasOnPreModify() const override { return true; }
+        void onPreModify() override; // invalidates the cached settings
+
         static std::size_t          getCount(Session& session);
         static pointer              find(Session& session, UserId id);
         static pointer              find(Session& session, std::string_view loginName);
         static RangeResults<UserId> find(Session& session, const FindParameters& params);
         static pointer              findDemoUser(Session& session);
+        // No DB access if already cached, the cache is invalidated once a transaction modifying any user is committed
+        static std::optional<Settings> getSettings(Session& session, UserId id);
 
         // accessors
         const std::string& getLoginName() const { return _loginName; }
@@ -95,7 +112,8 @@ namespace Database {
         void setSubsonicArtistListMode(SubsonicArtistListMode mode) { _subsonicArtistListMode = mode; }
         void setFeedbackBackend(FeedbackBackend feedbackBackend) { _feedbackBackend = feedbackBackend; }
         void setScrobblingBackend(ScrobblingBackend scrobblingBackend) { _scrobblingBackend = scrobblingBackend; }
-        void setListenBrainzToken(const std::optional<UUID>& MBID) { _listenbrainzToken = MBID ? MBID->getAsString() : ""; }
+        void setListenBrainzToken(const std::optional<UUID>& MBID);
+        void setListenBrainzFeedbacksSyncDateTime(const Wt::WDateTime& dateTime) { _listenbrainzFeedbacksSyncDateTime = dateTime; }
 
         // read
         bool                    isAdmin() const { return _type == UserType::ADMIN; }
@@ -112,6 +130,7 @@ namespace Database {
         FeedbackBackend         getFeedbackBackend() const { return _feedbackBackend; }
         ScrobblingBackend       getScrobblingBackend() const { return _scrobblingBackend; }
         std::optional<UUID>     getListenBrainzToken() const { return UUID::fromString(_listenbrainzToken); }
+        const Wt::WDateTime&    getListenBrainzFeedbacksSyncDateTime() const { return _listenbrainzFeedbacksSyncDateTime; } // creation date of the most recent feedback already fetched
 
         template<class Action>
         void persist(Action& a)
@@ -129,6 +148,7 @@ namespace Database {
             Wt::Dbo::field(a, _feedbackBackend, "feedback_backend");
             Wt::Dbo::field(a, _scrobblingBackend, "scrobbling_backend");
             Wt::Dbo::field(a, _listenbrainzToken, "listenbrainz_token");
+            Wt::Dbo::field(a, _listenbrainzFeedbacksSyncDateTime, "listenbrainz_feedbacks_sync_date_time");
 
             // UI player settings
             Wt::Dbo::field(a, _curPlayingTrackPos, "cur_playing_track_pos");
@@ -151,6 +171,7 @@ namespace Database {
         FeedbackBackend _feedbackBackend{ defaultFeedbackBackend };
         ScrobblingBackend _scrobblingBackend{ defaultScrobblingBackend };
         std::string     _listenbrainzToken; // Musicbrainz Identifier
+        Wt::WDateTime   _listenbrainzFeedbacksSyncDateTime;
 
         // Admin defined settings
         UserType        _type{ UserType::REGULAR };
@@ -181,6 +181,75 @@ TEST_F(DatabaseFixture, Artist_singleTrack_mediaLibrary)
     }
 }
 
+TEST_F(DatabaseFixture, Artist_linkTypes)
+{
+    ScopedTrack track1{ session, "MyTrack1" };
+    ScopedTrack track2{ session, "MyTrack2" };
+    ScopedArtist artist{ session, "MyArtist" };
+    ScopedMediaLibrary library1{ session };
+    ScopedMediaLibrary library2{ session };
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+
+        track1.get().modify()->setMediaLibrary(library1.get());
+        track2.get().modify()->setMediaLibrary(library2.get());
+        TrackArtistLink::create(session, track1.get(), artist.get(), TrackArtistLinkType::Artist);
+        TrackArtistLink::create(session, track2.get(), artist.get(), TrackArtistLinkType::Composer);
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+        EXPECT_TRUE(artist->getLinkTypes().empty());
+    }
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+        Artist::updateLinkTypes(session);
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+        EXPECT_EQ(artist->getLinkTypes(), (EnumSet<TrackArtistLinkType>{ TrackArtistLinkType::Artist, TrackArtistLinkType::Composer }));
+
+        EXPECT_EQ(Artist::findIds(session, Artist::FindParameters{}.setLinkType(TrackArtistLinkType::Artist)).results.size(), 1);
+        EXPECT_EQ(Artist::findIds(session, Artist::FindParameters{}.setLinkType(TrackArtistLinkType::Composer)).results.size(), 1);
+        EXPECT_EQ(Artist::findIds(session, Artist::FindParameters{}.setLinkType(TrackArtistLinkType::Writer)).results.size(), 0);
+
+        EXPECT_EQ(Artist::findIds(session, Artist::FindParameters{}.setLinkType(TrackArtistLinkType::Artist).setMediaLibrary(library1->getId())).results.size(), 1);
+        EXPECT_EQ(Artist::findIds(session, Artist::FindParameters{}.setLinkType(TrackArtistLinkType::Artist).setMediaLibrary(library2->getId())).results.size(), 0);
+        EXPECT_EQ(Artist::findIds(session, Artist::FindParameters{}.setLinkType(TrackArtistLinkType::Composer).setMediaLibrary(library2->getId())).results.size(), 1);
+
+        // track based filters still use the links
+        EXPECT_EQ(Artist::findIds(session, Artist::FindParameters{}.setLinkType(TrackArtistLinkType::Composer).setTrack(track1->getId())).results.size(), 0);
+        EXPECT_EQ(Artist::findIds(session, Artist::FindParameters{}.setLinkType(TrackArtistLinkType::Composer).setTrack(track2->getId())).results.size(), 1);
+    }
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+        track2.get().modify()->setMediaLibrary(library1.get());
+        Artist::updateLinkTypes(session);
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+        EXPECT_EQ(Artist::findIds(session, Artist::FindParameters{}.setLinkType(TrackArtistLinkType::Composer).setMediaLibrary(library1->getId())).results.size(), 1);
+        EXPECT_EQ(Artist::findIds(session, Artist::FindParameters{}.setLinkType(TrackArtistLinkType::Composer).setMediaLibrary(library2->getId())).results.size(), 0);
+    }
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+        track2.get().remove();
+        Artist::updateLinkTypes(session);
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+        EXPECT_EQ(artist->getLinkTypes(), (EnumSet<TrackArtistLinkType>{ TrackArtistLinkType::Artist }));
+        EXPECT_EQ(Artist::findIds(session, Artist::FindParameters{}.setLinkType(TrackArtistLinkType::Composer)).results.size(), 0);
+    }
+}
+
 TEST_F(DatabaseFixture, Artist_singleTracktMultiRoles)
 {
     ScopedTrack track{ session, "MyTrack" };
@@ -191,6 +260,7 @@ TEST_F(DatabaseFixture, Artist_singleTracktMultiRoles)
         TrackArtistLink::create(session, track.get(), artist.get(), TrackArtistLinkType::Artist);
         TrackArtistLink::create(session, track.get(), artist.get(), TrackArtistLinkType::ReleaseArtist);
         TrackArtistLink::create(session, track.get(), artist.get(), TrackArtistLinkType::Writer);
+        Artist::updateLinkTypes(session);
     }
 
     {
@@ -332,6 +402,30 @@ TEST_F(DatabaseFixture, Artist_findByName)
     }
 }
 
+TEST_F(DatabaseFixture, Artist_findByNamesAndMBIDs)
+{
+    const UUID mbid{ UUID::generate() };
+    ScopedArtist artist1{ session, "MyArtist" };
+    ScopedArtist artist2{ session, "MyArtist", mbid };
+    ScopedArtist artist3{ session, "MyOtherArtist" };
+
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        EXPECT_EQ(Artist::findByNames(session, std::vector<std::string>{}).size(), 0);
+        EXPECT_EQ(Artist::findByNames(session, std::vector<std::string>{ "NNN" }).size(), 0);
+
+        const auto artists{ Artist::findByNames(session, std::vector<std::string>{ "MyArtist", "MyOtherArtist", "NNN" }) };
+        ASSERT_EQ(artists.size(), 3);
+        EXPECT_EQ(artists[0]->getId(), artist2.getId()); // mbid entries first
+
+        EXPECT_EQ(Artist::findByMBIDs(session, std::vector<UUID>{ UUID::generate() }).size(), 0);
+        const auto artistsByMBID{ Artist::findByMBIDs(session, std::vector<UUID>{ mbid, UUID::generate() }) };
+        ASSERT_EQ(artistsByMBID.size(), 1);
+        EXPECT_EQ(artistsByMBID.front()->getId(), artist2.getId());
+    }
+}
+
 TEST_F(DatabaseFixture, Artist_findByNameEscaped)
 {
     ScopedArtist artist1{ session, R"(MyArtist%)" };
@@ -421,6 +515,67 @@ TEST_F(DatabaseFixture, Artist_sortMethod)
     }
 }
 
+TEST_F(DatabaseFixture, Artist_sortMethod_accentsAndCase)
+{
+    ScopedArtist artistA{ session, "Émilie Simon" };
+    ScopedArtist artistB{ session, "ezra" };
+    ScopedArtist artistC{ session, "Fabrice" };
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+        artistA.get().modify()->setSortName("Simon, Émilie");
+        artistB.get().modify()->setSortName("Ézra");
+        artistC.get().modify()->setSortName("fabrice");
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        const auto allArtistsByName{ Artist::findIds(session, Artist::FindParameters {}.setSortMethod(ArtistSortMethod::ByName)) };
+        ASSERT_EQ(allArtistsByName.results.size(), 3);
+        EXPECT_EQ(allArtistsByName.results[0], artistA.getId());
+        EXPECT_EQ(allArtistsByName.results[1], artistB.getId());
+        EXPECT_EQ(allArtistsByName.results[2], artistC.getId());
+
+        const auto allArtistsBySortName{ Artist::findIds(session, Artist::FindParameters {}.setSortMethod(ArtistSortMethod::BySortName)) };
+        ASSERT_EQ(allArtistsBySortName.results.size(), 3);
+        EXPECT_EQ(allArtistsBySortName.results[0], artistB.getId());
+        EXPECT_EQ(allArtistsBySortName.results[1], artistC.getId());
+        EXPECT_EQ(allArtistsBySortName.results[2], artistA.getId());
+
+        EXPECT_EQ(artistA.get()->getIndexLetter(), "S");
+        EXPECT_EQ(artistB.get()->getIndexLetter(), "E");
+    }
+}
+
+TEST_F(DatabaseFixture, Artist_findNames)
+{
+    ScopedArtist artistB{ session, "artistB" };
+    ScopedArtist artistA{ session, "ArtistA" };
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+        artistA.get().modify()->setSortName("sortNameA");
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        std::vector<std::tuple<ArtistId, std::string, std::string>> names;
+        Artist::findNames(session, [&](ArtistId artistId, std::string_view name, std::string_view sortName)
+            {
+                names.emplace_back(artistId, name, sortName);
+            });
+
+        ASSERT_EQ(names.size(), 2);
+        EXPECT_EQ(std::get<0>(names[0]), artistA.getId());
+        EXPECT_EQ(std::get<1>(names[0]), "ArtistA");
+        EXPECT_EQ(std::get<2>(names[0]), "sortNameA");
+        EXPECT_EQ(std::get<0>(names[1]), artistB.getId());
+        EXPECT_EQ(std::get<1>(names[1]), "artistB");
+    }
+}
+
 TEST_F(DatabaseFixture, Artist_nonReleaseTracks)
 {
     ScopedArtist artist{ session, "artist" };
@@ -488,3 +643,29 @@ TEST_F(DatabaseFixture, Artist_findByRelease)
         EXPECT_EQ(artists.results.front(), artist.getId());
     }
 }
+
+TEST_F(DatabaseFixture, Artist_removeOrphans)
+{
+    ScopedTrack track{ session, "MyTrack" };
+    ScopedArtist artist{ session, "MyArtist" };
+    ScopedArtist orphanArtist{ session, "MyOrphanArtist" };
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+        TrackArtistLink::create(session, track.get(), artist.get(), TrackArtistLinkType::Artist);
+    }
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+        EXPECT_EQ(Artist::removeOrphans(session), 1);
+        EXPECT_EQ(Artist::removeOrphans(session), 0);
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        EXPECT_TRUE(Artist::exists(session, artist.getId()));
+        EXPECT_FALSE(Artist::exists(session, orphanArtist.getId()));
+        EXPECT_EQ(Artist::findOrphanIds(session).results.size(), 0);
+    }
+}
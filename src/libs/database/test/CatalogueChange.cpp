@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Common.hpp"
+
+#include <optional>
+
+#include "database/CatalogueChange.hpp"
+
+using namespace Database;
+
+TEST_F(DatabaseFixture, CatalogueChange)
+{
+    std::int64_t initialChangeId;
+    {
+        auto transaction{ session.createReadTransaction() };
+        initialChangeId = CatalogueChange::getLastChangeId(session);
+    }
+
+    auto findChanges{ [&](CatalogueChange::EntityType type, bool removed, std::int64_t afterChangeId)
+        {
+            auto transaction{ session.createReadTransaction() };
+            return CatalogueChange::find(session, type, removed, afterChangeId, CatalogueChange::getLastChangeId(session), 100);
+        } };
+
+    std::optional<ScopedTrack> track1{ std::in_place, session, "MyTrackFile1" };
+    ScopedTrack track2{ session, "MyTrackFile2" };
+    {
+        const auto changes{ findChanges(CatalogueChange::EntityType::Track, false, initialChangeId) };
+        ASSERT_EQ(changes.size(), 2);
+        EXPECT_EQ(changes[0].entityId, track1->getId().getValue());
+        EXPECT_EQ(changes[1].entityId, track2.getId().getValue());
+        EXPECT_LT(changes[0].changeId, changes[1].changeId);
+
+        EXPECT_TRUE(findChanges(CatalogueChange::EntityType::Track, true, initialChangeId).empty());
+        EXPECT_TRUE(findChanges(CatalogueChange::EntityType::Artist, false, initialChangeId).empty());
+    }
+
+    // modified entities are reported once, after the others
+    {
+        auto transaction{ session.createWriteTransaction() };
+        track1->get().modify()->setName("MyTrack");
+    }
+    {
+        const auto changes{ findChanges(CatalogueChange::EntityType::Track, false, initialChangeId) };
+        ASSERT_EQ(changes.size(), 2);
+        EXPECT_EQ(changes[0].entityId, track2.getId().getValue());
+        EXPECT_EQ(changes[1].entityId, track1->getId().getValue());
+    }
+
+    std::int64_t changeId;
+    {
+        auto transaction{ session.createReadTransaction() };
+        changeId = CatalogueChange::getLastChangeId(session);
+    }
+    EXPECT_TRUE(findChanges(CatalogueChange::EntityType::Track, false, changeId).empty());
+
+    const TrackId removedTrackId{ track1->getId() };
+    track1.reset();
+    {
+        EXPECT_TRUE(findChanges(CatalogueChange::EntityType::Track, false, changeId).empty());
+
+        const auto changes{ findChanges(CatalogueChange::EntityType::Track, true, changeId) };
+        ASSERT_EQ(changes.size(), 1);
+        EXPECT_EQ(changes[0].entityId, removedTrackId.getValue());
+    }
+
+    {
+        ScopedArtist artist{ session, "MyArtist" };
+        ScopedRelease release{ session, "MyRelease" };
+
+        EXPECT_EQ(findChanges(CatalogueChange::EntityType::Artist, false, changeId).size(), 1);
+        EXPECT_EQ(findChanges(CatalogueChange::EntityType::Release, false, changeId).size(), 1);
+    }
+}
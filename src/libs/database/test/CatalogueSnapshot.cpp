@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Common.hpp"
+
+#include "database/CatalogueSnapshot.hpp"
+
+using namespace Database;
+
+TEST_F(DatabaseFixture, CatalogueSnapshot_sameResultsAsDatabase)
+{
+    ScopedRelease release1{ session, "MyRelease1" };
+    ScopedRelease release2{ session, "myrelease0" };
+    ScopedArtist artist1{ session, "MyArtist1" };
+    ScopedArtist artist2{ session, "MyArtist2" };
+    ScopedClusterType clusterType{ session, "MyClusterType" };
+    ScopedCluster cluster1{ session, clusterType.lockAndGet(), "MyCluster1" };
+    ScopedCluster cluster2{ session, clusterType.lockAndGet(), "MyCluster2" };
+    ScopedTrack track1{ session, "b" };
+    ScopedTrack track2{ session, "A" };
+    ScopedTrack track3{ session, "c" };
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+
+        track1.get().modify()->setRelease(release1.get());
+        track1.get().modify()->setTrackNumber(2);
+        track2.get().modify()->setRelease(release1.get());
+        track2.get().modify()->setTrackNumber(1);
+        track3.get().modify()->setRelease(release2.get());
+
+        TrackArtistLink::create(session, track1.get(), artist1.get(), TrackArtistLinkType::Artist);
+        TrackArtistLink::create(session, track1.get(), artist1.get(), TrackArtistLinkType::Composer);
+        TrackArtistLink::create(session, track2.get(), artist2.get(), TrackArtistLinkType::Composer);
+        TrackArtistLink::create(session, track3.get(), artist1.get(), TrackArtistLinkType::Artist);
+
+        cluster1.get().modify()->addTrack(track1.get());
+        cluster1.get().modify()->addTrack(track3.get());
+        cluster2.get().modify()->addTrack(track3.get());
+
+        Artist::updateLinkTypes(session);
+    }
+
+    auto transaction{ session.createReadTransaction() };
+
+    const std::shared_ptr<const CatalogueSnapshot> snapshot{ CatalogueSnapshot::build(session) };
+    EXPECT_EQ(snapshot->getTrackCount(), 3);
+    EXPECT_EQ(snapshot->getReleaseCount(), 2);
+    EXPECT_EQ(snapshot->getArtistCount(), 2);
+
+    auto checkTracks{ [&](const Track::FindParameters& params)
+        {
+            const auto snapshotResults{ snapshot->findTrackIds(params) };
+            ASSERT_TRUE(snapshotResults);
+            const auto dbResults{ Track::findIds(session, params) };
+            EXPECT_EQ(snapshotResults->results, dbResults.results);
+            EXPECT_EQ(snapshotResults->moreResults, dbResults.moreResults);
+        } };
+
+    checkTracks(Track::FindParameters{}.setSortMethod(TrackSortMethod::Name));
+    checkTracks(Track::FindParameters{}.setSortMethod(TrackSortMethod::Name).setRange(Range{ 1, 1 }));
+    checkTracks(Track::FindParameters{}.setRelease(release1.getId()).setSortMethod(TrackSortMethod::Release));
+    checkTracks(Track::FindParameters{}.setArtist(artist1.getId(), { TrackArtistLinkType::Composer }).setSortMethod(TrackSortMethod::Name));
+    checkTracks(Track::FindParameters{}.setClusters({ cluster1.getId(), cluster2.getId() }).setSortMethod(TrackSortMethod::Name));
+
+    auto checkReleases{ [&](const Release::FindParameters& params)
+        {
+            const auto snapshotResults{ snapshot->findReleaseIds(params) };
+            ASSERT_TRUE(snapshotResults);
+            const auto dbResults{ Release::findIds(session, params) };
+            EXPECT_EQ(snapshotResults->results, dbResults.results);
+            EXPECT_EQ(snapshotResults->moreResults, dbResults.moreResults);
+        } };
+
+    checkReleases(Release::FindParameters{}.setSortMethod(ReleaseSortMethod::Name));
+    checkReleases(Release::FindParameters{}.setSortMethod(ReleaseSortMethod::Name).setRange(Range{ 0, 1 }));
+    checkReleases(Release::FindParameters{}.setArtist(artist1.getId()).setSortMethod(ReleaseSortMethod::Name));
+    checkReleases(Release::FindParameters{}.setClusters({ cluster1.getId() }).setSortMethod(ReleaseSortMethod::Name));
+
+    auto checkArtists{ [&](const Artist::FindParameters& params)
+        {
+            const auto snapshotResults{ snapshot->findArtistIds(params) };
+            ASSERT_TRUE(snapshotResults);
+            const auto dbResults{ Artist::findIds(session, params) };
+            EXPECT_EQ(snapshotResults->results, dbResults.results);
+            EXPECT_EQ(snapshotResults->moreResults, dbResults.moreResults);
+        } };
+
+    checkArtists(Artist::FindParameters{}.setSortMethod(ArtistSortMethod::ByName));
+    checkArtists(Artist::FindParameters{}.setLinkType(TrackArtistLinkType::Composer).setSortMethod(ArtistSortMethod::ByName));
+    checkArtists(Artist::FindParameters{}.setClusters({ cluster2.getId() }).setSortMethod(ArtistSortMethod::BySortName));
+
+    // not handled by the snapshot
+    EXPECT_FALSE(snapshot->findTrackIds(Track::FindParameters{}.setKeywords({ "foo" })));
+    EXPECT_FALSE(snapshot->findReleaseIds(Release::FindParameters{}.setSortMethod(ReleaseSortMethod::Random)));
+}
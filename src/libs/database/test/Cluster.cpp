@@ -343,6 +343,41 @@ TEST_F(DatabaseFixture, Cluster_singleTrackSingleReleaseSingleCluster)
     }
 }
 
+TEST_F(DatabaseFixture, Cluster_updateCounts)
+{
+    ScopedTrack track1{ session, "MyTrackFile1" };
+    ScopedTrack track2{ session, "MyTrackFile2" };
+    ScopedRelease release{ session, "MyRelease" };
+    ScopedClusterType clusterType{ session, "MyClusterType" };
+    ScopedCluster cluster{ session, clusterType.lockAndGet(), "MyCluster" };
+    ScopedCluster unusedCluster{ session, clusterType.lockAndGet(), "MyClusterUnused" };
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+
+        track1.get().modify()->setRelease(release.get());
+        track2.get().modify()->setRelease(release.get());
+        cluster.get().modify()->addTrack(track1.get());
+        cluster.get().modify()->addTrack(track2.get());
+        unusedCluster.get().modify()->setTrackCount(5);
+        unusedCluster.get().modify()->setReleaseCount(3);
+    }
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+        Cluster::updateCounts(session);
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        EXPECT_EQ(cluster.get()->getTracksCount(), 2);
+        EXPECT_EQ(cluster.get()->getReleasesCount(), 1);
+        EXPECT_EQ(unusedCluster.get()->getTracksCount(), 0);
+        EXPECT_EQ(unusedCluster.get()->getReleasesCount(), 0);
+    }
+}
+
 TEST_F(DatabaseFixture, SingleTrackSingleArtistMultiClusters)
 {
     ScopedTrack track{ session, "MyTrackFile" };
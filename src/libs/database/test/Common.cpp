@@ -22,6 +22,7 @@
 #include "database/Artist.hpp"
 #include "database/Cluster.hpp"
 #include "database/Db.hpp"
+#include "database/Directory.hpp"
 #include "database/Listen.hpp"
 #include "database/MediaLibrary.hpp"
 #include "database/Release.hpp"
@@ -77,6 +78,9 @@ void DatabaseFixture::testDatabaseEmpty()
     EXPECT_EQ(Artist::getCount(session), 0);
     EXPECT_EQ(Cluster::getCount(session), 0);
     EXPECT_EQ(ClusterType::getCount(session), 0);
+    // directories are only removed once they no longer have tracks
+    Directory::removeOrphans(session);
+    EXPECT_EQ(Directory::getCount(session), 0);
     EXPECT_EQ(Listen::getCount(session), 0);
     EXPECT_EQ(MediaLibrary::getCount(session), 0);
     EXPECT_EQ(Release::getCount(session), 0);
@@ -232,3 +236,103 @@ TEST_F(DatabaseFixture, Common_subRange)
     }
 }
 
+TEST_F(DatabaseFixture, Common_subRangeView)
+{
+    using namespace Database;
+
+    RangeResults<int> results;
+    results.range = Range{ 10, 3 };
+    results.results = { 5, 6, 7 };
+    results.moreResults = true;
+    results.nextCursor = Cursor{ "key", 3 };
+
+    {
+        const RangeResultsView<int> view{ results.getView() };
+        EXPECT_EQ(view.range, results.range);
+        EXPECT_EQ(view.results.data(), results.results.data());
+        EXPECT_EQ(view.results.size(), 3);
+        EXPECT_TRUE(view.moreResults);
+        EXPECT_EQ(view.nextCursor, results.nextCursor);
+    }
+    {
+        const RangeResultsView<int> view{ results.getSubRangeView(Range{ 11, 1 }) };
+        ASSERT_EQ(view.results.size(), 1);
+        EXPECT_EQ(view.results.data(), results.results.data() + 1);
+        EXPECT_TRUE(view.moreResults);
+        EXPECT_FALSE(view.nextCursor);
+    }
+    {
+        const RangeResultsView<int> view{ results.getSubRangeView(Range{ 11, 0 }) };
+        ASSERT_EQ(view.results.size(), 2);
+        EXPECT_EQ(view.results.front(), 6);
+        EXPECT_EQ(view.results.back(), 7);
+        EXPECT_TRUE(view.moreResults);
+        EXPECT_EQ(view.nextCursor, results.nextCursor);
+    }
+    {
+        const RangeResultsView<int> view{ results.getSubRangeView(Range{ 20, 2 }) };
+        EXPECT_TRUE(view.results.empty());
+        const Range expectedRange{ 13, 0 };
+        EXPECT_EQ(view.range, expectedRange);
+    }
+}
+
+TEST_F(DatabaseFixture, Common_subRangeMove)
+{
+    using namespace Database;
+
+    RangeResults<std::string> results;
+    results.range = Range{ 0, 4 };
+    results.results = { "a", "b", "c", "d" };
+    results.moreResults = false;
+
+    const RangeResults<std::string> subRange{ std::move(results).getSubRange(Range{ 1, 2 }) };
+    ASSERT_EQ(subRange.results.size(), 2);
+    EXPECT_EQ(subRange.results.front(), "b");
+    EXPECT_EQ(subRange.results.back(), "c");
+    EXPECT_TRUE(subRange.moreResults);
+    const Range expectedRange{ 1, 2 };
+    EXPECT_EQ(subRange.range, expectedRange);
+}
+
+
+TEST_F(DatabaseFixture, Common_writeGeneration)
+{
+    using namespace Database;
+
+    const std::uint64_t initialGeneration{ session.getDb().getWriteGeneration() };
+
+    {
+        auto transaction{ session.createReadTransaction() };
+        EXPECT_EQ(Artist::getCount(session), 0);
+    }
+    EXPECT_EQ(session.getDb().getWriteGeneration(), initialGeneration);
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+    }
+    EXPECT_GT(session.getDb().getWriteGeneration(), initialGeneration);
+}
+
+TEST_F(DatabaseFixture, Common_loadedObjectCount)
+{
+    using namespace Database;
+
+    ScopedTrack track{ session, "MyTrack" };
+    const std::size_t initialCount{ session.getLoadedObjectCount() };
+
+    {
+        Track::pointer loadedTrack;
+        {
+            auto transaction{ session.createReadTransaction() };
+            loadedTrack = Track::find(session, track.getId());
+            ASSERT_TRUE(loadedTrack);
+            EXPECT_EQ(session.getLoadedObjectCount(), initialCount + 1);
+        }
+
+        // kept alive by the pointer
+        EXPECT_EQ(session.getLoadedObjectCount(), initialCount + 1);
+    }
+
+    EXPECT_EQ(session.getLoadedObjectCount(), initialCount);
+}
@@ -102,6 +102,50 @@ TEST_F(DatabaseFixture, SingleUser)
     }
 }
 
+TEST_F(DatabaseFixture, IncrementalVacuum)
+{
+    Db& db{ session.getDb() };
+
+    const Db::StorageStats initialStats{ db.getStorageStats() };
+    EXPECT_TRUE(initialStats.incrementalVacuum);
+    EXPECT_GT(initialStats.pageSize, 0);
+    EXPECT_GT(initialStats.pageCount, 0);
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+        session.getDboSession().execute("CREATE TABLE vacuum_test (data BLOB)");
+        session.getDboSession().execute("WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n WHERE i < 1000) INSERT INTO vacuum_test SELECT randomblob(4096) FROM n");
+    }
+    {
+        auto transaction{ session.createWriteTransaction() };
+        session.getDboSession().execute("DROP TABLE vacuum_test");
+    }
+
+    const Db::StorageStats stats{ db.getStorageStats() };
+    ASSERT_GT(stats.freePageCount, 10);
+
+    EXPECT_LT(db.incrementalVacuum(10), stats.freePageCount);
+    EXPECT_EQ(db.incrementalVacuum(stats.freePageCount), 0);
+    EXPECT_EQ(db.getStorageStats().freePageCount, 0);
+}
+
+TEST_F(DatabaseFixture, Backup)
+{
+    ScopedTrack track{ session, "MyTrack" };
+
+    const std::filesystem::path backupFile{ std::tmpnam(nullptr) };
+    ScopedFileDeleter backupFileDeleter{ backupFile };
+    session.getDb().backup(backupFile);
+    EXPECT_FALSE(std::filesystem::exists(backupFile.string() + ".tmp"));
+
+    Db backupDb{ backupFile };
+    Session backupSession{ backupDb };
+    {
+        auto transaction{ backupSession.createReadTransaction() };
+        EXPECT_EQ(Track::getCount(backupSession), 1);
+    }
+}
+
 int main(int argc, char** argv)
 {
     ::testing::InitGoogleTest(&argc, argv);
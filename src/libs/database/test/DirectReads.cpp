@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Common.hpp"
+
+#include "database/DirectReads.hpp"
+
+using namespace Database;
+
+TEST_F(DatabaseFixture, DirectReads_releaseYears)
+{
+    ScopedRelease release{ session, "MyRelease" };
+
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        const DirectReads::ReleaseYears years{ DirectReads::getReleaseYears(session, release.getId()) };
+        EXPECT_FALSE(years.year);
+        EXPECT_FALSE(years.originalYear);
+    }
+
+    ScopedTrack track1{ session, "MyTrack1" };
+    ScopedTrack track2{ session, "MyTrack2" };
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+
+        track1.get().modify()->setRelease(release.get());
+        track2.get().modify()->setRelease(release.get());
+        track1.get().modify()->setYear(1994);
+        track2.get().modify()->setYear(1994);
+        track1.get().modify()->setOriginalYear(1993);
+
+        // pending changes must be seen
+        const DirectReads::ReleaseYears years{ DirectReads::getReleaseYears(session, release.getId()) };
+        EXPECT_EQ(years.year, 1994);
+        EXPECT_EQ(years.year, release.get()->getYear());
+        EXPECT_FALSE(years.originalYear); // track2 has no original year
+        EXPECT_EQ(years.originalYear, release.get()->getOriginalYear());
+    }
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+
+        track2.get().modify()->setYear(1995);
+        track2.get().modify()->setOriginalYear(1993);
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        const DirectReads::ReleaseYears years{ DirectReads::getReleaseYears(session, release.getId()) };
+        EXPECT_FALSE(years.year);
+        EXPECT_EQ(years.year, release.get()->getYear());
+        EXPECT_EQ(years.originalYear, 1993);
+        EXPECT_EQ(years.originalYear, release.get()->getOriginalYear());
+    }
+}
+
+TEST_F(DatabaseFixture, DirectReads_releaseClusterNames)
+{
+    ScopedTrack track{ session, "MyTrack" };
+    ScopedRelease release{ session, "MyRelease" };
+    ScopedClusterType genreType{ session, "GENRE" };
+    ScopedClusterType moodType{ session, "MOOD" };
+    ScopedCluster genre{ session, genreType.lockAndGet(), "Rock" };
+    ScopedCluster mood{ session, moodType.lockAndGet(), "Happy" };
+    ScopedCluster unusedGenre{ session, genreType.lockAndGet(), "Jazz" };
+
+    {
+        auto transaction{ session.createReadTransaction() };
+        EXPECT_TRUE(DirectReads::getReleaseClusterNames(session, release.getId(), "GENRE").empty());
+    }
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+
+        track.get().modify()->setRelease(release.get());
+        genre.get().modify()->addTrack(track.get());
+        mood.get().modify()->addTrack(track.get());
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        const std::vector<std::string> genres{ DirectReads::getReleaseClusterNames(session, release.getId(), "GENRE") };
+        ASSERT_EQ(genres.size(), 1);
+        EXPECT_EQ(genres.front(), "Rock");
+
+        const std::vector<std::string> moods{ DirectReads::getReleaseClusterNames(session, release.getId(), "MOOD") };
+        ASSERT_EQ(moods.size(), 1);
+        EXPECT_EQ(moods.front(), "Happy");
+
+        EXPECT_TRUE(DirectReads::getReleaseClusterNames(session, release.getId(), "UNKNOWN").empty());
+    }
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Common.hpp"
+
+#include "database/Directory.hpp"
+
+using namespace Database;
+
+TEST_F(DatabaseFixture, Directory_trackPath)
+{
+    ScopedTrack track1{ session, "/root/artist/release/track1.mp3" };
+    ScopedTrack track2{ session, "/root/artist/release/track2.mp3" };
+    ScopedTrack track3{ session, "/root/artist/other-release/track3.mp3" };
+
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        EXPECT_EQ(track1->getPath(), "/root/artist/release/track1.mp3");
+        EXPECT_EQ(track1->getFileName(), "track1.mp3");
+        EXPECT_EQ(track1->getDirectory(), track2->getDirectory());
+        EXPECT_NE(track1->getDirectory(), track3->getDirectory());
+
+        // "/", "root", "artist", "release", "other-release"
+        EXPECT_EQ(Directory::getCount(session), 5);
+        EXPECT_EQ(Directory::findRootDirectories(session).size(), 1);
+
+        const Directory::pointer directory{ Directory::find(session, "/root/artist/release/") };
+        ASSERT_TRUE(directory);
+        EXPECT_EQ(directory, track1->getDirectory());
+        EXPECT_EQ(directory->getName(), "release");
+        EXPECT_EQ(directory->getPath(), "/root/artist/release");
+        EXPECT_FALSE(Directory::find(session, "/root/foo"));
+
+        EXPECT_EQ(Track::findByPath(session, "/root/artist/release/track2.mp3"), track2.get());
+        EXPECT_FALSE(Track::findByPath(session, "/root/artist/track2.mp3"));
+        EXPECT_EQ(Track::findByPaths(session, std::vector<std::filesystem::path>{ "/root/artist/release/track1.mp3", "/root/artist/other-release/track3.mp3", "/root/foo.mp3" }).size(), 2);
+    }
+}
+
+TEST_F(DatabaseFixture, Directory_move)
+{
+    ScopedTrack track{ session, "/root/artist/release/track.mp3" };
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+
+        Track::move(session, track.get(), "/root/other-artist/track.flac", {});
+        EXPECT_EQ(track->getPath(), "/root/other-artist/track.flac");
+        EXPECT_EQ(Track::findByPath(session, "/root/other-artist/track.flac"), track.get());
+        EXPECT_FALSE(Track::findByPath(session, "/root/artist/release/track.mp3"));
+
+        // "artist" and "release"
+        EXPECT_EQ(Directory::removeOrphans(session), 2);
+        EXPECT_FALSE(Directory::find(session, "/root/artist"));
+        EXPECT_TRUE(Directory::find(session, "/root/other-artist"));
+    }
+}
+
+TEST_F(DatabaseFixture, Directory_mediaLibrary)
+{
+    ScopedMediaLibrary library{ session, "/root/music/", "MyLibrary" };
+    ScopedTrack orphanTrack{ session, "/root/music/artist/orphan-track.mp3" };
+    ScopedTrack track{ session, "/root/music/artist/track.mp3", library.lockAndGet() };
+
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        EXPECT_EQ(track->getMediaLibrary(), library.get());
+        EXPECT_EQ(track->getPath(), "/root/music/artist/track.mp3");
+        EXPECT_NE(track->getDirectory(), orphanTrack->getDirectory());
+
+        // the tracks of the media library have their own directory tree
+        const std::vector<Directory::pointer> rootDirectories{ Directory::findRootDirectories(session) };
+        EXPECT_EQ(rootDirectories.size(), 2);
+        EXPECT_EQ(Directory::findIds(session, "/root/music/artist").size(), 2);
+        EXPECT_EQ(Directory::find(session, "/root/music/artist"), track->getDirectory());
+        EXPECT_EQ(track->getDirectory()->getMediaLibrary(), library.get());
+
+        EXPECT_EQ(Track::findByPath(session, "/root/music/artist/track.mp3"), track.get());
+        EXPECT_EQ(Track::findByPath(session, "/root/music/artist/orphan-track.mp3"), orphanTrack.get());
+        EXPECT_EQ(Track::findPathsInDirectory(session, "/root").results.size(), 2);
+        EXPECT_EQ(Track::findPathsInDirectory(session, "/root/music/artist").results.size(), 2);
+    }
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+
+        EXPECT_TRUE(Directory::moveRootDirectory(session, "/root/music", "/other/music"));
+        EXPECT_FALSE(Directory::moveRootDirectory(session, "/root/music", "/other/music"));
+        EXPECT_EQ(track->getPath(), "/other/music/artist/track.mp3");
+        EXPECT_EQ(Track::findByPath(session, "/other/music/artist/track.mp3"), track.get());
+        EXPECT_EQ(orphanTrack->getPath(), "/root/music/artist/orphan-track.mp3");
+    }
+}
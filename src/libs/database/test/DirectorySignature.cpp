@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Common.hpp"
+
+#include <algorithm>
+
+#include "database/DirectorySignature.hpp"
+
+using namespace Database;
+
+TEST_F(DatabaseFixture, DirectorySignature)
+{
+    auto getAll{ [&]
+        {
+            auto transaction{ session.createReadTransaction() };
+
+            std::vector<DirectorySignature::Entry> entries;
+            DirectorySignature::visitAll(session, [&](const DirectorySignature::Entry& entry) { entries.push_back(entry); });
+            std::sort(std::begin(entries), std::end(entries), [](const DirectorySignature::Entry& lhs, const DirectorySignature::Entry& rhs) { return lhs.path < rhs.path; });
+
+            return entries;
+        } };
+
+    EXPECT_TRUE(getAll().empty());
+
+    const Wt::WDateTime checkTime{ Wt::WDate{ 2024, 1, 2 }, Wt::WTime{ 3, 4, 5 } };
+    std::vector<DirectorySignature::Entry> entries;
+    for (std::size_t i{}; i < 300; ++i)
+        entries.push_back(DirectorySignature::Entry{ "/root/dir" + std::to_string(1000 + i), static_cast<long long>(i) * 1'000'000'000'000, i, checkTime });
+    entries.push_back(DirectorySignature::Entry{ "/root/unchecked", 42, 1, {} });
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+        DirectorySignature::setAll(session, entries);
+    }
+    EXPECT_EQ(getAll(), entries);
+
+    entries.resize(1);
+    {
+        auto transaction{ session.createWriteTransaction() };
+        DirectorySignature::setAll(session, entries);
+    }
+    EXPECT_EQ(getAll(), entries);
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+        DirectorySignature::setAll(session, {});
+    }
+    EXPECT_TRUE(getAll().empty());
+}
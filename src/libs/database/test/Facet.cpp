@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Common.hpp"
+
+#include "database/Facet.hpp"
+
+using namespace Database;
+
+namespace
+{
+    std::vector<Facet::Entry> getAllEntries(Session& session, FacetType type)
+    {
+        std::vector<Facet::Entry> entries;
+        Facet::visitAll(session, type, [&](const Facet::Entry& entry) { entries.push_back(entry); });
+
+        return entries;
+    }
+}
+
+TEST_F(DatabaseFixture, Facet_trackValues)
+{
+    ScopedTrack track1{ session, "MyTrack1" };
+    ScopedTrack track2{ session, "MyTrack2" };
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+
+        Facet::setTrackValues(session, track1.getId(), FacetType::Genre, std::vector<std::string>{ "Rock", "Pop", "Rock" });
+        Facet::setTrackValues(session, track2.getId(), FacetType::Genre, std::vector<std::string>{ "Pop" });
+        Facet::setTrackValues(session, track2.getId(), FacetType::Mood, std::vector<std::string>{ "Happy" });
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        EXPECT_EQ(Facet::getTrackValues(session, track1.getId(), FacetType::Genre), (std::vector<std::string>{ "Rock", "Pop" }));
+        EXPECT_EQ(Facet::getTrackValues(session, track2.getId(), FacetType::Genre), std::vector<std::string>{ "Pop" });
+        EXPECT_TRUE(Facet::getTrackValues(session, track1.getId(), FacetType::Mood).empty());
+        EXPECT_EQ(Facet::getTrackValues(session, track2.getId(), FacetType::Mood), std::vector<std::string>{ "Happy" });
+        EXPECT_TRUE(Facet::getTrackValues(session, track2.getId(), FacetType::Language).empty());
+
+        EXPECT_EQ(Facet::findTrackIds(session, FacetType::Genre, "Pop", MediaLibraryId{}, std::nullopt).results.size(), 2);
+        EXPECT_EQ(Facet::findTrackIds(session, FacetType::Genre, "Rock", MediaLibraryId{}, std::nullopt).results, std::vector<TrackId>{ track1.getId() });
+        EXPECT_TRUE(Facet::findTrackIds(session, FacetType::Genre, "Happy", MediaLibraryId{}, std::nullopt).results.empty());
+    }
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+
+        // replaced values
+        Facet::setTrackValues(session, track1.getId(), FacetType::Genre, std::vector<std::string>{ "Jazz" });
+        EXPECT_EQ(Facet::getTrackValues(session, track1.getId(), FacetType::Genre), std::vector<std::string>{ "Jazz" });
+
+        // "Rock"
+        EXPECT_EQ(Facet::removeOrphans(session), 1);
+    }
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+
+        Facet::setTrackValues(session, track1.getId(), FacetType::Genre, {});
+        Facet::setTrackValues(session, track2.getId(), FacetType::Genre, {});
+        Facet::setTrackValues(session, track2.getId(), FacetType::Mood, {});
+        EXPECT_EQ(Facet::removeOrphans(session), 3);
+    }
+}
+
+TEST_F(DatabaseFixture, Facet_releaseValues)
+{
+    ScopedMediaLibrary library{ session };
+    ScopedRelease release{ session, "MyRelease" };
+    ScopedTrack track1{ session, "MyTrack1" };
+    ScopedTrack track2{ session, "MyTrack2" };
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+
+        track1.get().modify()->setRelease(release.get());
+        track2.get().modify()->setRelease(release.get());
+        track2.get().modify()->setMediaLibrary(library.get());
+
+        Facet::setTrackValues(session, track1.getId(), FacetType::Genre, std::vector<std::string>{ "Rock" });
+        Facet::setTrackValues(session, track2.getId(), FacetType::Genre, std::vector<std::string>{ "Rock", "Blues" });
+
+        Facet::updateCounts(session);
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        EXPECT_EQ(Facet::getReleaseValues(session, release.getId(), FacetType::Genre), (std::vector<std::string>{ "Blues", "Rock" }));
+        EXPECT_TRUE(Facet::getReleaseValues(session, release.getId(), FacetType::Mood).empty());
+
+        EXPECT_EQ(Facet::findReleaseIds(session, FacetType::Genre, "Blues", MediaLibraryId{}, std::nullopt).results, std::vector<ReleaseId>{ release.getId() });
+        EXPECT_EQ(Facet::findReleaseIds(session, FacetType::Genre, "Blues", library.getId(), std::nullopt).results, std::vector<ReleaseId>{ release.getId() });
+        EXPECT_EQ(Facet::findTrackIds(session, FacetType::Genre, "Rock", library.getId(), std::nullopt).results, std::vector<TrackId>{ track2.getId() });
+        EXPECT_TRUE(Facet::findReleaseIds(session, FacetType::Genre, "Jazz", MediaLibraryId{}, std::nullopt).results.empty());
+
+        const std::vector<Facet::Entry> genres{ getAllEntries(session, FacetType::Genre) };
+        ASSERT_EQ(genres.size(), 2);
+        EXPECT_EQ(genres[0].name, "Blues");
+        EXPECT_EQ(genres[0].trackCount, 1);
+        EXPECT_EQ(genres[0].releaseCount, 1);
+        EXPECT_EQ(genres[1].name, "Rock");
+        EXPECT_EQ(genres[1].trackCount, 2);
+        EXPECT_EQ(genres[1].releaseCount, 1);
+    }
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+
+        Facet::setTrackValues(session, track1.getId(), FacetType::Genre, {});
+        Facet::setTrackValues(session, track2.getId(), FacetType::Genre, {});
+        EXPECT_EQ(Facet::removeOrphans(session), 2);
+    }
+}
@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Common.hpp"
+
+#include <algorithm>
+
+#include "database/ImageFile.hpp"
+
+using namespace Database;
+
+namespace
+{
+    std::vector<ImageFile::Entry> sortEntries(std::vector<ImageFile::Entry> entries)
+    {
+        std::sort(std::begin(entries), std::end(entries), [](const ImageFile::Entry& lhs, const ImageFile::Entry& rhs) { return lhs.path < rhs.path; });
+        return entries;
+    }
+}
+
+TEST_F(DatabaseFixture, ImageFile)
+{
+    auto getAll{ [&]
+        {
+            auto transaction{ session.createReadTransaction() };
+
+            std::vector<ImageFile::Entry> entries;
+            ImageFile::visitAll(session, [&](const ImageFile::Entry& entry) { entries.push_back(entry); });
+            return sortEntries(std::move(entries));
+        } };
+
+    {
+        auto transaction{ session.createReadTransaction() };
+        EXPECT_FALSE(ImageFile::hasAny(session));
+    }
+    EXPECT_TRUE(getAll().empty());
+
+    std::vector<ImageFile::Entry> entries;
+    for (std::size_t i{}; i < 300; ++i)
+        entries.push_back(ImageFile::Entry{ "/root/dir" + std::to_string(1000 + i) + "/cover.jpg", i, static_cast<long long>(i) * 1'000'000'000'000 });
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+        ImageFile::setAll(session, entries);
+    }
+    EXPECT_EQ(getAll(), entries);
+    {
+        auto transaction{ session.createReadTransaction() };
+        EXPECT_TRUE(ImageFile::hasAny(session));
+    }
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+        ImageFile::setAll(session, {});
+    }
+    EXPECT_TRUE(getAll().empty());
+}
+
+TEST_F(DatabaseFixture, ImageFile_directory)
+{
+    const std::vector<ImageFile::Entry> entries{
+        { "/root/artist/artist.jpg", 1, 1 },
+        { "/root/artist/release/cover.jpg", 2, 2 },
+        { "/root/artist/release/back.png", 3, 3 },
+        { "/root/artist/release/cd1/cover.jpg", 4, 4 },
+        { "/root/artist2/artist.jpg", 5, 5 },
+        { "/root/artist-other/artist.jpg", 6, 6 },
+    };
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+        ImageFile::setAll(session, entries);
+    }
+
+    auto getDirectory{ [&](const std::filesystem::path& directory)
+        {
+            auto transaction{ session.createReadTransaction() };
+
+            std::vector<ImageFile::Entry> res;
+            ImageFile::visitDirectory(session, directory, [&](const ImageFile::Entry& entry) { res.push_back(entry); });
+            return sortEntries(std::move(res));
+        } };
+
+    auto getAllInDirectory{ [&](const std::filesystem::path& directory)
+        {
+            auto transaction{ session.createReadTransaction() };
+
+            std::vector<ImageFile::Entry> res;
+            ImageFile::visitAllInDirectory(session, directory, [&](const ImageFile::Entry& entry) { res.push_back(entry); });
+            return sortEntries(std::move(res));
+        } };
+
+    EXPECT_EQ(getDirectory("/root/artist"), (std::vector<ImageFile::Entry>{ entries[0] }));
+    EXPECT_EQ(getDirectory("/root/artist/release"), (std::vector<ImageFile::Entry>{ entries[2], entries[1] }));
+    EXPECT_TRUE(getDirectory("/root").empty());
+
+    EXPECT_EQ(getAllInDirectory("/root/artist"), (std::vector<ImageFile::Entry>{ entries[0], entries[2], entries[3], entries[1] }));
+    EXPECT_EQ(getAllInDirectory("/root/artist/"), getAllInDirectory("/root/artist"));
+    EXPECT_EQ(getAllInDirectory("/root").size(), entries.size());
+
+    // only the files located in the directory are replaced
+    const std::vector<ImageFile::Entry> newEntries{ { "/root/artist/release/cover.jpg", 7, 7 } };
+    {
+        auto transaction{ session.createWriteTransaction() };
+        ImageFile::setAllInDirectory(session, "/root/artist", newEntries);
+    }
+    EXPECT_EQ(getAllInDirectory("/root/artist"), newEntries);
+    EXPECT_EQ(getDirectory("/root/artist2"), (std::vector<ImageFile::Entry>{ entries[4] }));
+    EXPECT_EQ(getDirectory("/root/artist-other"), (std::vector<ImageFile::Entry>{ entries[5] }));
+}
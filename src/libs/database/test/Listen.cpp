@@ -57,6 +57,44 @@ TEST_F(DatabaseFixture, Listen_getAll)
     }
 }
 
+TEST_F(DatabaseFixture, Listen_createIfNotExist)
+{
+    ScopedTrack track1{ session, "MyTrack1" };
+    ScopedTrack track2{ session, "MyTrack2" };
+    ScopedUser user{ session, "MyUser" };
+    const Wt::WDateTime dateTime1{ Wt::WDate{2000, 1, 2}, Wt::WTime{12, 0, 1} };
+    const Wt::WDateTime dateTime2{ Wt::WDate{2000, 1, 2}, Wt::WTime{13, 0, 1} };
+
+    ScopedListen listen{ session, user.lockAndGet(), track1.lockAndGet(), ScrobblingBackend::ListenBrainz, dateTime1 };
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+
+        const std::vector<Listen::TimedTrack> entries{
+            { track1.getId(), dateTime1 }, // already exists
+            { track1.getId(), dateTime2 },
+            { track2.getId(), dateTime1 },
+            { track2.getId(), dateTime1 }, // duplicated entry
+            { TrackId{ track2.getId().getValue() + 1 }, dateTime1 }, // missing track
+        };
+        EXPECT_EQ(Listen::createIfNotExist(session, user.getId(), ScrobblingBackend::ListenBrainz, SyncState::Synchronized, entries), 2);
+        EXPECT_EQ(Listen::getCount(session), 3);
+
+        // same entries, other backend
+        EXPECT_EQ(Listen::createIfNotExist(session, user.getId(), ScrobblingBackend::Internal, SyncState::Synchronized, std::vector<Listen::TimedTrack>{ { track1.getId(), dateTime1 } }), 1);
+        EXPECT_EQ(Listen::getCount(session), 4);
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        const Listen::pointer createdListen{ Listen::find(session, user.getId(), track2.getId(), ScrobblingBackend::ListenBrainz, dateTime1) };
+        ASSERT_TRUE(createdListen);
+        EXPECT_EQ(createdListen->getSyncState(), SyncState::Synchronized);
+        EXPECT_EQ(createdListen->getDateTime(), dateTime1);
+    }
+}
+
 TEST_F(DatabaseFixture, Listen_get)
 {
     ScopedTrack track{ session, "MyTrack" };
@@ -658,6 +696,49 @@ TEST_F(DatabaseFixture, Listen_getTopTracks)
     }
 }
 
+TEST_F(DatabaseFixture, Listen_getTopTracks_period)
+{
+    ScopedTrack track1{ session, "MyTrack1" };
+    ScopedTrack track2{ session, "MyTrack2" };
+    ScopedUser user{ session, "MyUser" };
+
+    ScopedListen listen1{ session, user.lockAndGet(), track1.lockAndGet(), ScrobblingBackend::Internal, Wt::WDateTime{ Wt::WDate{ 2000, 1, 2 }, Wt::WTime{ 12, 0, 1 } } };
+    ScopedListen listen2{ session, user.lockAndGet(), track2.lockAndGet(), ScrobblingBackend::Internal, Wt::WDateTime{ Wt::WDate{ 2000, 2, 2 }, Wt::WTime{ 12, 0, 1 } } };
+    ScopedListen listen3{ session, user.lockAndGet(), track2.lockAndGet(), ScrobblingBackend::Internal, Wt::WDateTime{ Wt::WDate{ 2000, 2, 3 }, Wt::WTime{ 12, 0, 1 } } };
+    ScopedListen listen4{ session, user.lockAndGet(), track1.lockAndGet(), ScrobblingBackend::Internal, Wt::WDateTime{ Wt::WDate{ 2001, 1, 2 }, Wt::WTime{ 12, 0, 1 } } };
+
+    auto getTopTracks{ [&](std::optional<MonthRange> period)
+        {
+            auto transaction{ session.createReadTransaction() };
+
+            Listen::StatsFindParameters params;
+            params.setUser(user->getId());
+            params.setScrobblingBackend(ScrobblingBackend::Internal);
+            params.setPeriod(period);
+
+            return Listen::getTopTracks(session, params).results;
+        } };
+
+    EXPECT_EQ(getTopTracks(MonthRange::fromMonth(2000, 1)), (std::vector<TrackId>{ track1.getId() }));
+    EXPECT_EQ(getTopTracks(MonthRange::fromMonth(2000, 2)), (std::vector<TrackId>{ track2.getId() }));
+    EXPECT_EQ(getTopTracks(MonthRange::fromMonth(2000, 3)), (std::vector<TrackId>{}));
+    EXPECT_EQ(getTopTracks(MonthRange::fromYear(2001)), (std::vector<TrackId>{ track1.getId() }));
+    EXPECT_EQ(getTopTracks(MonthRange::fromYear(2000)), (std::vector<TrackId>{ track2.getId(), track1.getId() }));
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+        listen3.get().remove();
+    }
+    EXPECT_EQ(getTopTracks(MonthRange::fromMonth(2000, 2)), (std::vector<TrackId>{ track2.getId() }));
+    EXPECT_EQ(getTopTracks(MonthRange{ 200002, 200101 }).size(), 2);
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+        listen2.get().remove();
+    }
+    EXPECT_EQ(getTopTracks(MonthRange::fromMonth(2000, 2)), (std::vector<TrackId>{}));
+}
+
 TEST_F(DatabaseFixture, Listen_getTopTracks_artist)
 {
     ScopedTrack track{ session, "MyTrack" };
@@ -1480,6 +1561,119 @@ TEST_F(DatabaseFixture, Listen_getCount_track)
     }
 }
 
+TEST_F(DatabaseFixture, Listen_getTrackStats)
+{
+    ScopedTrack track1{ session, "MyTrack1" };
+    ScopedTrack track2{ session, "MyTrack2" };
+    ScopedUser user{ session, "MyUser" };
+
+    const Wt::WDateTime dateTime1{ Wt::WDate {2000, 1, 2}, Wt::WTime {12,0, 1} };
+    const Wt::WDateTime dateTime2{ Wt::WDate {2000, 1, 3}, Wt::WTime {12,0, 1} };
+    ScopedListen listen1{ session, user.lockAndGet(), track1.lockAndGet(), ScrobblingBackend::Internal, dateTime1 };
+    ScopedListen listen2{ session, user.lockAndGet(), track1.lockAndGet(), ScrobblingBackend::Internal, dateTime2 };
+
+    const std::vector<TrackId> trackIds{ track1.getId(), track2.getId() };
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        std::vector<Listen::TrackStats> stats;
+        Listen::getTrackStats(session, user->getId(), trackIds, [&](const Listen::TrackStats& trackStats) { stats.push_back(trackStats); });
+        ASSERT_EQ(stats.size(), 1);
+        EXPECT_EQ(stats[0].track, track1.getId());
+        EXPECT_EQ(stats[0].count, 2);
+        EXPECT_EQ(stats[0].lastListenDateTime, dateTime2);
+    }
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+        user.get().modify()->setScrobblingBackend(ScrobblingBackend::ListenBrainz);
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        bool visited{};
+        Listen::getTrackStats(session, user->getId(), trackIds, [&](const Listen::TrackStats&) { visited = true; });
+        EXPECT_FALSE(visited);
+    }
+}
+
+TEST_F(DatabaseFixture, Listen_getTrackStats_removedListen)
+{
+    ScopedTrack track{ session, "MyTrack" };
+    ScopedUser user{ session, "MyUser" };
+
+    const Wt::WDateTime dateTime1{ Wt::WDate {2000, 1, 2}, Wt::WTime {12,0, 1} };
+    const Wt::WDateTime dateTime2{ Wt::WDate {2000, 1, 3}, Wt::WTime {12,0, 1} };
+    ScopedListen listen1{ session, user.lockAndGet(), track.lockAndGet(), ScrobblingBackend::Internal, dateTime1 };
+
+    const std::vector<TrackId> trackIds{ track.getId() };
+    {
+        ScopedListen listen2{ session, user.lockAndGet(), track.lockAndGet(), ScrobblingBackend::Internal, dateTime2 };
+
+        auto transaction{ session.createReadTransaction() };
+        EXPECT_EQ(Listen::getCount(session, user->getId(), track.getId()), 2);
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+        EXPECT_EQ(Listen::getCount(session, user->getId(), track.getId()), 1);
+
+        std::vector<Listen::TrackStats> stats;
+        Listen::getTrackStats(session, user->getId(), trackIds, [&](const Listen::TrackStats& trackStats) { stats.push_back(trackStats); });
+        ASSERT_EQ(stats.size(), 1);
+        EXPECT_EQ(stats[0].count, 1);
+        EXPECT_EQ(stats[0].lastListenDateTime, dateTime1);
+    }
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+        listen1.get().remove();
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+        EXPECT_EQ(Listen::getCount(session, user->getId(), track.getId()), 0);
+
+        bool visited{};
+        Listen::getTrackStats(session, user->getId(), trackIds, [&](const Listen::TrackStats&) { visited = true; });
+        EXPECT_FALSE(visited);
+    }
+}
+
+TEST_F(DatabaseFixture, Listen_getTrackStats_backend)
+{
+    ScopedTrack track1{ session, "MyTrack1" };
+    ScopedTrack track2{ session, "MyTrack2" };
+    ScopedUser user{ session, "MyUser" };
+    ScopedUser user2{ session, "MyUser2" };
+
+    const Wt::WDateTime dateTime1{ Wt::WDate {2000, 1, 2}, Wt::WTime {12,0, 1} };
+    const Wt::WDateTime dateTime2{ Wt::WDate {2000, 1, 3}, Wt::WTime {12,0, 1} };
+    ScopedListen listen1{ session, user.lockAndGet(), track1.lockAndGet(), ScrobblingBackend::Internal, dateTime1 };
+    ScopedListen listen2{ session, user.lockAndGet(), track1.lockAndGet(), ScrobblingBackend::Internal, dateTime2 };
+    ScopedListen listen3{ session, user.lockAndGet(), track2.lockAndGet(), ScrobblingBackend::ListenBrainz, dateTime1 };
+    ScopedListen listen4{ session, user2.lockAndGet(), track2.lockAndGet(), ScrobblingBackend::Internal, dateTime1 };
+
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        std::vector<Listen::TrackStats> stats;
+        Listen::getTrackStats(session, user->getId(), ScrobblingBackend::Internal, [&](const Listen::TrackStats& trackStats) { stats.push_back(trackStats); });
+        ASSERT_EQ(stats.size(), 1);
+        EXPECT_EQ(stats[0].track, track1.getId());
+        EXPECT_EQ(stats[0].count, 2);
+        EXPECT_EQ(stats[0].lastListenDateTime, dateTime2);
+
+        stats.clear();
+        Listen::getTrackStats(session, user->getId(), ScrobblingBackend::ListenBrainz, [&](const Listen::TrackStats& trackStats) { stats.push_back(trackStats); });
+        ASSERT_EQ(stats.size(), 1);
+        EXPECT_EQ(stats[0].track, track2.getId());
+        EXPECT_EQ(stats[0].count, 1);
+        EXPECT_EQ(stats[0].lastListenDateTime, dateTime1);
+    }
+}
+
 TEST_F(DatabaseFixture, Listen_getCount_release)
 {
     ScopedTrack track1{ session, "MyTrack" };
@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+#include <Wt/Dbo/Exception.h>
+
+#include "Common.hpp"
+
+#include "database/QueryDeadline.hpp"
+
+namespace
+{
+    using namespace Database;
+
+    // Takes several seconds if not interrupted
+    long long runSlowQuery(Session& session)
+    {
+        auto transaction{ session.createReadTransaction() };
+        return session.getDboSession().query<long long>("WITH RECURSIVE c(x) AS (SELECT 1 UNION ALL SELECT x + 1 FROM c WHERE x < 100000000) SELECT COUNT(*) FROM c").resultValue();
+    }
+}
+
+TEST(QueryDeadline, deadline)
+{
+    using namespace std::chrono_literals;
+
+    const auto now{ QueryDeadline::Clock::now() };
+
+    const QueryDeadline deadline{ now + 1h };
+    EXPECT_FALSE(deadline.isExceeded());
+    EXPECT_FALSE(deadline.isCancelled());
+    EXPECT_EQ(deadline.narrowedTo(now + 2h).getExpiry(), now + 1h);
+    EXPECT_EQ(deadline.narrowedTo(now - 1s).getExpiry(), now - 1s);
+    EXPECT_TRUE(deadline.narrowedTo(now - 1s).isExceeded());
+
+    auto cancelled{ std::make_shared<std::atomic<bool>>() };
+    const QueryDeadline cancellableDeadline{ now + 1h, cancelled };
+    EXPECT_FALSE(cancellableDeadline.isExceeded());
+    *cancelled = true;
+    EXPECT_TRUE(cancellableDeadline.isCancelled());
+    EXPECT_TRUE(cancellableDeadline.isExceeded());
+    EXPECT_TRUE(cancellableDeadline.narrowedTo(now + 2h).isCancelled());
+}
+
+TEST(QueryDeadline, scoped)
+{
+    using namespace std::chrono_literals;
+
+    EXPECT_FALSE(ScopedQueryDeadline::getCurrent());
+    {
+        const ScopedQueryDeadline scopedDeadline{ QueryDeadline{ QueryDeadline::Clock::now() + 1h } };
+        ASSERT_TRUE(ScopedQueryDeadline::getCurrent());
+        EXPECT_FALSE(ScopedQueryDeadline::isCurrentExceeded());
+        {
+            const ScopedQueryDeadline nestedScopedDeadline{ QueryDeadline{ QueryDeadline::Clock::now() - 1s } };
+            EXPECT_TRUE(ScopedQueryDeadline::isCurrentExceeded());
+        }
+        EXPECT_FALSE(ScopedQueryDeadline::isCurrentExceeded());
+        {
+            const ScopedQueryDeadline nestedScopedDeadline{ std::nullopt };
+            EXPECT_FALSE(ScopedQueryDeadline::getCurrent());
+        }
+        EXPECT_TRUE(ScopedQueryDeadline::getCurrent());
+    }
+    EXPECT_FALSE(ScopedQueryDeadline::getCurrent());
+}
+
+TEST_F(DatabaseFixture, QueryDeadline_interrupt)
+{
+    using namespace std::chrono_literals;
+
+    {
+        const ScopedQueryDeadline scopedDeadline{ QueryDeadline{ QueryDeadline::Clock::now() + 50ms } };
+        EXPECT_THROW(runSlowQuery(session), Wt::Dbo::Exception);
+        EXPECT_TRUE(ScopedQueryDeadline::isCurrentExceeded());
+    }
+
+    {
+        auto cancelled{ std::make_shared<std::atomic<bool>>(true) };
+        const ScopedQueryDeadline scopedDeadline{ QueryDeadline{ QueryDeadline::Clock::now() + 1h, cancelled } };
+        EXPECT_THROW(runSlowQuery(session), Wt::Dbo::Exception);
+    }
+
+    // the connections can still be used once the deadline is over
+    {
+        auto transaction{ session.createReadTransaction() };
+        EXPECT_EQ(session.getDboSession().query<long long>("SELECT 1").resultValue(), 1);
+    }
+}
+
+TEST_F(DatabaseFixture, QueryDeadline_writeTransactionNotInterrupted)
+{
+    using namespace std::chrono_literals;
+
+    const ScopedQueryDeadline scopedDeadline{ QueryDeadline{ QueryDeadline::Clock::now() - 1s } };
+
+    auto transaction{ session.createWriteTransaction() };
+    EXPECT_EQ(session.getDboSession().query<long long>("WITH RECURSIVE c(x) AS (SELECT 1 UNION ALL SELECT x + 1 FROM c WHERE x < 10000) SELECT COUNT(*) FROM c").resultValue(), 10000);
+}
@@ -0,0 +1,194 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Common.hpp"
+
+#include "database/StarredArtist.hpp"
+#include "database/StarredRelease.hpp"
+#include "database/StarredTrack.hpp"
+
+// Checks that the hot query shapes generated by the find functions make use of the indexes
+// The statements below mirror what the createQuery functions build for the most common find parameters
+namespace
+{
+    using namespace Database;
+
+    struct QueryShape
+    {
+        std::string_view name;
+        std::string_view sql;
+        bool allowTempBTree{}; // for aggregates (group by, distinct, order by counts) that cannot be served by an index
+    };
+
+    const QueryShape queryShapes[]
+    {
+        { "tracks of release", "SELECT t.id FROM track t WHERE t.release_id = ? ORDER BY t.disc_number,t.track_number" },
+        { "track by path", "SELECT t.id FROM track t WHERE t.directory_id = ? AND t.file_name = ?" },
+        { "directory by name", "SELECT d.id FROM directory d WHERE d.parent_directory_id = ? AND d.name = ?" },
+        { "root directory by name", "SELECT d.id FROM directory d WHERE d.parent_directory_id IS NULL AND d.name = ?" },
+        { "tracks by name", "SELECT t.id FROM track t ORDER BY t.name_sort_key, t.id LIMIT 50" },
+        { "tracks by name, cursor", "SELECT t.id FROM track t WHERE (t.name_sort_key, t.id) > (?, ?) ORDER BY t.name_sort_key, t.id LIMIT 50" },
+        { "tracks by last written", "SELECT t.id FROM track t ORDER BY t.file_last_write DESC LIMIT 50" },
+        { "tracks by date", "SELECT t.id FROM track t ORDER BY t.sort_date DESC,t.release_id,t.disc_number,t.track_number LIMIT 50" },
+        { "tracks of tracklist", "SELECT t.id FROM track t INNER JOIN tracklist t_l ON t_l_e.tracklist_id = t_l.id INNER JOIN tracklist_entry t_l_e ON t.id = t_l_e.track_id WHERE t_l.id = ? ORDER BY t_l.id" },
+        { "tracks of cluster", "SELECT t.id FROM track t INNER JOIN track_cluster t_c ON t_c.track_id = t.id WHERE t_c.cluster_id = ? LIMIT 50" },
+        { "tracks of artist", "SELECT t.id FROM track t INNER JOIN artist a ON a.id = t_a_l.artist_id INNER JOIN track_artist_link t_a_l ON t_a_l.track_id = t.id WHERE a.id = ? AND (t_a_l.type = ?) GROUP BY t.id", true },
+        { "starred tracks", "SELECT t.id FROM track t INNER JOIN starred_track s_t ON s_t.track_id = t.id WHERE s_t.user_id = ? AND s_t.backend = ? AND s_t.sync_state <> ? ORDER BY s_t.date_time DESC LIMIT 50" },
+        { "releases by name", "SELECT DISTINCT r.id FROM release r ORDER BY r.name_sort_key, r.id LIMIT 50" },
+        { "releases by name, cursor", "SELECT DISTINCT r.id FROM release r WHERE (r.name_sort_key, r.id) > (?, ?) ORDER BY r.name_sort_key, r.id LIMIT 50" },
+        { "releases by date", "SELECT DISTINCT r.id FROM release r ORDER BY r.sort_date, r.name_sort_key LIMIT 50" },
+        { "releases by original date", "SELECT DISTINCT r.id FROM release r ORDER BY r.original_sort_date, r.name_sort_key LIMIT 50" },
+        { "releases by original date desc", "SELECT DISTINCT r.id FROM release r ORDER BY r.original_sort_date DESC, r.name_sort_key LIMIT 50" },
+        { "starred releases", "SELECT DISTINCT r.id FROM release r INNER JOIN starred_release s_r ON s_r.release_id = r.id WHERE s_r.user_id = ? AND s_r.backend = ? AND s_r.sync_state <> ? ORDER BY s_r.date_time DESC LIMIT 50", true },
+        { "artists by name", "SELECT DISTINCT a.id FROM artist a ORDER BY a.name_sort_key, a.id LIMIT 50" },
+        { "artists by sort name", "SELECT DISTINCT a.id FROM artist a ORDER BY a.sort_name_sort_key, a.id LIMIT 50" },
+        { "artists by sort name, link type", "SELECT DISTINCT a.id FROM artist a WHERE (a.link_types & ?) <> 0 ORDER BY a.sort_name_sort_key, a.id LIMIT 50" },
+        { "artists by sort name, link type and media library", "SELECT DISTINCT a.id FROM artist a INNER JOIN artist_media_library a_m_l ON a_m_l.artist_id = a.id WHERE a_m_l.media_library_id = ? AND (a_m_l.link_types & ?) <> 0 ORDER BY a.sort_name_sort_key, a.id LIMIT 50", true },
+        { "artists of release", "SELECT DISTINCT a.id FROM artist a INNER JOIN track t ON t.id = t_a_l.track_id INNER JOIN track_artist_link t_a_l ON t_a_l.artist_id = a.id WHERE t.release_id = ?", true },
+        { "starred artists", "SELECT DISTINCT a.id FROM artist a INNER JOIN starred_artist s_a ON s_a.artist_id = a.id WHERE s_a.user_id = ? AND s_a.backend = ? AND s_a.sync_state <> ? ORDER BY s_a.date_time DESC LIMIT 50", true },
+        { "track listen count", "SELECT COALESCE(SUM(l_s.count), 0) from listen_stats l_s INNER JOIN user u ON u.id = l_s.user_id WHERE l_s.track_id = ? AND l_s.user_id = ? AND l_s.backend = u.scrobbling_backend" },
+        { "top tracks", "SELECT t.id from track t INNER JOIN listen_stats l_s ON l_s.track_id = t.id WHERE l_s.user_id = ? AND l_s.backend = ? GROUP BY l_s.track_id ORDER BY SUM(l_s.count) DESC LIMIT 50", true },
+        { "top tracks of period", "SELECT t.id from track t INNER JOIN listen_period_stats l_s ON l_s.track_id = t.id WHERE l_s.user_id = ? AND l_s.backend = ? AND l_s.period BETWEEN ? AND ? GROUP BY l_s.track_id ORDER BY SUM(l_s.count) DESC LIMIT 50", true },
+        { "recent tracks", "SELECT t.id from track t INNER JOIN listen_stats l_s ON l_s.track_id = t.id WHERE l_s.user_id = ? AND l_s.backend = ? GROUP BY l_s.track_id ORDER BY MAX(l_s.last_date_time) DESC LIMIT 50", true },
+        { "top artists", "SELECT a.id from artist a INNER JOIN track t ON t.id = t_a_l.track_id INNER JOIN track_artist_link t_a_l ON t_a_l.artist_id = a.id INNER JOIN listen_stats l_s ON l_s.track_id = t.id WHERE l_s.user_id = ? AND l_s.backend = ? GROUP BY a.id ORDER BY SUM(l_s.count) DESC LIMIT 50", true },
+        { "listens to sync", "SELECT id FROM listen WHERE user_id = ? AND backend = ? AND sync_state = ? ORDER BY date_time" },
+        { "most recent listen", "SELECT l.id FROM listen l WHERE l.track_id = ? AND l.user_id = ? AND l.backend = ? ORDER BY l.date_time DESC LIMIT 1" },
+    };
+
+    class QueryPlanFixture : public ::testing::TestWithParam<QueryShape>
+    {
+    public:
+        static void SetUpTestCase()
+        {
+            _tmpDb = std::make_unique<TmpDatabase>();
+
+            Session session{ _tmpDb->getDb() };
+            session.prepareTables();
+            populate(session);
+            session.analyze();
+        }
+
+        static void TearDownTestCase()
+        {
+            _tmpDb.reset();
+        }
+
+    protected:
+        static inline std::unique_ptr<TmpDatabase> _tmpDb{};
+
+    private:
+        // Synthetic library, big enough to make the planner prefer indexes over scans
+        static void populate(Session& session)
+        {
+            constexpr std::size_t releaseCount{ 500 };
+            constexpr std::size_t artistCount{ 250 };
+            constexpr std::size_t trackCount{ 5'000 };
+            constexpr std::size_t clusterCount{ 50 };
+            constexpr std::size_t userCount{ 4 };
+            constexpr std::size_t listenCount{ 10'000 };
+            constexpr std::size_t trackListCount{ 20 };
+
+            std::mt19937 randGenerator{ 42 };
+            auto pick{ [&](const auto& entities) { return entities[std::uniform_int_distribution<std::size_t>{ 0, entities.size() - 1 }(randGenerator)]; } };
+
+            auto transaction{ session.createWriteTransaction() };
+
+            std::vector<Release::pointer> releases;
+            for (std::size_t i{}; i < releaseCount; ++i)
+                releases.push_back(session.create<Release>("Release" + std::to_string(randGenerator())));
+
+            std::vector<Artist::pointer> artists;
+            for (std::size_t i{}; i < artistCount; ++i)
+            {
+                artists.push_back(session.create<Artist>("Artist" + std::to_string(randGenerator())));
+                artists.back().modify()->setSortName("Artist" + std::to_string(randGenerator()));
+            }
+
+            const ClusterType::pointer clusterType{ session.create<ClusterType>("Genre") };
+            std::vector<Cluster::pointer> clusters;
+            for (std::size_t i{}; i < clusterCount; ++i)
+                clusters.push_back(session.create<Cluster>(clusterType, "Genre" + std::to_string(i)));
+
+            std::vector<User::pointer> users;
+            for (std::size_t i{}; i < userCount; ++i)
+                users.push_back(session.create<User>("User" + std::to_string(i)));
+
+            const Wt::WDateTime baseDateTime{ Wt::WDate{ 2020, 1, 1 } };
+
+            std::vector<Track::pointer> tracks;
+            for (std::size_t i{}; i < trackCount; ++i)
+            {
+                Track::pointer track{ session.create<Track>("/music/directory" + std::to_string(i % 100) + "/track" + std::to_string(i) + ".mp3") };
+                track.modify()->setName("Track" + std::to_string(randGenerator()));
+                track.modify()->setRelease(pick(releases));
+                track.modify()->setDiscNumber(1);
+                track.modify()->setTrackNumber(static_cast<int>(i % 12) + 1);
+                track.modify()->setLastWriteTime(baseDateTime.addSecs(static_cast<int>(randGenerator() % 1'000'000)));
+                track.modify()->setClusters({ clusters[i % clusterCount], clusters[(i * 7 + 3) % clusterCount] }); // always distinct
+
+                session.create<TrackArtistLink>(track, pick(artists), TrackArtistLinkType::Artist);
+                session.create<TrackArtistLink>(track, pick(artists), TrackArtistLinkType::ReleaseArtist);
+
+                tracks.push_back(track);
+            }
+
+            for (std::size_t i{}; i < listenCount; ++i)
+                session.create<Listen>(pick(users), pick(tracks), ScrobblingBackend::Internal, baseDateTime.addSecs(static_cast<int>(i)));
+
+            for (std::size_t i{}; i < trackCount / 4; ++i)
+                session.create<StarredTrack>(tracks[i * 4], users[i % userCount], FeedbackBackend::Internal);
+            for (std::size_t i{}; i < releaseCount / 2; ++i)
+                session.create<StarredRelease>(releases[i * 2], users[i % userCount], FeedbackBackend::Internal);
+            for (std::size_t i{}; i < artistCount / 2; ++i)
+                session.create<StarredArtist>(artists[i * 2], users[i % userCount], FeedbackBackend::Internal);
+
+            for (std::size_t i{}; i < trackListCount; ++i)
+            {
+                const TrackList::pointer trackList{ session.create<TrackList>("TrackList" + std::to_string(i), TrackListType::Playlist, false, pick(users)) };
+                for (std::size_t j{}; j < trackCount / trackListCount; ++j)
+                    session.create<TrackListEntry>(pick(tracks), trackList);
+            }
+        }
+    };
+}
+
+TEST_P(QueryPlanFixture, useIndexes)
+{
+    const QueryShape& queryShape{ GetParam() };
+
+    const std::vector<std::string> queryPlan{ _tmpDb->getDb().explainQueryPlan(std::string{ queryShape.sql }) };
+    ASSERT_FALSE(queryPlan.empty());
+
+    for (const std::string& detail : queryPlan)
+    {
+        // "SCAN t" (or "SCAN TABLE track AS t" for older versions) means a full table scan
+        const bool isFullScan{ detail.starts_with("SCAN ") && detail.find(" USING ") == std::string::npos };
+        EXPECT_FALSE(isFullScan) << "'" << queryShape.name << "': " << detail;
+
+        if (!queryShape.allowTempBTree)
+            EXPECT_EQ(detail.find("TEMP B-TREE"), std::string::npos) << "'" << queryShape.name << "': " << detail;
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(HotQueries, QueryPlanFixture, ::testing::ValuesIn(queryShapes));
@@ -42,6 +42,12 @@ TEST_F(DatabaseFixture, Release)
         EXPECT_EQ(Release::getCount(session, Release::FindParameters{}), 1);
         EXPECT_TRUE(Release::exists(session, release.getId()));
 
+        {
+            const auto releases{ Release::find(session, std::vector<ReleaseId>{ release.getId(), ReleaseId{ release.getId().getValue() + 1 } }) };
+            ASSERT_EQ(releases.size(), 1);
+            EXPECT_EQ(releases.front()->getId(), release.getId());
+        }
+
         {
             const auto releases{ Release::findOrphanIds(session) };
             ASSERT_EQ(releases.results.size(), 1);
@@ -170,10 +176,10 @@ TEST_F(DatabaseFixture, Release_findByNameAndPath)
         auto transaction{ session.createWriteTransaction() };
 
         track1.get().modify()->setRelease(release1.get());
-        track1.get().modify()->setPath("/tmp/foo/foo.mp3");
+        Track::move(session, track1.get(), "/tmp/foo/foo.mp3", {});
 
         track2.get().modify()->setRelease(release2.get());
-        track2.get().modify()->setPath("/tmp/bar/bar.mp3");
+        Track::move(session, track2.get(), "/tmp/bar/bar.mp3", {});
     }
 
     {
@@ -606,6 +612,7 @@ TEST_F(DatabaseFixture, Release_getDiscCount)
     {
         auto transaction{ session.createWriteTransaction() };
         track.get().modify()->setRelease(release.get());
+        Release::updateAggregates(session);
     }
     {
         auto transaction{ session.createReadTransaction() };
@@ -614,6 +621,7 @@ TEST_F(DatabaseFixture, Release_getDiscCount)
     {
         auto transaction{ session.createWriteTransaction() };
         track.get().modify()->setDiscNumber(5);
+        Release::updateAggregates(session);
     }
     {
         auto transaction{ session.createReadTransaction() };
@@ -623,6 +631,7 @@ TEST_F(DatabaseFixture, Release_getDiscCount)
         auto transaction{ session.createWriteTransaction() };
         track2.get().modify()->setRelease(release.get());
         track2.get().modify()->setDiscNumber(5);
+        Release::updateAggregates(session);
     }
     {
         auto transaction{ session.createReadTransaction() };
@@ -631,6 +640,7 @@ TEST_F(DatabaseFixture, Release_getDiscCount)
     {
         auto transaction{ session.createWriteTransaction() };
         track2.get().modify()->setDiscNumber(6);
+        Release::updateAggregates(session);
     }
     {
         auto transaction{ session.createReadTransaction() };
@@ -737,6 +747,9 @@ TEST_F(DatabaseFixture, Release_sortMethod)
 
         track2.get().modify()->setRelease(release2.get());
         track2.get().modify()->setDate(release2Date);
+
+        // release dates are aggregated from their tracks
+        Release::updateAggregates(session);
     }
 
     {
@@ -782,6 +795,40 @@ TEST_F(DatabaseFixture, Release_sortMethod)
     }
 }
 
+TEST_F(DatabaseFixture, Release_cursor)
+{
+    ScopedRelease release1{ session, "b" };
+    ScopedRelease release2{ session, "A" };
+    ScopedRelease release3{ session, "a" };
+    ScopedRelease release4{ session, "C" };
+
+    auto transaction{ session.createReadTransaction() };
+
+    const auto allReleases{ Release::findIds(session, Release::FindParameters{}.setSortMethod(ReleaseSortMethod::Name)) };
+    ASSERT_EQ(allReleases.results.size(), 4);
+    EXPECT_FALSE(allReleases.nextCursor);
+
+    std::vector<ReleaseId> releases;
+    std::optional<Cursor> cursor;
+    for (std::size_t offset{}; ; offset += 1)
+    {
+        const auto res{ Release::findIds(session, Release::FindParameters{}.setSortMethod(ReleaseSortMethod::Name).setRange(Range{ offset, 1 }).setCursor(cursor)) };
+        EXPECT_EQ(res.range.offset, offset);
+        releases.insert(std::end(releases), std::cbegin(res.results), std::cend(res.results));
+
+        if (!res.moreResults)
+        {
+            EXPECT_FALSE(res.nextCursor);
+            break;
+        }
+
+        ASSERT_TRUE(res.nextCursor);
+        cursor = res.nextCursor;
+    }
+
+    EXPECT_EQ(releases, allReleases.results);
+}
+
 TEST_F(DatabaseFixture, Release_meanBitrate)
 {
     ScopedRelease release1{ session, "MyRelease1" };
@@ -818,4 +865,84 @@ TEST_F(DatabaseFixture, Release_meanBitrate)
         track3.get().modify()->setRelease(release1.get());
     }
     checkExpectedBitrate(192); // 0 should not be taken into account
-}
\ No newline at end of file
+}
+TEST_F(DatabaseFixture, Release_updateAggregates)
+{
+    ScopedRelease release{ session, "MyRelease" };
+    ScopedTrack track1{ session, "MyTrack1" };
+    ScopedTrack track2{ session, "MyTrack2" };
+    ScopedClusterType genreType{ session, "GENRE" };
+    ScopedClusterType moodType{ session, "MOOD" };
+    ScopedCluster rock{ session, genreType.lockAndGet(), "Rock" };
+    ScopedCluster pop{ session, genreType.lockAndGet(), "Pop" };
+    ScopedCluster sad{ session, moodType.lockAndGet(), "Sad" };
+
+    const Wt::WDateTime dateTime{ Wt::WDate{ 2024, 1, 2 }, Wt::WTime{ 3, 4, 5 } };
+    {
+        auto transaction{ session.createWriteTransaction() };
+
+        track1.get().modify()->setRelease(release.get());
+        track1.get().modify()->setDuration(std::chrono::seconds{ 10 });
+        track1.get().modify()->setDiscNumber(1);
+        track1.get().modify()->setLastWriteTime(dateTime.addSecs(-60));
+        track2.get().modify()->setRelease(release.get());
+        track2.get().modify()->setDuration(std::chrono::seconds{ 20 });
+        track2.get().modify()->setDiscNumber(2);
+        track2.get().modify()->setLastWriteTime(dateTime);
+
+        pop.get().modify()->addTrack(track1.get());
+        pop.get().modify()->addTrack(track2.get());
+        rock.get().modify()->addTrack(track2.get());
+        sad.get().modify()->addTrack(track1.get());
+        sad.get().modify()->addTrack(track2.get());
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+        EXPECT_EQ(release.get()->getTracksCount(), 0); // not computed yet
+        EXPECT_EQ(release.get()->getPrimaryGenre(), "");
+    }
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+        Release::updateAggregates(session);
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+        EXPECT_EQ(release.get()->getTracksCount(), 2);
+        EXPECT_EQ(release.get()->getDuration(), std::chrono::seconds{ 30 });
+        EXPECT_EQ(release.get()->getDiscCount(), 2);
+        EXPECT_EQ(release.get()->getLastWritten(), dateTime);
+        EXPECT_EQ(release.get()->getPrimaryGenre(), "Pop");
+    }
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+        track2.get().modify()->setRelease({});
+        Release::updateAggregates(session);
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+        EXPECT_EQ(release.get()->getTracksCount(), 1);
+        EXPECT_EQ(release.get()->getDuration(), std::chrono::seconds{ 10 });
+        EXPECT_EQ(release.get()->getDiscCount(), 1);
+        EXPECT_EQ(release.get()->getLastWritten(), dateTime.addSecs(-60));
+        EXPECT_EQ(release.get()->getPrimaryGenre(), "Pop");
+    }
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+        track1.get().modify()->setRelease({});
+        Release::updateAggregates(session);
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+        EXPECT_EQ(release.get()->getTracksCount(), 0);
+        EXPECT_EQ(release.get()->getDuration(), std::chrono::seconds{ 0 });
+        EXPECT_EQ(release.get()->getDiscCount(), 0);
+        EXPECT_EQ(release.get()->getPrimaryGenre(), "");
+    }
+}
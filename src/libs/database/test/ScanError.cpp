@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Common.hpp"
+
+#include "database/ScanError.hpp"
+
+using namespace Database;
+
+TEST_F(DatabaseFixture, ScanError)
+{
+    auto getAll{ [&](std::optional<Range> range = std::nullopt)
+        {
+            auto transaction{ session.createReadTransaction() };
+
+            std::vector<ScanError::Entry> entries;
+            ScanError::find(session, range, [&](const ScanError::Entry& entry) { entries.push_back(entry); });
+
+            return entries;
+        } };
+
+    EXPECT_TRUE(getAll().empty());
+
+    // more than one insert chunk
+    std::vector<ScanError::Entry> entries;
+    for (std::size_t i{}; i < 300; ++i)
+        entries.push_back(ScanError::Entry{ "/root/file" + std::to_string(1000 - i) + ".mp3", static_cast<int>(i % 4), i % 2 ? "Permission denied" : "" });
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+        ScanError::add(session, entries);
+        ScanError::add(session, std::span{ entries }.first(1));
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+        EXPECT_EQ(ScanError::getCount(session), 301);
+    }
+
+    std::vector<ScanError::Entry> expectedEntries{ entries };
+    expectedEntries.push_back(entries.front());
+    EXPECT_EQ(getAll(), expectedEntries);
+
+    const std::vector<ScanError::Entry> rangeEntries{ getAll(Range{ 10, 5 }) };
+    EXPECT_EQ(rangeEntries, std::vector<ScanError::Entry>(std::cbegin(entries) + 10, std::cbegin(entries) + 15));
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+        ScanError::clear(session);
+    }
+    EXPECT_TRUE(getAll().empty());
+}
@@ -0,0 +1,233 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Common.hpp"
+
+#include "database/Similarity.hpp"
+
+using namespace Database;
+
+TEST_F(DatabaseFixture, Similarity_releases)
+{
+    ScopedRelease release1{ session, "MyRelease1" };
+    ScopedRelease release2{ session, "MyRelease2" };
+    ScopedRelease release3{ session, "MyRelease3" };
+
+    {
+        auto transaction{ session.createReadTransaction() };
+        EXPECT_TRUE(Similarity::isEmpty(session));
+        EXPECT_EQ(Similarity::findSimilarReleaseIds(session, release1.getId()).results.size(), 0);
+    }
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+        const Similarity::Entries<ReleaseId> entries{ { release3.getId(), 5 }, { release2.getId(), 2 } };
+        Similarity::setReleaseSimilarities(session, release1.getId(), entries);
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+        EXPECT_FALSE(Similarity::isEmpty(session));
+
+        const auto releases{ Similarity::findSimilarReleaseIds(session, release1.getId()) };
+        ASSERT_EQ(releases.results.size(), 2);
+        EXPECT_EQ(releases.results[0], release3.getId());
+        EXPECT_EQ(releases.results[1], release2.getId());
+
+        const auto firstRelease{ Similarity::findSimilarReleaseIds(session, release1.getId(), Range{ 0, 1 }) };
+        ASSERT_EQ(firstRelease.results.size(), 1);
+        EXPECT_EQ(firstRelease.results[0], release3.getId());
+        EXPECT_TRUE(firstRelease.moreResults);
+
+        std::size_t visitCount{};
+        Similarity::visitReleaseSimilarities(session, [&](ReleaseId releaseId, const Similarity::Entries<ReleaseId>& entries)
+            {
+                ++visitCount;
+                EXPECT_EQ(releaseId, release1.getId());
+                EXPECT_EQ(entries, (Similarity::Entries<ReleaseId>{ { release3.getId(), 5 }, { release2.getId(), 2 } }));
+            });
+        EXPECT_EQ(visitCount, 1);
+    }
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+        release3.get().remove();
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        const auto releases{ Similarity::findSimilarReleaseIds(session, release1.getId()) };
+        ASSERT_EQ(releases.results.size(), 1);
+        EXPECT_EQ(releases.results[0], release2.getId());
+    }
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+        Similarity::setReleaseSimilarities(session, release1.getId(), {});
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+        EXPECT_TRUE(Similarity::isEmpty(session));
+    }
+}
+
+TEST_F(DatabaseFixture, Similarity_artists)
+{
+    ScopedArtist artist1{ session, "MyArtist1" };
+    ScopedArtist artist2{ session, "MyArtist2" };
+    ScopedArtist artist3{ session, "MyArtist3" };
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+        const Similarity::Entries<ArtistId> artistEntries{ { artist2.getId(), 3 }, { artist3.getId(), 1 } };
+        Similarity::setArtistSimilarities(session, artist1.getId(), TrackArtistLinkType::Artist, artistEntries);
+        const Similarity::Entries<ArtistId> composerEntries{ { artist3.getId(), 4 } };
+        Similarity::setArtistSimilarities(session, artist1.getId(), TrackArtistLinkType::Composer, composerEntries);
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        {
+            const auto artists{ Similarity::findSimilarArtistIds(session, artist1.getId(), { TrackArtistLinkType::Artist }) };
+            ASSERT_EQ(artists.results.size(), 2);
+            EXPECT_EQ(artists.results[0], artist2.getId());
+            EXPECT_EQ(artists.results[1], artist3.getId());
+        }
+
+        {
+            // scores are summed over the link types
+            const auto artists{ Similarity::findSimilarArtistIds(session, artist1.getId(), {}) };
+            ASSERT_EQ(artists.results.size(), 2);
+            EXPECT_EQ(artists.results[0], artist3.getId());
+            EXPECT_EQ(artists.results[1], artist2.getId());
+        }
+
+        EXPECT_EQ(Similarity::findSimilarArtistIds(session, artist1.getId(), { TrackArtistLinkType::Producer }).results.size(), 0);
+        EXPECT_EQ(Similarity::findSimilarArtistIds(session, artist2.getId(), {}).results.size(), 0);
+
+        std::size_t visitCount{};
+        Similarity::visitArtistSimilarities(session, [&](ArtistId artistId, TrackArtistLinkType linkType, const Similarity::Entries<ArtistId>& entries)
+            {
+                ++visitCount;
+                EXPECT_EQ(artistId, artist1.getId());
+                if (linkType == TrackArtistLinkType::Artist)
+                    EXPECT_EQ(entries.size(), 2);
+                else
+                    EXPECT_EQ(entries.size(), 1);
+            });
+        EXPECT_EQ(visitCount, 2);
+    }
+}
+
+TEST_F(DatabaseFixture, Similarity_tracks)
+{
+    ScopedTrack track1{ session, "MyTrack1" };
+    ScopedTrack track2{ session, "MyTrack2" };
+    ScopedTrack track3{ session, "MyTrack3" };
+    ScopedTrack track4{ session, "MyTrack4" };
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+        const Similarity::Entries<TrackId> track1Entries{ { track2.getId(), 2 }, { track3.getId(), 1 } };
+        Similarity::setTrackSimilarities(session, track1.getId(), track1Entries);
+        const Similarity::Entries<TrackId> track2Entries{ { track1.getId(), 2 }, { track4.getId(), 2 }, { track3.getId(), 1 } };
+        Similarity::setTrackSimilarities(session, track2.getId(), track2Entries);
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        {
+            const std::vector<TrackId> tracks{ track1.getId() };
+            const auto similarTracks{ Similarity::findSimilarTrackIds(session, tracks) };
+            ASSERT_EQ(similarTracks.results.size(), 2);
+            EXPECT_EQ(similarTracks.results[0], track2.getId());
+            EXPECT_EQ(similarTracks.results[1], track3.getId());
+        }
+
+        {
+            // input tracks are excluded
+            const std::vector<TrackId> tracks{ track1.getId(), track2.getId() };
+            const auto similarTracks{ Similarity::findSimilarTrackIds(session, tracks) };
+            ASSERT_EQ(similarTracks.results.size(), 2);
+            EXPECT_EQ(similarTracks.results[0], track3.getId());
+            EXPECT_EQ(similarTracks.results[1], track4.getId());
+        }
+    }
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+        const Similarity::Entries<TrackId> track1Entries{ { track4.getId(), 1 } };
+        Similarity::setTrackSimilarities(session, track1.getId(), track1Entries);
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        const std::vector<TrackId> tracks{ track1.getId() };
+        const auto similarTracks{ Similarity::findSimilarTrackIds(session, tracks) };
+        ASSERT_EQ(similarTracks.results.size(), 1);
+        EXPECT_EQ(similarTracks.results[0], track4.getId());
+    }
+}
+
+TEST_F(DatabaseFixture, Similarity_relations)
+{
+    ScopedTrack track{ session, "MyTrack" };
+    ScopedRelease release{ session, "MyRelease" };
+    ScopedArtist artist{ session, "MyArtist" };
+    ScopedClusterType clusterType{ session, "MyClusterType" };
+    ScopedCluster cluster{ session, clusterType.lockAndGet(), "MyCluster" };
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+        track.get().modify()->setRelease(release.get());
+        cluster.get().modify()->addTrack(track.get());
+        TrackArtistLink::create(session, track.get(), artist.get(), TrackArtistLinkType::Artist);
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        std::size_t visitCount{};
+        Similarity::visitTrackClusters(session, [&](TrackId trackId, ClusterId clusterId)
+            {
+                ++visitCount;
+                EXPECT_EQ(trackId, track.getId());
+                EXPECT_EQ(clusterId, cluster.getId());
+            });
+        Similarity::visitTrackReleases(session, [&](TrackId trackId, ReleaseId releaseId)
+            {
+                ++visitCount;
+                EXPECT_EQ(trackId, track.getId());
+                EXPECT_EQ(releaseId, release.getId());
+            });
+        Similarity::visitTrackArtistLinks(session, [&](TrackId trackId, ArtistId artistId, TrackArtistLinkType linkType)
+            {
+                ++visitCount;
+                EXPECT_EQ(trackId, track.getId());
+                EXPECT_EQ(artistId, artist.getId());
+                EXPECT_EQ(linkType, TrackArtistLinkType::Artist);
+            });
+        EXPECT_EQ(visitCount, 3);
+    }
+}
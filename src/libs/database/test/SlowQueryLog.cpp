@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+
+#include "database/SlowQueryLog.hpp"
+
+using namespace Database;
+using namespace std::chrono_literals;
+
+TEST(SlowQueryLog, QueryShape)
+{
+    EXPECT_EQ(SlowQueryLog::computeQueryShape("SELECT id FROM track WHERE id = ?"), "SELECT id FROM track WHERE id = ?");
+    EXPECT_EQ(SlowQueryLog::computeQueryShape("SELECT id FROM track WHERE id IN (?, ?, ?)"), "SELECT id FROM track WHERE id IN (?)");
+    EXPECT_EQ(SlowQueryLog::computeQueryShape("SELECT id FROM track WHERE id IN (?,?)"), "SELECT id FROM track WHERE id IN (?)");
+    EXPECT_EQ(SlowQueryLog::computeQueryShape("SELECT id FROM track WHERE id IN (1, 2, 3.5)"), "SELECT id FROM track WHERE id IN (?)");
+    EXPECT_EQ(SlowQueryLog::computeQueryShape("SELECT  t1.id\n  FROM track t1 LIMIT 10 "), "SELECT t1.id FROM track t1 LIMIT ?");
+    EXPECT_EQ(SlowQueryLog::computeQueryShape("SELECT id FROM track WHERE name = 'it''s' OR name = '1'"), "SELECT id FROM track WHERE name = ? OR name = ?");
+    EXPECT_EQ(SlowQueryLog::computeQueryShape("SELECT \"id 2\" FROM \"track\""), "SELECT \"id 2\" FROM \"track\"");
+    EXPECT_EQ(SlowQueryLog::computeQueryShape("SELECT id FROM track WHERE name = 'unterminated"), "SELECT id FROM track WHERE name = ?");
+}
+
+TEST(SlowQueryLog, Record)
+{
+    SlowQueryLog log{ 10ms, 2 };
+    EXPECT_EQ(log.getThreshold(), 10ms);
+
+    EXPECT_TRUE(log.record(SlowQueryLog::Query{ "SELECT id FROM track WHERE id IN (?, ?)", { "1", "2" }, 2, 20ms }));
+    EXPECT_FALSE(log.record(SlowQueryLog::Query{ "SELECT id FROM track WHERE id IN (?)", { "3" }, 1, 40ms }));
+    log.setQueryPlan("SELECT id FROM track WHERE id IN (?, ?, ?)", { "SEARCH track USING INTEGER PRIMARY KEY (rowid=?)" });
+    EXPECT_TRUE(log.record(SlowQueryLog::Query{ "SELECT id FROM release", {}, 10, 15ms }));
+
+    // full
+    EXPECT_FALSE(log.record(SlowQueryLog::Query{ "SELECT id FROM artist", {}, 10, 15ms }));
+
+    const std::vector<SlowQueryLog::Entry> entries{ log.getEntries() };
+    ASSERT_EQ(entries.size(), 2);
+
+    EXPECT_EQ(entries[0].shape, "SELECT id FROM track WHERE id IN (?)");
+    EXPECT_EQ(entries[0].count, 2);
+    EXPECT_EQ(entries[0].totalDuration, 60ms);
+    EXPECT_EQ(entries[0].maxDuration, 40ms);
+    EXPECT_EQ(entries[0].lastQuery.parameters, std::vector<std::string>{ "3" });
+    EXPECT_EQ(entries[0].lastQuery.rowCount, 1);
+    ASSERT_EQ(entries[0].queryPlan.size(), 1);
+    EXPECT_EQ(entries[0].queryPlan.front(), "SEARCH track USING INTEGER PRIMARY KEY (rowid=?)");
+
+    EXPECT_EQ(entries[1].shape, "SELECT id FROM release");
+    EXPECT_EQ(entries[1].count, 1);
+    EXPECT_TRUE(entries[1].queryPlan.empty());
+
+    log.clear();
+    EXPECT_TRUE(log.getEntries().empty());
+}
@@ -135,3 +135,66 @@ TEST_F(DatabaseFixture, StarredTrack_dateTime)
         EXPECT_EQ(tracks.results[1], starredTrack1->getTrack()->getId());
     }
 }
+
+TEST_F(DatabaseFixture, StarredTrack_findStarredTrackIds)
+{
+    ScopedTrack track1{ session, "MyTrack1" };
+    ScopedTrack track2{ session, "MyTrack2" };
+    ScopedTrack track3{ session, "MyTrack3" };
+    ScopedUser user{ session, "MyUser" };
+    ScopedUser user2{ session, "MyUser2" };
+
+    ScopedStarredTrack starredTrack1{ session, track1.lockAndGet(), user.lockAndGet(), FeedbackBackend::ListenBrainz };
+    ScopedStarredTrack starredTrack2{ session, track2.lockAndGet(), user.lockAndGet(), FeedbackBackend::Internal };
+    ScopedStarredTrack starredTrack3{ session, track3.lockAndGet(), user2.lockAndGet(), FeedbackBackend::ListenBrainz };
+
+    const std::vector<TrackId> trackIds{ track1.getId(), track2.getId(), track3.getId() };
+
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        const auto starredTrackIds{ StarredTrack::findStarredTrackIds(session, trackIds, user.getId(), FeedbackBackend::ListenBrainz) };
+        ASSERT_EQ(starredTrackIds.size(), 1);
+        EXPECT_EQ(starredTrackIds.front(), track1.getId());
+
+        EXPECT_TRUE(StarredTrack::findStarredTrackIds(session, std::vector<TrackId>{ track2.getId(), track3.getId() }, user.getId(), FeedbackBackend::ListenBrainz).empty());
+        EXPECT_TRUE(StarredTrack::findStarredTrackIds(session, std::vector<TrackId>{}, user.getId(), FeedbackBackend::ListenBrainz).empty());
+    }
+}
+
+TEST_F(DatabaseFixture, StarredTrack_getStarredDateTimes)
+{
+    ScopedTrack track1{ session, "MyTrack1" };
+    ScopedTrack track2{ session, "MyTrack2" };
+    ScopedTrack track3{ session, "MyTrack3" };
+    ScopedUser user{ session, "MyUser" };
+    ScopedUser user2{ session, "MyUser2" };
+
+    ScopedStarredTrack starredTrack1{ session, track1.lockAndGet(), user.lockAndGet(), FeedbackBackend::Internal };
+    ScopedStarredTrack starredTrack2{ session, track2.lockAndGet(), user.lockAndGet(), FeedbackBackend::Internal };
+    ScopedStarredTrack starredTrack3{ session, track3.lockAndGet(), user.lockAndGet(), FeedbackBackend::ListenBrainz };
+    ScopedStarredTrack starredTrack4{ session, track3.lockAndGet(), user2.lockAndGet(), FeedbackBackend::Internal };
+
+    const Wt::WDateTime dateTime{ Wt::WDate {1950, 1, 2}, Wt::WTime {12, 30, 1} };
+    {
+        auto transaction{ session.createWriteTransaction() };
+
+        starredTrack1.get().modify()->setDateTime(dateTime);
+        starredTrack2.get().modify()->setSyncState(SyncState::PendingRemove);
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        std::vector<std::pair<TrackId, Wt::WDateTime>> dateTimes;
+        StarredTrack::getStarredDateTimes(session, user.getId(), FeedbackBackend::Internal, [&](TrackId trackId, const Wt::WDateTime& starredDateTime) { dateTimes.emplace_back(trackId, starredDateTime); });
+        ASSERT_EQ(dateTimes.size(), 1);
+        EXPECT_EQ(dateTimes[0].first, track1.getId());
+        EXPECT_EQ(dateTimes[0].second, dateTime);
+
+        dateTimes.clear();
+        StarredTrack::getStarredDateTimes(session, user.getId(), FeedbackBackend::ListenBrainz, [&](TrackId trackId, const Wt::WDateTime& starredDateTime) { dateTimes.emplace_back(trackId, starredDateTime); });
+        ASSERT_EQ(dateTimes.size(), 1);
+        EXPECT_EQ(dateTimes[0].first, track3.getId());
+    }
+}
@@ -20,6 +20,9 @@
 #include "Common.hpp"
 
 #include <algorithm>
+#include <tuple>
+
+#include "database/CatalogueChange.hpp"
 
 using namespace Database;
 
@@ -63,6 +66,239 @@ TEST_F(DatabaseFixture, Track)
     }
 }
 
+TEST_F(DatabaseFixture, Track_findByIds)
+{
+    ScopedTrack track1{ session, "MyTrackFile1" };
+    ScopedTrack track2{ session, "MyTrackFile2" };
+    ScopedTrack track3{ session, "MyTrackFile3" };
+
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        EXPECT_TRUE(Track::find(session, std::vector<TrackId>{}).empty());
+
+        const std::vector<TrackId> trackIds{ track3.getId(), TrackId{ track3.getId().getValue() + 1000 }, track1.getId() };
+        const auto tracks{ Track::find(session, trackIds) };
+        ASSERT_EQ(tracks.size(), 2);
+        EXPECT_EQ(tracks[0]->getId(), track3.getId());
+        EXPECT_EQ(tracks[1]->getId(), track1.getId());
+    }
+}
+
+TEST_F(DatabaseFixture, Track_findArtistLinkIds)
+{
+    ScopedTrack track1{ session, "MyTrackFile1" };
+    ScopedTrack track2{ session, "MyTrackFile2" };
+    ScopedRelease release{ session, "MyRelease" };
+    ScopedArtist artist1{ session, "MyArtist1" };
+    ScopedArtist artist2{ session, "MyArtist2" };
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+
+        track1.get().modify()->setRelease(release.get());
+        TrackArtistLink::create(session, track1.get(), artist1.get(), TrackArtistLinkType::Artist);
+        TrackArtistLink::create(session, track1.get(), artist2.get(), TrackArtistLinkType::Composer);
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        std::vector<Track::ArtistLinkIds> visitedIds;
+        Track::findArtistLinkIds(session, [&](const Track::ArtistLinkIds& ids) { visitedIds.push_back(ids); });
+        ASSERT_EQ(visitedIds.size(), 3);
+
+        std::sort(std::begin(visitedIds), std::end(visitedIds), [](const Track::ArtistLinkIds& lhs, const Track::ArtistLinkIds& rhs) { return std::tie(lhs.trackId, lhs.artistId) < std::tie(rhs.trackId, rhs.artistId); });
+
+        EXPECT_EQ(visitedIds[0].trackId, track1.getId());
+        EXPECT_EQ(visitedIds[0].releaseId, release.getId());
+        EXPECT_EQ(visitedIds[0].artistId, artist1.getId());
+        EXPECT_EQ(visitedIds[0].linkType, TrackArtistLinkType::Artist);
+
+        EXPECT_EQ(visitedIds[1].trackId, track1.getId());
+        EXPECT_EQ(visitedIds[1].releaseId, release.getId());
+        EXPECT_EQ(visitedIds[1].artistId, artist2.getId());
+        EXPECT_EQ(visitedIds[1].linkType, TrackArtistLinkType::Composer);
+
+        EXPECT_EQ(visitedIds[2].trackId, track2.getId());
+        EXPECT_FALSE(visitedIds[2].releaseId.isValid());
+        EXPECT_FALSE(visitedIds[2].artistId.isValid());
+    }
+}
+
+TEST_F(DatabaseFixture, Track_findArtistLinkIds_tracks)
+{
+    ScopedTrack track1{ session, "MyTrackFile1" };
+    ScopedTrack track2{ session, "MyTrackFile2" };
+    ScopedRelease release{ session, "MyRelease" };
+    ScopedArtist artist{ session, "MyArtist" };
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+
+        track2.get().modify()->setRelease(release.get());
+        TrackArtistLink::create(session, track1.get(), artist.get(), TrackArtistLinkType::Artist);
+        TrackArtistLink::create(session, track2.get(), artist.get(), TrackArtistLinkType::Artist);
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        const std::vector<TrackId> tracks{ track2.getId() };
+        std::vector<Track::ArtistLinkIds> visitedIds;
+        Track::findArtistLinkIds(session, tracks, [&](const Track::ArtistLinkIds& ids) { visitedIds.push_back(ids); });
+        ASSERT_EQ(visitedIds.size(), 1);
+        EXPECT_EQ(visitedIds[0].trackId, track2.getId());
+        EXPECT_EQ(visitedIds[0].releaseId, release.getId());
+        EXPECT_EQ(visitedIds[0].artistId, artist.getId());
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        std::size_t count{};
+        Track::findArtistLinkIds(session, std::span<const TrackId>{}, [&](const Track::ArtistLinkIds&) { ++count; });
+        EXPECT_EQ(count, 0);
+    }
+}
+
+TEST_F(DatabaseFixture, Track_artistLinkSubTypes)
+{
+    ScopedTrack track1{ session, "MyTrackFile1" };
+    ScopedTrack track2{ session, "MyTrackFile2" };
+    ScopedArtist artist{ session, "MyArtist" };
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+
+        TrackArtistLink::create(session, track1.get(), artist.get(), TrackArtistLinkType::Performer, "MyRole");
+        TrackArtistLink::create(session, track2.get(), artist.get(), TrackArtistLinkType::Performer, "MyRole");
+        TrackArtistLink::create(session, track2.get(), artist.get(), TrackArtistLinkType::Artist);
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        const TrackArtistLinkSubType::pointer subType{ TrackArtistLinkSubType::find(session, "MyRole") };
+        ASSERT_TRUE(subType);
+        EXPECT_EQ(subType->getName(), "MyRole");
+        EXPECT_FALSE(TrackArtistLinkSubType::find(session, "MyOtherRole"));
+
+        const auto links1{ track1->getArtistLinks() };
+        ASSERT_EQ(links1.size(), 1);
+        EXPECT_EQ(links1.front()->getSubType(), "MyRole");
+
+        std::size_t performerCount{};
+        for (const TrackArtistLink::pointer& link : track2->getArtistLinks())
+        {
+            if (link->getType() == TrackArtistLinkType::Performer)
+            {
+                EXPECT_EQ(link->getSubType(), "MyRole");
+                performerCount++;
+            }
+            else
+                EXPECT_TRUE(link->getSubType().empty());
+        }
+        EXPECT_EQ(performerCount, 1);
+    }
+}
+
+TEST_F(DatabaseFixture, Track_extraInfo)
+{
+    ScopedTrack track{ session, "MyTrackFile" };
+
+    {
+        auto transaction{ session.createReadTransaction() };
+        EXPECT_EQ(track->getExtraInfo(), Track::ExtraInfo{});
+    }
+
+    Track::ExtraInfo extraInfo;
+    extraInfo.discSubtitle = "MySubtitle";
+    extraInfo.copyright = "MyCopyright";
+    extraInfo.copyrightURL = "MyCopyrightURL";
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+        Track::setExtraInfo(session, track.get(), extraInfo);
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+        EXPECT_EQ(track->getExtraInfo(), extraInfo);
+    }
+
+    extraInfo.copyright.clear();
+    {
+        auto transaction{ session.createWriteTransaction() };
+        Track::setExtraInfo(session, track.get(), extraInfo);
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+        EXPECT_EQ(track->getExtraInfo(), extraInfo);
+    }
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+        Track::setExtraInfo(session, track.get(), Track::ExtraInfo{});
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+        EXPECT_EQ(track->getExtraInfo(), Track::ExtraInfo{});
+    }
+}
+
+TEST_F(DatabaseFixture, Track_findSummaries)
+{
+    ScopedTrack track1{ session, "MyTrackFile1" };
+    ScopedTrack track2{ session, "MyTrackFile2" };
+    ScopedRelease release{ session, "MyRelease" };
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+
+        track1.get().modify()->setDuration(std::chrono::seconds{ 42 });
+        track1.get().modify()->setRelease(release.get());
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        std::vector<Track::Summary> summaries;
+        Track::findSummaries(session, Track::FindParameters{}.setRelease(release.getId()), [&](const Track::Summary& summary) { summaries.push_back(summary); });
+        ASSERT_EQ(summaries.size(), 1);
+        EXPECT_EQ(summaries.front().trackId, track1.getId());
+        EXPECT_EQ(summaries.front().path, std::filesystem::path{ "MyTrackFile1" });
+        EXPECT_EQ(summaries.front().duration, std::chrono::seconds{ 42 });
+        EXPECT_EQ(summaries.front().release, release.getId());
+
+        summaries.clear();
+        Track::findSummaries(session, Track::FindParameters{}.setSortMethod(TrackSortMethod::Random), [&](const Track::Summary& summary) { summaries.push_back(summary); });
+        ASSERT_EQ(summaries.size(), 2);
+        EXPECT_TRUE(std::any_of(std::cbegin(summaries), std::cend(summaries), [&](const Track::Summary& summary) { return summary.trackId == track2.getId() && !summary.release.isValid(); }));
+    }
+}
+
+TEST_F(DatabaseFixture, Track_findById)
+{
+    TrackId removedTrackId;
+    {
+        ScopedTrack track{ session, "MyTrackFile" };
+        removedTrackId = track.getId();
+
+        auto transaction{ session.createReadTransaction() };
+        EXPECT_EQ(Track::find(session, removedTrackId), track.get());
+        EXPECT_EQ(Track::find(session, removedTrackId), track.get()); // second lookup reuses the loaded object
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+        EXPECT_FALSE(Track::find(session, removedTrackId));
+        EXPECT_FALSE(Track::find(session, TrackId{}));
+    }
+}
+
 TEST_F(DatabaseFixture, Track_MediaLibrary)
 {
     ScopedTrack track{ session, "MyTrackFile" };
@@ -128,6 +364,250 @@ TEST_F(DatabaseFixture, MultipleTracks)
     }
 }
 
+TEST_F(DatabaseFixture, Track_remove)
+{
+    ScopedTrack track1{ session, "MyTrackFile1" };
+    ScopedTrack track2{ session, "MyTrackFile2" };
+    ScopedTrack track3{ session, "MyTrackFile3" };
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+
+        const std::vector<TrackId> trackIds{ track1.getId(), track3.getId(), TrackId{ 42 } };
+        EXPECT_EQ(Track::remove(session, trackIds), 2);
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        EXPECT_FALSE(Track::exists(session, track1.getId()));
+        EXPECT_TRUE(Track::exists(session, track2.getId()));
+        EXPECT_FALSE(Track::exists(session, track3.getId()));
+        EXPECT_EQ(Track::getCount(session), 1);
+    }
+}
+
+TEST_F(DatabaseFixture, Track_findFileScanInfos)
+{
+    ScopedTrack track1{ session, "MyTrackFile1" };
+    ScopedTrack track2{ session, "MyTrackFile2" };
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+
+        track1.get().modify()->setFileSize(1234);
+        track1.get().modify()->setContentFingerprint(0xDEADBEEF);
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        std::vector<Track::FileScanInfo> fileScanInfos;
+        Track::findFileScanInfos(session, [&](const Track::FileScanInfo& fileScanInfo) { fileScanInfos.push_back(fileScanInfo); });
+        ASSERT_EQ(fileScanInfos.size(), 2);
+        std::sort(std::begin(fileScanInfos), std::end(fileScanInfos), [](const Track::FileScanInfo& lhs, const Track::FileScanInfo& rhs) { return lhs.trackId < rhs.trackId; });
+
+        EXPECT_EQ(fileScanInfos[0].trackId, track1.getId());
+        EXPECT_EQ(fileScanInfos[0].path, "MyTrackFile1");
+        EXPECT_EQ(fileScanInfos[0].fileSize, 1234);
+        ASSERT_TRUE(fileScanInfos[0].contentFingerprint);
+        EXPECT_EQ(*fileScanInfos[0].contentFingerprint, 0xDEADBEEF);
+
+        EXPECT_EQ(fileScanInfos[1].trackId, track2.getId());
+        EXPECT_EQ(fileScanInfos[1].fileSize, 0);
+        EXPECT_FALSE(fileScanInfos[1].contentFingerprint);
+    }
+}
+
+TEST_F(DatabaseFixture, Track_findPathsWithEstimatedDuration)
+{
+    ScopedTrack track1{ session, "MyTrackFile1" };
+    ScopedTrack track2{ session, "MyTrackFile2" };
+
+    {
+        auto transaction{ session.createReadTransaction() };
+        EXPECT_TRUE(Track::findPathsWithEstimatedDuration(session).results.empty());
+    }
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+        track2.get().modify()->setDurationEstimated(true);
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        const auto paths{ Track::findPathsWithEstimatedDuration(session) };
+        ASSERT_EQ(paths.results.size(), 1);
+        EXPECT_EQ(paths.results.front().trackId, track2.getId());
+        EXPECT_EQ(paths.results.front().path, "MyTrackFile2");
+        EXPECT_TRUE(track2->isDurationEstimated());
+        EXPECT_FALSE(track1->isDurationEstimated());
+    }
+}
+
+TEST_F(DatabaseFixture, Track_findPathsWithPendingLoudnessAnalysis)
+{
+    ScopedTrack track1{ session, "MyTrackFile1" };
+    ScopedTrack track2{ session, "MyTrackFile2" };
+
+    {
+        auto transaction{ session.createReadTransaction() };
+        EXPECT_TRUE(Track::findPathsWithPendingLoudnessAnalysis(session).results.empty());
+    }
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+        track1.get().modify()->setLoudnessAnalysisPending(true);
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        const auto paths{ Track::findPathsWithPendingLoudnessAnalysis(session) };
+        ASSERT_EQ(paths.results.size(), 1);
+        EXPECT_EQ(paths.results.front().trackId, track1.getId());
+        EXPECT_EQ(paths.results.front().path, "MyTrackFile1");
+        EXPECT_TRUE(track1->isLoudnessAnalysisPending());
+        EXPECT_FALSE(track2->isLoudnessAnalysisPending());
+    }
+}
+
+TEST_F(DatabaseFixture, Track_findIdsByMBIDs)
+{
+    ScopedTrack track1{ session, "MyTrack1" };
+    ScopedTrack track2{ session, "MyTrack2" };
+    const UUID trackMBID{ UUID::generate() };
+    const UUID recordingMBID{ UUID::generate() };
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+        track1.get().modify()->setTrackMBID(trackMBID);
+        track1.get().modify()->setRecordingMBID(recordingMBID);
+        track2.get().modify()->setRecordingMBID(recordingMBID);
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        EXPECT_TRUE(Track::findIdsByMBIDs(session, std::vector<UUID>{ UUID::generate() }).empty());
+
+        const auto tracksByMBID{ Track::findIdsByMBIDs(session, std::vector<UUID>{ trackMBID, recordingMBID }) };
+        ASSERT_EQ(tracksByMBID.size(), 1);
+        EXPECT_EQ(tracksByMBID[0].trackId, track1.getId());
+        EXPECT_EQ(tracksByMBID[0].mbid, trackMBID);
+
+        const auto tracksByRecordingMBID{ Track::findIdsByRecordingMBIDs(session, std::vector<UUID>{ recordingMBID }) };
+        ASSERT_EQ(tracksByRecordingMBID.size(), 2);
+        EXPECT_EQ(tracksByRecordingMBID[0].mbid, recordingMBID);
+        EXPECT_EQ(tracksByRecordingMBID[1].mbid, recordingMBID);
+        EXPECT_NE(tracksByRecordingMBID[0].trackId, tracksByRecordingMBID[1].trackId);
+    }
+}
+
+TEST_F(DatabaseFixture, Track_findTrackMBIDDuplicates)
+{
+    ScopedTrack track1{ session, "MyTrack1" };
+    ScopedTrack track2{ session, "MyTrack2" };
+    ScopedTrack track3{ session, "MyTrack3" };
+    ScopedTrack track4{ session, "MyTrack4" };
+    ScopedTrack track5{ session, "MyTrack5" };
+    const UUID mbid1{ UUID::generate() };
+    const UUID mbid2{ UUID::generate() };
+    const UUID mbid3{ UUID::generate() };
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+        track1.get().modify()->setTrackMBID(mbid1);
+        track2.get().modify()->setTrackMBID(mbid1);
+        track3.get().modify()->setTrackMBID(mbid2);
+        track4.get().modify()->setTrackMBID(mbid3);
+        track5.get().modify()->setTrackMBID(mbid3);
+    }
+
+    std::int64_t changeId{};
+    {
+        auto transaction{ session.createReadTransaction() };
+        changeId = CatalogueChange::getLastChangeId(session);
+
+        const auto duplicates{ Track::findTrackMBIDDuplicates(session, 0, std::nullopt, 10) };
+        ASSERT_EQ(duplicates.size(), 2);
+        EXPECT_LT(toMBIDBlob(duplicates[0].mbid), toMBIDBlob(duplicates[1].mbid));
+        for (const Track::MBIDDuplicates& duplicate : duplicates)
+        {
+            if (duplicate.mbid == mbid1)
+                EXPECT_EQ(duplicate.trackIds, (std::vector<TrackId>{ track1.getId(), track2.getId() }));
+            else
+            {
+                EXPECT_EQ(duplicate.mbid, mbid3);
+                EXPECT_EQ(duplicate.trackIds, (std::vector<TrackId>{ track4.getId(), track5.getId() }));
+            }
+        }
+
+        const auto firstDuplicates{ Track::findTrackMBIDDuplicates(session, 0, std::nullopt, 1) };
+        ASSERT_EQ(firstDuplicates.size(), 1);
+        EXPECT_EQ(firstDuplicates[0].mbid, duplicates[0].mbid);
+
+        const auto nextDuplicates{ Track::findTrackMBIDDuplicates(session, 0, firstDuplicates[0].mbid, 1) };
+        ASSERT_EQ(nextDuplicates.size(), 1);
+        EXPECT_EQ(nextDuplicates[0].mbid, duplicates[1].mbid);
+
+        EXPECT_TRUE(Track::findTrackMBIDDuplicates(session, 0, nextDuplicates[0].mbid, 1).empty());
+        EXPECT_TRUE(Track::findTrackMBIDDuplicates(session, changeId, std::nullopt, 10).empty());
+    }
+
+    // only the MBIDs of the changed tracks are checked
+    {
+        auto transaction{ session.createWriteTransaction() };
+        track2.get().modify()->setName("MyTrack2, modified");
+        track3.get().modify()->setName("MyTrack3, modified");
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        const auto duplicates{ Track::findTrackMBIDDuplicates(session, changeId, std::nullopt, 10) };
+        ASSERT_EQ(duplicates.size(), 1);
+        EXPECT_EQ(duplicates[0].mbid, mbid1);
+        EXPECT_EQ(duplicates[0].trackIds, (std::vector<TrackId>{ track1.getId(), track2.getId() }));
+    }
+}
+
+TEST_F(DatabaseFixture, Track_findIdsInDirectory)
+{
+    ScopedTrack track1{ session, "/root/artist/release/track1.mp3" };
+    ScopedTrack track2{ session, "/root/artist/release/cd2/track2.mp3" };
+    ScopedTrack track3{ session, "/root/artist-other/track3.mp3" };
+    ScopedRelease release{ session, "MyRelease" };
+    ScopedRelease otherRelease{ session, "MyOtherRelease" };
+    ScopedArtist artist{ session, "MyArtist" };
+    ScopedArtist otherArtist{ session, "MyOtherArtist" };
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+
+        track1.get().modify()->setRelease(release.get());
+        track2.get().modify()->setRelease(release.get());
+        track3.get().modify()->setRelease(otherRelease.get());
+        TrackArtistLink::create(session, track1.get(), artist.get(), TrackArtistLinkType::Artist);
+        TrackArtistLink::create(session, track2.get(), artist.get(), TrackArtistLinkType::Composer);
+        TrackArtistLink::create(session, track3.get(), otherArtist.get(), TrackArtistLinkType::Artist);
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        EXPECT_EQ(Track::findReleaseIdsInDirectory(session, "/root/artist").results, std::vector<ReleaseId>{ release.getId() });
+        EXPECT_EQ(Track::findReleaseIdsInDirectory(session, "/root/artist/release/cd2").results, std::vector<ReleaseId>{ release.getId() });
+        EXPECT_EQ(Track::findReleaseIdsInDirectory(session, "/root").results.size(), 2);
+        EXPECT_TRUE(Track::findReleaseIdsInDirectory(session, "/other").results.empty());
+
+        EXPECT_EQ(Track::findArtistIdsInDirectory(session, "/root/artist").results, std::vector<ArtistId>{ artist.getId() });
+        EXPECT_EQ(Track::findArtistIdsInDirectory(session, "/root/artist-other").results, std::vector<ArtistId>{ otherArtist.getId() });
+        EXPECT_EQ(Track::findArtistIdsInDirectory(session, "/root/").results.size(), 2);
+    }
+}
+
 TEST_F(DatabaseFixture, MultipleTracksSearchByFilter)
 {
     ScopedTrack track1{ session, "" };
@@ -174,6 +654,44 @@ TEST_F(DatabaseFixture, MultipleTracksSearchByFilter)
     }
 }
 
+TEST_F(DatabaseFixture, Track_searchByKeywordsAfterRename)
+{
+    ScopedTrack track1{ session, "" };
+    ScopedTrack track2{ session, "" };
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+        track1.get().modify()->setName("Foo \"Bar\" Baz");
+        track2.get().modify()->setName("Foo");
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        const auto tracks{ Track::findIds(session, Track::FindParameters {}.setKeywords({"\"Bar\""})) };
+        ASSERT_EQ(tracks.results.size(), 1);
+        EXPECT_EQ(tracks.results.front(), track1.getId());
+
+        EXPECT_EQ(Track::findIds(session, Track::FindParameters{}.setKeywords({ "Foo", "Baz" })).results.size(), 1);
+        EXPECT_EQ(Track::findIds(session, Track::FindParameters{}.setKeywords({ "Qux" })).results.size(), 0);
+    }
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+        track2.get().modify()->setName("Qux");
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        const auto tracks{ Track::findIds(session, Track::FindParameters {}.setKeywords({"Qux"})) };
+        ASSERT_EQ(tracks.results.size(), 1);
+        EXPECT_EQ(tracks.results.front(), track2.getId());
+
+        EXPECT_EQ(Track::findIds(session, Track::FindParameters{}.setKeywords({ "Foo" })).results.size(), 1);
+    }
+}
+
 TEST_F(DatabaseFixture, Track_date)
 {
     ScopedTrack track{ session, "MyTrack" };
@@ -242,3 +760,113 @@ TEST_F(DatabaseFixture, Track_writtenAfter)
     }
 }
 
+
+TEST_F(DatabaseFixture, Track_sortMethodName)
+{
+    ScopedTrack track1{ session, "MyTrack1" };
+    ScopedTrack track2{ session, "MyTrack2" };
+    ScopedTrack track3{ session, "MyTrack3" };
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+        track1.get().modify()->setName("Été");
+        track2.get().modify()->setName("eux");
+        track3.get().modify()->setName("Abba");
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        const auto tracks{ Track::findIds(session, Track::FindParameters {}.setSortMethod(TrackSortMethod::Name)) };
+        ASSERT_EQ(tracks.results.size(), 3);
+        EXPECT_EQ(tracks.results[0], track3.getId());
+        EXPECT_EQ(tracks.results[1], track1.getId());
+        EXPECT_EQ(tracks.results[2], track2.getId());
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        const auto firstTracks{ Track::findIds(session, Track::FindParameters {}.setSortMethod(TrackSortMethod::Name).setRange(Range{ 0, 2 })) };
+        ASSERT_EQ(firstTracks.results.size(), 2);
+        ASSERT_TRUE(firstTracks.nextCursor);
+
+        const auto nextTracks{ Track::findIds(session, Track::FindParameters {}.setSortMethod(TrackSortMethod::Name).setRange(Range{ 2, 2 }).setCursor(firstTracks.nextCursor)) };
+        ASSERT_EQ(nextTracks.results.size(), 1);
+        EXPECT_EQ(nextTracks.results[0], track2.getId());
+    }
+}
+
+TEST_F(DatabaseFixture, Track_sortMethodDateDesc)
+{
+    ScopedTrack track1{ session, "MyTrack1" };
+    ScopedTrack track2{ session, "MyTrack2" };
+    ScopedTrack track3{ session, "MyTrack3" };
+    ScopedTrack track4{ session, "MyTrack4" };
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+        track1.get().modify()->setDate(Wt::WDate{ 1994, 5, 1 });
+        track2.get().modify()->setYear(1994); // year only: before the full dates of the same year
+        track3.get().modify()->setDate(Wt::WDate{ 2001, 1, 2 });
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        const auto tracks{ Track::findIds(session, Track::FindParameters{}.setSortMethod(TrackSortMethod::DateDescAndRelease)) };
+        ASSERT_EQ(tracks.results.size(), 4);
+        EXPECT_EQ(tracks.results[0], track3.getId());
+        EXPECT_EQ(tracks.results[1], track1.getId());
+        EXPECT_EQ(tracks.results[2], track2.getId());
+        EXPECT_EQ(tracks.results[3], track4.getId()); // no date
+    }
+}
+
+TEST_F(DatabaseFixture, Track_sortMethodRandom)
+{
+    ScopedTrack track1{ session, "MyTrack1" };
+    ScopedTrack track2{ session, "MyTrack2" };
+    ScopedTrack track3{ session, "MyTrack3" };
+    ScopedRelease release{ session, "MyRelease" };
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+        track1.get().modify()->setRelease(release.get());
+        track2.get().modify()->setRelease(release.get());
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        const auto tracks{ Track::findIds(session, Track::FindParameters {}.setSortMethod(TrackSortMethod::Random)) };
+        ASSERT_EQ(tracks.results.size(), 3);
+        EXPECT_FALSE(tracks.moreResults);
+        EXPECT_TRUE(std::is_permutation(std::cbegin(tracks.results), std::cend(tracks.results), std::cbegin(std::vector<TrackId>{ track1.getId(), track2.getId(), track3.getId() })));
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        const auto tracks{ Track::findIds(session, Track::FindParameters {}.setSortMethod(TrackSortMethod::Random).setRange(Range{ 0, 2 })) };
+        EXPECT_EQ(tracks.results.size(), 2);
+        EXPECT_TRUE(tracks.moreResults);
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        const auto tracks{ Track::findIds(session, Track::FindParameters {}.setSortMethod(TrackSortMethod::Random).setRange(Range{ 2, 2 })) };
+        EXPECT_EQ(tracks.results.size(), 1);
+        EXPECT_FALSE(tracks.moreResults);
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+
+        const auto tracks{ Track::find(session, Track::FindParameters {}.setSortMethod(TrackSortMethod::Random).setRelease(release.getId()).setRange(Range{ 0, 1 })) };
+        ASSERT_EQ(tracks.results.size(), 1);
+        EXPECT_TRUE(tracks.moreResults);
+        EXPECT_TRUE(tracks.results.front()->getId() == track1.getId() || tracks.results.front()->getId() == track2.getId());
+    }
+}
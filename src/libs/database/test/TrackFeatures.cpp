@@ -46,3 +46,130 @@ TEST_F(DatabaseFixture, TrackFeatures)
 		EXPECT_EQ(allTrackFeatures.results.front(), trackFeatures.getId());
 	}
 }
+
+TEST_F(DatabaseFixture, TrackFeatures_rawFeatures)
+{
+	ScopedTrack track1 {session, "MyTrack1"};
+	ScopedTrack track2 {session, "MyTrack2"};
+	ScopedTrackFeatures trackFeatures1 {session, track1.lockAndGet(), "{\"a\": 1}"};
+	ScopedTrackFeatures trackFeatures2 {session, track2.lockAndGet(), "{\"a\": 2}"};
+
+	{
+		auto transaction {session.createReadTransaction()};
+
+		std::vector<TrackFeatures::RawFeatures> rawFeatures;
+		TrackFeaturesId lastRetrievedId;
+		TrackFeatures::findRawFeatures(session, lastRetrievedId, 1, 1, [&](TrackFeatures::RawFeatures&& features) { rawFeatures.push_back(std::move(features)); });
+		ASSERT_EQ(rawFeatures.size(), 1);
+		EXPECT_EQ(rawFeatures[0].id, trackFeatures1.getId());
+		EXPECT_EQ(rawFeatures[0].trackId, track1.getId());
+		EXPECT_EQ(rawFeatures[0].data, "{\"a\": 1}");
+		EXPECT_TRUE(rawFeatures[0].packedFeatures.empty());
+		EXPECT_EQ(lastRetrievedId, trackFeatures1.getId());
+
+		TrackFeatures::findRawFeatures(session, lastRetrievedId, 10, 1, [&](TrackFeatures::RawFeatures&& features) { rawFeatures.push_back(std::move(features)); });
+		ASSERT_EQ(rawFeatures.size(), 2);
+		EXPECT_EQ(rawFeatures[1].id, trackFeatures2.getId());
+		EXPECT_EQ(rawFeatures[1].trackId, track2.getId());
+		EXPECT_EQ(lastRetrievedId, trackFeatures2.getId());
+
+		TrackFeatures::findRawFeatures(session, lastRetrievedId, 10, 1, [&](TrackFeatures::RawFeatures&& features) { rawFeatures.push_back(std::move(features)); });
+		EXPECT_EQ(rawFeatures.size(), 2);
+	}
+}
+
+TEST_F(DatabaseFixture, TrackFeatures_packedFeatures)
+{
+	ScopedTrack track {session, "MyTrack"};
+	ScopedTrackFeatures trackFeatures {session, track.lockAndGet(), "{\"a\": 1}"};
+
+	const std::vector<float> packedFeatures {1.5f, -2.f, 3.25f};
+	{
+		auto transaction {session.createWriteTransaction()};
+		TrackFeatures::updatePackedFeatures(session, trackFeatures.getId(), packedFeatures, 42);
+	}
+
+	{
+		auto transaction {session.createReadTransaction()};
+
+		std::vector<TrackFeatures::RawFeatures> rawFeatures;
+		TrackFeaturesId lastRetrievedId;
+		TrackFeatures::findRawFeatures(session, lastRetrievedId, 10, 42, [&](TrackFeatures::RawFeatures&& features) { rawFeatures.push_back(std::move(features)); });
+		ASSERT_EQ(rawFeatures.size(), 1);
+		EXPECT_TRUE(rawFeatures[0].data.empty());
+		EXPECT_EQ(rawFeatures[0].packedFeatures, packedFeatures);
+	}
+
+	{
+		auto transaction {session.createReadTransaction()};
+
+		// outdated version: json data expected
+		std::vector<TrackFeatures::RawFeatures> rawFeatures;
+		TrackFeaturesId lastRetrievedId;
+		TrackFeatures::findRawFeatures(session, lastRetrievedId, 10, 43, [&](TrackFeatures::RawFeatures&& features) { rawFeatures.push_back(std::move(features)); });
+		ASSERT_EQ(rawFeatures.size(), 1);
+		EXPECT_EQ(rawFeatures[0].data, "{\"a\": 1}");
+		EXPECT_TRUE(rawFeatures[0].packedFeatures.empty());
+	}
+}
+
+TEST_F(DatabaseFixture, TrackFeatures_findPathsWithoutFeatures)
+{
+	ScopedTrack track1 {session, "MyTrack1"};
+	ScopedTrack track2 {session, "MyTrack2"};
+
+	{
+		auto transaction {session.createReadTransaction()};
+
+		const auto paths {Track::findPathsWithoutFeatures(session)};
+		ASSERT_EQ(paths.results.size(), 2);
+		EXPECT_EQ(paths.results[0].trackId, track1.getId());
+		EXPECT_EQ(paths.results[1].trackId, track2.getId());
+	}
+
+	ScopedTrackFeatures trackFeatures1 {session, track1.lockAndGet(), "{\"a\": 1}"};
+
+	{
+		auto transaction {session.createReadTransaction()};
+
+		const auto paths {Track::findPathsWithoutFeatures(session)};
+		ASSERT_EQ(paths.results.size(), 1);
+		EXPECT_EQ(paths.results[0].trackId, track2.getId());
+		EXPECT_EQ(paths.results[0].path, "MyTrack2");
+	}
+}
+
+TEST_F(DatabaseFixture, TrackFeatures_findRecordingMBIDsWithMissingFeatures)
+{
+	ScopedTrack track1 {session, "MyTrack1"};
+	ScopedTrack track2 {session, "MyTrack2"};
+	const UUID recordingMBID {UUID::generate()};
+
+	{
+		auto transaction {session.createReadTransaction()};
+
+		EXPECT_TRUE(Track::findRecordingMBIDsWithMissingFeatures(session).results.empty());
+	}
+
+	{
+		auto transaction {session.createWriteTransaction()};
+		track1.get().modify()->setRecordingMBID(recordingMBID);
+	}
+
+	{
+		auto transaction {session.createReadTransaction()};
+
+		const auto results {Track::findRecordingMBIDsWithMissingFeatures(session)};
+		ASSERT_EQ(results.results.size(), 1);
+		EXPECT_EQ(results.results[0].trackId, track1.getId());
+		EXPECT_EQ(results.results[0].mbid, recordingMBID);
+	}
+
+	ScopedTrackFeatures trackFeatures1 {session, track1.lockAndGet(), "{\"a\": 1}"};
+
+	{
+		auto transaction {session.createReadTransaction()};
+
+		EXPECT_TRUE(Track::findRecordingMBIDsWithMissingFeatures(session).results.empty());
+	}
+}
@@ -222,3 +222,149 @@ TEST_F(DatabaseFixture, SingleTrackList_getEntries)
         EXPECT_EQ(entries[0]->getTrack()->getId(), track2.getId());
     }
 }
+
+TEST_F(DatabaseFixture, TrackList_bulkModifiers)
+{
+    ScopedUser user{ session, "MyUser" };
+    ScopedTrackList trackList{ session, "MyTrackList", TrackListType::Playlist, false, user.lockAndGet() };
+    ScopedTrack track1{ session, "MyTrack1" };
+    ScopedTrack track2{ session, "MyTrack2" };
+    ScopedTrack track3{ session, "MyTrack3" };
+    ScopedTrack track4{ session, "MyTrack4" };
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+
+        TrackId unknownTrackId{ track4.getId().getValue() + 1 };
+        trackList.get().modify()->appendTracks({ track3.getId(), unknownTrackId, track1.getId(), track2.getId() });
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+        EXPECT_EQ(trackList.get()->getTrackIds(), (std::vector<TrackId>{ track3.getId(), track1.getId(), track2.getId() }));
+    }
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+        trackList.get().modify()->moveEntry(0, 2);
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+        EXPECT_EQ(trackList.get()->getTrackIds(), (std::vector<TrackId>{ track1.getId(), track2.getId(), track3.getId() }));
+    }
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+        trackList.get().modify()->appendTracks({ track4.getId() });
+        trackList.get().modify()->moveEntry(3, 1);
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+        EXPECT_EQ(trackList.get()->getTrackIds(), (std::vector<TrackId>{ track1.getId(), track4.getId(), track2.getId(), track3.getId() }));
+    }
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+        trackList.get().modify()->removeEntries({ 3, 1, 10 });
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+        EXPECT_EQ(trackList.get()->getTrackIds(), (std::vector<TrackId>{ track1.getId(), track2.getId() }));
+    }
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+        trackList.get().modify()->replaceTracks({ track4.getId(), track3.getId() });
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+        EXPECT_EQ(trackList.get()->getTrackIds(), (std::vector<TrackId>{ track4.getId(), track3.getId() }));
+        EXPECT_EQ(trackList.get()->getCount(), 2);
+    }
+}
+
+TEST_F(DatabaseFixture, TrackList_aggregates)
+{
+    ScopedUser user{ session, "MyUser" };
+    ScopedTrackList trackList{ session, "MyTrackList", TrackListType::Playlist, false, user.lockAndGet() };
+    ScopedTrack track1{ session, "MyTrack1" };
+    ScopedTrack track2{ session, "MyTrack2" };
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+        track1.get().modify()->setDuration(std::chrono::seconds{ 10 });
+        track2.get().modify()->setDuration(std::chrono::seconds{ 20 });
+    }
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+        trackList.get().modify()->appendTracks({ track1.getId(), track2.getId(), track1.getId() });
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+        EXPECT_EQ(trackList.get()->getCount(), 3);
+        EXPECT_EQ(trackList.get()->getDuration(), std::chrono::seconds{ 40 });
+    }
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+        trackList.get().modify()->removeEntries({ 0 });
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+        EXPECT_EQ(trackList.get()->getCount(), 2);
+        EXPECT_EQ(trackList.get()->getDuration(), std::chrono::seconds{ 30 });
+    }
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+        session.create<TrackListEntry>(track2.get(), trackList.get());
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+        EXPECT_EQ(trackList.get()->getCount(), 3);
+        EXPECT_EQ(trackList.get()->getDuration(), std::chrono::seconds{ 50 });
+    }
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+        trackList.get()->getEntry(0).remove();
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+        EXPECT_EQ(trackList.get()->getCount(), 2);
+        EXPECT_EQ(trackList.get()->getDuration(), std::chrono::seconds{ 30 });
+    }
+
+    // durations refined by the scanner
+    {
+        auto transaction{ session.createWriteTransaction() };
+        track2.get().modify()->setDuration(std::chrono::seconds{ 25 });
+        TrackList::updateAggregates(session);
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+        EXPECT_EQ(trackList.get()->getCount(), 2);
+        EXPECT_EQ(trackList.get()->getDuration(), std::chrono::seconds{ 35 });
+    }
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+        trackList.get().modify()->replaceTracks({});
+    }
+
+    {
+        auto transaction{ session.createReadTransaction() };
+        EXPECT_EQ(trackList.get()->getCount(), 0);
+        EXPECT_EQ(trackList.get()->getDuration(), std::chrono::seconds{ 0 });
+    }
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Common.hpp"
+
+using namespace Database;
+
+TEST_F(DatabaseFixture, User_settings)
+{
+    EXPECT_FALSE(User::getSettings(session, UserId{ 42 }));
+
+    ScopedUser user{ session, "MyUser" };
+
+    {
+        const std::optional<User::Settings> settings{ User::getSettings(session, user.getId()) };
+        ASSERT_TRUE(settings);
+        EXPECT_EQ(settings->type, UserType::REGULAR);
+        EXPECT_EQ(settings->feedbackBackend, User::defaultFeedbackBackend);
+        EXPECT_EQ(settings->scrobblingBackend, User::defaultScrobblingBackend);
+        EXPECT_EQ(settings->subsonicArtistListMode, User::defaultSubsonicArtistListMode);
+    }
+
+    {
+        // cached
+        const std::uint64_t statementCount{ session.getExecutedStatementCount() };
+        EXPECT_TRUE(User::getSettings(session, user.getId()));
+        EXPECT_EQ(session.getExecutedStatementCount(), statementCount);
+    }
+
+    {
+        auto transaction{ session.createWriteTransaction() };
+        user.get().modify()->setType(UserType::ADMIN);
+        user.get().modify()->setFeedbackBackend(FeedbackBackend::ListenBrainz);
+    }
+
+    {
+        const std::optional<User::Settings> settings{ User::getSettings(session, user.getId()) };
+        ASSERT_TRUE(settings);
+        EXPECT_EQ(settings->type, UserType::ADMIN);
+        EXPECT_EQ(settings->feedbackBackend, FeedbackBackend::ListenBrainz);
+    }
+}
+
+TEST_F(DatabaseFixture, User_settingsRemovedUser)
+{
+    UserId userId;
+    {
+        ScopedUser user{ session, "MyUser" };
+        userId = user.getId();
+
+        EXPECT_TRUE(User::getSettings(session, userId));
+    }
+
+    EXPECT_FALSE(User::getSettings(session, userId));
+}
@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdint>
+#include <random>
+#include <vector>
+#include <benchmark/benchmark.h>
+
+#include "image/IRawImage.hpp"
+
+namespace
+{
+    // Uncompressed 24 bits BMP, readable by all the image backends
+    std::vector<std::byte> generateBMP(std::size_t width, std::size_t height)
+    {
+        const std::size_t rowSize{ (width * 3 + 3) & ~std::size_t{ 3 } };
+        const std::size_t pixelDataSize{ rowSize * height };
+        const std::size_t headerSize{ 54 };
+
+        std::vector<std::byte> bmp(headerSize + pixelDataSize);
+        auto writeLE{ [&](std::size_t offset, std::uint32_t value, std::size_t size)
+        {
+            for (std::size_t i{}; i < size; ++i)
+                bmp[offset + i] = static_cast<std::byte>((value >> (8 * i)) & 0xFF);
+        } };
+
+        bmp[0] = std::byte{ 'B' };
+        bmp[1] = std::byte{ 'M' };
+        writeLE(2, headerSize + pixelDataSize, 4);
+        writeLE(10, headerSize, 4);
+        writeLE(14, 40, 4);
+        writeLE(18, width, 4);
+        writeLE(22, height, 4);
+        writeLE(26, 1, 2);
+        writeLE(28, 24, 2);
+        writeLE(34, pixelDataSize, 4);
+
+        // gradients plus some noise, to get realistic jpeg sizes
+        std::minstd_rand randomEngine{ 42 };
+        std::uniform_int_distribution<int> noise{ 0, 31 };
+        for (std::size_t y{}; y < height; ++y)
+        {
+            for (std::size_t x{}; x < width; ++x)
+            {
+                const std::size_t offset{ headerSize + y * rowSize + x * 3 };
+                bmp[offset] = static_cast<std::byte>((x * 255 / width + noise(randomEngine)) & 0xFF);
+                bmp[offset + 1] = static_cast<std::byte>((y * 255 / height + noise(randomEngine)) & 0xFF);
+                bmp[offset + 2] = static_cast<std::byte>(((x + y) * 127 / (width + height) + noise(randomEngine)) & 0xFF);
+            }
+        }
+
+        return bmp;
+    }
+
+    // args: source size, requested size
+    void BM_Resize(benchmark::State& state)
+    {
+        const std::vector<std::byte> bmp{ generateBMP(state.range(0), state.range(0)) };
+
+        for (auto _ : state)
+        {
+            state.PauseTiming();
+            std::unique_ptr<Image::IRawImage> image{ Image::decodeImage(bmp.data(), bmp.size()) };
+            state.ResumeTiming();
+
+            image->resize(state.range(1));
+            benchmark::DoNotOptimize(image);
+        }
+    }
+
+    // args: image size, format
+    void BM_Encode(benchmark::State& state)
+    {
+        const auto format{ static_cast<Image::ImageFormat>(state.range(1)) };
+        if (!Image::isEncodingSupported(format))
+        {
+            state.SkipWithError("Format not supported");
+            return;
+        }
+
+        const std::vector<std::byte> bmp{ generateBMP(state.range(0), state.range(0)) };
+        const std::unique_ptr<Image::IRawImage> image{ Image::decodeImage(bmp.data(), bmp.size()) };
+
+        for (auto _ : state)
+        {
+            std::unique_ptr<Image::IEncodedImage> encodedImage{ image->encodeTo(format, 75) };
+            benchmark::DoNotOptimize(encodedImage);
+        }
+    }
+
+    // args: source size, requested size
+    void BM_Cover(benchmark::State& state)
+    {
+        const std::vector<std::byte> bmp{ generateBMP(state.range(0), state.range(0)) };
+
+        for (auto _ : state)
+        {
+            std::unique_ptr<Image::IRawImage> image{ Image::decodeImage(bmp.data(), bmp.size()) };
+            image->resize(state.range(1));
+            std::unique_ptr<Image::IEncodedImage> encodedImage{ image->encodeTo(Image::ImageFormat::JPEG, 75) };
+            benchmark::DoNotOptimize(encodedImage);
+        }
+    }
+
+    // args: source size, requested size, scaled decoding
+    void BM_JPEGCover(benchmark::State& state)
+    {
+        const std::vector<std::byte> bmp{ generateBMP(state.range(0), state.range(0)) };
+        const std::unique_ptr<Image::IEncodedImage> jpeg{ Image::decodeImage(bmp.data(), bmp.size())->encodeTo(Image::ImageFormat::JPEG, 90) };
+        const bool scaledDecoding{ state.range(2) != 0 };
+
+        for (auto _ : state)
+        {
+            std::unique_ptr<Image::IRawImage> image{ scaledDecoding ? Image::decodeImage(jpeg->getData(), jpeg->getDataSize(), state.range(1)) : Image::decodeImage(jpeg->getData(), jpeg->getDataSize()) };
+            image->resize(state.range(1));
+            std::unique_ptr<Image::IEncodedImage> encodedImage{ image->encodeTo(Image::ImageFormat::JPEG, 75) };
+            benchmark::DoNotOptimize(encodedImage);
+        }
+    }
+}
+
+// Usual cover sizes, requested with the sizes used by the UI
+BENCHMARK(BM_Resize)->Args({ 600, 128 })->Args({ 1000, 128 })->Args({ 1000, 512 })->Args({ 3000, 128 })->Args({ 3000, 512 });
+BENCHMARK(BM_Encode)->ArgsProduct({ { 128, 512, 1024 }, { static_cast<int>(Image::ImageFormat::JPEG), static_cast<int>(Image::ImageFormat::WebP) } });
+BENCHMARK(BM_Cover)->Args({ 1000, 128 })->Args({ 1000, 512 })->Args({ 3000, 512 });
+BENCHMARK(BM_JPEGCover)->ArgsProduct({ { 1000, 3000 }, { 128, 512 }, { 0, 1 } });
+
+int main(int argc, char** argv)
+{
+    Image::init(argv[0]);
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 1;
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+
+    return 0;
+}
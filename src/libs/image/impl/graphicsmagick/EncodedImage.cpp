@@ -17,7 +17,7 @@
  * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include "JPEGImage.hpp"
+#include "EncodedImage.hpp"
 
 #include "RawImage.hpp"
 #include "image/Exception.hpp"
@@ -25,12 +25,35 @@
 
 namespace Image::GraphicsMagick
 {
-	JPEGImage::JPEGImage(const RawImage& rawImage, unsigned quality)
+	namespace
 	{
+		struct FormatInfo
+		{
+			const char* magick;
+			std::string_view mimeType;
+		};
+
+		FormatInfo getFormatInfo(ImageFormat format)
+		{
+			switch (format)
+			{
+				case ImageFormat::JPEG:	return {"JPEG", "image/jpeg"};
+				case ImageFormat::WebP:	return {"WEBP", "image/webp"};
+			}
+
+			throw ImageException {"Unhandled image format"};
+		}
+	}
+
+	EncodedImage::EncodedImage(const RawImage& rawImage, ImageFormat format, unsigned quality)
+	{
+		const FormatInfo formatInfo {getFormatInfo(format)};
+		_mimeType = formatInfo.mimeType;
+
 		try
 		{
 			Magick::Image image {rawImage.getMagickImage()};
-			image.magick("JPEG");
+			image.magick(formatInfo.magick);
 			image.quality(quality);
 			image.write(&_blob);
 		}
@@ -42,13 +65,13 @@ namespace Image::GraphicsMagick
 	}
 
 	const std::byte*
-	JPEGImage::getData() const
+	EncodedImage::getData() const
 	{
 		return reinterpret_cast<const std::byte*>(_blob.data());
 	}
 
 	std::size_t
-	JPEGImage::getDataSize() const
+	EncodedImage::getDataSize() const
 	{
 		return _blob.length();
 	}
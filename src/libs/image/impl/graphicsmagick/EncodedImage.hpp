@@ -30,16 +30,17 @@
 namespace Image::GraphicsMagick
 {
 	class RawImage;
-	class JPEGImage : public IEncodedImage
+	class EncodedImage : public IEncodedImage
 	{
 		public:
-			JPEGImage(const RawImage& rawImage, unsigned quality);
+			EncodedImage(const RawImage& rawImage, ImageFormat format, unsigned quality);
 
 		private:
 			const std::byte* getData() const override;
 			std::size_t getDataSize() const override;
-			std::string_view getMimeType() const override { return "image/jpeg"; }
+			std::string_view getMimeType() const override { return _mimeType; }
 
 			Magick::Blob _blob;
+			std::string_view _mimeType;
 	};
 }
@@ -21,7 +21,7 @@
 
 #include <magick/resource.h>
 
-#include "JPEGImage.hpp"
+#include "EncodedImage.hpp"
 #include "image/Exception.hpp"
 #include "utils/ILogger.hpp"
 
@@ -37,6 +37,16 @@ namespace Image
 		return std::make_unique<GraphicsMagick::RawImage>(path);
 	}
 
+	std::unique_ptr<IRawImage> decodeImage(const std::byte* encodedData, std::size_t encodedDataSize, ImageSize targetWidth)
+	{
+		return std::make_unique<GraphicsMagick::RawImage>(encodedData, encodedDataSize, targetWidth);
+	}
+
+	std::unique_ptr<IRawImage> decodeImage(const std::filesystem::path& path, ImageSize targetWidth)
+	{
+		return std::make_unique<GraphicsMagick::RawImage>(path, targetWidth);
+	}
+
 	void
 	init(const std::filesystem::path& path)
 	{
@@ -54,15 +64,55 @@ namespace Image
 		LMS_LOG(COVER, INFO, "Magick threads resource limit = " << GetMagickResourceLimit(MagickLib::ThreadsResource));
 		LMS_LOG(COVER, INFO, "Magick Disk resource limit = " << GetMagickResourceLimit(MagickLib::DiskResource));
 	}
+
+	std::string_view
+	getBackendName()
+	{
+		return "GraphicsMagick";
+	}
+
+	bool
+	isEncodingSupported(ImageFormat format)
+	{
+		switch (format)
+		{
+			case ImageFormat::JPEG:
+				return true;
+
+			case ImageFormat::WebP:
+				try
+				{
+					return Magick::CoderInfo {"WEBP"}.isWritable();
+				}
+				catch (Magick::Exception&)
+				{
+					// GraphicsMagick built without libwebp
+					return false;
+				}
+		}
+
+		return false;
+	}
 }
 
 namespace Image::GraphicsMagick
 {
 
-RawImage::RawImage(const std::byte* encodedData, std::size_t encodedDataSize)
+namespace
+{
+	void setSizeHint(Magick::Image& image, std::optional<ImageSize> targetWidth)
+	{
+		// The JPEG coder uses the size hint to perform scaled DCT decoding, the result is still at least as large as the requested size
+		if (targetWidth)
+			image.size(Magick::Geometry {static_cast<unsigned int>(*targetWidth), static_cast<unsigned int>(*targetWidth)});
+	}
+}
+
+RawImage::RawImage(const std::byte* encodedData, std::size_t encodedDataSize, std::optional<ImageSize> targetWidth)
 {
 	try
 	{
+		setSizeHint(_image, targetWidth);
 		Magick::Blob blob {encodedData, encodedDataSize};
 		_image.read(blob);
 	}
@@ -82,10 +132,11 @@ RawImage::RawImage(const std::byte* encodedData, std::size_t encodedDataSize)
 	}
 }
 
-RawImage::RawImage(const std::filesystem::path& p)
+RawImage::RawImage(const std::filesystem::path& p, std::optional<ImageSize> targetWidth)
 {
 	try
 	{
+		setSizeHint(_image, targetWidth);
 		_image.read(p.string().c_str());
 	}
 	catch (Magick::WarningCoder& e)
@@ -119,9 +170,9 @@ RawImage::resize(ImageSize width)
 }
 
 std::unique_ptr<IEncodedImage>
-RawImage::encodeToJPEG(unsigned quality) const
+RawImage::encodeTo(ImageFormat format, unsigned quality) const
 {
-	return std::make_unique<JPEGImage>(*this, quality);
+	return std::make_unique<EncodedImage>(*this, format, quality);
 }
 
 Magick::Image
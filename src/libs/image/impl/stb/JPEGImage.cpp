@@ -19,14 +19,51 @@
 
 #include "JPEGImage.hpp"
 
+#if LMS_SUPPORT_TURBOJPEG
+#include <memory>
+#include <turbojpeg.h>
+#else
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include <stb_image_write.h>
+#endif
 
 #include "image/Exception.hpp"
 #include "RawImage.hpp"
 
 namespace Image::STB
 {
+#if LMS_SUPPORT_TURBOJPEG
+	namespace
+	{
+		tjhandle getCompressor()
+		{
+			// compressors are not thread safe, but can be reused
+			thread_local const std::unique_ptr<void, decltype(&::tjDestroy)> compressor {::tjInitCompress(), ::tjDestroy};
+			return compressor.get();
+		}
+	}
+
+	JPEGImage::JPEGImage(const RawImage& rawImage, unsigned quality)
+	{
+		tjhandle compressor {getCompressor()};
+		if (!compressor)
+			throw ImageException {"Cannot create jpeg compressor!"};
+
+		unsigned char* jpegBuffer {};
+		unsigned long jpegSize {};
+		// same chroma subsampling as stb
+		const int subsampling {quality >= 90 ? TJSAMP_444 : TJSAMP_420};
+		if (::tjCompress2(compressor, reinterpret_cast<const unsigned char*>(rawImage.getData()), rawImage.getWidth(), 0, rawImage.getHeight(), TJPF_RGB,
+				&jpegBuffer, &jpegSize, subsampling, quality, TJFLAG_FASTDCT) != 0)
+		{
+			::tjFree(jpegBuffer);
+			throw ImageException {"Failed to export in jpeg format: " + std::string {::tjGetErrorStr2(compressor)}};
+		}
+
+		_data.assign(reinterpret_cast<const std::byte*>(jpegBuffer), reinterpret_cast<const std::byte*>(jpegBuffer) + jpegSize);
+		::tjFree(jpegBuffer);
+	}
+#else
 	JPEGImage::JPEGImage(const RawImage& rawImage, unsigned quality)
 	{
 		auto writeCb {[](void* ctx, void* writeData, int writeSize)
@@ -43,6 +80,7 @@ namespace Image::STB
 			throw ImageException {"Failed to export in jpeg format!"};
 		}
 	}
+#endif
 
 	const std::byte*
 	JPEGImage::getData() const
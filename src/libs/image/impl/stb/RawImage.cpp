@@ -30,7 +30,19 @@
 #include <stb_image.h>
 #include <stb_image_resize.h>
 
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+#if LMS_SUPPORT_TURBOJPEG
+#include <turbojpeg.h>
+#endif
+
 #include "JPEGImage.hpp"
+#if LMS_SUPPORT_WEBP
+#include "WebPImage.hpp"
+#endif
 
 #include "image/Exception.hpp"
 
@@ -46,29 +58,190 @@ namespace Image
         return std::make_unique<STB::RawImage>(path);
     }
 
+    std::unique_ptr<IRawImage> decodeImage(const std::byte* encodedData, std::size_t encodedDataSize, ImageSize targetWidth)
+    {
+        return std::make_unique<STB::RawImage>(encodedData, encodedDataSize, targetWidth);
+    }
+
+    std::unique_ptr<IRawImage> decodeImage(const std::filesystem::path& path, ImageSize targetWidth)
+    {
+        return std::make_unique<STB::RawImage>(path, targetWidth);
+    }
+
     void init(const std::filesystem::path&)
     {
     }
+
+    std::string_view getBackendName()
+    {
+#if LMS_SUPPORT_TURBOJPEG
+        return "stb+turbojpeg";
+#else
+        return "stb";
+#endif
+    }
+
+    bool isEncodingSupported(ImageFormat format)
+    {
+        switch (format)
+        {
+        case ImageFormat::JPEG:
+            return true;
+        case ImageFormat::WebP:
+#if LMS_SUPPORT_WEBP
+            return true;
+#else
+            return false;
+#endif
+        }
+
+        return false;
+    }
 }
 
 namespace Image::STB
 {
-    RawImage::RawImage(const std::byte* encodedData, std::size_t encodedDataSize)
+    namespace
     {
+        constexpr int channelCount{ 3 };
+
+        // 2x2 box filter, written so that the compiler vectorizes both passes
+        void halveImage(const unsigned char* src, int srcWidth, int srcHeight, unsigned char* dst)
+        {
+            const int dstWidth{ srcWidth / 2 };
+            const int dstHeight{ srcHeight / 2 };
+            const std::size_t srcStride{ static_cast<std::size_t>(srcWidth) * channelCount };
+            const std::size_t dstStride{ static_cast<std::size_t>(dstWidth) * channelCount };
+
+            std::vector<std::uint16_t> rowSums(dstWidth * 2 * channelCount);
+            for (int y{}; y < dstHeight; ++y)
+            {
+                const unsigned char* row0{ src + (2 * y) * srcStride };
+                const unsigned char* row1{ row0 + srcStride };
+                for (std::size_t i{}; i < rowSums.size(); ++i)
+                    rowSums[i] = row0[i] + row1[i];
+
+                unsigned char* dstRow{ dst + y * dstStride };
+                for (int x{}; x < dstWidth; ++x)
+                {
+                    for (int c{}; c < channelCount; ++c)
+                        dstRow[x * channelCount + c] = static_cast<unsigned char>((rowSums[2 * x * channelCount + c] + rowSums[(2 * x + 1) * channelCount + c] + 2) >> 2);
+                }
+            }
+        }
+
+#if LMS_SUPPORT_TURBOJPEG
+        tjhandle getDecompressor()
+        {
+            // decompressors are not thread safe, but can be reused
+            thread_local const std::unique_ptr<void, decltype(&::tjDestroy)> decompressor{ ::tjInitDecompress(), ::tjDestroy };
+            return decompressor.get();
+        }
+
+        std::vector<std::byte> readFile(const std::filesystem::path& p)
+        {
+            std::ifstream ifs{ p, std::ios_base::binary };
+            if (!ifs)
+                throw ImageException{ "Cannot open file '" + p.string() + "'" };
+
+            std::vector<std::byte> data;
+            ifs.seekg(0, std::ios::end);
+            data.resize(static_cast<std::size_t>(ifs.tellg()));
+            ifs.seekg(0, std::ios::beg);
+            if (!ifs.read(reinterpret_cast<char*>(data.data()), data.size()))
+                throw ImageException{ "Cannot read file '" + p.string() + "'" };
+
+            return data;
+        }
+#endif
+    }
+}
+
+namespace Image::STB
+{
+    RawImage::RawImage(const std::byte* encodedData, std::size_t encodedDataSize, std::optional<ImageSize> targetWidth)
+    {
+        if (targetWidth && tryDecodeScaledJPEG(encodedData, encodedDataSize, *targetWidth))
+            return;
+
         int n;
         _data = UniquePtrFree{ ::stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(encodedData), encodedDataSize, &_width, &_height, &n, 3), std::free };
         if (!_data)
             throw ImageException{ "Cannot load image from memory: " + std::string{ ::stbi_failure_reason() } };
     }
 
-    RawImage::RawImage(const std::filesystem::path& p)
+    RawImage::RawImage(const std::filesystem::path& p, std::optional<ImageSize> targetWidth)
     {
+#if LMS_SUPPORT_TURBOJPEG
+        if (targetWidth)
+        {
+            const std::vector<std::byte> encodedData{ readFile(p) };
+            if (tryDecodeScaledJPEG(encodedData.data(), encodedData.size(), *targetWidth))
+                return;
+        }
+#else
+        (void)targetWidth;
+#endif
+
         int n;
         _data = UniquePtrFree{ stbi_load(p.string().c_str(), &_width, &_height, &n, 3), std::free };
         if (!_data)
             throw ImageException{ "Cannot load image from file: " + std::string{ ::stbi_failure_reason() } };
     }
 
+    bool RawImage::tryDecodeScaledJPEG(const std::byte* encodedData, std::size_t encodedDataSize, ImageSize targetWidth)
+    {
+#if LMS_SUPPORT_TURBOJPEG
+        tjhandle decompressor{ getDecompressor() };
+        if (!decompressor)
+            return false;
+
+        const unsigned char* jpegData{ reinterpret_cast<const unsigned char*>(encodedData) };
+        int width;
+        int height;
+        int subsampling;
+        int colorspace;
+        if (::tjDecompressHeader3(decompressor, jpegData, encodedDataSize, &width, &height, &subsampling, &colorspace) != 0)
+            return false; // not a JPEG image, or not supported
+
+        // Pick the smallest scaling factor that keeps the image at least as large as the target
+        const int maxDimension{ std::max(width, height) };
+        int scalingFactorCount{};
+        const tjscalingfactor* scalingFactors{ ::tjGetScalingFactors(&scalingFactorCount) };
+        tjscalingfactor bestScalingFactor{ 1, 1 };
+        for (int i{}; i < scalingFactorCount; ++i)
+        {
+            const tjscalingfactor& scalingFactor{ scalingFactors[i] };
+            if (scalingFactor.num > scalingFactor.denom)
+                continue;
+            if (TJSCALED(maxDimension, scalingFactor) < static_cast<int>(targetWidth))
+                continue;
+            if (scalingFactor.num * bestScalingFactor.denom < bestScalingFactor.num * scalingFactor.denom)
+                bestScalingFactor = scalingFactor;
+        }
+
+        const int scaledWidth{ TJSCALED(width, bestScalingFactor) };
+        const int scaledHeight{ TJSCALED(height, bestScalingFactor) };
+
+        UniquePtrFree data{ reinterpret_cast<unsigned char*>(malloc(static_cast<std::size_t>(scaledWidth) * scaledHeight * channelCount)), std::free };
+        if (!data)
+            throw ImageException{ "Cannot allocate memory for decoded image!" };
+
+        if (::tjDecompress2(decompressor, jpegData, encodedDataSize, data.get(), scaledWidth, 0, scaledHeight, TJPF_RGB, TJFLAG_FASTDCT) != 0)
+            return false; // let stb have a try, it may be more tolerant
+
+        _data = std::move(data);
+        _width = scaledWidth;
+        _height = scaledHeight;
+        return true;
+#else
+        (void)encodedData;
+        (void)encodedDataSize;
+        (void)targetWidth;
+        return false;
+#endif
+    }
+
     void RawImage::resize(ImageSize width)
     {
         size_t height;
@@ -86,6 +259,23 @@ namespace Image::STB
             width = (size_t)((float)height / _height * _width);
         }
 
+        if (static_cast<int>(width) == _width && static_cast<int>(height) == _height)
+            return;
+
+        // Covers are mostly downscaled by large factors: cheaply reduce the image while it is still
+        // at least twice the requested size, so that the filtered resize only processes a few times the output pixels
+        while (_width / 2 >= static_cast<int>(width * 2) && _height / 2 >= static_cast<int>(height * 2))
+        {
+            UniquePtrFree halvedData{ reinterpret_cast<unsigned char*>(malloc(static_cast<std::size_t>(_width / 2) * (_height / 2) * channelCount)), std::free };
+            if (!halvedData)
+                throw ImageException{ "Cannot allocate memory for resized image!" };
+
+            halveImage(_data.get(), _width, _height, halvedData.get());
+            _data = std::move(halvedData);
+            _width /= 2;
+            _height /= 2;
+        }
+
         UniquePtrFree resizedData{ reinterpret_cast<unsigned char*>(malloc(width * height * 3)), std::free };
         if (!resizedData)
             throw ImageException{ "Cannot allocate memory for resized image!" };
@@ -102,9 +292,21 @@ namespace Image::STB
         _width = width;
     }
 
-    std::unique_ptr<IEncodedImage> RawImage::encodeToJPEG(unsigned quality) const
+    std::unique_ptr<IEncodedImage> RawImage::encodeTo(ImageFormat format, unsigned quality) const
     {
-        return std::make_unique<JPEGImage>(*this, quality);
+        switch (format)
+        {
+        case ImageFormat::JPEG:
+            return std::make_unique<JPEGImage>(*this, quality);
+        case ImageFormat::WebP:
+#if LMS_SUPPORT_WEBP
+            return std::make_unique<WebPImage>(*this, quality);
+#else
+            break;
+#endif
+        }
+
+        throw ImageException{ "Unsupported output image format" };
     }
 
     ImageSize RawImage::getWidth() const
@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "WebPImage.hpp"
+
+#include <webp/encode.h>
+
+#include "image/Exception.hpp"
+#include "RawImage.hpp"
+
+namespace Image::STB
+{
+    WebPImage::WebPImage(const RawImage& rawImage, unsigned quality)
+    {
+        std::uint8_t* output{};
+        const std::size_t outputSize{ ::WebPEncodeRGB(reinterpret_cast<const std::uint8_t*>(rawImage.getData()), rawImage.getWidth(), rawImage.getHeight(), rawImage.getWidth() * 3, static_cast<float>(quality), &output) };
+        if (outputSize == 0)
+            throw ImageException{ "Failed to export in webp format!" };
+
+        _data.assign(reinterpret_cast<const std::byte*>(output), reinterpret_cast<const std::byte*>(output) + outputSize);
+        ::WebPFree(output);
+    }
+
+    const std::byte* WebPImage::getData() const
+    {
+        if (_data.empty())
+            return nullptr;
+
+        return _data.data();
+    }
+
+    std::size_t WebPImage::getDataSize() const
+    {
+        return _data.size();
+    }
+}
@@ -26,6 +26,12 @@ namespace Image
 {
 	using ImageSize = std::size_t;
 
+	enum class ImageFormat
+	{
+		JPEG,
+		WebP,
+	};
+
 	class IEncodedImage
 	{
 		public:
@@ -21,6 +21,7 @@
 
 #include <filesystem>
 #include <memory>
+#include <string_view>
 
 #include "image/IEncodedImage.hpp"
 
@@ -31,11 +32,19 @@ namespace Image
 		public:
 			virtual ~IRawImage() = default;
 			virtual void resize(ImageSize width) = 0;
-			virtual std::unique_ptr<IEncodedImage> encodeToJPEG(unsigned quality) const = 0;
+			// throws ImageException if the format is not supported
+			virtual std::unique_ptr<IEncodedImage> encodeTo(ImageFormat format, unsigned quality) const = 0;
 	};
 
 	void init(const std::filesystem::path& path);
+	std::string_view getBackendName(); // image library the project is built with
+	bool isEncodingSupported(ImageFormat format);
 	std::unique_ptr<IRawImage> decodeImage(const std::byte* encodedData, std::size_t encodedDataSize);
 	std::unique_ptr<IRawImage> decodeImage(const std::filesystem::path& path);
+
+	// Same as above, but the decoder is allowed to directly produce a downscaled image (ex: JPEG DCT scaling) that is still
+	// at least targetWidth in its largest dimension. Faster when the image is to be resized to targetWidth afterwards
+	std::unique_ptr<IRawImage> decodeImage(const std::byte* encodedData, std::size_t encodedDataSize, ImageSize targetWidth);
+	std::unique_ptr<IRawImage> decodeImage(const std::filesystem::path& path, ImageSize targetWidth);
 }
 
@@ -147,10 +147,11 @@ namespace MetaData
             const auto audioFile{ Av::parseAudioFile(p) };
 
             _containerInfo = audioFile->getContainerInfo();
+            _streamInfo = audioFile->getBestStreamInfo();
             _metaDataMap = audioFile->getMetaData();
             _hasEmbeddedCover = audioFile->hasAttachedPictures();
 
-            if (debug && Service<ILogger>::get()->isSeverityActive(Severity::DEBUG))
+            if (debug && Service<ILogger>::get()->isSeverityActive(Module::METADATA, Severity::DEBUG))
             {
                 for (const auto& [key, value] : _metaDataMap)
                     LMS_LOG(METADATA, DEBUG, "Key = '" << key << "', value = '" << value << "'");
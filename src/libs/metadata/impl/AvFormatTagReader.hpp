@@ -41,14 +41,21 @@ namespace MetaData
         void visitTagValues(std::string_view tag, TagValueVisitor visitor) const override;
         void visitPerformerTags(PerformerVisitor visitor) const override;
         bool hasEmbeddedCover() const override { return _hasEmbeddedCover; }
+        void visitEmbeddedCovers(EmbeddedCoverVisitor) const override {} // not supported, the file is not kept open
 
         std::chrono::milliseconds 	getDuration() const override { return _containerInfo.duration; }
         std::size_t                 getBitrate() const override { return _containerInfo.bitrate; }
         std::size_t                 getBitsPerSample() const override { return 0; }
-        std::size_t                 getSampleRate() const override { return 0; }
+        std::size_t                 getSampleRate() const override { return _streamInfo ? _streamInfo->sampleRate : 0; }
+        std::size_t                 getChannelCount() const override { return _streamInfo ? _streamInfo->channelCount : 0; }
+        std::string_view            getCodecName() const override { return _streamInfo ? std::string_view{ _streamInfo->codecName } : std::string_view{}; }
+        std::string_view            getContainerName() const override { return _containerInfo.name; }
+        std::optional<std::size_t>  getAudioStreamIndex() const override { return _streamInfo ? std::optional<std::size_t>{ _streamInfo->index } : std::nullopt; }
+        bool                        isDurationEstimated() const override { return false; } // not reported by libavformat
 
         Av::IAudioFile::MetadataMap _metaDataMap;
         Av::ContainerInfo _containerInfo;
+        std::optional<Av::StreamInfo> _streamInfo; // best audio stream
         bool _hasEmbeddedCover{};
     };
 } // namespace MetaData
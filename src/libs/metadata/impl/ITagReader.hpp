@@ -20,7 +20,11 @@
 #pragma once
 
 #include <chrono>
+#include <cstddef>
 #include <functional>
+#include <optional>
+#include <span>
+#include <string_view>
 
 namespace MetaData
 {
@@ -155,10 +159,18 @@ namespace MetaData
         virtual void visitPerformerTags(PerformerVisitor visitor) const = 0;
 
         virtual bool hasEmbeddedCover() const = 0;
+        using EmbeddedCoverVisitor = std::function<void(std::span<const std::byte> data)>;
+        virtual void visitEmbeddedCovers(EmbeddedCoverVisitor visitor) const = 0;
 
         virtual std::chrono::milliseconds 	getDuration() const = 0;
         virtual std::size_t                 getBitrate() const = 0;
         virtual std::size_t                 getBitsPerSample() const = 0;
         virtual std::size_t                 getSampleRate() const = 0;
+        virtual std::size_t                 getChannelCount() const = 0;
+        // Names used by libavcodec and libavformat, so that the transcoder does not have to probe the file again, empty if unknown
+        virtual std::string_view            getCodecName() const = 0;
+        virtual std::string_view            getContainerName() const = 0;
+        virtual std::optional<std::size_t>  getAudioStreamIndex() const = 0;
+        virtual bool                        isDurationEstimated() const = 0; // duration and bitrate computed using the first audio frame only
     };
 } // namespace MetaData
@@ -0,0 +1,1390 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "LightweightTagReader.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <string_view>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "metadata/Exception.hpp"
+#include "utils/ILogger.hpp"
+#include "utils/String.hpp"
+#include "Utils.hpp"
+
+namespace MetaData
+{
+    namespace
+    {
+        class ParsingFailedException : public Exception {};
+
+        // A read smaller than this is still done using this size, as the next read is likely to be close
+        constexpr std::size_t minReadSize{ 64 * 1024 };
+        // Guard against corrupted files announcing huge Ogg comment packets
+        constexpr std::size_t maxOggPacketSize{ 64 * 1024 * 1024 };
+
+        // Shared by all the readers of a thread, only the last reader that used it can rely on its content
+        thread_local std::vector<std::byte> readBuffer;
+        thread_local const void* readBufferOwner{};
+
+        // Same order as the ID3v1 genre list
+        constexpr std::array<std::string_view, 192> id3v1Genres
+        {
+            "Blues", "Classic Rock", "Country", "Dance", "Disco", "Funk", "Grunge", "Hip-Hop", "Jazz", "Metal",
+            "New Age", "Oldies", "Other", "Pop", "R&B", "Rap", "Reggae", "Rock", "Techno", "Industrial",
+            "Alternative", "Ska", "Death Metal", "Pranks", "Soundtrack", "Euro-Techno", "Ambient", "Trip-Hop", "Vocal", "Jazz+Funk",
+            "Fusion", "Trance", "Classical", "Instrumental", "Acid", "House", "Game", "Sound Clip", "Gospel", "Noise",
+            "Alternative Rock", "Bass", "Soul", "Punk", "Space", "Meditative", "Instrumental Pop", "Instrumental Rock", "Ethnic", "Gothic",
+            "Darkwave", "Techno-Industrial", "Electronic", "Pop-Folk", "Eurodance", "Dream", "Southern Rock", "Comedy", "Cult", "Gangsta",
+            "Top 40", "Christian Rap", "Pop/Funk", "Jungle", "Native American", "Cabaret", "New Wave", "Psychedelic", "Rave", "Showtunes",
+            "Trailer", "Lo-Fi", "Tribal", "Acid Punk", "Acid Jazz", "Polka", "Retro", "Musical", "Rock & Roll", "Hard Rock",
+            "Folk", "Folk Rock", "National Folk", "Swing", "Fast Fusion", "Bebop", "Latin", "Revival", "Celtic", "Bluegrass",
+            "Avant-garde", "Gothic Rock", "Progressive Rock", "Psychedelic Rock", "Symphonic Rock", "Slow Rock", "Big Band", "Chorus", "Easy Listening", "Acoustic",
+            "Humour", "Speech", "Chanson", "Opera", "Chamber Music", "Sonata", "Symphony", "Booty Bass", "Primus", "Porn Groove",
+            "Satire", "Slow Jam", "Club", "Tango", "Samba", "Folklore", "Ballad", "Power Ballad", "Rhythmic Soul", "Freestyle",
+            "Duet", "Punk Rock", "Drum Solo", "A Cappella", "Euro-House", "Dancehall", "Goa", "Drum & Bass", "Club-House", "Hardcore Techno",
+            "Terror", "Indie", "Britpop", "Worldbeat", "Polsk Punk", "Beat", "Christian Gangsta Rap", "Heavy Metal", "Black Metal", "Crossover",
+            "Contemporary Christian", "Christian Rock", "Merengue", "Salsa", "Thrash Metal", "Anime", "Jpop", "Synthpop", "Abstract", "Art Rock",
+            "Baroque", "Bhangra", "Big Beat", "Breakbeat", "Chillout", "Downtempo", "Dub", "EBM", "Eclectic", "Electro",
+            "Electroclash", "Emo", "Experimental", "Garage", "Global", "IDM", "Illbient", "Industro-Goth", "Jam Band", "Krautrock",
+            "Leftfield", "Lounge", "Math Rock", "New Romantic", "Nu-Breakz", "Post-Punk", "Post-Rock", "Psytrance", "Shoegaze", "Space Rock",
+            "Trop Rock", "World Music", "Neoclassical", "Audiobook", "Audio Theatre", "Neue Deutsche Welle", "Podcast", "Indie Rock", "G-Funk", "Dubstep",
+            "Garage Rock", "Psybient",
+        };
+
+        // ID3v2 frames to property names, as done by TagLib
+        const std::unordered_map<std::string_view, std::string_view> id3v2FrameMapping
+        {
+            { "TALB", "ALBUM" },
+            { "TBPM", "BPM" },
+            { "TCMP", "COMPILATION" },
+            { "TCOM", "COMPOSER" },
+            { "TCON", "GENRE" },
+            { "TCOP", "COPYRIGHT" },
+            { "TDEN", "ENCODINGTIME" },
+            { "TDLY", "PLAYLISTDELAY" },
+            { "TDOR", "ORIGINALDATE" },
+            { "TDRC", "DATE" },
+            { "TDRL", "RELEASEDATE" },
+            { "TDTG", "TAGGINGDATE" },
+            { "TENC", "ENCODEDBY" },
+            { "TEXT", "LYRICIST" },
+            { "TFLT", "FILETYPE" },
+            { "TIT1", "WORK" },
+            { "TIT2", "TITLE" },
+            { "TIT3", "SUBTITLE" },
+            { "TKEY", "INITIALKEY" },
+            { "TLAN", "LANGUAGE" },
+            { "TLEN", "LENGTH" },
+            { "TMED", "MEDIA" },
+            { "TMOO", "MOOD" },
+            { "TOAL", "ORIGINALALBUM" },
+            { "TOFN", "ORIGINALFILENAME" },
+            { "TOLY", "ORIGINALLYRICIST" },
+            { "TOPE", "ORIGINALARTIST" },
+            { "TOWN", "OWNER" },
+            { "TPE1", "ARTIST" },
+            { "TPE2", "ALBUMARTIST" },
+            { "TPE3", "CONDUCTOR" },
+            { "TPE4", "REMIXER" },
+            { "TPOS", "DISCNUMBER" },
+            { "TPRO", "PRODUCEDNOTICE" },
+            { "TPUB", "LABEL" },
+            { "TRCK", "TRACKNUMBER" },
+            { "TRSN", "RADIOSTATION" },
+            { "TRSO", "RADIOSTATIONOWNER" },
+            { "TSO2", "ALBUMARTISTSORT" },
+            { "TSOA", "ALBUMSORT" },
+            { "TSOC", "COMPOSERSORT" },
+            { "TSOP", "ARTISTSORT" },
+            { "TSOT", "TITLESORT" },
+            { "TSRC", "ISRC" },
+            { "TSSE", "ENCODING" },
+            { "TSST", "DISCSUBTITLE" },
+            { "GRP1", "GROUPING" },
+            { "MVIN", "MOVEMENTNUMBER" },
+            { "MVNM", "MOVEMENTNAME" },
+            { "WCOP", "COPYRIGHTURL" },
+            { "WFED", "PODCASTURL" },
+            { "WOAF", "FILEWEBPAGE" },
+            { "WOAR", "ARTISTWEBPAGE" },
+            { "WOAS", "AUDIOSOURCEWEBPAGE" },
+            { "WORS", "RADIOSTATIONWEBPAGE" },
+            { "WPAY", "PAYMENTWEBPAGE" },
+            { "WPUB", "PUBLISHERWEBPAGE" },
+        };
+
+        // ID3v2 TXXX descriptions to property names, as done by TagLib
+        const std::unordered_map<std::string_view, std::string_view> id3v2TxxxMapping
+        {
+            { "MUSICBRAINZ ALBUM ID", "MUSICBRAINZ_ALBUMID" },
+            { "MUSICBRAINZ ARTIST ID", "MUSICBRAINZ_ARTISTID" },
+            { "MUSICBRAINZ ALBUM ARTIST ID", "MUSICBRAINZ_ALBUMARTISTID" },
+            { "MUSICBRAINZ ALBUM RELEASE COUNTRY", "RELEASECOUNTRY" },
+            { "MUSICBRAINZ ALBUM STATUS", "RELEASESTATUS" },
+            { "MUSICBRAINZ ALBUM TYPE", "RELEASETYPE" },
+            { "MUSICBRAINZ RELEASE GROUP ID", "MUSICBRAINZ_RELEASEGROUPID" },
+            { "MUSICBRAINZ RELEASE TRACK ID", "MUSICBRAINZ_RELEASETRACKID" },
+            { "MUSICBRAINZ WORK ID", "MUSICBRAINZ_WORKID" },
+            { "ACOUSTID ID", "ACOUSTID_ID" },
+            { "ACOUSTID FINGERPRINT", "ACOUSTID_FINGERPRINT" },
+            { "MUSICIP PUID", "MUSICIP_PUID" },
+        };
+
+        // ID3v2 TIPL roles to property names, as done by TagLib
+        const std::unordered_map<std::string_view, std::string_view> id3v2InvolvedPeopleMapping
+        {
+            { "ARRANGER", "ARRANGER" },
+            { "ENGINEER", "ENGINEER" },
+            { "PRODUCER", "PRODUCER" },
+            { "DJ-MIX", "DJMIXER" },
+            { "MIX", "MIXER" },
+        };
+
+        enum class Id3v2Encoding
+        {
+            Latin1 = 0,
+            UTF16 = 1,
+            UTF16BE = 2,
+            UTF8 = 3,
+        };
+
+        std::uint8_t toUInt8(std::byte b)
+        {
+            return std::to_integer<std::uint8_t>(b);
+        }
+
+        std::span<const std::byte> subSpan(std::span<const std::byte> data, std::size_t offset, std::size_t size)
+        {
+            if (offset > data.size() || size > data.size() - offset)
+                throw ParsingFailedException{};
+
+            return data.subspan(offset, size);
+        }
+
+        std::uint32_t readBE(std::span<const std::byte> data, std::size_t offset, std::size_t size)
+        {
+            std::uint32_t res{};
+            for (std::byte b : subSpan(data, offset, size))
+                res = (res << 8) | toUInt8(b);
+
+            return res;
+        }
+
+        std::uint64_t readLE(std::span<const std::byte> data, std::size_t offset, std::size_t size)
+        {
+            std::uint64_t res{};
+            const auto bytes{ subSpan(data, offset, size) };
+            for (std::size_t i{ size }; i-- > 0;)
+                res = (res << 8) | toUInt8(bytes[i]);
+
+            return res;
+        }
+
+        std::uint32_t readSyncSafe32(std::span<const std::byte> data, std::size_t offset)
+        {
+            std::uint32_t res{};
+            for (std::byte b : subSpan(data, offset, 4))
+                res = (res << 7) | (toUInt8(b) & 0x7F);
+
+            return res;
+        }
+
+        std::string_view toStringView(std::span<const std::byte> data)
+        {
+            return { reinterpret_cast<const char*>(data.data()), data.size() };
+        }
+
+        bool startsWith(std::span<const std::byte> data, std::string_view prefix)
+        {
+            return data.size() >= prefix.size() && toStringView(data.first(prefix.size())) == prefix;
+        }
+
+        std::size_t readAll(int fd, std::span<std::byte> data, std::uint64_t offset)
+        {
+            std::size_t readSize{};
+            while (readSize < data.size())
+            {
+                const ssize_t res{ ::pread(fd, data.data() + readSize, data.size() - readSize, static_cast<off_t>(offset + readSize)) };
+                if (res < 0)
+                {
+                    if (errno == EINTR)
+                        continue;
+
+                    throw ParsingFailedException{};
+                }
+                if (res == 0)
+                    break;
+
+                readSize += static_cast<std::size_t>(res);
+            }
+
+            return readSize;
+        }
+
+        void appendUTF8(std::string& str, char32_t c)
+        {
+            if (c < 0x80)
+                str.push_back(static_cast<char>(c));
+            else if (c < 0x800)
+            {
+                str.push_back(static_cast<char>(0xC0 | (c >> 6)));
+                str.push_back(static_cast<char>(0x80 | (c & 0x3F)));
+            }
+            else if (c < 0x10000)
+            {
+                str.push_back(static_cast<char>(0xE0 | (c >> 12)));
+                str.push_back(static_cast<char>(0x80 | ((c >> 6) & 0x3F)));
+                str.push_back(static_cast<char>(0x80 | (c & 0x3F)));
+            }
+            else
+            {
+                str.push_back(static_cast<char>(0xF0 | (c >> 18)));
+                str.push_back(static_cast<char>(0x80 | ((c >> 12) & 0x3F)));
+                str.push_back(static_cast<char>(0x80 | ((c >> 6) & 0x3F)));
+                str.push_back(static_cast<char>(0x80 | (c & 0x3F)));
+            }
+        }
+
+        std::string latin1ToUTF8(std::span<const std::byte> data)
+        {
+            std::string res;
+            res.reserve(data.size());
+            for (std::byte b : data)
+                appendUTF8(res, toUInt8(b));
+
+            return res;
+        }
+
+        std::string utf16ToUTF8(std::span<const std::byte> data, bool bigEndian)
+        {
+            auto readUnit{ [&](std::size_t index) -> char32_t
+                {
+                    const std::uint8_t first{ toUInt8(data[index]) };
+                    const std::uint8_t second{ toUInt8(data[index + 1]) };
+                    return bigEndian ? ((first << 8) | second) : ((second << 8) | first);
+                } };
+
+            std::string res;
+            res.reserve(data.size());
+            for (std::size_t i{}; i + 1 < data.size(); i += 2)
+            {
+                char32_t c{ readUnit(i) };
+                if (c >= 0xD800 && c <= 0xDBFF)
+                {
+                    const char32_t low{ i + 3 < data.size() ? readUnit(i + 2) : 0 };
+                    if (low >= 0xDC00 && low <= 0xDFFF)
+                    {
+                        c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+                        i += 2;
+                    }
+                    else
+                        c = 0xFFFD;
+                }
+                else if (c >= 0xDC00 && c <= 0xDFFF)
+                    c = 0xFFFD;
+
+                appendUTF8(res, c);
+            }
+
+            return res;
+        }
+
+        std::string decodeId3v2String(std::span<const std::byte> data, Id3v2Encoding encoding)
+        {
+            switch (encoding)
+            {
+            case Id3v2Encoding::Latin1:
+                return latin1ToUTF8(data);
+
+            case Id3v2Encoding::UTF16:
+                if (startsWith(data, "\xFE\xFF"))
+                    return utf16ToUTF8(data.subspan(2), true);
+                if (startsWith(data, "\xFF\xFE"))
+                    return utf16ToUTF8(data.subspan(2), false);
+                return utf16ToUTF8(data, false);
+
+            case Id3v2Encoding::UTF16BE:
+                return utf16ToUTF8(data, true);
+
+            case Id3v2Encoding::UTF8:
+                return std::string{ toStringView(data) };
+            }
+
+            throw ParsingFailedException{};
+        }
+
+        Id3v2Encoding readId3v2Encoding(std::span<const std::byte> data)
+        {
+            const std::uint8_t encoding{ toUInt8(subSpan(data, 0, 1)[0]) };
+            if (encoding > static_cast<std::uint8_t>(Id3v2Encoding::UTF8))
+                throw ParsingFailedException{};
+
+            return static_cast<Id3v2Encoding>(encoding);
+        }
+
+        // Returns the string and the remaining data after its terminator
+        std::pair<std::string, std::span<const std::byte>> readId3v2String(std::span<const std::byte> data, Id3v2Encoding encoding)
+        {
+            const bool wide{ encoding == Id3v2Encoding::UTF16 || encoding == Id3v2Encoding::UTF16BE };
+            const std::size_t charSize{ wide ? std::size_t{ 2 } : std::size_t{ 1 } };
+
+            std::size_t end{};
+            while (end + charSize <= data.size())
+            {
+                if (data[end] == std::byte{ 0 } && (!wide || data[end + 1] == std::byte{ 0 }))
+                    return { decodeId3v2String(data.first(end), encoding), data.subspan(end + charSize) };
+
+                end += charSize;
+            }
+
+            return { decodeId3v2String(data, encoding), {} };
+        }
+
+        // Empty strings are skipped
+        std::vector<std::string> readId3v2Strings(std::span<const std::byte> data, Id3v2Encoding encoding)
+        {
+            std::vector<std::string> res;
+            while (!data.empty())
+            {
+                auto [str, remainingData] { readId3v2String(data, encoding) };
+                if (!str.empty())
+                    res.push_back(std::move(str));
+                data = remainingData;
+            }
+
+            return res;
+        }
+
+        void removeUnsynchronisation(std::vector<std::byte>& data)
+        {
+            auto itOut{ std::begin(data) };
+            for (auto it{ std::cbegin(data) }; it != std::cend(data); ++it)
+            {
+                *itOut++ = *it;
+                if (*it == std::byte{ 0xFF } && std::next(it) != std::cend(data) && *std::next(it) == std::byte{ 0x00 })
+                    ++it;
+            }
+            data.erase(itOut, std::end(data));
+        }
+
+        std::optional<std::size_t> parseNumber(std::string_view str)
+        {
+            std::size_t res{};
+            const auto [ptr, ec] { std::from_chars(str.data(), str.data() + str.size(), res) };
+            if (str.empty() || ec != std::errc{} || ptr != str.data() + str.size())
+                return std::nullopt;
+
+            return res;
+        }
+
+        // Handles the ID3v1 genre references, like "(17)", "17" or "(4)Eurodisco"
+        void addId3v2Genres(std::string_view value, std::vector<std::string>& genres)
+        {
+            auto addGenre{ [&](std::string_view genre)
+                {
+                    if (genre == "RX")
+                        genres.emplace_back("Remix");
+                    else if (genre == "CR")
+                        genres.emplace_back("Cover");
+                    else if (const std::optional<std::size_t> index{ parseNumber(genre) })
+                    {
+                        if (*index < id3v1Genres.size())
+                            genres.emplace_back(id3v1Genres[*index]);
+                    }
+                    else if (!genre.empty())
+                        genres.emplace_back(genre);
+                } };
+
+            while (value.size() > 1 && value.front() == '(' && value[1] != '(')
+            {
+                const std::size_t end{ value.find(')') };
+                if (end == std::string_view::npos)
+                    break;
+
+                addGenre(value.substr(1, end - 1));
+                value.remove_prefix(end + 1);
+            }
+
+            if (!value.empty())
+            {
+                if (value.starts_with("(("))
+                    value.remove_prefix(1);
+
+                if (parseNumber(value))
+                    addGenre(value);
+                else
+                    genres.emplace_back(value);
+            }
+        }
+
+        std::vector<std::byte> decodeBase64(std::string_view input)
+        {
+            auto decodeChar{ [](char c) -> int
+                {
+                    if (c >= 'A' && c <= 'Z')
+                        return c - 'A';
+                    if (c >= 'a' && c <= 'z')
+                        return c - 'a' + 26;
+                    if (c >= '0' && c <= '9')
+                        return c - '0' + 52;
+                    if (c == '+')
+                        return 62;
+                    if (c == '/')
+                        return 63;
+                    return -1;
+                } };
+
+            std::vector<std::byte> res;
+            res.reserve(input.size() * 3 / 4);
+
+            std::uint32_t accumulator{};
+            int bitCount{};
+            for (char c : input)
+            {
+                if (c == '=')
+                    break;
+
+                const int value{ decodeChar(c) };
+                if (value < 0)
+                    throw ParsingFailedException{};
+
+                accumulator = (accumulator << 6) | static_cast<std::uint32_t>(value);
+                bitCount += 6;
+                if (bitCount >= 8)
+                {
+                    bitCount -= 8;
+                    res.push_back(static_cast<std::byte>((accumulator >> bitCount) & 0xFF));
+                }
+            }
+
+            return res;
+        }
+
+        // data is a FLAC METADATA_BLOCK_PICTURE
+        std::span<const std::byte> getFlacPictureData(std::span<const std::byte> data)
+        {
+            std::size_t offset{ 4 }; // picture type
+            offset += 4 + readBE(data, offset, 4); // mime type
+            offset += 4 + readBE(data, offset, 4); // description
+            offset += 16; // width, height, color depth, color count
+
+            const std::size_t size{ readBE(data, offset, 4) };
+            return subSpan(data, offset + 4, size);
+        }
+
+        // data is an ID3v2 APIC frame
+        std::span<const std::byte> getApicPictureData(std::span<const std::byte> data)
+        {
+            const Id3v2Encoding encoding{ readId3v2Encoding(data) };
+            auto [mimeType, remainingData] { readId3v2String(data.subspan(1), Id3v2Encoding::Latin1) };
+            remainingData = subSpan(remainingData, 1, remainingData.size() - 1); // picture type
+            auto [description, pictureData] { readId3v2String(remainingData, encoding) };
+
+            return pictureData;
+        }
+
+        struct MpegFrameHeader
+        {
+            unsigned version{}; // 1, 2 or 25 for 2.5
+            unsigned layer{};
+            std::size_t bitrate{}; // kbps
+            std::size_t sampleRate{};
+            bool mono{};
+            std::size_t samplesPerFrame{};
+            std::size_t frameLength{};
+        };
+
+        std::optional<MpegFrameHeader> parseMpegFrameHeader(std::span<const std::byte> data)
+        {
+            static constexpr std::size_t bitrates[2][3][16]
+            {
+                {
+                    { 0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448, 0 },
+                    { 0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 0 },
+                    { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0 },
+                },
+                {
+                    { 0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256, 0 },
+                    { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0 },
+                    { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0 },
+                },
+            };
+            static constexpr std::size_t sampleRates[3][3]
+            {
+                { 44100, 48000, 32000 },
+                { 22050, 24000, 16000 },
+                { 11025, 12000, 8000 },
+            };
+
+            if (data.size() < 4 || toUInt8(data[0]) != 0xFF || (toUInt8(data[1]) & 0xE0) != 0xE0)
+                return std::nullopt;
+
+            const unsigned versionBits{ (toUInt8(data[1]) >> 3) & 0x03u };
+            const unsigned layerBits{ (toUInt8(data[1]) >> 1) & 0x03u };
+            const unsigned bitrateIndex{ static_cast<unsigned>(toUInt8(data[2]) >> 4) };
+            const unsigned sampleRateIndex{ (toUInt8(data[2]) >> 2) & 0x03u };
+            const bool padding{ ((toUInt8(data[2]) >> 1) & 0x01u) != 0 };
+            if (versionBits == 1 || layerBits == 0 || sampleRateIndex == 3)
+                return std::nullopt;
+
+            MpegFrameHeader header;
+            header.version = versionBits == 3 ? 1 : (versionBits == 2 ? 2 : 25);
+            header.layer = 4 - layerBits;
+
+            const std::size_t versionIndex{ header.version == 1 ? std::size_t{ 0 } : std::size_t{ 1 } };
+            header.bitrate = bitrates[versionIndex][header.layer - 1][bitrateIndex];
+            if (header.bitrate == 0) // free format not handled
+                return std::nullopt;
+
+            header.sampleRate = sampleRates[header.version == 1 ? 0 : (header.version == 2 ? 1 : 2)][sampleRateIndex];
+            header.mono = (toUInt8(data[3]) >> 6) == 3;
+
+            if (header.layer == 1)
+            {
+                header.samplesPerFrame = 384;
+                header.frameLength = (12 * header.bitrate * 1000 / header.sampleRate + (padding ? 1 : 0)) * 4;
+            }
+            else
+            {
+                header.samplesPerFrame = (header.layer == 3 && header.version != 1) ? 576 : 1152;
+                header.frameLength = header.samplesPerFrame / 8 * header.bitrate * 1000 / header.sampleRate + (padding ? 1 : 0);
+            }
+
+            return header;
+        }
+
+        // TagLib reports bitrates in kbps
+        std::size_t computeBitrate(std::uint64_t streamLength, double durationMs)
+        {
+            return static_cast<std::size_t>(static_cast<double>(streamLength) * 8.0 / durationMs + 0.5) * 1000;
+        }
+    }
+
+    std::unique_ptr<LightweightTagReader> LightweightTagReader::create(const std::filesystem::path& p, bool debug)
+    {
+        const int fd{ ::open(p.c_str(), O_RDONLY | O_CLOEXEC) };
+        if (fd < 0)
+        {
+            LMS_LOG(METADATA, ERROR, "File '" << p.string() << "': cannot open file: " << ::strerror(errno));
+            throw ParsingFailedException{};
+        }
+
+        struct stat fileStat;
+        if (::fstat(fd, &fileStat) != 0)
+        {
+            LMS_LOG(METADATA, ERROR, "File '" << p.string() << "': cannot stat file: " << ::strerror(errno));
+            ::close(fd);
+            throw ParsingFailedException{};
+        }
+
+        std::unique_ptr<LightweightTagReader> reader{ new LightweightTagReader{ fd, static_cast<std::uint64_t>(fileStat.st_size) } };
+        try
+        {
+            if (!reader->parse())
+                return nullptr;
+        }
+        catch (const ParsingFailedException&)
+        {
+            LMS_LOG(METADATA, DEBUG, "File '" << p.string() << "': unexpected content, cannot use the lightweight parser");
+            return nullptr;
+        }
+
+        if (debug && Service<ILogger>::get()->isSeverityActive(Module::METADATA, Severity::DEBUG))
+        {
+            for (const auto& [key, values] : reader->_tags)
+            {
+                for (const std::string& value : values)
+                    LMS_LOG(METADATA, DEBUG, "Key = '" << key << "', value = '" << value << "'");
+            }
+        }
+
+        return reader;
+    }
+
+    LightweightTagReader::LightweightTagReader(int fd, std::uint64_t fileSize)
+        : _fd{ fd }
+        , _fileSize{ fileSize }
+    {
+    }
+
+    LightweightTagReader::~LightweightTagReader()
+    {
+        if (readBufferOwner == this)
+            readBufferOwner = nullptr;
+
+        ::close(_fd);
+    }
+
+    bool LightweightTagReader::hasMultiValuedTags() const
+    {
+        return std::any_of(std::cbegin(_tags), std::cend(_tags), [](const auto& entry) { return entry.second.size() > 1; });
+    }
+
+    void LightweightTagReader::visitTagValues(TagType tag, TagValueVisitor visitor) const
+    {
+        for (const std::string& tagName : Utils::getTagLibTagNames(tag))
+        {
+            auto itValues{ _tags.find(tagName) };
+            if (itValues == std::cend(_tags))
+                continue;
+
+            for (const std::string& value : itValues->second)
+                visitor(value);
+
+            break;
+        }
+    }
+
+    void LightweightTagReader::visitTagValues(std::string_view tag, TagValueVisitor visitor) const
+    {
+        auto itValues{ _tags.find(StringUtils::stringToUpper(std::string{ tag })) };
+        if (itValues == std::cend(_tags))
+            return;
+
+        for (const std::string& value : itValues->second)
+            visitor(value);
+    }
+
+    void LightweightTagReader::visitPerformerTags(PerformerVisitor visitor) const
+    {
+        visitTagValues("PERFORMER", [&](std::string_view value)
+            {
+                visitor("", value);
+            });
+
+        constexpr std::string_view performerPrefix{ "PERFORMER:" };
+        for (auto it{ _tags.lower_bound(performerPrefix) }; it != std::cend(_tags) && it->first.starts_with(performerPrefix); ++it)
+        {
+            const std::string_view role{ std::string_view{ it->first }.substr(performerPrefix.size()) };
+            for (const std::string& name : it->second)
+                visitor(role, name);
+        }
+    }
+
+    void LightweightTagReader::visitEmbeddedCovers(EmbeddedCoverVisitor visitor) const
+    {
+        // Not using the shared read buffer, as pictures are way larger than the other metadata blocks
+        std::vector<std::byte> buffer;
+
+        for (const Picture& picture : _pictures)
+        {
+            try
+            {
+                if (!picture.base64Content.empty())
+                    buffer = decodeBase64(picture.base64Content);
+                else
+                {
+                    buffer.resize(picture.size);
+                    if (readAll(_fd, buffer, picture.offset) != picture.size)
+                        throw ParsingFailedException{};
+                    if (picture.unsynchronised)
+                        removeUnsynchronisation(buffer);
+                }
+
+                std::span<const std::byte> data;
+                switch (picture.format)
+                {
+                case Picture::Format::FlacPicture:
+                    data = getFlacPictureData(buffer);
+                    break;
+                case Picture::Format::Id3v2Apic:
+                    data = getApicPictureData(buffer);
+                    break;
+                case Picture::Format::Raw:
+                    data = buffer;
+                    break;
+                }
+
+                if (!data.empty())
+                    visitor(data);
+            }
+            catch (const ParsingFailedException&)
+            {
+                LMS_LOG(METADATA, DEBUG, "Skipping malformed embedded picture");
+            }
+        }
+    }
+
+    bool LightweightTagReader::parse()
+    {
+        const auto magic{ read(0, std::min<std::uint64_t>(_fileSize, 4)) };
+        if (startsWith(magic, "fLaC"))
+            return parseFlac();
+        if (startsWith(magic, "OggS"))
+            return parseOgg();
+        if (startsWith(magic, "ID3"))
+            return parseMpeg();
+
+        return false;
+    }
+
+    bool LightweightTagReader::parseFlac()
+    {
+        _codecName = "flac";
+        _containerName = "flac";
+
+        std::uint64_t offset{ 4 };
+        bool lastBlock{};
+        bool hasStreamInfo{};
+        bool hasVorbisComment{};
+        std::uint64_t sampleCount{};
+
+        while (!lastBlock)
+        {
+            const auto blockHeader{ read(offset, 4) };
+            lastBlock = (toUInt8(blockHeader[0]) & 0x80) != 0;
+            const unsigned blockType{ toUInt8(blockHeader[0]) & 0x7Fu };
+            const std::size_t blockSize{ readBE(blockHeader, 1, 3) };
+            offset += 4;
+
+            switch (blockType)
+            {
+            case 0: // STREAMINFO
+            {
+                if (blockSize < 18)
+                    throw ParsingFailedException{};
+
+                const auto streamInfo{ read(offset, 18) };
+                _sampleRate = readBE(streamInfo, 10, 3) >> 4;
+                _bitsPerSample = ((readBE(streamInfo, 12, 2) >> 4) & 0x1F) + 1;
+                _channelCount = ((toUInt8(streamInfo[12]) >> 1) & 0x07) + 1;
+                sampleCount = (static_cast<std::uint64_t>(toUInt8(streamInfo[13]) & 0x0F) << 32) | readBE(streamInfo, 14, 4);
+                hasStreamInfo = true;
+                break;
+            }
+
+            case 4: // VORBIS_COMMENT, only the first one is used
+                if (!hasVorbisComment)
+                {
+                    parseVorbisComment(read(offset, blockSize), false);
+                    hasVorbisComment = true;
+                }
+                break;
+
+            case 6: // PICTURE
+                _pictures.push_back(Picture{ Picture::Format::FlacPicture, offset, blockSize, false, {} });
+                break;
+
+            case 127:
+                throw ParsingFailedException{};
+            }
+
+            offset += blockSize;
+        }
+
+        if (!hasStreamInfo)
+            throw ParsingFailedException{};
+
+        if (_sampleRate > 0 && sampleCount > 0)
+        {
+            const double duration{ static_cast<double>(sampleCount) * 1000.0 / static_cast<double>(_sampleRate) };
+            _duration = std::chrono::milliseconds{ static_cast<long long>(duration + 0.5) };
+            if (offset <= _fileSize)
+                _bitrate = computeBitrate(_fileSize - offset - (hasId3v1Tag() ? 128 : 0), duration);
+        }
+
+        return true;
+    }
+
+    bool LightweightTagReader::parseOgg()
+    {
+        _containerName = "ogg";
+
+        enum class Codec
+        {
+            Unknown,
+            Vorbis,
+            Opus,
+        };
+
+        // Only the content of the identification and comment packets is needed
+        // The size of the Vorbis setup header is computed from the segment tables
+        Codec codec{ Codec::Unknown };
+        std::array<std::vector<std::byte>, 2> packets;
+        std::array<std::uint64_t, 3> packetSizes{};
+        std::size_t packetIndex{};
+        std::size_t neededPacketCount{ 1 };
+        std::uint32_t serialNumber{};
+        std::int64_t firstGranulePosition{};
+        std::uint64_t offset{};
+
+        while (packetIndex < neededPacketCount)
+        {
+            const auto pageHeader{ read(offset, 27) };
+            if (!startsWith(pageHeader, "OggS") || pageHeader[4] != std::byte{ 0 })
+                throw ParsingFailedException{};
+
+            const std::uint32_t pageSerialNumber{ static_cast<std::uint32_t>(readLE(pageHeader, 14, 4)) };
+            if (offset == 0)
+            {
+                serialNumber = pageSerialNumber;
+                firstGranulePosition = static_cast<std::int64_t>(readLE(pageHeader, 6, 8));
+            }
+
+            const std::size_t segmentCount{ toUInt8(pageHeader[26]) };
+            std::array<std::uint8_t, 255> segmentSizes;
+            const auto segmentTable{ read(offset + 27, segmentCount) };
+            std::transform(std::cbegin(segmentTable), std::cend(segmentTable), std::begin(segmentSizes), toUInt8);
+            const std::uint64_t dataOffset{ offset + 27 + segmentCount };
+            std::size_t dataSize{};
+            for (std::size_t i{}; i < segmentCount; ++i)
+                dataSize += segmentSizes[i];
+
+            offset = dataOffset + dataSize;
+            if (pageSerialNumber != serialNumber) // multiplexed stream
+                continue;
+
+            const auto pageData{ read(dataOffset, dataSize) };
+            std::size_t segmentOffset{};
+            for (std::size_t i{}; i < segmentCount && packetIndex < neededPacketCount; ++i)
+            {
+                const std::size_t segmentSize{ segmentSizes[i] };
+                if (packetIndex < packets.size())
+                {
+                    if (packets[packetIndex].size() + segmentSize > maxOggPacketSize)
+                        throw ParsingFailedException{};
+
+                    const auto segmentData{ pageData.subspan(segmentOffset, segmentSize) };
+                    packets[packetIndex].insert(std::cend(packets[packetIndex]), std::cbegin(segmentData), std::cend(segmentData));
+                }
+                packetSizes[packetIndex] += segmentSize;
+                segmentOffset += segmentSize;
+
+                if (segmentSize < 255) // end of packet
+                {
+                    if (packetIndex == 0)
+                    {
+                        if (startsWith(packets[0], "\x01vorbis"))
+                        {
+                            codec = Codec::Vorbis;
+                            neededPacketCount = 3;
+                        }
+                        else if (startsWith(packets[0], "OpusHead"))
+                        {
+                            codec = Codec::Opus;
+                            neededPacketCount = 2;
+                        }
+                        else // FLAC, Speex, ...
+                            return false;
+                    }
+                    packetIndex++;
+                }
+            }
+        }
+
+        const std::optional<std::int64_t> lastGranulePosition{ findLastOggGranulePosition(serialNumber) };
+
+        std::int64_t frameCount{};
+        std::uint64_t headerSize{};
+        std::size_t nominalBitrate{};
+        switch (codec)
+        {
+        case Codec::Vorbis:
+        {
+            if (!startsWith(packets[1], "\x03vorbis"))
+                throw ParsingFailedException{};
+            parseVorbisComment(std::span{ packets[1] }.subspan(7), true);
+
+            _sampleRate = static_cast<std::size_t>(readLE(packets[0], 12, 4));
+            _channelCount = toUInt8(packets[0][11]);
+            _codecName = "vorbis";
+            const std::int32_t bitrate{ static_cast<std::int32_t>(readLE(packets[0], 20, 4)) };
+            if (bitrate > 0)
+                nominalBitrate = static_cast<std::size_t>(bitrate / 1000.0 + 0.5) * 1000;
+
+            if (lastGranulePosition)
+                frameCount = *lastGranulePosition - firstGranulePosition;
+            headerSize = packetSizes[0] + packetSizes[1] + packetSizes[2];
+            break;
+        }
+
+        case Codec::Opus:
+        {
+            if (!startsWith(packets[1], "OpusTags"))
+                throw ParsingFailedException{};
+            parseVorbisComment(std::span{ packets[1] }.subspan(8), true);
+
+            _sampleRate = 48000; // Opus always decodes at 48kHz
+            _channelCount = toUInt8(packets[0][9]);
+            _codecName = "opus";
+            const std::int64_t preSkip{ static_cast<std::int64_t>(readLE(packets[0], 10, 2)) };
+            if (lastGranulePosition)
+                frameCount = *lastGranulePosition - firstGranulePosition - preSkip;
+            headerSize = packetSizes[0] + packetSizes[1];
+            break;
+        }
+
+        case Codec::Unknown:
+            return false;
+        }
+
+        if (_sampleRate > 0 && frameCount > 0)
+        {
+            const double duration{ static_cast<double>(frameCount) * 1000.0 / static_cast<double>(_sampleRate) };
+            _duration = std::chrono::milliseconds{ static_cast<long long>(duration + 0.5) };
+            if (headerSize <= _fileSize)
+                _bitrate = computeBitrate(_fileSize - headerSize, duration);
+        }
+        if (_bitrate == 0)
+            _bitrate = nominalBitrate;
+
+        return true;
+    }
+
+    std::optional<std::int64_t> LightweightTagReader::findLastOggGranulePosition(std::uint32_t serialNumber)
+    {
+        // A page cannot be larger than 65307 bytes
+        const std::size_t tailSize{ static_cast<std::size_t>(std::min<std::uint64_t>(_fileSize, 2 * 65536)) };
+        const auto data{ read(_fileSize - tailSize, tailSize) };
+        if (data.size() < 27)
+            return std::nullopt;
+
+        for (std::size_t offset{ data.size() - 27 + 1 }; offset-- > 0;)
+        {
+            const auto pageHeader{ data.subspan(offset, 27) };
+            if (!startsWith(pageHeader, "OggS") || pageHeader[4] != std::byte{ 0 } || readLE(pageHeader, 14, 4) != serialNumber)
+                continue;
+
+            const std::int64_t granulePosition{ static_cast<std::int64_t>(readLE(pageHeader, 6, 8)) };
+            if (granulePosition >= 0)
+                return granulePosition;
+        }
+
+        return std::nullopt;
+    }
+
+    bool LightweightTagReader::parseMpeg()
+    {
+        const std::optional<std::uint64_t> tagEnd{ parseId3v2Tag() };
+        if (!tagEnd || *tagEnd >= _fileSize)
+            return false;
+
+        // Let TagLib merge the other tags
+        if (_tags.empty() && hasId3v1Tag())
+            return false;
+        if (hasApeTag())
+            return false;
+
+        // Look for the first frame, validated by the header of the following one
+        const auto data{ read(*tagEnd, static_cast<std::size_t>(std::min<std::uint64_t>(_fileSize - *tagEnd, minReadSize))) };
+        if (startsWith(data, "fLaC"))
+            return false;
+
+        std::optional<MpegFrameHeader> firstFrameHeader;
+        std::size_t firstFrameOffset{};
+        for (std::size_t offset{}; offset + 4 <= data.size(); ++offset)
+        {
+            std::optional<MpegFrameHeader> header{ parseMpegFrameHeader(data.subspan(offset, 4)) };
+            if (!header)
+                continue;
+
+            const std::size_t nextFrameOffset{ offset + header->frameLength };
+            if (nextFrameOffset + 4 <= data.size())
+            {
+                const std::optional<MpegFrameHeader> nextHeader{ parseMpegFrameHeader(data.subspan(nextFrameOffset, 4)) };
+                if (!nextHeader || nextHeader->version != header->version || nextHeader->layer != header->layer || nextHeader->sampleRate != header->sampleRate)
+                    continue;
+            }
+
+            firstFrameHeader = header;
+            firstFrameOffset = offset;
+            break;
+        }
+        if (!firstFrameHeader)
+            return false;
+
+        _sampleRate = firstFrameHeader->sampleRate;
+        _channelCount = firstFrameHeader->mono ? 1 : 2;
+        _codecName = firstFrameHeader->layer == 1 ? "mp1" : (firstFrameHeader->layer == 2 ? "mp2" : "mp3");
+        _containerName = "mp3";
+
+        // VBR headers
+        std::uint32_t frameCount{};
+        std::uint32_t streamSize{};
+        const auto frameData{ data.subspan(firstFrameOffset, std::min(firstFrameHeader->frameLength, data.size() - firstFrameOffset)) };
+        const std::size_t xingOffset{ firstFrameHeader->version == 1 ? (firstFrameHeader->mono ? std::size_t{ 21 } : std::size_t{ 36 }) : (firstFrameHeader->mono ? std::size_t{ 13 } : std::size_t{ 21 }) };
+        if (xingOffset < frameData.size() && (startsWith(frameData.subspan(xingOffset), "Xing") || startsWith(frameData.subspan(xingOffset), "Info")))
+        {
+            std::size_t offset{ xingOffset + 4 };
+            const std::uint32_t flags{ readBE(frameData, offset, 4) };
+            offset += 4;
+            if (flags & 0x01)
+            {
+                frameCount = readBE(frameData, offset, 4);
+                offset += 4;
+            }
+            if (flags & 0x02)
+                streamSize = readBE(frameData, offset, 4);
+        }
+        else if (36 < frameData.size() && startsWith(frameData.subspan(36), "VBRI"))
+        {
+            streamSize = readBE(frameData, 36 + 10, 4);
+            frameCount = readBE(frameData, 36 + 14, 4);
+        }
+
+        _mpegStreamOffset = *tagEnd + firstFrameOffset;
+        _mpegStreamEnd = _fileSize - (hasId3v1Tag() ? 128 : 0);
+
+        if (frameCount > 0 && streamSize > 0)
+        {
+            const double duration{ static_cast<double>(frameCount) * static_cast<double>(firstFrameHeader->samplesPerFrame) * 1000.0 / static_cast<double>(firstFrameHeader->sampleRate) };
+            _duration = std::chrono::milliseconds{ static_cast<long long>(duration + 0.5) };
+            _bitrate = computeBitrate(streamSize, duration);
+        }
+        else
+        {
+            const std::uint64_t streamStart{ *tagEnd + firstFrameOffset + (hasId3v1Tag() ? 128 : 0) };
+            if (streamStart < _fileSize)
+            {
+                const double duration{ static_cast<double>(_fileSize - streamStart) * 8.0 / static_cast<double>(firstFrameHeader->bitrate) };
+                _duration = std::chrono::milliseconds{ static_cast<long long>(duration + 0.5) };
+            }
+            _bitrate = firstFrameHeader->bitrate * 1000;
+            _durationEstimated = true;
+        }
+
+        return true;
+    }
+
+    std::optional<AudioProperties> LightweightTagReader::computeExactAudioProperties(const std::filesystem::path& p)
+    {
+        const std::unique_ptr<LightweightTagReader> reader{ create(p, false) };
+        if (!reader || reader->_mpegStreamEnd == 0)
+            return std::nullopt;
+
+        if (!reader->_durationEstimated)
+            return AudioProperties{ reader->_duration, reader->_bitrate };
+
+        try
+        {
+            return reader->walkMpegFrames();
+        }
+        catch (const ParsingFailedException&)
+        {
+            LMS_LOG(METADATA, DEBUG, "File '" << p.string() << "': unexpected content while walking through audio frames");
+            return std::nullopt;
+        }
+    }
+
+    std::optional<AudioProperties> LightweightTagReader::walkMpegFrames() const
+    {
+        // Resynchronize on garbage, but not too far away since there may be trailing tags
+        constexpr std::size_t maxResyncSize{ 4096 };
+
+        std::uint64_t sampleCount{};
+        std::uint64_t streamSize{};
+
+        std::uint64_t offset{ _mpegStreamOffset };
+        while (offset + 4 <= _mpegStreamEnd)
+        {
+            std::optional<MpegFrameHeader> header{ parseMpegFrameHeader(read(offset, 4)) };
+            if (!header)
+            {
+                const std::uint64_t resyncEnd{ std::min<std::uint64_t>(offset + maxResyncSize, _mpegStreamEnd - 4 + 1) };
+                std::uint64_t resyncOffset{ offset + 1 };
+                for (; resyncOffset < resyncEnd; ++resyncOffset)
+                {
+                    header = parseMpegFrameHeader(read(resyncOffset, 4));
+                    if (header && header->sampleRate == _sampleRate)
+                        break;
+                    header.reset();
+                }
+                if (!header)
+                    break;
+
+                offset = resyncOffset;
+            }
+
+            sampleCount += header->samplesPerFrame;
+            streamSize += std::min<std::uint64_t>(header->frameLength, _mpegStreamEnd - offset);
+            offset += header->frameLength;
+        }
+
+        if (sampleCount == 0)
+            return std::nullopt;
+
+        const double duration{ static_cast<double>(sampleCount) * 1000.0 / static_cast<double>(_sampleRate) };
+
+        AudioProperties res;
+        res.duration = std::chrono::milliseconds{ static_cast<long long>(duration + 0.5) };
+        res.bitrate = computeBitrate(streamSize, duration);
+        return res;
+    }
+
+    std::optional<std::uint64_t> LightweightTagReader::parseId3v2Tag()
+    {
+        const auto header{ read(0, 10) };
+        const unsigned majorVersion{ toUInt8(header[3]) };
+        const unsigned flags{ toUInt8(header[5]) };
+        const std::uint64_t tagEnd{ 10 + std::uint64_t{ readSyncSafe32(header, 6) } };
+
+        // ID3v2.2 and v2.3 whole tag unsynchronisation are rarely found, let TagLib handle them
+        if ((majorVersion != 3 && majorVersion != 4) || (majorVersion == 3 && (flags & 0x80)))
+            return std::nullopt;
+
+        std::uint64_t offset{ 10 };
+        if (flags & 0x40) // extended header
+        {
+            const auto extendedHeader{ read(offset, 4) };
+            offset += majorVersion == 3 ? 4 + std::uint64_t{ readBE(extendedHeader, 0, 4) } : std::uint64_t{ readSyncSafe32(extendedHeader, 0) };
+        }
+
+        std::map<std::string, std::string, std::less<>> legacyDateFrames; // v2.3 only
+        std::vector<std::byte> frameContent;
+        while (offset + 10 <= tagEnd)
+        {
+            const auto frameHeader{ read(offset, 10) };
+            const std::string frameId{ toStringView(frameHeader.first(4)) };
+            if (!std::all_of(std::cbegin(frameId), std::cend(frameId), [](char c) { return (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9'); }))
+                break; // padding
+
+            const std::uint64_t frameSize{ majorVersion == 4 ? readSyncSafe32(frameHeader, 4) : readBE(frameHeader, 4, 4) };
+            const unsigned formatFlags{ toUInt8(frameHeader[9]) };
+            offset += 10;
+            if (frameSize > tagEnd - offset)
+                break;
+
+            std::uint64_t dataOffset{ offset };
+            std::uint64_t dataSize{ frameSize };
+            offset += frameSize;
+
+            bool unsynchronised{};
+            std::size_t extraHeaderSize{};
+            if (majorVersion == 3)
+            {
+                if (formatFlags & 0xC0) // compression, encryption
+                    continue;
+                if (formatFlags & 0x20) // grouping identity
+                    extraHeaderSize += 1;
+            }
+            else
+            {
+                if (formatFlags & 0x0C) // compression, encryption
+                    continue;
+                if (formatFlags & 0x40) // grouping identity
+                    extraHeaderSize += 1;
+                if (formatFlags & 0x01) // data length indicator
+                    extraHeaderSize += 4;
+                unsynchronised = (formatFlags & 0x02) != 0;
+            }
+            if (extraHeaderSize > dataSize)
+                continue;
+            dataOffset += extraHeaderSize;
+            dataSize -= extraHeaderSize;
+
+            if (frameId == "APIC")
+            {
+                _pictures.push_back(Picture{ Picture::Format::Id3v2Apic, dataOffset, static_cast<std::size_t>(dataSize), unsynchronised, {} });
+                continue;
+            }
+
+            const bool isLegacyDateFrame{ majorVersion == 3 && (frameId == "TYER" || frameId == "TDAT" || frameId == "TORY") };
+            if (!isLegacyDateFrame && frameId[0] != 'T' && frameId[0] != 'W' && !id3v2FrameMapping.contains(frameId)
+                && frameId != "COMM" && frameId != "USLT" && frameId != "UFID" && frameId != "IPLS")
+                continue;
+
+            std::span<const std::byte> frameData{ read(dataOffset, static_cast<std::size_t>(dataSize)) };
+            if (unsynchronised)
+            {
+                frameContent.assign(std::cbegin(frameData), std::cend(frameData));
+                removeUnsynchronisation(frameContent);
+                frameData = frameContent;
+            }
+
+            if (isLegacyDateFrame)
+            {
+                std::vector<std::string> values{ readId3v2Strings(frameData.subspan(1), readId3v2Encoding(frameData)) };
+                if (!values.empty())
+                    legacyDateFrames[frameId] = std::move(values.front());
+            }
+            else
+                parseId3v2Frame(frameId, frameData);
+        }
+
+        // Upgrade the v2.3 date frames, as done by TagLib
+        if (auto itYear{ legacyDateFrames.find("TYER") }; itYear != std::cend(legacyDateFrames) && !hasTag("DATE"))
+        {
+            std::string date{ itYear->second };
+            if (auto itDate{ legacyDateFrames.find("TDAT") }; itDate != std::cend(legacyDateFrames) && itDate->second.size() == 4 && parseNumber(itDate->second))
+                date += "-" + itDate->second.substr(2, 2) + "-" + itDate->second.substr(0, 2); // DDMM
+            addTagValue("DATE", std::move(date));
+        }
+        if (auto itOriginalYear{ legacyDateFrames.find("TORY") }; itOriginalYear != std::cend(legacyDateFrames) && !hasTag("ORIGINALDATE"))
+            addTagValue("ORIGINALDATE", itOriginalYear->second);
+
+        return tagEnd + ((majorVersion == 4 && (flags & 0x10)) ? 10 : 0);
+    }
+
+    void LightweightTagReader::parseId3v2Frame(std::string_view frameId, std::span<const std::byte> data)
+    {
+        if (frameId == "TXXX")
+        {
+            const Id3v2Encoding encoding{ readId3v2Encoding(data) };
+            auto [description, valuesData] { readId3v2String(data.subspan(1), encoding) };
+            std::string key{ StringUtils::stringToUpper(description) };
+            if (key.empty())
+                return;
+            if (auto it{ id3v2TxxxMapping.find(key) }; it != std::cend(id3v2TxxxMapping))
+                key = it->second;
+
+            for (std::string& value : readId3v2Strings(valuesData, encoding))
+                addTagValue(key, std::move(value));
+        }
+        else if (frameId == "TIPL" || frameId == "IPLS" || frameId == "TMCL")
+        {
+            // list of (role, name) pairs
+            const std::vector<std::string> values{ readId3v2Strings(data.subspan(1), readId3v2Encoding(data)) };
+            for (std::size_t i{}; i + 1 < values.size(); i += 2)
+            {
+                const std::string role{ StringUtils::stringToUpper(values[i]) };
+                if (frameId == "TMCL")
+                    addTagValue("PERFORMER:" + role, values[i + 1]);
+                else if (auto it{ id3v2InvolvedPeopleMapping.find(role) }; it != std::cend(id3v2InvolvedPeopleMapping))
+                    addTagValue(std::string{ it->second }, values[i + 1]);
+            }
+        }
+        else if (frameId == "COMM" || frameId == "USLT")
+        {
+            const Id3v2Encoding encoding{ readId3v2Encoding(data) };
+            auto [description, textData] { readId3v2String(subSpan(data, 4, data.size() - 4), encoding) }; // skip encoding and language
+            auto [text, remainingData] { readId3v2String(textData, encoding) };
+
+            std::string key{ frameId == "COMM" ? "COMMENT" : "LYRICS" };
+            if (!description.empty())
+                key += ":" + StringUtils::stringToUpper(description);
+            addTagValue(std::move(key), std::move(text));
+        }
+        else if (frameId == "UFID")
+        {
+            auto [owner, identifier] { readId3v2String(data, Id3v2Encoding::Latin1) };
+            if (owner == "http://musicbrainz.org")
+                addTagValue("MUSICBRAINZ_TRACKID", latin1ToUTF8(identifier));
+        }
+        else if (frameId == "WXXX")
+        {
+            const Id3v2Encoding encoding{ readId3v2Encoding(data) };
+            auto [description, urlData] { readId3v2String(data.subspan(1), encoding) };
+            std::string key{ StringUtils::stringToUpper(description) };
+            key = (key.empty() || key == "URL") ? "URL" : "URL:" + key;
+            addTagValue(std::move(key), readId3v2String(urlData, Id3v2Encoding::Latin1).first);
+        }
+        else if (auto it{ id3v2FrameMapping.find(frameId) }; it != std::cend(id3v2FrameMapping))
+        {
+            if (frameId[0] == 'W')
+            {
+                addTagValue(std::string{ it->second }, readId3v2String(data, Id3v2Encoding::Latin1).first);
+                return;
+            }
+
+            std::vector<std::string> values{ readId3v2Strings(data.subspan(1), readId3v2Encoding(data)) };
+            if (frameId == "TCON")
+            {
+                std::vector<std::string> genres;
+                for (const std::string& value : values)
+                    addId3v2Genres(value, genres);
+                values = std::move(genres);
+            }
+
+            for (std::string& value : values)
+                addTagValue(std::string{ it->second }, std::move(value));
+        }
+    }
+
+    void LightweightTagReader::parseVorbisComment(std::span<const std::byte> data, bool withPictures)
+    {
+        std::size_t offset{};
+        offset += 4 + readLE(data, offset, 4); // vendor string
+
+        const std::uint64_t commentCount{ readLE(data, offset, 4) };
+        offset += 4;
+        for (std::uint64_t i{}; i < commentCount; ++i)
+        {
+            const std::size_t commentSize{ static_cast<std::size_t>(readLE(data, offset, 4)) };
+            offset += 4;
+            const std::string_view comment{ toStringView(subSpan(data, offset, commentSize)) };
+            offset += commentSize;
+
+            const std::size_t separator{ comment.find('=') };
+            if (separator == std::string_view::npos || separator == 0)
+                continue;
+
+            std::string key{ StringUtils::stringToUpper(std::string{ comment.substr(0, separator) }) };
+            const std::string_view value{ comment.substr(separator + 1) };
+
+            // Pictures are not exposed as tags, as done by TagLib
+            if (key == "METADATA_BLOCK_PICTURE" || key == "COVERART")
+            {
+                if (withPictures && !value.empty())
+                    _pictures.push_back(Picture{ key == "COVERART" ? Picture::Format::Raw : Picture::Format::FlacPicture, 0, 0, false, std::string{ value } });
+                continue;
+            }
+
+            addTagValue(std::move(key), std::string{ value });
+        }
+    }
+
+    bool LightweightTagReader::hasId3v1Tag()
+    {
+        return _fileSize >= 128 && startsWith(read(_fileSize - 128, 3), "TAG");
+    }
+
+    bool LightweightTagReader::hasApeTag()
+    {
+        const std::uint64_t footerEnd{ _fileSize - (hasId3v1Tag() ? 128 : 0) };
+        return footerEnd >= 32 && startsWith(read(footerEnd - 32, 8), "APETAGEX");
+    }
+
+    void LightweightTagReader::addTagValue(std::string key, std::string value)
+    {
+        if (value.empty())
+            return;
+
+        _tags[std::move(key)].push_back(std::move(value));
+    }
+
+    std::span<const std::byte> LightweightTagReader::read(std::uint64_t offset, std::size_t size) const
+    {
+        if (offset > _fileSize || size > _fileSize - offset)
+            throw ParsingFailedException{};
+
+        if (readBufferOwner == this && offset >= _bufferOffset && offset + size <= _bufferOffset + _bufferSize)
+            return std::span<const std::byte>{ readBuffer }.subspan(static_cast<std::size_t>(offset - _bufferOffset), size);
+
+        const std::size_t readSize{ static_cast<std::size_t>(std::min<std::uint64_t>(std::max(size, minReadSize), _fileSize - offset)) };
+        if (readBuffer.size() < readSize)
+            readBuffer.resize(readSize);
+
+        readBufferOwner = this;
+        _bufferOffset = offset;
+        _bufferSize = readAll(_fd, std::span{ readBuffer }.first(readSize), offset);
+        if (_bufferSize < size)
+            throw ParsingFailedException{};
+
+        return std::span<const std::byte>{ readBuffer }.first(size);
+    }
+} // namespace MetaData
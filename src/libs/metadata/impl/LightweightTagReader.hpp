@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "metadata/IParser.hpp"
+#include "ITagReader.hpp"
+
+namespace MetaData
+{
+    // Reads FLAC, Ogg Vorbis, Ogg Opus and MP3 (ID3v2) files by only loading their metadata blocks
+    // Tags are exposed using the same names as the TagLib backend
+    class LightweightTagReader : public ITagReader
+    {
+    public:
+        // Returns nullptr if the file is not handled by this reader, the caller has to use another backend
+        static std::unique_ptr<LightweightTagReader> create(const std::filesystem::path& path, bool debug);
+        ~LightweightTagReader() override;
+
+        // Counts the audio frames of MP3 files for which the duration could only be estimated
+        // Returns std::nullopt if the file is not handled by this reader
+        static std::optional<AudioProperties> computeExactAudioProperties(const std::filesystem::path& path);
+
+    private:
+        LightweightTagReader(int fd, std::uint64_t fileSize);
+        LightweightTagReader(const LightweightTagReader&) = delete;
+        LightweightTagReader& operator=(const LightweightTagReader&) = delete;
+
+        bool hasMultiValuedTags() const override;
+        void visitTagValues(TagType tag, TagValueVisitor visitor) const override;
+        void visitTagValues(std::string_view tag, TagValueVisitor visitor) const override;
+        void visitPerformerTags(PerformerVisitor visitor) const override;
+        bool hasEmbeddedCover() const override { return !_pictures.empty(); }
+        void visitEmbeddedCovers(EmbeddedCoverVisitor visitor) const override;
+
+        std::chrono::milliseconds 	getDuration() const override { return _duration; }
+        std::size_t                 getBitrate() const override { return _bitrate; }
+        std::size_t                 getBitsPerSample() const override { return _bitsPerSample; }
+        std::size_t                 getSampleRate() const override { return _sampleRate; }
+        std::size_t                 getChannelCount() const override { return _channelCount; }
+        std::string_view            getCodecName() const override { return _codecName; }
+        std::string_view            getContainerName() const override { return _containerName; }
+        std::optional<std::size_t>  getAudioStreamIndex() const override { return 0; } // single audio stream, always first
+        bool                        isDurationEstimated() const override { return _durationEstimated; }
+
+        // All the parse functions return false if the file uses features not handled by this reader
+        bool parse();
+        bool parseFlac();
+        bool parseOgg();
+        bool parseMpeg();
+        std::optional<AudioProperties> walkMpegFrames() const;
+        std::optional<std::uint64_t> parseId3v2Tag(); // returns the offset just after the tag
+        void parseId3v2Frame(std::string_view frameId, std::span<const std::byte> data);
+        void parseVorbisComment(std::span<const std::byte> data, bool withPictures);
+        std::optional<std::int64_t> findLastOggGranulePosition(std::uint32_t serialNumber);
+        bool hasId3v1Tag();
+        bool hasApeTag();
+        void addTagValue(std::string key, std::string value);
+        bool hasTag(std::string_view key) const { return _tags.find(key) != std::cend(_tags); }
+
+        // Returned data is only valid until the next read
+        std::span<const std::byte> read(std::uint64_t offset, std::size_t size) const;
+
+        struct Picture
+        {
+            enum class Format
+            {
+                FlacPicture,    // FLAC METADATA_BLOCK_PICTURE
+                Id3v2Apic,      // ID3v2 APIC frame
+                Raw,            // picture data only
+            };
+            Format format;
+            std::uint64_t offset{};         // location in the file, if base64Content is empty
+            std::size_t size{};
+            bool unsynchronised{};
+            std::string base64Content;      // pictures stored in Ogg comments
+        };
+
+        const int _fd;
+        const std::uint64_t _fileSize;
+        std::map<std::string, std::vector<std::string>, std::less<>> _tags; // upper case keys
+        std::vector<Picture> _pictures;
+        std::chrono::milliseconds _duration{};
+        std::size_t _bitrate{};
+        std::size_t _bitsPerSample{};
+        std::size_t _sampleRate{};
+        std::size_t _channelCount{};
+        std::string_view _codecName;
+        std::string_view _containerName;
+        bool _durationEstimated{};
+        std::uint64_t _mpegStreamOffset{};  // first audio frame, MP3 only
+        std::uint64_t _mpegStreamEnd{};     // MP3 only
+
+        mutable std::uint64_t _bufferOffset{};
+        mutable std::size_t _bufferSize{};
+    };
+} // namespace MetaData
@@ -19,13 +19,19 @@
 
 #include "Parser.hpp"
 
+#include <algorithm>
+#include <charconv>
+#include <memory_resource>
 #include <span>
+#include <type_traits>
+#include <utility>
 
 #include "metadata/Exception.hpp"
 #include "utils/ILogger.hpp"
 #include "utils/String.hpp"
 
 #include "AvFormatTagReader.hpp"
+#include "LightweightTagReader.hpp"
 #include "TagLibTagReader.hpp"
 #include "Utils.hpp"
 
@@ -33,72 +39,126 @@ namespace MetaData
 {
     namespace
     {
-        void visitTagValues(const ITagReader& tagReader, std::string_view tagType, std::span<const std::string> tagDelimiters, ITagReader::TagValueVisitor visitor)
+        // Storage for the intermediate values that have to outlive the tag reader visits
+        // One per parser thread, released at each parse so that its memory is reused for the next files
+        class Arena
         {
-            tagReader.visitTagValues(tagType, [&](std::string_view value)
+        public:
+            static Arena& get()
+            {
+                thread_local Arena arena;
+                return arena;
+            }
+
+            void release() { _resource.release(); }
+            std::pmr::memory_resource* getResource() { return &_resource; }
+
+            std::string_view store(std::string_view str)
+            {
+                char* data{ static_cast<char*>(_resource.allocate(str.size(), alignof(char))) };
+                std::copy(std::cbegin(str), std::cend(str), data);
+                return { data, str.size() };
+            }
+
+        private:
+            Arena() = default;
+
+            static constexpr std::size_t initialSize{ 16 * 1024 };
+            std::vector<std::byte> _initialBuffer = std::vector<std::byte>(initialSize);
+            std::pmr::monotonic_buffer_resource _resource{ _initialBuffer.data(), _initialBuffer.size() };
+        };
+
+        // Visits the trimmed non empty values, split using the first delimiter they contain if the tag reader does not handle multi-valued tags
+        // Visited values are only valid during the visit
+        template<typename TagName, typename Visitor>
+        void visitTagValues(const ITagReader& tagReader, const TagName& tag, std::span<const std::string> tagDelimiters, Visitor&& visitor)
+        {
+            const bool splitValues{ !tagDelimiters.empty() && !tagReader.hasMultiValuedTags() };
+
+            auto visitIfNonEmpty{ [&](std::string_view value)
+            {
+                value = StringUtils::stringTrim(value);
+                if (!value.empty())
+                    visitor(value);
+            } };
+
+            auto onValue{ [&](std::string_view value)
+            {
+                if (splitValues)
                 {
-                    auto visitTagIfNonEmpty{ [&](std::string_view tag)
+                    for (std::string_view tagDelimiter : tagDelimiters)
                     {
-                        tag = StringUtils::stringTrim(tag);
-                        if (!tag.empty())
-                            visitor(tag);
-                    } };
+                        if (value.find(tagDelimiter) == std::string_view::npos)
+                            continue;
 
-                    if (!tagReader.hasMultiValuedTags())
-                    {
-                        for (std::string_view tagDelimiter : tagDelimiters)
+                        for (std::size_t pos{ value.find(tagDelimiter) }; pos != std::string_view::npos; pos = value.find(tagDelimiter))
                         {
-                            if (value.find(tagDelimiter) != std::string_view::npos)
-                            {
-                                for (std::string_view splitTag : StringUtils::splitString(value, tagDelimiter))
-                                    visitTagIfNonEmpty(splitTag);
-                                return;
-                            }
+                            visitIfNonEmpty(value.substr(0, pos));
+                            value.remove_prefix(pos + tagDelimiter.size());
                         }
+                        visitIfNonEmpty(value);
+                        return;
                     }
+                }
 
-                    visitTagIfNonEmpty(value);
-                });
+                // no delimiter found, or no delimiter to be used
+                visitIfNonEmpty(value);
+            } };
+
+            // capture a single reference to fit in the small buffer of std::function
+            tagReader.visitTagValues(tag, [&onValue](std::string_view value) { onValue(value); });
         }
 
+        // Views are stored in the arena, no copy is made for numbers
         template<typename T>
-        std::vector<T> getTagValuesFirstMatchAs(const ITagReader& tagReader, std::initializer_list<TagType> tagTypes, std::span<const std::string> tagDelimiters)
+        std::optional<T> parseTagValue(std::string_view value)
         {
-            std::vector<T> res;
-
-            for (const TagType tagType : tagTypes)
+            if constexpr (std::is_arithmetic_v<T>)
             {
-                auto addTagIfNonEmpty{ [&res](std::string_view tag)
+                // Only use the leading part, as done by stream extraction ('Number/Total' is read as Number')
+                if (value.starts_with('+'))
+                    value.remove_prefix(1);
+
+                T res{};
+                const auto [ptr, ec] { std::from_chars(value.data(), value.data() + value.size(), res) };
+                if (ec != std::errc{})
+                    return std::nullopt;
+
+                return res;
+            }
+            else if constexpr (std::is_same_v<T, std::string_view>)
+                return Arena::get().store(value);
+            else
+                return StringUtils::readAs<T>(value);
+        }
+
+        template<typename T, typename Container>
+        void addTagValuesAs(const ITagReader& tagReader, TagType tagType, std::span<const std::string> tagDelimiters, Container& res)
+        {
+            visitTagValues(tagReader, tagType, tagDelimiters, [&](std::string_view value)
                 {
-                    tag = StringUtils::stringTrim(tag);
-                    if (!tag.empty())
-                    {
-                        std::optional<T> val{ StringUtils::readAs<T>(tag) };
-                        if (val)
-                            res.emplace_back(std::move(*val));
-                    }
-                } };
+                    if (std::optional<T> val{ parseTagValue<T>(value) })
+                        res.push_back(std::move(*val));
+                });
+        }
 
-                tagReader.visitTagValues(tagType, [&](std::string_view value)
-                    {
-                        if (!tagReader.hasMultiValuedTags())
-                        {
-                            for (std::string_view tagDelimiter : tagDelimiters)
-                            {
-                                if (value.find(tagDelimiter) != std::string_view::npos)
-                                {
-                                    for (std::string_view splitTag : StringUtils::splitString(value, tagDelimiter))
-                                        addTagIfNonEmpty(splitTag);
-
-                                    return;
-                                }
-                            }
-                        }
+        template<typename T>
+        std::vector<T> getTagValuesAs(const ITagReader& tagReader, TagType tagType, std::span<const std::string> tagDelimiters)
+        {
+            std::vector<T> res;
+            addTagValuesAs<T>(tagReader, tagType, tagDelimiters, res);
+            return res;
+        }
 
-                        // no delimiter found, or no delimiter to be used
-                        addTagIfNonEmpty(value);
-                    });
+        // Values are stored in the arena
+        template<typename T>
+        std::pmr::vector<T> getTagValuesFirstMatchAs(const ITagReader& tagReader, std::initializer_list<TagType> tagTypes, std::span<const std::string> tagDelimiters)
+        {
+            std::pmr::vector<T> res{ Arena::get().getResource() };
 
+            for (const TagType tagType : tagTypes)
+            {
+                addTagValuesAs<T>(tagReader, tagType, tagDelimiters, res);
                 if (!res.empty())
                     break;
             }
@@ -106,27 +166,36 @@ namespace MetaData
             return res;
         }
 
+        // First value that can be read as T
         template <typename T>
-        std::optional<T> getTagValueFirstMatchAs(const ITagReader& tagReader, std::initializer_list<TagType> tagTypes)
+        std::optional<T> getTagValueAs(const ITagReader& tagReader, TagType tagType)
         {
             std::optional<T> res;
-            std::vector<T> values{ getTagValuesFirstMatchAs<T>(tagReader, tagTypes, {} /* don't expect multiple values here */) };
-            if (!values.empty())
-                res = std::move(values.front());
+            visitTagValues(tagReader, tagType, {} /* don't expect multiple values here */, [&](std::string_view value)
+                {
+                    if (!res)
+                        res = parseTagValue<T>(value);
+                });
 
             return res;
         }
 
-        template <typename T>
-        std::vector<T> getTagValuesAs(const ITagReader& tagReader, TagType tagType, std::span<const std::string> tagDelimiters)
+        // 'Number/Total' encoded values
+        std::optional<std::size_t> getTotalFromPositionTag(const ITagReader& tagReader, TagType tagType)
         {
-            return getTagValuesFirstMatchAs<T>(tagReader, { tagType }, tagDelimiters);
-        }
+            std::optional<std::size_t> res;
+            bool visited{};
+            visitTagValues(tagReader, tagType, {}, [&](std::string_view value)
+                {
+                    if (std::exchange(visited, true))
+                        return;
 
-        template <typename T>
-        std::optional<T> getTagValueAs(const ITagReader& tagReader, TagType tagType)
-        {
-            return getTagValueFirstMatchAs<T>(tagReader, { tagType });
+                    const std::size_t separator{ value.find('/') };
+                    if (separator != std::string_view::npos && value.find('/', separator + 1) == std::string_view::npos)
+                        res = parseTagValue<std::size_t>(value.substr(separator + 1));
+                });
+
+            return res;
         }
 
         std::vector<Artist> getArtists(const ITagReader& tagReader,
@@ -136,22 +205,22 @@ namespace MetaData
             std::span<const std::string> artistTagDelimiters
         )
         {
-            std::vector<std::string> artistNames{ getTagValuesFirstMatchAs<std::string>(tagReader, artistTagNames, artistTagDelimiters) };
+            const std::pmr::vector<std::string_view> artistNames{ getTagValuesFirstMatchAs<std::string_view>(tagReader, artistTagNames, artistTagDelimiters) };
             if (artistNames.empty())
                 return {};
 
-            std::vector<std::string> artistSortNames{ getTagValuesFirstMatchAs<std::string>(tagReader, artistSortTagNames, artistTagDelimiters) };
-            std::vector<UUID> artistMBIDs{ getTagValuesFirstMatchAs<UUID>(tagReader, artistMBIDTagNames, artistTagDelimiters) };
+            const std::pmr::vector<std::string_view> artistSortNames{ getTagValuesFirstMatchAs<std::string_view>(tagReader, artistSortTagNames, artistTagDelimiters) };
+            std::pmr::vector<UUID> artistMBIDs{ getTagValuesFirstMatchAs<UUID>(tagReader, artistMBIDTagNames, artistTagDelimiters) };
 
             std::vector<Artist> artists;
             artists.reserve(artistNames.size());
 
             for (std::size_t i{}; i < artistNames.size(); ++i)
             {
-                Artist& artist{ artists.emplace_back(std::move(artistNames[i])) };
+                Artist& artist{ artists.emplace_back(artistNames[i]) };
 
                 if (artistNames.size() == artistSortNames.size())
-                    artist.sortName = std::move(artistSortNames[i]);
+                    artist.sortName = std::string{ artistSortNames[i] };
                 if (artistNames.size() == artistMBIDs.size())
                     artist.mbid = std::move(artistMBIDs[i]);
             }
@@ -192,6 +261,11 @@ namespace MetaData
         return std::make_unique<Parser>(parserBackend, parserReadStyle);
     }
 
+    std::optional<AudioProperties> computeExactAudioProperties(const std::filesystem::path& p)
+    {
+        return LightweightTagReader::computeExactAudioProperties(p);
+    }
+
     Parser::Parser(ParserBackend parserBackend, ParserReadStyle readStyle)
         : _parserBackend{ parserBackend }
         , _readStyle{ readStyle }
@@ -205,6 +279,10 @@ namespace MetaData
         case ParserBackend::AvFormat:
             LMS_LOG(METADATA, INFO, "Using AvFormat parser");
             break;
+
+        case ParserBackend::Lightweight:
+            LMS_LOG(METADATA, INFO, "Using lightweight parser, with TagLib fallback using read style = " << Utils::readStyleToString(readStyle));
+            break;
         }
     }
 
@@ -222,6 +300,12 @@ namespace MetaData
             case ParserBackend::AvFormat:
                 tagReader = std::make_unique<AvFormatTagReader>(p, debug);
                 break;
+
+            case ParserBackend::Lightweight:
+                tagReader = LightweightTagReader::create(p, debug);
+                if (!tagReader)
+                    tagReader = std::make_unique<TagLibTagReader>(p, _readStyle, debug);
+                break;
             }
             if (!tagReader)
                 throw ParseException{ "Unhandled parser backend" };
@@ -239,6 +323,7 @@ namespace MetaData
     {
         auto track{ std::make_unique<Track>() };
 
+        Arena::get().release();
         processAudioProperties(tagReader, *track);
         processTags(tagReader, *track);
 
@@ -249,18 +334,32 @@ namespace MetaData
     {
         track.duration = tagReader.getDuration();
         track.bitrate = tagReader.getBitrate();
+        track.durationEstimated = tagReader.isDurationEstimated();
+        track.codec = tagReader.getCodecName();
+        track.container = tagReader.getContainerName();
+        track.sampleRate = tagReader.getSampleRate();
+        track.channelCount = tagReader.getChannelCount();
+        track.audioStreamIndex = tagReader.getAudioStreamIndex();
     }
 
     void Parser::processTags(const ITagReader& tagReader, Track& track)
     {
         track.hasCover = tagReader.hasEmbeddedCover();
+        if (track.hasCover && _extractEmbeddedCover)
+        {
+            tagReader.visitEmbeddedCovers([&](std::span<const std::byte> data)
+                {
+                    if (track.embeddedCover.empty())
+                        track.embeddedCover.assign(std::cbegin(data), std::cend(data));
+                });
+        }
 
         track.title = getTagValueAs<std::string>(tagReader, TagType::TrackTitle).value_or("");
         track.mbid = getTagValueAs<UUID>(tagReader, TagType::MusicBrainzTrackID);
         track.recordingMBID = getTagValueAs<UUID>(tagReader, TagType::MusicBrainzRecordingID);
         track.acoustID = getTagValueAs<UUID>(tagReader, TagType::AcoustID);
         track.position = getTagValueAs<std::size_t>(tagReader, TagType::TrackNumber); // May parse 'Number/Total', that's fine
-        if (auto dateStr = getTagValueAs<std::string>(tagReader, TagType::Date))
+        if (auto dateStr = getTagValueAs<std::string_view>(tagReader, TagType::Date))
         {
             if (const Wt::WDate date{ Utils::parseDate(*dateStr) }; date.isValid())
             {
@@ -272,7 +371,7 @@ namespace MetaData
                 track.year = Utils::parseYear(*dateStr);
             }
         }
-        if (auto dateStr = getTagValueAs<std::string>(tagReader, TagType::OriginalReleaseDate))
+        if (auto dateStr = getTagValueAs<std::string_view>(tagReader, TagType::OriginalReleaseDate))
         {
             if (const Wt::WDate date{ Utils::parseDate(*dateStr) }; date.isValid())
             {
@@ -284,7 +383,7 @@ namespace MetaData
                 track.originalYear = Utils::parseYear(*dateStr);
             }
         }
-        if (auto dateStr = getTagValueAs<std::string>(tagReader, TagType::OriginalReleaseYear))
+        if (auto dateStr = getTagValueAs<std::string_view>(tagReader, TagType::OriginalReleaseYear))
         {
             track.originalYear = Utils::parseYear(*dateStr);
         }
@@ -298,9 +397,7 @@ namespace MetaData
         {
             visitTagValues(tagReader, userExtraTag, _defaultTagDelimiters, [&](std::string_view value)
                 {
-                    value = StringUtils::stringTrim(value);
-                    if (!value.empty())
-                        track.userExtraTags[userExtraTag].push_back(std::string{ value });
+                    track.userExtraTags[userExtraTag].emplace_back(value);
                 });
         }
 
@@ -310,8 +407,6 @@ namespace MetaData
         track.labels = getTagValuesAs<std::string>(tagReader, TagType::RecordLabel, _defaultTagDelimiters);
         track.languages = getTagValuesAs<std::string>(tagReader, TagType::Language, _defaultTagDelimiters);
 
-        std::vector<std::string_view> artistDelimiters{};
-
         track.medium = getMedium(tagReader);
         track.artists = getArtists(tagReader, { TagType::Artists, TagType::Artist }, { TagType::ArtistSortOrder }, { TagType::MusicBrainzArtistID }, _artistTagDelimiters);
         track.conductorArtists = getArtists(tagReader, { TagType::Conductors, TagType::Conductor }, { TagType::ConductorsSortOrder, TagType::ConductorSortOrder }, {}, _artistTagDelimiters);
@@ -341,16 +436,7 @@ namespace MetaData
         medium->name = getTagValueAs<std::string>(tagReader, TagType::DiscSubtitle).value_or("");
         medium->trackCount = getTagValueAs<std::size_t>(tagReader, TagType::TotalTracks);
         if (!medium->trackCount)
-        {
-            // totalTracks may be encoded as "position/count"
-            if (const auto value{ getTagValueAs<std::string>(tagReader, TagType::TrackNumber) })
-            {
-                // Expecting 'Number/Total'
-                const std::vector<std::string_view> strings{ StringUtils::splitString(*value, '/') };
-                if (strings.size() == 2)
-                    medium->trackCount = StringUtils::readAs<std::size_t>(strings[1]);
-            }
-        }
+            medium->trackCount = getTotalFromPositionTag(tagReader, TagType::TrackNumber); // totalTracks may be encoded as "position/count"
         // Expecting 'Number[/Total]'
         medium->position = getTagValueAs<std::size_t>(tagReader, TagType::DiscNumber);
         medium->release = getRelease(tagReader);
@@ -379,16 +465,7 @@ namespace MetaData
         release->artists = getArtists(tagReader, { TagType::AlbumArtists, TagType::AlbumArtist }, { TagType::AlbumArtistsSortOrder, TagType::AlbumArtistSortOrder }, { TagType::MusicBrainzReleaseArtistID }, _artistTagDelimiters);
         release->mediumCount = getTagValueAs<std::size_t>(tagReader, TagType::TotalDiscs);
         if (!release->mediumCount)
-        {
-            // mediumCount may be encoded as "position/count"
-            if (const auto value{ getTagValueAs<std::string>(tagReader, TagType::DiscNumber) })
-            {
-                // Expecting 'Number/Total'
-                const std::vector<std::string_view> strings{ StringUtils::splitString(*value, '/') };
-                if (strings.size() == 2)
-                    release->mediumCount = StringUtils::readAs<std::size_t>(strings[1]);
-            }
-        }
+            release->mediumCount = getTotalFromPositionTag(tagReader, TagType::DiscNumber); // mediumCount may be encoded as "position/count"
 
         release->releaseTypes = getTagValuesAs<std::string>(tagReader, TagType::ReleaseType, _defaultTagDelimiters);
 
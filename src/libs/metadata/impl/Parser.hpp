@@ -36,6 +36,7 @@ namespace MetaData
         void setUserExtraTags(std::span<const std::string> extraTags) override { _userExtraTags.assign(std::cbegin(extraTags), std::cend(extraTags)); }
         void setArtistTagDelimiters(std::span<const std::string> delimiters) override { _artistTagDelimiters.assign(std::cbegin(delimiters), std::cend(delimiters)); }
         void setDefaultTagDelimiters(std::span<const std::string> delimiters) override { _defaultTagDelimiters.assign(std::cbegin(delimiters), std::cend(delimiters)); }
+        void setExtractEmbeddedCover(bool extract) override { _extractEmbeddedCover = extract; }
 
         void processAudioProperties(const ITagReader& reader, Track& track);
         void processTags(const ITagReader& reader, Track& track);
@@ -49,6 +50,7 @@ namespace MetaData
         std::vector<std::string> _userExtraTags;
         std::vector<std::string> _artistTagDelimiters;
         std::vector<std::string> _defaultTagDelimiters;
+        bool _extractEmbeddedCover{};
     };
 } // namespace MetaData
 
@@ -19,14 +19,17 @@
 
 #include "TagLibTagReader.hpp"
 
+#include <taglib/apefile.h>
 #include <taglib/apetag.h>
 #include <taglib/asffile.h>
+#include <taglib/attachedpictureframe.h>
 #include <taglib/id3v2tag.h>
 #include <taglib/fileref.h>
 #include <taglib/flacfile.h>
 #include <taglib/mp4file.h>
 #include <taglib/mpcfile.h>
 #include <taglib/mpegfile.h>
+#include <taglib/oggflacfile.h>
 #include <taglib/opusfile.h>
 #include <taglib/tag.h>
 #include <taglib/tpropertymap.h>
@@ -36,6 +39,7 @@
 #include "metadata/Exception.hpp"
 #include "utils/ILogger.hpp"
 #include "utils/String.hpp"
+#include "Utils.hpp"
 
 namespace MetaData
 {
@@ -43,112 +47,6 @@ namespace MetaData
     {
         class ParsingFailedException : public Exception {};
 
-        // Mapping to internal taglib names and/or common alternative custom names
-        static const std::unordered_map<TagType, std::vector<std::string>> tagMapping
-        {
-            { TagType::AcoustID, { "ACOUSTID_ID", "ACOUSTID ID" } },
-            { TagType::Album, { "ALBUM" } },
-            { TagType::AlbumArtist, { "ALBUMARTIST" } },
-            { TagType::AlbumArtistSortOrder, { "ALBUMARTISTSORT" } },
-            { TagType::AlbumArtists, { "ALBUMARTISTS" } },
-            { TagType::AlbumArtistsSortOrder, { "ALBUMARTISTSSORT" } },
-            { TagType::AlbumSortOrder, { "ALBUMSORT" } },
-            { TagType::Arranger, { "ARRANGER" } },
-            { TagType::Artist, { "ARTIST" } },
-            { TagType::ArtistSortOrder, { "ARTISTSORT" } },
-            { TagType::Artists, { "ARTISTS" } },
-            { TagType::ASIN, { "ASIN" } },
-            { TagType::Barcode, { "BARCODE" } },
-            { TagType::BPM, { "BPM" } },
-            { TagType::CatalogNumber, { "CATALOGNUMBER" } },
-            { TagType::Comment, { "COMMENT" } },
-            { TagType::Compilation, { "COMPILATION" } },
-            { TagType::Composer, { "COMPOSER" } },
-            { TagType::Composers, { "COMPOSERS" } },
-            { TagType::ComposerSortOrder, { "COMPOSERSORT" } },
-            { TagType::ComposersSortOrder, { "COMPOSERSSORT" } },
-            { TagType::Conductor, { "CONDUCTOR" } },
-            { TagType::ConductorSortOrder, { "CONDUCTORSORT" } },
-            { TagType::Conductors, { "CONDUCTORS" } },
-            { TagType::ConductorsSortOrder, { "CONDUCTORSSORT" } },
-            { TagType::Copyright, { "COPYRIGHT" } },
-            { TagType::CopyrightURL, { "COPYRIGHTURL" } },
-            { TagType::Date, { "DATE", "YEAR" } },
-            { TagType::Director, { "DIRECTOR" } },
-            { TagType::DiscNumber, { "DISCNUMBER", "DISC" } },
-            { TagType::DiscSubtitle, { "DISCSUBTITLE", "SETSUBTITLE" } },
-            { TagType::EncodedBy, { "ENCODEDBY" } },
-            { TagType::Engineer, { "ENGINEER" } },
-            { TagType::GaplessPlayback, { "GAPLESSPLAYBACK" } },
-            { TagType::Genre, { "GENRE" } },
-            { TagType::Grouping, { "GROUPING", "ALBUMGROUPING" } },
-            { TagType::InitialKey, { "INITIALKEY" } },
-            { TagType::ISRC, { "ISRC" } },
-            { TagType::Language, { "LANGUAGE" } },
-            { TagType::License, { "LICENSE" } },
-            { TagType::Lyricist, { "LYRICIST" } },
-            { TagType::LyricistSortOrder, { "LYRICISTSORT" } },
-            { TagType::Lyricists, { "LYRICISTS" } },
-            { TagType::LyricistsSortOrder, { "LYRICISTSSORT" } },
-            { TagType::Lyrics, { "LYRICS" } },
-            { TagType::Media, { "MEDIA" } },
-            { TagType::MixDJ, { "DJMIXER" } },
-            { TagType::Mixer, { "MIXER" } },
-            { TagType::MixerSortOrder, { "MIXERSORT" } },
-            { TagType::Mixers, { "MIXERS" } },
-            { TagType::MixersSortOrder, { "MIXERSSORT" } },
-            { TagType::Mood, { "MOOD" } },
-            { TagType::Movement, { "MOVEMENT", "MOVEMENTNAME" } },
-            { TagType::MovementCount, { "MOVEMENTCOUNT" } },
-            { TagType::MovementNumber, { "MOVEMENTNUMBER" } },
-            { TagType::MusicBrainzArtistID, { "MUSICBRAINZ_ARTISTID", "MUSICBRAINZ ARTIST ID", "MUSICBRAINZ/ARTIST ID" } },
-            { TagType::MusicBrainzDiscID, { "MUSICBRAINZ_DISCID", "MUSICBRAINZ DISC ID", "MUSICBRAINZ/DISC ID" } },
-            { TagType::MusicBrainzOriginalArtistID, { "MUSICBRAINZ_ORIGINALARTISTID", "MUSICBRAINZ ORIGINAL ARTIST ID", "MUSICBRAINZ/ORIGINAL ARTIST ID" } },
-            { TagType::MusicBrainzOriginalReleaseID, { "MUSICBRAINZ_ORIGINALRELEASEID", "MUSICBRAINZ ORIGINAL RELEASE ID", "MUSICBRAINZ/ORIGINAL RELEASE ID" } },
-            { TagType::MusicBrainzRecordingID, { "MUSICBRAINZ_TRACKID", "MUSICBRAINZ TRACK ID", "MUSICBRAINZ/TRACK ID" } },
-            { TagType::MusicBrainzReleaseArtistID, { "MUSICBRAINZ_ALBUMARTISTID", "MUSICBRAINZ ALBUM ARTIST ID", "MUSICBRAINZ/ALBUM ARTIST ID" } },
-            { TagType::MusicBrainzReleaseGroupID, { "MUSICBRAINZ_RELEASEGROUPID", "MUSICBRAINZ RELEASE GROUP ID", "MUSICBRAINZ/RELEASE GROUP ID" } },
-            { TagType::MusicBrainzReleaseID, { "MUSICBRAINZ_ALBUMID", "MUSICBRAINZ ALBUM ID", "MUSICBRAINZ/ALBUM ID" } },
-            { TagType::MusicBrainzTrackID, { "MUSICBRAINZ_RELEASETRACKID", "MUSICBRAINZ RELEASE TRACK ID", "MUSICBRAINZ/RELEASE TRACK ID" } },
-            { TagType::MusicBrainzWorkID, { "MUSICBRAINZ_WORKID", "MUSICBRAINZ WORK ID", "MUSICBRAINZ/WORK ID" } },
-            { TagType::OriginalArtist, { "ORIGINALARTIST" } },
-            { TagType::OriginalFilename, { "ORIGINALFILENAME" } },
-            { TagType::OriginalReleaseDate, { "ORIGINALDATE" } },
-            { TagType::OriginalReleaseYear, { "ORIGINALYEAR" } },
-            { TagType::Podcast, { "PODCAST" } },
-            { TagType::PodcastURL, { "PODCASTURL" } },
-            { TagType::Producer, { "PRODUCER" } },
-            { TagType::ProducerSortOrder, { "PRODUCERSORTORDER" } },
-            { TagType::Producers, { "PRODUCERS" } },
-            { TagType::ProducersSortOrder, { "PRODUCERSSORTORDER" } },
-            { TagType::RecordLabel, { "LABEL" } },
-            { TagType::ReleaseCountry, { "RELEASECOUNTRY" } },
-            { TagType::ReleaseDate, { "RELEASEDATE" } },
-            { TagType::ReleaseStatus, { "RELEASESTATUS" } },
-            { TagType::ReleaseType, { "RELEASETYPE", "MUSICBRAINZ_ALBUMTYPE", "MUSICBRAINZ ALBUM TYPE", "MUSICBRAINZ/ALBUM TYPE" } },
-            { TagType::Remixer, { "REMIXER", "MODIFIEDBY", "MIXARTIST" } },
-            { TagType::RemixerSortOrder, { "REMIXERSORTORDER", "MIXARTISTSORTORDER" } },
-            { TagType::Remixers, { "REMIXERS" } },
-            { TagType::RemixersSortOrder, { "REMIXERSSORTORDER", "MIXARTISTSSORTORDER" } },
-            { TagType::ReplayGainAlbumGain, { "REPLAYGAIN_ALBUM_GAIN" } },
-            { TagType::ReplayGainAlbumPeak, { "REPLAYGAIN_ALBUM_PEAK" } },
-            { TagType::ReplayGainAlbumRange, { "REPLAYGAIN_ALBUM_RANGE" } },
-            { TagType::ReplayGainReferenceLoudness, { "REPLAYGAIN_REFERENCE_LOUDNESS" } },
-            { TagType::ReplayGainTrackGain, { "REPLAYGAIN_TRACK_GAIN" } },
-            { TagType::ReplayGainTrackPeak, { "REPLAYGAIN_TRACK_PEAK" } },
-            { TagType::ReplayGainTrackRange, { "REPLAYGAIN_TRACK_RANGE" } },
-            { TagType::Script, { "SCRIPT" } },
-            { TagType::ShowWorkAndMovement, { "SHOWWORKMOVEMENT", "SHOWMOVEMENT" } },
-            { TagType::Subtitle, { "SUBTITLE" } },
-            { TagType::TotalDiscs, { "DISCTOTAL", "TOTALDISCS"} },
-            { TagType::TotalTracks, { "TRACKTOTAL", "TOTALTRACKS" } },
-            { TagType::TrackNumber, { "TRACKNUMBER" } },
-            { TagType::TrackTitle, { "TITLE" } },
-            { TagType::TrackTitleSortOrder, { "TITLESORT" } },
-            { TagType::WorkTitle, { "WORK" } },
-            { TagType::Writer, { "WRITER" } },
-        };
-
         TagLib::AudioProperties::ReadStyle readStyleToTagLibReadStyle(ParserReadStyle readStyle)
         {
             switch (readStyle)
@@ -161,6 +59,77 @@ namespace MetaData
             throw LmsException{ "Cannot convert read style" };
         }
 
+        std::span<const std::byte> toSpan(const TagLib::ByteVector& data)
+        {
+            return { reinterpret_cast<const std::byte*>(data.data()), data.size() };
+        }
+
+        struct StreamFormat
+        {
+            std::string_view codecName;
+            std::string_view containerName;
+            std::optional<std::size_t> audioStreamIndex;
+        };
+
+        // Names as reported by libavcodec/libavformat
+        StreamFormat getStreamFormat(TagLib::File* file)
+        {
+            // The audio stream comes first for these containers, attached pictures are exposed as extra streams
+            constexpr std::size_t firstStream{ 0 };
+
+            if (const auto* mp3File{ dynamic_cast<const TagLib::MPEG::File*>(file) })
+            {
+                switch (mp3File->audioProperties()->layer())
+                {
+                case 1: return { "mp1", "mp3", firstStream };
+                case 2: return { "mp2", "mp3", firstStream };
+                default: return { "mp3", "mp3", firstStream };
+                }
+            }
+            if (dynamic_cast<const TagLib::FLAC::File*>(file))
+                return { "flac", "flac", firstStream };
+            if (dynamic_cast<const TagLib::Ogg::Vorbis::File*>(file))
+                return { "vorbis", "ogg", firstStream };
+            if (dynamic_cast<const TagLib::Ogg::Opus::File*>(file))
+                return { "opus", "ogg", firstStream };
+            if (dynamic_cast<const TagLib::Ogg::FLAC::File*>(file))
+                return { "flac", "ogg", firstStream };
+            if (dynamic_cast<const TagLib::WavPack::File*>(file))
+                return { "wavpack", "wv", firstStream };
+            if (dynamic_cast<const TagLib::APE::File*>(file))
+                return { "ape", "ape", firstStream };
+            if (const auto* mpcFile{ dynamic_cast<const TagLib::MPC::File*>(file) })
+            {
+                if (mpcFile->audioProperties()->mpcVersion() >= 8)
+                    return { "musepack8", "mpc8", firstStream };
+                return { "musepack7", "mpc", firstStream };
+            }
+            // May contain several tracks: the stream index is left to be detected
+            if (const auto* mp4File{ dynamic_cast<const TagLib::MP4::File*>(file) })
+            {
+                constexpr std::string_view containerName{ "mov,mp4,m4a,3gp,3g2,mj2" };
+                switch (mp4File->audioProperties()->codec())
+                {
+                case TagLib::MP4::Properties::AAC: return { "aac", containerName, std::nullopt };
+                case TagLib::MP4::Properties::ALAC: return { "alac", containerName, std::nullopt };
+                default: return { "", containerName, std::nullopt };
+                }
+            }
+            if (const auto* asfFile{ dynamic_cast<const TagLib::ASF::File*>(file) })
+            {
+                switch (asfFile->audioProperties()->codec())
+                {
+                case TagLib::ASF::Properties::WMA1: return { "wmav1", "asf", std::nullopt };
+                case TagLib::ASF::Properties::WMA2: return { "wmav2", "asf", std::nullopt };
+                case TagLib::ASF::Properties::WMA9Pro: return { "wmapro", "asf", std::nullopt };
+                case TagLib::ASF::Properties::WMA9Lossless: return { "wmalossless", "asf", std::nullopt };
+                default: return { "", "asf", std::nullopt };
+                }
+            }
+
+            return {};
+        }
+
         void mergeTagMaps(TagLib::PropertyMap& dst, TagLib::PropertyMap&& src)
         {
             for (auto&& [tag, values] : src)
@@ -190,6 +159,11 @@ namespace MetaData
 
         _propertyMap = _file.file()->properties();
 
+        const StreamFormat streamFormat{ getStreamFormat(_file.file()) };
+        _codecName = streamFormat.codecName;
+        _containerName = streamFormat.containerName;
+        _audioStreamIndex = streamFormat.audioStreamIndex;
+
         // Some tags may not be known by TagLib
         auto getAPETags = [&](const TagLib::APE::Tag* apeTag)
             {
@@ -234,6 +208,9 @@ namespace MetaData
         // MP3
         else if (TagLib::MPEG::File * mp3File{ dynamic_cast<TagLib::MPEG::File*>(_file.file()) })
         {
+            // without Xing/VBRI header, TagLib assumes the bitrate of the first frame is used for the whole file
+            _durationEstimated = !mp3File->audioProperties()->xingHeader();
+
             if (mp3File->ID3v2Tag())
             {
                 const auto& frameListMap{ mp3File->ID3v2Tag()->frameListMap() };
@@ -282,7 +259,7 @@ namespace MetaData
                 _hasEmbeddedCover = true;
         }
 
-        if (debug && Service<ILogger>::get()->isSeverityActive(Severity::DEBUG))
+        if (debug && Service<ILogger>::get()->isSeverityActive(Module::METADATA, Severity::DEBUG))
         {
             for (const auto& [key, values] : _propertyMap)
             {
@@ -299,11 +276,7 @@ namespace MetaData
 
     void TagLibTagReader::visitTagValues(TagType tag, TagValueVisitor visitor) const
     {
-        auto itTagNames{ tagMapping.find(tag) };
-        if (itTagNames == std::cend(tagMapping))
-            return;
-
-        for (const std::string& tagName : itTagNames->second)
+        for (const std::string& tagName : Utils::getTagLibTagNames(tag))
         {
             bool visited{};
 
@@ -355,6 +328,54 @@ namespace MetaData
         }
     }
 
+    void TagLibTagReader::visitEmbeddedCovers(EmbeddedCoverVisitor visitor) const
+    {
+        if (!_hasEmbeddedCover)
+            return;
+
+        // WMA
+        if (TagLib::ASF::File * asfFile{ dynamic_cast<TagLib::ASF::File*>(_file.file()) })
+        {
+            const auto& attributeListMap{ asfFile->tag()->attributeListMap() };
+            if (auto it{ attributeListMap.find("WM/Picture") }; it != attributeListMap.end())
+            {
+                for (const TagLib::ASF::Attribute& attribute : it->second)
+                    visitor(toSpan(attribute.toPicture().picture()));
+            }
+        }
+        // MP3
+        else if (TagLib::MPEG::File * mp3File{ dynamic_cast<TagLib::MPEG::File*>(_file.file()) })
+        {
+            for (const TagLib::ID3v2::Frame* frame : mp3File->ID3v2Tag()->frameListMap()["APIC"])
+            {
+                if (const auto* pictureFrame{ dynamic_cast<const TagLib::ID3v2::AttachedPictureFrame*>(frame) })
+                    visitor(toSpan(pictureFrame->picture()));
+            }
+        }
+        // MP4
+        else if (TagLib::MP4::File * mp4File{ dynamic_cast<TagLib::MP4::File*>(_file.file()) })
+        {
+            for (const TagLib::MP4::CoverArt& coverArt : mp4File->tag()->item("covr").toCoverArtList())
+                visitor(toSpan(coverArt.data()));
+        }
+        // FLAC
+        else if (TagLib::FLAC::File * flacFile{ dynamic_cast<TagLib::FLAC::File*>(_file.file()) })
+        {
+            for (const TagLib::FLAC::Picture* picture : flacFile->pictureList())
+                visitor(toSpan(picture->data()));
+        }
+        else if (TagLib::Ogg::Vorbis::File * vorbisFile{ dynamic_cast<TagLib::Ogg::Vorbis::File*>(_file.file()) })
+        {
+            for (const TagLib::FLAC::Picture* picture : vorbisFile->tag()->pictureList())
+                visitor(toSpan(picture->data()));
+        }
+        else if (TagLib::Ogg::Opus::File * opusFile{ dynamic_cast<TagLib::Ogg::Opus::File*>(_file.file()) })
+        {
+            for (const TagLib::FLAC::Picture* picture : opusFile->tag()->pictureList())
+                visitor(toSpan(picture->data()));
+        }
+    }
+
     std::chrono::milliseconds TagLibTagReader::getDuration() const
     {
         return std::chrono::milliseconds{ _file.audioProperties()->lengthInMilliseconds() };
@@ -374,4 +395,9 @@ namespace MetaData
     {
         return static_cast<std::size_t>(_file.audioProperties()->sampleRate());
     }
+
+    std::size_t TagLibTagReader::getChannelCount() const
+    {
+        return static_cast<std::size_t>(_file.audioProperties()->channels());
+    }
 } // namespace MetaData
@@ -43,15 +43,25 @@ namespace MetaData
         void visitTagValues(std::string_view tag, TagValueVisitor visitor) const override;
         void visitPerformerTags(PerformerVisitor visitor) const override;
         bool hasEmbeddedCover() const override { return _hasEmbeddedCover; }
+        void visitEmbeddedCovers(EmbeddedCoverVisitor visitor) const override;
 
         std::chrono::milliseconds 	getDuration() const override;
         std::size_t                 getBitrate() const override;
         std::size_t                 getBitsPerSample() const override;
         std::size_t                 getSampleRate() const override;
+        std::size_t                 getChannelCount() const override;
+        std::string_view            getCodecName() const override { return _codecName; }
+        std::string_view            getContainerName() const override { return _containerName; }
+        std::optional<std::size_t>  getAudioStreamIndex() const override { return _audioStreamIndex; }
+        bool                        isDurationEstimated() const override { return _durationEstimated; }
 
         TagLib::FileRef _file;
         TagLib::PropertyMap _propertyMap; // case-insensitive keys
         bool _hasEmbeddedCover{};
         bool _hasMultiValuedTags{};
+        bool _durationEstimated{};
+        std::string_view _codecName;
+        std::string_view _containerName;
+        std::optional<std::size_t> _audioStreamIndex;
     };
 } // namespace MetaData
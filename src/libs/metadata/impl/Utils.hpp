@@ -21,10 +21,13 @@
 #pragma once
 
 #include <optional>
+#include <span>
+#include <string>
 #include <string_view>
 #include <Wt/WDate.h>
 
 #include "metadata/IParser.hpp"
+#include "ITagReader.hpp"
 
 namespace MetaData::Utils
 {
@@ -32,6 +35,9 @@ namespace MetaData::Utils
 	std::optional<int> parseYear(std::string_view yearStr);
 	std::string_view readStyleToString(ParserReadStyle readStyle);
 
+	// Internal taglib names and/or common alternative custom names, in lookup order
+	std::span<const std::string> getTagLibTagNames(TagType tag);
+
 	struct PerformerArtist
 	{
 		Artist artist;
@@ -20,6 +20,7 @@
 #pragma once
 
 #include <chrono>
+#include <cstddef>
 #include <filesystem>
 #include <map>
 #include <optional>
@@ -98,11 +99,18 @@ namespace MetaData
         Tags                        userExtraTags;
         std::chrono::milliseconds 	duration{};
         std::size_t                 bitrate{};
+        bool                        durationEstimated{}; // duration and bitrate may be inaccurate, see computeExactAudioProperties
+        std::string                 codec;          // libavcodec name ("mp3", "flac", ...), empty if unknown
+        std::string                 container;      // libavformat name ("mp3", "ogg", ...), empty if unknown
+        std::size_t                 sampleRate{};
+        std::size_t                 channelCount{};
+        std::optional<std::size_t>  audioStreamIndex; // in the container, if known
         std::optional<int>          year{};
         Wt::WDate					date;
         std::optional<int>          originalYear{};
         Wt::WDate					originalDate;
         bool						hasCover{};
+        std::vector<std::byte>      embeddedCover; // only filled if requested, see IParser::setExtractEmbeddedCover
         std::optional<UUID>			acoustID;
         std::string					copyright;
         std::string					copyrightURL;
@@ -128,12 +136,15 @@ namespace MetaData
         virtual void setUserExtraTags(std::span<const std::string> extraTags) = 0;
         virtual void setArtistTagDelimiters(std::span<const std::string> delimiters) = 0;
         virtual void setDefaultTagDelimiters(std::span<const std::string> delimiters) = 0;
+        // Copy the first embedded picture into the parsed track, so that callers do not have to reopen the file later
+        virtual void setExtractEmbeddedCover(bool extract) = 0;
     };
 
     enum class ParserBackend
     {
         TagLib,
         AvFormat,
+        Lightweight, // only reads the metadata blocks of FLAC, Ogg Vorbis/Opus and MP3 files, TagLib is used for the other files
     };
 
     enum class ParserReadStyle
@@ -143,4 +154,13 @@ namespace MetaData
         Accurate,
     };
     std::unique_ptr<IParser> createParser(ParserBackend parserBackend, ParserReadStyle parserReadStyle);
+
+    struct AudioProperties
+    {
+        std::chrono::milliseconds   duration{};
+        std::size_t                 bitrate{};
+    };
+    // Walks through all the audio frames of the file, much slower than parse
+    // Only MP3 files are handled, returns std::nullopt for other files
+    std::optional<AudioProperties> computeExactAudioProperties(const std::filesystem::path& p);
 } // namespace MetaData
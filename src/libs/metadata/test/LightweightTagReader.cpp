@@ -0,0 +1,416 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "LightweightTagReader.hpp"
+
+namespace MetaData
+{
+    namespace
+    {
+        using Bytes = std::vector<std::byte>;
+
+        class TemporaryFile
+        {
+        public:
+            TemporaryFile(std::string_view name, const Bytes& content)
+                : _path{ std::filesystem::temp_directory_path() / ("lms-test-lightweight-" + std::string{ name }) }
+            {
+                std::ofstream ofs{ _path, std::ios::binary | std::ios::trunc };
+                ofs.write(reinterpret_cast<const char*>(content.data()), static_cast<std::streamsize>(content.size()));
+            }
+            ~TemporaryFile() { std::filesystem::remove(_path); }
+
+            const std::filesystem::path& getPath() const { return _path; }
+
+        private:
+            const std::filesystem::path _path;
+        };
+
+        void append(Bytes& bytes, std::string_view str)
+        {
+            for (char c : str)
+                bytes.push_back(static_cast<std::byte>(c));
+        }
+
+        void appendBE(Bytes& bytes, std::uint32_t value, std::size_t size)
+        {
+            for (std::size_t i{ size }; i-- > 0;)
+                bytes.push_back(static_cast<std::byte>((value >> (i * 8)) & 0xFF));
+        }
+
+        void appendLE(Bytes& bytes, std::uint64_t value, std::size_t size)
+        {
+            for (std::size_t i{}; i < size; ++i)
+                bytes.push_back(static_cast<std::byte>((value >> (i * 8)) & 0xFF));
+        }
+
+        void appendSyncSafe(Bytes& bytes, std::uint32_t value)
+        {
+            for (std::size_t i{ 4 }; i-- > 0;)
+                bytes.push_back(static_cast<std::byte>((value >> (i * 7)) & 0x7F));
+        }
+
+        Bytes createVorbisComment(std::initializer_list<std::string_view> comments)
+        {
+            Bytes res;
+            appendLE(res, 6, 4);
+            append(res, "vendor");
+            appendLE(res, comments.size(), 4);
+            for (std::string_view comment : comments)
+            {
+                appendLE(res, comment.size(), 4);
+                append(res, comment);
+            }
+            return res;
+        }
+
+        Bytes createFlacPicture(std::string_view data)
+        {
+            Bytes res;
+            appendBE(res, 3, 4); // front cover
+            appendBE(res, 10, 4);
+            append(res, "image/jpeg");
+            appendBE(res, 0, 4);
+            res.resize(res.size() + 16); // width, height, color depth, color count
+            appendBE(res, static_cast<std::uint32_t>(data.size()), 4);
+            append(res, data);
+            return res;
+        }
+
+        Bytes createId3v2Frame(std::string_view id, const Bytes& content)
+        {
+            Bytes res;
+            append(res, id);
+            appendSyncSafe(res, static_cast<std::uint32_t>(content.size()));
+            appendBE(res, 0, 2);
+            res.insert(std::cend(res), std::cbegin(content), std::cend(content));
+            return res;
+        }
+
+        Bytes createId3v2TextFrame(std::string_view id, std::string_view text)
+        {
+            Bytes content{ std::byte{ 3 } }; // UTF-8
+            append(content, text);
+            return createId3v2Frame(id, content);
+        }
+
+        void appendOggPage(Bytes& bytes, std::uint64_t granulePosition, std::uint32_t sequenceNumber, const Bytes& packet)
+        {
+            append(bytes, "OggS");
+            bytes.push_back(std::byte{ 0 }); // version
+            bytes.push_back(sequenceNumber == 0 ? std::byte{ 0x02 } : std::byte{ 0 });
+            appendLE(bytes, granulePosition, 8);
+            appendLE(bytes, 1234, 4); // serial number
+            appendLE(bytes, sequenceNumber, 4);
+            appendLE(bytes, 0, 4); // crc, not checked
+
+            const std::size_t segmentCount{ packet.size() / 255 + 1 };
+            bytes.push_back(static_cast<std::byte>(segmentCount));
+            for (std::size_t i{}; i < segmentCount - 1; ++i)
+                bytes.push_back(std::byte{ 255 });
+            bytes.push_back(static_cast<std::byte>(packet.size() % 255));
+            bytes.insert(std::cend(bytes), std::cbegin(packet), std::cend(packet));
+        }
+
+        std::vector<std::string> getTagValues(const ITagReader& reader, TagType tag)
+        {
+            std::vector<std::string> values;
+            reader.visitTagValues(tag, [&](std::string_view value) { values.emplace_back(value); });
+            return values;
+        }
+
+        std::vector<std::string> getEmbeddedCovers(const ITagReader& reader)
+        {
+            std::vector<std::string> covers;
+            reader.visitEmbeddedCovers([&](std::span<const std::byte> data) { covers.emplace_back(reinterpret_cast<const char*>(data.data()), data.size()); });
+            return covers;
+        }
+    }
+
+    TEST(LightweightTagReader, flac)
+    {
+        Bytes file;
+        append(file, "fLaC");
+
+        // STREAMINFO: 44.1kHz, 2 channels, 16 bits, 10 seconds
+        file.push_back(std::byte{ 0 });
+        appendBE(file, 34, 3);
+        appendBE(file, 4096, 2);
+        appendBE(file, 4096, 2);
+        appendBE(file, 0, 3);
+        appendBE(file, 0, 3);
+        appendBE(file, (44100 << 12) | (1 << 9) | (15 << 4), 4);
+        appendBE(file, 441000, 4);
+        appendBE(file, 0, 4);
+        appendBE(file, 0, 4);
+        appendBE(file, 0, 4);
+        appendBE(file, 0, 4);
+
+        const Bytes vorbisComment{ createVorbisComment({ "TITLE=MyTitle", "artist=MyArtist1", "ARTIST=MyArtist2", "PERFORMER:Piano=MyPianist", "ignored" }) };
+        file.push_back(std::byte{ 4 });
+        appendBE(file, static_cast<std::uint32_t>(vorbisComment.size()), 3);
+        file.insert(std::cend(file), std::cbegin(vorbisComment), std::cend(vorbisComment));
+
+        const Bytes picture{ createFlacPicture("MyPicture") };
+        file.push_back(std::byte{ 0x80 | 6 });
+        appendBE(file, static_cast<std::uint32_t>(picture.size()), 3);
+        file.insert(std::cend(file), std::cbegin(picture), std::cend(picture));
+
+        file.resize(file.size() + 1000); // audio frames
+
+        const TemporaryFile tmpFile{ "test.flac", file };
+        const std::unique_ptr<ITagReader> reader{ LightweightTagReader::create(tmpFile.getPath(), false) };
+        ASSERT_NE(reader, nullptr);
+
+        EXPECT_EQ(reader->getDuration(), std::chrono::seconds{ 10 });
+        EXPECT_FALSE(reader->isDurationEstimated());
+        EXPECT_EQ(reader->getSampleRate(), 44100);
+        EXPECT_EQ(reader->getBitsPerSample(), 16);
+        EXPECT_EQ(reader->getBitrate(), 1000); // 1000 bytes in 10 seconds
+        EXPECT_EQ(reader->getCodecName(), "flac");
+        EXPECT_EQ(reader->getContainerName(), "flac");
+
+        EXPECT_TRUE(reader->hasMultiValuedTags());
+        EXPECT_EQ(getTagValues(*reader, TagType::TrackTitle), std::vector<std::string>{ "MyTitle" });
+        EXPECT_EQ(getTagValues(*reader, TagType::Artist), (std::vector<std::string>{ "MyArtist1", "MyArtist2" }));
+
+        std::vector<std::pair<std::string, std::string>> performers;
+        reader->visitPerformerTags([&](std::string_view role, std::string_view name) { performers.emplace_back(role, name); });
+        EXPECT_EQ(performers, (std::vector<std::pair<std::string, std::string>>{ { "PIANO", "MyPianist" } }));
+
+        ASSERT_TRUE(reader->hasEmbeddedCover());
+        EXPECT_EQ(getEmbeddedCovers(*reader), std::vector<std::string>{ "MyPicture" });
+    }
+
+    TEST(LightweightTagReader, mp3)
+    {
+        Bytes frames;
+        {
+            Bytes artists{ std::byte{ 3 } };
+            append(artists, "MyArtist1");
+            artists.push_back(std::byte{ 0 });
+            append(artists, "MyArtist2");
+            frames = createId3v2Frame("TPE1", artists);
+        }
+        {
+            // UTF-16 with BOM
+            const Bytes title{ std::byte{ 1 }, std::byte{ 0xFF }, std::byte{ 0xFE }, std::byte{ 'T' }, std::byte{ 0 }, std::byte{ 0xE9 }, std::byte{ 0 } };
+            const Bytes frame{ createId3v2Frame("TIT2", title) };
+            frames.insert(std::cend(frames), std::cbegin(frame), std::cend(frame));
+        }
+        {
+            Bytes txxx{ std::byte{ 0 } };
+            append(txxx, "MusicBrainz Album Id");
+            txxx.push_back(std::byte{ 0 });
+            append(txxx, "7de7b4cb-0a4a-4ee6-8a6d-5f0cd3d5e1b7");
+            const Bytes frame{ createId3v2Frame("TXXX", txxx) };
+            frames.insert(std::cend(frames), std::cbegin(frame), std::cend(frame));
+        }
+        {
+            const Bytes frame{ createId3v2TextFrame("TCON", "(17)") };
+            frames.insert(std::cend(frames), std::cbegin(frame), std::cend(frame));
+        }
+        {
+            Bytes tmcl{ std::byte{ 3 } };
+            append(tmcl, "piano");
+            tmcl.push_back(std::byte{ 0 });
+            append(tmcl, "MyPianist");
+            const Bytes frame{ createId3v2Frame("TMCL", tmcl) };
+            frames.insert(std::cend(frames), std::cbegin(frame), std::cend(frame));
+        }
+        {
+            Bytes apic{ std::byte{ 0 } };
+            append(apic, "image/jpeg");
+            apic.push_back(std::byte{ 0 });
+            apic.push_back(std::byte{ 3 }); // front cover
+            apic.push_back(std::byte{ 0 }); // empty description
+            append(apic, "MyPicture");
+            const Bytes frame{ createId3v2Frame("APIC", apic) };
+            frames.insert(std::cend(frames), std::cbegin(frame), std::cend(frame));
+        }
+        frames.resize(frames.size() + 64); // padding
+
+        Bytes file;
+        append(file, "ID3");
+        file.push_back(std::byte{ 4 });
+        file.push_back(std::byte{ 0 });
+        file.push_back(std::byte{ 0 });
+        appendSyncSafe(file, static_cast<std::uint32_t>(frames.size()));
+        file.insert(std::cend(file), std::cbegin(frames), std::cend(frames));
+
+        // MPEG 1 layer III, 128 kbps, 44.1kHz: 417 bytes per frame
+        const std::size_t audioStart{ file.size() };
+        for (std::size_t i{}; i < 100; ++i)
+        {
+            const std::size_t frameStart{ file.size() };
+            appendBE(file, 0xFFFB9000, 4);
+            file.resize(frameStart + 417);
+        }
+        const std::size_t audioSize{ file.size() - audioStart };
+
+        const TemporaryFile tmpFile{ "test.mp3", file };
+        const std::unique_ptr<ITagReader> reader{ LightweightTagReader::create(tmpFile.getPath(), false) };
+        ASSERT_NE(reader, nullptr);
+
+        EXPECT_EQ(reader->getSampleRate(), 44100);
+        EXPECT_EQ(reader->getBitrate(), 128000);
+        EXPECT_EQ(reader->getCodecName(), "mp3");
+        EXPECT_EQ(reader->getDuration(), std::chrono::milliseconds{ static_cast<long long>(audioSize * 8.0 / 128 + 0.5) });
+        EXPECT_TRUE(reader->isDurationEstimated());
+
+        EXPECT_EQ(getTagValues(*reader, TagType::Artist), (std::vector<std::string>{ "MyArtist1", "MyArtist2" }));
+        EXPECT_EQ(getTagValues(*reader, TagType::TrackTitle), std::vector<std::string>{ "T\xC3\xA9" });
+        EXPECT_EQ(getTagValues(*reader, TagType::MusicBrainzReleaseID), std::vector<std::string>{ "7de7b4cb-0a4a-4ee6-8a6d-5f0cd3d5e1b7" });
+        EXPECT_EQ(getTagValues(*reader, TagType::Genre), std::vector<std::string>{ "Rock" });
+
+        std::vector<std::pair<std::string, std::string>> performers;
+        reader->visitPerformerTags([&](std::string_view role, std::string_view name) { performers.emplace_back(role, name); });
+        EXPECT_EQ(performers, (std::vector<std::pair<std::string, std::string>>{ { "PIANO", "MyPianist" } }));
+
+        ASSERT_TRUE(reader->hasEmbeddedCover());
+        EXPECT_EQ(getEmbeddedCovers(*reader), std::vector<std::string>{ "MyPicture" });
+    }
+
+    TEST(LightweightTagReader, mp3ExactAudioProperties)
+    {
+        Bytes file;
+        append(file, "ID3");
+        file.push_back(std::byte{ 4 });
+        file.push_back(std::byte{ 0 });
+        file.push_back(std::byte{ 0 });
+        const Bytes frames{ createId3v2TextFrame("TIT2", "MyTitle") };
+        appendSyncSafe(file, static_cast<std::uint32_t>(frames.size()));
+        file.insert(std::cend(file), std::cbegin(frames), std::cend(frames));
+
+        // VBR without Xing header: 50 frames at 128 kbps (417 bytes), then 50 frames at 64 kbps (208 bytes)
+        const std::size_t audioStart{ file.size() };
+        for (std::size_t i{}; i < 100; ++i)
+        {
+            const std::size_t frameStart{ file.size() };
+            appendBE(file, i < 50 ? 0xFFFB9000 : 0xFFFB5000, 4);
+            file.resize(frameStart + (i < 50 ? 417 : 208));
+        }
+        const std::size_t audioSize{ file.size() - audioStart };
+
+        const TemporaryFile tmpFile{ "test.mp3", file };
+        {
+            const std::unique_ptr<ITagReader> reader{ LightweightTagReader::create(tmpFile.getPath(), false) };
+            ASSERT_NE(reader, nullptr);
+            EXPECT_TRUE(reader->isDurationEstimated());
+            EXPECT_EQ(reader->getDuration(), std::chrono::milliseconds{ static_cast<long long>(audioSize * 8.0 / 128 + 0.5) });
+        }
+
+        const std::optional<AudioProperties> audioProperties{ LightweightTagReader::computeExactAudioProperties(tmpFile.getPath()) };
+        ASSERT_TRUE(audioProperties.has_value());
+        const double duration{ 100 * 1152 * 1000.0 / 44100 };
+        EXPECT_EQ(audioProperties->duration, std::chrono::milliseconds{ static_cast<long long>(duration + 0.5) });
+        EXPECT_EQ(audioProperties->bitrate, static_cast<std::size_t>(audioSize * 8.0 / duration + 0.5) * 1000);
+    }
+
+    TEST(LightweightTagReader, opus)
+    {
+        Bytes file;
+        {
+            Bytes header;
+            append(header, "OpusHead");
+            header.push_back(std::byte{ 1 }); // version
+            header.push_back(std::byte{ 2 }); // channels
+            appendLE(header, 312, 2); // pre skip
+            appendLE(header, 44100, 4); // input sample rate
+            appendLE(header, 0, 2); // gain
+            header.push_back(std::byte{ 0 }); // mapping family
+            appendOggPage(file, 0, 0, header);
+        }
+        {
+            Bytes tags;
+            append(tags, "OpusTags");
+            const Bytes vorbisComment{ createVorbisComment({ "TITLE=MyTitle", "METADATA_BLOCK_PICTURE=AAAAAwAAAAppbWFnZS9qcGVnAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAJTXlQaWN0dXJl" }) };
+            tags.insert(std::cend(tags), std::cbegin(vorbisComment), std::cend(vorbisComment));
+            appendOggPage(file, 0, 1, tags);
+        }
+        appendOggPage(file, 48000 * 5 + 312, 2, Bytes(1000));
+
+        const TemporaryFile tmpFile{ "test.opus", file };
+        const std::unique_ptr<ITagReader> reader{ LightweightTagReader::create(tmpFile.getPath(), false) };
+        ASSERT_NE(reader, nullptr);
+
+        EXPECT_EQ(reader->getDuration(), std::chrono::seconds{ 5 });
+        EXPECT_EQ(reader->getSampleRate(), 48000);
+        EXPECT_EQ(reader->getCodecName(), "opus");
+        EXPECT_EQ(reader->getContainerName(), "ogg");
+        EXPECT_FALSE(reader->hasMultiValuedTags());
+        EXPECT_EQ(getTagValues(*reader, TagType::TrackTitle), std::vector<std::string>{ "MyTitle" });
+
+        // pictures are not exposed as tags
+        bool visited{};
+        reader->visitTagValues("METADATA_BLOCK_PICTURE", [&](std::string_view) { visited = true; });
+        EXPECT_FALSE(visited);
+
+        ASSERT_TRUE(reader->hasEmbeddedCover());
+        EXPECT_EQ(getEmbeddedCovers(*reader), std::vector<std::string>{ "MyPicture" });
+    }
+
+    TEST(LightweightTagReader, unsupportedFiles)
+    {
+        {
+            Bytes file;
+            append(file, "fLaC");
+            file.resize(1000);
+
+            const TemporaryFile tmpFile{ "test.flac", file };
+            EXPECT_EQ(LightweightTagReader::computeExactAudioProperties(tmpFile.getPath()), std::nullopt);
+        }
+
+        {
+            Bytes file;
+            append(file, "RIFF");
+            file.resize(1000);
+
+            const TemporaryFile tmpFile{ "test.wav", file };
+            EXPECT_EQ(LightweightTagReader::create(tmpFile.getPath(), false), nullptr);
+        }
+
+        {
+            // ID3v2.2 tags are left to TagLib
+            Bytes file;
+            append(file, "ID3");
+            file.push_back(std::byte{ 2 });
+            file.resize(1000);
+
+            const TemporaryFile tmpFile{ "test.mp3", file };
+            EXPECT_EQ(LightweightTagReader::create(tmpFile.getPath(), false), nullptr);
+        }
+
+        {
+            // truncated
+            Bytes file;
+            append(file, "fLaC");
+            file.push_back(std::byte{ 0 });
+
+            const TemporaryFile tmpFile{ "test.flac", file };
+            EXPECT_EQ(LightweightTagReader::create(tmpFile.getPath(), false), nullptr);
+        }
+    }
+}
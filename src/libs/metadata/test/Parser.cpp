@@ -266,4 +266,26 @@ namespace MetaData
         EXPECT_EQ(track->languages[0], "Lang1");
         EXPECT_EQ(track->languages[1], "Lang2");
     }
+
+    TEST(Parser, embeddedCover)
+    {
+        const std::vector<std::byte> cover{ std::byte{ 0xFF }, std::byte{ 0xD8 }, std::byte{ 0xFF } };
+
+        TestTagReader testTags{ {} };
+        testTags.setEmbeddedCover(cover);
+
+        {
+            std::unique_ptr<Track> track{ Parser{}.parse(testTags) };
+            EXPECT_TRUE(track->hasCover);
+            EXPECT_TRUE(track->embeddedCover.empty());
+        }
+
+        {
+            Parser parser;
+            static_cast<IParser&>(parser).setExtractEmbeddedCover(true);
+            std::unique_ptr<Track> track{ parser.parse(testTags) };
+            EXPECT_TRUE(track->hasCover);
+            EXPECT_EQ(track->embeddedCover, cover);
+        }
+    }
 }
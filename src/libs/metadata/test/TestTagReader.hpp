@@ -44,6 +44,7 @@ namespace MetaData
         static constexpr std::size_t trackBitrate{ 128000 };
         static constexpr std::size_t trackBitsPerSample{ 16 };
         static constexpr std::size_t trackSampleRate{ 44000 };
+        static constexpr std::size_t trackChannelCount{ 2 };
 
         using Tags = std::unordered_map<TagType, std::vector<std::string_view>>;
         using Performers = std::unordered_map<std::string_view, std::vector<std::string_view>>;
@@ -91,17 +92,30 @@ namespace MetaData
             }
         }
 
-        bool hasEmbeddedCover() const override { return false; };
+        bool hasEmbeddedCover() const override { return !_embeddedCover.empty(); };
+        void visitEmbeddedCovers(EmbeddedCoverVisitor visitor) const override
+        {
+            if (!_embeddedCover.empty())
+                visitor(_embeddedCover);
+        }
+
+        void setEmbeddedCover(std::vector<std::byte> embeddedCover) { _embeddedCover = std::move(embeddedCover); }
 
         std::chrono::milliseconds 	getDuration() const override { return trackDuration; }
         std::size_t                 getBitrate() const override { return trackBitrate; }
         std::size_t                 getBitsPerSample() const override { return trackBitsPerSample; }
         std::size_t                 getSampleRate() const override { return trackSampleRate; }
+        std::size_t                 getChannelCount() const override { return trackChannelCount; }
+        std::string_view            getCodecName() const override { return "mp3"; }
+        std::string_view            getContainerName() const override { return "mp3"; }
+        std::optional<std::size_t>  getAudioStreamIndex() const override { return 0; }
+        bool                        isDurationEstimated() const override { return false; }
 
     private:
         const Tags _tags;
         const Performers _performers;
         const ExtraUserTags _extraUserTags;
         bool _hasMultiValuedTags;
+        std::vector<std::byte> _embeddedCover;
     };
 }
\ No newline at end of file
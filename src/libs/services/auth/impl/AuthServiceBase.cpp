@@ -36,6 +36,15 @@ namespace Auth
     UserId AuthServiceBase::getOrCreateUser(std::string_view loginName)
     {
         Session& session{ getDbSession() };
+
+        // Most of the time, the user already exists: avoid a write access
+        {
+            auto transaction{ session.createReadTransaction() };
+
+            if (const User::pointer user{ User::find(session, loginName) })
+                return user->getId();
+        }
+
         auto transaction{ session.createWriteTransaction() };
 
         User::pointer user{ User::find(session, loginName) };
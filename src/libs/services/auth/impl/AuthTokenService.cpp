@@ -100,30 +100,23 @@ namespace Auth
 	AuthTokenService::processAuthToken(const boost::asio::ip::address& clientAddress, std::string_view tokenValue)
 	{
 		// Do not waste too much resource on brute force attacks (optim)
-		{
-			std::shared_lock lock {_mutex};
-
-			if (_loginThrottler.isClientThrottled(clientAddress))
-				return AuthTokenProcessResult {AuthTokenProcessResult::State::Throttled};
-		}
+		if (_loginThrottler.isClientThrottled(clientAddress))
+			return AuthTokenProcessResult {AuthTokenProcessResult::State::Throttled};
 
 		auto res {processAuthToken(tokenValue)};
+		if (!res)
 		{
-			std::unique_lock lock {_mutex};
-
-			if (_loginThrottler.isClientThrottled(clientAddress))
+			if (!_loginThrottler.onBadClientAttempt(clientAddress))
 				return AuthTokenProcessResult {AuthTokenProcessResult::State::Throttled};
 
-			if (!res)
-			{
-				_loginThrottler.onBadClientAttempt(clientAddress);
-				return AuthTokenProcessResult {AuthTokenProcessResult::State::Denied};
-			}
-
-			_loginThrottler.onGoodClientAttempt(clientAddress);
-			onUserAuthenticated(res->userId);
-			return AuthTokenProcessResult {AuthTokenProcessResult::State::Granted, std::move(*res)};
+			return AuthTokenProcessResult {AuthTokenProcessResult::State::Denied};
 		}
+
+		if (!_loginThrottler.onGoodClientAttempt(clientAddress))
+			return AuthTokenProcessResult {AuthTokenProcessResult::State::Throttled};
+
+		onUserAuthenticated(res->userId);
+		return AuthTokenProcessResult {AuthTokenProcessResult::State::Granted, std::move(*res)};
 	}
 
 	void
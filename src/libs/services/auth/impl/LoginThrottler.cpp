@@ -21,8 +21,11 @@
 
 #include "LoginThrottler.hpp"
 
+#include <algorithm>
+#include <cassert>
+#include <functional>
+
 #include "utils/ILogger.hpp"
-#include "utils/Random.hpp"
 
 namespace Auth {
 
@@ -32,7 +35,7 @@ getAddressWithMask(const boost::asio::ip::address_v6& address, std::size_t prefi
 {
 	assert(prefix % 8 == 0);
 
-	std::array<uint8_t, 16> truncatedBytes;
+	std::array<uint8_t, 16> truncatedBytes {};
 
 	auto bytes {address.to_bytes()};
 	std::copy(std::cbegin(bytes), std::next(std::cbegin(bytes), prefix / 8), truncatedBytes.begin());
@@ -47,35 +50,100 @@ getAddressToThrottle(const boost::asio::ip::address& address)
 	return address.is_v6() ? getAddressWithMask(address.to_v6(), 64) : address;
 }
 
+LoginThrottler::LoginThrottler(std::size_t maxEntries)
+	: _maxEntriesPerShard {std::max<std::size_t>(maxEntries / _shardCount, 1)}
+{
+	const std::int64_t currentSlot {getSlot(Clock::now())};
+	for (Shard& shard : _shards)
+		shard.currentSlot = currentSlot;
+}
+
+std::int64_t
+LoginThrottler::getSlot(Clock::time_point time)
+{
+	return std::chrono::duration_cast<std::chrono::seconds>(time.time_since_epoch()) / _wheelSlotDuration;
+}
+
+bool
+LoginThrottler::isThrottled(const Shard& shard, const boost::asio::ip::address& address, Clock::time_point now)
+{
+	auto it {shard.attemptsInfo.find(address)};
+	if (it == shard.attemptsInfo.end())
+		return false;
+
+	return it->second.nextAttempt > now;
+}
+
+LoginThrottler::Shard&
+LoginThrottler::getShard(const boost::asio::ip::address& address)
+{
+	return _shards[std::hash<boost::asio::ip::address>{}(address) % _shardCount];
+}
+
+const LoginThrottler::Shard&
+LoginThrottler::getShard(const boost::asio::ip::address& address) const
+{
+	return _shards[std::hash<boost::asio::ip::address>{}(address) % _shardCount];
+}
+
 void
-LoginThrottler::removeOutdatedEntries()
+LoginThrottler::removeOutdatedEntries(Shard& shard, Clock::time_point now)
 {
-	const Wt::WDateTime now {Wt::WDateTime::currentDateTime()};
+	// Only the elapsed slots are processed: the entries of the current slot may not be expired yet
+	const std::int64_t nowSlot {getSlot(now)};
+	const std::int64_t slotCount {std::min<std::int64_t>(nowSlot - shard.currentSlot, _wheelSlotCount)};
 
-	for (auto it {std::begin(_attemptsInfo)}; it != std::end(_attemptsInfo); )
+	for (std::int64_t slot {shard.currentSlot}; slot < shard.currentSlot + slotCount; ++slot)
 	{
-		if (it->second.nextAttempt <= now)
-			it = _attemptsInfo.erase(it);
-		else
-			++it;
+		const std::size_t slotIndex {static_cast<std::size_t>(slot % _wheelSlotCount)};
+		std::vector<boost::asio::ip::address>& addresses {shard.expiryWheel[slotIndex]};
+
+		std::erase_if(addresses, [&](const boost::asio::ip::address& address)
+		{
+			auto it {shard.attemptsInfo.find(address)};
+			if (it == shard.attemptsInfo.end())
+				return true;
+
+			if (it->second.expiry <= now)
+			{
+				shard.attemptsInfo.erase(it);
+				return true;
+			}
+
+			// Still alive: only keep it if it is actually scheduled in this slot (later lap)
+			return static_cast<std::size_t>(getSlot(it->second.expiry) % _wheelSlotCount) != slotIndex;
+		});
 	}
+
+	shard.currentSlot = nowSlot;
 }
 
-void
+bool
 LoginThrottler::onBadClientAttempt(const boost::asio::ip::address& address)
 {
 	const boost::asio::ip::address clientAddress {getAddressToThrottle(address)};
-	const Wt::WDateTime now {Wt::WDateTime::currentDateTime()};
+	Shard& shard {getShard(clientAddress)};
+	const Clock::time_point now {Clock::now()};
+
+	const std::scoped_lock lock {shard.mutex};
+
+	removeOutdatedEntries(shard, now);
+	if (isThrottled(shard, clientAddress, now))
+		return false;
 
-	if (_attemptsInfo.size() >= _maxEntries)
-		removeOutdatedEntries();
-	if (_attemptsInfo.size() >= _maxEntries)
-		_attemptsInfo.erase(Random::pickRandom(_attemptsInfo));
+	auto it {shard.attemptsInfo.find(clientAddress)};
+	if (it == shard.attemptsInfo.end())
+	{
+		if (shard.attemptsInfo.size() >= _maxEntriesPerShard)
+			shard.attemptsInfo.erase(shard.attemptsInfo.begin());
+
+		it = shard.attemptsInfo.emplace(clientAddress, AttemptInfo {}).first;
+	}
 
-	AttemptInfo& attemptInfo {_attemptsInfo[address]};
-	if (attemptInfo.nextAttempt.isValid())
+	AttemptInfo& attemptInfo {it->second};
+	if (attemptInfo.nextAttempt != Clock::time_point {})
 	{
-		assert(attemptInfo.nextAttempt <= now); // should not be called if throttled
+		// previous throttling has ended
 		attemptInfo = {};
 	}
 
@@ -85,36 +153,44 @@ LoginThrottler::onBadClientAttempt(const boost::asio::ip::address& address)
 	if (attemptInfo.badConsecutiveAttemptCount >= _maxBadConsecutiveAttemptCount)
 	{
 		LMS_LOG(AUTH, DEBUG, "Throttling '" << clientAddress.to_string() << "'");
-		attemptInfo.nextAttempt = now.addMSecs(std::chrono::duration_cast<std::chrono::milliseconds>(_throttlingDuration).count());
+		attemptInfo.nextAttempt = now + _throttlingDuration;
+		attemptInfo.expiry = attemptInfo.nextAttempt;
 	}
 	else
 	{
-		attemptInfo.nextAttempt = {};
+		attemptInfo.expiry = now + _badAttemptRetentionDuration;
 	}
+
+	shard.expiryWheel[static_cast<std::size_t>(getSlot(attemptInfo.expiry) % _wheelSlotCount)].push_back(clientAddress);
+
+	return true;
 }
 
-void
+bool
 LoginThrottler::onGoodClientAttempt(const boost::asio::ip::address& address)
 {
 	const boost::asio::ip::address clientAddress {getAddressToThrottle(address)};
+	Shard& shard {getShard(clientAddress)};
+	const Clock::time_point now {Clock::now()};
+
+	const std::scoped_lock lock {shard.mutex};
+
+	if (isThrottled(shard, clientAddress, now))
+		return false;
 
-	_attemptsInfo.erase(clientAddress);
+	shard.attemptsInfo.erase(clientAddress);
+	return true;
 }
 
 bool
 LoginThrottler::isClientThrottled(const boost::asio::ip::address& address) const
 {
 	const boost::asio::ip::address clientAddress {getAddressToThrottle(address)};
+	const Shard& shard {getShard(clientAddress)};
 
-	auto it {_attemptsInfo.find(clientAddress)};
-	if (it == _attemptsInfo.end())
-		return false;
-
-	if (!it->second.nextAttempt.isValid())
-		return false;
+	const std::scoped_lock lock {shard.mutex};
 
-	return it->second.nextAttempt > Wt::WDateTime::currentDateTime();
+	return isThrottled(shard, clientAddress, Clock::now());
 }
 
 } // Auth
-
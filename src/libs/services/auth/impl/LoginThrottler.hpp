@@ -19,39 +19,69 @@
 
 #pragma once
 
+#include <array>
 #include <chrono>
+#include <cstdint>
+#include <mutex>
 #include <unordered_map>
-
-#include <Wt/WDateTime.h>
+#include <vector>
 
 #include "utils/NetAddress.hpp"
-#include "utils/Exception.hpp"
 
 namespace Auth
 {
+	// Thread safe: addresses are spread over independently locked shards
+	// Entries expire through a time wheel per shard, so that no full scan is needed
 	class LoginThrottler
 	{
 		public:
-			LoginThrottler(std::size_t maxEntries) : _maxEntries {maxEntries} {}
+			LoginThrottler(std::size_t maxEntries);
+
+			LoginThrottler(const LoginThrottler&) = delete;
+			LoginThrottler& operator=(const LoginThrottler&) = delete;
 
-			// user must lock these calls to avoid races
 			bool isClientThrottled(const boost::asio::ip::address& address) const;
-			void onBadClientAttempt(const boost::asio::ip::address& address);
-			void onGoodClientAttempt(const boost::asio::ip::address& address);
+			// Attempts are not registered if the client is throttled (returns false)
+			bool onBadClientAttempt(const boost::asio::ip::address& address);
+			bool onGoodClientAttempt(const boost::asio::ip::address& address);
 
 		private:
-			void removeOutdatedEntries();
+			using Clock = std::chrono::steady_clock;
 
-			const std::size_t _maxEntries;
 			static constexpr std::size_t _maxBadConsecutiveAttemptCount {5};
 			static constexpr std::chrono::seconds _throttlingDuration {3};
+			// Bad attempts older than this are forgotten
+			static constexpr std::chrono::seconds _badAttemptRetentionDuration {60};
+			static constexpr std::size_t _shardCount {16};
+			static constexpr std::chrono::seconds _wheelSlotDuration {1};
+			static constexpr std::size_t _wheelSlotCount {64}; // must cover the longest expiry
+			static_assert(_wheelSlotDuration * _wheelSlotCount > _badAttemptRetentionDuration);
+			static_assert(_wheelSlotDuration * _wheelSlotCount > _throttlingDuration);
 
 			struct AttemptInfo
 			{
-				Wt::WDateTime nextAttempt;
+				Clock::time_point nextAttempt; // throttled until then
+				Clock::time_point expiry;
 				std::size_t badConsecutiveAttemptCount{};
 			};
-			std::unordered_map<boost::asio::ip::address, AttemptInfo>	_attemptsInfo;
+
+			struct Shard
+			{
+				mutable std::mutex mutex;
+				std::unordered_map<boost::asio::ip::address, AttemptInfo> attemptsInfo;
+				// Addresses to check, by expiry slot. An address may be present several times, entries are only removed if actually expired
+				std::array<std::vector<boost::asio::ip::address>, _wheelSlotCount> expiryWheel;
+				std::int64_t currentSlot{};
+			};
+
+			static std::int64_t getSlot(Clock::time_point time);
+			static bool isThrottled(const Shard& shard, const boost::asio::ip::address& address, Clock::time_point now);
+
+			Shard& getShard(const boost::asio::ip::address& address);
+			const Shard& getShard(const boost::asio::ip::address& address) const;
+			void removeOutdatedEntries(Shard& shard, Clock::time_point now);
+
+			const std::size_t _maxEntriesPerShard;
+			std::array<Shard, _shardCount> _shards;
 	};
 } // Auth
-
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PasswordCheckCache.hpp"
+
+#include <Wt/Auth/HashFunction.h>
+#include <Wt/WRandom.h>
+
+#include "utils/ILogger.hpp"
+
+namespace Auth
+{
+    namespace
+    {
+        // Only used to compare passwords given by clients, never stored
+        const Wt::Auth::SHA1HashFunction digestFunction;
+    }
+
+    std::size_t PasswordCheckCache::KeyHash::operator()(const Key& key) const
+    {
+        std::size_t res{ std::hash<boost::asio::ip::address>{}(key.clientAddress) };
+        res ^= std::hash<std::string>{}(key.loginName) + 0x9e3779b9 + (res << 6) + (res >> 2);
+        res ^= std::hash<std::string>{}(key.passwordDigest) + 0x9e3779b9 + (res << 6) + (res >> 2);
+        return res;
+    }
+
+    PasswordCheckCache::PasswordCheckCache(std::size_t maxEntries, std::chrono::seconds ttl)
+        : _maxEntries{ maxEntries }
+        , _ttl{ ttl }
+        , _salt{ Wt::WRandom::generateId(32) }
+    {
+    }
+
+    std::optional<Database::UserId> PasswordCheckCache::find(const boost::asio::ip::address& clientAddress, std::string_view loginName, std::string_view password) const
+    {
+        auto it{ _entries.find(createKey(clientAddress, loginName, password)) };
+        if (it == std::cend(_entries))
+            return std::nullopt;
+
+        if (it->second.expiry <= std::chrono::steady_clock::now())
+            return std::nullopt;
+
+        return it->second.userId;
+    }
+
+    void PasswordCheckCache::add(const boost::asio::ip::address& clientAddress, std::string_view loginName, std::string_view password, Database::UserId userId, std::uint64_t invalidationCount)
+    {
+        if (_maxEntries == 0 || invalidationCount != _invalidationCount)
+            return;
+
+        if (_entries.size() >= _maxEntries)
+            removeOutdatedEntries();
+        if (_entries.size() >= _maxEntries)
+            _entries.clear();
+
+        _entries.insert_or_assign(createKey(clientAddress, loginName, password), Entry{ userId, std::chrono::steady_clock::now() + _ttl });
+    }
+
+    void PasswordCheckCache::invalidate(Database::UserId userId)
+    {
+        _invalidationCount++;
+        std::erase_if(_entries, [&](const auto& entry) { return entry.second.userId == userId; });
+    }
+
+    PasswordCheckCache::Key PasswordCheckCache::createKey(const boost::asio::ip::address& clientAddress, std::string_view loginName, std::string_view password) const
+    {
+        return Key{ clientAddress, std::string{ loginName }, digestFunction.compute(std::string{ password }, _salt) };
+    }
+
+    void PasswordCheckCache::removeOutdatedEntries()
+    {
+        const auto now{ std::chrono::steady_clock::now() };
+        std::erase_if(_entries, [&](const auto& entry) { return entry.second.expiry <= now; });
+    }
+} // namespace Auth
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "database/UserId.hpp"
+#include "utils/NetAddress.hpp"
+
+namespace Auth
+{
+    // Short lived cache of successful password checks, so that clients sending their credentials on each request
+    // do not trigger a full password verification each time
+    // Passwords are only kept as salted digests
+    class PasswordCheckCache
+    {
+    public:
+        PasswordCheckCache(std::size_t maxEntries, std::chrono::seconds ttl);
+
+        // user must lock these calls to avoid races
+        std::optional<Database::UserId> find(const boost::asio::ip::address& clientAddress, std::string_view loginName, std::string_view password) const;
+
+        // Successful checks are only added if no invalidation occurred since the check has started
+        std::uint64_t getInvalidationCount() const { return _invalidationCount; }
+        void add(const boost::asio::ip::address& clientAddress, std::string_view loginName, std::string_view password, Database::UserId userId, std::uint64_t invalidationCount);
+
+        void invalidate(Database::UserId userId);
+
+    private:
+        struct Key
+        {
+            boost::asio::ip::address clientAddress;
+            std::string loginName;
+            std::string passwordDigest;
+
+            bool operator==(const Key& other) const = default;
+        };
+
+        struct KeyHash
+        {
+            std::size_t operator()(const Key& key) const;
+        };
+
+        struct Entry
+        {
+            Database::UserId userId;
+            std::chrono::steady_clock::time_point expiry;
+        };
+
+        Key createKey(const boost::asio::ip::address& clientAddress, std::string_view loginName, std::string_view password) const;
+        void removeOutdatedEntries();
+
+        const std::size_t _maxEntries;
+        const std::chrono::seconds _ttl;
+        const std::string _salt;
+        std::uint64_t _invalidationCount{};
+        std::unordered_map<Key, Entry, KeyHash> _entries;
+    };
+} // namespace Auth
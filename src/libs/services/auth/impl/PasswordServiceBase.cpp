@@ -19,6 +19,10 @@
 
 #include "PasswordServiceBase.hpp"
 
+#include <algorithm>
+#include <cassert>
+
+#include <boost/asio/post.hpp>
 #include <Wt/Auth/HashFunction.h>
 #include <Wt/WRandom.h>
 
@@ -31,12 +35,22 @@
 #include "database/Session.hpp"
 #include "database/User.hpp"
 #include "utils/Exception.hpp"
+#include "utils/IConfig.hpp"
 #include "utils/ILogger.hpp"
+#include "utils/Service.hpp"
 
 namespace Auth
 {
 
 	static const Wt::Auth::SHA1HashFunction sha1Function;
+	static constexpr std::chrono::seconds passwordCheckCacheTTL {30};
+
+	static
+	std::size_t
+	getPasswordCheckThreadCount()
+	{
+		return std::max<std::size_t>(Service<IConfig>::get()->getULong("login-password-check-thread-count", 2), 1);
+	}
 
 	std::unique_ptr<IPasswordService>
 	createPasswordService(std::string_view passwordAuthenticationBackend, Database::Db& db, std::size_t maxThrottlerEntries, IAuthTokenService& authTokenService)
@@ -54,44 +68,143 @@ namespace Auth
 	PasswordServiceBase::PasswordServiceBase(Database::Db& db, std::size_t maxThrottlerEntries, IAuthTokenService& authTokenService)
 		: AuthServiceBase {db}
 		, _loginThrottler {maxThrottlerEntries}
+		, _passwordCheckCache {maxThrottlerEntries, passwordCheckCacheTTL}
 		, _authTokenService {authTokenService}
+		, _maxPendingChecksPerClient {std::max<std::size_t>(Service<IConfig>::get()->getULong("login-max-pending-checks-per-client", 4), 1)}
+		, _ioContextRunner {std::in_place, _ioService, getPasswordCheckThreadCount()}
 	{
 	}
 
-	PasswordServiceBase::CheckResult
-	PasswordServiceBase::checkUserPassword(const boost::asio::ip::address& clientAddress, std::string_view loginName, std::string_view password)
+	PasswordServiceBase::~PasswordServiceBase()
 	{
-		LMS_LOG(AUTH, DEBUG, "Checking password for user '" << loginName << "'");
+		stopPendingChecks();
+	}
 
+	void
+	PasswordServiceBase::stopPendingChecks()
+	{
+		_ioContextRunner.reset();
+	}
+
+	std::optional<PasswordServiceBase::CheckResult>
+	PasswordServiceBase::checkUserPasswordFast(const boost::asio::ip::address& clientAddress, std::string_view loginName, std::string_view password, std::uint64_t& passwordCheckCacheInvalidationCount)
+	{
 		// Do not waste too much resource on brute force attacks (optim)
-		{
-			std::shared_lock lock {_mutex};
+		if (_loginThrottler.isClientThrottled(clientAddress))
+			return CheckResult {CheckResult::State::Throttled};
+
+		std::shared_lock lock {_mutex};
+
+		// Clients usually send their credentials on each request: skip the full check if done recently
+		if (const std::optional<Database::UserId> userId {_passwordCheckCache.find(clientAddress, loginName, password)})
+			return CheckResult {CheckResult::State::Granted, *userId};
 
-			if (_loginThrottler.isClientThrottled(clientAddress))
+		passwordCheckCacheInvalidationCount = _passwordCheckCache.getInvalidationCount();
+		return std::nullopt;
+	}
+
+	PasswordServiceBase::CheckResult
+	PasswordServiceBase::onUserPasswordChecked(const boost::asio::ip::address& clientAddress, std::string_view loginName, std::string_view password, bool match, std::uint64_t passwordCheckCacheInvalidationCount)
+	{
+		if (!match)
+		{
+			if (!_loginThrottler.onBadClientAttempt(clientAddress))
 				return {CheckResult::State::Throttled};
+
+			return {CheckResult::State::Denied};
 		}
 
-		const bool match {checkUserPassword(loginName, password)};
+		if (!_loginThrottler.onGoodClientAttempt(clientAddress))
+			return {CheckResult::State::Throttled};
+
+		const Database::UserId userId {getOrCreateUser(loginName)};
+		onUserAuthenticated(userId);
 		{
 			std::unique_lock lock {_mutex};
+			_passwordCheckCache.add(clientAddress, loginName, password, userId, passwordCheckCacheInvalidationCount);
+		}
+		return {CheckResult::State::Granted, userId};
+	}
 
-			if (_loginThrottler.isClientThrottled(clientAddress))
-				return {CheckResult::State::Throttled};
+	PasswordServiceBase::CheckResult
+	PasswordServiceBase::checkUserPassword(const boost::asio::ip::address& clientAddress, std::string_view loginName, std::string_view password)
+	{
+		LMS_LOG(AUTH, DEBUG, "Checking password for user '" << loginName << "'");
 
-			if (match)
-			{
-				_loginThrottler.onGoodClientAttempt(clientAddress);
+		std::uint64_t passwordCheckCacheInvalidationCount {};
+		if (const std::optional<CheckResult> result {checkUserPasswordFast(clientAddress, loginName, password, passwordCheckCacheInvalidationCount)})
+			return *result;
+
+		const bool match {checkUserPassword(loginName, password)};
+		return onUserPasswordChecked(clientAddress, loginName, password, match, passwordCheckCacheInvalidationCount);
+	}
+
+	std::optional<PasswordServiceBase::CheckResult>
+	PasswordServiceBase::asyncCheckUserPassword(const boost::asio::ip::address& clientAddress, std::string_view loginName, std::string_view password, CheckCallback callback)
+	{
+		LMS_LOG(AUTH, DEBUG, "Checking password for user '" << loginName << "' (async)");
+
+		std::uint64_t passwordCheckCacheInvalidationCount {};
+		if (const std::optional<CheckResult> result {checkUserPasswordFast(clientAddress, loginName, password, passwordCheckCacheInvalidationCount)})
+			return *result;
 
-				const Database::UserId userId {getOrCreateUser(loginName)};
-				onUserAuthenticated(userId);
-				return {CheckResult::State::Granted, userId};
+		// Do not let a single client monopolize the check threads
+		if (!tryAcquirePendingCheck(clientAddress))
+		{
+			LMS_LOG(AUTH, DEBUG, "Too many pending password checks for '" << clientAddress.to_string() << "'");
+			return CheckResult {CheckResult::State::Throttled};
+		}
+
+		boost::asio::post(_ioService, [=, this, loginName = std::string {loginName}, password = std::string {password}, callback = std::move(callback)]
+		{
+			CheckResult result;
+			try
+			{
+				const bool match {checkUserPassword(loginName, password)};
+				result = onUserPasswordChecked(clientAddress, loginName, password, match, passwordCheckCacheInvalidationCount);
 			}
-			else
+			catch (const std::exception& e)
 			{
-				_loginThrottler.onBadClientAttempt(clientAddress);
-				return {CheckResult::State::Denied};
+				LMS_LOG(AUTH, ERROR, "Caught exception while checking password for user '" << loginName << "': " << e.what());
 			}
-		}
+
+			releasePendingCheck(clientAddress);
+			callback(result);
+		});
+
+		return std::nullopt;
+	}
+
+	bool
+	PasswordServiceBase::tryAcquirePendingCheck(const boost::asio::ip::address& clientAddress)
+	{
+		const std::scoped_lock lock {_pendingChecksMutex};
+
+		std::size_t& count {_pendingCheckCounts[clientAddress]};
+		if (count >= _maxPendingChecksPerClient)
+			return false;
+
+		count += 1;
+		return true;
+	}
+
+	void
+	PasswordServiceBase::releasePendingCheck(const boost::asio::ip::address& clientAddress)
+	{
+		const std::scoped_lock lock {_pendingChecksMutex};
+
+		auto it {_pendingCheckCounts.find(clientAddress)};
+		assert(it != std::end(_pendingCheckCounts));
+		if (--it->second == 0)
+			_pendingCheckCounts.erase(it);
+	}
+
+	void
+	PasswordServiceBase::onUserPasswordChanged(Database::UserId userId)
+	{
+		std::unique_lock lock {_mutex};
+
+		_passwordCheckCache.invalidate(userId);
 	}
 } // namespace Auth
 
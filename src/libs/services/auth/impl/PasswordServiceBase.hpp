@@ -19,11 +19,18 @@
 
 #pragma once
 
+#include <mutex>
+#include <optional>
 #include <shared_mutex>
+#include <unordered_map>
+
+#include <boost/asio/io_service.hpp>
 
 #include "services/auth/IPasswordService.hpp"
 #include "AuthServiceBase.hpp"
 #include "LoginThrottler.hpp"
+#include "PasswordCheckCache.hpp"
+#include "utils/IOContextRunner.hpp"
 
 namespace Database
 {
@@ -38,6 +45,7 @@ namespace Auth
 	{
 		public:
 			PasswordServiceBase(Database::Db& db, std::size_t maxThrottlerEntries, IAuthTokenService& authTokenService);
+			~PasswordServiceBase() override;
 
 			PasswordServiceBase(const PasswordServiceBase&) = delete;
 			PasswordServiceBase& operator=(const PasswordServiceBase&) = delete;
@@ -46,6 +54,9 @@ namespace Auth
 
 		protected:
 			IAuthTokenService&	getAuthTokenService() { return _authTokenService; }
+			void				onUserPasswordChanged(Database::UserId userId);
+			// Must be called by the derived classes' destructors, as the pending checks use checkUserPassword
+			void				stopPendingChecks();
 
 		private:
 			virtual bool	checkUserPassword(std::string_view loginName, std::string_view password) = 0;
@@ -53,10 +64,29 @@ namespace Auth
 			CheckResult		checkUserPassword(const boost::asio::ip::address& clientAddress,
 												std::string_view loginName,
 												std::string_view password) override;
+			std::optional<CheckResult>	asyncCheckUserPassword(const boost::asio::ip::address& clientAddress,
+														std::string_view loginName,
+														std::string_view password,
+														CheckCallback callback) override;
+
+			// Throttling and recent successful checks
+			std::optional<CheckResult>	checkUserPasswordFast(const boost::asio::ip::address& clientAddress, std::string_view loginName, std::string_view password, std::uint64_t& passwordCheckCacheInvalidationCount);
+			CheckResult					onUserPasswordChecked(const boost::asio::ip::address& clientAddress, std::string_view loginName, std::string_view password, bool match, std::uint64_t passwordCheckCacheInvalidationCount);
+
+			bool	tryAcquirePendingCheck(const boost::asio::ip::address& clientAddress);
+			void	releasePendingCheck(const boost::asio::ip::address& clientAddress);
 
-			std::shared_mutex			_mutex;
+			std::shared_mutex			_mutex; // protects _passwordCheckCache
 			LoginThrottler				_loginThrottler;
+			PasswordCheckCache			_passwordCheckCache;
 			IAuthTokenService&			_authTokenService;
+
+			const std::size_t			_maxPendingChecksPerClient;
+			std::mutex					_pendingChecksMutex;
+			std::unordered_map<boost::asio::ip::address, std::size_t> _pendingCheckCounts;
+
+			boost::asio::io_service			_ioService;
+			std::optional<IOContextRunner>	_ioContextRunner; // must be last, stopped first
 	};
 
 } // namespace Auth
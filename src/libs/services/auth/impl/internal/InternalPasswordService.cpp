@@ -41,6 +41,11 @@ namespace Auth
         _validator.setMinimumMatchLength(3);
     }
 
+    InternalPasswordService::~InternalPasswordService()
+    {
+        stopPendingChecks();
+    }
+
     bool InternalPasswordService::checkUserPassword(std::string_view loginName, std::string_view password)
     {
         LMS_LOG(AUTH, DEBUG, "Checking internal password for user '" << loginName << "'");
@@ -95,25 +100,30 @@ namespace Auth
     {
         const Database::User::PasswordHash passwordHash{ hashPassword(newPassword) };
 
-        Database::Session& session{ getDbSession() };
-        auto transaction{ session.createWriteTransaction() };
+        {
+            Database::Session& session{ getDbSession() };
+            auto transaction{ session.createWriteTransaction() };
+
+            Database::User::pointer user{ Database::User::find(session, userId) };
+            if (!user)
+                throw Exception{ "User not found!" };
 
-        Database::User::pointer user{ Database::User::find(session, userId) };
-        if (!user)
-            throw Exception{ "User not found!" };
+            switch (checkPasswordAcceptability(newPassword, PasswordValidationContext{ user->getLoginName(), user->getType() }))
+            {
+            case PasswordAcceptabilityResult::OK:
+                break;
+            case PasswordAcceptabilityResult::TooWeak:
+                throw PasswordTooWeakException{};
+            case PasswordAcceptabilityResult::MustMatchLoginName:
+                throw PasswordMustMatchLoginNameException{};
+            }
 
-        switch (checkPasswordAcceptability(newPassword, PasswordValidationContext{ user->getLoginName(), user->getType() }))
-        {
-        case PasswordAcceptabilityResult::OK:
-            break;
-        case PasswordAcceptabilityResult::TooWeak:
-            throw PasswordTooWeakException{};
-        case PasswordAcceptabilityResult::MustMatchLoginName:
-            throw PasswordMustMatchLoginNameException{};
+            user.modify()->setPasswordHash(passwordHash);
+            getAuthTokenService().clearAuthTokens(userId);
         }
 
-        user.modify()->setPasswordHash(passwordHash);
-        getAuthTokenService().clearAuthTokens(userId);
+        // the new password is now visible to the concurrent checks
+        onUserPasswordChanged(userId);
     }
 
     Database::User::PasswordHash InternalPasswordService::hashPassword(std::string_view password) const
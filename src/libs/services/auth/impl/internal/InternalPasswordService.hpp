@@ -34,6 +34,7 @@ namespace Auth
     {
     public:
         InternalPasswordService(Database::Db& db, std::size_t maxThrottlerEntries, IAuthTokenService& authTokenService);
+        ~InternalPasswordService() override;
 
     private:
         bool	checkUserPassword(std::string_view loginName, std::string_view password) override;
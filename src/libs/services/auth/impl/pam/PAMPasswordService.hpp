@@ -29,6 +29,7 @@ namespace Auth
 	{
 		public:
 			using PasswordServiceBase::PasswordServiceBase;
+			~PAMPasswordService() override { stopPendingChecks(); }
 
 		private:
 			bool	checkUserPassword(std::string_view loginName,std::string_view password) override;
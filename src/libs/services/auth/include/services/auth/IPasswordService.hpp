@@ -19,6 +19,7 @@
 
 #pragma once
 
+#include <functional>
 #include <string_view>
 #include <optional>
 
@@ -61,6 +62,15 @@ namespace Auth
 														std::string_view loginName,
 														std::string_view password) = 0;
 
+			// Same as checkUserPassword, but the slow password verifications are made on dedicated threads
+			// Returns the result if it is immediately available (throttled client, recent successful check)
+			// Otherwise, the callback is called from another thread once the check is done
+			using CheckCallback = std::function<void(const CheckResult&)>;
+			virtual std::optional<CheckResult>	asyncCheckUserPassword(const boost::asio::ip::address& clientAddress,
+																	std::string_view loginName,
+																	std::string_view password,
+																	CheckCallback callback) = 0;
+
 			virtual bool			canSetPasswords() const = 0;
 
 			enum class PasswordAcceptabilityResult
@@ -0,0 +1,277 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CoverFileCache.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <vector>
+
+#include "utils/ILogger.hpp"
+
+namespace Cover
+{
+    namespace
+    {
+        constexpr std::string_view tmpFileExtension{ ".tmp" };
+        // the recent temporary files may still be written by the other worker processes sharing the directory
+        constexpr std::chrono::minutes tmpFileMaxAge{ 10 };
+
+        std::optional<std::string_view> getMimeType(const std::filesystem::path& cacheFile)
+        {
+            const std::filesystem::path extension{ cacheFile.extension() };
+            if (extension == ".jpg")
+                return "image/jpeg";
+            if (extension == ".webp")
+                return "image/webp";
+            if (extension == ".embedded")
+                return "application/octet-stream"; // original embedded pictures, any format
+            if (extension == ".link")
+                return "application/octet-stream"; // content hash of the source picture of an entity
+
+            return std::nullopt;
+        }
+
+        class MappedEncodedImage : public Image::IEncodedImage
+        {
+        public:
+            MappedEncodedImage(void* data, std::size_t size, std::string_view mimeType)
+                : _data{ data }
+                , _size{ size }
+                , _mimeType{ mimeType }
+            {}
+
+            ~MappedEncodedImage() override
+            {
+                ::munmap(_data, _size);
+            }
+
+            MappedEncodedImage(const MappedEncodedImage&) = delete;
+            MappedEncodedImage& operator=(const MappedEncodedImage&) = delete;
+
+        private:
+            const std::byte* getData() const override { return static_cast<const std::byte*>(_data); }
+            std::size_t getDataSize() const override { return _size; }
+            std::string_view getMimeType() const override { return _mimeType; }
+
+            void* _data;
+            const std::size_t _size;
+            const std::string_view _mimeType;
+        };
+
+        std::shared_ptr<Image::IEncodedImage> mapFile(const std::filesystem::path& path, std::string_view mimeType)
+        {
+            const int fd{ ::open(path.c_str(), O_RDONLY | O_CLOEXEC) };
+            if (fd < 0)
+                return nullptr;
+
+            std::shared_ptr<Image::IEncodedImage> image;
+
+            struct stat fileStat;
+            if (::fstat(fd, &fileStat) == 0 && fileStat.st_size > 0)
+            {
+                // the mapping remains valid once the file is closed or even evicted
+                void* data{ ::mmap(nullptr, static_cast<std::size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, fd, 0) };
+                if (data != MAP_FAILED)
+                    image = std::make_shared<MappedEncodedImage>(data, static_cast<std::size_t>(fileStat.st_size), mimeType);
+            }
+
+            ::close(fd);
+            return image;
+        }
+    }
+
+    CoverFileCache::CoverFileCache(const std::filesystem::path& directory, std::size_t maxSize)
+        : _directory{ directory }
+        , _maxSize{ maxSize }
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(_directory, ec);
+        if (ec)
+            LMS_LOG(COVER, ERROR, "Cannot create cover cache directory '" << _directory.string() << "': " << ec.message());
+
+        loadEntries();
+
+        LMS_LOG(COVER, INFO, "Cover file cache: " << _entries.size() << " entries, size = " << _currentSize << "/" << _maxSize);
+    }
+
+    std::shared_ptr<Image::IEncodedImage> CoverFileCache::get(const std::string& key)
+    {
+        const std::filesystem::path cacheFile{ getCacheFile(key) };
+
+        const std::scoped_lock lock{ _mutex };
+
+        const std::optional<std::string_view> mimeType{ getMimeType(cacheFile) };
+        if (!mimeType)
+            return nullptr;
+
+        auto it{ _entriesByKey.find(key) };
+        if (it == std::cend(_entriesByKey))
+        {
+            // may have been written by another worker process sharing the directory
+            std::shared_ptr<Image::IEncodedImage> image{ mapFile(cacheFile, *mimeType) };
+            if (image)
+            {
+                _entries.push_front(Entry{ key, image->getDataSize() });
+                _entriesByKey[key] = std::begin(_entries);
+                _currentSize += image->getDataSize();
+                evict();
+            }
+
+            return image;
+        }
+
+        std::shared_ptr<Image::IEncodedImage> image{ mapFile(cacheFile, *mimeType) };
+        if (!image)
+        {
+            // removed behind our back
+            _currentSize -= it->second->size;
+            _entries.erase(it->second);
+            _entriesByKey.erase(it);
+            return nullptr;
+        }
+
+        _entries.splice(std::begin(_entries), _entries, it->second);
+
+        // used as access time, so that the eviction order survives restarts
+        std::error_code ec;
+        std::filesystem::last_write_time(cacheFile, std::filesystem::file_time_type::clock::now(), ec);
+
+        return image;
+    }
+
+    void CoverFileCache::put(const std::string& key, const Image::IEncodedImage& image)
+    {
+        const std::filesystem::path cacheFile{ getCacheFile(key) };
+        // written outside of the lock, concurrent writes of a same key (possibly by other worker processes) use their own temporary files
+        static std::atomic<std::size_t> tmpFileId{};
+        std::filesystem::path tmpFile{ cacheFile };
+        tmpFile.concat("." + std::to_string(::getpid()) + "." + std::to_string(tmpFileId++)).concat(tmpFileExtension);
+
+        {
+            std::ofstream ofs{ tmpFile, std::ios::out | std::ios::binary | std::ios::trunc };
+            ofs.write(reinterpret_cast<const char*>(image.getData()), image.getDataSize());
+            if (!ofs)
+            {
+                LMS_LOG(COVER, ERROR, "Cannot write cover cache file '" << tmpFile.string() << "'");
+                std::error_code ec;
+                std::filesystem::remove(tmpFile, ec);
+                return;
+            }
+        }
+
+        std::error_code ec;
+        std::filesystem::rename(tmpFile, cacheFile, ec);
+        if (ec)
+        {
+            LMS_LOG(COVER, ERROR, "Cannot move cover cache file '" << tmpFile.string() << "': " << ec.message());
+            std::filesystem::remove(tmpFile, ec);
+            return;
+        }
+
+        const std::scoped_lock lock{ _mutex };
+
+        if (auto it{ _entriesByKey.find(key) }; it != std::cend(_entriesByKey))
+        {
+            _currentSize -= it->second->size;
+            _entries.erase(it->second);
+            _entriesByKey.erase(it);
+        }
+
+        _entries.push_front(Entry{ key, image.getDataSize() });
+        _entriesByKey[key] = std::begin(_entries);
+        _currentSize += image.getDataSize();
+
+        evict();
+    }
+
+    std::filesystem::path CoverFileCache::getCacheFile(const std::string& key) const
+    {
+        return _directory / key;
+    }
+
+    void CoverFileCache::loadEntries()
+    {
+        struct FileInfo
+        {
+            std::string key;
+            std::size_t size;
+            std::filesystem::file_time_type lastWriteTime;
+        };
+        std::vector<FileInfo> files;
+
+        std::error_code ec;
+        for (const std::filesystem::directory_entry& dirEntry : std::filesystem::directory_iterator{ _directory, ec })
+        {
+            const std::filesystem::path& path{ dirEntry.path() };
+            if (!getMimeType(path))
+            {
+                // unfinished writes from a previous run
+                if (dirEntry.last_write_time(ec) < std::filesystem::file_time_type::clock::now() - tmpFileMaxAge)
+                    std::filesystem::remove(path, ec);
+                continue;
+            }
+
+            const auto size{ dirEntry.file_size(ec) };
+            if (ec)
+                continue;
+            const auto lastWriteTime{ dirEntry.last_write_time(ec) };
+            if (ec)
+                continue;
+
+            files.push_back(FileInfo{ path.filename().string(), static_cast<std::size_t>(size), lastWriteTime });
+        }
+
+        std::sort(std::begin(files), std::end(files), [](const FileInfo& lhs, const FileInfo& rhs) { return lhs.lastWriteTime > rhs.lastWriteTime; });
+
+        for (const FileInfo& file : files)
+        {
+            _entries.push_back(Entry{ file.key, file.size });
+            _entriesByKey.emplace(file.key, std::prev(std::end(_entries)));
+            _currentSize += file.size;
+        }
+
+        evict();
+    }
+
+    void CoverFileCache::evict()
+    {
+        while (_currentSize > _maxSize && !_entries.empty())
+        {
+            const Entry& entry{ _entries.back() };
+
+            // mapped images remain valid
+            std::error_code ec;
+            std::filesystem::remove(getCacheFile(entry.key), ec);
+
+            _currentSize -= entry.size;
+            _entriesByKey.erase(entry.key);
+            _entries.pop_back();
+        }
+    }
+} // namespace Cover
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "image/IEncodedImage.hpp"
+
+namespace Cover
+{
+    // On disk cache of resized covers, the least recently used entries are evicted first
+    // Keys are expected to change when the cover sources change: entries are never updated
+    // Keys are used as file names, their extension gives the image format (".jpg" or ".webp"), or the kind of raw data (".embedded", ".link")
+    class CoverFileCache
+    {
+    public:
+        CoverFileCache(const std::filesystem::path& directory, std::size_t maxSize);
+
+        CoverFileCache(const CoverFileCache&) = delete;
+        CoverFileCache& operator=(const CoverFileCache&) = delete;
+
+        // the returned image directly maps the cache file
+        std::shared_ptr<Image::IEncodedImage> get(const std::string& key);
+        void put(const std::string& key, const Image::IEncodedImage& image);
+
+    private:
+        std::filesystem::path getCacheFile(const std::string& key) const;
+        void loadEntries();
+        void evict(); // must be locked
+
+        const std::filesystem::path _directory;
+        const std::size_t _maxSize;
+
+        std::mutex _mutex;
+        struct Entry
+        {
+            std::string key;
+            std::size_t size;
+        };
+        using Entries = std::list<Entry>; // most recently used first
+        Entries _entries;
+        std::unordered_map<std::string, Entries::iterator> _entriesByKey;
+        std::size_t _currentSize{};
+    };
+} // namespace Cover
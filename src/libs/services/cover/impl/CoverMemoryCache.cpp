@@ -0,0 +1,174 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CoverMemoryCache.hpp"
+
+namespace Cover
+{
+    namespace
+    {
+        constexpr std::size_t protectedSegmentPercent{ 80 };
+    }
+
+    CoverMemoryCache::CoverMemoryCache(std::size_t maxSize)
+        : _maxShardSize{ maxSize / _shardCount }
+        , _maxShardProtectedSize{ _maxShardSize * protectedSegmentPercent / 100 }
+    {
+    }
+
+    std::shared_ptr<Image::IEncodedImage> CoverMemoryCache::get(const CacheEntryDesc& entryDesc)
+    {
+        Shard& shard{ getShard(entryDesc) };
+        std::scoped_lock lock{ shard.mutex };
+
+        auto it{ shard.entries.find(entryDesc) };
+        if (it == std::cend(shard.entries))
+        {
+            ++_misses;
+            return nullptr;
+        }
+
+        ++_hits;
+        promote(shard, it->second);
+        return it->second->image;
+    }
+
+    void CoverMemoryCache::put(const CacheEntryDesc& entryDesc, std::shared_ptr<Image::IEncodedImage> image)
+    {
+        const std::size_t imageSize{ image->getDataSize() };
+        if (imageSize > _maxShardSize)
+            return;
+
+        Shard& shard{ getShard(entryDesc) };
+        std::scoped_lock lock{ shard.mutex };
+
+        if (auto it{ shard.entries.find(entryDesc) }; it != std::cend(shard.entries))
+            erase(shard, it->second);
+
+        shard.probationEntries.push_front(Entry{ entryDesc, std::move(image), false });
+        shard.probationSize += imageSize;
+        shard.entries.emplace(entryDesc, std::begin(shard.probationEntries));
+
+        evict(shard);
+    }
+
+    void CoverMemoryCache::clear()
+    {
+        for (Shard& shard : _shards)
+        {
+            std::scoped_lock lock{ shard.mutex };
+
+            shard.entries.clear();
+            shard.probationEntries.clear();
+            shard.protectedEntries.clear();
+            shard.probationSize = 0;
+            shard.protectedSize = 0;
+        }
+
+        _hits = 0;
+        _misses = 0;
+        _evictions = 0;
+    }
+
+    CoverMemoryCache::Stats CoverMemoryCache::getStats() const
+    {
+        Stats stats;
+        stats.hits = _hits;
+        stats.misses = _misses;
+        stats.evictions = _evictions;
+
+        for (const Shard& shard : _shards)
+        {
+            std::scoped_lock lock{ shard.mutex };
+
+            stats.entryCount += shard.entries.size();
+            stats.size += shard.probationSize + shard.protectedSize;
+        }
+
+        return stats;
+    }
+
+    CoverMemoryCache::Shard& CoverMemoryCache::getShard(const CacheEntryDesc& entryDesc)
+    {
+        // mix the high bits in
+        std::size_t h{ std::hash<CacheEntryDesc>{}(entryDesc) };
+        h ^= h >> 17;
+        h *= 0x9E3779B97F4A7C15ULL;
+        h ^= h >> 31;
+
+        return _shards[h % _shardCount];
+    }
+
+    void CoverMemoryCache::promote(Shard& shard, EntryList::iterator itEntry)
+    {
+        if (itEntry->isProtected)
+        {
+            shard.protectedEntries.splice(std::begin(shard.protectedEntries), shard.protectedEntries, itEntry);
+            return;
+        }
+
+        const std::size_t imageSize{ itEntry->image->getDataSize() };
+        itEntry->isProtected = true;
+        shard.protectedEntries.splice(std::begin(shard.protectedEntries), shard.probationEntries, itEntry);
+        shard.probationSize -= imageSize;
+        shard.protectedSize += imageSize;
+
+        // demote the least recently used protected entries, they get a second chance in probation
+        while (shard.protectedSize > _maxShardProtectedSize)
+        {
+            auto itDemoted{ std::prev(std::end(shard.protectedEntries)) };
+            const std::size_t demotedSize{ itDemoted->image->getDataSize() };
+
+            itDemoted->isProtected = false;
+            shard.probationEntries.splice(std::begin(shard.probationEntries), shard.protectedEntries, itDemoted);
+            shard.protectedSize -= demotedSize;
+            shard.probationSize += demotedSize;
+        }
+    }
+
+    void CoverMemoryCache::erase(Shard& shard, EntryList::iterator itEntry)
+    {
+        const std::size_t imageSize{ itEntry->image->getDataSize() };
+
+        shard.entries.erase(itEntry->desc);
+        if (itEntry->isProtected)
+        {
+            shard.protectedSize -= imageSize;
+            shard.protectedEntries.erase(itEntry);
+        }
+        else
+        {
+            shard.probationSize -= imageSize;
+            shard.probationEntries.erase(itEntry);
+        }
+    }
+
+    void CoverMemoryCache::evict(Shard& shard)
+    {
+        while (shard.probationSize + shard.protectedSize > _maxShardSize)
+        {
+            if (!shard.probationEntries.empty())
+                erase(shard, std::prev(std::end(shard.probationEntries)));
+            else
+                erase(shard, std::prev(std::end(shard.protectedEntries)));
+
+            ++_evictions;
+        }
+    }
+} // namespace Cover
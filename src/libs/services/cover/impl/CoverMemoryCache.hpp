@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "image/IEncodedImage.hpp"
+
+namespace Cover
+{
+    // Hash of a source picture (embedded picture or image file)
+    // Entities sharing the same picture (ex: tracks of a release) get the same hash
+    struct ContentHash
+    {
+        std::uint64_t value{};
+
+        bool operator==(const ContentHash& other) const = default;
+    };
+
+    // Resized and encoded version of a source picture
+    struct CacheEntryDesc
+    {
+        ContentHash         contentHash;
+        std::size_t			size;
+        Image::ImageFormat  format;
+
+        bool operator==(const CacheEntryDesc& other) const
+        {
+            return contentHash == other.contentHash
+                && size == other.size
+                && format == other.format;
+        }
+    };
+} // ns Cover
+
+namespace std
+{
+    template<>
+    class hash<Cover::ContentHash>
+    {
+    public:
+        size_t operator()(const Cover::ContentHash& contentHash) const
+        {
+            return std::hash<std::uint64_t>()(contentHash.value);
+        }
+    };
+
+    template<>
+    class hash<Cover::CacheEntryDesc>
+    {
+    public:
+        size_t operator()(const Cover::CacheEntryDesc& e) const
+        {
+            size_t h{ std::hash<Cover::ContentHash>()(e.contentHash) };
+            h ^= std::hash<std::size_t>()(e.size) << 1;
+            h ^= std::hash<Image::ImageFormat>()(e.format) << 2;
+            return h;
+        }
+    };
+
+} // ns std
+
+namespace Cover
+{
+    // Size bounded, sharded segmented LRU cache
+    // New entries go to a probation segment and are promoted to the protected segment on their first hit,
+    // so that a burst of one-shot covers cannot evict the covers that are actually requested often
+    class CoverMemoryCache
+    {
+    public:
+        CoverMemoryCache(std::size_t maxSize);
+
+        CoverMemoryCache(const CoverMemoryCache&) = delete;
+        CoverMemoryCache& operator=(const CoverMemoryCache&) = delete;
+
+        std::shared_ptr<Image::IEncodedImage> get(const CacheEntryDesc& entryDesc);
+        void put(const CacheEntryDesc& entryDesc, std::shared_ptr<Image::IEncodedImage> image);
+        void clear();
+
+        struct Stats
+        {
+            std::size_t hits{};
+            std::size_t misses{};
+            std::size_t evictions{};
+            std::size_t entryCount{};
+            std::size_t size{};
+        };
+        Stats getStats() const;
+
+    private:
+        struct Entry
+        {
+            CacheEntryDesc desc;
+            std::shared_ptr<Image::IEncodedImage> image;
+            bool isProtected{};
+        };
+        using EntryList = std::list<Entry>;
+
+        struct Shard
+        {
+            mutable std::mutex mutex;
+            EntryList probationEntries; // most recently used first
+            EntryList protectedEntries; // most recently used first
+            std::unordered_map<CacheEntryDesc, EntryList::iterator> entries;
+            std::size_t probationSize{};
+            std::size_t protectedSize{};
+        };
+
+        Shard& getShard(const CacheEntryDesc& entryDesc);
+        void promote(Shard& shard, EntryList::iterator itEntry);
+        void erase(Shard& shard, EntryList::iterator itEntry);
+        void evict(Shard& shard);
+
+        static constexpr std::size_t _shardCount{ 16 };
+        const std::size_t _maxShardSize;
+        const std::size_t _maxShardProtectedSize;
+        std::array<Shard, _shardCount> _shards;
+
+        std::atomic<std::size_t> _hits{};
+        std::atomic<std::size_t> _misses{};
+        std::atomic<std::size_t> _evictions{};
+    };
+} // namespace Cover
@@ -19,12 +19,23 @@
 
 #include "CoverService.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <iomanip>
 #include <set>
+#include <sstream>
+#include <type_traits>
+
+#include <boost/asio/post.hpp>
 
 #include "av/IAudioFile.hpp"
 
 #include "database/Db.hpp"
 #include "database/Artist.hpp"
+#include "database/ImageFile.hpp"
 #include "database/Release.hpp"
 #include "database/Session.hpp"
 #include "database/Track.hpp"
@@ -33,8 +44,8 @@
 #include "image/IRawImage.hpp"
 #include "utils/IConfig.hpp"
 #include "utils/ILogger.hpp"
+#include "utils/IMetricsRegistry.hpp"
 #include "utils/Path.hpp"
-#include "utils/Random.hpp"
 #include "utils/String.hpp"
 #include "utils/Utils.hpp"
 
@@ -75,6 +86,91 @@ namespace Cover
             return res;
         }
 
+        // Non image data kept in the file cache (original embedded pictures, links)
+        class RawData : public Image::IEncodedImage
+        {
+        public:
+            RawData(std::span<const std::byte> data) : _data{ data } {}
+
+        private:
+            const std::byte* getData() const override { return _data.data(); }
+            std::size_t getDataSize() const override { return _data.size(); }
+            std::string_view getMimeType() const override { return "application/octet-stream"; } // not needed to decode
+
+            std::span<const std::byte> _data;
+        };
+
+        constexpr std::size_t maxContentHashCount{ 100'000 };
+
+        ContentHash computeContentHash(std::span<const std::byte> data)
+        {
+            ContentHash contentHash;
+            contentHash.value = std::hash<std::string_view>{}(std::string_view{ reinterpret_cast<const char*>(data.data()), data.size() });
+            contentHash.value ^= data.size() * 0x9E3779B97F4A7C15ULL;
+            return contentHash;
+        }
+
+        std::vector<std::byte> readFile(const std::filesystem::path& p)
+        {
+            std::ifstream ifs{ p, std::ios_base::binary };
+            if (!ifs)
+                throw Image::ImageException{ "Cannot open file" };
+
+            std::vector<std::byte> data;
+            ifs.seekg(0, std::ios::end);
+            data.resize(static_cast<std::size_t>(ifs.tellg()));
+            ifs.seekg(0, std::ios::beg);
+            if (!ifs.read(reinterpret_cast<char*>(data.data()), data.size()))
+                throw Image::ImageException{ "Cannot read file" };
+
+            return data;
+        }
+
+        // Runs computeFunc once for all the concurrent callers using the same key
+        // The result must be cached by computeFunc, as it is up to the next callers to find it
+        template<typename Key, typename Result, typename Hash, typename ComputeFunc>
+        Result computeOnce(std::mutex& mutex, std::unordered_map<Key, std::shared_future<Result>, Hash>& ongoingComputations, const Key& key, std::atomic<std::size_t>& coalescedCount, ComputeFunc computeFunc)
+        {
+            std::promise<Result> promise;
+            {
+                std::unique_lock lock{ mutex };
+
+                if (auto it{ ongoingComputations.find(key) }; it != std::cend(ongoingComputations))
+                {
+                    std::shared_future<Result> ongoingComputation{ it->second };
+                    lock.unlock();
+
+                    ++coalescedCount;
+                    return ongoingComputation.get();
+                }
+
+                ongoingComputations.emplace(key, promise.get_future().share());
+            }
+
+            Result result;
+            try
+            {
+                result = computeFunc();
+            }
+            catch (...)
+            {
+                {
+                    std::scoped_lock lock{ mutex };
+                    ongoingComputations.erase(key);
+                }
+                promise.set_exception(std::current_exception());
+                throw;
+            }
+
+            {
+                std::scoped_lock lock{ mutex };
+                ongoingComputations.erase(key);
+            }
+            promise.set_value(result);
+
+            return result;
+        }
+
         std::vector<std::string> constructPreferredFileNames()
         {
             std::vector<std::string> res;
@@ -101,12 +197,36 @@ namespace Cover
             return res;
         }
 
+        std::unique_ptr<CoverFileCache> createFileCache()
+        {
+            const std::size_t maxSize{ Service<IConfig>::get()->getULong("cover-file-cache-max-size", 256) * 1000 * 1000 };
+            if (maxSize == 0)
+                return nullptr;
+
+            return std::make_unique<CoverFileCache>(Service<IConfig>::get()->getPath("working-dir") / "cache" / "covers", maxSize);
+        }
+
+        std::size_t getThreadCount()
+        {
+            std::size_t threadCount{ Service<IConfig>::get()->getULong("cover-thread-count", 0) };
+            if (threadCount == 0)
+                threadCount = std::max<std::size_t>(std::thread::hardware_concurrency() / 2, 1);
+
+            return threadCount;
+        }
+
         bool isFileSupported(const std::filesystem::path& file, const std::vector<std::filesystem::path>& extensions)
         {
             return (std::find(std::cbegin(extensions), std::cend(extensions), file.extension()) != std::cend(extensions));
         }
     }
 
+    const std::vector<std::filesystem::path>& getSupportedImageFileExtensions()
+    {
+        static const std::vector<std::filesystem::path> fileExtensions{ ".jpg", ".jpeg", ".png", ".bmp" }; // TODO parametrize
+        return fileExtensions;
+    }
+
     std::unique_ptr<ICoverService> createCoverService(Database::Db& db, const std::filesystem::path& execPath, const std::filesystem::path& defaultCoverPath)
     {
         return std::make_unique<CoverService>(db, execPath, defaultCoverPath);
@@ -120,15 +240,33 @@ namespace Cover
         : _db{ db }
         , _defaultCoverPath{ defaultCoverPath }
         , _maxCacheSize{ Service<IConfig>::get()->getULong("cover-max-cache-size", 30) * 1000 * 1000 }
+        , _cache{ _maxCacheSize }
         , _maxFileSize{ Service<IConfig>::get()->getULong("cover-max-file-size", 10) * 1000 * 1000 }
         , _preferredFileNames{ constructPreferredFileNames() }
         , _artistFileNames{ constructArtistFileNames() }
+        , _webpQuality{ Utils::clamp<unsigned>(Service<IConfig>::get()->getULong("cover-webp-quality", 75), 1, 100) }
+        , _webpEnabled{ Service<IConfig>::get()->getBool("cover-webp-enabled", true) && isEncodingSupported(ImageFormat::WebP) }
+        , _fileCache{ createFileCache() }
+        , _ioContextRunner{ _ioService, getThreadCount() }
     {
         setJpegQuality(Service<IConfig>::get()->getULong("cover-jpeg-quality", 75));
 
+        if (Metrics::IRegistry * registry{ Service<Metrics::IRegistry>::get() })
+        {
+            _memoryCacheCounters.hits = &registry->getCounter("lms_cover_cache_hits_total", "Covers found in the cache", { { "cache", "memory" } });
+            _memoryCacheCounters.misses = &registry->getCounter("lms_cover_cache_misses_total", "Covers not found in the cache", { { "cache", "memory" } });
+            if (_fileCache)
+            {
+                _fileCacheCounters.hits = &registry->getCounter("lms_cover_cache_hits_total", "Covers found in the cache", { { "cache", "file" } });
+                _fileCacheCounters.misses = &registry->getCounter("lms_cover_cache_misses_total", "Covers not found in the cache", { { "cache", "file" } });
+            }
+        }
+
         LMS_LOG(COVER, INFO, "Default cover path = '" << _defaultCoverPath.string() << "'");
         LMS_LOG(COVER, INFO, "Max cache size = " << _maxCacheSize);
         LMS_LOG(COVER, INFO, "Max file size = " << _maxFileSize);
+        LMS_LOG(COVER, INFO, "Thread count = " << _ioContextRunner.getThreadCount());
+        LMS_LOG(COVER, INFO, "WebP output " << (_webpEnabled ? "enabled" : "disabled") << ", quality = " << _webpQuality);
         LMS_LOG(COVER, INFO, "Preferred file names: " << StringUtils::joinStrings(_preferredFileNames, ","));
 
 #if LMS_SUPPORT_IMAGE_GM
@@ -139,7 +277,7 @@ namespace Cover
 
         try
         {
-            getDefault(512);
+            getDefault(512, ImageFormat::JPEG);
         }
         catch (const Image::ImageException& e)
         {
@@ -147,20 +285,18 @@ namespace Cover
         }
     }
 
-    std::unique_ptr<IEncodedImage> CoverService::getFromAvMediaFile(const Av::IAudioFile& input, ImageSize width) const
+    CoverService::ResolvedCover CoverService::getFromAvMediaFile(const Av::IAudioFile& input, ImageSize width, ImageFormat format)
     {
-        std::unique_ptr<IEncodedImage> image;
+        ResolvedCover cover;
 
         input.visitAttachedPictures([&](const Av::Picture& picture)
             {
-                if (image)
+                if (cover.image)
                     return;
 
                 try
                 {
-                    std::unique_ptr<IRawImage> rawImage{ decodeImage(picture.data, picture.dataSize) };
-                    rawImage->resize(width);
-                    image = rawImage->encodeToJPEG(_jpegQuality);
+                    cover = processCover(std::span{ picture.data, picture.dataSize }, SourceKind::Embedded, width, format);
                 }
                 catch (const Image::ImageException& e)
                 {
@@ -168,145 +304,155 @@ namespace Cover
                 }
             });
 
-        return image;
+        return cover;
     }
 
-    std::unique_ptr<IEncodedImage> CoverService::getFromCoverFile(const std::filesystem::path& p, ImageSize width) const
+    CoverService::ResolvedCover CoverService::getFromCoverFile(const std::filesystem::path& p, ImageSize width, ImageFormat format)
     {
-        std::unique_ptr<IEncodedImage> image;
+        ResolvedCover cover;
 
         try
         {
-            std::unique_ptr<IRawImage> rawImage{ decodeImage(p) };
-            rawImage->resize(width);
-            image = rawImage->encodeToJPEG(_jpegQuality);
+            const std::vector<std::byte> source{ readFile(p) };
+            cover = processCover(source, SourceKind::File, width, format);
         }
         catch (const ImageException& e)
         {
             LMS_LOG(COVER, ERROR, "Cannot read cover in file '" << p.string() << "': " << e.what());
         }
 
-        return image;
+        return cover;
     }
 
-    std::shared_ptr<IEncodedImage> CoverService::getDefault(ImageSize width)
+    std::shared_ptr<IEncodedImage> CoverService::getDefault(ImageSize width, ImageFormat format)
     {
         {
-            std::shared_lock lock{ _cacheMutex };
+            std::shared_lock lock{ _defaultCoverCacheMutex };
 
-            if (auto it{ _defaultCoverCache.find(width) }; it != std::cend(_defaultCoverCache))
+            if (auto it{ _defaultCoverCache.find({ width, format }) }; it != std::cend(_defaultCoverCache))
                 return it->second;
         }
 
         {
-            std::unique_lock lock{ _cacheMutex };
+            std::unique_lock lock{ _defaultCoverCacheMutex };
 
-            if (auto it{ _defaultCoverCache.find(width) }; it != std::cend(_defaultCoverCache))
+            if (auto it{ _defaultCoverCache.find({ width, format }) }; it != std::cend(_defaultCoverCache))
                 return it->second;
 
-            std::shared_ptr<IEncodedImage> image{ getFromCoverFile(_defaultCoverPath, width) };
-            _defaultCoverCache[width] = image;
+            std::shared_ptr<IEncodedImage> image{ getFromCoverFile(_defaultCoverPath, width, format).image };
+            _defaultCoverCache[{ width, format }] = image;
             LMS_LOG(COVER, DEBUG, "Default cache entries = " << _defaultCoverCache.size());
 
             return image;
         }
     }
 
-    std::unique_ptr<IEncodedImage> CoverService::getFromDirectory(const std::filesystem::path& directory, ImageSize width, const std::vector<std::string>& preferredFileNames, bool allowPickRandom) const
+    CoverService::ResolvedCover CoverService::getFromDirectory(const std::filesystem::path& directory, ImageSize width, ImageFormat format, const std::vector<std::string>& preferredFileNames, bool allowPickRandom)
     {
         const std::multimap<std::string, std::filesystem::path> coverPaths{ getCoverPaths(directory) };
 
         auto tryLoadImageFromFilename = [&](std::string_view fileName)
             {
-                std::unique_ptr<IEncodedImage> image;
+                ResolvedCover cover;
 
                 auto range{ coverPaths.equal_range(std::string {fileName}) };
                 for (auto it{ range.first }; it != range.second; ++it)
                 {
-                    image = getFromCoverFile(it->second, width);
-                    if (image)
+                    cover = getFromCoverFile(it->second, width, format);
+                    if (cover.image)
                         break;
                 }
-                return image;
+                return cover;
             };
 
-        std::unique_ptr<IEncodedImage> image;
+        ResolvedCover cover;
 
         for (std::string_view filename : preferredFileNames)
         {
-            image = tryLoadImageFromFilename(filename);
-            if (image)
-                return image;
+            cover = tryLoadImageFromFilename(filename);
+            if (cover.image)
+                return cover;
         }
 
         if (allowPickRandom)
         {
             for (const auto& [filename, coverPath] : coverPaths)
             {
-                image = getFromCoverFile(coverPath, width);
-                if (image)
-                    return image;
+                cover = getFromCoverFile(coverPath, width, format);
+                if (cover.image)
+                    return cover;
             }
         }
 
-        return image;
+        return cover;
     }
 
-    std::unique_ptr<IEncodedImage> CoverService::getFromSameNamedFile(const std::filesystem::path& filePath, ImageSize width) const
+    CoverService::ResolvedCover CoverService::getFromSameNamedFile(const std::filesystem::path& filePath, ImageSize width, ImageFormat format)
     {
-        std::unique_ptr<IEncodedImage> res;
+        ResolvedCover res;
+
+        const std::vector<Database::ImageFile::Entry> imageFiles{ getImageFiles(filePath.parent_path()) };
 
         std::filesystem::path coverPath{ filePath };
-        for (const std::filesystem::path& extension : _fileExtensions)
+        for (const std::filesystem::path& extension : getSupportedImageFileExtensions())
         {
             coverPath.replace_extension(extension);
 
-            if (!checkCoverFile(coverPath))
+            auto itImageFile{ std::find_if(std::cbegin(imageFiles), std::cend(imageFiles), [&](const Database::ImageFile::Entry& imageFile) { return imageFile.path == coverPath; }) };
+            if (itImageFile == std::cend(imageFiles) || !checkCoverFile(*itImageFile))
                 continue;
 
-            res = getFromCoverFile(coverPath, width);
-            if (res)
+            res = getFromCoverFile(coverPath, width, format);
+            if (res.image)
                 break;
         }
 
         return res;
     }
 
-    bool CoverService::checkCoverFile(const std::filesystem::path& filePath) const
+    bool CoverService::checkCoverFile(const Database::ImageFile::Entry& imageFile) const
     {
-        std::error_code ec;
-
-        if (!isFileSupported(filePath, _fileExtensions))
-            return false;
-
-        if (!std::filesystem::exists(filePath, ec))
+        if (!isFileSupported(imageFile.path, getSupportedImageFileExtensions()))
             return false;
 
-        if (!std::filesystem::is_regular_file(filePath, ec))
-            return false;
-
-        if (std::filesystem::file_size(filePath, ec) > _maxFileSize && !ec)
+        if (imageFile.fileSize > _maxFileSize)
         {
-            LMS_LOG(COVER, INFO, "Image file '" << filePath.string() << " is too big (" << std::filesystem::file_size(filePath, ec) << "), limit is " << _maxFileSize);
+            LMS_LOG(COVER, INFO, "Image file '" << imageFile.path.string() << " is too big (" << imageFile.fileSize << "), limit is " << _maxFileSize);
             return false;
         }
 
         return true;
     }
 
-    std::multimap<std::string, std::filesystem::path> CoverService::getCoverPaths(const std::filesystem::path& directoryPath) const
+    std::vector<Database::ImageFile::Entry> CoverService::getImageFiles(const std::filesystem::path& directoryPath) const
     {
-        std::multimap<std::string, std::filesystem::path> res;
-        std::error_code ec;
+        std::vector<Database::ImageFile::Entry> res;
+
+        // Use the index of the scanner, unless it has not been built yet
+        {
+            Database::Session& session{ _db.getTLSSession() };
+            auto transaction{ session.createReadTransaction() };
 
+            if (Database::ImageFile::hasAny(session))
+            {
+                Database::ImageFile::visitDirectory(session, directoryPath, [&](const Database::ImageFile::Entry& entry) { res.push_back(entry); });
+                return res;
+            }
+        }
+
+        std::error_code ec;
         std::filesystem::directory_iterator itPath(directoryPath, ec);
         std::filesystem::directory_iterator itEnd;
         while (!ec && itPath != itEnd)
         {
             const std::filesystem::path& path{ *itPath };
 
-            if (checkCoverFile(path))
-                res.emplace(std::filesystem::path{ path }.filename().replace_extension("").string(), path);
+            if (isFileSupported(path, getSupportedImageFileExtensions()) && std::filesystem::is_regular_file(path, ec))
+            {
+                const auto fileSize{ std::filesystem::file_size(path, ec) };
+                if (!ec)
+                    res.push_back(Database::ImageFile::Entry{ path, static_cast<std::size_t>(fileSize) });
+            }
 
             itPath.increment(ec);
         }
@@ -314,73 +460,185 @@ namespace Cover
         return res;
     }
 
-    std::unique_ptr<IEncodedImage> CoverService::getFromTrack(const std::filesystem::path& p, ImageSize width) const
+    std::multimap<std::string, std::filesystem::path> CoverService::getCoverPaths(const std::filesystem::path& directoryPath) const
+    {
+        std::multimap<std::string, std::filesystem::path> res;
+
+        for (const Database::ImageFile::Entry& imageFile : getImageFiles(directoryPath))
+        {
+            if (checkCoverFile(imageFile))
+                res.emplace(std::filesystem::path{ imageFile.path }.filename().replace_extension("").string(), imageFile.path);
+        }
+
+        return res;
+    }
+
+    CoverService::ResolvedCover CoverService::getFromTrack(const std::filesystem::path& p, ImageSize width, ImageFormat format)
     {
-        std::unique_ptr<IEncodedImage> image;
+        ResolvedCover cover;
 
         try
         {
-            image = getFromAvMediaFile(*Av::parseAudioFile(p), width);
+            cover = getFromAvMediaFile(*Av::parseAudioFile(p), width, format);
         }
         catch (Av::Exception& e)
         {
             LMS_LOG(COVER, ERROR, "Cannot get covers from track " << p.string() << ": " << e.what());
         }
 
-        return image;
+        return cover;
     }
 
-    std::shared_ptr<IEncodedImage> CoverService::getFromTrack(Database::TrackId trackId, ImageSize width)
+    CoverService::ResolvedCover CoverService::getFromEmbeddedCoverStore(const std::filesystem::path& trackPath, ImageSize width, ImageFormat format)
     {
-        return getFromTrack(_db.getTLSSession(), trackId, width, true /* allow release fallback*/);
+        ResolvedCover cover;
+
+        const std::shared_ptr<IEncodedImage> embeddedCover{ loadFromFileCache(computeEmbeddedCoverFileCacheKey(trackPath)) };
+        if (!embeddedCover)
+            return cover;
+
+        try
+        {
+            cover = processCover(std::span{ embeddedCover->getData(), embeddedCover->getDataSize() }, SourceKind::Embedded, width, format);
+        }
+        catch (const Image::ImageException& e)
+        {
+            LMS_LOG(COVER, ERROR, "Cannot read stored embedded cover of track '" << trackPath.string() << "': " << e.what());
+        }
+
+        return cover;
     }
 
-    std::shared_ptr<IEncodedImage> CoverService::getFromTrack(Database::Session& dbSession, Database::TrackId trackId, ImageSize width, bool allowReleaseFallback)
+    CoverService::ResolvedCover CoverService::processCover(std::span<const std::byte> source, SourceKind sourceKind, ImageSize width, ImageFormat format)
     {
-        using namespace Database;
+        const CacheEntryDesc entryDesc{ computeContentHash(source), width, format };
+
+        return computeOnce(_ongoingComputationsMutex, _ongoingProcessings, entryDesc, _coalescedRequestCount, [&]
+            {
+                ResolvedCover cover{ loadFromCache(entryDesc), entryDesc.contentHash };
+                if (cover.image)
+                    return cover;
 
-        const CacheEntryDesc cacheEntryDesc{ trackId, width };
+                const auto start{ std::chrono::steady_clock::now() };
+                std::unique_ptr<IRawImage> rawImage{ decodeImage(source.data(), source.size(), width) };
+                rawImage->resize(width);
+                cover.image = rawImage->encodeTo(format, getQuality(format));
+
+                ProcessingCounters& counters{ _processingCounters[static_cast<std::size_t>(sourceKind)] };
+                counters.count++;
+                counters.sourceSize += source.size();
+                counters.duration += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+                saveToCache(entryDesc, cover.image);
+
+                return cover;
+            });
+    }
+
+    ICoverService::ProcessingStats CoverService::getProcessingStats(SourceKind sourceKind) const
+    {
+        const ProcessingCounters& counters{ _processingCounters[static_cast<std::size_t>(sourceKind)] };
+
+        ProcessingStats stats;
+        stats.count = counters.count;
+        stats.sourceSize = counters.sourceSize;
+        stats.duration = std::chrono::microseconds{ counters.duration };
+
+        return stats;
+    }
+
+    void CoverService::storeEmbeddedTrackCover(const std::filesystem::path& trackPath, std::span<const std::byte> data)
+    {
+        if (!_fileCache || data.empty() || data.size() > _maxFileSize)
+            return;
+
+        saveToFileCache(computeEmbeddedCoverFileCacheKey(trackPath), RawData{ data });
+    }
+
+    std::shared_ptr<IEncodedImage> CoverService::getFromTrack(Database::TrackId trackId, ImageSize width, ImageFormat format)
+    {
+        return getFromTrack(_db.getTLSSession(), trackId, width, format, true /* allow release fallback*/).image;
+    }
+
+    CoverService::ResolvedCover CoverService::getFromTrack(Database::Session& dbSession, Database::TrackId trackId, ImageSize width, ImageFormat format, bool allowReleaseFallback)
+    {
+        const EntityRequestDesc requestDesc{ trackId, width, format };
+
+        // results without release fallback are not shared with concurrent requests, as they may differ
+        if (!allowReleaseFallback)
+        {
+            ResolvedCover cover{ loadFromCache(requestDesc) };
+            if (!cover.image)
+            {
+                cover = computeTrackCover(dbSession, trackId, width, format, false);
+                if (cover.image)
+                    saveContentHash(requestDesc.id, cover.contentHash);
+            }
 
-        std::shared_ptr<IEncodedImage> cover{ loadFromCache(cacheEntryDesc) };
-        if (cover)
             return cover;
+        }
+
+        return getOrComputeCover(requestDesc, [&] { return computeTrackCover(dbSession, trackId, width, format, true); });
+    }
+
+    CoverService::ResolvedCover CoverService::computeTrackCover(Database::Session& dbSession, Database::TrackId trackId, ImageSize width, ImageFormat format, bool allowReleaseFallback)
+    {
+        ResolvedCover cover;
 
         if (const std::optional<TrackInfo> trackInfo{ getTrackInfo(dbSession, trackId) })
         {
-            if (trackInfo->hasCover)
-                cover = getFromTrack(trackInfo->trackPath, width);
+            const std::string linkKey{ computeLinkFileCacheKey("track", trackId.toString(), { trackInfo->trackPath, trackInfo->trackPath.parent_path() }) };
+            cover = loadFromLink(linkKey, width, format);
+            if (!cover.image)
+            {
+                if (trackInfo->hasCover)
+                {
+                    cover = getFromEmbeddedCoverStore(trackInfo->trackPath, width, format);
+                    if (!cover.image)
+                        cover = getFromTrack(trackInfo->trackPath, width, format);
+                }
+
+                if (!cover.image)
+                    cover = getFromSameNamedFile(trackInfo->trackPath, width, format);
 
-            if (!cover)
-                cover = getFromSameNamedFile(trackInfo->trackPath, width);
+                // release covers are linked on their own
+                if (cover.image)
+                    saveLinkToFileCache(linkKey, cover.contentHash);
+            }
 
-            if (!cover && trackInfo->releaseId && allowReleaseFallback)
-                cover = getFromRelease(*trackInfo->releaseId, width);
+            if (!cover.image && trackInfo->releaseId && allowReleaseFallback)
+                cover = resolveReleaseCover(*trackInfo->releaseId, width, format);
 
-            if (!cover && trackInfo->isMultiDisc)
+            if (!cover.image && trackInfo->isMultiDisc)
             {
                 if (trackInfo->trackPath.parent_path().has_parent_path())
-                    cover = getFromDirectory(trackInfo->trackPath.parent_path().parent_path(), width, _preferredFileNames, true);
+                    cover = getFromDirectory(trackInfo->trackPath.parent_path().parent_path(), width, format, _preferredFileNames, true);
             }
         }
 
-        if (cover)
-            saveToCache(cacheEntryDesc, cover);
-
         return cover;
     }
 
-    std::shared_ptr<IEncodedImage> CoverService::getFromRelease(Database::ReleaseId releaseId, ImageSize width)
+    std::shared_ptr<IEncodedImage> CoverService::getFromRelease(Database::ReleaseId releaseId, ImageSize width, ImageFormat format)
+    {
+        return resolveReleaseCover(releaseId, width, format).image;
+    }
+
+    CoverService::ResolvedCover CoverService::resolveReleaseCover(Database::ReleaseId releaseId, ImageSize width, ImageFormat format)
+    {
+        return getOrComputeCover(EntityRequestDesc{ releaseId, width, format }, [&] { return computeReleaseCover(releaseId, width, format); });
+    }
+
+    CoverService::ResolvedCover CoverService::computeReleaseCover(Database::ReleaseId releaseId, ImageSize width, ImageFormat format)
     {
         using namespace Database;
-        const CacheEntryDesc cacheEntryDesc{ releaseId, width };
 
-        std::shared_ptr<IEncodedImage> cover{ loadFromCache(cacheEntryDesc) };
-        if (cover)
-            return cover;
+        ResolvedCover cover;
 
         struct ReleaseInfo
         {
             TrackId firstTrackId;
+            std::filesystem::path firstTrackPath;
             std::filesystem::path releaseDirectory;
         };
 
@@ -399,6 +657,7 @@ namespace Cover
                 const Track::pointer& track{ tracks.results.front() };
                 res = ReleaseInfo{};
                 res->firstTrackId = track->getId();
+                res->firstTrackPath = track->getPath();
                 res->releaseDirectory = track->getPath().parent_path();
             }
 
@@ -407,25 +666,32 @@ namespace Cover
 
         if (const std::optional<ReleaseInfo> releaseInfo{ getReleaseInfo() })
         {
-            cover = getFromDirectory(releaseInfo->releaseDirectory, width, _preferredFileNames, true);
-            if (!cover)
-                cover = getFromTrack(session, releaseInfo->firstTrackId, width, false /* no release fallback */);
-        }
+            const std::string linkKey{ computeLinkFileCacheKey("release", releaseId.toString(), { releaseInfo->releaseDirectory, releaseInfo->firstTrackPath }) };
+            cover = loadFromLink(linkKey, width, format);
+            if (!cover.image)
+            {
+                cover = getFromDirectory(releaseInfo->releaseDirectory, width, format, _preferredFileNames, true);
+                if (!cover.image)
+                    cover = getFromTrack(session, releaseInfo->firstTrackId, width, format, false /* no release fallback */);
 
-        if (cover)
-            saveToCache(cacheEntryDesc, cover);
+                if (cover.image)
+                    saveLinkToFileCache(linkKey, cover.contentHash);
+            }
+        }
 
         return cover;
     }
 
-    std::shared_ptr<IEncodedImage> CoverService::getFromArtist(Database::ArtistId artistId, ImageSize width)
+    std::shared_ptr<IEncodedImage> CoverService::getFromArtist(Database::ArtistId artistId, ImageSize width, ImageFormat format)
+    {
+        return getOrComputeCover(EntityRequestDesc{ artistId, width, format }, [&] { return computeArtistImage(artistId, width, format); }).image;
+    }
+
+    CoverService::ResolvedCover CoverService::computeArtistImage(Database::ArtistId artistId, ImageSize width, ImageFormat format)
     {
         using namespace Database;
-        const CacheEntryDesc cacheEntryDesc{ artistId, width };
 
-        std::shared_ptr<IEncodedImage> artistImage{ loadFromCache(cacheEntryDesc) };
-        if (artistImage)
-            return artistImage;
+        ResolvedCover artistImage;
 
         std::string artistName;
         std::string artistMBID;
@@ -449,20 +715,34 @@ namespace Cover
             Track::FindParameters params;
             params.setArtist(artistId, { TrackArtistLinkType::ReleaseArtist });
 
-            Track::find(session, params, [&](const Track::pointer& track)
+            Track::findSummaries(session, params, [&](const Track::Summary& track)
                 {
                     Artist::FindParameters artistFindParams;
-                    artistFindParams.setTrack(track->getId());
+                    artistFindParams.setTrack(track.trackId);
                     artistFindParams.setLinkType(TrackArtistLinkType::ReleaseArtist);
 
                     const auto releaseArtists{ Artist::findIds(session, artistFindParams) };
                     if (releaseArtists.results.size() == 1)
-                        releasePaths.insert(track->getPath().parent_path());
+                        releasePaths.insert(track.path.parent_path());
                     else
-                        multiArtistReleasePaths.insert(track->getPath().parent_path());
+                        multiArtistReleasePaths.insert(track.path.parent_path());
                 });
         }
 
+        std::vector<std::filesystem::path> artistImageSources;
+        for (const std::set<std::filesystem::path>* paths : { &releasePaths, &multiArtistReleasePaths })
+        {
+            for (const std::filesystem::path& path : *paths)
+            {
+                artistImageSources.push_back(path);
+                artistImageSources.push_back(path.parent_path());
+            }
+        }
+        const std::string linkKey{ computeLinkFileCacheKey("artist", artistId.toString(), artistImageSources) };
+        artistImage = loadFromLink(linkKey, width, format);
+        if (artistImage.image)
+            return artistImage;
+
         std::vector<std::string> artistFileNames;
         if (!artistMBID.empty())
             artistFileNames.push_back(artistMBID);
@@ -479,7 +759,7 @@ namespace Cover
         if (!releasePaths.empty())
         {
             const std::filesystem::path artistPath{ releasePaths.size() == 1 ? releasePaths.begin()->parent_path() : PathUtils::getLongestCommonPath(std::cbegin(releasePaths), std::cend(releasePaths)) };
-            artistImage = getFromDirectory(artistPath, width, artistFileNamesWithGenericNames, false);
+            artistImage = getFromDirectory(artistPath, width, format, artistFileNamesWithGenericNames, false);
         }
 
         // Expect layout like this:
@@ -487,12 +767,12 @@ namespace Cover
         //                      /artist-mbid.jpg
         //                      /artist-name.jpg
         //                      /artist.jpg
-        if (!artistImage)
+        if (!artistImage.image)
         {
             for (const std::filesystem::path& releasePath : releasePaths)
             {
-                artistImage = getFromDirectory(releasePath, width, artistFileNamesWithGenericNames, false);
-                if (artistImage)
+                artistImage = getFromDirectory(releasePath, width, format, artistFileNamesWithGenericNames, false);
+                if (artistImage.image)
                     break;
             }
         }
@@ -502,31 +782,108 @@ namespace Cover
         // ReleaseArtist/Release/Tracks'
         //                      /artist-name.jpg
         //                      /artist-mbid.jpg
-        if (!artistImage)
+        if (!artistImage.image)
         {
             for (const std::filesystem::path& releasePath : multiArtistReleasePaths)
             {
-                artistImage = getFromDirectory(releasePath, width, artistFileNames, false);
-                if (artistImage)
+                artistImage = getFromDirectory(releasePath, width, format, artistFileNames, false);
+                if (artistImage.image)
                     break;
             }
         }
 
-        if (artistImage)
-            saveToCache(cacheEntryDesc, artistImage);
+        if (artistImage.image)
+            saveLinkToFileCache(linkKey, artistImage.contentHash);
 
         return artistImage;
     }
 
-    void CoverService::flushCache()
+    CoverService::ResolvedCover CoverService::getOrComputeCover(const EntityRequestDesc& requestDesc, const std::function<ResolvedCover()>& computeFunc)
+    {
+        if (ResolvedCover cover{ loadFromCache(requestDesc) }; cover.image)
+            return cover;
+
+        return computeOnce(_ongoingComputationsMutex, _ongoingComputations, requestDesc, _coalescedRequestCount, [&]
+            {
+                // the link must be saved before the computation is no longer visible to other requests
+                ResolvedCover cover{ computeFunc() };
+                if (cover.image)
+                    saveContentHash(requestDesc.id, cover.contentHash);
+
+                return cover;
+            });
+    }
+
+    std::size_t CoverService::EntityRequestDescHash::operator()(const EntityRequestDesc& desc) const
+    {
+        std::size_t h{ std::hash<EntityId>{}(desc.id) };
+        h ^= std::hash<ImageSize>{}(desc.width) << 1;
+        h ^= std::hash<ImageFormat>{}(desc.format) << 2;
+        return h;
+    }
+
+    void CoverService::asyncGetFromTrack(Database::TrackId trackId, ImageSize width, ImageFormat format, CoverCallback callback)
+    {
+        postCoverRequest([this, trackId, width, format] { return getFromTrack(trackId, width, format); }, std::move(callback));
+    }
+
+    void CoverService::asyncGetFromRelease(Database::ReleaseId releaseId, ImageSize width, ImageFormat format, CoverCallback callback)
+    {
+        postCoverRequest([this, releaseId, width, format] { return getFromRelease(releaseId, width, format); }, std::move(callback));
+    }
+
+    void CoverService::asyncGetFromArtist(Database::ArtistId artistId, ImageSize width, ImageFormat format, CoverCallback callback)
     {
-        std::unique_lock lock{ _cacheMutex };
+        postCoverRequest([this, artistId, width, format] { return getFromArtist(artistId, width, format); }, std::move(callback));
+    }
+
+    void CoverService::postCoverRequest(std::function<std::shared_ptr<IEncodedImage>()> getCoverFunc, CoverCallback callback)
+    {
+        boost::asio::post(_ioService, [getCoverFunc = std::move(getCoverFunc), callback = std::move(callback)]
+            {
+                std::shared_ptr<IEncodedImage> cover;
+                try
+                {
+                    cover = getCoverFunc();
+                }
+                catch (const std::exception& e)
+                {
+                    LMS_LOG(COVER, ERROR, "Cannot get cover: " << e.what());
+                }
+
+                callback(std::move(cover));
+            });
+    }
 
-        LMS_LOG(COVER, DEBUG, "Cache stats: hits = " << _cacheHits << ", misses = " << _cacheMisses << ", nb entries = " << _cache.size() << ", size = " << _cacheSize);
-        _cacheHits = 0;
-        _cacheMisses = 0;
-        _cacheSize = 0;
+    void CoverService::flushCache()
+    {
+        const CoverMemoryCache::Stats stats{ _cache.getStats() };
+        LMS_LOG(COVER, DEBUG, "Cache stats: hits = " << stats.hits << ", misses = " << stats.misses << ", evictions = " << stats.evictions << ", nb entries = " << stats.entryCount << ", size = " << stats.size << ", coalesced requests = " << _coalescedRequestCount);
+        _coalescedRequestCount = 0;
         _cache.clear();
+
+        std::unique_lock lock{ _contentHashesMutex };
+        _contentHashes.clear();
+    }
+
+    void CoverService::invalidate(std::span<const Database::TrackId> tracks, std::span<const Database::ReleaseId> releases, std::span<const Database::ArtistId> artists)
+    {
+        // resized covers are keyed by their content and cannot be stale: only the links need to be removed
+        std::size_t removedCount{};
+        {
+            std::unique_lock lock{ _contentHashesMutex };
+
+            auto erase{ [&](auto ids)
+            {
+                for (auto id : ids)
+                    removedCount += _contentHashes.erase(id);
+            } };
+            erase(tracks);
+            erase(releases);
+            erase(artists);
+        }
+
+        LMS_LOG(COVER, DEBUG, "Invalidated " << removedCount << " cache entries (" << tracks.size() << " tracks, " << releases.size() << " releases, " << artists.size() << " artists)");
     }
 
     void CoverService::setJpegQuality(unsigned quality)
@@ -536,35 +893,185 @@ namespace Cover
         LMS_LOG(COVER, INFO, "JPEG export quality = " << _jpegQuality);
     }
 
+    unsigned CoverService::getQuality(ImageFormat format) const
+    {
+        return format == ImageFormat::WebP ? _webpQuality : _jpegQuality;
+    }
+
+    ImageFormat CoverService::getPreferredFormat(std::string_view httpAcceptHeader) const
+    {
+        if (!_webpEnabled)
+            return ImageFormat::JPEG;
+
+        // ex: "image/avif,image/webp,*/*;q=0.8"
+        for (std::string_view mediaRange : StringUtils::splitString(httpAcceptHeader, ','))
+        {
+            const std::vector<std::string_view> params{ StringUtils::splitString(mediaRange, ';') };
+            if (params.empty() || !StringUtils::stringCaseInsensitiveEqual(StringUtils::stringTrim(params.front()), "image/webp"))
+                continue;
+
+            const bool refused{ std::any_of(std::next(std::cbegin(params)), std::cend(params), [](std::string_view param)
+                {
+                    param = StringUtils::stringTrim(param);
+                    return param.starts_with("q=") && StringUtils::readAs<float>(param.substr(2)).value_or(1) == 0;
+                }) };
+
+            return refused ? ImageFormat::JPEG : ImageFormat::WebP;
+        }
+
+        return ImageFormat::JPEG;
+    }
+
     void CoverService::saveToCache(const CacheEntryDesc& entryDesc, std::shared_ptr<IEncodedImage> image)
     {
-        std::unique_lock lock{ _cacheMutex };
+        saveToFileCache(computeFileCacheKey(entryDesc), *image);
+        _cache.put(entryDesc, std::move(image));
+    }
 
-        while (_cacheSize + image->getDataSize() > _maxCacheSize && !_cache.empty())
+    std::string CoverService::computeLinkFileCacheKey(std::string_view type, std::string_view id, const std::vector<std::filesystem::path>& sources) const
+    {
+        // covers are not tracked in the database: rely on the modification times to detect source changes
+        std::ostringstream oss;
+        oss << type << '\n' << id;
+        for (const std::filesystem::path& source : sources)
         {
-            auto itRandom{ Random::pickRandom(_cache) };
-            _cacheSize -= itRandom->second->getDataSize();
-            _cache.erase(itRandom);
+            std::error_code ec;
+            const auto lastWriteTime{ std::filesystem::last_write_time(source, ec) };
+            oss << '\n' << source.string() << '\n' << (ec ? 0 : lastWriteTime.time_since_epoch().count());
         }
 
-        _cacheSize += image->getDataSize();
-        _cache[entryDesc] = image;
+        std::ostringstream key;
+        key << std::hex << std::setw(16) << std::setfill('0') << std::hash<std::string>{}(oss.str()) << ".link";
+        return key.str();
     }
 
-    std::shared_ptr<IEncodedImage> CoverService::loadFromCache(const CacheEntryDesc& entryDesc)
+    std::string CoverService::computeFileCacheKey(const CacheEntryDesc& entryDesc) const
+    {
+        std::ostringstream oss;
+        oss << "content\n" << entryDesc.contentHash.value << '\n' << entryDesc.size << '\n' << static_cast<int>(entryDesc.format) << '\n' << getQuality(entryDesc.format);
+
+        std::ostringstream key;
+        key << std::hex << std::setw(16) << std::setfill('0') << std::hash<std::string>{}(oss.str());
+        key << (entryDesc.format == ImageFormat::WebP ? ".webp" : ".jpg");
+        return key.str();
+    }
+
+    std::optional<ContentHash> CoverService::loadLinkFromFileCache(const std::string& key)
+    {
+        const std::shared_ptr<IEncodedImage> link{ loadFromFileCache(key) };
+        if (!link || link->getDataSize() != sizeof(ContentHash::value))
+            return std::nullopt;
+
+        ContentHash contentHash;
+        std::memcpy(&contentHash.value, link->getData(), sizeof(contentHash.value));
+        return contentHash;
+    }
+
+    void CoverService::saveLinkToFileCache(const std::string& key, ContentHash contentHash)
+    {
+        saveToFileCache(key, RawData{ std::as_bytes(std::span{ &contentHash.value, 1 }) });
+    }
+
+    CoverService::ResolvedCover CoverService::loadFromLink(const std::string& linkKey, ImageSize width, ImageFormat format)
     {
-        std::shared_lock lock{ _cacheMutex };
+        ResolvedCover cover;
 
-        auto it{ _cache.find(entryDesc) };
-        if (it == std::cend(_cache))
+        if (const std::optional<ContentHash> contentHash{ loadLinkFromFileCache(linkKey) })
         {
-            ++_cacheMisses;
+            cover.contentHash = *contentHash;
+            cover.image = loadFromCache(CacheEntryDesc{ *contentHash, width, format });
+        }
+
+        return cover;
+    }
+
+    std::string CoverService::computeEmbeddedCoverFileCacheKey(const std::filesystem::path& trackPath) const
+    {
+        // the track modification time is part of the key: stored pictures of modified tracks are never used again and end up evicted
+        std::error_code ec;
+        const auto lastWriteTime{ std::filesystem::last_write_time(trackPath, ec) };
+
+        std::ostringstream oss;
+        oss << "embedded\n" << trackPath.string() << '\n' << (ec ? 0 : lastWriteTime.time_since_epoch().count());
+
+        std::ostringstream key;
+        key << std::hex << std::setw(16) << std::setfill('0') << std::hash<std::string>{}(oss.str()) << ".embedded";
+        return key.str();
+    }
+
+    std::shared_ptr<IEncodedImage> CoverService::loadFromFileCache(const std::string& key)
+    {
+        if (!_fileCache)
             return nullptr;
+
+        std::shared_ptr<IEncodedImage> image{ _fileCache->get(key) };
+        _fileCacheCounters.count(image != nullptr);
+
+        return image;
+    }
+
+    void CoverService::saveToFileCache(const std::string& key, const IEncodedImage& image)
+    {
+        if (_fileCache)
+            _fileCache->put(key, image);
+    }
+
+    std::shared_ptr<IEncodedImage> CoverService::loadFromCache(const CacheEntryDesc& entryDesc)
+    {
+        std::shared_ptr<IEncodedImage> image{ _cache.get(entryDesc) };
+        _memoryCacheCounters.count(image != nullptr);
+        if (image)
+            return image;
+
+        image = loadFromFileCache(computeFileCacheKey(entryDesc));
+        if (image)
+            _cache.put(entryDesc, image);
+
+        return image;
+    }
+
+    CoverService::ResolvedCover CoverService::loadFromCache(const EntityRequestDesc& requestDesc)
+    {
+        ResolvedCover cover;
+
+        if (const std::optional<ContentHash> contentHash{ loadContentHash(requestDesc.id) })
+        {
+            cover.contentHash = *contentHash;
+            cover.image = loadFromCache(CacheEntryDesc{ *contentHash, requestDesc.width, requestDesc.format });
         }
 
-        ++_cacheHits;
+        return cover;
+    }
+
+    void CoverService::saveContentHash(const EntityId& entityId, ContentHash contentHash)
+    {
+        std::unique_lock lock{ _contentHashesMutex };
+
+        // each link is small, but there is one per track
+        if (_contentHashes.size() >= maxContentHashCount && !_contentHashes.contains(entityId))
+        {
+            LMS_LOG(COVER, DEBUG, "Too many content hashes, clearing");
+            _contentHashes.clear();
+        }
+        _contentHashes[entityId] = contentHash;
+    }
+
+    std::optional<ContentHash> CoverService::loadContentHash(const EntityId& entityId)
+    {
+        std::shared_lock lock{ _contentHashesMutex };
+
+        auto it{ _contentHashes.find(entityId) };
+        if (it == std::cend(_contentHashes))
+            return std::nullopt;
+
         return it->second;
     }
 
+    void CoverService::CacheCounters::count(bool hit) const
+    {
+        if (Metrics::Counter * counter{ hit ? hits : misses })
+            counter->inc();
+    }
+
 } // namespace Cover
 
@@ -19,19 +19,29 @@
 
 #pragma once
 
+#include <array>
 #include <atomic>
 #include <filesystem>
+#include <functional>
+#include <future>
 #include <map>
+#include <mutex>
 #include <optional>
 #include <shared_mutex>
+#include <span>
 #include <string_view>
 #include <unordered_map>
+#include <unordered_set>
 #include <variant>
 #include <vector>
 
 #include "services/cover/ICoverService.hpp"
+#include "CoverFileCache.hpp"
+#include "CoverMemoryCache.hpp"
 #include "image/IEncodedImage.hpp"
+#include "database/ImageFile.hpp"
 #include "database/Types.hpp"
+#include "utils/IOContextRunner.hpp"
 
 namespace Database
 {
@@ -43,41 +53,10 @@ namespace Av
     class IAudioFile;
 }
 
-namespace Cover
-{
-    struct CacheEntryDesc
-    {
-        std::variant<Database::ArtistId, Database::ReleaseId, Database::TrackId> id;
-        std::size_t			size;
-
-        bool operator==(const CacheEntryDesc& other) const
-        {
-            return id == other.id
-                && size == other.size;
-        }
-    };
-} // ns Cover
-
-namespace std
+namespace Metrics
 {
-    template<>
-    class hash<Cover::CacheEntryDesc>
-    {
-    public:
-        size_t operator()(const Cover::CacheEntryDesc& e) const
-        {
-            size_t h{};
-            std::visit([&](auto id)
-                {
-                    using IdType = std::decay_t<decltype(id)>;
-                    h ^= std::hash<IdType>()(id);
-                }, e.id);
-            h ^= std::hash<std::size_t>()(e.size) << 1;
-            return h;
-        }
-    };
-
-} // ns std
+    class Counter;
+}
 
 namespace Cover
 {
@@ -90,43 +69,129 @@ namespace Cover
         CoverService& operator=(const CoverService&) = delete;
 
     private:
-        std::shared_ptr<Image::IEncodedImage>   getFromTrack(Database::TrackId trackId, Image::ImageSize width) override;
-        std::shared_ptr<Image::IEncodedImage>   getFromRelease(Database::ReleaseId releaseId, Image::ImageSize width) override;
-        std::shared_ptr<Image::IEncodedImage>   getFromArtist(Database::ArtistId artistId, Image::ImageSize width) override;
-        std::shared_ptr<Image::IEncodedImage>   getDefault(Image::ImageSize width) override;
+        std::shared_ptr<Image::IEncodedImage>   getFromTrack(Database::TrackId trackId, Image::ImageSize width, Image::ImageFormat format) override;
+        std::shared_ptr<Image::IEncodedImage>   getFromRelease(Database::ReleaseId releaseId, Image::ImageSize width, Image::ImageFormat format) override;
+        std::shared_ptr<Image::IEncodedImage>   getFromArtist(Database::ArtistId artistId, Image::ImageSize width, Image::ImageFormat format) override;
+        std::shared_ptr<Image::IEncodedImage>   getDefault(Image::ImageSize width, Image::ImageFormat format) override;
+        void                                    asyncGetFromTrack(Database::TrackId trackId, Image::ImageSize width, Image::ImageFormat format, CoverCallback callback) override;
+        void                                    asyncGetFromRelease(Database::ReleaseId releaseId, Image::ImageSize width, Image::ImageFormat format, CoverCallback callback) override;
+        void                                    asyncGetFromArtist(Database::ArtistId artistId, Image::ImageSize width, Image::ImageFormat format, CoverCallback callback) override;
+        void                                    storeEmbeddedTrackCover(const std::filesystem::path& trackPath, std::span<const std::byte> data) override;
         void                                    flushCache() override;
+        void                                    invalidate(std::span<const Database::TrackId> tracks, std::span<const Database::ReleaseId> releases, std::span<const Database::ArtistId> artists) override;
         void                                    setJpegQuality(unsigned quality) override;
+        Image::ImageFormat                      getPreferredFormat(std::string_view httpAcceptHeader) const override;
+        ProcessingStats                         getProcessingStats(SourceKind sourceKind) const override;
 
-        std::shared_ptr<Image::IEncodedImage>   getFromTrack(Database::Session& dbSession, Database::TrackId trackId, Image::ImageSize width, bool allowReleaseFallback);
-        std::unique_ptr<Image::IEncodedImage>   getFromAvMediaFile(const Av::IAudioFile& input, Image::ImageSize width) const;
-        std::unique_ptr<Image::IEncodedImage>   getFromCoverFile(const std::filesystem::path& p, Image::ImageSize width) const;
-
-        std::unique_ptr<Image::IEncodedImage>   getFromTrack(const std::filesystem::path& path, Image::ImageSize width) const;
+        // Cover of an entity, along with the hash of its source picture
+        struct ResolvedCover
+        {
+            std::shared_ptr<Image::IEncodedImage> image; // nullptr if no cover found
+            ContentHash contentHash;
+        };
+
+        ResolvedCover                           getFromTrack(Database::Session& dbSession, Database::TrackId trackId, Image::ImageSize width, Image::ImageFormat format, bool allowReleaseFallback);
+        ResolvedCover                           resolveReleaseCover(Database::ReleaseId releaseId, Image::ImageSize width, Image::ImageFormat format);
+        ResolvedCover                           computeTrackCover(Database::Session& dbSession, Database::TrackId trackId, Image::ImageSize width, Image::ImageFormat format, bool allowReleaseFallback);
+        ResolvedCover                           computeReleaseCover(Database::ReleaseId releaseId, Image::ImageSize width, Image::ImageFormat format);
+        ResolvedCover                           computeArtistImage(Database::ArtistId artistId, Image::ImageSize width, Image::ImageFormat format);
+        ResolvedCover                           getFromAvMediaFile(const Av::IAudioFile& input, Image::ImageSize width, Image::ImageFormat format);
+        ResolvedCover                           getFromCoverFile(const std::filesystem::path& p, Image::ImageSize width, Image::ImageFormat format);
+
+        ResolvedCover                           getFromTrack(const std::filesystem::path& path, Image::ImageSize width, Image::ImageFormat format);
+        ResolvedCover                           getFromEmbeddedCoverStore(const std::filesystem::path& trackPath, Image::ImageSize width, Image::ImageFormat format);
+        std::vector<Database::ImageFile::Entry>             getImageFiles(const std::filesystem::path& directoryPath) const;
         std::multimap<std::string, std::filesystem::path>   getCoverPaths(const std::filesystem::path& directoryPath) const;
-        std::unique_ptr<Image::IEncodedImage>   getFromDirectory(const std::filesystem::path& directory, Image::ImageSize width, const std::vector<std::string>& preferredFileNames, bool allowPickRandom) const;
-        std::unique_ptr<Image::IEncodedImage>   getFromSameNamedFile(const std::filesystem::path& filePath, Image::ImageSize width) const;
+        ResolvedCover                           getFromDirectory(const std::filesystem::path& directory, Image::ImageSize width, Image::ImageFormat format, const std::vector<std::string>& preferredFileNames, bool allowPickRandom);
+        ResolvedCover                           getFromSameNamedFile(const std::filesystem::path& filePath, Image::ImageSize width, Image::ImageFormat format);
+
+        // Decodes, resizes and encodes the source picture, unless the result is already cached
+        // throws ImageException
+        ResolvedCover                           processCover(std::span<const std::byte> source, SourceKind sourceKind, Image::ImageSize width, Image::ImageFormat format);
 
-        bool                                    checkCoverFile(const std::filesystem::path& directoryPath) const;
+        struct ProcessingCounters
+        {
+            std::atomic<std::size_t> count{};
+            std::atomic<std::size_t> sourceSize{};
+            std::atomic<std::chrono::microseconds::rep> duration{};
+        };
+        std::array<ProcessingCounters, 2> _processingCounters; // indexed by SourceKind
+
+        bool                                    checkCoverFile(const Database::ImageFile::Entry& imageFile) const;
 
         Database::Db& _db;
 
-        std::shared_mutex _cacheMutex;
-        std::unordered_map<CacheEntryDesc, std::shared_ptr<Image::IEncodedImage>> _cache;
-        std::unordered_map<Image::ImageSize, std::shared_ptr<Image::IEncodedImage>> _defaultCoverCache;
-        std::atomic<std::size_t>    _cacheMisses{};
-        std::atomic<std::size_t>    _cacheHits{};
-        std::size_t                 _cacheSize{};
+        std::shared_mutex _defaultCoverCacheMutex;
+        std::map<std::pair<Image::ImageSize, Image::ImageFormat>, std::shared_ptr<Image::IEncodedImage>> _defaultCoverCache;
 
+        // Memory and file caches of the resized covers, keyed by the hash of their source
         void saveToCache(const CacheEntryDesc& entryDesc, std::shared_ptr<Image::IEncodedImage> image);
         std::shared_ptr<Image::IEncodedImage> loadFromCache(const CacheEntryDesc& entryDesc);
 
+        // Entities are mapped to the hash of their source picture, so that identical pictures are processed and stored only once
+        using EntityId = std::variant<Database::ArtistId, Database::ReleaseId, Database::TrackId>;
+        void saveContentHash(const EntityId& entityId, ContentHash contentHash);
+        std::optional<ContentHash> loadContentHash(const EntityId& entityId);
+        std::shared_mutex _contentHashesMutex;
+        std::unordered_map<EntityId, ContentHash> _contentHashes;
+
+        // Concurrent misses for the same entity or for the same source picture wait for a single computation
+        struct EntityRequestDesc
+        {
+            EntityId id;
+            Image::ImageSize width;
+            Image::ImageFormat format;
+
+            bool operator==(const EntityRequestDesc& other) const = default;
+        };
+        struct EntityRequestDescHash
+        {
+            std::size_t operator()(const EntityRequestDesc& desc) const;
+        };
+        ResolvedCover loadFromCache(const EntityRequestDesc& requestDesc);
+        ResolvedCover getOrComputeCover(const EntityRequestDesc& requestDesc, const std::function<ResolvedCover()>& computeFunc);
+        std::mutex _ongoingComputationsMutex;
+        std::unordered_map<EntityRequestDesc, std::shared_future<ResolvedCover>, EntityRequestDescHash> _ongoingComputations;
+        std::unordered_map<CacheEntryDesc, std::shared_future<ResolvedCover>> _ongoingProcessings;
+        std::atomic<std::size_t> _coalescedRequestCount{};
+
+        // On disk, entities are linked to the hash of their source picture, the link keys are computed using the sources of the entity
+        std::string computeLinkFileCacheKey(std::string_view type, std::string_view id, const std::vector<std::filesystem::path>& sources) const;
+        std::string computeFileCacheKey(const CacheEntryDesc& entryDesc) const;
+        std::optional<ContentHash> loadLinkFromFileCache(const std::string& key);
+        void saveLinkToFileCache(const std::string& key, ContentHash contentHash);
+        ResolvedCover loadFromLink(const std::string& linkKey, Image::ImageSize width, Image::ImageFormat format);
+        void saveToFileCache(const std::string& key, const Image::IEncodedImage& image);
+        std::shared_ptr<Image::IEncodedImage> loadFromFileCache(const std::string& key);
+        std::string computeEmbeddedCoverFileCacheKey(const std::filesystem::path& trackPath) const;
+
         const std::filesystem::path _defaultCoverPath;
         const std::size_t _maxCacheSize;
-        static inline const std::vector<std::filesystem::path> _fileExtensions{ ".jpg", ".jpeg", ".png", ".bmp" }; // TODO parametrize
+        CoverMemoryCache _cache;
         const std::size_t _maxFileSize;
         const std::vector<std::string> _preferredFileNames;
         const std::vector<std::string> _artistFileNames;
         unsigned _jpegQuality;
+        const unsigned _webpQuality;
+        const bool _webpEnabled; // configured and supported by the image library
+        unsigned getQuality(Image::ImageFormat format) const;
+        const std::unique_ptr<CoverFileCache> _fileCache; // nullptr if disabled
+
+        // null if metrics are not collected
+        struct CacheCounters
+        {
+            Metrics::Counter* hits{};
+            Metrics::Counter* misses{};
+
+            void count(bool hit) const;
+        };
+        CacheCounters _memoryCacheCounters;
+        CacheCounters _fileCacheCounters;
+
+        // Cover decoding/resizing offloaded from the callers' threads
+        void postCoverRequest(std::function<std::shared_ptr<Image::IEncodedImage>()> getCoverFunc, CoverCallback callback);
+        boost::asio::io_service _ioService;
+        IOContextRunner _ioContextRunner; // must be last, stopped first
     };
 
 } // namespace Cover
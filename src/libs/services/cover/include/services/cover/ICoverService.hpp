@@ -19,8 +19,14 @@
 
 #pragma once
 
+#include <chrono>
+#include <cstddef>
 #include <filesystem>
+#include <functional>
 #include <memory>
+#include <span>
+#include <string_view>
+#include <vector>
 
 #include "database/ArtistId.hpp"
 #include "database/ReleaseId.hpp"
@@ -39,17 +45,50 @@ namespace Cover
     public:
         virtual ~ICoverService() = default;
 
-        virtual std::shared_ptr<Image::IEncodedImage> getFromTrack(Database::TrackId trackId, Image::ImageSize width) = 0;
-        virtual std::shared_ptr<Image::IEncodedImage> getFromRelease(Database::ReleaseId releaseId, Image::ImageSize width) = 0;
-        virtual std::shared_ptr<Image::IEncodedImage> getFromArtist(Database::ArtistId artistId, Image::ImageSize width) = 0;
+        virtual std::shared_ptr<Image::IEncodedImage> getFromTrack(Database::TrackId trackId, Image::ImageSize width, Image::ImageFormat format) = 0;
+        virtual std::shared_ptr<Image::IEncodedImage> getFromRelease(Database::ReleaseId releaseId, Image::ImageSize width, Image::ImageFormat format) = 0;
+        virtual std::shared_ptr<Image::IEncodedImage> getFromArtist(Database::ArtistId artistId, Image::ImageSize width, Image::ImageFormat format) = 0;
 
-        virtual std::shared_ptr<Image::IEncodedImage> getDefault(Image::ImageSize width) = 0;
+        virtual std::shared_ptr<Image::IEncodedImage> getDefault(Image::ImageSize width, Image::ImageFormat format) = 0;
+
+        // Async versions, computed by a dedicated thread pool
+        // The callback is called from a pool thread, with nullptr if no cover is found
+        using CoverCallback = std::function<void(std::shared_ptr<Image::IEncodedImage>)>;
+        virtual void asyncGetFromTrack(Database::TrackId trackId, Image::ImageSize width, Image::ImageFormat format, CoverCallback callback) = 0;
+        virtual void asyncGetFromRelease(Database::ReleaseId releaseId, Image::ImageSize width, Image::ImageFormat format, CoverCallback callback) = 0;
+        virtual void asyncGetFromArtist(Database::ArtistId artistId, Image::ImageSize width, Image::ImageFormat format, CoverCallback callback) = 0;
+
+        // Keeps the original embedded picture of a track file, as read by the scanner, so that it does not have to be reopened later
+        // No-op if the file cache is disabled
+        virtual void storeEmbeddedTrackCover(const std::filesystem::path& trackPath, std::span<const std::byte> data) = 0;
 
         virtual void flushCache() = 0;
+        // Only removes the cached covers of the given entities
+        virtual void invalidate(std::span<const Database::TrackId> tracks, std::span<const Database::ReleaseId> releases, std::span<const Database::ArtistId> artists) = 0;
 
         virtual void setJpegQuality(unsigned quality) = 0; // from 1 to 100
+
+        // Best supported format according to a HTTP Accept header, JPEG being the fallback
+        virtual Image::ImageFormat getPreferredFormat(std::string_view httpAcceptHeader) const = 0;
+
+        // Pictures actually decoded, resized and encoded since the service creation (cache hits are not counted)
+        enum class SourceKind
+        {
+            Embedded,   // in the track files, or stored by the scanner
+            File,       // image files
+        };
+        struct ProcessingStats
+        {
+            std::size_t count{};
+            std::size_t sourceSize{}; // in bytes
+            std::chrono::microseconds duration{};
+        };
+        virtual ProcessingStats getProcessingStats(SourceKind sourceKind) const = 0;
     };
 
+    // Extensions of the image files that can be used as covers or artist images
+    const std::vector<std::filesystem::path>& getSupportedImageFileExtensions();
+
     std::unique_ptr<ICoverService> createCoverService(Database::Db& db, const std::filesystem::path& execPath, const std::filesystem::path& defaultCoverPath);
 
 } // namespace CoverArt
@@ -29,13 +29,28 @@
 #include "database/StarredTrack.hpp"
 #include "database/Track.hpp"
 #include "database/User.hpp"
+#include "utils/IConfig.hpp"
 #include "utils/ILogger.hpp"
+#include "utils/ITraceLogger.hpp"
+#include "utils/Service.hpp"
 
 #include "internal/InternalBackend.hpp"
 #include "listenbrainz/ListenBrainzBackend.hpp"
 
 namespace Feedback
 {
+    namespace
+    {
+        std::chrono::seconds getStarredCacheMaxAge()
+        {
+            // only the other workers may star objects in the same database behind the back of the service
+            if (Service<IConfig>::get()->getULong("worker-count", 1) <= 1)
+                return std::chrono::seconds{ 0 };
+
+            return std::chrono::seconds{ Service<IConfig>::get()->getULong("annotation-cache-max-age", 10) };
+        }
+    }
+
     std::unique_ptr<IFeedbackService> createFeedbackService(boost::asio::io_context& ioContext, Db& db)
     {
         return std::make_unique<FeedbackService>(ioContext, db);
@@ -43,10 +58,11 @@ namespace Feedback
 
     FeedbackService::FeedbackService(boost::asio::io_context& ioContext, Db& db)
         : _db{ db }
+        , _starredCache{ getStarredCacheMaxAge() }
     {
         LMS_LOG(SCROBBLING, INFO, "Starting service...");
         _backends.emplace(Database::FeedbackBackend::Internal, std::make_unique<InternalBackend>(_db));
-        _backends.emplace(Database::FeedbackBackend::ListenBrainz, std::make_unique<ListenBrainz::ListenBrainzBackend>(ioContext, _db));
+        _backends.emplace(Database::FeedbackBackend::ListenBrainz, std::make_unique<ListenBrainz::ListenBrainzBackend>(ioContext, _db, _starredCache));
         LMS_LOG(SCROBBLING, INFO, "Service started!");
     }
 
@@ -57,38 +73,43 @@ namespace Feedback
 
     std::optional<Database::FeedbackBackend> FeedbackService::getUserFeedbackBackend(UserId userId)
     {
-        std::optional<Database::FeedbackBackend> feedbackBackend;
+        LMS_SCOPED_TRACE_DETAILED("Feedback", "getUserFeedbackBackend");
 
-        Session& session{ _db.getTLSSession() };
-        auto transaction{ session.createReadTransaction() };
-        if (const User::pointer user{ User::find(session, userId) })
-            feedbackBackend = user->getFeedbackBackend();
+        std::optional<Database::FeedbackBackend> feedbackBackend;
+        if (const std::optional<User::Settings> settings{ User::getSettings(_db.getTLSSession(), userId) })
+            feedbackBackend = settings->feedbackBackend;
 
         return feedbackBackend;
     }
 
     void FeedbackService::star(UserId userId, ArtistId artistId)
     {
+        LMS_SCOPED_TRACE_OVERVIEW("Feedback", "star");
         star<Artist, ArtistId, StarredArtist>(userId, artistId);
     }
 
     void FeedbackService::unstar(UserId userId, ArtistId artistId)
     {
+        LMS_SCOPED_TRACE_OVERVIEW("Feedback", "unstar");
         unstar<Artist, ArtistId, StarredArtist>(userId, artistId);
     }
 
     bool FeedbackService::isStarred(UserId userId, ArtistId artistId)
     {
-        return isStarred<Artist, ArtistId, StarredArtist>(userId, artistId);
+        LMS_SCOPED_TRACE_DETAILED("Feedback", "isStarred");
+        return findStarredDateTime(userId, artistId).has_value();
     }
 
     Wt::WDateTime FeedbackService::getStarredDateTime(UserId userId, ArtistId artistId)
     {
-        return getStarredDateTime<Artist, ArtistId, StarredArtist>(userId, artistId);
+        LMS_SCOPED_TRACE_DETAILED("Feedback", "getStarredDateTime");
+        return findStarredDateTime(userId, artistId).value_or(Wt::WDateTime{});
     }
 
     FeedbackService::ArtistContainer FeedbackService::findStarredArtists(const ArtistFindParameters& params)
     {
+        LMS_SCOPED_TRACE_OVERVIEW("Feedback", "findStarredArtists");
+
         auto backend{ getUserFeedbackBackend(params.user) };
         if (!backend)
             return {};
@@ -109,26 +130,32 @@ namespace Feedback
 
     void FeedbackService::star(UserId userId, ReleaseId releaseId)
     {
+        LMS_SCOPED_TRACE_OVERVIEW("Feedback", "star");
         star<Release, ReleaseId, StarredRelease>(userId, releaseId);
     }
 
     void FeedbackService::unstar(UserId userId, ReleaseId releaseId)
     {
+        LMS_SCOPED_TRACE_OVERVIEW("Feedback", "unstar");
         unstar<Release, ReleaseId, StarredRelease>(userId, releaseId);
     }
 
     bool FeedbackService::isStarred(UserId userId, ReleaseId releaseId)
     {
-        return isStarred<Release, ReleaseId, StarredRelease>(userId, releaseId);
+        LMS_SCOPED_TRACE_DETAILED("Feedback", "isStarred");
+        return findStarredDateTime(userId, releaseId).has_value();
     }
 
     Wt::WDateTime FeedbackService::getStarredDateTime(UserId userId, ReleaseId releaseId)
     {
-        return getStarredDateTime<Release, ReleaseId, StarredRelease>(userId, releaseId);
+        LMS_SCOPED_TRACE_DETAILED("Feedback", "getStarredDateTime");
+        return findStarredDateTime(userId, releaseId).value_or(Wt::WDateTime{});
     }
 
     FeedbackService::ReleaseContainer FeedbackService::findStarredReleases(const FindParameters& params)
     {
+        LMS_SCOPED_TRACE_OVERVIEW("Feedback", "findStarredReleases");
+
         auto backend{ getUserFeedbackBackend(params.user) };
         if (!backend)
             return {};
@@ -148,26 +175,32 @@ namespace Feedback
 
     void FeedbackService::star(UserId userId, TrackId trackId)
     {
+        LMS_SCOPED_TRACE_OVERVIEW("Feedback", "star");
         star<Track, TrackId, StarredTrack>(userId, trackId);
     }
 
     void FeedbackService::unstar(UserId userId, TrackId trackId)
     {
+        LMS_SCOPED_TRACE_OVERVIEW("Feedback", "unstar");
         unstar<Track, TrackId, StarredTrack>(userId, trackId);
     }
 
     bool FeedbackService::isStarred(UserId userId, TrackId trackId)
     {
-        return isStarred<Track, TrackId, StarredTrack>(userId, trackId);
+        LMS_SCOPED_TRACE_DETAILED("Feedback", "isStarred");
+        return findStarredDateTime(userId, trackId).has_value();
     }
 
     Wt::WDateTime FeedbackService::getStarredDateTime(UserId userId, TrackId trackId)
     {
-        return getStarredDateTime<Track, TrackId, StarredTrack>(userId, trackId);
+        LMS_SCOPED_TRACE_DETAILED("Feedback", "getStarredDateTime");
+        return findStarredDateTime(userId, trackId).value_or(Wt::WDateTime{});
     }
 
     FeedbackService::TrackContainer FeedbackService::findStarredTracks(const FindParameters& params)
     {
+        LMS_SCOPED_TRACE_OVERVIEW("Feedback", "findStarredTracks");
+
         auto backend{ getUserFeedbackBackend(params.user) };
         if (!backend)
             return {};
@@ -184,5 +217,45 @@ namespace Feedback
 
         return Track::findIds(session, searchParams);
     }
+
+    FeedbackService::TrackStarredDateTimeContainer FeedbackService::getStarredDateTimes(UserId userId, std::span<const TrackId> trackIds)
+    {
+        LMS_SCOPED_TRACE_OVERVIEW("Feedback", "getStarredDateTimes");
+
+        TrackStarredDateTimeContainer res;
+
+        const auto backend{ getUserFeedbackBackend(userId) };
+        if (!backend)
+            return res;
+
+        visitStarredCache(userId, *backend, [&](const StarredCache::Entry& entry)
+            {
+                for (const TrackId trackId : trackIds)
+                {
+                    if (const auto it{ entry.tracks.find(trackId) }; it != std::cend(entry.tracks))
+                        res.emplace(trackId, it->second);
+                }
+            });
+
+        return res;
+    }
+
+    StarredCache::Entry FeedbackService::loadStarredCacheEntry(UserId userId, FeedbackBackend backend)
+    {
+        LMS_SCOPED_TRACE_DETAILED("Feedback", "loadStarredCacheEntry");
+
+        StarredCache::Entry entry;
+
+        Session& session{ _db.getTLSSession() };
+        auto transaction{ session.createReadTransaction() };
+
+        StarredArtist::getStarredDateTimes(session, userId, backend, [&](ArtistId artistId, const Wt::WDateTime& dateTime) { entry.artists.emplace(artistId, dateTime); });
+        StarredRelease::getStarredDateTimes(session, userId, backend, [&](ReleaseId releaseId, const Wt::WDateTime& dateTime) { entry.releases.emplace(releaseId, dateTime); });
+        StarredTrack::getStarredDateTimes(session, userId, backend, [&](TrackId trackId, const Wt::WDateTime& dateTime) { entry.tracks.emplace(trackId, dateTime); });
+
+        LMS_LOG(SCROBBLING, DEBUG, "Loaded starred objects of user " << userId.toString() << ": " << entry.artists.size() << " artists, " << entry.releases.size() << " releases, " << entry.tracks.size() << " tracks");
+
+        return entry;
+    }
 } // ns Feedback
 
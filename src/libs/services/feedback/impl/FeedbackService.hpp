@@ -20,10 +20,12 @@
 #pragma once
 
 #include <memory>
+#include <optional>
 #include <unordered_map>
 
 #include "services/feedback/IFeedbackService.hpp"
 #include "IFeedbackBackend.hpp"
+#include "StarredCache.hpp"
 
 namespace Database
 {
@@ -59,6 +61,7 @@ namespace Feedback
         bool isStarred(Database::UserId userId, Database::TrackId trackId) override;
         Wt::WDateTime getStarredDateTime(Database::UserId userId, Database::TrackId trackId) override;
         TrackContainer findStarredTracks(const FindParameters& params) override;
+        TrackStarredDateTimeContainer getStarredDateTimes(Database::UserId userId, std::span<const Database::TrackId> trackIds) override;
 
         std::optional<Database::FeedbackBackend> getUserFeedbackBackend(Database::UserId userId);
 
@@ -66,12 +69,16 @@ namespace Feedback
         void star(Database::UserId userId, ObjIdType id);
         template <typename ObjType, typename ObjIdType, typename StarredObjType>
         void unstar(Database::UserId userId, ObjIdType id);
-        template <typename ObjType, typename ObjIdType, typename StarredObjType>
-        bool isStarred(Database::UserId userId, ObjIdType id);
-        template <typename ObjType, typename ObjIdType, typename StarredObjType>
-        Wt::WDateTime getStarredDateTime(Database::UserId userId, ObjIdType id);
+        template <typename ObjIdType>
+        std::optional<Wt::WDateTime> findStarredDateTime(Database::UserId userId, ObjIdType id); // nullopt if not starred
+
+        // func is called with the starred objects of the user for this backend, loaded from the database if needed
+        template <typename Func>
+        void visitStarredCache(Database::UserId userId, Database::FeedbackBackend backend, Func&& func);
+        StarredCache::Entry loadStarredCacheEntry(Database::UserId userId, Database::FeedbackBackend backend);
 
         Database::Db& _db;
+        StarredCache _starredCache; // must outlive the backends
         std::unordered_map<Database::FeedbackBackend, std::unique_ptr<IFeedbackBackend>> _backends;
     };
 
@@ -19,6 +19,8 @@
 
 #pragma once
 
+#include <utility>
+
 #include "database/Db.hpp"
 #include "database/Session.hpp"
 #include "database/User.hpp"
@@ -35,6 +37,7 @@ namespace Feedback
             return;
 
         typename StarredObjType::IdType starredObjId;
+        Wt::WDateTime dateTime;
         {
             Session& session{ _db.getTLSSession() };
             auto transaction{ session.createWriteTransaction() };
@@ -54,8 +57,10 @@ namespace Feedback
             }
             starredObj.modify()->setDateTime(Wt::WDateTime::currentDateTime());
             starredObjId = starredObj->getId();
+            dateTime = starredObj->getDateTime();
         }
         _backends[*backend]->onStarred(starredObjId);
+        _starredCache.onStarred(userId, *backend, objId, dateTime);
     }
 
     template <typename ObjType, typename ObjIdType, typename StarredObjType>
@@ -77,29 +82,37 @@ namespace Feedback
             starredObjId = starredObj->getId();
         }
         _backends[*backend]->onUnstarred(starredObjId);
+        _starredCache.onUnstarred(userId, *backend, objId);
     }
 
-    template <typename ObjType, typename ObjIdType, typename StarredObjType>
-    bool FeedbackService::isStarred(UserId userId, ObjIdType objId)
+    template <typename ObjIdType>
+    std::optional<Wt::WDateTime> FeedbackService::findStarredDateTime(UserId userId, ObjIdType objId)
     {
-        Session& session{ _db.getTLSSession() };
-        auto transaction{ session.createReadTransaction() };
+        const auto backend{ getUserFeedbackBackend(userId) };
+        if (!backend)
+            return std::nullopt;
 
-        typename StarredObjType::pointer starredObj{ StarredObjType::find(session, objId, userId) };
-        return starredObj && (starredObj->getSyncState() != SyncState::PendingRemove);
+        std::optional<Wt::WDateTime> res;
+        visitStarredCache(userId, *backend, [&](const StarredCache::Entry& entry)
+            {
+                const auto& dateTimes{ StarredCache::Entry::getDateTimes<ObjIdType>(entry) };
+                if (const auto it{ dateTimes.find(objId) }; it != std::cend(dateTimes))
+                    res = it->second;
+            });
+
+        return res;
     }
 
-    template <typename ObjType, typename ObjIdType, typename StarredObjType>
-    Wt::WDateTime FeedbackService::getStarredDateTime(UserId userId, ObjIdType objId)
+    template <typename Func>
+    void FeedbackService::visitStarredCache(UserId userId, FeedbackBackend backend, Func&& func)
     {
-        Session& session{ _db.getTLSSession() };
-        auto transaction{ session.createReadTransaction() };
-
-        typename StarredObjType::pointer starredObj{ StarredObjType::find(session, objId, userId) };
-        if (starredObj && (starredObj->getSyncState() != SyncState::PendingRemove))
-            return starredObj->getDateTime();
+        if (_starredCache.visit(userId, backend, func))
+            return;
 
-        return {};
+        const std::uint64_t generation{ _starredCache.getGeneration() };
+        StarredCache::Entry entry{ loadStarredCacheEntry(userId, backend) };
+        func(std::as_const(entry));
+        _starredCache.put(userId, backend, std::move(entry), generation);
     }
 
 } // ns Feedback
\ No newline at end of file
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "StarredCache.hpp"
+
+#include <utility>
+
+namespace Feedback
+{
+    std::uint64_t StarredCache::getGeneration() const
+    {
+        const std::shared_lock lock{ _mutex };
+        return _generation;
+    }
+
+    void StarredCache::put(Database::UserId userId, Database::FeedbackBackend backend, Entry entry, std::uint64_t generation)
+    {
+        const std::unique_lock lock{ _mutex };
+
+        if (generation != _generation) // starred objects have been modified meanwhile
+            return;
+
+        _entries[userId].insert_or_assign(backend, LoadedEntry{ std::move(entry), std::chrono::steady_clock::now() });
+    }
+
+    void StarredCache::invalidate(Database::UserId userId)
+    {
+        const std::unique_lock lock{ _mutex };
+
+        _generation++;
+        _entries.erase(userId);
+    }
+
+    StarredCache::Entry* StarredCache::findEntry(Database::UserId userId, Database::FeedbackBackend backend)
+    {
+        return const_cast<Entry*>(std::as_const(*this).findEntry(userId, backend));
+    }
+
+    const StarredCache::Entry* StarredCache::findEntry(Database::UserId userId, Database::FeedbackBackend backend) const
+    {
+        const auto itUser{ _entries.find(userId) };
+        if (itUser == std::cend(_entries))
+            return nullptr;
+
+        const auto itEntry{ itUser->second.find(backend) };
+        if (itEntry == std::cend(itUser->second))
+            return nullptr;
+
+        if (_maxAge.count() > 0 && std::chrono::steady_clock::now() - itEntry->second.loadTime > _maxAge)
+            return nullptr;
+
+        return &itEntry->second.entry;
+    }
+} // ns Feedback
@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <type_traits>
+#include <unordered_map>
+
+#include <Wt/WDateTime.h>
+
+#include "database/ArtistId.hpp"
+#include "database/ReleaseId.hpp"
+#include "database/TrackId.hpp"
+#include "database/Types.hpp"
+#include "database/UserId.hpp"
+
+namespace Feedback
+{
+    // Objects starred by the users, per feedback backend, loaded on first use so that annotations do not hit the database
+    // Loaded entries are updated on each star/unstar, the other writers (synchronizations, etc.) must report their changes too
+    // Entries are tagged with the generation in use when their load started: stale loads are not cached
+    // Entries older than maxAge are reloaded, so that the changes made by other processes are eventually seen (0 means no limit)
+    class StarredCache
+    {
+    public:
+        struct Entry
+        {
+            std::unordered_map<Database::ArtistId, Wt::WDateTime> artists;
+            std::unordered_map<Database::ReleaseId, Wt::WDateTime> releases;
+            std::unordered_map<Database::TrackId, Wt::WDateTime> tracks;
+
+            template <typename ObjIdType, typename Self>
+            static auto& getDateTimes(Self& entry)
+            {
+                if constexpr (std::is_same_v<ObjIdType, Database::ArtistId>)
+                    return entry.artists;
+                else if constexpr (std::is_same_v<ObjIdType, Database::ReleaseId>)
+                    return entry.releases;
+                else
+                {
+                    static_assert(std::is_same_v<ObjIdType, Database::TrackId>);
+                    return entry.tracks;
+                }
+            }
+        };
+
+        explicit StarredCache(std::chrono::seconds maxAge) : _maxAge{ maxAge } {}
+
+        StarredCache(const StarredCache&) = delete;
+        StarredCache& operator=(const StarredCache&) = delete;
+
+        // func is called with the entry of the user, under lock. Returns false if the entry is not loaded yet
+        template <typename Func>
+        bool visit(Database::UserId userId, Database::FeedbackBackend backend, Func&& func) const
+        {
+            const std::shared_lock lock{ _mutex };
+
+            const Entry* entry{ findEntry(userId, backend) };
+            if (!entry)
+                return false;
+
+            func(*entry);
+            return true;
+        }
+
+        std::uint64_t getGeneration() const;
+        void put(Database::UserId userId, Database::FeedbackBackend backend, Entry entry, std::uint64_t generation);
+
+        template <typename ObjIdType>
+        void onStarred(Database::UserId userId, Database::FeedbackBackend backend, ObjIdType objId, const Wt::WDateTime& dateTime)
+        {
+            const std::unique_lock lock{ _mutex };
+
+            _generation++;
+            if (Entry* entry{ findEntry(userId, backend) })
+                Entry::getDateTimes<ObjIdType>(*entry).insert_or_assign(objId, dateTime);
+        }
+
+        template <typename ObjIdType>
+        void onUnstarred(Database::UserId userId, Database::FeedbackBackend backend, ObjIdType objId)
+        {
+            const std::unique_lock lock{ _mutex };
+
+            _generation++;
+            if (Entry* entry{ findEntry(userId, backend) })
+                Entry::getDateTimes<ObjIdType>(*entry).erase(objId);
+        }
+
+        void invalidate(Database::UserId userId);
+
+    private:
+        // must be called with _mutex held
+        Entry* findEntry(Database::UserId userId, Database::FeedbackBackend backend);
+        const Entry* findEntry(Database::UserId userId, Database::FeedbackBackend backend) const;
+
+        struct LoadedEntry
+        {
+            Entry entry;
+            std::chrono::steady_clock::time_point loadTime;
+        };
+
+        const std::chrono::seconds _maxAge;
+        mutable std::shared_mutex _mutex;
+        std::uint64_t _generation{};
+        std::unordered_map<Database::UserId, std::unordered_map<Database::FeedbackBackend, LoadedEntry>> _entries;
+    };
+} // ns Feedback
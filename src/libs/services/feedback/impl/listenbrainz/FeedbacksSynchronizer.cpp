@@ -19,6 +19,9 @@
 
 #include "FeedbacksSynchronizer.hpp"
 
+#include <unordered_set>
+#include <utility>
+#include <vector>
 #include <boost/asio/bind_executor.hpp>
 #include <Wt/Json/Array.h>
 #include <Wt/Json/Object.h>
@@ -31,11 +34,13 @@
 #include "database/Track.hpp"
 #include "database/User.hpp"
 #include "utils/IConfig.hpp"
+#include "utils/IResourceGovernor.hpp"
 #include "utils/http/IClient.hpp"
 #include "utils/Service.hpp"
 
 #include "Exception.hpp"
 #include "FeedbacksParser.hpp"
+#include "StarredCache.hpp"
 #include "Utils.hpp"
 
 namespace Feedback::ListenBrainz
@@ -59,10 +64,11 @@ namespace Feedback::ListenBrainz
         }
     }
 
-    FeedbacksSynchronizer::FeedbacksSynchronizer(boost::asio::io_context& ioContext, Database::Db& db, Http::IClient& client)
+    FeedbacksSynchronizer::FeedbacksSynchronizer(boost::asio::io_context& ioContext, Database::Db& db, Http::IClient& client, StarredCache& starredCache)
         : _ioContext{ ioContext }
         , _db{ db }
         , _client{ client }
+        , _starredCache{ starredCache }
         , _maxSyncFeedbackCount{ Service<IConfig>::get()->getULong("listenbrainz-max-sync-feedback-count", 1000) }
         , _syncFeedbacksPeriod{ Service<IConfig>::get()->getULong("listenbrainz-sync-feedbacks-period-hours", 1) }
     {
@@ -261,6 +267,14 @@ namespace Feedback::ListenBrainz
                     throw Exception{ "GetFeedbacks timer failure: " + std::string {ec.message()} };
                 }
 
+                // not urgent, let the live streams and requests go first
+                if (isForegroundBusy())
+                {
+                    LOG(DEBUG, "Foreground busy, postponing sync");
+                    scheduleSync(std::chrono::seconds{ 60 });
+                    return;
+                }
+
                 startSync();
             }));
     }
@@ -292,6 +306,9 @@ namespace Feedback::ListenBrainz
     {
         context.syncing = true;
         context.listenBrainzUserName = "";
+        context.syncDateTime = {};
+        context.newestFeedbackDateTime = {};
+        context.syncDateTimeReached = false;
         context.fetchedFeedbackCount = 0;
         context.matchedFeedbackCount = 0;
         context.importedFeedbackCount = 0;
@@ -315,7 +332,19 @@ namespace Feedback::ListenBrainz
     {
         assert(context.listenBrainzUserName.empty());
 
-        const std::optional<UUID> listenBrainzToken{ ListenBrainz::Utils::getListenBrainzToken(_db.getTLSSession(), context.userId) };
+        std::optional<UUID> listenBrainzToken;
+        {
+            Database::Session& session{ _db.getTLSSession() };
+            auto transaction{ session.createReadTransaction() };
+
+            const Database::User::pointer user{ Database::User::find(session, context.userId) };
+            if (user)
+            {
+                listenBrainzToken = user->getListenBrainzToken();
+                context.syncDateTime = user->getListenBrainzFeedbacksSyncDateTime();
+            }
+        }
+
         if (!listenBrainzToken)
         {
             onSyncEnded(context);
@@ -393,9 +422,11 @@ namespace Feedback::ListenBrainz
                     {
                         const std::size_t fetchedFeedbackCount{ processGetFeedbacks(msgBodyCopy, context) };
                         if (fetchedFeedbackCount == 0 // no more thing available on server
+                            || context.syncDateTimeReached // older feedbacks already processed during a previous sync
                             || context.fetchedFeedbackCount >= context.feedbackCount // we may miss something, but we will get it next time
                             || context.fetchedFeedbackCount >= _maxSyncFeedbackCount)
                         {
+                            saveSyncDateTime(context);
                             onSyncEnded(context);
                         }
                         else
@@ -419,70 +450,148 @@ namespace Feedback::ListenBrainz
         LOG(DEBUG, "Parsed " << parseResult.feedbackCount << " feedbacks, found " << parseResult.feedbacks.size() << " usable entries");
         context.fetchedFeedbackCount += parseResult.feedbackCount;
 
+        // Feedbacks are sent most recent first
+        // Keep the ones created at the watermark second, as they may not all have been seen yet
+        std::vector<Feedback> feedbacks;
+        feedbacks.reserve(parseResult.feedbacks.size());
         for (const Feedback& feedback : parseResult.feedbacks)
         {
-            tryImportFeedback(feedback, context);
+            if (context.syncDateTime.isValid() && feedback.created < context.syncDateTime)
+            {
+                context.syncDateTimeReached = true;
+                continue;
+            }
+
+            if (!context.newestFeedbackDateTime.isValid() || feedback.created > context.newestFeedbackDateTime)
+                context.newestFeedbackDateTime = feedback.created;
+
+            feedbacks.push_back(feedback);
         }
 
+        importFeedbacks(feedbacks, context);
+
         return parseResult.feedbackCount;
     }
 
-    void FeedbacksSynchronizer::tryImportFeedback(const Feedback& feedback, UserContext& context)
+    void FeedbacksSynchronizer::importFeedbacks(std::span<const Feedback> feedbacks, UserContext& context)
     {
         using namespace Database;
 
+        if (feedbacks.empty())
+            return;
+
         Session& session{ _db.getTLSSession() };
 
-        bool needImport{};
-        TrackId trackId;
+        std::vector<TrackId> trackIdsToImport;
+        std::vector<const Feedback*> feedbacksToImport;
 
         {
+            std::vector<UUID> recordingMBIDs;
+            recordingMBIDs.reserve(feedbacks.size());
+            for (const Feedback& feedback : feedbacks)
+                recordingMBIDs.push_back(feedback.recordingMBID);
+
             auto transaction{ session.createReadTransaction() };
-            const std::vector<Track::pointer> tracks{ Track::findByRecordingMBID(session, feedback.recordingMBID) };
-            if (tracks.size() > 1)
-            {
-                LOG(DEBUG, "Too many matches for feedback '" << feedback << "': duplicate recording MBIDs found");
-                return;
-            }
-            else if (tracks.empty())
+
+            std::unordered_map<std::string, std::vector<TrackId>> trackIdsByMBID;
+            for (const Track::MBIDResult& result : Track::findIdsByRecordingMBIDs(session, recordingMBIDs))
+                trackIdsByMBID[result.mbid.getAsString()].push_back(result.trackId);
+
+            std::vector<TrackId> matchedTrackIds;
+            std::vector<const Feedback*> matchedFeedbacks;
+            for (const Feedback& feedback : feedbacks)
             {
-                LOG(DEBUG, "Cannot match feedback '" << feedback << "': no track found for this recording MBID");
-                return;
-            }
+                auto itTrackIds{ trackIdsByMBID.find(feedback.recordingMBID.getAsString()) };
+                if (itTrackIds == std::cend(trackIdsByMBID))
+                {
+                    LOG(DEBUG, "Cannot match feedback '" << feedback << "': no track found for this recording MBID");
+                    continue;
+                }
+                if (itTrackIds->second.size() > 1)
+                {
+                    LOG(DEBUG, "Too many matches for feedback '" << feedback << "': duplicate recording MBIDs found");
+                    continue;
+                }
 
-            trackId = tracks.front()->getId();
-            needImport = !StarredTrack::exists(session, trackId, context.userId, Database::FeedbackBackend::ListenBrainz);
+                matchedTrackIds.push_back(itTrackIds->second.front());
+                matchedFeedbacks.push_back(&feedback);
+            }
 
             // don't update starred date time
             // no need to update state if it was found as not synchronized
             // pending remove => will be removed later
             // pending add => will be resent later
+            std::unordered_set<TrackId> starredTrackIds;
+            for (const TrackId trackId : StarredTrack::findStarredTrackIds(session, matchedTrackIds, context.userId, FeedbackBackend::ListenBrainz))
+                starredTrackIds.insert(trackId);
+
+            for (std::size_t i{}; i < matchedTrackIds.size(); ++i)
+            {
+                if (!starredTrackIds.insert(matchedTrackIds[i]).second)
+                {
+                    LOG(DEBUG, "No need to import feedback '" << *matchedFeedbacks[i] << "', already imported");
+                    context.matchedFeedbackCount++;
+                    continue;
+                }
+
+                trackIdsToImport.push_back(matchedTrackIds[i]);
+                feedbacksToImport.push_back(matchedFeedbacks[i]);
+            }
         }
 
-        if (needImport)
-        {
-            LOG(DEBUG, "Importing feedback '" << feedback << "'");
+        if (trackIdsToImport.empty())
+            return;
 
+        std::vector<std::pair<TrackId, Wt::WDateTime>> importedFeedbacks;
+        {
             auto transaction{ session.createWriteTransaction() };
 
-            const Track::pointer track{ Track::find(session, trackId) };
-            if (!track)
-                return;
-
             const User::pointer user{ User::find(session, context.userId) };
             if (!user)
                 return;
 
-            StarredTrack::pointer starredTrack{ session.create<StarredTrack>(track, user, Database::FeedbackBackend::ListenBrainz) };
-            starredTrack.modify()->setSyncState(SyncState::Synchronized);
-            starredTrack.modify()->setDateTime(feedback.created);
+            for (std::size_t i{}; i < trackIdsToImport.size(); ++i)
+            {
+                const Track::pointer track{ Track::find(session, trackIdsToImport[i]) };
+                if (!track)
+                    continue;
+
+                LOG(DEBUG, "Importing feedback '" << *feedbacksToImport[i] << "'");
 
-            context.importedFeedbackCount++;
+                StarredTrack::pointer starredTrack{ session.create<StarredTrack>(track, user, Database::FeedbackBackend::ListenBrainz) };
+                starredTrack.modify()->setSyncState(SyncState::Synchronized);
+                starredTrack.modify()->setDateTime(feedbacksToImport[i]->created);
+                importedFeedbacks.emplace_back(trackIdsToImport[i], starredTrack->getDateTime());
+
+                context.importedFeedbackCount++;
+            }
         }
-        else
+
+        // once committed
+        for (const auto& [trackId, dateTime] : importedFeedbacks)
+            _starredCache.onStarred(context.userId, Database::FeedbackBackend::ListenBrainz, trackId, dateTime);
+    }
+
+    void FeedbacksSynchronizer::saveSyncDateTime(const UserContext& context)
+    {
+        if (!context.newestFeedbackDateTime.isValid()
+            || (context.syncDateTime.isValid() && context.newestFeedbackDateTime <= context.syncDateTime))
         {
-            LOG(DEBUG, "No need to import feedback '" << feedback << "', already imported");
-            context.matchedFeedbackCount++;
+            return;
         }
+
+        Database::Session& session{ _db.getTLSSession() };
+        auto transaction{ session.createWriteTransaction() };
+
+        Database::User::pointer user{ Database::User::find(session, context.userId) };
+        if (!user)
+            return;
+
+        // token changed during the sync: the fetched feedbacks belong to the previous account
+        if (user->getListenBrainzFeedbacksSyncDateTime() != context.syncDateTime)
+            return;
+
+        user.modify()->setListenBrainzFeedbacksSyncDateTime(context.newestFeedbackDateTime);
+        LOG(DEBUG, "Feedback sync date time set to " << context.newestFeedbackDateTime.toString() << " for user '" << context.listenBrainzUserName << "'");
     }
 } // namespace Feedback::ListenBrainz
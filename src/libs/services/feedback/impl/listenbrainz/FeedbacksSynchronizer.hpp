@@ -20,10 +20,12 @@
 #pragma once
 
 #include <optional>
+#include <span>
 #include <unordered_map>
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/io_context_strand.hpp>
 #include <boost/asio/steady_timer.hpp>
+#include <Wt/WDateTime.h>
 
 #include "database/Types.hpp"
 #include "database/StarredTrackId.hpp"
@@ -41,12 +43,17 @@ namespace Http
     class IClient;
 }
 
+namespace Feedback
+{
+    class StarredCache;
+}
+
 namespace Feedback::ListenBrainz
 {
     class FeedbacksSynchronizer
     {
     public:
-        FeedbacksSynchronizer(boost::asio::io_context& ioContext, Database::Db& db, Http::IClient& client);
+        FeedbacksSynchronizer(boost::asio::io_context& ioContext, Database::Db& db, Http::IClient& client, StarredCache& starredCache);
 
         void enqueFeedback(FeedbackType type, Database::StarredTrackId starredTrackId);
 
@@ -68,6 +75,9 @@ namespace Feedback::ListenBrainz
 
             // resetted at each sync
             std::string		listenBrainzUserName; // need to be resolved first
+            Wt::WDateTime	syncDateTime; // persisted watermark: feedbacks created before are already processed
+            Wt::WDateTime	newestFeedbackDateTime; // next watermark
+            bool			syncDateTimeReached{};
 
             std::size_t		currentOffset{};
             std::size_t		fetchedFeedbackCount{};
@@ -85,13 +95,15 @@ namespace Feedback::ListenBrainz
         void enqueGetFeedbackCount(UserContext& context);
         void enqueGetFeedbacks(UserContext& context);
         std::size_t processGetFeedbacks(std::string_view body, UserContext& context);
-        void tryImportFeedback(const Feedback& feedback, UserContext& context);
+        void importFeedbacks(std::span<const Feedback> feedbacks, UserContext& context);
+        void saveSyncDateTime(const UserContext& context);
 
         boost::asio::io_context& _ioContext;
         boost::asio::io_context::strand	_strand{ _ioContext };
         Database::Db& _db;
         boost::asio::steady_timer		_syncTimer{ _ioContext };
         Http::IClient& _client;
+        StarredCache& _starredCache; // the imported feedbacks are reported to it
 
         std::unordered_map<Database::UserId, UserContext> _userContexts;
 
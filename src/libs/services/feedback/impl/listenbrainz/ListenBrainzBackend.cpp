@@ -56,12 +56,12 @@ namespace Feedback::ListenBrainz
         }
     }
 
-    ListenBrainzBackend::ListenBrainzBackend(boost::asio::io_context& ioContext, Database::Db& db)
+    ListenBrainzBackend::ListenBrainzBackend(boost::asio::io_context& ioContext, Database::Db& db, StarredCache& starredCache)
         : _ioContext{ ioContext }
         , _db{ db }
         , _baseAPIUrl{ Service<IConfig>::get()->getString("listenbrainz-api-base-url", "https://api.listenbrainz.org") }
         , _client{ Http::createClient(_ioContext, _baseAPIUrl) }
-        , _feedbacksSynchronizer{ _ioContext, db, *_client }
+        , _feedbacksSynchronizer{ _ioContext, db, *_client, starredCache }
     {
         LOG(INFO, "Starting ListenBrainz feedback backend... API endpoint = '" << _baseAPIUrl << "'");
     }
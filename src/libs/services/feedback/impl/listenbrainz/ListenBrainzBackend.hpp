@@ -31,12 +31,17 @@ namespace Database
     class Db;
 }
 
+namespace Feedback
+{
+    class StarredCache;
+}
+
 namespace Feedback::ListenBrainz
 {
     class ListenBrainzBackend final : public IFeedbackBackend
     {
     public:
-        ListenBrainzBackend(boost::asio::io_context& ioContext, Database::Db& db);
+        ListenBrainzBackend(boost::asio::io_context& ioContext, Database::Db& db, StarredCache& starredCache);
         ~ListenBrainzBackend() override;
 
     private:
@@ -21,6 +21,8 @@
 
 #include <memory>
 #include <optional>
+#include <span>
+#include <unordered_map>
 #include <boost/asio/io_service.hpp>
 #include <Wt/WDateTime.h>
 
@@ -91,6 +93,9 @@ namespace Feedback
         virtual bool                isStarred(Database::UserId userId, Database::TrackId artistId) = 0;
         virtual Wt::WDateTime       getStarredDateTime(Database::UserId userId, Database::TrackId artistId) = 0;
         virtual TrackContainer      findStarredTracks(const FindParameters& params) = 0;
+        // Same as getStarredDateTime, for several tracks at once. Tracks that are not starred are not reported
+        using TrackStarredDateTimeContainer = std::unordered_map<Database::TrackId, Wt::WDateTime>;
+        virtual TrackStarredDateTimeContainer getStarredDateTimes(Database::UserId userId, std::span<const Database::TrackId> trackIds) = 0;
     };
 
     std::unique_ptr<IFeedbackService> createFeedbackService(boost::asio::io_service& ioService, Database::Db& db);
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2022 Emeric Poupon
+ * Copyright (C) 2024 Emeric Poupon
  *
  * This file is part of LMS.
  *
@@ -19,14 +19,15 @@
 
 #pragma once
 
-#include "IConstraint.hpp"
+#include <memory>
+#include "IEngine.hpp"
 
-namespace Recommendation::PlaylistGeneratorConstraint
+namespace Database
 {
-	class DuplicateTracks : public IConstraint
-	{
-		private:
-			float computeScore(const std::vector<Database::TrackId>& trackIds, std::size_t trackIndex) override;
-	};
-} // namespace Recommendation::PlaylistGeneratorConstraints
+	class Db;
+}
 
+namespace Recommendation
+{
+	std::unique_ptr<IEngine> createNearestNeighboursEngine(Database::Db& db);
+}
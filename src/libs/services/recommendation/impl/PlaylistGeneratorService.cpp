@@ -19,13 +19,16 @@
 
 #include "PlaylistGeneratorService.hpp"
 
+#include <algorithm>
+#include <limits>
+#include <unordered_set>
+
 #include "database/Db.hpp"
 #include "database/Session.hpp"
 #include "database/Track.hpp"
 #include "services/recommendation/IRecommendationService.hpp"
 #include "playlist-constraints/ConsecutiveArtists.hpp"
 #include "playlist-constraints/ConsecutiveReleases.hpp"
-#include "playlist-constraints/DuplicateTracks.hpp"
 #include "utils/ILogger.hpp"
 
 namespace Recommendation
@@ -41,9 +44,8 @@ namespace Recommendation
         : _db{ db }
         , _recommendationService{ recommendationService }
     {
-        _constraints.push_back(std::make_unique<PlaylistGeneratorConstraint::ConsecutiveArtists>(_db));
-        _constraints.push_back(std::make_unique<PlaylistGeneratorConstraint::ConsecutiveReleases>(_db));
-        _constraints.push_back(std::make_unique<PlaylistGeneratorConstraint::DuplicateTracks>());
+        _constraints.push_back(std::make_unique<PlaylistGeneratorConstraint::ConsecutiveArtists>());
+        _constraints.push_back(std::make_unique<PlaylistGeneratorConstraint::ConsecutiveReleases>());
     }
 
     std::vector<TrackId> PlaylistGeneratorService::extendPlaylist(TrackListId tracklistId, std::size_t maxCount) const
@@ -55,38 +57,46 @@ namespace Recommendation
 
         const std::vector<TrackId> startingTracks{ getTracksFromTrackList(tracklistId) };
 
+        // duplicates are never selected: drop the candidates already in the playlist, or already proposed
+        {
+            std::unordered_set<TrackId> seenTracks(std::cbegin(startingTracks), std::cend(startingTracks));
+            similarTracks.erase(std::remove_if(std::begin(similarTracks), std::end(similarTracks), [&](TrackId trackId) { return !seenTracks.insert(trackId).second; }), std::end(similarTracks));
+        }
+
+        const PlaylistGeneratorConstraint::TrackMetadataMap trackMetadata{ getTrackMetadata(startingTracks, similarTracks) };
+
         std::vector<TrackId> finalResult = startingTracks;
         finalResult.reserve(startingTracks.size() + maxCount);
 
-        std::vector<float> scores;
         for (std::size_t i{}; i < maxCount; ++i)
         {
             if (similarTracks.empty())
                 break;
 
-            scores.resize(similarTracks.size(), {});
-
             // select the similar track that has the best score
+            std::size_t bestScoreIndex{};
+            float bestScore{ std::numeric_limits<float>::max() };
             for (std::size_t trackIndex{}; trackIndex < similarTracks.size(); ++trackIndex)
             {
-                using namespace Database::Debug;
-
                 finalResult.push_back(similarTracks[trackIndex]);
 
-                scores[trackIndex] = 0;
+                float score{};
                 for (const auto& constraint : _constraints)
-                    scores[trackIndex] += constraint->computeScore(finalResult, finalResult.size() - 1);
+                    score += constraint->computeScore(finalResult, finalResult.size() - 1, trackMetadata);
 
                 finalResult.pop_back();
 
+                if (score < bestScore)
+                {
+                    bestScore = score;
+                    bestScoreIndex = trackIndex;
+                }
+
                 // early exit if we consider we found a track with no constraint violation (since similarTracks sorted from most to least similar)
-                if (scores[trackIndex] < 0.01)
+                if (score < 0.01)
                     break;
             }
 
-            // get the best score
-            const std::size_t bestScoreIndex{ static_cast<std::size_t>(std::distance(std::cbegin(scores), std::min_element(std::cbegin(scores), std::cend(scores)))) };
-
             finalResult.push_back(similarTracks[bestScoreIndex]);
             similarTracks.erase(std::begin(similarTracks) + bestScoreIndex);
         }
@@ -111,4 +121,32 @@ namespace Recommendation
 
         return tracks;
     }
+
+    PlaylistGeneratorConstraint::TrackMetadataMap PlaylistGeneratorService::getTrackMetadata(std::span<const TrackId> startingTracks, std::span<const TrackId> similarTracks) const
+    {
+        PlaylistGeneratorConstraint::TrackMetadataMap trackMetadata;
+        trackMetadata.reserve(startingTracks.size() + similarTracks.size());
+
+        Session& dbSession{ _db.getTLSSession() };
+        auto transaction{ dbSession.createReadTransaction() };
+
+        auto addTrackMetadata{ [&](const Track::ArtistLinkIds& ids)
+            {
+                PlaylistGeneratorConstraint::TrackMetadata& metadata{ trackMetadata[ids.trackId] };
+                metadata.release = ids.releaseId;
+                if (ids.artistId.isValid())
+                    metadata.artists.push_back(ids.artistId);
+            } };
+
+        Track::findArtistLinkIds(dbSession, startingTracks, addTrackMetadata);
+        Track::findArtistLinkIds(dbSession, similarTracks, addTrackMetadata);
+
+        for (auto& [trackId, metadata] : trackMetadata)
+        {
+            std::sort(std::begin(metadata.artists), std::end(metadata.artists));
+            metadata.artists.erase(std::unique(std::begin(metadata.artists), std::end(metadata.artists)), std::end(metadata.artists));
+        }
+
+        return trackMetadata;
+    }
 }
@@ -19,6 +19,8 @@
 
 #pragma once
 
+#include <span>
+
 #include "services/recommendation/IPlaylistGeneratorService.hpp"
 #include "services/recommendation/IRecommendationService.hpp"
 #include "playlist-constraints/IConstraint.hpp"
@@ -34,6 +36,7 @@ namespace Recommendation
 			TrackContainer extendPlaylist(Database::TrackListId tracklistId, std::size_t maxCount) const override;
 
 			TrackContainer getTracksFromTrackList(Database::TrackListId tracklistId) const;
+			PlaylistGeneratorConstraint::TrackMetadataMap getTrackMetadata(std::span<const Database::TrackId> startingTracks, std::span<const Database::TrackId> similarTracks) const;
 
 			Database::Db& _db;
 			Recommendation::IRecommendationService& _recommendationService;
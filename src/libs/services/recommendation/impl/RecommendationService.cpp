@@ -19,17 +19,31 @@
 
 #include "RecommendationService.hpp"
 
-#include <unordered_map>
+#if defined(__linux__)
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <utility>
 #include <vector>
 
+#include <boost/asio/post.hpp>
+
 #include "ClustersEngineCreator.hpp"
 #include "FeaturesEngineCreator.hpp"
+#include "NearestNeighboursEngineCreator.hpp"
 
 #include "database/Db.hpp"
 #include "database/Session.hpp"
 #include "database/ScanSettings.hpp"
 #include "utils/Exception.hpp"
+#include "utils/IConfig.hpp"
 #include "utils/ILogger.hpp"
+#include "utils/Service.hpp"
 
 namespace Recommendation
 {
@@ -41,83 +55,238 @@ namespace Recommendation
 
             return Database::ScanSettings::get(session)->getSimilarityEngineType();
         }
+
+        std::unique_ptr<IEngine> createEngine(Database::Db& db, Database::ScanSettings::SimilarityEngineType engineType)
+        {
+            using namespace Database;
+
+            switch (engineType)
+            {
+            case ScanSettings::SimilarityEngineType::Clusters:
+                return createClustersEngine(db);
+
+            case ScanSettings::SimilarityEngineType::NearestNeighbours:
+                return createNearestNeighboursEngine(db);
+
+            case ScanSettings::SimilarityEngineType::Features:
+            case ScanSettings::SimilarityEngineType::None:
+                break;
+            }
+
+            return {};
+        }
+
+        std::unique_ptr<IEngine> createEngine(Database::Db& db, EngineType engineType)
+        {
+            switch (engineType)
+            {
+            case EngineType::Clusters:
+                return createClustersEngine(db);
+
+            case EngineType::Features:
+                return createFeaturesEngine(db);
+
+            case EngineType::NearestNeighbours:
+                return createNearestNeighboursEngine(db);
+            }
+
+            return {};
+        }
+
+        // Loading an engine is CPU intensive, let the requests being served go first
+        void lowerCurrentThreadPriority()
+        {
+#if defined(__linux__)
+            // On Linux, the nice value is a per thread attribute
+            if (::setpriority(PRIO_PROCESS, static_cast<id_t>(::syscall(SYS_gettid)), 10) < 0)
+                LMS_LOG(RECOMMENDATION, WARNING, "Cannot lower the priority of the engine loading thread: " << ::strerror(errno));
+#endif
+        }
+
+        template <typename IdType>
+        void appendIds(std::string& key, const std::vector<IdType>& ids)
+        {
+            for (const IdType id : ids)
+            {
+                key += std::to_string(id.getValue());
+                key += ',';
+            }
+        }
     }
 
-    std::unique_ptr<IRecommendationService> createRecommendationService(Database::Db& db)
+    std::unique_ptr<IRecommendationService> createRecommendationService(Database::Db& db, std::optional<EngineType> forcedEngineType)
     {
-        return std::make_unique<RecommendationService>(db);
+        return std::make_unique<RecommendationService>(db, forcedEngineType);
     }
 
-    RecommendationService::RecommendationService(Database::Db& db)
+    RecommendationService::RecommendationService(Database::Db& db, std::optional<EngineType> forcedEngineType)
         : _db{ db }
+        , _forcedEngineType{ forcedEngineType }
+        , _resultCache{ Service<IConfig>::get()->getULong("recommendation-cache-max-entries", 1024) }
+        , _loadContextRunner{ _loadContext, 1 }
     {
-        load();
+        boost::asio::post(_loadContext, [] { lowerCurrentThreadPriority(); });
+        load({});
+    }
+
+    RecommendationService::~RecommendationService()
+    {
+        {
+            std::scoped_lock lock{ _loadMutex };
+
+            _stopping = true;
+            if (_loadingEngine)
+                _loadingEngine->requestCancelLoad();
+        }
+
+        _loadContextRunner.stop();
     }
 
     TrackContainer RecommendationService::findSimilarTracks(Database::TrackListId trackListId, std::size_t maxCount) const
     {
         TrackContainer res;
 
-        if (!_engine)
+        std::uint64_t engineGeneration{};
+        const std::shared_ptr<IEngine> engine{ getEngine(engineGeneration) };
+        if (!engine)
             return res;
 
-        return _engine->findSimilarTracksFromTrackList(trackListId, maxCount);
+        // Not cached: the content of the track list may change at any time
+        return engine->findSimilarTracksFromTrackList(trackListId, maxCount);
     }
 
     TrackContainer RecommendationService::findSimilarTracks(const std::vector<Database::TrackId>& trackIds, std::size_t maxCount) const
     {
         TrackContainer res;
 
-        if (!_engine)
+        std::uint64_t engineGeneration{};
+        const std::shared_ptr<IEngine> engine{ getEngine(engineGeneration) };
+        if (!engine)
             return res;
 
-        return _engine->findSimilarTracks(trackIds, maxCount);
+        std::string key{ "tracks:" + std::to_string(maxCount) + ":" };
+        appendIds(key, trackIds);
+        if (std::optional<TrackContainer> cachedRes{ _resultCache.get<Database::TrackId>(engineGeneration, key) })
+            return std::move(*cachedRes);
+
+        res = engine->findSimilarTracks(trackIds, maxCount);
+        _resultCache.put(engineGeneration, key, res);
+
+        return res;
     }
 
     ReleaseContainer RecommendationService::getSimilarReleases(Database::ReleaseId releaseId, std::size_t maxCount) const
     {
         ReleaseContainer res;
 
-        if (!_engine)
+        std::uint64_t engineGeneration{};
+        const std::shared_ptr<IEngine> engine{ getEngine(engineGeneration) };
+        if (!engine)
             return res;
 
-        return _engine->getSimilarReleases(releaseId, maxCount);;
+        const std::string key{ "releases:" + std::to_string(maxCount) + ":" + std::to_string(releaseId.getValue()) };
+        if (std::optional<ReleaseContainer> cachedRes{ _resultCache.get<Database::ReleaseId>(engineGeneration, key) })
+            return std::move(*cachedRes);
+
+        res = engine->getSimilarReleases(releaseId, maxCount);
+        _resultCache.put(engineGeneration, key, res);
+
+        return res;
     }
 
     ArtistContainer RecommendationService::getSimilarArtists(Database::ArtistId artistId, EnumSet<Database::TrackArtistLinkType> linkTypes, std::size_t maxCount) const
     {
         ArtistContainer res;
 
-        if (!_engine)
+        std::uint64_t engineGeneration{};
+        const std::shared_ptr<IEngine> engine{ getEngine(engineGeneration) };
+        if (!engine)
             return res;
 
-        return _engine->getSimilarArtists(artistId, linkTypes, maxCount);
+        const std::string key{ "artists:" + std::to_string(maxCount) + ":" + std::to_string(linkTypes.getBitfield()) + ":" + std::to_string(artistId.getValue()) };
+        if (std::optional<ArtistContainer> cachedRes{ _resultCache.get<Database::ArtistId>(engineGeneration, key) })
+            return std::move(*cachedRes);
+
+        res = engine->getSimilarArtists(artistId, linkTypes, maxCount);
+        _resultCache.put(engineGeneration, key, res);
 
         return res;
     }
 
-    void RecommendationService::load()
+    std::shared_ptr<IEngine> RecommendationService::getEngine(std::uint64_t& engineGeneration) const
+    {
+        std::shared_lock lock{ _engineMutex };
+        engineGeneration = _engineGeneration;
+        return _engine;
+    }
+
+    void RecommendationService::load(const ProgressCallback& progressCallback)
+    {
+        std::scoped_lock lock{ _loadMutex };
+
+        if (_stopping)
+            return;
+
+        // The ongoing load is outdated, the pending one will start over
+        if (_loadingEngine)
+            _loadingEngine->requestCancelLoad();
+
+        _loadProgressCallback = progressCallback;
+        if (_loadPending)
+            return;
+
+        _loadPending = true;
+        boost::asio::post(_loadContext, [this] { processPendingLoad(); });
+    }
+
+    void RecommendationService::waitLoaded() const
+    {
+        std::unique_lock lock{ _loadMutex };
+        _loadCondVar.wait(lock, [this] { return !_loadPending && !_loadingEngine; });
+    }
+
+    void RecommendationService::processPendingLoad()
     {
-        using namespace Database;
+        ProgressCallback progressCallback;
+        std::shared_ptr<IEngine> engine;
 
-        switch (getSimilarityEngineType(_db.getTLSSession()))
         {
-        case ScanSettings::SimilarityEngineType::Clusters:
-            if (_engineType != EngineType::Clusters)
+            std::scoped_lock lock{ _loadMutex };
+
+            _loadPending = false;
+            progressCallback = std::move(_loadProgressCallback);
+
+            if (!_stopping)
             {
-                _engineType = EngineType::Clusters;
-                _engine = createClustersEngine(_db);
+                engine = _forcedEngineType ? createEngine(_db, *_forcedEngineType) : createEngine(_db, getSimilarityEngineType(_db.getTLSSession()));
+                _loadingEngine = engine;
             }
-            break;
+        }
 
-        case ScanSettings::SimilarityEngineType::Features:
-        case ScanSettings::SimilarityEngineType::None:
-            _engineType.reset();
-            _engine.reset();
-            break;
+        if (engine)
+        {
+            LMS_LOG(RECOMMENDATION, INFO, "Loading recommendation engine...");
+            engine->load(false, progressCallback);
+        }
+
+        std::shared_ptr<IEngine> previousEngine;
+        {
+            std::scoped_lock lock{ _loadMutex };
+
+            _loadingEngine.reset();
+
+            // may have been cancelled by a more recent load request, or by the service destruction
+            if (!_loadPending && !_stopping)
+            {
+                {
+                    std::unique_lock engineLock{ _engineMutex };
+                    previousEngine = std::exchange(_engine, std::move(engine));
+                    _engineGeneration++;
+                }
+                LMS_LOG(RECOMMENDATION, INFO, "Recommendation engine loaded");
+            }
         }
 
-        if (_engine)
-            _engine->load(false);
+        _loadCondVar.notify_all();
     }
 } // ns Similarity
@@ -19,10 +19,19 @@
 
 #pragma once
 
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <shared_mutex>
+
+#include <boost/asio/io_context.hpp>
 
 #include "services/recommendation/IRecommendationService.hpp"
+#include "utils/IOContextRunner.hpp"
 #include "IEngine.hpp"
+#include "SimilarityResultCache.hpp"
 
 namespace Database
 {
@@ -31,37 +40,48 @@ namespace Database
 
 namespace Recommendation
 {
-    enum class EngineType
-    {
-        Clusters,
-        Features,
-    };
-
     class RecommendationService : public IRecommendationService
     {
     public:
-        RecommendationService(Database::Db& db);
-        ~RecommendationService() = default;
+        RecommendationService(Database::Db& db, std::optional<EngineType> forcedEngineType);
+        ~RecommendationService() override;
 
         RecommendationService(const RecommendationService&) = delete;
         RecommendationService& operator=(const RecommendationService&) = delete;
 
     private:
-        void load() override;
+        void load(const ProgressCallback& progressCallback) override;
+        void waitLoaded() const override;
 
         TrackContainer findSimilarTracks(Database::TrackListId tracklistId, std::size_t maxCount) const override;
         TrackContainer findSimilarTracks(const std::vector<Database::TrackId>& tracksId, std::size_t maxCount) const override;
         ReleaseContainer getSimilarReleases(Database::ReleaseId releaseId, std::size_t maxCount) const override;
         ArtistContainer getSimilarArtists(Database::ArtistId artistId, EnumSet<Database::TrackArtistLinkType> linkTypes, std::size_t maxCount) const override;
 
-        void setEnginePriorities(const std::vector<EngineType>& engineTypes);
-        void clearEngines();
-        void loadPendingEngine(EngineType engineType, std::unique_ptr<IEngine> engine, bool forceReload, const ProgressCallback& progressCallback);
+        std::shared_ptr<IEngine> getEngine(std::uint64_t& engineGeneration) const;
+        void processPendingLoad();
 
         Database::Db& _db;
-        std::optional<EngineType> _engineType;
-        std::unique_ptr<IEngine> _engine;
+        const std::optional<EngineType> _forcedEngineType;
+
+        // Engine in use, only replaced once its successor is completely loaded
+        mutable std::shared_mutex _engineMutex;
+        std::shared_ptr<IEngine> _engine;
+        std::uint64_t _engineGeneration{}; // incremented each time the engine is replaced
+
+        // Results of the repeated lookups, dropped each time the engine is replaced
+        mutable SimilarityResultCache _resultCache;
+
+        // Engines are loaded one at a time, on a low priority thread
+        mutable std::mutex _loadMutex;
+        mutable std::condition_variable _loadCondVar;
+        bool _loadPending{};
+        ProgressCallback _loadProgressCallback;
+        std::shared_ptr<IEngine> _loadingEngine;
+        bool _stopping{};
+
+        boost::asio::io_context _loadContext;
+        IOContextRunner _loadContextRunner;
     };
 
 } // ns Recommendation
-
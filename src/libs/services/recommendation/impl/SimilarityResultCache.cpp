@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "SimilarityResultCache.hpp"
+
+namespace Recommendation
+{
+    SimilarityResultCache::SimilarityResultCache(std::size_t maxEntryCount)
+        : _maxEntryCount{ maxEntryCount }
+    {
+    }
+
+    std::optional<SimilarityResultCache::Entry> SimilarityResultCache::getEntry(std::uint64_t engineGeneration, const std::string& key)
+    {
+        std::scoped_lock lock{ _mutex };
+
+        clearIfOutdated(engineGeneration);
+        if (engineGeneration != _engineGeneration)
+            return std::nullopt;
+
+        auto it{ _entriesByKey.find(key) };
+        if (it == std::cend(_entriesByKey))
+            return std::nullopt;
+
+        _entries.splice(std::begin(_entries), _entries, it->second);
+        return it->second->second;
+    }
+
+    void SimilarityResultCache::putEntry(std::uint64_t engineGeneration, const std::string& key, Entry entry)
+    {
+        std::scoped_lock lock{ _mutex };
+
+        clearIfOutdated(engineGeneration);
+        if (engineGeneration != _engineGeneration) // computed by an engine that has been replaced meanwhile
+            return;
+
+        if (auto it{ _entriesByKey.find(key) }; it != std::cend(_entriesByKey))
+        {
+            it->second->second = std::move(entry);
+            _entries.splice(std::begin(_entries), _entries, it->second);
+            return;
+        }
+
+        _entries.emplace_front(key, std::move(entry));
+        _entriesByKey.emplace(key, std::begin(_entries));
+
+        while (_entries.size() > _maxEntryCount)
+        {
+            _entriesByKey.erase(_entries.back().first);
+            _entries.pop_back();
+        }
+    }
+
+    void SimilarityResultCache::clearIfOutdated(std::uint64_t engineGeneration)
+    {
+        if (engineGeneration <= _engineGeneration)
+            return;
+
+        _engineGeneration = engineGeneration;
+        _entries.clear();
+        _entriesByKey.clear();
+    }
+} // namespace Recommendation
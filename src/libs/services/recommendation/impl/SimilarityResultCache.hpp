@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <variant>
+
+#include "services/recommendation/Types.hpp"
+
+namespace Recommendation
+{
+    // Similarity results, keyed by the lookup parameters (seeds, link types, count)
+    // Entries are tagged with the engine generation they have been computed with: everything is dropped as soon as another engine is in use
+    class SimilarityResultCache
+    {
+    public:
+        SimilarityResultCache(std::size_t maxEntryCount);
+
+        SimilarityResultCache(const SimilarityResultCache&) = delete;
+        SimilarityResultCache& operator=(const SimilarityResultCache&) = delete;
+
+        template <typename IdType>
+        std::optional<ResultContainer<IdType>> get(std::uint64_t engineGeneration, const std::string& key)
+        {
+            std::optional<Entry> entry{ getEntry(engineGeneration, key) };
+            if (!entry)
+                return std::nullopt;
+
+            if (auto* results{ std::get_if<ResultContainer<IdType>>(&*entry) })
+                return std::move(*results);
+
+            return std::nullopt;
+        }
+
+        // engineGeneration must be the generation of the engine that computed the results
+        template <typename IdType>
+        void put(std::uint64_t engineGeneration, const std::string& key, const ResultContainer<IdType>& results)
+        {
+            putEntry(engineGeneration, key, results);
+        }
+
+    private:
+        using Entry = std::variant<ArtistContainer, ReleaseContainer, TrackContainer>;
+
+        std::optional<Entry> getEntry(std::uint64_t engineGeneration, const std::string& key);
+        void putEntry(std::uint64_t engineGeneration, const std::string& key, Entry entry);
+        void clearIfOutdated(std::uint64_t engineGeneration);
+
+        const std::size_t _maxEntryCount;
+
+        std::mutex _mutex;
+        std::uint64_t _engineGeneration{};
+        using EntryList = std::list<std::pair<std::string, Entry>>; // most recently used first
+        EntryList _entries;
+        std::unordered_map<std::string, EntryList::iterator> _entriesByKey;
+    };
+} // namespace Recommendation
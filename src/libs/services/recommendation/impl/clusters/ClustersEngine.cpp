@@ -24,6 +24,7 @@
 #include "database/Db.hpp"
 #include "database/Release.hpp"
 #include "database/Session.hpp"
+#include "database/Similarity.hpp"
 #include "database/Track.hpp"
 #include "database/TrackList.hpp"
 
@@ -44,7 +45,11 @@ namespace Recommendation {
         Session& dbSession{ _db.getTLSSession() };
         auto transaction{ dbSession.createReadTransaction() };
 
-        const auto similarTrackIds{ Track::findSimilarTrackIds(dbSession, trackIds, Range {0, maxCount}) };
+        // Precomputed by the scanner, may not be available yet
+        auto similarTrackIds{ Similarity::findSimilarTrackIds(dbSession, trackIds, Range {0, maxCount}) };
+        if (similarTrackIds.results.empty())
+            similarTrackIds = Track::findSimilarTrackIds(dbSession, trackIds, Range {0, maxCount});
+
         return std::move(similarTrackIds.results);
     }
 
@@ -80,6 +85,10 @@ namespace Recommendation {
             Session& dbSession{ _db.getTLSSession() };
             auto transaction{ dbSession.createReadTransaction() };
 
+            auto similarReleaseIds{ Similarity::findSimilarReleaseIds(dbSession, releaseId, Range {0, maxCount}) };
+            if (!similarReleaseIds.results.empty())
+                return std::move(similarReleaseIds.results);
+
             auto release{ Release::find(dbSession, releaseId) };
             if (!release)
                 return res;
@@ -100,6 +109,10 @@ namespace Recommendation {
         Session& dbSession{ _db.getTLSSession() };
         auto transaction{ dbSession.createReadTransaction() };
 
+        auto similarArtistIds{ Similarity::findSimilarArtistIds(dbSession, artistId, artistLinkTypes, Range {0, maxCount}) };
+        if (!similarArtistIds.results.empty())
+            return std::move(similarArtistIds.results);
+
         auto artist{ Artist::find(dbSession, artistId) };
         if (!artist)
             return {};
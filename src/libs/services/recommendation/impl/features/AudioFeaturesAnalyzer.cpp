@@ -0,0 +1,742 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "AudioFeaturesAnalyzer.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <charconv>
+#include <cmath>
+#include <numbers>
+#include <numeric>
+
+namespace Recommendation
+{
+    namespace
+    {
+        constexpr double sampleRateAsDouble{ static_cast<double>(IAudioFeaturesAnalyzer::sampleRate) };
+        constexpr std::size_t cepstralCoefficientCount{ 13 };
+        constexpr std::size_t filterBankBandCount{ 40 };
+        constexpr std::size_t contrastBandCount{ 6 };
+        constexpr std::size_t maxMedianValueCount{ 4096 }; // per dimension
+        constexpr float logFloor{ 1e-10f };
+
+        constexpr std::array<std::string_view, 9> statNames{ "dmean", "dmean2", "dvar", "dvar2", "max", "mean", "median", "min", "var" };
+
+        double binToFrequency(std::size_t bin)
+        {
+            return static_cast<double>(bin) * sampleRateAsDouble / static_cast<double>(AudioFeaturesAnalyzer::frameSize);
+        }
+
+        std::size_t frequencyToBin(double frequency)
+        {
+            const double bin{ std::round(frequency * static_cast<double>(AudioFeaturesAnalyzer::frameSize) / sampleRateAsDouble) };
+            return std::min(static_cast<std::size_t>(std::max(bin, 0.0)), AudioFeaturesAnalyzer::spectrumSize - 1);
+        }
+
+        std::vector<float> computeBinFrequencies()
+        {
+            std::vector<float> frequencies(AudioFeaturesAnalyzer::spectrumSize);
+            for (std::size_t bin{}; bin < frequencies.size(); ++bin)
+                frequencies[bin] = static_cast<float>(binToFrequency(bin));
+
+            return frequencies;
+        }
+
+        std::vector<float> computeWindow()
+        {
+            // Hann, normalized so that the spectrum of a full scale sine peaks at 1
+            std::vector<float> window(AudioFeaturesAnalyzer::frameSize);
+            double sum{};
+            for (std::size_t i{}; i < window.size(); ++i)
+            {
+                window[i] = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * std::numbers::pi * static_cast<double>(i) / static_cast<double>(window.size() - 1)));
+                sum += window[i];
+            }
+
+            for (float& value : window)
+                value = static_cast<float>(value * 2.0 / sum);
+
+            return window;
+        }
+
+        // twiddles of the half size complex FFT, followed by the ones used to split its output into the real input spectrum
+        std::vector<std::complex<float>> computeTwiddles()
+        {
+            constexpr std::size_t size{ AudioFeaturesAnalyzer::frameSize };
+
+            std::vector<std::complex<float>> twiddles(size / 4 + size / 2);
+            for (std::size_t i{}; i < size / 4; ++i)
+                twiddles[i] = std::polar(1.0, -2.0 * std::numbers::pi * static_cast<double>(i) / static_cast<double>(size / 2));
+            for (std::size_t i{}; i < size / 2; ++i)
+                twiddles[size / 4 + i] = std::polar(1.0, -2.0 * std::numbers::pi * static_cast<double>(i) / static_cast<double>(size));
+
+            return twiddles;
+        }
+
+        // std::complex multiplication handles infinities, which is much slower
+        std::complex<float> multiply(std::complex<float> a, std::complex<float> b)
+        {
+            return { a.real() * b.real() - a.imag() * b.imag(), a.real() * b.imag() + a.imag() * b.real() };
+        }
+
+        // in place, radix 2
+        void computeFFT(std::span<std::complex<float>> data, std::span<const std::complex<float>> twiddles)
+        {
+            const std::size_t size{ data.size() };
+            assert(std::has_single_bit(size));
+            assert(twiddles.size() >= size / 2);
+
+            for (std::size_t i{ 1 }, j{}; i < size; ++i)
+            {
+                std::size_t bit{ size >> 1 };
+                for (; j & bit; bit >>= 1)
+                    j ^= bit;
+                j ^= bit;
+
+                if (i < j)
+                    std::swap(data[i], data[j]);
+            }
+
+            for (std::size_t length{ 2 }; length <= size; length <<= 1)
+            {
+                const std::size_t halfLength{ length / 2 };
+                const std::size_t twiddleStride{ size / length };
+                for (std::size_t i{}; i < size; i += length)
+                {
+                    for (std::size_t j{}; j < halfLength; ++j)
+                    {
+                        const std::complex<float> u{ data[i + j] };
+                        const std::complex<float> v{ multiply(data[i + j + halfLength], twiddles[j * twiddleStride]) };
+                        data[i + j] = u + v;
+                        data[i + j + halfLength] = u - v;
+                    }
+                }
+            }
+        }
+
+        template<typename Band>
+        std::vector<Band> computeRectangularBands(std::span<const double> edges)
+        {
+            std::vector<Band> bands;
+            for (std::size_t i{}; i + 1 < edges.size(); ++i)
+            {
+                const std::size_t firstBin{ frequencyToBin(edges[i]) };
+                const std::size_t lastBin{ std::max(frequencyToBin(edges[i + 1]), firstBin + 1) };
+                bands.push_back(Band{ firstBin, std::vector<float>(lastBin - firstBin, 1.0f) });
+            }
+
+            return bands;
+        }
+
+        // Triangular bands, evenly spaced on the given scale, normalized so that the weights of each band sum to 1
+        template<typename Band, typename ToScale, typename FromScale>
+        std::vector<Band> computeTriangularBands(double lowFrequency, double highFrequency, std::size_t bandCount, ToScale toScale, FromScale fromScale)
+        {
+            std::vector<double> frequencies(bandCount + 2);
+            const double low{ toScale(lowFrequency) };
+            const double high{ toScale(highFrequency) };
+            for (std::size_t i{}; i < frequencies.size(); ++i)
+                frequencies[i] = fromScale(low + (high - low) * static_cast<double>(i) / static_cast<double>(bandCount + 1));
+
+            std::vector<Band> bands;
+            for (std::size_t i{}; i < bandCount; ++i)
+            {
+                const double left{ frequencies[i] };
+                const double center{ frequencies[i + 1] };
+                const double right{ frequencies[i + 2] };
+
+                Band band{ frequencyToBin(left), {} };
+                for (std::size_t bin{ band.firstBin }; bin < AudioFeaturesAnalyzer::spectrumSize && binToFrequency(bin) <= right; ++bin)
+                {
+                    const double frequency{ binToFrequency(bin) };
+                    double weight{};
+                    if (frequency >= left && frequency <= center)
+                        weight = (frequency - left) / (center - left);
+                    else if (frequency > center)
+                        weight = (right - frequency) / (right - center);
+                    band.weights.push_back(static_cast<float>(std::max(weight, 0.0)));
+                }
+
+                float sum{ std::accumulate(std::cbegin(band.weights), std::cend(band.weights), 0.0f) };
+                if (sum == 0)
+                {
+                    // narrower than a bin
+                    band.firstBin = frequencyToBin(center);
+                    band.weights = { 1.0f };
+                    sum = 1.0f;
+                }
+                for (float& weight : band.weights)
+                    weight /= sum;
+
+                bands.push_back(std::move(band));
+            }
+
+            return bands;
+        }
+
+        std::vector<std::vector<float>> computeDctMatrix()
+        {
+            // orthonormal DCT-II
+            std::vector<std::vector<float>> matrix(cepstralCoefficientCount, std::vector<float>(filterBankBandCount));
+            for (std::size_t i{}; i < cepstralCoefficientCount; ++i)
+            {
+                const double scale{ std::sqrt((i == 0 ? 1.0 : 2.0) / static_cast<double>(filterBankBandCount)) };
+                for (std::size_t j{}; j < filterBankBandCount; ++j)
+                    matrix[i][j] = static_cast<float>(scale * std::cos(std::numbers::pi * static_cast<double>(i) * (static_cast<double>(j) + 0.5) / static_cast<double>(filterBankBandCount)));
+            }
+
+            return matrix;
+        }
+
+        struct DistributionShape
+        {
+            float spread{};
+            float skewness{};
+            float kurtosis{};
+        };
+
+        // values are the weights of the positions, spaced by step
+        DistributionShape computeDistributionShape(std::span<const float> values, double step)
+        {
+            const double sum{ std::accumulate(std::cbegin(values), std::cend(values), 0.0) };
+            if (sum <= 0)
+                return {};
+
+            double centroid{};
+            for (std::size_t i{}; i < values.size(); ++i)
+                centroid += static_cast<double>(i) * step * values[i];
+            centroid /= sum;
+
+            double m2{};
+            double m3{};
+            double m4{};
+            for (std::size_t i{}; i < values.size(); ++i)
+            {
+                const double deviation{ static_cast<double>(i) * step - centroid };
+                const double weight{ values[i] / sum };
+                m2 += weight * deviation * deviation;
+                m3 += weight * deviation * deviation * deviation;
+                m4 += weight * deviation * deviation * deviation * deviation;
+            }
+
+            if (m2 <= 0)
+                return {};
+
+            return DistributionShape{ static_cast<float>(m2), static_cast<float>(m3 / std::pow(m2, 1.5)), static_cast<float>(m4 / (m2 * m2) - 3.0) };
+        }
+
+        float toDb(float value)
+        {
+            return 20.0f * std::log10(std::max(value, logFloor));
+        }
+
+        void writeNumber(std::string& output, double value)
+        {
+            if (!std::isfinite(value))
+                value = 0;
+
+            std::array<char, 32> buffer;
+            const auto [end, error]{ std::to_chars(buffer.data(), buffer.data() + buffer.size(), value) };
+            assert(error == std::errc{});
+            output.append(buffer.data(), end);
+        }
+    }
+
+    std::unique_ptr<IAudioFeaturesAnalyzer> createAudioFeaturesAnalyzer()
+    {
+        return std::make_unique<AudioFeaturesAnalyzer>();
+    }
+
+    void AudioFeaturesAnalyzer::DimensionStats::RunningStats::add(double value)
+    {
+        count++;
+        const double delta{ value - mean };
+        mean += delta / static_cast<double>(count);
+        m2 += delta * (value - mean);
+    }
+
+    void AudioFeaturesAnalyzer::DimensionStats::add(float value)
+    {
+        if (_values.count == 0)
+        {
+            _min = value;
+            _max = value;
+        }
+        else
+        {
+            _min = std::min(_min, value);
+            _max = std::max(_max, value);
+
+            const float derivative{ std::abs(value - _lastValue) };
+            if (_derivatives.count > 0)
+                _secondDerivatives.add(std::abs(derivative - _lastDerivative));
+            _derivatives.add(derivative);
+            _lastDerivative = derivative;
+        }
+        _values.add(value);
+        _lastValue = value;
+
+        if (++_medianSkipped < _medianStride)
+            return;
+
+        _medianSkipped = 0;
+        _medianValues.push_back(value);
+        if (_medianValues.size() == maxMedianValueCount)
+        {
+            // keep one value out of two
+            for (std::size_t i{}; i < _medianValues.size() / 2; ++i)
+                _medianValues[i] = _medianValues[i * 2 + 1];
+            _medianValues.resize(_medianValues.size() / 2);
+            _medianStride *= 2;
+        }
+    }
+
+    double AudioFeaturesAnalyzer::DimensionStats::computeMedian() const
+    {
+        if (_medianValues.empty())
+            return 0;
+
+        std::vector<float> values{ _medianValues };
+        auto itMedian{ std::begin(values) + values.size() / 2 };
+        std::nth_element(std::begin(values), itMedian, std::end(values));
+        return *itMedian;
+    }
+
+    void AudioFeaturesAnalyzer::DimensionStats::writeStat(std::string& output, std::string_view stat) const
+    {
+        double value{};
+        if (stat == "dmean")
+            value = _derivatives.mean;
+        else if (stat == "dmean2")
+            value = _secondDerivatives.mean;
+        else if (stat == "dvar")
+            value = _derivatives.getVariance();
+        else if (stat == "dvar2")
+            value = _secondDerivatives.getVariance();
+        else if (stat == "max")
+            value = _max;
+        else if (stat == "mean")
+            value = _values.mean;
+        else if (stat == "median")
+            value = computeMedian();
+        else if (stat == "min")
+            value = _min;
+        else if (stat == "var")
+            value = _values.getVariance();
+
+        writeNumber(output, value);
+    }
+
+    AudioFeaturesAnalyzer::AudioFeaturesAnalyzer()
+        : _window{ computeWindow() }
+        , _twiddles{ computeTwiddles() }
+        , _binFrequencies{ computeBinFrequencies() }
+        , _barkBands{ computeRectangularBands<Band>(std::array<double, 28>{ 0, 50, 100, 150, 200, 300, 400, 510, 630, 770, 920, 1080, 1270, 1480, 1720, 2000, 2320, 2700, 3150, 3700, 4400, 5300, 6400, 7700, 9500, 12000, 15500, 20500 }) }
+        , _melBands{ computeTriangularBands<Band>(0, sampleRateAsDouble / 2, filterBankBandCount,
+            [](double frequency) { return 2595.0 * std::log10(1.0 + frequency / 700.0); },
+            [](double mel) { return 700.0 * (std::pow(10.0, mel / 2595.0) - 1.0); }) }
+        , _erbBands{ computeTriangularBands<Band>(50, sampleRateAsDouble / 2, filterBankBandCount,
+            [](double frequency) { return 21.4 * std::log10(1.0 + 0.00437 * frequency); },
+            [](double erb) { return (std::pow(10.0, erb / 21.4) - 1.0) / 0.00437; }) }
+        , _dctMatrix{ computeDctMatrix() }
+        , _fftBuffer(frameSize / 2)
+        , _spectrum(spectrumSize)
+        , _powerSpectrum(spectrumSize)
+        , _previousSpectrum(spectrumSize)
+    {
+        // same names as the AcousticBrainz low level features
+        _indexes.spectralCentroid = addDescriptor("spectral_centroid", 1);
+        _indexes.spectralSpread = addDescriptor("spectral_spread", 1);
+        _indexes.spectralSkewness = addDescriptor("spectral_skewness", 1);
+        _indexes.spectralKurtosis = addDescriptor("spectral_kurtosis", 1);
+        _indexes.spectralRolloff = addDescriptor("spectral_rolloff", 1);
+        _indexes.spectralFlux = addDescriptor("spectral_flux", 1);
+        _indexes.spectralRms = addDescriptor("spectral_rms", 1);
+        _indexes.spectralEnergy = addDescriptor("spectral_energy", 1);
+        _indexes.spectralEnergyBandLow = addDescriptor("spectral_energyband_low", 1);
+        _indexes.spectralEnergyBandMiddleLow = addDescriptor("spectral_energyband_middle_low", 1);
+        _indexes.spectralEnergyBandMiddleHigh = addDescriptor("spectral_energyband_middle_high", 1);
+        _indexes.spectralEnergyBandHigh = addDescriptor("spectral_energyband_high", 1);
+        _indexes.spectralEntropy = addDescriptor("spectral_entropy", 1);
+        _indexes.spectralDecrease = addDescriptor("spectral_decrease", 1);
+        _indexes.spectralComplexity = addDescriptor("spectral_complexity", 1);
+        _indexes.spectralStrongPeak = addDescriptor("spectral_strongpeak", 1);
+        _indexes.spectralContrastCoeffs = addDescriptor("spectral_contrast_coeffs", contrastBandCount);
+        _indexes.spectralContrastValleys = addDescriptor("spectral_contrast_valleys", contrastBandCount);
+        _indexes.hfc = addDescriptor("hfc", 1);
+        _indexes.zeroCrossingRate = addDescriptor("zerocrossingrate", 1);
+        _indexes.silenceRate30dB = addDescriptor("silence_rate_30dB", 1);
+        _indexes.silenceRate60dB = addDescriptor("silence_rate_60dB", 1);
+
+        auto addBandsDescriptors{ [this](std::string_view name, std::size_t bandCount)
+            {
+                const std::size_t index{ addDescriptor(name, bandCount) };
+                for (std::string_view shape : { "_crest", "_flatness_db", "_kurtosis", "_skewness", "_spread" })
+                    addDescriptor(std::string{ name } + std::string{ shape }, 1);
+                return index;
+            } };
+        _indexes.barkBands = addBandsDescriptors("barkbands", _barkBands.size());
+        _indexes.melBands = addBandsDescriptors("melbands", _melBands.size());
+        _indexes.erbBands = addBandsDescriptors("erbbands", _erbBands.size());
+        _indexes.mfcc = addDescriptor("mfcc", cepstralCoefficientCount);
+        _indexes.gfcc = addDescriptor("gfcc", cepstralCoefficientCount);
+    }
+
+    AudioFeaturesAnalyzer::~AudioFeaturesAnalyzer() = default;
+
+    std::size_t AudioFeaturesAnalyzer::addDescriptor(std::string_view name, std::size_t dimCount)
+    {
+        _descriptors.push_back(Descriptor{ std::string{ name }, std::vector<DimensionStats>(dimCount) });
+        return _descriptors.size() - 1;
+    }
+
+    void AudioFeaturesAnalyzer::addValues(std::size_t descriptorIndex, std::span<const float> values)
+    {
+        std::vector<DimensionStats>& dimensions{ _descriptors[descriptorIndex].dimensions };
+        assert(dimensions.size() == values.size());
+
+        for (std::size_t i{}; i < values.size(); ++i)
+            dimensions[i].add(values[i]);
+    }
+
+    void AudioFeaturesAnalyzer::process(std::span<const float> samples)
+    {
+        _pendingSamples.insert(std::end(_pendingSamples), std::cbegin(samples), std::cend(samples));
+
+        std::size_t offset{};
+        for (; offset + frameSize <= _pendingSamples.size(); offset += hopSize)
+            analyzeFrame(std::span{ _pendingSamples }.subspan(offset, frameSize));
+
+        _pendingSamples.erase(std::begin(_pendingSamples), std::begin(_pendingSamples) + offset);
+    }
+
+    void AudioFeaturesAnalyzer::analyzeFrame(std::span<const float> frame)
+    {
+        // time domain
+        {
+            std::size_t zeroCrossingCount{};
+            double power{};
+            for (std::size_t i{}; i < frame.size(); ++i)
+            {
+                power += frame[i] * frame[i];
+                if (i > 0 && std::signbit(frame[i]) != std::signbit(frame[i - 1]))
+                    zeroCrossingCount++;
+            }
+            power /= static_cast<double>(frame.size());
+
+            addValue(_indexes.zeroCrossingRate, static_cast<float>(zeroCrossingCount) / static_cast<float>(frame.size()));
+            addValue(_indexes.silenceRate30dB, power < std::pow(10.0, -30.0 / 10.0) ? 1.0f : 0.0f);
+            addValue(_indexes.silenceRate60dB, power < std::pow(10.0, -60.0 / 10.0) ? 1.0f : 0.0f);
+        }
+
+        computeSpectrum(frame);
+
+        const double magnitudeSum{ std::accumulate(std::cbegin(_spectrum), std::cend(_spectrum), 0.0) };
+        const double energy{ std::accumulate(std::cbegin(_powerSpectrum), std::cend(_powerSpectrum), 0.0) };
+
+        addValue(_indexes.spectralEnergy, static_cast<float>(energy));
+        addValue(_indexes.spectralRms, static_cast<float>(std::sqrt(energy / static_cast<double>(spectrumSize))));
+
+        auto computeBandEnergy{ [this](double lowFrequency, double highFrequency)
+            {
+                const std::size_t lastBin{ frequencyToBin(highFrequency) };
+                double bandEnergy{};
+                for (std::size_t bin{ frequencyToBin(lowFrequency) }; bin <= lastBin; ++bin)
+                    bandEnergy += _powerSpectrum[bin];
+                return static_cast<float>(bandEnergy);
+            } };
+        addValue(_indexes.spectralEnergyBandLow, computeBandEnergy(20, 150));
+        addValue(_indexes.spectralEnergyBandMiddleLow, computeBandEnergy(150, 800));
+        addValue(_indexes.spectralEnergyBandMiddleHigh, computeBandEnergy(800, 4000));
+        addValue(_indexes.spectralEnergyBandHigh, computeBandEnergy(4000, 20000));
+
+        // shape of the spectrum, in Hz
+        {
+            double centroid{};
+            if (magnitudeSum > 0)
+            {
+                for (std::size_t bin{}; bin < spectrumSize; ++bin)
+                    centroid += _binFrequencies[bin] * _spectrum[bin];
+                centroid /= magnitudeSum;
+            }
+            addValue(_indexes.spectralCentroid, static_cast<float>(centroid));
+
+            const DistributionShape shape{ computeDistributionShape(_spectrum, binToFrequency(1)) };
+            addValue(_indexes.spectralSpread, shape.spread);
+            addValue(_indexes.spectralSkewness, shape.skewness);
+            addValue(_indexes.spectralKurtosis, shape.kurtosis);
+        }
+
+        {
+            double rolloffEnergy{};
+            std::size_t rolloffBin{};
+            for (; rolloffBin < spectrumSize; ++rolloffBin)
+            {
+                rolloffEnergy += _powerSpectrum[rolloffBin];
+                if (rolloffEnergy >= 0.85 * energy)
+                    break;
+            }
+            addValue(_indexes.spectralRolloff, energy > 0 ? _binFrequencies[std::min(rolloffBin, spectrumSize - 1)] : 0.0f);
+        }
+
+        {
+            double flux{};
+            for (std::size_t bin{}; bin < spectrumSize; ++bin)
+            {
+                const double delta{ _spectrum[bin] - _previousSpectrum[bin] };
+                flux += delta * delta;
+            }
+            addValue(_indexes.spectralFlux, static_cast<float>(std::sqrt(flux)));
+        }
+
+        {
+            double entropy{};
+            if (magnitudeSum > 0)
+            {
+                for (const float magnitude : _spectrum)
+                {
+                    if (magnitude <= 0)
+                        continue;
+
+                    const double probability{ magnitude / magnitudeSum };
+                    entropy -= probability * std::log2(probability);
+                }
+            }
+            addValue(_indexes.spectralEntropy, static_cast<float>(entropy));
+        }
+
+        {
+            double decrease{};
+            const double sum{ magnitudeSum - _spectrum[0] };
+            if (sum > 0)
+            {
+                for (std::size_t bin{ 1 }; bin < spectrumSize; ++bin)
+                    decrease += (_spectrum[bin] - _spectrum[0]) / static_cast<double>(bin);
+                decrease /= sum;
+            }
+            addValue(_indexes.spectralDecrease, static_cast<float>(decrease));
+        }
+
+        {
+            constexpr float peakThreshold{ 0.005f };
+
+            std::size_t peakCount{};
+            for (std::size_t bin{ 1 }; bin + 1 < spectrumSize; ++bin)
+            {
+                if (_spectrum[bin] > peakThreshold && _spectrum[bin] > _spectrum[bin - 1] && _spectrum[bin] >= _spectrum[bin + 1])
+                    peakCount++;
+            }
+            addValue(_indexes.spectralComplexity, static_cast<float>(peakCount));
+        }
+
+        {
+            // peak magnitude divided by its bandwidth
+            float strongPeak{};
+            const auto itMax{ std::max_element(std::cbegin(_spectrum) + 1, std::cend(_spectrum)) };
+            if (*itMax > 0)
+            {
+                const std::size_t peakBin{ static_cast<std::size_t>(std::distance(std::cbegin(_spectrum), itMax)) };
+                std::size_t lowBin{ peakBin };
+                while (lowBin > 1 && _spectrum[lowBin - 1] > *itMax / 2)
+                    lowBin--;
+                std::size_t highBin{ peakBin + 1 };
+                while (highBin < spectrumSize - 1 && _spectrum[highBin] > *itMax / 2)
+                    highBin++;
+
+                strongPeak = *itMax / std::log10(static_cast<float>(highBin) / static_cast<float>(lowBin));
+            }
+            addValue(_indexes.spectralStrongPeak, strongPeak);
+        }
+
+        {
+            double hfc{};
+            for (std::size_t bin{}; bin < spectrumSize; ++bin)
+                hfc += _binFrequencies[bin] * _powerSpectrum[bin];
+            addValue(_indexes.hfc, static_cast<float>(hfc));
+        }
+
+        analyzeSpectralContrast();
+
+        analyzeBands(_barkBands, _indexes.barkBands);
+        analyzeBands(_melBands, _indexes.melBands);
+        analyzeCepstralCoefficients(_indexes.mfcc);
+        analyzeBands(_erbBands, _indexes.erbBands);
+        analyzeCepstralCoefficients(_indexes.gfcc);
+
+        std::swap(_previousSpectrum, _spectrum);
+        _frameCount++;
+    }
+
+    void AudioFeaturesAnalyzer::computeSpectrum(std::span<const float> frame)
+    {
+        // real input: even samples as real parts, odd samples as imaginary parts of a half size FFT
+        constexpr std::size_t halfSize{ frameSize / 2 };
+        for (std::size_t i{}; i < halfSize; ++i)
+            _fftBuffer[i] = std::complex<float>{ frame[2 * i] * _window[2 * i], frame[2 * i + 1] * _window[2 * i + 1] };
+
+        computeFFT(_fftBuffer, std::span{ _twiddles }.first(frameSize / 4));
+
+        const std::span<const std::complex<float>> splitTwiddles{ std::span{ _twiddles }.subspan(frameSize / 4) };
+        for (std::size_t bin{}; bin < spectrumSize; ++bin)
+        {
+            const std::complex<float> z{ _fftBuffer[bin % halfSize] };
+            const std::complex<float> zMirror{ std::conj(_fftBuffer[(halfSize - bin % halfSize) % halfSize]) };
+
+            const std::complex<float> even{ (z + zMirror) * 0.5f };
+            const std::complex<float> odd{ (z - zMirror) * std::complex<float>{ 0, -0.5f } };
+            const std::complex<float> value{ bin < halfSize ? even + multiply(odd, splitTwiddles[bin]) : even - odd };
+
+            _powerSpectrum[bin] = value.real() * value.real() + value.imag() * value.imag();
+            _spectrum[bin] = std::sqrt(_powerSpectrum[bin]);
+        }
+    }
+
+    void AudioFeaturesAnalyzer::analyzeBands(const FilterBank& filterBank, std::size_t descriptorIndex)
+    {
+        _bandEnergies.resize(filterBank.size());
+        for (std::size_t i{}; i < filterBank.size(); ++i)
+        {
+            const Band& band{ filterBank[i] };
+
+            double bandEnergy{};
+            for (std::size_t j{}; j < band.weights.size() && band.firstBin + j < spectrumSize; ++j)
+                bandEnergy += band.weights[j] * _powerSpectrum[band.firstBin + j];
+            _bandEnergies[i] = static_cast<float>(bandEnergy);
+        }
+        addValues(descriptorIndex, _bandEnergies);
+
+        const double sum{ std::accumulate(std::cbegin(_bandEnergies), std::cend(_bandEnergies), 0.0) };
+        const double mean{ sum / static_cast<double>(_bandEnergies.size()) };
+
+        // crest
+        addValue(descriptorIndex + 1, mean > 0 ? static_cast<float>(*std::max_element(std::cbegin(_bandEnergies), std::cend(_bandEnergies)) / mean) : 0.0f);
+
+        // flatness, 0 (flat) to 1 (peaky)
+        {
+            double flatnessDb{ 1.0 };
+            if (mean > 0)
+            {
+                double logSum{};
+                for (const float bandEnergy : _bandEnergies)
+                    logSum += std::log(std::max(bandEnergy, logFloor));
+                const double geometricMean{ std::exp(logSum / static_cast<double>(_bandEnergies.size())) };
+                flatnessDb = std::clamp(10.0 * std::log10(geometricMean / mean) / -60.0, 0.0, 1.0);
+            }
+            addValue(descriptorIndex + 2, static_cast<float>(flatnessDb));
+        }
+
+        const DistributionShape shape{ computeDistributionShape(_bandEnergies, 1.0) };
+        addValue(descriptorIndex + 3, shape.kurtosis);
+        addValue(descriptorIndex + 4, shape.skewness);
+        addValue(descriptorIndex + 5, shape.spread);
+    }
+
+    void AudioFeaturesAnalyzer::analyzeCepstralCoefficients(std::size_t descriptorIndex)
+    {
+        // uses the band energies computed last
+        assert(_bandEnergies.size() == filterBankBandCount);
+
+        _bandValues.resize(cepstralCoefficientCount);
+        for (std::size_t i{}; i < cepstralCoefficientCount; ++i)
+        {
+            double coefficient{};
+            for (std::size_t j{}; j < filterBankBandCount; ++j)
+                coefficient += _dctMatrix[i][j] * toDb(_bandEnergies[j]);
+            _bandValues[i] = static_cast<float>(coefficient);
+        }
+        addValues(descriptorIndex, _bandValues);
+    }
+
+    void AudioFeaturesAnalyzer::analyzeSpectralContrast()
+    {
+        // octave like bands between 20 Hz and 11 kHz, the peaks and valleys are the means of the 40% highest/lowest magnitudes of each band
+        constexpr double lowFrequency{ 20 };
+        constexpr double highFrequency{ 11'000 };
+        constexpr double neighbourRatio{ 0.4 };
+
+        std::array<float, contrastBandCount> coeffs;
+        std::array<float, contrastBandCount> valleys;
+        for (std::size_t i{}; i < contrastBandCount; ++i)
+        {
+            const std::size_t firstBin{ frequencyToBin(lowFrequency * std::pow(highFrequency / lowFrequency, static_cast<double>(i) / contrastBandCount)) };
+            const std::size_t lastBin{ std::max(frequencyToBin(lowFrequency * std::pow(highFrequency / lowFrequency, static_cast<double>(i + 1) / contrastBandCount)), firstBin + 1) };
+
+            _bandValues.assign(std::cbegin(_spectrum) + firstBin, std::cbegin(_spectrum) + lastBin);
+            std::sort(std::begin(_bandValues), std::end(_bandValues));
+
+            const std::size_t neighbourCount{ std::max<std::size_t>(1, static_cast<std::size_t>(std::round(neighbourRatio * static_cast<double>(_bandValues.size())))) };
+            const double valley{ std::accumulate(std::cbegin(_bandValues), std::cbegin(_bandValues) + neighbourCount, 0.0) / static_cast<double>(neighbourCount) };
+            const double peak{ std::accumulate(std::cend(_bandValues) - neighbourCount, std::cend(_bandValues), 0.0) / static_cast<double>(neighbourCount) };
+
+            valleys[i] = static_cast<float>(std::log(valley + logFloor));
+            coeffs[i] = static_cast<float>(std::log(peak + logFloor) - valleys[i]);
+        }
+
+        addValues(_indexes.spectralContrastCoeffs, coeffs);
+        addValues(_indexes.spectralContrastValleys, valleys);
+    }
+
+    std::optional<std::string> AudioFeaturesAnalyzer::getJsonEncodedFeatures() const
+    {
+        // less than a second is not meaningful
+        if (_frameCount < sampleRate / hopSize)
+            return std::nullopt;
+
+        std::string output{ "{\"lowlevel\":{" };
+        for (std::size_t descriptorIndex{}; descriptorIndex < _descriptors.size(); ++descriptorIndex)
+        {
+            const Descriptor& descriptor{ _descriptors[descriptorIndex] };
+            if (descriptorIndex > 0)
+                output += ',';
+            output += '"';
+            output += descriptor.name;
+            output += "\":{";
+
+            for (std::size_t statIndex{}; statIndex < statNames.size(); ++statIndex)
+            {
+                if (statIndex > 0)
+                    output += ',';
+                output += '"';
+                output += statNames[statIndex];
+                output += "\":";
+
+                if (descriptor.dimensions.size() == 1)
+                {
+                    descriptor.dimensions.front().writeStat(output, statNames[statIndex]);
+                    continue;
+                }
+
+                output += '[';
+                for (std::size_t dimIndex{}; dimIndex < descriptor.dimensions.size(); ++dimIndex)
+                {
+                    if (dimIndex > 0)
+                        output += ',';
+                    descriptor.dimensions[dimIndex].writeStat(output, statNames[statIndex]);
+                }
+                output += ']';
+            }
+            output += '}';
+        }
+        output += "}}";
+
+        return output;
+    }
+}
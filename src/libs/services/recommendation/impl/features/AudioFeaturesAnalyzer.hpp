@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <array>
+#include <complex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "services/recommendation/IAudioFeaturesAnalyzer.hpp"
+
+namespace Recommendation
+{
+    // Frame based analysis, close to what the Essentia music extractor computes for AcousticBrainz
+    // Descriptors are aggregated on the fly, so that long tracks can be analyzed using a bounded amount of memory
+    class AudioFeaturesAnalyzer : public IAudioFeaturesAnalyzer
+    {
+    public:
+        AudioFeaturesAnalyzer();
+        ~AudioFeaturesAnalyzer() override;
+
+        AudioFeaturesAnalyzer(const AudioFeaturesAnalyzer&) = delete;
+        AudioFeaturesAnalyzer& operator=(const AudioFeaturesAnalyzer&) = delete;
+
+        static constexpr std::size_t frameSize{ 2048 };
+        static constexpr std::size_t hopSize{ 1024 };
+        static constexpr std::size_t spectrumSize{ frameSize / 2 + 1 };
+
+    private:
+        void process(std::span<const float> samples) override;
+        std::optional<std::string> getJsonEncodedFeatures() const override;
+
+        // Statistics of one dimension of a descriptor over all the frames (mean, var, min, max, median, and same on derivatives)
+        class DimensionStats
+        {
+        public:
+            void add(float value);
+            void writeStat(std::string& output, std::string_view stat) const;
+
+        private:
+            struct RunningStats
+            {
+                std::size_t count{};
+                double mean{};
+                double m2{};
+
+                void add(double value);
+                double getVariance() const { return count ? m2 / static_cast<double>(count) : 0; }
+            };
+
+            double computeMedian() const;
+
+            RunningStats _values;
+            RunningStats _derivatives;
+            RunningStats _secondDerivatives;
+            float _min{};
+            float _max{};
+            float _lastValue{};
+            float _lastDerivative{};
+
+            // decimated values, to compute the median using a bounded amount of memory
+            std::vector<float> _medianValues;
+            std::size_t _medianStride{ 1 };
+            std::size_t _medianSkipped{};
+        };
+
+        // Triangular or rectangular weights applied to the power spectrum
+        struct Band
+        {
+            std::size_t firstBin;
+            std::vector<float> weights;
+        };
+        using FilterBank = std::vector<Band>;
+
+        struct Descriptor
+        {
+            std::string name;
+            std::vector<DimensionStats> dimensions;
+        };
+
+        std::size_t addDescriptor(std::string_view name, std::size_t dimCount);
+        void addValue(std::size_t descriptorIndex, float value) { _descriptors[descriptorIndex].dimensions.front().add(value); }
+        void addValues(std::size_t descriptorIndex, std::span<const float> values);
+
+        void analyzeFrame(std::span<const float> frame);
+        void computeSpectrum(std::span<const float> frame);
+        // also adds the band shape descriptors (crest, flatness, etc.), that must follow descriptorIndex
+        void analyzeBands(const FilterBank& filterBank, std::size_t descriptorIndex);
+        void analyzeCepstralCoefficients(std::size_t descriptorIndex);
+        void analyzeSpectralContrast();
+
+        const std::vector<float> _window;
+        const std::vector<std::complex<float>> _twiddles;
+        const std::vector<float> _binFrequencies;
+        const FilterBank _barkBands;
+        const FilterBank _melBands;
+        const FilterBank _erbBands;
+        const std::vector<std::vector<float>> _dctMatrix; // 40 mel/erb bands -> 13 cepstral coefficients
+
+        std::vector<float> _pendingSamples;
+        std::size_t _frameCount{};
+
+        // per frame buffers
+        std::vector<std::complex<float>> _fftBuffer;
+        std::vector<float> _spectrum; // magnitude
+        std::vector<float> _powerSpectrum;
+        std::vector<float> _previousSpectrum;
+        std::vector<float> _bandEnergies;
+        std::vector<float> _bandValues;
+
+        std::vector<Descriptor> _descriptors;
+        struct DescriptorIndexes
+        {
+            std::size_t spectralCentroid;
+            std::size_t spectralSpread;
+            std::size_t spectralSkewness;
+            std::size_t spectralKurtosis;
+            std::size_t spectralRolloff;
+            std::size_t spectralFlux;
+            std::size_t spectralRms;
+            std::size_t spectralEnergy;
+            std::size_t spectralEnergyBandLow;
+            std::size_t spectralEnergyBandMiddleLow;
+            std::size_t spectralEnergyBandMiddleHigh;
+            std::size_t spectralEnergyBandHigh;
+            std::size_t spectralEntropy;
+            std::size_t spectralDecrease;
+            std::size_t spectralComplexity;
+            std::size_t spectralStrongPeak;
+            std::size_t spectralContrastCoeffs;
+            std::size_t spectralContrastValleys;
+            std::size_t hfc;
+            std::size_t zeroCrossingRate;
+            std::size_t silenceRate30dB;
+            std::size_t silenceRate60dB;
+            std::size_t barkBands;
+            std::size_t melBands;
+            std::size_t erbBands;
+            std::size_t mfcc;
+            std::size_t gfcc;
+        } _indexes;
+    };
+}
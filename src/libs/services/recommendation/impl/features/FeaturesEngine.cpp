@@ -30,8 +30,12 @@
 #include "database/TrackFeatures.hpp"
 #include "database/TrackList.hpp"
 #include "som/DataNormalizer.hpp"
+#include "utils/IConfig.hpp"
 #include "utils/ILogger.hpp"
+#include "utils/IResourceGovernor.hpp"
+#include "utils/Service.hpp"
 #include "utils/Random.hpp"
+#include "FeaturesLoader.hpp"
 
 namespace Recommendation
 {
@@ -44,42 +48,27 @@ namespace Recommendation
 
     namespace
     {
-        std::optional<SOM::InputVector> convertFeatureValuesMapToInputVector(const FeatureValuesMap& featureValuesMap, std::size_t nbDimensions)
+        std::unordered_set<FeatureName> getFeatureNames(const FeatureSettingsMap& featureSettingsMap)
         {
-            std::size_t i{};
-            std::optional<SOM::InputVector> res{ SOM::InputVector {nbDimensions} };
-            for (const auto& [featureName, values] : featureValuesMap)
-            {
-                if (values.size() != getFeatureDef(featureName).nbDimensions)
-                {
-                    LMS_LOG(RECOMMENDATION, WARNING, "Dimension mismatch for feature '" << featureName << "'. Expected " << getFeatureDef(featureName).nbDimensions << ", got " << values.size());
-                    res.reset();
-                    break;
-                }
+            std::unordered_set<FeatureName> featureNames;
+            std::transform(std::cbegin(featureSettingsMap), std::cend(featureSettingsMap), std::inserter(featureNames, std::begin(featureNames)),
+                [](const auto& itFeatureSetting) { return itFeatureSetting.first; });
 
-                for (double val : values)
-                    (*res)[i++] = val;
-            }
-
-            return res;
+            return featureNames;
         }
 
-        SOM::InputVector getInputVectorWeights(const FeatureSettingsMap& featureSettingsMap, std::size_t nbDimensions)
+        SOM::InputVector getInputVectorWeights(const FeatureSettingsMap& featureSettingsMap, const FeaturesExtractor& featuresExtractor)
         {
-            SOM::InputVector weights{ nbDimensions };
-            std::size_t index{};
-            for (const auto& [featureName, featureSettings] : featureSettingsMap)
+            SOM::InputVector weights{ featuresExtractor.getDimCount() };
+            for (const FeaturesExtractor::Feature& feature : featuresExtractor.getFeatures())
             {
-                const std::size_t featureNbDimensions{ getFeatureDef(featureName).nbDimensions };
-
-                for (std::size_t i{}; i < featureNbDimensions; ++i)
-                    weights[index++] = (1. / featureNbDimensions * featureSettings.weight);
+                for (std::size_t i{}; i < feature.dimCount; ++i)
+                    weights[feature.offset + i] = (1. / feature.dimCount * featureSettingsMap.at(feature.name).weight);
             }
 
-            assert(index == nbDimensions);
-
             return weights;
         }
+
     }
 
     const FeatureSettingsMap& FeaturesEngine::getDefaultTrainFeatureSettings()
@@ -100,57 +89,29 @@ namespace Recommendation
     {
         LMS_LOG(RECOMMENDATION, INFO, "Constructing features classifier...");
 
-        std::unordered_set<FeatureName> featureNames;
-        std::transform(std::cbegin(trainSettings.featureSettingsMap), std::cend(trainSettings.featureSettingsMap), std::inserter(featureNames, std::begin(featureNames)),
-            [](const auto& itFeatureSetting) { return itFeatureSetting.first; });
-
-        const std::size_t nbDimensions{ std::accumulate(std::cbegin(featureNames), std::cend(featureNames), std::size_t {0},
-                [](std::size_t sum, const FeatureName& featureName) { return sum + getFeatureDef(featureName).nbDimensions; }) };
+        const FeaturesExtractor featuresExtractor{ getFeatureNames(trainSettings.featureSettingsMap) };
+        const std::size_t nbDimensions{ featuresExtractor.getDimCount() };
 
         LMS_LOG(RECOMMENDATION, DEBUG, "Features dimension = " << nbDimensions);
 
-        Session & session{ _db.getTLSSession() };
-
-        RangeResults<TrackFeaturesId> trackFeaturesIds;
-        {
-            auto transaction{ session.createReadTransaction() };
-
-            LMS_LOG(RECOMMENDATION, DEBUG, "Getting Track features...");
-            trackFeaturesIds = TrackFeatures::find(session);
-            LMS_LOG(RECOMMENDATION, DEBUG, "Getting Track features DONE (found " << trackFeaturesIds.results.size() << " track features)");
-        }
-
         std::vector<SOM::InputVector> samples;
         std::vector<TrackId> samplesTrackIds;
+        TrackFeaturesId lastTrackFeaturesId;
 
-        samples.reserve(trackFeaturesIds.results.size());
-        samplesTrackIds.reserve(trackFeaturesIds.results.size());
+        // normalization factors are computed while the samples are extracted
+        SOM::DataNormalizer dataNormalizer{ nbDimensions };
+        dataNormalizer.resetNormalizationFactors();
 
         LMS_LOG(RECOMMENDATION, DEBUG, "Extracting features...");
-        // TODO handle errors using exceptions
-        for (const TrackFeaturesId trackFeaturesId : trackFeaturesIds.results)
+        loadFeatures(_db, featuresExtractor, lastTrackFeaturesId, trainSettings.threadCount, [this] { return _loadCancelled; }, [&](TrackId trackId, SOM::InputVector&& inputVector)
         {
-            if (_loadCancelled)
-                return;
-
-            auto transaction{ session.createReadTransaction() };
-
-            TrackFeatures::pointer trackFeatures{ TrackFeatures::find(session, trackFeaturesId) };
-            if (!trackFeatures)
-                continue;
-
-            FeatureValuesMap featureValuesMap{ trackFeatures->getFeatureValuesMap(featureNames) };
-            if (featureValuesMap.empty())
-                continue;
-
-            std::optional<SOM::InputVector> inputVector{ convertFeatureValuesMapToInputVector(featureValuesMap, nbDimensions) };
-            if (!inputVector)
-                continue;
-
-            samples.emplace_back(std::move(*inputVector));
-            samplesTrackIds.emplace_back(trackFeatures->getTrack()->getId());
-        }
-        LMS_LOG(RECOMMENDATION, DEBUG, "Extracting features DONE");
+            dataNormalizer.updateNormalizationFactors(inputVector);
+            samples.emplace_back(std::move(inputVector));
+            samplesTrackIds.emplace_back(trackId);
+        });
+        if (_loadCancelled)
+            return;
+        LMS_LOG(RECOMMENDATION, DEBUG, "Extracting features DONE (" << samples.size() << " tracks)");
 
         if (samples.empty())
         {
@@ -159,11 +120,7 @@ namespace Recommendation
         }
 
         LMS_LOG(RECOMMENDATION, DEBUG, "Normalizing data...");
-        SOM::DataNormalizer dataNormalizer{ nbDimensions };
-
-        dataNormalizer.computeNormalizationFactors(samples);
-        for (auto& sample : samples)
-            dataNormalizer.normalizeData(sample);
+        dataNormalizer.normalizeData(samples, trainSettings.threadCount);
 
         SOM::Coordinate size{ static_cast<SOM::Coordinate>(std::sqrt(samples.size() / trainSettings.sampleCountPerNeuron)) };
         if (size < 2)
@@ -175,7 +132,7 @@ namespace Recommendation
 
         SOM::Network network{ size, size, nbDimensions };
 
-        SOM::InputVector weights{ getInputVectorWeights(trainSettings.featureSettingsMap, nbDimensions) };
+        SOM::InputVector weights{ getInputVectorWeights(trainSettings.featureSettingsMap, featuresExtractor) };
         network.setDataWeights(weights);
 
         auto somProgressCallback{ [&](const SOM::Network::CurrentIteration& iter)
@@ -185,9 +142,20 @@ namespace Recommendation
         } };
 
         LMS_LOG(RECOMMENDATION, DEBUG, "Training network...");
-        network.train(samples, trainSettings.iterationCount,
-            progressCallback ? somProgressCallback : SOM::Network::ProgressCallback{},
-            [this] { return _loadCancelled; });
+        switch (trainSettings.mode)
+        {
+        case TrainSettings::Mode::Online:
+            network.train(samples, trainSettings.iterationCount,
+                progressCallback ? somProgressCallback : SOM::Network::ProgressCallback{},
+                [this] { return _loadCancelled; });
+            break;
+
+        case TrainSettings::Mode::Batch:
+            network.trainBatch(samples, trainSettings.iterationCount, trainSettings.threadCount,
+                progressCallback ? somProgressCallback : SOM::Network::ProgressCallback{},
+                [this] { throttleBackgroundWork(); return _loadCancelled; }); // called once per iteration
+            break;
+        }
         LMS_LOG(RECOMMENDATION, DEBUG, "Training network DONE");
 
         LMS_LOG(RECOMMENDATION, DEBUG, "Classifying tracks...");
@@ -205,6 +173,11 @@ namespace Recommendation
         LMS_LOG(RECOMMENDATION, DEBUG, "Classifying tracks DONE");
 
         load(std::move(network), std::move(trackPositions));
+
+        _dataNormalizer.emplace(std::move(dataNormalizer));
+        _featureSettingsMap = trainSettings.featureSettingsMap;
+        _lastTrackFeaturesId = lastTrackFeaturesId;
+        _driftingTrackCount = 0;
     }
 
     void FeaturesEngine::loadFromCache(FeaturesEngineCache&& cache)
@@ -212,6 +185,64 @@ namespace Recommendation
         LMS_LOG(RECOMMENDATION, INFO, "Constructing features classifier from cache...");
 
         load(std::move(cache._network), cache._trackPositions);
+
+        _dataNormalizer.reset();
+        if (cache._dataNormalizer)
+            _dataNormalizer.emplace(*cache._dataNormalizer);
+        _featureSettingsMap = getDefaultTrainFeatureSettings();
+        _lastTrackFeaturesId = cache._lastTrackFeaturesId;
+        _driftingTrackCount = cache._driftingTrackCount;
+    }
+
+    std::optional<std::size_t> FeaturesEngine::placeNewTracks()
+    {
+        const FeaturesExtractor featuresExtractor{ getFeatureNames(_featureSettingsMap) };
+        const std::size_t nbDimensions{ featuresExtractor.getDimCount() };
+
+        if (!_dataNormalizer || _dataNormalizer->getInputDimCount() != nbDimensions || _network->getInputDimCount() != nbDimensions)
+        {
+            LMS_LOG(RECOMMENDATION, INFO, "Cannot place new tracks in the current classifier");
+            return std::nullopt;
+        }
+
+        LMS_LOG(RECOMMENDATION, DEBUG, "Placing new tracks...");
+
+        Session& session{ _db.getTLSSession() };
+
+        std::size_t placedTrackCount{};
+        loadFeatures(_db, featuresExtractor, _lastTrackFeaturesId, Service<IConfig>::get()->getULong("recommendation-features-training-thread-count", 0), [this] { return _loadCancelled; }, [&](TrackId trackId, SOM::InputVector&& inputVector)
+        {
+            if (_trackIndex.contains(trackId))
+                return;
+
+            _dataNormalizer->normalizeData(inputVector);
+
+            const SOM::Network::ClosestRefVector closestRefVector{ _network->getClosestRefVector(inputVector) };
+            const SOM::Position position{ closestRefVector.position };
+            if (closestRefVector.distance > _networkRefVectorsDistanceMedian)
+                _driftingTrackCount++;
+
+            auto transaction{ session.createReadTransaction() };
+
+            addTrack(session, trackId, std::span<const SOM::Position>{ &position, 1 });
+            placedTrackCount++;
+        });
+        if (_loadCancelled)
+            return std::nullopt;
+
+        buildIndexes();
+
+        // drift is the proportion of tracks that are badly represented by the network
+        const std::size_t drift{ _trackIndex.getObjectCount() == 0 ? 0 : _driftingTrackCount * 100 / _trackIndex.getObjectCount() };
+        LMS_LOG(RECOMMENDATION, INFO, "Placed " << placedTrackCount << " new tracks, drift = " << drift << "%");
+
+        if (drift > Service<IConfig>::get()->getULong("recommendation-features-max-drift", 10))
+        {
+            LMS_LOG(RECOMMENDATION, INFO, "Drift is too high, retraining classifier");
+            return std::nullopt;
+        }
+
+        return placedTrackCount;
     }
 
     TrackContainer FeaturesEngine::findSimilarTracksFromTrackList(TrackListId trackListId, std::size_t maxCount) const
@@ -236,7 +267,7 @@ namespace Recommendation
 
     TrackContainer FeaturesEngine::findSimilarTracks(const std::vector<TrackId>& tracksIds, std::size_t maxCount) const
     {
-        auto similarTrackIds{ getSimilarObjects(tracksIds, _trackMatrix, _trackPositions, maxCount) };
+        auto similarTrackIds{ getSimilarObjects(tracksIds, _trackIndex, _trackIndex, maxCount) };
 
         Session& session{ _db.getTLSSession() };
 
@@ -256,7 +287,7 @@ namespace Recommendation
 
     ReleaseContainer FeaturesEngine::getSimilarReleases(ReleaseId releaseId, std::size_t maxCount) const
     {
-        auto similarReleaseIds{ getSimilarObjects({releaseId}, _releaseMatrix, _releasePositions, maxCount) };
+        auto similarReleaseIds{ getSimilarObjects({releaseId}, _releaseIndex, _releaseIndex, maxCount) };
 
         Session& session{ _db.getTLSSession() };
 
@@ -281,13 +312,13 @@ namespace Recommendation
         {
             ArtistContainer similarArtistIds;
 
-            const auto itArtists {_artistMatrix.find(linkType)};
-            if (itArtists == std::cend(_artistMatrix))
+            const auto itArtists {_artistIndexByLinkType.find(linkType)};
+            if (itArtists == std::cend(_artistIndexByLinkType))
             {
                 return similarArtistIds;
             }
 
-            return getSimilarObjects({artistId}, itArtists->second, _artistPositions, maxCount);
+            return getSimilarObjects({artistId}, _artistIndex, itArtists->second, maxCount);
         } };
 
         std::unordered_set<ArtistId> similarArtistIds;
@@ -320,7 +351,20 @@ namespace Recommendation
 
     FeaturesEngineCache FeaturesEngine::toCache() const
     {
-        return FeaturesEngineCache{ *_network, _trackPositions };
+        FeaturesEngineCache::TrackPositions trackPositions;
+        trackPositions.reserve(_trackIndex.getObjectCount());
+        _trackIndex.visit([&](TrackId trackId, std::span<const SOM::Position> positions)
+        {
+            trackPositions.emplace(trackId, std::vector<SOM::Position>(std::cbegin(positions), std::cend(positions)));
+        });
+
+        FeaturesEngineCache cache{ *_network, std::move(trackPositions) };
+        if (_dataNormalizer)
+            cache._dataNormalizer.emplace(*_dataNormalizer);
+        cache._lastTrackFeaturesId = _lastTrackFeaturesId;
+        cache._driftingTrackCount = _driftingTrackCount;
+
+        return cache;
     }
 
     void FeaturesEngine::load(bool forceReload, const ProgressCallback& progressCallback)
@@ -329,14 +373,35 @@ namespace Recommendation
         {
             FeaturesEngineCache::invalidate();
         }
-        else if (std::optional<FeaturesEngineCache> cache{ FeaturesEngineCache::read() })
+        else
         {
-            loadFromCache(std::move(*cache));
-            return;
+            if (!_network)
+            {
+                if (std::optional<FeaturesEngineCache> cache{ FeaturesEngineCache::read() })
+                    loadFromCache(std::move(*cache));
+            }
+
+            if (_network)
+            {
+                if (const std::optional<std::size_t> placedTrackCount{ placeNewTracks() })
+                {
+                    if (*placedTrackCount > 0)
+                        toCache().write();
+                    return;
+                }
+
+                if (_loadCancelled)
+                    return;
+            }
         }
 
         TrainSettings trainSettings;
         trainSettings.featureSettingsMap = getDefaultTrainFeatureSettings();
+        if (Service<IConfig>::get()->getString("recommendation-features-training-mode", "batch") == "online")
+            trainSettings.mode = TrainSettings::Mode::Online;
+        else
+            trainSettings.mode = TrainSettings::Mode::Batch;
+        trainSettings.threadCount = Service<IConfig>::get()->getULong("recommendation-features-training-thread-count", 0);
 
         loadFromTraining(trainSettings, progressCallback);
         if (!_loadCancelled && _network)
@@ -356,58 +421,101 @@ namespace Recommendation
         _networkRefVectorsDistanceMedian = network.computeRefVectorsDistanceMedian();
         LMS_LOG(RECOMMENDATION, DEBUG, "Median distance betweend ref vectors = " << _networkRefVectorsDistanceMedian);
 
+        // neighbours that are too far are not considered as similar
+        _refVectorNeighbourGraph = RefVectorNeighbourGraph{ network, _networkRefVectorsDistanceMedian * 0.75 };
+
         const SOM::Coordinate width{ network.getWidth() };
         const SOM::Coordinate height{ network.getHeight() };
 
-        _releaseMatrix = ReleaseMatrix{ width, height };
-        _trackMatrix = TrackMatrix{ width, height };
+        _artistIndex = ArtistIndex{ width, height };
+        _artistIndexByLinkType.clear();
+        _releaseIndex = ReleaseIndex{ width, height };
+        _trackIndex = TrackIndex{ width, height };
 
         LMS_LOG(RECOMMENDATION, DEBUG, "Constructing maps...");
 
-        Session & session{ _db.getTLSSession() };
+        Session& session{ _db.getTLSSession() };
 
-        for (const auto& [trackId, positions] : trackPositions)
         {
-            if (_loadCancelled)
-                return;
-
             auto transaction{ session.createReadTransaction() };
 
-            const Track::pointer track{ Track::find(session, trackId) };
-            if (!track)
-                continue;
-
-            for (const SOM::Position& position : positions)
-            {
-                Utils::push_back_if_not_present(_trackPositions[trackId], position);
-                Utils::push_back_if_not_present(_trackMatrix[position], trackId);
-
-                if (Release::pointer release{ track->getRelease() })
-                {
-                    const ReleaseId releaseId{ release->getId() };
-                    Utils::push_back_if_not_present(_releasePositions[releaseId], position);
-                    Utils::push_back_if_not_present(_releaseMatrix[position], releaseId);
-                }
-                for (const TrackArtistLink::pointer& artistLink : track->getArtistLinks())
+            // A single streamed query rather than loading each track, its release and its artist links
+            TrackId currentTrackId;
+            const std::vector<SOM::Position>* currentPositions{};
+            Track::findArtistLinkIds(session, [&](const Track::ArtistLinkIds& ids)
                 {
-                    const ArtistId artistId{ artistLink->getArtist()->getId() };
+                    if (_loadCancelled)
+                        return;
 
-                    Utils::push_back_if_not_present(_artistPositions[artistId], position);
-                    auto itArtists{ _artistMatrix.find(artistLink->getType()) };
-                    if (itArtists == std::cend(_artistMatrix))
+                    if (ids.trackId != currentTrackId)
                     {
-                        [[maybe_unused]] auto [it, inserted] = _artistMatrix.try_emplace(artistLink->getType(), ArtistMatrix{ width, height });
-                        assert(inserted);
-                        itArtists = it;
+                        currentTrackId = ids.trackId;
+
+                        const auto itPositions{ trackPositions.find(ids.trackId) };
+                        currentPositions = itPositions != std::cend(trackPositions) ? &itPositions->second : nullptr;
+                        if (currentPositions)
+                            addTrackPositions(ids.trackId, ids.releaseId, *currentPositions);
                     }
-                    Utils::push_back_if_not_present(itArtists->second[position], artistId);
-                }
-            }
+
+                    if (currentPositions && ids.artistId.isValid())
+                        addArtistPositions(ids.artistId, ids.linkType, *currentPositions);
+                });
         }
 
+        if (_loadCancelled)
+            return;
+
+        buildIndexes();
+
         _network = std::make_unique<SOM::Network>(network);
 
         LMS_LOG(RECOMMENDATION, INFO, "Classifier successfully loaded!");
     }
 
+    void FeaturesEngine::addTrack(Session& session, TrackId trackId, std::span<const SOM::Position> positions)
+    {
+        const Track::pointer track{ Track::find(session, trackId) };
+        if (!track)
+            return;
+
+        const Release::pointer release{ track->getRelease() };
+        addTrackPositions(trackId, release ? release->getId() : ReleaseId{}, positions);
+
+        for (const TrackArtistLink::pointer& artistLink : track->getArtistLinks())
+            addArtistPositions(artistLink->getArtist()->getId(), artistLink->getType(), positions);
+    }
+
+    void FeaturesEngine::addTrackPositions(TrackId trackId, ReleaseId releaseId, std::span<const SOM::Position> positions)
+    {
+        for (const SOM::Position& position : positions)
+        {
+            _trackIndex.add(trackId, position);
+
+            if (releaseId.isValid())
+                _releaseIndex.add(releaseId, position);
+        }
+    }
+
+    void FeaturesEngine::addArtistPositions(ArtistId artistId, TrackArtistLinkType linkType, std::span<const SOM::Position> positions)
+    {
+        auto itArtists{ _artistIndexByLinkType.find(linkType) };
+        if (itArtists == std::cend(_artistIndexByLinkType))
+            itArtists = _artistIndexByLinkType.emplace(linkType, ArtistIndex{ _trackIndex.getWidth(), _trackIndex.getHeight() }).first;
+
+        for (const SOM::Position& position : positions)
+        {
+            _artistIndex.add(artistId, position);
+            itArtists->second.add(artistId, position);
+        }
+    }
+
+    void FeaturesEngine::buildIndexes()
+    {
+        _trackIndex.build();
+        _releaseIndex.build();
+        _artistIndex.build();
+        for (auto& [linkType, artistIndex] : _artistIndexByLinkType)
+            artistIndex.build();
+    }
+
 } // ns Recommendation
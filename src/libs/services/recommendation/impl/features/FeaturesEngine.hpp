@@ -23,7 +23,10 @@
 #include <functional>
 #include <unordered_map>
 #include <optional>
+#include <queue>
+#include <span>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 #include "som/DataNormalizer.hpp"
@@ -32,6 +35,9 @@
 #include "IEngine.hpp"
 #include "FeaturesEngineCache.hpp"
 #include "FeaturesDefs.hpp"
+#include "FeaturesExtractor.hpp"
+#include "ObjectPositionIndex.hpp"
+#include "RefVectorNeighbourGraph.hpp"
 
 namespace Database
 {
@@ -68,135 +74,136 @@ class FeaturesEngine : public IEngine
 		// Use training (may be very slow)
 		struct TrainSettings
 		{
+			enum class Mode
+			{
+				Online,	// ref vectors updated after each sample
+				Batch,	// ref vectors updated after each pass, multithreaded
+			};
+			Mode mode {Mode::Online};
+			std::size_t threadCount {};	// batch mode only, 0 means number of logical CPUs
 			std::size_t iterationCount {10};
 			float sampleCountPerNeuron {4};
 			FeatureSettingsMap featureSettingsMap;
 		};
 		void loadFromTraining(const TrainSettings& trainSettings, const ProgressCallback& progressCallback);
 
-		template <typename IdType>
-		using ObjectPositions = std::unordered_map<IdType, std::vector<SOM::Position>>;
-
-		using ArtistPositions = ObjectPositions<Database::ArtistId>;
-		using ReleasePositions = ObjectPositions<Database::ReleaseId>;
-		using TrackPositions = ObjectPositions<Database::TrackId>;
+		using TrackPositions = std::unordered_map<Database::TrackId, std::vector<SOM::Position>>;
 
-		template <typename IdType>
-		using ObjectMatrix = SOM::Matrix<std::vector<IdType>>;
-		using ArtistMatrix = ObjectMatrix<Database::ArtistId>;
-		using ReleaseMatrix = ObjectMatrix<Database::ReleaseId>;
-		using TrackMatrix = ObjectMatrix<Database::TrackId>;
+		using ArtistIndex = ObjectPositionIndex<Database::ArtistId>;
+		using ReleaseIndex = ObjectPositionIndex<Database::ReleaseId>;
+		using TrackIndex = ObjectPositionIndex<Database::TrackId>;
 
 		void load(const SOM::Network& network, const TrackPositions& tracksPosition);
+		void addTrack(Database::Session& session, Database::TrackId trackId, std::span<const SOM::Position> positions);
+		void addTrackPositions(Database::TrackId trackId, Database::ReleaseId releaseId, std::span<const SOM::Position> positions);
+		void addArtistPositions(Database::ArtistId artistId, Database::TrackArtistLinkType linkType, std::span<const SOM::Position> positions);
+		void buildIndexes();
 
-		FeaturesEngineCache toCache() const;
-
-		template <typename IdType>
-		static std::vector<SOM::Position> getMatchingRefVectorsPosition(const std::vector<IdType>& ids, const ObjectPositions<IdType>& objectPositions);
+		// Place the tracks whose features appeared since the last load on their closest ref vector, without retraining
+		// Returns the number of placed tracks, or nothing if the network has to be retrained
+		std::optional<std::size_t> placeNewTracks();
 
-		template <typename IdType>
-		static std::vector<IdType> getObjectsIds(const std::vector<SOM::Position>& positions, const ObjectMatrix<IdType>& objectsMatrix);
+		FeaturesEngineCache toCache() const;
 
+		// objects that share the positions of the given ids in positionIndex, looked up in objectIndex
 		template <typename IdType>
 		std::vector<IdType> getSimilarObjects(const std::vector<IdType>& ids,
-				const ObjectMatrix<IdType>& objectMatrix,
-				const ObjectPositions<IdType>& objectPositions,
+				const ObjectPositionIndex<IdType>& positionIndex,
+				const ObjectPositionIndex<IdType>& objectIndex,
 				std::size_t maxCount) const;
 
 		Database::Db&		_db;
 		bool				_loadCancelled {};
 		std::unique_ptr<SOM::Network>	_network;
 		double				_networkRefVectorsDistanceMedian {};
-
-		ArtistPositions     _artistPositions;
-		std::unordered_map<Database::TrackArtistLinkType, ArtistMatrix> _artistMatrix;
-
-		ReleasePositions	_releasePositions;
-		ReleaseMatrix		_releaseMatrix;
-
-		TrackPositions		_trackPositions;
-		TrackMatrix			_trackMatrix;
+		RefVectorNeighbourGraph	_refVectorNeighbourGraph;	// used to expand the searched positions
+
+		// used to place new tracks
+		std::optional<SOM::DataNormalizer>	_dataNormalizer;
+		FeatureSettingsMap	_featureSettingsMap;
+		Database::TrackFeaturesId	_lastTrackFeaturesId;
+		std::size_t			_driftingTrackCount {};	// placed tracks that are far from their ref vector
+
+		ArtistIndex			_artistIndex;	// all link types, only used for positions
+		std::unordered_map<Database::TrackArtistLinkType, ArtistIndex> _artistIndexByLinkType;
+		ReleaseIndex		_releaseIndex;
+		TrackIndex			_trackIndex;
 };
 
-template <typename IdType>
-std::vector<SOM::Position>
-FeaturesEngine::getMatchingRefVectorsPosition(const std::vector<IdType>& ids, const ObjectPositions<IdType>& objectPositions)
-{
-	std::vector<SOM::Position> res;
-
-	if (ids.empty())
-		return res;
-
-	for (const IdType id : ids)
-	{
-		auto it = objectPositions.find(id);
-		if (it == objectPositions.end())
-			continue;
-
-		for (const SOM::Position& position : it->second)
-			Utils::push_back_if_not_present(res, position);
-	}
-
-	return res;
-}
-
 template <typename IdType>
 std::vector<IdType>
-FeaturesEngine::getObjectsIds(const std::vector<SOM::Position>& positions, const ObjectMatrix<IdType>& objectMatrix)
+FeaturesEngine::getSimilarObjects(const std::vector<IdType>& ids,
+		const ObjectPositionIndex<IdType>& positionIndex,
+		const ObjectPositionIndex<IdType>& objectIndex,
+		std::size_t maxCount) const
 {
 	std::vector<IdType> res;
 
-	for (const SOM::Position& position : positions)
+	std::vector<bool> isPositionSearched(positionIndex.getPositionCount());
+	std::vector<std::size_t> searchedPositionIndexes;
+	for (const IdType id : ids)
 	{
-		for (const IdType id : objectMatrix.get(position))
-			Utils::push_back_if_not_present(res, id);
+		for (const SOM::Position& position : positionIndex.getPositions(id))
+		{
+			if (!isPositionSearched[positionIndex.toIndex(position)])
+			{
+				isPositionSearched[positionIndex.toIndex(position)] = true;
+				searchedPositionIndexes.push_back(positionIndex.toIndex(position));
+			}
+		}
 	}
 
-	return res;
-}
-
-template <typename IdType>
-std::vector<IdType>
-FeaturesEngine::getSimilarObjects(const std::vector<IdType>& ids,
-		const ObjectMatrix<IdType>& objectMatrix,
-		const ObjectPositions<IdType>& objectPositions,
-		std::size_t maxCount) const
-{
-	std::vector<IdType> res;
-
-	std::vector<SOM::Position> searchedRefVectorsPosition {getMatchingRefVectorsPosition(ids, objectPositions)};
-	if (searchedRefVectorsPosition.empty())
+	if (searchedPositionIndexes.empty())
 		return res;
 
-	while (1)
+	// neighbours of the searched positions, closest first
+	using Neighbour = RefVectorNeighbourGraph::Neighbour;
+	const auto isFarther {[](const Neighbour& a, const Neighbour& b) { return a.distance > b.distance; }};
+	std::priority_queue<Neighbour, std::vector<Neighbour>, decltype(isFarther)> candidates {isFarther};
+	const auto addCandidates {[&](std::size_t searchedPositionIndex)
 	{
-		std::vector<IdType> closestObjectIds {getObjectsIds(searchedRefVectorsPosition, objectMatrix)};
+		for (const Neighbour& neighbour : _refVectorNeighbourGraph.getNeighbours(searchedPositionIndex))
+		{
+			if (!isPositionSearched[neighbour.positionIndex])
+				candidates.push(neighbour);
+		}
+	}};
+	for (const std::size_t searchedPositionIndex : searchedPositionIndexes)
+		addCandidates(searchedPositionIndex);
 
-		// Remove objects that are already in input or already reported
-		closestObjectIds.erase(std::remove_if(std::begin(closestObjectIds), std::end(closestObjectIds),
-					[&](IdType id)
-					{
-						return std::find(std::cbegin(ids), std::cend(ids), id) != std::cend(ids);
-					})
-				, std::end(closestObjectIds));
+	// objects that are already in input or already reported
+	std::unordered_set<IdType> excludedIds(std::cbegin(ids), std::cend(ids));
 
-		for (IdType id : closestObjectIds)
+	std::size_t processedPositionCount {};
+	while (1)
+	{
+		for (; processedPositionCount < searchedPositionIndexes.size() && res.size() < maxCount; ++processedPositionCount)
 		{
-			if (res.size() == maxCount)
-				break;
-
-			Utils::push_back_if_not_present(res, id);
+			for (const IdType id : objectIndex.getObjects(objectIndex.toPosition(searchedPositionIndexes[processedPositionCount])))
+			{
+				if (res.size() == maxCount)
+					break;
+
+				if (excludedIds.insert(id).second)
+					res.push_back(id);
+			}
 		}
 
 		if (res.size() == maxCount)
 			break;
 
 		// If there is not enough objects, try again with closest neighbour until there is too much distance
-		const std::optional<SOM::Position> closestRefVectorPosition {_network->getClosestRefVectorPosition(searchedRefVectorsPosition, _networkRefVectorsDistanceMedian * 0.75)};
-		if (!closestRefVectorPosition)
+		while (!candidates.empty() && isPositionSearched[candidates.top().positionIndex])
+			candidates.pop();
+		if (candidates.empty())
 			break;
 
-		Utils::push_back_if_not_present(searchedRefVectorsPosition, closestRefVectorPosition.value());
+		const std::size_t closestPositionIndex {candidates.top().positionIndex};
+		candidates.pop();
+
+		isPositionSearched[closestPositionIndex] = true;
+		searchedPositionIndexes.push_back(closestPositionIndex);
+		addCandidates(closestPositionIndex);
 	}
 
 	return res;
@@ -1,24 +1,16 @@
-/*
- * Copyright (C) 2018 Emeric Poupon
- *
- * This file is part of LMS.
- *
- * LMS is free software: you can redistribute it and/or modify
- * it under the terms of the GNU General Public License as published by
- * the Free Software Foundation, either version 3 of the License, or
- * (at your option) any later version.
- *
- * LMS is distributed in the hope that it will be useful,
- * but WITHOUT ANY WARRANTY; without even the implied warranty of
- * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
- * GNU General Public License for more details.
- *
- * You should have received a copy of the GNU General Public License
- * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
- */
-
 #include "FeaturesEngineCache.hpp"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/xml_parser.hpp>
 
@@ -35,6 +27,12 @@ namespace Recommendation
             return Service<IConfig>::get()->getPath("working-dir") / "cache" / "features";
         }
 
+        std::filesystem::path getCacheFilePath()
+        {
+            return getCacheDirectory() / "features.bin";
+        }
+
+        // legacy XML files
         std::filesystem::path getCacheNetworkFilePath()
         {
             return getCacheDirectory() / "network";
@@ -45,47 +43,280 @@ namespace Recommendation
             return getCacheDirectory() / "track_positions";
         }
 
-        bool networkToCacheFile(const SOM::Network& network, std::filesystem::path path)
+        // Binary cache file layout, using native endianness (the magic number does not match otherwise)
+        // - header
+        // - data weights: dimCount values
+        // - data normalizer: dimCount min/max values, only if hasDataNormalizer is set
+        // - ref vectors: width * height * dimCount values, row major
+        // - tracks: trackCount entries, sorted by track id
+        // - positions: positionCount entries, referenced by the tracks
+        // All blocks are 8 bytes aligned so that they can be used directly from the mapped file
+        constexpr std::uint32_t cacheFileMagic{ 0x4C4D5346 }; // "LMSF"
+        constexpr std::uint32_t cacheFileVersion{ 3 };
+
+        struct CacheFileHeader
         {
-            try
-            {
-                boost::property_tree::ptree root;
+            std::uint32_t magic;
+            std::uint32_t version;
+            std::uint32_t width;
+            std::uint32_t height;
+            std::uint64_t dimCount;
+            std::uint64_t trackCount;
+            std::uint64_t positionCount;
+            std::int64_t lastTrackFeaturesId;
+            std::uint64_t driftingTrackCount;
+            std::uint32_t hasDataNormalizer;
+            std::uint32_t padding;
+        };
+
+        struct CacheFileTrack
+        {
+            std::int64_t trackId;
+            std::uint64_t firstPosition;
+            std::uint64_t positionCount;
+        };
 
-                root.put("width", network.getWidth());
-                root.put("height", network.getHeight());
-                root.put("dim_count", network.getInputDimCount());
+        struct CacheFilePosition
+        {
+            std::uint32_t x;
+            std::uint32_t y;
+        };
 
-                for (SOM::InputVector::value_type weight : network.getDataWeights())
-                    root.add("weights.weight", weight);
+        using Value = SOM::InputVector::value_type;
+        using MinMax = SOM::DataNormalizer::MinMax;
 
-                for (SOM::Coordinate x = 0; x < network.getWidth(); ++x)
+        static_assert(sizeof(CacheFileHeader) % alignof(std::uint64_t) == 0);
+        static_assert(sizeof(CacheFileTrack) % alignof(std::uint64_t) == 0);
+        static_assert(sizeof(CacheFilePosition) % alignof(std::uint64_t) == 0);
+        static_assert(sizeof(Value) % alignof(std::uint64_t) == 0);
+        static_assert(sizeof(MinMax) % alignof(std::uint64_t) == 0);
+        static_assert(sizeof(Database::IdType::ValueType) == sizeof(std::int64_t));
+
+        class MappedFile
+        {
+        public:
+            MappedFile(const std::filesystem::path& path)
+            {
+                const int fd{ ::open(path.c_str(), O_RDONLY | O_CLOEXEC) };
+                if (fd < 0)
+                    return;
+
+                struct stat fileStat;
+                if (::fstat(fd, &fileStat) == 0 && fileStat.st_size > 0)
                 {
-                    for (SOM::Coordinate y = 0; y < network.getWidth(); ++y)
+                    void* data{ ::mmap(nullptr, static_cast<std::size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, fd, 0) };
+                    if (data != MAP_FAILED)
                     {
-                        const auto& refVector = network.getRefVector({ x, y });
+                        _data = data;
+                        _size = static_cast<std::size_t>(fileStat.st_size);
+                    }
+                }
+
+                ::close(fd);
+            }
 
-                        boost::property_tree::ptree node;
-                        for (const auto& value : refVector)
-                            node.add("values.value", value);
+            ~MappedFile()
+            {
+                if (_data)
+                    ::munmap(_data, _size);
+            }
 
-                        node.put("coord_x", x);
-                        node.put("coord_y", y);
+            MappedFile(const MappedFile&) = delete;
+            MappedFile& operator=(const MappedFile&) = delete;
 
-                        root.add_child("ref_vectors.ref_vector", node);
-                    }
+            bool isValid() const { return _data; }
+
+            // returns nullptr if the block does not fit in the file
+            template <typename T>
+            const T* getBlock(std::size_t& offset, std::uint64_t count) const
+            {
+                if (offset > _size || count > (_size - offset) / sizeof(T))
+                    return nullptr;
+
+                const T* res{ reinterpret_cast<const T*>(static_cast<const std::byte*>(_data) + offset) };
+                offset += count * sizeof(T);
+                return res;
+            }
+
+        private:
+            void* _data{};
+            std::size_t _size{};
+        };
+
+        template <typename T>
+        void writeBlock(std::ofstream& ofs, const T* data, std::size_t count)
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            ofs.write(reinterpret_cast<const char*>(data), count * sizeof(T));
+        }
+    }
+
+    std::optional<FeaturesEngineCache> FeaturesEngineCache::readFromBinaryFile(const std::filesystem::path& path)
+    {
+        const MappedFile file{ path };
+        if (!file.isValid())
+            return std::nullopt;
+
+        LMS_LOG(RECOMMENDATION, INFO, "Reading features cache...");
+
+        std::size_t offset{};
+        const CacheFileHeader* header{ file.getBlock<CacheFileHeader>(offset, 1) };
+        if (!header || header->magic != cacheFileMagic)
+        {
+            LMS_LOG(RECOMMENDATION, ERROR, "Cannot read features cache: bad header");
+            return std::nullopt;
+        }
+        if (header->version != cacheFileVersion)
+        {
+            LMS_LOG(RECOMMENDATION, INFO, "Features cache version " << header->version << " is not supported");
+            return std::nullopt;
+        }
+        if (header->width == 0 || header->height == 0 || header->dimCount == 0)
+        {
+            LMS_LOG(RECOMMENDATION, ERROR, "Cannot read features cache: bad network size");
+            return std::nullopt;
+        }
+
+        const Value* weights{ file.getBlock<Value>(offset, header->dimCount) };
+        const MinMax* dataNormalizer{ header->hasDataNormalizer ? file.getBlock<MinMax>(offset, header->dimCount) : nullptr };
+        const Value* refVectors{ file.getBlock<Value>(offset, static_cast<std::uint64_t>(header->width) * header->height * header->dimCount) };
+        const CacheFileTrack* tracks{ file.getBlock<CacheFileTrack>(offset, header->trackCount) };
+        const CacheFilePosition* positions{ file.getBlock<CacheFilePosition>(offset, header->positionCount) };
+        if (!weights || (header->hasDataNormalizer && !dataNormalizer) || !refVectors || !tracks || !positions)
+        {
+            LMS_LOG(RECOMMENDATION, ERROR, "Cannot read features cache: truncated file");
+            return std::nullopt;
+        }
+
+        const std::size_t dimCount{ static_cast<std::size_t>(header->dimCount) };
+        SOM::Network network{ header->width, header->height, dimCount };
+        {
+            SOM::InputVector inputVector{ dimCount };
+            std::copy(weights, weights + dimCount, std::begin(inputVector));
+            network.setDataWeights(inputVector);
+
+            for (SOM::Coordinate y{}; y < header->height; ++y)
+            {
+                for (SOM::Coordinate x{}; x < header->width; ++x)
+                {
+                    const Value* refVector{ refVectors + (x + static_cast<std::size_t>(header->width) * y) * dimCount };
+                    std::copy(refVector, refVector + dimCount, std::begin(inputVector));
+                    network.setRefVector({ x, y }, inputVector);
                 }
+            }
+        }
 
-                boost::property_tree::write_xml(path.string(), root);
+        TrackPositions trackPositions;
+        trackPositions.reserve(header->trackCount);
+        for (std::uint64_t i{}; i < header->trackCount; ++i)
+        {
+            const CacheFileTrack& track{ tracks[i] };
+            if (track.firstPosition > header->positionCount || track.positionCount > header->positionCount - track.firstPosition)
+            {
+                LMS_LOG(RECOMMENDATION, ERROR, "Cannot read features cache: bad track positions");
+                return std::nullopt;
+            }
 
-                LMS_LOG(RECOMMENDATION, DEBUG, "Created network cache");
-                return true;
+            std::vector<SOM::Position>& trackPosition{ trackPositions[Database::TrackId{ track.trackId }] };
+            trackPosition.reserve(track.positionCount);
+            for (std::uint64_t j{}; j < track.positionCount; ++j)
+            {
+                const CacheFilePosition& position{ positions[track.firstPosition + j] };
+                if (position.x >= header->width || position.y >= header->height)
+                {
+                    LMS_LOG(RECOMMENDATION, ERROR, "Cannot read features cache: bad track position");
+                    return std::nullopt;
+                }
+
+                trackPosition.push_back({ position.x, position.y });
             }
-            catch (boost::property_tree::ptree_error& error)
+        }
+
+        LMS_LOG(RECOMMENDATION, INFO, "Successfully read features cache (" << trackPositions.size() << " tracks)");
+
+        FeaturesEngineCache res{ std::move(network), std::move(trackPositions) };
+        if (dataNormalizer)
+        {
+            res._dataNormalizer.emplace(dimCount);
+            for (std::size_t i{}; i < dimCount; ++i)
+                res._dataNormalizer->setValue(i, dataNormalizer[i]);
+        }
+        if (header->lastTrackFeaturesId != Database::TrackFeaturesId{}.getValue())
+            res._lastTrackFeaturesId = Database::TrackFeaturesId{ header->lastTrackFeaturesId };
+        res._driftingTrackCount = header->driftingTrackCount;
+
+        return res;
+    }
+
+    bool FeaturesEngineCache::writeToBinaryFile(const std::filesystem::path& path) const
+    {
+        // written aside, so that a partially written file is never read
+        // the worker processes sharing the working directory may save it at the same time
+        const std::filesystem::path tmpPath{ path.string() + "." + std::to_string(::getpid()) + ".tmp" };
+
+        std::vector<TrackPositions::const_iterator> sortedTracks;
+        sortedTracks.reserve(_trackPositions.size());
+        for (auto it{ std::cbegin(_trackPositions) }; it != std::cend(_trackPositions); ++it)
+            sortedTracks.push_back(it);
+        std::sort(std::begin(sortedTracks), std::end(sortedTracks), [](const auto& a, const auto& b) { return a->first < b->first; });
+
+        std::vector<CacheFileTrack> tracks;
+        std::vector<CacheFilePosition> positions;
+        tracks.reserve(sortedTracks.size());
+        for (const auto& it : sortedTracks)
+        {
+            tracks.push_back(CacheFileTrack{ it->first.getValue(), positions.size(), it->second.size() });
+            for (const SOM::Position& position : it->second)
+                positions.push_back(CacheFilePosition{ position.x, position.y });
+        }
+
+        const bool hasDataNormalizer{ _dataNormalizer && _dataNormalizer->getInputDimCount() == _network.getInputDimCount() };
+        const CacheFileHeader header{ cacheFileMagic, cacheFileVersion, _network.getWidth(), _network.getHeight(), _network.getInputDimCount(), tracks.size(), positions.size(),
+            _lastTrackFeaturesId.getValue(), _driftingTrackCount, hasDataNormalizer, 0 };
+
+        {
+            std::ofstream ofs{ tmpPath, std::ios::binary | std::ios::trunc };
+            if (!ofs)
             {
-                LMS_LOG(RECOMMENDATION, ERROR, "Cannot create network cache: " << error.what());
+                LMS_LOG(RECOMMENDATION, ERROR, "Cannot create features cache file '" << tmpPath.string() << "'");
                 return false;
             }
+
+            writeBlock(ofs, &header, 1);
+            writeBlock(ofs, _network.getDataWeights().data(), _network.getInputDimCount());
+            if (hasDataNormalizer)
+            {
+                for (std::size_t i{}; i < _dataNormalizer->getInputDimCount(); ++i)
+                    writeBlock(ofs, &_dataNormalizer->getValue(i), 1);
+            }
+            for (SOM::Coordinate y{}; y < _network.getHeight(); ++y)
+            {
+                for (SOM::Coordinate x{}; x < _network.getWidth(); ++x)
+                    writeBlock(ofs, _network.getRefVector({ x, y }).data(), _network.getInputDimCount());
+            }
+            writeBlock(ofs, tracks.data(), tracks.size());
+            writeBlock(ofs, positions.data(), positions.size());
+
+            ofs.close();
+            if (!ofs)
+            {
+                LMS_LOG(RECOMMENDATION, ERROR, "Cannot write features cache file '" << tmpPath.string() << "'");
+                std::filesystem::remove(tmpPath);
+                return false;
+            }
+        }
+
+        std::error_code ec;
+        std::filesystem::rename(tmpPath, path, ec);
+        if (ec)
+        {
+            LMS_LOG(RECOMMENDATION, ERROR, "Cannot rename features cache file: " << ec.message());
+            std::filesystem::remove(tmpPath, ec);
+            return false;
         }
+
+        LMS_LOG(RECOMMENDATION, DEBUG, "Created features cache");
+        return true;
     }
 
     std::optional<SOM::Network> FeaturesEngineCache::createNetworkFromCacheFile(const std::filesystem::path& path)
@@ -140,40 +371,6 @@ namespace Recommendation
         }
     }
 
-    bool FeaturesEngineCache::objectPositionToCacheFile(const TrackPositions& trackPositions, const std::filesystem::path& path)
-    {
-        try
-        {
-            boost::property_tree::ptree root;
-
-            for (const auto& [id, positions] : trackPositions)
-            {
-                boost::property_tree::ptree node;
-
-                node.put("id", id.getValue());
-
-                for (const SOM::Position& position : positions)
-                {
-                    boost::property_tree::ptree positionNode;
-                    positionNode.put("x", position.x);
-                    positionNode.put("y", position.y);
-
-                    node.add_child("position.position", positionNode);
-                }
-
-                root.add_child("objects.object", node);
-            }
-
-            boost::property_tree::write_xml(path.string(), root);
-            return true;
-        }
-        catch (boost::property_tree::ptree_error& error)
-        {
-            LMS_LOG(RECOMMENDATION, ERROR, "Cannot cache object position: " << error.what());
-            return false;
-        }
-    }
-
     std::optional<FeaturesEngineCache::TrackPositions> FeaturesEngineCache::createObjectPositionsFromCacheFile(const std::filesystem::path& path)
     {
         try
@@ -209,13 +406,7 @@ namespace Recommendation
         }
     }
 
-    void FeaturesEngineCache::invalidate()
-    {
-        std::filesystem::remove(getCacheNetworkFilePath());
-        std::filesystem::remove(getCacheTrackPositionsFilePath());
-    }
-
-    std::optional<FeaturesEngineCache> FeaturesEngineCache::read()
+    std::optional<FeaturesEngineCache> FeaturesEngineCache::readFromXmlFiles()
     {
         auto network{ createNetworkFromCacheFile(getCacheNetworkFilePath()) };
         if (!network)
@@ -228,15 +419,38 @@ namespace Recommendation
         return FeaturesEngineCache{ std::move(*network), std::move(*trackPositions) };
     }
 
-    void FeaturesEngineCache::write() const
+    void FeaturesEngineCache::invalidate()
     {
-        std::filesystem::create_directories(Service<IConfig>::get()->getPath("working-dir") / "cache" / "features");
+        std::filesystem::remove(getCacheFilePath());
+        std::filesystem::remove(getCacheNetworkFilePath());
+        std::filesystem::remove(getCacheTrackPositionsFilePath());
+    }
+
+    std::optional<FeaturesEngineCache> FeaturesEngineCache::read()
+    {
+        if (std::optional<FeaturesEngineCache> cache{ readFromBinaryFile(getCacheFilePath()) })
+            return cache;
 
-        if (!networkToCacheFile(_network, getCacheNetworkFilePath())
-            || !objectPositionToCacheFile(_trackPositions, getCacheTrackPositionsFilePath()))
+        std::optional<FeaturesEngineCache> cache{ readFromXmlFiles() };
+        if (cache)
         {
-            invalidate();
+            LMS_LOG(RECOMMENDATION, INFO, "Migrating features cache to binary format");
+            if (cache->writeToBinaryFile(getCacheFilePath()))
+            {
+                std::filesystem::remove(getCacheNetworkFilePath());
+                std::filesystem::remove(getCacheTrackPositionsFilePath());
+            }
         }
+
+        return cache;
+    }
+
+    void FeaturesEngineCache::write() const
+    {
+        std::filesystem::create_directories(getCacheDirectory());
+
+        if (!writeToBinaryFile(getCacheFilePath()))
+            invalidate();
     }
 
     FeaturesEngineCache::FeaturesEngineCache(SOM::Network network, TrackPositions trackPositions)
@@ -20,9 +20,12 @@
 #pragma once
 
 #include <filesystem>
+#include <optional>
 #include <unordered_map>
 
+#include "database/TrackFeatures.hpp"
 #include "database/TrackId.hpp"
+#include "som/DataNormalizer.hpp"
 #include "som/Network.hpp"
 
 namespace Recommendation {
@@ -40,14 +43,23 @@ class FeaturesEngineCache
 
 		FeaturesEngineCache(SOM::Network network, TrackPositions trackPositions);
 
+		static std::optional<FeaturesEngineCache> readFromBinaryFile(const std::filesystem::path& path);
+		bool writeToBinaryFile(const std::filesystem::path& path) const;
+
+		// legacy XML format, only read to migrate existing caches
+		static std::optional<FeaturesEngineCache> readFromXmlFiles();
 		static std::optional<SOM::Network> createNetworkFromCacheFile(const std::filesystem::path& path);
 		static std::optional<TrackPositions> createObjectPositionsFromCacheFile(const std::filesystem::path& path);
-		static bool objectPositionToCacheFile(const TrackPositions& trackPositions, const std::filesystem::path& path);
 
 		friend class FeaturesEngine;
 
 		SOM::Network		_network;
 		TrackPositions		_trackPositions;
+
+		// needed to place new tracks without retraining, not available when migrating from the XML format
+		std::optional<SOM::DataNormalizer>	_dataNormalizer;
+		Database::TrackFeaturesId	_lastTrackFeaturesId;
+		std::size_t			_driftingTrackCount {};
 };
 
 } // namespace Recommendation
@@ -0,0 +1,321 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "FeaturesExtractor.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <charconv>
+
+namespace Recommendation
+{
+    class FeaturesExtractor::Parser
+    {
+    public:
+        Parser(const FeaturesExtractor& extractor, std::string_view data, SOM::InputVector& output, std::vector<bool>& foundFeatures)
+            : _extractor{ extractor }
+            , _data{ data }
+            , _output{ output }
+            , _foundFeatures{ foundFeatures }
+        {}
+
+        bool parseDocument()
+        {
+            skipWhitespaces();
+            if (!parseValue())
+                return false;
+
+            skipWhitespaces();
+            return _pos == _data.size();
+        }
+
+    private:
+        char peek() const { return _pos < _data.size() ? _data[_pos] : '\0'; }
+
+        bool consume(char c)
+        {
+            if (peek() != c)
+                return false;
+
+            ++_pos;
+            return true;
+        }
+
+        void skipWhitespaces()
+        {
+            while (_pos < _data.size() && (_data[_pos] == ' ' || _data[_pos] == '\n' || _data[_pos] == '\r' || _data[_pos] == '\t'))
+                ++_pos;
+        }
+
+        // value at _path
+        bool parseValue()
+        {
+            if (auto itFeature{ _extractor._featureIndexes.find(_path) }; itFeature != std::cend(_extractor._featureIndexes))
+                return parseFeatureValues(itFeature->second);
+
+            if ((_path.empty() || _extractor._featurePrefixes.contains(_path)) && peek() == '{')
+                return parseObject();
+
+            return skipValue();
+        }
+
+        bool parseObject()
+        {
+            if (!consume('{'))
+                return false;
+
+            skipWhitespaces();
+            if (consume('}'))
+                return true;
+
+            while (true)
+            {
+                skipWhitespaces();
+                std::string_view key;
+                if (!parseString(key))
+                    return false;
+
+                skipWhitespaces();
+                if (!consume(':'))
+                    return false;
+                skipWhitespaces();
+
+                const std::size_t pathSize{ _path.size() };
+                if (!_path.empty())
+                    _path += '.';
+                _path += key;
+
+                if (!parseValue())
+                    return false;
+
+                _path.resize(pathSize);
+
+                skipWhitespaces();
+                if (consume('}'))
+                    return true;
+                if (!consume(','))
+                    return false;
+            }
+        }
+
+        // escape sequences are kept as is
+        bool parseString(std::string_view& str)
+        {
+            if (!consume('"'))
+                return false;
+
+            const std::size_t begin{ _pos };
+            while (_pos < _data.size() && _data[_pos] != '"')
+            {
+                if (_data[_pos] == '\\')
+                    ++_pos;
+                ++_pos;
+            }
+
+            if (_pos >= _data.size())
+                return false;
+
+            str = _data.substr(begin, _pos - begin);
+            ++_pos;
+            return true;
+        }
+
+        bool parseNumber(SOM::InputVector::value_type& value)
+        {
+            const char* begin{ _data.data() + _pos };
+            const auto [end, error] { std::from_chars(begin, _data.data() + _data.size(), value) };
+            if (error != std::errc{})
+                return false;
+
+            _pos += end - begin;
+            return true;
+        }
+
+        bool skipValue()
+        {
+            std::string_view str;
+            switch (peek())
+            {
+            case '"':
+                return parseString(str);
+
+            case '{':
+            case '[':
+                {
+                    std::size_t depth{};
+                    while (_pos < _data.size())
+                    {
+                        const char c{ _data[_pos] };
+                        if (c == '"')
+                        {
+                            if (!parseString(str))
+                                return false;
+                            continue;
+                        }
+
+                        ++_pos;
+                        if (c == '{' || c == '[')
+                        {
+                            ++depth;
+                        }
+                        else if (c == '}' || c == ']')
+                        {
+                            if (--depth == 0)
+                                return true;
+                        }
+                    }
+                    return false;
+                }
+
+            default:
+                {
+                    // numbers, true, false, null
+                    const std::size_t begin{ _pos };
+                    while (_pos < _data.size() && _data[_pos] != ',' && _data[_pos] != '}' && _data[_pos] != ']'
+                        && _data[_pos] != ' ' && _data[_pos] != '\n' && _data[_pos] != '\r' && _data[_pos] != '\t')
+                        ++_pos;
+
+                    return _pos != begin;
+                }
+            }
+        }
+
+        // either a single number or an array of numbers
+        bool parseFeatureValues(std::size_t featureIndex)
+        {
+            const Feature& feature{ _extractor._features[featureIndex] };
+            auto itOutput{ std::next(std::begin(_output), feature.offset) };
+
+            std::size_t valueCount{};
+            SOM::InputVector::value_type value;
+            if (consume('['))
+            {
+                skipWhitespaces();
+                if (!consume(']'))
+                {
+                    while (true)
+                    {
+                        skipWhitespaces();
+                        if (!parseNumber(value))
+                            return false;
+
+                        if (++valueCount > feature.dimCount)
+                            return false;
+                        *itOutput++ = value;
+
+                        skipWhitespaces();
+                        if (consume(']'))
+                            break;
+                        if (!consume(','))
+                            return false;
+                    }
+                }
+            }
+            else
+            {
+                if (!parseNumber(value))
+                    return false;
+
+                valueCount = 1;
+                *itOutput = value;
+            }
+
+            if (valueCount != feature.dimCount)
+                return false;
+
+            _foundFeatures[featureIndex] = true;
+            return true;
+        }
+
+        const FeaturesExtractor& _extractor;
+        const std::string_view _data;
+        SOM::InputVector& _output;
+        std::vector<bool>& _foundFeatures;
+        std::size_t _pos{};
+        std::string _path;
+    };
+
+    namespace
+    {
+        // FNV-1a
+        void hashCombine(std::uint64_t& hash, std::string_view data)
+        {
+            for (const char c : data)
+            {
+                hash ^= static_cast<unsigned char>(c);
+                hash *= 0x100000001b3;
+            }
+        }
+    }
+
+    FeaturesExtractor::FeaturesExtractor(const FeatureNames& featureNames)
+        : _layoutVersion{ 0xcbf29ce484222325 }
+    {
+        std::vector<FeatureName> sortedFeatureNames(std::cbegin(featureNames), std::cend(featureNames));
+        std::sort(std::begin(sortedFeatureNames), std::end(sortedFeatureNames));
+
+        for (FeatureName& featureName : sortedFeatureNames)
+        {
+            const std::size_t dimCount{ getFeatureDef(featureName).nbDimensions };
+
+            for (std::size_t pos{ featureName.find('.') }; pos != FeatureName::npos; pos = featureName.find('.', pos + 1))
+                _featurePrefixes.emplace(featureName, 0, pos);
+
+            hashCombine(_layoutVersion, featureName);
+            hashCombine(_layoutVersion, std::to_string(dimCount) + ';');
+
+            _featureIndexes.emplace(featureName, _features.size());
+            _features.push_back(Feature{ std::move(featureName), _dimCount, dimCount });
+            _dimCount += dimCount;
+        }
+    }
+
+    std::optional<SOM::InputVector> FeaturesExtractor::extract(std::string_view jsonData) const
+    {
+        std::optional<SOM::InputVector> res{ SOM::InputVector{ _dimCount } };
+        std::vector<bool> foundFeatures(_features.size());
+
+        Parser parser{ *this, jsonData, *res, foundFeatures };
+        if (!parser.parseDocument() || std::find(std::cbegin(foundFeatures), std::cend(foundFeatures), false) != std::cend(foundFeatures))
+            res.reset();
+
+        return res;
+    }
+
+    std::optional<SOM::InputVector> FeaturesExtractor::extract(const FeaturesExtractor& packedLayout, std::span<const float> packedValues) const
+    {
+        if (packedValues.size() != packedLayout.getDimCount())
+            return std::nullopt;
+
+        SOM::InputVector res{ _dimCount };
+        for (const Feature& feature : _features)
+        {
+            auto itPackedFeature{ packedLayout._featureIndexes.find(feature.name) };
+            if (itPackedFeature == std::cend(packedLayout._featureIndexes))
+                return std::nullopt;
+
+            const Feature& packedFeature{ packedLayout._features[itPackedFeature->second] };
+            assert(packedFeature.dimCount == feature.dimCount);
+            for (std::size_t i{}; i < feature.dimCount; ++i)
+                res[feature.offset + i] = packedValues[packedFeature.offset + i];
+        }
+
+        return res;
+    }
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "som/InputVector.hpp"
+#include "FeaturesDefs.hpp"
+
+namespace Recommendation
+{
+    // Extracts the given features from json encoded AcousticBrainz low level data, directly into input vectors
+    // The document is scanned once, and only the values of the requested features are decoded
+    // Features are laid out in the input vectors sorted by name
+    // Thread safe
+    class FeaturesExtractor
+    {
+    public:
+        FeaturesExtractor(const FeatureNames& featureNames);
+
+        std::size_t getDimCount() const { return _dimCount; }
+
+        // sorted by name, defines the layout of the input vectors
+        struct Feature
+        {
+            FeatureName name;
+            std::size_t offset;
+            std::size_t dimCount;
+        };
+        const std::vector<Feature>& getFeatures() const { return _features; }
+
+        // identifies the layout, changes whenever the features or their definitions change
+        std::uint64_t getLayoutVersion() const { return _layoutVersion; }
+
+        // nothing if the data is ill-formed or some features are missing
+        std::optional<SOM::InputVector> extract(std::string_view jsonData) const;
+        // from values previously extracted using the layout of packedLayout (must contain all the features of this extractor)
+        std::optional<SOM::InputVector> extract(const FeaturesExtractor& packedLayout, std::span<const float> packedValues) const;
+
+    private:
+        class Parser;
+
+        std::vector<Feature> _features;
+        std::size_t _dimCount{};
+        std::uint64_t _layoutVersion{};
+        std::unordered_map<std::string, std::size_t> _featureIndexes; // by name
+        std::unordered_set<std::string> _featurePrefixes; // all the parent paths of the features
+    };
+}
@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "FeaturesLoader.hpp"
+
+#include <algorithm>
+#include <latch>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include <boost/asio/post.hpp>
+
+#include "database/Db.hpp"
+#include "database/Session.hpp"
+#include "utils/ILogger.hpp"
+#include "utils/IOContextRunner.hpp"
+#include "utils/IResourceGovernor.hpp"
+
+namespace Recommendation
+{
+    using namespace Database;
+
+    namespace
+    {
+        // Layout of the features stored pre-extracted in the database: all the known features
+        const FeaturesExtractor& getPackedFeaturesExtractor()
+        {
+            static const FeaturesExtractor packedFeaturesExtractor{ getFeatureNames() };
+            return packedFeaturesExtractor;
+        }
+    }
+
+    void loadFeatures(Db& db, const FeaturesExtractor& featuresExtractor, TrackFeaturesId& lastTrackFeaturesId, std::size_t threadCount,
+        const FeaturesLoadStopCallback& requestStopCallback, const std::function<void(TrackId, SOM::InputVector&&)>& func)
+    {
+        // Big json documents: keep a limited amount of them in memory
+        constexpr std::size_t batchSize{ 256 };
+
+        boost::asio::io_context ioContext;
+        IOContextRunner ioContextRunner{ ioContext, threadCount ? threadCount : std::max<std::size_t>(1, std::thread::hardware_concurrency()) };
+
+        const FeaturesExtractor& packedFeaturesExtractor{ getPackedFeaturesExtractor() };
+        const long long packedFeaturesVersion{ static_cast<long long>(packedFeaturesExtractor.getLayoutVersion()) };
+
+        Session& session{ db.getTLSSession() };
+
+        std::vector<TrackFeatures::RawFeatures> rawFeatures;
+        std::vector<std::optional<SOM::InputVector>> inputVectors;
+        std::vector<std::vector<float>> newPackedFeatures; // to be stored for next time
+        while (!requestStopCallback())
+        {
+            throttleBackgroundWork();
+
+            rawFeatures.clear();
+            {
+                auto transaction{ session.createReadTransaction() };
+                TrackFeatures::findRawFeatures(session, lastTrackFeaturesId, batchSize, packedFeaturesVersion, [&](TrackFeatures::RawFeatures&& features) { rawFeatures.push_back(std::move(features)); });
+            }
+
+            if (rawFeatures.empty())
+                break;
+
+            inputVectors.assign(rawFeatures.size(), std::nullopt);
+            newPackedFeatures.assign(rawFeatures.size(), {});
+            std::latch extractDone{ static_cast<std::ptrdiff_t>(rawFeatures.size()) };
+            for (std::size_t i{}; i < rawFeatures.size(); ++i)
+            {
+                boost::asio::post(ioContext, [&, i]
+                {
+                    const TrackFeatures::RawFeatures& features{ rawFeatures[i] };
+                    if (!features.packedFeatures.empty())
+                    {
+                        inputVectors[i] = featuresExtractor.extract(packedFeaturesExtractor, features.packedFeatures);
+                    }
+                    else if (const std::optional<SOM::InputVector> packedInputVector{ packedFeaturesExtractor.extract(features.data) })
+                    {
+                        newPackedFeatures[i].assign(std::cbegin(*packedInputVector), std::cend(*packedInputVector));
+                        inputVectors[i] = featuresExtractor.extract(packedFeaturesExtractor, newPackedFeatures[i]);
+                    }
+                    else
+                    {
+                        // some unused features may be missing
+                        inputVectors[i] = featuresExtractor.extract(features.data);
+                    }
+
+                    extractDone.count_down();
+                });
+            }
+            extractDone.wait();
+
+            {
+                auto transaction{ session.createWriteTransaction() };
+
+                for (std::size_t i{}; i < rawFeatures.size(); ++i)
+                {
+                    if (!newPackedFeatures[i].empty())
+                        TrackFeatures::updatePackedFeatures(session, rawFeatures[i].id, newPackedFeatures[i], packedFeaturesVersion);
+                }
+            }
+
+            for (std::size_t i{}; i < rawFeatures.size(); ++i)
+            {
+                if (!inputVectors[i])
+                {
+                    LMS_LOG(RECOMMENDATION, WARNING, "Cannot extract features for track " << rawFeatures[i].trackId.toString());
+                    continue;
+                }
+
+                func(rawFeatures[i].trackId, std::move(*inputVectors[i]));
+            }
+        }
+    }
+}
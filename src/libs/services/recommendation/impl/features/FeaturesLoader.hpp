@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <functional>
+
+#include "database/TrackFeatures.hpp"
+#include "database/TrackId.hpp"
+#include "som/InputVector.hpp"
+#include "FeaturesExtractor.hpp"
+
+namespace Database
+{
+    class Db;
+}
+
+namespace Recommendation
+{
+    // Reads and decodes in parallel the features stored after lastTrackFeaturesId (updated)
+    // threadCount set to 0 means number of logical CPUs
+    // func is called from the calling thread, by ascending track features id
+    // Features pre-extracted in the database are used when up to date, and stored otherwise
+    using FeaturesLoadStopCallback = std::function<bool()>;
+    void loadFeatures(Database::Db& db, const FeaturesExtractor& featuresExtractor, Database::TrackFeaturesId& lastTrackFeaturesId, std::size_t threadCount,
+        const FeaturesLoadStopCallback& requestStopCallback, const std::function<void(Database::TrackId, SOM::InputVector&&)>& func);
+}
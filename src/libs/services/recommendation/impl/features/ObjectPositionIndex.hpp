@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <numeric>
+#include <span>
+#include <vector>
+
+#include "som/Matrix.hpp"
+
+namespace Recommendation
+{
+    // Compact two ways mapping between objects and network positions, using flat arrays:
+    // - objects sorted by id, each one referencing a range of positions
+    // - positions, each one referencing a range of objects (sorted by id)
+    // Added objects only become visible once build() is called
+    template <typename IdType>
+    class ObjectPositionIndex
+    {
+    public:
+        ObjectPositionIndex() = default;
+        ObjectPositionIndex(SOM::Coordinate width, SOM::Coordinate height)
+            : _width{ width }
+            , _height{ height }
+            , _objectOffsets(static_cast<std::size_t>(width) * height + 1)
+        {}
+
+        SOM::Coordinate getWidth() const { return _width; }
+        SOM::Coordinate getHeight() const { return _height; }
+        std::size_t getPositionCount() const { return static_cast<std::size_t>(_width) * _height; }
+        std::size_t toIndex(const SOM::Position& position) const { return position.x + static_cast<std::size_t>(_width) * position.y; }
+        SOM::Position toPosition(std::size_t positionIndex) const { return SOM::Position{ static_cast<SOM::Coordinate>(positionIndex % _width), static_cast<SOM::Coordinate>(positionIndex / _width) }; }
+
+        void add(IdType id, const SOM::Position& position)
+        {
+            assert(position.x < _width && position.y < _height);
+            _pendingEntries.push_back(Entry{ id, static_cast<PositionIndex>(toIndex(position)) });
+        }
+
+        void build();
+
+        std::size_t getObjectCount() const { return _ids.size(); }
+        bool contains(IdType id) const { return findObject(id) != _ids.size(); }
+
+        std::span<const SOM::Position> getPositions(IdType id) const
+        {
+            const std::size_t objectIndex{ findObject(id) };
+            if (objectIndex == _ids.size())
+                return {};
+
+            return std::span<const SOM::Position>{ _positions.data() + _positionOffsets[objectIndex], _positionOffsets[objectIndex + 1] - _positionOffsets[objectIndex] };
+        }
+
+        std::span<const IdType> getObjects(const SOM::Position& position) const
+        {
+            const std::size_t positionIndex{ toIndex(position) };
+            return std::span<const IdType>{ _objects.data() + _objectOffsets[positionIndex], _objectOffsets[positionIndex + 1] - _objectOffsets[positionIndex] };
+        }
+
+        // visitor(IdType, std::span<const SOM::Position>), called by ascending id
+        template <typename Visitor>
+        void visit(Visitor visitor) const
+        {
+            for (std::size_t objectIndex{}; objectIndex < _ids.size(); ++objectIndex)
+                visitor(_ids[objectIndex], std::span<const SOM::Position>{ _positions.data() + _positionOffsets[objectIndex], _positionOffsets[objectIndex + 1] - _positionOffsets[objectIndex] });
+        }
+
+    private:
+        using PositionIndex = std::uint32_t;
+        using Offset = std::uint32_t;
+
+        struct Entry
+        {
+            IdType id;
+            PositionIndex positionIndex;
+        };
+
+        std::size_t findObject(IdType id) const
+        {
+            const auto it{ std::lower_bound(std::cbegin(_ids), std::cend(_ids), id) };
+            if (it == std::cend(_ids) || *it != id)
+                return _ids.size();
+
+            return std::distance(std::cbegin(_ids), it);
+        }
+
+        SOM::Coordinate _width{};
+        SOM::Coordinate _height{};
+
+        std::vector<IdType> _ids;               // sorted
+        std::vector<Offset> _positionOffsets;   // _ids.size() + 1 entries
+        std::vector<SOM::Position> _positions;
+
+        std::vector<Offset> _objectOffsets;     // getPositionCount() + 1 entries
+        std::vector<IdType> _objects;
+
+        std::vector<Entry> _pendingEntries;
+    };
+
+    template <typename IdType>
+    void ObjectPositionIndex<IdType>::build()
+    {
+        if (_pendingEntries.empty())
+            return;
+
+        std::vector<Entry> entries;
+        entries.reserve(_positions.size() + _pendingEntries.size());
+        for (std::size_t objectIndex{}; objectIndex < _ids.size(); ++objectIndex)
+        {
+            for (Offset offset{ _positionOffsets[objectIndex] }; offset < _positionOffsets[objectIndex + 1]; ++offset)
+                entries.push_back(Entry{ _ids[objectIndex], static_cast<PositionIndex>(toIndex(_positions[offset])) });
+        }
+        entries.insert(std::end(entries), std::cbegin(_pendingEntries), std::cend(_pendingEntries));
+        _pendingEntries.clear();
+        _pendingEntries.shrink_to_fit();
+
+        std::sort(std::begin(entries), std::end(entries), [](const Entry& a, const Entry& b) { return a.id < b.id || (a.id == b.id && a.positionIndex < b.positionIndex); });
+        entries.erase(std::unique(std::begin(entries), std::end(entries), [](const Entry& a, const Entry& b) { return a.id == b.id && a.positionIndex == b.positionIndex; }), std::end(entries));
+
+        _ids.clear();
+        _positionOffsets.clear();
+        _positions.clear();
+        _positions.reserve(entries.size());
+        for (const Entry& entry : entries)
+        {
+            if (_ids.empty() || _ids.back() != entry.id)
+            {
+                _ids.push_back(entry.id);
+                _positionOffsets.push_back(static_cast<Offset>(_positions.size()));
+            }
+            _positions.push_back(toPosition(entry.positionIndex));
+        }
+        _positionOffsets.push_back(static_cast<Offset>(_positions.size()));
+
+        // counting sort, keeps objects sorted by id within each position
+        std::fill(std::begin(_objectOffsets), std::end(_objectOffsets), Offset{});
+        for (const Entry& entry : entries)
+            _objectOffsets[entry.positionIndex + 1]++;
+        std::partial_sum(std::cbegin(_objectOffsets), std::cend(_objectOffsets), std::begin(_objectOffsets));
+
+        std::vector<Offset> cursors(std::cbegin(_objectOffsets), std::prev(std::cend(_objectOffsets)));
+        _objects.resize(entries.size());
+        for (const Entry& entry : entries)
+            _objects[cursors[entry.positionIndex]++] = entry.id;
+    }
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "som/Network.hpp"
+
+namespace Recommendation
+{
+    // For each ref vector, its direct neighbours in the network sorted by ascending distance
+    // Neighbours that are too far are not kept, so that walking the graph never requires any distance computation
+    class RefVectorNeighbourGraph
+    {
+    public:
+        struct Neighbour
+        {
+            std::uint32_t positionIndex;
+            SOM::InputVector::Distance distance;
+        };
+
+        RefVectorNeighbourGraph() = default;
+        RefVectorNeighbourGraph(const SOM::Network& network, SOM::InputVector::Distance maxDistance)
+        {
+            const SOM::Coordinate width{ network.getWidth() };
+            const SOM::Coordinate height{ network.getHeight() };
+
+            _neighbourOffsets.reserve(static_cast<std::size_t>(width) * height + 1);
+            _neighbours.reserve(static_cast<std::size_t>(width) * height * 4);
+            for (SOM::Coordinate y{}; y < height; ++y)
+            {
+                for (SOM::Coordinate x{}; x < width; ++x)
+                {
+                    _neighbourOffsets.push_back(static_cast<Offset>(_neighbours.size()));
+
+                    const auto addNeighbour{ [&](SOM::Coordinate neighbourX, SOM::Coordinate neighbourY)
+                    {
+                        const SOM::InputVector::Distance distance{ network.getRefVectorsDistance({ x, y }, { neighbourX, neighbourY }) };
+                        if (distance <= maxDistance)
+                            _neighbours.push_back(Neighbour{ static_cast<std::uint32_t>(neighbourX + static_cast<std::size_t>(width) * neighbourY), distance });
+                    } };
+
+                    if (y > 0)
+                        addNeighbour(x, y - 1);
+                    if (y < height - 1)
+                        addNeighbour(x, y + 1);
+                    if (x > 0)
+                        addNeighbour(x - 1, y);
+                    if (x < width - 1)
+                        addNeighbour(x + 1, y);
+
+                    std::sort(std::begin(_neighbours) + _neighbourOffsets.back(), std::end(_neighbours), [](const Neighbour& a, const Neighbour& b) { return a.distance < b.distance; });
+                }
+            }
+            _neighbourOffsets.push_back(static_cast<Offset>(_neighbours.size()));
+            _neighbours.shrink_to_fit();
+        }
+
+        std::span<const Neighbour> getNeighbours(std::size_t positionIndex) const
+        {
+            return std::span<const Neighbour>{ _neighbours.data() + _neighbourOffsets[positionIndex], _neighbourOffsets[positionIndex + 1] - _neighbourOffsets[positionIndex] };
+        }
+
+    private:
+        using Offset = std::uint32_t;
+
+        std::vector<Offset> _neighbourOffsets; // position count + 1 entries, positions indexed row-major as in ObjectPositionIndex
+        std::vector<Neighbour> _neighbours;
+    };
+}
@@ -0,0 +1,339 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "HnswIndex.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <queue>
+
+namespace Recommendation
+{
+    namespace
+    {
+        struct FurthestFirst
+        {
+            bool operator()(const HnswIndex::SearchResult& a, const HnswIndex::SearchResult& b) const { return a.distance < b.distance; }
+        };
+
+        struct ClosestFirst
+        {
+            bool operator()(const HnswIndex::SearchResult& a, const HnswIndex::SearchResult& b) const { return a.distance > b.distance; }
+        };
+
+        template <typename T>
+        void writeValues(std::ostream& os, std::span<const T> values)
+        {
+            os.write(reinterpret_cast<const char*>(values.data()), values.size_bytes());
+        }
+
+        template <typename T>
+        bool readValues(std::istream& is, std::span<T> values)
+        {
+            return static_cast<bool>(is.read(reinterpret_cast<char*>(values.data()), values.size_bytes()));
+        }
+    }
+
+    HnswIndex::HnswIndex(std::size_t dimCount, const Settings& settings)
+        : _dimCount{ dimCount }
+        , _settings{ settings }
+    {
+        assert(_settings.maxConnectionCount >= 2);
+    }
+
+    float HnswIndex::computeDistance(std::span<const float> a, std::span<const float> b) const
+    {
+        float distance{};
+        for (std::size_t i{}; i < _dimCount; ++i)
+        {
+            const float diff{ a[i] - b[i] };
+            distance += diff * diff;
+        }
+
+        return distance;
+    }
+
+    std::span<HnswIndex::NodeIndex> HnswIndex::getConnections(NodeIndex node, std::size_t level)
+    {
+        if (level == 0)
+            return { _bottomConnections.data() + node * (getMaxConnectionCount(0) + 1), getMaxConnectionCount(0) + 1 };
+
+        return { _upperConnections[node].data() + (level - 1) * (getMaxConnectionCount(level) + 1), getMaxConnectionCount(level) + 1 };
+    }
+
+    std::span<const HnswIndex::NodeIndex> HnswIndex::getConnections(NodeIndex node, std::size_t level) const
+    {
+        return const_cast<HnswIndex*>(this)->getConnections(node, level);
+    }
+
+    HnswIndex::NodeIndex HnswIndex::add(std::span<const float> vector)
+    {
+        assert(vector.size() == _dimCount);
+
+        const NodeIndex node{ static_cast<NodeIndex>(getSize()) };
+
+        std::uniform_real_distribution<double> distribution{ 0, 1 };
+        const double levelFactor{ 1 / std::log(static_cast<double>(_settings.maxConnectionCount)) };
+        const std::size_t level{ std::min<std::size_t>(static_cast<std::size_t>(-std::log(1 - distribution(_levelGenerator)) * levelFactor), 255) };
+
+        _vectors.insert(std::end(_vectors), std::cbegin(vector), std::cend(vector));
+        _levels.push_back(static_cast<std::uint8_t>(level));
+        _bottomConnections.resize(_bottomConnections.size() + getMaxConnectionCount(0) + 1);
+        _upperConnections.emplace_back(level * (getMaxConnectionCount(1) + 1));
+
+        if (node == 0)
+        {
+            _entryPoint = node;
+            _maxLevel = level;
+            return node;
+        }
+
+        NodeIndex entryPoint{ _entryPoint };
+        for (std::size_t currentLevel{ _maxLevel }; currentLevel > level; --currentLevel)
+            entryPoint = searchClosest(vector, entryPoint, currentLevel);
+
+        for (std::size_t currentLevel{ std::min(level, _maxLevel) + 1 }; currentLevel-- > 0;)
+        {
+            std::vector<SearchResult> candidates{ searchLayer(vector, entryPoint, _settings.efConstruction, currentLevel) };
+            entryPoint = candidates.front().node;
+
+            selectNeighbours(candidates, _settings.maxConnectionCount);
+            for (const SearchResult& candidate : candidates)
+            {
+                connect(node, candidate.node, currentLevel);
+                connect(candidate.node, node, currentLevel);
+            }
+        }
+
+        if (level > _maxLevel)
+        {
+            _entryPoint = node;
+            _maxLevel = level;
+        }
+
+        return node;
+    }
+
+    std::vector<HnswIndex::SearchResult> HnswIndex::search(std::span<const float> query, std::size_t count, std::size_t ef) const
+    {
+        assert(query.size() == _dimCount);
+
+        if (getSize() == 0 || count == 0)
+            return {};
+
+        NodeIndex entryPoint{ _entryPoint };
+        for (std::size_t currentLevel{ _maxLevel }; currentLevel > 0; --currentLevel)
+            entryPoint = searchClosest(query, entryPoint, currentLevel);
+
+        std::vector<SearchResult> res{ searchLayer(query, entryPoint, std::max(ef, count), 0) };
+        if (res.size() > count)
+            res.resize(count);
+
+        return res;
+    }
+
+    HnswIndex::NodeIndex HnswIndex::searchClosest(std::span<const float> query, NodeIndex entryPoint, std::size_t level) const
+    {
+        NodeIndex closest{ entryPoint };
+        float closestDistance{ computeDistance(query, closest) };
+
+        bool changed{ true };
+        while (changed)
+        {
+            changed = false;
+
+            const std::span<const NodeIndex> connections{ getConnections(closest, level) };
+            for (const NodeIndex neighbour : connections.subspan(1, connections[0]))
+            {
+                const float distance{ computeDistance(query, neighbour) };
+                if (distance < closestDistance)
+                {
+                    closest = neighbour;
+                    closestDistance = distance;
+                    changed = true;
+                }
+            }
+        }
+
+        return closest;
+    }
+
+    std::vector<HnswIndex::SearchResult> HnswIndex::searchLayer(std::span<const float> query, NodeIndex entryPoint, std::size_t ef, std::size_t level) const
+    {
+        std::vector<bool> visited(getSize());
+        std::priority_queue<SearchResult, std::vector<SearchResult>, ClosestFirst> candidates;
+        std::priority_queue<SearchResult, std::vector<SearchResult>, FurthestFirst> results;
+
+        const SearchResult entry{ entryPoint, computeDistance(query, entryPoint) };
+        visited[entryPoint] = true;
+        candidates.push(entry);
+        results.push(entry);
+
+        while (!candidates.empty())
+        {
+            const SearchResult candidate{ candidates.top() };
+            if (candidate.distance > results.top().distance && results.size() >= ef)
+                break;
+            candidates.pop();
+
+            const std::span<const NodeIndex> connections{ getConnections(candidate.node, level) };
+            for (const NodeIndex neighbour : connections.subspan(1, connections[0]))
+            {
+                if (visited[neighbour])
+                    continue;
+                visited[neighbour] = true;
+
+                const float distance{ computeDistance(query, neighbour) };
+                if (results.size() < ef || distance < results.top().distance)
+                {
+                    candidates.push(SearchResult{ neighbour, distance });
+                    results.push(SearchResult{ neighbour, distance });
+                    if (results.size() > ef)
+                        results.pop();
+                }
+            }
+        }
+
+        std::vector<SearchResult> res(results.size());
+        for (auto itResult{ std::rbegin(res) }; itResult != std::rend(res); ++itResult)
+        {
+            *itResult = results.top();
+            results.pop();
+        }
+
+        return res;
+    }
+
+    void HnswIndex::selectNeighbours(std::vector<SearchResult>& candidates, std::size_t maxCount) const
+    {
+        if (candidates.size() <= maxCount)
+            return;
+
+        // keep the candidates that are closer to the node than to any already selected neighbour, to preserve the connectivity between clusters
+        std::vector<SearchResult> selected;
+        selected.reserve(maxCount);
+        for (const SearchResult& candidate : candidates)
+        {
+            const bool keep{ std::none_of(std::cbegin(selected), std::cend(selected), [&](const SearchResult& selectedNeighbour)
+            {
+                return computeDistance(getVector(candidate.node), getVector(selectedNeighbour.node)) < candidate.distance;
+            }) };
+
+            if (keep)
+            {
+                selected.push_back(candidate);
+                if (selected.size() == maxCount)
+                    break;
+            }
+        }
+
+        candidates = std::move(selected);
+    }
+
+    void HnswIndex::connect(NodeIndex node, NodeIndex neighbour, std::size_t level)
+    {
+        const std::span<NodeIndex> connections{ getConnections(node, level) };
+        const std::size_t maxConnectionCount{ getMaxConnectionCount(level) };
+
+        if (connections[0] < maxConnectionCount)
+        {
+            connections[1 + connections[0]] = neighbour;
+            connections[0]++;
+            return;
+        }
+
+        std::vector<SearchResult> candidates;
+        candidates.reserve(maxConnectionCount + 1);
+        candidates.push_back(SearchResult{ neighbour, computeDistance(getVector(node), neighbour) });
+        for (const NodeIndex connection : connections.subspan(1))
+            candidates.push_back(SearchResult{ connection, computeDistance(getVector(node), connection) });
+
+        std::sort(std::begin(candidates), std::end(candidates), [](const SearchResult& a, const SearchResult& b) { return a.distance < b.distance; });
+        selectNeighbours(candidates, maxConnectionCount);
+
+        connections[0] = static_cast<NodeIndex>(candidates.size());
+        for (std::size_t i{}; i < candidates.size(); ++i)
+            connections[1 + i] = candidates[i].node;
+    }
+
+    void HnswIndex::write(std::ostream& os) const
+    {
+        const std::uint64_t header[]{ _dimCount, _settings.maxConnectionCount, _settings.efConstruction, getSize(), _entryPoint, _maxLevel };
+        writeValues(os, std::span<const std::uint64_t>{ header });
+        writeValues(os, std::span<const float>{ _vectors });
+        writeValues(os, std::span<const std::uint8_t>{ _levels });
+        writeValues(os, std::span<const NodeIndex>{ _bottomConnections });
+        for (const std::vector<NodeIndex>& connections : _upperConnections)
+            writeValues(os, std::span<const NodeIndex>{ connections });
+    }
+
+    std::optional<HnswIndex> HnswIndex::read(std::istream& is)
+    {
+        std::uint64_t header[6];
+        if (!readValues(is, std::span<std::uint64_t>{ header }))
+            return std::nullopt;
+
+        const auto [dimCount, maxConnectionCount, efConstruction, size, entryPoint, maxLevel] { header };
+        if (dimCount == 0 || maxConnectionCount < 2 || maxConnectionCount > 1024 || size > std::numeric_limits<NodeIndex>::max() || (size > 0 && entryPoint >= size) || maxLevel > 255)
+            return std::nullopt;
+
+        std::optional<HnswIndex> res{ HnswIndex{ dimCount, Settings{ maxConnectionCount, efConstruction } } };
+        res->_entryPoint = static_cast<NodeIndex>(entryPoint);
+        res->_maxLevel = maxLevel;
+
+        res->_vectors.resize(size * dimCount);
+        res->_levels.resize(size);
+        res->_bottomConnections.resize(size * (res->getMaxConnectionCount(0) + 1));
+        if (!readValues(is, std::span<float>{ res->_vectors })
+            || !readValues(is, std::span<std::uint8_t>{ res->_levels })
+            || !readValues(is, std::span<NodeIndex>{ res->_bottomConnections }))
+            return std::nullopt;
+
+        res->_upperConnections.resize(size);
+        for (std::size_t node{}; node < size; ++node)
+        {
+            res->_upperConnections[node].resize(res->_levels[node] * (res->getMaxConnectionCount(1) + 1));
+            if (!readValues(is, std::span<NodeIndex>{ res->_upperConnections[node] }))
+                return std::nullopt;
+        }
+
+        // make sure the graph can be walked safely
+        for (std::size_t node{}; node < size; ++node)
+        {
+            for (std::size_t level{}; level <= res->_levels[node]; ++level)
+            {
+                const std::span<const NodeIndex> connections{ res->getConnections(static_cast<NodeIndex>(node), level) };
+                if (connections[0] > res->getMaxConnectionCount(level))
+                    return std::nullopt;
+
+                for (const NodeIndex neighbour : connections.subspan(1, connections[0]))
+                {
+                    if (neighbour >= size || res->_levels[neighbour] < level)
+                        return std::nullopt;
+                }
+            }
+        }
+        if (size > 0 && res->_levels[entryPoint] != maxLevel)
+            return std::nullopt;
+
+        return res;
+    }
+}
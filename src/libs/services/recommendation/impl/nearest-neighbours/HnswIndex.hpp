@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <optional>
+#include <ostream>
+#include <random>
+#include <span>
+#include <vector>
+
+namespace Recommendation
+{
+    // Approximate nearest neighbours index, using a Hierarchical Navigable Small World graph
+    // Vectors are compared using the squared euclidean distance
+    // Adding vectors is not thread safe, searching is
+    class HnswIndex
+    {
+    public:
+        using NodeIndex = std::uint32_t;
+
+        struct Settings
+        {
+            std::size_t maxConnectionCount{ 16 }; // per node and per layer, twice as much on the bottom layer
+            std::size_t efConstruction{ 200 }; // candidate list size when adding vectors
+        };
+
+        HnswIndex(std::size_t dimCount, const Settings& settings);
+
+        std::size_t getDimCount() const { return _dimCount; }
+        std::size_t getSize() const { return _levels.size(); }
+        std::span<const float> getVector(NodeIndex node) const { return { _vectors.data() + node * _dimCount, _dimCount }; }
+
+        // returns the index of the new node (nodes are indexed in insertion order)
+        NodeIndex add(std::span<const float> vector);
+
+        struct SearchResult
+        {
+            NodeIndex node;
+            float distance;
+        };
+        // count nearest nodes, by ascending distance. ef is the candidate list size (the larger, the more accurate)
+        std::vector<SearchResult> search(std::span<const float> query, std::size_t count, std::size_t ef) const;
+
+        void write(std::ostream& os) const;
+        // nothing if the data is ill-formed
+        static std::optional<HnswIndex> read(std::istream& is);
+
+    private:
+        float computeDistance(std::span<const float> a, std::span<const float> b) const;
+        float computeDistance(std::span<const float> query, NodeIndex node) const { return computeDistance(query, getVector(node)); }
+
+        std::size_t getMaxConnectionCount(std::size_t level) const { return level == 0 ? 2 * _settings.maxConnectionCount : _settings.maxConnectionCount; }
+        // first element is the connection count
+        std::span<NodeIndex> getConnections(NodeIndex node, std::size_t level);
+        std::span<const NodeIndex> getConnections(NodeIndex node, std::size_t level) const;
+
+        NodeIndex searchClosest(std::span<const float> query, NodeIndex entryPoint, std::size_t level) const;
+        std::vector<SearchResult> searchLayer(std::span<const float> query, NodeIndex entryPoint, std::size_t ef, std::size_t level) const;
+        // candidates sorted by ascending distance
+        void selectNeighbours(std::vector<SearchResult>& candidates, std::size_t maxCount) const;
+        void connect(NodeIndex node, NodeIndex neighbour, std::size_t level);
+
+        std::size_t _dimCount;
+        Settings _settings;
+        std::mt19937 _levelGenerator;
+
+        std::vector<float> _vectors; // _dimCount values per node
+        std::vector<std::uint8_t> _levels; // top layer of each node
+        std::vector<NodeIndex> _bottomConnections; // fixed size slots per node
+        std::vector<std::vector<NodeIndex>> _upperConnections; // per node, fixed size slots for each of its upper layers
+        NodeIndex _entryPoint{};
+        std::size_t _maxLevel{};
+    };
+}
@@ -0,0 +1,608 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "NearestNeighboursEngine.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <unordered_set>
+
+#include "database/Artist.hpp"
+#include "database/Db.hpp"
+#include "database/Release.hpp"
+#include "database/Session.hpp"
+#include "database/Track.hpp"
+#include "database/TrackArtistLink.hpp"
+#include "database/TrackList.hpp"
+#include "utils/IConfig.hpp"
+#include "utils/ILogger.hpp"
+#include "utils/Service.hpp"
+#include "features/FeaturesEngine.hpp"
+#include "features/FeaturesExtractor.hpp"
+#include "features/FeaturesLoader.hpp"
+
+namespace Recommendation
+{
+    using namespace Database;
+
+    std::unique_ptr<IEngine> createNearestNeighboursEngine(Db& db)
+    {
+        return std::make_unique<NearestNeighboursEngine>(db);
+    }
+
+    namespace
+    {
+        std::filesystem::path getCacheFilePath()
+        {
+            return Service<IConfig>::get()->getPath("working-dir") / "cache" / "nearest-neighbours.bin";
+        }
+
+        // Cache file layout, using native endianness (the magic number does not match otherwise)
+        // - header
+        // - offsets and factors: dimCount values each
+        // - track ids: nodeCount values
+        // - index
+        constexpr std::uint32_t cacheFileMagic{ 0x4C4D534E }; // "LMSN"
+        constexpr std::uint32_t cacheFileVersion{ 1 };
+
+        struct CacheFileHeader
+        {
+            std::uint32_t magic;
+            std::uint32_t version;
+            std::uint64_t featuresLayoutVersion;
+            std::uint64_t dimCount;
+            std::uint64_t nodeCount;
+            std::int64_t lastTrackFeaturesId;
+        };
+
+        FeatureNames getFeatureNames(const FeatureSettingsMap& featureSettingsMap)
+        {
+            FeatureNames featureNames;
+            for (const auto& [featureName, featureSettings] : featureSettingsMap)
+                featureNames.insert(featureName);
+
+            return featureNames;
+        }
+
+        const FeaturesExtractor& getFeaturesExtractor()
+        {
+            static const FeaturesExtractor featuresExtractor{ getFeatureNames(FeaturesEngine::getDefaultTrainFeatureSettings()) };
+            return featuresExtractor;
+        }
+
+        std::size_t getEfSearch()
+        {
+            return Service<IConfig>::get()->getULong("recommendation-nearest-neighbours-ef-search", 64);
+        }
+
+        template <typename ObjectType, typename IdType>
+        void removeNonExistingObjects(Session& session, std::vector<IdType>& ids)
+        {
+            auto transaction{ session.createReadTransaction() };
+
+            ids.erase(std::remove_if(std::begin(ids), std::end(ids),
+                [&](IdType id)
+                {
+                    return !ObjectType::exists(session, id);
+                }), std::end(ids));
+        }
+    }
+
+    std::vector<float> NearestNeighboursEngine::Cache::toIndexVector(const SOM::InputVector& inputVector) const
+    {
+        std::vector<float> res(offsets.size());
+        for (std::size_t i{}; i < res.size(); ++i)
+            res[i] = (static_cast<float>(inputVector[i]) - offsets[i]) * factors[i];
+
+        return res;
+    }
+
+    std::optional<NearestNeighboursEngine::Cache> NearestNeighboursEngine::Cache::read()
+    {
+        const std::filesystem::path path{ getCacheFilePath() };
+
+        std::ifstream ifs{ path, std::ios::binary };
+        if (!ifs)
+            return std::nullopt;
+
+        LMS_LOG(RECOMMENDATION, INFO, "Reading nearest neighbours cache...");
+
+        CacheFileHeader header;
+        if (!ifs.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != cacheFileMagic)
+        {
+            LMS_LOG(RECOMMENDATION, ERROR, "Cannot read nearest neighbours cache: bad header");
+            return std::nullopt;
+        }
+        if (header.version != cacheFileVersion)
+        {
+            LMS_LOG(RECOMMENDATION, INFO, "Nearest neighbours cache version " << header.version << " is not supported");
+            return std::nullopt;
+        }
+        if (header.dimCount == 0 || header.dimCount > std::numeric_limits<std::uint32_t>::max() || header.nodeCount > std::numeric_limits<HnswIndex::NodeIndex>::max())
+        {
+            LMS_LOG(RECOMMENDATION, ERROR, "Cannot read nearest neighbours cache: bad sizes");
+            return std::nullopt;
+        }
+
+        std::vector<float> offsets(header.dimCount);
+        std::vector<float> factors(header.dimCount);
+        std::vector<std::int64_t> trackIdValues(header.nodeCount);
+        if (!ifs.read(reinterpret_cast<char*>(offsets.data()), offsets.size() * sizeof(float))
+            || !ifs.read(reinterpret_cast<char*>(factors.data()), factors.size() * sizeof(float))
+            || !ifs.read(reinterpret_cast<char*>(trackIdValues.data()), trackIdValues.size() * sizeof(std::int64_t)))
+        {
+            LMS_LOG(RECOMMENDATION, ERROR, "Cannot read nearest neighbours cache: truncated file");
+            return std::nullopt;
+        }
+
+        std::optional<HnswIndex> index{ HnswIndex::read(ifs) };
+        if (!index || index->getDimCount() != header.dimCount || index->getSize() != header.nodeCount)
+        {
+            LMS_LOG(RECOMMENDATION, ERROR, "Cannot read nearest neighbours cache: bad index");
+            return std::nullopt;
+        }
+
+        std::vector<TrackId> trackIds;
+        trackIds.reserve(trackIdValues.size());
+        for (const std::int64_t trackIdValue : trackIdValues)
+            trackIds.push_back(TrackId{ trackIdValue });
+
+        TrackFeaturesId lastTrackFeaturesId;
+        if (header.lastTrackFeaturesId != TrackFeaturesId{}.getValue())
+            lastTrackFeaturesId = TrackFeaturesId{ header.lastTrackFeaturesId };
+
+        LMS_LOG(RECOMMENDATION, INFO, "Successfully read nearest neighbours cache (" << trackIds.size() << " tracks)");
+
+        return Cache{ header.featuresLayoutVersion, std::move(offsets), std::move(factors), lastTrackFeaturesId, std::move(trackIds), std::move(*index) };
+    }
+
+    bool NearestNeighboursEngine::Cache::write() const
+    {
+        const std::filesystem::path path{ getCacheFilePath() };
+        // written aside, so that a partially written file is never read
+        // the worker processes sharing the working directory may save it at the same time
+        const std::filesystem::path tmpPath{ path.string() + "." + std::to_string(::getpid()) + ".tmp" };
+
+        std::error_code ec;
+        std::filesystem::create_directories(path.parent_path(), ec);
+
+        std::vector<std::int64_t> trackIdValues;
+        trackIdValues.reserve(trackIds.size());
+        for (const TrackId trackId : trackIds)
+            trackIdValues.push_back(trackId.getValue());
+
+        const CacheFileHeader header{ cacheFileMagic, cacheFileVersion, featuresLayoutVersion, offsets.size(), trackIds.size(), lastTrackFeaturesId.getValue() };
+
+        {
+            std::ofstream ofs{ tmpPath, std::ios::binary | std::ios::trunc };
+            if (!ofs)
+            {
+                LMS_LOG(RECOMMENDATION, ERROR, "Cannot create nearest neighbours cache file '" << tmpPath.string() << "'");
+                return false;
+            }
+
+            ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            ofs.write(reinterpret_cast<const char*>(offsets.data()), offsets.size() * sizeof(float));
+            ofs.write(reinterpret_cast<const char*>(factors.data()), factors.size() * sizeof(float));
+            ofs.write(reinterpret_cast<const char*>(trackIdValues.data()), trackIdValues.size() * sizeof(std::int64_t));
+            index.write(ofs);
+
+            ofs.close();
+            if (!ofs)
+            {
+                LMS_LOG(RECOMMENDATION, ERROR, "Cannot write nearest neighbours cache file '" << tmpPath.string() << "'");
+                std::filesystem::remove(tmpPath, ec);
+                return false;
+            }
+        }
+
+        std::filesystem::rename(tmpPath, path, ec);
+        if (ec)
+        {
+            LMS_LOG(RECOMMENDATION, ERROR, "Cannot rename nearest neighbours cache file: " << ec.message());
+            std::filesystem::remove(tmpPath, ec);
+            return false;
+        }
+
+        LMS_LOG(RECOMMENDATION, DEBUG, "Created nearest neighbours cache");
+        return true;
+    }
+
+    void NearestNeighboursEngine::Cache::invalidate()
+    {
+        std::error_code ec;
+        std::filesystem::remove(getCacheFilePath(), ec);
+    }
+
+    void NearestNeighboursEngine::load(bool forceReload, const ProgressCallback& progressCallback)
+    {
+        if (forceReload)
+        {
+            Cache::invalidate();
+            _cache.reset();
+        }
+        else
+        {
+            if (!_cache)
+            {
+                _cache = Cache::read();
+                if (_cache && _cache->featuresLayoutVersion != getFeaturesExtractor().getLayoutVersion())
+                {
+                    LMS_LOG(RECOMMENDATION, INFO, "Features have changed, rebuilding nearest neighbours index");
+                    _cache.reset();
+                }
+
+                if (_cache)
+                    buildLookups();
+            }
+
+            if (_loadCancelled)
+                return;
+
+            if (_cache)
+            {
+                // removed tracks are just ignored, rebuild once they take too much room
+                const std::size_t removedTrackCount{ _cache->trackIds.size() - _nodesByTrack.size() };
+                if (removedTrackCount * 5 <= _cache->trackIds.size())
+                {
+                    if (addNewTracks() > 0 && !_loadCancelled)
+                        _cache->write();
+                    return;
+                }
+
+                LMS_LOG(RECOMMENDATION, INFO, "Too many removed tracks (" << removedTrackCount << "), rebuilding nearest neighbours index");
+            }
+        }
+
+        loadFromFeatures(progressCallback);
+        if (!_loadCancelled && _cache)
+            _cache->write();
+    }
+
+    void NearestNeighboursEngine::requestCancelLoad()
+    {
+        LMS_LOG(RECOMMENDATION, DEBUG, "Requesting init cancellation");
+        _loadCancelled = true;
+    }
+
+    void NearestNeighboursEngine::loadFromFeatures(const ProgressCallback& progressCallback)
+    {
+        LMS_LOG(RECOMMENDATION, INFO, "Building nearest neighbours index...");
+
+        const FeaturesExtractor& featuresExtractor{ getFeaturesExtractor() };
+        const std::size_t dimCount{ featuresExtractor.getDimCount() };
+
+        std::vector<SOM::InputVector> samples;
+        std::vector<TrackId> samplesTrackIds;
+        std::unordered_set<TrackId> sampledTrackIds;
+        TrackFeaturesId lastTrackFeaturesId;
+
+        loadFeatures(_db, featuresExtractor, lastTrackFeaturesId, Service<IConfig>::get()->getULong("recommendation-features-training-thread-count", 0), [this] { return _loadCancelled; }, [&](TrackId trackId, SOM::InputVector&& inputVector)
+        {
+            if (!sampledTrackIds.insert(trackId).second)
+                return;
+
+            samples.emplace_back(std::move(inputVector));
+            samplesTrackIds.emplace_back(trackId);
+        });
+        if (_loadCancelled)
+            return;
+
+        _cache.reset();
+        buildLookups();
+
+        if (samples.empty())
+        {
+            LMS_LOG(RECOMMENDATION, INFO, "Nothing to index!");
+            return;
+        }
+
+        // min/max normalization, then weighting so that each feature weighs as configured, whatever its dimension count
+        std::vector<float> offsets(dimCount, std::numeric_limits<float>::max());
+        std::vector<float> factors(dimCount, std::numeric_limits<float>::lowest());
+        for (const SOM::InputVector& sample : samples)
+        {
+            for (std::size_t i{}; i < dimCount; ++i)
+            {
+                offsets[i] = std::min(offsets[i], static_cast<float>(sample[i]));
+                factors[i] = std::max(factors[i], static_cast<float>(sample[i]));
+            }
+        }
+        for (const FeaturesExtractor::Feature& feature : featuresExtractor.getFeatures())
+        {
+            const float weight{ static_cast<float>(FeaturesEngine::getDefaultTrainFeatureSettings().at(feature.name).weight / feature.dimCount) };
+            for (std::size_t i{ feature.offset }; i < feature.offset + feature.dimCount; ++i)
+            {
+                const float range{ factors[i] - offsets[i] };
+                factors[i] = range > 0 ? std::sqrt(weight) / range : 0;
+            }
+        }
+
+        HnswIndex::Settings indexSettings;
+        indexSettings.maxConnectionCount = std::max<std::size_t>(2, Service<IConfig>::get()->getULong("recommendation-nearest-neighbours-max-connections", 16));
+        indexSettings.efConstruction = std::max<std::size_t>(1, Service<IConfig>::get()->getULong("recommendation-nearest-neighbours-ef-construction", 200));
+
+        Cache cache{ featuresExtractor.getLayoutVersion(), std::move(offsets), std::move(factors), lastTrackFeaturesId, {}, HnswIndex{ dimCount, indexSettings } };
+        cache.trackIds.reserve(samples.size());
+        for (std::size_t i{}; i < samples.size(); ++i)
+        {
+            if (_loadCancelled)
+                return;
+
+            cache.index.add(cache.toIndexVector(samples[i]));
+            cache.trackIds.push_back(samplesTrackIds[i]);
+
+            if (progressCallback && (i + 1) % 1000 == 0)
+                progressCallback(Progress{ samples.size(), i + 1 });
+        }
+
+        _cache = std::move(cache);
+        buildLookups();
+
+        LMS_LOG(RECOMMENDATION, INFO, "Nearest neighbours index successfully built (" << _cache->trackIds.size() << " tracks)");
+    }
+
+    std::size_t NearestNeighboursEngine::addNewTracks()
+    {
+        Session& session{ _db.getTLSSession() };
+
+        std::size_t addedTrackCount{};
+        loadFeatures(_db, getFeaturesExtractor(), _cache->lastTrackFeaturesId, Service<IConfig>::get()->getULong("recommendation-features-training-thread-count", 0), [this] { return _loadCancelled; }, [&](TrackId trackId, SOM::InputVector&& inputVector)
+        {
+            if (_nodesByTrack.contains(trackId))
+                return;
+
+            const HnswIndex::NodeIndex node{ _cache->index.add(_cache->toIndexVector(inputVector)) };
+            _cache->trackIds.push_back(trackId);
+
+            auto transaction{ session.createReadTransaction() };
+            addTrackLookups(session, node);
+            addedTrackCount++;
+        });
+
+        if (addedTrackCount > 0)
+            LMS_LOG(RECOMMENDATION, INFO, "Added " << addedTrackCount << " new tracks to the nearest neighbours index");
+
+        return addedTrackCount;
+    }
+
+    void NearestNeighboursEngine::buildLookups()
+    {
+        _nodesByTrack.clear();
+        _nodesByRelease.clear();
+        _nodesByArtist.clear();
+        _nodeReleases.clear();
+        _nodeArtistLinks.clear();
+
+        if (!_cache)
+            return;
+
+        LMS_LOG(RECOMMENDATION, DEBUG, "Constructing maps...");
+
+        Session& session{ _db.getTLSSession() };
+        for (HnswIndex::NodeIndex node{}; node < _cache->trackIds.size(); ++node)
+        {
+            if (_loadCancelled)
+                return;
+
+            auto transaction{ session.createReadTransaction() };
+            addTrackLookups(session, node);
+        }
+    }
+
+    void NearestNeighboursEngine::addTrackLookups(Session& session, HnswIndex::NodeIndex node)
+    {
+        if (_nodeReleases.size() <= node)
+        {
+            _nodeReleases.resize(node + 1);
+            _nodeArtistLinks.resize(node + 1);
+        }
+
+        const TrackId trackId{ _cache->trackIds[node] };
+        const Track::pointer track{ Track::find(session, trackId) };
+        if (!track)
+            return;
+
+        _nodesByTrack[trackId] = node;
+
+        if (const Release::pointer release{ track->getRelease() })
+        {
+            _nodeReleases[node] = release->getId();
+            _nodesByRelease[release->getId()].push_back(node);
+        }
+
+        for (const TrackArtistLink::pointer& artistLink : track->getArtistLinks())
+        {
+            const ArtistId artistId{ artistLink->getArtist()->getId() };
+            _nodeArtistLinks[node].emplace_back(artistId, artistLink->getType());
+
+            std::vector<HnswIndex::NodeIndex>& artistNodes{ _nodesByArtist[artistId] };
+            if (artistNodes.empty() || artistNodes.back() != node)
+                artistNodes.push_back(node);
+        }
+    }
+
+    std::vector<float> NearestNeighboursEngine::computeMeanVector(std::span<const HnswIndex::NodeIndex> nodes) const
+    {
+        std::vector<float> res(_cache->index.getDimCount());
+        for (const HnswIndex::NodeIndex node : nodes)
+        {
+            const std::span<const float> vector{ _cache->index.getVector(node) };
+            for (std::size_t i{}; i < res.size(); ++i)
+                res[i] += vector[i];
+        }
+
+        for (float& value : res)
+            value /= nodes.size();
+
+        return res;
+    }
+
+    template <typename IdType, typename NodeObjectsVisitor>
+    std::vector<IdType> NearestNeighboursEngine::findClosestObjects(std::span<const float> query, std::size_t maxCount, NodeObjectsVisitor visitNodeObjects) const
+    {
+        std::vector<IdType> res;
+        std::unordered_set<IdType> foundIds;
+
+        const std::size_t nodeCount{ _cache->index.getSize() };
+        if (maxCount == 0 || nodeCount == 0)
+            return res;
+
+        // objects usually span several nodes: widen the search until enough of them are found
+        for (std::size_t searchCount{ std::min(nodeCount, maxCount * 8) };; searchCount = std::min(nodeCount, searchCount * 4))
+        {
+            res.clear();
+            foundIds.clear();
+
+            for (const HnswIndex::SearchResult& result : _cache->index.search(query, searchCount, std::max(getEfSearch(), searchCount)))
+            {
+                // removed tracks
+                if (!_nodesByTrack.contains(_cache->trackIds[result.node]))
+                    continue;
+
+                visitNodeObjects(result.node, [&](IdType id)
+                {
+                    if (res.size() < maxCount && foundIds.insert(id).second)
+                        res.push_back(id);
+                });
+
+                if (res.size() == maxCount)
+                    return res;
+            }
+
+            if (searchCount == nodeCount)
+                return res;
+        }
+    }
+
+    TrackContainer NearestNeighboursEngine::findSimilarTracksFromTrackList(TrackListId trackListId, std::size_t maxCount) const
+    {
+        const TrackContainer trackIds{ [&]
+        {
+            TrackContainer res;
+
+            Session& session{ _db.getTLSSession() };
+
+            auto transaction{ session.createReadTransaction() };
+
+            const TrackList::pointer trackList{ TrackList::find(session, trackListId) };
+            if (trackList)
+                res = trackList->getTrackIds();
+
+            return res;
+        }() };
+
+        return findSimilarTracks(trackIds, maxCount);
+    }
+
+    TrackContainer NearestNeighboursEngine::findSimilarTracks(const std::vector<TrackId>& trackIds, std::size_t maxCount) const
+    {
+        TrackContainer res;
+        if (!_cache || maxCount == 0)
+            return res;
+
+        // tracks close to any of the input tracks
+        const std::unordered_set<TrackId> inputTrackIds(std::cbegin(trackIds), std::cend(trackIds));
+        std::unordered_map<TrackId, float> distances;
+        for (const TrackId trackId : inputTrackIds)
+        {
+            const auto itNode{ _nodesByTrack.find(trackId) };
+            if (itNode == std::cend(_nodesByTrack))
+                continue;
+
+            for (const HnswIndex::SearchResult& result : _cache->index.search(_cache->index.getVector(itNode->second), maxCount + inputTrackIds.size(), getEfSearch()))
+            {
+                const TrackId similarTrackId{ _cache->trackIds[result.node] };
+                if (inputTrackIds.contains(similarTrackId) || !_nodesByTrack.contains(similarTrackId))
+                    continue;
+
+                auto [itDistance, inserted]{ distances.try_emplace(similarTrackId, result.distance) };
+                if (!inserted)
+                    itDistance->second = std::min(itDistance->second, result.distance);
+            }
+        }
+
+        std::vector<std::pair<TrackId, float>> sortedDistances(std::cbegin(distances), std::cend(distances));
+        std::sort(std::begin(sortedDistances), std::end(sortedDistances), [](const auto& a, const auto& b) { return a.second < b.second; });
+        if (sortedDistances.size() > maxCount)
+            sortedDistances.resize(maxCount);
+
+        res.reserve(sortedDistances.size());
+        for (const auto& [trackId, distance] : sortedDistances)
+            res.push_back(trackId);
+
+        // Report only existing ids, as tracks may have been removed since the last load
+        removeNonExistingObjects<Track>(_db.getTLSSession(), res);
+
+        return res;
+    }
+
+    ReleaseContainer NearestNeighboursEngine::getSimilarReleases(ReleaseId releaseId, std::size_t maxCount) const
+    {
+        ReleaseContainer res;
+        if (!_cache)
+            return res;
+
+        const auto itNodes{ _nodesByRelease.find(releaseId) };
+        if (itNodes == std::cend(_nodesByRelease))
+            return res;
+
+        res = findClosestObjects<ReleaseId>(computeMeanVector(itNodes->second), maxCount, [&](HnswIndex::NodeIndex node, const auto& addRelease)
+        {
+            const ReleaseId similarReleaseId{ _nodeReleases[node] };
+            if (similarReleaseId.isValid() && similarReleaseId != releaseId)
+                addRelease(similarReleaseId);
+        });
+
+        // Report only existing ids
+        removeNonExistingObjects<Release>(_db.getTLSSession(), res);
+
+        return res;
+    }
+
+    ArtistContainer NearestNeighboursEngine::getSimilarArtists(ArtistId artistId, EnumSet<TrackArtistLinkType> linkTypes, std::size_t maxCount) const
+    {
+        ArtistContainer res;
+        if (!_cache)
+            return res;
+
+        const auto itNodes{ _nodesByArtist.find(artistId) };
+        if (itNodes == std::cend(_nodesByArtist))
+            return res;
+
+        res = findClosestObjects<ArtistId>(computeMeanVector(itNodes->second), maxCount, [&](HnswIndex::NodeIndex node, const auto& addArtist)
+        {
+            for (const auto& [similarArtistId, linkType] : _nodeArtistLinks[node])
+            {
+                if (similarArtistId != artistId && linkTypes.contains(linkType))
+                    addArtist(similarArtistId);
+            }
+        });
+
+        // Report only existing ids
+        removeNonExistingObjects<Artist>(_db.getTLSSession(), res);
+
+        return res;
+    }
+} // ns Recommendation
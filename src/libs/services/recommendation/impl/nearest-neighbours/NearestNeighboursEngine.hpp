@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "database/ArtistId.hpp"
+#include "database/ReleaseId.hpp"
+#include "database/TrackFeatures.hpp"
+#include "database/TrackId.hpp"
+#include "database/Types.hpp"
+#include "som/InputVector.hpp"
+#include "IEngine.hpp"
+#include "HnswIndex.hpp"
+
+namespace Database
+{
+    class Session;
+}
+
+namespace Recommendation
+{
+    // Uses an approximate nearest neighbours index over the normalized feature vectors of the tracks
+    // Releases and artists are represented by the mean vector of their tracks
+    class NearestNeighboursEngine : public IEngine
+    {
+    public:
+        NearestNeighboursEngine(Database::Db& db) : _db{ db } {}
+
+        NearestNeighboursEngine(const NearestNeighboursEngine&) = delete;
+        NearestNeighboursEngine(NearestNeighboursEngine&&) = delete;
+        NearestNeighboursEngine& operator=(const NearestNeighboursEngine&) = delete;
+        NearestNeighboursEngine& operator=(NearestNeighboursEngine&&) = delete;
+
+    private:
+        void load(bool forceReload, const ProgressCallback& progressCallback) override;
+        void requestCancelLoad() override;
+
+        TrackContainer findSimilarTracksFromTrackList(Database::TrackListId tracklistId, std::size_t maxCount) const override;
+        TrackContainer findSimilarTracks(const std::vector<Database::TrackId>& tracksId, std::size_t maxCount) const override;
+        ReleaseContainer getSimilarReleases(Database::ReleaseId releaseId, std::size_t maxCount) const override;
+        ArtistContainer getSimilarArtists(Database::ArtistId artistId, EnumSet<Database::TrackArtistLinkType> linkTypes, std::size_t maxCount) const override;
+
+        // Index and everything needed to add new tracks to it
+        struct Cache
+        {
+            std::uint64_t featuresLayoutVersion{};
+            std::vector<float> offsets; // per dimension
+            std::vector<float> factors; // per dimension, includes the feature weights
+            Database::TrackFeaturesId lastTrackFeaturesId;
+            std::vector<Database::TrackId> trackIds; // per node
+            HnswIndex index;
+
+            std::vector<float> toIndexVector(const SOM::InputVector& inputVector) const;
+
+            static std::optional<Cache> read();
+            bool write() const;
+            static void invalidate();
+        };
+
+        void loadFromFeatures(const ProgressCallback& progressCallback);
+        // returns the number of added tracks
+        std::size_t addNewTracks();
+        void buildLookups();
+        void addTrackLookups(Database::Session& session, HnswIndex::NodeIndex node);
+
+        std::vector<float> computeMeanVector(std::span<const HnswIndex::NodeIndex> nodes) const;
+
+        // objects of the closest nodes, by ascending distance
+        template <typename IdType, typename NodeObjectsVisitor>
+        std::vector<IdType> findClosestObjects(std::span<const float> query, std::size_t maxCount, NodeObjectsVisitor visitNodeObjects) const;
+
+        Database::Db& _db;
+        bool _loadCancelled{};
+        std::optional<Cache> _cache;
+
+        // lookups, built from the database at load time
+        std::unordered_map<Database::TrackId, HnswIndex::NodeIndex> _nodesByTrack; // only existing tracks
+        std::unordered_map<Database::ReleaseId, std::vector<HnswIndex::NodeIndex>> _nodesByRelease;
+        std::unordered_map<Database::ArtistId, std::vector<HnswIndex::NodeIndex>> _nodesByArtist; // all link types
+        std::vector<Database::ReleaseId> _nodeReleases;
+        std::vector<std::vector<std::pair<Database::ArtistId, Database::TrackArtistLinkType>>> _nodeArtistLinks;
+    };
+}
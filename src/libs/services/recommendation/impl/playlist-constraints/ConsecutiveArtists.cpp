@@ -20,12 +20,7 @@
 #include "ConsecutiveArtists.hpp"
 
 #include <algorithm>
-
-#include "database/Db.hpp"
-#include "database/Release.hpp"
-#include "database/Session.hpp"
-#include "database/Track.hpp"
-#include "utils/ILogger.hpp"
+#include <cassert>
 
 namespace Recommendation::PlaylistGeneratorConstraint
 {
@@ -34,27 +29,46 @@ namespace Recommendation::PlaylistGeneratorConstraint
 		std::size_t
 		countCommonArtists(const ArtistContainer& artists1, const ArtistContainer& artists2)
 		{
-			ArtistContainer intersection;
+			std::size_t count {};
+
+			auto it1 {std::cbegin(artists1)};
+			auto it2 {std::cbegin(artists2)};
+			while (it1 != std::cend(artists1) && it2 != std::cend(artists2))
+			{
+				if (*it1 < *it2)
+					++it1;
+				else if (*it2 < *it1)
+					++it2;
+				else
+				{
+					++count;
+					++it1;
+					++it2;
+				}
+			}
+
+			return count;
+		}
 
-			std::set_intersection(std::cbegin(artists1), std::cend(artists1),
-						std::cbegin(artists2), std::cend(artists2),
-						std::back_inserter(intersection));
+		const ArtistContainer&
+		getArtists(const TrackMetadataMap& trackMetadata, Database::TrackId trackId)
+		{
+			static const ArtistContainer noArtists;
 
-			return intersection.size();
+			const auto it {trackMetadata.find(trackId)};
+			return it != std::cend(trackMetadata) ? it->second.artists : noArtists;
 		}
 	}
 
-	ConsecutiveArtists::ConsecutiveArtists(Database::Db& db)
-		: _db {db}
-	{}
-
 	float
-	ConsecutiveArtists::computeScore(const std::vector<Database::TrackId>& trackIds, std::size_t trackIndex)
+	ConsecutiveArtists::computeScore(const TrackContainer& trackIds, std::size_t trackIndex, const TrackMetadataMap& trackMetadata)
 	{
 		assert(!trackIds.empty());
 		assert(trackIndex <= trackIds.size() - 1);
 
-		const ArtistContainer artists {getArtists(trackIds[trackIndex])};
+		const ArtistContainer& artists {getArtists(trackMetadata, trackIds[trackIndex])};
+		if (artists.empty())
+			return 0;
 
 		constexpr std::size_t rangeSize{ 3 }; // check up to rangeSize tracks before/after the target track
 		static_assert(rangeSize > 0);
@@ -63,35 +77,12 @@ namespace Recommendation::PlaylistGeneratorConstraint
 		for (std::size_t i {1}; i < rangeSize; ++i)
 		{
 			if (trackIndex >= i)
-				score += countCommonArtists(artists, getArtists(trackIds[trackIndex - i])) / static_cast<float>(i);
+				score += countCommonArtists(artists, getArtists(trackMetadata, trackIds[trackIndex - i])) / static_cast<float>(i);
 
 			if (trackIndex + i < trackIds.size())
-				score += countCommonArtists(artists, getArtists(trackIds[trackIndex + i])) / static_cast<float>(i);
+				score += countCommonArtists(artists, getArtists(trackMetadata, trackIds[trackIndex + i])) / static_cast<float>(i);
 		}
 
 		return score;
 	}
-
-	ArtistContainer
-	ConsecutiveArtists::getArtists(Database::TrackId trackId)
-	{
-		using namespace Database;
-
-		ArtistContainer res;
-
-		Session& dbSession {_db.getTLSSession()};
-		auto transaction {dbSession.createReadTransaction()};
-
-		const Track::pointer track {Track::find(dbSession, trackId)};
-		if (!track)
-			return res;
-
-		res = track->getArtistIds({});
-		std::sort(std::begin(res), std::end(res));
-
-		return res;
-	}
-
-
 } // namespace Recommendation
-
@@ -19,25 +19,29 @@
 
 #include "ConsecutiveReleases.hpp"
 
-#include "database/Db.hpp"
-#include "database/Release.hpp"
-#include "database/Session.hpp"
-#include "database/Track.hpp"
-#include "utils/ILogger.hpp"
+#include <cassert>
 
 namespace Recommendation::PlaylistGeneratorConstraint
 {
-	ConsecutiveReleases::ConsecutiveReleases(Database::Db& db)
-		: _db {db}
-	{}
+	namespace
+	{
+		Database::ReleaseId
+		getReleaseId(const TrackMetadataMap& trackMetadata, Database::TrackId trackId)
+		{
+			const auto it {trackMetadata.find(trackId)};
+			return it != std::cend(trackMetadata) ? it->second.release : Database::ReleaseId {};
+		}
+	}
 
 	float
-	ConsecutiveReleases::computeScore(const std::vector<Database::TrackId>& trackIds, std::size_t trackIndex)
+	ConsecutiveReleases::computeScore(const TrackContainer& trackIds, std::size_t trackIndex, const TrackMetadataMap& trackMetadata)
 	{
 		assert(!trackIds.empty());
 		assert(trackIndex <= trackIds.size() - 1);
 
-		const Database::ReleaseId releaseId {getReleaseId(trackIds[trackIndex])};
+		const Database::ReleaseId releaseId {getReleaseId(trackMetadata, trackIds[trackIndex])};
+		if (!releaseId.isValid())
+			return 0;
 
 		constexpr std::size_t rangeSize{ 3 }; // check up to rangeSize tracks before/after the target track
 		static_assert(rangeSize > 0);
@@ -45,33 +49,13 @@ namespace Recommendation::PlaylistGeneratorConstraint
 		float score {};
 		for (std::size_t i {1}; i < rangeSize; ++i)
 		{
-			if ((trackIndex >= i) && getReleaseId(trackIds[trackIndex - i]) == releaseId)
+			if ((trackIndex >= i) && getReleaseId(trackMetadata, trackIds[trackIndex - i]) == releaseId)
 				score += (1.f / static_cast<float>(i));
 
-			if ((trackIndex + i < trackIds.size()) && getReleaseId(trackIds[trackIndex + i]) == releaseId)
+			if ((trackIndex + i < trackIds.size()) && getReleaseId(trackMetadata, trackIds[trackIndex + i]) == releaseId)
 				score += (1.f / static_cast<float>(i));
 		}
 
 		return score;
 	}
-
-	Database::ReleaseId
-	ConsecutiveReleases::getReleaseId(Database::TrackId trackId)
-	{
-		using namespace Database;
-
-		Session& dbSession {_db.getTLSSession()};
-		auto transaction {dbSession.createReadTransaction()};
-
-		const Track::pointer track {Track::find(dbSession, trackId)};
-		if (!track)
-			return {};
-
-		const Release::pointer release {track->getRelease()};
-		if (!release)
-			return {};
-
-		return release->getId();
-	}
 } // namespace Recommendation
-
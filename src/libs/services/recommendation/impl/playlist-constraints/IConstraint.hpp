@@ -19,12 +19,23 @@
 
 #pragma once
 
+#include <unordered_map>
 #include <vector>
 
+#include "database/ReleaseId.hpp"
+#include "database/TrackId.hpp"
 #include "services/recommendation/Types.hpp"
 
 namespace Recommendation::PlaylistGeneratorConstraint
 {
+	// Metadata of the candidate and playlist tracks, loaded once per generation so that scoring does not hit the database
+	struct TrackMetadata
+	{
+		Database::ReleaseId	release;
+		ArtistContainer		artists; // sorted
+	};
+	using TrackMetadataMap = std::unordered_map<Database::TrackId, TrackMetadata>;
+
 	class IConstraint
 	{
 		public:
@@ -34,6 +45,6 @@ namespace Recommendation::PlaylistGeneratorConstraint
 			// 0: best
 			// 1: worst
 			// > 1 : violation
-			virtual float computeScore(const TrackContainer& trackIds, std::size_t trackIndex) = 0;
+			virtual float computeScore(const TrackContainer& trackIds, std::size_t trackIndex, const TrackMetadataMap& trackMetadata) = 0;
 	};
 } // namespace Recommendation
@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+
+namespace Recommendation
+{
+    // Computes low level audio features from decoded samples, for tracks that have no AcousticBrainz data
+    // Features are encoded the same way as AcousticBrainz low level data (see FeaturesDefs), only the spectral ones are computed
+    class IAudioFeaturesAnalyzer
+    {
+    public:
+        virtual ~IAudioFeaturesAnalyzer() = default;
+
+        // mono samples, at sampleRate
+        static constexpr std::size_t sampleRate{ 44'100 };
+        virtual void process(std::span<const float> samples) = 0;
+
+        // none if not enough samples were processed
+        virtual std::optional<std::string> getJsonEncodedFeatures() const = 0;
+    };
+
+    std::unique_ptr<IAudioFeaturesAnalyzer> createAudioFeaturesAnalyzer();
+}
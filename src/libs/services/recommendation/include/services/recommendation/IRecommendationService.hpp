@@ -20,6 +20,7 @@
 #pragma once
 
 #include <memory>
+#include <optional>
 #include <vector>
 #include "utils/EnumSet.hpp"
 #include "database/TrackListId.hpp"
@@ -38,7 +39,9 @@ namespace Recommendation
 		public:
 			virtual ~IRecommendationService() = default;
 
-			virtual void load() = 0;
+			// Asynchronous: the current engine keeps on being used until the new one is completely loaded
+			virtual void load(const ProgressCallback& progressCallback = {}) = 0;
+			virtual void waitLoaded() const = 0;
 
 			virtual TrackContainer findSimilarTracks(Database::TrackListId tracklistId, std::size_t maxCount) const = 0;
 			virtual TrackContainer findSimilarTracks(const std::vector<Database::TrackId>& tracksId, std::size_t maxCount) const = 0;
@@ -46,6 +49,7 @@ namespace Recommendation
 			virtual ArtistContainer getSimilarArtists(Database::ArtistId artistId, EnumSet<Database::TrackArtistLinkType> linkTypes, std::size_t maxCount) const = 0;
 	};
 
-	std::unique_ptr<IRecommendationService> createRecommendationService(Database::Db& db);
+	// The engine type is read from the scan settings, unless forcedEngineType is set (used by the tools to compare engines)
+	std::unique_ptr<IRecommendationService> createRecommendationService(Database::Db& db, std::optional<EngineType> forcedEngineType = std::nullopt);
 } // ns Recommendation
 
@@ -14,6 +14,13 @@ namespace Recommendation
 	};
 	using ProgressCallback = std::function<void(const Progress&)>;
 
+	enum class EngineType
+	{
+		Clusters,
+		Features,
+		NearestNeighbours,
+	};
+
 	template <typename IdType>
 	using ResultContainer = std::vector<IdType>;
 
@@ -0,0 +1,206 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "FileSystemWatcher.hpp"
+
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+
+#include "utils/Exception.hpp"
+#include "utils/ILogger.hpp"
+
+namespace Scanner
+{
+#if defined(__linux__)
+    namespace
+    {
+        constexpr std::uint32_t watchMask{ IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR };
+    }
+
+    FileSystemWatcher::FileSystemWatcher(const std::vector<std::filesystem::path>& rootDirectories, const std::filesystem::path& excludeDirFileName, ChangeCallback callback)
+        : _rootDirectories{ rootDirectories }
+        , _excludeDirFileName{ excludeDirFileName }
+        , _callback{ std::move(callback) }
+    {
+        _inotifyFd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (_inotifyFd < 0)
+            throw LmsException{ "Cannot create inotify instance: " + std::string{ ::strerror(errno) } };
+
+        _stopFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (_stopFd < 0)
+        {
+            ::close(_inotifyFd);
+            throw LmsException{ "Cannot create eventfd: " + std::string{ ::strerror(errno) } };
+        }
+
+        for (const std::filesystem::path& rootDirectory : _rootDirectories)
+            addWatchesRecursive(rootDirectory);
+
+        LMS_LOG(DBUPDATER, INFO, "Watching " << _watchedDirectories.size() << " directories for changes");
+
+        _thread = std::thread{ [this] { run(); } };
+    }
+
+    FileSystemWatcher::~FileSystemWatcher()
+    {
+        const std::uint64_t value{ 1 };
+        if (::write(_stopFd, &value, sizeof(value)) < 0)
+            LMS_LOG(DBUPDATER, ERROR, "Cannot stop file system watcher: " << ::strerror(errno));
+
+        _thread.join();
+
+        ::close(_stopFd);
+        ::close(_inotifyFd);
+    }
+
+    void FileSystemWatcher::addWatchesRecursive(const std::filesystem::path& directory)
+    {
+        std::error_code ec;
+        if (!_excludeDirFileName.empty() && std::filesystem::exists(directory / _excludeDirFileName, ec))
+            return;
+
+        const int wd{ ::inotify_add_watch(_inotifyFd, directory.c_str(), watchMask) };
+        if (wd < 0)
+        {
+            if (errno == ENOSPC)
+                LMS_LOG(DBUPDATER, WARNING, "Cannot watch '" << directory.string() << "': too many watches (see /proc/sys/fs/inotify/max_user_watches)");
+            else
+                LMS_LOG(DBUPDATER, ERROR, "Cannot watch '" << directory.string() << "': " << ::strerror(errno));
+            return;
+        }
+        _watchedDirectories[wd] = directory;
+
+        std::filesystem::directory_iterator itPath{ directory, std::filesystem::directory_options::follow_directory_symlink, ec };
+        std::filesystem::directory_iterator itEnd;
+        while (!ec && itPath != itEnd)
+        {
+            if (std::filesystem::is_directory(*itPath, ec) && !ec)
+                addWatchesRecursive(*itPath);
+
+            itPath.increment(ec);
+        }
+    }
+
+    void FileSystemWatcher::run()
+    {
+        std::array<pollfd, 2> fds{ pollfd{ _inotifyFd, POLLIN, 0 }, pollfd{ _stopFd, POLLIN, 0 } };
+        alignas(inotify_event) std::array<char, 64 * 1024> buffer;
+
+        while (true)
+        {
+            if (::poll(fds.data(), fds.size(), -1) < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+
+                LMS_LOG(DBUPDATER, ERROR, "Cannot poll file system events: " << ::strerror(errno));
+                return;
+            }
+
+            if (fds[1].revents & POLLIN)
+                return;
+
+            if (!(fds[0].revents & POLLIN))
+                continue;
+
+            while (true)
+            {
+                const ssize_t readSize{ ::read(_inotifyFd, buffer.data(), buffer.size()) };
+                if (readSize <= 0)
+                    break;
+
+                processEvents(buffer.data(), static_cast<std::size_t>(readSize));
+            }
+        }
+    }
+
+    void FileSystemWatcher::processEvents(const char* buffer, std::size_t size)
+    {
+        for (std::size_t offset{}; offset < size;)
+        {
+            const inotify_event& event{ *reinterpret_cast<const inotify_event*>(buffer + offset) };
+            offset += sizeof(inotify_event) + event.len;
+
+            if (event.mask & IN_Q_OVERFLOW)
+            {
+                LMS_LOG(DBUPDATER, WARNING, "Too many file system events, rescanning all watched directories");
+                for (const std::filesystem::path& rootDirectory : _rootDirectories)
+                    _callback(rootDirectory);
+                continue;
+            }
+
+            auto itDirectory{ _watchedDirectories.find(event.wd) };
+            if (itDirectory == std::cend(_watchedDirectories))
+                continue;
+
+            if (event.mask & IN_IGNORED)
+            {
+                _watchedDirectories.erase(itDirectory);
+                continue;
+            }
+
+            const std::filesystem::path& directory{ itDirectory->second };
+            if (event.mask & (IN_DELETE_SELF | IN_MOVE_SELF))
+            {
+                _callback(directory);
+                continue;
+            }
+
+            if (event.len == 0)
+                continue;
+
+            const std::filesystem::path path{ directory / event.name };
+            if (event.mask & IN_ISDIR)
+            {
+                // new directories may already have content
+                if (event.mask & (IN_CREATE | IN_MOVED_TO))
+                    addWatchesRecursive(path);
+
+                _callback(path);
+            }
+            else if (path.filename() == _excludeDirFileName)
+            {
+                _callback(directory);
+            }
+            else if (event.mask & (IN_CLOSE_WRITE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO))
+            {
+                _callback(directory);
+            }
+        }
+    }
+#else
+    FileSystemWatcher::FileSystemWatcher(const std::vector<std::filesystem::path>& rootDirectories, const std::filesystem::path& excludeDirFileName, ChangeCallback callback)
+        : _rootDirectories{ rootDirectories }
+        , _excludeDirFileName{ excludeDirFileName }
+        , _callback{ std::move(callback) }
+    {
+        LMS_LOG(DBUPDATER, WARNING, "Watching directories for changes is not supported on this platform");
+    }
+
+    FileSystemWatcher::~FileSystemWatcher() = default;
+#endif
+}
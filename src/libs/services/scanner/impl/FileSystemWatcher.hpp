@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <filesystem>
+#include <functional>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace Scanner
+{
+    // Watch the given directories and their sub directories for changes (inotify based)
+    // The callback is called from a dedicated thread with the directory to be rescanned:
+    // either a directory whose direct content has changed, or a directory that has been added/removed
+    class FileSystemWatcher
+    {
+    public:
+        using ChangeCallback = std::function<void(const std::filesystem::path& directory)>;
+
+        FileSystemWatcher(const std::vector<std::filesystem::path>& rootDirectories, const std::filesystem::path& excludeDirFileName, ChangeCallback callback);
+        ~FileSystemWatcher();
+
+        FileSystemWatcher(const FileSystemWatcher&) = delete;
+        FileSystemWatcher& operator=(const FileSystemWatcher&) = delete;
+
+    private:
+        void addWatchesRecursive(const std::filesystem::path& directory);
+        void run();
+        void processEvents(const char* buffer, std::size_t size);
+
+        const std::vector<std::filesystem::path> _rootDirectories;
+        const std::filesystem::path _excludeDirFileName;
+        ChangeCallback _callback;
+
+        int _inotifyFd{ -1 };
+        int _stopFd{ -1 };
+        std::unordered_map<int, std::filesystem::path> _watchedDirectories; // by watch descriptor
+        std::thread _thread;
+    };
+}
@@ -19,9 +19,17 @@
 
 #pragma once
 
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <set>
 #include <string_view>
 #include <vector>
 
+#include <Wt/WDateTime.h>
+
+#include "database/DirectorySignature.hpp"
+#include "database/MediaLibraryId.hpp"
 #include "services/scanner/ScannerStats.hpp"
 
 namespace Scanner
@@ -34,11 +42,27 @@ namespace Scanner
         virtual ScanStep getStep() const = 0;
         virtual std::string_view getStepName() const = 0;
 
+        // Files found by the discovery step, so that other steps do not have to walk the media libraries again
+        struct DiscoveredFile
+        {
+            std::filesystem::path       path;
+            Wt::WDateTime               lastWriteTime;
+            Database::MediaLibraryId    mediaLibrary;
+            bool                        inChangedDirectory{};  // directory added or modified since the last complete scan, scanned first
+        };
+
         struct ScanContext
         {
             const bool forceScan;
+            const std::vector<std::filesystem::path> directories;   // if not empty, only scan these directories (and their sub directories)
             ScanStats stats;
             ScanStepStats currentStepStats;
+            std::vector<DiscoveredFile> discoveredFiles;   // sorted by path
+            bool discoveryComplete{};                       // false if the discovery has been aborted
+            std::map<Database::MediaLibraryId, std::filesystem::path> scanCheckpoints; // resumed scan: files up to these paths have already been processed
+            std::vector<Database::DirectorySignature::Entry> directorySignatures;    // computed by the discovery step, saved once the scan is complete
+            std::set<std::filesystem::path> changedDirectories;    // directories with added, removed or modified tracks or image files, used to invalidate the covers
+            std::int64_t catalogueChangeIdAtStart{};                // last catalogue change made before the scan, to find the tracks changed by the scan (see CatalogueChange)
         };
         virtual void process(ScanContext& context) = 0;
     };
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/post.hpp>
+
+#include "database/Track.hpp"
+#include "utils/IOContextRunner.hpp"
+#include "utils/IResourceGovernor.hpp"
+
+namespace Scanner
+{
+    // Processes the tracks using a pool of threads
+    // Results are handed in batches to saveFunc, from the calling thread, in no particular order
+    // Tracks for which processFunc returns nothing are skipped (remaining ones are skipped too once abort is set)
+    template<typename Result>
+    void processTracksInParallel(std::span<const Database::Track::PathResult> paths, std::size_t threadCount, std::size_t batchSize, const bool& abort,
+        std::function<std::optional<Result>(const Database::Track::PathResult&)> processFunc, std::function<void(std::span<const Result>)> saveFunc)
+    {
+        if (paths.empty())
+            return;
+
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::vector<Result> results; // protected by mutex
+        std::size_t completedCount{}; // protected by mutex
+
+        boost::asio::io_service ioService;
+        for (const Database::Track::PathResult& path : paths)
+        {
+            boost::asio::post(ioService, [&]
+                {
+                    std::optional<Result> result;
+                    if (!abort)
+                    {
+                        throttleBackgroundWork();
+                        result = processFunc(path);
+                    }
+
+                    {
+                        const std::scoped_lock lock{ mutex };
+                        if (result)
+                            results.push_back(std::move(*result));
+                        completedCount++;
+                    }
+                    cv.notify_one();
+                });
+        }
+        IOContextRunner ioContextRunner{ ioService, threadCount };
+
+        std::vector<Result> resultsToSave;
+        bool done{};
+        while (!done)
+        {
+            {
+                std::unique_lock lock{ mutex };
+                cv.wait(lock, [&] { return results.size() >= batchSize || completedCount == paths.size(); });
+
+                resultsToSave.swap(results);
+                done = completedCount == paths.size();
+            }
+
+            if (!resultsToSave.empty())
+            {
+                saveFunc(resultsToSave);
+                resultsToSave.clear();
+            }
+        }
+    }
+}
@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PassiveScannerService.hpp"
+
+#include "database/CatalogueSnapshot.hpp"
+#include "database/Db.hpp"
+#include "utils/IConfig.hpp"
+#include "utils/ILogger.hpp"
+#include "utils/Service.hpp"
+
+#include "ScanReports.hpp"
+
+namespace Scanner
+{
+    namespace
+    {
+        // the reports only keep the summary counters
+        ScanStats toScanStats(const ScanReport& report)
+        {
+            ScanStats stats;
+            stats.startTime = report.startTime;
+            stats.stopTime = report.stopTime;
+            stats.scans = report.scanCount;
+            stats.skips = report.fileCount > report.changeCount ? report.fileCount - report.changeCount : 0;
+            stats.updates = report.changeCount;
+            stats.errorCount = report.errorCount;
+            stats.performance = report.performance;
+
+            return stats;
+        }
+
+        std::filesystem::file_time_type getWriteTime(const std::filesystem::path& path)
+        {
+            std::error_code ec;
+            const std::filesystem::file_time_type writeTime{ std::filesystem::last_write_time(path, ec) };
+            return ec ? std::filesystem::file_time_type{} : writeTime;
+        }
+    }
+
+    std::unique_ptr<IScannerService> createPassiveScannerService(Database::Db& db)
+    {
+        return std::make_unique<PassiveScannerService>(db);
+    }
+
+    PassiveScannerService::PassiveScannerService(Database::Db& db)
+        : _db{ db }
+        , _dbSession{ db }
+        , _scanReportsPath{ Service<IConfig>::get()->getPath("working-dir") / "scan-reports.json" }
+    {
+        _ioService.setThreadCount(1);
+
+        if (Service<IConfig>::get()->getULong("scanner-report-count", 5) == 0)
+            LMS_LOG(DBUPDATER, WARNING, "Scan reports disabled, the scans made by the primary worker cannot be followed");
+
+        _scanReportsWriteTime = getWriteTime(_scanReportsPath);
+        _scanReports = loadScanReports(_scanReportsPath);
+
+        _ioService.post([this]
+            {
+                publishCatalogueSnapshot();
+                schedulePoll();
+            });
+        _ioService.start();
+    }
+
+    PassiveScannerService::~PassiveScannerService()
+    {
+        _pollTimer.cancel();
+        _ioService.stop();
+    }
+
+    void PassiveScannerService::requestStop()
+    {
+        LMS_LOG(DBUPDATER, WARNING, "Scans can only be stopped from the primary worker");
+    }
+
+    void PassiveScannerService::requestReload()
+    {
+        _ioService.post([this] { publishCatalogueSnapshot(); });
+    }
+
+    void PassiveScannerService::requestImmediateScan(bool)
+    {
+        LMS_LOG(DBUPDATER, WARNING, "Scans can only be requested from the primary worker");
+    }
+
+    PassiveScannerService::Status PassiveScannerService::getStatus() const
+    {
+        Status res;
+
+        std::shared_lock lock{ _statusMutex };
+
+        if (!_scanReports.empty())
+            res.lastCompleteScanStats = toScanStats(_scanReports.front());
+        res.lastScanReports = _scanReports;
+
+        return res;
+    }
+
+    void PassiveScannerService::schedulePoll()
+    {
+        _pollTimer.expires_after(pollPeriod);
+        _pollTimer.async_wait([this](const boost::system::error_code& ec)
+            {
+                if (ec)
+                    return;
+
+                poll();
+                schedulePoll();
+            });
+    }
+
+    void PassiveScannerService::poll()
+    {
+        const std::filesystem::file_time_type writeTime{ getWriteTime(_scanReportsPath) };
+        if (writeTime == _scanReportsWriteTime)
+            return;
+
+        _scanReportsWriteTime = writeTime;
+
+        std::vector<ScanReport> scanReports{ loadScanReports(_scanReportsPath) };
+        if (scanReports.empty())
+            return;
+
+        bool newScan{};
+        {
+            std::unique_lock lock{ _statusMutex };
+
+            newScan = _scanReports.empty() || _scanReports.front().stopTime != scanReports.front().stopTime;
+            _scanReports = std::move(scanReports);
+        }
+
+        if (!newScan)
+            return;
+
+        LMS_LOG(DBUPDATER, INFO, "Scan completed by the primary worker");
+        publishCatalogueSnapshot();
+
+        ScanStats stats;
+        {
+            std::shared_lock lock{ _statusMutex };
+            stats = toScanStats(_scanReports.front());
+        }
+        _events.scanComplete.emit(ScanSummary{ stats });
+    }
+
+    void PassiveScannerService::publishCatalogueSnapshot()
+    {
+        std::shared_ptr<const Database::CatalogueSnapshot> snapshot;
+        {
+            auto transaction{ _dbSession.createReadTransaction() };
+            snapshot = Database::CatalogueSnapshot::build(_dbSession);
+        }
+        _db.publishCatalogueSnapshot(std::move(snapshot));
+    }
+} // namespace Scanner
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <shared_mutex>
+#include <vector>
+
+#include <Wt/WIOService.h>
+
+#include <boost/asio/steady_timer.hpp>
+
+#include "database/Session.hpp"
+#include "services/scanner/IScannerService.hpp"
+
+namespace Database
+{
+    class Db;
+}
+
+namespace Scanner
+{
+    // Used by the processes that share the database with the one that actually scans the media libraries (see worker-count)
+    // The scans are followed through the saved scan reports
+    class PassiveScannerService : public IScannerService
+    {
+    public:
+        PassiveScannerService(Database::Db& db);
+        ~PassiveScannerService();
+
+        PassiveScannerService(const PassiveScannerService&) = delete;
+        PassiveScannerService& operator=(const PassiveScannerService&) = delete;
+
+    private:
+        void requestStop() override;
+        void requestReload() override;
+        void requestImmediateScan(bool force) override;
+
+        Status getStatus() const override;
+        Events& getEvents() override { return _events; }
+
+        void schedulePoll();
+        void poll();
+        void publishCatalogueSnapshot();
+
+        static constexpr std::chrono::seconds pollPeriod{ 10 };
+
+        Database::Db&                       _db;
+        Database::Session                   _dbSession;
+        const std::filesystem::path         _scanReportsPath;
+        Events                              _events;
+        Wt::WIOService                      _ioService;
+        boost::asio::steady_timer           _pollTimer{ _ioService };
+
+        std::filesystem::file_time_type     _scanReportsWriteTime{};
+        mutable std::shared_mutex           _statusMutex;
+        std::vector<ScanReport>             _scanReports; // most recent first
+    };
+} // namespace Scanner
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "RateLimiter.hpp"
+
+#include <algorithm>
+#include <thread>
+
+namespace Scanner
+{
+    namespace
+    {
+        // sleep by small steps to react quickly to aborts
+        constexpr std::chrono::milliseconds maxSleepDuration{ 100 };
+    }
+
+    RateLimiter::RateLimiter(std::size_t maxUnitsPerSecond)
+        : _maxUnitsPerSecond{ maxUnitsPerSecond }
+    {
+    }
+
+    void RateLimiter::acquire(std::size_t units, const bool& abort)
+    {
+        if (_maxUnitsPerSecond == 0 || units == 0)
+            return;
+
+        clock::time_point startTime;
+        {
+            std::scoped_lock lock{ _mutex };
+
+            // Reserve a time slot after the previous consumers
+            startTime = std::max(clock::now(), _nextAvailableTime);
+            _nextAvailableTime = startTime + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>{ static_cast<double>(units) / _maxUnitsPerSecond });
+        }
+
+        for (clock::time_point now{ clock::now() }; now < startTime && !abort; now = clock::now())
+            std::this_thread::sleep_for(std::min<clock::duration>(startTime - now, maxSleepDuration));
+    }
+}
@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+
+namespace Scanner
+{
+    // Limits the average consumption rate of some units (files, bytes, ...), shared by several threads
+    class RateLimiter
+    {
+    public:
+        RateLimiter(std::size_t maxUnitsPerSecond); // 0 means unlimited
+
+        RateLimiter(const RateLimiter&) = delete;
+        RateLimiter& operator=(const RateLimiter&) = delete;
+
+        // Blocks until the given units can be consumed, or until abort is set
+        void acquire(std::size_t units, const bool& abort);
+
+    private:
+        using clock = std::chrono::steady_clock;
+
+        const std::size_t _maxUnitsPerSecond;
+        std::mutex _mutex;
+        clock::time_point _nextAvailableTime;
+    };
+}
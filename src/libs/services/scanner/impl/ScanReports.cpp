@@ -0,0 +1,220 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ScanReports.hpp"
+
+#include <fstream>
+#include <sstream>
+
+#include <Wt/Json/Array.h>
+#include <Wt/Json/Object.h>
+#include <Wt/Json/Parser.h>
+#include <Wt/Json/Serializer.h>
+#include <Wt/WException.h>
+
+#include "utils/ILogger.hpp"
+
+namespace Scanner
+{
+    namespace
+    {
+        Wt::Json::Value toJsonValue(std::uintmax_t value)
+        {
+            return Wt::Json::Value{ static_cast<long long>(value) };
+        }
+
+        long long getLongLong(const Wt::Json::Object& object, const std::string& name)
+        {
+            return object.get(name).toNumber().orIfNull(0LL);
+        }
+
+        Wt::Json::Object toJson(const ScanPerformance& performance)
+        {
+            Wt::Json::Object object;
+
+            Wt::Json::Array steps;
+            for (const ScanPerformance::Step& step : performance.steps)
+            {
+                Wt::Json::Object stepObject;
+                stepObject["step"] = Wt::Json::Value{ static_cast<int>(step.step) };
+                stepObject["duration_ms"] = toJsonValue(step.duration.count());
+                stepObject["processed_elems"] = toJsonValue(step.processedElems);
+                steps.push_back(std::move(stepObject));
+            }
+            object["steps"] = std::move(steps);
+
+            object["bytes_read"] = toJsonValue(performance.bytesRead);
+            object["parse_duration_us"] = toJsonValue(performance.parseDuration.count());
+            object["db_duration_us"] = toJsonValue(performance.dbDuration.count());
+
+            Wt::Json::Array slowestFiles;
+            for (const ScanPerformance::SlowFile& slowFile : performance.slowestFiles)
+            {
+                Wt::Json::Object fileObject;
+                fileObject["file"] = Wt::Json::Value{ slowFile.file.string() };
+                fileObject["format"] = Wt::Json::Value{ slowFile.format };
+                fileObject["size"] = toJsonValue(slowFile.size);
+                fileObject["parse_duration_us"] = toJsonValue(slowFile.parseDuration.count());
+                slowestFiles.push_back(std::move(fileObject));
+            }
+            object["slowest_files"] = std::move(slowestFiles);
+
+            return object;
+        }
+
+        ScanPerformance performanceFromJson(const Wt::Json::Object& object)
+        {
+            ScanPerformance performance;
+
+            if (object.type("steps") == Wt::Json::Type::Array)
+            {
+                const Wt::Json::Array& steps = object.get("steps");
+                for (const Wt::Json::Value& step : steps)
+                {
+                    if (step.type() != Wt::Json::Type::Object)
+                        continue;
+
+                    const Wt::Json::Object& stepObject = step;
+                    const long long stepIndex{ getLongLong(stepObject, "step") };
+                    if (stepIndex < 0 || stepIndex >= static_cast<long long>(ScanProgressStepCount))
+                        continue;
+
+                    performance.steps.push_back(ScanPerformance::Step{ static_cast<ScanStep>(stepIndex), std::chrono::milliseconds{ getLongLong(stepObject, "duration_ms") }, static_cast<std::size_t>(getLongLong(stepObject, "processed_elems")) });
+                }
+            }
+
+            performance.bytesRead = getLongLong(object, "bytes_read");
+            performance.parseDuration = std::chrono::microseconds{ getLongLong(object, "parse_duration_us") };
+            performance.dbDuration = std::chrono::microseconds{ getLongLong(object, "db_duration_us") };
+
+            if (object.type("slowest_files") == Wt::Json::Type::Array)
+            {
+                const Wt::Json::Array& slowestFiles = object.get("slowest_files");
+                for (const Wt::Json::Value& slowFile : slowestFiles)
+                {
+                    if (slowFile.type() != Wt::Json::Type::Object)
+                        continue;
+
+                    const Wt::Json::Object& fileObject = slowFile;
+                    performance.slowestFiles.push_back(ScanPerformance::SlowFile{
+                        static_cast<std::string>(fileObject.get("file").orIfNull("")),
+                        static_cast<std::string>(fileObject.get("format").orIfNull("")),
+                        static_cast<std::uintmax_t>(getLongLong(fileObject, "size")),
+                        std::chrono::microseconds{ getLongLong(fileObject, "parse_duration_us") } });
+                }
+            }
+
+            return performance;
+        }
+
+        Wt::Json::Object toJson(const ScanReport& report)
+        {
+            Wt::Json::Object object;
+
+            object["start_time"] = Wt::Json::Value{ static_cast<long long>(report.startTime.toTime_t()) };
+            object["stop_time"] = Wt::Json::Value{ static_cast<long long>(report.stopTime.toTime_t()) };
+            object["file_count"] = toJsonValue(report.fileCount);
+            object["scan_count"] = toJsonValue(report.scanCount);
+            object["change_count"] = toJsonValue(report.changeCount);
+            object["error_count"] = toJsonValue(report.errorCount);
+            object["performance"] = toJson(report.performance);
+
+            return object;
+        }
+
+        ScanReport reportFromJson(const Wt::Json::Object& object)
+        {
+            ScanReport report;
+
+            report.startTime = Wt::WDateTime::fromTime_t(getLongLong(object, "start_time"));
+            report.stopTime = Wt::WDateTime::fromTime_t(getLongLong(object, "stop_time"));
+            report.fileCount = getLongLong(object, "file_count");
+            report.scanCount = getLongLong(object, "scan_count");
+            report.changeCount = getLongLong(object, "change_count");
+            report.errorCount = getLongLong(object, "error_count");
+            if (object.type("performance") == Wt::Json::Type::Object)
+                report.performance = performanceFromJson(object.get("performance"));
+
+            return report;
+        }
+    }
+
+    std::vector<ScanReport> loadScanReports(const std::filesystem::path& path)
+    {
+        std::vector<ScanReport> reports;
+
+        std::ifstream file{ path };
+        if (!file)
+            return reports;
+
+        try
+        {
+            std::ostringstream oss;
+            oss << file.rdbuf();
+
+            Wt::Json::Object root;
+            Wt::Json::parse(oss.str(), root);
+
+            if (root.type("reports") == Wt::Json::Type::Array)
+            {
+                const Wt::Json::Array& reportValues = root.get("reports");
+                for (const Wt::Json::Value& reportValue : reportValues)
+                {
+                    if (reportValue.type() == Wt::Json::Type::Object)
+                        reports.push_back(reportFromJson(reportValue));
+                }
+            }
+        }
+        catch (const Wt::WException& e)
+        {
+            LMS_LOG(DBUPDATER, WARNING, "Cannot parse scan reports from '" << path.string() << "': " << e.what());
+            reports.clear();
+        }
+
+        return reports;
+    }
+
+    void saveScanReports(const std::filesystem::path& path, std::span<const ScanReport> reports)
+    {
+        Wt::Json::Array reportValues;
+        for (const ScanReport& report : reports)
+            reportValues.push_back(toJson(report));
+
+        Wt::Json::Object root;
+        root["reports"] = std::move(reportValues);
+
+        // never leave a truncated file behind
+        std::filesystem::path tmpPath{ path };
+        tmpPath += ".tmp";
+        {
+            std::ofstream file{ tmpPath, std::ios::out | std::ios::trunc };
+            file << Wt::Json::serialize(root);
+            if (!file)
+            {
+                LMS_LOG(DBUPDATER, ERROR, "Cannot write scan reports into '" << tmpPath.string() << "'");
+                return;
+            }
+        }
+
+        std::error_code ec;
+        std::filesystem::rename(tmpPath, path, ec);
+        if (ec)
+            LMS_LOG(DBUPDATER, ERROR, "Cannot save scan reports into '" << path.string() << "': " << ec.message());
+    }
+}
@@ -0,0 +1,34 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <filesystem>
+#include <span>
+#include <vector>
+
+#include "services/scanner/ScannerStats.hpp"
+
+namespace Scanner
+{
+    // The last scan reports are saved in a JSON file, the most recent first
+    // Missing or invalid files are reported as empty
+    std::vector<ScanReport> loadScanReports(const std::filesystem::path& path);
+    void saveScanReports(const std::filesystem::path& path, std::span<const ScanReport> reports);
+}
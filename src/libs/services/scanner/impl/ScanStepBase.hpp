@@ -20,7 +20,10 @@
 #pragma once
 
 #include <functional>
+#include <span>
+#include <utility>
 
+#include "database/ScanError.hpp"
 #include "services/scanner/ScannerStats.hpp"
 #include "IScanStep.hpp"
 #include "ScannerSettings.hpp"
@@ -53,6 +56,14 @@ namespace Scanner
 			{}
 
 		protected:
+			// Counts the error in the stats and stores it, must be called within a write transaction
+			static void addError(Database::Session& session, ScanStats& stats, ScanError error)
+			{
+				const Database::ScanError::Entry entry{ error.file, static_cast<int>(error.error), error.systemError };
+				Database::ScanError::add(session, std::span{ &entry, 1 });
+				stats.addError(std::move(error));
+			}
+
 			const ScannerSettings&	_settings;
 			ProgressCallback		_progressCallback;
 			bool&					_abortScan;
@@ -19,6 +19,9 @@
 
 #include "ScanStepCheckDuplicatedDbFiles.hpp"
 
+#include <optional>
+#include <vector>
+
 #include "database/Db.hpp"
 #include "database/Session.hpp"
 #include "database/Track.hpp"
@@ -26,6 +29,11 @@
 
 namespace Scanner
 {
+    namespace
+    {
+        constexpr std::size_t readBatchSize{ 100 }; // MBIDs
+    }
+
     void ScanStepCheckDuplicatedDbFiles::process(ScanContext& context)
     {
         using namespace Database;
@@ -33,23 +41,32 @@ namespace Scanner
         if (_abortScan)
             return;
 
-		Session& session {_db.getTLSSession()};
-		auto transaction {session.createReadTransaction()};
+        Session& session{ _db.getTLSSession() };
 
-        const RangeResults<TrackId> tracks = Track::findIdsTrackMBIDDuplicates(session);
-        for (const TrackId trackId : tracks.results)
+        // Only the MBIDs of the tracks changed by this scan are checked, by batches so that the read transactions stay short
+        std::optional<UUID> lastMBID;
+        while (!_abortScan)
         {
-            if (_abortScan)
-                break;
+            std::vector<Track::MBIDDuplicates> duplicates;
+            {
+                auto transaction{ session.createReadTransaction() };
+                duplicates = Track::findTrackMBIDDuplicates(session, context.catalogueChangeIdAtStart, lastMBID, readBatchSize);
+            }
 
-            const Track::pointer track{ Track::find(session, trackId) };
-            if (auto trackMBID{ track->getTrackMBID() })
+            for (const Track::MBIDDuplicates& duplicate : duplicates)
             {
-                LMS_LOG(DBUPDATER, INFO, "Found duplicated track MBID [" << trackMBID->getAsString() << "], file: " << track->getPath().string() << " - " << track->getName());
-                context.stats.duplicates.emplace_back(ScanDuplicate{ track->getId(), DuplicateReason::SameTrackMBID });
-                context.currentStepStats.processedElems++;
-                _progressCallback(context.currentStepStats);
+                LMS_LOG(DBUPDATER, INFO, "Found duplicated track MBID [" << duplicate.mbid.getAsString() << "], shared by " << duplicate.trackIds.size() << " tracks");
+                for (const TrackId trackId : duplicate.trackIds)
+                    context.stats.duplicates.emplace_back(ScanDuplicate{ trackId, DuplicateReason::SameTrackMBID });
+
+                context.currentStepStats.processedElems += duplicate.trackIds.size();
             }
+            _progressCallback(context.currentStepStats);
+
+            if (duplicates.size() < readBatchSize)
+                break;
+
+            lastMBID = duplicates.back().mbid;
         }
 
         LMS_LOG(DBUPDATER, DEBUG, "Found " << context.currentStepStats.processedElems << " duplicated audio files");
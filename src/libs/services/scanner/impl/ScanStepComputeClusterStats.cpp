@@ -19,8 +19,12 @@
 
 #include "ScanStepComputeClusterStats.hpp"
 #include "database/Db.hpp"
+#include "database/Artist.hpp"
 #include "database/Cluster.hpp"
+#include "database/Facet.hpp"
+#include "database/Release.hpp"
 #include "database/Session.hpp"
+#include "database/TrackList.hpp"
 #include "utils/ILogger.hpp"
 #include "utils/Path.hpp"
 
@@ -33,57 +37,30 @@ namespace Scanner
         if (context.stats.nbChanges() == 0)
             return;
 
-        Session& dbSession{ _db.getTLSSession() };
-
-        const std::size_t clusterCount{ [&] {
-            auto transaction{ dbSession.createReadTransaction() };
-            return Cluster::getCount(dbSession);
-            }() };
-
-        context.currentStepStats.totalElems = clusterCount;
-
-        foreachSubRange(Range{ 0, clusterCount }, 100, [&](Range range)
-            {
-                const std::vector<ClusterId> clusterIds{ [&]
-                {
-                    Cluster::FindParameters params;
-                    params.setRange(range);
-
-                    {
-                        auto transaction{ dbSession.createReadTransaction() };
-                        return std::move(Cluster::findIds(dbSession, params).results);
-                    }
-                }() };
-
-                for (const ClusterId clusterId : clusterIds)
-                {
-                    if (_abortScan)
-                        break;
-
-                    std::size_t trackCount;
-                    std::size_t releaseCount;
+        if (_abortScan)
+            return;
 
-                    {
-                        auto transaction{ dbSession.createReadTransaction() };
+        Session& dbSession{ _db.getTLSSession() };
 
-                        trackCount = Cluster::computeTrackCount(dbSession, clusterId);
-                        releaseCount = Cluster::computeReleaseCount(dbSession, clusterId);
-                    }
+        {
+            auto transaction{ dbSession.createWriteTransaction() };
 
-                    {
-                        auto transaction{ dbSession.createWriteTransaction() };
+            context.currentStepStats.totalElems = Cluster::getCount(dbSession);
+            Cluster::updateCounts(dbSession);
+            Facet::updateCounts(dbSession);
+            context.currentStepStats.processedElems = context.currentStepStats.totalElems;
+        }
 
-                        auto cluster{ Cluster::find(dbSession, clusterId) };
-                        cluster.modify()->setTrackCount(trackCount);
-                        cluster.modify()->setReleaseCount(releaseCount);
-                    }
+        LMS_LOG(DBUPDATER, DEBUG, "Recomputed stats for " << context.currentStepStats.processedElems << " clusters!");
 
-                    context.currentStepStats.processedElems++;
-                }
+        {
+            auto transaction{ dbSession.createWriteTransaction() };
 
-                return true;
-            });
+            Release::updateAggregates(dbSession);
+            TrackList::updateAggregates(dbSession);
+            Artist::updateLinkTypes(dbSession);
+        }
 
-        LMS_LOG(DBUPDATER, DEBUG, "Recomputed stats for " << context.currentStepStats.processedElems << " clusters!");
+        LMS_LOG(DBUPDATER, DEBUG, "Recomputed release and tracklist aggregates, and artist link types");
     }
 }
@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ScanStepComputeLoudness.hpp"
+
+#include <optional>
+#include <thread>
+
+#include "av/Loudness.hpp"
+#include "av/Types.hpp"
+#include "database/Db.hpp"
+#include "database/Session.hpp"
+#include "database/Track.hpp"
+#include "utils/IConfig.hpp"
+#include "utils/ILogger.hpp"
+#include "utils/Service.hpp"
+#include "ParallelTrackProcessing.hpp"
+
+namespace Scanner
+{
+    namespace
+    {
+        constexpr std::size_t batchSize{ 20 };
+
+        struct AnalyzedTrack
+        {
+            Database::TrackId trackId;
+            std::optional<Av::Loudness> loudness;
+        };
+
+        std::size_t getThreadCount()
+        {
+            std::size_t threadCount{ Service<IConfig>::get()->getULong("scanner-loudness-thread-count", 0) };
+            if (threadCount == 0)
+                threadCount = std::max<std::size_t>(std::thread::hardware_concurrency() / 2, 1);
+
+            return threadCount;
+        }
+    }
+
+    ScanStepComputeLoudness::ScanStepComputeLoudness(InitParams& initParams)
+        : ScanStepBase{ initParams }
+        , _enabled{ Service<IConfig>::get()->getBool("scanner-compute-replay-gain", false) }
+        , _threadCount{ getThreadCount() }
+    {
+    }
+
+    void ScanStepComputeLoudness::process(ScanContext& context)
+    {
+        using namespace Database;
+
+        if (!_enabled)
+            return;
+
+        // Tracks left over by an aborted scan are analyzed by the next one
+        RangeResults<Track::PathResult> paths;
+        {
+            Session& session{ _db.getTLSSession() };
+            auto transaction{ session.createReadTransaction() };
+
+            paths = Track::findPathsWithPendingLoudnessAnalysis(session);
+        }
+
+        context.currentStepStats.totalElems = paths.results.size();
+        if (paths.results.empty())
+            return;
+
+        LMS_LOG(DBUPDATER, DEBUG, "Computing loudness of " << paths.results.size() << " tracks using " << _threadCount << " thread(s)");
+
+        processTracksInParallel<AnalyzedTrack>(paths.results, _threadCount, batchSize, _abortScan,
+            [](const Track::PathResult& path)
+            {
+                AnalyzedTrack analyzedTrack{ path.trackId, std::nullopt };
+                try
+                {
+                    analyzedTrack.loudness = Av::computeLoudness(path.path);
+                }
+                catch (const Av::Exception& e)
+                {
+                    LMS_LOG(DBUPDATER, DEBUG, "Cannot compute loudness of file '" << path.path.string() << "': " << e.what());
+                }
+                return analyzedTrack;
+            },
+            [&](std::span<const AnalyzedTrack> analyzedTracks)
+            {
+                {
+                    Session& session{ _db.getTLSSession() };
+                    auto transaction{ session.createWriteTransaction() };
+
+                    for (const AnalyzedTrack& analyzedTrack : analyzedTracks)
+                    {
+                        Track::pointer track{ Track::find(session, analyzedTrack.trackId) };
+                        if (!track)
+                            continue;
+
+                        // do not try again on failure, until the file changes
+                        if (analyzedTrack.loudness && !track->getTrackReplayGain())
+                            track.modify()->setTrackReplayGain(static_cast<float>(Av::replayGainReferenceLoudness - analyzedTrack.loudness->integratedLoudness));
+                        track.modify()->setLoudnessAnalysisPending(false);
+                    }
+                }
+
+                context.currentStepStats.processedElems += analyzedTracks.size();
+                _progressCallback(context.currentStepStats);
+            });
+
+        LMS_LOG(DBUPDATER, DEBUG, "Computed loudness of " << context.currentStepStats.processedElems << " tracks");
+    }
+}
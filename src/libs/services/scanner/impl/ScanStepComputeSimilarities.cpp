@@ -0,0 +1,548 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ScanStepComputeSimilarities.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "database/Db.hpp"
+#include "database/Session.hpp"
+#include "database/Similarity.hpp"
+#include "utils/IConfig.hpp"
+#include "utils/ILogger.hpp"
+#include "utils/Service.hpp"
+
+namespace Scanner
+{
+    using namespace Database;
+
+    namespace
+    {
+        using Index = std::uint32_t;
+        constexpr Index invalidIndex{ std::numeric_limits<Index>::max() };
+        constexpr std::size_t linkTypeCount{ static_cast<std::size_t>(TrackArtistLinkType::Writer) + 1 };
+
+        // Max number of tracks scored to find the similar tracks of a given track
+        constexpr std::size_t maxTrackCandidateCount{ 1000 };
+        // Number of entities whose similarities are written in a single transaction
+        constexpr std::size_t writeBatchSize{ 100 };
+
+        template <typename IdType>
+        class DenseIndexes
+        {
+        public:
+            Index getOrAdd(IdType id)
+            {
+                const auto [it, inserted]{ _indexes.try_emplace(id, static_cast<Index>(_ids.size())) };
+                if (inserted)
+                    _ids.push_back(id);
+                return it->second;
+            }
+
+            Index find(IdType id) const
+            {
+                const auto it{ _indexes.find(id) };
+                return it == std::cend(_indexes) ? invalidIndex : it->second;
+            }
+
+            IdType getId(Index index) const { return _ids[index]; }
+            std::size_t size() const { return _ids.size(); }
+
+        private:
+            std::unordered_map<IdType, Index> _indexes;
+            std::vector<IdType> _ids;
+        };
+
+        // Compressed lists, values of each list are sorted
+        template <typename T>
+        class AdjacencyLists
+        {
+        public:
+            AdjacencyLists() = default;
+
+            // pairs are sorted in place
+            AdjacencyLists(std::size_t listCount, std::vector<std::pair<Index, T>>& pairs)
+            {
+                std::sort(std::begin(pairs), std::end(pairs));
+
+                _offsets.reserve(listCount + 1);
+                _values.reserve(pairs.size());
+
+                auto it{ std::cbegin(pairs) };
+                for (std::size_t list{}; list < listCount; ++list)
+                {
+                    for (; it != std::cend(pairs) && it->first == list; ++it)
+                        _values.push_back(it->second);
+                    _offsets.push_back(_values.size());
+                }
+            }
+
+            std::size_t size() const { return _offsets.size() - 1; }
+            std::span<const T> operator[](std::size_t list) const { return { _values.data() + _offsets[list], _offsets[list + 1] - _offsets[list] }; }
+
+        private:
+            std::vector<std::size_t> _offsets{ 0 };
+            std::vector<T> _values;
+        };
+
+        struct CountedIndex
+        {
+            Index index;
+            std::uint32_t count;
+
+            bool operator<(const CountedIndex& other) const { return index < other.index; }
+        };
+
+        // how many times each value appears in each list
+        AdjacencyLists<CountedIndex> buildCountedLists(std::size_t listCount, std::vector<std::pair<Index, Index>>& pairs)
+        {
+            std::sort(std::begin(pairs), std::end(pairs));
+
+            std::vector<std::pair<Index, CountedIndex>> countedPairs;
+            for (const auto& [list, value] : pairs)
+            {
+                if (!countedPairs.empty() && countedPairs.back().first == list && countedPairs.back().second.index == value)
+                    countedPairs.back().second.count++;
+                else
+                    countedPairs.emplace_back(list, CountedIndex{ value, 1 });
+            }
+            pairs.clear();
+
+            return AdjacencyLists<CountedIndex>{ listCount, countedPairs };
+        }
+
+        void removeDuplicates(std::vector<std::pair<Index, Index>>& pairs)
+        {
+            std::sort(std::begin(pairs), std::end(pairs));
+            pairs.erase(std::unique(std::begin(pairs), std::end(pairs)), std::end(pairs));
+        }
+
+        // Scores of the candidates of a single entity
+        class ScoreAccumulator
+        {
+        public:
+            explicit ScoreAccumulator(std::size_t size)
+                : _scores(size)
+            {}
+
+            void add(Index index, std::size_t score)
+            {
+                if (_scores[index] == 0)
+                    _candidates.push_back(index);
+                _scores[index] += score;
+            }
+
+            // best candidates first, ties broken using the ids to get stable results across scans
+            template <typename IdType>
+            Similarity::Entries<IdType> extractBest(std::size_t count, const DenseIndexes<IdType>& ids)
+            {
+                const auto isBetter{ [&](Index lhs, Index rhs)
+                    {
+                        if (_scores[lhs] != _scores[rhs])
+                            return _scores[lhs] > _scores[rhs];
+                        return ids.getId(lhs).getValue() < ids.getId(rhs).getValue();
+                    } };
+
+                const std::size_t resultCount{ std::min(count, _candidates.size()) };
+                std::partial_sort(std::begin(_candidates), std::begin(_candidates) + resultCount, std::end(_candidates), isBetter);
+
+                Similarity::Entries<IdType> res;
+                res.reserve(resultCount);
+                for (std::size_t i{}; i < resultCount; ++i)
+                    res.push_back(Similarity::Entry<IdType>{ ids.getId(_candidates[i]), _scores[_candidates[i]] });
+
+                for (Index index : _candidates)
+                    _scores[index] = 0;
+                _candidates.clear();
+
+                return res;
+            }
+
+        private:
+            std::vector<std::size_t> _scores;
+            std::vector<Index> _candidates;
+        };
+
+        template <typename IdType>
+        std::size_t computeHash(std::span<const Similarity::Entry<IdType>> entries)
+        {
+            std::size_t hash{ entries.size() };
+            const auto combine{ [&](std::size_t value) { hash ^= value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2); } };
+
+            for (const Similarity::Entry<IdType>& entry : entries)
+            {
+                combine(std::hash<IdType>{}(entry.id));
+                combine(entry.score);
+            }
+
+            return hash;
+        }
+
+        using ArtistKey = std::pair<ArtistId, TrackArtistLinkType>;
+        struct ArtistKeyHash
+        {
+            std::size_t operator()(const ArtistKey& key) const { return std::hash<ArtistId>{}(key.first) * linkTypeCount + static_cast<std::size_t>(key.second); }
+        };
+
+        // Only writes the similarities that differ from the stored ones
+        template <typename Key, typename IdType, typename KeyHash = std::hash<Key>>
+        class SimilarityWriter
+        {
+        public:
+            using StoreFunc = std::function<void(Session& session, const Key& key, std::span<const Similarity::Entry<IdType>> entries)>;
+
+            SimilarityWriter(Session& session, StoreFunc storeFunc)
+                : _session{ session }
+                , _storeFunc{ std::move(storeFunc) }
+            {}
+
+            void setStoredEntries(const Key& key, std::span<const Similarity::Entry<IdType>> entries)
+            {
+                _storedHashes[key] = computeHash(entries);
+            }
+
+            void update(const Key& key, Similarity::Entries<IdType>&& entries)
+            {
+                const auto itStored{ _storedHashes.find(key) };
+                if (itStored != std::cend(_storedHashes))
+                {
+                    const bool unchanged{ itStored->second == computeHash<IdType>(entries) };
+                    _storedHashes.erase(itStored);
+                    if (unchanged)
+                        return;
+                }
+                else if (entries.empty())
+                    return;
+
+                _pendingUpdates.emplace_back(key, std::move(entries));
+                if (_pendingUpdates.size() >= writeBatchSize)
+                    flush();
+            }
+
+            // Clears the similarities of the entities that have not been updated
+            void finish()
+            {
+                for (const auto& [key, hash] : _storedHashes)
+                {
+                    _pendingUpdates.emplace_back(key, Similarity::Entries<IdType>{});
+                    if (_pendingUpdates.size() >= writeBatchSize)
+                        flush();
+                }
+                _storedHashes.clear();
+
+                flush();
+            }
+
+            std::size_t getUpdateCount() const { return _updateCount; }
+
+        private:
+            void flush()
+            {
+                if (_pendingUpdates.empty())
+                    return;
+
+                {
+                    auto transaction{ _session.createWriteTransaction() };
+
+                    for (const auto& [key, entries] : _pendingUpdates)
+                        _storeFunc(_session, key, entries);
+                }
+
+                _updateCount += _pendingUpdates.size();
+                _pendingUpdates.clear();
+            }
+
+            Session& _session;
+            StoreFunc _storeFunc;
+            std::unordered_map<Key, std::size_t, KeyHash> _storedHashes;
+            std::vector<std::pair<Key, Similarity::Entries<IdType>>> _pendingUpdates;
+            std::size_t _updateCount{};
+        };
+
+        struct ArtistLink
+        {
+            Index artist;
+            TrackArtistLinkType linkType;
+
+            auto operator<=>(const ArtistLink&) const = default;
+        };
+
+        // Only the tracks that belong to at least one cluster are considered
+        struct ClusterModel
+        {
+            DenseIndexes<TrackId> tracks;
+            DenseIndexes<ClusterId> clusters;
+            DenseIndexes<ReleaseId> releases;
+            DenseIndexes<ArtistId> artists;
+
+            AdjacencyLists<Index> trackClusters;
+            AdjacencyLists<Index> clusterTracks;
+            std::vector<Index> trackReleases; // invalidIndex if no release
+            AdjacencyLists<ArtistLink> trackArtistLinks;
+        };
+
+        ClusterModel loadClusterModel(Session& session)
+        {
+            ClusterModel model;
+
+            auto transaction{ session.createReadTransaction() };
+
+            std::vector<std::pair<Index, Index>> trackClusterPairs;
+            Similarity::visitTrackClusters(session, [&](TrackId trackId, ClusterId clusterId)
+                {
+                    trackClusterPairs.emplace_back(model.tracks.getOrAdd(trackId), model.clusters.getOrAdd(clusterId));
+                });
+
+            std::vector<std::pair<Index, Index>> clusterTrackPairs;
+            clusterTrackPairs.reserve(trackClusterPairs.size());
+            for (const auto& [track, cluster] : trackClusterPairs)
+                clusterTrackPairs.emplace_back(cluster, track);
+
+            model.trackClusters = AdjacencyLists<Index>{ model.tracks.size(), trackClusterPairs };
+            model.clusterTracks = AdjacencyLists<Index>{ model.clusters.size(), clusterTrackPairs };
+
+            model.trackReleases.resize(model.tracks.size(), invalidIndex);
+            Similarity::visitTrackReleases(session, [&](TrackId trackId, ReleaseId releaseId)
+                {
+                    const Index track{ model.tracks.find(trackId) };
+                    if (track != invalidIndex)
+                        model.trackReleases[track] = model.releases.getOrAdd(releaseId);
+                });
+
+            std::vector<std::pair<Index, ArtistLink>> trackArtistLinkPairs;
+            Similarity::visitTrackArtistLinks(session, [&](TrackId trackId, ArtistId artistId, TrackArtistLinkType linkType)
+                {
+                    const Index track{ model.tracks.find(trackId) };
+                    if (track != invalidIndex)
+                        trackArtistLinkPairs.emplace_back(track, ArtistLink{ model.artists.getOrAdd(artistId), linkType });
+                });
+            model.trackArtistLinks = AdjacencyLists<ArtistLink>{ model.tracks.size(), trackArtistLinkPairs };
+
+            return model;
+        }
+
+        std::size_t computeIntersectionSize(std::span<const Index> lhs, std::span<const Index> rhs)
+        {
+            std::size_t res{};
+
+            auto itLhs{ std::cbegin(lhs) };
+            auto itRhs{ std::cbegin(rhs) };
+            while (itLhs != std::cend(lhs) && itRhs != std::cend(rhs))
+            {
+                if (*itLhs < *itRhs)
+                    ++itLhs;
+                else if (*itRhs < *itLhs)
+                    ++itRhs;
+                else
+                {
+                    ++res;
+                    ++itLhs;
+                    ++itRhs;
+                }
+            }
+
+            return res;
+        }
+    }
+
+    ScanStepComputeSimilarities::ScanStepComputeSimilarities(InitParams& initParams)
+        : ScanStepBase{ initParams }
+        , _similarityCount{ Service<IConfig>::get()->getULong("scanner-similarity-count", 50) }
+    {
+    }
+
+    void ScanStepComputeSimilarities::process(ScanContext& context)
+    {
+        if (_abortScan)
+            return;
+
+        Session& session{ _db.getTLSSession() };
+
+        if (context.stats.nbChanges() == 0)
+        {
+            auto transaction{ session.createReadTransaction() };
+            if (!Similarity::isEmpty(session))
+                return;
+        }
+
+        const ClusterModel model{ loadClusterModel(session) };
+
+        SimilarityWriter<ReleaseId, ReleaseId> releaseWriter{ session, [](Session& s, ReleaseId release, std::span<const Similarity::Entry<ReleaseId>> entries) { Similarity::setReleaseSimilarities(s, release, entries); } };
+        SimilarityWriter<ArtistKey, ArtistId, ArtistKeyHash> artistWriter{ session, [](Session& s, const ArtistKey& key, std::span<const Similarity::Entry<ArtistId>> entries) { Similarity::setArtistSimilarities(s, key.first, key.second, entries); } };
+        SimilarityWriter<TrackId, TrackId> trackWriter{ session, [](Session& s, TrackId track, std::span<const Similarity::Entry<TrackId>> entries) { Similarity::setTrackSimilarities(s, track, entries); } };
+
+        {
+            auto transaction{ session.createReadTransaction() };
+
+            Similarity::visitReleaseSimilarities(session, [&](ReleaseId release, const Similarity::Entries<ReleaseId>& entries) { releaseWriter.setStoredEntries(release, entries); });
+            Similarity::visitArtistSimilarities(session, [&](ArtistId artist, TrackArtistLinkType linkType, const Similarity::Entries<ArtistId>& entries) { artistWriter.setStoredEntries(ArtistKey{ artist, linkType }, entries); });
+            Similarity::visitTrackSimilarities(session, [&](TrackId track, const Similarity::Entries<TrackId>& entries) { trackWriter.setStoredEntries(track, entries); });
+        }
+
+        context.currentStepStats.totalElems = model.releases.size() + model.artists.size() + model.tracks.size();
+        context.currentStepStats.processedElems = 0;
+
+        // Releases: score of a candidate is the number of its tracks in each cluster of the release
+        {
+            std::vector<std::pair<Index, Index>> releaseClusterPairs;
+            std::vector<std::pair<Index, Index>> clusterReleasePairs;
+            for (Index track{}; track < model.tracks.size(); ++track)
+            {
+                const Index release{ model.trackReleases[track] };
+                if (release == invalidIndex)
+                    continue;
+
+                for (const Index cluster : model.trackClusters[track])
+                {
+                    releaseClusterPairs.emplace_back(release, cluster);
+                    clusterReleasePairs.emplace_back(cluster, release);
+                }
+            }
+            removeDuplicates(releaseClusterPairs);
+
+            const AdjacencyLists<Index> releaseClusters{ model.releases.size(), releaseClusterPairs };
+            const AdjacencyLists<CountedIndex> clusterReleaseCounts{ buildCountedLists(model.clusters.size(), clusterReleasePairs) };
+
+            ScoreAccumulator scores{ model.releases.size() };
+            for (Index release{}; release < model.releases.size(); ++release)
+            {
+                if (_abortScan)
+                    return;
+
+                for (const Index cluster : releaseClusters[release])
+                {
+                    for (const CountedIndex& candidate : clusterReleaseCounts[cluster])
+                    {
+                        if (candidate.index != release)
+                            scores.add(candidate.index, candidate.count);
+                    }
+                }
+
+                releaseWriter.update(model.releases.getId(release), scores.extractBest(_similarityCount, model.releases));
+
+                context.currentStepStats.processedElems++;
+                _progressCallback(context.currentStepStats);
+            }
+            releaseWriter.finish();
+        }
+
+        // Artists: same as releases, candidates are scored separately for each link type they have on the tracks
+        {
+            std::vector<std::pair<Index, Index>> artistClusterPairs;
+            std::vector<std::pair<Index, Index>> clusterArtistLinkPairs;
+            for (Index track{}; track < model.tracks.size(); ++track)
+            {
+                for (const ArtistLink& link : model.trackArtistLinks[track])
+                {
+                    const Index artistLink{ static_cast<Index>(link.artist * linkTypeCount + static_cast<std::size_t>(link.linkType)) };
+                    for (const Index cluster : model.trackClusters[track])
+                    {
+                        artistClusterPairs.emplace_back(link.artist, cluster);
+                        clusterArtistLinkPairs.emplace_back(cluster, artistLink);
+                    }
+                }
+            }
+            removeDuplicates(artistClusterPairs);
+
+            const AdjacencyLists<Index> artistClusters{ model.artists.size(), artistClusterPairs };
+            const AdjacencyLists<CountedIndex> clusterArtistLinkCounts{ buildCountedLists(model.clusters.size(), clusterArtistLinkPairs) };
+
+            std::vector<ScoreAccumulator> scoresByLinkType(linkTypeCount, ScoreAccumulator{ model.artists.size() });
+            for (Index artist{}; artist < model.artists.size(); ++artist)
+            {
+                if (_abortScan)
+                    return;
+
+                for (const Index cluster : artistClusters[artist])
+                {
+                    for (const CountedIndex& candidate : clusterArtistLinkCounts[cluster])
+                    {
+                        const Index candidateArtist{ static_cast<Index>(candidate.index / linkTypeCount) };
+                        if (candidateArtist != artist)
+                            scoresByLinkType[candidate.index % linkTypeCount].add(candidateArtist, candidate.count);
+                    }
+                }
+
+                for (std::size_t linkType{}; linkType < linkTypeCount; ++linkType)
+                    artistWriter.update(ArtistKey{ model.artists.getId(artist), static_cast<TrackArtistLinkType>(linkType) }, scoresByLinkType[linkType].extractBest(_similarityCount, model.artists));
+
+                context.currentStepStats.processedElems++;
+                _progressCallback(context.currentStepStats);
+            }
+            artistWriter.finish();
+        }
+
+        // Tracks: candidates are gathered from the smallest clusters of the track first, and are scored using their shared clusters
+        {
+            ScoreAccumulator scores{ model.tracks.size() };
+            std::vector<Index> seenTracks(model.tracks.size(), invalidIndex);
+            std::vector<Index> trackClusters;
+            std::vector<Index> candidates;
+
+            for (Index track{}; track < model.tracks.size(); ++track)
+            {
+                if (_abortScan)
+                    return;
+
+                const std::span<const Index> clusters{ model.trackClusters[track] };
+                trackClusters.assign(std::cbegin(clusters), std::cend(clusters));
+                std::sort(std::begin(trackClusters), std::end(trackClusters), [&](Index lhs, Index rhs) { return model.clusterTracks[lhs].size() < model.clusterTracks[rhs].size(); });
+
+                seenTracks[track] = track;
+                candidates.clear();
+                for (const Index cluster : trackClusters)
+                {
+                    const std::span<const Index> clusterTracks{ model.clusterTracks[cluster] };
+
+                    // start at a track dependent position not to always pick the same candidates in large clusters
+                    const std::size_t start{ std::hash<TrackId>{}(model.tracks.getId(track)) % clusterTracks.size() };
+                    for (std::size_t i{}; i < clusterTracks.size() && candidates.size() < maxTrackCandidateCount; ++i)
+                    {
+                        const Index candidate{ clusterTracks[(start + i) % clusterTracks.size()] };
+                        if (seenTracks[candidate] == track)
+                            continue;
+
+                        seenTracks[candidate] = track;
+                        candidates.push_back(candidate);
+                    }
+
+                    if (candidates.size() >= maxTrackCandidateCount)
+                        break;
+                }
+
+                for (const Index candidate : candidates)
+                    scores.add(candidate, computeIntersectionSize(clusters, model.trackClusters[candidate]));
+
+                trackWriter.update(model.tracks.getId(track), scores.extractBest(_similarityCount, model.tracks));
+
+                context.currentStepStats.processedElems++;
+                _progressCallback(context.currentStepStats);
+            }
+            trackWriter.finish();
+        }
+
+        LMS_LOG(DBUPDATER, DEBUG, "Updated similarities of " << releaseWriter.getUpdateCount() << " releases, " << artistWriter.getUpdateCount() << " artist link types and " << trackWriter.getUpdateCount() << " tracks");
+    }
+}
@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "ScanStepBase.hpp"
+
+namespace Scanner
+{
+    // Precomputes the cluster based similar releases, artists and tracks, used by the clusters recommendation engine
+    class ScanStepComputeSimilarities : public ScanStepBase
+    {
+    public:
+        ScanStepComputeSimilarities(InitParams& initParams);
+
+    private:
+        ScanStep getStep() const override { return ScanStep::ComputeSimilarities; }
+        std::string_view getStepName() const override { return "Compute similarities"; }
+        void process(ScanContext& context) override;
+
+        const std::size_t _similarityCount;
+    };
+}
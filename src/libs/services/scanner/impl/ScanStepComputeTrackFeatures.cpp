@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ScanStepComputeTrackFeatures.hpp"
+
+#include <optional>
+#include <string>
+#include <thread>
+
+#include "av/AudioDecoding.hpp"
+#include "av/Types.hpp"
+#include "database/Db.hpp"
+#include "database/Session.hpp"
+#include "database/Track.hpp"
+#include "database/TrackFeatures.hpp"
+#include "services/recommendation/IAudioFeaturesAnalyzer.hpp"
+#include "utils/IConfig.hpp"
+#include "utils/ILogger.hpp"
+#include "utils/Service.hpp"
+#include "ParallelTrackProcessing.hpp"
+
+namespace Scanner
+{
+    namespace
+    {
+        // features are quite large, keep the write transactions short
+        constexpr std::size_t batchSize{ 10 };
+
+        struct AnalyzedTrack
+        {
+            Database::TrackId trackId;
+            std::optional<std::string> jsonEncodedFeatures; // none on failure
+        };
+
+        std::size_t getThreadCount()
+        {
+            std::size_t threadCount{ Service<IConfig>::get()->getULong("scanner-track-features-thread-count", 0) };
+            if (threadCount == 0)
+                threadCount = std::max<std::size_t>(std::thread::hardware_concurrency() / 2, 1);
+
+            return threadCount;
+        }
+
+        std::optional<std::string> computeTrackFeatures(const std::filesystem::path& path)
+        {
+            using namespace Recommendation;
+
+            std::unique_ptr<IAudioFeaturesAnalyzer> analyzer{ createAudioFeaturesAnalyzer() };
+
+            const Av::DecodingParameters parameters{ IAudioFeaturesAnalyzer::sampleRate, 1 };
+            Av::decodeAudioFile(path, parameters, [&](std::span<const float> samples)
+                {
+                    analyzer->process(samples);
+                });
+
+            return analyzer->getJsonEncodedFeatures();
+        }
+    }
+
+    ScanStepComputeTrackFeatures::ScanStepComputeTrackFeatures(InitParams& initParams)
+        : ScanStepBase{ initParams }
+        , _enabled{ Service<IConfig>::get()->getBool("scanner-compute-track-features", false) }
+        , _threadCount{ getThreadCount() }
+    {
+    }
+
+    void ScanStepComputeTrackFeatures::process(ScanContext& context)
+    {
+        using namespace Database;
+
+        if (!_enabled)
+            return;
+
+        // Tracks that could not be analyzed are tried again by the next scan
+        RangeResults<Track::PathResult> paths;
+        {
+            Session& session{ _db.getTLSSession() };
+            auto transaction{ session.createReadTransaction() };
+
+            paths = Track::findPathsWithoutFeatures(session);
+        }
+
+        context.currentStepStats.totalElems = paths.results.size();
+        if (paths.results.empty())
+            return;
+
+        LMS_LOG(DBUPDATER, DEBUG, "Computing features of " << paths.results.size() << " tracks using " << _threadCount << " thread(s)");
+
+        processTracksInParallel<AnalyzedTrack>(paths.results, _threadCount, batchSize, _abortScan,
+            [](const Track::PathResult& path)
+            {
+                AnalyzedTrack analyzedTrack{ path.trackId, std::nullopt };
+                try
+                {
+                    analyzedTrack.jsonEncodedFeatures = computeTrackFeatures(path.path);
+                    if (!analyzedTrack.jsonEncodedFeatures)
+                        LMS_LOG(DBUPDATER, DEBUG, "Cannot compute features of file '" << path.path.string() << "': not enough audio samples");
+                }
+                catch (const Av::Exception& e)
+                {
+                    LMS_LOG(DBUPDATER, DEBUG, "Cannot compute features of file '" << path.path.string() << "': " << e.what());
+                }
+                return analyzedTrack;
+            },
+            [&](std::span<const AnalyzedTrack> analyzedTracks)
+            {
+                {
+                    Session& session{ _db.getTLSSession() };
+                    auto transaction{ session.createWriteTransaction() };
+
+                    for (const AnalyzedTrack& analyzedTrack : analyzedTracks)
+                    {
+                        if (!analyzedTrack.jsonEncodedFeatures)
+                            continue;
+
+                        Track::pointer track{ Track::find(session, analyzedTrack.trackId) };
+                        if (!track || TrackFeatures::find(session, analyzedTrack.trackId))
+                            continue;
+
+                        session.create<TrackFeatures>(track, *analyzedTrack.jsonEncodedFeatures);
+                        context.stats.featuresFetched++;
+                    }
+                }
+
+                context.currentStepStats.processedElems += analyzedTracks.size();
+                _progressCallback(context.currentStepStats);
+            });
+
+        LMS_LOG(DBUPDATER, DEBUG, "Computed features of " << context.stats.featuresFetched << " tracks");
+    }
+}
@@ -19,38 +19,327 @@
 
 #include "ScanStepDiscoverFiles.hpp"
 
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+#include <thread>
+
+#include "database/Db.hpp"
+#include "database/ImageFile.hpp"
+#include "database/Session.hpp"
+#include "database/Track.hpp"
+#include "services/cover/ICoverService.hpp"
+#include "utils/Exception.hpp"
+#include "utils/IConfig.hpp"
 #include "utils/ILogger.hpp"
 #include "utils/Path.hpp"
 
 namespace Scanner
 {
+    using namespace Database;
+
+    namespace
+    {
+        std::size_t getExploreThreadCount()
+        {
+            std::size_t threadCount{ Service<IConfig>::get()->getULong("scanner-explore-thread-count", 1) };
+
+            if (threadCount == 0)
+                threadCount = std::max<std::size_t>(std::thread::hardware_concurrency() / 2, 1);
+
+            return threadCount;
+        }
+    }
+
+    std::vector<std::filesystem::path> ScanStepDiscoverFiles::getDirectoriesToExplore(const ScanContext& context, const ScannerSettings::MediaLibraryInfo& mediaLibrary)
+    {
+        if (context.directories.empty())
+            return { mediaLibrary.rootDirectory };
+
+        std::vector<std::filesystem::path> res;
+        for (const std::filesystem::path& directory : context.directories)
+        {
+            // removed directories are handled by the orphan removal step
+            std::error_code ec;
+            if (!std::filesystem::is_directory(directory, ec))
+                continue;
+
+            if (PathUtils::isPathInRootPath(directory, mediaLibrary.rootDirectory, &excludeDirFileName))
+                res.push_back(directory);
+        }
+
+        return res;
+    }
+
+    ScanStepDiscoverFiles::ScanStepDiscoverFiles(InitParams& initParams)
+        : ScanStepBase{ initParams }
+        , _directoryCheckPeriod{ std::chrono::hours{ 24 } * Service<IConfig>::get()->getULong("scanner-directory-check-period", 7) }
+    {
+    }
+
     void ScanStepDiscoverFiles::process(ScanContext& context)
     {
         context.stats.filesScanned = 0;
+        context.discoveredFiles.clear();
+        context.discoveryComplete = false;
+        context.directorySignatures.clear();
+
+        // Signatures only make sense if all the directories are explored
+        const bool useDirectorySignatures{ context.directories.empty() };
+        const bool skipUnchangedDirectories{ useDirectorySignatures && !context.forceScan && _directoryCheckPeriod.count() > 0 };
+        if (useDirectorySignatures)
+            loadDirectorySignatures(skipUnchangedDirectories);
 
+        const std::size_t exploreThreadCount{ getExploreThreadCount() };
+
+        // Files are only listed here, their last write time is retrieved once we know whether their directory has changed
+        std::vector<DiscoveredFile> files;
+        std::vector<std::filesystem::path> imageFilePaths;
+        std::vector<std::filesystem::path> exploredDirectories;
+        std::vector<ScanError> readErrors;
         for (const ScannerSettings::MediaLibraryInfo& mediaLibrary : _settings.mediaLibraries)
         {
-            std::size_t currentDirectoryProcessElemsCount{};
-            PathUtils::exploreFilesRecursive(mediaLibrary.rootDirectory, [&](std::error_code ec, const std::filesystem::path& path)
+            for (const std::filesystem::path& directory : getDirectoriesToExplore(context, mediaLibrary))
+            {
+                exploredDirectories.push_back(directory);
+
+                std::size_t currentDirectoryProcessElemsCount{};
+                PathUtils::exploreFilesRecursiveParallel(directory, [&](std::error_code ec, const std::filesystem::path& path)
+                    {
+                        if (_abortScan)
+                            return false;
+
+                        if (ec)
+                        {
+                            LMS_LOG(DBUPDATER, ERROR, "Cannot process entry '" << path.string() << "': " << ec.message());
+                            readErrors.emplace_back(ScanError{ path, ScanErrorType::CannotReadFile, ec.message() });
+                        }
+                        else if (PathUtils::hasFileAnyExtension(path, _settings.supportedExtensions))
+                        {
+                            files.push_back(DiscoveredFile{ path, {}, mediaLibrary.id });
+                            context.currentStepStats.processedElems++;
+                            currentDirectoryProcessElemsCount++;
+                            _progressCallback(context.currentStepStats);
+                        }
+                        else if (PathUtils::hasFileAnyExtension(path, Cover::getSupportedImageFileExtensions()))
+                        {
+                            imageFilePaths.push_back(path);
+                        }
+
+                        return true;
+                    }, &excludeDirFileName, exploreThreadCount);
+
+                LMS_LOG(DBUPDATER, DEBUG, "Discovered " << currentDirectoryProcessElemsCount << " files in '" << directory << "'");
+            }
+        }
+
+        if (!readErrors.empty())
+        {
+            Session& session{ _db.getTLSSession() };
+            auto transaction{ session.createWriteTransaction() };
+
+            for (ScanError& error : readErrors)
+                addError(session, context.stats, std::move(error));
+        }
+
+        if (!_abortScan)
+            saveImageFiles(context, exploredDirectories, imageFilePaths);
+
+        // Sorting keeps the files of a same directory together (sub directories aside), and allows lookups by path
+        std::sort(std::begin(files), std::end(files), [](const DiscoveredFile& lhs, const DiscoveredFile& rhs) { return lhs.path < rhs.path; });
+
+        // Group the files by directory
+        std::map<std::filesystem::path, std::vector<std::size_t>> filesByDirectory;
+        for (std::size_t i{}; i < files.size(); ++i)
+            filesByDirectory[files[i].path.parent_path()].push_back(i);
+
+        const Wt::WDateTime now{ Wt::WDateTime::currentDateTime() };
+        // without any previous signature, all the directories would be considered as changed
+        const bool detectChangedDirectories{ !_directorySignatures.empty() };
+        std::size_t skippedDirectoryCount{};
+        std::size_t changedDirectoryCount{};
+        for (const auto& [directory, fileIndexes] : filesByDirectory)
+        {
+            if (_abortScan)
+                break;
+
+            DirectorySignature::Entry signature{ directory, getDirectoryLastWriteTime(directory), fileIndexes.size(), now };
+
+            // The directory last write time is not updated when a file is modified in place: check each file from time to time anyway
+            bool unchangedDirectory{};
+            bool changedDirectory{ detectChangedDirectories };
+            if (auto itSignature{ _directorySignatures.find(directory.string()) }; itSignature != std::cend(_directorySignatures))
+            {
+                const DirectorySignature::Entry& previousSignature{ itSignature->second };
+                changedDirectory = signature.lastWriteTime == 0
+                    || previousSignature.lastWriteTime != signature.lastWriteTime
+                    || previousSignature.fileCount != signature.fileCount;
+
+                if (skipUnchangedDirectories
+                    && !changedDirectory
+                    && previousSignature.checkTime.isValid()
+                    && previousSignature.checkTime.addSecs(static_cast<int>(std::chrono::seconds{ _directoryCheckPeriod }.count())) > now)
                 {
-                    if (_abortScan)
-                        return false;
+                    unchangedDirectory = true;
+                    signature.checkTime = previousSignature.checkTime;
+                    skippedDirectoryCount++;
+                }
+            }
+            if (changedDirectory)
+                changedDirectoryCount++;
 
-                    if (!ec && PathUtils::hasFileAnyExtension(path, _settings.supportedExtensions))
+            for (const std::size_t fileIndex : fileIndexes)
+            {
+                DiscoveredFile& file{ files[fileIndex] };
+                file.inChangedDirectory = changedDirectory;
+
+                if (unchangedDirectory)
+                {
+                    if (auto itLastWriteTime{ _knownFileLastWriteTimes.find(file.path.string()) }; itLastWriteTime != std::cend(_knownFileLastWriteTimes))
                     {
-                        context.currentStepStats.processedElems++;
-                        currentDirectoryProcessElemsCount++;
-                        _progressCallback(context.currentStepStats);
+                        file.lastWriteTime = itLastWriteTime->second;
+                        continue;
                     }
+                }
 
-                    return true;
-                }, &excludeDirFileName);
+                try
+                {
+                    file.lastWriteTime = PathUtils::getLastWriteTime(file.path);
+                }
+                catch (LmsException& e)
+                {
+                    LMS_LOG(DBUPDATER, ERROR, e.what());
+                    context.stats.skips++;
+                    context.currentStepStats.processedElems--;
+                }
+            }
 
-            LMS_LOG(DBUPDATER, DEBUG, "Discovered " << currentDirectoryProcessElemsCount << " files in '" << mediaLibrary.rootDirectory << "'");
+            if (useDirectorySignatures)
+                context.directorySignatures.push_back(std::move(signature));
         }
 
+        std::erase_if(files, [](const DiscoveredFile& file) { return !file.lastWriteTime.isValid(); });
+        context.discoveredFiles = std::move(files);
+
+        _directorySignatures.clear();
+        _knownFileLastWriteTimes.clear();
+
+        context.discoveryComplete = !_abortScan;
         context.stats.filesScanned = context.currentStepStats.processedElems;
 
-        LMS_LOG(DBUPDATER, DEBUG, "Discovered " << context.stats.filesScanned << " files in all directories");
+        LMS_LOG(DBUPDATER, DEBUG, "Discovered " << context.stats.filesScanned << " files in all directories (" << skippedDirectoryCount << " unchanged directories, " << changedDirectoryCount << " changed directories)");
+    }
+
+    void ScanStepDiscoverFiles::loadDirectorySignatures(bool loadKnownFileLastWriteTimes)
+    {
+        Database::Session& dbSession{ _db.getTLSSession() };
+        auto transaction{ dbSession.createReadTransaction() };
+
+        DirectorySignature::visitAll(dbSession, [&](const DirectorySignature::Entry& entry)
+            {
+                _directorySignatures.emplace(entry.path.string(), entry);
+            });
+
+        // Needed only if some directories may be unchanged
+        if (_directorySignatures.empty() || !loadKnownFileLastWriteTimes)
+            return;
+
+        Track::findFileScanInfos(dbSession, [&](const Track::FileScanInfo& fileScanInfo)
+            {
+                _knownFileLastWriteTimes.emplace(fileScanInfo.path.string(), fileScanInfo.lastWriteTime);
+            });
+
+        LMS_LOG(DBUPDATER, DEBUG, "Loaded " << _directorySignatures.size() << " directory signatures");
+    }
+
+    void ScanStepDiscoverFiles::saveImageFiles(ScanContext& context, const std::vector<std::filesystem::path>& exploredDirectories, const std::vector<std::filesystem::path>& imageFilePaths)
+    {
+        std::vector<ImageFile::Entry> imageFiles;
+        imageFiles.reserve(imageFilePaths.size());
+        for (const std::filesystem::path& path : imageFilePaths)
+        {
+            std::error_code ec;
+            const std::uintmax_t fileSize{ std::filesystem::file_size(path, ec) };
+            if (ec)
+                continue;
+            const std::filesystem::file_time_type lastWriteTime{ std::filesystem::last_write_time(path, ec) };
+            if (ec)
+                continue;
+
+            imageFiles.push_back(ImageFile::Entry{ path, static_cast<std::size_t>(fileSize), lastWriteTime.time_since_epoch().count() });
+        }
+
+        // Only the explored directories are replaced in case of partial scans
+        const bool replaceAll{ context.directories.empty() };
+
+        Database::Session& dbSession{ _db.getTLSSession() };
+
+        // Changed image files may be the covers of unchanged tracks
+        {
+            std::unordered_map<std::string, ImageFile::Entry> previousImageFiles;
+            auto addPreviousImageFile{ [&](const ImageFile::Entry& entry) { previousImageFiles.emplace(entry.path.string(), entry); } };
+
+            auto transaction{ dbSession.createReadTransaction() };
+
+            if (replaceAll)
+                ImageFile::visitAll(dbSession, addPreviousImageFile);
+            else
+            {
+                for (const std::filesystem::path& directory : exploredDirectories)
+                    ImageFile::visitAllInDirectory(dbSession, directory, addPreviousImageFile);
+            }
+
+            auto onImageFileChanged{ [&](const std::filesystem::path& path)
+                {
+                    context.stats.imageFileChanges++;
+                    context.changedDirectories.insert(path.parent_path());
+                } };
+
+            for (const ImageFile::Entry& imageFile : imageFiles)
+            {
+                auto itPrevious{ previousImageFiles.find(imageFile.path.string()) };
+                if (itPrevious == std::cend(previousImageFiles))
+                {
+                    onImageFileChanged(imageFile.path);
+                    continue;
+                }
+
+                if (itPrevious->second != imageFile)
+                    onImageFileChanged(imageFile.path);
+                previousImageFiles.erase(itPrevious);
+            }
+
+            for (const auto& [path, previousImageFile] : previousImageFiles)
+                onImageFileChanged(previousImageFile.path);
+        }
+
+        {
+            auto transaction{ dbSession.createWriteTransaction() };
+
+            if (replaceAll)
+                ImageFile::setAll(dbSession, imageFiles);
+            else
+            {
+                for (const std::filesystem::path& directory : exploredDirectories)
+                {
+                    std::vector<ImageFile::Entry> directoryImageFiles;
+                    std::copy_if(std::cbegin(imageFiles), std::cend(imageFiles), std::back_inserter(directoryImageFiles), [&](const ImageFile::Entry& imageFile) { return PathUtils::isPathInRootPath(imageFile.path, directory); });
+
+                    ImageFile::setAllInDirectory(dbSession, directory, directoryImageFiles);
+                }
+            }
+        }
+
+        LMS_LOG(DBUPDATER, DEBUG, "Indexed " << imageFiles.size() << " image files, " << context.stats.imageFileChanges << " changes");
+    }
+
+    long long ScanStepDiscoverFiles::getDirectoryLastWriteTime(const std::filesystem::path& directory)
+    {
+        std::error_code ec;
+        const std::filesystem::file_time_type lastWriteTime{ std::filesystem::last_write_time(directory, ec) };
+        if (ec)
+            return 0;
+
+        return lastWriteTime.time_since_epoch().count();
     }
 }
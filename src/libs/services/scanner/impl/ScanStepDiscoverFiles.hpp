@@ -19,6 +19,15 @@
 
 #pragma once
 
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <Wt/WDateTime.h>
+
+#include "database/DirectorySignature.hpp"
 #include "ScanStepBase.hpp"
 
 namespace Scanner
@@ -26,11 +35,25 @@ namespace Scanner
 	class ScanStepDiscoverFiles : public ScanStepBase
 	{
 		public:
-			using ScanStepBase::ScanStepBase;
+			ScanStepDiscoverFiles(InitParams& initParams);
 
 		private:
 			ScanStep getStep() const override { return ScanStep::DiscoveringFiles; }
 			std::string_view getStepName() const override { return "DiscoveringFiles"; }
 			void process(ScanContext& context) override;
+
+			std::vector<std::filesystem::path> getDirectoriesToExplore(const ScanContext& context, const ScannerSettings::MediaLibraryInfo& mediaLibrary);
+
+			// Files in directories whose signature has not changed since the last scan are not checked one by one
+			// The changed directories are also scanned first, so that new content quickly shows up
+			void loadDirectorySignatures(bool loadKnownFileLastWriteTimes);
+			static long long getDirectoryLastWriteTime(const std::filesystem::path& directory); // 0 on error
+
+			// Image files are indexed so that the cover service does not have to look for them
+			void saveImageFiles(ScanContext& context, const std::vector<std::filesystem::path>& exploredDirectories, const std::vector<std::filesystem::path>& imageFilePaths);
+
+			const std::chrono::hours _directoryCheckPeriod;
+			std::unordered_map<std::string, Database::DirectorySignature::Entry> _directorySignatures;	// by path
+			std::unordered_map<std::string, Wt::WDateTime> _knownFileLastWriteTimes;					// by path, as stored in the database
 	};
 }
@@ -0,0 +1,290 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ScanStepFetchTrackFeatures.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/asio/io_context.hpp>
+#include <Wt/Json/Object.h>
+#include <Wt/Json/Parser.h>
+#include <Wt/Json/Serializer.h>
+#include <Wt/WException.h>
+
+#include "database/Db.hpp"
+#include "database/Session.hpp"
+#include "database/Track.hpp"
+#include "database/TrackFeatures.hpp"
+#include "utils/IConfig.hpp"
+#include "utils/ILogger.hpp"
+#include "utils/IOContextRunner.hpp"
+#include "utils/Service.hpp"
+#include "utils/http/IClient.hpp"
+
+namespace Scanner
+{
+    namespace
+    {
+        // max number of recordings the bulk endpoint accepts per request
+        constexpr std::size_t maxRecordingCountPerRequest{ 25 };
+        // bulk responses contain whole low level documents
+        constexpr std::size_t maxResponseBodySize{ 16 * 1024 * 1024 };
+        constexpr std::size_t writeBatchSize{ 100 };
+
+        struct FetchedFeatures
+        {
+            std::string recordingMBID;
+            std::string jsonEncodedFeatures;
+        };
+
+        // Only the low level part of the first submission of each recording is kept
+        std::vector<FetchedFeatures> parseBulkLowLevelResponse(std::string_view msgBody)
+        {
+            std::vector<FetchedFeatures> res;
+
+            try
+            {
+                Wt::Json::Object root;
+                Wt::Json::parse(std::string{ msgBody }, root);
+
+                for (auto& [recordingMBID, submissions] : root)
+                {
+                    if (submissions.type() != Wt::Json::Type::Object)
+                        continue; // mbid_mapping is an object too, but has no "0" entry
+
+                    Wt::Json::Object& submissionsObj{ submissions };
+                    auto itFirstSubmission{ submissionsObj.find("0") };
+                    if (itFirstSubmission == std::end(submissionsObj) || itFirstSubmission->second.type() != Wt::Json::Type::Object)
+                        continue;
+
+                    Wt::Json::Object& firstSubmission{ itFirstSubmission->second };
+                    auto itLowLevel{ firstSubmission.find("lowlevel") };
+                    if (itLowLevel == std::end(firstSubmission))
+                        continue;
+
+                    Wt::Json::Object features;
+                    features["lowlevel"] = std::move(itLowLevel->second);
+                    res.push_back(FetchedFeatures{ recordingMBID, Wt::Json::serialize(features, 0) });
+                }
+            }
+            catch (const Wt::WException& e)
+            {
+                LMS_LOG(DBUPDATER, ERROR, "Cannot parse AcousticBrainz response: " << e.what());
+                res.clear();
+            }
+
+            return res;
+        }
+
+        std::string createBulkLowLevelRelativeUrl(std::span<const std::string> recordingMBIDs)
+        {
+            std::string url{ "/api/v1/low-level?recording_ids=" };
+            for (std::size_t i{}; i < recordingMBIDs.size(); ++i)
+            {
+                if (i > 0)
+                    url += ';';
+                url += recordingMBIDs[i];
+            }
+
+            return url;
+        }
+
+        // The client sends up to maxConcurrentRequestCount requests at a time (and handles the rate limiting headers of the server)
+        // as soon as a request completes, the next pending one is sent
+        class BulkFetcher
+        {
+        public:
+            BulkFetcher(const std::string& baseAPIUrl, std::size_t maxConcurrentRequestCount, std::deque<std::vector<std::string>> pendingRequests)
+                : _maxConcurrentRequestCount{ maxConcurrentRequestCount }
+                , _client{ Http::createClient(_ioContext, baseAPIUrl, Http::ClientParameters{ maxConcurrentRequestCount }) }
+                , _pendingRequests{ std::move(pendingRequests) }
+            {
+            }
+
+            // Blocks until all the requests are done or abort is set, results are handed in batches from the calling thread
+            // along with the number of recordings processed so far (found or not)
+            void run(const bool& abort, std::function<void(std::span<const FetchedFeatures>, std::size_t processedRecordingCount)> saveFunc)
+            {
+                IOContextRunner ioContextRunner{ _ioContext, _maxConcurrentRequestCount };
+                for (std::size_t i{}; i < _maxConcurrentRequestCount; ++i)
+                    sendNextRequest();
+
+                std::vector<FetchedFeatures> resultsToSave;
+                std::size_t processedRecordingCount{};
+                bool done{};
+                while (!done)
+                {
+                    {
+                        std::unique_lock lock{ _mutex };
+                        _cv.wait_for(lock, std::chrono::seconds{ 1 }, [&] { return _results.size() >= writeBatchSize || (_pendingRequests.empty() && _ongoingRequestCount == 0); });
+
+                        if (abort)
+                            _pendingRequests.clear();
+
+                        resultsToSave.swap(_results);
+                        processedRecordingCount = _processedRecordingCount;
+                        // do not wait for ongoing requests on abort, they may be throttled for a long time
+                        done = (_pendingRequests.empty() && _ongoingRequestCount == 0) || abort;
+                    }
+
+                    saveFunc(resultsToSave, processedRecordingCount);
+                    resultsToSave.clear();
+                }
+                // ioContextRunner stops the IO context before returning: ongoing requests are dropped
+            }
+
+        private:
+            void sendNextRequest()
+            {
+                Http::ClientGETRequestParameters request;
+                std::size_t recordingCount{};
+                {
+                    const std::scoped_lock lock{ _mutex };
+                    if (_pendingRequests.empty())
+                        return;
+
+                    request.relativeUrl = createBulkLowLevelRelativeUrl(_pendingRequests.front());
+                    recordingCount = _pendingRequests.front().size();
+                    _pendingRequests.pop_front();
+                    _ongoingRequestCount++;
+                }
+
+                request.maxResponseBodySize = maxResponseBodySize;
+                request.onSuccessFunc = [this, recordingCount](std::string_view msgBody)
+                    {
+                        onRequestDone(recordingCount, parseBulkLowLevelResponse(msgBody));
+                        sendNextRequest();
+                    };
+                request.onFailureFunc = [this, recordingCount]
+                    {
+                        onRequestDone(recordingCount, {});
+                        sendNextRequest();
+                    };
+
+                _client->sendGETRequest(std::move(request));
+            }
+
+            void onRequestDone(std::size_t recordingCount, std::vector<FetchedFeatures> fetchedFeatures)
+            {
+                {
+                    const std::scoped_lock lock{ _mutex };
+                    _processedRecordingCount += recordingCount;
+                    _results.insert(std::end(_results), std::make_move_iterator(std::begin(fetchedFeatures)), std::make_move_iterator(std::end(fetchedFeatures)));
+                    _ongoingRequestCount--;
+                }
+                _cv.notify_one();
+            }
+
+            const std::size_t _maxConcurrentRequestCount;
+            boost::asio::io_context _ioContext;
+            std::unique_ptr<Http::IClient> _client;
+
+            std::mutex _mutex;
+            std::condition_variable _cv;
+            std::deque<std::vector<std::string>> _pendingRequests; // protected by _mutex
+            std::size_t _ongoingRequestCount{}; // protected by _mutex
+            std::size_t _processedRecordingCount{}; // protected by _mutex
+            std::vector<FetchedFeatures> _results; // protected by _mutex
+        };
+    }
+
+    ScanStepFetchTrackFeatures::ScanStepFetchTrackFeatures(InitParams& initParams)
+        : ScanStepBase{ initParams }
+        , _baseAPIUrl{ Service<IConfig>::get()->getString("acousticbrainz-api-base-url", "") }
+        , _maxConcurrentRequestCount{ std::max<std::size_t>(Service<IConfig>::get()->getULong("acousticbrainz-max-concurrent-requests", 4), 1) }
+    {
+    }
+
+    void ScanStepFetchTrackFeatures::process(ScanContext& context)
+    {
+        using namespace Database;
+
+        if (_baseAPIUrl.empty())
+            return;
+
+        // tracks sharing the same recording get the same features
+        std::unordered_map<std::string, std::vector<TrackId>> trackIdsByRecordingMBID;
+        {
+            Session& session{ _db.getTLSSession() };
+            auto transaction{ session.createReadTransaction() };
+
+            for (const Track::MBIDResult& result : Track::findRecordingMBIDsWithMissingFeatures(session).results)
+                trackIdsByRecordingMBID[std::string{ result.mbid.getAsString() }].push_back(result.trackId);
+        }
+
+        if (trackIdsByRecordingMBID.empty())
+            return;
+
+        std::deque<std::vector<std::string>> requests;
+        for (const auto& [recordingMBID, trackIds] : trackIdsByRecordingMBID)
+        {
+            if (requests.empty() || requests.back().size() == maxRecordingCountPerRequest)
+                requests.emplace_back().reserve(maxRecordingCountPerRequest);
+
+            requests.back().push_back(recordingMBID);
+        }
+
+        context.currentStepStats.totalElems = trackIdsByRecordingMBID.size();
+        LMS_LOG(DBUPDATER, DEBUG, "Fetching features of " << trackIdsByRecordingMBID.size() << " recordings using " << requests.size() << " requests, " << _maxConcurrentRequestCount << " at a time");
+
+        BulkFetcher fetcher{ _baseAPIUrl, _maxConcurrentRequestCount, std::move(requests) };
+        fetcher.run(_abortScan, [&](std::span<const FetchedFeatures> fetchedFeatures, std::size_t processedRecordingCount)
+            {
+                if (!fetchedFeatures.empty())
+                {
+                    Session& session{ _db.getTLSSession() };
+                    auto transaction{ session.createWriteTransaction() };
+
+                    for (const FetchedFeatures& features : fetchedFeatures)
+                    {
+                        auto itTrackIds{ trackIdsByRecordingMBID.find(features.recordingMBID) };
+                        if (itTrackIds == std::cend(trackIdsByRecordingMBID))
+                            continue;
+
+                        for (const TrackId trackId : itTrackIds->second)
+                        {
+                            Track::pointer track{ Track::find(session, trackId) };
+                            if (!track || TrackFeatures::find(session, trackId))
+                                continue;
+
+                            session.create<TrackFeatures>(track, features.jsonEncodedFeatures);
+                            context.stats.featuresFetched++;
+                        }
+                    }
+                }
+
+                if (processedRecordingCount != context.currentStepStats.processedElems)
+                {
+                    context.currentStepStats.processedElems = processedRecordingCount;
+                    _progressCallback(context.currentStepStats);
+                }
+            });
+
+        LMS_LOG(DBUPDATER, DEBUG, "Fetched features for " << context.stats.featuresFetched << " tracks");
+    }
+}
@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "ScanStepBase.hpp"
+
+namespace Scanner
+{
+    // Fetches the low level audio features of the tracks that have a recording MBID and no features yet, from an AcousticBrainz server
+    class ScanStepFetchTrackFeatures : public ScanStepBase
+    {
+    public:
+        ScanStepFetchTrackFeatures(InitParams& initParams);
+
+    private:
+        ScanStep getStep() const override { return ScanStep::FetchingTrackFeatures; }
+        std::string_view getStepName() const override { return "Fetching track features"; }
+        void process(ScanContext& context) override;
+
+        const std::string _baseAPIUrl; // empty to disable
+        const std::size_t _maxConcurrentRequestCount;
+    };
+}
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ScanStepGenerateCovers.hpp"
+
+#include "database/Db.hpp"
+#include "database/Release.hpp"
+#include "database/Session.hpp"
+#include "services/cover/ICoverService.hpp"
+#include "utils/IConfig.hpp"
+#include "utils/ILogger.hpp"
+#include "utils/Service.hpp"
+#include "utils/String.hpp"
+
+namespace Scanner
+{
+    namespace
+    {
+        std::vector<Image::ImageSize> readCoverSizes()
+        {
+            std::vector<Image::ImageSize> res;
+
+            // sizes used by the web interface by default
+            Service<IConfig>::get()->visitStrings("cover-pregenerated-sizes",
+                [&res](std::string_view str)
+                {
+                    if (const auto size{ StringUtils::readAs<Image::ImageSize>(str) })
+                        res.push_back(*size);
+                    else
+                        LMS_LOG(DBUPDATER, ERROR, "Invalid cover size '" << str << "'");
+                }, { "128", "512" });
+
+            return res;
+        }
+    }
+
+    ScanStepGenerateCovers::ScanStepGenerateCovers(InitParams& initParams)
+        : ScanStepBase{ initParams }
+        , _coverSizes{ readCoverSizes() }
+    {
+    }
+
+    void ScanStepGenerateCovers::process(ScanContext& context)
+    {
+        using namespace Database;
+
+        if (context.stats.nbChanges() == 0 || _coverSizes.empty())
+            return;
+
+        Cover::ICoverService* coverService{ Service<Cover::ICoverService>::get() };
+        if (!coverService)
+            return;
+
+        RangeResults<ReleaseId> releaseIds;
+        {
+            Session& session{ _db.getTLSSession() };
+            auto transaction{ session.createReadTransaction() };
+
+            releaseIds = Release::findIds(session, Release::FindParameters{});
+        }
+
+        context.currentStepStats.totalElems = releaseIds.results.size();
+
+        // already generated covers are just looked up
+        for (const ReleaseId releaseId : releaseIds.results)
+        {
+            if (_abortScan)
+                break;
+
+            for (const Image::ImageSize size : _coverSizes)
+                coverService->getFromRelease(releaseId, size, Image::ImageFormat::JPEG);
+
+            context.currentStepStats.processedElems++;
+            _progressCallback(context.currentStepStats);
+        }
+
+        LMS_LOG(DBUPDATER, DEBUG, "Generated covers for " << context.currentStepStats.processedElems << " releases");
+    }
+}
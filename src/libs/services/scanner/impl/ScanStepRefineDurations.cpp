@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ScanStepRefineDurations.hpp"
+
+#include <optional>
+#include <vector>
+
+#include "database/Db.hpp"
+#include "database/Release.hpp"
+#include "database/Session.hpp"
+#include "database/Track.hpp"
+#include "database/TrackList.hpp"
+#include "metadata/Exception.hpp"
+#include "metadata/IParser.hpp"
+#include "utils/IConfig.hpp"
+#include "utils/ILogger.hpp"
+#include "utils/Service.hpp"
+
+namespace Scanner
+{
+    namespace
+    {
+        constexpr std::size_t batchSize{ 100 };
+
+        struct RefinedTrack
+        {
+            Database::TrackId trackId;
+            std::optional<MetaData::AudioProperties> audioProperties;
+        };
+    }
+
+    ScanStepRefineDurations::ScanStepRefineDurations(InitParams& initParams)
+        : ScanStepBase{ initParams }
+        , _enabled{ Service<IConfig>::get()->getBool("scanner-refine-estimated-durations", true) }
+    {
+    }
+
+    void ScanStepRefineDurations::process(ScanContext& context)
+    {
+        using namespace Database;
+
+        if (!_enabled)
+            return;
+
+        // Tracks left over by an aborted scan are refined by the next one
+        RangeResults<Track::PathResult> paths;
+        {
+            Session& session{ _db.getTLSSession() };
+            auto transaction{ session.createReadTransaction() };
+
+            paths = Track::findPathsWithEstimatedDuration(session);
+        }
+
+        context.currentStepStats.totalElems = paths.results.size();
+
+        std::vector<RefinedTrack> refinedTracks;
+        refinedTracks.reserve(batchSize);
+
+        auto saveRefinedTracks{ [&]
+            {
+                Session& session{ _db.getTLSSession() };
+                auto transaction{ session.createWriteTransaction() };
+
+                for (const RefinedTrack& refinedTrack : refinedTracks)
+                {
+                    Track::pointer track{ Track::find(session, refinedTrack.trackId) };
+                    if (!track)
+                        continue;
+
+                    // keep the estimation if the file cannot be walked through, but do not try again
+                    if (refinedTrack.audioProperties)
+                    {
+                        track.modify()->setDuration(refinedTrack.audioProperties->duration);
+                        track.modify()->setBitrate(refinedTrack.audioProperties->bitrate);
+                    }
+                    track.modify()->setDurationEstimated(false);
+                }
+
+                refinedTracks.clear();
+            } };
+
+        for (const Track::PathResult& path : paths.results)
+        {
+            if (_abortScan)
+                break;
+
+            RefinedTrack refinedTrack{ path.trackId, std::nullopt };
+            try
+            {
+                refinedTrack.audioProperties = MetaData::computeExactAudioProperties(path.path);
+            }
+            catch (const MetaData::Exception&)
+            {
+                LMS_LOG(DBUPDATER, DEBUG, "Cannot compute exact duration of file '" << path.path.string() << "'");
+            }
+            refinedTracks.push_back(std::move(refinedTrack));
+
+            if (refinedTracks.size() == batchSize)
+                saveRefinedTracks();
+
+            context.currentStepStats.processedElems++;
+            _progressCallback(context.currentStepStats);
+        }
+
+        if (!refinedTracks.empty())
+            saveRefinedTracks();
+
+        // Durations are aggregated by releases and tracklists
+        if (context.currentStepStats.processedElems > 0)
+        {
+            Session& session{ _db.getTLSSession() };
+            auto transaction{ session.createWriteTransaction() };
+
+            Release::updateAggregates(session);
+            TrackList::updateAggregates(session);
+        }
+
+        LMS_LOG(DBUPDATER, DEBUG, "Refined durations of " << context.currentStepStats.processedElems << " tracks");
+    }
+}
@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "ScanStepBase.hpp"
+
+namespace Scanner
+{
+    // Computes the exact duration of the tracks for which only an estimation could be read from the file headers
+    class ScanStepRefineDurations : public ScanStepBase
+    {
+    public:
+        ScanStepRefineDurations(InitParams& initParams);
+
+    private:
+        ScanStep getStep() const override { return ScanStep::RefiningDurations; }
+        std::string_view getStepName() const override { return "Refining durations"; }
+        void process(ScanContext& context) override;
+
+        const bool _enabled;
+    };
+}
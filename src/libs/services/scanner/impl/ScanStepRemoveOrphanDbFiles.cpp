@@ -19,9 +19,13 @@
 
 #include "ScanStepRemoveOrphanDbFiles.hpp"
 
+#include <algorithm>
+
 #include "database/Artist.hpp"
 #include "database/Cluster.hpp"
 #include "database/Db.hpp"
+#include "database/Directory.hpp"
+#include "database/Facet.hpp"
 #include "database/Release.hpp"
 #include "database/Session.hpp"
 #include "database/Track.hpp"
@@ -35,46 +39,30 @@ namespace Scanner
     namespace
     {
         constexpr std::size_t batchSize = 100;
+        constexpr std::size_t removeBatchSize = 1000; // track removals per write transaction
+
+        const std::filesystem::path& getPath(const IScanStep::DiscoveredFile& discoveredFile) { return discoveredFile.path; }
+        const std::filesystem::path& getPath(const std::filesystem::path& path) { return path; }
 
+        // Orphans are removed using a single set based statement
         template <typename T>
-        void removeOrphanEntries(Session& session, bool& abortScan)
+        std::size_t removeOrphanEntries(Session& session, bool abortScan)
         {
-            using IdType = typename T::IdType;
-
-            RangeResults<IdType> entries;
-            while (!abortScan)
-            {
-                {
-                    auto transaction{ session.createReadTransaction() };
-
-                    entries = T::findOrphanIds(session, Range{ 0, batchSize });
-                };
-
-                {
-                    auto transaction{ session.createWriteTransaction() };
+            if (abortScan)
+                return 0;
 
-                    for (const IdType objectId : entries.results)
-                    {
-                        if (abortScan)
-                            break;
-
-                        typename T::pointer entry{ T::find(session, objectId) };
-
-                        entry.remove();
-                    }
-                }
-
-                if (!entries.moreResults)
-                    break;
-            }
+            auto transaction{ session.createWriteTransaction() };
+            return T::removeOrphans(session);
         }
     }
 
     void ScanStepRemoveOrphanDbFiles::process(ScanContext& context)
     {
         removeOrphanTracks(context);
+        removeOrphanDirectories();
         removeOrphanClusters();
         removeOrphanClusterTypes();
+        removeOrphanFacets();
         removeOrphanArtists();
         removeOrphanReleases();
     }
@@ -86,6 +74,12 @@ namespace Scanner
         if (_abortScan)
             return;
 
+        if (!context.directories.empty())
+        {
+            removeOrphanTracksInDirectories(context);
+            return;
+        }
+
         Session& session{ _db.getTLSSession() };
 
         LMS_LOG(DBUPDATER, DEBUG, "Checking tracks to be removed...");
@@ -99,80 +93,149 @@ namespace Scanner
 
         context.currentStepStats.totalElems = trackCount;
 
-        RangeResults<Track::PathResult> trackPaths;
-        std::vector<TrackId> tracksToRemove;
+        // All the paths are loaded at once and diffed in memory against the discovered files
+        std::vector<Track::PathResult> trackPaths;
+        {
+            auto transaction{ session.createReadTransaction() };
+            trackPaths = std::move(Track::findPaths(session).results);
+        }
 
-        // TODO handle only files in context.directory
-        for (std::size_t i{ trackCount < batchSize ? 0 : trackCount - batchSize }; ; i -= (i > batchSize ? batchSize : i))
+        std::vector<TrackId> tracksToRemove;
+        for (const Track::PathResult& trackPath : trackPaths)
         {
-            tracksToRemove.clear();
+            if (_abortScan)
+                return;
 
+            if (!checkFile(context, trackPath.path))
             {
-                auto transaction{ session.createReadTransaction() };
-                trackPaths = Track::findPaths(session, Range{ i, batchSize });
+                tracksToRemove.push_back(trackPath.trackId);
+                context.changedDirectories.insert(trackPath.path.parent_path());
             }
 
-            for (const Track::PathResult& trackPath : trackPaths.results)
-            {
-                if (_abortScan)
-                    return;
+            context.currentStepStats.processedElems++;
+        }
 
-                if (!checkFile(trackPath.path))
-                    tracksToRemove.push_back(trackPath.trackId);
+        removeTracks(context, tracksToRemove);
+        _progressCallback(context.currentStepStats);
 
-                context.currentStepStats.processedElems++;
-            }
+        LMS_LOG(DBUPDATER, DEBUG,  trackCount << " tracks checked!");
+    }
 
-            if (!tracksToRemove.empty())
-            {
-                auto transaction{ session.createWriteTransaction() };
+    void ScanStepRemoveOrphanDbFiles::removeOrphanTracksInDirectories(ScanContext& context)
+    {
+        Session& session{ _db.getTLSSession() };
+
+        // Only tracks in the scanned directories can be checked against the discovered files
+        std::vector<Track::PathResult> trackPaths;
+        {
+            auto transaction{ session.createReadTransaction() };
 
-                for (const TrackId trackId : tracksToRemove)
+            for (const std::filesystem::path& directory : context.directories)
+            {
+                RangeResults<Track::PathResult> directoryTrackPaths;
+                Range range{ 0, batchSize };
+                do
                 {
-                    Track::pointer track{ Track::find(session, trackId) };
-                    if (track)
-                    {
-                        track.remove();
-                        context.stats.deletions++;
-                    }
-                }
+                    directoryTrackPaths = Track::findPathsInDirectory(session, directory, range);
+                    trackPaths.insert(std::end(trackPaths), std::make_move_iterator(std::begin(directoryTrackPaths.results)), std::make_move_iterator(std::end(directoryTrackPaths.results)));
+                    range.offset += batchSize;
+                } while (directoryTrackPaths.moreResults);
             }
+        }
 
-            _progressCallback(context.currentStepStats);
+        LMS_LOG(DBUPDATER, DEBUG, trackPaths.size() << " tracks to be checked in " << context.directories.size() << " directories...");
+        context.currentStepStats.totalElems = trackPaths.size();
 
-            if (i == 0)
-                break;
+        std::vector<TrackId> tracksToRemove;
+        for (const Track::PathResult& trackPath : trackPaths)
+        {
+            if (_abortScan)
+                return;
+
+            if (!checkFile(context, trackPath.path))
+            {
+                tracksToRemove.push_back(trackPath.trackId);
+                context.changedDirectories.insert(trackPath.path.parent_path());
+            }
+
+            context.currentStepStats.processedElems++;
         }
 
-        LMS_LOG(DBUPDATER, DEBUG,  trackCount << " tracks checked!");
+        removeTracks(context, tracksToRemove);
+        _progressCallback(context.currentStepStats);
+    }
+
+    void ScanStepRemoveOrphanDbFiles::removeTracks(ScanContext& context, std::span<const TrackId> trackIds)
+    {
+        Session& session{ _db.getTLSSession() };
+
+        // Keep write transactions short to not block other writers for too long
+        for (std::size_t offset{}; offset < trackIds.size() && !_abortScan; offset += removeBatchSize)
+        {
+            auto transaction{ session.createWriteTransaction() };
+            context.stats.deletions += Track::remove(session, trackIds.subspan(offset, std::min(removeBatchSize, trackIds.size() - offset)));
+        }
+    }
+
+    void ScanStepRemoveOrphanDbFiles::removeOrphanDirectories()
+    {
+        LMS_LOG(DBUPDATER, DEBUG, "Checking orphan directories...");
+        const std::size_t removedCount{ removeOrphanEntries<Database::Directory>(_db.getTLSSession(), _abortScan) };
+        LMS_LOG(DBUPDATER, DEBUG, "Removed " << removedCount << " orphan directories");
     }
 
     void ScanStepRemoveOrphanDbFiles::removeOrphanClusters()
     {
         LMS_LOG(DBUPDATER, DEBUG, "Checking orphan clusters...");
-        removeOrphanEntries<Database::Cluster>(_db.getTLSSession(), _abortScan);
+        const std::size_t removedCount{ removeOrphanEntries<Database::Cluster>(_db.getTLSSession(), _abortScan) };
+        LMS_LOG(DBUPDATER, DEBUG, "Removed " << removedCount << " orphan clusters");
     }
 
     void ScanStepRemoveOrphanDbFiles::removeOrphanClusterTypes()
     {
         LMS_LOG(DBUPDATER, DEBUG, "Checking orphan cluster types...");
-        removeOrphanEntries<Database::ClusterType>(_db.getTLSSession(), _abortScan);
+        const std::size_t removedCount{ removeOrphanEntries<Database::ClusterType>(_db.getTLSSession(), _abortScan) };
+        LMS_LOG(DBUPDATER, DEBUG, "Removed " << removedCount << " orphan cluster types");
+    }
+
+    void ScanStepRemoveOrphanDbFiles::removeOrphanFacets()
+    {
+        LMS_LOG(DBUPDATER, DEBUG, "Checking orphan genres, moods and languages...");
+        const std::size_t removedCount{ removeOrphanEntries<Database::Facet>(_db.getTLSSession(), _abortScan) };
+        LMS_LOG(DBUPDATER, DEBUG, "Removed " << removedCount << " orphan genres, moods and languages");
     }
 
     void ScanStepRemoveOrphanDbFiles::removeOrphanArtists()
     {
         LMS_LOG(DBUPDATER, DEBUG, "Checking orphan artists...");
-        removeOrphanEntries<Database::Artist>(_db.getTLSSession(), _abortScan);
+        const std::size_t removedCount{ removeOrphanEntries<Database::Artist>(_db.getTLSSession(), _abortScan) };
+        LMS_LOG(DBUPDATER, DEBUG, "Removed " << removedCount << " orphan artists");
     }
 
     void ScanStepRemoveOrphanDbFiles::removeOrphanReleases()
     {
         LMS_LOG(DBUPDATER, DEBUG, "Checking orphan releases...");
-        removeOrphanEntries<Database::Release>(_db.getTLSSession(), _abortScan);
+        const std::size_t removedCount{ removeOrphanEntries<Database::Release>(_db.getTLSSession(), _abortScan) };
+        LMS_LOG(DBUPDATER, DEBUG, "Removed " << removedCount << " orphan releases");
     }
 
-    bool ScanStepRemoveOrphanDbFiles::checkFile(const std::filesystem::path& p)
+    bool ScanStepRemoveOrphanDbFiles::checkFile(const ScanContext& context, const std::filesystem::path& p)
     {
+        // Discovered files already exist, belong to a media directory and have a supported extension
+        if (context.discoveryComplete)
+        {
+            const bool discovered{ std::binary_search(std::cbegin(context.discoveredFiles), std::cend(context.discoveredFiles), p,
+                [](const auto& lhs, const auto& rhs)
+                {
+                    return getPath(lhs) < getPath(rhs);
+                }) };
+
+            if (!discovered)
+                LMS_LOG(DBUPDATER, INFO, "Removing '" << p.string() << "': missing or out of media directory");
+
+            return discovered;
+        }
+
         try
         {
             // For each track, make sure the the file still exists
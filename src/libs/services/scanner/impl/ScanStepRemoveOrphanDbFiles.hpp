@@ -20,7 +20,9 @@
 #pragma once
 
 #include <filesystem>
+#include <span>
 
+#include "database/TrackId.hpp"
 #include "ScanStepBase.hpp"
 
 namespace Scanner
@@ -36,10 +38,14 @@ namespace Scanner
 			void process(ScanContext& context) override;
 
 			void removeOrphanTracks(ScanContext& context);
+			void removeOrphanTracksInDirectories(ScanContext& context);
+			void removeTracks(ScanContext& context, std::span<const Database::TrackId> trackIds);
+			void removeOrphanDirectories();
 			void removeOrphanClusters();
 			void removeOrphanClusterTypes();
+			void removeOrphanFacets();
 			void removeOrphanArtists();
 			void removeOrphanReleases();
-			bool checkFile(const std::filesystem::path& p);
+			bool checkFile(const ScanContext& context, const std::filesystem::path& p);
 	};
 }
@@ -19,9 +19,22 @@
 
 #include "ScanStepScanFiles.hpp"
 
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <set>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
 #include "database/Artist.hpp"
 #include "database/Cluster.hpp"
 #include "database/Db.hpp"
+#include "database/Facet.hpp"
 #include "database/MediaLibrary.hpp"
 #include "database/Release.hpp"
 #include "database/Session.hpp"
@@ -30,35 +43,234 @@
 #include "database/TrackArtistLink.hpp"
 #include "metadata/Exception.hpp"
 #include "metadata/IParser.hpp"
+#include "services/cover/ICoverService.hpp"
 #include "utils/Exception.hpp"
+#include "utils/IAsyncFileReader.hpp"
 #include "utils/IConfig.hpp"
 #include "utils/ILogger.hpp"
+#include "utils/IResourceGovernor.hpp"
 #include "utils/Path.hpp"
 
 namespace Scanner
 {
     using namespace Database;
 
+    struct ScanStepScanFiles::BatchLookups
+    {
+        std::unordered_map<MediaLibraryId, MediaLibrary::pointer>       mediaLibraries;
+        std::unordered_map<std::string, Track::pointer>                 tracksByPath;
+    };
+
+    // Entities resolved so far during the current scan
+    // A name or MBID key is only present once all its matching DB entries have been loaded
+    struct ScanStepScanFiles::ResolutionCache
+    {
+        std::map<UUID, Artist::pointer>                                 artistsByMBID;
+        std::unordered_map<std::string, std::vector<Artist::pointer>>   artistsByName; // MBID entries first
+        std::map<UUID, Release::pointer>                                releasesByMBID;
+        std::map<std::pair<std::string, std::filesystem::path>, Release::pointer> releasesByNameAndDirectory;
+        std::unordered_map<std::string, ReleaseType::pointer>           releaseTypesByName;
+        std::unordered_map<std::string, TrackArtistLinkSubType::pointer> linkSubTypesByName;
+        std::unordered_map<std::string, ClusterType::pointer>           clusterTypesByName;
+        std::map<std::pair<ClusterTypeId, std::string>, Cluster::pointer> clustersByTypeAndName;
+    };
+
     namespace
     {
-        Artist::pointer createArtist(Session& session, const MetaData::Artist& artistInfo)
+        using BatchLookups = ScanStepScanFiles::BatchLookups;
+        using ResolutionCache = ScanStepScanFiles::ResolutionCache;
+
+        // most tags and audio properties are at the start of the files
+        constexpr std::size_t metadataPrefetchSize{ 131'072 };
+
+        template <typename Func>
+        void visitArtists(const MetaData::Track& track, Func&& func)
+        {
+            auto visit{ [&](const std::vector<MetaData::Artist>& artists)
+            {
+                for (const MetaData::Artist& artist : artists)
+                    func(artist);
+            } };
+
+            visit(track.artists);
+            if (track.medium && track.medium->release)
+                visit(track.medium->release->artists);
+            visit(track.conductorArtists);
+            visit(track.composerArtists);
+            visit(track.lyricistArtists);
+            visit(track.mixerArtists);
+            for (const auto& [role, performers] : track.performerArtists)
+                visit(performers);
+            visit(track.producerArtists);
+            visit(track.remixerArtists);
+        }
+
+        template <typename Func>
+        void visitClusters(const MetaData::Track& track, Func&& func)
+        {
+            // Genres, moods and languages are also stored in dedicated tables (see setTrackFacets), their clusters are kept for the UI filters and the clusters similarity engine
+            func("GENRE", track.genres);
+            func("MOOD", track.moods);
+            func("LANGUAGE", track.languages);
+            func("GROUPING", track.groupings);
+
+            for (const auto& [tag, values] : track.userExtraTags)
+                func(tag, values);
+        }
+
+        void setTrackFacets(Session& session, TrackId track, const MetaData::Track& trackMetadata)
+        {
+            Facet::setTrackValues(session, track, FacetType::Genre, trackMetadata.genres);
+            Facet::setTrackValues(session, track, FacetType::Mood, trackMetadata.moods);
+            Facet::setTrackValues(session, track, FacetType::Language, trackMetadata.languages);
+        }
+
+        template <typename ScanResult>
+        void prefetchBatchLookups(Session& session, std::span<const ScanResult> scanResults, BatchLookups& lookups, ResolutionCache& cache)
+        {
+            std::vector<std::filesystem::path> paths;
+            std::set<UUID> artistMBIDs;
+            std::set<std::string> artistNames;
+            std::set<UUID> releaseMBIDs;
+            std::map<std::string, std::set<std::string>> clusterValuesByType;
+
+            // Only query what has not already been resolved during this scan
+            for (const ScanResult& scanResult : scanResults)
+            {
+                paths.push_back(scanResult.path);
+                lookups.mediaLibraries.try_emplace(scanResult.scanQueue->getLibraryInfo().id);
+
+                if (!scanResult.trackMetaData)
+                    continue;
+
+                const MetaData::Track& track{ *scanResult.trackMetaData };
+                visitArtists(track, [&](const MetaData::Artist& artist)
+                    {
+                        if (artist.mbid)
+                        {
+                            if (!cache.artistsByMBID.contains(*artist.mbid))
+                                artistMBIDs.emplace(*artist.mbid);
+                        }
+                        else if (!artist.name.empty() && !cache.artistsByName.contains(artist.name))
+                            artistNames.emplace(artist.name);
+                    });
+
+                if (track.medium && track.medium->release && track.medium->release->mbid)
+                {
+                    const UUID& mbid{ *track.medium->release->mbid };
+                    if (!cache.releasesByMBID.contains(mbid))
+                        releaseMBIDs.emplace(mbid);
+                }
+
+                visitClusters(track, [&](const std::string& tag, std::span<const std::string> values)
+                    {
+                        auto itClusterType{ cache.clusterTypesByName.find(tag) };
+                        std::set<std::string>& missingValues{ clusterValuesByType[tag] };
+                        for (const std::string& value : values)
+                        {
+                            if (itClusterType == std::cend(cache.clusterTypesByName)
+                                || !cache.clustersByTypeAndName.contains(std::make_pair(itClusterType->second->getId(), value)))
+                                missingValues.insert(value);
+                        }
+                    });
+            }
+
+            for (auto& [mediaLibraryId, mediaLibrary] : lookups.mediaLibraries)
+                mediaLibrary = MediaLibrary::find(session, mediaLibraryId); // may be null if settings are updated in // => next scan will correct this
+
+            for (const Track::pointer& track : Track::findByPaths(session, paths))
+                lookups.tracksByPath.emplace(track->getPath().string(), track);
+
+            for (const Artist::pointer& artist : Artist::findByMBIDs(session, std::vector<UUID>(std::cbegin(artistMBIDs), std::cend(artistMBIDs))))
+                cache.artistsByMBID.emplace(*artist->getMBID(), artist);
+
+            {
+                const std::vector<std::string> names(std::cbegin(artistNames), std::cend(artistNames));
+                for (const std::string& name : names)
+                    cache.artistsByName.try_emplace(name);
+
+                for (const Artist::pointer& artist : Artist::findByNames(session, names))
+                    cache.artistsByName[artist->getName()].push_back(artist);
+            }
+
+            for (const Release::pointer& release : Release::findByMBIDs(session, std::vector<UUID>(std::cbegin(releaseMBIDs), std::cend(releaseMBIDs))))
+                cache.releasesByMBID.emplace(*release->getMBID(), release);
+
+            {
+                std::vector<std::string> clusterTypeNames;
+                for (const auto& [tag, values] : clusterValuesByType)
+                {
+                    if (!cache.clusterTypesByName.contains(tag))
+                        clusterTypeNames.push_back(tag);
+                }
+
+                for (const ClusterType::pointer& clusterType : ClusterType::findByNames(session, clusterTypeNames))
+                    cache.clusterTypesByName.emplace(clusterType->getName(), clusterType);
+
+                for (const auto& [tag, values] : clusterValuesByType)
+                {
+                    auto itClusterType{ cache.clusterTypesByName.find(tag) };
+                    if (values.empty() || itClusterType == std::cend(cache.clusterTypesByName))
+                        continue;
+
+                    const ClusterType::pointer& clusterType{ itClusterType->second };
+                    const std::vector<std::string> clusterNames(std::cbegin(values), std::cend(values));
+                    for (const Cluster::pointer& cluster : clusterType->getClusters(clusterNames))
+                        cache.clustersByTypeAndName.emplace(std::make_pair(clusterType->getId(), std::string{ cluster->getName() }), cluster);
+                }
+            }
+        }
+
+        void addArtistToNameLookup(ResolutionCache& cache, const Artist::pointer& artist)
+        {
+            // names that have not been loaded yet will be fetched from the DB when needed
+            auto itArtists{ cache.artistsByName.find(artist->getName()) };
+            if (itArtists == std::end(cache.artistsByName))
+                return;
+
+            std::vector<Artist::pointer>& artists{ itArtists->second };
+
+            if (artist->getMBID())
+                artists.insert(std::find_if(std::cbegin(artists), std::cend(artists), [](const Artist::pointer& other) { return !other->getMBID(); }), artist);
+            else
+                artists.push_back(artist);
+        }
+
+        void removeArtistFromNameLookup(ResolutionCache& cache, const Artist::pointer& artist)
+        {
+            auto itArtists{ cache.artistsByName.find(artist->getName()) };
+            if (itArtists == std::end(cache.artistsByName))
+                return;
+
+            std::vector<Artist::pointer>& artists{ itArtists->second };
+            artists.erase(std::remove(std::begin(artists), std::end(artists), artist), std::end(artists));
+        }
+
+        Artist::pointer createArtist(Session& session, ResolutionCache& cache, const MetaData::Artist& artistInfo)
         {
             Artist::pointer artist{ session.create<Artist>(artistInfo.name) };
 
             if (artistInfo.mbid)
+            {
                 artist.modify()->setMBID(*artistInfo.mbid);
+                cache.artistsByMBID.emplace(*artistInfo.mbid, artist);
+            }
             if (artistInfo.sortName)
                 artist.modify()->setSortName(*artistInfo.sortName);
 
+            addArtistToNameLookup(cache, artist);
+
             return artist;
         }
 
-        void updateArtistIfNeeded(Artist::pointer artist, const MetaData::Artist& artistInfo)
+        void updateArtistIfNeeded(ResolutionCache& cache, Artist::pointer artist, const MetaData::Artist& artistInfo)
         {
             // Name may have been updated
             if (artist->getName() != artistInfo.name)
             {
+                removeArtistFromNameLookup(cache, artist);
                 artist.modify()->setName(artistInfo.name);
+                addArtistToNameLookup(cache, artist);
             }
 
             // Sortname may have been updated
@@ -68,7 +280,7 @@ namespace Scanner
             }
         }
 
-        std::vector<Artist::pointer> getOrCreateArtists(Session& session, const std::vector<MetaData::Artist>& artistsInfo, bool allowFallbackOnMBIDEntries)
+        std::vector<Artist::pointer> getOrCreateArtists(Session& session, ResolutionCache& cache, const std::vector<MetaData::Artist>& artistsInfo, bool allowFallbackOnMBIDEntries)
         {
             std::vector<Artist::pointer> artists;
 
@@ -79,11 +291,14 @@ namespace Scanner
                 // First try to get by MBID
                 if (artistInfo.mbid)
                 {
-                    artist = Artist::find(session, *artistInfo.mbid);
-                    if (!artist)
-                        artist = createArtist(session, artistInfo);
+                    auto itArtist{ cache.artistsByMBID.find(*artistInfo.mbid) };
+                    if (itArtist == std::cend(cache.artistsByMBID))
+                        artist = createArtist(session, cache, artistInfo);
                     else
-                        updateArtistIfNeeded(artist, artistInfo);
+                    {
+                        artist = itArtist->second;
+                        updateArtistIfNeeded(cache, artist, artistInfo);
+                    }
 
                     artists.emplace_back(std::move(artist));
                     continue;
@@ -92,21 +307,25 @@ namespace Scanner
                 // Fall back on artist name (collisions may occur)
                 if (!artistInfo.name.empty())
                 {
-                    for (const Artist::pointer& sameNamedArtist : Artist::find(session, artistInfo.name))
+                    auto itSameNamedArtists{ cache.artistsByName.find(artistInfo.name) };
+                    if (itSameNamedArtists != std::cend(cache.artistsByName))
                     {
-                        // Do not fallback on artist that is correctly tagged
-                        if (!allowFallbackOnMBIDEntries && sameNamedArtist->getMBID())
-                            continue;
+                        for (const Artist::pointer& sameNamedArtist : itSameNamedArtists->second)
+                        {
+                            // Do not fallback on artist that is correctly tagged
+                            if (!allowFallbackOnMBIDEntries && sameNamedArtist->getMBID())
+                                continue;
 
-                        artist = sameNamedArtist;
-                        break;
+                            artist = sameNamedArtist;
+                            break;
+                        }
                     }
 
                     // No Artist found with the same name and without MBID -> creating
                     if (!artist)
-                        artist = createArtist(session, artistInfo);
+                        artist = createArtist(session, cache, artistInfo);
                     else
-                        updateArtistIfNeeded(artist, artistInfo);
+                        updateArtistIfNeeded(cache, artist, artistInfo);
 
                     artists.emplace_back(std::move(artist));
                     continue;
@@ -116,16 +335,33 @@ namespace Scanner
             return artists;
         }
 
-        ReleaseType::pointer getOrCreateReleaseType(Session& session, std::string_view name)
+        ReleaseType::pointer getOrCreateReleaseType(Session& session, ResolutionCache& cache, std::string_view name)
         {
+            auto itReleaseType{ cache.releaseTypesByName.find(std::string{ name }) };
+            if (itReleaseType != std::cend(cache.releaseTypesByName))
+                return itReleaseType->second;
+
             ReleaseType::pointer releaseType{ ReleaseType::find(session, name) };
             if (!releaseType)
                 releaseType = session.create<ReleaseType>(name);
 
+            cache.releaseTypesByName.emplace(name, releaseType);
             return releaseType;
         }
 
-        void updateReleaseIfNeeded(Session& session, Release::pointer release, const MetaData::Release& releaseInfo)
+        TrackArtistLinkSubType::pointer getOrCreateLinkSubType(Session& session, ResolutionCache& cache, std::string_view name)
+        {
+            auto itSubType{ cache.linkSubTypesByName.find(std::string{ name }) };
+            if (itSubType != std::cend(cache.linkSubTypesByName))
+                return itSubType->second;
+
+            TrackArtistLinkSubType::pointer subType{ TrackArtistLinkSubType::getOrCreate(session, name) };
+
+            cache.linkSubTypesByName.emplace(name, subType);
+            return subType;
+        }
+
+        void updateReleaseIfNeeded(Session& session, ResolutionCache& cache, Release::pointer release, const MetaData::Release& releaseInfo)
         {
             if (release->getName() != releaseInfo.name)
                 release.modify()->setName(releaseInfo.name);
@@ -141,79 +377,109 @@ namespace Scanner
             {
                 release.modify()->clearReleaseTypes();
                 for (std::string_view releaseType : releaseInfo.releaseTypes)
-                    release.modify()->addReleaseType(getOrCreateReleaseType(session, releaseType));
+                    release.modify()->addReleaseType(getOrCreateReleaseType(session, cache, releaseType));
             }
         }
 
-        Release::pointer getOrCreateRelease(Session& session, const MetaData::Release& releaseInfo, const std::filesystem::path& expectedReleaseDirectory)
+        Release::pointer getOrCreateRelease(Session& session, ResolutionCache& cache, const MetaData::Release& releaseInfo, const std::filesystem::path& expectedReleaseDirectory)
         {
             Release::pointer release;
 
             // First try to get by MBID
             if (releaseInfo.mbid)
             {
-                release = Release::find(session, *releaseInfo.mbid);
-                if (!release)
+                auto itRelease{ cache.releasesByMBID.find(*releaseInfo.mbid) };
+                if (itRelease == std::cend(cache.releasesByMBID))
+                {
                     release = session.create<Release>(releaseInfo.name, releaseInfo.mbid);
+                    cache.releasesByMBID.emplace(*releaseInfo.mbid, release);
+                }
+                else
+                    release = itRelease->second;
 
-                updateReleaseIfNeeded(session, release, releaseInfo);
+                updateReleaseIfNeeded(session, cache, release, releaseInfo);
                 return release;
             }
 
             // Fall back on release name (collisions may occur), if and only if it is in the current directory
             if (!releaseInfo.name.empty())
             {
-                for (const Release::pointer& sameNamedRelease : Release::find(session, releaseInfo.name, expectedReleaseDirectory))
+                auto key{ std::make_pair(releaseInfo.name, expectedReleaseDirectory) };
+                auto itRelease{ cache.releasesByNameAndDirectory.find(key) };
+                if (itRelease != std::cend(cache.releasesByNameAndDirectory))
+                    release = itRelease->second;
+                else
                 {
-                    // do not fallback on properly tagged releases
-                    if (sameNamedRelease->getMBID())
-                        continue;
+                    for (const Release::pointer& sameNamedRelease : Release::find(session, releaseInfo.name, expectedReleaseDirectory))
+                    {
+                        // do not fallback on properly tagged releases
+                        if (sameNamedRelease->getMBID())
+                            continue;
 
-                    release = sameNamedRelease;
-                    break;
-                }
+                        release = sameNamedRelease;
+                        break;
+                    }
+
+                    // No release found with the same name and without MBID -> creating
+                    if (!release)
+                        release = session.create<Release>(releaseInfo.name);
 
-                // No release found with the same name and without MBID -> creating
-                if (!release)
-                    release = session.create<Release>(releaseInfo.name);
+                    cache.releasesByNameAndDirectory.emplace(std::move(key), release);
+                }
 
-                updateReleaseIfNeeded(session, release, releaseInfo);
+                updateReleaseIfNeeded(session, cache, release, releaseInfo);
                 return release;
             }
 
             return Release::pointer{};
         }
 
-        std::vector<Cluster::pointer> getOrCreateClusters(Session& session, const MetaData::Track& track)
+        std::vector<Cluster::pointer> getOrCreateClusters(Session& session, ResolutionCache& cache, const MetaData::Track& track)
         {
             std::vector<Cluster::pointer> clusters;
 
-            auto getOrCreateClusters {[&](std::string tag, std::span<const std::string> values)
+            visitClusters(track, [&](const std::string& tag, std::span<const std::string> values)
             {
-                auto clusterType = ClusterType::find(session, tag);
-                if (!clusterType)
+                ClusterType::pointer clusterType;
+                auto itClusterType{ cache.clusterTypesByName.find(tag) };
+                if (itClusterType != std::cend(cache.clusterTypesByName))
+                    clusterType = itClusterType->second;
+                else
+                {
                     clusterType = session.create<ClusterType>(tag);
+                    cache.clusterTypesByName.emplace(tag, clusterType);
+                }
 
                 for (const auto& value : values)
                 {
-                    auto cluster{ clusterType->getCluster(value) };
-                    if (!cluster)
+                    Cluster::pointer cluster;
+                    auto key{ std::make_pair(clusterType->getId(), value) };
+                    auto itCluster{ cache.clustersByTypeAndName.find(key) };
+                    if (itCluster != std::cend(cache.clustersByTypeAndName))
+                        cluster = itCluster->second;
+                    else
+                    {
                         cluster = session.create<Cluster>(clusterType, value);
+                        cache.clustersByTypeAndName.emplace(std::move(key), cluster);
+                    }
 
                     clusters.push_back(cluster);
                 }
-            }};
+            });
+
+            return clusters;
+        }
 
-            // TODO: migrate these fields in dedicated tables in DB
-            getOrCreateClusters("GENRE", track.genres);
-            getOrCreateClusters("MOOD", track.moods);
-            getOrCreateClusters("LANGUAGE", track.languages);
-            getOrCreateClusters("GROUPING", track.groupings);
+        MetaData::ParserBackend getParserBackend()
+        {
+            std::string_view backend{ Service<IConfig>::get()->getString("scanner-parser-backend", "taglib") };
 
-            for (const auto& [tag, values] : track.userExtraTags)
-                getOrCreateClusters(tag, values);
+            if (backend == "taglib")
+                return MetaData::ParserBackend::TagLib;
+            else if (backend == "lightweight")
+                return MetaData::ParserBackend::Lightweight;
 
-            return clusters;
+            throw LmsException{ "Invalid value for 'scanner-parser-backend'" };
         }
 
         MetaData::ParserReadStyle getParserReadStyle()
@@ -230,6 +496,29 @@ namespace Scanner
             throw LmsException{ "Invalid value for 'scanner-parser-read-style'" };
         }
 
+        void mergeScanStats(ScanStats& stats, ScanStats& other)
+        {
+            stats.skips += other.skips;
+            stats.scans += other.scans;
+            stats.additions += other.additions;
+            stats.deletions += other.deletions;
+            stats.updates += other.updates;
+            stats.errorCount += other.errorCount;
+            for (ScanError& error : other.errors)
+            {
+                if (stats.errors.size() >= ScanStats::maxErrorSampleCount)
+                    break;
+                stats.errors.push_back(std::move(error));
+            }
+            stats.duplicates.insert(std::end(stats.duplicates), std::cbegin(other.duplicates), std::cend(other.duplicates));
+            stats.performance.bytesRead += other.performance.bytesRead;
+            stats.performance.parseDuration += other.performance.parseDuration;
+            stats.performance.dbDuration += other.performance.dbDuration;
+            stats.performance.slowestFiles.insert(std::end(stats.performance.slowestFiles), std::make_move_iterator(std::begin(other.performance.slowestFiles)), std::make_move_iterator(std::end(other.performance.slowestFiles)));
+            std::stable_sort(std::begin(stats.performance.slowestFiles), std::end(stats.performance.slowestFiles), [](const ScanPerformance::SlowFile& lhs, const ScanPerformance::SlowFile& rhs) { return lhs.parseDuration > rhs.parseDuration; });
+            other = ScanStats{};
+        }
+
         std::size_t getScanMetaDataThreadCount()
         {
             std::size_t threadCount{ Service<IConfig>::get()->getULong("scanner-metadata-thread-count", 0) };
@@ -241,83 +530,206 @@ namespace Scanner
         }
     } // namespace
 
-    ScanStepScanFiles::MetadataScanQueue::MetadataScanQueue(MetaData::IParser& parser, std::size_t threadCount)
+    ScanStepScanFiles::ScanResultQueue::ScanResultQueue(std::size_t capacity)
+        : _scanResults{ capacity }
+    {}
+
+    void ScanStepScanFiles::ScanResultQueue::push(MetaDataScanResult&& result)
+    {
+        while (!_scanResults.tryPush(std::move(result))) // cannot happen since the pending scan requests are bounded, just in case
+            std::this_thread::yield();
+
+        // results are published before the ongoing scan count is decremented
+        const std::size_t resultCount{ _resultCount.fetch_add(1) + 1 };
+        const std::size_t ongoingScanCount{ _ongoingScanCount.fetch_sub(1) - 1 };
+
+        // Only wake up the consumer when it may have something to do
+        if (resultCount == _resultsBatchSize.load(std::memory_order_relaxed) || ongoingScanCount == 0 || _flushRequestCount > 0)
+            notifyResultsEvent();
+    }
+
+    void ScanStepScanFiles::ScanResultQueue::notifyResultsEvent()
+    {
+        _resultsEvent.fetch_add(1);
+        _resultsEvent.notify_one();
+    }
+
+    std::size_t ScanStepScanFiles::ScanResultQueue::waitAndPopResults(std::vector<MetaDataScanResult>& results, std::size_t maxCount)
+    {
+        results.clear();
+        results.reserve(maxCount);
+
+        _resultsBatchSize.store(maxCount, std::memory_order_relaxed);
+        while (true)
+        {
+            const std::uint32_t resultsEvent{ _resultsEvent.load() };
+
+            const bool noOngoingScan{ _ongoingScanCount == 0 };
+            const std::size_t resultCount{ _resultCount };
+            if (resultCount >= maxCount
+                || (resultCount > 0 && (noOngoingScan || _flushRequestCount > 0))
+                || (noOngoingScan && _noMoreScanRequests))
+                break;
+
+            _resultsEvent.wait(resultsEvent);
+        }
+
+        const std::size_t popCount{ _scanResults.tryPopBatch(results, maxCount) };
+        _resultCount -= popCount;
+
+        return popCount;
+    }
+
+    void ScanStepScanFiles::ScanResultQueue::setNoMoreScanRequests(bool noMoreScanRequests)
+    {
+        _noMoreScanRequests = noMoreScanRequests;
+        if (noMoreScanRequests)
+            notifyResultsEvent();
+    }
+
+    void ScanStepScanFiles::ScanResultQueue::beginFlush()
+    {
+        _flushRequestCount += 1;
+        notifyResultsEvent();
+    }
+
+    ScanStepScanFiles::MetadataScanQueue::MetadataScanQueue(MetaData::IParser& parser, ScanResultQueue& resultQueue, const ScannerSettings::MediaLibraryInfo& libraryInfo, std::size_t threadCount, std::size_t maxPendingCount, const bool& abortScan)
         : _metadataParser{ parser }
+        , _resultQueue{ resultQueue }
+        , _libraryInfo{ libraryInfo }
+        , _maxPendingCount{ maxPendingCount }
+        , _abortScan{ abortScan }
+        , _filesRateLimiter{ libraryInfo.maxFilesPerSecond }
+        , _bytesRateLimiter{ libraryInfo.maxBytesPerSecond }
         , _scanContextRunner{ _scanContext, threadCount }
     {}
 
     void ScanStepScanFiles::MetadataScanQueue::pushScanRequest(const std::filesystem::path& path)
     {
+        _pendingCount += 1;
+        _resultQueue.onScanRequestPosted();
+
+        // Start loading the metadata blocks while the previous files are parsed, unless the library reads are throttled
+        if (_libraryInfo.maxFilesPerSecond == 0 && _libraryInfo.maxBytesPerSecond == 0)
         {
-            std::scoped_lock lock{ _mutex };
-            _ongoingScanCount += 1;
+            if (IAsyncFileReader* asyncFileReader{ Service<IAsyncFileReader>::get() })
+                asyncFileReader->prefetch(path, metadataPrefetchSize);
         }
 
         _scanContext.post([=, this]
             {
                 std::unique_ptr<MetaData::Track> track;
+                std::optional<PathUtils::FileFingerprint> fingerprint;
+                std::uintmax_t fileSize{};
+                std::chrono::microseconds parseDuration{};
 
-                try
+                // the result is still pushed in case of abort, but will be discarded
+                if (!_abortScan)
                 {
-                    track = _metadataParser.parse(path);
-                }
-                catch(const MetaData::Exception& e)
-                {
-                    LMS_LOG(DBUPDATER, INFO, "Failed to parse '" << path.string() << "'");
+                    {
+                        std::error_code ec;
+                        fileSize = std::filesystem::file_size(path, ec);
+                        if (ec)
+                            fileSize = 0;
+                    }
+
+                    _filesRateLimiter.acquire(1, _abortScan);
+                    if (_libraryInfo.maxBytesPerSecond > 0 && fileSize > 0)
+                        _bytesRateLimiter.acquire(fileSize, _abortScan);
+                    throttleBackgroundWork();
+
+                    const auto parseStartTime{ std::chrono::steady_clock::now() };
+                    try
+                    {
+                        track = _metadataParser.parse(path);
+                    }
+                    catch(const MetaData::Exception& e)
+                    {
+                        LMS_LOG(DBUPDATER, INFO, "Failed to parse '" << path.string() << "'");
+                    }
+                    parseDuration = std::max(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - parseStartTime), std::chrono::microseconds{ 1 });
                 }
-                
+
+                if (track)
                 {
-                    std::scoped_lock lock{ _mutex };
+                    try
+                    {
+                        fingerprint = PathUtils::computeFileFingerprint(path);
+                    }
+                    catch (const LmsException& e)
+                    {
+                        LMS_LOG(DBUPDATER, DEBUG, "Cannot compute fingerprint of '" << path.string() << "': " << e.what());
+                    }
 
-                    _scanResults.emplace_back(MetaDataScanResult{ std::move(path), std::move(track) });
-                    _ongoingScanCount -= 1;
+                    // stored right away, no need to keep the picture until the track is written
+                    if (!track->embeddedCover.empty())
+                    {
+                        if (Cover::ICoverService* coverService{ Service<Cover::ICoverService>::get() })
+                            coverService->storeEmbeddedTrackCover(path, track->embeddedCover);
+                        track->embeddedCover = std::vector<std::byte>{};
+                    }
                 }
-                _condVar.notify_all();
+
+                _resultQueue.push(MetaDataScanResult{ std::move(path), std::move(track), fingerprint, this, fileSize, parseDuration });
+                _parsedCount += 1;
             });
     }
 
-    std::size_t ScanStepScanFiles::MetadataScanQueue::getResultsCount() const
+    void ScanStepScanFiles::MetadataScanQueue::onResultsWritten(std::size_t count)
     {
-        std::scoped_lock lock{ _mutex };
-        return _scanResults.size();
+        _pendingCount -= count;
+
+        _writtenEvent.fetch_add(1);
+        _writtenEvent.notify_one();
     }
 
-    size_t ScanStepScanFiles::MetadataScanQueue::popResults(std::vector<MetaDataScanResult>& results, std::size_t maxCount)
+    void ScanStepScanFiles::MetadataScanQueue::wait()
     {
-        results.clear();
-        results.reserve(maxCount);
-        
+        while (true)
         {
-            std::scoped_lock lock{ _mutex };
-            
-            while (results.size() < maxCount && !_scanResults.empty())
-            {
-                results.push_back(std::move(_scanResults.front()));
-                _scanResults.pop_front();
-            }
-        }
+            const std::uint32_t writtenEvent{ _writtenEvent.load() };
+            if (_pendingCount <= _maxPendingCount)
+                break;
 
-        return results.size();
+            _writtenEvent.wait(writtenEvent);
+        }
     }
 
-    void ScanStepScanFiles::MetadataScanQueue::wait(std::size_t maxScanRequestCount)
+    void ScanStepScanFiles::MetadataScanQueue::waitAllWritten()
     {
-        std::unique_lock lock{ _mutex };
-        _condVar.wait(lock, [=, this] {return _ongoingScanCount <= maxScanRequestCount;});
+        _resultQueue.beginFlush();
+        while (true)
+        {
+            const std::uint32_t writtenEvent{ _writtenEvent.load() };
+            if (_pendingCount == 0)
+                break;
+
+            _writtenEvent.wait(writtenEvent);
+        }
+        _resultQueue.endFlush();
     }
 
     ScanStepScanFiles::ScanStepScanFiles(InitParams& initParams)
         : ScanStepBase{ initParams }
-        , _metadataParser{ MetaData::createParser(MetaData::ParserBackend::TagLib, getParserReadStyle()) } // For now, always use TagLib
-        , _metadataScanQueue{ *_metadataParser, getScanMetaDataThreadCount() }
+        , _metadataParser{ MetaData::createParser(getParserBackend(), getParserReadStyle()) }
+        , _defaultScanThreadCount{ getScanMetaDataThreadCount() }
+        , _slowestFileCount{ Service<IConfig>::get()->getULong("scanner-report-slowest-file-count", 10) }
+        , _resolutionCache{ std::make_unique<ResolutionCache>() }
     {
-        LMS_LOG(DBUPDATER, INFO, "Using " << _metadataScanQueue.getThreadCount() << " thread(s) for scanning file metadata");
+        LMS_LOG(DBUPDATER, INFO, "Using " << _defaultScanThreadCount << " thread(s) per media library for scanning file metadata");
+
+        // avoids reopening the files to get their covers once the scan is done, they are kept in the cover file cache
+        const bool extractEmbeddedCovers{ Service<IConfig>::get()->getBool("scanner-extract-embedded-covers", true)
+            && Service<IConfig>::get()->getULong("cover-file-cache-max-size", 256) > 0 };
+        _metadataParser->setExtractEmbeddedCover(extractEmbeddedCovers);
+        LMS_LOG(DBUPDATER, INFO, "Extract embedded covers while scanning: " << (extractEmbeddedCovers ? "yes" : "no"));
     }
 
+    ScanStepScanFiles::~ScanStepScanFiles() = default;
+
     void ScanStepScanFiles::process(ScanContext& context)
     {
-        const std::size_t scanQueueMaxScanRequestCount{ 20 * _metadataScanQueue.getThreadCount() };
-        const std::size_t processMetaDataBatchSize{ 10 };
+        constexpr std::chrono::milliseconds progressReportPeriod{ 500 };
 
         {
             std::vector<std::string> tagsToParse{ _extraTagsToParse };
@@ -327,80 +739,436 @@ namespace Scanner
             _metadataParser->setDefaultTagDelimiters(_settings.defaultTagDelimiters);
         }
 
-        std::vector<MetaDataScanResult> scanResults;
         context.currentStepStats.totalElems = context.stats.filesScanned;
 
+        clearResolutionCache();
+        if (!context.forceScan)
+            loadFileScanInfos();
+
+        _writtenCount = 0;
+
+        std::vector<const ScannerSettings::MediaLibraryInfo*> mediaLibraries;
         for (const ScannerSettings::MediaLibraryInfo& mediaLibrary : _settings.mediaLibraries)
         {
-            PathUtils::exploreFilesRecursive(mediaLibrary.rootDirectory, [&](std::error_code ec, const std::filesystem::path& path)
+            if (std::any_of(std::cbegin(context.discoveredFiles), std::cend(context.discoveredFiles), [&](const DiscoveredFile& discoveredFile) { return discoveredFile.mediaLibrary == mediaLibrary.id; }))
+                mediaLibraries.push_back(&mediaLibrary);
+        }
+
+        // Pipeline: each media library is checked by its own thread, that posts the scan requests to its own parser threads
+        // then a single writer thread commits the results of all the libraries in the database, using large batches
+        ScanResultQueue resultQueue{ mediaLibraries.size() * (scanQueueMaxPendingCount + 1) }; // wait() lets at most maxPendingCount + 1 requests in flight per library
+        std::vector<std::unique_ptr<LibraryScan>> libraryScans;
+        for (const ScannerSettings::MediaLibraryInfo* mediaLibrary : mediaLibraries)
+        {
+            const std::size_t threadCount{ mediaLibrary->scanThreadCount > 0 ? mediaLibrary->scanThreadCount : _defaultScanThreadCount };
+            LMS_LOG(DBUPDATER, DEBUG, "Scanning '" << mediaLibrary->rootDirectory.string() << "' using " << threadCount << " thread(s)"
+                << (mediaLibrary->maxFilesPerSecond > 0 ? ", max " + std::to_string(mediaLibrary->maxFilesPerSecond) + " files/s" : "")
+                << (mediaLibrary->maxBytesPerSecond > 0 ? ", max " + std::to_string(mediaLibrary->maxBytesPerSecond) + " bytes/s" : ""));
+
+            auto libraryScan{ std::make_unique<LibraryScan>() };
+            libraryScan->scanQueue = std::make_unique<MetadataScanQueue>(*_metadataParser, resultQueue, *mediaLibrary, threadCount, scanQueueMaxPendingCount, _abortScan);
+            libraryScans.push_back(std::move(libraryScan));
+        }
+
+        ScanStats writerStats;
+        std::exception_ptr writerException;
+        std::atomic<bool> writerFailed{};
+        std::thread writerThread{ [&]
+            {
+                std::vector<MetaDataScanResult> scanResults;
+                std::unordered_map<MetadataScanQueue*, std::size_t> writtenCountByQueue;
+                while (resultQueue.waitAndPopResults(scanResults, writeBatchSize) > 0)
                 {
-                    if (_abortScan)
-                        return false;
+                    // keep on draining the results even if there is nothing to do, the library scans would be blocked otherwise
+                    if (!_abortScan && !writerFailed)
+                    {
+                        addParsePerformance(writerStats.performance, scanResults);
+                        try
+                        {
+                            const auto startTime{ std::chrono::steady_clock::now() };
+                            processMetaDataScanResults(writerStats, scanResults);
+                            writerStats.performance.dbDuration += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime);
+                            _writtenCount += scanResults.size();
+                        }
+                        catch (...)
+                        {
+                            writerException = std::current_exception();
+                            writerFailed = true;
+                        }
+                    }
 
-                    if (ec)
+                    writtenCountByQueue.clear();
+                    for (const MetaDataScanResult& scanResult : scanResults)
+                        writtenCountByQueue[scanResult.scanQueue] += 1;
+                    for (const auto& [scanQueue, writtenCount] : writtenCountByQueue)
+                        scanQueue->onResultsWritten(writtenCount);
+                }
+            } };
+
+        std::mutex runningLibraryScanMutex;
+        std::condition_variable runningLibraryScanCondVar;
+        std::size_t runningLibraryScanCount{ libraryScans.size() };
+
+        std::vector<std::thread> libraryScanThreads;
+        for (const std::unique_ptr<LibraryScan>& libraryScan : libraryScans)
+        {
+            libraryScanThreads.emplace_back([&, &libraryScan = *libraryScan]
+                {
+                    try
                     {
-                        LMS_LOG(DBUPDATER, ERROR, "Cannot process entry '" << path.string() << "': " << ec.message());
-                        context.stats.errors.emplace_back(ScanError{ path, ScanErrorType::CannotReadFile, ec.message() });
+                        scanMediaLibrary(context, libraryScan, writerFailed);
                     }
-                    else if (PathUtils::hasFileAnyExtension(path, _settings.supportedExtensions))
+                    catch (...)
                     {
-                        if (checkFileNeedScan(context, path, mediaLibrary))
-                            _metadataScanQueue.pushScanRequest(path);
-
-                        context.currentStepStats.processedElems++;
-                        _progressCallback(context.currentStepStats);
+                        libraryScan.exception = std::current_exception();
                     }
 
-                    while (_metadataScanQueue.getResultsCount() > processMetaDataBatchSize)
+                    // the parser threads cannot be stopped while they still have results to publish
+                    libraryScan.scanQueue->waitAllWritten();
+
                     {
-                        _metadataScanQueue.popResults(scanResults, processMetaDataBatchSize);
-                        processMetaDataScanResults(context, scanResults, mediaLibrary);
+                        std::scoped_lock lock{ runningLibraryScanMutex };
+                        runningLibraryScanCount -= 1;
                     }
+                    runningLibraryScanCondVar.notify_all();
+                });
+        }
 
-                    _metadataScanQueue.wait(scanQueueMaxScanRequestCount);
+        auto updateStepStats{ [&]
+            {
+                context.currentStepStats.processedElems = 0;
+                context.currentStepStats.parsedElems = 0;
+                for (const std::unique_ptr<LibraryScan>& libraryScan : libraryScans)
+                {
+                    context.currentStepStats.processedElems += libraryScan->processedCount;
+                    context.currentStepStats.parsedElems += libraryScan->scanQueue->getParsedCount();
+                }
+                context.currentStepStats.writtenElems = _writtenCount;
+            } };
 
-                    return true;
-                }, &excludeDirFileName);
+        {
+            std::unique_lock lock{ runningLibraryScanMutex };
+            while (!runningLibraryScanCondVar.wait_for(lock, progressReportPeriod, [&] { return runningLibraryScanCount == 0; }))
+            {
+                lock.unlock();
+                updateStepStats();
+                _progressCallback(context.currentStepStats);
+                lock.lock();
+            }
+        }
 
-            _metadataScanQueue.wait();
+        for (std::thread& libraryScanThread : libraryScanThreads)
+            libraryScanThread.join();
 
-            while (_metadataScanQueue.popResults(scanResults, processMetaDataBatchSize) > 0)
-                processMetaDataScanResults(context, scanResults, mediaLibrary);
+        resultQueue.setNoMoreScanRequests(true);
+        writerThread.join();
+
+        updateStepStats();
+        _progressCallback(context.currentStepStats);
+        {
+            const std::int64_t elapsedSecs{ std::max<std::int64_t>(context.currentStepStats.startTime.secsTo(Wt::WDateTime::currentDateTime()), 1) };
+            LMS_LOG(DBUPDATER, INFO, "Checked " << context.currentStepStats.processedElems << " files (" << context.currentStepStats.processedElems / elapsedSecs << "/s), "
+                << "parsed " << context.currentStepStats.parsedElems << " files (" << context.currentStepStats.parsedElems / elapsedSecs << "/s), "
+                << "written " << context.currentStepStats.writtenElems << " files (" << context.currentStepStats.writtenElems / elapsedSecs << "/s)");
+        }
+
+        // Do not keep entities alive between scans (or after an abort), the DB may be modified meanwhile
+        clearResolutionCache();
+        _fileScanInfos.clear();
+        _fileScanInfos.shrink_to_fit();
+        _contentFingerprintInfos.clear();
+        _contentFingerprintInfos.shrink_to_fit();
+
+        mergeScanStats(context.stats, writerStats);
+        for (const std::unique_ptr<LibraryScan>& libraryScan : libraryScans)
+            mergeScanStats(context.stats, libraryScan->stats);
+        context.changedDirectories.merge(_changedDirectories);
+        _changedDirectories.clear();
+
+        if (writerException)
+            std::rethrow_exception(writerException);
+        for (const std::unique_ptr<LibraryScan>& libraryScan : libraryScans)
+        {
+            if (libraryScan->exception)
+                std::rethrow_exception(libraryScan->exception);
         }
-    }      
+    }
 
-    bool ScanStepScanFiles::checkFileNeedScan(ScanContext& context, const std::filesystem::path& file, const ScannerSettings::MediaLibraryInfo& libraryInfo)
+    void ScanStepScanFiles::scanMediaLibrary(const ScanContext& context, LibraryScan& libraryScan, const std::atomic<bool>& writerFailed)
     {
-        ScanStats& stats{ context.stats };
-        Wt::WDateTime lastWriteTime;
+        const std::size_t checkpointFileCount{ 1000 }; // files processed between two scan checkpoints
+
+        MetadataScanQueue& scanQueue{ *libraryScan.scanQueue };
+        const ScannerSettings::MediaLibraryInfo& mediaLibrary{ scanQueue.getLibraryInfo() };
+
+        // Only full scans are checkpointed
+        const bool saveCheckpoints{ context.directories.empty() };
+
+        const std::filesystem::path* scanCheckpoint{};
+        if (auto itCheckpoint{ context.scanCheckpoints.find(mediaLibrary.id) }; itCheckpoint != std::cend(context.scanCheckpoints))
+            scanCheckpoint = &itCheckpoint->second;
+
+        // New content first: the files of the changed directories are scanned and committed before the others
+        // They are not checkpointed, since checkpoints rely on the path order
+        {
+            std::size_t changedDirectoryFileCount{};
+            for (const DiscoveredFile& discoveredFile : context.discoveredFiles)
+            {
+                if (_abortScan || writerFailed)
+                    break;
+
+                if (discoveredFile.mediaLibrary != mediaLibrary.id || !discoveredFile.inChangedDirectory)
+                    continue;
+
+                // already processed by the interrupted scan
+                if (scanCheckpoint && discoveredFile.path <= *scanCheckpoint)
+                    continue;
+
+                if (checkFileNeedScan(context, libraryScan.stats, discoveredFile, mediaLibrary))
+                    scanQueue.pushScanRequest(discoveredFile.path);
+
+                libraryScan.processedCount++;
+                changedDirectoryFileCount++;
+
+                scanQueue.wait();
+            }
+
+            if (changedDirectoryFileCount > 0)
+            {
+                scanQueue.waitAllWritten();
+                LMS_LOG(DBUPDATER, DEBUG, "Processed " << changedDirectoryFileCount << " files of the changed directories of '" << mediaLibrary.rootDirectory.string() << "'");
+            }
+        }
+
+        const std::filesystem::path* lastProcessedFile{};
+        std::size_t processedFileCountSinceCheckpoint{};
+        for (const DiscoveredFile& discoveredFile : context.discoveredFiles)
+        {
+            if (_abortScan || writerFailed)
+                break;
+
+            if (discoveredFile.mediaLibrary != mediaLibrary.id)
+                continue;
+
+            // Already processed by the interrupted scan (discovered files are sorted by path)
+            if (scanCheckpoint && discoveredFile.path <= *scanCheckpoint)
+            {
+                libraryScan.stats.skips++;
+                libraryScan.processedCount++;
+                continue;
+            }
+
+            // already processed first, but still considered for the checkpoints
+            if (discoveredFile.inChangedDirectory)
+            {
+                lastProcessedFile = &discoveredFile.path;
+                continue;
+            }
+
+            if (checkFileNeedScan(context, libraryScan.stats, discoveredFile, mediaLibrary))
+                scanQueue.pushScanRequest(discoveredFile.path);
+
+            lastProcessedFile = &discoveredFile.path;
+            libraryScan.processedCount++;
+
+            // Bound the number of pending scan requests
+            scanQueue.wait();
+
+            // Results are processed out of order: all the pending results have to be committed before saving a checkpoint
+            if (saveCheckpoints && ++processedFileCountSinceCheckpoint >= checkpointFileCount)
+            {
+                scanQueue.waitAllWritten();
+                if (!_abortScan && !writerFailed)
+                    saveScanCheckpoint(mediaLibrary.id, *lastProcessedFile);
+
+                processedFileCountSinceCheckpoint = 0;
+            }
+        }
+
+        scanQueue.waitAllWritten();
+        if (saveCheckpoints && !_abortScan && !writerFailed && lastProcessedFile)
+            saveScanCheckpoint(mediaLibrary.id, *lastProcessedFile);
+    }
+
+    void ScanStepScanFiles::saveScanCheckpoint(MediaLibraryId mediaLibraryId, const std::filesystem::path& lastProcessedFile)
+    {
+        Database::Session& dbSession{ _db.getTLSSession() };
+        auto transaction{ dbSession.createWriteTransaction() };
+
+        if (MediaLibrary::pointer mediaLibrary{ MediaLibrary::find(dbSession, mediaLibraryId) })
+            mediaLibrary.modify()->setScanCheckpoint(lastProcessedFile);
+    }
+
+    void ScanStepScanFiles::loadFileScanInfos()
+    {
+        _fileScanInfos.clear();
+        _contentFingerprintInfos.clear();
+
+        {
+            Database::Session& dbSession{ _db.getTLSSession() };
+            auto transaction{ dbSession.createReadTransaction() };
+
+            _fileScanInfos.reserve(Track::getCount(dbSession));
+            Track::findFileScanInfos(dbSession, [&](const Track::FileScanInfo& fileScanInfo)
+                {
+                    _fileScanInfos.push_back(FileScanInfo{ std::hash<std::string>{}(fileScanInfo.path.string()), fileScanInfo.lastWriteTime.toTime_t(), fileScanInfo.scanVersion, fileScanInfo.mediaLibrary, false });
+                    if (fileScanInfo.contentFingerprint)
+                        _contentFingerprintInfos.push_back(ContentFingerprintInfo{ PathUtils::FileFingerprint{ fileScanInfo.fileSize, *fileScanInfo.contentFingerprint }, fileScanInfo.trackId });
+                });
+        }
+
+        std::sort(std::begin(_contentFingerprintInfos), std::end(_contentFingerprintInfos), [](const ContentFingerprintInfo& lhs, const ContentFingerprintInfo& rhs)
+            {
+                return std::tie(lhs.fingerprint.fileSize, lhs.fingerprint.crc32) < std::tie(rhs.fingerprint.fileSize, rhs.fingerprint.crc32);
+            });
+        _contentFingerprintInfos.shrink_to_fit();
+
+        std::sort(std::begin(_fileScanInfos), std::end(_fileScanInfos), [](const FileScanInfo& lhs, const FileScanInfo& rhs) { return lhs.pathHash < rhs.pathHash; });
+
+        // Keep only one entry per hash, flagged if it is shared by several files
+        for (std::size_t i{ 1 }; i < _fileScanInfos.size(); ++i)
+        {
+            if (_fileScanInfos[i].pathHash == _fileScanInfos[i - 1].pathHash)
+            {
+                _fileScanInfos[i].hashCollision = true;
+                _fileScanInfos[i - 1].hashCollision = true;
+            }
+        }
+        _fileScanInfos.erase(std::unique(std::begin(_fileScanInfos), std::end(_fileScanInfos), [](const FileScanInfo& lhs, const FileScanInfo& rhs) { return lhs.pathHash == rhs.pathHash; }), std::end(_fileScanInfos));
+        _fileScanInfos.shrink_to_fit();
+
+        LMS_LOG(DBUPDATER, DEBUG, "Loaded scan info for " << _fileScanInfos.size() << " files");
+    }
+
+    const ScanStepScanFiles::FileScanInfo* ScanStepScanFiles::findFileScanInfo(const std::filesystem::path& file) const
+    {
+        const std::size_t pathHash{ std::hash<std::string>{}(file.string()) };
+
+        auto it{ std::lower_bound(std::cbegin(_fileScanInfos), std::cend(_fileScanInfos), pathHash, [](const FileScanInfo& fileScanInfo, std::size_t hash) { return fileScanInfo.pathHash < hash; }) };
+        if (it == std::cend(_fileScanInfos) || it->pathHash != pathHash)
+            return nullptr;
+
+        return &(*it);
+    }
+
+    bool ScanStepScanFiles::isFilePresent(const ScanContext& context, const std::filesystem::path& file) const
+    {
+        // Discovered files cover all the media libraries only in case of a complete full scan
+        if (context.discoveryComplete && context.directories.empty())
+        {
+            auto it{ std::lower_bound(std::cbegin(context.discoveredFiles), std::cend(context.discoveredFiles), file, [](const DiscoveredFile& discoveredFile, const std::filesystem::path& path) { return discoveredFile.path < path; }) };
+            return it != std::cend(context.discoveredFiles) && it->path == file;
+        }
+
+        std::error_code ec;
+        return std::filesystem::exists(file, ec);
+    }
+
+    bool ScanStepScanFiles::updateMovedTrack(const ScanContext& context, ScanStats& stats, const DiscoveredFile& discoveredFile, const ScannerSettings::MediaLibraryInfo& libraryInfo)
+    {
+        const std::filesystem::path& file{ discoveredFile.path };
+
+        // Files sizes are very discriminating: only compute the fingerprint if there is a candidate with the same size
+        std::error_code ec;
+        const std::uintmax_t fileSize{ std::filesystem::file_size(file, ec) };
+        if (ec)
+            return false;
+
+        auto [itBegin, itEnd]{ std::equal_range(std::begin(_contentFingerprintInfos), std::end(_contentFingerprintInfos), fileSize,
+            [](const auto& lhs, const auto& rhs)
+            {
+                if constexpr (std::is_same_v<std::decay_t<decltype(lhs)>, ContentFingerprintInfo>)
+                    return lhs.fingerprint.fileSize < rhs;
+                else
+                    return lhs < rhs.fingerprint.fileSize;
+            }) };
+        if (itBegin == itEnd)
+            return false;
+
+        PathUtils::FileFingerprint fingerprint;
         try
         {
-            lastWriteTime = PathUtils::getLastWriteTime(file);
+            fingerprint = PathUtils::computeFileFingerprint(file);
         }
-        catch (LmsException& e)
+        catch (const LmsException& e)
         {
-            LMS_LOG(DBUPDATER, ERROR, e.what());
-            stats.skips++;
+            LMS_LOG(DBUPDATER, DEBUG, "Cannot compute fingerprint of '" << file.string() << "': " << e.what());
             return false;
         }
 
+        std::scoped_lock lock{ _contentFingerprintMutex };
+        for (auto it{ itBegin }; it != itEnd; ++it)
+        {
+            if (it->fingerprint != fingerprint || !it->trackId.isValid())
+                continue;
+
+            Database::Session& dbSession{ _db.getTLSSession() };
+            auto transaction{ dbSession.createWriteTransaction() };
+
+            Track::pointer track{ Track::find(dbSession, it->trackId) };
+            if (!track || isFilePresent(context, track->getPath()))
+                continue;
+
+            LMS_LOG(DBUPDATER, DEBUG, "Considering track '" << file.string() << "' moved from '" << track->getPath().string() << "' (same content fingerprint)");
+            it->trackId = TrackId{};
+            addChangedDirectory(track->getPath().parent_path());
+            addChangedDirectory(file.parent_path());
+
+            Track::move(dbSession, track, file, Database::MediaLibrary::find(dbSession, libraryInfo.id)); // media library may be null, will be handled in the next scan anyway
+
+            const bool needScan{ track->getLastWriteTime().toTime_t() != discoveredFile.lastWriteTime.toTime_t() || track->getScanVersion() != _settings.scanVersion };
+            if (!needScan)
+                stats.updates++;
+
+            return !needScan;
+        }
+
+        return false;
+    }
+
+    bool ScanStepScanFiles::checkFileNeedScan(const ScanContext& context, ScanStats& stats, const DiscoveredFile& discoveredFile, const ScannerSettings::MediaLibraryInfo& libraryInfo)
+    {
+        const std::filesystem::path& file{ discoveredFile.path };
+        const Wt::WDateTime& lastWriteTime{ discoveredFile.lastWriteTime };
+
         bool needUpdateLibrary{};
         if (!context.forceScan)
         {
             // Skip file if last write is the same
-            Database::Session& dbSession{ _db.getTLSSession() };
-            auto transaction{ _db.getTLSSession().createReadTransaction() };
+            std::time_t trackLastWriteTime{};
+            std::size_t trackScanVersion{};
+            MediaLibraryId trackMediaLibrary;
 
-            const Track::pointer track{ Track::findByPath(dbSession, file) };
+            const FileScanInfo* fileScanInfo{ findFileScanInfo(file) };
+            if (!fileScanInfo)
+                return !updateMovedTrack(context, stats, discoveredFile, libraryInfo); // new or moved file
 
-            if (track
-                && track->getLastWriteTime().toTime_t() == lastWriteTime.toTime_t()
-                && track->getScanVersion() == _settings.scanVersion
-                )
+            if (!fileScanInfo->hashCollision)
+            {
+                trackLastWriteTime = fileScanInfo->lastWriteTime;
+                trackScanVersion = fileScanInfo->scanVersion;
+                trackMediaLibrary = fileScanInfo->mediaLibrary;
+            }
+            else
+            {
+                Database::Session& dbSession{ _db.getTLSSession() };
+                auto transaction{ dbSession.createReadTransaction() };
+
+                const Track::pointer track{ Track::findByPath(dbSession, file) };
+                if (!track)
+                    return true;
+
+                trackLastWriteTime = track->getLastWriteTime().toTime_t();
+                trackScanVersion = track->getScanVersion();
+                if (auto mediaLibrary{ track->getMediaLibrary() })
+                    trackMediaLibrary = mediaLibrary->getId();
+            }
+
+            if (trackLastWriteTime == lastWriteTime.toTime_t()
+                && trackScanVersion == _settings.scanVersion)
             {
                 // this file may have been moved from one library to another, then we just need to update the media library id instead of a full rescan
-                auto trackMediaLibrary{ track->getMediaLibrary() };
-                if (trackMediaLibrary && trackMediaLibrary->getId() == libraryInfo.id)
+                if (trackMediaLibrary == libraryInfo.id)
                 {
                     stats.skips++;
                     return false;
@@ -416,8 +1184,10 @@ namespace Scanner
             auto transaction{ _db.getTLSSession().createWriteTransaction() };
 
             Track::pointer track{ Track::findByPath(dbSession, file) };
-            assert(track);
-            track.modify()->setMediaLibrary(Database::MediaLibrary::find(dbSession, libraryInfo.id)); // may be null, will be handled in the next scan anyway
+            if (!track)
+                return true; // removed in the meantime
+
+            Track::move(dbSession, track, file, Database::MediaLibrary::find(dbSession, libraryInfo.id)); // media library may be null, will be handled in the next scan anyway
             stats.updates++;
             return false;
         }
@@ -425,36 +1195,87 @@ namespace Scanner
         return true; // need to scan
     }
 
-    void ScanStepScanFiles::processMetaDataScanResults(ScanContext& context, std::span<const MetaDataScanResult> scanResults, const ScannerSettings::MediaLibraryInfo& libraryInfo)
+    void ScanStepScanFiles::addParsePerformance(ScanPerformance& performance, std::span<const MetaDataScanResult> scanResults) const
     {
-        Database::Session& dbSession{ _db.getTLSSession() };
-        auto transaction{ dbSession.createWriteTransaction() };
+        auto isSlower{ [](std::chrono::microseconds parseDuration, const ScanPerformance::SlowFile& slowFile) { return parseDuration > slowFile.parseDuration; } };
 
         for (const MetaDataScanResult& scanResult : scanResults)
         {
-            if (_abortScan)
-                return;
+            if (scanResult.parseDuration.count() == 0)
+                continue;
 
+            performance.bytesRead += scanResult.fileSize;
+            performance.parseDuration += scanResult.parseDuration;
+
+            // only keep the slowest files, sorted
+            if (_slowestFileCount == 0
+                || (performance.slowestFiles.size() >= _slowestFileCount && scanResult.parseDuration <= performance.slowestFiles.back().parseDuration))
+                continue;
+
+            std::string format;
             if (scanResult.trackMetaData)
             {
-                context.stats.scans++;
+                format = scanResult.trackMetaData->container;
+                if (!scanResult.trackMetaData->codec.empty())
+                    format += (format.empty() ? "" : "/") + scanResult.trackMetaData->codec;
+            }
 
-                processFileMetaData(context, scanResult.path, *scanResult.trackMetaData, libraryInfo);
+            const auto it{ std::upper_bound(std::begin(performance.slowestFiles), std::end(performance.slowestFiles), scanResult.parseDuration, isSlower) };
+            performance.slowestFiles.insert(it, ScanPerformance::SlowFile{ scanResult.path, std::move(format), scanResult.fileSize, scanResult.parseDuration });
+            if (performance.slowestFiles.size() > _slowestFileCount)
+                performance.slowestFiles.pop_back();
+        }
+    }
 
-                // optimize the database during scan (if we import a very large database, it may be too late to do it once at end)
-                if ((context.stats.scans % 1'000) == 0)
-                    _db.getTLSSession().optimize();
-            }
-            else
+    void ScanStepScanFiles::processMetaDataScanResults(ScanStats& stats, std::span<const MetaDataScanResult> scanResults)
+    {
+        try
+        {
+            Database::Session& dbSession{ _db.getTLSSession() };
+            auto transaction{ dbSession.createWriteTransaction() };
+
+            // Resolve all the entities referenced by this batch using a few set-based queries instead of per file lookups
+            BatchLookups lookups;
+            prefetchBatchLookups(dbSession, scanResults, lookups, *_resolutionCache);
+
+            for (const MetaDataScanResult& scanResult : scanResults)
             {
-                context.stats.errors.emplace_back(scanResult.path, ScanErrorType::CannotParseFile);
+                if (_abortScan)
+                    return;
+
+                if (scanResult.trackMetaData)
+                {
+                    stats.scans++;
+
+                    processFileMetaData(stats, lookups, scanResult.scanQueue->getLibraryInfo().id, scanResult.path, *scanResult.trackMetaData, scanResult.fingerprint);
+                }
+                else
+                {
+                    addError(dbSession, stats, ScanError{ scanResult.path, ScanErrorType::CannotParseFile });
+                }
             }
         }
+        catch (...)
+        {
+            // the transaction has been rolled back: cached entities may no longer exist
+            clearResolutionCache();
+            throw;
+        }
     }
 
-    void ScanStepScanFiles::processFileMetaData(ScanContext& context, const std::filesystem::path& file, const MetaData::Track& trackMetadata, const ScannerSettings::MediaLibraryInfo& libraryInfo)
+    void ScanStepScanFiles::clearResolutionCache()
+    {
+        *_resolutionCache = ResolutionCache{};
+    }
+
+    void ScanStepScanFiles::addChangedDirectory(const std::filesystem::path& directory)
+    {
+        const std::scoped_lock lock{ _changedDirectoriesMutex };
+        _changedDirectories.insert(directory);
+    }
+
+    void ScanStepScanFiles::processFileMetaData(ScanStats& stats, BatchLookups& lookups, MediaLibraryId mediaLibrary, const std::filesystem::path& file, const MetaData::Track& trackMetadata, const std::optional<PathUtils::FileFingerprint>& fingerprint)
     {
-        ScanStats& stats{ context.stats };
         Wt::WDateTime lastWriteTime;
         try
         {
@@ -467,8 +1288,13 @@ namespace Scanner
             return;
         }
 
+        // whatever happens next, the track is added, updated or removed
+        addChangedDirectory(file.parent_path());
+
         Database::Session& dbSession{ _db.getTLSSession() };
-        Track::pointer track{ Track::findByPath(dbSession, file) };
+        Track::pointer track;
+        if (auto itTrack{ lookups.tracksByPath.find(file.string()) }; itTrack != std::cend(lookups.tracksByPath))
+            track = itTrack->second;
 
         if (trackMetadata.mbid && (!track || _settings.skipDuplicateMBID))
         {
@@ -482,8 +1308,9 @@ namespace Scanner
                 if (!std::filesystem::exists(otherTrack->getPath(), ec))
                 {
                     LMS_LOG(DBUPDATER, DEBUG, "Considering track '" << file.string() << "' moved from '" << otherTrack->getPath() << "'");
+                    addChangedDirectory(otherTrack->getPath().parent_path());
                     track = otherTrack;
-                    track.modify()->setPath(file);
+                    Track::move(dbSession, track, file, lookups.mediaLibraries[mediaLibrary]);
                 }
             }
 
@@ -529,7 +1356,7 @@ namespace Scanner
                 track.remove();
                 stats.deletions++;
             }
-            stats.errors.emplace_back(ScanError{ file, ScanErrorType::BadDuration });
+            addError(_db.getTLSSession(), stats, ScanError{ file, ScanErrorType::BadDuration });
             return;
         }
 
@@ -546,9 +1373,10 @@ namespace Scanner
 
         // If file already exists, update its data
         // Otherwise, create it
-        if (!track)
+        const bool isNewTrack{ !track };
+        if (isNewTrack)
         {
-            track = dbSession.create<Track>(file);
+            track = dbSession.create<Track>(file, lookups.mediaLibraries[mediaLibrary]);
             LMS_LOG(DBUPDATER, DEBUG, "Adding '" << file.string() << "'");
             stats.additions++;
         }
@@ -562,57 +1390,67 @@ namespace Scanner
         // Track related data
         assert(track);
 
-        track.modify()->setMediaLibrary(MediaLibrary::find(dbSession, libraryInfo.id)); // may be null if settings are updated in // => next scan will correct this
+        if (track->getMediaLibrary() != lookups.mediaLibraries[mediaLibrary])
+            Track::move(dbSession, track, file, lookups.mediaLibraries[mediaLibrary]); // in the directory tree of its new media library
         track.modify()->clearArtistLinks();
         // Do not fallback on artists with the same name but having a MBID for artist and releaseArtists, as it may be corrected by properly tagging files
-        for (const Artist::pointer& artist : getOrCreateArtists(dbSession, trackMetadata.artists, false))
+        for (const Artist::pointer& artist : getOrCreateArtists(dbSession, *_resolutionCache, trackMetadata.artists, false))
             track.modify()->addArtistLink(TrackArtistLink::create(dbSession, track, artist, TrackArtistLinkType::Artist));
 
         if (trackMetadata.medium && trackMetadata.medium->release)
         {
-            for (const Artist::pointer& releaseArtist : getOrCreateArtists(dbSession, trackMetadata.medium->release->artists, false))
+            for (const Artist::pointer& releaseArtist : getOrCreateArtists(dbSession, *_resolutionCache, trackMetadata.medium->release->artists, false))
                 track.modify()->addArtistLink(TrackArtistLink::create(dbSession, track, releaseArtist, TrackArtistLinkType::ReleaseArtist));
         }
 
         // Allow fallbacks on artists with the same name even if they have MBID, since there is no tag to indicate the MBID of these artists
         // We could ask MusicBrainz to get all the information, but that would heavily slow down the import process
-        for (const Artist::pointer& conductor : getOrCreateArtists(dbSession, trackMetadata.conductorArtists, true))
+        for (const Artist::pointer& conductor : getOrCreateArtists(dbSession, *_resolutionCache, trackMetadata.conductorArtists, true))
             track.modify()->addArtistLink(TrackArtistLink::create(dbSession, track, conductor, TrackArtistLinkType::Conductor));
 
-        for (const Artist::pointer& composer : getOrCreateArtists(dbSession, trackMetadata.composerArtists, true))
+        for (const Artist::pointer& composer : getOrCreateArtists(dbSession, *_resolutionCache, trackMetadata.composerArtists, true))
             track.modify()->addArtistLink(TrackArtistLink::create(dbSession, track, composer, TrackArtistLinkType::Composer));
 
-        for (const Artist::pointer& lyricist : getOrCreateArtists(dbSession, trackMetadata.lyricistArtists, true))
+        for (const Artist::pointer& lyricist : getOrCreateArtists(dbSession, *_resolutionCache, trackMetadata.lyricistArtists, true))
             track.modify()->addArtistLink(TrackArtistLink::create(dbSession, track, lyricist, TrackArtistLinkType::Lyricist));
 
-        for (const Artist::pointer& mixer : getOrCreateArtists(dbSession, trackMetadata.mixerArtists, true))
+        for (const Artist::pointer& mixer : getOrCreateArtists(dbSession, *_resolutionCache, trackMetadata.mixerArtists, true))
             track.modify()->addArtistLink(TrackArtistLink::create(dbSession, track, mixer, TrackArtistLinkType::Mixer));
 
         for (const auto& [role, performers] : trackMetadata.performerArtists)
         {
-            for (const Artist::pointer& performer : getOrCreateArtists(dbSession, performers, true))
-                track.modify()->addArtistLink(TrackArtistLink::create(dbSession, track, performer, TrackArtistLinkType::Performer, role));
+            const TrackArtistLinkSubType::pointer subType{ role.empty() ? TrackArtistLinkSubType::pointer{} : getOrCreateLinkSubType(dbSession, *_resolutionCache, role) };
+            for (const Artist::pointer& performer : getOrCreateArtists(dbSession, *_resolutionCache, performers, true))
+                track.modify()->addArtistLink(TrackArtistLink::create(dbSession, track, performer, TrackArtistLinkType::Performer, subType));
         }
 
-        for (const Artist::pointer& producer : getOrCreateArtists(dbSession, trackMetadata.producerArtists, true))
+        for (const Artist::pointer& producer : getOrCreateArtists(dbSession, *_resolutionCache, trackMetadata.producerArtists, true))
             track.modify()->addArtistLink(TrackArtistLink::create(dbSession, track, producer, TrackArtistLinkType::Producer));
 
-        for (const Artist::pointer& remixer : getOrCreateArtists(dbSession, trackMetadata.remixerArtists, true))
+        for (const Artist::pointer& remixer : getOrCreateArtists(dbSession, *_resolutionCache, trackMetadata.remixerArtists, true))
             track.modify()->addArtistLink(TrackArtistLink::create(dbSession, track, remixer, TrackArtistLinkType::Remixer));
 
         track.modify()->setScanVersion(_settings.scanVersion);
         if (trackMetadata.medium && trackMetadata.medium->release)
-            track.modify()->setRelease(getOrCreateRelease(dbSession, *trackMetadata.medium->release, file.parent_path()));
+            track.modify()->setRelease(getOrCreateRelease(dbSession, *_resolutionCache, *trackMetadata.medium->release, file.parent_path()));
         else
             track.modify()->setRelease({});
         track.modify()->setTotalTrack(trackMetadata.medium ? trackMetadata.medium->trackCount : std::nullopt);
         track.modify()->setReleaseReplayGain(trackMetadata.medium ? trackMetadata.medium->replayGain : std::nullopt);
-        track.modify()->setDiscSubtitle(trackMetadata.medium ? trackMetadata.medium->name : "");
-        track.modify()->setClusters(getOrCreateClusters(dbSession, trackMetadata));
+        track.modify()->setClusters(getOrCreateClusters(dbSession, *_resolutionCache, trackMetadata));
+        setTrackFacets(dbSession, track->getId(), trackMetadata);
         track.modify()->setLastWriteTime(lastWriteTime);
+        track.modify()->setFileSize(fingerprint ? fingerprint->fileSize : 0);
+        track.modify()->setContentFingerprint(fingerprint ? std::optional<std::uint32_t>{ fingerprint->crc32 } : std::nullopt);
         track.modify()->setName(title);
         track.modify()->setDuration(trackMetadata.duration);
         track.modify()->setBitrate(trackMetadata.bitrate);
+        track.modify()->setDurationEstimated(trackMetadata.durationEstimated);
+        track.modify()->setCodec(trackMetadata.codec);
+        track.modify()->setContainer(trackMetadata.container);
+        track.modify()->setSampleRate(trackMetadata.sampleRate);
+        track.modify()->setChannelCount(trackMetadata.channelCount);
+        track.modify()->setAudioStreamIndex(trackMetadata.audioStreamIndex);
         track.modify()->setAddedTime(Wt::WDateTime::currentDateTime());
         track.modify()->setTrackNumber(trackMetadata.position);
         track.modify()->setDiscNumber(trackMetadata.medium ? trackMetadata.medium->position : std::nullopt);
@@ -631,12 +1469,21 @@ namespace Scanner
 
         track.modify()->setRecordingMBID(trackMetadata.recordingMBID);
         track.modify()->setTrackMBID(trackMetadata.mbid);
-        if (auto trackFeatures{ TrackFeatures::find(dbSession, track->getId()) })
-            trackFeatures.remove(); // TODO: only if MBID changed?
+        if (!isNewTrack)
+        {
+            if (auto trackFeatures{ TrackFeatures::find(dbSession, track->getId()) })
+                trackFeatures.remove(); // TODO: only if MBID changed?
+        }
         track.modify()->setHasCover(trackMetadata.hasCover);
-        track.modify()->setCopyright(trackMetadata.copyright);
-        track.modify()->setCopyrightURL(trackMetadata.copyrightURL);
         track.modify()->setTrackReplayGain(trackMetadata.replayGain);
+        track.modify()->setLoudnessAnalysisPending(!trackMetadata.replayGain);
         track.modify()->setArtistDisplayName(trackMetadata.artistDisplayName);
+
+        // last, as the track is flushed
+        Track::ExtraInfo extraInfo;
+        extraInfo.discSubtitle = trackMetadata.medium ? trackMetadata.medium->name : "";
+        extraInfo.copyright = trackMetadata.copyright;
+        extraInfo.copyrightURL = trackMetadata.copyrightURL;
+        Track::setExtraInfo(dbSession, track, extraInfo);
     }
 }
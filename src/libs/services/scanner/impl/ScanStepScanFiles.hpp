@@ -19,16 +19,27 @@
 
 #pragma once
 
-#include <condition_variable>
-#include <deque>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <exception>
 #include <filesystem>
+#include <memory>
 #include <mutex>
+#include <optional>
+#include <set>
 #include <span>
 #include <string>
 #include <vector>
 
+#include "database/MediaLibraryId.hpp"
+#include "database/TrackId.hpp"
 #include "metadata/IParser.hpp"
 #include "utils/IOContextRunner.hpp"
+#include "utils/MPSCQueue.hpp"
+#include "utils/Path.hpp"
+#include "RateLimiter.hpp"
 #include "ScanStepBase.hpp"
 
 namespace Scanner
@@ -37,50 +48,148 @@ namespace Scanner
     {
     public:
         ScanStepScanFiles(InitParams& initParams);
+        ~ScanStepScanFiles() override;
+
+        // Database entities prefetched for a whole batch of scan results
+        struct BatchLookups;
+        // Database entities resolved by MBID/name, kept during the whole scan
+        struct ResolutionCache;
 
     private:
         ScanStep getStep() const override { return ScanStep::ScanningFiles; }
         std::string_view getStepName() const override { return "Scanning files"; }
         void process(ScanContext& context) override;
 
-        bool checkFileNeedScan(ScanContext& context, const std::filesystem::path& file, const ScannerSettings::MediaLibraryInfo& libraryInfo);
+        bool checkFileNeedScan(const ScanContext& context, ScanStats& stats, const DiscoveredFile& discoveredFile, const ScannerSettings::MediaLibraryInfo& libraryInfo);
+        void saveScanCheckpoint(Database::MediaLibraryId mediaLibrary, const std::filesystem::path& lastProcessedFile);
+
+        // Compact in-memory snapshot of the already scanned files, sorted by path hash
+        struct FileScanInfo
+        {
+            std::size_t pathHash;
+            std::time_t lastWriteTime;
+            std::size_t scanVersion;
+            Database::MediaLibraryId mediaLibrary;
+            bool hashCollision; // several files share this hash, need to query the DB
+        };
+        void loadFileScanInfos();
+        const FileScanInfo* findFileScanInfo(const std::filesystem::path& file) const;
+        std::vector<FileScanInfo> _fileScanInfos;
+
+        // Content fingerprints of the already scanned files, sorted by file size then fingerprint
+        struct ContentFingerprintInfo
+        {
+            PathUtils::FileFingerprint fingerprint;
+            Database::TrackId trackId; // reset once matched with a moved file
+        };
+        bool updateMovedTrack(const ScanContext& context, ScanStats& stats, const DiscoveredFile& discoveredFile, const ScannerSettings::MediaLibraryInfo& libraryInfo); // returns true if the moved track does not need to be scanned
+        bool isFilePresent(const ScanContext& context, const std::filesystem::path& file) const;
+        std::vector<ContentFingerprintInfo> _contentFingerprintInfos;
+        std::mutex _contentFingerprintMutex; // matched entries are shared by the concurrent library scans
+
+        class MetadataScanQueue;
         struct MetaDataScanResult
         {
             std::filesystem::path path;
             std::unique_ptr<MetaData::Track> trackMetaData;
+            std::optional<PathUtils::FileFingerprint> fingerprint;
+            MetadataScanQueue* scanQueue{}; // queue that issued the scan request
+            std::uintmax_t fileSize{};
+            std::chrono::microseconds parseDuration{}; // 0 if not parsed (aborted scan)
         };
-        void processMetaDataScanResults(ScanContext& context, std::span<const MetaDataScanResult> scanResults, const ScannerSettings::MediaLibraryInfo& libraryInfo);
-        void processFileMetaData(ScanContext& context, const std::filesystem::path& file, const MetaData::Track& trackMetadata, const ScannerSettings::MediaLibraryInfo& libraryInfo);
+        void addParsePerformance(ScanPerformance& performance, std::span<const MetaDataScanResult> scanResults) const;
+        void processMetaDataScanResults(ScanStats& stats, std::span<const MetaDataScanResult> scanResults);
+        void processFileMetaData(ScanStats& stats, BatchLookups& lookups, Database::MediaLibraryId mediaLibrary, const std::filesystem::path& file, const MetaData::Track& trackMetadata, const std::optional<PathUtils::FileFingerprint>& fingerprint);
+
+        // Directories of the written, moved or removed tracks, merged in the scan context once done
+        void addChangedDirectory(const std::filesystem::path& directory);
+        std::mutex _changedDirectoriesMutex;
+        std::set<std::filesystem::path> _changedDirectories;
 
         std::unique_ptr<MetaData::IParser>  _metadataParser;
         const std::vector<std::string>      _extraTagsToParse;
+        const std::size_t                   _defaultScanThreadCount;
+        const std::size_t                   _slowestFileCount; // reported in the scan performance
+
+        // Scan results of all the media libraries, consumed by a single writer thread
+        class ScanResultQueue
+        {
+            public:
+                ScanResultQueue(std::size_t capacity);
 
+                void onScanRequestPosted() { _ongoingScanCount += 1; }
+                void push(MetaDataScanResult&& result); // called by the parser threads
+
+                // Single consumer: wait until maxCount results are available, or until all the ongoing scan requests are done (or a flush is requested)
+                // returns 0 once there are no more results and setNoMoreScanRequests(true) has been called
+                std::size_t waitAndPopResults(std::vector<MetaDataScanResult>& results, std::size_t maxCount);
+                void setNoMoreScanRequests(bool noMoreScanRequests);
+
+                // While a flush is requested, results are consumed as soon as possible, even if there are not enough to fill a batch
+                void beginFlush();
+                void endFlush() { _flushRequestCount -= 1; }
+
+            private:
+                void notifyResultsEvent();
+
+                // Results are pushed by the parser threads without locking, the consumer is only notified when it has something to do
+                Utils::MPSCQueue<MetaDataScanResult> _scanResults;
+                std::atomic<std::size_t> _ongoingScanCount{};
+                std::atomic<std::size_t> _resultCount{};
+                std::atomic<std::size_t> _resultsBatchSize{};
+                std::atomic<std::size_t> _flushRequestCount{};
+                std::atomic<bool> _noMoreScanRequests{};
+                std::atomic<std::uint32_t> _resultsEvent{};
+        };
+
+        // Parses the files of a media library, using its own threads and rate limits
         class MetadataScanQueue
         {
             public:
-                MetadataScanQueue(MetaData::IParser& parser, std::size_t threadCount);
+                MetadataScanQueue(MetaData::IParser& parser, ScanResultQueue& resultQueue, const ScannerSettings::MediaLibraryInfo& libraryInfo, std::size_t threadCount, std::size_t maxPendingCount, const bool& abortScan);
 
+                const ScannerSettings::MediaLibraryInfo& getLibraryInfo() const { return _libraryInfo; }
                 std::size_t getThreadCount() const { return _scanContextRunner.getThreadCount(); }
+                std::size_t getParsedCount() const { return _parsedCount; }
 
                 void pushScanRequest(const std::filesystem::path& path);
+                void onResultsWritten(std::size_t count); // called by the writer thread, once the results are written (or discarded)
 
-                std::size_t getResultsCount() const;
-                size_t popResults(std::vector<MetaDataScanResult>& results, std::size_t maxCount);
-
-                void wait(std::size_t maxScanRequestCount = 0); // wait until ongoing scan request count <= maxScanRequestCount
+                void wait(); // wait until the count of scan requests not written yet <= maxPendingCount
+                void waitAllWritten();
 
             private:
                 MetaData::IParser& _metadataParser;
+                ScanResultQueue& _resultQueue;
+                const ScannerSettings::MediaLibraryInfo& _libraryInfo;
+                const std::size_t _maxPendingCount;
+                const bool& _abortScan;
+                RateLimiter _filesRateLimiter;
+                RateLimiter _bytesRateLimiter;
+
+                std::atomic<std::size_t> _pendingCount{}; // scan requests not written yet
+                std::atomic<std::uint32_t> _writtenEvent{};
+                std::atomic<std::size_t> _parsedCount{};
+
+                // last, so that the parser threads are stopped first
                 boost::asio::io_context _scanContext;
                 IOContextRunner _scanContextRunner;
+        };
+        static constexpr std::size_t writeBatchSize{ 500 };
+        static constexpr std::size_t scanQueueMaxPendingCount{ 2 * writeBatchSize }; // per library, scan requests being parsed or waiting to be written
 
-                mutable std::mutex _mutex ;
-                std::size_t _ongoingScanCount{};
-                std::deque<MetaDataScanResult> _scanResults;
-                std::condition_variable _condVar;
+        // Each media library is checked in its own thread
+        struct LibraryScan
+        {
+            std::unique_ptr<MetadataScanQueue> scanQueue;
+            ScanStats stats;
+            std::atomic<std::size_t> processedCount{};
+            std::exception_ptr exception;
         };
-        MetadataScanQueue _metadataScanQueue;
+        void scanMediaLibrary(const ScanContext& context, LibraryScan& libraryScan, const std::atomic<bool>& writerFailed);
+        std::atomic<std::size_t> _writtenCount{};
 
-        std::deque<MetaDataScanResult> _metaDataScanResults;
+        void clearResolutionCache();
+        std::unique_ptr<ResolutionCache> _resolutionCache; // only used by the writer thread during the scan
     };
 }
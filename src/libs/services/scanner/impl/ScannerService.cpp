@@ -22,20 +22,33 @@
 #include <ctime>
 #include <boost/asio/placeholders.hpp>
 
+#include "database/CatalogueChange.hpp"
+#include "database/CatalogueSnapshot.hpp"
+#include "database/DirectorySignature.hpp"
 #include "database/MediaLibrary.hpp"
+#include "database/ScanError.hpp"
 #include "database/TrackFeatures.hpp"
 #include "database/ScanSettings.hpp"
+#include "database/Track.hpp"
 #include "utils/Exception.hpp"
 #include "utils/IConfig.hpp"
 #include "utils/ILogger.hpp"
+#include "utils/IMetricsRegistry.hpp"
 #include "utils/Path.hpp"
 #include "utils/Tuple.hpp"
 
+#include "ScanReports.hpp"
 #include "ScanStepCheckDuplicatedDbFiles.hpp"
 #include "ScanStepDiscoverFiles.hpp"
+#include "ScanStepFetchTrackFeatures.hpp"
+#include "ScanStepGenerateCovers.hpp"
+#include "ScanStepRefineDurations.hpp"
 #include "ScanStepRemoveOrphanDbFiles.hpp"
 #include "ScanStepScanFiles.hpp"
 #include "ScanStepComputeClusterStats.hpp"
+#include "ScanStepComputeLoudness.hpp"
+#include "ScanStepComputeSimilarities.hpp"
+#include "ScanStepComputeTrackFeatures.hpp"
 
 namespace Scanner
 {
@@ -43,6 +56,27 @@ namespace Scanner
 
     namespace
     {
+        std::string_view getScanStepMetricName(ScanStep step)
+        {
+            switch (step)
+            {
+            case ScanStep::DiscoveringFiles:            return "discover_files";
+            case ScanStep::ScanningFiles:               return "scan_files";
+            case ScanStep::ChekingForMissingFiles:      return "check_missing_files";
+            case ScanStep::CheckingForDuplicateFiles:   return "check_duplicated_files";
+            case ScanStep::ComputingTrackFeatures:      return "compute_track_features";
+            case ScanStep::ReloadingSimilarityEngine:   return "reload_similarity_engine";
+            case ScanStep::ComputeClusterStats:         return "compute_cluster_stats";
+            case ScanStep::ComputeSimilarities:         return "compute_similarities";
+            case ScanStep::GeneratingCovers:            return "generate_covers";
+            case ScanStep::RefiningDurations:           return "refine_durations";
+            case ScanStep::ComputingLoudness:           return "compute_loudness";
+            case ScanStep::FetchingTrackFeatures:       return "fetch_track_features";
+            }
+
+            return "unknown";
+        }
+
         Wt::WDate getNextMonday(Wt::WDate current)
         {
             do
@@ -72,9 +106,36 @@ namespace Scanner
     ScannerService::ScannerService(Db& db)
         : _db{ db }
         , _dbSession{ db }
+        , _scanReportsPath{ Service<IConfig>::get()->getPath("working-dir") / "scan-reports.json" }
+        , _scanReportMaxCount{ Service<IConfig>::get()->getULong("scanner-report-count", 5) }
+        , _watchEnabled{ Service<IConfig>::get()->getBool("scanner-watch-media-libraries", false) }
+        , _watchDebounceDelay{ Service<IConfig>::get()->getULong("scanner-watch-debounce-delay", 30) }
     {
         _ioService.setThreadCount(1);
 
+        if (Metrics::IRegistry * registry{ Service<Metrics::IRegistry>::get() })
+        {
+            // full scans may take hours
+            constexpr std::array<double, 9> scanDurationBuckets{ 1, 10, 60, 300, 900, 1800, 3600, 7200, 14400 };
+
+            _scanMetrics.inProgress = &registry->getGauge("lms_scanner_scan_in_progress", "Set to 1 while a scan is in progress");
+            _scanMetrics.completeScans = &registry->getCounter("lms_scanner_scans_total", "Scans run", { { "result", "complete" } });
+            _scanMetrics.abortedScans = &registry->getCounter("lms_scanner_scans_total", "Scans run", { { "result", "aborted" } });
+            _scanMetrics.scanDuration = &registry->getHistogram("lms_scanner_scan_duration_seconds", "Duration of the complete scans", scanDurationBuckets);
+            _scanMetrics.scannedFiles = &registry->getCounter("lms_scanner_files_total", "Files checked by the scans", { { "result", "scanned" } });
+            _scanMetrics.skippedFiles = &registry->getCounter("lms_scanner_files_total", "Files checked by the scans", { { "result", "skipped" } });
+            _scanMetrics.additions = &registry->getCounter("lms_scanner_changes_total", "Database changes made by the scans", { { "type", "addition" } });
+            _scanMetrics.deletions = &registry->getCounter("lms_scanner_changes_total", "Database changes made by the scans", { { "type", "deletion" } });
+            _scanMetrics.updates = &registry->getCounter("lms_scanner_changes_total", "Database changes made by the scans", { { "type", "update" } });
+            _scanMetrics.errors = &registry->getCounter("lms_scanner_errors_total", "Files that could not be scanned");
+            for (std::size_t i{}; i < _scanMetrics.processedElements.size(); ++i)
+                _scanMetrics.processedElements[i] = &registry->getCounter("lms_scanner_processed_elements_total", "Elements processed by the scan steps, updated while the steps are running", { { "step", std::string{ getScanStepMetricName(static_cast<ScanStep>(i)) } } });
+        }
+
+        _scanReports = loadScanReports(_scanReportsPath);
+        if (_scanReports.size() > _scanReportMaxCount)
+            _scanReports.resize(_scanReportMaxCount);
+
         refreshScanSettings();
 
         start();
@@ -84,6 +145,7 @@ namespace Scanner
     {
         LMS_LOG(DBUPDATER, INFO, "Stopping service...");
         stop();
+        _fileSystemWatcher.reset();
         LMS_LOG(DBUPDATER, INFO, "Service stopped!");
     }
 
@@ -96,7 +158,9 @@ namespace Scanner
                 if (_abortScan)
                     return;
 
-                scheduleNextScan();
+                publishCatalogueSnapshot();
+                if (!resumeInterruptedScan())
+                    scheduleNextScan();
             });
 
         _ioService.start();
@@ -108,6 +172,7 @@ namespace Scanner
 
         _abortScan = true;
         _scheduleTimer.cancel();
+        _watchTimer.cancel();
         _ioService.stop();
     }
 
@@ -126,12 +191,21 @@ namespace Scanner
 
         _abortScan = true;
         _scheduleTimer.cancel();
+        _watchTimer.cancel();
         _ioService.stop();
         LMS_LOG(DBUPDATER, DEBUG, "Scan abort done!");
 
         _abortScan = false;
         _ioService.start();
 
+        {
+            // pending changes are still to be scanned
+            std::scoped_lock watchLock{ _changedDirectoriesMutex };
+            _watchScanScheduled = false;
+            if (!_changedDirectories.empty())
+                _ioService.post([this] { scheduleWatchScan(); });
+        }
+
         if (isRunning)
             _events.scanAborted.emit();
     }
@@ -161,6 +235,7 @@ namespace Scanner
                 if (_abortScan)
                     return;
 
+                publishCatalogueSnapshot();
                 scheduleNextScan();
             });
     }
@@ -175,6 +250,7 @@ namespace Scanner
         res.nextScheduledScan = _nextScheduledScan;
         res.lastCompleteScanStats = _lastCompleteScanStats;
         res.currentScanStepStats = _currentScanStepStats;
+        res.lastScanReports = _scanReports;
 
         return res;
     }
@@ -232,6 +308,27 @@ namespace Scanner
         _events.scanScheduled.emit(_nextScheduledScan);
     }
 
+    bool ScannerService::resumeInterruptedScan()
+    {
+        refreshScanSettings();
+
+        bool force{};
+        {
+            auto transaction{ _dbSession.createReadTransaction() };
+
+            const ScanSettings::pointer scanSettings{ ScanSettings::get(_dbSession) };
+            if (scanSettings->getInterruptedScanVersion() != _settings.scanVersion)
+                return false;
+
+            force = scanSettings->isInterruptedScanForced();
+        }
+
+        LMS_LOG(DBUPDATER, INFO, "Resuming interrupted scan");
+        scheduleScan(force);
+
+        return true;
+    }
+
     void ScannerService::scheduleScan(bool force, const Wt::WDateTime& dateTime)
     {
         auto cb{ [this, force](boost::system::error_code ec)
@@ -260,7 +357,74 @@ namespace Scanner
         }
     }
 
-    void ScannerService::scan(bool forceScan)
+    void ScannerService::refreshFileSystemWatcher()
+    {
+        _fileSystemWatcher.reset();
+
+        if (!_watchEnabled || _settings.mediaLibraries.empty())
+            return;
+
+        std::vector<std::filesystem::path> rootDirectories;
+        for (const ScannerSettings::MediaLibraryInfo& mediaLibrary : _settings.mediaLibraries)
+            rootDirectories.push_back(mediaLibrary.rootDirectory);
+
+        try
+        {
+            _fileSystemWatcher = std::make_unique<FileSystemWatcher>(rootDirectories, ScanStepBase::excludeDirFileName, [this](const std::filesystem::path& directory)
+                {
+                    onDirectoryChanged(directory);
+                });
+        }
+        catch (const LmsException& e)
+        {
+            LMS_LOG(DBUPDATER, ERROR, "Cannot watch media libraries: " << e.what());
+        }
+    }
+
+    void ScannerService::onDirectoryChanged(const std::filesystem::path& directory)
+    {
+        // called from the watcher thread
+        std::scoped_lock lock{ _changedDirectoriesMutex };
+
+        LMS_LOG(DBUPDATER, DEBUG, "Change detected in '" << directory.string() << "'");
+        _changedDirectories.insert(directory.lexically_normal());
+
+        if (!_watchScanScheduled)
+        {
+            _watchScanScheduled = true;
+            _ioService.post([this] { scheduleWatchScan(); });
+        }
+    }
+
+    void ScannerService::scheduleWatchScan()
+    {
+        // Debounce: wait a bit so that all the changes made in the meantime are handled by the same scan
+        _watchTimer.expires_from_now(_watchDebounceDelay);
+        _watchTimer.async_wait([this](boost::system::error_code ec)
+            {
+                if (ec)
+                    return;
+
+                std::vector<std::filesystem::path> directories;
+                {
+                    std::scoped_lock lock{ _changedDirectoriesMutex };
+                    _watchScanScheduled = false;
+
+                    // Only keep top most directories, since sub directories are scanned recursively
+                    for (const std::filesystem::path& directory : _changedDirectories)
+                    {
+                        if (directories.empty() || !PathUtils::isPathInRootPath(directory, directories.back()))
+                            directories.push_back(directory);
+                    }
+                    _changedDirectories.clear();
+                }
+
+                if (!directories.empty())
+                    scan(false, directories);
+            });
+    }
+
+    void ScannerService::scan(bool forceScan, const std::vector<std::filesystem::path>& directories)
     {
         _events.scanStarted.emit();
 
@@ -271,31 +435,72 @@ namespace Scanner
         }
 
 
-        LMS_LOG(UI, INFO, "New scan started!");
+        if (directories.empty())
+            LMS_LOG(UI, INFO, "New scan started!");
+        else
+            LMS_LOG(UI, INFO, "New scan started on " << directories.size() << " changed directories!");
 
         refreshScanSettings();
 
-        IScanStep::ScanContext scanContext{ forceScan, ScanStats {}, ScanStepStats {} };
+        if (_scanMetrics.inProgress)
+            _scanMetrics.inProgress->set(1);
+
+        IScanStep::ScanContext scanContext{ forceScan, directories, ScanStats {}, ScanStepStats {} };
         ScanStats& stats{ scanContext.stats };
         stats.startTime = Wt::WDateTime::currentDateTime();
 
+        // only the errors of the last scan are kept
+        {
+            auto transaction{ _dbSession.createWriteTransaction() };
+            Database::ScanError::clear(_dbSession);
+        }
+
+        {
+            auto transaction{ _dbSession.createReadTransaction() };
+            scanContext.catalogueChangeIdAtStart = Database::CatalogueChange::getLastChangeId(_dbSession);
+        }
+
+        // Only full scans are checkpointed, scans on changed directories are expected to be short
+        if (directories.empty())
+            prepareScanCheckpoints(scanContext);
+
         for (auto& scanStep : _scanSteps)
         {
             LMS_LOG(DBUPDATER, DEBUG, "Starting scan step '" << scanStep->getStepName() << "'");
             scanContext.currentStepStats = ScanStepStats{ Wt::WDateTime::currentDateTime(), scanStep->getStep() };
 
             notifyInProgress(scanContext.currentStepStats);
+            const auto stepStartTime{ std::chrono::steady_clock::now() };
             scanStep->process(scanContext);
+            const auto stepDuration{ std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - stepStartTime) };
             notifyInProgress(scanContext.currentStepStats);
-            LMS_LOG(DBUPDATER, DEBUG, "Completed scan step '" << scanStep->getStepName() << "'");
+            LMS_LOG(DBUPDATER, DEBUG, "Completed scan step '" << scanStep->getStepName() << "' in " << stepDuration.count() << " ms");
+
+            stats.performance.steps.push_back(ScanPerformance::Step{ scanStep->getStep(), stepDuration, scanContext.currentStepStats.processedElems });
         }
 
-        LMS_LOG(DBUPDATER, INFO, "Scan " << (_abortScan ? "aborted" : "complete") << ". Changes = " << stats.nbChanges() << " (added = " << stats.additions << ", removed = " << stats.deletions << ", updated = " << stats.updates << "), Not changed = " << stats.skips << ", Scanned = " << stats.scans << " (errors = " << stats.errors.size() << "), features fetched = " << stats.featuresFetched << ",  duplicates = " << stats.duplicates.size());
+        LMS_LOG(DBUPDATER, INFO, "Scan " << (_abortScan ? "aborted" : "complete") << ". Changes = " << stats.nbChanges() << " (added = " << stats.additions << ", removed = " << stats.deletions << ", updated = " << stats.updates << "), Not changed = " << stats.skips << ", Scanned = " << stats.scans << " (errors = " << stats.errorCount << "), features fetched = " << stats.featuresFetched << ",  duplicates = " << stats.duplicates.size());
+
+        reportScanMetrics(stats, _abortScan);
+        if (stats.performance.parseDuration.count() > 0)
+        {
+            LMS_LOG(DBUPDATER, INFO, "Parsed " << stats.performance.bytesRead / (1024 * 1024) << " MiB in " << stats.performance.parseDuration.count() / 1000 << " ms (cumulated over the parser threads), database updates took " << stats.performance.dbDuration.count() / 1000 << " ms"
+                << (stats.performance.slowestFiles.empty() ? "" : ", slowest file to parse is '" + stats.performance.slowestFiles.front().file.string() + "' (" + std::to_string(stats.performance.slowestFiles.front().parseDuration.count() / 1000) + " ms)"));
+        }
 
         _dbSession.analyze();
 
+        if (!_abortScan && stats.nbChanges() > 0)
+            publishCatalogueSnapshot();
+
         if (!_abortScan)
         {
+            if (directories.empty())
+            {
+                clearScanCheckpoints();
+                saveDirectorySignatures(scanContext);
+            }
+
             stats.stopTime = Wt::WDateTime::currentDateTime();
             {
                 std::unique_lock lock{ _statusMutex };
@@ -303,11 +508,13 @@ namespace Scanner
                 _lastCompleteScanStats = stats;
                 _currentScanStepStats.reset();
             }
+            addScanReport(stats);
 
             LMS_LOG(DBUPDATER, DEBUG, "Scan not aborted, scheduling next scan!");
             scheduleNextScan();
 
-            _events.scanComplete.emit(stats);
+            notifyCoverChanges(scanContext);
+            _events.scanComplete.emit(ScanSummary{ stats });
         }
         else
         {
@@ -320,6 +527,20 @@ namespace Scanner
         }
     }
 
+    void ScannerService::publishCatalogueSnapshot()
+    {
+        LMS_LOG(DBUPDATER, DEBUG, "Building catalogue snapshot...");
+
+        std::shared_ptr<const CatalogueSnapshot> snapshot;
+        {
+            auto transaction{ _dbSession.createReadTransaction() };
+            snapshot = CatalogueSnapshot::build(_dbSession);
+        }
+        _db.publishCatalogueSnapshot(std::move(snapshot));
+
+        LMS_LOG(DBUPDATER, DEBUG, "Catalogue snapshot published");
+    }
+
     void ScannerService::refreshScanSettings()
     {
         ScannerSettings newSettings{ readSettings() };
@@ -349,8 +570,91 @@ namespace Scanner
         _scanSteps.push_back(std::make_unique<ScanStepDiscoverFiles>(params));
         _scanSteps.push_back(std::make_unique<ScanStepScanFiles>(params));
         _scanSteps.push_back(std::make_unique<ScanStepRemoveOrphanDbFiles>(params));
+        _scanSteps.push_back(std::make_unique<ScanStepComputeLoudness>(params));
+        _scanSteps.push_back(std::make_unique<ScanStepFetchTrackFeatures>(params));
+        _scanSteps.push_back(std::make_unique<ScanStepComputeTrackFeatures>(params));
         _scanSteps.push_back(std::make_unique<ScanStepComputeClusterStats>(params));
+        _scanSteps.push_back(std::make_unique<ScanStepComputeSimilarities>(params));
         _scanSteps.push_back(std::make_unique<ScanStepCheckDuplicatedDbFiles>(params));
+        _scanSteps.push_back(std::make_unique<ScanStepGenerateCovers>(params));
+        _scanSteps.push_back(std::make_unique<ScanStepRefineDurations>(params));
+
+        refreshFileSystemWatcher();
+    }
+
+    void ScannerService::prepareScanCheckpoints(IScanStep::ScanContext& context)
+    {
+        auto transaction{ _dbSession.createWriteTransaction() };
+
+        ScanSettings::pointer scanSettings{ ScanSettings::get(_dbSession) };
+
+        // Files processed by an interrupted scan can be skipped, unless this scan is more demanding
+        const bool resume{ scanSettings->getInterruptedScanVersion() == _settings.scanVersion && (scanSettings->isInterruptedScanForced() || !context.forceScan) };
+
+        MediaLibrary::find(_dbSession, [&](const MediaLibrary::pointer& mediaLibrary)
+            {
+                if (!resume)
+                    mediaLibrary.modify()->setScanCheckpoint({});
+                else if (!mediaLibrary->getScanCheckpoint().empty())
+                    context.scanCheckpoints.emplace(mediaLibrary->getId(), mediaLibrary->getScanCheckpoint());
+            });
+
+        if (resume)
+            LMS_LOG(DBUPDATER, INFO, "Resuming interrupted scan from " << context.scanCheckpoints.size() << " media library checkpoint(s)");
+
+        scanSettings.modify()->setInterruptedScan(_settings.scanVersion, context.forceScan);
+    }
+
+    void ScannerService::clearScanCheckpoints()
+    {
+        auto transaction{ _dbSession.createWriteTransaction() };
+
+        ScanSettings::get(_dbSession).modify()->clearInterruptedScan();
+        MediaLibrary::find(_dbSession, [&](const MediaLibrary::pointer& mediaLibrary)
+            {
+                mediaLibrary.modify()->setScanCheckpoint({});
+            });
+    }
+
+    void ScannerService::notifyCoverChanges(const IScanStep::ScanContext& context)
+    {
+        if (context.changedDirectories.empty())
+            return;
+
+        // Covers are searched in the track directories and in their parent directories (multi disc releases, artist directories)
+        // Tracks located in sub directories of a changed directory are therefore impacted as well
+        CoverChanges changes;
+        {
+            auto transaction{ _dbSession.createReadTransaction() };
+
+            std::filesystem::path lastDirectory;
+            for (const std::filesystem::path& directory : context.changedDirectories)
+            {
+                // sorted: sub directories follow their parent directory
+                if (!lastDirectory.empty() && PathUtils::isPathInRootPath(directory, lastDirectory))
+                    continue;
+                lastDirectory = directory;
+
+                for (const Track::PathResult& trackPath : Track::findPathsInDirectory(_dbSession, directory).results)
+                    changes.tracks.push_back(trackPath.trackId);
+                const auto releaseIds{ Track::findReleaseIdsInDirectory(_dbSession, directory).results };
+                changes.releases.insert(std::end(changes.releases), std::cbegin(releaseIds), std::cend(releaseIds));
+                const auto artistIds{ Track::findArtistIdsInDirectory(_dbSession, directory).results };
+                changes.artists.insert(std::end(changes.artists), std::cbegin(artistIds), std::cend(artistIds));
+            }
+        }
+
+        LMS_LOG(DBUPDATER, DEBUG, "Covers may have changed in " << context.changedDirectories.size() << " directories: " << changes.tracks.size() << " tracks, " << changes.releases.size() << " releases, " << changes.artists.size() << " artists");
+        _events.coversChanged.emit(changes);
+    }
+
+    void ScannerService::saveDirectorySignatures(const IScanStep::ScanContext& context)
+    {
+        if (!context.discoveryComplete)
+            return;
+
+        auto transaction{ _dbSession.createWriteTransaction() };
+        DirectorySignature::setAll(_dbSession, context.directorySignatures);
     }
 
     ScannerSettings ScannerService::readSettings()
@@ -376,7 +680,7 @@ namespace Scanner
 
             MediaLibrary::find(_dbSession, [&](const MediaLibrary::pointer& mediaLibrary)
                 {
-                    newSettings.mediaLibraries.push_back(ScannerSettings::MediaLibraryInfo{ mediaLibrary->getId(), mediaLibrary->getPath().lexically_normal() });
+                    newSettings.mediaLibraries.push_back(ScannerSettings::MediaLibraryInfo{ mediaLibrary->getId(), mediaLibrary->getPath().lexically_normal(), mediaLibrary->getScanThreadCount(), mediaLibrary->getScanMaxFilesPerSecond(), mediaLibrary->getScanMaxBytesPerSecond() });
                 });
 
             {
@@ -391,6 +695,41 @@ namespace Scanner
         return newSettings;
     }
 
+    void ScannerService::reportScanMetrics(const ScanStats& stats, bool aborted)
+    {
+        if (!_scanMetrics.inProgress)
+            return;
+
+        _scanMetrics.inProgress->set(0);
+        (aborted ? _scanMetrics.abortedScans : _scanMetrics.completeScans)->inc();
+        if (!aborted)
+            _scanMetrics.scanDuration->observe(std::chrono::seconds{ stats.startTime.secsTo(Wt::WDateTime::currentDateTime()) });
+        _scanMetrics.scannedFiles->inc(stats.scans);
+        _scanMetrics.skippedFiles->inc(stats.skips);
+        _scanMetrics.additions->inc(stats.additions);
+        _scanMetrics.deletions->inc(stats.deletions);
+        _scanMetrics.updates->inc(stats.updates);
+        _scanMetrics.errors->inc(stats.errorCount);
+    }
+
+    void ScannerService::addScanReport(const ScanStats& stats)
+    {
+        if (_scanReportMaxCount == 0)
+            return;
+
+        std::vector<ScanReport> scanReports;
+        {
+            std::unique_lock lock{ _statusMutex };
+
+            _scanReports.insert(std::begin(_scanReports), ScanReport{ stats });
+            if (_scanReports.size() > _scanReportMaxCount)
+                _scanReports.resize(_scanReportMaxCount);
+            scanReports = _scanReports;
+        }
+
+        saveScanReports(_scanReportsPath, scanReports);
+    }
+
     void ScannerService::notifyInProgress(const ScanStepStats& stepStats)
     {
         {
@@ -398,6 +737,17 @@ namespace Scanner
             _currentScanStepStats = stepStats;
         }
 
+        if (Metrics::Counter * processedElements{ _scanMetrics.processedElements[static_cast<std::size_t>(stepStats.currentStep)] })
+        {
+            if (stepStats.currentStep != _scanMetrics.reportedStep || stepStats.processedElems < _scanMetrics.reportedProcessedElems)
+            {
+                _scanMetrics.reportedStep = stepStats.currentStep;
+                _scanMetrics.reportedProcessedElems = 0;
+            }
+            processedElements->inc(stepStats.processedElems - _scanMetrics.reportedProcessedElems);
+            _scanMetrics.reportedProcessedElems = stepStats.processedElems;
+        }
+
         const std::chrono::system_clock::time_point now{ std::chrono::system_clock::now() };
         _events.scanInProgress(stepStats);
         _lastScanInProgressEmit = now;
@@ -19,9 +19,13 @@
 
 #pragma once
 
+#include <array>
 #include <chrono>
+#include <memory>
+#include <mutex>
 #include <shared_mutex>
 #include <optional>
+#include <set>
 #include <vector>
 
 #include <Wt/WDateTime.h>
@@ -35,6 +39,14 @@
 #include "database/Types.hpp"
 #include "services/scanner/IScannerService.hpp"
 #include "utils/Path.hpp"
+
+namespace Metrics
+{
+    class Counter;
+    class Gauge;
+    class Histogram;
+}
+#include "FileSystemWatcher.hpp"
 #include "IScanStep.hpp"
 #include "ScannerSettings.hpp"
 
@@ -63,22 +75,36 @@ namespace Scanner
         // Job handling
         void scheduleNextScan();
         void scheduleScan(bool force, const Wt::WDateTime& dateTime = {});
+        bool resumeInterruptedScan(); // returns true if an interrupted scan has been scheduled
 
         void abortScan();
 
         // Update database (scheduled callback)
-        void scan(bool force);
+        // If directories is not empty, only scan these directories
+        void scan(bool force, const std::vector<std::filesystem::path>& directories = {});
+
+        // Watch mode
+        void refreshFileSystemWatcher();
+        void onDirectoryChanged(const std::filesystem::path& directory);
+        void scheduleWatchScan();
 
         void scanMediaDirectory(const std::filesystem::path& mediaDirectory, bool forceScan, ScanStats& stats);
 
         // Helpers
         void refreshScanSettings();
+        void prepareScanCheckpoints(IScanStep::ScanContext& context);
+        void clearScanCheckpoints();
+        void saveDirectorySignatures(const IScanStep::ScanContext& context);
+        void notifyCoverChanges(const IScanStep::ScanContext& context);
+        void publishCatalogueSnapshot();
         ScannerSettings readSettings();
         void reloadRecommendationService();
 
         void notifyInProgressIfNeeded(const ScanStepStats& stats);
         void notifyInProgress(const ScanStepStats& stats);
         void reloadSimilarityEngine(ScanStats& stats);
+        void reportScanMetrics(const ScanStats& stats, bool aborted);
+        void addScanReport(const ScanStats& stats);
 
         std::vector<std::unique_ptr<IScanStep>>	_scanSteps;
 
@@ -95,9 +121,42 @@ namespace Scanner
         State								_curState{ State::NotScheduled };
         std::optional<ScanStats> 			_lastCompleteScanStats;
         std::optional<ScanStepStats> 		_currentScanStepStats;
+        std::vector<ScanReport>             _scanReports; // most recent first
         Wt::WDateTime						_nextScheduledScan;
 
         ScannerSettings						_settings;
+
+        const std::filesystem::path             _scanReportsPath;
+        const std::size_t                       _scanReportMaxCount;
+
+        const bool                              _watchEnabled;
+        const std::chrono::seconds              _watchDebounceDelay;
+        boost::asio::system_timer				_watchTimer{ _ioService };
+        std::mutex                              _changedDirectoriesMutex;
+        std::set<std::filesystem::path>         _changedDirectories;
+        bool                                    _watchScanScheduled{};
+        std::unique_ptr<FileSystemWatcher>      _fileSystemWatcher;
+
+        // null if metrics are not collected
+        struct ScanMetrics
+        {
+            Metrics::Gauge* inProgress{};
+            Metrics::Counter* completeScans{};
+            Metrics::Counter* abortedScans{};
+            Metrics::Histogram* scanDuration{};
+            Metrics::Counter* scannedFiles{};
+            Metrics::Counter* skippedFiles{};
+            Metrics::Counter* additions{};
+            Metrics::Counter* deletions{};
+            Metrics::Counter* updates{};
+            Metrics::Counter* errors{};
+            std::array<Metrics::Counter*, ScanProgressStepCount> processedElements{}; // indexed by ScanStep
+
+            // processed elements reported so far for the current step
+            ScanStep reportedStep{};
+            std::size_t reportedProcessedElems{};
+        };
+        ScanMetrics                             _scanMetrics;
     };
 } // Scanner
 
@@ -43,6 +43,9 @@ namespace Scanner
         {
             Database::MediaLibraryId id;
             std::filesystem::path rootDirectory;
+            std::size_t scanThreadCount{};      // 0 means use the default thread count
+            std::size_t maxFilesPerSecond{};    // 0 means unlimited
+            std::size_t maxBytesPerSecond{};    // 0 means unlimited
 
             bool operator<=>(const MediaLibraryInfo& other) const = default;
         };
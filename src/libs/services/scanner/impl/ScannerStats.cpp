@@ -40,6 +40,40 @@ ScanStats::nbChanges() const
 	return additions + deletions + updates;
 }
 
+void
+ScanStats::addError(ScanError error)
+{
+	errorCount++;
+	if (errors.size() < maxErrorSampleCount)
+		errors.push_back(std::move(error));
+}
+
+ScanSummary::ScanSummary(const ScanStats& stats)
+: startTime {stats.startTime},
+stopTime {stats.stopTime},
+skips {stats.skips},
+scans {stats.scans},
+additions {stats.additions},
+deletions {stats.deletions},
+updates {stats.updates},
+featuresFetched {stats.featuresFetched},
+imageFileChanges {stats.imageFileChanges},
+errorCount {stats.errorCount},
+duplicateCount {stats.duplicates.size()}
+{
+}
+
+ScanReport::ScanReport(const ScanStats& stats)
+: startTime {stats.startTime},
+stopTime {stats.stopTime},
+fileCount {stats.nbFiles()},
+scanCount {stats.scans},
+changeCount {stats.nbChanges()},
+errorCount {stats.errorCount},
+performance {stats.performance}
+{
+}
+
 unsigned
 ScanStepStats::progress() const
 {
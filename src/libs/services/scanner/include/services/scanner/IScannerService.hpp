@@ -20,6 +20,7 @@
 #pragma once
 
 #include <optional>
+#include <vector>
 
 #include "ScannerEvents.hpp"
 #include "ScannerStats.hpp"
@@ -55,6 +56,7 @@ namespace Scanner
 				Wt::WDateTime						nextScheduledScan;
 				std::optional<ScanStats>			lastCompleteScanStats;
 				std::optional<ScanStepStats> 		currentScanStepStats;
+				std::vector<ScanReport>				lastScanReports; // most recent first
 			};
 
 			virtual Status getStatus() const = 0;
@@ -63,6 +65,8 @@ namespace Scanner
 	};
 
 	std::unique_ptr<IScannerService> createScannerService(Database::Db& db);
+	// Does not scan, only follows the scans made by another process using the same database (see worker-count)
+	std::unique_ptr<IScannerService> createPassiveScannerService(Database::Db& db);
 
 } // Scanner
 
@@ -19,14 +19,27 @@
 
 #pragma once
 
+#include <vector>
+
 #include <Wt/WDateTime.h>
 #include <Wt/WSignal.h>
 
+#include "database/ArtistId.hpp"
+#include "database/ReleaseId.hpp"
+#include "database/TrackId.hpp"
 #include "ScannerStats.hpp"
 
 namespace Scanner
 {
 
+    // Entities whose cover or image may have changed during a scan
+    struct CoverChanges
+    {
+        std::vector<Database::TrackId> tracks;
+        std::vector<Database::ReleaseId> releases;
+        std::vector<Database::ArtistId> artists;
+    };
+
     struct Events
     {
         // Called if scan was aborted
@@ -35,8 +48,11 @@ namespace Scanner
         // Called just after scan start
         Wt::Signal<> 				scanStarted;
 
-        // Called just after scan complete (true if changes have been made)
-        Wt::Signal<ScanStats>		scanComplete;
+        // Called just after scan complete, the errors are stored in the database (see Database::ScanError)
+        Wt::Signal<ScanSummary>		scanComplete;
+
+        // Called just before scanComplete, if some covers may have changed
+        Wt::Signal<CoverChanges>	coversChanged;
 
         // Called during scan in progress
         Wt::Signal<ScanStepStats>	scanInProgress;
@@ -21,7 +21,10 @@
 
 #include <Wt/WDateTime.h>
 
+#include <chrono>
+#include <cstdint>
 #include <filesystem>
+#include <string>
 #include <vector>
 
 #include "database/TrackId.hpp"
@@ -63,11 +66,16 @@ namespace Scanner
         ScanningFiles,
         ChekingForMissingFiles,
         CheckingForDuplicateFiles,
-        FetchingTrackFeatures,
+        ComputingTrackFeatures,
         ReloadingSimilarityEngine,
         ComputeClusterStats,
+        ComputeSimilarities,
+        GeneratingCovers,
+        RefiningDurations,
+        ComputingLoudness,
+        FetchingTrackFeatures,
     };
-    static inline constexpr unsigned ScanProgressStepCount{ 7 };
+    static inline constexpr unsigned ScanProgressStepCount{ 12 };
 
     // reduced scan stats
     struct ScanStepStats
@@ -79,9 +87,38 @@ namespace Scanner
         std::size_t	totalElems{};
         std::size_t	processedElems{};
 
+        // per stage counters, for pipelined steps
+        std::size_t	parsedElems{};
+        std::size_t	writtenElems{};
+
         unsigned		progress() const;
     };
 
+    // Where the time goes during a scan
+    struct ScanPerformance
+    {
+        struct Step
+        {
+            ScanStep                    step;
+            std::chrono::milliseconds   duration{};
+            std::size_t                 processedElems{};
+        };
+
+        struct SlowFile
+        {
+            std::filesystem::path       file;
+            std::string                 format;         // container/codec, empty if the file could not be parsed
+            std::uintmax_t              size{};
+            std::chrono::microseconds   parseDuration{};
+        };
+
+        std::vector<Step>           steps;          // in execution order
+        std::uintmax_t              bytesRead{};    // size of the parsed files
+        std::chrono::microseconds   parseDuration{}; // cumulated over all the parser threads
+        std::chrono::microseconds   dbDuration{};   // spent by the writer to update the database with the parsed files
+        std::vector<SlowFile>       slowestFiles;   // the slowest to parse first, see scanner-report-slowest-file-count
+    };
+
     struct ScanStats
     {
         Wt::WDateTime	startTime;
@@ -96,13 +133,60 @@ namespace Scanner
         std::size_t	deletions{};		// removed from DB
         std::size_t	updates{};			// updated file in DB
 
-        std::size_t	featuresFetched{};	// features fetched in DB
+        std::size_t	featuresFetched{};	// features computed and added in DB
+
+        std::size_t	imageFileChanges{};	// image files added, removed or modified
 
-        std::vector<ScanError>		errors;
+        std::size_t	errorCount{};		// all the errors, stored in the database
+        std::vector<ScanError>		errors;		// only the first ones, see maxErrorSampleCount
         std::vector<ScanDuplicate>	duplicates;
 
+        ScanPerformance performance;
+
+        static constexpr std::size_t maxErrorSampleCount{ 100 };
+
         std::size_t	nbFiles() const;
         std::size_t	nbChanges() const;
+
+        void		addError(ScanError error); // counted and sampled, not stored
+    };
+
+    // Counters of a complete scan, sent to the scanComplete listeners
+    struct ScanSummary
+    {
+        Wt::WDateTime	startTime;
+        Wt::WDateTime	stopTime;
+
+        std::size_t	skips{};
+        std::size_t	scans{};
+        std::size_t	additions{};
+        std::size_t	deletions{};
+        std::size_t	updates{};
+        std::size_t	featuresFetched{};
+        std::size_t	imageFileChanges{};
+        std::size_t	errorCount{};
+        std::size_t	duplicateCount{};
+
+        ScanSummary() = default;
+        ScanSummary(const ScanStats& stats);
+
+        std::size_t	nbFiles() const { return skips + additions + updates; }
+        std::size_t	nbChanges() const { return additions + deletions + updates; }
+    };
+
+    // Summary of a complete scan, the last ones are kept across restarts (see scanner-report-count)
+    struct ScanReport
+    {
+        Wt::WDateTime   startTime;
+        Wt::WDateTime   stopTime;
+        std::size_t     fileCount{};    // see ScanStats::nbFiles
+        std::size_t     scanCount{};    // actually scanned files
+        std::size_t     changeCount{};
+        std::size_t     errorCount{};
+        ScanPerformance performance;
+
+        ScanReport() = default;
+        ScanReport(const ScanStats& stats);
     };
 } // namespace Scanner
 
@@ -22,7 +22,9 @@
 #include <chrono>
 #include <memory>
 #include <optional>
+#include <vector>
 
+#include "database/UserId.hpp"
 #include "services/scrobbling/Listen.hpp"
 
 namespace Database
@@ -43,6 +45,9 @@ namespace Scrobbling
         virtual void listenStarted(const Listen& listen) = 0;
         virtual void listenFinished(const Listen& listen, std::optional<std::chrono::seconds> duration) = 0;
         virtual void addTimedListen(const TimedListen& listen) = 0;
+
+        // Listens of this user that are not in the database yet
+        virtual std::vector<TimedListen> getPendingListens(Database::UserId userId) const = 0;
     };
 } // ns Scrobbling
 
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ListenStatsCache.hpp"
+
+#include <utility>
+
+namespace Scrobbling
+{
+    std::uint64_t ListenStatsCache::getGeneration() const
+    {
+        const std::shared_lock lock{ _mutex };
+        return _generation;
+    }
+
+    void ListenStatsCache::put(Database::UserId userId, Database::ScrobblingBackend backend, TrackStatsContainer stats, std::uint64_t generation)
+    {
+        const std::unique_lock lock{ _mutex };
+
+        if (generation != _generation) // listens have been added meanwhile
+            return;
+
+        _stats[userId].insert_or_assign(backend, LoadedStats{ std::move(stats), std::chrono::steady_clock::now() });
+    }
+
+    void ListenStatsCache::onListenAdded(Database::UserId userId, Database::ScrobblingBackend backend, Database::TrackId trackId, const Wt::WDateTime& listenedAt)
+    {
+        const std::unique_lock lock{ _mutex };
+
+        _generation++;
+
+        TrackStatsContainer* stats{ findStats(userId, backend) };
+        if (!stats)
+            return;
+
+        IScrobblingService::TrackListenStats& trackStats{ (*stats)[trackId] };
+        trackStats.count++;
+        if (!trackStats.lastListenDateTime.isValid() || listenedAt > trackStats.lastListenDateTime)
+            trackStats.lastListenDateTime = listenedAt;
+    }
+
+    void ListenStatsCache::invalidate(Database::UserId userId)
+    {
+        const std::unique_lock lock{ _mutex };
+
+        _generation++;
+        _stats.erase(userId);
+    }
+
+    ListenStatsCache::TrackStatsContainer* ListenStatsCache::findStats(Database::UserId userId, Database::ScrobblingBackend backend)
+    {
+        return const_cast<TrackStatsContainer*>(std::as_const(*this).findStats(userId, backend));
+    }
+
+    const ListenStatsCache::TrackStatsContainer* ListenStatsCache::findStats(Database::UserId userId, Database::ScrobblingBackend backend) const
+    {
+        const auto itUser{ _stats.find(userId) };
+        if (itUser == std::cend(_stats))
+            return nullptr;
+
+        const auto itStats{ itUser->second.find(backend) };
+        if (itStats == std::cend(itUser->second))
+            return nullptr;
+
+        if (_maxAge.count() > 0 && std::chrono::steady_clock::now() - itStats->second.loadTime > _maxAge)
+            return nullptr;
+
+        return &itStats->second.stats;
+    }
+} // ns Scrobbling
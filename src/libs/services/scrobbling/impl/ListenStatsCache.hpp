@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+#include <Wt/WDateTime.h>
+
+#include "database/TrackId.hpp"
+#include "database/Types.hpp"
+#include "database/UserId.hpp"
+#include "services/scrobbling/IScrobblingService.hpp"
+
+namespace Scrobbling
+{
+    // Per track listen stats of the users, per scrobbling backend, loaded on first use so that annotations do not hit the database
+    // Only the listens written in the database are accounted for: the backends report each listen they write
+    // Entries are tagged with the generation in use when their load started: stale loads are not cached
+    // Entries older than maxAge are reloaded, so that the changes made by other processes are eventually seen (0 means no limit)
+    class ListenStatsCache
+    {
+    public:
+        using TrackStatsContainer = IScrobblingService::TrackListenStatsContainer;
+
+        explicit ListenStatsCache(std::chrono::seconds maxAge) : _maxAge{ maxAge } {}
+
+        ListenStatsCache(const ListenStatsCache&) = delete;
+        ListenStatsCache& operator=(const ListenStatsCache&) = delete;
+
+        // func is called with the stats of the user, under lock. Returns false if they are not loaded yet
+        template <typename Func>
+        bool visit(Database::UserId userId, Database::ScrobblingBackend backend, Func&& func) const
+        {
+            const std::shared_lock lock{ _mutex };
+
+            const TrackStatsContainer* stats{ findStats(userId, backend) };
+            if (!stats)
+                return false;
+
+            func(*stats);
+            return true;
+        }
+
+        std::uint64_t getGeneration() const;
+        void put(Database::UserId userId, Database::ScrobblingBackend backend, TrackStatsContainer stats, std::uint64_t generation);
+
+        // to be called once the listen is committed
+        void onListenAdded(Database::UserId userId, Database::ScrobblingBackend backend, Database::TrackId trackId, const Wt::WDateTime& listenedAt);
+        void invalidate(Database::UserId userId);
+
+    private:
+        // must be called with _mutex held
+        TrackStatsContainer* findStats(Database::UserId userId, Database::ScrobblingBackend backend);
+        const TrackStatsContainer* findStats(Database::UserId userId, Database::ScrobblingBackend backend) const;
+
+        struct LoadedStats
+        {
+            TrackStatsContainer stats;
+            std::chrono::steady_clock::time_point loadTime;
+        };
+
+        const std::chrono::seconds _maxAge;
+        mutable std::shared_mutex _mutex;
+        std::uint64_t _generation{};
+        std::unordered_map<Database::UserId, std::unordered_map<Database::ScrobblingBackend, LoadedStats>> _stats;
+    };
+} // ns Scrobbling
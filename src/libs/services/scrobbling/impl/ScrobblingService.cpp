@@ -19,6 +19,9 @@
 
 #include "ScrobblingService.hpp"
 
+#include <algorithm>
+#include <utility>
+
 #include "database/Artist.hpp"
 #include "database/Db.hpp"
 #include "database/Listen.hpp"
@@ -26,7 +29,10 @@
 #include "database/Session.hpp"
 #include "database/Track.hpp"
 #include "database/User.hpp"
+#include "utils/IConfig.hpp"
 #include "utils/ILogger.hpp"
+#include "utils/ITraceLogger.hpp"
+#include "utils/Service.hpp"
 
 #include "internal/InternalBackend.hpp"
 #include "listenbrainz/ListenBrainzBackend.hpp"
@@ -45,6 +51,7 @@ namespace Scrobbling
             listenFindParams.setRange(params.range);
             listenFindParams.setMediaLibrary(params.library);
             listenFindParams.setArtist(params.artist);
+            listenFindParams.setPeriod(params.period);
 
             return listenFindParams;
         }
@@ -53,6 +60,15 @@ namespace Scrobbling
         {
             return Database::Listen::ArtistStatsFindParameters{ convertToListenFindParameters(static_cast<const ScrobblingService::FindParameters&>(params)), params.linkType };
         }
+
+        std::chrono::seconds getListenStatsCacheMaxAge()
+        {
+            // only the other workers may write listens in the same database behind the back of the service
+            if (Service<IConfig>::get()->getULong("worker-count", 1) <= 1)
+                return std::chrono::seconds{ 0 };
+
+            return std::chrono::seconds{ Service<IConfig>::get()->getULong("annotation-cache-max-age", 10) };
+        }
     }
 
     std::unique_ptr<IScrobblingService> createScrobblingService(boost::asio::io_context& ioContext, Db& db)
@@ -62,10 +78,11 @@ namespace Scrobbling
 
     ScrobblingService::ScrobblingService(boost::asio::io_context& ioContext, Db& db)
         : _db{ db }
+        , _listenStatsCache{ getListenStatsCacheMaxAge() }
     {
         LMS_LOG(SCROBBLING, INFO, "Starting service...");
-        _scrobblingBackends.emplace(ScrobblingBackend::Internal, std::make_unique<InternalBackend>(_db));
-        _scrobblingBackends.emplace(ScrobblingBackend::ListenBrainz, std::make_unique<ListenBrainz::ListenBrainzBackend>(ioContext, _db));
+        _scrobblingBackends.emplace(ScrobblingBackend::Internal, std::make_unique<InternalBackend>(ioContext, _db, _listenStatsCache));
+        _scrobblingBackends.emplace(ScrobblingBackend::ListenBrainz, std::make_unique<ListenBrainz::ListenBrainzBackend>(ioContext, _db, _listenStatsCache));
         LMS_LOG(SCROBBLING, INFO, "Service started!");
     }
 
@@ -76,36 +93,86 @@ namespace Scrobbling
 
     void ScrobblingService::listenStarted(const Listen& listen)
     {
+        LMS_SCOPED_TRACE_OVERVIEW("Scrobbling", "listenStarted");
+
         if (std::optional<ScrobblingBackend> backend{ getUserBackend(listen.userId) })
             _scrobblingBackends[*backend]->listenStarted(listen);
     }
 
     void ScrobblingService::listenFinished(const Listen& listen, std::optional<std::chrono::seconds> duration)
     {
+        LMS_SCOPED_TRACE_OVERVIEW("Scrobbling", "listenFinished");
+
         if (std::optional<ScrobblingBackend> backend{ getUserBackend(listen.userId) })
             _scrobblingBackends[*backend]->listenFinished(listen, duration);
     }
 
     void ScrobblingService::addTimedListen(const TimedListen& listen)
     {
+        LMS_SCOPED_TRACE_OVERVIEW("Scrobbling", "addTimedListen");
+
         if (std::optional<ScrobblingBackend> backend{ getUserBackend(listen.userId) })
             _scrobblingBackends[*backend]->addTimedListen(listen);
     }
 
     std::optional<ScrobblingBackend> ScrobblingService::getUserBackend(UserId userId)
     {
+        LMS_SCOPED_TRACE_DETAILED("Scrobbling", "getUserBackend");
+
         std::optional<ScrobblingBackend> backend;
+        if (const std::optional<User::Settings> settings{ User::getSettings(_db.getTLSSession(), userId) })
+            backend = settings->scrobblingBackend;
+
+        return backend;
+    }
+
+    std::vector<TimedListen> ScrobblingService::getPendingListens(UserId userId) const
+    {
+        std::vector<TimedListen> res;
+        for (const auto& [backend, scrobblingBackend] : _scrobblingBackends)
+        {
+            std::vector<TimedListen> listens{ scrobblingBackend->getPendingListens(userId) };
+            res.insert(std::end(res), std::cbegin(listens), std::cend(listens));
+        }
+
+        return res;
+    }
+
+    template <typename Func>
+    void ScrobblingService::visitListenStatsCache(UserId userId, ScrobblingBackend backend, Func&& func)
+    {
+        if (_listenStatsCache.visit(userId, backend, func))
+            return;
+
+        const std::uint64_t generation{ _listenStatsCache.getGeneration() };
+        ListenStatsCache::TrackStatsContainer stats{ loadListenStatsCacheEntry(userId, backend) };
+        func(std::as_const(stats));
+        _listenStatsCache.put(userId, backend, std::move(stats), generation);
+    }
+
+    ListenStatsCache::TrackStatsContainer ScrobblingService::loadListenStatsCacheEntry(UserId userId, ScrobblingBackend backend)
+    {
+        LMS_SCOPED_TRACE_DETAILED("Scrobbling", "loadListenStatsCacheEntry");
+
+        ListenStatsCache::TrackStatsContainer res;
 
         Session& session{ _db.getTLSSession() };
         auto transaction{ session.createReadTransaction() };
-        if (const User::pointer user{ User::find(session, userId) })
-            backend = user->getScrobblingBackend();
 
-        return backend;
+        Database::Listen::getTrackStats(session, userId, backend, [&](const Database::Listen::TrackStats& stats)
+            {
+                res.emplace(stats.track, TrackListenStats{ stats.count, stats.lastListenDateTime });
+            });
+
+        LMS_LOG(SCROBBLING, DEBUG, "Loaded listen stats of user " << userId.toString() << ": " << res.size() << " tracks");
+
+        return res;
     }
 
     ScrobblingService::ArtistContainer ScrobblingService::getRecentArtists(const ArtistFindParameters& params)
     {
+        LMS_SCOPED_TRACE_OVERVIEW("Scrobbling", "getRecentArtists");
+
         ArtistContainer res;
 
         const auto backend{ getUserBackend(params.user) };
@@ -124,6 +191,8 @@ namespace Scrobbling
 
     ScrobblingService::ReleaseContainer ScrobblingService::getRecentReleases(const FindParameters& params)
     {
+        LMS_SCOPED_TRACE_OVERVIEW("Scrobbling", "getRecentReleases");
+
         ReleaseContainer res;
 
         const auto backend{ getUserBackend(params.user) };
@@ -142,6 +211,8 @@ namespace Scrobbling
 
     ScrobblingService::TrackContainer ScrobblingService::getRecentTracks(const FindParameters& params)
     {
+        LMS_SCOPED_TRACE_OVERVIEW("Scrobbling", "getRecentTracks");
+
         TrackContainer res;
 
         const auto backend{ getUserBackend(params.user) };
@@ -160,20 +231,49 @@ namespace Scrobbling
 
     std::size_t ScrobblingService::getCount(Database::UserId userId, Database::ReleaseId releaseId)
     {
+        LMS_SCOPED_TRACE_DETAILED("Scrobbling", "getCount");
+
         Session& session{ _db.getTLSSession() };
         auto transaction{ session.createReadTransaction() };
-        return Database::Listen::getCount(session, userId, releaseId);
+
+        std::size_t count{ Database::Listen::getCount(session, userId, releaseId) };
+        for (const TimedListen& listen : getPendingListens(userId))
+        {
+            const Track::pointer track{ Track::find(session, listen.trackId) };
+            if (track && track->getRelease() && track->getRelease()->getId() == releaseId)
+                count++;
+        }
+
+        return count;
     }
 
     std::size_t ScrobblingService::getCount(Database::UserId userId, Database::TrackId trackId)
     {
-        Session& session{ _db.getTLSSession() };
-        auto transaction{ session.createReadTransaction() };
-        return Database::Listen::getCount(session, userId, trackId);
+        LMS_SCOPED_TRACE_DETAILED("Scrobbling", "getCount");
+
+        std::size_t count{};
+        if (const auto backend{ getUserBackend(userId) })
+        {
+            visitListenStatsCache(userId, *backend, [&](const ListenStatsCache::TrackStatsContainer& stats)
+                {
+                    if (const auto it{ stats.find(trackId) }; it != std::cend(stats))
+                        count = it->second.count;
+                });
+        }
+
+        for (const TimedListen& listen : getPendingListens(userId))
+        {
+            if (listen.trackId == trackId)
+                count++;
+        }
+
+        return count;
     }
 
     Wt::WDateTime ScrobblingService::getLastListenDateTime(Database::UserId userId, Database::ReleaseId releaseId)
     {
+        LMS_SCOPED_TRACE_DETAILED("Scrobbling", "getLastListenDateTime");
+
         const auto backend{ getUserBackend(userId) };
         if (!backend)
             return {};
@@ -182,25 +282,81 @@ namespace Scrobbling
         auto transaction{ session.createReadTransaction() };
 
         const Database::Listen::pointer listen{ Database::Listen::getMostRecentListen(session, userId, *backend, releaseId) };
-        return listen ? listen->getDateTime() : Wt::WDateTime{};
+        Wt::WDateTime res{ listen ? listen->getDateTime() : Wt::WDateTime{} };
+        for (const TimedListen& pendingListen : getPendingListens(userId))
+        {
+            if (res.isValid() && pendingListen.listenedAt <= res)
+                continue;
+
+            const Track::pointer track{ Track::find(session, pendingListen.trackId) };
+            if (track && track->getRelease() && track->getRelease()->getId() == releaseId)
+                res = pendingListen.listenedAt;
+        }
+
+        return res;
     }
 
     Wt::WDateTime ScrobblingService::getLastListenDateTime(Database::UserId userId, Database::TrackId trackId)
     {
+        LMS_SCOPED_TRACE_DETAILED("Scrobbling", "getLastListenDateTime");
+
         const auto backend{ getUserBackend(userId) };
         if (!backend)
             return {};
 
-        Session& session{ _db.getTLSSession() };
-        auto transaction{ session.createReadTransaction() };
+        Wt::WDateTime res;
+        visitListenStatsCache(userId, *backend, [&](const ListenStatsCache::TrackStatsContainer& stats)
+            {
+                if (const auto it{ stats.find(trackId) }; it != std::cend(stats))
+                    res = it->second.lastListenDateTime;
+            });
+
+        for (const TimedListen& pendingListen : getPendingListens(userId))
+        {
+            if (pendingListen.trackId == trackId && (!res.isValid() || pendingListen.listenedAt > res))
+                res = pendingListen.listenedAt;
+        }
 
-        const Database::Listen::pointer listen{ Database::Listen::getMostRecentListen(session, userId, *backend, trackId) };
-        return listen ? listen->getDateTime() : Wt::WDateTime{};
+        return res;
+    }
+
+    ScrobblingService::TrackListenStatsContainer ScrobblingService::getListenStats(Database::UserId userId, std::span<const Database::TrackId> trackIds)
+    {
+        LMS_SCOPED_TRACE_OVERVIEW("Scrobbling", "getListenStats");
+
+        TrackListenStatsContainer res;
+
+        if (const auto backend{ getUserBackend(userId) })
+        {
+            visitListenStatsCache(userId, *backend, [&](const ListenStatsCache::TrackStatsContainer& stats)
+                {
+                    for (const TrackId trackId : trackIds)
+                    {
+                        if (const auto it{ stats.find(trackId) }; it != std::cend(stats))
+                            res.emplace(trackId, it->second);
+                    }
+                });
+        }
+
+        for (const TimedListen& listen : getPendingListens(userId))
+        {
+            if (std::find(std::cbegin(trackIds), std::cend(trackIds), listen.trackId) == std::cend(trackIds))
+                continue;
+
+            TrackListenStats& stats{ res[listen.trackId] };
+            stats.count++;
+            if (!stats.lastListenDateTime.isValid() || listen.listenedAt > stats.lastListenDateTime)
+                stats.lastListenDateTime = listen.listenedAt;
+        }
+
+        return res;
     }
 
     // Top
     ScrobblingService::ArtistContainer ScrobblingService::getTopArtists(const ArtistFindParameters& params)
     {
+        LMS_SCOPED_TRACE_OVERVIEW("Scrobbling", "getTopArtists");
+
         ArtistContainer res;
 
         const auto backend{ getUserBackend(params.user) };
@@ -219,6 +375,8 @@ namespace Scrobbling
 
     ScrobblingService::ReleaseContainer ScrobblingService::getTopReleases(const FindParameters& params)
     {
+        LMS_SCOPED_TRACE_OVERVIEW("Scrobbling", "getTopReleases");
+
         ReleaseContainer res;
 
         const auto backend{ getUserBackend(params.user) };
@@ -237,6 +395,8 @@ namespace Scrobbling
 
     ScrobblingService::TrackContainer ScrobblingService::getTopTracks(const FindParameters& params)
     {
+        LMS_SCOPED_TRACE_OVERVIEW("Scrobbling", "getTopTracks");
+
         TrackContainer res;
 
         const auto backend{ getUserBackend(params.user) };
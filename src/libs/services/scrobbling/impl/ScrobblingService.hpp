@@ -22,9 +22,11 @@
 #include <memory>
 #include <optional>
 #include <unordered_map>
+#include <vector>
 
 #include "services/scrobbling/IScrobblingService.hpp"
 #include "IScrobblingBackend.hpp"
+#include "ListenStatsCache.hpp"
 
 namespace Scrobbling
 {
@@ -48,14 +50,22 @@ namespace Scrobbling
 
         Wt::WDateTime getLastListenDateTime(Database::UserId userId, Database::ReleaseId releaseId) override;
         Wt::WDateTime getLastListenDateTime(Database::UserId userId, Database::TrackId trackId) override;
+        TrackListenStatsContainer getListenStats(Database::UserId userId, std::span<const Database::TrackId> trackIds) override;
 
         ArtistContainer getTopArtists(const ArtistFindParameters& params) override;
         ReleaseContainer getTopReleases(const FindParameters& params) override;
         TrackContainer getTopTracks(const FindParameters& params) override;
 
         std::optional<Database::ScrobblingBackend> getUserBackend(Database::UserId userId);
+        std::vector<TimedListen> getPendingListens(Database::UserId userId) const; // not in the database yet, merged in the per track/release stats
+
+        // func is called with the track stats of the user for this backend, loaded from the database if needed
+        template <typename Func>
+        void visitListenStatsCache(Database::UserId userId, Database::ScrobblingBackend backend, Func&& func);
+        ListenStatsCache::TrackStatsContainer loadListenStatsCacheEntry(Database::UserId userId, Database::ScrobblingBackend backend);
 
         Database::Db& _db;
+        ListenStatsCache _listenStatsCache; // must outlive the backends
         std::unordered_map<Database::ScrobblingBackend, std::unique_ptr<IScrobblingBackend>> _scrobblingBackends;
     };
 
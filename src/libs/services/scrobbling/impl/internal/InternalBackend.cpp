@@ -19,17 +19,79 @@
 
 #include "InternalBackend.hpp"
 
+#include <algorithm>
+#include <sstream>
+#include <string>
+
 #include "database/Db.hpp"
 #include "database/Listen.hpp"
 #include "database/Session.hpp"
 #include "database/Track.hpp"
 #include "database/User.hpp"
+#include "utils/IConfig.hpp"
+#include "utils/ILogger.hpp"
+#include "utils/Service.hpp"
+
+#include "ListenStatsCache.hpp"
 
 namespace Scrobbling
 {
-    InternalBackend::InternalBackend(Database::Db& db)
-        : _db{ db }
-    {}
+    namespace
+    {
+        // journal lines are "<user id> <track id> <listened at, in ms since epoch>"
+        void writeJournalEntry(std::ostream& os, const TimedListen& listen)
+        {
+            const auto listenedAt{ std::chrono::duration_cast<std::chrono::milliseconds>(listen.listenedAt.toTimePoint().time_since_epoch()) };
+            os << listen.userId.getValue() << ' ' << listen.trackId.getValue() << ' ' << listenedAt.count() << '\n';
+        }
+
+        // each worker process has its own journal, see worker-count
+        std::filesystem::path getJournalPath()
+        {
+            const unsigned long workerIndex{ Service<IConfig>::get()->getULong("worker-index", 0) };
+            return Service<IConfig>::get()->getPath("working-dir") / (workerIndex == 0 ? std::string{ "internal-listens.journal" } : "internal-listens-" + std::to_string(workerIndex) + ".journal");
+        }
+
+        std::optional<TimedListen> parseJournalEntry(const std::string& line)
+        {
+            std::istringstream iss{ line };
+
+            Database::UserId::ValueType userId{};
+            Database::TrackId::ValueType trackId{};
+            long long listenedAt{};
+            if (!(iss >> userId >> trackId >> listenedAt))
+                return std::nullopt;
+
+            TimedListen listen;
+            listen.userId = userId;
+            listen.trackId = trackId;
+            listen.listenedAt = Wt::WDateTime::fromTimePoint(std::chrono::system_clock::time_point{ std::chrono::milliseconds{ listenedAt } });
+            return listen;
+        }
+    }
+
+    InternalBackend::InternalBackend(boost::asio::io_context& ioContext, Database::Db& db, ListenStatsCache& listenStatsCache)
+        : _ioContext{ ioContext }
+        , _db{ db }
+        , _listenStatsCache{ listenStatsCache }
+        , _flushDelay{ Service<IConfig>::get()->getULong("scrobbling-internal-flush-delay", 2) }
+        , _journalPath{ getJournalPath() }
+    {
+        if (_flushDelay.count() == 0)
+            return;
+
+        replayJournal();
+
+        _journal.open(_journalPath, std::ios::out | std::ios::app);
+        if (!_journal)
+            LMS_LOG(SCROBBLING, ERROR, "Cannot open listen journal '" << _journalPath.string() << "', pending listens may be lost on crash");
+    }
+
+    InternalBackend::~InternalBackend()
+    {
+        _flushTimer.cancel();
+        flush();
+    }
 
     void InternalBackend::listenStarted(const Listen&)
     {
@@ -47,22 +109,163 @@ namespace Scrobbling
 
     void InternalBackend::addTimedListen(const TimedListen& listen)
     {
-        Database::Session& session{ _db.getTLSSession() };
-        auto transaction{ session.createWriteTransaction() };
+        if (_flushDelay.count() == 0)
+        {
+            saveListens(std::span{ &listen, 1 });
+            return;
+        }
+
+        {
+            const std::scoped_lock lock{ _mutex };
+
+            const bool alreadyPending{ std::any_of(std::cbegin(_pendingListens), std::cend(_pendingListens), [&](const TimedListen& pendingListen)
+                {
+                    return pendingListen.userId == listen.userId && pendingListen.trackId == listen.trackId && pendingListen.listenedAt == listen.listenedAt;
+                }) };
+            if (alreadyPending)
+                return;
+
+            _pendingListens.push_back(listen);
+            if (_journal)
+            {
+                writeJournalEntry(_journal, listen);
+                _journal.flush();
+            }
+
+            scheduleFlush();
+        }
+    }
 
-        if (Database::Listen::find(session, listen.userId, listen.trackId, Database::ScrobblingBackend::Internal, listen.listenedAt))
+    std::vector<TimedListen> InternalBackend::getPendingListens(Database::UserId userId) const
+    {
+        std::vector<TimedListen> res;
+
+        const std::scoped_lock lock{ _mutex };
+        std::copy_if(std::cbegin(_pendingListens), std::cend(_pendingListens), std::back_inserter(res), [=](const TimedListen& listen) { return listen.userId == userId; });
+
+        return res;
+    }
+
+    void InternalBackend::replayJournal()
+    {
+        std::ifstream journal{ _journalPath };
+        if (!journal)
             return;
 
-        const Database::User::pointer user{ Database::User::find(session, listen.userId) };
-        if (!user)
+        std::string line;
+        while (std::getline(journal, line))
+        {
+            if (const std::optional<TimedListen> listen{ parseJournalEntry(line) })
+                _pendingListens.push_back(*listen);
+            else
+                LMS_LOG(SCROBBLING, WARNING, "Skipping invalid listen journal entry '" << line << "'");
+        }
+
+        if (!_pendingListens.empty())
+        {
+            LMS_LOG(SCROBBLING, INFO, "Replaying " << _pendingListens.size() << " pending listens from journal");
+
+            const std::scoped_lock lock{ _mutex };
+            scheduleFlush();
+        }
+    }
+
+    void InternalBackend::writeJournal()
+    {
+        _journal.close();
+        _journal.open(_journalPath, std::ios::out | std::ios::trunc);
+        if (!_journal)
+        {
+            LMS_LOG(SCROBBLING, ERROR, "Cannot open listen journal '" << _journalPath.string() << "', pending listens may be lost on crash");
             return;
+        }
 
-        const Database::Track::pointer track{ Database::Track::find(session, listen.trackId) };
-        if (!track)
+        for (const TimedListen& listen : _pendingListens)
+            writeJournalEntry(_journal, listen);
+
+        _journal.flush();
+    }
+
+    void InternalBackend::scheduleFlush()
+    {
+        if (_flushScheduled)
             return;
 
-        auto dbListen{ session.create<Database::Listen>(user, track, Database::ScrobblingBackend::Internal, listen.listenedAt) };
-        dbListen.modify()->setSyncState(Database::SyncState::Synchronized);
+        _flushScheduled = true;
+        _flushTimer.expires_after(_flushDelay);
+        _flushTimer.async_wait([this](const boost::system::error_code& ec)
+            {
+                if (ec == boost::asio::error::operation_aborted)
+                    return;
+
+                flush();
+            });
     }
-} // Scrobbling
 
+    void InternalBackend::flush()
+    {
+        const std::scoped_lock flushLock{ _flushMutex };
+
+        std::vector<TimedListen> listens;
+        {
+            const std::scoped_lock lock{ _mutex };
+            _flushScheduled = false;
+            listens.swap(_pendingListens);
+        }
+
+        if (listens.empty())
+            return;
+
+        try
+        {
+            saveListens(listens);
+        }
+        catch (const std::exception& e)
+        {
+            LMS_LOG(SCROBBLING, ERROR, "Cannot save " << listens.size() << " listens: " << e.what() << ", retrying later");
+
+            const std::scoped_lock lock{ _mutex };
+            _pendingListens.insert(std::begin(_pendingListens), std::cbegin(listens), std::cend(listens));
+            scheduleFlush();
+            return;
+        }
+
+        LMS_LOG(SCROBBLING, DEBUG, "Saved " << listens.size() << " listens");
+
+        // drop the saved listens from the journal, keeping the ones that came in the meantime
+        const std::scoped_lock lock{ _mutex };
+        if (_journal.is_open())
+            writeJournal();
+    }
+
+    void InternalBackend::saveListens(std::span<const TimedListen> listens)
+    {
+        std::vector<const TimedListen*> savedListens;
+        {
+            Database::Session& session{ _db.getTLSSession() };
+            auto transaction{ session.createWriteTransaction() };
+
+            for (const TimedListen& listen : listens)
+            {
+                if (Database::Listen::find(session, listen.userId, listen.trackId, Database::ScrobblingBackend::Internal, listen.listenedAt))
+                    continue;
+
+                const Database::User::pointer user{ Database::User::find(session, listen.userId) };
+                if (!user)
+                    continue;
+
+                const Database::Track::pointer track{ Database::Track::find(session, listen.trackId) };
+                if (!track)
+                    continue;
+
+                auto dbListen{ session.create<Database::Listen>(user, track, Database::ScrobblingBackend::Internal, listen.listenedAt) };
+                dbListen.modify()->setSyncState(Database::SyncState::Synchronized);
+                savedListens.push_back(&listen);
+            }
+        }
+
+        // once committed
+        for (const TimedListen* listen : savedListens)
+            _listenStatsCache.onListenAdded(listen->userId, Database::ScrobblingBackend::Internal, listen->trackId, listen->listenedAt);
+    }
+} // Scrobbling
@@ -19,6 +19,15 @@
 
 #pragma once
 
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <span>
+#include <vector>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+
 #include "IScrobblingBackend.hpp"
 
 namespace Database
@@ -28,17 +37,42 @@ namespace Database
 
 namespace Scrobbling
 {
+    class ListenStatsCache;
+
+    // Listens are acknowledged immediately and written to the database in batches
+    // Pending listens are journaled, so that they are not lost if LMS is killed before they are written
     class InternalBackend final : public IScrobblingBackend
     {
     public:
-        InternalBackend(Database::Db& db);
+        InternalBackend(boost::asio::io_context& ioContext, Database::Db& db, ListenStatsCache& listenStatsCache);
+        ~InternalBackend() override;
 
     private:
+        InternalBackend(const InternalBackend&) = delete;
+        InternalBackend& operator=(const InternalBackend&) = delete;
+
         void listenStarted(const Listen& listen) override;
         void listenFinished(const Listen& listen, std::optional<std::chrono::seconds> duration) override;
         void addTimedListen(const TimedListen& listen) override;
+        std::vector<TimedListen> getPendingListens(Database::UserId userId) const override;
 
+        void replayJournal();
+        void writeJournal(); // rewrite it with the pending listens, must be called with _mutex held
+        void scheduleFlush(); // must be called with _mutex held
+        void flush();
+        void saveListens(std::span<const TimedListen> listens);
+
+        boost::asio::io_context& _ioContext;
         Database::Db& _db;
+        ListenStatsCache& _listenStatsCache; // the saved listens are reported to it
+        const std::chrono::seconds _flushDelay; // 0 means no buffering
+        const std::filesystem::path _journalPath;
+
+        std::mutex _flushMutex; // only one batch written at a time
+        mutable std::mutex _mutex;
+        boost::asio::steady_timer _flushTimer{ _ioContext };
+        bool _flushScheduled{};
+        std::vector<TimedListen> _pendingListens;
+        std::ofstream _journal;
     };
 } // Scrobbling
-
@@ -19,6 +19,8 @@
 
 #include "ListenBrainzBackend.hpp"
 
+#include <algorithm>
+
 #include "database/Db.hpp"
 #include "database/Session.hpp"
 #include "database/Track.hpp"
@@ -50,12 +52,12 @@ namespace Scrobbling::ListenBrainz
         }
     }
 
-    ListenBrainzBackend::ListenBrainzBackend(boost::asio::io_context& ioContext, Db& db)
+    ListenBrainzBackend::ListenBrainzBackend(boost::asio::io_context& ioContext, Db& db, ListenStatsCache& listenStatsCache)
         : _ioContext{ ioContext }
         , _db{ db }
         , _baseAPIUrl{ Service<IConfig>::get()->getString("listenbrainz-api-base-url", "https://api.listenbrainz.org") }
-        , _client{ Http::createClient(_ioContext, _baseAPIUrl) }
-        , _listensSynchronizer{ _ioContext, db, *_client }
+        , _client{ Http::createClient(_ioContext, _baseAPIUrl, Http::ClientParameters{ std::max<std::size_t>(Service<IConfig>::get()->getULong("listenbrainz-max-concurrent-requests", 2), 1) }) }
+        , _listensSynchronizer{ _ioContext, db, *_client, listenStatsCache }
     {
         LOG(INFO, "Starting ListenBrainz backend... API endpoint = '" << _baseAPIUrl << "'");
     }
@@ -83,5 +85,11 @@ namespace Scrobbling::ListenBrainz
     {
         _listensSynchronizer.enqueListen(timedListen);
     }
+
+    std::vector<TimedListen> ListenBrainzBackend::getPendingListens(Database::UserId) const
+    {
+        // listens are saved as pending submissions as they come
+        return {};
+    }
 } // namespace Scrobbling::ListenBrainz
 
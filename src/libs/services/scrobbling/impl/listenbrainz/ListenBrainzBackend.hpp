@@ -31,12 +31,17 @@ namespace Database
     class Db;
 }
 
+namespace Scrobbling
+{
+    class ListenStatsCache;
+}
+
 namespace Scrobbling::ListenBrainz
 {
     class ListenBrainzBackend final : public IScrobblingBackend
     {
     public:
-        ListenBrainzBackend(boost::asio::io_context& ioContext, Database::Db& db);
+        ListenBrainzBackend(boost::asio::io_context& ioContext, Database::Db& db, ListenStatsCache& listenStatsCache);
         ~ListenBrainzBackend() override;
 
     private:
@@ -46,6 +51,7 @@ namespace Scrobbling::ListenBrainz
         void listenStarted(const Listen& listen) override;
         void listenFinished(const Listen& listen, std::optional<std::chrono::seconds> duration) override;
         void addTimedListen(const TimedListen& listen) override;
+        std::vector<TimedListen> getPendingListens(Database::UserId userId) const override;
 
         // Submit listens
         void enqueListen(const Listen& listen, const Wt::WDateTime& timePoint);
@@ -19,6 +19,10 @@
 
 #include "ListensSynchronizer.hpp"
 
+#include <algorithm>
+#include <span>
+#include <unordered_map>
+
 #include <boost/asio/bind_executor.hpp>
 #include <Wt/Json/Array.h>
 #include <Wt/Json/Object.h>
@@ -34,10 +38,11 @@
 #include "database/User.hpp"
 #include "services/scrobbling/Exception.hpp"
 #include "utils/IConfig.hpp"
+#include "utils/IResourceGovernor.hpp"
 #include "utils/http/IClient.hpp"
 #include "utils/Service.hpp"
-#include "ListensParser.hpp"
 
+#include "ListenStatsCache.hpp"
 #include "Utils.hpp"
 
 namespace Scrobbling::ListenBrainz
@@ -142,44 +147,37 @@ namespace Scrobbling::ListenBrainz
             }
         }
 
-        Database::TrackId tryGetMatchingTrack(Database::Session& session, const Listen& listen)
+        using TrackIdsByMBID = std::unordered_map<std::string /* mbid */, std::vector<Database::TrackId>>;
+
+        TrackIdsByMBID toTrackIdsByMBID(const std::vector<Database::Track::MBIDResult>& results)
         {
-            using namespace Database;
+            TrackIdsByMBID res;
+            for (const Database::Track::MBIDResult& result : results)
+                res[std::string{ result.mbid.getAsString() }].push_back(result.trackId);
 
-            auto transaction{ session.createReadTransaction() };
+            return res;
+        }
 
-            // first try to match using track MBID, and then fallback on possibly ambiguous info
-            if (listen.trackMBID)
-            {
-                const auto tracks{ Track::findByMBID(session, *listen.trackMBID) };
-                // if duplicated files, do not record it (let the user correct its database)
-                if (tracks.size() == 1)
-                {
-                    LOG(DEBUG, "Matched listen '" << listen << "' using track MBID");
-                    return tracks.front()->getId();
-                }
-                else if (tracks.size() > 1)
-                {
-                    LOG(DEBUG, "Too many matches for listen '" << listen << "' using track MBID!");
-                    return {};
-                }
-            }
+        // nothing if the MBID is not known, an invalid id if ambiguous
+        std::optional<Database::TrackId> findTrackByMBID(const TrackIdsByMBID& trackIdsByMBID, const std::optional<UUID>& mbid)
+        {
+            if (!mbid)
+                return std::nullopt;
 
-            if (listen.recordingMBID)
-            {
-                const auto tracks{ Track::findByRecordingMBID(session, *listen.recordingMBID) };
-                // if duplicated files, do not record it (let the user correct its database)
-                if (tracks.size() == 1)
-                {
-                    LOG(DEBUG, "Matched listen '" << listen << "' using recording MBID");
-                    return tracks.front()->getId();
-                }
-                else if (tracks.size() > 1)
-                {
-                    LOG(DEBUG, "Too many matches for listen '" << listen << "' using recording MBID!");
-                    return {};
-                }
-            }
+            auto itTrackIds{ trackIdsByMBID.find(std::string{ mbid->getAsString() }) };
+            if (itTrackIds == std::cend(trackIdsByMBID))
+                return std::nullopt;
+
+            // if duplicated files, do not record it (let the user correct its database)
+            if (itTrackIds->second.size() > 1)
+                return Database::TrackId{};
+
+            return itTrackIds->second.front();
+        }
+
+        Database::TrackId tryGetMatchingTrackUsingMetadata(Database::Session& session, const Listen& listen)
+        {
+            using namespace Database;
 
             assert(!listen.trackName.empty() && !listen.artistName.empty());
 
@@ -207,16 +205,63 @@ namespace Scrobbling::ListenBrainz
             LOG(DEBUG, "No match for listen '" << listen << "'");
             return {};
         }
+
+        // Returns the matching track of each listen (invalid if no match)
+        // Track and recording MBIDs are looked up all at once, then fallback on possibly ambiguous info
+        std::vector<Database::TrackId> getMatchingTracks(Database::Session& session, std::span<const Listen> listens)
+        {
+            using namespace Database;
+
+            std::vector<UUID> trackMBIDs;
+            std::vector<UUID> recordingMBIDs;
+            for (const Listen& listen : listens)
+            {
+                if (listen.trackMBID)
+                    trackMBIDs.push_back(*listen.trackMBID);
+                if (listen.recordingMBID)
+                    recordingMBIDs.push_back(*listen.recordingMBID);
+            }
+
+            auto transaction{ session.createReadTransaction() };
+
+            const TrackIdsByMBID trackIdsByTrackMBID{ toTrackIdsByMBID(Track::findIdsByMBIDs(session, trackMBIDs)) };
+            const TrackIdsByMBID trackIdsByRecordingMBID{ toTrackIdsByMBID(Track::findIdsByRecordingMBIDs(session, recordingMBIDs)) };
+
+            std::vector<TrackId> res;
+            res.reserve(listens.size());
+            for (const Listen& listen : listens)
+            {
+                if (const std::optional<TrackId> trackId{ findTrackByMBID(trackIdsByTrackMBID, listen.trackMBID) })
+                {
+                    LOG(DEBUG, (trackId->isValid() ? "Matched" : "Too many matches for") << " listen '" << listen << "' using track MBID");
+                    res.push_back(*trackId);
+                }
+                else if (const std::optional<TrackId> trackId{ findTrackByMBID(trackIdsByRecordingMBID, listen.recordingMBID) })
+                {
+                    LOG(DEBUG, (trackId->isValid() ? "Matched" : "Too many matches for") << " listen '" << listen << "' using recording MBID");
+                    res.push_back(*trackId);
+                }
+                else
+                {
+                    res.push_back(tryGetMatchingTrackUsingMetadata(session, listen));
+                }
+            }
+
+            return res;
+        }
     }
 
-    ListensSynchronizer::ListensSynchronizer(boost::asio::io_context& ioContext, Database::Db& db, Http::IClient& client)
+    ListensSynchronizer::ListensSynchronizer(boost::asio::io_context& ioContext, Database::Db& db, Http::IClient& client, ListenStatsCache& listenStatsCache)
         : _ioContext{ ioContext }
         , _db{ db }
         , _client{ client }
+        , _listenStatsCache{ listenStatsCache }
         , _maxSyncListenCount{ Service<IConfig>::get()->getULong("listenbrainz-max-sync-listen-count", 1000) }
         , _syncListensPeriod{ Service<IConfig>::get()->getULong("listenbrainz-sync-listens-period-hours", 1) }
+        , _maxSubmitListenCount{ std::clamp<std::size_t>(Service<IConfig>::get()->getULong("listenbrainz-max-submit-listen-count", 100), 1, 1000) }
+        , _maxConcurrentSyncCount{ std::max<std::size_t>(Service<IConfig>::get()->getULong("listenbrainz-max-concurrent-syncs", 4), 1) }
     {
-        LOG(INFO, "Starting Listens synchronizer, maxSyncListenCount = " << _maxSyncListenCount << ", _syncListensPeriod = " << _syncListensPeriod.count() << " hours");
+        LOG(INFO, "Starting Listens synchronizer, maxSyncListenCount = " << _maxSyncListenCount << ", _syncListensPeriod = " << _syncListensPeriod.count() << " hours, maxConcurrentSyncCount = " << _maxConcurrentSyncCount);
 
         scheduleSync(std::chrono::seconds{ 30 });
     }
@@ -234,38 +279,21 @@ namespace Scrobbling::ListenBrainz
 
     void ListensSynchronizer::enqueListen(const Scrobbling::Listen& listen, const Wt::WDateTime& timePoint)
     {
-        Http::ClientPOSTRequestParameters request;
-        request.relativeUrl = "/1/submit-listens";
-
         if (timePoint.isValid())
         {
+            // Listens are first saved as pending, and then submitted in batches along with the other pending listens of the user
+            // This way, they are sent again later in case of failure, even after a restart
             const TimedListen timedListen{ listen, timePoint };
-            // We want the listen to be sent again later in case of failure, so we just save it as pending send
             saveListen(timedListen, Database::SyncState::PendingAdd);
 
-            request.priority = Http::ClientRequestParameters::Priority::Normal;
-            request.onSuccessFunc = [this, timedListen](std::string_view)
+            _strand.dispatch([this, userId = listen.userId]
                 {
-                    _strand.dispatch([this, timedListen]
-                        {
-                            if (saveListen(timedListen, Database::SyncState::Synchronized))
-                            {
-                                UserContext& context{ getUserContext(timedListen.userId) };
-                                if (context.listenCount)
-                                    (*context.listenCount)++;
-                            }
-                        });
-                };
-            // on failure, this listen will be sent during the next sync
-        }
-        else
-        {
-            // We want "listen now" to appear as soon as possible
-            request.priority = Http::ClientRequestParameters::Priority::High;
-            // don't retry on failure
+                    requestListensSubmission(getUserContext(userId));
+                });
+            return;
         }
 
-        std::string bodyText{ listenToJsonString(_db.getTLSSession(), listen, timePoint, timePoint.isValid() ? "single" : "playing_now") };
+        std::string bodyText{ listenToJsonString(_db.getTLSSession(), listen, timePoint, "playing_now") };
         if (bodyText.empty())
         {
             LOG(DEBUG, "Cannot convert listen to json: skipping");
@@ -279,79 +307,175 @@ namespace Scrobbling::ListenBrainz
             return;
         }
 
+        Http::ClientPOSTRequestParameters request;
+        request.relativeUrl = "/1/submit-listens";
+        // We want "listen now" to appear as soon as possible
+        request.priority = Http::ClientRequestParameters::Priority::High;
+        // don't retry on failure
         request.message.addBodyText(bodyText);
         request.message.addHeader("Authorization", "Token " + std::string{ listenBrainzToken->getAsString() });
         request.message.addHeader("Content-Type", "application/json");
         _client.sendPOSTRequest(std::move(request));
     }
 
-    bool ListensSynchronizer::saveListen(const TimedListen& listen, Database::SyncState scrobblingState)
+    void ListensSynchronizer::requestListensSubmission(UserContext& context)
+    {
+        assert(_strand.running_in_this_thread());
+
+        // listens saved meanwhile will be picked up by the next batch
+        if (context.submittingListens)
+            return;
+
+        context.submittingListens = true;
+        context.unsubmittableListenCount = 0;
+        submitNextPendingListens(context);
+    }
+
+    void ListensSynchronizer::submitNextPendingListens(UserContext& context)
     {
         using namespace Database;
 
+        assert(_strand.running_in_this_thread());
+        assert(context.submittingListens);
+
+        const std::optional<UUID> listenBrainzToken{ Utils::getListenBrainzToken(_db.getTLSSession(), context.userId) };
+        if (!listenBrainzToken)
+        {
+            context.submittingListens = false;
+            return;
+        }
+
         Session& session{ _db.getTLSSession() };
-        auto transaction{ session.createWriteTransaction() }; // TODO: unique only if needed
 
-        Database::Listen::pointer dbListen{ Database::Listen::find(session, listen.userId, listen.trackId, Database::ScrobblingBackend::ListenBrainz, listen.listenedAt) };
-        if (!dbListen)
+        std::vector<ListenId> listenIds;
+        Wt::Json::Array payloads;
+        while (payloads.empty())
         {
-            const User::pointer user{ User::find(session, listen.userId) };
-            if (!user)
-                return false;
+            std::vector<std::pair<ListenId, TimedListen>> pendingListens;
+            {
+                auto transaction{ session.createReadTransaction() };
 
-            const Track::pointer track{ Track::find(session, listen.trackId) };
-            if (!track)
-                return false;
+                Database::Listen::FindParameters params;
+                params.setUser(context.userId)
+                    .setScrobblingBackend(ScrobblingBackend::ListenBrainz)
+                    .setSyncState(SyncState::PendingAdd)
+                    .setRange(Range{ context.unsubmittableListenCount, _maxSubmitListenCount });
 
-            dbListen = session.create<Database::Listen>(user, track, Database::ScrobblingBackend::ListenBrainz, listen.listenedAt);
-            dbListen.modify()->setSyncState(scrobblingState);
+                for (const ListenId listenId : Database::Listen::find(session, params).results)
+                {
+                    const Database::Listen::pointer listen{ Database::Listen::find(session, listenId) };
+                    pendingListens.emplace_back(listenId, TimedListen{ { context.userId, listen->getTrack()->getId() }, listen->getDateTime() });
+                }
+            }
 
-            LOG(DEBUG, "LISTEN CREATED for user " << user->getLoginName() << ", track '" << track->getName() << "' AT " << listen.listenedAt.toString());
+            if (pendingListens.empty())
+            {
+                LOG(DEBUG, "No more pending listens to submit");
+                context.submittingListens = false;
+                return;
+            }
 
-            return true;
+            for (const auto& [listenId, timedListen] : pendingListens)
+            {
+                std::optional<Wt::Json::Object> payload{ listenToJsonPayload(session, timedListen, timedListen.listenedAt) };
+                if (!payload)
+                {
+                    // left as pending, skipped until the next submission request
+                    context.unsubmittableListenCount++;
+                    continue;
+                }
+
+                listenIds.push_back(listenId);
+                payloads.push_back(std::move(*payload));
+            }
         }
 
-        if (dbListen->getSyncState() == scrobblingState)
-            return false;
+        Wt::Json::Object root;
+        root["listen_type"] = Wt::Json::Value{ std::string{ "import" } };
+        root["payload"] = std::move(payloads);
 
-        dbListen.modify()->setSyncState(scrobblingState);
-        return true;
+        LOG(DEBUG, "Submitting " << listenIds.size() << " pending listens");
+
+        Http::ClientPOSTRequestParameters request;
+        request.relativeUrl = "/1/submit-listens";
+        request.priority = Http::ClientRequestParameters::Priority::Normal;
+        request.onSuccessFunc = [this, &context, listenIds = std::move(listenIds)](std::string_view)
+            {
+                _strand.dispatch([this, &context, listenIds]
+                    {
+                        onListensSubmitted(context, listenIds);
+                        submitNextPendingListens(context);
+                    });
+            };
+        request.onFailureFunc = [this, &context]
+            {
+                // listens are still pending, they will be submitted again during the next sync
+                _strand.dispatch([&context]
+                    {
+                        context.submittingListens = false;
+                    });
+            };
+        request.message.addBodyText(Wt::Json::serialize(root));
+        request.message.addHeader("Authorization", "Token " + std::string{ listenBrainzToken->getAsString() });
+        request.message.addHeader("Content-Type", "application/json");
+        _client.sendPOSTRequest(std::move(request));
     }
 
-    void ListensSynchronizer::enquePendingListens()
+    void ListensSynchronizer::onListensSubmitted(UserContext& context, std::span<const Database::ListenId> listenIds)
     {
-        std::vector<TimedListen> pendingListens;
+        using namespace Database;
 
+        Session& session{ _db.getTLSSession() };
+        auto transaction{ session.createWriteTransaction() };
+
+        for (const ListenId listenId : listenIds)
         {
-            Database::Session& session{ _db.getTLSSession() };
+            Database::Listen::pointer listen{ Database::Listen::find(session, listenId) };
+            if (!listen || listen->getSyncState() != SyncState::PendingAdd)
+                continue;
 
-            auto transaction{ session.createWriteTransaction() };
+            listen.modify()->setSyncState(SyncState::Synchronized);
+            if (context.listenCount)
+                (*context.listenCount)++;
+        }
+    }
+
+    bool ListensSynchronizer::saveListen(const TimedListen& listen, Database::SyncState scrobblingState)
+    {
+        using namespace Database;
 
-            Database::Listen::FindParameters params;
-            params.setScrobblingBackend(Database::ScrobblingBackend::ListenBrainz)
-                .setSyncState(Database::SyncState::PendingAdd)
-                .setRange(Database::Range{ 0, 100 }); // don't flood too much?
+        Session& session{ _db.getTLSSession() };
 
-            const Database::RangeResults results{ Database::Listen::find(session, params) };
-            pendingListens.reserve(results.results.size());
+        {
+            auto transaction{ session.createWriteTransaction() }; // TODO: unique only if needed
 
-            for (Database::ListenId listenId : results.results)
+            Database::Listen::pointer dbListen{ Database::Listen::find(session, listen.userId, listen.trackId, Database::ScrobblingBackend::ListenBrainz, listen.listenedAt) };
+            if (dbListen)
             {
-                const Database::Listen::pointer listen{ Database::Listen::find(session, listenId) };
-
-                TimedListen timedListen;
-                timedListen.listenedAt = listen->getDateTime();
-                timedListen.userId = listen->getUser()->getId();
-                timedListen.trackId = listen->getTrack()->getId();
+                if (dbListen->getSyncState() == scrobblingState)
+                    return false;
 
-                pendingListens.push_back(std::move(timedListen));
+                dbListen.modify()->setSyncState(scrobblingState);
+                return true;
             }
-        }
 
-        LOG(DEBUG, "Queing " << pendingListens.size() << " pending listen");
+            const User::pointer user{ User::find(session, listen.userId) };
+            if (!user)
+                return false;
+
+            const Track::pointer track{ Track::find(session, listen.trackId) };
+            if (!track)
+                return false;
+
+            dbListen = session.create<Database::Listen>(user, track, Database::ScrobblingBackend::ListenBrainz, listen.listenedAt);
+            dbListen.modify()->setSyncState(scrobblingState);
+
+            LOG(DEBUG, "LISTEN CREATED for user " << user->getLoginName() << ", track '" << track->getName() << "' AT " << listen.listenedAt.toString());
+        }
 
-        for (const TimedListen& pendingListen : pendingListens)
-            enqueListen(pendingListen);
+        // once committed
+        _listenStatsCache.onListenAdded(listen.userId, Database::ScrobblingBackend::ListenBrainz, listen.trackId, listen.listenedAt);
+        return true;
     }
 
     ListensSynchronizer::UserContext& ListensSynchronizer::getUserContext(Database::UserId userId)
@@ -394,6 +518,14 @@ namespace Scrobbling::ListenBrainz
                     throw Exception{ "GetListens timer failure: " + std::string {ec.message()} };
                 }
 
+                // not urgent, let the live streams and requests go first
+                if (isForegroundBusy())
+                {
+                    LOG(DEBUG, "Foreground busy, postponing sync");
+                    scheduleSync(std::chrono::seconds{ 60 });
+                    return;
+                }
+
                 startSync();
             }));
     }
@@ -404,8 +536,6 @@ namespace Scrobbling::ListenBrainz
 
         assert(!isSyncing());
 
-        enquePendingListens();
-
         Database::RangeResults<Database::UserId> userIds;
         {
             Database::Session& session{ _db.getTLSSession() };
@@ -413,13 +543,37 @@ namespace Scrobbling::ListenBrainz
             userIds = Database::User::find(_db.getTLSSession(), Database::User::FindParameters{}.setScrobblingBackend(Database::ScrobblingBackend::ListenBrainz));
         }
 
+        // submit the listens that could not be sent so far
         for (const Database::UserId userId : userIds.results)
-            startSync(getUserContext(userId));
+            requestListensSubmission(getUserContext(userId));
+
+        assert(_pendingSyncUserIds.empty());
+        _pendingSyncUserIds.assign(std::cbegin(userIds.results), std::cend(userIds.results));
+        startPendingSyncs();
 
         if (!isSyncing())
             scheduleSync(_syncListensPeriod);
     }
 
+    void ListensSynchronizer::startPendingSyncs()
+    {
+        assert(_strand.running_in_this_thread());
+
+        auto getSyncingCount{ [this]
+            {
+                return static_cast<std::size_t>(std::count_if(std::cbegin(_userContexts), std::cend(_userContexts), [](const auto& contextEntry) { return contextEntry.second.syncing; }));
+            } };
+
+        // syncs may end synchronously (and start pending ones)
+        while (!_pendingSyncUserIds.empty() && getSyncingCount() < _maxConcurrentSyncCount)
+        {
+            const Database::UserId userId{ _pendingSyncUserIds.front() };
+            _pendingSyncUserIds.pop_front();
+
+            startSync(getUserContext(userId));
+        }
+    }
+
     void ListensSynchronizer::startSync(UserContext& context)
     {
         context.syncing = true;
@@ -439,6 +593,7 @@ namespace Scrobbling::ListenBrainz
                 LOG(INFO, "Sync done for user '" << context.listenBrainzUserName << "', fetched: " << context.fetchedListenCount << ", matched: " << context.matchedListenCount << ", imported: " << context.importedListenCount);
                 context.syncing = false;
 
+                startPendingSyncs();
                 if (!isSyncing())
                     scheduleSync(_syncListensPeriod);
             });
@@ -522,14 +677,11 @@ namespace Scrobbling::ListenBrainz
         request.priority = Http::ClientRequestParameters::Priority::Low;
         request.onSuccessFunc = [this, &context](std::string_view msgBody)
             {
-                processGetListensResponse(msgBody, context);
-                if (context.fetchedListenCount >= _maxSyncListenCount || !context.maxDateTime.isValid())
-                {
-                    onSyncEnded(context);
-                    return;
-                }
-
-                enqueGetListens(context);
+                // do not hold the send queue while the listens are imported
+                _strand.dispatch([this, &context, result = ListensParser::parse(msgBody)]() mutable
+                    {
+                        processGetListensResponse(std::move(result), context);
+                    });
             };
         request.onFailureFunc = [this, &context]
             {
@@ -539,34 +691,73 @@ namespace Scrobbling::ListenBrainz
         _client.sendGETRequest(std::move(request));
     }
 
-    void ListensSynchronizer::processGetListensResponse(std::string_view msgBody, UserContext& context)
+    void ListensSynchronizer::processGetListensResponse(ListensParser::Result&& result, UserContext& context)
     {
-        Database::Session& session{ _db.getTLSSession() };
+        assert(_strand.running_in_this_thread());
 
         context.maxDateTime = {}; // invalidate to break in case no more listens are fetched
-        ListensParser::Result result{ ListensParser::parse(msgBody) };
         context.fetchedListenCount += result.listenCount;
 
-        for (const Listen& parsedListen : result.listens)
+        std::vector<Listen> listens;
+        listens.reserve(result.listens.size());
+        for (Listen& parsedListen : result.listens)
         {
-            // update oldest listen for the next query
             if (!parsedListen.listenedAt.isValid())
             {
                 LOG(DEBUG, "Skipping entry due to invalid listenedAt");
                 continue;
             }
 
+            // update oldest listen for the next query
             if (!context.maxDateTime.isValid() || context.maxDateTime > parsedListen.listenedAt)
                 context.maxDateTime = parsedListen.listenedAt;
 
-            if (const Database::TrackId trackId{ tryGetMatchingTrack(session, parsedListen) }; trackId.isValid())
-            {
-                context.matchedListenCount++;
+            listens.push_back(std::move(parsedListen));
+        }
 
-                const Scrobbling::TimedListen listen{ {context.userId, trackId}, parsedListen.listenedAt };
-                if (saveListen(listen, Database::SyncState::Synchronized))
-                    context.importedListenCount++;
-            }
+        // fetch the next page while this one is being imported
+        const bool syncEnded{ context.fetchedListenCount >= _maxSyncListenCount || !context.maxDateTime.isValid() };
+        if (!syncEnded)
+            enqueGetListens(context);
+
+        importListens(listens, context);
+
+        if (syncEnded)
+            onSyncEnded(context);
+    }
+
+    void ListensSynchronizer::importListens(std::span<const Listen> listens, UserContext& context)
+    {
+        if (listens.empty())
+            return;
+
+        Database::Session& session{ _db.getTLSSession() };
+
+        const std::vector<Database::TrackId> trackIds{ getMatchingTracks(session, listens) };
+        assert(trackIds.size() == listens.size());
+
+        std::vector<Database::Listen::TimedTrack> matchedListens;
+        matchedListens.reserve(listens.size());
+        for (std::size_t i{}; i < listens.size(); ++i)
+        {
+            if (trackIds[i].isValid())
+                matchedListens.push_back(Database::Listen::TimedTrack{ trackIds[i], listens[i].listenedAt });
         }
+        context.matchedListenCount += matchedListens.size();
+
+        if (matchedListens.empty())
+            return;
+
+        std::size_t importedListenCount{};
+        {
+            auto transaction{ session.createWriteTransaction() };
+            // already known listens are skipped, their sync state is left as is
+            importedListenCount = Database::Listen::createIfNotExist(session, context.userId, Database::ScrobblingBackend::ListenBrainz, Database::SyncState::Synchronized, matchedListens);
+        }
+        context.importedListenCount += importedListenCount;
+
+        // the imported listens are not known, the stats of the user are reloaded on next use
+        if (importedListenCount > 0)
+            _listenStatsCache.invalidate(context.userId);
     }
 } // namespace Scrobbling::ListenBrainz
@@ -19,16 +19,20 @@
 
 #pragma once
 
+#include <deque>
 #include <optional>
+#include <span>
 #include <unordered_map>
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/io_context_strand.hpp>
 #include <boost/asio/steady_timer.hpp>
 
+#include "database/ListenId.hpp"
 #include "database/Types.hpp"
 #include "database/UserId.hpp"
 
 #include "services/scrobbling/Listen.hpp"
+#include "ListensParser.hpp"
 
 namespace Database
 {
@@ -40,22 +44,25 @@ namespace Http
 	class IClient;
 }
 
+namespace Scrobbling
+{
+	class ListenStatsCache;
+}
+
 namespace Scrobbling::ListenBrainz
 {
 	class ListensSynchronizer
 	{
 		public:
-			ListensSynchronizer(boost::asio::io_context& ioContext, Database::Db& db, Http::IClient& client);
+			ListensSynchronizer(boost::asio::io_context& ioContext, Database::Db& db, Http::IClient& client, ListenStatsCache& listenStatsCache);
 
 			void enqueListen(const TimedListen& listen);
-			void enqueListenNow(const Listen& listen);
+			void enqueListenNow(const Scrobbling::Listen& listen);
 
 		private:
-			void enqueListen(const Listen& listen, const Wt::WDateTime& timePoint);
+			void enqueListen(const Scrobbling::Listen& listen, const Wt::WDateTime& timePoint);
 			bool saveListen(const TimedListen& listen, Database::SyncState scrobblinState);
 
-			void enquePendingListens();
-
 			struct UserContext
 			{
 				UserContext(Database::UserId id) : userId {id} {}
@@ -69,6 +76,10 @@ namespace Scrobbling::ListenBrainz
 				bool						syncing {};
 				std::optional<std::size_t>	listenCount {};
 
+				// pending listens submission
+				bool						submittingListens {};
+				std::size_t					unsubmittableListenCount {}; // pending listens that cannot be converted, skipped
+
 				// resetted at each sync
 				std::string		listenBrainzUserName; // need to be resolved first
 				Wt::WDateTime	maxDateTime;
@@ -78,26 +89,35 @@ namespace Scrobbling::ListenBrainz
 			};
 
 			UserContext& getUserContext(Database::UserId userId);
+			void requestListensSubmission(UserContext& context);
+			void submitNextPendingListens(UserContext& context);
+			void onListensSubmitted(UserContext& context, std::span<const Database::ListenId> listenIds);
 			bool isSyncing() const;
 			void scheduleSync(std::chrono::seconds fromNow);
 			void startSync();
 			void startSync(UserContext& context);
+			void startPendingSyncs();
 			void onSyncEnded(UserContext& context);
 			void enqueValidateToken(UserContext& context);
 			void enqueGetListenCount(UserContext& context);
 			void enqueGetListens(UserContext& context);
-			void processGetListensResponse(std::string_view body, UserContext& context);
+			void processGetListensResponse(ListensParser::Result&& result, UserContext& context);
+			void importListens(std::span<const ListenBrainz::Listen> listens, UserContext& context);
 
 			boost::asio::io_context&		_ioContext;
 			boost::asio::io_context::strand	_strand {_ioContext};
 			Database::Db&					_db;
 			boost::asio::steady_timer		_syncTimer {_ioContext};
 			Http::IClient&					_client;
+			ListenStatsCache&				_listenStatsCache; // the saved listens are reported to it
 
 			std::unordered_map<Database::UserId, UserContext> _userContexts;
+			std::deque<Database::UserId> _pendingSyncUserIds; // waiting for a sync slot
 
 			const std::size_t			_maxSyncListenCount;
 			const std::chrono::hours	_syncListensPeriod;
+			const std::size_t			_maxSubmitListenCount; // per request
+			const std::size_t			_maxConcurrentSyncCount;
 	};
 } // Scrobbling::ListenBrainz
 
@@ -22,6 +22,8 @@
 #include <chrono>
 #include <memory>
 #include <optional>
+#include <span>
+#include <unordered_map>
 #include <boost/asio/io_service.hpp>
 #include <Wt/WDateTime.h>
 
@@ -63,12 +65,14 @@ namespace Scrobbling
             std::optional<Database::Range>                range;
             Database::MediaLibraryId                      library; // if set, match this library
             Database::ArtistId                            artist; // if set, match this artist
+            std::optional<Database::MonthRange>           period; // if set, only the listens of these months
 
             FindParameters& setUser(const Database::UserId _user) { user = _user; return *this; }
             FindParameters& setClusters(const std::vector<Database::ClusterId>& _clusters) { clusters = _clusters; return *this; }
             FindParameters& setRange(std::optional<Database::Range> _range) { range = _range; return *this; }
             FindParameters& setMediaLibrary(Database::MediaLibraryId _library) { library = _library; return *this; }
             FindParameters& setArtist(Database::ArtistId _artist) { artist = _artist; return *this; }
+            FindParameters& setPeriod(std::optional<Database::MonthRange> _period) { period = _period; return *this; }
         };
 
         // Artists
@@ -92,6 +96,15 @@ namespace Scrobbling
         virtual Wt::WDateTime getLastListenDateTime(Database::UserId userId, Database::ReleaseId releaseId) = 0;
         virtual Wt::WDateTime getLastListenDateTime(Database::UserId userId, Database::TrackId trackId) = 0;
 
+        // Same as getCount/getLastListenDateTime, for several tracks at once
+        struct TrackListenStats
+        {
+            std::size_t     count{};
+            Wt::WDateTime   lastListenDateTime;
+        };
+        using TrackListenStatsContainer = std::unordered_map<Database::TrackId, TrackListenStats>; // tracks that have never been listened to are not reported
+        virtual TrackListenStatsContainer getListenStats(Database::UserId userId, std::span<const Database::TrackId> trackIds) = 0;
+
         // Top
         virtual ArtistContainer getTopArtists(const ArtistFindParameters& params) = 0;
         virtual ReleaseContainer getTopReleases(const FindParameters& params) = 0;
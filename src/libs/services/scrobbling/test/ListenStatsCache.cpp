@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+
+#include "ListenStatsCache.hpp"
+
+using namespace Scrobbling;
+
+namespace
+{
+    const Wt::WDateTime dateTime1{ Wt::WDate{ 2000, 1, 2 }, Wt::WTime{ 12, 0, 1 } };
+    const Wt::WDateTime dateTime2{ Wt::WDate{ 2000, 1, 3 }, Wt::WTime{ 12, 0, 1 } };
+
+    std::optional<IScrobblingService::TrackListenStats> getTrackStats(const ListenStatsCache& cache, Database::UserId userId, Database::ScrobblingBackend backend, Database::TrackId trackId)
+    {
+        std::optional<IScrobblingService::TrackListenStats> res;
+        const bool loaded{ cache.visit(userId, backend, [&](const ListenStatsCache::TrackStatsContainer& stats)
+            {
+                if (const auto it{ stats.find(trackId) }; it != std::cend(stats))
+                    res = it->second;
+            }) };
+        EXPECT_TRUE(loaded);
+
+        return res;
+    }
+}
+
+TEST(ListenStatsCache, notLoaded)
+{
+    ListenStatsCache cache{ std::chrono::seconds{ 0 } };
+
+    bool visited{};
+    EXPECT_FALSE(cache.visit(Database::UserId{ 1 }, Database::ScrobblingBackend::Internal, [&](const ListenStatsCache::TrackStatsContainer&) { visited = true; }));
+    EXPECT_FALSE(visited);
+
+    // listens of unloaded users are not tracked
+    cache.onListenAdded(Database::UserId{ 1 }, Database::ScrobblingBackend::Internal, Database::TrackId{ 1 }, dateTime1);
+    EXPECT_FALSE(cache.visit(Database::UserId{ 1 }, Database::ScrobblingBackend::Internal, [&](const ListenStatsCache::TrackStatsContainer&) { visited = true; }));
+    EXPECT_FALSE(visited);
+}
+
+TEST(ListenStatsCache, onListenAdded)
+{
+    ListenStatsCache cache{ std::chrono::seconds{ 0 } };
+    const Database::UserId userId{ 1 };
+    const Database::TrackId trackId1{ 1 };
+    const Database::TrackId trackId2{ 2 };
+
+    ListenStatsCache::TrackStatsContainer stats;
+    stats.emplace(trackId1, IScrobblingService::TrackListenStats{ 2, dateTime2 });
+    cache.put(userId, Database::ScrobblingBackend::Internal, std::move(stats), cache.getGeneration());
+
+    cache.onListenAdded(userId, Database::ScrobblingBackend::Internal, trackId1, dateTime1);
+    cache.onListenAdded(userId, Database::ScrobblingBackend::Internal, trackId2, dateTime1);
+
+    const auto trackStats1{ getTrackStats(cache, userId, Database::ScrobblingBackend::Internal, trackId1) };
+    ASSERT_TRUE(trackStats1);
+    EXPECT_EQ(trackStats1->count, 3);
+    EXPECT_EQ(trackStats1->lastListenDateTime, dateTime2);
+
+    const auto trackStats2{ getTrackStats(cache, userId, Database::ScrobblingBackend::Internal, trackId2) };
+    ASSERT_TRUE(trackStats2);
+    EXPECT_EQ(trackStats2->count, 1);
+    EXPECT_EQ(trackStats2->lastListenDateTime, dateTime1);
+
+    // other backend not loaded
+    EXPECT_FALSE(cache.visit(userId, Database::ScrobblingBackend::ListenBrainz, [](const ListenStatsCache::TrackStatsContainer&) {}));
+}
+
+TEST(ListenStatsCache, staleLoad)
+{
+    ListenStatsCache cache{ std::chrono::seconds{ 0 } };
+    const Database::UserId userId{ 1 };
+
+    const std::uint64_t generation{ cache.getGeneration() };
+    // a listen is written while the stats are being loaded
+    cache.onListenAdded(userId, Database::ScrobblingBackend::Internal, Database::TrackId{ 1 }, dateTime1);
+    cache.put(userId, Database::ScrobblingBackend::Internal, {}, generation);
+
+    EXPECT_FALSE(cache.visit(userId, Database::ScrobblingBackend::Internal, [](const ListenStatsCache::TrackStatsContainer&) {}));
+}
+
+TEST(ListenStatsCache, invalidate)
+{
+    ListenStatsCache cache{ std::chrono::seconds{ 0 } };
+    const Database::UserId userId1{ 1 };
+    const Database::UserId userId2{ 2 };
+
+    cache.put(userId1, Database::ScrobblingBackend::Internal, {}, cache.getGeneration());
+    cache.put(userId2, Database::ScrobblingBackend::Internal, {}, cache.getGeneration());
+
+    cache.invalidate(userId1);
+    EXPECT_FALSE(cache.visit(userId1, Database::ScrobblingBackend::Internal, [](const ListenStatsCache::TrackStatsContainer&) {}));
+    EXPECT_TRUE(cache.visit(userId2, Database::ScrobblingBackend::Internal, [](const ListenStatsCache::TrackStatsContainer&) {}));
+}
@@ -51,4 +51,148 @@ static void BM_Matrix(benchmark::State& state)
 // Register the benchmark with custom range
 BENCHMARK(BM_Matrix)->Arg(3)->Arg(6)->Arg(12)->Arg(24);
 
+static std::vector<InputVector> generateSamples(std::size_t count, std::size_t dimCount)
+{
+    std::minstd_rand randomEngine{ 42 };
+    std::uniform_real_distribution<InputVector::value_type> distrib{ 0, 1 };
+
+    std::vector<InputVector> samples(count, InputVector{ dimCount });
+    for (InputVector& sample : samples)
+    {
+        for (InputVector::value_type& value : sample)
+            value = distrib(randomEngine);
+    }
+
+    return samples;
+}
+
+// args: network size, input dimension count
+template <typename Scalar>
+static void BM_Network_ClosestRefVector(benchmark::State& state)
+{
+    const BasicNetwork<Scalar> network{ static_cast<Coordinate>(state.range(0)), static_cast<Coordinate>(state.range(0)), static_cast<std::size_t>(state.range(1)) };
+    const std::vector<InputVector> samples{ generateSamples(64, state.range(1)) };
+
+    std::size_t i{};
+    for (auto _ : state)
+    {
+        const Position pos{ network.getClosestRefVectorPosition(samples[i++ % samples.size()]) };
+        benchmark::DoNotOptimize(pos);
+    }
+}
+
+BENCHMARK_TEMPLATE(BM_Network_ClosestRefVector, double)->ArgsProduct({ { 10, 20, 40 }, { 10, 40, 150 } });
+BENCHMARK_TEMPLATE(BM_Network_ClosestRefVector, float)->ArgsProduct({ { 10, 20, 40 }, { 10, 40, 150 } });
+
+// Samples gathered around a few centers, as real features are
+static std::vector<InputVector> generateClusteredSamples(std::size_t count, std::size_t dimCount)
+{
+    constexpr std::size_t clusterCount{ 16 };
+    const std::vector<InputVector> centers{ generateSamples(clusterCount, dimCount) };
+
+    std::minstd_rand randomEngine{ 42 };
+    std::normal_distribution<InputVector::value_type> distrib{ 0, 0.05 };
+
+    std::vector<InputVector> samples;
+    samples.reserve(count);
+    for (std::size_t i{}; i < count; ++i)
+    {
+        InputVector sample{ centers[i % clusterCount] };
+        for (InputVector::value_type& value : sample)
+            value += distrib(randomEngine);
+        samples.push_back(std::move(sample));
+    }
+
+    return samples;
+}
+
+// Closest ref vector of a trained network, most ref vectors are then far from the searched samples
+// args: network size, input dimension count
+static void BM_Network_ClosestRefVectorTrained(benchmark::State& state)
+{
+    const std::vector<InputVector> samples{ generateClusteredSamples(1000, state.range(1)) };
+    Network network{ static_cast<Coordinate>(state.range(0)), static_cast<Coordinate>(state.range(0)), static_cast<std::size_t>(state.range(1)) };
+    network.trainBatch(samples, 5, 0);
+
+    std::size_t i{};
+    for (auto _ : state)
+    {
+        const Position pos{ network.getClosestRefVectorPosition(samples[i++ % samples.size()]) };
+        benchmark::DoNotOptimize(pos);
+    }
+}
+
+BENCHMARK(BM_Network_ClosestRefVectorTrained)->ArgsProduct({ { 20, 40 }, { 40, 150 } });
+
+// Accuracy of the single precision network, compared to the double precision one trained the same way
+// args: network size, input dimension count
+static void BM_Network_FloatAccuracy(benchmark::State& state)
+{
+    const std::vector<InputVector> samples{ generateSamples(1000, state.range(1)) };
+
+    std::size_t sameClosestRefVectorCount{};
+    double distanceError{};
+    for (auto _ : state)
+    {
+        BasicNetwork<double> doubleNetwork{ static_cast<Coordinate>(state.range(0)), static_cast<Coordinate>(state.range(0)), static_cast<std::size_t>(state.range(1)) };
+        doubleNetwork.trainBatch(samples, 5, 1);
+
+        BasicNetwork<float> floatNetwork{ doubleNetwork.getWidth(), doubleNetwork.getHeight(), doubleNetwork.getInputDimCount() };
+        for (Coordinate y{}; y < doubleNetwork.getHeight(); ++y)
+        {
+            for (Coordinate x{}; x < doubleNetwork.getWidth(); ++x)
+                floatNetwork.setRefVector({ x, y }, doubleNetwork.getRefVector({ x, y }));
+        }
+
+        sameClosestRefVectorCount = 0;
+        distanceError = 0;
+        for (const InputVector& sample : samples)
+        {
+            const Position doublePosition{ doubleNetwork.getClosestRefVectorPosition(sample) };
+            const Position floatPosition{ floatNetwork.getClosestRefVectorPosition(sample) };
+            if (doublePosition == floatPosition)
+                sameClosestRefVectorCount++;
+
+            const InputVector::Distance doubleDistance{ sample.computeEuclidianSquareDistance(doubleNetwork.getRefVector(doublePosition), doubleNetwork.getDataWeights()) };
+            const InputVector::Distance floatDistance{ sample.computeEuclidianSquareDistance(doubleNetwork.getRefVector(floatPosition), doubleNetwork.getDataWeights()) };
+            distanceError += floatDistance - doubleDistance;
+        }
+    }
+
+    state.counters["same_closest_ratio"] = static_cast<double>(sameClosestRefVectorCount) / samples.size();
+    state.counters["mean_distance_error"] = distanceError / samples.size();
+}
+
+BENCHMARK(BM_Network_FloatAccuracy)->ArgsProduct({ { 10, 20 }, { 40, 150 } })->Unit(benchmark::kMillisecond)->Iterations(1);
+
+// args: network size, input dimension count
+static void BM_Network_Train(benchmark::State& state)
+{
+    const std::vector<InputVector> samples{ generateSamples(1000, state.range(1)) };
+
+    for (auto _ : state)
+    {
+        Network network{ static_cast<Coordinate>(state.range(0)), static_cast<Coordinate>(state.range(0)), static_cast<std::size_t>(state.range(1)) };
+        network.train(samples, 1);
+        benchmark::DoNotOptimize(network);
+    }
+}
+
+BENCHMARK(BM_Network_Train)->ArgsProduct({ { 10, 20 }, { 40, 150 } })->Unit(benchmark::kMillisecond);
+
+// args: network size, input dimension count, thread count
+static void BM_Network_TrainBatch(benchmark::State& state)
+{
+    const std::vector<InputVector> samples{ generateSamples(1000, state.range(1)) };
+
+    for (auto _ : state)
+    {
+        Network network{ static_cast<Coordinate>(state.range(0)), static_cast<Coordinate>(state.range(0)), static_cast<std::size_t>(state.range(1)) };
+        network.trainBatch(samples, 1, state.range(2));
+        benchmark::DoNotOptimize(network);
+    }
+}
+
+BENCHMARK(BM_Network_TrainBatch)->ArgsProduct({ { 10, 20 }, { 40, 150 }, { 1, 4 } })->Unit(benchmark::kMillisecond)->UseRealTime();
+
 BENCHMARK_MAIN();
\ No newline at end of file
@@ -20,8 +20,12 @@
 #include "som/DataNormalizer.hpp"
 
 #include <algorithm>
+#include <limits>
 #include <numeric>
 #include <sstream>
+#include <thread>
+
+#include "ParallelFor.hpp"
 
 namespace SOM
 {
@@ -47,6 +51,7 @@ variance(const std::vector<T>& vec)
 
 DataNormalizer::DataNormalizer(std::size_t inputDimCount)
 : _inputDimCount{inputDimCount}
+, _minmax(inputDimCount)
 {
 }
 
@@ -62,31 +67,71 @@ DataNormalizer::setValue(std::size_t index, const MinMax& minMax)
 	_minmax[index] = minMax;
 }
 
+static std::size_t
+getThreadCount(std::size_t threadCount, std::size_t itemCount)
+{
+	if (threadCount == 0)
+		threadCount = std::max<std::size_t>(1, std::thread::hardware_concurrency());
+
+	return std::max<std::size_t>(1, std::min(threadCount, itemCount));
+}
+
 void
-DataNormalizer::computeNormalizationFactors(const std::vector<InputVector>& inputVectors)
+DataNormalizer::updateMinMax(std::vector<MinMax>& minmax, const InputVector& inputVector)
+{
+	const InputVector::value_type* values {inputVector.data()};
+	for (std::size_t dimId {}; dimId < minmax.size(); ++dimId)
+	{
+		minmax[dimId].min = std::min(minmax[dimId].min, values[dimId]);
+		minmax[dimId].max = std::max(minmax[dimId].max, values[dimId]);
+	}
+}
+
+void
+DataNormalizer::computeNormalizationFactors(const std::vector<InputVector>& inputVectors, std::size_t threadCount)
 {
 	if (inputVectors.empty())
 		throw Exception("Empty input vectors");
 
-	// For each dimension of the input, compute the min/max
-	_minmax.clear();
-	_minmax.resize(_inputDimCount);
+	for (const InputVector& inputVector : inputVectors)
+		checkSameDimensions(inputVector, _inputDimCount);
 
-	for (std::size_t dimId {}; dimId < _inputDimCount; ++dimId)
+	// For each dimension of the input, compute the min/max, using one accumulator per thread
+	threadCount = getThreadCount(threadCount, inputVectors.size());
+	const MinMax initialMinMax {std::numeric_limits<InputVector::value_type>::max(), std::numeric_limits<InputVector::value_type>::lowest()};
+	std::vector<std::vector<MinMax>> minmaxByThread(threadCount, std::vector<MinMax>(_inputDimCount, initialMinMax));
+
+	parallelFor(inputVectors.size(), threadCount, [&](std::size_t begin, std::size_t end, std::size_t threadIndex)
 	{
-		std::vector<InputVector::value_type> values;
+		for (std::size_t i {begin}; i < end; ++i)
+			updateMinMax(minmaxByThread[threadIndex], inputVectors[i]);
+	});
 
-		for (const auto& inputVector: inputVectors)
+	_minmax = std::move(minmaxByThread[0]);
+	for (std::size_t threadIndex {1}; threadIndex < threadCount; ++threadIndex)
+	{
+		for (std::size_t dimId {}; dimId < _inputDimCount; ++dimId)
 		{
-			checkSameDimensions(inputVector, _inputDimCount);
-			values.push_back(inputVector[dimId]);
+			_minmax[dimId].min = std::min(_minmax[dimId].min, minmaxByThread[threadIndex][dimId].min);
+			_minmax[dimId].max = std::max(_minmax[dimId].max, minmaxByThread[threadIndex][dimId].max);
 		}
-
-		auto result {std::minmax_element(values.begin(), values.end())};
-		_minmax[dimId] = {*result.first, *result.second};
 	}
 }
 
+void
+DataNormalizer::resetNormalizationFactors()
+{
+	_minmax.assign(_inputDimCount, MinMax {std::numeric_limits<InputVector::value_type>::max(), std::numeric_limits<InputVector::value_type>::lowest()});
+}
+
+void
+DataNormalizer::updateNormalizationFactors(const InputVector& inputVector)
+{
+	checkSameDimensions(inputVector, _inputDimCount);
+
+	updateMinMax(_minmax, inputVector);
+}
+
 InputVector::value_type
 DataNormalizer::normalizeValue(InputVector::value_type value, std::size_t dimId) const
 {
@@ -110,6 +155,20 @@ DataNormalizer::normalizeData(InputVector& a) const
 	}
 }
 
+void
+DataNormalizer::normalizeData(std::vector<InputVector>& inputVectors, std::size_t threadCount) const
+{
+	// checked beforehand, so that the worker threads cannot throw
+	for (const InputVector& inputVector : inputVectors)
+		checkSameDimensions(inputVector, _inputDimCount);
+
+	parallelFor(inputVectors.size(), getThreadCount(threadCount, inputVectors.size()), [&](std::size_t begin, std::size_t end, std::size_t)
+	{
+		for (std::size_t i {begin}; i < end; ++i)
+			normalizeData(inputVectors[i]);
+	});
+}
+
 void
 DataNormalizer::dump(std::ostream& os) const
 {
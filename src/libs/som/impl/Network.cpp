@@ -20,14 +20,19 @@
 #include "som/Network.hpp"
 
 #include <algorithm>
+#include <cassert>
 #include <chrono>
 #include <cmath>
+#include <limits>
+#include <numeric>
 #include <random>
 #include <sstream>
+#include <thread>
 #include <unordered_set>
 
 #include "utils/ILogger.hpp"
 #include "utils/Random.hpp"
+#include "ParallelFor.hpp"
 
 namespace SOM
 {
@@ -47,7 +52,7 @@ checkSameDimensions(const InputVector& a, std::size_t inputDimCount)
 }
 
 static LearningFactor
-defaultLearningFactor(Network::CurrentIteration iteration)
+defaultLearningFactor(CurrentIteration iteration)
 {
 	static const LearningFactor initialValue{1};
 
@@ -60,9 +65,62 @@ euclidianSquareDistance(const InputVector& a, const InputVector& b, const InputV
 	return a.computeEuclidianSquareDistance(b, weights);
 }
 
+// Vectors are processed by blocks of this size, using independent accumulators so that the compiler can vectorize the loops
+static constexpr std::size_t blockSize {4};
+
+static std::size_t
+computeStride(std::size_t inputDimCount)
+{
+	return (inputDimCount + blockSize - 1) / blockSize * blockSize;
+}
+
+// Accumulated using the storage type, so that the loops keep the same vector width as the loads
+template <typename Scalar>
+static InputVector::Distance
+weightedSquareDistance(const Scalar* __restrict a, const Scalar* __restrict b, const Scalar* __restrict weights, std::size_t stride)
+{
+	Scalar acc[blockSize] {};
+	for (std::size_t i {}; i < stride; i += blockSize)
+	{
+		for (std::size_t j {}; j < blockSize; ++j)
+		{
+			const Scalar diff {a[i + j] - b[i + j]};
+			acc[j] += diff * diff * weights[i + j];
+		}
+	}
+
+	InputVector::Distance res {};
+	for (std::size_t j {}; j < blockSize; ++j)
+		res += acc[j];
+
+	return res;
+}
+
+// Partial sums are checked against the bound once per chunk of this size, to keep the inner loops vectorized
+static constexpr std::size_t boundCheckChunkSize {8 * blockSize};
+
+// Same as weightedSquareDistance, but stops as soon as the partial sum reaches bound (weights must be positive)
+// In that case, the returned value is only guaranteed to be greater or equal to bound
+template <typename Scalar>
+static InputVector::Distance
+boundedWeightedSquareDistance(const Scalar* __restrict a, const Scalar* __restrict b, const Scalar* __restrict weights, std::size_t stride, InputVector::Distance bound)
+{
+	InputVector::Distance res {};
+
+	std::size_t offset {};
+	for (; offset + boundCheckChunkSize < stride; offset += boundCheckChunkSize)
+	{
+		res += weightedSquareDistance(a + offset, b + offset, weights + offset, boundCheckChunkSize);
+		if (res >= bound)
+			return res;
+	}
+
+	return res + weightedSquareDistance(a + offset, b + offset, weights + offset, stride - offset);
+}
+
 static
 InputVector::value_type
-sigmaFunc(Network::CurrentIteration iteration)
+sigmaFunc(CurrentIteration iteration)
 {
 	constexpr InputVector::value_type sigma0 {1};
 
@@ -71,67 +129,119 @@ sigmaFunc(Network::CurrentIteration iteration)
 
 static
 InputVector::value_type
-defaultNeighbourhoodFunc(Norm norm, const Network::CurrentIteration& iteration)
+defaultNeighbourhoodFunc(Norm norm, const CurrentIteration& iteration)
 {
 	InputVector::value_type sigma {sigmaFunc(iteration)};
 
 	return exp(-norm / (2 * sigma * sigma));
 }
 
-Network::Network(Coordinate width, Coordinate height, std::size_t inputDimCount)
+template <typename Scalar>
+BasicNetwork<Scalar>::BasicNetwork(Coordinate width, Coordinate height, std::size_t inputDimCount)
 :
+_width {width},
+_height {height},
 _inputDimCount {inputDimCount},
+_stride {computeStride(inputDimCount)},
 _weights {inputDimCount, static_cast<InputVector::value_type>(1)},
-_refVectors {width, height, _inputDimCount},
-_distanceFunc {euclidianSquareDistance},
+_paddedWeights(_stride),
+_refVectors(static_cast<std::size_t>(width) * height * _stride),
 _learningFactorFunc {defaultLearningFactor},
 _neighbourhoodFunc {defaultNeighbourhoodFunc}
 {
+	toPaddedVector(_weights, _paddedWeights.data());
+
 	// init each vector with a random normalized value
-	for (Coordinate y {}; y < _refVectors.getHeight(); ++y)
+	for (Coordinate y {}; y < _height; ++y)
 	{
-		for (Coordinate x {}; x < _refVectors.getWidth(); ++x)
+		for (Coordinate x {}; x < _width; ++x)
 		{
-			for (InputVector::value_type& val : _refVectors.get({x,y}))
-				val = Random::getRealRandom<InputVector::value_type>(0, 1);
+			value_type* refVector {getRefVectorData({x, y})};
+			for (std::size_t i {}; i < _inputDimCount; ++i)
+				refVector[i] = Random::getRealRandom<InputVector::value_type>(0, 1);
 		}
 	}
 }
 
+template <typename Scalar>
 void
-Network::setDataWeights(const InputVector& weights)
+BasicNetwork<Scalar>::setDataWeights(const InputVector& weights)
 {
 	checkSameDimensions(weights, _inputDimCount);
 
 	_weights = weights;
+	toPaddedVector(_weights, _paddedWeights.data());
 }
 
+template <typename Scalar>
 void
-Network::setRefVector(const Position& position, const InputVector& data)
+BasicNetwork<Scalar>::setRefVector(const Position& position, const InputVector& data)
 {
 	checkSameDimensions(data, _inputDimCount);
 
-	_refVectors[position] = data;
+	toPaddedVector(data, getRefVectorData(position));
+}
+
+template <typename Scalar>
+typename BasicNetwork<Scalar>::DistanceFunc
+BasicNetwork<Scalar>::getDistanceFunc() const
+{
+	return euclidianSquareDistance;
+}
+
+template <typename Scalar>
+void
+BasicNetwork<Scalar>::toPaddedVector(const InputVector& input, value_type* output) const
+{
+	std::copy(input.data(), input.data() + _inputDimCount, output);
+	std::fill(output + _inputDimCount, output + _stride, value_type {});
+}
+
+template <typename Scalar>
+typename BasicNetwork<Scalar>::value_type*
+BasicNetwork<Scalar>::getRefVectorData(const Position& position)
+{
+	assert(position.x < _width);
+	assert(position.y < _height);
+	return _refVectors.data() + (position.x + static_cast<std::size_t>(_width) * position.y) * _stride;
+}
+
+template <typename Scalar>
+const typename BasicNetwork<Scalar>::value_type*
+BasicNetwork<Scalar>::getRefVectorData(const Position& position) const
+{
+	assert(position.x < _width);
+	assert(position.y < _height);
+	return _refVectors.data() + (position.x + static_cast<std::size_t>(_width) * position.y) * _stride;
+}
+
+template <typename Scalar>
+Position
+BasicNetwork<Scalar>::indexToPosition(std::size_t index) const
+{
+	return Position {static_cast<Coordinate>(index % _width), static_cast<Coordinate>(index / _width)};
 }
 
+template <typename Scalar>
 InputVector::Distance
-Network::getRefVectorsDistance(const Position& position1, const Position& position2) const
+BasicNetwork<Scalar>::getRefVectorsDistance(const Position& position1, const Position& position2) const
 {
-	return _distanceFunc(_refVectors.get(position1), _refVectors.get(position2), _weights);
+	return weightedSquareDistance(getRefVectorData(position1), getRefVectorData(position2), _paddedWeights.data(), _stride);
 }
 
+template <typename Scalar>
 InputVector::Distance
-Network::computeRefVectorsDistanceMean() const
+BasicNetwork<Scalar>::computeRefVectorsDistanceMean() const
 {
 	std::vector<InputVector::Distance> values;
-	values.reserve(2 * _refVectors.getHeight()*_refVectors.getWidth() - _refVectors.getWidth() - _refVectors.getHeight());
-	for (Coordinate y {}; y < _refVectors.getHeight(); ++y)
+	values.reserve(2 * _height * _width - _width - _height);
+	for (Coordinate y {}; y < _height; ++y)
 	{
-		for (Coordinate x {}; x < _refVectors.getWidth(); ++x)
+		for (Coordinate x {}; x < _width; ++x)
 		{
-			if (x != _refVectors.getWidth() - 1)
+			if (x != _width - 1)
 				values.emplace_back(getRefVectorsDistance( {x, y}, {x + 1, y}));
-			if (y != _refVectors.getHeight() - 1)
+			if (y != _height - 1)
 				values.emplace_back(getRefVectorsDistance( {x, y}, {x, y + 1}));
 		}
 	}
@@ -139,18 +249,19 @@ Network::computeRefVectorsDistanceMean() const
 	return std::accumulate(values.begin(), values.end(), 0.) / values.size();
 }
 
+template <typename Scalar>
 double
-Network::computeRefVectorsDistanceMedian() const
+BasicNetwork<Scalar>::computeRefVectorsDistanceMedian() const
 {
 	std::vector<InputVector::Distance> values;
-	values.reserve(2*_refVectors.getHeight()*_refVectors.getWidth() - _refVectors.getWidth() - _refVectors.getHeight());
-	for (Coordinate y {}; y < _refVectors.getHeight(); ++y)
+	values.reserve(2 * _height * _width - _width - _height);
+	for (Coordinate y {}; y < _height; ++y)
 	{
-		for (Coordinate x {}; x < _refVectors.getWidth(); ++x)
+		for (Coordinate x {}; x < _width; ++x)
 		{
-			if (x != _refVectors.getWidth() - 1)
+			if (x != _width - 1)
 				values.emplace_back(getRefVectorsDistance( {x, y}, {x + 1, y}));
-			if (y != _refVectors.getHeight() - 1)
+			if (y != _height - 1)
 				values.emplace_back(getRefVectorsDistance( {x, y}, {x, y + 1}));
 		}
 	}
@@ -160,16 +271,17 @@ Network::computeRefVectorsDistanceMedian() const
 	return values[values.size() > 1 ? values.size()/2 - 1 : 0];
 }
 
+template <typename Scalar>
 void
-Network::dump(std::ostream& os) const
+BasicNetwork<Scalar>::dump(std::ostream& os) const
 {
-	os << "Width: " << _refVectors.getWidth() << ", Height: " << _refVectors.getHeight() << std::endl;;
+	os << "Width: " << _width << ", Height: " << _height << std::endl;;
 
-	for (Coordinate y {}; y < _refVectors.getHeight(); ++y)
+	for (Coordinate y {}; y < _height; ++y)
 	{
-		for (Coordinate x {}; x < _refVectors.getWidth(); ++x)
+		for (Coordinate x {}; x < _width; ++x)
 		{
-			os << _refVectors.get({x, y}) << " ";
+			os << getRefVector({x, y}) << " ";
 		}
 
 		os << std::endl;
@@ -177,39 +289,90 @@ Network::dump(std::ostream& os) const
 	os << std::endl;
 }
 
+template <typename Scalar>
+std::size_t
+BasicNetwork<Scalar>::getClosestRefVectorIndex(const value_type* paddedData, InputVector::Distance* distanceToClosest) const
+{
+	std::size_t closestIndex {};
+	InputVector::Distance closestDistance {std::numeric_limits<InputVector::Distance>::max()};
+
+	const std::size_t refVectorCount {static_cast<std::size_t>(_width) * _height};
+	for (std::size_t index {}; index < refVectorCount; ++index)
+	{
+		// most ref vectors are far from the data: give up on them as soon as they cannot be the closest one
+		const InputVector::Distance distance {boundedWeightedSquareDistance(_refVectors.data() + index * _stride, paddedData, _paddedWeights.data(), _stride, closestDistance)};
+		if (distance < closestDistance)
+		{
+			closestDistance = distance;
+			closestIndex = index;
+		}
+	}
+
+	if (distanceToClosest)
+		*distanceToClosest = closestDistance;
+
+	return closestIndex;
+}
+
+template <typename Scalar>
 Position
-Network::getClosestRefVectorPosition(const InputVector& data) const
+BasicNetwork<Scalar>::getClosestRefVectorPosition(const InputVector& data) const
 {
-	return _refVectors.getPositionMinElement([&](const auto& a, const auto& b)
-			{
-				return (_distanceFunc(a, data, _weights) < _distanceFunc(b, data, _weights));
-			});
+	checkSameDimensions(data, _inputDimCount);
+
+	std::vector<value_type> paddedData(_stride);
+	toPaddedVector(data, paddedData.data());
+
+	return indexToPosition(getClosestRefVectorIndex(paddedData.data()));
 }
 
+template <typename Scalar>
 std::optional<Position>
-Network::getClosestRefVectorPosition(const InputVector& data, InputVector::Distance maxDistance) const
+BasicNetwork<Scalar>::getClosestRefVectorPosition(const InputVector& data, InputVector::Distance maxDistance) const
 {
-	std::optional<Position> position {getClosestRefVectorPosition(data)};
+	checkSameDimensions(data, _inputDimCount);
+
+	std::vector<value_type> paddedData(_stride);
+	toPaddedVector(data, paddedData.data());
 
-	if (_distanceFunc(data, _refVectors.get(*position), _weights) > maxDistance)
+	InputVector::Distance distance {};
+	std::optional<Position> position {indexToPosition(getClosestRefVectorIndex(paddedData.data(), &distance))};
+
+	if (distance > maxDistance)
 		position.reset();
 
 	return position;
 }
 
+template <typename Scalar>
+typename BasicNetwork<Scalar>::ClosestRefVector
+BasicNetwork<Scalar>::getClosestRefVector(const InputVector& data) const
+{
+	checkSameDimensions(data, _inputDimCount);
+
+	std::vector<value_type> paddedData(_stride);
+	toPaddedVector(data, paddedData.data());
+
+	ClosestRefVector res;
+	res.position = indexToPosition(getClosestRefVectorIndex(paddedData.data(), &res.distance));
+
+	return res;
+}
+
+template <typename Scalar>
 std::optional<Position>
-Network::getClosestRefVectorPosition(const std::vector<Position>& refVectorsPosition, InputVector::Distance maxDistance) const
+BasicNetwork<Scalar>::getClosestRefVectorPosition(const std::vector<Position>& refVectorsPosition, InputVector::Distance maxDistance) const
 {
 	std::unordered_set<Position> neighboursPosition;
 	for (const Position& refVectorPosition : refVectorsPosition)
 	{
 		if (refVectorPosition.y > 0)
 			neighboursPosition.insert({ refVectorPosition.x, refVectorPosition.y - 1 });
-		if (refVectorPosition.y < _refVectors.getHeight() - 1)
+		if (refVectorPosition.y < _height - 1)
 			neighboursPosition.insert({ refVectorPosition.x, refVectorPosition.y + 1 });
 		if (refVectorPosition.x > 0)
 			neighboursPosition.insert({ refVectorPosition.x - 1, refVectorPosition.y });
-		if (refVectorPosition.x < _refVectors.getWidth() - 1)
+		if (refVectorPosition.x < _width - 1)
 			neighboursPosition.insert({ refVectorPosition.x + 1, refVectorPosition.y });
 	}
 
@@ -262,34 +425,51 @@ computePositionNorm(const Position& c1, const Position& c2)
 	return std::sqrt((c1.x - c2.x) * (c1.x - c2.x) + (c1.y - c2.y) * (c1.y - c2.y));
 }
 
+template <typename Scalar>
 void
-Network::updateRefVectors(const Position& closestRefVectorPosition, const InputVector& input, LearningFactor learningFactor, const CurrentIteration& iteration)
+BasicNetwork<Scalar>::updateRefVectors(const Position& closestRefVectorPosition, const value_type* __restrict paddedInput, LearningFactor learningFactor, const CurrentIteration& iteration)
 {
-	for (Coordinate y {}; y < _refVectors.getHeight(); ++y)
+	for (Coordinate y {}; y < _height; ++y)
 	{
-		for (Coordinate x {}; x < _refVectors.getWidth(); ++x)
+		for (Coordinate x {}; x < _width; ++x)
 		{
-			InputVector& refVector {_refVectors.get({x, y})};
+			value_type* __restrict refVector {getRefVectorData({x, y})};
 
 			const Norm norm {computePositionNorm({x, y}, closestRefVectorPosition)};
+			const value_type factor {static_cast<value_type>(learningFactor * _neighbourhoodFunc(norm, iteration))};
 
-			InputVector delta {input - refVector};
-			delta *= (learningFactor * _neighbourhoodFunc(norm, iteration));
-
-			refVector += delta;
+			for (std::size_t i {}; i < _stride; ++i)
+				refVector[i] += factor * (paddedInput[i] - refVector[i]);
 		}
 	}
 }
 
+template <typename Scalar>
+std::vector<typename BasicNetwork<Scalar>::value_type>
+BasicNetwork<Scalar>::toPaddedVectors(const std::vector<InputVector>& inputData) const
+{
+	std::vector<value_type> res(inputData.size() * _stride);
+	for (std::size_t i {}; i < inputData.size(); ++i)
+	{
+		checkSameDimensions(inputData[i], _inputDimCount);
+		toPaddedVector(inputData[i], res.data() + i * _stride);
+	}
+
+	return res;
+}
+
+template <typename Scalar>
 void
-Network::train(const std::vector<InputVector>& inputData, std::size_t nbIterations, ProgressCallback progressCallback, RequestStopCallback requestStopCallback)
+BasicNetwork<Scalar>::train(const std::vector<InputVector>& inputData, std::size_t nbIterations, ProgressCallback progressCallback, RequestStopCallback requestStopCallback)
 {
 	bool stopRequested {false};
-	std::vector<const InputVector*> inputDataShuffled;
 
+	// converted once for all iterations
+	const std::vector<value_type> paddedInputData {toPaddedVectors(inputData)};
+	std::vector<const value_type*> inputDataShuffled;
 	inputDataShuffled.reserve(inputData.size());
-	for (const auto& input : inputData)
-		inputDataShuffled.push_back(&input);
+	for (std::size_t i {}; i < inputData.size(); ++i)
+		inputDataShuffled.push_back(paddedInputData.data() + i * _stride);
 
 	for (std::size_t i {}; i < nbIterations; ++i)
 	{
@@ -302,7 +482,7 @@ Network::train(const std::vector<InputVector>& inputData, std::size_t nbIteratio
 
 		const LearningFactor learningFactor {_learningFactorFunc(curIter)};
 
-		for (const InputVector* input : inputDataShuffled)
+		for (const value_type* input : inputDataShuffled)
 		{
 			if (requestStopCallback)
 				stopRequested = requestStopCallback();
@@ -310,7 +490,7 @@ Network::train(const std::vector<InputVector>& inputData, std::size_t nbIteratio
 			if (stopRequested)
 				return;
 
-			updateRefVectors(getClosestRefVectorPosition(*input), *input, learningFactor, curIter);
+			updateRefVectors(indexToPosition(getClosestRefVectorIndex(input)), input, learningFactor, curIter);
 		}
 
 		if (stopRequested)
@@ -318,12 +498,148 @@ Network::train(const std::vector<InputVector>& inputData, std::size_t nbIteratio
 	}
 }
 
-const InputVector&
-Network::getRefVector(const Position& position) const
+template <typename Scalar>
+void
+BasicNetwork<Scalar>::trainBatch(const std::vector<InputVector>& inputData, std::size_t nbIterations, std::size_t threadCount, ProgressCallback progressCallback, RequestStopCallback requestStopCallback)
+{
+	if (threadCount == 0)
+		threadCount = std::max<std::size_t>(1, std::thread::hardware_concurrency());
+
+	const std::size_t refVectorCount {static_cast<std::size_t>(_width) * _height};
+	const std::vector<value_type> paddedInputData {toPaddedVectors(inputData)};
+
+	// per thread sum of the samples matched by each ref vector, and number of such samples
+	struct Accumulator
+	{
+		std::vector<value_type> sums;
+		std::vector<value_type> counts;
+	};
+	std::vector<Accumulator> accumulators(threadCount);
+	for (Accumulator& accumulator : accumulators)
+	{
+		accumulator.sums.resize(refVectorCount * _stride);
+		accumulator.counts.resize(refVectorCount);
+	}
+
+	// neighbourhood factor only depends on the offset between positions: index is (dx + width - 1) + (dy + height - 1) * (2 * width - 1)
+	const std::size_t neighbourhoodWidth {2 * static_cast<std::size_t>(_width) - 1};
+	std::vector<value_type> neighbourhoodFactors(neighbourhoodWidth * (2 * static_cast<std::size_t>(_height) - 1));
+
+	std::vector<value_type> newRefVectors(_refVectors.size());
+
+	// Contrary to the online mode, random ref vectors easily end up all matching the same few samples and get merged on the first pass
+	// Start from randomly picked samples instead
+	if (!inputData.empty())
+	{
+		std::vector<std::size_t> sampleIndexes(inputData.size());
+		std::iota(std::begin(sampleIndexes), std::end(sampleIndexes), 0);
+		Random::shuffleContainer(sampleIndexes);
+
+		for (std::size_t index {}; index < refVectorCount; ++index)
+		{
+			const value_type* input {paddedInputData.data() + sampleIndexes[index % sampleIndexes.size()] * _stride};
+			std::copy(input, input + _stride, _refVectors.data() + index * _stride);
+		}
+	}
+
+	for (std::size_t i {}; i < nbIterations; ++i)
+	{
+		CurrentIteration curIter {i, nbIterations};
+
+		if (progressCallback)
+			progressCallback(curIter);
+
+		if (requestStopCallback && requestStopCallback())
+			return;
+
+		parallelFor(inputData.size(), threadCount, [&](std::size_t begin, std::size_t end, std::size_t threadIndex)
+		{
+			Accumulator& accumulator {accumulators[threadIndex]};
+			std::fill(std::begin(accumulator.sums), std::end(accumulator.sums), value_type {});
+			std::fill(std::begin(accumulator.counts), std::end(accumulator.counts), value_type {});
+
+			for (std::size_t sampleIndex {begin}; sampleIndex < end; ++sampleIndex)
+			{
+				const value_type* __restrict input {paddedInputData.data() + sampleIndex * _stride};
+				const std::size_t closestIndex {getClosestRefVectorIndex(input)};
+
+				value_type* __restrict sum {accumulator.sums.data() + closestIndex * _stride};
+				for (std::size_t j {}; j < _stride; ++j)
+					sum[j] += input[j];
+				accumulator.counts[closestIndex] += 1;
+			}
+		});
+
+		for (std::size_t threadIndex {1}; threadIndex < threadCount; ++threadIndex)
+		{
+			for (std::size_t j {}; j < accumulators[0].sums.size(); ++j)
+				accumulators[0].sums[j] += accumulators[threadIndex].sums[j];
+			for (std::size_t j {}; j < refVectorCount; ++j)
+				accumulators[0].counts[j] += accumulators[threadIndex].counts[j];
+		}
+		const Accumulator& total {accumulators[0]};
+
+		for (Coordinate dy {}; dy < 2 * _height - 1; ++dy)
+		{
+			for (Coordinate dx {}; dx < 2 * _width - 1; ++dx)
+				neighbourhoodFactors[dx + dy * neighbourhoodWidth] = _neighbourhoodFunc(computePositionNorm({dx, dy}, {_width - 1, _height - 1}), curIter);
+		}
+
+		parallelFor(refVectorCount, threadCount, [&](std::size_t begin, std::size_t end, std::size_t)
+		{
+			for (std::size_t index {begin}; index < end; ++index)
+			{
+				const Position position {indexToPosition(index)};
+				value_type* __restrict newRefVector {newRefVectors.data() + index * _stride};
+				std::fill(newRefVector, newRefVector + _stride, value_type {});
+
+				value_type denominator {};
+				for (std::size_t matchingIndex {}; matchingIndex < refVectorCount; ++matchingIndex)
+				{
+					if (total.counts[matchingIndex] == 0)
+						continue;
+
+					const Position matchingPosition {indexToPosition(matchingIndex)};
+					const value_type factor {neighbourhoodFactors[(matchingPosition.x + _width - 1 - position.x) + (matchingPosition.y + _height - 1 - position.y) * neighbourhoodWidth]};
+
+					const value_type* __restrict sum {total.sums.data() + matchingIndex * _stride};
+					for (std::size_t j {}; j < _stride; ++j)
+						newRefVector[j] += factor * sum[j];
+					denominator += factor * total.counts[matchingIndex];
+				}
+
+				// keep ref vectors that are too far from any sample
+				if (denominator > std::numeric_limits<value_type>::min())
+				{
+					for (std::size_t j {}; j < _stride; ++j)
+						newRefVector[j] /= denominator;
+				}
+				else
+				{
+					const value_type* refVector {_refVectors.data() + index * _stride};
+					std::copy(refVector, refVector + _stride, newRefVector);
+				}
+			}
+		});
+
+		_refVectors.swap(newRefVectors);
+	}
+}
+
+template <typename Scalar>
+InputVector
+BasicNetwork<Scalar>::getRefVector(const Position& position) const
 {
-	return _refVectors[position];
+	InputVector res {_inputDimCount};
+
+	const value_type* refVector {getRefVectorData(position)};
+	std::copy(refVector, refVector + _inputDimCount, std::begin(res));
+
+	return res;
 }
 
+template class BasicNetwork<float>;
+template class BasicNetwork<double>;
 
 } // namespace SOM
 
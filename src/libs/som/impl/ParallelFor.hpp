@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace SOM
+{
+
+// Split [0, count) in contiguous chunks, processed by threadCount threads
+// func(begin, end, threadIndex) is called once per chunk
+template <typename Func>
+void
+parallelFor(std::size_t count, std::size_t threadCount, Func func)
+{
+	const std::size_t chunkSize {(count + threadCount - 1) / threadCount};
+
+	std::vector<std::thread> threads;
+	threads.reserve(threadCount - 1);
+	for (std::size_t threadIndex {1}; threadIndex < threadCount; ++threadIndex)
+	{
+		const std::size_t begin {std::min(count, threadIndex * chunkSize)};
+		const std::size_t end {std::min(count, begin + chunkSize)};
+		threads.emplace_back([=, &func] { func(begin, end, threadIndex); });
+	}
+
+	func(0, std::min(count, chunkSize), 0);
+
+	for (std::thread& thread : threads)
+		thread.join();
+}
+
+} // namespace SOM
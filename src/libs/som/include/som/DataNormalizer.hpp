@@ -43,14 +43,22 @@ class DataNormalizer
 
 		void setValue(std::size_t index, const MinMax& minMax);
 
-		void computeNormalizationFactors(const std::vector<InputVector>& dataSamples);
+		// Single pass over the samples, split among threadCount threads (0 means number of logical CPUs)
+		void computeNormalizationFactors(const std::vector<InputVector>& dataSamples, std::size_t threadCount = 1);
+
+		// Streaming alternative, samples are taken into account one by one as they are produced
+		void resetNormalizationFactors();
+		void updateNormalizationFactors(const InputVector& dataSample);
 
 		void normalizeData(InputVector& data) const;
+		// in place, split among threadCount threads (0 means number of logical CPUs)
+		void normalizeData(std::vector<InputVector>& dataSamples, std::size_t threadCount = 1) const;
 
 		void dump(std::ostream& os) const;
 
 	private:
 		InputVector::value_type normalizeValue(InputVector::value_type value, std::size_t dimensionId) const;
+		static void updateMinMax(std::vector<MinMax>& minmax, const InputVector& dataSample);
 
 		const std::size_t _inputDimCount;
 
@@ -22,6 +22,7 @@
 
 #include <vector>
 #include <cmath>
+#include <ostream>
 
 #include "utils/Exception.hpp"
 
@@ -132,6 +133,12 @@ class InputVector
 			return res;
 		}
 
+		// unchecked access, for internal loops
+		const value_type* data() const
+		{
+			return _values.data();
+		}
+
 		std::vector<value_type>::iterator begin()
 		{
 			return _values.begin();
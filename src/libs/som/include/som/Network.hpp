@@ -37,14 +37,23 @@ namespace SOM
     void checkSameDimensions(const InputVector& a, std::size_t inputDimCount);
     std::ostream& operator<<(std::ostream& os, const InputVector& a);
 
-    class Network
+    struct CurrentIteration
+    {
+        std::size_t idIteration;
+        std::size_t iterationCount;
+    };
+
+    // Scalar is the type used to store the ref vectors and to compute the distances
+    // The input vectors, the weights and the returned distances keep on using the InputVector types
+    template <typename Scalar>
+    class BasicNetwork
     {
     public:
         // Init a network with random values
-        Network(Coordinate width, Coordinate height, std::size_t inputDimCount);
+        BasicNetwork(Coordinate width, Coordinate height, std::size_t inputDimCount);
 
-        Coordinate getWidth() const { return _refVectors.getWidth(); }
-        Coordinate getHeight() const { return _refVectors.getHeight(); }
+        Coordinate getWidth() const { return _width; }
+        Coordinate getHeight() const { return _height; }
         std::size_t getInputDimCount() const { return _inputDimCount; }
         const InputVector& getDataWeights() const { return _weights; }
 
@@ -55,19 +64,28 @@ namespace SOM
         void setRefVector(const Position& position, const InputVector& data);
 
         // <!> data must be normalized
-        struct CurrentIteration
-        {
-            std::size_t idIteration;
-            std::size_t iterationCount;
-        };
+        using CurrentIteration = SOM::CurrentIteration;
         using ProgressCallback = std::function<void(const CurrentIteration&)>;
         using RequestStopCallback = std::function<bool()>;
         void train(const std::vector<InputVector>& dataSamples, std::size_t nbIterations, ProgressCallback = ProgressCallback{}, RequestStopCallback = RequestStopCallback{});
 
-        const InputVector& getRefVector(const Position& position) const;
+        // Batch training: for each iteration, all the samples are first matched against the current ref vectors,
+        // then each ref vector is replaced by the neighbourhood weighted mean of the samples
+        // Both steps are split among threadCount threads (0 means number of logical CPUs)
+        // The learning factor is not used in this mode
+        void trainBatch(const std::vector<InputVector>& dataSamples, std::size_t nbIterations, std::size_t threadCount, ProgressCallback = ProgressCallback{}, RequestStopCallback = RequestStopCallback{});
+
+        InputVector getRefVector(const Position& position) const;
         Position getClosestRefVectorPosition(const InputVector& data) const;
         std::optional<Position> getClosestRefVectorPosition(const InputVector& data, InputVector::Distance maxDistance) const;
 
+        struct ClosestRefVector
+        {
+            Position position;
+            InputVector::Distance distance; // between data and the ref vector
+        };
+        ClosestRefVector getClosestRefVector(const InputVector& data) const;
+
         std::optional<Position> getClosestRefVectorPosition(const std::vector<Position>& refVectorsPosition, InputVector::Distance maxDistance) const;
 
         InputVector::Distance getRefVectorsDistance(const Position& position1, const Position& position2) const;
@@ -81,9 +99,9 @@ namespace SOM
         // i is the current iteration
         // refVector(i+1) = refVector(i) + LearningFactor(i) * NeighbourhoodFunc(i) * (MatchingRefVector - refVector)
 
+        // Distance between vectors is the weighted euclidian square distance
         using DistanceFunc = std::function<InputVector::Distance(const InputVector& /* a */, const InputVector& /* b */, const InputVector& /* weights */)>;
-        void setDistanceFunc(DistanceFunc distanceFunc);
-        DistanceFunc getDistanceFunc() { return _distanceFunc; }
+        DistanceFunc getDistanceFunc() const;
 
         using LearningFactorFunc = std::function<LearningFactor(const CurrentIteration&)>;
         void setLearningFactorFunc(LearningFactorFunc learningFactorFunc);
@@ -93,15 +111,36 @@ namespace SOM
 
     private:
 
-        void updateRefVectors(const Position& closestRefVectorPosition, const InputVector& input, LearningFactor learningFactor, const CurrentIteration& iteration);
+        using value_type = Scalar;
+
+        // Ref vectors are stored contiguously, row-major, each one padded to _stride values
+        // Padding values are zero in both the ref vectors and the weights, so that kernels
+        // can process whole blocks without caring about the actual dimension count
+        void toPaddedVector(const InputVector& input, value_type* output) const;
+        value_type* getRefVectorData(const Position& position);
+        const value_type* getRefVectorData(const Position& position) const;
+        std::size_t getClosestRefVectorIndex(const value_type* paddedData, InputVector::Distance* distanceToClosest = nullptr) const;
+        Position indexToPosition(std::size_t index) const;
 
+        std::vector<value_type> toPaddedVectors(const std::vector<InputVector>& inputData) const;
+        void updateRefVectors(const Position& closestRefVectorPosition, const value_type* paddedInput, LearningFactor learningFactor, const CurrentIteration& iteration);
+
+        Coordinate _width{};
+        Coordinate _height{};
         std::size_t _inputDimCount{};
+        std::size_t _stride{};
         InputVector _weights;	// weight for each dimension
-        Matrix<InputVector> _refVectors;
+        std::vector<value_type> _paddedWeights;
+        std::vector<value_type> _refVectors;
 
-        DistanceFunc _distanceFunc;
         LearningFactorFunc _learningFactorFunc;
         NeighbourhoodFunc _neighbourhoodFunc;
     };
 
+    extern template class BasicNetwork<float>;
+    extern template class BasicNetwork<double>;
+
+    // Single precision halves the memory bandwidth of the closest ref vector searches, with no visible effect on the results
+    using Network = BasicNetwork<float>;
+
 } // namespace SOM
@@ -67,6 +67,51 @@ TEST(som, InputVector)
 	}
 }
 
+TEST(som, DataNormalizer)
+{
+	std::vector<InputVector> data;
+	for (std::size_t i {}; i < 100; ++i)
+	{
+		InputVector sample {3};
+		sample[0] = static_cast<InputVector::value_type>(i);
+		sample[1] = static_cast<InputVector::value_type>(i % 7) - 3;
+		sample[2] = 5;
+		data.push_back(sample);
+	}
+
+	DataNormalizer normalizer {3};
+	normalizer.computeNormalizationFactors(data, 4);
+	EXPECT_EQ(normalizer.getValue(0).min, 0);
+	EXPECT_EQ(normalizer.getValue(0).max, 99);
+	EXPECT_EQ(normalizer.getValue(1).min, -3);
+	EXPECT_EQ(normalizer.getValue(1).max, 3);
+
+	DataNormalizer streamingNormalizer {3};
+	streamingNormalizer.resetNormalizationFactors();
+	for (const InputVector& sample : data)
+		streamingNormalizer.updateNormalizationFactors(sample);
+	for (std::size_t i {}; i < 3; ++i)
+	{
+		EXPECT_EQ(streamingNormalizer.getValue(i).min, normalizer.getValue(i).min);
+		EXPECT_EQ(streamingNormalizer.getValue(i).max, normalizer.getValue(i).max);
+	}
+
+	// more threads than samples
+	std::vector<InputVector> normalizedData {data};
+	normalizer.normalizeData(normalizedData, 200);
+	for (std::size_t i {}; i < data.size(); ++i)
+	{
+		InputVector expected {data[i]};
+		normalizer.normalizeData(expected);
+		for (std::size_t j {}; j < 2; ++j)
+		{
+			EXPECT_EQ(normalizedData[i][j], expected[j]);
+			EXPECT_GE(normalizedData[i][j], 0);
+			EXPECT_LE(normalizedData[i][j], 1);
+		}
+	}
+}
+
 TEST(som, Network)
 {
 	Network network {2, 2, 1};
@@ -126,6 +171,117 @@ TEST(som, Network)
 	}
 }
 
+TEST(som, NetworkBatch)
+{
+	Network network {3, 3, 2};
+
+	auto makeInput {[](InputVector::value_type x, InputVector::value_type y)
+	{
+		InputVector input {2};
+		input[0] = x;
+		input[1] = y;
+		return input;
+	}};
+
+	// 3 well separated clusters
+	const std::vector<InputVector> centers {makeInput(0, 0), makeInput(0.5, 1), makeInput(1, 0)};
+
+	std::vector<InputVector> trainData;
+	for (const InputVector& center : centers)
+	{
+		for (std::size_t i {}; i < 10; ++i)
+			trainData.push_back(makeInput(center[0] + static_cast<InputVector::value_type>(i) / 200, center[1] + static_cast<InputVector::value_type>(i % 3) / 200));
+	}
+
+	// more threads than samples per thread
+	network.trainBatch(trainData, 20, 7);
+	network.dump(std::cout);
+
+	std::vector<std::unordered_set<Position>> clusterPositions(centers.size());
+	for (std::size_t i {}; i < trainData.size(); ++i)
+	{
+		const Position position {network.getClosestRefVectorPosition(trainData[i])};
+		clusterPositions[i / 10].insert(position);
+
+		EXPECT_LT(network.getDistanceFunc()(network.getRefVector(position), trainData[i], network.getDataWeights()), EPSILON);
+	}
+
+	for (std::size_t i {}; i < clusterPositions.size(); ++i)
+	{
+		for (std::size_t j {i + 1}; j < clusterPositions.size(); ++j)
+		{
+			for (const Position& position : clusterPositions[i])
+				EXPECT_FALSE(clusterPositions[j].contains(position));
+		}
+	}
+}
+
+TEST(som, NetworkRefVectors)
+{
+	// not square, and dimension count not a multiple of the internal block size
+	Network network {3, 2, 5};
+
+	for (Coordinate y {}; y < network.getHeight(); ++y)
+	{
+		for (Coordinate x {}; x < network.getWidth(); ++x)
+		{
+			InputVector refVector {5};
+			for (std::size_t i {}; i < refVector.getNbDimensions(); ++i)
+				refVector[i] = x * 10 + y + static_cast<InputVector::value_type>(i) / 10;
+
+			network.setRefVector({x, y}, refVector);
+		}
+	}
+
+	for (Coordinate y {}; y < network.getHeight(); ++y)
+	{
+		for (Coordinate x {}; x < network.getWidth(); ++x)
+		{
+			const InputVector refVector {network.getRefVector({x, y})};
+			ASSERT_EQ(refVector.getNbDimensions(), 5);
+			for (std::size_t i {}; i < refVector.getNbDimensions(); ++i)
+				EXPECT_LT(std::abs(refVector[i] - (x * 10 + y + static_cast<InputVector::value_type>(i) / 10)), EPSILON);
+
+			EXPECT_EQ(network.getClosestRefVectorPosition(refVector), (Position {x, y}));
+			EXPECT_TRUE(network.getClosestRefVectorPosition(refVector, 0.1).has_value());
+
+			const Network::ClosestRefVector closestRefVector {network.getClosestRefVector(refVector)};
+			EXPECT_EQ(closestRefVector.position, (Position {x, y}));
+			EXPECT_LT(closestRefVector.distance, EPSILON);
+		}
+	}
+
+	EXPECT_LT(std::abs(network.getRefVectorsDistance({0, 0}, {1, 0}) - 5 * 100), EPSILON);
+	EXPECT_LT(std::abs(network.getRefVectorsDistance({0, 0}, {0, 1}) - 5), EPSILON);
+}
+
+TEST(som, NetworkPrecision)
+{
+	// same ref vectors, stored using different scalar types
+	BasicNetwork<double> doubleNetwork {4, 4, 3};
+	BasicNetwork<float> floatNetwork {4, 4, 3};
+	for (Coordinate y {}; y < doubleNetwork.getHeight(); ++y)
+	{
+		for (Coordinate x {}; x < doubleNetwork.getWidth(); ++x)
+		{
+			const InputVector refVector {doubleNetwork.getRefVector({x, y})};
+			floatNetwork.setRefVector({x, y}, refVector);
+		}
+	}
+
+	for (Coordinate y {}; y < doubleNetwork.getHeight(); ++y)
+	{
+		for (Coordinate x {}; x < doubleNetwork.getWidth(); ++x)
+		{
+			InputVector input {doubleNetwork.getRefVector({x, y})};
+			input[0] += 0.001;
+
+			EXPECT_EQ(floatNetwork.getClosestRefVectorPosition(input), doubleNetwork.getClosestRefVectorPosition(input));
+			EXPECT_LT(std::abs(floatNetwork.getRefVectorsDistance({x, y}, {0, 0}) - doubleNetwork.getRefVectorsDistance({x, y}, {0, 0})), EPSILON);
+		}
+	}
+}
+
 int main(int argc, char **argv)
 {
 	::testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ArtistIndexCache.hpp"
+
+#include "database/Artist.hpp"
+#include "database/Db.hpp"
+#include "database/Session.hpp"
+#include "utils/ILogger.hpp"
+
+namespace API::Subsonic
+{
+    using namespace Database;
+
+    ArtistIndexCache::ArtistIndexCache(Db& db)
+        : _db{ db }
+    {
+    }
+
+    std::shared_ptr<const ArtistIndexCache::Index> ArtistIndexCache::getIndex(MediaLibraryId library, SubsonicArtistListMode listMode)
+    {
+        const IndexKey key{ library, listMode };
+
+        {
+            const std::scoped_lock lock{ _mutex };
+            auto it{ _indexes.find(key) };
+            if (it != std::cend(_indexes))
+                return it->second;
+        }
+
+        // concurrent first requests may build the same index, no big deal
+        std::shared_ptr<const Index> index{ buildIndex(key) };
+
+        const std::scoped_lock lock{ _mutex };
+        return _indexes.try_emplace(key, index).first->second;
+    }
+
+    void ArtistIndexCache::onScanComplete(bool changes)
+    {
+        if (!changes)
+            return;
+
+        std::vector<IndexKey> keys;
+        {
+            const std::scoped_lock lock{ _mutex };
+            for (const auto& [key, index] : _indexes)
+                keys.push_back(key);
+        }
+
+        // Rebuild the indexes already in use, so that clients do not wait for them
+        std::map<IndexKey, std::shared_ptr<const Index>> indexes;
+        for (const IndexKey& key : keys)
+            indexes.emplace(key, buildIndex(key));
+
+        const std::scoped_lock lock{ _mutex };
+        _indexes = std::move(indexes);
+    }
+
+    std::shared_ptr<const ArtistIndexCache::Index> ArtistIndexCache::buildIndex(const IndexKey& key)
+    {
+        const auto& [library, listMode] { key };
+
+        LMS_LOG(API_SUBSONIC, DEBUG, "Building artist index...");
+
+        Artist::FindParameters parameters;
+        parameters.setSortMethod(ArtistSortMethod::BySortName);
+        switch (listMode)
+        {
+        case SubsonicArtistListMode::AllArtists:
+            break;
+        case SubsonicArtistListMode::ReleaseArtists:
+            parameters.setLinkType(TrackArtistLinkType::ReleaseArtist);
+            break;
+        case SubsonicArtistListMode::TrackArtists:
+            parameters.setLinkType(TrackArtistLinkType::Artist);
+            break;
+        }
+        parameters.setMediaLibrary(library);
+
+        std::map<std::string, std::vector<ArtistId>> artistsByIndexLetter;
+        {
+            Session& session{ _db.getTLSSession() };
+            auto transaction{ session.createReadTransaction() };
+
+            Artist::find(session, parameters, [&](const Artist::pointer& artist)
+                {
+                    artistsByIndexLetter[artist->getIndexLetter()].push_back(artist->getId());
+                });
+        }
+
+        auto index{ std::make_shared<Index>() };
+        index->buildDateTime = Wt::WDateTime::currentDateTime();
+        index->artistsByIndexLetter.assign(std::make_move_iterator(std::begin(artistsByIndexLetter)), std::make_move_iterator(std::end(artistsByIndexLetter)));
+
+        LMS_LOG(API_SUBSONIC, DEBUG, "Artist index built, " << index->artistsByIndexLetter.size() << " entries");
+
+        return index;
+    }
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <Wt/WDateTime.h>
+
+#include "database/ArtistId.hpp"
+#include "database/MediaLibraryId.hpp"
+#include "database/Types.hpp"
+
+namespace Database
+{
+    class Db;
+}
+
+namespace API::Subsonic
+{
+    // Artists dispatched by the first letter of their sort name, as reported by getIndexes/getArtists
+    // Indexes are built on first use, and rebuilt when a scan has made changes
+    class ArtistIndexCache
+    {
+    public:
+        ArtistIndexCache(Database::Db& db);
+
+        ArtistIndexCache(const ArtistIndexCache&) = delete;
+        ArtistIndexCache& operator=(const ArtistIndexCache&) = delete;
+
+        struct Index
+        {
+            Wt::WDateTime buildDateTime;
+            std::vector<std::pair<std::string, std::vector<Database::ArtistId>>> artistsByIndexLetter; // ordered by letter, then by artist sort name
+        };
+
+        std::shared_ptr<const Index> getIndex(Database::MediaLibraryId library, Database::SubsonicArtistListMode listMode);
+
+        void onScanComplete(bool changes);
+
+    private:
+        using IndexKey = std::pair<Database::MediaLibraryId, Database::SubsonicArtistListMode>;
+        std::shared_ptr<const Index> buildIndex(const IndexKey& key);
+
+        Database::Db& _db;
+
+        std::mutex _mutex;
+        std::map<IndexKey, std::shared_ptr<const Index>> _indexes;
+    };
+}
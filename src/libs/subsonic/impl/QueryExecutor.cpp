@@ -0,0 +1,40 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "QueryExecutor.hpp"
+
+#include "database/Db.hpp"
+#include "utils/ILogger.hpp"
+
+namespace API::Subsonic
+{
+    QueryExecutor::QueryExecutor(Database::Db& db, std::size_t threadCount)
+        : _db{ db }
+    {
+        LMS_LOG(API_SUBSONIC, INFO, "Using " << threadCount << " threads to run concurrent queries");
+
+        if (threadCount > 0)
+            _ioContextRunner = std::make_unique<IOContextRunner>(_ioContext, threadCount);
+    }
+
+    Database::Session& QueryExecutor::getSession()
+    {
+        return _db.getTLSSession();
+    }
+}
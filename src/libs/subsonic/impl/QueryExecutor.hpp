@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <functional>
+#include <future>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+
+#include "database/QueryDeadline.hpp"
+#include "utils/IOContextRunner.hpp"
+
+namespace Database
+{
+    class Db;
+    class Session;
+}
+
+namespace API::Subsonic
+{
+    // Runs independent read only queries concurrently, each thread uses its own database session (and connection)
+    // Queries must not reference any request data, as the request may not wait for their completion
+    // Queries are run using the query deadline of the calling thread
+    class QueryExecutor
+    {
+    public:
+        QueryExecutor(Database::Db& db, std::size_t threadCount); // 0 to run the queries synchronously
+
+        QueryExecutor(const QueryExecutor&) = delete;
+        QueryExecutor& operator=(const QueryExecutor&) = delete;
+
+        template <typename Func>
+        auto execute(Func&& func) -> std::future<std::invoke_result_t<Func, Database::Session&>>
+        {
+            using Result = std::invoke_result_t<Func, Database::Session&>;
+
+            auto task{ std::make_shared<std::packaged_task<Result()>>([this, func = std::forward<Func>(func), queryDeadline = Database::ScopedQueryDeadline::getCurrent()]() mutable
+                {
+                    const Database::ScopedQueryDeadline scopedQueryDeadline{ std::move(queryDeadline) };
+                    return func(getSession());
+                }) };
+            std::future<Result> res{ task->get_future() };
+
+            if (_ioContextRunner)
+                boost::asio::post(_ioContext, [task] { (*task)(); });
+            else
+                (*task)();
+
+            return res;
+        }
+
+    private:
+        Database::Session& getSession();
+
+        Database::Db& _db;
+        boost::asio::io_context _ioContext;
+        std::unique_ptr<IOContextRunner> _ioContextRunner;
+    };
+}
@@ -19,6 +19,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <string>
 
 #include <Wt/Http/Request.h>
@@ -34,15 +35,29 @@ namespace Database
 
 namespace API::Subsonic
 {
+    class ArtistIndexCache;
+    class QueryExecutor;
+    class RequestMetrics;
+    class SearchIndex;
+    class SongFragmentCache;
+
     struct RequestContext
     {
         const Wt::Http::ParameterMap& parameters;
         Database::Session& dbSession;
+        ArtistIndexCache& artistIndexCache;
+        QueryExecutor& queryExecutor;
+        SearchIndex* searchIndex; // null if disabled
+        SongFragmentCache* songFragmentCache; // null if disabled
+        std::uint64_t scanGeneration; // incremented each time a scan has made changes
+        const RequestMetrics& requestMetrics;
         Database::UserId userId;
         ClientInfo clientInfo;
         ProtocolVersion serverProtocolVersion;
         bool enableOpenSubsonic{ true };
         bool enableDefaultCover{ };
+        // Continuation created by the entry point, null on its first call (even if the request has been resumed after a pending authentication)
+        Wt::Http::ResponseContinuation* continuation{};
     };
 }
 
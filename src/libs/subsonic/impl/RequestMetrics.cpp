@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "RequestMetrics.hpp"
+
+#include <algorithm>
+
+#include "database/Session.hpp"
+#include "utils/IMetricsRegistry.hpp"
+#include "utils/IResourceGovernor.hpp"
+#include "utils/Service.hpp"
+
+namespace API::Subsonic
+{
+    RequestMetrics::RequestMetrics(std::span<const std::string_view> entryPoints)
+    {
+        for (std::string_view entryPoint : entryPoints)
+            _counters.try_emplace(entryPoint);
+
+        if (Metrics::IRegistry * registry{ Service<Metrics::IRegistry>::get() })
+        {
+            _requestDurationHistogram = &registry->getHistogram("lms_http_request_duration_seconds", "Duration of the HTTP API requests, media retrieval excluded", Metrics::defaultDurationBuckets, { { "api", "subsonic" } });
+            _succeededRequestCounter = &registry->getCounter("lms_http_requests_total", "HTTP API requests, media retrieval excluded", { { "api", "subsonic" }, { "result", "success" } });
+            _failedRequestCounter = &registry->getCounter("lms_http_requests_total", "HTTP API requests, media retrieval excluded", { { "api", "subsonic" }, { "result", "failure" } });
+        }
+    }
+
+    void RequestMetrics::record(std::string_view entryPoint, bool succeeded, std::chrono::microseconds duration, std::uint64_t responseSize, std::uint64_t statementCount)
+    {
+        auto itCounters{ _counters.find(entryPoint) };
+        if (itCounters == std::end(_counters))
+            return;
+
+        EntryPointCounters& counters{ itCounters->second };
+
+        counters.requestCount.fetch_add(1, std::memory_order_relaxed);
+        if (!succeeded)
+            counters.failedRequestCount.fetch_add(1, std::memory_order_relaxed);
+        counters.totalDuration.fetch_add(duration.count(), std::memory_order_relaxed);
+        counters.responseSize.fetch_add(responseSize, std::memory_order_relaxed);
+        counters.statementCount.fetch_add(statementCount, std::memory_order_relaxed);
+
+        std::int64_t maxDuration{ counters.maxDuration.load(std::memory_order_relaxed) };
+        while (maxDuration < duration.count() && !counters.maxDuration.compare_exchange_weak(maxDuration, duration.count(), std::memory_order_relaxed))
+            ;
+
+        const auto itBucket{ std::lower_bound(std::cbegin(latencyBucketUpperBounds), std::cend(latencyBucketUpperBounds), duration) };
+        counters.latencyBuckets[std::distance(std::cbegin(latencyBucketUpperBounds), itBucket)].fetch_add(1, std::memory_order_relaxed);
+
+        if (_requestDurationHistogram)
+        {
+            _requestDurationHistogram->observe(duration);
+            (succeeded ? _succeededRequestCounter : _failedRequestCounter)->inc();
+        }
+    }
+
+    void RequestMetrics::visit(std::function<void(std::string_view entryPoint, const EntryPointStats& stats)> visitor) const
+    {
+        for (const auto& [entryPoint, counters] : _counters)
+        {
+            EntryPointStats stats;
+            stats.requestCount = counters.requestCount.load(std::memory_order_relaxed);
+            if (stats.requestCount == 0)
+                continue;
+
+            stats.failedRequestCount = counters.failedRequestCount.load(std::memory_order_relaxed);
+            stats.totalDuration = std::chrono::microseconds{ counters.totalDuration.load(std::memory_order_relaxed) };
+            stats.maxDuration = std::chrono::microseconds{ counters.maxDuration.load(std::memory_order_relaxed) };
+            stats.responseSize = counters.responseSize.load(std::memory_order_relaxed);
+            stats.statementCount = counters.statementCount.load(std::memory_order_relaxed);
+            for (std::size_t i{}; i < stats.latencyBuckets.size(); ++i)
+                stats.latencyBuckets[i] = counters.latencyBuckets[i].load(std::memory_order_relaxed);
+
+            visitor(entryPoint, stats);
+        }
+    }
+
+    RequestMetrics::Recorder::Recorder(RequestMetrics& metrics, std::string_view entryPoint, const Database::Session& session)
+        : _metrics{ metrics }
+        , _entryPoint{ entryPoint }
+        , _session{ session }
+        , _start{ std::chrono::steady_clock::now() }
+        , _statementCountAtStart{ session.getExecutedStatementCount() }
+    {
+    }
+
+    RequestMetrics::Recorder::~Recorder()
+    {
+        const auto duration{ std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - _start) };
+        _metrics.record(_entryPoint, _succeeded, duration, _responseSize, _session.getExecutedStatementCount() - _statementCountAtStart);
+
+        if (IResourceGovernor* governor{ Service<IResourceGovernor>::get() })
+            governor->addRequestLatency(duration);
+    }
+} // namespace API::Subsonic
@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+
+namespace Database
+{
+    class Session;
+}
+
+namespace Metrics
+{
+    class Counter;
+    class Histogram;
+}
+
+namespace API::Subsonic
+{
+    // Per entry point counters, updated without locking
+    // Overall figures are also exported to the metrics registry, if any
+    class RequestMetrics
+    {
+    public:
+        // Entry point names must outlive this object
+        RequestMetrics(std::span<const std::string_view> entryPoints);
+
+        RequestMetrics(const RequestMetrics&) = delete;
+        RequestMetrics& operator=(const RequestMetrics&) = delete;
+
+        static constexpr std::array<std::chrono::milliseconds, 12> latencyBucketUpperBounds{ std::chrono::milliseconds{ 1 }, std::chrono::milliseconds{ 2 }, std::chrono::milliseconds{ 5 }, std::chrono::milliseconds{ 10 }, std::chrono::milliseconds{ 25 }, std::chrono::milliseconds{ 50 }, std::chrono::milliseconds{ 100 }, std::chrono::milliseconds{ 250 }, std::chrono::milliseconds{ 500 }, std::chrono::milliseconds{ 1'000 }, std::chrono::milliseconds{ 2'500 }, std::chrono::milliseconds{ 5'000 } };
+
+        struct EntryPointStats
+        {
+            std::uint64_t requestCount{};
+            std::uint64_t failedRequestCount{};
+            std::chrono::microseconds totalDuration{};
+            std::chrono::microseconds maxDuration{};
+            std::uint64_t responseSize{}; // total, in bytes
+            std::uint64_t statementCount{}; // total
+            std::array<std::uint64_t, latencyBucketUpperBounds.size() + 1> latencyBuckets{}; // last bucket has no upper bound
+        };
+
+        void record(std::string_view entryPoint, bool succeeded, std::chrono::microseconds duration, std::uint64_t responseSize, std::uint64_t statementCount);
+
+        // Entry points that have not been requested yet are skipped
+        void visit(std::function<void(std::string_view entryPoint, const EntryPointStats& stats)> visitor) const;
+
+        // Records a request on destruction
+        class Recorder
+        {
+        public:
+            Recorder(RequestMetrics& metrics, std::string_view entryPoint, const Database::Session& session);
+            ~Recorder();
+
+            Recorder(const Recorder&) = delete;
+            Recorder& operator=(const Recorder&) = delete;
+
+            void setSucceeded(std::uint64_t responseSize) { _succeeded = true; _responseSize = responseSize; }
+
+        private:
+            RequestMetrics& _metrics;
+            const std::string_view _entryPoint;
+            const Database::Session& _session;
+            const std::chrono::steady_clock::time_point _start;
+            const std::uint64_t _statementCountAtStart;
+            bool _succeeded{};
+            std::uint64_t _responseSize{};
+        };
+
+    private:
+        struct EntryPointCounters
+        {
+            std::atomic<std::uint64_t> requestCount{};
+            std::atomic<std::uint64_t> failedRequestCount{};
+            std::atomic<std::int64_t> totalDuration{}; // in microseconds
+            std::atomic<std::int64_t> maxDuration{}; // in microseconds
+            std::atomic<std::uint64_t> responseSize{};
+            std::atomic<std::uint64_t> statementCount{};
+            std::array<std::atomic<std::uint64_t>, latencyBucketUpperBounds.size() + 1> latencyBuckets{};
+        };
+
+        std::unordered_map<std::string_view, EntryPointCounters> _counters; // never modified after construction
+
+        // null if metrics are not collected
+        Metrics::Histogram* _requestDurationHistogram{};
+        Metrics::Counter* _succeededRequestCounter{};
+        Metrics::Counter* _failedRequestCounter{};
+    };
+} // namespace API::Subsonic
@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ResponseBufferStream.hpp"
+
+#include <cassert>
+
+namespace API::Subsonic
+{
+    namespace
+    {
+        // Buffers that grew larger than this because of a huge response are released
+        constexpr std::size_t maxKeptCapacity{ 4 * 1024 * 1024 };
+
+        thread_local std::string threadBuffer;
+        thread_local bool threadBufferInUse{};
+
+        std::string& acquireThreadBuffer()
+        {
+            assert(!threadBufferInUse);
+            threadBufferInUse = true;
+
+            threadBuffer.clear();
+            return threadBuffer;
+        }
+    }
+
+    ResponseBufferStream::ResponseBufferStream()
+        : std::ostream{ nullptr }
+        , _streamBuffer{ acquireThreadBuffer() }
+    {
+        rdbuf(&_streamBuffer);
+    }
+
+    ResponseBufferStream::~ResponseBufferStream()
+    {
+        if (threadBuffer.capacity() > maxKeptCapacity)
+            std::string{}.swap(threadBuffer);
+
+        threadBufferInUse = false;
+    }
+
+    ResponseBufferStream::StreamBuffer::int_type ResponseBufferStream::StreamBuffer::overflow(int_type c)
+    {
+        if (!traits_type::eq_int_type(c, traits_type::eof()))
+            _buffer.push_back(traits_type::to_char_type(c));
+
+        return traits_type::not_eof(c);
+    }
+
+    std::streamsize ResponseBufferStream::StreamBuffer::xsputn(const char* s, std::streamsize count)
+    {
+        _buffer.append(s, static_cast<std::size_t>(count));
+        return count;
+    }
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+
+namespace API::Subsonic
+{
+    // Output stream that writes into a buffer owned by the calling thread
+    // The capacity of the buffer is kept from one serialization to the next, so that responses can be written without any allocation
+    // Only one stream per thread can be used at a time
+    class ResponseBufferStream : public std::ostream
+    {
+    public:
+        ResponseBufferStream();
+        ~ResponseBufferStream();
+
+        ResponseBufferStream(const ResponseBufferStream&) = delete;
+        ResponseBufferStream& operator=(const ResponseBufferStream&) = delete;
+
+        // Only valid until the stream is destroyed
+        std::string_view getContent() const { return _streamBuffer.getContent(); }
+
+    private:
+        class StreamBuffer : public std::streambuf
+        {
+        public:
+            StreamBuffer(std::string& buffer) : _buffer{ buffer } {}
+
+            std::string_view getContent() const { return _buffer; }
+
+        private:
+            int_type overflow(int_type c) override;
+            std::streamsize xsputn(const char* s, std::streamsize count) override;
+
+            std::string& _buffer;
+        };
+
+        StreamBuffer _streamBuffer;
+    };
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ResponseCache.hpp"
+
+#include "utils/ILogger.hpp"
+
+namespace API::Subsonic
+{
+    namespace
+    {
+        // rough estimate of the memory used to index an entry
+        constexpr std::size_t entryOverhead{ 128 };
+    }
+
+    ResponseCache::ResponseCache(std::size_t maxSize)
+        : _maxSize{ maxSize }
+    {
+        LMS_LOG(API_SUBSONIC, INFO, "Response cache max size = " << _maxSize << " bytes");
+    }
+
+    ResponseCache::Entry ResponseCache::get(const std::string& key, std::uint64_t generation)
+    {
+        if (!isEnabled())
+            return {};
+
+        const std::scoped_lock lock{ _mutex };
+
+        auto it{ _cachedResponsesByKey.find(key) };
+        if (it == std::cend(_cachedResponsesByKey))
+        {
+            _missCount++;
+            return {};
+        }
+
+        CachedResponses::iterator itCachedResponse{ it->second };
+        if (itCachedResponse->second.generation != generation)
+        {
+            _missCount++;
+            erase(itCachedResponse);
+            return {};
+        }
+
+        _hitCount++;
+        _cachedResponses.splice(std::begin(_cachedResponses), _cachedResponses, itCachedResponse);
+
+        LMS_LOG(API_SUBSONIC, DEBUG, "Response cache hits = " << _hitCount << ", misses = " << _missCount << ", entries = " << _cachedResponses.size() << ", size = " << _currentSize);
+
+        return itCachedResponse->second.response;
+    }
+
+    void ResponseCache::put(const std::string& key, std::uint64_t generation, Entry response)
+    {
+        if (!isEnabled())
+            return;
+
+        const std::size_t size{ key.size() + response->size() + entryOverhead };
+        if (size > _maxSize)
+            return;
+
+        const std::scoped_lock lock{ _mutex };
+
+        if (auto it{ _cachedResponsesByKey.find(key) }; it != std::cend(_cachedResponsesByKey))
+            erase(it->second);
+
+        while (!_cachedResponses.empty() && _currentSize + size > _maxSize)
+            erase(std::prev(std::end(_cachedResponses)));
+
+        _cachedResponses.emplace_front(key, CachedResponse{ std::move(response), generation, size });
+        _cachedResponsesByKey.emplace(_cachedResponses.front().first, std::begin(_cachedResponses));
+        _currentSize += size;
+    }
+
+    void ResponseCache::clear()
+    {
+        const std::scoped_lock lock{ _mutex };
+
+        _cachedResponsesByKey.clear();
+        _cachedResponses.clear();
+        _currentSize = 0;
+    }
+
+    void ResponseCache::erase(CachedResponses::iterator it)
+    {
+        _currentSize -= it->second.size;
+        _cachedResponsesByKey.erase(it->first);
+        _cachedResponses.erase(it);
+    }
+}
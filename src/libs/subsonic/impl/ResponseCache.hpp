@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+namespace API::Subsonic
+{
+    // Bounded cache of serialized responses, the least recently used ones are evicted first
+    // Each response is stored along with a generation: it is only served for this generation
+    class ResponseCache
+    {
+    public:
+        ResponseCache(std::size_t maxSize); // in bytes, 0 to disable the cache
+
+        ResponseCache(const ResponseCache&) = delete;
+        ResponseCache& operator=(const ResponseCache&) = delete;
+
+        bool isEnabled() const { return _maxSize > 0; }
+
+        using Entry = std::shared_ptr<const std::string>;
+        Entry get(const std::string& key, std::uint64_t generation);
+        void put(const std::string& key, std::uint64_t generation, Entry response);
+        void clear();
+
+    private:
+        struct CachedResponse
+        {
+            Entry response;
+            std::uint64_t generation;
+            std::size_t size;
+        };
+        using CachedResponses = std::list<std::pair<const std::string, CachedResponse>>; // most recently used first
+
+        void erase(CachedResponses::iterator it);
+
+        const std::size_t _maxSize;
+
+        std::mutex _mutex;
+        std::size_t _currentSize{};
+        CachedResponses _cachedResponses;
+        std::unordered_map<std::string_view, CachedResponses::iterator> _cachedResponsesByKey; // keys point to the list entries
+        std::size_t _hitCount{};
+        std::size_t _missCount{};
+    };
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ResponseCompression.hpp"
+
+#include <zlib.h>
+
+#include "utils/Exception.hpp"
+#include "utils/String.hpp"
+
+namespace API::Subsonic
+{
+    namespace
+    {
+        class GzipCompressor
+        {
+        public:
+            GzipCompressor()
+            {
+                // 15 + 16: max window and gzip wrapper
+                if (::deflateInit2(&_stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+                    throw LmsException{ "Cannot init gzip compressor" };
+            }
+
+            ~GzipCompressor()
+            {
+                ::deflateEnd(&_stream);
+            }
+
+            GzipCompressor(const GzipCompressor&) = delete;
+            GzipCompressor& operator=(const GzipCompressor&) = delete;
+
+            std::string compress(std::string_view input)
+            {
+                if (::deflateReset(&_stream) != Z_OK)
+                    throw LmsException{ "Cannot reset gzip compressor" };
+
+                std::string output;
+                output.resize(::deflateBound(&_stream, static_cast<uLong>(input.size())));
+
+                _stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+                _stream.avail_in = static_cast<uInt>(input.size());
+                _stream.next_out = reinterpret_cast<Bytef*>(output.data());
+                _stream.avail_out = static_cast<uInt>(output.size());
+
+                // deflateBound guarantees a single call is enough
+                if (::deflate(&_stream, Z_FINISH) != Z_STREAM_END)
+                    throw LmsException{ "Gzip compression failed" };
+
+                output.resize(_stream.total_out);
+                return output;
+            }
+
+        private:
+            z_stream _stream{};
+        };
+    }
+
+    bool isGzipEncodingAccepted(std::string_view acceptEncodingHeader)
+    {
+        for (std::string_view coding : StringUtils::splitString(acceptEncodingHeader, ','))
+        {
+            std::string_view qValue;
+            if (const std::size_t paramPos{ coding.find(';') }; paramPos != std::string_view::npos)
+            {
+                qValue = StringUtils::stringTrim(coding.substr(paramPos + 1));
+                coding = coding.substr(0, paramPos);
+            }
+            coding = StringUtils::stringTrim(coding);
+
+            if (coding != "gzip" && coding != "*")
+                continue;
+
+            // only handle explicit refusals, other weights do not matter here
+            if (qValue.starts_with("q="))
+            {
+                qValue.remove_prefix(2);
+                if (qValue.find_first_not_of("0.") == std::string_view::npos)
+                    return false;
+            }
+
+            return true;
+        }
+
+        return false;
+    }
+
+    std::string compressGzip(std::string_view input)
+    {
+        thread_local GzipCompressor compressor;
+        return compressor.compress(input);
+    }
+}
@@ -0,0 +1,283 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "SearchIndex.hpp"
+
+#include <algorithm>
+
+#include "database/Artist.hpp"
+#include "database/Db.hpp"
+#include "database/Release.hpp"
+#include "database/Session.hpp"
+#include "database/Track.hpp"
+#include "utils/ILogger.hpp"
+#include "utils/String.hpp"
+
+namespace API::Subsonic
+{
+    using namespace Database;
+
+    namespace
+    {
+        bool containsAllKeywords(std::string_view name, std::span<const std::string> keywords)
+        {
+            return std::all_of(std::cbegin(keywords), std::cend(keywords), [&](const std::string& keyword) { return name.find(keyword) != std::string_view::npos; });
+        }
+
+        // matches of the cached keywords are a superset of the matches of the new keywords
+        bool canRefine(std::span<const std::string> cachedKeywords, std::span<const std::string> keywords)
+        {
+            return std::all_of(std::cbegin(cachedKeywords), std::cend(cachedKeywords), [&](const std::string& cachedKeyword)
+                {
+                    return std::any_of(std::cbegin(keywords), std::cend(keywords), [&](const std::string& keyword) { return keyword.find(cachedKeyword) != std::string::npos; });
+                });
+        }
+
+        // candidates: positions to check, or nullptr to check all the entries
+        template <typename MatchFunc>
+        std::vector<std::uint32_t> filter(std::size_t entryCount, const std::vector<std::uint32_t>* candidates, MatchFunc matchFunc)
+        {
+            std::vector<std::uint32_t> res;
+            if (candidates)
+            {
+                std::copy_if(std::cbegin(*candidates), std::cend(*candidates), std::back_inserter(res), matchFunc);
+            }
+            else
+            {
+                for (std::uint32_t i{}; i < entryCount; ++i)
+                {
+                    if (matchFunc(i))
+                        res.push_back(i);
+                }
+            }
+
+            return res;
+        }
+
+        template <typename IdType, typename StartsWithFunc>
+        std::vector<IdType> toIds(const std::vector<IdType>& ids, std::vector<std::uint32_t> matches, StartsWithFunc startsWith)
+        {
+            std::stable_partition(std::begin(matches), std::end(matches), startsWith);
+
+            std::vector<IdType> res;
+            res.reserve(matches.size());
+            std::transform(std::cbegin(matches), std::cend(matches), std::back_inserter(res), [&](std::uint32_t match) { return ids[match]; });
+
+            return res;
+        }
+    }
+
+    void SearchIndex::Names::add(std::string_view name)
+    {
+        if (offsets.empty())
+            offsets.push_back(0);
+
+        // ASCII only, other characters are left as is
+        const std::string lowerName{ StringUtils::stringToLower(name) };
+        buffer.append(lowerName);
+        offsets.push_back(static_cast<std::uint32_t>(buffer.size()));
+    }
+
+    SearchIndex::SearchIndex(Db& db, std::size_t maxCachedQueriesPerUser)
+        : _db{ db }
+        , _maxCachedQueriesPerUser{ maxCachedQueriesPerUser }
+    {
+    }
+
+    SearchIndex::Results SearchIndex::search(UserId user, std::span<const std::string_view> keywords)
+    {
+        std::vector<std::string> lowerKeywords;
+        for (std::string_view keyword : keywords)
+        {
+            if (!keyword.empty())
+                lowerKeywords.push_back(StringUtils::stringToLower(keyword));
+        }
+
+        const std::shared_ptr<const Index> index{ getIndex() };
+
+        CachedMatches cachedMatches{ findCachedMatches(user, index, lowerKeywords) };
+        std::shared_ptr<const Matches> matches{ cachedMatches.matches };
+        if (!cachedMatches.exact)
+        {
+            const Matches* candidates{ cachedMatches.matches.get() };
+
+            auto newMatches{ std::make_shared<Matches>() };
+            newMatches->artists = filter(index->artistIds.size(), candidates ? &candidates->artists : nullptr, [&](std::uint32_t i)
+                {
+                    return containsAllKeywords(index->artistNames.get(i), lowerKeywords) || containsAllKeywords(index->artistSortNames.get(i), lowerKeywords);
+                });
+            newMatches->releases = filter(index->releaseIds.size(), candidates ? &candidates->releases : nullptr, [&](std::uint32_t i)
+                {
+                    return containsAllKeywords(index->releaseNames.get(i), lowerKeywords);
+                });
+            newMatches->tracks = filter(index->trackIds.size(), candidates ? &candidates->tracks : nullptr, [&](std::uint32_t i)
+                {
+                    return containsAllKeywords(index->trackNames.get(i), lowerKeywords);
+                });
+
+            matches = newMatches;
+            cacheMatches(user, CachedQuery{ index, lowerKeywords, matches });
+        }
+
+        const std::string_view firstKeyword{ lowerKeywords.empty() ? std::string_view{} : std::string_view{ lowerKeywords.front() } };
+
+        Results results;
+        results.artists = toIds(index->artistIds, matches->artists, [&](std::uint32_t i)
+            {
+                return index->artistNames.get(i).starts_with(firstKeyword) || index->artistSortNames.get(i).starts_with(firstKeyword);
+            });
+        results.releases = toIds(index->releaseIds, matches->releases, [&](std::uint32_t i) { return index->releaseNames.get(i).starts_with(firstKeyword); });
+        results.tracks = toIds(index->trackIds, matches->tracks, [&](std::uint32_t i) { return index->trackNames.get(i).starts_with(firstKeyword); });
+
+        return results;
+    }
+
+    void SearchIndex::onScanComplete(bool changes)
+    {
+        if (!changes)
+            return;
+
+        bool indexInUse;
+        {
+            const std::scoped_lock lock{ _mutex };
+            indexInUse = _index != nullptr;
+        }
+
+        // Rebuild the index if already in use, so that clients do not wait for it
+        std::shared_ptr<const Index> index;
+        if (indexInUse)
+            index = buildIndex();
+
+        const std::scoped_lock lock{ _mutex };
+        _index = std::move(index);
+        _cachedQueries.clear();
+    }
+
+    std::shared_ptr<const SearchIndex::Index> SearchIndex::getIndex()
+    {
+        {
+            const std::scoped_lock lock{ _mutex };
+            if (_index)
+                return _index;
+        }
+
+        // concurrent first requests may build the index, no big deal
+        std::shared_ptr<const Index> index{ buildIndex() };
+
+        const std::scoped_lock lock{ _mutex };
+        if (!_index)
+            _index = index;
+
+        return _index;
+    }
+
+    std::shared_ptr<const SearchIndex::Index> SearchIndex::buildIndex()
+    {
+        LMS_LOG(API_SUBSONIC, DEBUG, "Building search index...");
+
+        auto index{ std::make_shared<Index>() };
+        {
+            Session& session{ _db.getTLSSession() };
+            auto transaction{ session.createReadTransaction() };
+
+            Artist::findNames(session, [&](ArtistId artistId, std::string_view name, std::string_view sortName)
+                {
+                    index->artistIds.push_back(artistId);
+                    index->artistNames.add(name);
+                    index->artistSortNames.add(sortName);
+                });
+
+            Release::findNames(session, [&](ReleaseId releaseId, std::string_view name)
+                {
+                    index->releaseIds.push_back(releaseId);
+                    index->releaseNames.add(name);
+                });
+
+            Track::findNames(session, [&](TrackId trackId, std::string_view name)
+                {
+                    index->trackIds.push_back(trackId);
+                    index->trackNames.add(name);
+                });
+        }
+
+        LMS_LOG(API_SUBSONIC, DEBUG, "Search index built: " << index->artistIds.size() << " artists, " << index->releaseIds.size() << " releases, " << index->trackIds.size() << " tracks");
+
+        return index;
+    }
+
+    SearchIndex::CachedMatches SearchIndex::findCachedMatches(UserId user, const std::shared_ptr<const Index>& index, std::span<const std::string> keywords)
+    {
+        const std::scoped_lock lock{ _mutex };
+
+        auto itUser{ _cachedQueries.find(user) };
+        if (itUser == std::end(_cachedQueries))
+            return {};
+
+        std::list<CachedQuery>& cachedQueries{ itUser->second };
+
+        CachedMatches res;
+        std::size_t bestMatchCount{};
+        for (auto it{ std::begin(cachedQueries) }; it != std::end(cachedQueries);)
+        {
+            // built using a previous index
+            if (it->index != index)
+            {
+                it = cachedQueries.erase(it);
+                continue;
+            }
+
+            if (std::equal(std::cbegin(it->keywords), std::cend(it->keywords), std::cbegin(keywords), std::cend(keywords)))
+            {
+                cachedQueries.splice(std::begin(cachedQueries), cachedQueries, it);
+                return CachedMatches{ it->matches, true };
+            }
+
+            if (canRefine(it->keywords, keywords))
+            {
+                const std::size_t matchCount{ it->matches->artists.size() + it->matches->releases.size() + it->matches->tracks.size() };
+                if (!res.matches || matchCount < bestMatchCount)
+                {
+                    res.matches = it->matches;
+                    bestMatchCount = matchCount;
+                }
+            }
+
+            ++it;
+        }
+
+        return res;
+    }
+
+    void SearchIndex::cacheMatches(UserId user, CachedQuery cachedQuery)
+    {
+        if (_maxCachedQueriesPerUser == 0)
+            return;
+
+        const std::scoped_lock lock{ _mutex };
+
+        // the cache has been cleared in the meantime
+        if (cachedQuery.index != _index)
+            return;
+
+        std::list<CachedQuery>& cachedQueries{ _cachedQueries[user] };
+        cachedQueries.push_front(std::move(cachedQuery));
+        if (cachedQueries.size() > _maxCachedQueriesPerUser)
+            cachedQueries.pop_back();
+    }
+}
@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "database/ArtistId.hpp"
+#include "database/ReleaseId.hpp"
+#include "database/TrackId.hpp"
+#include "database/UserId.hpp"
+
+namespace Database
+{
+    class Db;
+}
+
+namespace API::Subsonic
+{
+    // In-memory copy of the artist, release and track names, used to answer search queries without scanning the database
+    // An entry matches if all the keywords are contained in its name (case insensitive), or in its sort name for artists
+    // The index is built on first use, and rebuilt when a scan has made changes
+    // The last queries of each user are kept, so that the next keystrokes only filter the previous matches
+    class SearchIndex
+    {
+    public:
+        SearchIndex(Database::Db& db, std::size_t maxCachedQueriesPerUser);
+
+        SearchIndex(const SearchIndex&) = delete;
+        SearchIndex& operator=(const SearchIndex&) = delete;
+
+        // Entries starting with the first keyword come first, then the entries are ordered by name
+        struct Results
+        {
+            std::vector<Database::ArtistId> artists;
+            std::vector<Database::ReleaseId> releases;
+            std::vector<Database::TrackId> tracks;
+        };
+        Results search(Database::UserId user, std::span<const std::string_view> keywords);
+
+        void onScanComplete(bool changes);
+
+    private:
+        // Lower cased names, stored in a single buffer and ordered by name
+        struct Names
+        {
+            std::string buffer;
+            std::vector<std::uint32_t> offsets; // name i is in [offsets[i], offsets[i + 1])
+
+            std::size_t size() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+            std::string_view get(std::uint32_t i) const { return std::string_view{ buffer }.substr(offsets[i], offsets[i + 1] - offsets[i]); }
+            void add(std::string_view name);
+        };
+
+        struct Index
+        {
+            std::vector<Database::ArtistId> artistIds;
+            Names artistNames;
+            Names artistSortNames;
+            std::vector<Database::ReleaseId> releaseIds;
+            Names releaseNames;
+            std::vector<Database::TrackId> trackIds;
+            Names trackNames;
+        };
+
+        // Matching positions in the index, in name order
+        struct Matches
+        {
+            std::vector<std::uint32_t> artists;
+            std::vector<std::uint32_t> releases;
+            std::vector<std::uint32_t> tracks;
+        };
+
+        struct CachedQuery
+        {
+            std::shared_ptr<const Index> index;
+            std::vector<std::string> keywords;
+            std::shared_ptr<const Matches> matches;
+        };
+
+        std::shared_ptr<const Index> getIndex();
+        std::shared_ptr<const Index> buildIndex();
+        struct CachedMatches
+        {
+            std::shared_ptr<const Matches> matches; // null if nothing usable has been found
+            bool exact{}; // false if the matches have to be filtered using the keywords
+        };
+        CachedMatches findCachedMatches(Database::UserId user, const std::shared_ptr<const Index>& index, std::span<const std::string> keywords);
+        void cacheMatches(Database::UserId user, CachedQuery cachedQuery);
+
+        Database::Db& _db;
+        const std::size_t _maxCachedQueriesPerUser;
+
+        std::mutex _mutex;
+        std::shared_ptr<const Index> _index;
+        std::unordered_map<Database::UserId, std::list<CachedQuery>> _cachedQueries; // most recent first
+    };
+}
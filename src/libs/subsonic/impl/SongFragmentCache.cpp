@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "SongFragmentCache.hpp"
+
+#include "utils/ILogger.hpp"
+
+namespace API::Subsonic
+{
+    namespace
+    {
+        // rough estimate of the memory used to index an entry
+        constexpr std::size_t entryOverhead{ 128 };
+    }
+
+    SongFragmentCache::SongFragmentCache(std::size_t maxSize)
+        : _maxSize{ maxSize }
+    {
+        LMS_LOG(API_SUBSONIC, INFO, "Song fragment cache max size = " << _maxSize << " bytes");
+    }
+
+    SongFragmentCache::Key SongFragmentCache::toKey(Database::TrackId trackId, bool openSubsonic)
+    {
+        return (static_cast<Key>(trackId.getValue()) << 1) | (openSubsonic ? 1 : 0);
+    }
+
+    SongFragmentCache::Entry SongFragmentCache::get(Database::TrackId trackId, bool openSubsonic, std::uint64_t generation)
+    {
+        if (!isEnabled())
+            return {};
+
+        const std::scoped_lock lock{ _mutex };
+
+        auto it{ _cachedFragmentsByKey.find(toKey(trackId, openSubsonic)) };
+        if (it == std::cend(_cachedFragmentsByKey))
+            return {};
+
+        CachedFragments::iterator itCachedFragment{ it->second };
+        if (itCachedFragment->second.generation != generation)
+        {
+            erase(itCachedFragment);
+            return {};
+        }
+
+        _cachedFragments.splice(std::begin(_cachedFragments), _cachedFragments, itCachedFragment);
+        return itCachedFragment->second.fragment;
+    }
+
+    void SongFragmentCache::put(Database::TrackId trackId, bool openSubsonic, std::uint64_t generation, Entry fragment)
+    {
+        if (!isEnabled())
+            return;
+
+        const std::size_t size{ fragment->xmlAttributes.size() + fragment->xmlChildren.size() + fragment->jsonMembers.size() + entryOverhead };
+        if (size > _maxSize)
+            return;
+
+        const Key key{ toKey(trackId, openSubsonic) };
+
+        const std::scoped_lock lock{ _mutex };
+
+        if (auto it{ _cachedFragmentsByKey.find(key) }; it != std::cend(_cachedFragmentsByKey))
+            erase(it->second);
+
+        while (!_cachedFragments.empty() && _currentSize + size > _maxSize)
+            erase(std::prev(std::end(_cachedFragments)));
+
+        _cachedFragments.emplace_front(key, CachedFragment{ std::move(fragment), generation, size });
+        _cachedFragmentsByKey.emplace(key, std::begin(_cachedFragments));
+        _currentSize += size;
+    }
+
+    void SongFragmentCache::clear()
+    {
+        const std::scoped_lock lock{ _mutex };
+
+        _cachedFragmentsByKey.clear();
+        _cachedFragments.clear();
+        _currentSize = 0;
+    }
+
+    void SongFragmentCache::erase(CachedFragments::iterator it)
+    {
+        _currentSize -= it->second.size;
+        _cachedFragmentsByKey.erase(it->first);
+        _cachedFragments.erase(it);
+    }
+}
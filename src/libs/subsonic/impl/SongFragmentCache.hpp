@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "database/TrackId.hpp"
+#include "SubsonicResponse.hpp"
+
+namespace API::Subsonic
+{
+    // Bounded cache of the user independent part of the song nodes, the least recently used ones are evicted first
+    // Tracks only change during scans: each fragment is stored along with the scan generation it has been created for
+    class SongFragmentCache
+    {
+    public:
+        SongFragmentCache(std::size_t maxSize); // in bytes, 0 to disable the cache
+
+        SongFragmentCache(const SongFragmentCache&) = delete;
+        SongFragmentCache& operator=(const SongFragmentCache&) = delete;
+
+        bool isEnabled() const { return _maxSize > 0; }
+
+        using Entry = std::shared_ptr<const Response::Node::SerializedFragment>;
+        Entry get(Database::TrackId trackId, bool openSubsonic, std::uint64_t generation);
+        void put(Database::TrackId trackId, bool openSubsonic, std::uint64_t generation, Entry fragment);
+        void clear();
+
+    private:
+        using Key = std::uint64_t;
+        static Key toKey(Database::TrackId trackId, bool openSubsonic);
+
+        struct CachedFragment
+        {
+            Entry fragment;
+            std::uint64_t generation;
+            std::size_t size;
+        };
+        using CachedFragments = std::list<std::pair<Key, CachedFragment>>; // most recently used first
+
+        void erase(CachedFragments::iterator it);
+
+        const std::size_t _maxSize;
+
+        std::mutex _mutex;
+        std::size_t _currentSize{};
+        CachedFragments _cachedFragments;
+        std::unordered_map<Key, CachedFragments::iterator> _cachedFragmentsByKey;
+    };
+}
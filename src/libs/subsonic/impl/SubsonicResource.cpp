@@ -20,16 +20,30 @@
 #include "SubsonicResource.hpp"
 
 #include <atomic>
+#include <ctime>
+#include <functional>
+#include <iomanip>
+#include <mutex>
+#include <optional>
+#include <sstream>
 #include <unordered_map>
+#include <unordered_set>
+
+#include <boost/asio/post.hpp>
+#include <Wt/Dbo/Exception.h>
+#include <Wt/Http/ResponseContinuation.h>
 
 #include "services/auth/IPasswordService.hpp"
 #include "services/auth/IEnvService.hpp"
+#include "services/scanner/IScannerService.hpp"
 #include "database/Db.hpp"
+#include "database/QueryDeadline.hpp"
 #include "database/Session.hpp"
 #include "database/User.hpp"
 #include "utils/EnumSet.hpp"
 #include "utils/IConfig.hpp"
 #include "utils/ILogger.hpp"
+#include "utils/ITraceLogger.hpp"
 #include "utils/Service.hpp"
 #include "utils/String.hpp"
 #include "utils/Utils.hpp"
@@ -37,6 +51,7 @@
 #include "entrypoints/AlbumSongLists.hpp"
 #include "entrypoints/Browsing.hpp"
 #include "entrypoints/Bookmarks.hpp"
+#include "entrypoints/LibraryChanges.hpp"
 #include "entrypoints/MediaAnnotation.hpp"
 #include "entrypoints/MediaLibraryScanning.hpp"
 #include "entrypoints/MediaRetrieval.hpp"
@@ -46,6 +61,8 @@
 #include "entrypoints/UserManagement.hpp"
 #include "ParameterParsing.hpp"
 #include "ProtocolVersion.hpp"
+#include "ResponseBufferStream.hpp"
+#include "ResponseCompression.hpp"
 #include "RequestContext.hpp"
 #include "SubsonicId.hpp"
 #include "SubsonicResponse.hpp"
@@ -135,16 +152,28 @@ namespace API::Subsonic
 
         void checkUserTypeIsAllowed(RequestContext& context, EnumSet<Database::UserType> allowedUserTypes)
         {
-            auto transaction{ context.dbSession.createReadTransaction() };
-
-            User::pointer currentUser{ User::find(context.dbSession, context.userId) };
-            if (!currentUser)
+            const std::optional<User::Settings> userSettings{ User::getSettings(context.dbSession, context.userId) };
+            if (!userSettings)
                 throw RequestedDataNotFoundError{};
 
-            if (!allowedUserTypes.contains(currentUser->getType()))
+            if (!allowedUserTypes.contains(userSettings->type))
                 throw UserNotAuthorizedError{};
         }
 
+        // Chrome trace event format, to be analyzed offline
+        void handleGetServerTraces(RequestContext& context, const Wt::Http::Request&, Wt::Http::Response& response)
+        {
+            checkUserTypeIsAllowed(context, { UserType::ADMIN });
+
+            const Tracing::ITraceLogger* traceLogger{ Service<Tracing::ITraceLogger>::get() };
+            if (!traceLogger)
+                throw NotImplementedGenericError{};
+
+            response.setMimeType("application/json");
+            response.addHeader("Content-Disposition", "attachment; filename=\"lms-traces.json\"");
+            traceLogger->dump(response.out());
+        }
+
         Response handleNotImplemented(RequestContext&)
         {
             throw NotImplementedGenericError{};
@@ -165,6 +194,7 @@ namespace API::Subsonic
             {"/ping",                       {handlePingRequest}},
             {"/getLicense",                 {handleGetLicenseRequest}},
             {"/getOpenSubsonicExtensions",  {handleGetOpenSubsonicExtensions}},
+            {"/getServerMetrics",           {handleGetServerMetricsRequest, {UserType::ADMIN}}},
 
             // Browsing
             {"/getMusicFolders",        {handleGetMusicFoldersRequest}},
@@ -265,6 +295,250 @@ namespace API::Subsonic
             {"/startScan",          {Scan::handleStartScan,     {UserType::ADMIN}}},
         };
 
+        // Entry points whose responses only depend on the request parameters, on the user and on the database content
+        // Their responses can be validated using the database write generation
+        static const std::unordered_set<std::string_view> conditionalRequestEntryPoints
+        {
+            "/getMusicFolders",
+            "/getIndexes",
+            "/getMusicDirectory",
+            "/getGenres",
+            "/getArtists",
+            "/getArtist",
+            "/getAlbum",
+            "/getSong",
+            "/getStarred",
+            "/getStarred2",
+            "/getPlaylists",
+            "/getPlaylist",
+        };
+
+        std::string computeEntityTag(const Db& db, std::string_view requestPath, const Wt::Http::ParameterMap& parameters, UserId userId)
+        {
+            // Authentication parameters are not relevant, the authenticated user is
+            std::string key{ requestPath };
+            key += '\n';
+            key += userId.toString();
+            for (const auto& [name, values] : parameters)
+            {
+                if (name == "u" || name == "p" || name == "t" || name == "s")
+                    continue;
+
+                key += '\n';
+                key += name;
+                for (const std::string& value : values)
+                {
+                    key += '=';
+                    key += value;
+                }
+            }
+
+            const auto lastWriteTime{ std::chrono::duration_cast<std::chrono::milliseconds>(db.getLastWriteTime().time_since_epoch()).count() };
+
+            std::ostringstream oss;
+            oss << '"' << std::hex << lastWriteTime << '-' << db.getWriteGeneration() << '-' << std::hash<std::string>{}(key) << '"';
+            return oss.str();
+        }
+
+        bool entityTagMatches(std::string_view ifNoneMatchHeader, std::string_view entityTag)
+        {
+            for (std::string_view candidate : StringUtils::splitString(ifNoneMatchHeader, ','))
+            {
+                candidate = StringUtils::stringTrim(candidate);
+                if (candidate == "*")
+                    return true;
+
+                // weak comparison
+                if (candidate.starts_with("W/"))
+                    candidate.remove_prefix(2);
+
+                if (candidate == entityTag)
+                    return true;
+            }
+
+            return false;
+        }
+
+        std::string toHttpDate(std::chrono::system_clock::time_point timePoint)
+        {
+            const std::time_t time{ std::chrono::system_clock::to_time_t(timePoint) };
+            std::tm tm{};
+            ::gmtime_r(&time, &tm);
+
+            std::ostringstream oss;
+            oss.imbue(std::locale::classic());
+            oss << std::put_time(&tm, "%a, %d %b %Y %H:%M:%S GMT");
+            return oss.str();
+        }
+
+        enum class ResponseCacheScope
+        {
+            AllUsers,   // same response for all users, until the next scan
+            User,       // depends on user data, until the next database write
+        };
+
+        struct CacheableEntryPointInfo
+        {
+            ResponseCacheScope scope;
+            std::function<bool(const Wt::Http::ParameterMap&)> isCacheable{}; // all requests are cacheable if not set
+        };
+
+        bool isNotRandomAlbumList(const Wt::Http::ParameterMap& parameters)
+        {
+            return getParameterAs<std::string>(parameters, "type") != "random";
+        }
+
+        // Expensive read-only entry points
+        static const std::unordered_map<std::string_view, CacheableEntryPointInfo> cacheableEntryPoints
+        {
+            {"/getMusicFolders",    {ResponseCacheScope::AllUsers}},
+            {"/getGenres",          {ResponseCacheScope::AllUsers}},
+            {"/getIndexes",         {ResponseCacheScope::User}},
+            {"/getArtists",         {ResponseCacheScope::User}},
+            {"/getAlbumList",       {ResponseCacheScope::User, isNotRandomAlbumList}},
+            {"/getAlbumList2",      {ResponseCacheScope::User, isNotRandomAlbumList}},
+            {"/getTopSongs",        {ResponseCacheScope::User}},
+        };
+
+        struct SerializedResponse
+        {
+            std::string body;
+            bool gzipEncoded{};
+        };
+
+        bool isGzipEncoded(std::string_view body)
+        {
+            // serialized responses start with either '<' or '{', they cannot be mistaken for the gzip magic bytes
+            return body.size() >= 2 && body[0] == '\x1f' && body[1] == '\x8b';
+        }
+
+        void writePreparedResponse(Wt::Http::Response& response, const PreparedResponse& preparedResponse)
+        {
+            response.setStatus(preparedResponse.status);
+            for (const auto& [name, value] : preparedResponse.headers)
+                response.addHeader(name, value);
+            if (!preparedResponse.mimeType.empty())
+                response.setMimeType(preparedResponse.mimeType);
+
+            if (!preparedResponse.body)
+                return;
+
+            if (preparedResponse.gzipEncoded)
+                response.addHeader("Content-Encoding", "gzip");
+
+            response.setContentLength(preparedResponse.body->size());
+            response.out().write(preparedResponse.body->data(), preparedResponse.body->size());
+        }
+
+        PreparedResponse prepareFailedResponse(ProtocolVersion protocolVersion, const Error& error, ResponseFormat format)
+        {
+            const Response resp{ Response::createFailedResponse(protocolVersion, error) };
+
+            ResponseBufferStream os;
+            resp.write(os, format);
+
+            PreparedResponse preparedResponse;
+            preparedResponse.body = std::make_shared<const std::string>(os.getContent());
+            preparedResponse.mimeType = ResponseFormatToMimeType(format);
+            return preparedResponse;
+        }
+
+        // Shared between the request, its continuation and the task preparing the response
+        struct PendingResponse
+        {
+            std::mutex mutex;
+            Wt::Http::ParameterMap parameters; // copied, as the entry point is run once the request has been left
+            std::optional<PreparedResponse> response;
+            Wt::Http::ResponseContinuation* continuation{}; // set once waiting for the response, reset if the request is aborted
+            std::atomic<bool> cancelled{}; // the client has gone away: the queries of the entry point are interrupted
+        };
+
+        std::shared_ptr<PendingResponse> getPendingResponse(const Wt::Http::Request& request)
+        {
+            Wt::Http::ResponseContinuation* continuation{ request.continuation() };
+            if (!continuation)
+                return {};
+
+            const auto* pendingResponse{ Wt::cpp17::any_cast<std::shared_ptr<PendingResponse>>(&continuation->data()) };
+            return pendingResponse ? *pendingResponse : nullptr;
+        }
+
+        std::string computeResponseCacheKey(std::string_view requestPath, const RequestContext& context, ResponseFormat format, ResponseCacheScope scope)
+        {
+            std::ostringstream oss;
+            oss << requestPath
+                << '\n' << context.serverProtocolVersion.major << '.' << context.serverProtocolVersion.minor << '.' << context.serverProtocolVersion.patch
+                << '\n' << (format == ResponseFormat::json ? "json" : "xml")
+                << '\n' << context.enableOpenSubsonic << context.enableDefaultCover;
+            if (scope == ResponseCacheScope::User)
+                oss << '\n' << context.userId.toString();
+
+            // parameters are sorted by name, client related ones are already taken into account
+            for (const auto& [name, values] : context.parameters)
+            {
+                if (name == "u" || name == "p" || name == "t" || name == "s" || name == "c" || name == "v" || name == "f")
+                    continue;
+
+                oss << '\n' << name;
+                for (const std::string& value : values)
+                    oss << '=' << value;
+            }
+
+            return oss.str();
+        }
+
+        std::vector<std::string_view> getRequestEntryPointNames()
+        {
+            std::vector<std::string_view> names;
+            for (const auto& [name, entryPoint] : requestEntryPoints)
+                names.push_back(name);
+
+            return names;
+        }
+
+        std::unordered_map<std::string_view, std::chrono::milliseconds> readQueryTimeoutsByEntryPoint()
+        {
+            std::unordered_map<std::string_view, std::chrono::milliseconds> res;
+
+            Service<IConfig>::get()->visitStrings("api-subsonic-entry-point-query-timeouts", [&](std::string_view entry)
+                {
+                    const std::size_t separator{ entry.rfind(':') };
+                    const auto itEntryPoint{ separator != std::string_view::npos ? requestEntryPoints.find("/" + std::string{ entry.substr(0, separator) }) : std::cend(requestEntryPoints) };
+                    const std::optional<std::size_t> timeout{ separator != std::string_view::npos ? StringUtils::readAs<std::size_t>(entry.substr(separator + 1)) : std::nullopt };
+                    if (itEntryPoint == std::cend(requestEntryPoints) || !timeout)
+                    {
+                        LMS_LOG(API_SUBSONIC, ERROR, "Invalid entry '" << entry << "' in 'api-subsonic-entry-point-query-timeouts', ignored");
+                        return;
+                    }
+
+                    res[itEntryPoint->first] = std::chrono::milliseconds{ *timeout };
+                });
+
+            return res;
+        }
+
+        // The database errors caused by the query deadline are reported as such to the client
+        Response runEntryPoint(const RequestEntryPointInfo& entryPoint, RequestContext& context, std::string_view requestPath)
+        {
+            try
+            {
+                return (entryPoint.func)(context);
+            }
+            catch (const Wt::Dbo::Exception& e)
+            {
+                const std::optional<Database::QueryDeadline>& queryDeadline{ Database::ScopedQueryDeadline::getCurrent() };
+                if (!queryDeadline || !queryDeadline->isExceeded())
+                    throw;
+
+                if (queryDeadline->isCancelled())
+                    LMS_LOG(API_SUBSONIC, DEBUG, "Request '" << requestPath << "' cancelled: " << e.what());
+                else
+                    LMS_LOG(API_SUBSONIC, WARNING, "Query timeout reached for request '" << requestPath << "': " << e.what());
+
+                throw RequestTimeoutGenericError{};
+            }
+        }
+
         using MediaRetrievalHandlerFunc = std::function<void(RequestContext&, const Wt::Http::Request&, Wt::Http::Response&)>;
         static std::unordered_map<std::string, MediaRetrievalHandlerFunc> mediaRetrievalHandlers
         {
@@ -272,6 +546,12 @@ namespace API::Subsonic
             {"/download",       handleDownload},
             {"/stream",         handleStream},
             {"/getCoverArt",    handleGetCoverArt},
+
+            // Offline sync
+            {"/getLibraryChanges",  handleGetLibraryChanges},
+
+            // LMS specific
+            {"/getServerTraces",    handleGetServerTraces},
         };
     }
 
@@ -281,7 +561,41 @@ namespace API::Subsonic
         , _openSubsonicDisabledClients{ readOpenSubsonicDisabledClients() }
         , _defaultCoverClients{ readDefaultCoverClients() }
         , _db{ db }
+        , _artistIndexCache{ db }
+        , _responseCache{ Service<IConfig>::get()->getULong("api-subsonic-response-cache-max-size", 16) * 1024 * 1024 }
+        , _songFragmentCache{ Service<IConfig>::get()->getULong("api-subsonic-song-cache-max-size", 16) * 1024 * 1024 }
+        , _compressionMinSize{ Service<IConfig>::get()->getULong("api-subsonic-compression-min-size", 1024) }
+        , _queryTimeout{ Service<IConfig>::get()->getULong("api-subsonic-query-timeout", 20000) }
+        , _queryTimeoutsByEntryPoint{ readQueryTimeoutsByEntryPoint() }
+        , _queryExecutor{ db, Service<IConfig>::get()->getULong("api-subsonic-query-thread-count", 4) }
+        , _requestMetrics{ getRequestEntryPointNames() }
     {
+        if (const std::size_t requestThreadCount{ Service<IConfig>::get()->getULong("api-subsonic-request-thread-count", 8) }; requestThreadCount > 0)
+        {
+            _requestIoContextRunner = std::make_unique<IOContextRunner>(_requestIoContext, requestThreadCount, "subsonic-request");
+            LMS_LOG(API_SUBSONIC, INFO, "Using " << requestThreadCount << " threads to handle requests");
+        }
+
+        if (Service<IConfig>::get()->getBool("api-subsonic-search-index", true))
+            _searchIndex.emplace(db, Service<IConfig>::get()->getULong("api-subsonic-search-cache-size", 8));
+
+        _scanCompleteConnection = Service<Scanner::IScannerService>::get()->getEvents().scanComplete.connect([this](const Scanner::ScanSummary& stats)
+            {
+                _artistIndexCache.onScanComplete(stats.nbChanges() > 0);
+                if (_searchIndex)
+                    _searchIndex->onScanComplete(stats.nbChanges() > 0);
+                if (stats.nbChanges() > 0)
+                {
+                    _scanGeneration++;
+                    _responseCache.clear();
+                    _songFragmentCache.clear();
+                }
+            });
+    }
+
+    SubsonicResource::~SubsonicResource()
+    {
+        _scanCompleteConnection.disconnect();
     }
 
     void SubsonicResource::handleRequest(const Wt::Http::Request& request, Wt::Http::Response& response)
@@ -299,28 +613,39 @@ namespace API::Subsonic
         // Optional parameters
         const ResponseFormat format{ getParameterAs<std::string>(request.getParameterMap(), "f").value_or("xml") == "json" ? ResponseFormat::json : ResponseFormat::xml };
 
+        if (const std::shared_ptr<PendingResponse> pendingResponse{ getPendingResponse(request) })
+        {
+            const std::scoped_lock lock{ pendingResponse->mutex };
+            writePreparedResponse(response, pendingResponse->response.value());
+            return;
+        }
+
         ProtocolVersion protocolVersion{ defaultServerProtocolVersion };
 
         try
         {
             // We need to parse client a soon as possible to make sure to answer with the right protocol version
             protocolVersion = getServerProtocolVersion(getMandatoryParameterAs<std::string>(request.getParameterMap(), "c"));
-            RequestContext requestContext{ buildRequestContext(request) };
+            std::optional<RequestContext> optRequestContext{ buildRequestContext(request, response) };
+            if (!optRequestContext)
+            {
+                LMS_LOG(API_SUBSONIC, DEBUG, "Request " << requestId << " '" << requestPath << "': authentication pending");
+                return;
+            }
+            RequestContext& requestContext{ *optRequestContext };
 
             auto itEntryPoint{ requestEntryPoints.find(requestPath) };
             if (itEntryPoint != requestEntryPoints.end())
             {
-                if (itEntryPoint->second.checkFunc)
-                    itEntryPoint->second.checkFunc();
-
-                checkUserTypeIsAllowed(requestContext, itEntryPoint->second.allowedUserTypes);
-
-                const Response resp{ (itEntryPoint->second.func)(requestContext) };
-
-                resp.write(response.out(), format);
-                response.setMimeType(std::string{ ResponseFormatToMimeType(format) });
-                LMS_LOG(API_SUBSONIC, DEBUG, "Request " << requestId << " '" << requestPath << "' handled!");
+                RequestHeaders headers{ request.headerValue("If-None-Match"), request.headerValue("Accept-Encoding") };
+                if (_requestIoContextRunner)
+                {
+                    postPrepareResponse(requestId, itEntryPoint->first, requestContext, std::move(headers), format, response);
+                    LMS_LOG(API_SUBSONIC, DEBUG, "Request " << requestId << " '" << requestPath << "' posted");
+                    return;
+                }
 
+                writePreparedResponse(response, prepareResponse(requestId, itEntryPoint->first, requestContext, headers, format));
                 return;
             }
 
@@ -346,6 +671,182 @@ namespace API::Subsonic
         }
     }
 
+    PreparedResponse SubsonicResource::prepareResponse(std::size_t requestId, std::string_view requestPath, RequestContext& context, const RequestHeaders& headers, ResponseFormat format, std::shared_ptr<const std::atomic<bool>> cancelled)
+    {
+        const RequestEntryPointInfo& entryPoint{ requestEntryPoints.at(requestPath) };
+        PreparedResponse preparedResponse;
+
+        // Runaway queries must not hold the read connections, they are interrupted once the deadline is reached
+        const Database::ScopedQueryDeadline queryDeadline{ getQueryDeadline(requestPath, std::move(cancelled)) };
+
+        RequestMetrics::Recorder metricsRecorder{ _requestMetrics, requestPath, context.dbSession };
+        LMS_SCOPED_TRACE_OVERVIEW("Subsonic", requestPath);
+
+        if (entryPoint.checkFunc)
+            entryPoint.checkFunc();
+
+        checkUserTypeIsAllowed(context, entryPoint.allowedUserTypes);
+
+        std::optional<std::string> entityTag;
+        std::string lastModified;
+        if (conditionalRequestEntryPoints.contains(requestPath))
+        {
+            // Must be computed before reading anything from the database
+            entityTag = computeEntityTag(_db, requestPath, context.parameters, context.userId);
+            lastModified = toHttpDate(_db.getLastWriteTime());
+
+            if (!headers.ifNoneMatch.empty() && entityTagMatches(headers.ifNoneMatch, *entityTag))
+            {
+                preparedResponse.status = 304;
+                preparedResponse.headers.emplace_back("ETag", *entityTag);
+                metricsRecorder.setSucceeded(0);
+                LMS_LOG(API_SUBSONIC, DEBUG, "Request " << requestId << " '" << requestPath << "' not modified!");
+                return preparedResponse;
+            }
+        }
+
+        std::string responseCacheKey;
+        std::uint64_t responseCacheGeneration{};
+        if (auto itCacheable{ cacheableEntryPoints.find(requestPath) }; _responseCache.isEnabled() && itCacheable != std::cend(cacheableEntryPoints))
+        {
+            const CacheableEntryPointInfo& cacheableInfo{ itCacheable->second };
+            if (!cacheableInfo.isCacheable || cacheableInfo.isCacheable(context.parameters))
+            {
+                responseCacheKey = computeResponseCacheKey(requestPath, context, format, cacheableInfo.scope);
+                responseCacheGeneration = (cacheableInfo.scope == ResponseCacheScope::AllUsers) ? _scanGeneration.load() : _db.getWriteGeneration();
+            }
+        }
+
+        if (entityTag)
+        {
+            preparedResponse.headers.emplace_back("ETag", *entityTag);
+            preparedResponse.headers.emplace_back("Last-Modified", lastModified);
+        }
+
+        const bool compress{ _compressionMinSize > 0 && isGzipEncodingAccepted(headers.acceptEncoding) };
+        if (_compressionMinSize > 0)
+            preparedResponse.headers.emplace_back("Vary", "Accept-Encoding");
+
+        // Compressed responses are cached as is, so that they are not compressed again on cache hits
+        // Responses smaller than the threshold are never compressed, even if they are cached using a gzip key
+        auto serializeResponse{ [&]
+            {
+                const Response resp{ runEntryPoint(entryPoint, context, requestPath) };
+
+                LMS_SCOPED_TRACE_OVERVIEW("Subsonic", "WriteResponse");
+                // the reused buffer is only copied once, to the exact size of the response
+                ResponseBufferStream os;
+                resp.write(os, format);
+                const std::string_view serializedResponse{ os.getContent() };
+
+                if (compress && serializedResponse.size() >= _compressionMinSize)
+                    return SerializedResponse{ compressGzip(serializedResponse), true };
+
+                return SerializedResponse{ std::string{ serializedResponse }, false };
+            } };
+
+        if (!responseCacheKey.empty())
+        {
+            if (compress)
+                responseCacheKey += "\ngzip";
+
+            ResponseCache::Entry cachedResponse{ _responseCache.get(responseCacheKey, responseCacheGeneration) };
+            if (!cachedResponse)
+            {
+                SerializedResponse serializedResponse{ serializeResponse() };
+
+                preparedResponse.body = std::make_shared<const std::string>(std::move(serializedResponse.body));
+                preparedResponse.gzipEncoded = serializedResponse.gzipEncoded;
+                _responseCache.put(responseCacheKey, responseCacheGeneration, preparedResponse.body);
+            }
+            else
+            {
+                preparedResponse.body = std::move(cachedResponse);
+                preparedResponse.gzipEncoded = compress && isGzipEncoded(*preparedResponse.body);
+            }
+        }
+        else
+        {
+            SerializedResponse serializedResponse{ serializeResponse() };
+            preparedResponse.body = std::make_shared<const std::string>(std::move(serializedResponse.body));
+            preparedResponse.gzipEncoded = serializedResponse.gzipEncoded;
+        }
+        metricsRecorder.setSucceeded(preparedResponse.body->size());
+
+        preparedResponse.mimeType = ResponseFormatToMimeType(format);
+        LMS_LOG(API_SUBSONIC, DEBUG, "Request " << requestId << " '" << requestPath << "' handled!");
+
+        return preparedResponse;
+    }
+
+    void SubsonicResource::postPrepareResponse(std::size_t requestId, std::string_view requestPath, const RequestContext& context, RequestHeaders headers, ResponseFormat format, Wt::Http::Response& response)
+    {
+        auto pendingResponse{ std::make_shared<PendingResponse>() };
+        pendingResponse->parameters = context.parameters;
+
+        boost::asio::post(_requestIoContext, [this, requestId, requestPath, userId = context.userId, clientInfo = context.clientInfo, serverProtocolVersion = context.serverProtocolVersion, enableOpenSubsonic = context.enableOpenSubsonic, enableDefaultCover = context.enableDefaultCover, headers = std::move(headers), format, pendingResponse]
+            {
+                std::optional<PreparedResponse> preparedResponse;
+                try
+                {
+                    // each thread of the executor uses its own database session
+                    RequestContext workerContext{ pendingResponse->parameters, _db.getTLSSession(), _artistIndexCache, _queryExecutor, _searchIndex ? &*_searchIndex : nullptr, _songFragmentCache.isEnabled() ? &_songFragmentCache : nullptr, _scanGeneration.load(), _requestMetrics, userId, clientInfo, serverProtocolVersion, enableOpenSubsonic, enableDefaultCover, nullptr };
+                    preparedResponse = prepareResponse(requestId, requestPath, workerContext, headers, format, std::shared_ptr<const std::atomic<bool>>{ pendingResponse, &pendingResponse->cancelled });
+                }
+                catch (const Error& e)
+                {
+                    LMS_LOG(API_SUBSONIC, ERROR, "Error while processing request '" << requestPath << "'"
+                        << ", params = [" << parameterMapToDebugString(pendingResponse->parameters) << "]"
+                        << ", code = " << static_cast<int>(e.getCode()) << ", msg = '" << e.getMessage() << "'");
+                    preparedResponse = prepareFailedResponse(serverProtocolVersion, e, format);
+                }
+                catch (const std::exception& e)
+                {
+                    LMS_LOG(API_SUBSONIC, ERROR, "Exception while processing request '" << requestPath << "': " << e.what());
+                    preparedResponse.emplace();
+                    preparedResponse->status = 500;
+                }
+
+                Wt::Http::ResponseContinuation* continuation;
+                {
+                    const std::scoped_lock lock{ pendingResponse->mutex };
+                    pendingResponse->response = std::move(preparedResponse);
+                    continuation = pendingResponse->continuation;
+                }
+                if (continuation)
+                    continuation->haveMoreData();
+            });
+
+        Wt::Http::ResponseContinuation* continuation{ response.createContinuation() };
+        continuation->setData(pendingResponse);
+        continuation->waitForMoreData();
+
+        bool hasResponse;
+        {
+            const std::scoped_lock lock{ pendingResponse->mutex };
+            hasResponse = pendingResponse->response.has_value();
+            if (!hasResponse)
+                pendingResponse->continuation = continuation;
+        }
+        // the response may already be prepared
+        if (hasResponse)
+            continuation->haveMoreData();
+    }
+
+    std::optional<Database::QueryDeadline> SubsonicResource::getQueryDeadline(std::string_view requestPath, std::shared_ptr<const std::atomic<bool>> cancelled) const
+    {
+        std::chrono::milliseconds timeout{ _queryTimeout };
+        if (auto it{ _queryTimeoutsByEntryPoint.find(requestPath) }; it != std::cend(_queryTimeoutsByEntryPoint))
+            timeout = it->second;
+
+        if (timeout.count() > 0)
+            return Database::QueryDeadline{ Database::QueryDeadline::Clock::now() + timeout, std::move(cancelled) };
+        if (cancelled)
+            return Database::QueryDeadline{ Database::QueryDeadline::Clock::time_point::max(), std::move(cancelled) };
+
+        return std::nullopt;
+    }
+
     ProtocolVersion SubsonicResource::getServerProtocolVersion(const std::string& clientName) const
     {
         auto it{ _serverProtocolVersionsByClient.find(clientName) };
@@ -386,19 +887,66 @@ namespace API::Subsonic
         return res;
     }
 
-    RequestContext SubsonicResource::buildRequestContext(const Wt::Http::Request& request)
+    namespace
+    {
+        // Shared between the request, its continuation and the password check callback
+        struct PendingAuthentication
+        {
+            std::mutex mutex;
+            std::optional<Auth::IPasswordService::CheckResult> result;
+            Wt::Http::ResponseContinuation* continuation{}; // set once waiting for the result
+        };
+
+        std::shared_ptr<PendingAuthentication> getPendingAuthentication(const Wt::Http::Request& request)
+        {
+            Wt::Http::ResponseContinuation* continuation{ request.continuation() };
+            if (!continuation)
+                return {};
+
+            const auto* pendingAuthentication{ Wt::cpp17::any_cast<std::shared_ptr<PendingAuthentication>>(&continuation->data()) };
+            return pendingAuthentication ? *pendingAuthentication : nullptr;
+        }
+
+        Database::UserId processPasswordCheckResult(const Auth::IPasswordService::CheckResult& checkResult)
+        {
+            switch (checkResult.state)
+            {
+            case Auth::IPasswordService::CheckResult::State::Granted:
+                return *checkResult.userId;
+            case Auth::IPasswordService::CheckResult::State::Denied:
+                throw WrongUsernameOrPasswordError{};
+            case Auth::IPasswordService::CheckResult::State::Throttled:
+                throw LoginThrottledGenericError{};
+            }
+
+            throw InternalErrorGenericError{ "Unhandled password check result" };
+        }
+    }
+
+    std::optional<RequestContext> SubsonicResource::buildRequestContext(const Wt::Http::Request& request, Wt::Http::Response& response)
     {
         const Wt::Http::ParameterMap& parameters{ request.getParameterMap() };
         const ClientInfo clientInfo{ getClientInfo(parameters) };
-        const Database::UserId userId{ authenticateUser(request, clientInfo) };
+        const std::optional<Database::UserId> userId{ authenticateUser(request, response, clientInfo) };
+        if (!userId)
+            return std::nullopt;
+
         bool enableOpenSubsonic{ _openSubsonicDisabledClients.find(clientInfo.name) == std::cend(_openSubsonicDisabledClients) };
         bool enableDefaultCover{ _defaultCoverClients.find(clientInfo.name) != std::cend(_openSubsonicDisabledClients) };
+        // the entry points must not see the continuation used to wait for the authentication
+        Wt::Http::ResponseContinuation* continuation{ getPendingAuthentication(request) ? nullptr : request.continuation() };
 
-        return { parameters, _db.getTLSSession(), userId, clientInfo, getServerProtocolVersion(clientInfo.name), enableOpenSubsonic, enableDefaultCover };
+        return RequestContext{ parameters, _db.getTLSSession(), _artistIndexCache, _queryExecutor, _searchIndex ? &*_searchIndex : nullptr, _songFragmentCache.isEnabled() ? &_songFragmentCache : nullptr, _scanGeneration.load(), _requestMetrics, *userId, clientInfo, getServerProtocolVersion(clientInfo.name), enableOpenSubsonic, enableDefaultCover, continuation };
     }
 
-    Database::UserId SubsonicResource::authenticateUser(const Wt::Http::Request& request, const ClientInfo& clientInfo)
+    std::optional<Database::UserId> SubsonicResource::authenticateUser(const Wt::Http::Request& request, Wt::Http::Response& response, const ClientInfo& clientInfo)
     {
+        if (const std::shared_ptr<PendingAuthentication> pendingAuthentication{ getPendingAuthentication(request) })
+        {
+            const std::scoped_lock lock{ pendingAuthentication->mutex };
+            return processPasswordCheckResult(pendingAuthentication->result.value());
+        }
+
         // if the request if a continuation, the user is already authenticated
         if (request.continuation())
         {
@@ -422,22 +970,61 @@ namespace API::Subsonic
         }
         else if (auto * authPasswordService{ Service<::Auth::IPasswordService>::get() })
         {
-            const auto checkResult{ authPasswordService->checkUserPassword(boost::asio::ip::address::from_string(request.clientAddress()), clientInfo.user, clientInfo.password) };
+            // Slow password checks are made out of the HTTP threads, the request is then resumed in a continuation
+            auto pendingAuthentication{ std::make_shared<PendingAuthentication>() };
+            auto onChecked{ [pendingAuthentication](const Auth::IPasswordService::CheckResult& checkResult)
+            {
+                Wt::Http::ResponseContinuation* continuation;
+                {
+                    const std::scoped_lock lock{ pendingAuthentication->mutex };
+                    pendingAuthentication->result = checkResult;
+                    continuation = pendingAuthentication->continuation;
+                }
+                if (continuation)
+                    continuation->haveMoreData();
+            } };
 
-            switch (checkResult.state)
+            if (const auto checkResult{ authPasswordService->asyncCheckUserPassword(boost::asio::ip::address::from_string(request.clientAddress()), clientInfo.user, clientInfo.password, std::move(onChecked)) })
+                return processPasswordCheckResult(*checkResult);
+
+            Wt::Http::ResponseContinuation* continuation{ response.createContinuation() };
+            continuation->setData(pendingAuthentication);
+            continuation->waitForMoreData();
+
+            bool hasResult;
             {
-            case Auth::IPasswordService::CheckResult::State::Granted:
-                return *checkResult.userId;
-                break;
-            case Auth::IPasswordService::CheckResult::State::Denied:
-                throw WrongUsernameOrPasswordError{};
-            case Auth::IPasswordService::CheckResult::State::Throttled:
-                throw LoginThrottledGenericError{};
+                const std::scoped_lock lock{ pendingAuthentication->mutex };
+                hasResult = pendingAuthentication->result.has_value();
+                if (!hasResult)
+                    pendingAuthentication->continuation = continuation;
             }
+            // the check may already be done
+            if (hasResult)
+                continuation->haveMoreData();
+
+            return std::nullopt;
         }
 
         throw InternalErrorGenericError{ "No service available to authenticate user" };
     }
 
+    void SubsonicResource::handleAbort(const Wt::Http::Request& request)
+    {
+        // the continuation is about to be deleted: the pending tasks must no longer resume it
+        if (const std::shared_ptr<PendingResponse> pendingResponse{ getPendingResponse(request) })
+        {
+            LMS_LOG(API_SUBSONIC, DEBUG, "Request '" << request.pathInfo() << "' aborted by the client");
+
+            const std::scoped_lock lock{ pendingResponse->mutex };
+            pendingResponse->continuation = nullptr;
+            pendingResponse->cancelled = true;
+        }
+        else if (const std::shared_ptr<PendingAuthentication> pendingAuthentication{ getPendingAuthentication(request) })
+        {
+            const std::scoped_lock lock{ pendingAuthentication->mutex };
+            pendingAuthentication->continuation = nullptr;
+        }
+    }
+
 } // namespace api::subsonic
 
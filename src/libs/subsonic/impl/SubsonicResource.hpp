@@ -18,16 +18,34 @@
  */
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <memory>
 #include <string>
 #include <unordered_set>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
+#include <boost/asio/io_context.hpp>
 #include <Wt/WResource.h>
 #include <Wt/Http/Response.h>
+#include <Wt/WSignal.h>
 
+#include "database/QueryDeadline.hpp"
 #include "database/Types.hpp"
+#include "ArtistIndexCache.hpp"
 #include "ClientInfo.hpp"
+#include "QueryExecutor.hpp"
+#include "RequestMetrics.hpp"
+#include "SearchIndex.hpp"
+#include "ResponseCache.hpp"
+#include "SongFragmentCache.hpp"
 #include "RequestContext.hpp"
+#include "SubsonicResponse.hpp"
+#include "utils/IOContextRunner.hpp"
 
 namespace Database
 {
@@ -37,25 +55,68 @@ namespace Database
 namespace API::Subsonic
 {
 
+    // Response of an entry point, written by the HTTP thread once done
+    struct PreparedResponse
+    {
+        int status{ 200 };
+        std::vector<std::pair<std::string, std::string>> headers;
+        ResponseCache::Entry body; // may be shared with the response cache
+        bool gzipEncoded{};
+        std::string mimeType;
+    };
+
+    // Request headers used by the entry points
+    struct RequestHeaders
+    {
+        std::string ifNoneMatch;
+        std::string acceptEncoding;
+    };
+
     class SubsonicResource final : public Wt::WResource
     {
         public:
             SubsonicResource(Database::Db& db);
+            ~SubsonicResource() override;
 
         private:
             void handleRequest(const Wt::Http::Request &request, Wt::Http::Response &response) override;
+            // The client has gone away while the request was waiting in a continuation
+            void handleAbort(const Wt::Http::Request& request) override;
             ProtocolVersion getServerProtocolVersion(const std::string& clientName) const;
 
             static void checkProtocolVersion(ProtocolVersion client, ProtocolVersion server);
             ClientInfo getClientInfo(const Wt::Http::ParameterMap& parameters);
-            RequestContext buildRequestContext(const Wt::Http::Request& request);
-            Database::UserId authenticateUser(const Wt::Http::Request& request, const ClientInfo& clientInfo);
+            // std::nullopt if the authentication is pending: the request will be resumed in a continuation
+            std::optional<RequestContext> buildRequestContext(const Wt::Http::Request& request, Wt::Http::Response& response);
+            std::optional<Database::UserId> authenticateUser(const Wt::Http::Request& request, Wt::Http::Response& response, const ClientInfo& clientInfo);
+
+            // cancelled may be null, if the request cannot be aborted
+            PreparedResponse prepareResponse(std::size_t requestId, std::string_view requestPath, RequestContext& context, const RequestHeaders& headers, ResponseFormat format, std::shared_ptr<const std::atomic<bool>> cancelled = {});
+            // Prepares the response using the request executor, the request is then resumed in a continuation to write it
+            void postPrepareResponse(std::size_t requestId, std::string_view requestPath, const RequestContext& context, RequestHeaders headers, ResponseFormat format, Wt::Http::Response& response);
+            // std::nullopt if the queries of the entry point are not limited
+            std::optional<Database::QueryDeadline> getQueryDeadline(std::string_view requestPath, std::shared_ptr<const std::atomic<bool>> cancelled) const;
 
             const std::unordered_map<std::string, ProtocolVersion> _serverProtocolVersionsByClient;
             const std::unordered_set<std::string> _openSubsonicDisabledClients;
             const std::unordered_set<std::string> _defaultCoverClients;
 
             Database::Db& _db;
+            ArtistIndexCache _artistIndexCache;
+            ResponseCache _responseCache;
+            SongFragmentCache _songFragmentCache;
+            const std::size_t _compressionMinSize; // in bytes, 0 to disable compression
+            const std::chrono::milliseconds _queryTimeout; // 0 for no limit
+            const std::unordered_map<std::string_view, std::chrono::milliseconds> _queryTimeoutsByEntryPoint; // overrides _queryTimeout
+            QueryExecutor _queryExecutor;
+            std::optional<SearchIndex> _searchIndex;
+            RequestMetrics _requestMetrics;
+            std::atomic<std::uint64_t> _scanGeneration{}; // incremented each time a scan has made changes
+            Wt::Signals::connection _scanCompleteConnection;
+
+            // Entry points are run out of the HTTP threads, so that slow requests do not prevent other requests from being served
+            boost::asio::io_context _requestIoContext;
+            std::unique_ptr<IOContextRunner> _requestIoContextRunner; // null if requests are handled synchronously, must be last
     };
 
 } // namespace
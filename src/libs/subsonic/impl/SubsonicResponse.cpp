@@ -19,10 +19,14 @@
 
 #include "SubsonicResponse.hpp"
 
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <charconv>
 #include <cmath>
 #include <climits>
-#include <boost/property_tree/xml_parser.hpp>
+#include <limits>
+#include <sstream>
 
 #include "utils/Exception.hpp"
 #include "utils/String.hpp"
@@ -41,6 +45,39 @@ namespace API::Subsonic
         return "";
     }
 
+    namespace
+    {
+        template <typename Entries>
+        auto findEntry(Entries& entries, Response::Node::Key key)
+        {
+            return std::find_if(std::begin(entries), std::end(entries), [&](const auto& entry) { return entry.first == key; });
+        }
+
+        template <typename Entries>
+        auto& getOrCreateEntry(Entries& entries, Response::Node::Key key)
+        {
+            auto it{ findEntry(entries, key) };
+            if (it != std::end(entries))
+                return it->second;
+
+            return entries.emplace_back(key, typename Entries::value_type::second_type{}).second;
+        }
+
+        template <typename T>
+        void writeNumber(std::ostream& os, T value)
+        {
+            std::array<char, 32> buffer;
+            std::to_chars_result result;
+            if constexpr (std::is_floating_point_v<T>)
+                result = std::to_chars(buffer.data(), buffer.data() + buffer.size(), value, std::chars_format::general, 6); // same output as the default ostream formatting
+            else
+                result = std::to_chars(buffer.data(), buffer.data() + buffer.size(), value);
+            assert(result.ec == std::errc{});
+
+            os.write(buffer.data(), result.ptr - buffer.data());
+        }
+    }
+
     void Response::Node::setValue(std::string_view value)
     {
         assert(_children.empty() && _childrenArrays.empty() && _childrenValues.empty());
@@ -55,42 +92,47 @@ namespace API::Subsonic
 
     void Response::Node::setAttribute(Key key, std::string_view value)
     {
-        _attributes[key] = std::string{ value };
+        setAttributeValue(key, std::string{ value });
+    }
+
+    void Response::Node::setAttributeValue(Key key, ValueType&& value)
+    {
+        getOrCreateEntry(_attributes, key) = std::move(value);
     }
 
     void Response::Node::addChild(Key key, Node&& node)
     {
         assert(!_value);
-        assert(_children.find(key) == std::cend(_children));
-        _children[key] = std::move(node);
+        assert(findEntry(_children, key) == std::cend(_children));
+        _children.emplace_back(key, std::move(node));
     }
 
     void Response::Node::createEmptyArrayChild(Key key)
     {
         assert(!_value);
-        assert(_children.find(key) == std::cend(_children));
-        _childrenArrays.emplace(key, std::vector<Node>{});
+        assert(findEntry(_children, key) == std::cend(_children));
+        getOrCreateEntry(_childrenArrays, key);
     }
 
     void Response::Node::addArrayChild(Key key, Node&& node)
     {
         assert(!_value);
-        assert(_children.find(key) == std::cend(_children));
-        _childrenArrays[key].emplace_back(std::move(node));
+        assert(findEntry(_children, key) == std::cend(_children));
+        getOrCreateEntry(_childrenArrays, key).emplace_back(std::move(node));
     }
 
     void Response::Node::createEmptyArrayValue(Key key)
     {
         assert(!_value);
-        assert(_children.find(key) == std::cend(_children));
-        _childrenValues.emplace(key, ValuesType{});
+        assert(findEntry(_children, key) == std::cend(_children));
+        getOrCreateEntry(_childrenValues, key);
     }
 
     void Response::Node::addArrayValue(Key key, std::string_view value)
     {
         assert(!_value);
-        assert(_children.find(key) == std::cend(_children));
-        auto& values{ _childrenValues[key] };
+        assert(findEntry(_children, key) == std::cend(_children));
+        auto& values{ getOrCreateEntry(_childrenValues, key) };
         values.push_back(std::string{ value });
         assert(std::all_of(std::cbegin(values) + 1, std::cend(values), [&](const ValueType& value) {return value.index() == values.front().index();}));
     }
@@ -98,23 +140,27 @@ namespace API::Subsonic
     void Response::Node::addArrayValue(Key key, long long value)
     {
         assert(!_value);
-        auto& values{ _childrenValues[key] };
+        auto& values{ getOrCreateEntry(_childrenValues, key) };
         values.push_back(value);
         assert(std::all_of(std::cbegin(values) + 1, std::cend(values), [&](const ValueType& value) {return value.index() == values.front().index();}));
     }
 
+    void Response::Node::setSerializedFragment(std::shared_ptr<const SerializedFragment> fragment)
+    {
+        _serializedFragment = std::move(fragment);
+    }
+
     Response::Node& Response::Node::createChild(Key key)
     {
         assert(!_value);
-        return _children[key];
+        return getOrCreateEntry(_children, key);
     }
 
     Response::Node& Response::Node::createArrayChild(Key key)
     {
         assert(!_value);
-        assert(_children.find(key) == std::cend(_children));
-        _childrenArrays[key].emplace_back();
-        return _childrenArrays[key].back();
+        assert(findEntry(_children, key) == std::cend(_children));
+        return getOrCreateEntry(_childrenArrays, key).emplace_back();
     }
 
     void Response::Node::setVersionAttribute(ProtocolVersion protocolVersion)
@@ -158,17 +204,17 @@ namespace API::Subsonic
 
     void Response::addNode(Node::Key key, Node&& node)
     {
-        return _root._children["subsonic-response"].addChild(key, std::move(node));
+        return _root.createChild("subsonic-response").addChild(key, std::move(node));
     }
 
     Response::Node& Response::createNode(Node::Key key)
     {
-        return _root._children["subsonic-response"].createChild(key);
+        return _root.createChild("subsonic-response").createChild(key);
     }
 
     Response::Node& Response::createArrayNode(Node::Key key)
     {
-        return _root._children["subsonic-response"].createArrayChild(key);
+        return _root.createChild("subsonic-response").createArrayChild(key);
     }
 
     void Response::write(std::ostream& os, ResponseFormat format) const
@@ -184,64 +230,120 @@ namespace API::Subsonic
         }
     }
 
-    void Response::writeXML(std::ostream& os) const
+    Response::Node::SerializedFragment Response::serializeFragment(const Node& node)
     {
-        std::function<boost::property_tree::ptree(const Node&)> nodeToPropertyTree = [&](const Node& node)
+        assert(!node._value);
+
+        Node::SerializedFragment fragment;
+        {
+            XmlSerializer serializer;
+
+            std::ostringstream oss;
+            serializer.serializeAttributes(oss, node);
+            fragment.xmlAttributes = std::move(oss).str();
+
+            oss.str("");
+            serializer.serializeChildren(oss, node);
+            fragment.xmlChildren = std::move(oss).str();
+        }
+
+        {
+            std::ostringstream oss;
+            bool first{ true };
+            JsonSerializer{}.serializeMembers(oss, node, first);
+            fragment.jsonMembers = std::move(oss).str();
+        }
+
+        return fragment;
+    }
+
+    void Response::XmlSerializer::serializeNode(std::ostream& os, Node::Key key, const Node& node)
+    {
+        os << '<' << key.get();
+        serializeAttributes(os, node);
+
+        if (node._value)
+        {
+            os << '>';
+            serializeValue(os, *node._value);
+        }
+        else
+        {
+            if (node._children.empty() && node._childrenArrays.empty() && node._childrenValues.empty()
+                && (!node._serializedFragment || node._serializedFragment->xmlChildren.empty()))
             {
-                boost::property_tree::ptree res;
+                os << "/>";
+                return;
+            }
 
-                for (const auto& [key, value] : node._attributes)
-                {
-                    if (std::holds_alternative<std::string>(value))
-                        res.put("<xmlattr>." + std::string{ key.get() }, std::get<std::string>(value));
-                    else if (std::holds_alternative<bool>(value))
-                        res.put("<xmlattr>." + std::string{ key.get() }, std::get<bool>(value));
-                    else if (std::holds_alternative<float>(value))
-                        res.put("<xmlattr>." + std::string{ key.get() }, std::get<float>(value));
-                    else if (std::holds_alternative<long long>(value))
-                        res.put("<xmlattr>." + std::string{ key.get() }, std::get<long long>(value));
-                }
+            os << '>';
+            serializeChildren(os, node);
+        }
 
-                auto valueToPropertyTree = [](const Node::ValueType& value)
-                    {
-                        boost::property_tree::ptree res;
-                        std::visit([&](const auto& rawValue)
-                            {
-                                res.put_value(rawValue);
-                            }, value);
+        os << "</" << key.get() << '>';
+    }
 
-                        return res;
-                    };
+    void Response::XmlSerializer::serializeAttributes(std::ostream& os, const Node& node)
+    {
+        if (node._serializedFragment)
+            os << node._serializedFragment->xmlAttributes;
 
-                if (node._value)
-                {
-                    res = valueToPropertyTree(*node._value);
-                }
-                else
-                {
-                    for (const auto& [key, childNode] : node._children)
-                    {
-                        res.add_child(std::string{ key.get() }, nodeToPropertyTree(childNode));
-                    }
-
-                    for (const auto& [key, childArrayNodes] : node._childrenArrays)
-                    {
-                        for (const Node& childNode : childArrayNodes)
-                            res.add_child(std::string{ key.get() }, nodeToPropertyTree(childNode));
-                    }
-
-                    for (const auto& [key, childArrayValues] : node._childrenValues)
-                    {
-                        for (const Response::Node::ValueType& value : childArrayValues)
-                            res.add_child(std::string{ key.get() }, valueToPropertyTree(value));
-                    }
-                }
+        for (const auto& [attributeKey, value] : node._attributes)
+        {
+            os << ' ' << attributeKey.get() << "=\"";
+            serializeValue(os, value);
+            os << '"';
+        }
+    }
+
+    void Response::XmlSerializer::serializeChildren(std::ostream& os, const Node& node)
+    {
+        if (node._serializedFragment)
+            os << node._serializedFragment->xmlChildren;
 
-                return res;
-            };
+        for (const auto& [childKey, childNode] : node._children)
+            serializeNode(os, childKey, childNode);
+
+        for (const auto& [childKey, childArrayNodes] : node._childrenArrays)
+        {
+            for (const Node& childNode : childArrayNodes)
+                serializeNode(os, childKey, childNode);
+        }
 
-        boost::property_tree::ptree root{ nodeToPropertyTree(_root) };
-        boost::property_tree::write_xml(os, root);
+        for (const auto& [childKey, childArrayValues] : node._childrenValues)
+        {
+            for (const Node::ValueType& value : childArrayValues)
+            {
+                os << '<' << childKey.get() << '>';
+                serializeValue(os, value);
+                os << "</" << childKey.get() << '>';
+            }
+        }
+    }
+
+    void Response::XmlSerializer::serializeValue(std::ostream& os, const Node::ValueType& value)
+    {
+        if (std::holds_alternative<std::string>(value))
+            StringUtils::writeXmlEscapedString(os, std::get<std::string>(value));
+        else if (std::holds_alternative<std::string_view>(value))
+            StringUtils::writeXmlEscapedString(os, std::get<std::string_view>(value));
+        else if (std::holds_alternative<bool>(value))
+            os << (std::get<bool>(value) ? "true" : "false");
+        else if (std::holds_alternative<float>(value))
+            writeNumber(os, std::get<float>(value));
+        else if (std::holds_alternative<long long>(value))
+            writeNumber(os, std::get<long long>(value));
+        else
+            assert(false);
+    }
+
+    void Response::writeXML(std::ostream& os) const
+    {
+        os << "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n";
+
+        XmlSerializer serializer;
+        for (const auto& [key, node] : _root._children)
+            serializer.serializeNode(os, key, node);
     }
 
     void Response::JsonSerializer::serializeNode(std::ostream& os, const Response::Node& node)
@@ -249,6 +351,21 @@ namespace API::Subsonic
         os << '{';
 
         bool first{ true };
+        serializeMembers(os, node, first);
+
+        os << '}';
+    }
+
+    void Response::JsonSerializer::serializeMembers(std::ostream& os, const Response::Node& node, bool& first)
+    {
+        if (node._serializedFragment && !node._serializedFragment->jsonMembers.empty())
+        {
+            if (!first)
+                os << ',';
+
+            os << node._serializedFragment->jsonMembers;
+            first = false;
+        }
 
         for (const auto& [key, value] : node._attributes)
         {
@@ -331,8 +448,6 @@ namespace API::Subsonic
                 first = false;
             }
         }
-
-        os << '}';
     }
 
     void Response::JsonSerializer::serializeValue(std::ostream& os, const Node::ValueType& value)
@@ -341,6 +456,10 @@ namespace API::Subsonic
         {
             serializeEscapedString(os, std::get<std::string>(value));
         }
+        else if (std::holds_alternative<std::string_view>(value))
+        {
+            serializeEscapedString(os, std::get<std::string_view>(value));
+        }
         else if (std::holds_alternative<bool>(value))
         {
             os << (std::get<bool>(value) ? "true" : "false");
@@ -351,11 +470,11 @@ namespace API::Subsonic
             if (std::isnan(d) || std::fabs(d) == std::numeric_limits<float>::infinity())
                 os << "null";
             else
-                os << d;
+                writeNumber(os, d);
         }
         else if (std::holds_alternative<long long>(value))
         {
-            os << std::get<long long>(value);
+            writeNumber(os, std::get<long long>(value));
         }
         else
         {
@@ -363,6 +482,137 @@ namespace API::Subsonic
         }
     }
 
+    Response::StreamWriter::StreamWriter(ResponseFormat format, Response&& response, Node::Key key, Node&& node)
+        : _format{ format }
+        , _response{ std::move(response) }
+        , _key{ key }
+        , _node{ std::move(node) }
+    {
+    }
+
+    void Response::StreamWriter::writeBegin(std::ostream& os)
+    {
+        const auto& [responseKey, responseNode] { _response._root._children.front() };
+
+        switch (_format)
+        {
+        case ResponseFormat::xml:
+            os << "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n";
+            os << '<' << responseKey.get();
+            writeXmlAttributes(os, responseNode);
+            os << "><" << _key.get();
+            writeXmlAttributes(os, _node);
+            os << '>';
+            break;
+
+        case ResponseFormat::json:
+        {
+            JsonSerializer serializer;
+
+            os << '{';
+            serializer.serializeEscapedString(os, responseKey.get());
+            os << ":{";
+            bool first{ true };
+            writeJsonAttributes(os, responseNode, first);
+            if (!first)
+                os << ',';
+            serializer.serializeEscapedString(os, _key.get());
+            os << ":{";
+            writeJsonAttributes(os, _node, _firstChild);
+            break;
+        }
+        }
+    }
+
+    void Response::StreamWriter::writeArrayBegin(std::ostream& os, Node::Key key)
+    {
+        assert(!_arrayKey);
+        _arrayKey.emplace(key);
+        _firstArrayEntry = true;
+
+        if (_format == ResponseFormat::json)
+        {
+            if (!_firstChild)
+                os << ',';
+            JsonSerializer{}.serializeEscapedString(os, key.get());
+            os << ":[";
+            _firstChild = false;
+        }
+    }
+
+    void Response::StreamWriter::writeArrayEntry(std::ostream& os, const Node& node)
+    {
+        assert(_arrayKey);
+
+        switch (_format)
+        {
+        case ResponseFormat::xml:
+            XmlSerializer{}.serializeNode(os, *_arrayKey, node);
+            break;
+
+        case ResponseFormat::json:
+            if (!_firstArrayEntry)
+                os << ',';
+            JsonSerializer{}.serializeNode(os, node);
+            break;
+        }
+
+        _firstArrayEntry = false;
+    }
+
+    void Response::StreamWriter::writeArrayEnd(std::ostream& os)
+    {
+        assert(_arrayKey);
+        _arrayKey.reset();
+
+        if (_format == ResponseFormat::json)
+            os << ']';
+    }
+
+    void Response::StreamWriter::writeEnd(std::ostream& os)
+    {
+        assert(!_arrayKey);
+        const auto& [responseKey, responseNode] { _response._root._children.front() };
+
+        switch (_format)
+        {
+        case ResponseFormat::xml:
+            os << "</" << _key.get() << "></" << responseKey.get() << '>';
+            break;
+
+        case ResponseFormat::json:
+            os << "}}}";
+            break;
+        }
+    }
+
+    void Response::StreamWriter::writeJsonAttributes(std::ostream& os, const Node& node, bool& first)
+    {
+        JsonSerializer serializer;
+        for (const auto& [key, value] : node._attributes)
+        {
+            if (!first)
+                os << ',';
+
+            serializer.serializeEscapedString(os, key.get());
+            os << ':';
+            serializer.serializeValue(os, value);
+
+            first = false;
+        }
+    }
+
+    void Response::StreamWriter::writeXmlAttributes(std::ostream& os, const Node& node)
+    {
+        XmlSerializer serializer;
+        for (const auto& [key, value] : node._attributes)
+        {
+            os << ' ' << key.get() << "=\"";
+            serializer.serializeValue(os, value);
+            os << '"';
+        }
+    }
+
     void Response::JsonSerializer::serializeEscapedString(std::ostream& os, std::string_view str)
     {
         os << '\"';
@@ -18,8 +18,10 @@
  */
 #pragma once
 
-#include <map>
+#include <list>
+#include <memory>
 #include <optional>
+#include <ostream>
 #include <string>
 #include <string_view>
 #include <variant>
@@ -151,6 +153,11 @@ namespace API::Subsonic
         std::string getMessage() const override { return "Not implemented"; }
     };
 
+    class RequestTimeoutGenericError : public GenericError
+    {
+        std::string getMessage() const override { return "Request took too long to process"; }
+    };
+
     class UnknownEntryPointGenericError : public GenericError
     {
         std::string getMessage() const override { return "Unknown API method"; }
@@ -212,7 +219,7 @@ namespace API::Subsonic
                 constexpr Key(const char (&str)[N]) : _str{ str } {}
                 constexpr std::string_view get() const { return _str; }
 
-                bool constexpr operator<(const Key& other) const { return _str < other._str; }
+                bool constexpr operator==(const Key& other) const { return _str == other._str; }
 
             private:
                 const std::string_view _str;
@@ -220,15 +227,19 @@ namespace API::Subsonic
 
             void setAttribute(Key key, std::string_view value);
 
+            // String literals are not copied, as they outlive the serialization of the node
+            template<std::size_t N>
+            void setAttribute(Key key, const char (&value)[N]) { setAttributeValue(key, std::string_view{ value, N - 1 }); }
+
             template <typename T, std::enable_if_t<std::is_arithmetic<T>::value>* = nullptr>
             void setAttribute(Key key, T value)
             {
                 if constexpr (std::is_same<bool, T>::value)
-                    _attributes[key] = value;
+                    setAttributeValue(key, value);
                 else if constexpr (std::is_floating_point<T>::value)
-                    _attributes[key] = static_cast<float>(value);
+                    setAttributeValue(key, static_cast<float>(value));
                 else if constexpr (std::is_integral<T>::value)
-                    _attributes[key] = static_cast<long long>(value);
+                    setAttributeValue(key, static_cast<long long>(value));
                 else
                     static_assert("Unhandled type");
             }
@@ -246,18 +257,36 @@ namespace API::Subsonic
             void addArrayValue(Key key, std::string_view value);
             void addArrayValue(Key key, long long value);
 
+            // Attributes and children already serialized in both formats (see Response::serializeFragment)
+            // They are written before the other attributes and children of the node, and must not use the same keys
+            struct SerializedFragment
+            {
+                std::string xmlAttributes;
+                std::string xmlChildren;
+                std::string jsonMembers;
+            };
+            void setSerializedFragment(std::shared_ptr<const SerializedFragment> fragment);
+
         private:
             void setVersionAttribute(ProtocolVersion version);
 
             friend class Response;
-            using ValueType = std::variant<std::string, bool, float, long long>;
-            std::map<Key, ValueType> _attributes;
+            using ValueType = std::variant<std::string, std::string_view, bool, float, long long>; // string_view values are borrowed
+            void setAttributeValue(Key key, ValueType&& value);
+
+            // Nodes only have a few distinct keys: flat vectors, kept in insertion order, are cheaper than maps
+            template <typename T>
+            using KeyedEntries = std::vector<std::pair<Key, T>>;
+
+            KeyedEntries<ValueType> _attributes;
             std::optional<ValueType> _value;
-            std::map<Key, Node> _children;
-            std::map<Key, std::vector<Node>> _childrenArrays;
+            std::list<std::pair<Key, Node>> _children; // stable references, as returned by createChild
+            KeyedEntries<std::vector<Node>> _childrenArrays;
 
             using ValuesType = std::vector<ValueType>;
-            std::map<Key, ValuesType> _childrenValues;
+            KeyedEntries<ValuesType> _childrenValues;
+
+            std::shared_ptr<const SerializedFragment> _serializedFragment;
         };
 
         static Response createOkResponse(ProtocolVersion protocolVersion);
@@ -275,17 +304,34 @@ namespace API::Subsonic
 
         void write(std::ostream& os, ResponseFormat format) const;
 
+        // The node must not have any value
+        static Node::SerializedFragment serializeFragment(const Node& node);
+
+        // Incremental serialization, for responses too large to be built at once
+        class StreamWriter;
+
     private:
         static Response createResponseCommon(ProtocolVersion protocolVersion, const Error* error = nullptr);
 
+        // Serializers write directly to the output stream, without any intermediate representation
         class JsonSerializer
         {
             public:
             void serializeNode(std::ostream& os, const Node& node);
+            void serializeMembers(std::ostream& os, const Node& node, bool& first);
             void serializeValue(std::ostream& os, const Node::ValueType& node);
             void serializeEscapedString(std::ostream&, std::string_view str);
         };
 
+        class XmlSerializer
+        {
+            public:
+            void serializeNode(std::ostream& os, Node::Key key, const Node& node);
+            void serializeAttributes(std::ostream& os, const Node& node);
+            void serializeChildren(std::ostream& os, const Node& node);
+            void serializeValue(std::ostream& os, const Node::ValueType& value);
+        };
+
         void writeJSON(std::ostream& os) const;
         void writeXML(std::ostream& os) const;
 
@@ -293,5 +339,30 @@ namespace API::Subsonic
         Node _root;
     };
 
+    // The response is made of a single node: its attributes are written first, then its arrays of children, one after the other
+    class Response::StreamWriter
+    {
+    public:
+        StreamWriter(ResponseFormat format, Response&& response, Node::Key key, Node&& node); // node children are ignored
+
+        void writeBegin(std::ostream& os);
+        void writeArrayBegin(std::ostream& os, Node::Key key);
+        void writeArrayEntry(std::ostream& os, const Node& node);
+        void writeArrayEnd(std::ostream& os);
+        void writeEnd(std::ostream& os);
+
+    private:
+        void writeJsonAttributes(std::ostream& os, const Node& node, bool& first);
+        void writeXmlAttributes(std::ostream& os, const Node& node);
+
+        const ResponseFormat _format;
+        const Response _response;
+        const Node::Key _key;
+        const Node _node;
+        std::optional<Node::Key> _arrayKey;
+        bool _firstChild{ true };
+        bool _firstArrayEntry{ true };
+    };
+
 } // namespace
 
@@ -20,7 +20,9 @@
 #include "AlbumSongLists.hpp"
 
 #include "database/Artist.hpp"
-#include "database/Cluster.hpp"
+#include "database/CatalogueSnapshot.hpp"
+#include "database/Db.hpp"
+#include "database/Facet.hpp"
 #include "database/Release.hpp"
 #include "database/Session.hpp"
 #include "database/Track.hpp"
@@ -40,6 +42,18 @@ namespace API::Subsonic
 
     namespace
     {
+        // The catalogue snapshot answers the most common requests without touching the database
+        RangeResults<ReleaseId> findReleaseIds(RequestContext& context, const Release::FindParameters& params)
+        {
+            if (const std::shared_ptr<const CatalogueSnapshot> snapshot{ context.dbSession.getDb().getCatalogueSnapshot() })
+            {
+                if (std::optional<RangeResults<ReleaseId>> releases{ snapshot->findReleaseIds(params) })
+                    return std::move(*releases);
+            }
+
+            return Release::findIds(context.dbSession, params);
+        }
+
         Response handleGetAlbumListRequestCommon(RequestContext& context, bool id3)
         {
             // Mandatory params
@@ -71,7 +85,7 @@ namespace API::Subsonic
                 params.setRange(range);
                 params.setMediaLibrary(mediaLibraryId);
 
-                releases = Release::findIds(context.dbSession, params);
+                releases = findReleaseIds(context, params);
             }
             else if (type == "alphabeticalByArtist")
             {
@@ -87,19 +101,7 @@ namespace API::Subsonic
                 // Mandatory param
                 const std::string genre{ getMandatoryParameterAs<std::string>(context.parameters, "genre") };
 
-                if (const ClusterType::pointer clusterType{ ClusterType::find(context.dbSession, "GENRE") })
-                {
-                    if (const Cluster::pointer cluster{ clusterType->getCluster(genre) })
-                    {
-                        Release::FindParameters params;
-                        params.setClusters({ cluster->getId() });
-                        params.setSortMethod(ReleaseSortMethod::Name);
-                        params.setRange(range);
-                        params.setMediaLibrary(mediaLibraryId);
-
-                        releases = Release::findIds(context.dbSession, params);
-                    }
-                }
+                releases = Facet::findReleaseIds(context.dbSession, FacetType::Genre, genre, mediaLibraryId, range);
             }
             else if (type == "byYear")
             {
@@ -171,7 +173,11 @@ namespace API::Subsonic
 
             for (const ReleaseId releaseId : releases.results)
             {
+                // may have been removed since the catalogue snapshot has been built
                 const Release::pointer release{ Release::find(context.dbSession, releaseId) };
+                if (!release)
+                    continue;
+
                 albumListNode.addArrayChild("album", createAlbumNode(context, release, user, id3));
             }
 
@@ -215,12 +221,17 @@ namespace API::Subsonic
                     starredNode.addArrayChild("album", createAlbumNode(context, release, user, id3));
             }
 
+            std::vector<Track::pointer> tracks;
             for (const TrackId trackId : feedbackService.findStarredTracks(findParameters).results)
             {
                 if (auto track{ Track::find(context.dbSession, trackId) })
-                    starredNode.addArrayChild("song", createSongNode(context, track, user));
+                    tracks.push_back(track);
             }
 
+            const SongNodeBatch batch{ context, tracks, user };
+            for (const Track::pointer& track : tracks)
+                starredNode.addArrayChild("song", createSongNode(context, track, user, batch));
+
             return response;
         }
     } // namespace
@@ -257,10 +268,10 @@ namespace API::Subsonic
         params.setRange(Range{ 0, size });
         params.setMediaLibrary(mediaLibraryId);
 
-        Track::find(context.dbSession, params, [&](const Track::pointer& track)
-            {
-                randomSongsNode.addArrayChild("song", createSongNode(context, track, user));
-            });
+        const auto tracks{ Track::find(context.dbSession, params) };
+        const SongNodeBatch batch{ context, tracks.results, user };
+        for (const Track::pointer& track : tracks.results)
+            randomSongsNode.addArrayChild("song", createSongNode(context, track, user, batch));
 
         return response;
     }
@@ -280,14 +291,6 @@ namespace API::Subsonic
 
         auto transaction{ context.dbSession.createReadTransaction() };
 
-        auto clusterType{ ClusterType::find(context.dbSession, "GENRE") };
-        if (!clusterType)
-            throw RequestedDataNotFoundError{};
-
-        auto cluster{ clusterType->getCluster(genre) };
-        if (!cluster)
-            throw RequestedDataNotFoundError{};
-
         User::pointer user{ User::find(context.dbSession, context.userId) };
         if (!user)
             throw UserNotAuthorizedError{};
@@ -295,15 +298,11 @@ namespace API::Subsonic
         Response response{ Response::createOkResponse(context.serverProtocolVersion) };
         Response::Node& songsByGenreNode{ response.createNode("songsByGenre") };
 
-        Track::FindParameters params;
-        params.setClusters({ cluster->getId() });
-        params.setRange(Range{ offset, count });
-        params.setMediaLibrary(mediaLibrary);
-
-        Track::find(context.dbSession, params, [&](const Track::pointer& track)
-            {
-                songsByGenreNode.addArrayChild("song", createSongNode(context, track, user));
-            });
+        const RangeResults<TrackId> trackIds{ Facet::findTrackIds(context.dbSession, FacetType::Genre, genre, mediaLibrary, Range{ offset, count }) };
+        const std::vector<Track::pointer> tracks{ Track::find(context.dbSession, trackIds.results) };
+        const SongNodeBatch batch{ context, tracks, user };
+        for (const Track::pointer& track : tracks)
+            songsByGenreNode.addArrayChild("song", createSongNode(context, track, user, batch));
 
         return response;
     }
@@ -20,7 +20,7 @@
 #include "Browsing.hpp"
 
 #include "database/Artist.hpp"
-#include "database/Cluster.hpp"
+#include "database/Facet.hpp"
 #include "database/MediaLibrary.hpp"
 #include "database/Session.hpp"
 #include "database/Release.hpp"
@@ -36,6 +36,7 @@
 #include "responses/Genre.hpp"
 #include "responses/Song.hpp"
 #include "ParameterParsing.hpp"
+#include "ArtistIndexCache.hpp"
 #include "SubsonicId.hpp"
 #include "Utils.hpp"
 
@@ -44,7 +45,6 @@ namespace API::Subsonic
     using namespace Database;
 
     static const std::string_view	reportedDummyDate{ "2000-01-01T00:00:00" };
-    static const unsigned long long	reportedDummyDateULong{ 946684800000ULL }; // 2000-01-01T00:00:00 UTC
 
     namespace
     {
@@ -96,80 +96,34 @@ namespace API::Subsonic
             // Optional params
             const MediaLibraryId mediaLibrary{ getParameterAs<MediaLibraryId>(context.parameters, "musicFolderId").value_or(MediaLibraryId{}) };
 
+            const std::optional<User::Settings> userSettings{ User::getSettings(context.dbSession, context.userId) };
+            if (!userSettings)
+                throw UserNotAuthorizedError{};
+
+            const SubsonicArtistListMode listMode{ userSettings->subsonicArtistListMode };
+
+            const std::shared_ptr<const ArtistIndexCache::Index> index{ context.artistIndexCache.getIndex(mediaLibrary, listMode) };
+
             Response response{ Response::createOkResponse(context.serverProtocolVersion) };
 
             Response::Node& artistsNode{ response.createNode(id3 ? "artists" : "indexes") };
             artistsNode.setAttribute("ignoredArticles", "");
-            artistsNode.setAttribute("lastModified", reportedDummyDateULong); // TODO report last file write?
+            artistsNode.setAttribute("lastModified", static_cast<unsigned long long>(index->buildDateTime.toTime_t()) * 1000);
 
-            Artist::FindParameters parameters;
+            // Use short lived transactions, one per index entry
+            for (const auto& [indexLetter, artistIds] : index->artistsByIndexLetter)
             {
+                Response::Node& indexNode{ artistsNode.createArrayChild("index") };
+                indexNode.setAttribute("name", indexLetter);
+
                 auto transaction{ context.dbSession.createReadTransaction() };
 
                 User::pointer user{ User::find(context.dbSession, context.userId) };
                 if (!user)
                     throw UserNotAuthorizedError{};
 
-                parameters.setSortMethod(ArtistSortMethod::BySortName);
-                switch (user->getSubsonicArtistListMode())
-                {
-                case SubsonicArtistListMode::AllArtists:
-                    break;
-                case SubsonicArtistListMode::ReleaseArtists:
-                    parameters.setLinkType(TrackArtistLinkType::ReleaseArtist);
-                    break;
-                case SubsonicArtistListMode::TrackArtists:
-                    parameters.setLinkType(TrackArtistLinkType::Artist);
-                    break;
-                }
-            }
-            parameters.setMediaLibrary(mediaLibrary);
-
-            // This endpoint does not scale: make sort lived transactions in order not to block the whole application
-
-            // first pass: dispatch the artists by first letter
-            LMS_LOG(API_SUBSONIC, DEBUG, "GetArtists: fetching all artists...");
-            std::map<char, std::vector<ArtistId>> artistsSortedByFirstChar;
-            std::size_t currentArtistOffset{ 0 };
-            constexpr std::size_t batchSize{ 100 };
-            bool hasMoreArtists{ true };
-            while (hasMoreArtists)
-            {
-                auto transaction{ context.dbSession.createReadTransaction() };
-
-                parameters.setRange(Range{ currentArtistOffset, batchSize });
-                const auto artists{ Artist::find(context.dbSession, parameters) };
-                for (const Artist::pointer& artist : artists.results)
-                {
-                    std::string_view sortName{ artist->getSortName() };
-
-                    char sortChar;
-                    if (sortName.empty() || !std::isalpha(sortName[0]))
-                        sortChar = '?';
-                    else
-                        sortChar = std::toupper(sortName[0]);
-
-                    artistsSortedByFirstChar[sortChar].push_back(artist->getId());
-                }
-
-                hasMoreArtists = artists.moreResults;
-                currentArtistOffset += artists.results.size();
-            }
-
-            // second pass: add each artist
-            LMS_LOG(API_SUBSONIC, DEBUG, "GetArtists: constructing response...");
-            for (const auto& [sortChar, artistIds] : artistsSortedByFirstChar)
-            {
-                Response::Node& indexNode{ artistsNode.createArrayChild("index") };
-                indexNode.setAttribute("name", std::string{ sortChar });
-
                 for (const ArtistId artistId : artistIds)
                 {
-                    auto transaction{ context.dbSession.createReadTransaction() };
-                    User::pointer user{ User::find(context.dbSession, context.userId) };
-                    if (!user)
-                        throw UserNotAuthorizedError{};
-
                     if (const Artist::pointer artist{ Artist::find(context.dbSession, artistId) })
                         indexNode.addArrayChild("artist", createArtistNode(context, artist, user, id3));
                 }
@@ -272,12 +226,18 @@ namespace API::Subsonic
 
             Response response{ Response::createOkResponse(context.serverProtocolVersion) };
             Response::Node& similarSongsNode{ response.createNode(id3 ? Response::Node::Key{ "similarSongs2" } : Response::Node::Key{ "similarSongs" }) };
+
+            std::vector<Track::pointer> trackPointers;
             for (const TrackId trackId : tracks)
             {
-                const Track::pointer track{ Track::find(context.dbSession, trackId) };
-                similarSongsNode.addArrayChild("song", createSongNode(context, track, user));
+                if (Track::pointer track{ Track::find(context.dbSession, trackId) })
+                    trackPointers.push_back(track);
             }
 
+            const SongNodeBatch batch{ context, trackPointers, user };
+            for (const Track::pointer& track : trackPointers)
+                similarSongsNode.addArrayChild("song", createSongNode(context, track, user, batch));
+
             return response;
         }
 
@@ -360,10 +320,10 @@ namespace API::Subsonic
 
             directoryNode.setAttribute("name", Utils::makeNameFilesystemCompatible(release->getName()));
 
-            Track::find(context.dbSession, Track::FindParameters{}.setRelease(*releaseId).setSortMethod(TrackSortMethod::Release), [&](const Track::pointer& track)
-                {
-                    directoryNode.addArrayChild("child", createSongNode(context, track, user));
-                });
+            const auto tracks{ Track::find(context.dbSession, Track::FindParameters{}.setRelease(*releaseId).setSortMethod(TrackSortMethod::Release)) };
+            const SongNodeBatch batch{ context, tracks.results, user };
+            for (const Track::pointer& track : tracks.results)
+                directoryNode.addArrayChild("child", createSongNode(context, track, user, batch));
         }
         else
             throw BadParameterGenericError{ "id" };
@@ -379,14 +339,10 @@ namespace API::Subsonic
 
         auto transaction{ context.dbSession.createReadTransaction() };
 
-        const ClusterType::pointer clusterType{ ClusterType::find(context.dbSession, "GENRE") };
-        if (clusterType)
-        {
-            const auto clusters{ clusterType->getClusters() };
-
-            for (const Cluster::pointer& cluster : clusters)
-                genresNode.addArrayChild("genre", createGenreNode(cluster));
-        }
+        Facet::visitAll(context.dbSession, FacetType::Genre, [&](const Facet::Entry& genre)
+            {
+                genresNode.addArrayChild("genre", createGenreNode(genre));
+            });
 
         return response;
     }
@@ -442,8 +398,9 @@ namespace API::Subsonic
         Response::Node albumNode{ createAlbumNode(context, release, user, true /* id3 */) };
 
         const auto tracks{ Track::find(context.dbSession, Track::FindParameters {}.setRelease(id).setSortMethod(TrackSortMethod::Release)) };
+        const SongNodeBatch batch{ context, tracks.results, user };
         for (const Track::pointer& track : tracks.results)
-            albumNode.addArrayChild("song", createSongNode(context, track, user));
+            albumNode.addArrayChild("song", createSongNode(context, track, user, batch));
 
         response.addNode("album", std::move(albumNode));
 
@@ -518,12 +475,17 @@ namespace API::Subsonic
         params.setArtist(artists.front()->getId());
 
         const auto trackIds{ Service<Scrobbling::IScrobblingService>::get()->getTopTracks(params) };
+        std::vector<Track::pointer> tracks;
         for (const TrackId trackId : trackIds.results)
         {
             if (Track::pointer track{ Track::find(context.dbSession, trackId) })
-                topSongs.addArrayChild("song", createSongNode(context, track, user));
+                tracks.push_back(track);
         }
 
+        const SongNodeBatch batch{ context, tracks, user };
+        for (const Track::pointer& track : tracks)
+            topSongs.addArrayChild("song", createSongNode(context, track, user, batch));
+
         return response;
     }
 }
@@ -0,0 +1,239 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "LibraryChanges.hpp"
+
+#include <algorithm>
+#include <array>
+#include <memory>
+
+#include <Wt/Http/ResponseContinuation.h>
+
+#include "database/Artist.hpp"
+#include "database/CatalogueChange.hpp"
+#include "database/Release.hpp"
+#include "database/Session.hpp"
+#include "database/Track.hpp"
+#include "database/User.hpp"
+#include "utils/ILogger.hpp"
+#include "responses/Album.hpp"
+#include "responses/Artist.hpp"
+#include "responses/Song.hpp"
+#include "ParameterParsing.hpp"
+#include "SubsonicId.hpp"
+#include "SubsonicResponse.hpp"
+
+namespace API::Subsonic
+{
+    using namespace Database;
+
+    namespace
+    {
+        // entities written at each continuation
+        constexpr std::size_t batchSize{ 100 };
+
+        struct Step
+        {
+            Response::Node::Key key;
+            CatalogueChange::EntityType entityType;
+            bool removed;
+        };
+
+        constexpr std::array steps
+        {
+            Step{ "artist", CatalogueChange::EntityType::Artist, false },
+            Step{ "album", CatalogueChange::EntityType::Release, false },
+            Step{ "song", CatalogueChange::EntityType::Track, false },
+            Step{ "removedArtist", CatalogueChange::EntityType::Artist, true },
+            Step{ "removedAlbum", CatalogueChange::EntityType::Release, true },
+            Step{ "removedSong", CatalogueChange::EntityType::Track, true },
+        };
+
+        // Kept alive between continuations
+        struct SyncState
+        {
+            SyncState(ResponseFormat format, Response&& response, Response::Node&& node, std::int64_t since, std::int64_t upTo, bool fullSync)
+                : writer{ format, std::move(response), "libraryChanges", std::move(node) }
+                , since{ since }
+                , upTo{ upTo }
+                , fullSync{ fullSync }
+            {}
+
+            Response::StreamWriter writer;
+            const std::int64_t since;
+            const std::int64_t upTo;
+            const bool fullSync;
+            std::size_t currentStep{};
+            std::int64_t lastChangeId{}; // in the current step
+            bool begun{};
+        };
+
+        Response::Node createRemovedEntityNode(CatalogueChange::EntityType type, IdType::ValueType entityId)
+        {
+            Response::Node node;
+            switch (type)
+            {
+            case CatalogueChange::EntityType::Artist:
+                node.setAttribute("id", idToString(ArtistId{ entityId }));
+                break;
+            case CatalogueChange::EntityType::Release:
+                node.setAttribute("id", idToString(ReleaseId{ entityId }));
+                break;
+            case CatalogueChange::EntityType::Track:
+                node.setAttribute("id", idToString(TrackId{ entityId }));
+                break;
+            }
+
+            return node;
+        }
+
+        // returns the number of processed changes
+        std::size_t writeChanges(RequestContext& context, SyncState& state, std::ostream& os)
+        {
+            const Step& step{ steps[state.currentStep] };
+
+            auto transaction{ context.dbSession.createReadTransaction() };
+
+            const User::pointer user{ User::find(context.dbSession, context.userId) };
+            if (!user)
+                throw UserNotAuthorizedError{};
+
+            const std::vector<CatalogueChange::Entry> changes{ CatalogueChange::find(context.dbSession, step.entityType, step.removed, std::max(state.since, state.lastChangeId), state.upTo, batchSize) };
+            if (changes.empty())
+                return 0;
+
+            state.lastChangeId = changes.back().changeId;
+
+            // entities changed again in the meantime will be reported by the next sync
+            if (step.removed)
+            {
+                for (const CatalogueChange::Entry& change : changes)
+                    state.writer.writeArrayEntry(os, createRemovedEntityNode(step.entityType, change.entityId));
+                return changes.size();
+            }
+
+            switch (step.entityType)
+            {
+            case CatalogueChange::EntityType::Artist:
+                for (const CatalogueChange::Entry& change : changes)
+                {
+                    if (const Artist::pointer artist{ Artist::find(context.dbSession, ArtistId{ change.entityId }) })
+                        state.writer.writeArrayEntry(os, createArtistNode(context, artist, user, true /* id3 */));
+                }
+                break;
+
+            case CatalogueChange::EntityType::Release:
+                for (const CatalogueChange::Entry& change : changes)
+                {
+                    if (const Release::pointer release{ Release::find(context.dbSession, ReleaseId{ change.entityId }) })
+                        state.writer.writeArrayEntry(os, createAlbumNode(context, release, user, true /* id3 */));
+                }
+                break;
+
+            case CatalogueChange::EntityType::Track:
+            {
+                std::vector<Track::pointer> tracks;
+                for (const CatalogueChange::Entry& change : changes)
+                {
+                    if (Track::pointer track{ Track::find(context.dbSession, TrackId{ change.entityId }) })
+                        tracks.push_back(std::move(track));
+                }
+
+                const SongNodeBatch batch{ context, tracks, user };
+                for (const Track::pointer& track : tracks)
+                    state.writer.writeArrayEntry(os, createSongNode(context, track, user, batch));
+                break;
+            }
+            }
+
+            return changes.size();
+        }
+    }
+
+    void handleGetLibraryChanges(RequestContext& context, const Wt::Http::Request& request, Wt::Http::Response& response)
+    {
+        std::shared_ptr<SyncState> state;
+
+        if (Wt::Http::ResponseContinuation* continuation{ context.continuation })
+        {
+            state = Wt::cpp17::any_cast<std::shared_ptr<SyncState>>(continuation->data());
+        }
+        else
+        {
+            const ResponseFormat format{ getParameterAs<std::string>(context.parameters, "f").value_or("xml") == "json" ? ResponseFormat::json : ResponseFormat::xml };
+            std::int64_t since{ getParameterAs<std::int64_t>(context.parameters, "since").value_or(0) };
+
+            std::int64_t upTo;
+            {
+                auto transaction{ context.dbSession.createReadTransaction() };
+                upTo = CatalogueChange::getLastChangeId(context.dbSession);
+            }
+
+            // Unknown change id, the database may have been rebuilt: the client must drop everything
+            const bool fullSync{ since <= 0 || since > upTo };
+            if (fullSync)
+                since = 0;
+
+            Response::Node node;
+            node.setAttribute("since", since);
+            node.setAttribute("nextSince", upTo);
+            node.setAttribute("fullSync", fullSync);
+
+            state = std::make_shared<SyncState>(format, Response::createOkResponse(context.serverProtocolVersion), std::move(node), since, upTo, fullSync);
+            response.setMimeType(std::string{ ResponseFormatToMimeType(format) });
+
+            LMS_LOG(API_SUBSONIC, DEBUG, "Library changes requested since " << since << " up to " << upTo);
+        }
+
+        std::ostream& os{ response.out() };
+        if (!state->begun)
+        {
+            state->writer.writeBegin(os);
+            state->writer.writeArrayBegin(os, steps[state->currentStep].key);
+            state->begun = true;
+        }
+
+        // Write one batch of changes per call, moving to the next steps if needed
+        while (state->currentStep < steps.size())
+        {
+            if (writeChanges(context, *state, os) > 0)
+                break;
+
+            state->writer.writeArrayEnd(os);
+            state->currentStep++;
+            state->lastChangeId = 0;
+
+            // no need to report removals when everything is sent
+            if (state->fullSync && state->currentStep < steps.size() && steps[state->currentStep].removed)
+                state->currentStep = steps.size();
+
+            if (state->currentStep < steps.size())
+                state->writer.writeArrayBegin(os, steps[state->currentStep].key);
+        }
+
+        if (state->currentStep == steps.size())
+        {
+            state->writer.writeEnd(os);
+            return;
+        }
+
+        Wt::Http::ResponseContinuation* continuation{ response.createContinuation() };
+        continuation->setData(state);
+    }
+}
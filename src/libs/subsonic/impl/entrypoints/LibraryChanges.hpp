@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2022 Emeric Poupon
+ * Copyright (C) 2024 Emeric Poupon
  *
  * This file is part of LMS.
  *
@@ -17,17 +17,15 @@
  * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include "DuplicateTracks.hpp"
+#pragma once
 
-#include <algorithm>
+#include <Wt/Http/Request.h>
+#include <Wt/Http/Response.h>
 
-namespace Recommendation::PlaylistGeneratorConstraint
-{
-	float
-	DuplicateTracks::computeScore(const std::vector<Database::TrackId>& trackIds, std::size_t trackIndex)
-	{
-		const auto count {std::count(std::cbegin(trackIds), std::cend(trackIds), trackIds[trackIndex])};
-		return count == 1 ? 0 : 1000;
-	}
-} // namespace Recommendation
+#include "RequestContext.hpp"
 
+namespace API::Subsonic
+{
+    // OpenSubsonic extension: streams the artists, albums and songs changed since a given change id (whole catalogue if not set)
+    void handleGetLibraryChanges(RequestContext& context, const Wt::Http::Request& request, Wt::Http::Response& response);
+}
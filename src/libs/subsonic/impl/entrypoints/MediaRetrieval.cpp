@@ -19,18 +19,25 @@
 
 #include "MediaRetrieval.hpp"
 
+#include <iomanip>
+#include <sstream>
+
 #include "av/IAudioFile.hpp"
 #include "av/RawResourceHandlerCreator.hpp"
 #include "av/TranscodingParameters.hpp"
 #include "av/TranscodingResourceHandlerCreator.hpp"
 #include "av/Types.hpp"
 #include "services/cover/ICoverService.hpp"
+#include "database/Release.hpp"
 #include "database/Session.hpp"
 #include "database/Track.hpp"
+#include "database/TrackList.hpp"
 #include "database/User.hpp"
 #include "utils/IResourceHandler.hpp"
 #include "utils/ILogger.hpp"
 #include "utils/FileResourceHandlerCreator.hpp"
+#include "utils/IZipper.hpp"
+#include "utils/ZipperResourceHandlerCreator.hpp"
 #include "utils/Utils.hpp"
 #include "utils/String.hpp"
 #include "ParameterParsing.hpp"
@@ -74,6 +81,7 @@ namespace API::Subsonic
             switch (outputFormat)
             {
             case Av::Transcoding::OutputFormat::MP3:
+            case Av::Transcoding::OutputFormat::MPEGTS_MP3:
                 return codec == Av::DecodingCodec::MP3;
 
             case Av::Transcoding::OutputFormat::OGG_OPUS:
@@ -95,11 +103,23 @@ namespace API::Subsonic
             bool estimateContentLength{};
         };
 
-        bool isOutputFormatCompatible(const std::filesystem::path& trackPath, Av::Transcoding::OutputFormat outputFormat)
+        // Codec as stored at scan time, std::nullopt if the track was scanned before it was stored
+        std::optional<Av::DecodingCodec> getTrackCodec(const Track::pointer& track)
+        {
+            if (track->getCodec().empty())
+                return std::nullopt;
+
+            return Av::getDecodingCodec(track->getCodec());
+        }
+
+        bool isOutputFormatCompatible(const Track::pointer& track, Av::Transcoding::OutputFormat outputFormat)
         {
+            if (const std::optional<Av::DecodingCodec> codec{ getTrackCodec(track) })
+                return isCodecCompatibleWithOutputFormat(*codec, outputFormat);
+
             try
             {
-                const auto audioFile{ Av::parseAudioFile(trackPath) };
+                const auto audioFile{ Av::parseAudioFile(track->getPath()) };
 
                 const auto streamInfo{ audioFile->getBestStreamInfo() };
                 if (!streamInfo)
@@ -127,18 +147,20 @@ namespace API::Subsonic
 
             StreamParameters parameters;
 
-            auto transaction{ context.dbSession.createReadTransaction() };
-
-            const User::pointer user{ User::find(context.dbSession, context.userId) };
-            if (!user)
+            const std::optional<User::Settings> userSettings{ User::getSettings(context.dbSession, context.userId) };
+            if (!userSettings)
                 throw UserNotAuthorizedError{};
 
+            auto transaction{ context.dbSession.createReadTransaction() };
+
             const auto track{ Track::find(context.dbSession, id) };
             if (!track)
                 throw RequestedDataNotFoundError{};
 
             parameters.inputParameters.trackPath = track->getPath();
             parameters.inputParameters.duration = track->getDuration();
+            parameters.inputParameters.codec = getTrackCodec(track);
+            parameters.inputParameters.bitrate = track->getBitrate();
             parameters.estimateContentLength = estimateContentLength;
 
             if (format == "raw") // raw => no transcoding
@@ -147,8 +169,8 @@ namespace API::Subsonic
             std::optional<Av::Transcoding::OutputFormat> requestedFormat{ subsonicStreamFormatToAvOutputFormat(format) };
             if (!requestedFormat)
             {
-                if (user->getSubsonicEnableTranscodingByDefault())
-                    requestedFormat = userTranscodeFormatToAvFormat(user->getSubsonicDefaultTranscodingOutputFormat());
+                if (userSettings->subsonicEnableTranscodingByDefault)
+                    requestedFormat = userTranscodeFormatToAvFormat(userSettings->subsonicDefaultTranscodingOutputFormat);
             }
 
             if (!requestedFormat && (maxBitRate == 0 || track->getBitrate() <= maxBitRate ))
@@ -161,7 +183,7 @@ namespace API::Subsonic
             //  same codec => apply max bitrate
             //  otherwise => apply default bitrate (because we can't really compare bitrates between formats) + max bitrate)
             std::size_t bitrate{};
-            if (requestedFormat && isOutputFormatCompatible(track->getPath(), *requestedFormat))
+            if (requestedFormat && isOutputFormatCompatible(track, *requestedFormat))
             {
                 if (maxBitRate == 0 || track->getBitrate() <= maxBitRate)
                 {
@@ -172,9 +194,9 @@ namespace API::Subsonic
             }
             
             if (!requestedFormat)
-                requestedFormat = userTranscodeFormatToAvFormat(user->getSubsonicDefaultTranscodingOutputFormat());
+                requestedFormat = userTranscodeFormatToAvFormat(userSettings->subsonicDefaultTranscodingOutputFormat);
             if (!bitrate)
-                bitrate = std::min<std::size_t>(user->getSubsonicDefaultTranscodingOutputBitrate(), maxBitRate);
+                bitrate = std::min<std::size_t>(userSettings->subsonicDefaultTranscodingOutputBitrate, maxBitRate);
 
             Av::Transcoding::OutputParameters& outputParameters{ parameters.outputParameters.emplace() };
 
@@ -182,33 +204,137 @@ namespace API::Subsonic
             outputParameters.offset = std::chrono::seconds{ timeOffset };
             outputParameters.format = *requestedFormat;
             outputParameters.bitrate = bitrate;
+            outputParameters.stream = track->getAudioStreamIndex();
 
             return parameters;
         }
     }
 
-    void handleDownload(RequestContext& context, const Wt::Http::Request& request, Wt::Http::Response& response)
+    namespace
     {
-        std::shared_ptr<IResourceHandler> resourceHandler;
+        std::string sanitizeFileName(std::string_view name)
+        {
+            return StringUtils::replaceInString(StringUtils::replaceInString(name, "/", "_"), "\"", "_");
+        }
 
-        Wt::Http::ResponseContinuation* continuation{ request.continuation() };
-        if (!continuation)
+        std::string getZipEntryName(const Track::pointer& track)
         {
-            // Mandatory params
-            Database::TrackId id{ getMandatoryParameterAs<Database::TrackId>(context.parameters, "id") };
+            std::ostringstream fileName;
+
+            if (const auto discNumber{ track->getDiscNumber() })
+                fileName << *discNumber << ".";
+            if (const auto trackNumber{ track->getTrackNumber() })
+                fileName << std::setw(2) << std::setfill('0') << *trackNumber << " - ";
+
+            fileName << sanitizeFileName(track->getName()) << track->getPath().extension().string();
+
+            return fileName.str();
+        }
+
+        std::shared_ptr<IResourceHandler> createZipResourceHandler(const Zip::EntryContainer& entries)
+        {
+            try
+            {
+                return createZipperResourceHandler(Zip::createZipper(entries));
+            }
+            catch (const Zip::Exception& e)
+            {
+                LMS_LOG(API_SUBSONIC, ERROR, "Cannot create zip archive: " << e.what());
+                throw InternalErrorGenericError{ e.what() };
+            }
+        }
 
-            std::filesystem::path trackPath;
+        std::shared_ptr<IResourceHandler> createReleaseZipResourceHandler(RequestContext& context, ReleaseId releaseId, Wt::Http::Response& response)
+        {
+            Zip::EntryContainer entries;
+            std::string archiveName;
             {
                 auto transaction{ context.dbSession.createReadTransaction() };
 
-                auto track{ Track::find(context.dbSession, id) };
-                if (!track)
+                const Release::pointer release{ Release::find(context.dbSession, releaseId) };
+                if (!release)
                     throw RequestedDataNotFoundError{};
 
-                trackPath = track->getPath();
+                const auto tracks{ Track::find(context.dbSession, Track::FindParameters{}.setRelease(releaseId).setSortMethod(TrackSortMethod::Release)) };
+                for (const Track::pointer& track : tracks.results)
+                    entries.push_back(Zip::Entry{ getZipEntryName(track), track->getPath() });
+
+                archiveName = sanitizeFileName(release->getName()) + ".zip";
             }
 
-            resourceHandler = Av::createRawResourceHandler(trackPath);
+            std::shared_ptr<IResourceHandler> resourceHandler{ createZipResourceHandler(entries) };
+            response.addHeader("Content-Disposition", "attachment; filename=\"" + archiveName + "\"");
+
+            return resourceHandler;
+        }
+
+        std::shared_ptr<IResourceHandler> createTrackListZipResourceHandler(RequestContext& context, TrackListId trackListId, Wt::Http::Response& response)
+        {
+            Zip::EntryContainer entries;
+            std::string archiveName;
+            {
+                auto transaction{ context.dbSession.createReadTransaction() };
+
+                const TrackList::pointer trackList{ TrackList::find(context.dbSession, trackListId) };
+                if (!trackList)
+                    throw RequestedDataNotFoundError{};
+
+                // prefixed by the position, to keep the playlist order
+                std::size_t position{};
+                for (const TrackListEntry::pointer& entry : trackList->getEntries())
+                {
+                    const Track::pointer track{ entry->getTrack() };
+
+                    std::ostringstream fileName;
+                    fileName << std::setw(3) << std::setfill('0') << ++position << " - " << sanitizeFileName(track->getName()) << track->getPath().extension().string();
+                    entries.push_back(Zip::Entry{ fileName.str(), track->getPath() });
+                }
+
+                archiveName = sanitizeFileName(trackList->getName()) + ".zip";
+            }
+
+            std::shared_ptr<IResourceHandler> resourceHandler{ createZipResourceHandler(entries) };
+            response.addHeader("Content-Disposition", "attachment; filename=\"" + archiveName + "\"");
+
+            return resourceHandler;
+        }
+    }
+
+    void handleDownload(RequestContext& context, const Wt::Http::Request& request, Wt::Http::Response& response)
+    {
+        std::shared_ptr<IResourceHandler> resourceHandler;
+
+        Wt::Http::ResponseContinuation* continuation{ context.continuation };
+        if (!continuation)
+        {
+            // Mandatory params: a track, or a release / playlist downloaded as a zip archive
+            if (const std::optional<TrackId> trackId{ getParameterAs<TrackId>(context.parameters, "id") })
+            {
+                std::filesystem::path trackPath;
+                {
+                    auto transaction{ context.dbSession.createReadTransaction() };
+
+                    auto track{ Track::find(context.dbSession, *trackId) };
+                    if (!track)
+                        throw RequestedDataNotFoundError{};
+
+                    trackPath = track->getPath();
+                }
+
+                resourceHandler = Av::createRawResourceHandler(trackPath);
+            }
+            else if (const std::optional<ReleaseId> releaseId{ getParameterAs<ReleaseId>(context.parameters, "id") })
+            {
+                resourceHandler = createReleaseZipResourceHandler(context, *releaseId, response);
+            }
+            else if (const std::optional<TrackListId> trackListId{ getParameterAs<TrackListId>(context.parameters, "id") })
+            {
+                resourceHandler = createTrackListZipResourceHandler(context, *trackListId, response);
+            }
+            else
+            {
+                throw RequiredParameterMissingError{ "id" };
+            }
         }
         else
         {
@@ -226,14 +352,21 @@ namespace API::Subsonic
 
         try
         {
-            Wt::Http::ResponseContinuation* continuation = request.continuation();
+            Wt::Http::ResponseContinuation* continuation = context.continuation;
             if (!continuation)
             {
                 StreamParameters streamParameters{ getStreamParameters(context) };
                 if (streamParameters.outputParameters)
-                    resourceHandler = Av::Transcoding::createResourceHandler(streamParameters.inputParameters, *streamParameters.outputParameters, streamParameters.estimateContentLength);
+                {
+                    Av::Transcoding::SchedulingParameters schedulingParameters;
+                    schedulingParameters.clientId = context.userId.toString();
+                    schedulingParameters.deviceId = context.userId.toString() + "/" + context.clientInfo.name + "/" + request.clientAddress();
+                    resourceHandler = Av::Transcoding::createResourceHandler(streamParameters.inputParameters, *streamParameters.outputParameters, schedulingParameters, streamParameters.estimateContentLength);
+                }
                 else
+                {
                     resourceHandler = Av::createRawResourceHandler(streamParameters.inputParameters.trackPath);
+                }
             }
             else
             {
@@ -250,7 +383,17 @@ namespace API::Subsonic
         }
     }
 
-    void handleGetCoverArt(RequestContext& context, const Wt::Http::Request& /*request*/, Wt::Http::Response& response)
+    namespace
+    {
+        // Shared between the initial request and its continuation
+        struct PendingCover
+        {
+            Image::ImageFormat format{};
+            std::shared_ptr<Image::IEncodedImage> cover;
+        };
+    }
+
+    void handleGetCoverArt(RequestContext& context, const Wt::Http::Request& request, Wt::Http::Response& response)
     {
         // Mandatory params
         const auto trackId{ getParameterAs<TrackId>(context.parameters, "id") };
@@ -263,16 +406,37 @@ namespace API::Subsonic
         std::size_t size{ getParameterAs<std::size_t>(context.parameters, "size").value_or(1024) };
         size = ::Utils::clamp(size, std::size_t{ 32 }, std::size_t{ 2048 });
 
-        std::shared_ptr<Image::IEncodedImage> cover;
-        if (trackId)
-            cover = Service<Cover::ICoverService>::get()->getFromTrack(*trackId, size);
-        else if (releaseId)
-            cover = Service<Cover::ICoverService>::get()->getFromRelease(*releaseId, size);
-        else if (artistId)
-            cover = Service<Cover::ICoverService>::get()->getFromArtist(*artistId, size);
+        Wt::Http::ResponseContinuation* continuation{ context.continuation };
+        if (!continuation)
+        {
+            // Covers are computed by the cover service's own threads, the response is sent in a continuation
+            auto pendingCover{ std::make_shared<PendingCover>() };
+            pendingCover->format = Service<Cover::ICoverService>::get()->getPreferredFormat(request.headerValue("Accept"));
+
+            continuation = response.createContinuation();
+            continuation->setData(pendingCover);
+            continuation->waitForMoreData();
+
+            auto onCover{ [pendingCover, continuation](std::shared_ptr<Image::IEncodedImage> cover)
+            {
+                pendingCover->cover = std::move(cover);
+                continuation->haveMoreData();
+            } };
+
+            if (trackId)
+                Service<Cover::ICoverService>::get()->asyncGetFromTrack(*trackId, size, pendingCover->format, std::move(onCover));
+            else if (releaseId)
+                Service<Cover::ICoverService>::get()->asyncGetFromRelease(*releaseId, size, pendingCover->format, std::move(onCover));
+            else if (artistId)
+                Service<Cover::ICoverService>::get()->asyncGetFromArtist(*artistId, size, pendingCover->format, std::move(onCover));
+
+            return;
+        }
 
+        const auto pendingCover{ Wt::cpp17::any_cast<std::shared_ptr<PendingCover>>(continuation->data()) };
+        std::shared_ptr<Image::IEncodedImage> cover{ pendingCover->cover };
         if (!cover && context.enableDefaultCover && !artistId)
-            cover = Service<Cover::ICoverService>::get()->getDefault(size);
+            cover = Service<Cover::ICoverService>::get()->getDefault(size, pendingCover->format);
 
         if (!cover)
         {
@@ -280,6 +444,7 @@ namespace API::Subsonic
             return;
         }
 
+        response.addHeader("Vary", "Accept");
         response.out().write(reinterpret_cast<const char*>(cover->getData()), cover->getDataSize());
         response.setMimeType(std::string{ cover->getMimeType() });
     }
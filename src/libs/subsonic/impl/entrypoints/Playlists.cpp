@@ -71,9 +71,13 @@ namespace API::Subsonic
         Response response{ Response::createOkResponse(context.serverProtocolVersion) };
         Response::Node playlistNode{ createPlaylistNode(tracklist, context.dbSession) };
 
-        auto entries{ tracklist->getEntries() };
-        for (const TrackListEntry::pointer& entry : entries)
-            playlistNode.addArrayChild("entry", createSongNode(context, entry->getTrack(), user));
+        std::vector<Track::pointer> tracks;
+        for (const TrackListEntry::pointer& entry : tracklist->getEntries())
+            tracks.push_back(entry->getTrack());
+
+        const SongNodeBatch batch{ context, tracks, user };
+        for (const Track::pointer& track : tracks)
+            playlistNode.addArrayChild("entry", createSongNode(context, track, user, batch));
 
         response.addNode("playlist", std::move(playlistNode));
 
@@ -116,21 +120,18 @@ namespace API::Subsonic
             tracklist = context.dbSession.create<TrackList>(*name, TrackListType::Playlist, false, user);
         }
 
-        for (const TrackId trackId : trackIds)
-        {
-            Track::pointer track{ Track::find(context.dbSession, trackId) };
-            if (!track)
-                continue;
-
-            context.dbSession.create<TrackListEntry>(track, tracklist);
-        }
+        tracklist.modify()->appendTracks(trackIds);
 
         Response response{ Response::createOkResponse(context.serverProtocolVersion) };
         Response::Node playlistNode{ createPlaylistNode(tracklist, context.dbSession) };
 
-        auto entries{ tracklist->getEntries() };
-        for (const TrackListEntry::pointer& entry : entries)
-            playlistNode.addArrayChild("entry", createSongNode(context, entry->getTrack(), user));
+        std::vector<Track::pointer> tracks;
+        for (const TrackListEntry::pointer& entry : tracklist->getEntries())
+            tracks.push_back(entry->getTrack());
+
+        const SongNodeBatch batch{ context, tracks, user };
+        for (const Track::pointer& track : tracks)
+            playlistNode.addArrayChild("entry", createSongNode(context, track, user, batch));
 
         response.addNode("playlist", std::move(playlistNode));
 
@@ -169,27 +170,8 @@ namespace API::Subsonic
         if (isPublic)
             tracklist.modify()->setIsPublic(*isPublic);
 
-        {
-            // Remove from end to make indexes stable
-            std::sort(std::begin(trackPositionsToRemove), std::end(trackPositionsToRemove), std::greater<std::size_t>());
-
-            for (std::size_t trackPositionToRemove : trackPositionsToRemove)
-            {
-                auto entry{ tracklist->getEntry(trackPositionToRemove) };
-                if (entry)
-                    entry.remove();
-            }
-        }
-
-        // Add tracks
-        for (const TrackId trackIdToAdd : trackIdsToAdd)
-        {
-            Track::pointer track{ Track::find(context.dbSession, trackIdToAdd) };
-            if (!track)
-                continue;
-
-            context.dbSession.create<TrackListEntry>(track, tracklist);
-        }
+        tracklist.modify()->removeEntries(trackPositionsToRemove);
+        tracklist.modify()->appendTracks(trackIdsToAdd);
 
         return Response::createOkResponse(context.serverProtocolVersion);
     }
@@ -19,23 +19,167 @@
 
 #include "Searching.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <Wt/Dbo/Exception.h>
+
 #include "database/Artist.hpp"
+#include "database/QueryDeadline.hpp"
 #include "database/Release.hpp"
 #include "database/Session.hpp"
 #include "database/Track.hpp"
 #include "database/User.hpp"
+#include "utils/IConfig.hpp"
+#include "utils/ILogger.hpp"
+#include "utils/Service.hpp"
 #include "responses/Album.hpp"
 #include "responses/Artist.hpp"
 #include "responses/Song.hpp"
 #include "ParameterParsing.hpp"
+#include "QueryExecutor.hpp"
+#include "SearchIndex.hpp"
 #include "SubsonicId.hpp"
- 
+
 namespace API::Subsonic
 {
     using namespace Database;
 
     namespace
     {
+        struct SearchResults
+        {
+            std::vector<ArtistId> artists;
+            std::vector<ReleaseId> releases;
+            std::vector<TrackId> tracks;
+        };
+
+        std::chrono::milliseconds getSearchTimeout()
+        {
+            static const std::chrono::milliseconds timeout{ Service<IConfig>::get()->getULong("api-subsonic-search-timeout", 3000) };
+            return timeout;
+        }
+
+        template <typename IdType>
+        std::vector<IdType> getResultsBefore(std::future<RangeResults<IdType>>& results, std::chrono::steady_clock::time_point deadline, std::string_view category)
+        {
+            if (!results.valid())
+                return {};
+
+            if (results.wait_until(deadline) != std::future_status::ready)
+            {
+                LMS_LOG(API_SUBSONIC, WARNING, "Search timeout reached, skipping " << category << " results");
+                return {};
+            }
+
+            try
+            {
+                return std::move(results.get().results);
+            }
+            catch (const Wt::Dbo::Exception& e)
+            {
+                // the query may have just been interrupted by the search deadline
+                if (std::chrono::steady_clock::now() < deadline)
+                    throw;
+
+                LMS_LOG(API_SUBSONIC, WARNING, "Search timeout reached, skipping " << category << " results: " << e.what());
+                return {};
+            }
+        }
+
+        // The ids are moved, no new vector is allocated
+        template <typename IdType>
+        std::vector<IdType> getSubRange(std::vector<IdType>&& ids, Range range)
+        {
+            const std::size_t offset{ std::min(range.offset, ids.size()) };
+            const std::size_t size{ std::min(range.size, ids.size() - offset) };
+
+            ids.erase(std::begin(ids) + offset + size, std::end(ids));
+            ids.erase(std::begin(ids), std::begin(ids) + offset);
+            return std::move(ids);
+        }
+
+        SearchResults searchUsingIndex(SearchIndex& searchIndex, UserId userId, const std::vector<std::string_view>& keywords, Range artistRange, Range albumRange, Range songRange)
+        {
+            SearchIndex::Results results{ searchIndex.search(userId, keywords) };
+
+            return SearchResults{ getSubRange(std::move(results.artists), artistRange), getSubRange(std::move(results.releases), albumRange), getSubRange(std::move(results.tracks), songRange) };
+        }
+
+        SearchResults searchUsingDatabase(QueryExecutor& queryExecutor, const std::vector<std::string_view>& keywords, MediaLibraryId mediaLibrary, Range artistRange, Range albumRange, Range songRange)
+        {
+            // The searches are independent: run them concurrently, each one using its own read connection
+            // Slow categories are truncated once the deadline is reached, rather than making the client time out
+            // The late queries are interrupted, so that they do not keep holding their connections
+            const auto deadline{ std::chrono::steady_clock::now() + getSearchTimeout() };
+            const std::optional<QueryDeadline>& requestQueryDeadline{ ScopedQueryDeadline::getCurrent() };
+            const ScopedQueryDeadline searchQueryDeadline{ requestQueryDeadline ? requestQueryDeadline->narrowedTo(deadline) : QueryDeadline{ deadline } };
+            const std::vector<std::string> ownedKeywords(std::cbegin(keywords), std::cend(keywords));
+
+            std::future<RangeResults<ArtistId>> artistIds;
+            if (artistRange.size > 0)
+            {
+                artistIds = queryExecutor.execute([=](Session& session)
+                    {
+                        const std::vector<std::string_view> queryKeywords(std::cbegin(ownedKeywords), std::cend(ownedKeywords));
+
+                        Artist::FindParameters params;
+                        params.setKeywords(queryKeywords);
+                        params.setRange(artistRange);
+                        params.setMediaLibrary(mediaLibrary);
+
+                        auto transaction{ session.createReadTransaction() };
+                        return Artist::findIds(session, params);
+                    });
+            }
+
+            std::future<RangeResults<ReleaseId>> releaseIds;
+            if (albumRange.size > 0)
+            {
+                releaseIds = queryExecutor.execute([=](Session& session)
+                    {
+                        const std::vector<std::string_view> queryKeywords(std::cbegin(ownedKeywords), std::cend(ownedKeywords));
+
+                        Release::FindParameters params;
+                        params.setKeywords(queryKeywords);
+                        params.setRange(albumRange);
+                        params.setMediaLibrary(mediaLibrary);
+
+                        auto transaction{ session.createReadTransaction() };
+                        return Release::findIds(session, params);
+                    });
+            }
+
+            std::future<RangeResults<TrackId>> trackIds;
+            if (songRange.size > 0)
+            {
+                trackIds = queryExecutor.execute([=](Session& session)
+                    {
+                        const std::vector<std::string_view> queryKeywords(std::cbegin(ownedKeywords), std::cend(ownedKeywords));
+
+                        Track::FindParameters params;
+                        params.setKeywords(queryKeywords);
+                        params.setRange(songRange);
+                        params.setMediaLibrary(mediaLibrary);
+
+                        auto transaction{ session.createReadTransaction() };
+                        return Track::findIds(session, params);
+                    });
+            }
+
+            SearchResults results;
+            results.artists = getResultsBefore(artistIds, deadline, "artist");
+            results.releases = getResultsBefore(releaseIds, deadline, "album");
+            results.tracks = getResultsBefore(trackIds, deadline, "song");
+
+            return results;
+        }
+
         Response handleSearchRequestCommon(RequestContext& context, bool id3)
         {
             // Mandatory params
@@ -66,6 +210,15 @@ namespace API::Subsonic
             else if (songCount > defaultMaxCountSize)
                 throw ParameterValueTooHighGenericError{ "songCount", defaultMaxCountSize };
 
+            const Range artistRange{ artistOffset, artistCount };
+            const Range albumRange{ albumOffset, albumCount };
+            const Range songRange{ songOffset, songCount };
+
+            // The in-memory index does not know about media libraries
+            const SearchResults results{ (context.searchIndex && !mediaLibrary.isValid())
+                ? searchUsingIndex(*context.searchIndex, context.userId, keywords, artistRange, albumRange, songRange)
+                : searchUsingDatabase(context.queryExecutor, keywords, mediaLibrary, artistRange, albumRange, songRange) };
+
             Response response{ Response::createOkResponse(context.serverProtocolVersion) };
             Response::Node& searchResult2Node{ response.createNode(id3 ? "searchResult3" : "searchResult2") };
 
@@ -75,45 +228,30 @@ namespace API::Subsonic
             if (!user)
                 throw UserNotAuthorizedError{};
 
-            if (artistCount > 0)
+            // objects may have been removed since the ids have been fetched
+            for (const ArtistId artistId : results.artists)
             {
-                Artist::FindParameters params;
-                params.setKeywords(keywords);
-                params.setRange(Range{ artistOffset, artistCount });
-                params.setMediaLibrary(mediaLibrary);
-
-                Artist::find(context.dbSession, params, [&](const Artist::pointer& artist)
-                    {
-                        searchResult2Node.addArrayChild("artist", createArtistNode(context, artist, user, id3));
-                    });
+                if (const Artist::pointer artist{ Artist::find(context.dbSession, artistId) })
+                    searchResult2Node.addArrayChild("artist", createArtistNode(context, artist, user, id3));
             }
 
-            if (albumCount > 0)
+            for (const ReleaseId releaseId : results.releases)
             {
-                Release::FindParameters params;
-                params.setKeywords(keywords);
-                params.setRange(Range{ albumOffset, albumCount });
-                params.setMediaLibrary(mediaLibrary);
-
-                Release::find(context.dbSession, params, [&](const Release::pointer& release)
-                    {
-                        searchResult2Node.addArrayChild("album", createAlbumNode(context, release, user, id3));
-                    });
+                if (const Release::pointer release{ Release::find(context.dbSession, releaseId) })
+                    searchResult2Node.addArrayChild("album", createAlbumNode(context, release, user, id3));
             }
 
-            if (songCount > 0)
+            std::vector<Track::pointer> tracks;
+            for (const TrackId trackId : results.tracks)
             {
-                Track::FindParameters params;
-                params.setKeywords(keywords);
-                params.setRange(Range{ songOffset, songCount });
-                params.setMediaLibrary(mediaLibrary);
-
-                Track::find(context.dbSession, params, [&](const Track::pointer& track)
-                    {
-                        searchResult2Node.addArrayChild("song", createSongNode(context, track, user));
-                    });
+                if (Track::pointer track{ Track::find(context.dbSession, trackId) })
+                    tracks.push_back(std::move(track));
             }
 
+            const SongNodeBatch batch{ context, tracks, user };
+            for (const Track::pointer& track : tracks)
+                searchResult2Node.addArrayChild("song", createSongNode(context, track, user, batch));
+
             return response;
         }
     }
@@ -1,5 +1,7 @@
 #include "entrypoints/System.hpp"
 
+#include "RequestMetrics.hpp"
+
 namespace API::Subsonic
 {
     Response handlePingRequest(RequestContext& context)
@@ -35,6 +37,46 @@ namespace API::Subsonic
             formPostNode.addArrayValue("versions", 1);
         }
 
+        {
+            Response::Node& libraryChangesNode{ response.createArrayNode("openSubsonicExtensions") };
+            libraryChangesNode.setAttribute("name", "libraryChanges");
+            libraryChangesNode.addArrayValue("versions", 1);
+        }
+
         return response;
     };
+
+    Response handleGetServerMetricsRequest(RequestContext& context)
+    {
+        Response response{ Response::createOkResponse(context.serverProtocolVersion) };
+        Response::Node& metricsNode{ response.createNode("serverMetrics") };
+        metricsNode.createEmptyArrayChild("entryPoint");
+
+        context.requestMetrics.visit([&](std::string_view entryPoint, const RequestMetrics::EntryPointStats& stats)
+            {
+                Response::Node entryPointNode;
+                entryPointNode.setAttribute("name", entryPoint.substr(entryPoint.find_first_not_of('/')));
+                entryPointNode.setAttribute("requestCount", stats.requestCount);
+                entryPointNode.setAttribute("failedRequestCount", stats.failedRequestCount);
+                entryPointNode.setAttribute("totalDurationUs", stats.totalDuration.count());
+                entryPointNode.setAttribute("maxDurationUs", stats.maxDuration.count());
+                entryPointNode.setAttribute("responseSize", stats.responseSize);
+                entryPointNode.setAttribute("sqlStatementCount", stats.statementCount);
+
+                // not cumulative, the last bucket has no upper bound
+                entryPointNode.createEmptyArrayChild("latencyBucket");
+                for (std::size_t i{}; i < stats.latencyBuckets.size(); ++i)
+                {
+                    Response::Node bucketNode;
+                    if (i < RequestMetrics::latencyBucketUpperBounds.size())
+                        bucketNode.setAttribute("upperBoundMs", RequestMetrics::latencyBucketUpperBounds[i].count());
+                    bucketNode.setAttribute("count", stats.latencyBuckets[i]);
+                    entryPointNode.addArrayChild("latencyBucket", std::move(bucketNode));
+                }
+
+                metricsNode.addArrayChild("entryPoint", std::move(entryPointNode));
+            });
+
+        return response;
+    }
 }
@@ -27,4 +27,5 @@ namespace API::Subsonic
     Response handlePingRequest(RequestContext& context);
     Response handleGetLicenseRequest(RequestContext& context);
     Response handleGetOpenSubsonicExtensions(RequestContext& context);
+    Response handleGetServerMetricsRequest(RequestContext& context); // LMS specific
 }
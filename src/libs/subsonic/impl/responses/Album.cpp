@@ -20,7 +20,8 @@
 #include "responses/Album.hpp"
 
 #include "database/Artist.hpp"
-#include "database/Cluster.hpp"
+#include "database/DirectReads.hpp"
+#include "database/Facet.hpp"
 #include "database/Release.hpp"
 #include "database/User.hpp"
 #include "services/feedback/IFeedbackService.hpp"
@@ -59,8 +60,9 @@ namespace API::Subsonic
         albumNode.setAttribute("created", StringUtils::toISO8601String(release->getLastWritten()));
         albumNode.setAttribute("id", idToString(release->getId()));
         albumNode.setAttribute("coverArt", idToString(release->getId()));
-        if (const auto year{ release->getYear() })
-            albumNode.setAttribute("year", *year);
+        const DirectReads::ReleaseYears years{ DirectReads::getReleaseYears(context.dbSession, release->getId()) };
+        if (years.year)
+            albumNode.setAttribute("year", *years.year);
 
         auto artists{ release->getReleaseArtists() };
         if (artists.empty())
@@ -90,14 +92,9 @@ namespace API::Subsonic
 
         albumNode.setAttribute("playCount", Service<Scrobbling::IScrobblingService>::get()->getCount(user->getId(), release->getId()));
 
-        // Report the first GENRE for this track
-        const ClusterType::pointer genreClusterType{ ClusterType::find(context.dbSession, "GENRE") };
-        if (genreClusterType)
-        {
-            auto clusters{ release->getClusterGroups({genreClusterType->getId()}, 1) };
-            if (!clusters.empty() && !clusters.front().empty())
-                albumNode.setAttribute("genre", clusters.front().front()->getName());
-        }
+        // Report the most used GENRE of this release
+        if (!release->getPrimaryGenre().empty())
+            albumNode.setAttribute("genre", release->getPrimaryGenre());
 
         if (const Wt::WDateTime dateTime{ Service<Feedback::IFeedbackService>::get()->getStarredDateTime(user->getId(), release->getId()) }; dateTime.isValid())
             albumNode.setAttribute("starred", StringUtils::toISO8601String(dateTime));
@@ -121,30 +118,16 @@ namespace API::Subsonic
             albumNode.setAttribute("musicBrainzId", mbid ? mbid->getAsString() : "");
         }
 
-        auto addClusters{ [&](Response::Node::Key field, std::string_view clusterTypeName)
-        {
-            albumNode.createEmptyArrayValue(field);
-
-            Cluster::FindParameters params;
-            params.setRelease(release->getId());
-            params.setClusterTypeName(clusterTypeName);
-
-            for (const auto& cluster : Cluster::find(context.dbSession, params).results)
-                albumNode.addArrayValue(field, cluster->getName());
-        } };
-
-        addClusters("moods", "MOOD");
+        albumNode.createEmptyArrayValue("moods");
+        for (const std::string& mood : Facet::getReleaseValues(context.dbSession, release->getId(), FacetType::Mood))
+            albumNode.addArrayValue("moods", mood);
 
         // Genres
         albumNode.createEmptyArrayChild("genres");
-        if (genreClusterType)
+        if (!release->getPrimaryGenre().empty())
         {
-            Cluster::FindParameters params;
-            params.setRelease(release->getId());
-            params.setClusterType(genreClusterType->getId());
-
-            for (const auto& cluster : Cluster::find(context.dbSession, params).results)
-                albumNode.addArrayChild("genres", createItemGenreNode(cluster->getName()));
+            for (const std::string& genre : Facet::getReleaseValues(context.dbSession, release->getId(), FacetType::Genre))
+                albumNode.addArrayChild("genres", createItemGenreNode(genre));
         }
 
         albumNode.createEmptyArrayChild("artists");
@@ -152,7 +135,7 @@ namespace API::Subsonic
             albumNode.addArrayChild("artists", createArtistNode(artist));
 
         albumNode.setAttribute("displayArtist", release->getArtistDisplayName());
-        albumNode.addChild("originalReleaseDate", createItemDateNode(release->getOriginalDate(), release->getOriginalYear()));
+        albumNode.addChild("originalReleaseDate", createItemDateNode(release->getOriginalDate(), years.originalYear));
 
         {
             bool isCompilation{};
@@ -171,10 +154,13 @@ namespace API::Subsonic
 
         // disc titles
         albumNode.createEmptyArrayChild("discTitles");
-        for (const DiscInfo& discInfo : release->getDiscs())
+        if (release->getDiscCount() > 0)
         {
-            if (!discInfo.name.empty())
-                albumNode.addArrayChild("discTitles", createDiscTitle(discInfo));
+            for (const DiscInfo& discInfo : release->getDiscs())
+            {
+                if (!discInfo.name.empty())
+                    albumNode.addArrayChild("discTitles", createDiscTitle(discInfo));
+            }
         }
 
         return albumNode;
@@ -19,18 +19,16 @@
 
 #include "responses/Genre.hpp"
 
-#include "database/Cluster.hpp"
-
 namespace API::Subsonic
 {
-    Response::Node createGenreNode(const Database::Cluster::pointer& cluster)
+    Response::Node createGenreNode(const Database::Facet::Entry& genre)
     {
-        Response::Node clusterNode;
+        Response::Node genreNode;
 
-        clusterNode.setValue(cluster->getName());
-        clusterNode.setAttribute("songCount", cluster->getTracksCount());
-        clusterNode.setAttribute("albumCount", cluster->getReleasesCount());
+        genreNode.setValue(genre.name);
+        genreNode.setAttribute("songCount", genre.trackCount);
+        genreNode.setAttribute("albumCount", genre.releaseCount);
 
-        return clusterNode;
+        return genreNode;
     }
 }
\ No newline at end of file
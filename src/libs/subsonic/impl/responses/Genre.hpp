@@ -19,15 +19,10 @@
 
 #pragma once
 
-#include "database/Object.hpp"
+#include "database/Facet.hpp"
 #include "SubsonicResponse.hpp"
 
-namespace Database
-{
-    class Cluster;
-}
-
 namespace API::Subsonic
 {
-    Response::Node createGenreNode(const Database::ObjectPtr<Database::Cluster>& cluster);
+    Response::Node createGenreNode(const Database::Facet::Entry& genre);
 }
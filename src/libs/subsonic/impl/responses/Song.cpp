@@ -19,11 +19,14 @@
 
 #include "responses/Song.hpp"
 
+#include <algorithm>
+#include <memory>
+#include <string>
 #include <string_view>
 
 #include "av/IAudioFile.hpp"
 #include "database/Artist.hpp"
-#include "database/Cluster.hpp"
+#include "database/Facet.hpp"
 #include "database/Release.hpp"
 #include "database/Track.hpp"
 #include "database/TrackArtistLink.hpp"
@@ -36,6 +39,7 @@
 #include "responses/Contributor.hpp"
 #include "responses/ItemGenre.hpp"
 #include "responses/ReplayGain.hpp"
+#include "SongFragmentCache.hpp"
 #include "SubsonicId.hpp"
 #include "Utils.hpp"
 
@@ -87,164 +91,230 @@ namespace API::Subsonic
 
             path += Utils::makeNameFilesystemCompatible(track->getName());
 
-            if (track->getPath().has_extension())
-                path += track->getPath().extension();
+            if (std::filesystem::path{ track->getFileName() }.has_extension())
+                path += std::filesystem::path{ track->getFileName() }.extension();
 
             return path;
         }
-    }
-
-    Response::Node createSongNode(RequestContext& context, const Track::pointer& track, const User::pointer& user)
-    {
-        Response::Node trackResponse;
 
-        trackResponse.setAttribute("id", idToString(track->getId()));
-        trackResponse.setAttribute("isDir", false);
-        trackResponse.setAttribute("title", track->getName());
-        if (track->getTrackNumber())
-            trackResponse.setAttribute("track", *track->getTrackNumber());
-        if (track->getDiscNumber())
-            trackResponse.setAttribute("discNumber", *track->getDiscNumber());
-        if (track->getYear())
-            trackResponse.setAttribute("year", *track->getYear());
-        trackResponse.setAttribute("playCount", Service<Scrobbling::IScrobblingService>::get()->getCount(user->getId(), track->getId()));
-        trackResponse.setAttribute("path", getTrackPath(track));
+        // Fields that only depend on the track (and on the OpenSubsonic support)
+        Response::Node createSongTrackNode(RequestContext& context, const Track::pointer& track, const SongNodeBatch::TrackData& trackData)
         {
-            // TODO, store this in DB
-            std::error_code ec;
-            const auto fileSize{ std::filesystem::file_size(track->getPath(), ec) };
-            if (!ec)
-                trackResponse.setAttribute("size", fileSize);
-        }
+            Response::Node trackResponse;
 
-        if (track->getPath().has_extension())
-        {
-            auto extension{ track->getPath().extension() };
-            trackResponse.setAttribute("suffix", extension.string().substr(1));
-        }
+            trackResponse.setAttribute("id", idToString(track->getId()));
+            trackResponse.setAttribute("isDir", false);
+            trackResponse.setAttribute("title", track->getName());
+            if (track->getTrackNumber())
+                trackResponse.setAttribute("track", *track->getTrackNumber());
+            if (track->getDiscNumber())
+                trackResponse.setAttribute("discNumber", *track->getDiscNumber());
+            if (track->getYear())
+                trackResponse.setAttribute("year", *track->getYear());
+            trackResponse.setAttribute("path", getTrackPath(track));
+            {
+                // TODO, store this in DB
+                std::error_code ec;
+                const auto fileSize{ std::filesystem::file_size(track->getPath(), ec) };
+                if (!ec)
+                    trackResponse.setAttribute("size", fileSize);
+            }
 
-        {
-            const std::string fileSuffix{ formatToSuffix(user->getSubsonicDefaultTranscodingOutputFormat()) };
-            trackResponse.setAttribute("transcodedSuffix", fileSuffix);
-            trackResponse.setAttribute("transcodedContentType", Av::getMimeType(std::filesystem::path{ "." + fileSuffix }));
-        }
+            if (std::filesystem::path{ track->getFileName() }.has_extension())
+            {
+                auto extension{ std::filesystem::path{ track->getFileName() }.extension() };
+                trackResponse.setAttribute("suffix", extension.string().substr(1));
+            }
 
-        trackResponse.setAttribute("coverArt", idToString(track->getId()));
+            trackResponse.setAttribute("coverArt", idToString(track->getId()));
 
-        const std::vector<Artist::pointer>& artists{ track->getArtists({TrackArtistLinkType::Artist}) };
-        if (!artists.empty())
-        {
-            if (!track->getArtistDisplayName().empty())
-                trackResponse.setAttribute("artist", track->getArtistDisplayName());
-            else
-                trackResponse.setAttribute("artist", Utils::joinArtistNames(artists));
+            std::vector<Artist::pointer> artists;
+            for (const TrackArtistLink::pointer& link : trackData.artistLinks)
+            {
+                if (link->getType() == TrackArtistLinkType::Artist)
+                    artists.push_back(link->getArtist());
+            }
+            if (!artists.empty())
+            {
+                if (!track->getArtistDisplayName().empty())
+                    trackResponse.setAttribute("artist", track->getArtistDisplayName());
+                else
+                    trackResponse.setAttribute("artist", Utils::joinArtistNames(artists));
 
-            if (artists.size() == 1)
-                trackResponse.setAttribute("artistId", idToString(artists.front()->getId()));
-        }
+                if (artists.size() == 1)
+                    trackResponse.setAttribute("artistId", idToString(artists.front()->getId()));
+            }
 
-        Release::pointer release{ track->getRelease() };
-        if (release)
-        {
-            trackResponse.setAttribute("album", release->getName());
-            trackResponse.setAttribute("albumId", idToString(release->getId()));
-            trackResponse.setAttribute("parent", idToString(release->getId()));
-        }
+            Release::pointer release{ track->getRelease() };
+            if (release)
+            {
+                trackResponse.setAttribute("album", release->getName());
+                trackResponse.setAttribute("albumId", idToString(release->getId()));
+                trackResponse.setAttribute("parent", idToString(release->getId()));
+            }
 
-        trackResponse.setAttribute("duration", std::chrono::duration_cast<std::chrono::seconds>(track->getDuration()).count());
-        trackResponse.setAttribute("bitRate", (track->getBitrate() / 1000));
-        trackResponse.setAttribute("type", "music");
-        trackResponse.setAttribute("created", StringUtils::toISO8601String(track->getLastWritten()));
-        trackResponse.setAttribute("contentType", Av::getMimeType(track->getPath().extension()));
+            trackResponse.setAttribute("duration", std::chrono::duration_cast<std::chrono::seconds>(track->getDuration()).count());
+            trackResponse.setAttribute("bitRate", (track->getBitrate() / 1000));
+            trackResponse.setAttribute("type", "music");
+            trackResponse.setAttribute("created", StringUtils::toISO8601String(track->getLastWritten()));
+            trackResponse.setAttribute("contentType", Av::getMimeType(std::filesystem::path{ track->getFileName() }.extension()));
 
-        if (const Wt::WDateTime dateTime{ Service<Feedback::IFeedbackService>::get()->getStarredDateTime(user->getId(), track->getId()) }; dateTime.isValid())
-            trackResponse.setAttribute("starred", StringUtils::toISO8601String(dateTime));
+            // Report the first GENRE for this track
+            const std::vector<std::string>& genres{ trackData.genres };
+            if (!genres.empty())
+                trackResponse.setAttribute("genre", genres.front());
 
-        // Report the first GENRE for this track
-        std::vector<Cluster::pointer> genres;
-        {
-            Cluster::FindParameters params;
-            params.setTrack(track->getId());
-            params.setClusterTypeName("GENRE");
+            // OpenSubsonic specific fields (must always be set)
+            if (!context.enableOpenSubsonic)
+                return trackResponse;
 
-            genres = Cluster::find(context.dbSession, params).results;
-            if (!genres.empty())
-                trackResponse.setAttribute("genre", genres.front()->getName());
-        }
+            trackResponse.setAttribute("mediaType", "song");
 
-        // OpenSubsonic specific fields (must always be set)
-        if (!context.enableOpenSubsonic)
-            return trackResponse;
+            {
+                std::optional<UUID> mbid{ track->getRecordingMBID() };
+                trackResponse.setAttribute("musicBrainzId", mbid ? mbid->getAsString() : "");
+            }
 
-        trackResponse.setAttribute("mediaType", "song");
+            trackResponse.createEmptyArrayChild("contributors");
+            for (const TrackArtistLink::pointer& link : trackData.artistLinks)
+            {
+                // Don't report artists nor release artists as they are set in dedicated fields
+                if (link->getType() != TrackArtistLinkType::Artist && link->getType() != TrackArtistLinkType::ReleaseArtist)
+                    trackResponse.addArrayChild("contributors", createContributorNode(link));
+            }
 
-        {
-            const Wt::WDateTime dateTime{ Service<Scrobbling::IScrobblingService>::get()->getLastListenDateTime(user->getId(), track->getId()) };
-            trackResponse.setAttribute("played", dateTime.isValid() ? StringUtils::toISO8601String(dateTime) : "");
+            auto addArtistLinks{ [&](Response::Node::Key nodeName, TrackArtistLinkType type)
+            {
+                trackResponse.createEmptyArrayChild(nodeName);
+
+                for (const TrackArtistLink::pointer& link : trackData.artistLinks)
+                {
+                    if (link->getType() == type)
+                        trackResponse.addArrayChild(nodeName, createArtistNode(link->getArtist()));
+                }
+            } };
+
+            addArtistLinks("artists", TrackArtistLinkType::Artist);
+            trackResponse.setAttribute("displayArtist", track->getArtistDisplayName());
+
+            addArtistLinks("albumartists", TrackArtistLinkType::ReleaseArtist);
+            if (release)
+                trackResponse.setAttribute("displayAlbumArtist", release->getArtistDisplayName());
+
+            trackResponse.createEmptyArrayValue("moods");
+            for (const std::string& mood : trackData.moods)
+                trackResponse.addArrayValue("moods", mood);
+
+            // Genres
+            trackResponse.createEmptyArrayChild("genres");
+            for (const std::string& genre : genres)
+                trackResponse.addArrayChild("genres", createItemGenreNode(genre));
+
+            trackResponse.addChild("replayGain", createReplayGainNode(track));
+
+            return trackResponse;
         }
+    }
 
+    SongNodeBatch::SongNodeBatch(RequestContext& context, std::span<const Track::pointer> tracks, const User::pointer& user)
+    {
+        std::vector<TrackId> trackIds;
+        trackIds.reserve(tracks.size());
+        for (const Track::pointer& track : tracks)
         {
-            std::optional<UUID> mbid{ track->getRecordingMBID() };
-            trackResponse.setAttribute("musicBrainzId", mbid ? mbid->getAsString() : "");
+            trackIds.push_back(track->getId());
+            _trackData.try_emplace(track->getId());
         }
 
-        trackResponse.createEmptyArrayChild("contributors");
+        for (const auto& [trackId, stats] : Service<Scrobbling::IScrobblingService>::get()->getListenStats(user->getId(), trackIds))
         {
-            TrackArtistLink::FindParameters params;
-            params.setTrack(track->getId());
-
-            for (const TrackArtistLinkId linkId : TrackArtistLink::find(context.dbSession, params).results)
-            {
-                TrackArtistLink::pointer link{ TrackArtistLink::find(context.dbSession, linkId) };
-                // Don't report artists nor release artists as they are set in dedicated fields
-                if (link && link->getType() != TrackArtistLinkType::Artist && link->getType() != TrackArtistLinkType::ReleaseArtist)
-                    trackResponse.addArrayChild("contributors", createContributorNode(link));
-            }
+            TrackData& trackData{ _trackData[trackId] };
+            trackData.playCount = stats.count;
+            trackData.lastListenDateTime = stats.lastListenDateTime;
         }
 
-        auto addArtistLinks{ [&](Response::Node::Key nodeName, TrackArtistLinkType type)
+        for (const auto& [trackId, dateTime] : Service<Feedback::IFeedbackService>::get()->getStarredDateTimes(user->getId(), trackIds))
+            _trackData[trackId].starredDateTime = dateTime;
+
+        // No need to fetch what is needed to create the cached fragments
+        if (context.songFragmentCache)
         {
-            trackResponse.createEmptyArrayChild(nodeName);
+            std::erase_if(trackIds, [&](TrackId trackId)
+                {
+                    TrackData& trackData{ _trackData[trackId] };
+                    trackData.cachedFragment = context.songFragmentCache->get(trackId, context.enableOpenSubsonic, context.scanGeneration);
+                    return trackData.cachedFragment != nullptr;
+                });
+
+            if (trackIds.empty())
+                return;
+        }
 
-            TrackArtistLink::FindParameters params;
-            params.setTrack(track->getId());
-            params.setLinkType(type);
+        TrackArtistLink::find(context.dbSession, trackIds, [&](TrackId trackId, const TrackArtistLink::pointer& link, const Artist::pointer&)
+            {
+                _trackData[trackId].artistLinks.push_back(link);
+            });
 
-            for (const TrackArtistLinkId linkId : TrackArtistLink::find(context.dbSession, params).results)
+        Facet::getTrackValues(context.dbSession, trackIds, FacetType::Genre, [&](TrackId trackId, std::string_view genre)
             {
-                TrackArtistLink::pointer link{ TrackArtistLink::find(context.dbSession, linkId) };
-                if (link)
-                    trackResponse.addArrayChild(nodeName, createArtistNode(link->getArtist()));
-            }
-        } };
+                _trackData[trackId].genres.emplace_back(genre);
+            });
+        Facet::getTrackValues(context.dbSession, trackIds, FacetType::Mood, [&](TrackId trackId, std::string_view mood)
+            {
+                _trackData[trackId].moods.emplace_back(mood);
+            });
+    }
 
-        addArtistLinks("artists", TrackArtistLinkType::Artist);
-        trackResponse.setAttribute("displayArtist", track->getArtistDisplayName());
+    SongNodeBatch::~SongNodeBatch() = default;
 
-        addArtistLinks("albumartists", TrackArtistLinkType::ReleaseArtist);
-        if (release)
-            trackResponse.setAttribute("displayAlbumArtist", release->getArtistDisplayName());
+    const SongNodeBatch::TrackData& SongNodeBatch::getTrackData(TrackId trackId) const
+    {
+        static const TrackData emptyTrackData;
 
-        auto addClusters{ [&](Response::Node::Key field, std::string_view clusterTypeName)
-        {
-            trackResponse.createEmptyArrayValue(field);
+        auto it{ _trackData.find(trackId) };
+        return it != std::cend(_trackData) ? it->second : emptyTrackData;
+    }
 
-            Cluster::FindParameters params;
-            params.setTrack(track->getId());
-            params.setClusterTypeName(clusterTypeName);
+    Response::Node createSongNode(RequestContext& context, const Track::pointer& track, const User::pointer& user)
+    {
+        const SongNodeBatch batch{ context, std::span{ &track, 1 }, user };
+        return createSongNode(context, track, user, batch);
+    }
 
-            for (const auto& cluster : Cluster::find(context.dbSession, params).results)
-                trackResponse.addArrayValue(field, cluster->getName());
-        } };
+    Response::Node createSongNode(RequestContext& context, const Track::pointer& track, const User::pointer& user, const SongNodeBatch& batch)
+    {
+        const SongNodeBatch::TrackData& trackData{ batch.getTrackData(track->getId()) };
 
-        addClusters("moods", "MOOD");
+        Response::Node trackResponse;
+        if (trackData.cachedFragment)
+        {
+            trackResponse.setSerializedFragment(trackData.cachedFragment);
+        }
+        else if (context.songFragmentCache)
+        {
+            auto fragment{ std::make_shared<const Response::Node::SerializedFragment>(Response::serializeFragment(createSongTrackNode(context, track, trackData))) };
+            context.songFragmentCache->put(track->getId(), context.enableOpenSubsonic, context.scanGeneration, fragment);
+            trackResponse.setSerializedFragment(std::move(fragment));
+        }
+        else
+        {
+            trackResponse = createSongTrackNode(context, track, trackData);
+        }
+
+        // Fields that depend on the user
+        trackResponse.setAttribute("playCount", trackData.playCount);
+
+        {
+            const std::string fileSuffix{ formatToSuffix(user->getSubsonicDefaultTranscodingOutputFormat()) };
+            trackResponse.setAttribute("transcodedSuffix", fileSuffix);
+            trackResponse.setAttribute("transcodedContentType", Av::getMimeType(std::filesystem::path{ "." + fileSuffix }));
+        }
 
-        // Genres
-        trackResponse.createEmptyArrayChild("genres");
-        for (const auto& genre : genres)
-            trackResponse.addArrayChild("genres", createItemGenreNode(genre->getName()));
+        if (trackData.starredDateTime.isValid())
+            trackResponse.setAttribute("starred", StringUtils::toISO8601String(trackData.starredDateTime));
 
-        trackResponse.addChild("replayGain", createReplayGainNode(track));
+        if (context.enableOpenSubsonic)
+            trackResponse.setAttribute("played", trackData.lastListenDateTime.isValid() ? StringUtils::toISO8601String(trackData.lastListenDateTime) : "");
 
         return trackResponse;
     }
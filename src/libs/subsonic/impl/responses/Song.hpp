@@ -19,17 +19,55 @@
 
 #pragma once
 
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <Wt/WDateTime.h>
+
 #include "database/Object.hpp"
+#include "database/TrackId.hpp"
 #include "SubsonicResponse.hpp"
 
 namespace Database
 {
     class Track;
+    class TrackArtistLink;
     class User;
     class Session;
 }
 
 namespace API::Subsonic
 {
+    // Per track data needed to create the song nodes of several tracks, fetched at once using a few set queries
+    class SongNodeBatch
+    {
+    public:
+        SongNodeBatch(RequestContext& context, std::span<const Database::ObjectPtr<Database::Track>> tracks, const Database::ObjectPtr<Database::User>& user);
+        ~SongNodeBatch();
+
+        SongNodeBatch(const SongNodeBatch&) = delete;
+        SongNodeBatch& operator=(const SongNodeBatch&) = delete;
+
+        struct TrackData
+        {
+            std::size_t playCount{};
+            Wt::WDateTime lastListenDateTime;
+            Wt::WDateTime starredDateTime;
+            std::shared_ptr<const Response::Node::SerializedFragment> cachedFragment; // if set, the fields below are not fetched
+            std::vector<Database::ObjectPtr<Database::TrackArtistLink>> artistLinks; // artists are loaded along
+            std::vector<std::string> genres;
+            std::vector<std::string> moods;
+        };
+        const TrackData& getTrackData(Database::TrackId trackId) const; // empty data if the track is not part of the batch
+
+    private:
+        std::unordered_map<Database::TrackId, TrackData> _trackData;
+    };
+
     Response::Node createSongNode(RequestContext& context, const Database::ObjectPtr<Database::Track>& track, const Database::ObjectPtr<Database::User>& user);
+    Response::Node createSongNode(RequestContext& context, const Database::ObjectPtr<Database::Track>& track, const Database::ObjectPtr<Database::User>& user, const SongNodeBatch& batch);
 }
\ No newline at end of file
@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <random>
+#include <sstream>
+#include <string>
+#include <benchmark/benchmark.h>
+
+#include "utils/String.hpp"
+
+namespace
+{
+    // Mostly plain text, with a few characters to escape or to split on
+    std::string generateString(std::size_t size)
+    {
+        static constexpr std::string_view chars{ "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789     ;/%_\"\\&<" };
+
+        std::minstd_rand randomEngine{ 42 };
+        std::geometric_distribution<std::size_t> plainRunLength{ 0.05 };
+        std::uniform_int_distribution<std::size_t> plainChar{ 0, 66 };
+        std::uniform_int_distribution<std::size_t> specialChar{ 67, chars.size() - 1 };
+
+        std::string res;
+        res.reserve(size);
+        while (res.size() < size)
+        {
+            for (std::size_t i{ plainRunLength(randomEngine) }; i > 0 && res.size() < size; --i)
+                res += chars[plainChar(randomEngine)];
+            if (res.size() < size)
+                res += chars[specialChar(randomEngine)];
+        }
+
+        return res;
+    }
+
+    void BM_splitString(benchmark::State& state)
+    {
+        const std::string str{ generateString(state.range(0)) };
+
+        for (auto _ : state)
+            benchmark::DoNotOptimize(StringUtils::splitString(str, ';'));
+
+        state.SetBytesProcessed(state.iterations() * str.size());
+    }
+
+    void BM_stringToLower(benchmark::State& state)
+    {
+        const std::string str{ generateString(state.range(0)) };
+
+        for (auto _ : state)
+            benchmark::DoNotOptimize(StringUtils::stringToLower(str));
+
+        state.SetBytesProcessed(state.iterations() * str.size());
+    }
+
+    void BM_escapeString(benchmark::State& state)
+    {
+        const std::string str{ generateString(state.range(0)) };
+
+        for (auto _ : state)
+            benchmark::DoNotOptimize(StringUtils::escapeString(str, "%_", '\\'));
+
+        state.SetBytesProcessed(state.iterations() * str.size());
+    }
+
+    void BM_writeJsonEscapedString(benchmark::State& state)
+    {
+        const std::string str{ generateString(state.range(0)) };
+
+        for (auto _ : state)
+        {
+            std::ostringstream oss;
+            StringUtils::writeJsonEscapedString(oss, str);
+            benchmark::DoNotOptimize(oss);
+        }
+
+        state.SetBytesProcessed(state.iterations() * str.size());
+    }
+
+    void BM_writeXmlEscapedString(benchmark::State& state)
+    {
+        const std::string str{ generateString(state.range(0)) };
+
+        for (auto _ : state)
+        {
+            std::ostringstream oss;
+            StringUtils::writeXmlEscapedString(oss, str);
+            benchmark::DoNotOptimize(oss);
+        }
+
+        state.SetBytesProcessed(state.iterations() * str.size());
+    }
+
+    void BM_replaceInString(benchmark::State& state)
+    {
+        const std::string str{ generateString(state.range(0)) };
+
+        for (auto _ : state)
+            benchmark::DoNotOptimize(StringUtils::replaceInString(str, "/", "_"));
+
+        state.SetBytesProcessed(state.iterations() * str.size());
+    }
+}
+
+// typical tag values and names, then long texts
+BENCHMARK(BM_splitString)->Arg(32)->Arg(4096);
+BENCHMARK(BM_stringToLower)->Arg(32)->Arg(4096);
+BENCHMARK(BM_escapeString)->Arg(32)->Arg(4096);
+BENCHMARK(BM_writeJsonEscapedString)->Arg(32)->Arg(4096);
+BENCHMARK(BM_writeXmlEscapedString)->Arg(32)->Arg(4096);
+BENCHMARK(BM_replaceInString)->Arg(32)->Arg(4096);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,456 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "AsyncFileReader.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+
+#if __has_include(<linux/io_uring.h>) && defined(__NR_io_uring_setup)
+#include <linux/io_uring.h>
+#define LMS_HAS_IO_URING
+#endif
+
+#include <boost/asio/post.hpp>
+
+#include "utils/Exception.hpp"
+#include "utils/ILogger.hpp"
+
+namespace
+{
+    // io_uring limits a single read to a signed 32 bits size
+    constexpr std::size_t maxReadSize{ 0x7FFF'F000 };
+}
+
+#if defined(LMS_HAS_IO_URING)
+// Minimal io_uring usage through the raw system calls: a single submission thread at a time, and a thread reaping the completions
+class AsyncFileReader::IoUring
+{
+public:
+    using CompletionCallback = std::function<void(int result)>;
+
+    // returns nullptr if io_uring or the needed operations are not supported
+    static std::unique_ptr<IoUring> create(unsigned entryCount);
+    ~IoUring();
+
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    bool registerBuffers(std::span<std::byte> bufferPool, std::size_t bufferSize);
+    void submitRead(int fd, std::uint64_t offset, std::span<std::byte> buffer, std::optional<unsigned> registeredBufferIndex, CompletionCallback callback);
+
+private:
+    IoUring(int ringFd, const io_uring_params& params);
+    void submit(std::uint8_t opcode, int fd, std::uint64_t offset, std::span<std::byte> buffer, std::optional<unsigned> registeredBufferIndex, CompletionCallback* callback);
+    void processCompletions();
+
+    static int enter(int ringFd, unsigned toSubmit, unsigned minComplete, unsigned flags)
+    {
+        return static_cast<int>(::syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete, flags, nullptr, 0));
+    }
+
+    static unsigned loadAcquire(unsigned* value) { return std::atomic_ref<unsigned>{ *value }.load(std::memory_order_acquire); }
+    static void storeRelease(unsigned* value, unsigned newValue) { std::atomic_ref<unsigned>{ *value }.store(newValue, std::memory_order_release); }
+
+    template <typename T>
+    static T* at(void* base, std::size_t offset) { return reinterpret_cast<T*>(static_cast<std::byte*>(base) + offset); }
+
+    const int _ringFd;
+    void* _sqRing{ MAP_FAILED };
+    std::size_t _sqRingSize{};
+    void* _cqRing{ MAP_FAILED };
+    std::size_t _cqRingSize{};
+    io_uring_sqe* _sqes{ static_cast<io_uring_sqe*>(MAP_FAILED) };
+    std::size_t _sqesSize{};
+
+    unsigned* _sqTail{};
+    unsigned _sqMask{};
+    unsigned* _sqArray{};
+    unsigned* _cqHead{};
+    unsigned* _cqTail{};
+    unsigned _cqMask{};
+    io_uring_cqe* _cqes{};
+
+    std::mutex _submitMutex;
+    std::thread _completionThread;
+};
+
+std::unique_ptr<AsyncFileReader::IoUring> AsyncFileReader::IoUring::create(unsigned entryCount)
+{
+    io_uring_params params{};
+    const int ringFd{ static_cast<int>(::syscall(__NR_io_uring_setup, entryCount, &params)) };
+    if (ringFd < 0)
+    {
+        LMS_LOG(UTILS, INFO, "io_uring not available: " << ::strerror(errno));
+        return nullptr;
+    }
+
+#if defined(IORING_REGISTER_PROBE)
+    {
+        constexpr unsigned probeOpCount{ 256 };
+        std::vector<std::byte> probeBuffer(sizeof(io_uring_probe) + probeOpCount * sizeof(io_uring_probe_op));
+        io_uring_probe* probe{ reinterpret_cast<io_uring_probe*>(probeBuffer.data()) };
+        if (::syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_PROBE, probe, probeOpCount) < 0
+            || probe->last_op < IORING_OP_READ
+            || !(probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED))
+        {
+            LMS_LOG(UTILS, INFO, "io_uring read operations not supported");
+            ::close(ringFd);
+            return nullptr;
+        }
+    }
+#else
+    LMS_LOG(UTILS, INFO, "io_uring probing not supported at build time");
+    ::close(ringFd);
+    return nullptr;
+#endif
+
+    try
+    {
+        return std::unique_ptr<IoUring>{ new IoUring{ ringFd, params } };
+    }
+    catch (const LmsException& e)
+    {
+        LMS_LOG(UTILS, ERROR, "Cannot setup io_uring: " << e.what());
+        return nullptr;
+    }
+}
+
+AsyncFileReader::IoUring::IoUring(int ringFd, const io_uring_params& params)
+    : _ringFd{ ringFd }
+{
+    _sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    _cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool singleMmap{ (params.features & IORING_FEAT_SINGLE_MMAP) != 0 };
+    if (singleMmap)
+        _sqRingSize = _cqRingSize = std::max(_sqRingSize, _cqRingSize);
+
+    _sqRing = ::mmap(nullptr, _sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+    if (_sqRing != MAP_FAILED)
+        _cqRing = singleMmap ? _sqRing : ::mmap(nullptr, _cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+    if (_cqRing != MAP_FAILED)
+    {
+        _sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        _sqes = static_cast<io_uring_sqe*>(::mmap(nullptr, _sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES));
+    }
+    if (_sqes == MAP_FAILED)
+    {
+        const std::string error{ ::strerror(errno) };
+        if (_cqRing != MAP_FAILED && _cqRing != _sqRing)
+            ::munmap(_cqRing, _cqRingSize);
+        if (_sqRing != MAP_FAILED)
+            ::munmap(_sqRing, _sqRingSize);
+        ::close(ringFd);
+        throw LmsException{ "cannot map rings: " + error };
+    }
+
+    _sqTail = at<unsigned>(_sqRing, params.sq_off.tail);
+    _sqMask = *at<unsigned>(_sqRing, params.sq_off.ring_mask);
+    _sqArray = at<unsigned>(_sqRing, params.sq_off.array);
+    _cqHead = at<unsigned>(_cqRing, params.cq_off.head);
+    _cqTail = at<unsigned>(_cqRing, params.cq_off.tail);
+    _cqMask = *at<unsigned>(_cqRing, params.cq_off.ring_mask);
+    _cqes = at<io_uring_cqe>(_cqRing, params.cq_off.cqes);
+
+    _completionThread = std::thread{ [this] { processCompletions(); } };
+
+    LMS_LOG(UTILS, INFO, "Using io_uring with " << params.sq_entries << " entries");
+}
+
+AsyncFileReader::IoUring::~IoUring()
+{
+    // no callback means stop, all the reads have been completed at this point
+    submit(IORING_OP_NOP, -1, 0, {}, std::nullopt, nullptr);
+    _completionThread.join();
+
+    ::munmap(_sqes, _sqesSize);
+    if (_cqRing != _sqRing)
+        ::munmap(_cqRing, _cqRingSize);
+    ::munmap(_sqRing, _sqRingSize);
+    ::close(_ringFd);
+}
+
+bool AsyncFileReader::IoUring::registerBuffers(std::span<std::byte> bufferPool, std::size_t bufferSize)
+{
+    std::vector<::iovec> iovecs;
+    for (std::size_t offset{}; offset + bufferSize <= bufferPool.size(); offset += bufferSize)
+        iovecs.push_back(::iovec{ bufferPool.data() + offset, bufferSize });
+
+    if (::syscall(__NR_io_uring_register, _ringFd, IORING_REGISTER_BUFFERS, iovecs.data(), static_cast<unsigned>(iovecs.size())) < 0)
+    {
+        // usually the locked memory limit
+        LMS_LOG(UTILS, INFO, "Cannot register io_uring buffers: " << ::strerror(errno));
+        return false;
+    }
+
+    return true;
+}
+
+void AsyncFileReader::IoUring::submitRead(int fd, std::uint64_t offset, std::span<std::byte> buffer, std::optional<unsigned> registeredBufferIndex, CompletionCallback callback)
+{
+    submit(registeredBufferIndex ? IORING_OP_READ_FIXED : IORING_OP_READ, fd, offset, buffer, registeredBufferIndex, new CompletionCallback{ std::move(callback) });
+}
+
+void AsyncFileReader::IoUring::submit(std::uint8_t opcode, int fd, std::uint64_t offset, std::span<std::byte> buffer, std::optional<unsigned> registeredBufferIndex, CompletionCallback* callback)
+{
+    const std::scoped_lock lock{ _submitMutex };
+
+    // the kernel consumes all the entries at each enter call, so that the ring is never full
+    const unsigned tail{ *_sqTail };
+    const unsigned index{ tail & _sqMask };
+
+    io_uring_sqe& sqe{ _sqes[index] };
+    std::memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = opcode;
+    sqe.fd = fd;
+    sqe.off = offset;
+    sqe.addr = reinterpret_cast<std::uint64_t>(buffer.data());
+    sqe.len = static_cast<std::uint32_t>(buffer.size());
+    if (registeredBufferIndex)
+        sqe.buf_index = static_cast<std::uint16_t>(*registeredBufferIndex);
+    sqe.user_data = reinterpret_cast<std::uint64_t>(callback);
+
+    _sqArray[index] = index;
+    storeRelease(_sqTail, tail + 1);
+
+    while (enter(_ringFd, 1, 0, 0) < 0)
+    {
+        if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+            throw LmsException{ std::string{ "io_uring submission failed: " } + ::strerror(errno) };
+
+        std::this_thread::yield();
+    }
+}
+
+void AsyncFileReader::IoUring::processCompletions()
+{
+    while (true)
+    {
+        unsigned head{ *_cqHead };
+        const unsigned tail{ loadAcquire(_cqTail) };
+        if (head == tail)
+        {
+            if (enter(_ringFd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR)
+            {
+                LMS_LOG(UTILS, FATAL, "io_uring wait failed: " << ::strerror(errno));
+                std::abort();
+            }
+            continue;
+        }
+
+        for (; head != tail; ++head)
+        {
+            const io_uring_cqe& cqe{ _cqes[head & _cqMask] };
+            std::unique_ptr<CompletionCallback> callback{ reinterpret_cast<CompletionCallback*>(cqe.user_data) };
+            const int result{ cqe.res };
+            storeRelease(_cqHead, head + 1);
+
+            if (!callback)
+                return;
+
+            (*callback)(result);
+        }
+    }
+}
+#else
+class AsyncFileReader::IoUring
+{
+public:
+    static std::unique_ptr<IoUring> create(unsigned)
+    {
+        LMS_LOG(UTILS, INFO, "io_uring not supported at build time");
+        return nullptr;
+    }
+
+    bool registerBuffers(std::span<std::byte>, std::size_t) { return false; }
+    void submitRead(int, std::uint64_t, std::span<std::byte>, std::optional<unsigned>, std::function<void(int)>) {}
+};
+#endif
+
+std::unique_ptr<IAsyncFileReader> createAsyncFileReader(const AsyncFileReaderParameters& parameters)
+{
+    return std::make_unique<AsyncFileReader>(parameters);
+}
+
+AsyncFileReader::AsyncFileReader(const AsyncFileReaderParameters& parameters)
+    : _queueDepth{ std::max<std::size_t>(parameters.queueDepth, 1) }
+    , _bufferSize{ std::clamp<std::size_t>(parameters.bufferSize, 4096, maxReadSize) }
+    , _bufferPool(parameters.bufferCount * _bufferSize)
+    , _ioContextRunner{ _ioContext, std::max<std::size_t>(parameters.threadCount, 1) }
+{
+    for (std::size_t offset{}; offset < _bufferPool.size(); offset += _bufferSize)
+        _freeBuffers.push_back(_bufferPool.data() + offset);
+
+    if (parameters.useIoUring)
+    {
+        _ioUring = IoUring::create(static_cast<unsigned>(std::min<std::size_t>(_queueDepth, 4096)));
+        if (_ioUring && !_bufferPool.empty())
+            _bufferPoolRegistered = _ioUring->registerBuffers(_bufferPool, _bufferSize);
+    }
+
+    LMS_LOG(UTILS, INFO, "Async file reader using " << (_ioUring ? "io_uring" : "a thread pool") << ", queue depth = " << _queueDepth << ", " << parameters.bufferCount << (_bufferPoolRegistered ? " registered" : "") << " buffers of " << _bufferSize << " bytes");
+}
+
+AsyncFileReader::~AsyncFileReader()
+{
+    // callers may still wait for their reads
+    std::unique_lock lock{ _queueMutex };
+    _queueCondition.wait(lock, [this] { return _inFlightCount == 0; });
+}
+
+void AsyncFileReader::asyncRead(int fd, std::uint64_t offset, std::span<std::byte> buffer, ReadCallback callback)
+{
+    {
+        std::unique_lock lock{ _queueMutex };
+        _queueCondition.wait(lock, [this] { return _inFlightCount < _queueDepth; });
+        _inFlightCount++;
+    }
+
+    // owned by the pending read until its completion
+    submitRead(new ReadOperation{ fd, offset, buffer.first(std::min(buffer.size(), maxReadSize)), 0, std::move(callback) });
+}
+
+void AsyncFileReader::submitRead(ReadOperation* operation)
+{
+    if (!_ioUring)
+    {
+        boost::asio::post(_ioContext, [this, operation] { readUsingThreadPool(operation); });
+        return;
+    }
+
+    const std::span<std::byte> remainingBuffer{ operation->buffer.subspan(operation->readSize) };
+    _ioUring->submitRead(operation->fd, operation->offset + operation->readSize, remainingBuffer, getRegisteredBufferIndex(remainingBuffer), [this, operation](int result)
+        {
+            onReadComplete(operation, result);
+        });
+}
+
+void AsyncFileReader::readUsingThreadPool(ReadOperation* operation)
+{
+    const std::span<std::byte> remainingBuffer{ operation->buffer.subspan(operation->readSize) };
+    const ::ssize_t result{ ::pread(operation->fd, remainingBuffer.data(), remainingBuffer.size(), static_cast<::off_t>(operation->offset + operation->readSize)) };
+
+    onReadComplete(operation, result < 0 ? -errno : static_cast<int>(result));
+}
+
+void AsyncFileReader::onReadComplete(ReadOperation* operation, int result)
+{
+    std::error_code ec;
+    if (result < 0)
+    {
+        if (result == -EINTR || result == -EAGAIN)
+        {
+            submitRead(operation);
+            return;
+        }
+
+        ec = std::error_code{ -result, std::system_category() };
+    }
+    else if (result > 0)
+    {
+        operation->readSize += static_cast<std::size_t>(result);
+        // short reads do not necessarily mean end of file
+        if (operation->readSize < operation->buffer.size())
+        {
+            submitRead(operation);
+            return;
+        }
+    }
+
+    const std::unique_ptr<ReadOperation> completedOperation{ operation };
+
+    // released first, so that the callback can chain reads
+    {
+        const std::scoped_lock lock{ _queueMutex };
+        _inFlightCount--;
+    }
+    _queueCondition.notify_all();
+
+    completedOperation->callback(ec, completedOperation->readSize);
+}
+
+void AsyncFileReader::prefetch(const std::filesystem::path& path, std::size_t size)
+{
+    // opening a file may block too
+    boost::asio::post(_ioContext, [path, size]
+        {
+            const int fd{ ::open(path.c_str(), O_RDONLY | O_CLOEXEC) };
+            if (fd < 0)
+                return;
+
+#if defined(POSIX_FADV_WILLNEED)
+            ::posix_fadvise(fd, 0, static_cast<::off_t>(size), POSIX_FADV_WILLNEED);
+#endif
+            ::close(fd);
+        });
+}
+
+IAsyncFileReader::Buffer AsyncFileReader::acquireBuffer()
+{
+    {
+        const std::scoped_lock lock{ _freeBuffersMutex };
+        if (!_freeBuffers.empty())
+        {
+            std::byte* data{ _freeBuffers.back() };
+            _freeBuffers.pop_back();
+            return Buffer{ data, BufferDeleter{ this } };
+        }
+    }
+
+    return Buffer{ new std::byte[_bufferSize], BufferDeleter{ this } };
+}
+
+void AsyncFileReader::releaseBuffer(std::byte* data)
+{
+    if (data >= _bufferPool.data() && data < _bufferPool.data() + _bufferPool.size())
+    {
+        const std::scoped_lock lock{ _freeBuffersMutex };
+        _freeBuffers.push_back(data);
+    }
+    else
+    {
+        delete[] data;
+    }
+}
+
+std::optional<unsigned> AsyncFileReader::getRegisteredBufferIndex(std::span<const std::byte> buffer) const
+{
+    if (!_bufferPoolRegistered || buffer.empty())
+        return std::nullopt;
+
+    const std::byte* poolBegin{ _bufferPool.data() };
+    if (buffer.data() < poolBegin || buffer.data() >= poolBegin + _bufferPool.size())
+        return std::nullopt;
+
+    const std::size_t index{ static_cast<std::size_t>(buffer.data() - poolBegin) / _bufferSize };
+    // must fit in the registered buffer
+    if (buffer.data() + buffer.size() > poolBegin + (index + 1) * _bufferSize)
+        return std::nullopt;
+
+    return static_cast<unsigned>(index);
+}
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include <boost/asio/io_context.hpp>
+
+#include "utils/IAsyncFileReader.hpp"
+#include "utils/IOContextRunner.hpp"
+
+class AsyncFileReader final : public IAsyncFileReader
+{
+public:
+    AsyncFileReader(const AsyncFileReaderParameters& parameters);
+    ~AsyncFileReader() override;
+
+    AsyncFileReader(const AsyncFileReader&) = delete;
+    AsyncFileReader& operator=(const AsyncFileReader&) = delete;
+
+private:
+    void asyncRead(int fd, std::uint64_t offset, std::span<std::byte> buffer, ReadCallback callback) override;
+    void prefetch(const std::filesystem::path& path, std::size_t size) override;
+    Buffer acquireBuffer() override;
+    std::size_t getBufferSize() const override { return _bufferSize; }
+    void releaseBuffer(std::byte* data) override;
+
+    struct ReadOperation
+    {
+        int fd;
+        std::uint64_t offset;
+        std::span<std::byte> buffer;
+        std::size_t readSize{};
+        ReadCallback callback;
+    };
+    void submitRead(ReadOperation* operation);
+    void onReadComplete(ReadOperation* operation, int result); // result is the read size, or -errno
+    void readUsingThreadPool(ReadOperation* operation);
+    std::optional<unsigned> getRegisteredBufferIndex(std::span<const std::byte> buffer) const;
+
+    // in flight reads
+    const std::size_t _queueDepth;
+    std::mutex _queueMutex;
+    std::condition_variable _queueCondition;
+    std::size_t _inFlightCount{};
+
+    // buffer pool, a single allocation
+    const std::size_t _bufferSize;
+    std::vector<std::byte> _bufferPool;
+    bool _bufferPoolRegistered{};
+    std::mutex _freeBuffersMutex;
+    std::vector<std::byte*> _freeBuffers;
+
+    class IoUring;
+    std::unique_ptr<IoUring> _ioUring; // not set if io_uring is not used
+
+    boost::asio::io_context _ioContext;
+    IOContextRunner _ioContextRunner;
+};
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "utils/AsyncLogger.hpp"
+
+#include <sstream>
+#include <vector>
+
+#include "utils/LogFilter.hpp"
+
+AsyncLogger::AsyncLogger(const LogFilter& filter, std::size_t queueCapacity, Writer writer)
+    : _filter{ filter }
+    , _writer{ std::move(writer) }
+    , _queue{ queueCapacity }
+    , _thread{ [this] { run(); } }
+{
+}
+
+AsyncLogger::~AsyncLogger()
+{
+    _stopRequested.store(true);
+    _hasPendingRecords.store(true);
+    _hasPendingRecords.notify_one();
+
+    _thread.join();
+}
+
+bool AsyncLogger::isSeverityActive(Module module, Severity severity) const
+{
+    return _filter.isSeverityActive(module, severity);
+}
+
+void AsyncLogger::processLog(const Log& log)
+{
+    Record record{ log.getSeverity(), log.getModule(), std::this_thread::get_id(), log.getMessage() };
+
+    // may be the last log before the process ends
+    if (record.severity == Severity::FATAL)
+    {
+        write(record);
+        return;
+    }
+
+    if (!_queue.tryPush(std::move(record)))
+    {
+        _droppedCount.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    // only wakes up the writer thread if it is not already going to process the queue
+    if (!_hasPendingRecords.exchange(true))
+        _hasPendingRecords.notify_one();
+}
+
+void AsyncLogger::run()
+{
+    constexpr std::size_t maxBatchSize{ 256 };
+
+    std::vector<Record> records;
+    records.reserve(maxBatchSize);
+
+    while (true)
+    {
+        _hasPendingRecords.wait(false);
+        // cleared before draining: logs queued meanwhile will wake us up again
+        _hasPendingRecords.store(false);
+
+        while (_queue.tryPopBatch(records, maxBatchSize) > 0)
+        {
+            for (const Record& record : records)
+                write(record);
+            records.clear();
+        }
+
+        reportDroppedRecords();
+
+        if (_stopRequested.load())
+            break;
+    }
+}
+
+void AsyncLogger::write(const Record& record)
+{
+    const std::scoped_lock lock{ _writerMutex };
+    _writer(record);
+}
+
+void AsyncLogger::reportDroppedRecords()
+{
+    const std::uint64_t droppedCount{ getDroppedCount() };
+    if (droppedCount == _reportedDroppedCount)
+        return;
+
+    std::ostringstream oss;
+    oss << (droppedCount - _reportedDroppedCount) << " log records dropped (queue full)";
+    _reportedDroppedCount = droppedCount;
+
+    write(Record{ Severity::WARNING, Module::UTILS, std::this_thread::get_id(), oss.str() });
+}
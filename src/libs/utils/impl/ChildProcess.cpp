@@ -26,11 +26,11 @@
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <signal.h>
+#include <spawn.h>
 #include <unistd.h>
 
 #include <algorithm>
 #include <iostream>
-#include <mutex>
 
 #include <boost/asio/read.hpp>
 #include <boost/asio/buffer.hpp>
@@ -51,6 +51,25 @@ namespace
             : ChildProcessException{ errMsg + ": " + ec.message() }
         {}
     };
+
+    class SpawnFileActions
+    {
+    public:
+        SpawnFileActions()
+        {
+            if (const int res{ posix_spawn_file_actions_init(&_fileActions) }; res != 0)
+                throw SystemException{ res, "posix_spawn_file_actions_init failed!" };
+        }
+        ~SpawnFileActions() { posix_spawn_file_actions_destroy(&_fileActions); }
+
+        SpawnFileActions(const SpawnFileActions&) = delete;
+        SpawnFileActions& operator=(const SpawnFileActions&) = delete;
+
+        posix_spawn_file_actions_t* get() { return &_fileActions; }
+
+    private:
+        posix_spawn_file_actions_t _fileActions;
+    };
 }
 
 ChildProcess::ChildProcess(boost::asio::io_context& ioContext, const std::filesystem::path& path, const Args& args)
@@ -58,12 +77,10 @@ ChildProcess::ChildProcess(boost::asio::io_context& ioContext, const std::filesy
     , _childStdout{ _ioContext }
 
 {
-    // make sure only one thread is executing this part of code
-    static std::mutex mutex;
-    std::unique_lock<std::mutex> lock{ mutex };
-
+    SpawnFileActions fileActions;
     int pipe[2];
 
+    // O_CLOEXEC: no need to serialize spawns, the pipe of a process cannot leak into another one
     int res{ pipe2(pipe, O_NONBLOCK | O_CLOEXEC) };
     if (res < 0)
         throw SystemException{ errno, "pipe2 failed!" };
@@ -80,38 +97,45 @@ ChildProcess::ChildProcess(boost::asio::io_context& ioContext, const std::filesy
 #endif
     }
 
-    res = fork();
-    if (res == -1)
-        throw SystemException{ errno, "fork failed!" };
-
-    if (res == 0) // CHILD
+    // posix_spawn does not copy the address space of the parent (vfork like), and reports exec errors
     {
-        close(pipe[0]);
-        close(STDIN_FILENO);
-        close(STDERR_FILENO);
-
-        // Replace stdout with pipe write
-        if (dup2(pipe[1], STDOUT_FILENO) == -1)
-            exit(-1);
+        // Replace stdout with pipe write, stdin and stderr are not used
+        res = posix_spawn_file_actions_adddup2(fileActions.get(), pipe[1], STDOUT_FILENO);
+        if (res == 0)
+            res = posix_spawn_file_actions_addopen(fileActions.get(), STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+        if (res == 0)
+            res = posix_spawn_file_actions_addopen(fileActions.get(), STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+        if (res != 0)
+        {
+            close(pipe[0]);
+            close(pipe[1]);
+            throw SystemException{ res, "posix_spawn_file_actions failed!" };
+        }
 
-        std::vector<const char*> execArgs;
-        std::transform(std::cbegin(args), std::cend(args), std::back_inserter(execArgs), [](const std::string& arg) { return arg.c_str(); });
+        std::vector<char*> execArgs;
+        std::transform(std::cbegin(args), std::cend(args), std::back_inserter(execArgs), [](const std::string& arg) { return const_cast<char*>(arg.c_str()); });
         execArgs.push_back(nullptr);
 
-        res = execv(path.string().c_str(), (char* const*)&execArgs[0]);
-        if (res == -1)
-            exit(-1);
+        res = posix_spawn(&_childPID, path.c_str(), fileActions.get(), nullptr, execArgs.data(), environ);
     }
-    else // PARENT
+
+    close(pipe[1]);
+    if (res != 0)
+    {
+        close(pipe[0]);
+        throw SystemException{ res, "posix_spawn failed for '" + path.string() + "'" };
+    }
+
     {
-        close(pipe[1]);
+        boost::system::error_code assignError;
+        _childStdout.assign(pipe[0], assignError);
+        if (assignError)
         {
-            boost::system::error_code assignError;
-            _childStdout.assign(pipe[0], assignError);
-            if (assignError)
-                throw SystemException{ assignError, "fork failed!" };
+            close(pipe[0]);
+            kill();
+            wait(true);
+            throw SystemException{ assignError, "assign failed!" };
         }
-        _childPID = res;
     }
 }
 
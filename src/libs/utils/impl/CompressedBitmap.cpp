@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "utils/CompressedBitmap.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+namespace Utils
+{
+    void CompressedBitmap::Container::convertToBitmap()
+    {
+        words.assign(bitmapWordCount, 0);
+        for (const std::uint16_t low : values)
+            words[low / 64] |= std::uint64_t{ 1 } << (low % 64);
+
+        values.clear();
+        values.shrink_to_fit();
+    }
+
+    void CompressedBitmap::Container::convertToArray()
+    {
+        values.clear();
+        values.reserve(count);
+        for (std::size_t wordIndex{}; wordIndex < words.size(); ++wordIndex)
+        {
+            for (std::uint64_t word{ words[wordIndex] }; word != 0; word &= word - 1)
+                values.push_back(static_cast<std::uint16_t>(wordIndex * 64 + std::countr_zero(word)));
+        }
+
+        words.clear();
+        words.shrink_to_fit();
+    }
+
+    void CompressedBitmap::add(std::uint32_t value)
+    {
+        const std::uint16_t key{ static_cast<std::uint16_t>(value >> 16) };
+        const std::uint16_t low{ static_cast<std::uint16_t>(value & 0xFFFF) };
+
+        auto itContainer{ std::end(_containers) };
+        if (_containers.empty() || _containers.back().key < key)
+        {
+            itContainer = _containers.insert(itContainer, Container{ key });
+        }
+        else if (_containers.back().key != key)
+        {
+            itContainer = std::lower_bound(std::begin(_containers), std::end(_containers), key, [](const Container& container, std::uint16_t key) { return container.key < key; });
+            if (itContainer->key != key)
+                itContainer = _containers.insert(itContainer, Container{ key });
+        }
+        else
+        {
+            itContainer = std::prev(std::end(_containers));
+        }
+
+        Container& container{ *itContainer };
+        if (container.isBitmap())
+        {
+            std::uint64_t& word{ container.words[low / 64] };
+            const std::uint64_t mask{ std::uint64_t{ 1 } << (low % 64) };
+            if (!(word & mask))
+            {
+                word |= mask;
+                container.count++;
+            }
+            return;
+        }
+
+        if (container.values.empty() || container.values.back() < low)
+        {
+            container.values.push_back(low);
+        }
+        else
+        {
+            const auto it{ std::lower_bound(std::begin(container.values), std::end(container.values), low) };
+            if (*it == low)
+                return;
+
+            container.values.insert(it, low);
+        }
+
+        container.count++;
+        if (container.values.size() > maxArrayContainerSize)
+            container.convertToBitmap();
+    }
+
+    bool CompressedBitmap::contains(std::uint32_t value) const
+    {
+        const std::uint16_t key{ static_cast<std::uint16_t>(value >> 16) };
+        const std::uint16_t low{ static_cast<std::uint16_t>(value & 0xFFFF) };
+
+        const auto itContainer{ std::lower_bound(std::cbegin(_containers), std::cend(_containers), key, [](const Container& container, std::uint16_t key) { return container.key < key; }) };
+        if (itContainer == std::cend(_containers) || itContainer->key != key)
+            return false;
+
+        if (itContainer->isBitmap())
+            return itContainer->words[low / 64] & (std::uint64_t{ 1 } << (low % 64));
+
+        return std::binary_search(std::cbegin(itContainer->values), std::cend(itContainer->values), low);
+    }
+
+    std::size_t CompressedBitmap::getCount() const
+    {
+        std::size_t count{};
+        for (const Container& container : _containers)
+            count += container.count;
+
+        return count;
+    }
+
+    std::size_t CompressedBitmap::getMemoryUsage() const
+    {
+        std::size_t size{ sizeof(*this) + _containers.capacity() * sizeof(Container) };
+        for (const Container& container : _containers)
+            size += container.values.capacity() * sizeof(std::uint16_t) + container.words.capacity() * sizeof(std::uint64_t);
+
+        return size;
+    }
+
+    CompressedBitmap CompressedBitmap::intersect(const CompressedBitmap& lhs, const CompressedBitmap& rhs)
+    {
+        CompressedBitmap res;
+
+        auto itLhs{ std::cbegin(lhs._containers) };
+        auto itRhs{ std::cbegin(rhs._containers) };
+        while (itLhs != std::cend(lhs._containers) && itRhs != std::cend(rhs._containers))
+        {
+            if (itLhs->key < itRhs->key)
+            {
+                ++itLhs;
+                continue;
+            }
+            if (itRhs->key < itLhs->key)
+            {
+                ++itRhs;
+                continue;
+            }
+
+            Container container{ itLhs->key };
+            if (!itLhs->isBitmap() && !itRhs->isBitmap())
+            {
+                std::set_intersection(std::cbegin(itLhs->values), std::cend(itLhs->values), std::cbegin(itRhs->values), std::cend(itRhs->values), std::back_inserter(container.values));
+                container.count = static_cast<std::uint32_t>(container.values.size());
+            }
+            else if (itLhs->isBitmap() != itRhs->isBitmap())
+            {
+                const Container& arrayContainer{ itLhs->isBitmap() ? *itRhs : *itLhs };
+                const Container& bitmapContainer{ itLhs->isBitmap() ? *itLhs : *itRhs };
+                std::copy_if(std::cbegin(arrayContainer.values), std::cend(arrayContainer.values), std::back_inserter(container.values), [&](std::uint16_t low)
+                    {
+                        return bitmapContainer.words[low / 64] & (std::uint64_t{ 1 } << (low % 64));
+                    });
+                container.count = static_cast<std::uint32_t>(container.values.size());
+            }
+            else
+            {
+                container.words.resize(bitmapWordCount);
+                for (std::size_t i{}; i < bitmapWordCount; ++i)
+                {
+                    container.words[i] = itLhs->words[i] & itRhs->words[i];
+                    container.count += static_cast<std::uint32_t>(std::popcount(container.words[i]));
+                }
+
+                if (container.count <= maxArrayContainerSize)
+                    container.convertToArray();
+            }
+
+            if (container.count > 0)
+                res._containers.push_back(std::move(container));
+
+            ++itLhs;
+            ++itRhs;
+        }
+
+        return res;
+    }
+
+    std::vector<std::uint32_t> CompressedBitmap::toVector() const
+    {
+        std::vector<std::uint32_t> res;
+        res.reserve(getCount());
+        visit([&](std::uint32_t value) { res.push_back(value); });
+
+        return res;
+    }
+} // namespace Utils
@@ -19,6 +19,8 @@
 
 #include "Config.hpp"
 
+#include <libconfig.h++>
+
 #include "utils/Exception.hpp"
 #include "utils/ILogger.hpp"
 
@@ -29,9 +31,12 @@ std::unique_ptr<IConfig> createConfig(const std::filesystem::path& p)
 
 Config::Config(const std::filesystem::path& p)
 {
+	libconfig::Config config;
+
 	try
 	{
-		_config.readFile(p.string().c_str());
+		config.readFile(p.string().c_str());
+		addSettings(config.getRoot());
 	}
 	catch( libconfig::FileIOException& e)
 	{
@@ -47,88 +52,103 @@ Config::Config(const std::filesystem::path& p)
 	}
 }
 
-std::string_view
-Config::getString(std::string_view setting, std::string_view def)
+void
+Config::addSettings(const libconfig::Setting& group)
 {
-	try
+	for (int i {}; i < group.getLength(); ++i)
 	{
-		return static_cast<const char*>(_config.lookup(std::string {setting}));
-	}
-	catch (libconfig::ConfigException&)
-	{
-		return def;
+		const libconfig::Setting& setting {group[i]};
+
+		Value value;
+		switch (setting.getType())
+		{
+			case libconfig::Setting::TypeString:
+				value = std::string {static_cast<const char*>(setting)};
+				break;
+			case libconfig::Setting::TypeInt:
+			case libconfig::Setting::TypeInt64:
+				value = static_cast<long long>(setting);
+				break;
+			case libconfig::Setting::TypeBoolean:
+				value = static_cast<bool>(setting);
+				break;
+			case libconfig::Setting::TypeArray:
+			case libconfig::Setting::TypeList:
+			{
+				// only the leading strings are visited
+				Strings strings;
+				for (int j {}; j < setting.getLength() && setting[j].getType() == libconfig::Setting::TypeString; ++j)
+					strings.emplace_back(static_cast<const char*>(setting[j]));
+				value = std::move(strings);
+				break;
+			}
+			case libconfig::Setting::TypeGroup:
+				addSettings(setting);
+				break;
+			default:
+				break;
+		}
+
+		_values.emplace(setting.getPath(), std::move(value));
 	}
 }
 
+const Config::Value*
+Config::findValue(std::string_view setting) const
+{
+	auto it {_values.find(setting)};
+	return it != std::cend(_values) ? &it->second : nullptr;
+}
+
+std::string_view
+Config::getString(std::string_view setting, std::string_view def)
+{
+	const std::string* value {find<std::string>(setting)};
+	return value ? std::string_view {*value} : def;
+}
+
 void
 Config::visitStrings(std::string_view setting, std::function<void(std::string_view)> _func, std::initializer_list<std::string_view> defs)
 {
-	try
-	{
-		const libconfig::Setting& values {_config.lookup(std::string {setting})};
-		for (int i {}; i < values.getLength(); ++i)
-			_func(static_cast<const char*>(values[i]));
-	}
-	catch (const libconfig::SettingNotFoundException&)
+	const Value* value {findValue(setting)};
+	if (!value)
 	{
 		for (std::string_view def : defs)
 			_func(def);
+		return;
 	}
-	catch (libconfig::ConfigException&)
+
+	if (const Strings* strings {std::get_if<Strings>(value)})
 	{
+		for (const std::string& str : *strings)
+			_func(str);
 	}
 }
 
 std::filesystem::path
 Config::getPath(std::string_view setting, const std::filesystem::path& path)
 {
-	try
-	{
-		const char* res {_config.lookup(std::string {setting})};
-		return std::filesystem::path {std::string(res)};
-	}
-	catch (libconfig::ConfigException&)
-	{
-		return path;
-	}
+	const std::string* value {find<std::string>(setting)};
+	return value ? std::filesystem::path {*value} : path;
 }
 
 unsigned long
 Config::getULong(std::string_view setting, unsigned long def)
 {
-	try
-	{
-		return static_cast<unsigned int>(_config.lookup(std::string {setting}));
-	}
-	catch (libconfig::ConfigException&)
-	{
-		return def;
-	}
+	const long long* value {find<long long>(setting)};
+	return value ? static_cast<unsigned int>(*value) : def;
 }
 
 long
 Config::getLong(std::string_view setting, long def)
 {
-	try
-	{
-		return _config.lookup(std::string {setting});
-	}
-	catch (libconfig::ConfigException&)
-	{
-		return def;
-	}
+	const long long* value {find<long long>(setting)};
+	return value ? static_cast<long>(*value) : def;
 }
 
 bool
 Config::getBool(std::string_view setting, bool def)
 {
-	try
-	{
-		return _config.lookup(std::string {setting});
-	}
-	catch (libconfig::ConfigException&)
-	{
-		return def;
-	}
+	const bool* value {find<bool>(setting)};
+	return value ? *value : def;
 }
-
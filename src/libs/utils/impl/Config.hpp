@@ -20,9 +20,18 @@
 
 #include "utils/IConfig.hpp"
 
-#include <libconfig.h++>
+#include <string>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+namespace libconfig
+{
+	class Setting;
+}
 
 // Used to get config values from configuration files
+// The file is compiled into a flat table of typed values on construction: lookups do not allocate nor throw
 class Config final : public IConfig
 {
 	public:
@@ -43,7 +52,25 @@ class Config final : public IConfig
 		bool		getBool(std::string_view setting, bool def = false) override;
 
 	private:
+		struct OtherValue {}; // existing setting, not readable by any getter (float, group, ...)
+		using Strings = std::vector<std::string>;
+		using Value = std::variant<OtherValue, std::string, long long, bool, Strings>;
 
-		libconfig::Config _config;
-};
+		struct StringHash
+		{
+			using is_transparent = void;
+			std::size_t operator()(std::string_view str) const { return std::hash<std::string_view>{}(str); }
+		};
 
+		void			addSettings(const libconfig::Setting& group);
+		const Value*	findValue(std::string_view setting) const;
+
+		template <typename T>
+		const T* find(std::string_view setting) const
+		{
+			const Value* value {findValue(setting)};
+			return value ? std::get_if<T>(value) : nullptr;
+		}
+
+		std::unordered_map<std::string, Value, StringHash, std::equal_to<>> _values;
+};
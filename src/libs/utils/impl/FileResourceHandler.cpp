@@ -19,9 +19,24 @@
 
 #include "FileResourceHandler.hpp"
 
-#include <fstream>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sstream>
 
 #include "utils/ILogger.hpp"
+#include "utils/Random.hpp"
+
+namespace
+{
+    constexpr std::size_t maxPartCount{ 16 };
+    constexpr std::size_t boundarySize{ 32 };
+    constexpr ::uint64_t willNeedSize{ 512 * 1024 };
+}
 
 std::unique_ptr<IResourceHandler>
 createFileResourceHandler(const std::filesystem::path& path, std::string_view mimeType)
@@ -35,102 +50,205 @@ FileResourceHandler::FileResourceHandler(const std::filesystem::path& path, std:
 {
 }
 
-Wt::Http::ResponseContinuation*
-FileResourceHandler::processRequest(const Wt::Http::Request& request, Wt::Http::Response& response)
+FileResourceHandler::~FileResourceHandler()
 {
-    ::uint64_t startByte{ _offset };
-    std::ifstream ifs{ _path.string().c_str(), std::ios::in | std::ios::binary };
+    _fileReader.reset(); // may still be reading
+    if (_fd >= 0)
+        ::close(_fd);
+}
 
-    if (startByte == 0)
+bool
+FileResourceHandler::init(const Wt::Http::Request& request, Wt::Http::Response& response)
+{
+    _fd = ::open(_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (_fd < 0)
     {
-        if (!ifs)
-        {
-            LMS_LOG(UTILS, ERROR, "Cannot open file stream for '" << _path.string() << "'");
-            response.setStatus(404);
-            return {};
-        }
+        LMS_LOG(UTILS, ERROR, "Cannot open file '" << _path.string() << "': " << ::strerror(errno));
+        response.setStatus(404);
+        return false;
+    }
 
-        ifs.seekg(0, std::ios::end);
-        const ::uint64_t fileSize{ static_cast<::uint64_t>(ifs.tellg()) };
-        ifs.seekg(0, std::ios::beg);
+    struct stat fileStat;
+    if (::fstat(_fd, &fileStat) < 0)
+    {
+        LMS_LOG(UTILS, ERROR, "Cannot get size of file '" << _path.string() << "': " << ::strerror(errno));
+        response.setStatus(404);
+        return false;
+    }
+    _fileSize = static_cast<::uint64_t>(fileStat.st_size);
 
-        LMS_LOG(UTILS, DEBUG, "File '" << _path.string() << "', fileSize = " << fileSize);
+    LMS_LOG(UTILS, DEBUG, "File '" << _path.string() << "', fileSize = " << _fileSize);
 
-        response.addHeader("Accept-Ranges", "bytes");
-        
-        const Wt::Http::Request::ByteRangeSpecifier ranges{ request.getRanges(fileSize) };
-        if (!ranges.isSatisfiable())
-        {
-            std::ostringstream contentRange;
-            contentRange << "bytes */" << fileSize;
-            response.setStatus(416); // Requested range not satisfiable
-            response.addHeader("Content-Range", contentRange.str());
+    response.addHeader("Accept-Ranges", "bytes");
 
-            LMS_LOG(UTILS, DEBUG, "Range not satisfiable");
-            return {};
-        }
+    const Wt::Http::Request::ByteRangeSpecifier ranges{ request.getRanges(_fileSize) };
+    if (!ranges.isSatisfiable())
+    {
+        std::ostringstream contentRange;
+        contentRange << "bytes */" << _fileSize;
+        response.setStatus(416); // Requested range not satisfiable
+        response.addHeader("Content-Range", contentRange.str());
 
-        if (ranges.size() == 1)
-        {
-            LMS_LOG(UTILS, DEBUG, "Range requested = " << ranges[0].firstByte() << "-" << ranges[0].lastByte());
+        LMS_LOG(UTILS, DEBUG, "Range not satisfiable");
+        return false;
+    }
 
-            response.setStatus(206);
-            startByte = ranges[0].firstByte();
-            _beyondLastByte = ranges[0].lastByte() + 1;
+    if (ranges.size() == 1)
+    {
+        LMS_LOG(UTILS, DEBUG, "Range requested = " << ranges[0].firstByte() << "-" << ranges[0].lastByte());
 
-            std::ostringstream contentRange;
-            contentRange << "bytes " << startByte << "-"
-                << _beyondLastByte - 1 << "/" << fileSize;
+        const Part part{ ranges[0].firstByte(), ranges[0].lastByte() + 1 };
+        _parts.push_back(part);
 
-            response.addHeader("Content-Range", contentRange.str());
-            response.setContentLength(_beyondLastByte - startByte);
-        }
-        else
-        {
-            LMS_LOG(UTILS, DEBUG, "No range requested");
+        std::ostringstream contentRange;
+        contentRange << "bytes " << part.firstByte << "-" << part.beyondLastByte - 1 << "/" << _fileSize;
 
-            response.setStatus(200);
-            _beyondLastByte = fileSize;
-            response.setContentLength(_beyondLastByte);
-        }
+        response.setStatus(206);
+        response.addHeader("Content-Range", contentRange.str());
+        response.setContentLength(part.beyondLastByte - part.firstByte);
 
         LMS_LOG(UTILS, DEBUG, "Mimetype set to '" << _mimeType << "'");
         response.setMimeType(_mimeType);
     }
-    else if (!ifs)
+    else if (ranges.size() > 1 && ranges.size() <= maxPartCount)
     {
-        LMS_LOG(UTILS, ERROR, "Cannot reopen file stream for '" << _path.string() << "'");
-        return {};
+        LMS_LOG(UTILS, DEBUG, ranges.size() << " ranges requested");
+
+        for (const auto& range : ranges)
+            _parts.push_back(Part{ range.firstByte(), range.lastByte() + 1 });
+
+        _boundary.resize(boundarySize);
+        for (char& c : _boundary)
+            c = "0123456789abcdef"[Random::getRandom(0, 15)];
+
+        ::uint64_t contentLength{ getClosingBoundary().size() };
+        for (std::size_t partIndex{}; partIndex < _parts.size(); ++partIndex)
+            contentLength += getPartHeader(partIndex).size() + (_parts[partIndex].beyondLastByte - _parts[partIndex].firstByte);
+
+        response.setStatus(206);
+        response.setContentLength(contentLength);
+        response.setMimeType("multipart/byteranges; boundary=" + _boundary);
+    }
+    else
+    {
+        // too many ranges are served as a whole, as they may be used to make us seek all over the file
+        LMS_LOG(UTILS, DEBUG, (ranges.size() ? "Too many ranges requested" : "No range requested"));
+
+        _parts.push_back(Part{ 0, _fileSize });
+
+        response.setStatus(200);
+        response.setContentLength(_fileSize);
+
+        LMS_LOG(UTILS, DEBUG, "Mimetype set to '" << _mimeType << "'");
+        response.setMimeType(_mimeType);
+    }
+
+    adviseReadPattern();
+    return true;
+}
+
+void
+FileResourceHandler::adviseReadPattern() const
+{
+    for (const Part& part : _parts)
+    {
+        const ::uint64_t partSize{ part.beyondLastByte - part.firstByte };
+#if defined(POSIX_FADV_SEQUENTIAL)
+        ::posix_fadvise(_fd, static_cast<::off_t>(part.firstByte), static_cast<::off_t>(partSize), POSIX_FADV_SEQUENTIAL);
+#endif
+#if defined(POSIX_FADV_WILLNEED)
+        // only the head of each part: the rest will be read ahead by the kernel thanks to the sequential hint
+        ::posix_fadvise(_fd, static_cast<::off_t>(part.firstByte), static_cast<::off_t>(std::min(partSize, willNeedSize)), POSIX_FADV_WILLNEED);
+#endif
     }
+}
 
-    ifs.seekg(static_cast<std::istream::pos_type>(startByte));
+std::string
+FileResourceHandler::getPartHeader(std::size_t partIndex) const
+{
+    const Part& part{ _parts[partIndex] };
 
-    std::vector<char> buf;
-    buf.resize(_chunkSize);
+    std::ostringstream oss;
+    if (partIndex > 0)
+        oss << "\r\n";
+    oss << "--" << _boundary << "\r\n"
+        << "Content-Type: " << _mimeType << "\r\n"
+        << "Content-Range: bytes " << part.firstByte << "-" << part.beyondLastByte - 1 << "/" << _fileSize << "\r\n"
+        << "\r\n";
 
-    ::uint64_t restSize = _beyondLastByte - startByte;
-    ::uint64_t pieceSize = buf.size() > restSize ? restSize : buf.size();
+    return oss.str();
+}
 
-    ifs.read(&buf[0], pieceSize);
-    const ::uint64_t actualPieceSize{ static_cast<::uint64_t>(ifs.gcount()) };
-    if (actualPieceSize > 0)
+std::string
+FileResourceHandler::getClosingBoundary() const
+{
+    return "\r\n--" + _boundary + "--\r\n";
+}
+
+Wt::Http::ResponseContinuation*
+FileResourceHandler::processRequest(const Wt::Http::Request& request, Wt::Http::Response& response)
+{
+    if (!_initialized)
     {
-        response.out().write(&buf[0], actualPieceSize);
-        LMS_LOG(UTILS, DEBUG, "Written " << actualPieceSize << " bytes, range = " << startByte << "-" << startByte + actualPieceSize - 1 << "");
+        _initialized = true;
+        if (!init(request, response))
+            return {};
+    }
+    else if (_parts.empty()) // already failed
+        return {};
+
+    const bool isMultipart{ !_boundary.empty() };
+    const Part& part{ _parts[_currentPartIndex] };
+
+    if (!_fileReader)
+    {
+        if (isMultipart)
+            response.out() << getPartHeader(_currentPartIndex);
+
+        _fileReader = std::make_unique<SequentialFileReader>(_fd, part.firstByte, part.beyondLastByte);
+    }
+
+    const ::uint64_t startByte{ _fileReader->getOffset() };
+    std::span<const std::byte> piece;
+    try
+    {
+        piece = _fileReader->readNext();
+    }
+    catch (const std::system_error& e)
+    {
+        LMS_LOG(UTILS, ERROR, "Cannot read file '" << _path.string() << "': " << e.what());
+        return {};
+    }
+
+    if (!piece.empty())
+    {
+        response.out().write(reinterpret_cast<const char*>(piece.data()), piece.size());
+        LMS_LOG(UTILS, DEBUG, "Written " << piece.size() << " bytes, range = " << startByte << "-" << startByte + piece.size() - 1 << "");
     }
     else
     {
         LMS_LOG(UTILS, DEBUG, "Written 0 byte");
     }
 
-    if (ifs.good() && actualPieceSize < restSize)
+    // empty means end of file (may have been truncated meanwhile)
+    if (!piece.empty() && _fileReader->getOffset() < part.beyondLastByte)
+    {
+        LMS_LOG(UTILS, DEBUG, "Job not complete! Remaining range: " << _fileReader->getOffset() << "-" << part.beyondLastByte - 1);
+
+        return response.createContinuation();
+    }
+
+    _fileReader.reset();
+    if (!piece.empty() && ++_currentPartIndex < _parts.size())
     {
-        _offset = startByte + actualPieceSize;
-        LMS_LOG(UTILS, DEBUG, "Job not complete! Remaining range: " << _offset << "-" << _beyondLastByte - 1);
+        LMS_LOG(UTILS, DEBUG, "Part complete, next part = " << _currentPartIndex);
 
         return response.createContinuation();
     }
 
+    if (isMultipart)
+        response.out() << getClosingBoundary();
+
     LMS_LOG(UTILS, DEBUG, "Job complete!");
     return nullptr;
 }
@@ -20,24 +20,46 @@
 #pragma once
 
 #include <filesystem>
+#include <memory>
 #include <string>
 #include <string_view>
+#include <vector>
+
 #include "utils/IResourceHandler.hpp"
+#include "SequentialFileReader.hpp"
 
 class FileResourceHandler final : public IResourceHandler
 {
 public:
     FileResourceHandler(const std::filesystem::path& filePath, std::string_view mimeType);
+    ~FileResourceHandler() override;
+
+    FileResourceHandler(const FileResourceHandler&) = delete;
+    FileResourceHandler& operator=(const FileResourceHandler&) = delete;
 
 private:
     Wt::Http::ResponseContinuation* processRequest(const Wt::Http::Request& request, Wt::Http::Response& response) override;
     void abort() override {};
 
-    static constexpr std::size_t _chunkSize{ 262'144 };
+    struct Part
+    {
+        ::uint64_t firstByte{};
+        ::uint64_t beyondLastByte{};
+    };
+
+    bool init(const Wt::Http::Request& request, Wt::Http::Response& response);
+    void adviseReadPattern() const;
+    std::string getPartHeader(std::size_t partIndex) const;
+    std::string getClosingBoundary() const;
 
     std::filesystem::path   _path;
     std::string             _mimeType;
-    ::uint64_t              _beyondLastByte{};
-    ::uint64_t              _offset{};
+    ::uint64_t              _fileSize{};
+    int                     _fd{ -1 };  // kept open across continuations
+    bool                    _initialized{};
+    std::vector<Part>       _parts;     // several parts means a multipart/byteranges response
+    std::string             _boundary;  // only used for multipart responses
+    std::size_t             _currentPartIndex{};
+    std::unique_ptr<SequentialFileReader> _fileReader; // reads the next chunk of the current part while the current one is sent
 };
 
@@ -19,19 +19,55 @@
 
 #include "utils/IOContextRunner.hpp"
 
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+#include <cerrno>
 #include <cstdlib>
+#include <cstring>
 
 #include "utils/ILogger.hpp"
 
+namespace
+{
+    void setCurrentThreadAffinity(std::string_view name, std::span<const unsigned> cpus)
+    {
+#if defined(__linux__)
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        for (const unsigned cpu : cpus)
+        {
+            if (cpu < CPU_SETSIZE)
+                CPU_SET(cpu, &cpuSet);
+        }
+
+        // On Linux, pid 0 means the calling thread
+        if (::sched_setaffinity(0, sizeof(cpuSet), &cpuSet) < 0)
+            LMS_LOG(UTILS, WARNING, "Cannot set the CPU affinity of IO context '" << name << "': " << ::strerror(errno));
+#else
+        LMS_LOG(UTILS, WARNING, "Cannot set the CPU affinity of IO context '" << name << "': not supported on this platform");
+#endif
+    }
+}
+
 IOContextRunner::IOContextRunner(boost::asio::io_service& ioService, std::size_t threadCount)
+    : IOContextRunner{ ioService, threadCount, "default" }
+{
+}
+
+IOContextRunner::IOContextRunner(boost::asio::io_service& ioService, std::size_t threadCount, std::string_view name, std::span<const unsigned> cpus)
     : _ioService{ ioService }
     , _work{ ioService }
 {
-    LMS_LOG(UTILS, INFO, "Starting IO context with " << threadCount << " threads...");
+    LMS_LOG(UTILS, INFO, "Starting IO context '" << name << "' with " << threadCount << " threads" << (cpus.empty() ? "" : ", pinned to " + std::to_string(cpus.size()) + " CPUs") << "...");
     for (std::size_t i{}; i < threadCount; ++i)
     {
-        _threads.emplace_back([&]
+        _threads.emplace_back([this, name = std::string{ name }, cpus = std::vector<unsigned>(std::cbegin(cpus), std::cend(cpus))]
             {
+                if (!cpus.empty())
+                    setCurrentThreadAffinity(name, cpus);
+
                 try
                 {
                     _ioService.run();
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "utils/LogFilter.hpp"
+
+LogFilter::LogFilter(Severity minSeverity)
+{
+    setMinSeverity(minSeverity);
+}
+
+Severity LogFilter::getMinSeverity(Module module) const
+{
+    return _minSeverities[static_cast<std::size_t>(module)].load(std::memory_order_relaxed);
+}
+
+LogFilter::Severities LogFilter::getMinSeverities() const
+{
+    Severities severities;
+    for (std::size_t i{}; i < moduleCount; ++i)
+        severities[i] = _minSeverities[i].load(std::memory_order_relaxed);
+
+    return severities;
+}
+
+Severity LogFilter::getMaxMinSeverity() const
+{
+    Severity res{ Severity::FATAL };
+    for (const std::atomic<Severity>& minSeverity : _minSeverities)
+    {
+        const Severity severity{ minSeverity.load(std::memory_order_relaxed) };
+        if (static_cast<int>(severity) > static_cast<int>(res))
+            res = severity;
+    }
+
+    return res;
+}
+
+void LogFilter::setMinSeverity(Module module, Severity severity)
+{
+    _minSeverities[static_cast<std::size_t>(module)].store(severity, std::memory_order_relaxed);
+}
+
+void LogFilter::setMinSeverity(Severity severity)
+{
+    for (std::atomic<Severity>& minSeverity : _minSeverities)
+        minSeverity.store(severity, std::memory_order_relaxed);
+}
+
+void LogFilter::setMinSeverities(const Severities& severities)
+{
+    for (std::size_t i{}; i < moduleCount; ++i)
+        _minSeverities[i].store(severities[i], std::memory_order_relaxed);
+}
@@ -59,6 +59,29 @@ const char* getSeverityName(Severity sev)
     return "";
 }
 
+std::optional<Module> parseModuleName(std::string_view name)
+{
+    for (std::size_t i{}; i < moduleCount; ++i)
+    {
+        const Module module{ static_cast<Module>(i) };
+        if (StringUtils::stringCaseInsensitiveEqual(name, getModuleName(module)))
+            return module;
+    }
+
+    return std::nullopt;
+}
+
+std::optional<Severity> parseSeverityName(std::string_view name)
+{
+    for (Severity severity : { Severity::FATAL, Severity::ERROR, Severity::WARNING, Severity::INFO, Severity::DEBUG })
+    {
+        if (StringUtils::stringCaseInsensitiveEqual(name, getSeverityName(severity)))
+            return severity;
+    }
+
+    return std::nullopt;
+}
+
 Log::Log(ILogger& logger, Module module, Severity severity)
     : _logger{ logger }
     , _module{ module }
@@ -68,7 +91,7 @@ Log::Log(ILogger& logger, Module module, Severity severity)
 
 Log::~Log()
 {
-    assert(_logger.isSeverityActive(_severity));
+    assert(_logger.isSeverityActive(_module, _severity));
     _logger.processLog(*this);
 }
 
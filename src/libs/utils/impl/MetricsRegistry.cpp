@@ -0,0 +1,267 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "MetricsRegistry.hpp"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <limits>
+#include <sstream>
+
+#include "utils/Exception.hpp"
+
+namespace Metrics
+{
+    namespace
+    {
+        bool isValidName(std::string_view name, bool allowColons)
+        {
+            auto isValidChar{ [=](char c, bool first)
+                {
+                    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || (allowColons && c == ':') || (!first && c >= '0' && c <= '9');
+                } };
+
+            if (name.empty() || !isValidChar(name.front(), true))
+                return false;
+
+            return std::all_of(std::next(std::cbegin(name)), std::cend(name), [&](char c) { return isValidChar(c, false); });
+        }
+
+        void writeEscaped(std::ostream& os, std::string_view str, bool escapeQuotes)
+        {
+            for (const char c : str)
+            {
+                switch (c)
+                {
+                case '\\': os << "\\\\"; break;
+                case '\n': os << "\\n"; break;
+                case '"':
+                    if (escapeQuotes)
+                        os << "\\\"";
+                    else
+                        os << c;
+                    break;
+                default: os << c;
+                }
+            }
+        }
+
+        std::string formatLabels(const Labels& labels)
+        {
+            std::ostringstream oss;
+            for (const auto& [name, value] : labels)
+            {
+                if (!isValidName(name, false) || name.starts_with("__") || name == "le")
+                    throw LmsException{ "Invalid metric label name '" + name + "'" };
+
+                if (oss.tellp() > 0)
+                    oss << ',';
+                oss << name << "=\"";
+                writeEscaped(oss, value, true);
+                oss << '"';
+            }
+
+            return oss.str();
+        }
+
+        void writeValue(std::ostream& os, double value)
+        {
+            if (std::isinf(value))
+            {
+                os << (value > 0 ? "+Inf" : "-Inf");
+                return;
+            }
+            if (std::isnan(value))
+            {
+                os << "NaN";
+                return;
+            }
+
+            std::array<char, 32> buffer;
+            const auto [end, error]{ std::to_chars(buffer.data(), buffer.data() + buffer.size(), value) };
+            os << std::string_view{ buffer.data(), static_cast<std::size_t>(end - buffer.data()) };
+        }
+
+        void writeSample(std::ostream& os, std::string_view name, std::string_view suffix, std::string_view labels, std::string_view extraLabel = {})
+        {
+            os << name << suffix;
+            if (!labels.empty() || !extraLabel.empty())
+            {
+                os << '{' << labels;
+                if (!labels.empty() && !extraLabel.empty())
+                    os << ',';
+                os << extraLabel << '}';
+            }
+            os << ' ';
+        }
+    }
+
+    Histogram::Histogram(std::span<const double> upperBounds)
+        : _upperBounds(std::cbegin(upperBounds), std::cend(upperBounds))
+        , _bucketCounts{ std::make_unique<std::atomic<std::uint64_t>[]>(_upperBounds.size() + 1) }
+    {
+        if (!std::is_sorted(std::cbegin(_upperBounds), std::cend(_upperBounds)))
+            throw LmsException{ "Histogram bucket upper bounds must be sorted" };
+    }
+
+    void Histogram::observe(double value)
+    {
+        // le semantics: the value goes in the first bucket whose upper bound is greater or equal
+        const auto itBucket{ std::lower_bound(std::cbegin(_upperBounds), std::cend(_upperBounds), value) };
+        _bucketCounts[std::distance(std::cbegin(_upperBounds), itBucket)].fetch_add(1, std::memory_order_relaxed);
+        _sum.fetch_add(value, std::memory_order_relaxed);
+        _count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    Histogram::Snapshot Histogram::getSnapshot() const
+    {
+        Snapshot snapshot;
+        snapshot.upperBounds = _upperBounds;
+        snapshot.cumulativeCounts.reserve(_upperBounds.size() + 1);
+
+        std::uint64_t cumulativeCount{};
+        for (std::size_t i{}; i < _upperBounds.size() + 1; ++i)
+        {
+            cumulativeCount += _bucketCounts[i].load(std::memory_order_relaxed);
+            snapshot.cumulativeCounts.push_back(cumulativeCount);
+        }
+        snapshot.sum = _sum.load(std::memory_order_relaxed);
+        // not read atomically with the buckets: report a count consistent with the +Inf bucket
+        snapshot.count = cumulativeCount;
+
+        return snapshot;
+    }
+
+    std::unique_ptr<IRegistry> createRegistry()
+    {
+        return std::make_unique<MetricsRegistry>();
+    }
+
+    MetricsRegistry::Family& MetricsRegistry::getFamily(std::string_view name, std::string_view help, Type type)
+    {
+        auto itFamily{ _families.find(name) };
+        if (itFamily == std::end(_families))
+        {
+            if (!isValidName(name, true))
+                throw LmsException{ "Invalid metric name '" + std::string{ name } + "'" };
+
+            itFamily = _families.emplace(std::string{ name }, Family{ type, std::string{ help }, {}, {}, {} }).first;
+        }
+        else if (itFamily->second.type != type)
+        {
+            throw LmsException{ "Metric '" + std::string{ name } + "' already registered using another type" };
+        }
+
+        return itFamily->second;
+    }
+
+    Counter& MetricsRegistry::getCounter(std::string_view name, std::string_view help, const Labels& labels)
+    {
+        std::scoped_lock lock{ _mutex };
+
+        std::unique_ptr<Counter>& counter{ getFamily(name, help, Type::Counter).counters[formatLabels(labels)] };
+        if (!counter)
+            counter = std::make_unique<Counter>();
+
+        return *counter;
+    }
+
+    Gauge& MetricsRegistry::getGauge(std::string_view name, std::string_view help, const Labels& labels)
+    {
+        std::scoped_lock lock{ _mutex };
+
+        std::unique_ptr<Gauge>& gauge{ getFamily(name, help, Type::Gauge).gauges[formatLabels(labels)] };
+        if (!gauge)
+            gauge = std::make_unique<Gauge>();
+
+        return *gauge;
+    }
+
+    Histogram& MetricsRegistry::getHistogram(std::string_view name, std::string_view help, std::span<const double> upperBounds, const Labels& labels)
+    {
+        std::scoped_lock lock{ _mutex };
+
+        auto& histograms{ getFamily(name, help, Type::Histogram).histograms };
+        const std::string formattedLabels{ formatLabels(labels) };
+
+        auto itHistogram{ histograms.find(formattedLabels) };
+        if (itHistogram == std::end(histograms))
+            itHistogram = histograms.emplace(formattedLabels, std::make_unique<Histogram>(upperBounds)).first;
+
+        return *itHistogram->second;
+    }
+
+    void MetricsRegistry::write(std::ostream& os) const
+    {
+        std::scoped_lock lock{ _mutex };
+
+        for (const auto& [name, family] : _families)
+        {
+            os << "# HELP " << name << ' ';
+            writeEscaped(os, family.help, false);
+            os << '\n';
+
+            switch (family.type)
+            {
+            case Type::Counter:
+                os << "# TYPE " << name << " counter\n";
+                for (const auto& [labels, counter] : family.counters)
+                {
+                    writeSample(os, name, "", labels);
+                    os << counter->get() << '\n';
+                }
+                break;
+
+            case Type::Gauge:
+                os << "# TYPE " << name << " gauge\n";
+                for (const auto& [labels, gauge] : family.gauges)
+                {
+                    writeSample(os, name, "", labels);
+                    os << gauge->get() << '\n';
+                }
+                break;
+
+            case Type::Histogram:
+                os << "# TYPE " << name << " histogram\n";
+                for (const auto& [labels, histogram] : family.histograms)
+                {
+                    const Histogram::Snapshot snapshot{ histogram->getSnapshot() };
+                    for (std::size_t i{}; i < snapshot.cumulativeCounts.size(); ++i)
+                    {
+                        std::ostringstream le;
+                        le << "le=\"";
+                        writeValue(le, i < snapshot.upperBounds.size() ? snapshot.upperBounds[i] : std::numeric_limits<double>::infinity());
+                        le << '"';
+
+                        writeSample(os, name, "_bucket", labels, le.str());
+                        os << snapshot.cumulativeCounts[i] << '\n';
+                    }
+                    writeSample(os, name, "_sum", labels);
+                    writeValue(os, snapshot.sum);
+                    os << '\n';
+                    writeSample(os, name, "_count", labels);
+                    os << snapshot.count << '\n';
+                }
+                break;
+            }
+        }
+    }
+} // namespace Metrics
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "utils/IMetricsRegistry.hpp"
+
+namespace Metrics
+{
+    class MetricsRegistry final : public IRegistry
+    {
+    public:
+        MetricsRegistry() = default;
+        ~MetricsRegistry() override = default;
+
+        MetricsRegistry(const MetricsRegistry&) = delete;
+        MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+    private:
+        Counter& getCounter(std::string_view name, std::string_view help, const Labels& labels) override;
+        Gauge& getGauge(std::string_view name, std::string_view help, const Labels& labels) override;
+        Histogram& getHistogram(std::string_view name, std::string_view help, std::span<const double> upperBounds, const Labels& labels) override;
+        void write(std::ostream& os) const override;
+
+        enum class Type
+        {
+            Counter,
+            Gauge,
+            Histogram,
+        };
+
+        // All the metrics sharing the same name, one per label set
+        struct Family
+        {
+            Type type;
+            std::string help;
+            std::map<std::string /* formatted labels */, std::unique_ptr<Counter>> counters;
+            std::map<std::string /* formatted labels */, std::unique_ptr<Gauge>> gauges;
+            std::map<std::string /* formatted labels */, std::unique_ptr<Histogram>> histograms;
+        };
+        Family& getFamily(std::string_view name, std::string_view help, Type type);
+
+        mutable std::mutex _mutex;
+        std::map<std::string, Family, std::less<>> _families;
+    };
+} // namespace Metrics
@@ -23,8 +23,12 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <array>
+#include <condition_variable>
 #include <fstream>
+#include <mutex>
+#include <thread>
 
 #include <boost/tokenizer.hpp>
 
@@ -59,6 +63,38 @@ namespace PathUtils
         return crc32.getResult();
     }
 
+    FileFingerprint computeFileFingerprint(const std::filesystem::path& p, std::size_t blockSize)
+    {
+        std::ifstream ifs{ p.string().c_str(), std::ios_base::binary };
+        if (!ifs)
+            throw LmsException("Failed to open file '" + p.string() + "'");
+
+        FileFingerprint fingerprint;
+        fingerprint.fileSize = std::filesystem::file_size(p);
+
+        Utils::Crc32Calculator crc32;
+        std::vector<char> buffer(blockSize);
+        auto processBlock{ [&](std::uintmax_t offset, std::size_t size)
+            {
+                ifs.seekg(offset);
+                ifs.read(buffer.data(), size);
+                if (static_cast<std::size_t>(ifs.gcount()) != size)
+                    throw LmsException("Failed to read file '" + p.string() + "'");
+
+                crc32.processBytes(reinterpret_cast<const std::byte*>(buffer.data()), size);
+            } };
+
+        processBlock(0, static_cast<std::size_t>(std::min<std::uintmax_t>(fingerprint.fileSize, blockSize)));
+        if (fingerprint.fileSize > blockSize)
+        {
+            const std::uintmax_t tailOffset{ std::max<std::uintmax_t>(blockSize, fingerprint.fileSize - blockSize) };
+            processBlock(tailOffset, static_cast<std::size_t>(fingerprint.fileSize - tailOffset));
+        }
+
+        fingerprint.crc32 = crc32.getResult();
+        return fingerprint;
+    }
+
     bool ensureDirectory(const std::filesystem::path& dir)
     {
         if (std::filesystem::exists(dir))
@@ -132,6 +168,139 @@ namespace PathUtils
         return true;
     }
 
+    namespace
+    {
+        struct DirectoryEntry
+        {
+            std::error_code ec;
+            std::filesystem::path path;
+        };
+
+        // List the files of a directory, and return its sub directories
+        void listDirectory(const std::filesystem::path& directory, const std::filesystem::path* excludeDirFileName, std::vector<DirectoryEntry>& files, std::vector<std::filesystem::path>& subDirectories)
+        {
+            std::error_code ec;
+            std::filesystem::directory_iterator itPath{ directory, std::filesystem::directory_options::follow_directory_symlink, ec };
+
+            if (ec)
+            {
+                files.push_back(DirectoryEntry{ ec, directory });
+                return;
+            }
+
+            if (excludeDirFileName && !excludeDirFileName->empty())
+            {
+                const std::filesystem::path excludePath{ directory / *excludeDirFileName };
+
+                if (std::filesystem::exists(excludePath, ec))
+                {
+                    LMS_LOG(DBUPDATER, DEBUG, "Found '" << excludePath.string() << "': skipping directory");
+                    return;
+                }
+            }
+
+            std::filesystem::directory_iterator itEnd;
+            while (itPath != itEnd)
+            {
+                if (ec)
+                {
+                    files.push_back(DirectoryEntry{ ec, *itPath });
+                }
+                else
+                {
+                    if (std::filesystem::is_regular_file(*itPath, ec))
+                    {
+                        files.push_back(DirectoryEntry{ ec, *itPath });
+                    }
+                    else if (std::filesystem::is_directory(*itPath, ec))
+                    {
+                        if (!ec)
+                            subDirectories.push_back(*itPath);
+                        else
+                            files.push_back(DirectoryEntry{ ec, *itPath });
+                    }
+                }
+
+                itPath.increment(ec);
+            }
+        }
+    }
+
+    bool exploreFilesRecursiveParallel(const std::filesystem::path& directory, std::function<bool(std::error_code, const std::filesystem::path&)> cb, const std::filesystem::path* excludeDirFileName, std::size_t threadCount)
+    {
+        if (threadCount <= 1)
+            return exploreFilesRecursive(directory, cb, excludeDirFileName);
+
+        std::mutex mutex;
+        std::condition_variable condVar;
+        std::vector<std::filesystem::path> pendingDirectories{ directory }; // used as a stack to favor depth first exploration
+        std::size_t ongoingDirectoryCount{};
+        bool aborted{};
+
+        std::mutex cbMutex;
+
+        auto worker{ [&]
+        {
+            std::vector<DirectoryEntry> files;
+            std::vector<std::filesystem::path> subDirectories;
+
+            while (true)
+            {
+                std::filesystem::path currentDirectory;
+                {
+                    std::unique_lock lock{ mutex };
+                    condVar.wait(lock, [&] { return aborted || !pendingDirectories.empty() || ongoingDirectoryCount == 0; });
+
+                    // nothing left to explore or being explored
+                    if (aborted || pendingDirectories.empty())
+                        return;
+
+                    currentDirectory = std::move(pendingDirectories.back());
+                    pendingDirectories.pop_back();
+                    ongoingDirectoryCount++;
+                }
+
+                files.clear();
+                subDirectories.clear();
+                listDirectory(currentDirectory, excludeDirFileName, files, subDirectories);
+
+                bool continueExploring{ true };
+                {
+                    std::scoped_lock lock{ cbMutex };
+                    for (const DirectoryEntry& file : files)
+                    {
+                        if (!cb(file.ec, file.path))
+                        {
+                            continueExploring = false;
+                            break;
+                        }
+                    }
+                }
+
+                {
+                    std::scoped_lock lock{ mutex };
+
+                    ongoingDirectoryCount--;
+                    if (!continueExploring)
+                        aborted = true;
+                    else
+                        pendingDirectories.insert(std::end(pendingDirectories), std::make_move_iterator(std::begin(subDirectories)), std::make_move_iterator(std::end(subDirectories)));
+                }
+                condVar.notify_all();
+            }
+        } };
+
+        std::vector<std::thread> threads;
+        threads.reserve(threadCount);
+        for (std::size_t i{}; i < threadCount; ++i)
+            threads.emplace_back(worker);
+
+        for (std::thread& thread : threads)
+            thread.join();
+
+        return !aborted;
+    }
+
     bool hasFileAnyExtension(const std::filesystem::path& file, const std::vector<std::filesystem::path>& supportedExtensions)
     {
         const std::filesystem::path extension{ StringUtils::stringToLower(file.extension().string()) };
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ResourceGovernor.hpp"
+
+#include <cassert>
+#include <thread>
+
+#include "utils/ILogger.hpp"
+
+namespace
+{
+    constexpr double latencyWeight{ 0.2 }; // of the last request in the average
+    constexpr std::chrono::milliseconds pauseStep{ 50 };
+}
+
+std::unique_ptr<IResourceGovernor> createResourceGovernor(const ResourceGovernorParameters& parameters)
+{
+    return std::make_unique<ResourceGovernor>(parameters);
+}
+
+ResourceGovernor::ResourceGovernor(const ResourceGovernorParameters& parameters)
+    : _parameters{ parameters }
+{
+    LMS_LOG(UTILS, INFO, "Background jobs are throttled by " << _parameters.streamDelay.count() << " ms while streaming, paused while the request latency is above " << _parameters.latencyThreshold.count() << " ms");
+}
+
+void ResourceGovernor::onStreamStarted()
+{
+    const std::scoped_lock lock{ _mutex };
+    _activeStreamCount++;
+}
+
+void ResourceGovernor::onStreamEnded()
+{
+    const std::scoped_lock lock{ _mutex };
+    assert(_activeStreamCount > 0);
+    _activeStreamCount--;
+}
+
+void ResourceGovernor::addRequestLatency(std::chrono::microseconds latency)
+{
+    const std::scoped_lock lock{ _mutex };
+
+    const double value{ static_cast<double>(latency.count()) };
+    _averageLatency = _averageLatency ? (*_averageLatency * (1 - latencyWeight) + value * latencyWeight) : value;
+    _lastLatencyTime = std::chrono::steady_clock::now();
+}
+
+bool ResourceGovernor::isBusy() const
+{
+    const std::scoped_lock lock{ _mutex };
+    return _activeStreamCount > 0 || isLatencyHigh();
+}
+
+void ResourceGovernor::throttle()
+{
+    const auto start{ std::chrono::steady_clock::now() };
+
+    bool streaming{};
+    bool paused{};
+    while (true)
+    {
+        {
+            const std::scoped_lock lock{ _mutex };
+            streaming = _activeStreamCount > 0;
+            if (!isLatencyHigh())
+                break;
+        }
+
+        if (std::chrono::steady_clock::now() - start >= _parameters.maxPause)
+            break;
+
+        if (!paused)
+        {
+            LMS_LOG(UTILS, DEBUG, "Pausing background job: request latency is high");
+            paused = true;
+        }
+        std::this_thread::sleep_for(pauseStep);
+    }
+
+    if (streaming && _parameters.streamDelay.count() > 0)
+        std::this_thread::sleep_for(_parameters.streamDelay);
+}
+
+bool ResourceGovernor::isLatencyHigh() const
+{
+    if (!_averageLatency)
+        return false;
+
+    // no recent request: nothing to protect
+    if (std::chrono::steady_clock::now() - _lastLatencyTime > _parameters.latencyValidity)
+        return false;
+
+    return *_averageLatency > std::chrono::duration_cast<std::chrono::microseconds>(_parameters.latencyThreshold).count();
+}
@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <mutex>
+#include <optional>
+
+#include "utils/IResourceGovernor.hpp"
+
+class ResourceGovernor final : public IResourceGovernor
+{
+public:
+    ResourceGovernor(const ResourceGovernorParameters& parameters);
+
+    ResourceGovernor(const ResourceGovernor&) = delete;
+    ResourceGovernor& operator=(const ResourceGovernor&) = delete;
+
+private:
+    void onStreamStarted() override;
+    void onStreamEnded() override;
+    void addRequestLatency(std::chrono::microseconds latency) override;
+
+    bool isBusy() const override;
+    void throttle() override;
+
+    bool isLatencyHigh() const; // must be locked
+
+    const ResourceGovernorParameters _parameters;
+
+    mutable std::mutex _mutex;
+    std::size_t _activeStreamCount{};
+    std::optional<double> _averageLatency; // in microseconds, exponentially weighted
+    std::chrono::steady_clock::time_point _lastLatencyTime;
+};
@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "SequentialFileReader.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <memory>
+
+#include "utils/Service.hpp"
+
+namespace
+{
+    constexpr std::size_t syncBufferSize{ 262'144 };
+}
+
+SequentialFileReader::SequentialFileReader(int fd, std::uint64_t offset, std::uint64_t endOffset)
+    : _fd{ fd }
+    , _offset{ offset }
+    , _endOffset{ std::max(offset, endOffset) }
+    , _asyncFileReader{ Service<IAsyncFileReader>::get() }
+{
+    if (_asyncFileReader)
+    {
+        _asyncBuffers[0] = _asyncFileReader->acquireBuffer();
+        _asyncBuffers[1] = _asyncFileReader->acquireBuffer();
+        startRead(0);
+    }
+    else
+    {
+        _syncBuffer.resize(syncBufferSize);
+    }
+}
+
+SequentialFileReader::~SequentialFileReader()
+{
+    // the buffer must stay valid until the read completes
+    if (_pendingRead)
+        _pendingRead->wait();
+}
+
+std::span<const std::byte> SequentialFileReader::readNext()
+{
+    if (_endReached || _offset >= _endOffset)
+        return {};
+
+    if (!_asyncFileReader)
+    {
+        const std::span<std::byte> buffer{ std::span{ _syncBuffer }.first(static_cast<std::size_t>(std::min<std::uint64_t>(_syncBuffer.size(), _endOffset - _offset))) };
+        const auto [ec, readSize] { readSync(buffer) };
+        if (ec)
+            throw std::system_error{ ec };
+
+        _endReached = readSize < buffer.size();
+        _offset += readSize;
+        return buffer.first(readSize);
+    }
+
+    const auto [ec, readSize] { _pendingRead->get() };
+    _pendingRead.reset();
+    if (ec)
+        throw std::system_error{ ec };
+
+    const std::size_t bufferIndex{ _pendingBufferIndex };
+    _endReached = readSize < _pendingReadSize;
+    _offset += readSize;
+
+    // the other buffer is not used by the caller anymore
+    if (!_endReached && _offset < _endOffset)
+        startRead(1 - bufferIndex);
+
+    return std::span<const std::byte>{ _asyncBuffers[bufferIndex].get(), readSize };
+}
+
+void SequentialFileReader::startRead(std::size_t bufferIndex)
+{
+    if (_offset >= _endOffset)
+        return;
+
+    _pendingBufferIndex = bufferIndex;
+    _pendingReadSize = static_cast<std::size_t>(std::min<std::uint64_t>(_asyncFileReader->getBufferSize(), _endOffset - _offset));
+
+    auto promise{ std::make_shared<std::promise<ReadResult>>() };
+    _pendingRead = promise->get_future();
+    _asyncFileReader->asyncRead(_fd, _offset, std::span{ _asyncBuffers[bufferIndex].get(), _pendingReadSize }, [promise](std::error_code ec, std::size_t readSize)
+        {
+            promise->set_value(ReadResult{ ec, readSize });
+        });
+}
+
+SequentialFileReader::ReadResult SequentialFileReader::readSync(std::span<std::byte> buffer)
+{
+    std::size_t readSize{};
+    while (readSize < buffer.size())
+    {
+        const ::ssize_t res{ ::pread(_fd, buffer.data() + readSize, buffer.size() - readSize, static_cast<::off_t>(_offset + readSize)) };
+        if (res < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return { std::error_code{ errno, std::system_category() }, readSize };
+        }
+        if (res == 0)
+            break;
+
+        readSize += static_cast<std::size_t>(res);
+    }
+
+    return { std::error_code{}, readSize };
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <optional>
+#include <span>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "utils/IAsyncFileReader.hpp"
+
+// Reads a file range chunk by chunk, the next chunk being read in the background while the current one is consumed
+// Uses the IAsyncFileReader service if available, plain blocking reads otherwise
+class SequentialFileReader
+{
+public:
+    // fd must be kept open during the whole lifetime of this object
+    SequentialFileReader(int fd, std::uint64_t offset, std::uint64_t endOffset);
+    ~SequentialFileReader(); // waits for the pending read, if any
+
+    SequentialFileReader(const SequentialFileReader&) = delete;
+    SequentialFileReader& operator=(const SequentialFileReader&) = delete;
+
+    // Returns an empty chunk once the end of the range (or of the file) is reached
+    // Returned data is valid until the next call, throws std::system_error on read errors
+    std::span<const std::byte> readNext();
+
+    std::uint64_t getOffset() const { return _offset; } // start of the next chunk
+
+private:
+    using ReadResult = std::pair<std::error_code, std::size_t>;
+    void startRead(std::size_t bufferIndex);
+    ReadResult readSync(std::span<std::byte> buffer);
+
+    const int _fd;
+    std::uint64_t _offset;
+    const std::uint64_t _endOffset;
+    bool _endReached{};
+
+    IAsyncFileReader* const _asyncFileReader;
+    IAsyncFileReader::Buffer _asyncBuffers[2];
+    std::vector<std::byte> _syncBuffer; // if no async reader is available
+
+    std::size_t _pendingBufferIndex{};
+    std::size_t _pendingReadSize{};
+    std::optional<std::future<ReadResult>> _pendingRead;
+};
@@ -0,0 +1,225 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "utils/String.hpp"
+
+#include <optional>
+
+namespace StringUtils
+{
+    namespace
+    {
+        constexpr char32_t invalidCodePoint{ 0xFFFFFFFF };
+
+        // Returns invalidCodePoint on malformed sequences, only one byte is consumed in that case
+        char32_t decodeUTF8(std::string_view str, std::size_t& pos)
+        {
+            const unsigned char first{ static_cast<unsigned char>(str[pos]) };
+
+            std::size_t length;
+            char32_t codePoint;
+            if (first < 0x80)
+            {
+                pos += 1;
+                return first;
+            }
+            else if ((first & 0xE0) == 0xC0)
+            {
+                length = 2;
+                codePoint = first & 0x1F;
+            }
+            else if ((first & 0xF0) == 0xE0)
+            {
+                length = 3;
+                codePoint = first & 0x0F;
+            }
+            else if ((first & 0xF8) == 0xF0)
+            {
+                length = 4;
+                codePoint = first & 0x07;
+            }
+            else
+            {
+                pos += 1;
+                return invalidCodePoint;
+            }
+
+            if (pos + length > str.size())
+            {
+                pos += 1;
+                return invalidCodePoint;
+            }
+
+            for (std::size_t i{ 1 }; i < length; ++i)
+            {
+                const unsigned char c{ static_cast<unsigned char>(str[pos + i]) };
+                if ((c & 0xC0) != 0x80)
+                {
+                    pos += 1;
+                    return invalidCodePoint;
+                }
+                codePoint = (codePoint << 6) | (c & 0x3F);
+            }
+
+            pos += length;
+            return codePoint;
+        }
+
+        void encodeUTF8(char32_t codePoint, std::string& output)
+        {
+            if (codePoint < 0x80)
+            {
+                output.push_back(static_cast<char>(codePoint));
+            }
+            else if (codePoint < 0x800)
+            {
+                output.push_back(static_cast<char>(0xC0 | (codePoint >> 6)));
+                output.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+            }
+            else if (codePoint < 0x10000)
+            {
+                output.push_back(static_cast<char>(0xE0 | (codePoint >> 12)));
+                output.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+                output.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+            }
+            else
+            {
+                output.push_back(static_cast<char>(0xF0 | (codePoint >> 18)));
+                output.push_back(static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F)));
+                output.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+                output.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+            }
+        }
+
+        // Base letters of U+00C0..U+017F (Latin-1 Supplement letters and Latin Extended-A), empty if not a letter
+        constexpr std::string_view latinFoldTable[]
+        {
+            // U+00C0
+            "a", "a", "a", "a", "a", "a", "ae", "c", "e", "e", "e", "e", "i", "i", "i", "i",
+            // U+00D0
+            "d", "n", "o", "o", "o", "o", "o", "", "o", "u", "u", "u", "u", "y", "th", "ss",
+            // U+00E0
+            "a", "a", "a", "a", "a", "a", "ae", "c", "e", "e", "e", "e", "i", "i", "i", "i",
+            // U+00F0
+            "d", "n", "o", "o", "o", "o", "o", "", "o", "u", "u", "u", "u", "y", "th", "y",
+            // U+0100
+            "a", "a", "a", "a", "a", "a", "c", "c", "c", "c", "c", "c", "c", "c", "d", "d",
+            // U+0110
+            "d", "d", "e", "e", "e", "e", "e", "e", "e", "e", "e", "e", "g", "g", "g", "g",
+            // U+0120
+            "g", "g", "g", "g", "h", "h", "h", "h", "i", "i", "i", "i", "i", "i", "i", "i",
+            // U+0130
+            "i", "i", "ij", "ij", "j", "j", "k", "k", "k", "l", "l", "l", "l", "l", "l", "l",
+            // U+0140
+            "l", "l", "l", "n", "n", "n", "n", "n", "n", "n", "n", "n", "o", "o", "o", "o",
+            // U+0150
+            "o", "o", "oe", "oe", "r", "r", "r", "r", "r", "r", "s", "s", "s", "s", "s", "s",
+            // U+0160
+            "s", "s", "t", "t", "t", "t", "t", "t", "u", "u", "u", "u", "u", "u", "u", "u",
+            // U+0170
+            "u", "u", "u", "u", "w", "w", "y", "y", "y", "z", "z", "z", "z", "z", "z", "s",
+        };
+        static_assert(std::size(latinFoldTable) == 0x180 - 0xC0);
+
+        // Folded code point, std::nullopt if the code point must be written as is
+        std::optional<char32_t> foldGreekOrCyrillic(char32_t codePoint)
+        {
+            // Greek: capitals and accented letters
+            switch (codePoint)
+            {
+            case U'Ά': case U'ά': return U'α';
+            case U'Έ': case U'έ': return U'ε';
+            case U'Ή': case U'ή': return U'η';
+            case U'Ί': case U'ί': case U'Ϊ': case U'ϊ': case U'ΐ': return U'ι';
+            case U'Ό': case U'ό': return U'ο';
+            case U'Ύ': case U'ύ': case U'Ϋ': case U'ϋ': case U'ΰ': return U'υ';
+            case U'Ώ': case U'ώ': return U'ω';
+            case U'ς': return U'σ'; // final sigma
+            // Cyrillic: io sorts with ie
+            case U'Ё': case U'ё': return U'е';
+            default:
+                break;
+            }
+
+            if (codePoint >= U'Α' && codePoint <= U'Ω')
+                return codePoint + 0x20;
+            if (codePoint >= U'А' && codePoint <= U'Я')
+                return codePoint + 0x20;
+            if (codePoint >= U'Ѐ' && codePoint <= U'Џ')
+                return codePoint + 0x50;
+
+            return std::nullopt;
+        }
+
+        bool isCombiningDiacriticalMark(char32_t codePoint)
+        {
+            return codePoint >= U'̀' && codePoint <= U'ͯ';
+        }
+    }
+
+    std::string computeSortKey(std::string_view str)
+    {
+        std::string res;
+        res.reserve(str.size());
+
+        std::size_t pos{};
+        while (pos < str.size())
+        {
+            const std::size_t start{ pos };
+            const char32_t codePoint{ decodeUTF8(str, pos) };
+
+            if (codePoint < 0x80)
+            {
+                const char c{ static_cast<char>(codePoint) };
+                res.push_back((c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : c);
+            }
+            else if (codePoint == invalidCodePoint)
+                res.push_back(str[start]);
+            else if (isCombiningDiacriticalMark(codePoint)) // decomposed forms
+                continue;
+            else if (codePoint >= 0xC0 && codePoint < 0x180 && !latinFoldTable[codePoint - 0xC0].empty())
+                res.append(latinFoldTable[codePoint - 0xC0]);
+            else if (const std::optional<char32_t> folded{ foldGreekOrCyrillic(codePoint) })
+                encodeUTF8(*folded, res);
+            else
+                res.append(str.substr(start, pos - start));
+        }
+
+        return res;
+    }
+
+    std::string getSortKeyIndexLetter(std::string_view sortKey)
+    {
+        if (sortKey.empty())
+            return "?";
+
+        std::size_t pos{};
+        const char32_t codePoint{ decodeUTF8(sortKey, pos) };
+
+        std::string res;
+        if (codePoint >= 'a' && codePoint <= 'z')
+            res.push_back(static_cast<char>(codePoint - ('a' - 'A')));
+        else if ((codePoint >= U'α' && codePoint <= U'ω') || (codePoint >= U'а' && codePoint <= U'я'))
+            encodeUTF8(codePoint - 0x20, res);
+        else
+            res.push_back('?');
+
+        return res;
+    }
+} // namespace StringUtils
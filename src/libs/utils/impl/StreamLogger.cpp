@@ -30,7 +30,7 @@ StreamLogger::StreamLogger(std::ostream& os, EnumSet<Severity> severities)
 
 void StreamLogger::processLog(const Log& log)
 {
-    assert(isSeverityActive(log.getSeverity()));
+    assert(isSeverityActive(log.getModule(), log.getSeverity()));
     _os << std::this_thread::get_id() << " [" << getSeverityName(log.getSeverity()) << "] [" << getModuleName(log.getModule()) << "] " << log.getMessage() << std::endl;
 }
 
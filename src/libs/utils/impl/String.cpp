@@ -20,6 +20,9 @@
 #include "utils/String.hpp"
 
 #include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
 #include <iomanip>
 #include <utility>
 
@@ -50,37 +53,107 @@ namespace StringUtils
             { '"', "\\\"" },
         };
 
+        constexpr std::pair<char, std::string_view> xmlEscapeChars[]
+        {
+            { '&', "&amp;" },
+            { '<', "&lt;" },
+            { '>', "&gt;" },
+            { '"', "&quot;" },
+            { '\'', "&apos;" },
+        };
+
+        // Escape sequence of each byte, empty if the byte does not need to be escaped
+        using EscapeTable = std::array<std::string_view, 256>;
+
         template <std::size_t N>
-        std::string escape(std::string_view str, const std::pair<char, std::string_view>(&charsToEscape)[N])
+        constexpr EscapeTable makeEscapeTable(const std::pair<char, std::string_view>(&charsToEscape)[N])
         {
-            std::string escaped;
-            escaped.reserve(str.length());
+            EscapeTable table{};
+            for (const auto& [c, escaped] : charsToEscape)
+                table[static_cast<unsigned char>(c)] = escaped;
+
+            return table;
+        }
 
-            for (const char c : str)
+        constexpr EscapeTable jsEscapeTable{ makeEscapeTable(jsEscapeChars) };
+        constexpr EscapeTable jsonEscapeTable{ makeEscapeTable(jsonEscapeChars) };
+        constexpr EscapeTable xmlEscapeTable{ makeEscapeTable(xmlEscapeChars) };
+
+        // Calls func with the runs of chars that do not need to be escaped, and with the escape sequences
+        // Processing whole runs is much faster than appending/writing each char separately
+        template <typename Func>
+        void visitEscaped(std::string_view str, const EscapeTable& table, Func func)
+        {
+            std::size_t runStart{};
+            for (std::size_t i{}; i < str.size(); ++i)
             {
-                auto it{ std::find_if(std::cbegin(charsToEscape), std::cend(charsToEscape), [c](const auto& entry) { return entry.first == c; }) };
-                if (it == std::cend(charsToEscape))
-                {
-                    escaped += c;
+                const std::string_view escaped{ table[static_cast<unsigned char>(str[i])] };
+                if (escaped.empty())
                     continue;
-                }
 
-                escaped += it->second;
+                if (i != runStart)
+                    func(str.substr(runStart, i - runStart));
+                func(escaped);
+                runStart = i + 1;
             }
 
+            if (runStart != str.size())
+                func(str.substr(runStart));
+        }
+
+        std::string escape(std::string_view str, const EscapeTable& table)
+        {
+            std::string escaped;
+            escaped.reserve(str.length());
+
+            visitEscaped(str, table, [&](std::string_view chunk) { escaped.append(chunk); });
+
             return escaped;
         }
 
-        template <std::size_t N>
-        void writeEscapedString(std::ostream& os, std::string_view str, const std::pair<char, std::string_view>(&charsToEscape)[N])
+        void writeEscapedString(std::ostream& os, std::string_view str, const EscapeTable& table)
+        {
+            visitEscaped(str, table, [&](std::string_view chunk) { os.write(chunk.data(), static_cast<std::streamsize>(chunk.size())); });
+        }
+
+        // ASCII only: bytes of multi-byte UTF-8 sequences are left untouched
+        // Processes 8 bytes at once (SWAR), so that it is fast even if the compiler does not vectorize the loop
+        enum class CaseConversion
         {
-            for (const char c : str)
+            ToLower,
+            ToUpper,
+        };
+
+        template <CaseConversion conversion>
+        void convertAsciiCase(const char* input, char* output, std::size_t size)
+        {
+            constexpr char first{ conversion == CaseConversion::ToLower ? 'A' : 'a' };
+            constexpr char last{ conversion == CaseConversion::ToLower ? 'Z' : 'z' };
+
+            constexpr std::uint64_t ones{ 0x0101010101010101 };
+            constexpr std::uint64_t highBits{ ones * 0x80 };
+
+            std::size_t i{};
+            for (; i + sizeof(std::uint64_t) <= size; i += sizeof(std::uint64_t))
             {
-                auto itEntry{ std::find_if(std::cbegin(charsToEscape), std::cend(charsToEscape), [=](const auto& entry) { return entry.first == c;}) };
-                if (itEntry != std::cend(charsToEscape))
-                    os << itEntry->second;
-                else
-                    os << c;
+                std::uint64_t word;
+                std::memcpy(&word, input + i, sizeof(word));
+
+                // high bit of each byte set if the byte is in [first, last]
+                const std::uint64_t lowBits{ word & ~highBits };
+                const std::uint64_t geFirst{ lowBits + ones * (0x80 - first) };
+                const std::uint64_t gtLast{ lowBits + ones * (0x7F - last) };
+                const std::uint64_t inRange{ (geFirst ^ gtLast) & ~word & highBits };
+
+                // the case bit is 0x20
+                word ^= (inRange >> 2);
+                std::memcpy(output + i, &word, sizeof(word));
+            }
+
+            for (; i < size; ++i)
+            {
+                const char c{ input[i] };
+                output[i] = (c >= first && c <= last) ? static_cast<char>(c ^ 0x20) : c;
             }
         }
 
@@ -127,7 +200,19 @@ namespace StringUtils
 
     std::vector<std::string_view> splitString(std::string_view str, char separator)
     {
-        return splitString(str, std::string_view{ &separator, 1 });
+        std::vector<std::string_view> res;
+
+        // single char search is memchr based
+        std::size_t pos{};
+        for (std::size_t found{ str.find(separator) }; found != std::string_view::npos; found = str.find(separator, pos))
+        {
+            res.push_back(str.substr(pos, found - pos));
+            pos = found + 1;
+        }
+
+        res.push_back(str.substr(pos));
+
+        return res;
     }
 
     std::vector<std::string_view> splitString(std::string_view str, std::string_view separator)
@@ -246,25 +331,21 @@ namespace StringUtils
 
     std::string stringToLower(std::string_view str)
     {
-        std::string res;
-        res.reserve(str.size());
-
-        std::transform(std::cbegin(str), std::cend(str), std::back_inserter(res), [](unsigned char c) { return std::tolower(c);});
+        std::string res(str.size(), '\0');
+        details::convertAsciiCase<details::CaseConversion::ToLower>(str.data(), res.data(), str.size());
 
         return res;
     }
 
     void stringToLower(std::string& str)
     {
-        std::transform(std::cbegin(str), std::cend(str), std::begin(str), [](unsigned char c) { return std::tolower(c);});
+        details::convertAsciiCase<details::CaseConversion::ToLower>(str.data(), str.data(), str.size());
     }
 
     std::string stringToUpper(const std::string& str)
     {
-        std::string res;
-        res.reserve(str.size());
-
-        std::transform(std::cbegin(str), std::cend(str), std::back_inserter(res), [](char c) { return std::toupper(c);});
+        std::string res(str.size(), '\0');
+        details::convertAsciiCase<details::CaseConversion::ToUpper>(str.data(), res.data(), str.size());
 
         return res;
     }
@@ -311,50 +392,74 @@ namespace StringUtils
 
     std::string replaceInString(std::string_view str, const std::string& from, const std::string& to)
     {
-        std::string res{ str };
-        size_t pos = 0;
+        if (from.empty())
+            return std::string{ str };
 
-        while ((pos = res.find(from, pos)) != std::string::npos)
+        std::string res;
+        res.reserve(str.size());
+
+        std::size_t pos{};
+        for (std::size_t found{ str.find(from) }; found != std::string_view::npos; found = str.find(from, pos))
         {
-            res.replace(pos, from.length(), to);
-            pos += to.length();
+            res.append(str.substr(pos, found - pos));
+            res.append(to);
+            pos = found + from.size();
         }
+        res.append(str.substr(pos));
 
         return res;
     }
 
     std::string jsEscape(std::string_view str)
     {
-        return details::escape(str, details::jsEscapeChars);
+        return details::escape(str, details::jsEscapeTable);
     }
 
     void writeJSEscapedString(std::ostream& os, std::string_view str)
     {
-        details::writeEscapedString(os, str, details::jsEscapeChars);
+        details::writeEscapedString(os, str, details::jsEscapeTable);
     }
 
     std::string jsonEscape(std::string_view str)
     {
-        return details::escape(str, details::jsonEscapeChars);
+        return details::escape(str, details::jsonEscapeTable);
     }
 
     void writeJsonEscapedString(std::ostream& os, std::string_view str)
     {
-        details::writeEscapedString(os, str, details::jsonEscapeChars);
+        details::writeEscapedString(os, str, details::jsonEscapeTable);
+    }
+
+    std::string xmlEscape(std::string_view str)
+    {
+        return details::escape(str, details::xmlEscapeTable);
+    }
+
+    void writeXmlEscapedString(std::ostream& os, std::string_view str)
+    {
+        details::writeEscapedString(os, str, details::xmlEscapeTable);
     }
 
     std::string escapeString(std::string_view str, std::string_view charsToEscape, char escapeChar)
     {
+        std::array<bool, 256> mustEscape{};
+        for (const char c : charsToEscape)
+            mustEscape[static_cast<unsigned char>(c)] = true;
+
         std::string res;
         res.reserve(str.size());
 
-        for (const char c : str)
+        std::size_t runStart{};
+        for (std::size_t i{}; i < str.size(); ++i)
         {
-            if (std::any_of(std::cbegin(charsToEscape), std::cend(charsToEscape), [c](char charToEscape) { return c == charToEscape; }))
-                res += escapeChar;
+            if (!mustEscape[static_cast<unsigned char>(str[i])])
+                continue;
 
-            res += c;
+            res.append(str.substr(runStart, i - runStart));
+            res += escapeChar;
+            runStart = i;
         }
+        res.append(str.substr(runStart));
 
         return res;
     }
@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TraceLogger.hpp"
+
+#include <algorithm>
+
+#include "utils/Service.hpp"
+#include "utils/String.hpp"
+
+namespace Tracing
+{
+    namespace
+    {
+        // the span stack of the thread: only the depth and whether its outermost span is sampled are needed
+        struct SpanStack
+        {
+            std::size_t depth{};
+            bool sampled{};
+        };
+        thread_local SpanStack spanStack;
+
+        std::uint32_t getCurrentThreadId()
+        {
+            static std::atomic<std::uint32_t> nextThreadId{};
+            thread_local const std::uint32_t threadId{ nextThreadId++ };
+            return threadId;
+        }
+
+        void writeEvent(std::ostream& os, const ITraceLogger::CompleteEvent& event, std::chrono::steady_clock::time_point startTime)
+        {
+            os << "{\"name\":\"";
+            StringUtils::writeJsonEscapedString(os, event.name);
+            os << "\",\"cat\":\"";
+            StringUtils::writeJsonEscapedString(os, event.category);
+            os << "\",\"ph\":\"X\",\"ts\":" << std::chrono::duration_cast<std::chrono::microseconds>(event.start - startTime).count()
+                << ",\"dur\":" << std::chrono::duration_cast<std::chrono::microseconds>(event.duration).count()
+                << ",\"pid\":1,\"tid\":" << event.threadId;
+            if (!event.arg.empty())
+            {
+                os << ",\"args\":{\"arg\":\"";
+                StringUtils::writeJsonEscapedString(os, event.arg);
+                os << "\"}";
+            }
+            os << '}';
+        }
+    }
+
+    std::unique_ptr<ITraceLogger> createTraceLogger(const TraceLoggerParameters& parameters)
+    {
+        return std::make_unique<TraceLogger>(parameters);
+    }
+
+    TraceLogger::TraceLogger(const TraceLoggerParameters& parameters)
+        : _minLevel{ parameters.minLevel }
+        , _samplingPeriod{ std::max(parameters.samplingPeriod, 1U) }
+        , _bufferEventCount{ std::max<std::size_t>(parameters.bufferEventCount, 1) }
+    {
+        _events.reserve(_bufferEventCount);
+    }
+
+    bool TraceLogger::sampleNextTrace()
+    {
+        return _traceCount.fetch_add(1, std::memory_order_relaxed) % _samplingPeriod == 0;
+    }
+
+    void TraceLogger::write(CompleteEvent&& event)
+    {
+        std::scoped_lock lock{ _mutex };
+
+        if (_events.size() < _bufferEventCount)
+        {
+            _events.push_back(std::move(event));
+            return;
+        }
+
+        _events[_nextEventIndex] = std::move(event);
+        _nextEventIndex = (_nextEventIndex + 1) % _bufferEventCount;
+    }
+
+    void TraceLogger::dump(std::ostream& os) const
+    {
+        std::scoped_lock lock{ _mutex };
+
+        os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        // oldest first
+        for (std::size_t i{}; i < _events.size(); ++i)
+        {
+            if (i > 0)
+                os << ",\n";
+            writeEvent(os, _events[(_nextEventIndex + i) % _events.size()], _startTime);
+        }
+        os << "]}";
+    }
+
+    ScopedTrace::ScopedTrace(Level level, std::string_view category, std::string_view name, std::string_view arg)
+    {
+        ITraceLogger* traceLogger{ Service<ITraceLogger>::get() };
+        if (!traceLogger || !traceLogger->isLevelActive(level))
+            return;
+
+        if (spanStack.depth == 0)
+            spanStack.sampled = traceLogger->sampleNextTrace();
+        spanStack.depth++;
+        _stacked = true;
+
+        if (!spanStack.sampled)
+            return;
+
+        _traceLogger = traceLogger;
+        _category = category;
+        _name = name;
+        _arg = arg;
+        _start = std::chrono::steady_clock::now();
+    }
+
+    ScopedTrace::~ScopedTrace()
+    {
+        if (!_stacked)
+            return;
+
+        spanStack.depth--;
+
+        if (_traceLogger)
+            _traceLogger->write(ITraceLogger::CompleteEvent{ _start, std::chrono::steady_clock::now() - _start, _category, _name, std::move(_arg), getCurrentThreadId() });
+    }
+} // namespace Tracing
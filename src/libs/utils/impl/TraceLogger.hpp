@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "utils/ITraceLogger.hpp"
+
+namespace Tracing
+{
+    class TraceLogger final : public ITraceLogger
+    {
+    public:
+        TraceLogger(const TraceLoggerParameters& parameters);
+        ~TraceLogger() override = default;
+
+        TraceLogger(const TraceLogger&) = delete;
+        TraceLogger& operator=(const TraceLogger&) = delete;
+
+    private:
+        bool isLevelActive(Level level) const override { return level <= _minLevel; }
+        bool sampleNextTrace() override;
+        void write(CompleteEvent&& event) override;
+        void dump(std::ostream& os) const override;
+
+        const Level _minLevel;
+        const unsigned _samplingPeriod;
+        const std::chrono::steady_clock::time_point _startTime{ std::chrono::steady_clock::now() };
+        std::atomic<std::uint64_t> _traceCount{};
+
+        // ring buffer
+        const std::size_t _bufferEventCount;
+        mutable std::mutex _mutex;
+        std::vector<CompleteEvent> _events;
+        std::size_t _nextEventIndex{}; // once the buffer is full
+    };
+} // namespace Tracing
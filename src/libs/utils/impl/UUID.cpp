@@ -19,10 +19,8 @@
 
 #include "utils/UUID.hpp"
 
+#include <algorithm>
 #include <cassert>
-#include <iomanip>
-#include <regex>
-#include <sstream>
 
 #include "utils/Random.hpp"
 #include "utils/String.hpp"
@@ -38,52 +36,97 @@ namespace StringUtils
 }
 namespace
 {
-    bool stringIsUUID(std::string_view str)
+    constexpr std::size_t stringSize{ 36 };
+
+    constexpr bool isDashPosition(std::size_t pos)
+    {
+        return pos == 8 || pos == 13 || pos == 18 || pos == 23;
+    }
+
+    std::optional<unsigned char> hexCharToValue(char c)
     {
-        static const std::regex re{ R"([0-9a-fA-F]{8}\-[0-9a-fA-F]{4}\-[0-9a-fA-F]{4}\-[0-9a-fA-F]{4}\-[0-9a-fA-F]{12})" };
+        if (c >= '0' && c <= '9')
+            return c - '0';
+        if (c >= 'a' && c <= 'f')
+            return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F')
+            return c - 'A' + 10;
 
-        return std::regex_match(std::cbegin(str), std::cend(str), re);
+        return std::nullopt;
     }
 }
 
-UUID::UUID(std::string_view str)
-    : _value{ StringUtils::stringToLower(str) }
+UUID::UUID(const Bytes& value)
+    : _value{ value }
 {
 }
 
 std::optional<UUID> UUID::fromString(std::string_view str)
 {
-    if (!stringIsUUID(str))
+    if (str.size() != stringSize)
+        return std::nullopt;
+
+    Bytes value;
+    std::size_t byteIndex{};
+    for (std::size_t pos{}; pos < stringSize; )
+    {
+        if (isDashPosition(pos))
+        {
+            if (str[pos] != '-')
+                return std::nullopt;
+
+            pos += 1;
+            continue;
+        }
+
+        const std::optional<unsigned char> high{ hexCharToValue(str[pos]) };
+        const std::optional<unsigned char> low{ hexCharToValue(str[pos + 1]) };
+        if (!high || !low)
+            return std::nullopt;
+
+        value[byteIndex++] = static_cast<unsigned char>((*high << 4) | *low);
+        pos += 2;
+    }
+    assert(byteIndex == byteCount);
+
+    return UUID{ value };
+}
+
+std::optional<UUID> UUID::fromBytes(std::span<const unsigned char> bytes)
+{
+    if (bytes.size() != byteCount)
         return std::nullopt;
 
-    return UUID{ str };
+    Bytes value;
+    std::copy(std::cbegin(bytes), std::cend(bytes), std::begin(value));
+
+    return UUID{ value };
 }
 
 UUID UUID::generate()
 {
-    // Form is "123e4567-e89b-12d3-a456-426614174000"
-    // TODO: store 128 bits and only convert to string when necessary
+    Bytes value;
+    for (unsigned char& byte : value)
+        byte = static_cast<unsigned char>(Random::getRandom(0, 255));
+
+    return UUID{ value };
+}
 
-    std::ostringstream oss;
+std::string UUID::getAsString() const
+{
+    static constexpr char hexChars[]{ "0123456789abcdef" };
 
-    auto concatRandomBytes{ [](std::ostream& os, std::size_t byteCount)
+    std::string res;
+    res.reserve(stringSize);
+    for (std::size_t byteIndex{}; byteIndex < byteCount; ++byteIndex)
     {
-        for (std::size_t i {}; i < byteCount; ++i)
-            os << std::hex << std::setfill('0') << std::setw(2) << static_cast<int>(Random::getRandom<std::uint8_t>(0, 255));
-    } };
-
-    concatRandomBytes(oss, 4);
-    oss << "-";
-    concatRandomBytes(oss, 2);
-    oss << "-";
-    concatRandomBytes(oss, 2);
-    oss << "-";
-    concatRandomBytes(oss, 2);
-    oss << "-";
-    concatRandomBytes(oss, 6);
-
-    const auto uuid{fromString(oss.str())};
-    assert(uuid);
-    return uuid.value();
-}
+        if (isDashPosition(res.size()))
+            res.push_back('-');
 
+        res.push_back(hexChars[_value[byteIndex] >> 4]);
+        res.push_back(hexChars[_value[byteIndex] & 0x0F]);
+    }
+    assert(res.size() == stringSize);
+
+    return res;
+}
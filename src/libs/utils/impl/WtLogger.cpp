@@ -25,6 +25,7 @@
 #include <Wt/WLogger.h>
 
 #include "utils/Exception.hpp"
+#include "utils/LogFilter.hpp"
 
 namespace
 {
@@ -36,8 +37,8 @@ namespace
     }
 }
 
-WtLogger::WtLogger(Severity minSeverity)
-    : _minSeverity{ minSeverity }
+WtLogger::WtLogger(const LogFilter& filter)
+    : _filter{ filter }
 {
 }
 
@@ -55,13 +56,18 @@ std::string WtLogger::computeLogConfig(Severity minSeverity)
     throw LmsException{ "Unhandled severity" };
 }
 
-bool WtLogger::isSeverityActive(Severity severity) const
+bool WtLogger::isSeverityActive(Module module, Severity severity) const
 {
-    return static_cast<int>(severity) <= static_cast<int>(_minSeverity);
+    return _filter.isSeverityActive(module, severity);
+}
+
+void WtLogger::write(Severity severity, Module module, std::thread::id threadId, const std::string& message)
+{
+    Wt::log(getSeverityName(severity)) << Wt::WLogger::sep << to_string(threadId) << Wt::WLogger::sep << "[" << getModuleName(module) << "]" << Wt::WLogger::sep << message;
 }
 
 void WtLogger::processLog(const Log& log)
 {
-    Wt::log(getSeverityName(log.getSeverity())) << Wt::WLogger::sep << to_string(std::this_thread::get_id()) << Wt::WLogger::sep << "[" << getModuleName(log.getModule()) << "]" << Wt::WLogger::sep << log.getMessage();
+    write(log.getSeverity(), log.getModule(), std::this_thread::get_id(), log.getMessage());
 }
 
@@ -0,0 +1,568 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Zipper.hpp"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <ctime>
+#include <cstring> // strerror
+#include <mutex>
+#include <unordered_map>
+
+#include "utils/Crc32Calculator.hpp"
+#include "utils/ILogger.hpp"
+
+namespace Zip
+{
+    std::unique_ptr<IZipper> createZipper(const EntryContainer& entries)
+    {
+        return std::make_unique<Zipper>(entries);
+    }
+
+    namespace
+    {
+        constexpr std::uint32_t localFileHeaderSignature{ 0x04034b50 };
+        constexpr std::uint32_t centralDirectoryHeaderSignature{ 0x02014b50 };
+        constexpr std::uint32_t zip64EndOfCentralDirectorySignature{ 0x06064b50 };
+        constexpr std::uint32_t zip64EndOfCentralDirectoryLocatorSignature{ 0x07064b50 };
+        constexpr std::uint32_t endOfCentralDirectorySignature{ 0x06054b50 };
+
+        constexpr std::uint16_t zip64ExtraFieldId{ 0x0001 };
+        constexpr std::uint16_t versionDefault{ 20 };
+        constexpr std::uint16_t versionZip64{ 45 };
+        constexpr std::uint16_t versionMadeBy{ (3 << 8) /* unix */ | versionZip64 };
+        constexpr std::uint16_t flagUTF8Names{ 1 << 11 };
+        constexpr std::uint16_t compressionMethodStore{ 0 };
+
+        constexpr std::uint64_t localHeaderFixedSize{ 30 };
+        constexpr std::uint64_t localHeaderZip64ExtraFieldSize{ 20 };
+        constexpr std::uint64_t centralDirectoryHeaderFixedSize{ 46 };
+        constexpr std::uint64_t centralDirectoryHeaderZip64ExtraFieldSize{ 28 };
+        constexpr std::uint64_t zip64EndOfCentralDirectorySize{ 56 };
+        constexpr std::uint64_t zip64EndOfCentralDirectoryLocatorSize{ 20 };
+        constexpr std::uint64_t endOfCentralDirectorySize{ 22 };
+
+        constexpr std::uint64_t maxUInt16{ 0xFFFF };
+        constexpr std::uint64_t maxUInt32{ 0xFFFFFFFF }; // values greater or equal are set in the zip64 fields
+
+        // small parts (headers) are merged with the following ones in the same call
+        constexpr std::uint64_t minWriteSize{ 65'536 };
+
+        class FileException : public Exception
+        {
+        public:
+            FileException(const std::filesystem::path& p, std::string_view message)
+                : Exception{ "File '" + p.string() + "': " + std::string{ message } }
+            {}
+
+            FileException(const std::filesystem::path& p, std::string_view message, int err)
+                : Exception{ "File '" + p.string() + "': " + std::string{ message } + ": " + ::strerror(err) }
+            {}
+        };
+
+        // little endian
+        class ByteWriter
+        {
+        public:
+            ByteWriter(std::vector<std::byte>& output) : _output{ output } {}
+
+            void write16(std::uint64_t value) { write(value, 2); }
+            void write32(std::uint64_t value) { write(value, 4); }
+            void write64(std::uint64_t value) { write(value, 8); }
+            void writeString(std::string_view str)
+            {
+                for (const char c : str)
+                    _output.push_back(static_cast<std::byte>(c));
+            }
+
+        private:
+            void write(std::uint64_t value, std::size_t byteCount)
+            {
+                for (std::size_t i{}; i < byteCount; ++i)
+                    _output.push_back(static_cast<std::byte>((value >> (8 * i)) & 0xFF));
+            }
+
+            std::vector<std::byte>& _output;
+        };
+
+        struct DosDateTime
+        {
+            std::uint16_t time{};
+            std::uint16_t date{ (1 << 5) | 1 }; // 1980-01-01
+        };
+
+        DosDateTime toDosDateTime(::time_t time)
+        {
+            DosDateTime res;
+
+            std::tm tm{};
+            if (!::localtime_r(&time, &tm) || tm.tm_year < 80)
+                return res;
+
+            res.time = static_cast<std::uint16_t>((tm.tm_hour << 11) | (tm.tm_min << 5) | (tm.tm_sec / 2));
+            res.date = static_cast<std::uint16_t>((std::min(tm.tm_year - 80, 127) << 9) | ((tm.tm_mon + 1) << 5) | tm.tm_mday);
+
+            return res;
+        }
+
+        // Saves reading the files again when the same entries are downloaded again, or resumed
+        class Crc32Cache
+        {
+        public:
+            std::optional<std::uint32_t> get(const std::string& key)
+            {
+                const std::scoped_lock lock{ _mutex };
+
+                auto it{ _crcs.find(key) };
+                if (it == std::cend(_crcs))
+                    return std::nullopt;
+
+                return it->second;
+            }
+
+            void put(const std::string& key, std::uint32_t crc32)
+            {
+                const std::scoped_lock lock{ _mutex };
+
+                if (_crcs.size() >= _maxEntryCount)
+                    _crcs.clear();
+
+                _crcs.emplace(key, crc32);
+            }
+
+        private:
+            static constexpr std::size_t _maxEntryCount{ 4096 };
+
+            std::mutex _mutex;
+            std::unordered_map<std::string, std::uint32_t> _crcs;
+        };
+
+        Crc32Cache& getCrc32Cache()
+        {
+            static Crc32Cache cache;
+            return cache;
+        }
+
+        class ScopedFd
+        {
+        public:
+            ScopedFd(int fd) : _fd{ fd } {}
+            ~ScopedFd() { if (_fd >= 0) ::close(_fd); }
+            ScopedFd(const ScopedFd&) = delete;
+            ScopedFd& operator=(const ScopedFd&) = delete;
+
+            int get() const { return _fd; }
+
+        private:
+            const int _fd;
+        };
+
+        std::uint32_t computeCrc32(const std::filesystem::path& path, std::uint64_t size, ::time_t lastWriteTime, const std::atomic<bool>& cancelled)
+        {
+            const std::string cacheKey{ path.string() + '\n' + std::to_string(size) + '\n' + std::to_string(lastWriteTime) };
+            if (const std::optional<std::uint32_t> crc32{ getCrc32Cache().get(cacheKey) })
+                return *crc32;
+
+            const ScopedFd fd{ ::open(path.c_str(), O_RDONLY | O_CLOEXEC) };
+            if (fd.get() < 0)
+                throw FileException{ path, "cannot open file", errno };
+
+#if defined(POSIX_FADV_SEQUENTIAL)
+            ::posix_fadvise(fd.get(), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+            SequentialFileReader reader{ fd.get(), 0, size };
+            Utils::Crc32Calculator crc32;
+            std::uint64_t readSize{};
+            while (true)
+            {
+                if (cancelled)
+                    throw Exception{ "CRC computation cancelled" };
+
+                std::span<const std::byte> data;
+                try
+                {
+                    data = reader.readNext();
+                }
+                catch (const std::system_error& e)
+                {
+                    throw FileException{ path, "read failed", e.code().value() };
+                }
+
+                if (data.empty())
+                    break;
+
+                crc32.processBytes(data.data(), data.size());
+                readSize += data.size();
+            }
+
+            if (readSize != size)
+                throw FileException{ path, "size changed?" };
+
+            getCrc32Cache().put(cacheKey, crc32.getResult());
+            return crc32.getResult();
+        }
+    }
+
+    std::uint64_t Zipper::FileEntry::getLocalHeaderSize() const
+    {
+        return localHeaderFixedSize + fileName.size() + (size >= maxUInt32 ? localHeaderZip64ExtraFieldSize : 0);
+    }
+
+    std::uint64_t Zipper::FileEntry::getCentralDirectoryHeaderSize() const
+    {
+        return centralDirectoryHeaderFixedSize + fileName.size() + ((size >= maxUInt32 || localHeaderOffset >= maxUInt32) ? centralDirectoryHeaderZip64ExtraFieldSize : 0);
+    }
+
+    Zipper::Zipper(const EntryContainer& entries)
+    {
+        _entries.reserve(entries.size());
+
+        std::uint64_t offset{};
+        for (const Entry& entry : entries)
+        {
+            struct ::stat fileStat;
+            if (::stat(entry.filePath.c_str(), &fileStat) < 0)
+                throw FileException{ entry.filePath, "cannot access file", errno };
+            if (!S_ISREG(fileStat.st_mode))
+                throw FileException{ entry.filePath, "not a regular file" };
+            if (entry.fileName.size() > maxUInt16)
+                throw FileException{ entry.filePath, "file name too long" };
+
+            FileEntry& fileEntry{ _entries.emplace_back() };
+            fileEntry.fileName = entry.fileName;
+            fileEntry.filePath = entry.filePath;
+            fileEntry.size = static_cast<std::uint64_t>(fileStat.st_size);
+            fileEntry.lastWriteTime = fileStat.st_mtime;
+            fileEntry.mode = fileStat.st_mode;
+            fileEntry.localHeaderOffset = offset;
+
+            offset += fileEntry.getLocalHeaderSize() + fileEntry.size;
+        }
+
+        _centralDirectoryOffset = offset;
+        for (const FileEntry& fileEntry : _entries)
+            _centralDirectorySize += fileEntry.getCentralDirectoryHeaderSize();
+
+        _totalSize = _centralDirectoryOffset + _centralDirectorySize + endOfCentralDirectorySize;
+        if (needsZip64EndOfCentralDirectory())
+            _totalSize += zip64EndOfCentralDirectorySize + zip64EndOfCentralDirectoryLocatorSize;
+
+        _endOffset = _totalSize;
+    }
+
+    Zipper::~Zipper()
+    {
+        closeFile();
+        if (_pendingCrc32Cancelled)
+            *_pendingCrc32Cancelled = true; // the future waits for the computation to end
+    }
+
+    void Zipper::setByteRange(std::uint64_t firstByte, std::uint64_t endByte)
+    {
+        assert(!_started);
+
+        _offset = std::min(firstByte, _totalSize);
+        _endOffset = std::clamp(endByte, _offset, _totalSize);
+    }
+
+    std::uint64_t Zipper::writeSome(std::ostream& output)
+    {
+        _started = true;
+
+        std::uint64_t writtenBytes{};
+        while (!isComplete() && writtenBytes < minWriteSize)
+            writtenBytes += writeSomePart(output);
+
+        if (isComplete())
+            closeFile();
+
+        return writtenBytes;
+    }
+
+    bool Zipper::isComplete() const
+    {
+        return _aborted || _offset >= _endOffset;
+    }
+
+    void Zipper::abort()
+    {
+        LMS_LOG(UTILS, DEBUG, "Aborting zip creation");
+
+        _aborted = true;
+        closeFile();
+        if (_pendingCrc32Cancelled)
+            *_pendingCrc32Cancelled = true;
+    }
+
+    std::uint64_t Zipper::writeSomePart(std::ostream& output)
+    {
+        if (_offset >= _centralDirectoryOffset)
+        {
+            closeFile();
+
+            if (_centralDirectory.empty())
+                _centralDirectory = serializeCentralDirectory();
+
+            return writeBytes(output, _centralDirectory, _centralDirectoryOffset);
+        }
+
+        // entry containing the current offset
+        auto itEntry{ std::upper_bound(std::cbegin(_entries), std::cend(_entries), _offset, [](std::uint64_t offset, const FileEntry& entry) { return offset < entry.localHeaderOffset; }) };
+        assert(itEntry != std::cbegin(_entries));
+        const std::size_t entryIndex{ static_cast<std::size_t>(std::distance(std::cbegin(_entries), itEntry) - 1) };
+        const FileEntry& entry{ _entries[entryIndex] };
+
+        const std::uint64_t dataOffset{ entry.localHeaderOffset + entry.getLocalHeaderSize() };
+        if (_offset < dataOffset)
+        {
+            const std::vector<std::byte> localHeader{ serializeLocalHeader(entryIndex) };
+            return writeBytes(output, localHeader, entry.localHeaderOffset);
+        }
+
+        return writeSomeFileData(output, entryIndex, _offset - dataOffset);
+    }
+
+    std::uint64_t Zipper::writeSomeFileData(std::ostream& output, std::size_t entryIndex, std::uint64_t dataOffset)
+    {
+        if (_currentFileEntryIndex != entryIndex || _currentFileReader->getOffset() != dataOffset)
+            openFile(entryIndex, dataOffset);
+
+        std::span<const std::byte> data;
+        try
+        {
+            data = _currentFileReader->readNext();
+        }
+        catch (const std::system_error& e)
+        {
+            throw FileException{ _entries[entryIndex].filePath, "read failed", e.code().value() };
+        }
+
+        // the end of the range is never reached here
+        if (data.empty())
+            throw FileException{ _entries[entryIndex].filePath, "size changed?" };
+
+        output.write(reinterpret_cast<const char*>(data.data()), data.size());
+        if (!output)
+            throw Exception{ "Failed to write " + std::to_string(data.size()) + " bytes in final archive output!" };
+
+        _offset += data.size();
+        return data.size();
+    }
+
+    std::uint64_t Zipper::writeBytes(std::ostream& output, std::span<const std::byte> bytes, std::uint64_t bytesOffset)
+    {
+        assert(_offset >= bytesOffset && _offset < bytesOffset + bytes.size());
+
+        const std::uint64_t begin{ _offset - bytesOffset };
+        const std::uint64_t size{ std::min<std::uint64_t>(bytes.size() - begin, _endOffset - _offset) };
+
+        output.write(reinterpret_cast<const char*>(bytes.data() + begin), size);
+        if (!output)
+            throw Exception{ "Failed to write " + std::to_string(size) + " bytes in final archive output!" };
+
+        _offset += size;
+        return size;
+    }
+
+    void Zipper::openFile(std::size_t entryIndex, std::uint64_t dataOffset)
+    {
+        closeFile();
+
+        const FileEntry& entry{ _entries[entryIndex] };
+
+        // kept open until the entry is complete
+        _currentFileFd = ::open(entry.filePath.c_str(), O_RDONLY | O_CLOEXEC);
+        if (_currentFileFd < 0)
+            throw FileException{ entry.filePath, "cannot open file", errno };
+
+#if defined(POSIX_FADV_SEQUENTIAL)
+        ::posix_fadvise(_currentFileFd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+        const std::uint64_t archiveDataOffset{ entry.localHeaderOffset + entry.getLocalHeaderSize() };
+        const std::uint64_t endDataOffset{ std::min(entry.size, _endOffset - archiveDataOffset) };
+
+        _currentFileReader = std::make_unique<SequentialFileReader>(_currentFileFd, dataOffset, endDataOffset);
+        _currentFileEntryIndex = entryIndex;
+    }
+
+    void Zipper::closeFile()
+    {
+        _currentFileReader.reset(); // may still be reading
+        _currentFileEntryIndex.reset();
+        if (_currentFileFd >= 0)
+        {
+            ::close(_currentFileFd);
+            _currentFileFd = -1;
+        }
+    }
+
+    std::uint32_t Zipper::getCrc32(std::size_t entryIndex)
+    {
+        FileEntry& entry{ _entries[entryIndex] };
+        if (!entry.crc32)
+        {
+            if (_pendingCrc32EntryIndex == entryIndex)
+            {
+                _pendingCrc32EntryIndex.reset();
+                entry.crc32 = _pendingCrc32.get();
+            }
+            else
+            {
+                const std::atomic<bool> cancelled{};
+                entry.crc32 = computeCrc32(entry.filePath, entry.size, entry.lastWriteTime, cancelled);
+            }
+        }
+
+        // the next entry is likely to be requested soon
+        const std::size_t nextEntryIndex{ entryIndex + 1 };
+        if (!_pendingCrc32EntryIndex && nextEntryIndex < _entries.size() && !_entries[nextEntryIndex].crc32)
+        {
+            const FileEntry& nextEntry{ _entries[nextEntryIndex] };
+
+            _pendingCrc32Cancelled = std::make_shared<std::atomic<bool>>(false);
+            _pendingCrc32 = std::async(std::launch::async, [path = nextEntry.filePath, size = nextEntry.size, lastWriteTime = nextEntry.lastWriteTime, cancelled = _pendingCrc32Cancelled]
+                {
+                    return computeCrc32(path, size, lastWriteTime, *cancelled);
+                });
+            _pendingCrc32EntryIndex = nextEntryIndex;
+        }
+
+        return *entry.crc32;
+    }
+
+    std::vector<std::byte> Zipper::serializeLocalHeader(std::size_t entryIndex)
+    {
+        const std::uint32_t crc32{ getCrc32(entryIndex) };
+        const FileEntry& entry{ _entries[entryIndex] };
+        const bool zip64{ entry.size >= maxUInt32 };
+        const DosDateTime dosDateTime{ toDosDateTime(entry.lastWriteTime) };
+
+        std::vector<std::byte> header;
+        header.reserve(entry.getLocalHeaderSize());
+
+        ByteWriter writer{ header };
+        writer.write32(localFileHeaderSignature);
+        writer.write16(zip64 ? versionZip64 : versionDefault);
+        writer.write16(flagUTF8Names);
+        writer.write16(compressionMethodStore);
+        writer.write16(dosDateTime.time);
+        writer.write16(dosDateTime.date);
+        writer.write32(crc32);
+        writer.write32(zip64 ? maxUInt32 : entry.size); // compressed size
+        writer.write32(zip64 ? maxUInt32 : entry.size); // uncompressed size
+        writer.write16(entry.fileName.size());
+        writer.write16(zip64 ? localHeaderZip64ExtraFieldSize : 0);
+        writer.writeString(entry.fileName);
+        if (zip64)
+        {
+            writer.write16(zip64ExtraFieldId);
+            writer.write16(localHeaderZip64ExtraFieldSize - 4);
+            writer.write64(entry.size);
+            writer.write64(entry.size);
+        }
+
+        assert(header.size() == entry.getLocalHeaderSize());
+        return header;
+    }
+
+    std::vector<std::byte> Zipper::serializeCentralDirectory()
+    {
+        std::vector<std::byte> centralDirectory;
+        centralDirectory.reserve(_totalSize - _centralDirectoryOffset);
+
+        ByteWriter writer{ centralDirectory };
+        for (std::size_t entryIndex{}; entryIndex < _entries.size(); ++entryIndex)
+        {
+            const std::uint32_t crc32{ getCrc32(entryIndex) };
+            const FileEntry& entry{ _entries[entryIndex] };
+            const bool zip64{ entry.size >= maxUInt32 || entry.localHeaderOffset >= maxUInt32 };
+            const DosDateTime dosDateTime{ toDosDateTime(entry.lastWriteTime) };
+
+            writer.write32(centralDirectoryHeaderSignature);
+            writer.write16(versionMadeBy);
+            writer.write16(zip64 ? versionZip64 : versionDefault);
+            writer.write16(flagUTF8Names);
+            writer.write16(compressionMethodStore);
+            writer.write16(dosDateTime.time);
+            writer.write16(dosDateTime.date);
+            writer.write32(crc32);
+            writer.write32(zip64 ? maxUInt32 : entry.size); // compressed size
+            writer.write32(zip64 ? maxUInt32 : entry.size); // uncompressed size
+            writer.write16(entry.fileName.size());
+            writer.write16(zip64 ? centralDirectoryHeaderZip64ExtraFieldSize : 0);
+            writer.write16(0); // comment length
+            writer.write16(0); // disk number
+            writer.write16(0); // internal attributes
+            writer.write32(static_cast<std::uint64_t>(S_IFREG | (entry.mode & 07777)) << 16); // unix mode as external attributes
+            writer.write32(zip64 ? maxUInt32 : entry.localHeaderOffset);
+            writer.writeString(entry.fileName);
+            if (zip64)
+            {
+                writer.write16(zip64ExtraFieldId);
+                writer.write16(centralDirectoryHeaderZip64ExtraFieldSize - 4);
+                writer.write64(entry.size);
+                writer.write64(entry.size);
+                writer.write64(entry.localHeaderOffset);
+            }
+        }
+        assert(centralDirectory.size() == _centralDirectorySize);
+
+        if (needsZip64EndOfCentralDirectory())
+        {
+            writer.write32(zip64EndOfCentralDirectorySignature);
+            writer.write64(zip64EndOfCentralDirectorySize - 12); // remaining record size
+            writer.write16(versionMadeBy);
+            writer.write16(versionZip64);
+            writer.write32(0); // disk number
+            writer.write32(0); // disk with the central directory
+            writer.write64(_entries.size()); // on this disk
+            writer.write64(_entries.size());
+            writer.write64(_centralDirectorySize);
+            writer.write64(_centralDirectoryOffset);
+
+            writer.write32(zip64EndOfCentralDirectoryLocatorSignature);
+            writer.write32(0); // disk with the zip64 end of central directory
+            writer.write64(_centralDirectoryOffset + _centralDirectorySize);
+            writer.write32(1); // disk count
+        }
+
+        writer.write32(endOfCentralDirectorySignature);
+        writer.write16(0); // disk number
+        writer.write16(0); // disk with the central directory
+        writer.write16(std::min<std::uint64_t>(_entries.size(), maxUInt16)); // on this disk
+        writer.write16(std::min<std::uint64_t>(_entries.size(), maxUInt16));
+        writer.write32(std::min(_centralDirectorySize, maxUInt32));
+        writer.write32(std::min(_centralDirectoryOffset, maxUInt32));
+        writer.write16(0); // comment length
+
+        assert(_centralDirectoryOffset + centralDirectory.size() == _totalSize);
+        return centralDirectory;
+    }
+
+    bool Zipper::needsZip64EndOfCentralDirectory() const
+    {
+        return _entries.size() >= maxUInt16 || _centralDirectorySize >= maxUInt32 || _centralDirectoryOffset >= maxUInt32;
+    }
+} // namespace Zip
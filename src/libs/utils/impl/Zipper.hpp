@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+#include "utils/IZipper.hpp"
+#include "SequentialFileReader.hpp"
+
+namespace Zip
+{
+    // Store only archive writer (audio files are already compressed): the archive layout and size are known up front, so that any byte range can be written
+    // Entries are written with their CRC in their local header: the CRC of the next entry is computed in the background while the current one is written
+    class Zipper final : public IZipper
+    {
+    public:
+        Zipper(const EntryContainer& entries);
+        ~Zipper() override;
+
+        Zipper(const Zipper&) = delete;
+        Zipper& operator=(const Zipper&) = delete;
+
+    private:
+        std::uint64_t getTotalSize() const override { return _totalSize; }
+        void setByteRange(std::uint64_t firstByte, std::uint64_t endByte) override;
+        std::uint64_t writeSome(std::ostream& output) override;
+        bool isComplete() const override;
+        void abort() override;
+
+        struct FileEntry
+        {
+            std::string fileName;
+            std::filesystem::path filePath;
+            std::uint64_t size{};
+            ::time_t lastWriteTime{};
+            ::mode_t mode{};
+            std::uint64_t localHeaderOffset{};
+            std::optional<std::uint32_t> crc32;
+
+            std::uint64_t getLocalHeaderSize() const;
+            std::uint64_t getCentralDirectoryHeaderSize() const;
+        };
+
+        std::uint64_t writeSomePart(std::ostream& output);
+        std::uint64_t writeSomeFileData(std::ostream& output, std::size_t entryIndex, std::uint64_t dataOffset);
+        std::uint64_t writeBytes(std::ostream& output, std::span<const std::byte> bytes, std::uint64_t bytesOffset);
+        void openFile(std::size_t entryIndex, std::uint64_t dataOffset);
+        void closeFile();
+
+        std::uint32_t getCrc32(std::size_t entryIndex); // blocks until computed
+        std::vector<std::byte> serializeLocalHeader(std::size_t entryIndex);
+        std::vector<std::byte> serializeCentralDirectory();
+        bool needsZip64EndOfCentralDirectory() const;
+
+        std::vector<FileEntry> _entries;
+        std::uint64_t _centralDirectoryOffset{};
+        std::uint64_t _centralDirectorySize{};
+        std::uint64_t _totalSize{};
+
+        std::uint64_t _offset{}; // next byte to write
+        std::uint64_t _endOffset{};
+        bool _started{};
+        bool _aborted{};
+
+        // data of the entry being written
+        std::optional<std::size_t> _currentFileEntryIndex;
+        int _currentFileFd{ -1 };
+        std::unique_ptr<SequentialFileReader> _currentFileReader;
+
+        std::optional<std::size_t> _pendingCrc32EntryIndex;
+        std::future<std::uint32_t> _pendingCrc32;
+        std::shared_ptr<std::atomic<bool>> _pendingCrc32Cancelled;
+
+        std::vector<std::byte> _centralDirectory; // serialized once all the CRCs are known
+    };
+} // namespace Zip
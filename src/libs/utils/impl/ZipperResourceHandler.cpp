@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ZipperResourceHandler.hpp"
+
+#include <sstream>
+
+#include "utils/ILogger.hpp"
+#include "utils/ZipperResourceHandlerCreator.hpp"
+
+std::unique_ptr<IResourceHandler> createZipperResourceHandler(std::unique_ptr<Zip::IZipper> zipper)
+{
+    return std::make_unique<ZipperResourceHandler>(std::move(zipper));
+}
+
+ZipperResourceHandler::ZipperResourceHandler(std::unique_ptr<Zip::IZipper> zipper)
+    : _zipper{ std::move(zipper) }
+{
+}
+
+Wt::Http::ResponseContinuation*
+ZipperResourceHandler::processRequest(const Wt::Http::Request& request, Wt::Http::Response& response)
+{
+    if (!_started)
+    {
+        _started = true;
+
+        const std::uint64_t totalSize{ _zipper->getTotalSize() };
+        LMS_LOG(UTILS, DEBUG, "Zip archive size = " << totalSize);
+
+        response.addHeader("Accept-Ranges", "bytes");
+
+        const Wt::Http::Request::ByteRangeSpecifier ranges{ request.getRanges(totalSize) };
+        if (!ranges.isSatisfiable())
+        {
+            std::ostringstream contentRange;
+            contentRange << "bytes */" << totalSize;
+            response.setStatus(416); // Requested range not satisfiable
+            response.addHeader("Content-Range", contentRange.str());
+
+            LMS_LOG(UTILS, DEBUG, "Range not satisfiable");
+            return {};
+        }
+
+        if (ranges.size() == 1)
+        {
+            LMS_LOG(UTILS, DEBUG, "Range requested = " << ranges[0].firstByte() << "-" << ranges[0].lastByte());
+
+            const std::uint64_t firstByte{ ranges[0].firstByte() };
+            const std::uint64_t endByte{ ranges[0].lastByte() + 1 };
+            _zipper->setByteRange(firstByte, endByte);
+
+            std::ostringstream contentRange;
+            contentRange << "bytes " << firstByte << "-" << endByte - 1 << "/" << totalSize;
+
+            response.setStatus(206);
+            response.addHeader("Content-Range", contentRange.str());
+            response.setContentLength(endByte - firstByte);
+        }
+        else
+        {
+            response.setStatus(200);
+            response.setContentLength(totalSize);
+        }
+
+        response.setMimeType("application/zip");
+    }
+
+    try
+    {
+        _zipper->writeSome(response.out());
+    }
+    catch (const Zip::Exception& e)
+    {
+        // Content-Length already sent: the client will see a truncated response
+        LMS_LOG(UTILS, ERROR, "Zipper exception: " << e.what());
+        _zipper->abort();
+        return {};
+    }
+
+    if (!_zipper->isComplete())
+        return response.createContinuation();
+
+    LMS_LOG(UTILS, DEBUG, "Job complete!");
+    return {};
+}
+
+void ZipperResourceHandler::abort()
+{
+    _zipper->abort();
+}
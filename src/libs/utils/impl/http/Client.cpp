@@ -23,9 +23,9 @@
 namespace Http
 {
 	std::unique_ptr<IClient>
-	createClient(boost::asio::io_context& ioContext, std::string_view baseUrl)
+	createClient(boost::asio::io_context& ioContext, std::string_view baseUrl, const ClientParameters& parameters)
 	{
-		return std::make_unique<Client>(ioContext, baseUrl);
+		return std::make_unique<Client>(ioContext, baseUrl, parameters);
 	}
 
 	void
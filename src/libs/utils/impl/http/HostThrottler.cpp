@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "HostThrottler.hpp"
+
+#include <algorithm>
+#include <unordered_map>
+
+namespace Http
+{
+	std::shared_ptr<HostThrottler>
+	HostThrottler::get(std::string_view baseUrl)
+	{
+		static std::mutex mutex;
+		static std::unordered_map<std::string, std::weak_ptr<HostThrottler>> throttlers;
+
+		const std::string host {getHostFromUrl(baseUrl)};
+
+		const std::scoped_lock lock {mutex};
+
+		std::weak_ptr<HostThrottler>& entry {throttlers[host]};
+		std::shared_ptr<HostThrottler> res {entry.lock()};
+		if (!res)
+		{
+			res = std::make_shared<HostThrottler>(host);
+			entry = res;
+		}
+
+		return res;
+	}
+
+	void
+	HostThrottler::throttle(std::chrono::steady_clock::duration duration)
+	{
+		const std::scoped_lock lock {_mutex};
+		_throttledUntil = std::max(_throttledUntil, std::chrono::steady_clock::now() + duration);
+	}
+
+	std::optional<std::chrono::steady_clock::time_point>
+	HostThrottler::getThrottledUntil() const
+	{
+		const std::scoped_lock lock {_mutex};
+
+		if (_throttledUntil <= std::chrono::steady_clock::now())
+			return std::nullopt;
+
+		return _throttledUntil;
+	}
+
+	std::string_view
+	getHostFromUrl(std::string_view url)
+	{
+		std::size_t hostStart {url.find("://")};
+		hostStart = (hostStart == std::string_view::npos) ? 0 : hostStart + 3;
+
+		const std::size_t hostEnd {url.find('/', hostStart)};
+		return url.substr(0, hostEnd);
+	}
+} // namespace Http
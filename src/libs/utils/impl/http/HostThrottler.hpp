@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace Http
+{
+	// Server side rate limits apply to all the requests sent to a host, whatever the client or connection used:
+	// all the clients of the same host share the same throttle state
+	class HostThrottler
+	{
+		public:
+			static std::shared_ptr<HostThrottler> get(std::string_view baseUrl);
+
+			HostThrottler(std::string_view host) : _host {host} {}
+
+			HostThrottler(const HostThrottler&) = delete;
+			HostThrottler& operator=(const HostThrottler&) = delete;
+
+			const std::string& getHost() const { return _host; }
+
+			// no request can be sent to the host before now + duration
+			void throttle(std::chrono::steady_clock::duration duration);
+
+			// none if a request can be sent now
+			std::optional<std::chrono::steady_clock::time_point> getThrottledUntil() const;
+
+		private:
+			const std::string _host;
+
+			mutable std::mutex _mutex;
+			std::chrono::steady_clock::time_point _throttledUntil;
+	};
+
+	// "https://api.listenbrainz.org/1" -> "https://api.listenbrainz.org"
+	std::string_view getHostFromUrl(std::string_view url);
+} // namespace Http
@@ -19,6 +19,8 @@
 
 #include "SendQueue.hpp"
 
+#include <algorithm>
+
 #include <boost/asio/dispatch.hpp>
 #include <boost/asio/bind_executor.hpp>
 
@@ -60,22 +62,28 @@ namespace
 
 namespace Http
 {
-	SendQueue::SendQueue(boost::asio::io_context& ioContext, std::string_view baseUrl)
+	SendQueue::SendQueue(boost::asio::io_context& ioContext, std::string_view baseUrl, std::size_t maxConcurrentRequestCount)
 	: _ioContext {ioContext}
 	, _baseUrl {baseUrl}
+	, _hostThrottler {HostThrottler::get(baseUrl)}
 	{
-		_client.done().connect([this](Wt::AsioWrapper::error_code ec, const Wt::Http::Message& msg)
+		for (std::size_t i {}; i < std::max<std::size_t>(maxConcurrentRequestCount, 1); ++i)
 		{
-			_strand.dispatch([this, ec, msg = std::move(msg)]
+			Lane& lane {*_lanes.emplace_back(std::make_unique<Lane>(_ioContext))};
+			lane.client.done().connect([this, &lane](Wt::AsioWrapper::error_code ec, const Wt::Http::Message& msg)
 			{
-				onClientDone(ec, msg);
+				_strand.dispatch([this, &lane, ec, msg = std::move(msg)]
+				{
+					onClientDone(lane, ec, msg);
+				});
 			});
-		});
+		}
 	}
 
 	SendQueue::~SendQueue()
 	{
-		_client.abort();
+		for (auto& lane : _lanes)
+			lane->client.abort();
 	}
 
 	void
@@ -85,50 +93,76 @@ namespace Http
 		{
 			_sendQueue[request->getParameters().priority].emplace_back(std::move(request));
 
-			if (_state == State::Idle)
-				sendNextQueuedRequest();
+			sendQueuedRequests();
 		});
 	}
 
 	void
-	SendQueue::sendNextQueuedRequest()
+	SendQueue::sendQueuedRequests()
 	{
-		assert(_state == State::Idle);
-		assert(!_currentRequest);
+		if (_throttleTimerPending)
+			return;
 
-		for (auto& [prio, requests] : _sendQueue)
+		// may have been throttled by another client of the same host
+		if (const auto throttledUntil {_hostThrottler->getThrottledUntil()})
 		{
-			LOG(DEBUG, "Processing prio " << static_cast<int>(prio) << ", request count = " << requests.size());
-			while (!requests.empty())
-			{
-				std::unique_ptr<ClientRequest> request {std::move(requests.front())};
-				requests.pop_front();
+			waitThrottle(*throttledUntil);
+			return;
+		}
+
+		for (auto& lane : _lanes)
+		{
+			if (lane->request)
+				continue;
 
-				if (!sendRequest(*request))
+			while (std::unique_ptr<ClientRequest> request {popNextRequest()})
+			{
+				if (!sendRequest(*lane, *request))
 					continue;
 
-				_state = State::Sending;
-				_currentRequest = std::move(request);
-				return;
+				lane->request = std::move(request);
+				break;
 			}
+
+			if (!lane->request)
+				return; // no more queued request
+		}
+	}
+
+	std::unique_ptr<ClientRequest>
+	SendQueue::popNextRequest()
+	{
+		for (auto& [prio, requests] : _sendQueue)
+		{
+			if (requests.empty())
+				continue;
+
+			LOG(DEBUG, "Processing prio " << static_cast<int>(prio) << ", request count = " << requests.size());
+			std::unique_ptr<ClientRequest> request {std::move(requests.front())};
+			requests.pop_front();
+			return request;
 		}
+
+		return {};
 	}
 
 	bool
-	SendQueue::sendRequest(const ClientRequest& request)
+	SendQueue::sendRequest(Lane& lane, const ClientRequest& request)
 	{
 		std::string url {_baseUrl + request.getParameters().relativeUrl};
 		LOG(DEBUG, "Sending request to url '" << url << "'");
 
+		lane.client.setMaximumResponseSize(request.getParameters().maxResponseBodySize);
+
 		bool res {};
 		switch (request.getType())
 		{
 			case ClientRequest::Type::GET:
-				res = _client.get(url, request.getGETParameters().headers);
+				res = lane.client.get(url, request.getGETParameters().headers);
 				break;
 
 			case ClientRequest::Type::POST:
-				res = _client.post(url, request.getPOSTParameters().message);
+				res = lane.client.post(url, request.getPOSTParameters().message);
 				break;
 		}
 
@@ -139,7 +173,7 @@ namespace Http
 	}
 
 	void
-	SendQueue::onClientDone(Wt::AsioWrapper::error_code ec, const Wt::Http::Message& msg)
+	SendQueue::onClientDone(Lane& lane, Wt::AsioWrapper::error_code ec, const Wt::Http::Message& msg)
 	{
 		if (ec == boost::asio::error::operation_aborted)
 		{
@@ -147,14 +181,16 @@ namespace Http
 			return;
 		}
 
-		assert(_currentRequest);
-		_state = State::Idle;
+		assert(lane.request);
+		std::unique_ptr<ClientRequest> request {std::move(lane.request)};
 
 		LOG(DEBUG, "Client done. status = " << msg.status());
 		if (ec)
-			onClientDoneError(std::move(_currentRequest), ec);
+			onClientDoneError(std::move(request), ec);
 		else
-			onClientDoneSuccess(std::move(_currentRequest), msg);
+			onClientDoneSuccess(std::move(request), msg);
+
+		sendQueuedRequests();
 	}
 
 	void
@@ -163,7 +199,15 @@ namespace Http
 		LOG(ERROR, "Retry " << request->retryCount << ", client error: '" << ec.message() << "'");
 
 		// may be a network error, try again later
-		throttle(_defaultRetryWaitDuration);
+		retryLater(std::move(request));
+	}
+
+	void
+	SendQueue::retryLater(std::unique_ptr<ClientRequest> request)
+	{
+		// exponential backoff, shared by all the requests since the server is likely to be unavailable
+		throttle(_retryWaitDuration);
+		_retryWaitDuration = std::min(_retryWaitDuration * 2, _maxRetryWaitDuration);
 
 		if (request->retryCount++ < _maxRetryCount)
 		{
@@ -181,6 +225,14 @@ namespace Http
 	SendQueue::onClientDoneSuccess(std::unique_ptr<ClientRequest> request, const Wt::Http::Message& msg)
 	{
 		const ClientRequestParameters& requestParameters {request->getParameters()};
+
+		if (msg.status() >= 500)
+		{
+			LOG(ERROR, "Retry " << request->retryCount << ", server error: status = " << msg.status());
+			retryLater(std::move(request));
+			return;
+		}
+
 		bool mustThrottle{};
 		if (msg.status() == 429)
 		{
@@ -192,12 +244,17 @@ namespace Http
 		LOG(DEBUG, "Remaining messages = " << (remainingCount ? *remainingCount : 0));
 		if (mustThrottle || (remainingCount && *remainingCount == 0))
 		{
-			const auto waitDuration {headerReadAs<std::chrono::seconds>(msg, "X-RateLimit-Reset-In")};
+			std::optional<std::chrono::seconds> waitDuration {headerReadAs<std::chrono::seconds>(msg, "X-RateLimit-Reset-In")};
+			if (!waitDuration)
+				waitDuration = headerReadAs<std::chrono::seconds>(msg, "Retry-After");
 			throttle(waitDuration.value_or(_defaultRetryWaitDuration));
 		}
 
 		if (!mustThrottle)
 		{
+			// the server answered, no need to back off anymore
+			_retryWaitDuration = _minRetryWaitDuration;
+
 			if (msg.status() == 200)
 			{
 				if (requestParameters.onSuccessFunc)
@@ -210,21 +267,26 @@ namespace Http
 					requestParameters.onFailureFunc();
 			}
 		}
-
-		if (_state == State::Idle)
-			sendNextQueuedRequest();
 	}
 
 	void
 	SendQueue::throttle(std::chrono::seconds requestedDuration)
 	{
-		assert(_state == State::Idle);
-
 		const std::chrono::seconds duration {clamp(requestedDuration, _minRetryWaitDuration, _maxRetryWaitDuration)};
-		LOG(DEBUG, "Throttling for " << duration.count() << " seconds");
+		LOG(DEBUG, "Throttling host '" << _hostThrottler->getHost() << "' for " << duration.count() << " seconds");
 
-		_throttleTimer.expires_after(duration);
-		_throttleTimer.async_wait([this](const boost::system::error_code& ec)
+		// requests already being sent on other lanes are not cancelled
+		_hostThrottler->throttle(duration);
+	}
+
+	void
+	SendQueue::waitThrottle(std::chrono::steady_clock::time_point throttledUntil)
+	{
+		assert(!_throttleTimerPending);
+
+		_throttleTimerPending = true;
+		_throttleTimer.expires_at(throttledUntil);
+		_throttleTimer.async_wait(boost::asio::bind_executor(_strand, [this](const boost::system::error_code& ec)
 		{
 			if (ec == boost::asio::error::operation_aborted)
 			{
@@ -236,9 +298,8 @@ namespace Http
 				throw LmsException {"Throttle timer failure: " + std::string {ec.message()} };
 			}
 
-			_state = State::Idle;
-			sendNextQueuedRequest();
-		});
-		_state = State::Throttled;
+			_throttleTimerPending = false;
+			sendQueuedRequests();
+		}));
 	}
 } // namespace Scrobbling::ListenBrainz
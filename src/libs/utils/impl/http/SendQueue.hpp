@@ -20,6 +20,7 @@
 #pragma once
 
 #include <deque>
+#include <memory>
 #include <vector>
 #include <string_view>
 
@@ -29,13 +30,15 @@
 
 #include <Wt/Http/Client.h>
 #include "ClientRequest.hpp"
+#include "HostThrottler.hpp"
 
 namespace Http
 {
+	// Requests are sent by priority order, using up to maxConcurrentRequestCount connections at a time
 	class SendQueue
 	{
 		public:
-			SendQueue(boost::asio::io_context& ioContext, std::string_view baseUrl);
+			SendQueue(boost::asio::io_context& ioContext, std::string_view baseUrl, std::size_t maxConcurrentRequestCount);
 			~SendQueue();
 
 			SendQueue(const SendQueue&) = delete;
@@ -46,33 +49,39 @@ namespace Http
 			void sendRequest(std::unique_ptr<ClientRequest> request);
 
 		private:
-			void sendNextQueuedRequest();
-			bool sendRequest(const ClientRequest& request);
-			void onClientDone(Wt::AsioWrapper::error_code ec, const Wt::Http::Message& msg);
+			struct Lane
+			{
+				Lane(boost::asio::io_context& ioContext) : client {ioContext} {}
+
+				Wt::Http::Client				client;
+				std::unique_ptr<ClientRequest>	request; // being sent, if any
+			};
+
+			void sendQueuedRequests();
+			std::unique_ptr<ClientRequest> popNextRequest();
+			bool sendRequest(Lane& lane, const ClientRequest& request);
+			void onClientDone(Lane& lane, Wt::AsioWrapper::error_code ec, const Wt::Http::Message& msg);
 			void onClientDoneError(std::unique_ptr<ClientRequest> request, Wt::AsioWrapper::error_code ec);
+			void retryLater(std::unique_ptr<ClientRequest> request);
 			void onClientDoneSuccess(std::unique_ptr<ClientRequest> request, const Wt::Http::Message& msg);
 			void throttle(std::chrono::seconds duration);
+			void waitThrottle(std::chrono::steady_clock::time_point throttledUntil);
 
-			const std::size_t			_maxRetryCount {2};
-			const std::chrono::seconds	_defaultRetryWaitDuration {30};
+			const std::size_t			_maxRetryCount {5};
+			const std::chrono::seconds	_defaultRetryWaitDuration {30}; // when rate limited without any hint
 			const std::chrono::seconds	_minRetryWaitDuration {1};
 			const std::chrono::seconds	_maxRetryWaitDuration {300};
+			std::chrono::seconds		_retryWaitDuration {_minRetryWaitDuration}; // doubled after each failure, reset on success
 
 			boost::asio::io_context&		_ioContext;
 			boost::asio::io_context::strand	_strand {_ioContext};
 			boost::asio::steady_timer		_throttleTimer {_ioContext};
 			std::string						_baseUrl;
+			std::shared_ptr<HostThrottler>	_hostThrottler;
 
-			enum class State
-			{
-				Idle,
-				Throttled,
-				Sending,
-			};
-			State								_state {State::Idle};
-			Wt::Http::Client					_client {_ioContext};
+			bool								_throttleTimerPending {};
+			std::vector<std::unique_ptr<Lane>>	_lanes;
 			std::map<ClientRequestParameters::Priority, std::deque<std::unique_ptr<ClientRequest>>> _sendQueue;
-			std::unique_ptr<ClientRequest>		_currentRequest;
 	};
 
 } // namespace Scrobbling::ListenBrainz
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "utils/ILogger.hpp"
+#include "utils/MPSCQueue.hpp"
+
+class LogFilter;
+
+// Logs are formatted on the calling thread, then queued and written by a background thread
+// The queue is bounded: logs are dropped (and counted) if it is full. Fatal logs are written at once
+class AsyncLogger final : public ILogger
+{
+public:
+    struct Record
+    {
+        Severity severity{};
+        Module module{};
+        std::thread::id threadId;
+        std::string message;
+    };
+    using Writer = std::function<void(const Record&)>;
+
+    AsyncLogger(const LogFilter& filter, std::size_t queueCapacity, Writer writer); // filter must outlive the logger
+    ~AsyncLogger() override; // writes the pending logs
+
+    AsyncLogger(const AsyncLogger&) = delete;
+    AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+    std::uint64_t getDroppedCount() const { return _droppedCount.load(std::memory_order_relaxed); }
+
+private:
+    bool isSeverityActive(Module module, Severity severity) const override;
+    void processLog(const Log& log) override;
+
+    void run();
+    void write(const Record& record);
+    void reportDroppedRecords();
+
+    const LogFilter& _filter;
+    const Writer _writer;
+    std::mutex _writerMutex; // fatal logs are written by the calling thread
+    Utils::MPSCQueue<Record> _queue;
+    std::atomic<bool> _hasPendingRecords{};
+    std::atomic<bool> _stopRequested{};
+    std::atomic<std::uint64_t> _droppedCount{};
+    std::uint64_t _reportedDroppedCount{};
+    std::thread _thread;
+};
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Utils
+{
+    // Compressed set of 32-bit values (roaring bitmap like)
+    // Values are split by their 16 high bits into containers: sparse containers store the sorted low bits, dense ones a 65536-bit bitmap
+    class CompressedBitmap
+    {
+    public:
+        // values are expected to be mostly added in increasing order, any order is supported though
+        void add(std::uint32_t value);
+        bool contains(std::uint32_t value) const;
+
+        bool isEmpty() const { return _containers.empty(); }
+        std::size_t getCount() const;
+        std::size_t getMemoryUsage() const; // approximate, in bytes
+
+        static CompressedBitmap intersect(const CompressedBitmap& lhs, const CompressedBitmap& rhs);
+
+        // in increasing order
+        template <typename Func>
+        void visit(Func&& func) const
+        {
+            for (const Container& container : _containers)
+            {
+                const std::uint32_t high{ static_cast<std::uint32_t>(container.key) << 16 };
+                if (!container.isBitmap())
+                {
+                    for (const std::uint16_t low : container.values)
+                        func(high | low);
+                }
+                else
+                {
+                    for (std::size_t wordIndex{}; wordIndex < container.words.size(); ++wordIndex)
+                    {
+                        for (std::uint64_t word{ container.words[wordIndex] }; word != 0; word &= word - 1)
+                            func(high | static_cast<std::uint32_t>(wordIndex * 64 + std::countr_zero(word)));
+                    }
+                }
+            }
+        }
+        std::vector<std::uint32_t> toVector() const;
+
+    private:
+        static constexpr std::size_t maxArrayContainerSize{ 4096 }; // above this, a bitmap (8 KiB) is smaller
+        static constexpr std::size_t bitmapWordCount{ 65536 / 64 };
+
+        struct Container
+        {
+            explicit Container(std::uint16_t _key) : key{ _key } {}
+
+            std::uint16_t key; // 16 high bits of the values
+            std::uint32_t count{};
+            std::vector<std::uint16_t> values; // sorted low bits, for sparse containers
+            std::vector<std::uint64_t> words; // for dense containers
+
+            bool isBitmap() const { return !words.empty(); }
+            void convertToBitmap();
+            void convertToArray();
+        };
+
+        std::vector<Container> _containers; // sorted by key
+    };
+} // namespace Utils
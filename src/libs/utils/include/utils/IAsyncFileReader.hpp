@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <span>
+#include <system_error>
+
+// Reads files without blocking the callers, so that many reads can be in flight using few threads
+// Uses io_uring if supported by the system, a thread pool otherwise
+class IAsyncFileReader
+{
+public:
+    virtual ~IAsyncFileReader() = default;
+
+    // Called from an internal thread, must not block
+    // A read size lower than the requested one means the end of the file has been reached
+    using ReadCallback = std::function<void(std::error_code ec, std::size_t readSize)>;
+
+    // fd and buffer must be kept valid until the callback is called
+    virtual void asyncRead(int fd, std::uint64_t offset, std::span<std::byte> buffer, ReadCallback callback) = 0;
+
+    // Hints the system to load the start of the file in the page cache, in the background
+    virtual void prefetch(const std::filesystem::path& path, std::size_t size) = 0;
+
+    // Buffers of getBufferSize() bytes, taken from a pool registered to the kernel if possible (saves mapping the pages for each read)
+    // A plain buffer is allocated if the pool is exhausted
+    class BufferDeleter
+    {
+    public:
+        BufferDeleter() = default;
+        BufferDeleter(IAsyncFileReader* reader) : _reader{ reader } {}
+        void operator()(std::byte* data) const { _reader->releaseBuffer(data); }
+
+    private:
+        IAsyncFileReader* _reader{};
+    };
+    using Buffer = std::unique_ptr<std::byte[], BufferDeleter>;
+    virtual Buffer acquireBuffer() = 0;
+    virtual std::size_t getBufferSize() const = 0;
+
+private:
+    virtual void releaseBuffer(std::byte* data) = 0;
+};
+
+struct AsyncFileReaderParameters
+{
+    bool useIoUring{ true };
+    std::size_t threadCount{ 2 };           // workers of the thread pool, used for the prefetches and if io_uring is not used
+    std::size_t queueDepth{ 64 };           // max in flight reads, further calls to asyncRead block
+    std::size_t bufferCount{ 16 };          // in the registered buffer pool
+    std::size_t bufferSize{ 262'144 };
+};
+std::unique_ptr<IAsyncFileReader> createAsyncFileReader(const AsyncFileReaderParameters& parameters);
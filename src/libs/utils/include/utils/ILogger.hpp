@@ -19,7 +19,10 @@
 
 #pragma once
 
+#include <cstddef>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <sstream>
 
 #include "utils/String.hpp"
@@ -56,9 +59,13 @@ enum class Module
     UI,
     UTILS,
 };
+constexpr std::size_t moduleCount{ static_cast<std::size_t>(Module::UTILS) + 1 };
 
 const char* getModuleName(Module mod);
 const char* getSeverityName(Severity sev);
+// case insensitive
+std::optional<Module> parseModuleName(std::string_view name);
+std::optional<Severity> parseSeverityName(std::string_view name);
 
 class ILogger;
 class Log
@@ -88,13 +95,13 @@ class ILogger
 public:
     virtual ~ILogger() = default;
 
-    virtual bool isSeverityActive(Severity severity) const = 0;
+    virtual bool isSeverityActive(Module module, Severity severity) const = 0;
     virtual void processLog(const Log& log) = 0;
 };
 
 #define LMS_LOG(module, severity, message) \
     do \
     { \
-        if (auto* logger_ {::Service<::ILogger>::get()}; logger_ && logger_->isSeverityActive(::Severity::severity)) \
+        if (auto* logger_ {::Service<::ILogger>::get()}; logger_ && logger_->isSeverityActive(::Module::module, ::Severity::severity)) \
             ::Log{ *logger_, ::Module::module, ::Severity::severity }.getOstream() << message; \
     } while(0)
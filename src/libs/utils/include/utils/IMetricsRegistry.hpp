@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Server internals exposed using the Prometheus text format
+// Metrics are registered once and never removed: callers are expected to keep the returned references
+// Updating a metric is lock free
+namespace Metrics
+{
+    class Counter
+    {
+    public:
+        void inc(std::uint64_t value = 1) { _value.fetch_add(value, std::memory_order_relaxed); }
+        std::uint64_t get() const { return _value.load(std::memory_order_relaxed); }
+
+    private:
+        std::atomic<std::uint64_t> _value{};
+    };
+
+    class Gauge
+    {
+    public:
+        void set(std::int64_t value) { _value.store(value, std::memory_order_relaxed); }
+        void inc(std::int64_t value = 1) { _value.fetch_add(value, std::memory_order_relaxed); }
+        void dec(std::int64_t value = 1) { _value.fetch_sub(value, std::memory_order_relaxed); }
+        std::int64_t get() const { return _value.load(std::memory_order_relaxed); }
+
+    private:
+        std::atomic<std::int64_t> _value{};
+    };
+
+    class Histogram
+    {
+    public:
+        // upperBounds must be sorted, the +Inf bucket is implicit
+        Histogram(std::span<const double> upperBounds);
+
+        Histogram(const Histogram&) = delete;
+        Histogram& operator=(const Histogram&) = delete;
+
+        void observe(double value);
+        template <typename Rep, typename Period>
+        void observe(std::chrono::duration<Rep, Period> duration) { observe(std::chrono::duration<double>{ duration }.count()); }
+
+        struct Snapshot
+        {
+            std::vector<double> upperBounds;
+            std::vector<std::uint64_t> cumulativeCounts; // one more than upperBounds, for the +Inf bucket
+            double sum{};
+            std::uint64_t count{};
+        };
+        Snapshot getSnapshot() const;
+
+    private:
+        const std::vector<double> _upperBounds;
+        const std::unique_ptr<std::atomic<std::uint64_t>[]> _bucketCounts;
+        std::atomic<double> _sum{};
+        std::atomic<std::uint64_t> _count{};
+    };
+
+    // Suitable for latencies, in seconds
+    inline constexpr std::array<double, 13> defaultDurationBuckets{ 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10 };
+
+    using Labels = std::map<std::string, std::string>;
+
+    class IRegistry
+    {
+    public:
+        virtual ~IRegistry() = default;
+
+        // Getting an already registered metric returns the same instance
+        // Throws LmsException if the name is already used by another kind of metric
+        virtual Counter& getCounter(std::string_view name, std::string_view help, const Labels& labels = {}) = 0;
+        virtual Gauge& getGauge(std::string_view name, std::string_view help, const Labels& labels = {}) = 0;
+        virtual Histogram& getHistogram(std::string_view name, std::string_view help, std::span<const double> upperBounds = defaultDurationBuckets, const Labels& labels = {}) = 0;
+
+        // Text exposition format, version 0.0.4
+        virtual void write(std::ostream& os) const = 0;
+    };
+
+    std::unique_ptr<IRegistry> createRegistry();
+} // namespace Metrics
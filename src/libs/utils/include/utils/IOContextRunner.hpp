@@ -20,13 +20,19 @@
 #pragma once
 
 #include <optional>
+#include <span>
+#include <string>
+#include <string_view>
 #include <thread>
+#include <vector>
 #include <boost/asio/io_service.hpp>
 
 class IOContextRunner
 {
 public:
     IOContextRunner(boost::asio::io_service& ioService, std::size_t threadCount);
+    // If cpus is not empty, the threads are only allowed to run on these CPUs (Linux only)
+    IOContextRunner(boost::asio::io_service& ioService, std::size_t threadCount, std::string_view name, std::span<const unsigned> cpus = {});
     ~IOContextRunner();
 
     void stop();
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <memory>
+
+#include "utils/Service.hpp"
+
+// Lets the background jobs (scans, syncs, ...) back off while live streams are being served
+// or while the HTTP requests are slow, so that they do not compete with the foreground for CPU and disk
+class IResourceGovernor
+{
+public:
+    virtual ~IResourceGovernor() = default;
+
+    // Foreground side
+    virtual void onStreamStarted() = 0;
+    virtual void onStreamEnded() = 0;
+    virtual void addRequestLatency(std::chrono::microseconds latency) = 0;
+
+    // Background side
+    virtual bool isBusy() const = 0; // for the jobs that can postpone themselves
+    virtual void throttle() = 0; // blocks the calling thread for a bounded duration if busy, to be called between work units
+};
+
+struct ResourceGovernorParameters
+{
+    std::chrono::milliseconds streamDelay{ 10 };        // throttle delay while streams are active
+    std::chrono::milliseconds latencyThreshold{ 250 };  // background jobs are paused while the average request latency is above
+    std::chrono::milliseconds maxPause{ 2000 };         // max time spent in a single throttle call
+    std::chrono::milliseconds latencyValidity{ 10000 }; // latencies are not considered anymore if no more recent request is seen
+};
+std::unique_ptr<IResourceGovernor> createResourceGovernor(const ResourceGovernorParameters& parameters);
+
+// Helpers, no effect if no governor is set
+inline void throttleBackgroundWork()
+{
+    if (IResourceGovernor* governor{ Service<IResourceGovernor>::get() })
+        governor->throttle();
+}
+
+inline bool isForegroundBusy()
+{
+    const IResourceGovernor* governor{ Service<IResourceGovernor>::get() };
+    return governor && governor->isBusy();
+}
+
+// Live stream, for its whole lifetime
+class ScopedForegroundStream
+{
+public:
+    ScopedForegroundStream()
+        : _governor{ Service<IResourceGovernor>::get() }
+    {
+        if (_governor)
+            _governor->onStreamStarted();
+    }
+
+    ~ScopedForegroundStream()
+    {
+        if (_governor)
+            _governor->onStreamEnded();
+    }
+
+    ScopedForegroundStream(const ScopedForegroundStream&) = delete;
+    ScopedForegroundStream& operator=(const ScopedForegroundStream&) = delete;
+
+private:
+    IResourceGovernor* _governor;
+};
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+// Sampled tracing spans, kept in memory and exported using the Chrome trace event format (chrome://tracing, Perfetto, ...)
+// Spans nest on a per-thread basis: a span is only recorded if the outermost span of its thread has been sampled
+namespace Tracing
+{
+    enum class Level
+    {
+        Overview,   // requests, transactions, service calls
+        Detailed,   // queries, per object lookups
+    };
+
+    class ITraceLogger
+    {
+    public:
+        virtual ~ITraceLogger() = default;
+
+        virtual bool isLevelActive(Level level) const = 0;
+
+        // Called when an outermost span is started, tells if it has to be recorded along with its nested spans
+        virtual bool sampleNextTrace() = 0;
+
+        struct CompleteEvent
+        {
+            std::chrono::steady_clock::time_point start;
+            std::chrono::steady_clock::duration duration;
+            std::string_view category; // must outlive the trace logger
+            std::string_view name; // must outlive the trace logger
+            std::string arg; // optional
+            std::uint32_t threadId;
+        };
+        // Oldest events are discarded once the buffer is full
+        virtual void write(CompleteEvent&& event) = 0;
+
+        virtual void dump(std::ostream& os) const = 0;
+    };
+
+    struct TraceLoggerParameters
+    {
+        Level minLevel{ Level::Overview };
+        unsigned samplingPeriod{ 1 };           // record one outermost span out of samplingPeriod
+        std::size_t bufferEventCount{ 100'000 };
+    };
+    std::unique_ptr<ITraceLogger> createTraceLogger(const TraceLoggerParameters& parameters);
+
+    class ScopedTrace
+    {
+    public:
+        // category and name must outlive the trace logger, arg is only copied if the span is recorded
+        ScopedTrace(Level level, std::string_view category, std::string_view name, std::string_view arg = {});
+        ~ScopedTrace();
+
+        ScopedTrace(const ScopedTrace&) = delete;
+        ScopedTrace& operator=(const ScopedTrace&) = delete;
+
+    private:
+        bool _stacked{}; // part of the span stack of the thread
+        ITraceLogger* _traceLogger{}; // null if not recorded
+        std::string_view _category;
+        std::string_view _name;
+        std::string _arg;
+        std::chrono::steady_clock::time_point _start;
+    };
+} // namespace Tracing
+
+#define LMS_TRACE_CONCAT_IMPL(a, b) a##b
+#define LMS_TRACE_CONCAT(a, b) LMS_TRACE_CONCAT_IMPL(a, b)
+
+#define LMS_SCOPED_TRACE_OVERVIEW(...) const Tracing::ScopedTrace LMS_TRACE_CONCAT(lmsScopedTrace, __LINE__){ Tracing::Level::Overview, __VA_ARGS__ }
+#define LMS_SCOPED_TRACE_DETAILED(...) const Tracing::ScopedTrace LMS_TRACE_CONCAT(lmsScopedTrace, __LINE__){ Tracing::Level::Detailed, __VA_ARGS__ }
@@ -19,8 +19,10 @@
 
 #pragma once
 
+#include <cstdint>
 #include <filesystem>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "Exception.hpp"
@@ -44,11 +46,17 @@ namespace Zip
 		public:
 			virtual ~IZipper() = default;
 
+			// Size of the whole archive, known before writing anything
+			virtual std::uint64_t getTotalSize() const = 0;
+			// Restricts the output to [firstByte, endByte), must be called before the first writeSome call (defaults to the whole archive)
+			virtual void setByteRange(std::uint64_t firstByte, std::uint64_t endByte) = 0;
+
 			virtual std::uint64_t writeSome(std::ostream& output) = 0;
 			virtual bool isComplete() const = 0;
 			virtual void abort() = 0;
 	};
 
-	std::unique_ptr<IZipper> createArchiveZipper(const EntryContainer& entries);
+	// Entries are stored as is (no compression), throws Exception if a file cannot be accessed
+	std::unique_ptr<IZipper> createZipper(const EntryContainer& entries);
 } // namespace Zip
 
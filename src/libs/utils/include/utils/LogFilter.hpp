@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+
+#include "utils/ILogger.hpp"
+
+// Minimum severity of each module, may be changed at runtime (even from a signal handler)
+class LogFilter
+{
+public:
+    using Severities = std::array<Severity, moduleCount>;
+
+    LogFilter(Severity minSeverity);
+
+    LogFilter(const LogFilter&) = delete;
+    LogFilter& operator=(const LogFilter&) = delete;
+
+    bool isSeverityActive(Module module, Severity severity) const
+    {
+        return static_cast<int>(severity) <= static_cast<int>(_minSeverities[static_cast<std::size_t>(module)].load(std::memory_order_relaxed));
+    }
+
+    Severity getMinSeverity(Module module) const;
+    Severities getMinSeverities() const;
+    // most verbose severity among all the modules
+    Severity getMaxMinSeverity() const;
+
+    void setMinSeverity(Module module, Severity severity);
+    void setMinSeverity(Severity severity); // all modules
+    void setMinSeverities(const Severities& severities);
+
+private:
+    std::array<std::atomic<Severity>, moduleCount> _minSeverities;
+    static_assert(std::atomic<Severity>::is_always_lock_free);
+};
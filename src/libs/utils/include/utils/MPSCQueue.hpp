@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace Utils
+{
+    // Bounded lock-free queue, multiple producers / single consumer
+    // Each slot carries a sequence number telling whether it is free or holds a value, producers only contend on the enqueue position
+    template <typename T>
+    class MPSCQueue
+    {
+    public:
+        // capacity is rounded up to the next power of two
+        explicit MPSCQueue(std::size_t capacity)
+            : _capacity{ std::bit_ceil(std::max<std::size_t>(capacity, 2)) }
+            , _mask{ _capacity - 1 }
+            , _slots{ std::make_unique<Slot[]>(_capacity) }
+        {
+            for (std::size_t i{}; i < _capacity; ++i)
+                _slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        MPSCQueue(const MPSCQueue&) = delete;
+        MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+        std::size_t getCapacity() const { return _capacity; }
+
+        // Can be called from any thread. Returns false if the queue is full, value is left untouched in that case
+        bool tryPush(T&& value)
+        {
+            Slot* slot{};
+            std::size_t pos{ _enqueuePos.load(std::memory_order_relaxed) };
+            while (true)
+            {
+                slot = &_slots[pos & _mask];
+                const std::size_t sequence{ slot->sequence.load(std::memory_order_acquire) };
+                const std::ptrdiff_t diff{ static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos) };
+                if (diff == 0)
+                {
+                    if (_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        break;
+                }
+                else if (diff < 0)
+                    return false;
+                else
+                    pos = _enqueuePos.load(std::memory_order_relaxed);
+            }
+
+            slot->value = std::move(value);
+            slot->sequence.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer thread only. Returns false if the queue is empty
+        bool tryPop(T& value)
+        {
+            Slot& slot{ _slots[_dequeuePos & _mask] };
+            if (slot.sequence.load(std::memory_order_acquire) != _dequeuePos + 1)
+                return false;
+
+            value = std::move(slot.value);
+            slot.value = T{};
+            slot.sequence.store(_dequeuePos + _capacity, std::memory_order_release);
+            ++_dequeuePos;
+            return true;
+        }
+
+        // Consumer thread only. Appends at most maxCount values, returns the number of popped values
+        std::size_t tryPopBatch(std::vector<T>& values, std::size_t maxCount)
+        {
+            std::size_t count{};
+            T value;
+            while (count < maxCount && tryPop(value))
+            {
+                values.push_back(std::move(value));
+                ++count;
+            }
+
+            return count;
+        }
+
+    private:
+        static constexpr std::size_t cacheLineSize{ 64 };
+
+        struct Slot
+        {
+            std::atomic<std::size_t> sequence;
+            T value{};
+        };
+
+        const std::size_t _capacity;
+        const std::size_t _mask;
+        std::unique_ptr<Slot[]> _slots;
+
+        alignas(cacheLineSize) std::atomic<std::size_t> _enqueuePos{};
+        alignas(cacheLineSize) std::size_t _dequeuePos{}; // only accessed by the consumer
+    };
+} // namespace Utils
@@ -30,6 +30,17 @@ namespace PathUtils
 {
     std::uint32_t computeCrc32(const std::filesystem::path& p);
 
+    // Cheap content fingerprint: file size and crc32 of the first and last blocks
+    // Used to recognize moved files, must not be used to detect content changes
+    struct FileFingerprint
+    {
+        std::uintmax_t  fileSize{};
+        std::uint32_t   crc32{};
+
+        bool operator==(const FileFingerprint& other) const = default;
+    };
+    FileFingerprint computeFileFingerprint(const std::filesystem::path& p, std::size_t blockSize = 64 * 1024);
+
     // Make sure the given path is a directory
     // Create it if needed
     bool ensureDirectory(const std::filesystem::path& dir);
@@ -40,6 +51,11 @@ namespace PathUtils
     // returns false if aborted by user
     bool exploreFilesRecursive(const std::filesystem::path& directory, std::function<bool(std::error_code, const std::filesystem::path&)> cb, const std::filesystem::path* excludeDirFileName = {});
 
+    // Same as exploreFilesRecursive, but sub directories are listed using threadCount threads
+    // cb is never called concurrently, but files are not reported in any particular order
+    // returns false if aborted by user
+    bool exploreFilesRecursiveParallel(const std::filesystem::path& directory, std::function<bool(std::error_code, const std::filesystem::path&)> cb, const std::filesystem::path* excludeDirFileName, std::size_t threadCount);
+
     // Check if file's extension is one of provided extensions
     bool hasFileAnyExtension(const std::filesystem::path& file, const std::vector<std::filesystem::path>& extensions);
 
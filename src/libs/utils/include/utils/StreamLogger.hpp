@@ -30,7 +30,7 @@ public:
 
     StreamLogger(std::ostream& oss, EnumSet<Severity> severities = defaultSeverities);
 
-    bool isSeverityActive(Severity severity) const override { return _severities.contains(severity); }
+    bool isSeverityActive(Module, Severity severity) const override { return _severities.contains(severity); }
     void processLog(const Log& log) override;
 
 private:
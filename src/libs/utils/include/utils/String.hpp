@@ -56,6 +56,12 @@ namespace StringUtils
     void stringToLower(std::string& str);
     [[nodiscard]] std::string stringToUpper(const std::string& str);
 
+    // Collation-ready key: case folded, diacritics removed (Latin, Greek and Cyrillic scripts),
+    // so that plain binary comparisons of keys give a natural alphabetical order
+    [[nodiscard]] std::string computeSortKey(std::string_view str);
+    // Uppercase first letter of a sort key, "?" if it does not start with a letter
+    [[nodiscard]] std::string getSortKeyIndexLetter(std::string_view sortKey);
+
     [[nodiscard]] std::string bufferToString(std::span<const unsigned char> data);
 
     [[nodiscard]] bool stringCaseInsensitiveEqual(std::string_view strA, std::string_view strB);
@@ -90,6 +96,8 @@ namespace StringUtils
     [[nodiscard]] std::string jsonEscape(std::string_view str);
     void writeJSEscapedString(std::ostream& os, std::string_view str);
     void writeJsonEscapedString(std::ostream& os, std::string_view str);
+    [[nodiscard]] std::string xmlEscape(std::string_view str); // for both text and attribute values
+    void writeXmlEscapedString(std::ostream& os, std::string_view str);
 
     [[nodiscard]] std::string escapeString(std::string_view str, std::string_view charsToEscape, char escapeChar);
     [[nodiscard]] std::string unescapeString(std::string_view str, char escapeChar);
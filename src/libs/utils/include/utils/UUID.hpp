@@ -19,25 +19,34 @@
 
 #pragma once
 
+#include <array>
+#include <cstdint>
 #include <optional>
+#include <span>
 #include <string>
 #include <string_view>
 
 #include "utils/String.hpp"
 
+// 128-bit value, represented as "123e4567-e89b-12d3-a456-426614174000" when converted to string
 class UUID
 {
 public:
-    static std::optional<UUID> fromString(std::string_view str);
+    static constexpr std::size_t byteCount{ 16 };
+    using Bytes = std::array<unsigned char, byteCount>;
+
+    static std::optional<UUID> fromString(std::string_view str); // case insensitive
+    static std::optional<UUID> fromBytes(std::span<const unsigned char> bytes);
     static UUID generate();
 
-    std::string_view getAsString() const { return _value; }
+    std::string getAsString() const; // lower case
+    const Bytes& getAsBytes() const { return _value; }
 
-    bool operator<=>(const UUID&) const = default;
+    auto operator<=>(const UUID&) const = default;
 
 private:
-    UUID(std::string_view value);
-    std::string _value;
+    UUID(const Bytes& value);
+    Bytes _value;
 };
 
 namespace StringUtils
@@ -20,18 +20,23 @@
 #pragma once
 
 #include <string>
+#include <thread>
 
 #include "utils/ILogger.hpp"
 
+class LogFilter;
+
 class WtLogger final : public ILogger
 {
 public:
-    WtLogger(Severity minSeverity);
+    WtLogger(const LogFilter& filter); // filter must outlive the logger
 
     static std::string computeLogConfig(Severity minSeverity);
+    // Also used to write the logs processed by other threads, see AsyncLogger
+    static void write(Severity severity, Module module, std::thread::id threadId, const std::string& message);
 
 private:
-    bool isSeverityActive(Severity severity) const override;
+    bool isSeverityActive(Module module, Severity severity) const override;
     void processLog(const Log& log) override;
-    const Severity _minSeverity;
+    const LogFilter& _filter;
 };
\ No newline at end of file
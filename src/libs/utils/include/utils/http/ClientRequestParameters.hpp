@@ -19,6 +19,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <functional>
 #include <string_view>
 #include <vector>
@@ -38,6 +39,7 @@ namespace Http
 
 		Priority	priority {Priority::Normal};
 		std::string relativeUrl; // relative to baseUrl used by the client
+		std::size_t maxResponseBodySize {64 * 1024}; // bigger responses are reported as failures
 
 		using OnSuccessFunc = std::function<void(std::string_view msgBody)>;
 		OnSuccessFunc onSuccessFunc;
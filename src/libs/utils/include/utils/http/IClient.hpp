@@ -19,6 +19,8 @@
 
 #pragma once
 
+#include <cstddef>
+#include <memory>
 #include <string_view>
 #include <boost/asio/io_context.hpp>
 
@@ -35,6 +37,13 @@ namespace Http
 			virtual void sendPOSTRequest(ClientPOSTRequestParameters&& request) = 0;
 	};
 
-	std::unique_ptr<IClient> createClient(boost::asio::io_context& ioContext, std::string_view baseUrl);
+	struct ClientParameters
+	{
+		// requests sent in parallel, each one on its own connection (requests may complete out of order if greater than 1)
+		std::size_t maxConcurrentRequestCount {1};
+	};
+
+	// Rate limits reported by the server are shared by all the clients of the same host
+	std::unique_ptr<IClient> createClient(boost::asio::io_context& ioContext, std::string_view baseUrl, const ClientParameters& parameters = {});
 } // namespace Http
 
@@ -0,0 +1,174 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "utils/IAsyncFileReader.hpp"
+
+namespace
+{
+    class TemporaryFile
+    {
+    public:
+        TemporaryFile(std::size_t size)
+            : _path{ std::filesystem::temp_directory_path() / "lms-test-async-file-reader" }
+        {
+            std::ofstream ofs{ _path, std::ios::binary | std::ios::trunc };
+            for (std::size_t i{}; i < size; ++i)
+                ofs.put(static_cast<char>(i % 251));
+            ofs.close();
+
+            _fd = ::open(_path.c_str(), O_RDONLY | O_CLOEXEC);
+        }
+        ~TemporaryFile()
+        {
+            ::close(_fd);
+            std::filesystem::remove(_path);
+        }
+
+        int getFd() const { return _fd; }
+
+    private:
+        const std::filesystem::path _path;
+        int _fd{ -1 };
+    };
+
+    struct ReadResult
+    {
+        std::error_code ec;
+        std::size_t readSize{};
+    };
+
+    ReadResult readAndWait(IAsyncFileReader& reader, int fd, std::uint64_t offset, std::span<std::byte> buffer)
+    {
+        std::promise<ReadResult> promise;
+        reader.asyncRead(fd, offset, buffer, [&](std::error_code ec, std::size_t readSize) { promise.set_value(ReadResult{ ec, readSize }); });
+        return promise.get_future().get();
+    }
+
+    bool checkContent(std::span<const std::byte> data, std::uint64_t offset)
+    {
+        for (std::size_t i{}; i < data.size(); ++i)
+        {
+            if (data[i] != static_cast<std::byte>((offset + i) % 251))
+                return false;
+        }
+        return true;
+    }
+
+    class AsyncFileReaderTest : public testing::TestWithParam<bool /* use io_uring */>
+    {
+    protected:
+        std::unique_ptr<IAsyncFileReader> createReader(std::size_t queueDepth = 8, std::size_t bufferCount = 2)
+        {
+            AsyncFileReaderParameters parameters;
+            parameters.useIoUring = GetParam();
+            parameters.queueDepth = queueDepth;
+            parameters.bufferCount = bufferCount;
+            parameters.bufferSize = 65536;
+            return createAsyncFileReader(parameters);
+        }
+    };
+}
+
+TEST_P(AsyncFileReaderTest, read)
+{
+    const TemporaryFile file{ 100'000 };
+    const auto reader{ createReader() };
+
+    // registered buffer
+    {
+        IAsyncFileReader::Buffer buffer{ reader->acquireBuffer() };
+        const std::span<std::byte> data{ buffer.get(), reader->getBufferSize() };
+
+        const ReadResult result{ readAndWait(*reader, file.getFd(), 1000, data) };
+        EXPECT_FALSE(result.ec);
+        ASSERT_EQ(result.readSize, data.size());
+        EXPECT_TRUE(checkContent(data, 1000));
+    }
+
+    // user buffer, end of file reached
+    {
+        std::vector<std::byte> data(65536);
+        const ReadResult result{ readAndWait(*reader, file.getFd(), 50'000, data) };
+        EXPECT_FALSE(result.ec);
+        ASSERT_EQ(result.readSize, 50'000);
+        EXPECT_TRUE(checkContent(std::span{ data }.first(result.readSize), 50'000));
+    }
+
+    // beyond end of file
+    {
+        std::vector<std::byte> data(16);
+        const ReadResult result{ readAndWait(*reader, file.getFd(), 200'000, data) };
+        EXPECT_FALSE(result.ec);
+        EXPECT_EQ(result.readSize, 0);
+    }
+}
+
+TEST_P(AsyncFileReaderTest, readError)
+{
+    const auto reader{ createReader() };
+
+    std::vector<std::byte> data(16);
+    const ReadResult result{ readAndWait(*reader, -1, 0, data) };
+    EXPECT_EQ(result.ec, std::errc::bad_file_descriptor);
+}
+
+TEST_P(AsyncFileReaderTest, concurrentReads)
+{
+    const TemporaryFile file{ 1'000'000 };
+    const auto reader{ createReader(4 /* queue depth */, 2 /* buffers */) };
+
+    constexpr std::size_t readCount{ 64 };
+    constexpr std::size_t readSize{ 10'000 };
+
+    // more buffers than in the pool
+    std::vector<IAsyncFileReader::Buffer> buffers;
+    for (std::size_t i{}; i < readCount; ++i)
+        buffers.push_back(reader->acquireBuffer());
+
+    std::atomic<std::size_t> successCount{};
+    std::atomic<std::size_t> completedCount{};
+    std::promise<void> allCompleted;
+    for (std::size_t i{}; i < readCount; ++i)
+    {
+        const std::uint64_t offset{ i * readSize };
+        reader->asyncRead(file.getFd(), offset, std::span{ buffers[i].get(), readSize }, [&, i, offset](std::error_code ec, std::size_t size)
+            {
+                if (!ec && size == readSize && checkContent(std::span{ buffers[i].get(), size }, offset))
+                    successCount++;
+                if (++completedCount == readCount)
+                    allCompleted.set_value();
+            });
+    }
+
+    allCompleted.get_future().wait();
+    EXPECT_EQ(successCount, readCount);
+}
+
+INSTANTIATE_TEST_SUITE_P(AsyncFileReader, AsyncFileReaderTest, testing::Values(false, true), [](const testing::TestParamInfo<bool>& info) { return info.param ? "IoUring" : "ThreadPool"; });
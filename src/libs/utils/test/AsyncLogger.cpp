@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "utils/AsyncLogger.hpp"
+#include "utils/LogFilter.hpp"
+
+TEST(AsyncLogger, ordering)
+{
+    const LogFilter filter{ Severity::DEBUG };
+    std::vector<std::string> messages;
+    {
+        AsyncLogger logger{ filter, 1024, [&](const AsyncLogger::Record& record) { messages.push_back(record.message); } };
+
+        for (int i{}; i < 100; ++i)
+            Log{ logger, Module::UTILS, Severity::INFO }.getOstream() << "msg " << i;
+    } // pending logs are written on destruction
+
+    ASSERT_EQ(messages.size(), 100);
+    for (int i{}; i < 100; ++i)
+        EXPECT_EQ(messages[i], "msg " + std::to_string(i));
+}
+
+TEST(AsyncLogger, drops)
+{
+    constexpr std::size_t logCount{ 1000 };
+
+    const LogFilter filter{ Severity::DEBUG };
+    std::atomic<bool> writerBlocked{ true };
+    std::size_t writtenCount{};
+    std::uint64_t droppedCount{};
+    {
+        AsyncLogger logger{ filter, 16, [&](const AsyncLogger::Record& record) {
+                               writerBlocked.wait(true);
+                               if (record.message.starts_with("msg"))
+                                   writtenCount++;
+                           } };
+
+        for (std::size_t i{}; i < logCount; ++i)
+            Log{ logger, Module::UTILS, Severity::INFO }.getOstream() << "msg " << i;
+
+        writerBlocked.store(false);
+        writerBlocked.notify_one();
+
+        droppedCount = logger.getDroppedCount();
+    }
+
+    EXPECT_GT(droppedCount, 0);
+    EXPECT_EQ(writtenCount + droppedCount, logCount);
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <array>
+#include <string>
+
+#include <boost/asio/io_context.hpp>
+#include <gtest/gtest.h>
+
+#include "utils/IChildProcessManager.hpp"
+
+TEST(ChildProcess, readOutput)
+{
+    boost::asio::io_context ioContext;
+    auto childProcessManager{ createChildProcessManager(ioContext) };
+
+    auto childProcess{ childProcessManager->spawnChildProcess("/bin/sh", { "/bin/sh", "-c", "printf hello" }) };
+
+    std::array<std::byte, 64> buffer;
+    IChildProcess::ReadResult readResult{ IChildProcess::ReadResult::Error };
+    std::size_t readSize{};
+    childProcess->asyncRead(buffer.data(), buffer.size(), [&](IChildProcess::ReadResult result, std::size_t size)
+        {
+            readResult = result;
+            readSize = size;
+        });
+    ioContext.run();
+
+    EXPECT_EQ(readResult, IChildProcess::ReadResult::EndOfFile);
+    ASSERT_EQ(readSize, 5);
+    EXPECT_EQ(std::string(reinterpret_cast<const char*>(buffer.data()), readSize), "hello");
+    EXPECT_TRUE(childProcess->finished());
+}
+
+TEST(ChildProcess, killOnDestruction)
+{
+    boost::asio::io_context ioContext;
+    auto childProcessManager{ createChildProcessManager(ioContext) };
+
+    auto childProcess{ childProcessManager->spawnChildProcess("/bin/sh", { "/bin/sh", "-c", "sleep 60" }) };
+    EXPECT_FALSE(childProcess->finished());
+    childProcess.reset(); // must not wait for the process to exit by itself
+}
+
+TEST(ChildProcess, badExecutable)
+{
+    boost::asio::io_context ioContext;
+    auto childProcessManager{ createChildProcessManager(ioContext) };
+
+    EXPECT_THROW(childProcessManager->spawnChildProcess("/nonexistent/lms-test", { "/nonexistent/lms-test" }), ChildProcessException);
+}
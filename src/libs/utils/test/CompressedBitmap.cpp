@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <iterator>
+#include <random>
+#include <set>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "utils/CompressedBitmap.hpp"
+
+namespace
+{
+    std::vector<std::uint32_t> intersect(const std::set<std::uint32_t>& lhs, const std::set<std::uint32_t>& rhs)
+    {
+        std::vector<std::uint32_t> res;
+        std::set_intersection(std::cbegin(lhs), std::cend(lhs), std::cbegin(rhs), std::cend(rhs), std::back_inserter(res));
+        return res;
+    }
+}
+
+TEST(CompressedBitmap, empty)
+{
+    const Utils::CompressedBitmap bitmap;
+
+    EXPECT_TRUE(bitmap.isEmpty());
+    EXPECT_EQ(bitmap.getCount(), 0);
+    EXPECT_FALSE(bitmap.contains(0));
+    EXPECT_TRUE(bitmap.toVector().empty());
+}
+
+TEST(CompressedBitmap, add)
+{
+    Utils::CompressedBitmap bitmap;
+    bitmap.add(70000);
+    bitmap.add(3);
+    bitmap.add(1);
+    bitmap.add(3);
+    bitmap.add(0xFFFFFFFF);
+
+    EXPECT_EQ(bitmap.getCount(), 4);
+    EXPECT_TRUE(bitmap.contains(1));
+    EXPECT_FALSE(bitmap.contains(2));
+    EXPECT_TRUE(bitmap.contains(70000));
+    EXPECT_TRUE(bitmap.contains(0xFFFFFFFF));
+    EXPECT_EQ(bitmap.toVector(), (std::vector<std::uint32_t>{ 1, 3, 70000, 0xFFFFFFFF }));
+}
+
+TEST(CompressedBitmap, denseAndSparse)
+{
+    std::mt19937 randGenerator{ 42 };
+
+    // first container is dense, second one is sparse, third one is made dense using unordered insertions
+    std::set<std::uint32_t> values;
+    for (std::uint32_t value{}; value < 65536; value += 3)
+        values.insert(value);
+    for (std::uint32_t value{ 65536 }; value < 2 * 65536; value += 100)
+        values.insert(value);
+    for (std::size_t i{}; i < 10000; ++i)
+        values.insert(2 * 65536 + randGenerator() % 65536);
+
+    Utils::CompressedBitmap bitmap;
+    for (const std::uint32_t value : values)
+        bitmap.add(value);
+    std::vector<std::uint32_t> shuffledValues(std::cbegin(values), std::cend(values));
+    std::shuffle(std::begin(shuffledValues), std::end(shuffledValues), randGenerator);
+    for (const std::uint32_t value : shuffledValues)
+        bitmap.add(value); // no effect
+
+    EXPECT_EQ(bitmap.getCount(), values.size());
+    EXPECT_EQ(bitmap.toVector(), std::vector<std::uint32_t>(std::cbegin(values), std::cend(values)));
+    EXPECT_LT(bitmap.getMemoryUsage(), values.size() * sizeof(std::uint32_t));
+}
+
+TEST(CompressedBitmap, intersect)
+{
+    std::mt19937 randGenerator{ 1 };
+
+    // all combinations of dense and sparse containers
+    for (const std::uint32_t lhsModulo : { 2, 50 })
+    {
+        for (const std::uint32_t rhsModulo : { 3, 70 })
+        {
+            std::set<std::uint32_t> lhsValues;
+            std::set<std::uint32_t> rhsValues;
+            Utils::CompressedBitmap lhs;
+            Utils::CompressedBitmap rhs;
+
+            for (std::uint32_t value{}; value < 4 * 65536; ++value)
+            {
+                if (randGenerator() % lhsModulo == 0)
+                {
+                    lhsValues.insert(value);
+                    lhs.add(value);
+                }
+                if (randGenerator() % rhsModulo == 0)
+                {
+                    rhsValues.insert(value);
+                    rhs.add(value);
+                }
+            }
+
+            const Utils::CompressedBitmap res{ Utils::CompressedBitmap::intersect(lhs, rhs) };
+            const std::vector<std::uint32_t> expected{ intersect(lhsValues, rhsValues) };
+            EXPECT_EQ(res.getCount(), expected.size()) << "lhsModulo = " << lhsModulo << ", rhsModulo = " << rhsModulo;
+            EXPECT_EQ(res.toVector(), expected) << "lhsModulo = " << lhsModulo << ", rhsModulo = " << rhsModulo;
+            EXPECT_EQ(Utils::CompressedBitmap::intersect(rhs, lhs).toVector(), expected);
+        }
+    }
+}
+
+TEST(CompressedBitmap, intersect_disjoint)
+{
+    Utils::CompressedBitmap lhs;
+    Utils::CompressedBitmap rhs;
+    for (std::uint32_t value{}; value < 65536; value += 2)
+    {
+        lhs.add(value);
+        rhs.add(value + 1);
+    }
+    rhs.add(1'000'000);
+
+    EXPECT_TRUE(Utils::CompressedBitmap::intersect(lhs, rhs).isEmpty());
+    EXPECT_TRUE(Utils::CompressedBitmap::intersect(lhs, Utils::CompressedBitmap{}).isEmpty());
+}
@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+
+#include "utils/LogFilter.hpp"
+
+TEST(LogFilter, perModule)
+{
+    LogFilter filter{ Severity::INFO };
+    EXPECT_TRUE(filter.isSeverityActive(Module::METADATA, Severity::INFO));
+    EXPECT_FALSE(filter.isSeverityActive(Module::METADATA, Severity::DEBUG));
+    EXPECT_EQ(filter.getMaxMinSeverity(), Severity::INFO);
+
+    filter.setMinSeverity(Module::TRANSCODING, Severity::DEBUG);
+    filter.setMinSeverity(Module::METADATA, Severity::ERROR);
+    EXPECT_TRUE(filter.isSeverityActive(Module::TRANSCODING, Severity::DEBUG));
+    EXPECT_FALSE(filter.isSeverityActive(Module::METADATA, Severity::WARNING));
+    EXPECT_TRUE(filter.isSeverityActive(Module::METADATA, Severity::ERROR));
+    EXPECT_TRUE(filter.isSeverityActive(Module::UI, Severity::INFO));
+    EXPECT_EQ(filter.getMaxMinSeverity(), Severity::DEBUG);
+
+    const LogFilter::Severities severities{ filter.getMinSeverities() };
+    filter.setMinSeverity(Severity::FATAL);
+    EXPECT_FALSE(filter.isSeverityActive(Module::TRANSCODING, Severity::ERROR));
+    EXPECT_EQ(filter.getMaxMinSeverity(), Severity::FATAL);
+
+    filter.setMinSeverities(severities);
+    EXPECT_EQ(filter.getMinSeverity(Module::TRANSCODING), Severity::DEBUG);
+    EXPECT_EQ(filter.getMinSeverity(Module::METADATA), Severity::ERROR);
+}
+
+TEST(LogFilter, parseNames)
+{
+    EXPECT_EQ(parseModuleName("transcoding"), Module::TRANSCODING);
+    EXPECT_EQ(parseModuleName("DB UPDATER"), Module::DBUPDATER);
+    EXPECT_EQ(parseModuleName("foo"), std::nullopt);
+
+    EXPECT_EQ(parseSeverityName("Debug"), Severity::DEBUG);
+    EXPECT_EQ(parseSeverityName("warning"), Severity::WARNING);
+    EXPECT_EQ(parseSeverityName("verbose"), std::nullopt);
+}
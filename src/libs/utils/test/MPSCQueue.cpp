@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "utils/MPSCQueue.hpp"
+
+TEST(MPSCQueue, capacity)
+{
+    EXPECT_EQ(Utils::MPSCQueue<int>{ 1 }.getCapacity(), 2);
+    EXPECT_EQ(Utils::MPSCQueue<int>{ 4 }.getCapacity(), 4);
+    EXPECT_EQ(Utils::MPSCQueue<int>{ 5 }.getCapacity(), 8);
+}
+
+TEST(MPSCQueue, singleThreaded)
+{
+    Utils::MPSCQueue<std::unique_ptr<int>> queue{ 4 };
+
+    std::unique_ptr<int> value;
+    EXPECT_FALSE(queue.tryPop(value));
+
+    for (int i{}; i < 4; ++i)
+        EXPECT_TRUE(queue.tryPush(std::make_unique<int>(i)));
+
+    auto extraValue{ std::make_unique<int>(4) };
+    EXPECT_FALSE(queue.tryPush(std::move(extraValue)));
+    ASSERT_NE(extraValue, nullptr); // untouched
+
+    ASSERT_TRUE(queue.tryPop(value));
+    EXPECT_EQ(*value, 0);
+    EXPECT_TRUE(queue.tryPush(std::move(extraValue)));
+
+    std::vector<std::unique_ptr<int>> values;
+    EXPECT_EQ(queue.tryPopBatch(values, 2), 2);
+    EXPECT_EQ(queue.tryPopBatch(values, 10), 2);
+    EXPECT_EQ(queue.tryPopBatch(values, 10), 0);
+    ASSERT_EQ(values.size(), 4);
+    for (int i{}; i < 4; ++i)
+        EXPECT_EQ(*values[i], i + 1);
+}
+
+TEST(MPSCQueue, multiThreaded)
+{
+    constexpr std::size_t producerCount{ 8 };
+    constexpr std::size_t valueCountPerProducer{ 10'000 };
+
+    Utils::MPSCQueue<std::size_t> queue{ 64 };
+    std::vector<std::thread> producers;
+    for (std::size_t producer{}; producer < producerCount; ++producer)
+    {
+        producers.emplace_back([&, producer]
+            {
+                for (std::size_t i{}; i < valueCountPerProducer; ++i)
+                {
+                    while (!queue.tryPush(producer * valueCountPerProducer + i))
+                        std::this_thread::yield();
+                }
+            });
+    }
+
+    std::vector<std::size_t> lastValues(producerCount, 0);
+    std::vector<bool> hasValue(producerCount, false);
+    std::vector<std::size_t> values;
+    std::size_t popCount{};
+    while (popCount < producerCount * valueCountPerProducer)
+    {
+        values.clear();
+        if (queue.tryPopBatch(values, 16) == 0)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        // values of a given producer keep their order
+        for (std::size_t value : values)
+        {
+            const std::size_t producer{ value / valueCountPerProducer };
+            if (hasValue[producer])
+            {
+                EXPECT_GT(value, lastValues[producer]);
+            }
+            lastValues[producer] = value;
+            hasValue[producer] = true;
+        }
+        popCount += values.size();
+    }
+
+    for (std::thread& producer : producers)
+        producer.join();
+
+    std::size_t value;
+    EXPECT_FALSE(queue.tryPop(value));
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <array>
+#include <sstream>
+
+#include <gtest/gtest.h>
+
+#include "utils/Exception.hpp"
+#include "utils/IMetricsRegistry.hpp"
+
+namespace
+{
+    std::string write(const Metrics::IRegistry& registry)
+    {
+        std::ostringstream oss;
+        registry.write(oss);
+        return oss.str();
+    }
+}
+
+TEST(Metrics, counter)
+{
+    auto registry{ Metrics::createRegistry() };
+
+    Metrics::Counter& counter{ registry->getCounter("lms_test_total", "Test counter") };
+    counter.inc();
+    counter.inc(2);
+    EXPECT_EQ(counter.get(), 3);
+
+    // same instance on second call
+    EXPECT_EQ(&registry->getCounter("lms_test_total", "Test counter"), &counter);
+
+    EXPECT_EQ(write(*registry), "# HELP lms_test_total Test counter\n# TYPE lms_test_total counter\nlms_test_total 3\n");
+}
+
+TEST(Metrics, gaugeLabels)
+{
+    auto registry{ Metrics::createRegistry() };
+
+    Metrics::Gauge& gaugeA{ registry->getGauge("lms_test", "Test gauge", { { "kind", "a" } }) };
+    Metrics::Gauge& gaugeB{ registry->getGauge("lms_test", "Test gauge", { { "kind", "b\"\n" } }) };
+    EXPECT_NE(&gaugeA, &gaugeB);
+
+    gaugeA.inc(5);
+    gaugeA.dec();
+    gaugeB.set(-2);
+
+    EXPECT_EQ(write(*registry), "# HELP lms_test Test gauge\n# TYPE lms_test gauge\nlms_test{kind=\"a\"} 4\nlms_test{kind=\"b\\\"\\n\"} -2\n");
+}
+
+TEST(Metrics, histogram)
+{
+    auto registry{ Metrics::createRegistry() };
+
+    constexpr std::array<double, 2> upperBounds{ 0.5, 1 };
+    Metrics::Histogram& histogram{ registry->getHistogram("lms_test_seconds", "Test histogram", upperBounds, { { "kind", "a" } }) };
+    histogram.observe(0.25);
+    histogram.observe(0.5);
+    histogram.observe(std::chrono::milliseconds{ 750 });
+    histogram.observe(2);
+
+    const Metrics::Histogram::Snapshot snapshot{ histogram.getSnapshot() };
+    ASSERT_EQ(snapshot.cumulativeCounts.size(), 3);
+    EXPECT_EQ(snapshot.cumulativeCounts[0], 2);
+    EXPECT_EQ(snapshot.cumulativeCounts[1], 3);
+    EXPECT_EQ(snapshot.cumulativeCounts[2], 4);
+    EXPECT_EQ(snapshot.count, 4);
+    EXPECT_DOUBLE_EQ(snapshot.sum, 3.5);
+
+    EXPECT_EQ(write(*registry), "# HELP lms_test_seconds Test histogram\n"
+        "# TYPE lms_test_seconds histogram\n"
+        "lms_test_seconds_bucket{kind=\"a\",le=\"0.5\"} 2\n"
+        "lms_test_seconds_bucket{kind=\"a\",le=\"1\"} 3\n"
+        "lms_test_seconds_bucket{kind=\"a\",le=\"+Inf\"} 4\n"
+        "lms_test_seconds_sum{kind=\"a\"} 3.5\n"
+        "lms_test_seconds_count{kind=\"a\"} 4\n");
+}
+
+TEST(Metrics, invalidRegistrations)
+{
+    auto registry{ Metrics::createRegistry() };
+
+    registry->getCounter("lms_test", "Test");
+    EXPECT_THROW(registry->getGauge("lms_test", "Test"), LmsException);
+    EXPECT_THROW(registry->getCounter("0lms", "Test"), LmsException);
+    EXPECT_THROW(registry->getCounter("lms-test", "Test"), LmsException);
+    EXPECT_THROW(registry->getCounter("lms_test", "Test", { { "le", "1" } }), LmsException);
+
+    constexpr std::array<double, 2> unsortedUpperBounds{ 1, 0.5 };
+    EXPECT_THROW(registry->getHistogram("lms_test_seconds", "Test", unsortedUpperBounds), LmsException);
+}
@@ -17,8 +17,12 @@
  * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <fstream>
+#include <set>
+
 #include <gtest/gtest.h>
 
+#include "utils/Exception.hpp"
 #include "utils/Path.hpp"
 
 TEST(Path, getLongestCommonPath)
@@ -108,4 +112,86 @@ TEST(Path, isPathInRootPath)
     {
         EXPECT_EQ(PathUtils::isPathInRootPath(test.path, test.rootPath), test.expectedResult) << "Failed: path = " << test.path << ", rootPath = " << test.rootPath;
     }
-}
\ No newline at end of file
+}
+TEST(Path, exploreFilesRecursiveParallel)
+{
+    const std::filesystem::path rootPath{ std::filesystem::temp_directory_path() / "lms-test-explore" };
+    std::filesystem::remove_all(rootPath);
+
+    std::set<std::filesystem::path> expectedFiles;
+    for (std::size_t i{}; i < 10; ++i)
+    {
+        const std::filesystem::path directory{ rootPath / ("dir" + std::to_string(i)) / "subdir" };
+        std::filesystem::create_directories(directory);
+        for (std::size_t j{}; j < 3; ++j)
+        {
+            const std::filesystem::path file{ directory / ("file" + std::to_string(j) + ".txt") };
+            std::ofstream{ file };
+            expectedFiles.insert(file);
+        }
+    }
+
+    const std::filesystem::path excludeDirFileName{ ".lmsignore" };
+    std::filesystem::create_directories(rootPath / "excluded");
+    std::ofstream{ rootPath / "excluded" / excludeDirFileName };
+    std::ofstream{ rootPath / "excluded" / "file.txt" };
+
+    for (std::size_t threadCount : { 1, 2, 8 })
+    {
+        std::set<std::filesystem::path> files;
+        EXPECT_TRUE(PathUtils::exploreFilesRecursiveParallel(rootPath, [&](std::error_code ec, const std::filesystem::path& path)
+            {
+                EXPECT_FALSE(ec);
+                files.insert(path);
+                return true;
+            }, &excludeDirFileName, threadCount));
+
+        EXPECT_EQ(files, expectedFiles);
+    }
+
+    std::size_t fileCount{};
+    EXPECT_FALSE(PathUtils::exploreFilesRecursiveParallel(rootPath, [&](std::error_code, const std::filesystem::path&)
+        {
+            return ++fileCount < 5;
+        }, &excludeDirFileName, 4));
+    EXPECT_EQ(fileCount, 5);
+
+    std::filesystem::remove_all(rootPath);
+}
+
+TEST(Path, computeFileFingerprint)
+{
+    const std::filesystem::path rootPath{ std::filesystem::temp_directory_path() / "lms-test-fingerprint" };
+    std::filesystem::remove_all(rootPath);
+    std::filesystem::create_directories(rootPath);
+
+    auto writeFile{ [&](const std::filesystem::path& file, const std::string& content)
+        {
+            std::ofstream ofs{ rootPath / file, std::ios_base::binary };
+            ofs << content;
+        } };
+
+    const std::string content(1000, 'a');
+    writeFile("file1", content);
+    writeFile("file2", content);
+    std::string middleModifiedContent{ content };
+    middleModifiedContent[500] = 'b';
+    writeFile("file3", middleModifiedContent);
+    std::string tailModifiedContent{ content };
+    tailModifiedContent.back() = 'b';
+    writeFile("file4", tailModifiedContent);
+    writeFile("file5", content + "a");
+    writeFile("empty", "");
+
+    constexpr std::size_t blockSize{ 100 };
+    const PathUtils::FileFingerprint fingerprint{ PathUtils::computeFileFingerprint(rootPath / "file1", blockSize) };
+    EXPECT_EQ(fingerprint.fileSize, 1000);
+    EXPECT_EQ(PathUtils::computeFileFingerprint(rootPath / "file2", blockSize), fingerprint);
+    EXPECT_EQ(PathUtils::computeFileFingerprint(rootPath / "file3", blockSize), fingerprint); // only the first and last blocks are considered
+    EXPECT_NE(PathUtils::computeFileFingerprint(rootPath / "file4", blockSize), fingerprint);
+    EXPECT_NE(PathUtils::computeFileFingerprint(rootPath / "file5", blockSize), fingerprint);
+    EXPECT_EQ(PathUtils::computeFileFingerprint(rootPath / "empty", blockSize).fileSize, 0);
+    EXPECT_THROW(PathUtils::computeFileFingerprint(rootPath / "missing", blockSize), LmsException);
+
+    std::filesystem::remove_all(rootPath);
+}
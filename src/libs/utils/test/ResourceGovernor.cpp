@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "utils/IResourceGovernor.hpp"
+
+namespace
+{
+    ResourceGovernorParameters createTestParameters()
+    {
+        ResourceGovernorParameters parameters;
+        parameters.streamDelay = std::chrono::milliseconds{ 1 };
+        parameters.latencyThreshold = std::chrono::milliseconds{ 100 };
+        parameters.maxPause = std::chrono::milliseconds{ 200 };
+        parameters.latencyValidity = std::chrono::milliseconds{ 300 };
+        return parameters;
+    }
+}
+
+TEST(ResourceGovernor, idle)
+{
+    const auto governor{ createResourceGovernor(createTestParameters()) };
+    EXPECT_FALSE(governor->isBusy());
+
+    const auto start{ std::chrono::steady_clock::now() };
+    governor->throttle();
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds{ 50 });
+}
+
+TEST(ResourceGovernor, streams)
+{
+    const auto governor{ createResourceGovernor(createTestParameters()) };
+
+    governor->onStreamStarted();
+    governor->onStreamStarted();
+    EXPECT_TRUE(governor->isBusy());
+
+    governor->onStreamEnded();
+    EXPECT_TRUE(governor->isBusy());
+
+    governor->onStreamEnded();
+    EXPECT_FALSE(governor->isBusy());
+}
+
+TEST(ResourceGovernor, latency)
+{
+    const auto governor{ createResourceGovernor(createTestParameters()) };
+
+    governor->addRequestLatency(std::chrono::milliseconds{ 10 });
+    EXPECT_FALSE(governor->isBusy());
+
+    for (std::size_t i{}; i < 20; ++i)
+        governor->addRequestLatency(std::chrono::milliseconds{ 500 });
+    EXPECT_TRUE(governor->isBusy());
+
+    // pauses for a bounded duration
+    const auto start{ std::chrono::steady_clock::now() };
+    governor->throttle();
+    const auto duration{ std::chrono::steady_clock::now() - start };
+    EXPECT_GE(duration, std::chrono::milliseconds{ 200 });
+    EXPECT_LT(duration, std::chrono::milliseconds{ 1000 });
+
+    // old latencies are not considered anymore
+    std::this_thread::sleep_for(std::chrono::milliseconds{ 300 });
+    EXPECT_FALSE(governor->isBusy());
+}
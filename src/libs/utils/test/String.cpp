@@ -193,6 +193,14 @@ TEST(StringUtils, escapeJsonString)
     EXPECT_EQ(StringUtils::jsonEscape(R"(\Test\.mp3)"), R"(\\Test\\.mp3)");
 }
 
+TEST(StringUtils, escapeXmlString)
+{
+    EXPECT_EQ(StringUtils::xmlEscape(""), "");
+    EXPECT_EQ(StringUtils::xmlEscape("Test.mp3"), "Test.mp3");
+    EXPECT_EQ(StringUtils::xmlEscape(R"(Rock & Roll)"), R"(Rock &amp; Roll)");
+    EXPECT_EQ(StringUtils::xmlEscape(R"(<"Test'>)"), R"(&lt;&quot;Test&apos;&gt;)");
+}
+
 TEST(StringUtils, escapeString)
 {
     EXPECT_EQ(StringUtils::escapeString("", "*", ' '), "");
@@ -292,4 +300,64 @@ TEST(StringUtils, stringEndsWith)
     EXPECT_FALSE(StringUtils::stringEndsWith("FooBar", "1FooBar"));
     EXPECT_FALSE(StringUtils::stringEndsWith("FooBar", "1FooBar"));
     EXPECT_FALSE(StringUtils::stringEndsWith("FooBar", "R"));
-}
\ No newline at end of file
+}
+TEST(StringUtils, caseConversion_allBytes)
+{
+    std::string input;
+    for (int i{}; i < 2 * 256; ++i)
+        input.push_back(static_cast<char>(i % 256));
+
+    const std::string lower{ StringUtils::stringToLower(std::string_view{ input }) };
+    const std::string upper{ StringUtils::stringToUpper(input) };
+    ASSERT_EQ(lower.size(), input.size());
+    ASSERT_EQ(upper.size(), input.size());
+
+    for (std::size_t i{}; i < input.size(); ++i)
+    {
+        const char c{ input[i] };
+        EXPECT_EQ(lower[i], (c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : c) << "index = " << i;
+        EXPECT_EQ(upper[i], (c >= 'a' && c <= 'z') ? static_cast<char>(c - ('a' - 'A')) : c) << "index = " << i;
+    }
+
+    std::string inPlace{ input };
+    StringUtils::stringToLower(inPlace);
+    EXPECT_EQ(inPlace, lower);
+}
+
+TEST(StringUtils, computeSortKey)
+{
+    EXPECT_EQ(StringUtils::computeSortKey(""), "");
+    EXPECT_EQ(StringUtils::computeSortKey("The Beatles"), "the beatles");
+    EXPECT_EQ(StringUtils::computeSortKey("Émilie Simon"), "emilie simon");
+    EXPECT_EQ(StringUtils::computeSortKey("Sigur Rós"), "sigur ros");
+    EXPECT_EQ(StringUtils::computeSortKey("Motörhead"), "motorhead");
+    EXPECT_EQ(StringUtils::computeSortKey("Ærøskøbing"), "aeroskobing");
+    EXPECT_EQ(StringUtils::computeSortKey("Straße"), "strasse");
+    EXPECT_EQ(StringUtils::computeSortKey("Łódź"), "lodz");
+    EXPECT_EQ(StringUtils::computeSortKey("Ελληνικά"), "ελληνικα");
+    EXPECT_EQ(StringUtils::computeSortKey("ΣΟΦΊΑ"), "σοφια");
+    EXPECT_EQ(StringUtils::computeSortKey("Кино"), "кино");
+    EXPECT_EQ(StringUtils::computeSortKey("Ёлка"), "елка");
+    EXPECT_EQ(StringUtils::computeSortKey("坂本龍一"), "坂本龍一");
+
+    // decomposed form
+    EXPECT_EQ(StringUtils::computeSortKey("E\xCC\x81milie"), "emilie");
+
+    // invalid UTF-8 sequences are kept as is
+    EXPECT_EQ(StringUtils::computeSortKey("A\xC3"), "a\xC3");
+    EXPECT_EQ(StringUtils::computeSortKey("A\xFF" "B"), "a\xFF" "b");
+
+    // accents must not change the order
+    EXPECT_LT(StringUtils::computeSortKey("Éric"), StringUtils::computeSortKey("Fabrice"));
+    EXPECT_LT(StringUtils::computeSortKey("abba"), StringUtils::computeSortKey("ACDC"));
+}
+
+TEST(StringUtils, getSortKeyIndexLetter)
+{
+    EXPECT_EQ(StringUtils::getSortKeyIndexLetter(""), "?");
+    EXPECT_EQ(StringUtils::getSortKeyIndexLetter("1000 mods"), "?");
+    EXPECT_EQ(StringUtils::getSortKeyIndexLetter(StringUtils::computeSortKey("Émilie")), "E");
+    EXPECT_EQ(StringUtils::getSortKeyIndexLetter(StringUtils::computeSortKey("Кино")), "К");
+    EXPECT_EQ(StringUtils::getSortKeyIndexLetter(StringUtils::computeSortKey("Ελληνικά")), "Ε");
+    EXPECT_EQ(StringUtils::getSortKeyIndexLetter(StringUtils::computeSortKey("坂本龍一")), "?");
+}
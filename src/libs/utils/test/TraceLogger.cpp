@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <sstream>
+
+#include <gtest/gtest.h>
+
+#include "utils/ITraceLogger.hpp"
+#include "utils/Service.hpp"
+
+namespace
+{
+    std::size_t countEvents(const Tracing::ITraceLogger& traceLogger)
+    {
+        std::ostringstream oss;
+        traceLogger.dump(oss);
+
+        const std::string dump{ oss.str() };
+        std::size_t count{};
+        for (std::size_t pos{ dump.find("\"ph\":\"X\"") }; pos != std::string::npos; pos = dump.find("\"ph\":\"X\"", pos + 1))
+            ++count;
+
+        return count;
+    }
+}
+
+TEST(TraceLogger, nestedSpans)
+{
+    Service<Tracing::ITraceLogger> traceLogger{ Tracing::createTraceLogger(Tracing::TraceLoggerParameters{ Tracing::Level::Detailed, 1, 16 }) };
+
+    {
+        LMS_SCOPED_TRACE_OVERVIEW("Test", "Outer");
+        {
+            LMS_SCOPED_TRACE_DETAILED("Test", "Inner", "arg with \"quotes\"");
+        }
+    }
+
+    std::ostringstream oss;
+    traceLogger->dump(oss);
+    const std::string dump{ oss.str() };
+
+    // inner span is complete first
+    const std::size_t innerPos{ dump.find("\"name\":\"Inner\"") };
+    const std::size_t outerPos{ dump.find("\"name\":\"Outer\"") };
+    ASSERT_NE(innerPos, std::string::npos);
+    ASSERT_NE(outerPos, std::string::npos);
+    EXPECT_LT(innerPos, outerPos);
+    EXPECT_NE(dump.find("\"args\":{\"arg\":\"arg with \\\"quotes\\\"\"}"), std::string::npos);
+    EXPECT_EQ(dump.front(), '{');
+    EXPECT_EQ(dump.back(), '}');
+}
+
+TEST(TraceLogger, levels)
+{
+    Service<Tracing::ITraceLogger> traceLogger{ Tracing::createTraceLogger(Tracing::TraceLoggerParameters{ Tracing::Level::Overview, 1, 16 }) };
+
+    {
+        LMS_SCOPED_TRACE_OVERVIEW("Test", "Outer");
+        LMS_SCOPED_TRACE_DETAILED("Test", "Inner");
+    }
+
+    EXPECT_EQ(countEvents(*traceLogger), 1);
+}
+
+TEST(TraceLogger, sampling)
+{
+    Service<Tracing::ITraceLogger> traceLogger{ Tracing::createTraceLogger(Tracing::TraceLoggerParameters{ Tracing::Level::Overview, 4, 64 }) };
+
+    for (std::size_t i{}; i < 8; ++i)
+    {
+        LMS_SCOPED_TRACE_OVERVIEW("Test", "Outer");
+        // nested spans follow the decision made for the outermost one
+        LMS_SCOPED_TRACE_OVERVIEW("Test", "Inner");
+    }
+
+    EXPECT_EQ(countEvents(*traceLogger), 2 * 2);
+}
+
+TEST(TraceLogger, ringBuffer)
+{
+    Service<Tracing::ITraceLogger> traceLogger{ Tracing::createTraceLogger(Tracing::TraceLoggerParameters{ Tracing::Level::Overview, 1, 4 }) };
+
+    for (std::size_t i{}; i < 10; ++i)
+    {
+        LMS_SCOPED_TRACE_OVERVIEW("Test", "Span");
+    }
+
+    EXPECT_EQ(countEvents(*traceLogger), 4);
+}
+
+TEST(TraceLogger, noTraceLogger)
+{
+    // must not crash nor record anything
+    LMS_SCOPED_TRACE_OVERVIEW("Test", "Span");
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+
+#include "utils/UUID.hpp"
+
+TEST(UUID, fromString)
+{
+    struct TestCase
+    {
+        std::string_view input;
+        std::optional<std::string_view> expectedOutput;
+    };
+
+    TestCase tests[]
+    {
+        {"46ae879f-2dbe-46d3-99ad-05c116f97a30", "46ae879f-2dbe-46d3-99ad-05c116f97a30"},
+        {"46AE879F-2DBE-46D3-99AD-05C116F97A30", "46ae879f-2dbe-46d3-99ad-05c116f97a30"},
+        {"00000000-0000-0000-0000-000000000000", "00000000-0000-0000-0000-000000000000"},
+        {"ffffffff-ffff-ffff-ffff-ffffffffffff", "ffffffff-ffff-ffff-ffff-ffffffffffff"},
+        {"", std::nullopt},
+        {"46ae879f", std::nullopt},
+        {"46ae879f-2dbe-46d3-99ad-05c116f97a3", std::nullopt},
+        {"46ae879f-2dbe-46d3-99ad-05c116f97a300", std::nullopt},
+        {"46ae879f-2dbe-46d3-99ad05c116f97a30-", std::nullopt},
+        {"46ae879f02dbe-46d3-99ad-05c116f97a30", std::nullopt},
+        {"46ae879g-2dbe-46d3-99ad-05c116f97a30", std::nullopt},
+        {" 46ae879f-2dbe-46d3-99ad-05c116f97a3", std::nullopt},
+    };
+
+    for (const TestCase& test : tests)
+    {
+        const std::optional<UUID> uuid{ UUID::fromString(test.input) };
+        ASSERT_EQ(uuid.has_value(), test.expectedOutput.has_value()) << "Input = '" << test.input << "'";
+        if (uuid)
+            EXPECT_EQ(uuid->getAsString(), *test.expectedOutput);
+    }
+}
+
+TEST(UUID, bytes)
+{
+    const std::optional<UUID> uuid{ UUID::fromString("46ae879f-2dbe-46d3-99ad-05c116f97a30") };
+    ASSERT_TRUE(uuid);
+
+    const UUID::Bytes expectedBytes{ 0x46, 0xae, 0x87, 0x9f, 0x2d, 0xbe, 0x46, 0xd3, 0x99, 0xad, 0x05, 0xc1, 0x16, 0xf9, 0x7a, 0x30 };
+    EXPECT_EQ(uuid->getAsBytes(), expectedBytes);
+
+    const std::optional<UUID> uuidFromBytes{ UUID::fromBytes(expectedBytes) };
+    ASSERT_TRUE(uuidFromBytes);
+    EXPECT_EQ(*uuidFromBytes, *uuid);
+
+    EXPECT_FALSE(UUID::fromBytes({}));
+    EXPECT_FALSE(UUID::fromBytes(std::span{ expectedBytes }.first(15)));
+}
+
+TEST(UUID, generate)
+{
+    const UUID uuid1{ UUID::generate() };
+    const UUID uuid2{ UUID::generate() };
+    EXPECT_NE(uuid1, uuid2);
+
+    const std::optional<UUID> parsedUUID{ UUID::fromString(uuid1.getAsString()) };
+    ASSERT_TRUE(parsedUUID);
+    EXPECT_EQ(*parsedUUID, uuid1);
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "utils/IZipper.hpp"
+
+namespace
+{
+    class TemporaryFile
+    {
+    public:
+        TemporaryFile(std::string_view name, std::size_t size)
+            : _path{ std::filesystem::temp_directory_path() / name }
+        {
+            std::ofstream ofs{ _path, std::ios::binary | std::ios::trunc };
+            for (std::size_t i{}; i < size; ++i)
+                ofs.put(static_cast<char>(i % 251));
+        }
+        ~TemporaryFile()
+        {
+            std::filesystem::remove(_path);
+        }
+
+        const std::filesystem::path& getPath() const { return _path; }
+
+    private:
+        const std::filesystem::path _path;
+    };
+
+    std::string writeAll(Zip::IZipper& zipper)
+    {
+        std::ostringstream oss;
+        while (!zipper.isComplete())
+            zipper.writeSome(oss);
+
+        return std::move(oss).str();
+    }
+
+    std::uint32_t readUInt32(std::string_view data, std::size_t offset)
+    {
+        std::uint32_t value{};
+        for (std::size_t i{}; i < 4; ++i)
+            value |= static_cast<std::uint32_t>(static_cast<unsigned char>(data[offset + i])) << (8 * i);
+        return value;
+    }
+}
+
+TEST(Zipper, empty)
+{
+    auto zipper{ Zip::createZipper({}) };
+    const std::string archive{ writeAll(*zipper) };
+
+    ASSERT_EQ(archive.size(), 22);
+    EXPECT_EQ(archive.size(), zipper->getTotalSize());
+    EXPECT_EQ(readUInt32(archive, 0), 0x06054b50);
+}
+
+TEST(Zipper, storedEntries)
+{
+    const TemporaryFile file1{ "lms-test-zipper-1", 300'000 };
+    const TemporaryFile file2{ "lms-test-zipper-2", 0 };
+    const TemporaryFile file3{ "lms-test-zipper-3", 70'001 };
+
+    const Zip::EntryContainer entries{ { "a/file1", file1.getPath() }, { "a/file2", file2.getPath() }, { "b/file3", file3.getPath() } };
+    auto zipper{ Zip::createZipper(entries) };
+    const std::string archive{ writeAll(*zipper) };
+
+    ASSERT_EQ(archive.size(), zipper->getTotalSize());
+    EXPECT_EQ(readUInt32(archive, 0), 0x04034b50); // local header
+    EXPECT_EQ(readUInt32(archive, 14), 0x3121f218); // crc32
+    EXPECT_EQ(readUInt32(archive, 18), 300'000); // compressed size
+    EXPECT_EQ(readUInt32(archive, 22), 300'000); // uncompressed size
+    EXPECT_EQ(archive.substr(30, 7), "a/file1");
+    EXPECT_EQ(static_cast<unsigned char>(archive[37 + 251]), 0); // raw data
+
+    // end of central directory
+    const std::size_t endOfCentralDirectoryOffset{ archive.size() - 22 };
+    EXPECT_EQ(readUInt32(archive, endOfCentralDirectoryOffset), 0x06054b50);
+    EXPECT_EQ(readUInt32(archive, endOfCentralDirectoryOffset + 8), 0x00030003); // entry count
+    const std::uint32_t centralDirectoryOffset{ readUInt32(archive, endOfCentralDirectoryOffset + 16) };
+    EXPECT_EQ(readUInt32(archive, centralDirectoryOffset), 0x02014b50);
+    EXPECT_EQ(centralDirectoryOffset + readUInt32(archive, endOfCentralDirectoryOffset + 12), endOfCentralDirectoryOffset);
+}
+
+TEST(Zipper, byteRanges)
+{
+    const TemporaryFile file1{ "lms-test-zipper-1", 300'000 };
+    const TemporaryFile file2{ "lms-test-zipper-2", 1'000 };
+
+    const Zip::EntryContainer entries{ { "file1", file1.getPath() }, { "file2", file2.getPath() } };
+    const std::string archive{ writeAll(*Zip::createZipper(entries)) };
+
+    for (const std::size_t firstByte : { 0, 1, 35, 299'000, 300'040, 301'100 })
+    {
+        for (const std::size_t size : { 1, 50, 2'000, 1'000'000 })
+        {
+            auto zipper{ Zip::createZipper(entries) };
+            zipper->setByteRange(firstByte, firstByte + size);
+
+            EXPECT_EQ(writeAll(*zipper), archive.substr(firstByte, size)) << "firstByte = " << firstByte << ", size = " << size;
+        }
+    }
+}
+
+TEST(Zipper, missingFile)
+{
+    const Zip::EntryContainer entries{ { "file", "/this/file/does/not/exist" } };
+    EXPECT_THROW(Zip::createZipper(entries), Zip::Exception);
+}
@@ -0,0 +1,318 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "WorkerSupervisor.hpp"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/prctl.h>
+#include <sys/signalfd.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "utils/Exception.hpp"
+
+namespace Worker
+{
+    namespace
+    {
+        // avoids restarting in a loop the workers that cannot start
+        constexpr std::chrono::seconds restartDelay{ 5 };
+
+        struct WorkerProcess
+        {
+            pid_t pid{ -1 };
+            std::optional<std::chrono::steady_clock::time_point> restartTime;
+        };
+
+        sigset_t getHandledSignals()
+        {
+            sigset_t signals;
+            sigemptyset(&signals);
+            for (int signal : { SIGINT, SIGTERM, SIGQUIT, SIGCHLD, SIGUSR1, SIGUSR2 })
+                sigaddset(&signals, signal);
+
+            return signals;
+        }
+
+        class Supervisor
+        {
+        public:
+            Supervisor(std::size_t workerCount)
+                : _workers(workerCount)
+            {
+                const sigset_t signals{ getHandledSignals() };
+                if (sigprocmask(SIG_BLOCK, &signals, &_previousSignalMask) != 0)
+                    throw LmsException{ "Cannot block the supervisor signals" };
+
+                _signalFd = signalfd(-1, &signals, SFD_CLOEXEC);
+                if (_signalFd < 0)
+                    throw LmsException{ "Cannot create signal fd: " + std::string{ std::strerror(errno) } };
+            }
+
+            ~Supervisor()
+            {
+                if (_signalFd >= 0)
+                    close(_signalFd);
+                if (_readyFd >= 0)
+                    close(_readyFd);
+                sigprocmask(SIG_SETMASK, &_previousSignalMask, nullptr);
+            }
+
+            Supervisor(const Supervisor&) = delete;
+            Supervisor& operator=(const Supervisor&) = delete;
+
+            std::optional<Context> run()
+            {
+                if (std::optional<Context> context{ startWorker(0) })
+                    return context;
+
+                while (!_stopping || hasRunningWorkers())
+                {
+                    std::array<pollfd, 2> fds{ pollfd{ _signalFd, POLLIN, 0 }, pollfd{ _readyFd, POLLIN, 0 } };
+                    if (poll(fds.data(), fds.size(), computePollTimeout()) < 0 && errno != EINTR)
+                        throw LmsException{ "Supervisor poll failed: " + std::string{ std::strerror(errno) } };
+
+                    if (fds[1].revents)
+                        onPrimaryReady();
+
+                    if (fds[0].revents & POLLIN)
+                        handleSignal();
+
+                    if (std::optional<Context> context{ restartWorkers() })
+                        return context;
+
+                    if (_primaryReady && !_secondariesStarted && !_stopping)
+                    {
+                        _secondariesStarted = true;
+                        for (std::size_t index{ 1 }; index < _workers.size(); ++index)
+                        {
+                            if (std::optional<Context> context{ startWorker(index) })
+                                return context;
+                        }
+                    }
+                }
+
+                std::cerr << "All the workers are stopped" << std::endl;
+                return std::nullopt;
+            }
+
+        private:
+            // returns the context in the child process
+            std::optional<Context> startWorker(std::size_t index)
+            {
+                int readyPipe[2]{ -1, -1 };
+                if (index == 0)
+                {
+                    if (_readyFd >= 0)
+                    {
+                        close(_readyFd);
+                        _readyFd = -1;
+                    }
+
+                    if (pipe2(readyPipe, O_CLOEXEC) != 0)
+                        throw LmsException{ "Cannot create worker pipe: " + std::string{ std::strerror(errno) } };
+                }
+
+                const pid_t pid{ fork() };
+                if (pid < 0)
+                    throw LmsException{ "Cannot fork worker: " + std::string{ std::strerror(errno) } };
+
+                if (pid == 0)
+                {
+                    // the workers must not outlive the supervisor
+                    prctl(PR_SET_PDEATHSIG, SIGTERM);
+
+                    close(_signalFd);
+                    _signalFd = -1;
+                    if (readyPipe[0] >= 0)
+                        close(readyPipe[0]);
+
+                    Context context;
+                    context.index = index;
+                    context.count = _workers.size();
+                    context.readyFd = readyPipe[1];
+
+                    return context;
+                }
+
+                if (readyPipe[1] >= 0)
+                {
+                    close(readyPipe[1]);
+                    _readyFd = readyPipe[0];
+                }
+
+                std::cerr << "Started worker " << index << ", pid = " << pid << std::endl;
+                _workers[index].pid = pid;
+                _workers[index].restartTime.reset();
+
+                return std::nullopt;
+            }
+
+            void onPrimaryReady()
+            {
+                // nothing to read if the primary worker exited before being ready
+                char ready{};
+                if (read(_readyFd, &ready, sizeof(ready)) == sizeof(ready))
+                    _primaryReady = true;
+
+                close(_readyFd);
+                _readyFd = -1;
+            }
+
+            void handleSignal()
+            {
+                signalfd_siginfo info;
+                if (read(_signalFd, &info, sizeof(info)) != sizeof(info))
+                    return;
+
+                switch (info.ssi_signo)
+                {
+                case SIGCHLD:
+                    reapWorkers();
+                    break;
+
+                case SIGUSR1:
+                case SIGUSR2:
+                    sendToWorkers(info.ssi_signo);
+                    break;
+
+                default:
+                    if (!_stopping)
+                    {
+                        std::cerr << "Stopping the workers..." << std::endl;
+                        _stopping = true;
+                    }
+                    sendToWorkers(SIGTERM);
+                    break;
+                }
+            }
+
+            void reapWorkers()
+            {
+                int status{};
+                pid_t pid;
+                while ((pid = waitpid(-1, &status, WNOHANG)) > 0)
+                {
+                    for (std::size_t index{}; index < _workers.size(); ++index)
+                    {
+                        WorkerProcess& worker{ _workers[index] };
+                        if (worker.pid != pid)
+                            continue;
+
+                        worker.pid = -1;
+                        if (_stopping)
+                            break;
+
+                        if (WIFSIGNALED(status))
+                            std::cerr << "Worker " << index << " killed by signal " << WTERMSIG(status) << ", restarting in " << restartDelay.count() << " seconds" << std::endl;
+                        else
+                            std::cerr << "Worker " << index << " exited with status " << WEXITSTATUS(status) << ", restarting in " << restartDelay.count() << " seconds" << std::endl;
+
+                        worker.restartTime = std::chrono::steady_clock::now() + restartDelay;
+                        break;
+                    }
+                }
+            }
+
+            std::optional<Context> restartWorkers()
+            {
+                if (_stopping)
+                    return std::nullopt;
+
+                const auto now{ std::chrono::steady_clock::now() };
+                for (std::size_t index{}; index < _workers.size(); ++index)
+                {
+                    WorkerProcess& worker{ _workers[index] };
+                    if (worker.restartTime && *worker.restartTime <= now)
+                    {
+                        if (std::optional<Context> context{ startWorker(index) })
+                            return context;
+                    }
+                }
+
+                return std::nullopt;
+            }
+
+            void sendToWorkers(int signal)
+            {
+                for (const WorkerProcess& worker : _workers)
+                {
+                    if (worker.pid >= 0)
+                        kill(worker.pid, signal);
+                }
+            }
+
+            bool hasRunningWorkers() const
+            {
+                return std::any_of(std::cbegin(_workers), std::cend(_workers), [](const WorkerProcess& worker) { return worker.pid >= 0; });
+            }
+
+            int computePollTimeout() const
+            {
+                std::optional<std::chrono::steady_clock::time_point> nextRestartTime;
+                for (const WorkerProcess& worker : _workers)
+                {
+                    if (worker.restartTime && (!nextRestartTime || *worker.restartTime < *nextRestartTime))
+                        nextRestartTime = worker.restartTime;
+                }
+
+                if (!nextRestartTime || _stopping)
+                    return -1;
+
+                const auto timeout{ std::chrono::ceil<std::chrono::milliseconds>(*nextRestartTime - std::chrono::steady_clock::now()) };
+                return std::max<int>(0, static_cast<int>(timeout.count()));
+            }
+
+            std::vector<WorkerProcess> _workers;
+            sigset_t _previousSignalMask{};
+            int _signalFd{ -1 };
+            int _readyFd{ -1 }; // read end of the primary worker pipe
+            bool _primaryReady{};
+            bool _secondariesStarted{};
+            bool _stopping{};
+        };
+    }
+
+    std::optional<Context> runSupervisor(std::size_t workerCount)
+    {
+        // must be called before any thread is created
+        return Supervisor{ workerCount }.run();
+    }
+
+    void notifyReady(Context& context)
+    {
+        if (context.readyFd >= 0)
+        {
+            const char ready{ 1 };
+            [[maybe_unused]] const ssize_t res{ write(context.readyFd, &ready, sizeof(ready)) };
+            close(context.readyFd);
+            context.readyFd = -1;
+        }
+    }
+}
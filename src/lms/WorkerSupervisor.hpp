@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <optional>
+
+// Prefork mode: a supervisor process starts the workers, each worker runs its own server
+// The primary worker prepares the database and runs the background jobs (scans, synchronizations, database maintenance)
+namespace Worker
+{
+    struct Context
+    {
+        std::size_t index{};
+        std::size_t count{ 1 };
+        int readyFd{ -1 }; // written to by the primary worker once ready, see notifyReady
+
+        bool isPrimary() const { return index == 0; }
+    };
+
+    // Starts the workers, restarts the ones that exit unexpectedly and forwards them the stop and log signals
+    // The secondary workers are only started once the primary worker is ready
+    // Returns the worker context in the worker processes, and std::nullopt in the supervisor once all the workers are stopped
+    std::optional<Context> runSupervisor(std::size_t workerCount);
+
+    // To be called by the workers once the database is prepared
+    void notifyReady(Context& context);
+}
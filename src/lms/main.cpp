@@ -17,13 +17,21 @@
  * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <chrono>
+#include <csignal>
+#include <future>
+#include <optional>
+#include <string>
 #include <thread>
+#include <vector>
 
 #include <boost/asio/io_context.hpp>
 #include <boost/property_tree/xml_parser.hpp>
 
 #include <Wt/WServer.h>
 #include <Wt/WApplication.h>
+#include <Wt/WResource.h>
+#include <Wt/Http/Response.h>
 
 #include "image/IRawImage.hpp"
 #include "services/auth/IAuthTokenService.hpp"
@@ -31,6 +39,7 @@
 #include "services/auth/IEnvService.hpp"
 #include "services/cover/ICoverService.hpp"
 #include "database/Db.hpp"
+#include "database/MaintenanceScheduler.hpp"
 #include "database/Session.hpp"
 #include "services/feedback/IFeedbackService.hpp"
 #include "services/recommendation/IPlaylistGeneratorService.hpp"
@@ -40,15 +49,55 @@
 #include "subsonic/SubsonicResource.hpp"
 #include "ui/LmsApplication.hpp"
 #include "ui/LmsApplicationManager.hpp"
+#include "utils/AsyncLogger.hpp"
+#include "utils/IAsyncFileReader.hpp"
 #include "utils/IChildProcessManager.hpp"
 #include "utils/IConfig.hpp"
+#include "utils/IMetricsRegistry.hpp"
 #include "utils/IOContextRunner.hpp"
+#include "utils/IResourceGovernor.hpp"
+#include "utils/ITraceLogger.hpp"
+#include "utils/LogFilter.hpp"
 #include "utils/Service.hpp"
 #include "utils/String.hpp"
 #include "utils/WtLogger.hpp"
 
+#include "WorkerSupervisor.hpp"
+
 namespace
 {
+    // Settings seen by the worker processes, see worker-count
+    class WorkerConfig final : public IConfig
+    {
+    public:
+        WorkerConfig(std::unique_ptr<IConfig> config, const Worker::Context& context)
+            : _config{ std::move(config) }
+            , _context{ context }
+        {}
+
+    private:
+        std::string_view getString(std::string_view setting, std::string_view def) override { return _config->getString(setting, def); }
+        void visitStrings(std::string_view setting, std::function<void(std::string_view)> func, std::initializer_list<std::string_view> def) override { _config->visitStrings(setting, std::move(func), def); }
+        std::filesystem::path getPath(std::string_view setting, const std::filesystem::path& def) override { return _config->getPath(setting, def); }
+        long getLong(std::string_view setting, long def) override { return _config->getLong(setting, def); }
+        bool getBool(std::string_view setting, bool def) override { return _config->getBool(setting, def); }
+
+        unsigned long getULong(std::string_view setting, unsigned long def) override
+        {
+            if (setting == "worker-index")
+                return _context.index;
+
+            // the periodic synchronizations are only run by the primary worker
+            if (!_context.isPrimary() && (setting == "listenbrainz-sync-listens-period-hours" || setting == "listenbrainz-sync-feedbacks-period-hours"))
+                return 0;
+
+            return _config->getULong(setting, def);
+        }
+
+        const std::unique_ptr<IConfig> _config;
+        const Worker::Context _context;
+    };
+
     std::size_t getThreadCount()
     {
         const unsigned long configHttpServerThreadCount{ Service<IConfig>::get()->getULong("http-server-thread-count", 0) };
@@ -57,29 +106,167 @@ namespace
         return configHttpServerThreadCount ? configHttpServerThreadCount : std::max<unsigned long>(2, std::thread::hardware_concurrency());
     }
 
+    AsyncFileReaderParameters getAsyncFileReaderParameters()
+    {
+        IConfig& config{ *Service<IConfig>::get() };
+
+        AsyncFileReaderParameters parameters;
+        parameters.useIoUring = config.getBool("file-reader-io-uring", true);
+        parameters.threadCount = config.getULong("file-reader-thread-count", 2);
+        parameters.queueDepth = config.getULong("file-reader-queue-depth", 64);
+        parameters.bufferCount = config.getULong("file-reader-registered-buffer-count", 16);
+
+        return parameters;
+    }
+
+    ResourceGovernorParameters getResourceGovernorParameters()
+    {
+        IConfig& config{ *Service<IConfig>::get() };
+
+        ResourceGovernorParameters parameters;
+        parameters.streamDelay = std::chrono::milliseconds{ config.getULong("background-throttle-stream-delay", 10) };
+        parameters.latencyThreshold = std::chrono::milliseconds{ config.getULong("background-throttle-latency-threshold", 250) };
+        parameters.maxPause = std::chrono::milliseconds{ config.getULong("background-throttle-max-pause", 2000) };
+
+        return parameters;
+    }
+
+    // Executors used by the services that are out of the Wt event loop
+    struct IOContextSettings
+    {
+        std::size_t threadCount{};
+        std::vector<unsigned> cpus; // empty means no affinity
+    };
+
+    IOContextSettings getIOContextSettings(std::string_view name, std::size_t defaultThreadCount)
+    {
+        IConfig& config{ *Service<IConfig>::get() };
+        const std::string prefix{ "io-" + std::string{ name } };
+
+        IOContextSettings settings;
+        settings.threadCount = config.getULong(prefix + "-thread-count", 0);
+        if (settings.threadCount == 0)
+            settings.threadCount = defaultThreadCount;
+
+        config.visitStrings(prefix + "-cpus", [&](std::string_view entry)
+            {
+                const std::optional<unsigned> cpu{ StringUtils::readAs<unsigned>(entry) };
+                if (!cpu)
+                    throw LmsException{ "Invalid config value for '" + prefix + "-cpus'" };
+
+                settings.cpus.push_back(*cpu);
+            });
+
+        return settings;
+    }
+
+    Severity getLogMinSeverity(std::string_view setting, std::string_view value)
+    {
+        if (const std::optional<Severity> severity{ parseSeverityName(value) })
+            return *severity;
+
+        throw LmsException{ "Invalid config value for '" + std::string{ setting } + "'" };
+    }
+
     Severity getLogMinSeverity()
     {
-        std::string_view minSeverity{ Service<IConfig>::get()->getString("log-min-severity", "info") };
-
-        if (minSeverity == "debug")
-            return Severity::DEBUG;
-        else if (minSeverity == "info")
-            return Severity::INFO;
-        else if (minSeverity == "warning")
-            return Severity::WARNING;
-        else if (minSeverity == "error")
-            return Severity::ERROR;
-        else if (minSeverity == "fatal")
-            return Severity::FATAL;
-
-        throw LmsException{ "Invalid config value for 'log-min-severity'" };
+        return getLogMinSeverity("log-min-severity", Service<IConfig>::get()->getString("log-min-severity", "info"));
+    }
+
+    // entries are "module:severity"
+    void applyLogModuleMinSeverities(LogFilter& filter)
+    {
+        Service<IConfig>::get()->visitStrings("log-module-min-severities", [&](std::string_view entry) {
+            const std::size_t separator{ entry.rfind(':') };
+            if (separator == std::string_view::npos)
+                throw LmsException{ "Invalid config value for 'log-module-min-severities'" };
+
+            const std::optional<Module> module{ parseModuleName(entry.substr(0, separator)) };
+            if (!module)
+                throw LmsException{ "Invalid config value for 'log-module-min-severities': unknown module '" + std::string{ entry.substr(0, separator) } + "'" };
+
+            filter.setMinSeverity(*module, getLogMinSeverity("log-module-min-severities", entry.substr(separator + 1)));
+        });
+    }
+
+    // SIGUSR1 sets all the modules to the signal severity, SIGUSR2 restores the configured severities
+    // Only relaxed atomic stores in the handler, which is async-signal-safe
+    struct LogSignalState
+    {
+        LogFilter* filter{};
+        LogFilter::Severities configuredSeverities{};
+        Severity signalSeverity{};
+    };
+    LogSignalState logSignalState;
+
+    void onLogSignal(int signal)
+    {
+        if (signal == SIGUSR1)
+            logSignalState.filter->setMinSeverity(logSignalState.signalSeverity);
+        else
+            logSignalState.filter->setMinSeverities(logSignalState.configuredSeverities);
+    }
+
+    class ScopedLogSignalHandlers
+    {
+    public:
+        ScopedLogSignalHandlers(LogFilter& filter, Severity signalSeverity)
+        {
+            logSignalState.filter = &filter;
+            logSignalState.configuredSeverities = filter.getMinSeverities();
+            logSignalState.signalSeverity = signalSeverity;
+
+            install(onLogSignal);
+        }
+
+        ~ScopedLogSignalHandlers()
+        {
+            // the filter is about to be destroyed
+            install(SIG_IGN);
+        }
+
+        ScopedLogSignalHandlers(const ScopedLogSignalHandlers&) = delete;
+        ScopedLogSignalHandlers& operator=(const ScopedLogSignalHandlers&) = delete;
+
+    private:
+        static void install(void (*handler)(int))
+        {
+            struct sigaction action {};
+            action.sa_handler = handler;
+            sigemptyset(&action.sa_mask);
+            action.sa_flags = SA_RESTART;
+            if (sigaction(SIGUSR1, &action, nullptr) != 0 || sigaction(SIGUSR2, &action, nullptr) != 0)
+                throw LmsException{ "Cannot install log signal handlers" };
+        }
+    };
+
+    std::optional<Tracing::TraceLoggerParameters> getTraceLoggerParameters()
+    {
+        IConfig& config{ *Service<IConfig>::get() };
+
+        Tracing::TraceLoggerParameters parameters;
+
+        const std::string_view level{ config.getString("tracing-level", "disabled") };
+        if (level == "disabled")
+            return std::nullopt;
+        if (level == "overview")
+            parameters.minLevel = Tracing::Level::Overview;
+        else if (level == "detailed")
+            parameters.minLevel = Tracing::Level::Detailed;
+        else
+            throw LmsException{ "Bad value '" + std::string{ level } + "' for 'tracing-level'" };
+
+        parameters.samplingPeriod = config.getULong("tracing-sampling-period", parameters.samplingPeriod);
+        parameters.bufferEventCount = config.getULong("tracing-buffer-event-count", parameters.bufferEventCount);
+
+        return parameters;
     }
 
-    std::vector<std::string> generateWtConfig(std::string execPath, Severity minSeverity)
+    std::vector<std::string> generateWtConfig(std::string execPath, Severity minSeverity, const Worker::Context& workerContext)
     {
         std::vector<std::string> args;
 
-        const std::filesystem::path wtConfigPath{ Service<IConfig>::get()->getPath("working-dir") / "wt_config.xml" };
+        const std::filesystem::path wtConfigPath{ Service<IConfig>::get()->getPath("working-dir") / (workerContext.isPrimary() ? std::string{ "wt_config.xml" } : "wt_config-" + std::to_string(workerContext.index) + ".xml") };
         const std::filesystem::path wtLogFilePath{ Service<IConfig>::get()->getPath("log-file", "/var/log/lms.log") };
         const std::filesystem::path wtAccessLogFilePath{ Service<IConfig>::get()->getPath("access-log-file", "/var/log/lms.access.log") };
         const std::filesystem::path wtResourcesPath{ Service<IConfig>::get()->getPath("wt-resources", "/usr/share/Wt/resources") };
@@ -92,9 +279,11 @@ namespace
         if (!wtResourcesPath.empty())
             args.push_back("--resources-dir=" + wtResourcesPath.string());
 
+        // The Wt server cannot share its listening socket with other processes: each worker listens on its own port
+        const unsigned long listenPort{ Service<IConfig>::get()->getULong("listen-port", 5082) + workerContext.index };
         if (Service<IConfig>::get()->getBool("tls-enable", false))
         {
-            args.push_back("--https-port=" + std::to_string(Service<IConfig>::get()->getULong("listen-port", 5082)));
+            args.push_back("--https-port=" + std::to_string(listenPort));
             args.push_back("--https-address=" + std::string{ Service<IConfig>::get()->getString("listen-addr", "0.0.0.0") });
             args.push_back("--ssl-certificate=" + std::string{ Service<IConfig>::get()->getString("tls-cert") });
             args.push_back("--ssl-private-key=" + std::string{ Service<IConfig>::get()->getString("tls-key") });
@@ -102,7 +291,7 @@ namespace
         }
         else
         {
-            args.push_back("--http-port=" + std::to_string(Service<IConfig>::get()->getULong("listen-port", 5082)));
+            args.push_back("--http-port=" + std::to_string(listenPort));
             args.push_back("--http-address=" + std::string{ Service<IConfig>::get()->getString("listen-addr", "0.0.0.0") });
         }
 
@@ -149,7 +338,30 @@ namespace
         return args;
     }
 
-    void proxyScannerEventsToApplication(Scanner::IScannerService& scanner, Wt::WServer& server)
+    // Scraped by Prometheus
+    class MetricsResource final : public Wt::WResource
+    {
+    public:
+        MetricsResource(const Metrics::IRegistry& registry)
+            : _registry{ registry }
+        {}
+
+        ~MetricsResource() override
+        {
+            beingDeleted();
+        }
+
+    private:
+        void handleRequest(const Wt::Http::Request&, Wt::Http::Response& response) override
+        {
+            response.setMimeType("text/plain; version=0.0.4; charset=utf-8");
+            _registry.write(response.out());
+        }
+
+        const Metrics::IRegistry& _registry;
+    };
+
+    void proxyScannerEventsToApplication(Scanner::IScannerService& scanner, Wt::WServer& server, UserInterface::LmsApplicationManager& appManager)
     {
         auto postAll{ [](Wt::WServer& server, std::function<void()> cb)
         {
@@ -179,22 +391,20 @@ namespace
                     });
             });
 
-        scanner.getEvents().scanComplete.connect([&](const Scanner::ScanStats& stats)
+        scanner.getEvents().scanComplete.connect([&](const Scanner::ScanSummary& stats)
             {
-                postAll(server, [=]
+                // shared by all the sessions
+                postAll(server, [stats = std::make_shared<const Scanner::ScanSummary>(stats)]
                     {
-                        LmsApp->getScannerEvents().scanComplete.emit(stats);
+                        LmsApp->getScannerEvents().scanComplete.emit(*stats);
                         LmsApp->triggerUpdate();
                     });
             });
 
+        // Very frequent: coalesced and only sent to the sessions that display it
         scanner.getEvents().scanInProgress.connect([&](const Scanner::ScanStepStats& stats)
             {
-                postAll(server, [=]
-                    {
-                        LmsApp->getScannerEvents().scanInProgress.emit(stats);
-                        LmsApp->triggerUpdate();
-                    });
+                appManager.getScanProgressBroadcaster().onScanInProgress(stats);
             });
 
         scanner.getEvents().scanScheduled.connect([&](const Wt::WDateTime dateTime)
@@ -206,6 +416,24 @@ namespace
                     });
             });
     }
+
+    // Logs how long a startup phase took, so that slow startups can be diagnosed
+    class ScopedStartupPhase
+    {
+    public:
+        ScopedStartupPhase(std::string_view name) : _name{ name } {}
+        ~ScopedStartupPhase()
+        {
+            LMS_LOG(MAIN, INFO, "Startup phase '" << _name << "' done in " << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - _start).count() << " ms");
+        }
+
+        ScopedStartupPhase(const ScopedStartupPhase&) = delete;
+        ScopedStartupPhase& operator=(const ScopedStartupPhase&) = delete;
+
+    private:
+        const std::string_view _name;
+        const std::chrono::steady_clock::time_point _start{ std::chrono::steady_clock::now() };
+    };
 }
 
 int main(int argc, char* argv[])
@@ -228,13 +456,54 @@ int main(int argc, char* argv[])
 
     try
     {
+        const auto startTime{ std::chrono::steady_clock::now() };
+
         close(STDIN_FILENO);
 
-        Service<IConfig> config{ createConfig(configFilePath) };
-        const Severity minLogSeverity{getLogMinSeverity()};
-        Service<ILogger> logger{ std::make_unique<WtLogger>(minLogSeverity) };
+        std::unique_ptr<IConfig> fileConfig{ createConfig(configFilePath) };
+
+        // Prefork mode: this process becomes the supervisor of the workers, before any thread is created
+        Worker::Context workerContext;
+        if (const std::size_t workerCount{ fileConfig->getULong("worker-count", 1) }; workerCount > 1)
+        {
+            const std::optional<Worker::Context> context{ Worker::runSupervisor(workerCount) };
+            if (!context)
+                return EXIT_SUCCESS;
+
+            workerContext = *context;
+        }
 
-        // use system locale. libarchive relies on this to write filenames
+        Service<IConfig> config{ std::make_unique<WorkerConfig>(std::move(fileConfig), workerContext) };
+        LogFilter logFilter{ getLogMinSeverity() };
+        applyLogModuleMinSeverities(logFilter);
+        // Wt filters the logs as well: let through the most verbose severity we may ask for
+        Severity minLogSeverity{ logFilter.getMaxMinSeverity() };
+        std::optional<ScopedLogSignalHandlers> logSignalHandlers;
+        if (const std::string_view signalSeverity{ config->getString("log-signal-min-severity") }; !signalSeverity.empty())
+        {
+            const Severity severity{ getLogMinSeverity("log-signal-min-severity", signalSeverity) };
+            logSignalHandlers.emplace(logFilter, severity);
+            if (static_cast<int>(severity) > static_cast<int>(minLogSeverity))
+                minLogSeverity = severity;
+        }
+        Service<ILogger> logger;
+        if (config->getBool("log-async", false))
+        {
+            logger.assign(std::make_unique<AsyncLogger>(logFilter, config->getULong("log-async-queue-size", 65536), [](const AsyncLogger::Record& record) {
+                WtLogger::write(record.severity, record.module, record.threadId, record.message);
+            }));
+        }
+        else
+            logger.assign(std::make_unique<WtLogger>(logFilter));
+        // Created before anything else: metrics are registered once on construction, and all the components may write traces
+        Service<Metrics::IRegistry> metricsRegistry;
+        if (config->getBool("metrics-enabled", false))
+            metricsRegistry.assign(Metrics::createRegistry());
+        Service<Tracing::ITraceLogger> traceLogger;
+        if (const auto traceLoggerParameters{ getTraceLoggerParameters() })
+            traceLogger.assign(Tracing::createTraceLogger(*traceLoggerParameters));
+
+        // use system locale
         if (char* locale{ ::setlocale(LC_ALL, "") })
             LMS_LOG(MAIN, INFO, "locale set to '" << locale << "'");
         else
@@ -245,7 +514,7 @@ int main(int argc, char* argv[])
         std::filesystem::create_directories(config->getPath("working-dir") / "cache");
 
         // Construct WT configuration and get the argc/argv back
-        const std::vector<std::string> wtServerArgs{ generateWtConfig(argv[0], minLogSeverity) };
+        const std::vector<std::string> wtServerArgs{ generateWtConfig(argv[0], minLogSeverity, workerContext) };
 
         std::vector<const char*> wtArgv(wtServerArgs.size());
         for (std::size_t i = 0; i < wtServerArgs.size(); ++i)
@@ -254,27 +523,52 @@ int main(int argc, char* argv[])
             wtArgv[i] = wtServerArgs[i].c_str();
         }
 
-        boost::asio::io_context ioContext; // ioContext used to dispatch all the services that are out of the Wt event loop
+        // Separate executors, so that long background jobs do not delay the latency sensitive child process pipe reads
+        const IOContextSettings childProcessIOSettings{ getIOContextSettings("child-process", getThreadCount()) };
+        const IOContextSettings backgroundIOSettings{ getIOContextSettings("background", 2) };
+        const IOContextSettings maintenanceIOSettings{ getIOContextSettings("maintenance", 1) };
+
+        boost::asio::io_context childProcessIOContext; // transcoder pipes
+        boost::asio::io_context backgroundIOContext; // scrobbling and feedback sync
+        boost::asio::io_context maintenanceIOContext; // database maintenance
         Wt::WServer server{ argv[0] };
         server.setServerConfiguration(wtServerArgs.size(), const_cast<char**>(&wtArgv[0]));
 
-        IOContextRunner ioContextRunner{ ioContext, getThreadCount() };
+        IOContextRunner childProcessIOContextRunner{ childProcessIOContext, childProcessIOSettings.threadCount, "child-process", childProcessIOSettings.cpus };
+        IOContextRunner backgroundIOContextRunner{ backgroundIOContext, backgroundIOSettings.threadCount, "background", backgroundIOSettings.cpus };
+        IOContextRunner maintenanceIOContextRunner{ maintenanceIOContext, maintenanceIOSettings.threadCount, "maintenance", maintenanceIOSettings.cpus };
 
-        // Connection pool size must be twice the number of threads: we have at least 2 io pools with getThreadCount() each and they all may access the database
-        Database::Db database{ config->getPath("working-dir") / "lms.db", getThreadCount() * 2 };
+        // Default read connection count: the http server threads, the same amount for the pools owned by the services (covers, subsonic queries...)
+        // and the executors that access the database (child process pipes do not)
+        const std::size_t readConnectionCount{ config->getULong("db-read-connection-count", 0) };
+        const std::size_t defaultReadConnectionCount{ getThreadCount() * 2 + backgroundIOSettings.threadCount + maintenanceIOSettings.threadCount };
+        Database::Db database{ config->getPath("working-dir") / "lms.db", readConnectionCount ? readConnectionCount : defaultReadConnectionCount };
         {
+            const ScopedStartupPhase phase{ "database preparation" };
             Database::Session session{ database };
             session.prepareTables();
+        }
+        // the secondary workers can now use the database
+        Worker::notifyReady(workerContext);
 
-            // force optimize in case scanner aborted during a large import:
-            // queries may be too slow to even be able to relaunch a scan sing the web interface
-            session.analyze();
+        // Keeps the database statistics up to date, including during large imports
+        std::optional<Database::MaintenanceScheduler> maintenanceScheduler;
+        if (workerContext.isPrimary())
+        {
+            maintenanceScheduler.emplace(maintenanceIOContext, database);
+            // force analyze in case scanner aborted during a large import:
+            // queries may be too slow to even be able to relaunch a scan using the web interface
+            maintenanceScheduler->requestAnalyze();
         }
 
-        UserInterface::LmsApplicationManager appManager;
+        UserInterface::LmsApplicationManager appManager{ server };
 
         // Service initialization order is important (reverse-order for deinit)
-        Service<IChildProcessManager> childProcessManagerService{ createChildProcessManager(ioContext) };
+        Service<IChildProcessManager> childProcessManagerService{ createChildProcessManager(childProcessIOContext) };
+        Service<IAsyncFileReader> asyncFileReaderService{ createAsyncFileReader(getAsyncFileReaderParameters()) };
+        Service<IResourceGovernor> resourceGovernorService;
+        if (config->getBool("background-throttle-enable", true))
+            resourceGovernorService.assign(createResourceGovernor(getResourceGovernorParameters()));
         Service<Auth::IAuthTokenService> authTokenService;
         Service<Auth::IPasswordService> authPasswordService;
         Service<Auth::IEnvService> authEnvService;
@@ -293,20 +587,45 @@ int main(int argc, char* argv[])
             throw LmsException{ "Bad value '" + authenticationBackend + "' for 'authentication-backend'" };
 
         Image::init(argv[0]);
-        Service<Cover::ICoverService> coverService{ Cover::createCoverService(database, argv[0], server.appRoot() + "/images/unknown-cover.jpg") };
+
+        std::optional<ScopedStartupPhase> servicesPhase{ "services initialization" };
+        // Independent services that may take time to construct (on disk cache indexing, journal replay...), constructed in parallel
+        // They only rely on the services already set
+        const std::string defaultCoverPath{ server.appRoot() + "/images/unknown-cover.jpg" };
+        auto coverServiceFuture{ std::async(std::launch::async, [&] { return Cover::createCoverService(database, argv[0], defaultCoverPath); }) };
+        auto feedbackServiceFuture{ std::async(std::launch::async, [&] { return Feedback::createFeedbackService(backgroundIOContext, database); }) };
+        auto scrobblingServiceFuture{ std::async(std::launch::async, [&] { return Scrobbling::createScrobblingService(backgroundIOContext, database); }) };
+
+        Service<Cover::ICoverService> coverService{ coverServiceFuture.get() };
+        // the engine is loaded in background, no recommendation is made until it is ready
         Service<Recommendation::IRecommendationService> recommendationService{ Recommendation::createRecommendationService(database) };
         Service<Recommendation::IPlaylistGeneratorService> playlistGeneratorService{ Recommendation::createPlaylistGeneratorService(database, *recommendationService.get()) };
-        Service<Scanner::IScannerService> scannerService{ Scanner::createScannerService(database) };
+        // the secondary workers follow the scans made by the primary worker
+        Service<Scanner::IScannerService> scannerService{ workerContext.isPrimary() ? Scanner::createScannerService(database) : Scanner::createPassiveScannerService(database) };
+
+        scannerService->getEvents().coversChanged.connect([&](const Scanner::CoverChanges& changes)
+            {
+                coverService->invalidate(changes.tracks, changes.releases, changes.artists);
+                appManager.getImmutableCoverResource().invalidate(changes.tracks, changes.releases);
+            });
 
-        scannerService->getEvents().scanComplete.connect([&]
+        scannerService->getEvents().scanComplete.connect([&](const Scanner::ScanSummary& stats)
             {
-                // Flush cover cache even if no changes:
-                // covers may be external files that changed and we don't keep track of them for now (but we should)
-                coverService->flushCache();
+                // the changed covers are not known when following the scans of the primary worker
+                if (!workerContext.isPrimary() && stats.nbChanges() > 0)
+                {
+                    coverService->flushCache();
+                    appManager.getImmutableCoverResource().clear();
+                }
+
+                // Done in background, the current engine keeps on serving the requests meanwhile
+                if (stats.nbChanges() > 0 || stats.featuresFetched > 0)
+                    recommendationService->load();
             });
 
-        Service<Feedback::IFeedbackService> feedbackService{ Feedback::createFeedbackService(ioContext, database) };
-        Service<Scrobbling::IScrobblingService> scrobblingService{ Scrobbling::createScrobblingService(ioContext, database) };
+        Service<Feedback::IFeedbackService> feedbackService{ feedbackServiceFuture.get() };
+        Service<Scrobbling::IScrobblingService> scrobblingService{ scrobblingServiceFuture.get() };
+        servicesPhase.reset();
 
         std::unique_ptr<Wt::WResource> subsonicResource;
 
@@ -317,6 +636,15 @@ int main(int argc, char* argv[])
             server.addResource(subsonicResource.get(), "/rest");
         }
 
+        server.addResource(&appManager.getImmutableCoverResource(), std::string{ UserInterface::ImmutableCoverResource::path });
+
+        std::unique_ptr<Wt::WResource> metricsResource;
+        if (metricsRegistry.exists())
+        {
+            metricsResource = std::make_unique<MetricsResource>(*metricsRegistry);
+            server.addResource(metricsResource.get(), "/metrics");
+        }
+
         // bind UI entry point
         server.addEntryPoint(Wt::EntryPointType::Application,
             [&](const Wt::WEnvironment& env)
@@ -324,12 +652,17 @@ int main(int argc, char* argv[])
                 return UserInterface::LmsApplication::create(env, database, appManager);
             });
 
-        proxyScannerEventsToApplication(*scannerService, server);
+        proxyScannerEventsToApplication(*scannerService, server, appManager);
 
         LMS_LOG(MAIN, INFO, "Starting server...");
-        server.start();
+        {
+            const ScopedStartupPhase phase{ "server start" };
+            server.start();
+        }
 
-        LMS_LOG(MAIN, INFO, "Now running...");
+        if (workerContext.count > 1)
+            LMS_LOG(MAIN, INFO, "Worker " << workerContext.index << "/" << workerContext.count << (workerContext.isPrimary() ? " (primary)" : ""));
+        LMS_LOG(MAIN, INFO, "Now running, started in " << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count() << " ms");
         Wt::WServer::waitForShutdown();
 
         LMS_LOG(MAIN, INFO, "Stopping server...");
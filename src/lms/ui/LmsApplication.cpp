@@ -53,6 +53,7 @@
 #include "resource/AudioFileResource.hpp"
 #include "resource/AudioTranscodingResource.hpp"
 #include "resource/CoverResource.hpp"
+#include "resource/HlsTranscodingResource.hpp"
 #include "Auth.hpp"
 #include "LmsApplicationException.hpp"
 #include "LmsApplicationManager.hpp"
@@ -203,6 +204,16 @@ namespace UserInterface
         return _db.getTLSSession();
     }
 
+    CollectorResultCache& LmsApplication::getCollectorResultCache()
+    {
+        return _appManager.getCollectorResultCache();
+    }
+
+    ScanProgressBroadcaster& LmsApplication::getScanProgressBroadcaster()
+    {
+        return _appManager.getScanProgressBroadcaster();
+    }
+
     Database::User::pointer LmsApplication::getUser()
     {
         if (!_authenticatedUser)
@@ -381,7 +392,7 @@ namespace UserInterface
 
     void LmsApplication::createHome()
     {
-        _coverResource = std::make_shared<CoverResource>();
+        _coverResource = std::make_shared<CoverResource>(_appManager.getImmutableCoverResource());
 
         declareJavaScriptFunction("onLoadCover", "function(id) { id.className += \" Lms-cover-loaded\"}");
         declareJavaScriptFunction("updateActiveNav",
@@ -518,7 +529,7 @@ namespace UserInterface
                         const bool isAdmin{ getUserType() == Database::UserType::ADMIN };
                         if (isAdmin)
                         {
-                            _scannerEvents.scanComplete.connect([this](const Scanner::ScanStats& stats)
+                            _scannerEvents.scanComplete.connect([this](const Scanner::ScanSummary& stats)
                                 {
                                     notifyMsg(Notification::Type::Info,
                                     Wt::WString::tr("Lms.Admin.Database.database"),
@@ -527,8 +538,8 @@ namespace UserInterface
                                         .arg(static_cast<unsigned>(stats.additions))
                                         .arg(static_cast<unsigned>(stats.updates))
                                         .arg(static_cast<unsigned>(stats.deletions))
-                                        .arg(static_cast<unsigned>(stats.duplicates.size()))
-                                        .arg(static_cast<unsigned>(stats.errors.size())));
+                                        .arg(static_cast<unsigned>(stats.duplicateCount))
+                                        .arg(static_cast<unsigned>(stats.errorCount)));
                                 });
                         }
 
@@ -43,7 +43,9 @@ namespace UserInterface
     class LmsApplicationException;
     class MediaPlayer;
     class PlayQueue;
+    class CollectorResultCache;
     class LmsApplicationManager;
+    class ScanProgressBroadcaster;
     class NotificationContainer;
     class ModalManager;
 
@@ -60,6 +62,8 @@ namespace UserInterface
         std::shared_ptr<CoverResource> getCoverResource() { return _coverResource; }
         Database::Db& getDb();
         Database::Session& getDbSession(); // always thread safe
+        CollectorResultCache& getCollectorResultCache(); // shared by all the sessions
+        ScanProgressBroadcaster& getScanProgressBroadcaster();
 
         Database::ObjectPtr<Database::User>	getUser();
         Database::UserId				getUserId();
@@ -19,10 +19,22 @@
 
 #include "LmsApplicationManager.hpp"
 
+#include "utils/IConfig.hpp"
+#include "utils/IMetricsRegistry.hpp"
+#include "utils/Service.hpp"
 #include "LmsApplication.hpp"
 
 namespace UserInterface
 {
+	LmsApplicationManager::LmsApplicationManager(Wt::WServer& server)
+		: _collectorResultCache {Service<IConfig>::get()->getULong("ui-collector-cache-max-entries", 1024)}
+		, _scanProgressBroadcaster {server, std::chrono::milliseconds {Service<IConfig>::get()->getULong("ui-scan-progress-min-interval", 1000)}}
+		, _immutableCoverResource {Service<IConfig>::get()->getULong("ui-immutable-cover-max-entries", 100000)}
+	{
+		if (Metrics::IRegistry* registry {Service<Metrics::IRegistry>::get()})
+			_sessionCountGauge = &registry->getGauge("lms_ui_sessions", "Web UI sessions with a logged in user");
+	}
+
 	void
 	LmsApplicationManager::registerApplication(LmsApplication& application)
 	{
@@ -30,6 +42,8 @@ namespace UserInterface
 			std::scoped_lock lock {_mutex};
 			m_applications[application.getUserId()].insert(&application);
 		}
+		if (_sessionCountGauge)
+			_sessionCountGauge->inc();
 
 		applicationRegistered.emit(application);
 	}
@@ -41,6 +55,8 @@ namespace UserInterface
 			std::scoped_lock lock {_mutex};
 			m_applications[application.getUserId()].erase(&application);
 		}
+		if (_sessionCountGauge)
+			_sessionCountGauge->dec();
 
 		applicationUnregistered.emit(application);
 	}
@@ -26,6 +26,10 @@
 #include <Wt/WSignal.h>
 
 #include "database/UserId.hpp"
+#include "utils/IMetricsRegistry.hpp"
+#include "explore/CollectorResultCache.hpp"
+#include "resource/ImmutableCoverResource.hpp"
+#include "ScanProgressBroadcaster.hpp"
 
 namespace UserInterface
 {
@@ -33,6 +37,12 @@ namespace UserInterface
 	class LmsApplicationManager
 	{
 		public:
+			LmsApplicationManager(Wt::WServer& server);
+
+			CollectorResultCache& getCollectorResultCache() { return _collectorResultCache; }
+			ScanProgressBroadcaster& getScanProgressBroadcaster() { return _scanProgressBroadcaster; }
+			ImmutableCoverResource& getImmutableCoverResource() { return _immutableCoverResource; }
+
 			Wt::Signal<LmsApplication&> applicationRegistered;
 			Wt::Signal<LmsApplication&> applicationUnregistered;
 
@@ -44,5 +54,9 @@ namespace UserInterface
 
 			std::mutex _mutex;
 			std::unordered_map<Database::UserId, std::unordered_set<LmsApplication*>>  m_applications;
+			CollectorResultCache _collectorResultCache;
+			ScanProgressBroadcaster _scanProgressBroadcaster;
+			ImmutableCoverResource _immutableCoverResource;
+			Metrics::Gauge* _sessionCountGauge {};
 	};
 } // UserInterface
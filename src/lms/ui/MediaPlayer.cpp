@@ -36,6 +36,7 @@
 
 #include "resource/CoverResource.hpp"
 #include "resource/AudioTranscodingResource.hpp"
+#include "resource/HlsTranscodingResource.hpp"
 #include "resource/AudioFileResource.hpp"
 
 #include "utils/String.hpp"
@@ -198,6 +199,7 @@ namespace UserInterface
         addFunction("tr", &Wt::WTemplate::Functions::tr);
 
         _audioTranscodingResource = std::make_unique<AudioTranscodingResource>();
+        _hlsTranscodingResource = std::make_unique<HlsTranscodingResource>();
         _audioFileResource = std::make_unique<AudioFileResource>();
 
         _title = bindNew<Wt::WText>("title");
@@ -244,6 +246,7 @@ namespace UserInterface
                 return;
 
             const std::string transcodingResource{ _audioTranscodingResource->getUrl(trackId) };
+            const std::string hlsResource{ _hlsTranscodingResource->getUrl(trackId) };
             const std::string nativeResource{ _audioFileResource->getUrl(trackId) };
 
             const auto artists{ track->getArtists({Database::TrackArtistLinkType::Artist}) };
@@ -253,6 +256,7 @@ namespace UserInterface
                 << " trackId :\"" << trackId.toString() << "\","
                 << " nativeResource: \"" << nativeResource << "\","
                 << " transcodingResource: \"" << transcodingResource << "\","
+                << " hlsResource: \"" << hlsResource << "\","
                 << " duration: " << std::chrono::duration_cast<std::chrono::seconds>(track->getDuration()).count() << ","
                 << " replayGain: " << replayGain << ","
                 << " title: \"" << StringUtils::jsEscape(track->getName()) << "\","
@@ -34,6 +34,7 @@ namespace UserInterface
 {
     class AudioFileResource;
     class AudioTranscodingResource;
+    class HlsTranscodingResource;
 
     class MediaPlayer : public Wt::WTemplate
     {
@@ -117,6 +118,7 @@ namespace UserInterface
     private:
         std::unique_ptr<AudioFileResource>		_audioFileResource;
         std::unique_ptr<AudioTranscodingResource>	_audioTranscodingResource;
+        std::unique_ptr<HlsTranscodingResource>	_hlsTranscodingResource;
 
         std::optional<Database::TrackId> _trackIdLoaded;
         std::optional<Settings>		_settings;
@@ -42,9 +42,9 @@
 #include "utils/Service.hpp"
 #include "utils/String.hpp"
 
-#include "common/InfiniteScrollingContainer.hpp"
 #include "common/MandatoryValidator.hpp"
 #include "common/ValueStringModel.hpp"
+#include "resource/AudioTranscodingResource.hpp"
 #include "resource/DownloadResource.hpp"
 #include "LmsApplication.hpp"
 #include "MediaPlayer.hpp"
@@ -119,6 +119,7 @@ namespace UserInterface
     PlayQueue::PlayQueue()
         : Template{ Wt::WString::tr("Lms.PlayQueue.template") }
         , _capacity{ Service<IConfig>::get()->getULong("playqueue-max-entry-count", 1000) }
+        , _preTranscodeTrackCount{ Service<IConfig>::get()->getULong("playqueue-pre-transcode-track-count", 2) }
     {
         initTrackLists();
 
@@ -137,12 +138,9 @@ namespace UserInterface
                 saveAsTrackList();
             });
 
-        _entriesContainer = bindNew<InfiniteScrollingContainer>("entries", Wt::WString::tr("Lms.PlayQueue.template.entry-container"));
-        _entriesContainer->onRequestElements.connect([this]
-            {
-                addSome();
-                updateCurrentTrack(true);
-            });
+        // only the entries close to the visible part of the queue are rendered
+        _entriesContainer = bindNew<VirtualList>("entries", *this, _pageSize, _estimatedRowHeight);
+        _entriesContainer->reset();
 
         Wt::WPushButton* shuffleBtn{ bindNew<Wt::WPushButton>("shuffle-btn", Wt::WString::tr("Lms.PlayQueue.template.shuffle-btn"), Wt::TextFormat::XHTML) };
         shuffleBtn->clicked().connect([this]
@@ -151,15 +149,12 @@ namespace UserInterface
                     auto transaction{ LmsApp->getDbSession().createWriteTransaction() };
 
                     Database::TrackList::pointer queue{ getQueue() };
-                    auto entries{ queue->getEntries() };
-                    Random::shuffleContainer(entries);
+                    std::vector<Database::TrackId> trackIds{ queue->getTrackIds() };
+                    Random::shuffleContainer(trackIds);
 
-                    queue.modify()->clear();
-                    for (const Database::TrackListEntry::pointer& entry : entries)
-                        LmsApp->getDbSession().create<Database::TrackListEntry>(entry->getTrack(), queue);
+                    queue.modify()->replaceTracks(trackIds);
                 }
                 _entriesContainer->reset();
-                addSome();
             });
 
         _repeatBtn = bindNew<Wt::WCheckBox>("repeat-btn");
@@ -282,6 +277,7 @@ namespace UserInterface
 
         Database::TrackId trackId{};
         std::optional<float> replayGain{};
+        std::vector<Database::TrackId> nextTrackIds;
         {
             auto transaction{ LmsApp->getDbSession().createWriteTransaction() };
 
@@ -306,6 +302,9 @@ namespace UserInterface
 
             replayGain = getReplayGain(pos, track);
 
+            for (std::size_t nextPos{ pos + 1 }; nextPos < queue->getCount() && nextTrackIds.size() < _preTranscodeTrackCount; ++nextPos)
+                nextTrackIds.push_back(queue->getEntry(nextPos)->getTrack()->getId());
+
             if (!LmsApp->getUser()->isDemo())
                 LmsApp->getUser().modify()->setCurPlayingTrackPos(pos);
         }
@@ -314,6 +313,19 @@ namespace UserInterface
         updateCurrentTrack(true);
         _isTrackSelected = true;
         trackSelected.emit(trackId, play, replayGain ? *replayGain : 0);
+
+        if (play)
+            preTranscodeTracks(nextTrackIds);
+    }
+
+    void PlayQueue::preTranscodeTracks(const std::vector<Database::TrackId>& trackIds)
+    {
+        // only know for sure the tracks will be transcoded in this mode
+        const auto& settings{ LmsApp->getMediaPlayer().getSettings() };
+        if (!settings || settings->transcoding.mode != MediaPlayer::Settings::Transcoding::Mode::Always)
+            return;
+
+        UserInterface::preTranscodeTracks(trackIds, settings->transcoding.format, settings->transcoding.bitrate);
     }
 
     void PlayQueue::playPrevious()
@@ -385,10 +397,11 @@ namespace UserInterface
 
     void PlayQueue::updateCurrentTrack(bool selected)
     {
-        if (!_trackPos || *_trackPos >= static_cast<std::size_t>(_entriesContainer->getCount()))
+        if (!_trackPos)
             return;
 
-        Template* entry{ static_cast<Template*>(_entriesContainer->getWidget(*_trackPos)) };
+        // not rendered entries are highlighted when created
+        Template* entry{ static_cast<Template*>(_entriesContainer->getRenderedRow(*_trackPos)) };
         if (!entry)
             return;
 
@@ -403,52 +416,37 @@ namespace UserInterface
             Database::TrackList::pointer queue{ getQueue() };
             const std::size_t queueSize{ queue->getCount() };
 
-            std::size_t nbTracksToEnqueue{ queueSize + trackIds.size() > getCapacity() ? getCapacity() - queueSize : trackIds.size() };
-            for (const Database::TrackId trackId : trackIds)
-            {
-                if (nbTracksToEnqueue == 0)
-                    break;
-
-                Database::Track::pointer track{ Database::Track::find(LmsApp->getDbSession(), trackId) };
-                if (!track)
-                    continue;
-
-                LmsApp->getDbSession().create<Database::TrackListEntry>(track, queue);
-                nbTracksToEnqueue--;
-            }
+            const std::size_t nbTracksToEnqueue{ queueSize + trackIds.size() > getCapacity() ? getCapacity() - queueSize : trackIds.size() };
+            queue.modify()->appendTracks(std::vector<Database::TrackId>(std::cbegin(trackIds), std::cbegin(trackIds) + nbTracksToEnqueue));
         }
 
         updateInfo();
-        addSome();
-        _entriesContainer->setHasMore();
+        _entriesContainer->onRowsAppended();
     }
 
     std::vector<Database::TrackId> PlayQueue::getAndClearNextTracks()
     {
         std::vector<Database::TrackId> tracks;
 
-        auto transaction{ LmsApp->getDbSession().createWriteTransaction() };
-
-        Database::TrackList::pointer queue{ getQueue() };
-        std::vector<Database::TrackListEntry::pointer> entries{ queue->getEntries(Database::Range {_trackPos ? *_trackPos + 1 : 0, getCapacity()}) };
-        tracks.reserve(entries.size());
-        for (Database::TrackListEntry::pointer entry : entries)
         {
-            tracks.push_back(entry->getTrack()->getId());
-            entry.remove();
-        }
+            auto transaction{ LmsApp->getDbSession().createWriteTransaction() };
 
-        if (_trackPos)
-        {
-            // entries may have been cleared
-            if (*_trackPos + 1 < _entriesContainer->getCount())
-                _entriesContainer->remove(*_trackPos + 1, _entriesContainer->getCount() - 1);
-        }
-        else
-        {
-            _entriesContainer->reset();
+            Database::TrackList::pointer queue{ getQueue() };
+            const std::size_t firstPos{ _trackPos ? *_trackPos + 1 : 0 };
+            std::vector<Database::TrackListEntry::pointer> entries{ queue->getEntries(Database::Range {firstPos, getCapacity()}) };
+            tracks.reserve(entries.size());
+            std::vector<std::size_t> positions;
+            positions.reserve(entries.size());
+            for (const Database::TrackListEntry::pointer& entry : entries)
+            {
+                tracks.push_back(entry->getTrack()->getId());
+                positions.push_back(firstPos + positions.size());
+            }
+            queue.modify()->removeEntries(positions);
         }
 
+        _entriesContainer->reset();
+
         return tracks;
     }
 
@@ -487,23 +485,39 @@ namespace UserInterface
         loadTrack(index, true);
     }
 
-    void PlayQueue::addSome()
+    std::size_t PlayQueue::getRowCount()
     {
+        return getCount();
+    }
+
+    std::vector<std::unique_ptr<Wt::WWidget>> PlayQueue::createRows(std::size_t offset, std::size_t count)
+    {
+        std::vector<std::unique_ptr<Wt::WWidget>> rows;
+
         auto transaction{ LmsApp->getDbSession().createReadTransaction() };
 
         const Database::TrackList::pointer queue{ getQueue() };
-        const auto tracklistEntries{ queue->getEntries(Database::Range {_entriesContainer->getCount(), _batchSize}) };
+        const auto tracklistEntries{ queue->getEntries(Database::Range {offset, count}) };
+        rows.reserve(tracklistEntries.size());
         for (const Database::TrackListEntry::pointer& tracklistEntry : tracklistEntries)
-            addEntry(tracklistEntry);
+        {
+            std::unique_ptr<Wt::WWidget> entry{ createEntry(tracklistEntry) };
+            if (_trackPos && *_trackPos == offset + rows.size())
+                entry->addStyleClass("Lms-entry-playing");
+            rows.push_back(std::move(entry));
+        }
+
+        return rows;
     }
 
-    void PlayQueue::addEntry(const Database::TrackListEntry::pointer& tracklistEntry)
+    std::unique_ptr<Wt::WWidget> PlayQueue::createEntry(const Database::TrackListEntry::pointer& tracklistEntry)
     {
         const Database::TrackListEntryId tracklistEntryId{ tracklistEntry->getId() };
         const auto track{ tracklistEntry->getTrack() };
         const Database::TrackId trackId{ track->getId() };
 
-        Template* entry{ _entriesContainer->addNew<Template>(Wt::WString::tr("Lms.PlayQueue.template.entry")) };
+        auto entryPtr{ std::make_unique<Template>(Wt::WString::tr("Lms.PlayQueue.template.entry")) };
+        Template* entry{ entryPtr.get() };
         entry->addFunction("id", &Wt::WTemplate::Functions::id);
 
         entry->bindString("name", Wt::WString::fromUTF8(track->getName()), Wt::TextFormat::Plain);
@@ -561,11 +575,12 @@ namespace UserInterface
                     const std::optional<std::size_t> pos{ _entriesContainer->getIndexOf(*entry) };
                     if (pos && *_trackPos >= *pos)
                         (*_trackPos)--;
-                    else if (*_trackPos >= _entriesContainer->getCount())
+                    else if (*_trackPos >= getCount())
                         _trackPos.reset();
                 }
 
-                _entriesContainer->remove(*entry);
+                // following entries are shifted, entry is destroyed here
+                _entriesContainer->reset();
 
                 updateInfo();
             });
@@ -600,6 +615,8 @@ namespace UserInterface
 
         entry->bindNew<Wt::WPushButton>("download", Wt::WString::tr("Lms.Explore.download"))
             ->setLink(Wt::WLink{ std::make_unique<DownloadTrackResource>(trackId) });
+
+        return entryPtr;
     }
 
     void PlayQueue::enqueueRadioTracksIfNeeded()
@@ -791,15 +808,8 @@ namespace UserInterface
         auto transaction{ session.createWriteTransaction() };
 
         TrackList::pointer trackList{ TrackList::find(LmsApp->getDbSession(), trackListId) };
-        trackList.modify()->clear();
-
-        Track::FindParameters params;
-        params.setTrackList(_queueId);
-        params.setSortMethod(TrackSortMethod::TrackList);
+        const TrackList::pointer queue{ getQueue() };
 
-        Track::find(session, params, [&](const Track::pointer& track)
-            {
-                session.create<TrackListEntry>(track, trackList);
-            });
+        trackList.modify()->replaceTracks(queue->getTrackIds());
     }
 } // namespace UserInterface
@@ -31,6 +31,7 @@
 #include "database/TrackListId.hpp"
 
 #include "common/Template.hpp"
+#include "common/VirtualList.hpp"
 
 
 namespace Database
@@ -42,9 +43,7 @@ namespace Database
 
 namespace UserInterface {
 
-class InfiniteScrollingContainer;
-
-class PlayQueue : public Template
+class PlayQueue : public Template, private IVirtualListModel
 {
 	public:
 		PlayQueue();
@@ -85,8 +84,10 @@ class PlayQueue : public Template
 		void clearTracks();
 		void enqueueTracks(const std::vector<Database::TrackId>& trackIds);
 		std::vector<Database::TrackId> getAndClearNextTracks();
-		void addSome();
-		void addEntry(const Database::ObjectPtr<Database::TrackListEntry>& entry);
+		// IVirtualListModel
+		std::size_t getRowCount() override;
+		std::vector<std::unique_ptr<Wt::WWidget>> createRows(std::size_t offset, std::size_t count) override;
+		std::unique_ptr<Wt::WWidget> createEntry(const Database::ObjectPtr<Database::TrackListEntry>& entry);
 		void enqueueRadioTracksIfNeeded();
 		void enqueueRadioTracks();
 		void updateInfo();
@@ -97,6 +98,7 @@ class PlayQueue : public Template
 		void loadTrack(std::size_t pos, bool play);
 		void stop();
 
+		void preTranscodeTracks(const std::vector<Database::TrackId>& trackIds);
 		std::optional<float> getReplayGain(std::size_t pos, const Database::ObjectPtr<Database::Track>& track) const;
 		void saveAsTrackList();
 
@@ -104,11 +106,13 @@ class PlayQueue : public Template
 		void exportToTrackList(Database::TrackListId trackList);
 
 		const std::size_t _capacity;
-		static inline constexpr std::size_t _batchSize {12};
+		const std::size_t _preTranscodeTrackCount;
+		static inline constexpr std::size_t _pageSize {20};
+		static inline constexpr int _estimatedRowHeight {80}; // px
 
 		bool _mediaPlayerSettingsLoaded {};
 		Database::TrackListId _queueId {};
-		InfiniteScrollingContainer* _entriesContainer {};
+		VirtualList* _entriesContainer {};
 		Wt::WText* _nbTracks {};
 		Wt::WText* _duration {};
 		Wt::WCheckBox* _repeatBtn {};
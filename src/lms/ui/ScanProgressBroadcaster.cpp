@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ScanProgressBroadcaster.hpp"
+
+#include <algorithm>
+#include <vector>
+
+#include <Wt/WIOService.h>
+#include <Wt/WServer.h>
+
+#include "LmsApplication.hpp"
+
+namespace UserInterface
+{
+    ScanProgressBroadcaster::ScanProgressBroadcaster(Wt::WServer& server, std::chrono::milliseconds minInterval)
+        : _server{ server }
+        , _minInterval{ minInterval }
+    {
+    }
+
+    void ScanProgressBroadcaster::subscribe(const std::string& sessionId)
+    {
+        std::scoped_lock lock{ _mutex };
+        _sessionIds.insert(sessionId);
+    }
+
+    void ScanProgressBroadcaster::unsubscribe(const std::string& sessionId)
+    {
+        std::scoped_lock lock{ _mutex };
+        _sessionIds.erase(sessionId);
+    }
+
+    void ScanProgressBroadcaster::onScanInProgress(const Scanner::ScanStepStats& stats)
+    {
+        std::scoped_lock lock{ _mutex };
+
+        // nobody to notify, subscribers refresh their contents when they subscribe
+        if (_sessionIds.empty())
+            return;
+
+        _pendingStats = stats;
+        if (_flushScheduled)
+            return;
+
+        _flushScheduled = true;
+        const auto now{ std::chrono::steady_clock::now() };
+        const auto delay{ std::max<std::chrono::steady_clock::duration>(std::chrono::steady_clock::duration::zero(), _lastFlush + _minInterval - now) };
+        _server.ioService().schedule(delay, [this] { flush(); });
+    }
+
+    void ScanProgressBroadcaster::flush()
+    {
+        std::optional<Scanner::ScanStepStats> stats;
+        std::vector<std::string> sessionIds;
+        {
+            std::scoped_lock lock{ _mutex };
+
+            _flushScheduled = false;
+            _lastFlush = std::chrono::steady_clock::now();
+            stats.swap(_pendingStats);
+            sessionIds.assign(std::cbegin(_sessionIds), std::cend(_sessionIds));
+        }
+
+        if (!stats)
+            return;
+
+        for (const std::string& sessionId : sessionIds)
+        {
+            _server.post(sessionId, [stats = *stats]
+                {
+                    // may be nullptr, see https://redmine.webtoolkit.eu/issues/8202
+                    if (!LmsApp)
+                        return;
+
+                    LmsApp->getScannerEvents().scanInProgress.emit(stats);
+                    LmsApp->triggerUpdate();
+                });
+        }
+    }
+} // namespace UserInterface
@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_set>
+
+#include "services/scanner/ScannerStats.hpp"
+
+namespace Wt
+{
+    class WServer;
+}
+
+namespace UserInterface
+{
+    // Forwards the scan progress to the sessions that display it
+    // Progress events are coalesced (only the latest one is sent) and sent at most once per given interval
+    class ScanProgressBroadcaster
+    {
+    public:
+        ScanProgressBroadcaster(Wt::WServer& server, std::chrono::milliseconds minInterval);
+
+        ScanProgressBroadcaster(const ScanProgressBroadcaster&) = delete;
+        ScanProgressBroadcaster& operator=(const ScanProgressBroadcaster&) = delete;
+
+        void subscribe(const std::string& sessionId);
+        void unsubscribe(const std::string& sessionId);
+
+        // can be called from any thread
+        void onScanInProgress(const Scanner::ScanStepStats& stats);
+
+    private:
+        void flush();
+
+        Wt::WServer& _server;
+        const std::chrono::milliseconds _minInterval;
+
+        std::mutex _mutex;
+        std::unordered_set<std::string> _sessionIds;
+        std::optional<Scanner::ScanStepStats> _pendingStats;
+        bool _flushScheduled{};
+        std::chrono::steady_clock::time_point _lastFlush;
+    };
+} // namespace UserInterface
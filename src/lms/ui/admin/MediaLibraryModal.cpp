@@ -20,10 +20,12 @@
 #include "MediaLibraryModal.hpp"
 
 #include <Wt/WFormModel.h>
+#include <Wt/WIntValidator.h>
 #include <Wt/WLineEdit.h>
 #include <Wt/WPushButton.h>
 #include <Wt/WTemplateFormView.h>
 
+#include "database/Directory.hpp"
 #include "database/MediaLibrary.hpp"
 #include "database/Session.hpp"
 #include "utils/Path.hpp"
@@ -122,12 +124,18 @@ namespace UserInterface
         public:
             static inline constexpr Field NameField{ "name" };
             static inline constexpr Field DirectoryField{ "directory" };
+            static inline constexpr Field ScanThreadCountField{ "scan-thread-count" };
+            static inline constexpr Field MaxFilesPerSecondField{ "max-files-per-second" };
+            static inline constexpr Field MaxKBytesPerSecondField{ "max-kbytes-per-second" };
 
             MediaLibraryModel(MediaLibraryId libraryId)
                 : _libraryId{ libraryId }
             {
                 addField(NameField);
                 addField(DirectoryField);
+                addField(ScanThreadCountField);
+                addField(MaxFilesPerSecondField);
+                addField(MaxKBytesPerSecondField);
 
                 {
                     auto nameValidator{ std::make_shared<LibraryNameValidator>(libraryId) };
@@ -141,6 +149,14 @@ namespace UserInterface
                     setValidator(DirectoryField, std::move(directoryValidator));
                 }
 
+                setValidator(ScanThreadCountField, createCountValidator(256));
+                setValidator(MaxFilesPerSecondField, createCountValidator(100'000));
+                setValidator(MaxKBytesPerSecondField, createCountValidator(10'000'000));
+
+                setValue(ScanThreadCountField, std::string{ "0" });
+                setValue(MaxFilesPerSecondField, std::string{ "0" });
+                setValue(MaxKBytesPerSecondField, std::string{ "0" });
+
                 if (libraryId.isValid())
                     loadData();
             }
@@ -156,13 +172,38 @@ namespace UserInterface
                 else
                     library = session.create<MediaLibrary>();
 
+                const std::filesystem::path newPath{ valueText(DirectoryField).toUTF8() };
+                // Moved library: the tracks follow their root directory, so that they do not have to be removed and added again
+                // Nested paths are left to the scanner, as the tracks may move between directory trees
+                if (_libraryId.isValid()
+                    && !PathUtils::isPathInRootPath(newPath, library->getPath())
+                    && !PathUtils::isPathInRootPath(library->getPath(), newPath))
+                {
+                    Directory::moveRootDirectory(session, library->getPath(), newPath);
+                }
+
                 library.modify()->setName(valueText(NameField).toUTF8());
-                library.modify()->setPath(valueText(DirectoryField).toUTF8());
+                library.modify()->setPath(newPath);
+                library.modify()->setScanThreadCount(getCount(ScanThreadCountField));
+                library.modify()->setScanMaxFilesPerSecond(getCount(MaxFilesPerSecondField));
+                library.modify()->setScanMaxBytesPerSecond(getCount(MaxKBytesPerSecondField) * 1024);
 
                 return library->getId();
             }
 
         private:
+            static std::shared_ptr<Wt::WValidator> createCountValidator(int maxValue)
+            {
+                auto validator{ std::make_shared<Wt::WIntValidator>(0, maxValue) };
+                validator->setMandatory(true);
+                return validator;
+            }
+
+            std::size_t getCount(Field field) const
+            {
+                return StringUtils::readAs<std::size_t>(valueText(field).toUTF8()).value_or(0);
+            }
+
             void loadData()
             {
                 auto& session{ LmsApp->getDbSession() };
@@ -172,6 +213,9 @@ namespace UserInterface
 
                 setValue(NameField, std::string{ library->getName() });
                 setValue(DirectoryField, library->getPath().string());
+                setValue(ScanThreadCountField, std::to_string(library->getScanThreadCount()));
+                setValue(MaxFilesPerSecondField, std::to_string(library->getScanMaxFilesPerSecond()));
+                setValue(MaxKBytesPerSecondField, std::to_string(library->getScanMaxBytesPerSecond() / 1024));
             }
 
             const MediaLibraryId _libraryId;
@@ -187,6 +231,9 @@ namespace UserInterface
 
         setFormWidget(MediaLibraryModel::NameField, std::make_unique<Wt::WLineEdit>());
         setFormWidget(MediaLibraryModel::DirectoryField, std::make_unique<Wt::WLineEdit>());
+        setFormWidget(MediaLibraryModel::ScanThreadCountField, std::make_unique<Wt::WLineEdit>());
+        setFormWidget(MediaLibraryModel::MaxFilesPerSecondField, std::make_unique<Wt::WLineEdit>());
+        setFormWidget(MediaLibraryModel::MaxKBytesPerSecondField, std::make_unique<Wt::WLineEdit>());
 
         Wt::WPushButton* saveBtn{ bindNew<Wt::WPushButton>("save-btn", Wt::WString::tr(mediaLibraryId.isValid() ? "Lms.save" : "Lms.create")) };
         saveBtn->clicked().connect(this, [this, mediaLibraryId, model]
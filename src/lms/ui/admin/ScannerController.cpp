@@ -26,19 +26,24 @@
 #include <Wt/WPushButton.h>
 #include <Wt/WResource.h>
 
+#include "database/Db.hpp"
+#include "database/ScanError.hpp"
 #include "database/Session.hpp"
+#include "database/SlowQueryLog.hpp"
 #include "database/Track.hpp"
 #include "services/scanner/IScannerService.hpp"
+#include "utils/String.hpp"
 #include "utils/Service.hpp"
 #include "LmsApplication.hpp"
+#include "ScanProgressBroadcaster.hpp"
 
 namespace UserInterface
 {
     namespace
     {
-        std::string durationToString(const Wt::WDateTime& begin, const Wt::WDateTime& end)
+        std::string durationToString(std::chrono::seconds duration)
         {
-            const auto secs{ std::chrono::duration_cast<std::chrono::seconds>(end.toTimePoint() - begin.toTimePoint()).count() };
+            const auto secs{ duration.count() };
 
             std::ostringstream oss;
 
@@ -50,6 +55,31 @@ namespace UserInterface
 
             return oss.str();
         }
+
+        std::string durationToString(const Wt::WDateTime& begin, const Wt::WDateTime& end)
+        {
+            return durationToString(std::chrono::duration_cast<std::chrono::seconds>(end.toTimePoint() - begin.toTimePoint()));
+        }
+
+        std::string_view scanStepToString(Scanner::ScanStep step)
+        {
+            switch (step)
+            {
+            case Scanner::ScanStep::DiscoveringFiles:           return "Discovering files";
+            case Scanner::ScanStep::ScanningFiles:              return "Scanning files";
+            case Scanner::ScanStep::ChekingForMissingFiles:     return "Checking for missing files";
+            case Scanner::ScanStep::CheckingForDuplicateFiles:  return "Checking for duplicate files";
+            case Scanner::ScanStep::ComputingTrackFeatures:     return "Computing track features";
+            case Scanner::ScanStep::ReloadingSimilarityEngine:  return "Reloading similarity engine";
+            case Scanner::ScanStep::ComputeClusterStats:        return "Computing stats";
+            case Scanner::ScanStep::ComputeSimilarities:        return "Computing similarities";
+            case Scanner::ScanStep::GeneratingCovers:           return "Generating covers";
+            case Scanner::ScanStep::RefiningDurations:          return "Refining durations";
+            case Scanner::ScanStep::ComputingLoudness:          return "Computing loudness";
+            case Scanner::ScanStep::FetchingTrackFeatures:      return "Fetching track features";
+            }
+            return "?";
+        }
     }
 
     class ReportResource : public Wt::WResource
@@ -78,14 +108,19 @@ namespace UserInterface
             if (!_stats)
                 return;
 
-            response.out() << Wt::WString::tr("Lms.Admin.ScannerController.errors-header").arg(_stats->errors.size()).toUTF8() << std::endl;
-
-            for (const auto& error : _stats->errors)
             {
-                response.out() << error.file.string() << " - " << errorTypeToWString(error.error).toUTF8();
-                if (!error.systemError.empty())
-                    response.out() << ": " << error.systemError;
-                response.out() << std::endl;
+                // only a few errors are kept in the stats, all of them are stored in the database
+                auto transaction{ LmsApp->getDbSession().createReadTransaction() };
+
+                response.out() << Wt::WString::tr("Lms.Admin.ScannerController.errors-header").arg(Database::ScanError::getCount(LmsApp->getDbSession())).toUTF8() << std::endl;
+
+                Database::ScanError::find(LmsApp->getDbSession(), std::nullopt, [&](const Database::ScanError::Entry& error)
+                    {
+                        response.out() << error.path.string() << " - " << errorTypeToWString(static_cast<Scanner::ScanErrorType>(error.type)).toUTF8();
+                        if (!error.systemError.empty())
+                            response.out() << ": " << error.systemError;
+                        response.out() << std::endl;
+                    });
             }
 
             response.out() << std::endl;
@@ -136,8 +171,116 @@ namespace UserInterface
         std::unique_ptr<Scanner::ScanStats> _stats;
     };
 
+    class PerformanceReportResource : public Wt::WResource
+    {
+    public:
+        PerformanceReportResource()
+        {
+            suggestFileName("performance-report.txt");
+        }
+
+        ~PerformanceReportResource()
+        {
+            beingDeleted();
+        }
+
+        void setScanReports(const std::vector<Scanner::ScanReport>& reports)
+        {
+            _reports = reports;
+        }
+
+        void handleRequest(const Wt::Http::Request&, Wt::Http::Response& response)
+        {
+            constexpr std::uintmax_t mib{ 1024 * 1024 };
+
+            response.out() << Wt::WString::tr("Lms.Admin.ScannerController.performance-reports-header").arg(_reports.size()).toUTF8() << std::endl;
+
+            for (const Scanner::ScanReport& report : _reports)
+            {
+                const Scanner::ScanPerformance& performance{ report.performance };
+
+                response.out() << std::endl;
+                response.out() << Wt::WString::tr("Lms.Admin.ScannerController.performance-report-scan")
+                    .arg(report.fileCount)
+                    .arg(durationToString(report.startTime, report.stopTime))
+                    .arg(report.stopTime.toString())
+                    .arg(report.errorCount)
+                    .arg(report.changeCount).toUTF8() << std::endl;
+
+                for (const Scanner::ScanPerformance::Step& step : performance.steps)
+                {
+                    const auto durationMs{ step.duration.count() };
+                    response.out() << "  " << scanStepToString(step.step) << ": " << durationMs << " ms, " << step.processedElems << " elements";
+                    if (durationMs > 0)
+                        response.out() << " (" << (step.processedElems * 1000) / durationMs << "/s)";
+                    response.out() << std::endl;
+                }
+
+                response.out() << "  Parsed files: " << report.scanCount << ", " << performance.bytesRead / mib << " MiB read"
+                    << ", parse time: " << performance.parseDuration.count() / 1000 << " ms (cumulated over the parser threads)"
+                    << ", database time: " << performance.dbDuration.count() / 1000 << " ms" << std::endl;
+
+                if (!performance.slowestFiles.empty())
+                {
+                    response.out() << "  Slowest files to parse:" << std::endl;
+                    for (const Scanner::ScanPerformance::SlowFile& slowFile : performance.slowestFiles)
+                    {
+                        response.out() << "    " << slowFile.parseDuration.count() / 1000 << " ms - " << slowFile.file.string()
+                            << " (" << (slowFile.format.empty() ? "?" : slowFile.format) << ", " << slowFile.size / 1024 << " KiB)" << std::endl;
+                    }
+                }
+            }
+        }
+
+    private:
+        std::vector<Scanner::ScanReport> _reports;
+    };
+
+    class SlowQueriesResource : public Wt::WResource
+    {
+    public:
+        SlowQueriesResource(const Database::SlowQueryLog& slowQueryLog)
+            : _slowQueryLog{ slowQueryLog }
+        {
+            suggestFileName("slow-queries.txt");
+        }
+
+        ~SlowQueriesResource()
+        {
+            beingDeleted();
+        }
+
+        void handleRequest(const Wt::Http::Request&, Wt::Http::Response& response)
+        {
+            const std::vector<Database::SlowQueryLog::Entry> entries{ _slowQueryLog.getEntries() };
+
+            response.out() << Wt::WString::tr("Lms.Admin.ScannerController.slow-queries-header").arg(entries.size()).arg(_slowQueryLog.getThreshold().count() / 1000).toUTF8() << std::endl;
+
+            for (const Database::SlowQueryLog::Entry& entry : entries)
+            {
+                response.out() << std::endl;
+                response.out() << entry.shape << std::endl;
+                response.out() << "  count: " << entry.count
+                    << ", total: " << entry.totalDuration.count() / 1000 << " ms"
+                    << ", avg: " << entry.totalDuration.count() / 1000 / entry.count << " ms"
+                    << ", max: " << entry.maxDuration.count() / 1000 << " ms" << std::endl;
+                response.out() << "  last: " << entry.lastDateTime.toString().toUTF8()
+                    << ", " << entry.lastQuery.duration.count() / 1000 << " ms"
+                    << ", " << entry.lastQuery.rowCount << " rows"
+                    << ", parameters: [" << StringUtils::joinStrings(entry.lastQuery.parameters, ", ") << "]" << std::endl;
+                for (const std::string& detail : entry.queryPlan)
+                    response.out() << "  plan: " << detail << std::endl;
+            }
+        }
+
+    private:
+        const Database::SlowQueryLog& _slowQueryLog;
+    };
+
     ScannerController::ScannerController()
         : WTemplate{ Wt::WString::tr("Lms.Admin.ScannerController.template") }
+        , _scanProgressBroadcaster{ LmsApp->getScanProgressBroadcaster() }
+        , _sessionId{ LmsApp->sessionId() }
     {
         addFunction("tr", &Wt::WTemplate::Functions::tr);
         addFunction("id", &Wt::WTemplate::Functions::id);
@@ -156,6 +299,18 @@ namespace UserInterface
             _reportBtn->setLink(link);
         }
 
+        {
+            _performanceReportBtn = bindNew<Wt::WPushButton>("performance-report-btn", Wt::WString::tr("Lms.Admin.ScannerController.get-performance-reports"));
+
+            auto performanceReportResource{ std::make_shared<PerformanceReportResource>() };
+            performanceReportResource->setTakesUpdateLock(true);
+            _performanceReportResource = performanceReportResource.get();
+
+            Wt::WLink link{ performanceReportResource };
+            link.setTarget(Wt::LinkTarget::NewWindow);
+            _performanceReportBtn->setLink(link);
+        }
+
         Wt::WPushButton* scanBtn{ bindNew<Wt::WPushButton>("scan-btn", Wt::WString::tr("Lms.Admin.ScannerController.scan-now")) };
         scanBtn->clicked().connect([]
             {
@@ -177,6 +332,24 @@ namespace UserInterface
         _stepStatus = bindNew<Wt::WLineEdit>("step-status");
         _stepStatus->setReadOnly(true);
 
+        _dbStorage = bindNew<Wt::WLineEdit>("db-storage");
+        _dbStorage->setReadOnly(true);
+
+        {
+            Wt::WPushButton* slowQueriesBtn{ bindNew<Wt::WPushButton>("slow-queries-btn", Wt::WString::tr("Lms.Admin.ScannerController.get-slow-queries")) };
+            if (const Database::SlowQueryLog * slowQueryLog{ LmsApp->getDb().getSlowQueryLog() })
+            {
+                Wt::WLink link{ std::make_shared<SlowQueriesResource>(*slowQueryLog) };
+                link.setTarget(Wt::LinkTarget::NewWindow);
+                slowQueriesBtn->setLink(link);
+            }
+            else
+            {
+                // see db-slow-query-threshold
+                slowQueriesBtn->setEnabled(false);
+            }
+        }
+
         auto onDbEvent{ [&]() { refreshContents(); } };
 
         LmsApp->getScannerEvents().scanAborted.connect(this, []
@@ -187,11 +360,60 @@ namespace UserInterface
             {
                 LmsApp->notifyMsg(Notification::Type::Info, Wt::WString::tr("Lms.Admin.Database.database"), Wt::WString::tr("Lms.Admin.Database.scan-launched"));
             });
-        LmsApp->getScannerEvents().scanComplete.connect(this, onDbEvent);
+        LmsApp->getScannerEvents().scanComplete.connect(this, [this]
+            {
+                refreshContents();
+                refreshDbStorage();
+            });
         LmsApp->getScannerEvents().scanInProgress.connect(this, onDbEvent);
         LmsApp->getScannerEvents().scanScheduled.connect(this, onDbEvent);
 
+        LmsApp->internalPathChanged().connect(this, [this]
+            {
+                handlePathChange();
+            });
+
         refreshContents();
+        refreshDbStorage();
+        handlePathChange();
+    }
+
+    ScannerController::~ScannerController()
+    {
+        if (_subscribed)
+            _scanProgressBroadcaster.unsubscribe(_sessionId);
+    }
+
+    void ScannerController::handlePathChange()
+    {
+        // scan progress is only sent to the sessions that display this view
+        const bool displayed{ LmsApp->internalPathMatches("/admin/scanner") };
+        if (displayed == _subscribed)
+            return;
+
+        _subscribed = displayed;
+        if (_subscribed)
+        {
+            _scanProgressBroadcaster.subscribe(_sessionId);
+            refreshContents(); // progress events are missed while not subscribed
+        }
+        else
+            _scanProgressBroadcaster.unsubscribe(_sessionId);
+    }
+
+    void ScannerController::refreshDbStorage()
+    {
+        const Database::Db::StorageStats stats{ LmsApp->getDb().getStorageStats() };
+
+        constexpr std::uint64_t mib{ 1024 * 1024 };
+        const std::uint64_t size{ stats.pageCount * stats.pageSize };
+        const std::uint64_t freeSize{ stats.freePageCount * stats.pageSize };
+        const std::uint64_t freePercent{ stats.pageCount ? (stats.freePageCount * 100) / stats.pageCount : 0 };
+
+        _dbStorage->setText(Wt::WString::tr(stats.incrementalVacuum ? "Lms.Admin.ScannerController.db-storage-status" : "Lms.Admin.ScannerController.db-storage-status-no-vacuum")
+            .arg(size / mib)
+            .arg(freeSize / mib)
+            .arg(freePercent));
     }
 
     void ScannerController::refreshContents()
@@ -205,7 +427,7 @@ namespace UserInterface
                 .arg(status.lastCompleteScanStats->nbFiles())
                 .arg(durationToString(status.lastCompleteScanStats->startTime, status.lastCompleteScanStats->stopTime))
                 .arg(status.lastCompleteScanStats->stopTime.toString())
-                .arg(status.lastCompleteScanStats->errors.size())
+                .arg(status.lastCompleteScanStats->errorCount)
                 .arg(status.lastCompleteScanStats->duplicates.size())
             );
 
@@ -219,6 +441,10 @@ namespace UserInterface
             _reportBtn->setEnabled(false);
         }
 
+        // kept across restarts, unlike the last complete scan stats
+        _performanceReportResource->setScanReports(status.lastScanReports);
+        _performanceReportBtn->setEnabled(!status.lastScanReports.empty());
+
         switch (status.currentState)
         {
         case IScannerService::State::NotScheduled:
@@ -266,6 +492,13 @@ namespace UserInterface
                     .arg(status.currentScanStepStats->progress()));
                 break;
 
+            case Scanner::ScanStep::ComputingTrackFeatures:
+                _stepStatus->setText(Wt::WString::tr("Lms.Admin.ScannerController.step-computing-track-features")
+                    .arg(status.currentScanStepStats->processedElems)
+                    .arg(status.currentScanStepStats->totalElems)
+                    .arg(status.currentScanStepStats->progress()));
+                break;
+
             case Scanner::ScanStep::ReloadingSimilarityEngine:
                 _stepStatus->setText(Wt::WString::tr("Lms.Admin.ScannerController.step-reloading-similarity-engine")
                     .arg(status.currentScanStepStats->progress()));
@@ -274,6 +507,26 @@ namespace UserInterface
             case Scanner::ScanStep::ComputeClusterStats:
                 _stepStatus->setText(Wt::WString::tr("Lms.Admin.ScannerController.step-compute-cluster-stats")
                     .arg(status.currentScanStepStats->progress()));
+                break;
+
+            case Scanner::ScanStep::ComputeSimilarities:
+                _stepStatus->setText(Wt::WString::tr("Lms.Admin.ScannerController.step-compute-similarities")
+                    .arg(status.currentScanStepStats->progress()));
+                break;
+
+            case Scanner::ScanStep::GeneratingCovers:
+                _stepStatus->setText(Wt::WString::tr("Lms.Admin.ScannerController.step-generating-covers")
+                    .arg(status.currentScanStepStats->progress()));
+                break;
+
+            case Scanner::ScanStep::RefiningDurations:
+                _stepStatus->setText(Wt::WString::tr("Lms.Admin.ScannerController.step-refining-durations")
+                    .arg(status.currentScanStepStats->progress()));
+                break;
+
+            case Scanner::ScanStep::ComputingLoudness:
+                _stepStatus->setText(Wt::WString::tr("Lms.Admin.ScannerController.step-computing-loudness")
+                    .arg(status.currentScanStepStats->progress()));
             }
             break;
         }
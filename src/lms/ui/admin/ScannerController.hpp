@@ -19,24 +19,37 @@
 
 #pragma once
 
+#include <string>
+
 #include <Wt/WPushButton.h>
 #include <Wt/WTemplate.h>
 #include <Wt/WLineEdit.h>
 
 namespace UserInterface
 {
+    class ScanProgressBroadcaster;
+
     class ScannerController : public Wt::WTemplate
     {
     public:
         ScannerController();
+        ~ScannerController();
 
     private:
         void refreshContents();
+        void refreshDbStorage();
+        void handlePathChange();
 
         Wt::WPushButton* _reportBtn;
+        Wt::WPushButton* _performanceReportBtn;
         Wt::WLineEdit* _lastScanStatus;
         Wt::WLineEdit* _status;
         Wt::WLineEdit* _stepStatus;
+        Wt::WLineEdit* _dbStorage;
         class ReportResource* _reportResource;
+        class PerformanceReportResource* _performanceReportResource;
+        ScanProgressBroadcaster& _scanProgressBroadcaster;
+        const std::string _sessionId; // the application may be already gone on destruction
+        bool _subscribed{};
     };
 } // namespace DatabaseStatus
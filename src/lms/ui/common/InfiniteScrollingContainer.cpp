@@ -20,10 +20,32 @@
 #include "InfiniteScrollingContainer.hpp"
 
 #include <cassert>
+
+#include <Wt/WApplication.h>
+
+#include "utils/IConfig.hpp"
+#include "utils/IMetricsRegistry.hpp"
+#include "utils/Service.hpp"
 #include "LoadingIndicator.hpp"
 
 namespace UserInterface
 {
+	namespace
+	{
+		Metrics::Gauge*
+		getElementCountGauge()
+		{
+			static Metrics::Gauge* gauge {[]() -> Metrics::Gauge*
+			{
+				if (Metrics::IRegistry* registry {Service<Metrics::IRegistry>::get()})
+					return &registry->getGauge("lms_ui_list_entries", "Entries displayed in the lists of all the web UI sessions");
+				return nullptr;
+			}()};
+
+			return gauge;
+		}
+	}
+
 	InfiniteScrollingContainer::InfiniteScrollingContainer(const Wt::WString& text)
 		: Wt::WTemplate {text}
 		, _elements {bindNew<Wt::WContainerWidget>("elements")}
@@ -32,6 +54,11 @@ namespace UserInterface
 		reset();
 	}
 
+	InfiniteScrollingContainer::~InfiniteScrollingContainer()
+	{
+		onElementsRemoved(_elements->count());
+	}
+
 	void
 	InfiniteScrollingContainer::clear()
 	{
@@ -41,6 +68,7 @@ namespace UserInterface
 	void
 	InfiniteScrollingContainer::reset()
 	{
+		onElementsRemoved(_elements->count());
 		_elements->clear();
 		setHasMore(true);
 	}
@@ -54,7 +82,8 @@ namespace UserInterface
 	void
 	InfiniteScrollingContainer::add(std::unique_ptr<Wt::WWidget> result)
 	{
-		return _elements->addWidget(std::move(result));
+		_elements->addWidget(std::move(result));
+		onElementsAdded(1);
 	}
 
 	void
@@ -76,6 +105,7 @@ namespace UserInterface
 	InfiniteScrollingContainer::remove(Wt::WWidget& widget)
 	{
 		_elements->removeWidget(&widget);
+		onElementsRemoved(1);
 	}
 
 	void
@@ -89,11 +119,40 @@ namespace UserInterface
 		while (Wt::WWidget* widget {_elements->widget(i)})
 		{
 			_elements->removeWidget(widget);
+			onElementsRemoved(1);
 			if (i-- == first)
 				break;
 		}
 	}
 
+	void
+	InfiniteScrollingContainer::trim(std::size_t maxCount)
+	{
+		const std::size_t count {static_cast<std::size_t>(_elements->count())};
+		if (count <= maxCount)
+			return;
+
+		remove(maxCount, count - 1);
+		setHasMore(true);
+	}
+
+	void
+	InfiniteScrollingContainer::trimWhenLeaving(const std::string& internalPath)
+	{
+		wApp->internalPathChanged().connect(this, [this, internalPath]
+		{
+			if (!wApp->internalPathMatches(internalPath))
+				trim(getMaxHiddenCount());
+		});
+	}
+
+	std::size_t
+	InfiniteScrollingContainer::getMaxHiddenCount()
+	{
+		static const std::size_t maxHiddenCount {Service<IConfig>::get()->getULong("ui-hidden-list-max-entry-count", 50)};
+		return maxHiddenCount;
+	}
+
 	Wt::WWidget*
 	InfiniteScrollingContainer::getWidget(std::size_t pos) const
 	{
@@ -107,6 +166,20 @@ namespace UserInterface
 	}
 
 
+	void
+	InfiniteScrollingContainer::onElementsAdded(std::size_t count)
+	{
+		if (Metrics::Gauge* gauge {getElementCountGauge()})
+			gauge->inc(count);
+	}
+
+	void
+	InfiniteScrollingContainer::onElementsRemoved(std::size_t count)
+	{
+		if (Metrics::Gauge* gauge {getElementCountGauge()})
+			gauge->dec(count);
+	}
+
 	void
 	InfiniteScrollingContainer::displayLoadingIndicator()
 	{
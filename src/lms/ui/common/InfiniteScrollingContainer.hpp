@@ -21,6 +21,7 @@
 
 #include <memory>
 #include <optional>
+#include <string>
 #include <utility>
 
 #include <Wt/WContainerWidget.h>
@@ -37,6 +38,7 @@ namespace UserInterface
 		public:
 			// "text" must contain loading-indicator and "elements"
 			InfiniteScrollingContainer(const Wt::WString& text = Wt::WString::tr("Lms.infinite-scrolling-container.template"));
+			~InfiniteScrollingContainer();
 
 			void reset();
 			std::size_t getCount();
@@ -45,11 +47,17 @@ namespace UserInterface
 			template<typename T, typename... Args>
 			T* addNew(Args&&... args)
 			{
-				return _elements->addNew<T>(std::forward<Args>(args)...);
+				T* element {_elements->addNew<T>(std::forward<Args>(args)...)};
+				onElementsAdded(1);
+				return element;
 			}
 
 			void remove(Wt::WWidget& widget);
 			void remove(std::size_t first, std::size_t last);
+			// keeps the first maxCount elements, the removed ones are requested again when scrolling down
+			void trim(std::size_t maxCount);
+			// trims the elements when the view leaves the given internal path, as hidden views would keep them forever
+			void trimWhenLeaving(const std::string& internalPath);
 
 			Wt::WWidget*				getWidget(std::size_t pos) const;
 			std::optional<std::size_t>	getIndexOf(Wt::WWidget& widget) const;
@@ -61,6 +69,9 @@ namespace UserInterface
 			void clear() override;
 			void displayLoadingIndicator();
 			void hideLoadingIndicator();
+			static std::size_t getMaxHiddenCount();
+			static void onElementsAdded(std::size_t count);
+			static void onElementsRemoved(std::size_t count);
 			void setHasMore(bool hasMore); // can be used to add elements afterwards
 
 			Wt::WContainerWidget*	_elements;
@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "VirtualList.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace UserInterface
+{
+    namespace
+    {
+        constexpr int scrollVisibilityMargin{ 1000 }; // px
+    }
+
+    VirtualList::VirtualList(IVirtualListModel& model, std::size_t pageSize, int estimatedRowHeight)
+        : _model{ model }
+        , _pageSize{ pageSize }
+        , _estimatedRowHeight{ estimatedRowHeight }
+    {
+        assert(_pageSize > 0 && _pageSize % 2 == 0);
+    }
+
+    void VirtualList::reset()
+    {
+        layoutPages(0);
+    }
+
+    void VirtualList::onRowsAppended()
+    {
+        // only the last page may have been partially filled
+        layoutPages(_pages.empty() ? 0 : _pages.size() - 1);
+    }
+
+    Wt::WWidget* VirtualList::getRenderedRow(std::size_t index) const
+    {
+        const std::size_t pageIndex{ index / _pageSize };
+        if (pageIndex >= _pages.size() || !_pages[pageIndex].rendered)
+            return nullptr;
+
+        const int indexInPage{ static_cast<int>(index % _pageSize) };
+        Wt::WContainerWidget* container{ _pages[pageIndex].container };
+        return indexInPage < container->count() ? container->widget(indexInPage) : nullptr;
+    }
+
+    std::optional<std::size_t> VirtualList::getIndexOf(Wt::WWidget& row) const
+    {
+        auto itPage{ std::find_if(std::cbegin(_pages), std::cend(_pages), [&](const Page& page) { return page.container == row.parent(); }) };
+        if (itPage == std::cend(_pages))
+            return std::nullopt;
+
+        const int index{ itPage->container->indexOf(&row) };
+        if (index < 0)
+            return std::nullopt;
+
+        return itPage->offset + static_cast<std::size_t>(index);
+    }
+
+    void VirtualList::layoutPages(std::size_t firstPageToRebuild)
+    {
+        _rowCount = _model.getRowCount();
+
+        const std::size_t pageCount{ (_rowCount + _pageSize - 1) / _pageSize };
+        while (_pages.size() > pageCount)
+        {
+            removeWidget(_pages.back().container);
+            _pages.pop_back();
+        }
+
+        while (_pages.size() < pageCount)
+        {
+            const std::size_t pageIndex{ _pages.size() };
+
+            Page& page{ _pages.emplace_back() };
+            page.container = addNew<Wt::WContainerWidget>();
+            page.container->addStyleClass("Lms-row-container");
+            page.container->setScrollVisibilityEnabled(true);
+            page.container->setScrollVisibilityMargin(scrollVisibilityMargin);
+            page.container->scrollVisibilityChanged().connect([this, pageIndex](bool visible)
+                {
+                    if (pageIndex >= _pages.size())
+                        return;
+
+                    Page& page{ _pages[pageIndex] };
+                    if (visible && !page.rendered)
+                        render(page);
+                    else if (!visible && page.rendered)
+                        unrender(page);
+                });
+        }
+
+        for (std::size_t pageIndex{ firstPageToRebuild }; pageIndex < _pages.size(); ++pageIndex)
+        {
+            Page& page{ _pages[pageIndex] };
+            page.offset = pageIndex * _pageSize;
+            page.count = std::min(_pageSize, _rowCount - page.offset);
+
+            if (page.rendered)
+                render(page);
+            else
+                unrender(page);
+        }
+
+        // always display the first rows to avoid waiting for a round trip
+        if (!_pages.empty() && !_pages.front().rendered)
+            render(_pages.front());
+    }
+
+    void VirtualList::render(Page& page)
+    {
+        page.container->clear();
+        page.container->setHeight(Wt::WLength::Auto);
+
+        for (std::unique_ptr<Wt::WWidget>& row : _model.createRows(page.offset, page.count))
+            page.container->addWidget(std::move(row));
+
+        page.rendered = true;
+    }
+
+    void VirtualList::unrender(Page& page)
+    {
+        page.container->clear();
+        page.container->setHeight(Wt::WLength{ static_cast<double>(page.count * _estimatedRowHeight), Wt::LengthUnit::Pixel });
+
+        page.rendered = false;
+    }
+} // namespace UserInterface
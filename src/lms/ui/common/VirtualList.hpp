@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include <Wt/WContainerWidget.h>
+
+namespace UserInterface
+{
+    // Source of the rows displayed in a VirtualList
+    class IVirtualListModel
+    {
+    public:
+        virtual ~IVirtualListModel() = default;
+
+        virtual std::size_t getRowCount() = 0;
+        // Creates the rows [offset, offset + count), may return less rows if the underlying data has changed
+        virtual std::vector<std::unique_ptr<Wt::WWidget>> createRows(std::size_t offset, std::size_t count) = 0;
+    };
+
+    // Rows are grouped in pages, only the pages close to the visible part of the screen are rendered
+    // The other pages are replaced by empty placeholders of the estimated same height, so that scrolling is preserved
+    class VirtualList final : public Wt::WContainerWidget
+    {
+    public:
+        // pageSize must be even to keep the striped background consistent between pages
+        VirtualList(IVirtualListModel& model, std::size_t pageSize, int estimatedRowHeight /* px */);
+
+        // Everything may have changed, the rendered pages are rendered again
+        void reset();
+        // New rows have been added at the end
+        void onRowsAppended();
+
+        std::size_t getCount() const { return _rowCount; }
+        Wt::WWidget* getRenderedRow(std::size_t index) const; // nullptr if its page is not rendered
+        std::optional<std::size_t> getIndexOf(Wt::WWidget& row) const;
+
+    private:
+        struct Page
+        {
+            Wt::WContainerWidget* container{};
+            std::size_t offset{};
+            std::size_t count{};
+            bool rendered{};
+        };
+
+        void layoutPages(std::size_t firstPageToRebuild);
+        void render(Page& page);
+        void unrender(Page& page);
+
+        IVirtualListModel& _model;
+        const std::size_t _pageSize;
+        const int _estimatedRowHeight;
+
+        std::size_t _rowCount{};
+        std::vector<Page> _pages;
+    };
+} // namespace UserInterface
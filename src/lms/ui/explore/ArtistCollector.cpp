@@ -33,19 +33,53 @@ namespace UserInterface
 {
     using namespace Database;
 
-    RangeResults<ArtistId> ArtistCollector::get(std::optional<Database::Range> requestedRange)
+    RangeResultsView<ArtistId> ArtistCollector::get(std::optional<Database::Range> requestedRange)
+    {
+        const Range range{ getActualRange(requestedRange) };
+
+        // the random results are kept by the collector, the other ones are shared with the cache
+        RangeResultsView<ArtistId> artists;
+        if (getMode() == Mode::Random)
+            artists = getRandomArtists(range);
+        else
+        {
+            _results = getCachedResults<ArtistId>(getCollectorKey(), range, [&] { return findArtists(range); });
+            artists = _results->getView();
+        }
+
+        if (getMode() == Mode::All)
+        {
+            _nextCursor.reset();
+            if (artists.nextCursor)
+                _nextCursor = NextCursor{ range.offset + artists.results.size(), *artists.nextCursor };
+        }
+
+        if (range.offset + range.size == getMaxCount())
+            artists.moreResults = false;
+
+        return artists;
+    }
+
+    std::string ArtistCollector::getCollectorKey() const
+    {
+        std::string key{ "artist" };
+        if (_linkType)
+            key += std::to_string(static_cast<int>(*_linkType));
+
+        return key;
+    }
+
+    RangeResults<ArtistId> ArtistCollector::findArtists(Range range)
     {
         Feedback::IFeedbackService& feedbackService{ *Service<Feedback::IFeedbackService>::get() };
         Scrobbling::IScrobblingService& scrobblingService{ *Service<Scrobbling::IScrobblingService>::get() };
 
-        const Range range{ getActualRange(requestedRange) };
-
         RangeResults<ArtistId> artists;
 
         switch (getMode())
         {
         case Mode::Random:
-            artists = getRandomArtists(range);
+            assert(false); // see getRandomArtists
             break;
 
         case Mode::Starred:
@@ -121,6 +155,8 @@ namespace UserInterface
             params.setLinkType(_linkType);
             params.setSortMethod(ArtistSortMethod::BySortName);
             params.setRange(range);
+            if (_nextCursor && _nextCursor->offset == range.offset)
+                params.setCursor(_nextCursor->cursor);
 
             {
                 auto transaction{ LmsApp->getDbSession().createReadTransaction() };
@@ -130,13 +166,10 @@ namespace UserInterface
         }
         }
 
-        if (range.offset + range.size == getMaxCount())
-            artists.moreResults = false;
-
         return artists;
     }
 
-    RangeResults<Database::ArtistId> ArtistCollector::getRandomArtists(Range range)
+    RangeResultsView<ArtistId> ArtistCollector::getRandomArtists(Range range)
     {
         assert(getMode() == Mode::Random);
 
@@ -154,6 +187,6 @@ namespace UserInterface
             }
         }
 
-        return _randomArtists->getSubRange(range);
+        return _randomArtists->getSubRangeView(range);
     }
 } // ns UserInterface
@@ -20,6 +20,7 @@
 #pragma once
 
 #include <optional>
+#include <string>
 
 #include "DatabaseCollectorBase.hpp"
 #include "database/ArtistId.hpp"
@@ -37,13 +38,25 @@ namespace UserInterface
 		public:
 			using DatabaseCollectorBase::DatabaseCollectorBase;
 
-			Database::RangeResults<Database::ArtistId>	get(std::optional<Database::Range> range = std::nullopt);
-			void reset() { _randomArtists.reset(); }
+			// the results are valid until the next call to get or reset
+			Database::RangeResultsView<Database::ArtistId>	get(std::optional<Database::Range> range = std::nullopt);
+			void reset() { _randomArtists.reset(); _results.reset(); _nextCursor.reset(); }
 			void setArtistLinkType(std::optional<Database::TrackArtistLinkType> linkType) { _linkType = linkType; }
 
 		private:
-			Database::RangeResults<Database::ArtistId>	getRandomArtists(Range range);
+			std::string getCollectorKey() const;
+			Database::RangeResults<Database::ArtistId>	findArtists(Range range);
+			Database::RangeResultsView<Database::ArtistId>	getRandomArtists(Range range);
 			std::optional<Database::RangeResults<Database::ArtistId>> _randomArtists;
+			CollectorResultCache::Results<Database::ArtistId> _results; // last non random results
+
+			// cursor to fetch the next batch of the "All" mode, to avoid having the database skip all the previous results
+			struct NextCursor
+			{
+				std::size_t offset;
+				Database::Cursor cursor;
+			};
+			std::optional<NextCursor> _nextCursor;
 			std::optional<Database::TrackArtistLinkType> _linkType;
 	};
 } // ns UserInterface
@@ -349,13 +349,14 @@ namespace UserInterface
         params.setNonRelease(true);
 
         const auto tracks{ Track::find(LmsApp->getDbSession(), params) };
+        const TrackListHelpers::TrackEntryBatch batch{ tracks.results };
         for (const Track::pointer& track : tracks.results)
         {
             // TODO handle this with range
             if (_trackContainer->getCount() == _tracksMaxCount)
                 break;
 
-            _trackContainer->add(TrackListHelpers::createEntry(track, _playQueueController, _filters));
+            _trackContainer->add(TrackListHelpers::createEntry(track, _playQueueController, _filters, batch));
 
             areTracksAdded = true;
         }
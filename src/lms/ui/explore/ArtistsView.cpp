@@ -74,13 +74,14 @@ Artists::Artists(Filters& filters)
 		refreshView(linkType);
 	});
 
-	LmsApp->getScannerEvents().scanComplete.connect(this, [this](const Scanner::ScanStats& stats)
+	LmsApp->getScannerEvents().scanComplete.connect(this, [this](const Scanner::ScanSummary& stats)
 	{
 		if (stats.nbChanges())
 			_linkType->setModel(ArtistListHelpers::createArtistLinkTypesModel());
 	});
 
 	_container = bindNew<InfiniteScrollingContainer>("artists", Wt::WString::tr("Lms.Explore.Artists.template.container"));
+	_container->trimWhenLeaving("/artists");
 	_container->onRequestElements.connect([this]
 	{
 		addSome();
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CollectorResultCache.hpp"
+
+namespace UserInterface
+{
+    CollectorResultCache::CollectorResultCache(std::size_t maxEntryCount)
+        : _maxEntryCount{ maxEntryCount }
+    {
+    }
+
+    std::optional<CollectorResultCache::Entry> CollectorResultCache::getEntry(std::uint64_t writeGeneration, const std::string& key)
+    {
+        std::scoped_lock lock{ _mutex };
+
+        clearIfOutdated(writeGeneration);
+        if (writeGeneration != _writeGeneration)
+            return std::nullopt;
+
+        auto it{ _entriesByKey.find(key) };
+        if (it == std::cend(_entriesByKey))
+            return std::nullopt;
+
+        _entries.splice(std::begin(_entries), _entries, it->second);
+        return it->second->second;
+    }
+
+    void CollectorResultCache::putEntry(std::uint64_t writeGeneration, const std::string& key, Entry entry)
+    {
+        std::scoped_lock lock{ _mutex };
+
+        clearIfOutdated(writeGeneration);
+        if (writeGeneration != _writeGeneration) // computed before a write, results may already be outdated
+            return;
+
+        if (auto it{ _entriesByKey.find(key) }; it != std::cend(_entriesByKey))
+        {
+            it->second->second = std::move(entry);
+            _entries.splice(std::begin(_entries), _entries, it->second);
+            return;
+        }
+
+        _entries.emplace_front(key, std::move(entry));
+        _entriesByKey.emplace(key, std::begin(_entries));
+
+        while (_entries.size() > _maxEntryCount)
+        {
+            _entriesByKey.erase(_entries.back().first);
+            _entries.pop_back();
+        }
+    }
+
+    void CollectorResultCache::clearIfOutdated(std::uint64_t writeGeneration)
+    {
+        if (writeGeneration <= _writeGeneration)
+            return;
+
+        _writeGeneration = writeGeneration;
+        _entries.clear();
+        _entriesByKey.clear();
+    }
+} // namespace UserInterface
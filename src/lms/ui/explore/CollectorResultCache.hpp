@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <variant>
+
+#include "database/ArtistId.hpp"
+#include "database/ReleaseId.hpp"
+#include "database/TrackId.hpp"
+#include "database/Types.hpp"
+
+namespace UserInterface
+{
+    // Collector results, shared by all the sessions
+    // Entries are tagged with the database write generation they have been computed with: everything is dropped as soon as the database is written
+    // Results are immutable once cached, they are handed out without being copied
+    class CollectorResultCache
+    {
+    public:
+        CollectorResultCache(std::size_t maxEntryCount);
+
+        CollectorResultCache(const CollectorResultCache&) = delete;
+        CollectorResultCache& operator=(const CollectorResultCache&) = delete;
+
+        template <typename IdType>
+        using Results = std::shared_ptr<const Database::RangeResults<IdType>>;
+
+        // null if not found
+        template <typename IdType>
+        Results<IdType> get(std::uint64_t writeGeneration, const std::string& key)
+        {
+            std::optional<Entry> entry{ getEntry(writeGeneration, key) };
+            if (!entry)
+                return nullptr;
+
+            if (auto* results{ std::get_if<Results<IdType>>(&*entry) })
+                return std::move(*results);
+
+            return nullptr;
+        }
+
+        // writeGeneration must have been read before querying the results
+        template <typename IdType>
+        void put(std::uint64_t writeGeneration, const std::string& key, Results<IdType> results)
+        {
+            putEntry(writeGeneration, key, std::move(results));
+        }
+
+    private:
+        using Entry = std::variant<Results<Database::ArtistId>, Results<Database::ReleaseId>, Results<Database::TrackId>>;
+
+        std::optional<Entry> getEntry(std::uint64_t writeGeneration, const std::string& key);
+        void putEntry(std::uint64_t writeGeneration, const std::string& key, Entry entry);
+        void clearIfOutdated(std::uint64_t writeGeneration);
+
+        const std::size_t _maxEntryCount;
+
+        std::mutex _mutex;
+        std::uint64_t _writeGeneration{};
+        using EntryList = std::list<std::pair<std::string, Entry>>; // most recently used first
+        EntryList _entries;
+        std::unordered_map<std::string, EntryList::iterator> _entriesByKey;
+    };
+} // namespace UserInterface
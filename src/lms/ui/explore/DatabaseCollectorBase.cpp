@@ -19,7 +19,10 @@
 
 #include "DatabaseCollectorBase.hpp"
 
+#include "database/Db.hpp"
 #include "utils/String.hpp"
+#include "Filters.hpp"
+#include "LmsApplication.hpp"
 
 namespace UserInterface
 {
@@ -62,5 +65,56 @@ namespace UserInterface
         _searchKeywords = StringUtils::splitString(_searchText, ' ');
     }
 
+    std::string DatabaseCollectorBase::computeCacheKey(std::string_view collectorKey, Range range) const
+    {
+        std::string key{ collectorKey };
+
+        key += '/';
+        key += std::to_string(static_cast<int>(_mode));
+        key += '/';
+        key += std::to_string(range.offset);
+        key += '-';
+        key += std::to_string(range.size);
+
+        switch (_mode)
+        {
+        case Mode::Starred:
+        case Mode::RecentlyPlayed:
+        case Mode::MostPlayed:
+            key += "/u";
+            key += LmsApp->getUserId().toString();
+            break;
+
+        case Mode::Search:
+            key += "/s";
+            key += _searchText;
+            break;
+
+        case Mode::Random:
+        case Mode::RecentlyAdded:
+        case Mode::All:
+            break;
+        }
+
+        key += "/c";
+        for (const Database::ClusterId clusterId : _filters.getClusterIds())
+        {
+            key += clusterId.toString();
+            key += ',';
+        }
+
+        return key;
+    }
+
+    std::uint64_t DatabaseCollectorBase::getWriteGeneration()
+    {
+        return LmsApp->getDb().getWriteGeneration();
+    }
+
+    CollectorResultCache& DatabaseCollectorBase::getCollectorResultCache()
+    {
+        return LmsApp->getCollectorResultCache();
+    }
+
 } // ns UserInterface
 
@@ -19,6 +19,9 @@
 
 #pragma once
 
+#include <cassert>
+#include <cstdint>
+#include <memory>
 #include <optional>
 #include <string>
 #include <string_view>
@@ -26,6 +29,7 @@
 #include <vector>
 
 #include "database/Types.hpp"
+#include "CollectorResultCache.hpp"
 
 namespace UserInterface
 {
@@ -61,7 +65,30 @@ namespace UserInterface
         Filters&    getFilters() { return _filters; }
         const std::vector<std::string_view>& getSearchKeywords() const { return _searchKeywords; }
 
+        // Results are shared with the other sessions, not for the random mode whose results must stay specific to the collector
+        // collectorKey must identify the collector and the parameters it adds to the query
+        template <typename IdType, typename QueryFunc>
+        CollectorResultCache::Results<IdType> getCachedResults(std::string_view collectorKey, Range range, QueryFunc queryFunc)
+        {
+            assert(_mode != Mode::Random);
+
+            const std::string key{ computeCacheKey(collectorKey, range) };
+            const std::uint64_t writeGeneration{ getWriteGeneration() }; // must be read before querying
+            CollectorResultCache& cache{ getCollectorResultCache() };
+
+            if (CollectorResultCache::Results<IdType> results{ cache.get<IdType>(writeGeneration, key) })
+                return results;
+
+            auto results{ std::make_shared<const Database::RangeResults<IdType>>(queryFunc()) };
+            cache.put<IdType>(writeGeneration, key, results);
+            return results;
+        }
+
     private:
+        std::string computeCacheKey(std::string_view collectorKey, Range range) const;
+        static std::uint64_t getWriteGeneration();
+        static CollectorResultCache& getCollectorResultCache();
+
         Filters& _filters;
         std::string _searchText;
         std::vector<std::string_view> _searchKeywords;
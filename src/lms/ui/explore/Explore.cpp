@@ -19,9 +19,17 @@
 
 #include "Explore.hpp"
 
+#include <algorithm>
+#include <cassert>
+#include <map>
+#include <optional>
+
 #include <Wt/WApplication.h>
+#include <Wt/WContainerWidget.h>
 #include <Wt/WStackedWidget.h>
 
+#include "utils/IMetricsRegistry.hpp"
+#include "utils/Service.hpp"
 #include "ArtistsView.hpp"
 #include "ArtistView.hpp"
 #include "Filters.hpp"
@@ -36,22 +44,25 @@ namespace UserInterface {
 
 	namespace {
 
-		void
-		handleContentsPathChange(Wt::WStackedWidget* stack)
+		// same order as the placeholders in the stack
+		enum Idx
 		{
-			enum Idx
-			{
-				IdxArtists = 0,
-				IdxArtist,
-				IdxTrackLists,
-				IdxTrackList,
-				IdxReleases,
-				IdxRelease,
-				IdxSearch,
-				IdxTracks,
-			};
-
-			static const std::map<std::string, int> indexes =
+			IdxArtists = 0,
+			IdxArtist,
+			IdxTrackLists,
+			IdxTrackList,
+			IdxReleases,
+			IdxRelease,
+			IdxSearch,
+			IdxTracks,
+
+			IdxCount,
+		};
+
+		std::optional<Idx>
+		getIndexFromContentsPath()
+		{
+			static const std::map<std::string, Idx> indexes =
 			{
 				{ "/artists",		IdxArtists },
 				{ "/artist",		IdxArtist },
@@ -66,63 +77,140 @@ namespace UserInterface {
 			for (const auto& index : indexes)
 			{
 				if (wApp->internalPathMatches(index.first))
-				{
-					stack->setCurrentIndex(index.second);
-					return;
-				}
+					return index.second;
 			}
+
+			return std::nullopt;
+		}
+
+		Metrics::Gauge*
+		getViewCountGauge()
+		{
+			static Metrics::Gauge* gauge {[]() -> Metrics::Gauge*
+			{
+				if (Metrics::IRegistry* registry {Service<Metrics::IRegistry>::get()})
+					return &registry->getGauge("lms_ui_explore_views", "Explore views instantiated by all the web UI sessions");
+				return nullptr;
+			}()};
+
+			return gauge;
 		}
 
 	} // namespace
 
 	Explore::Explore(Filters& filters, PlayQueue& playQueue)
 		: Wt::WTemplate {Wt::WString::tr("Lms.Explore.template")}
+	, _filters {filters}
 	, _playQueueController {filters, playQueue}
 	{
 		addFunction("tr", &Functions::tr);
 
 		// Contents
-		Wt::WStackedWidget* contentsStack {bindNew<Wt::WStackedWidget>("contents")};
-		contentsStack->setOverflow(Wt::Overflow::Visible); // wt makes it hidden by default
+		_contentsStack = bindNew<Wt::WStackedWidget>("contents");
+		_contentsStack->setOverflow(Wt::Overflow::Visible); // wt makes it hidden by default
 
-		// same order as enum Idx
-		auto artists = std::make_unique<Artists>(filters);
-		contentsStack->addWidget(std::move(artists));
+		// Views are only created when first displayed, most sessions only visit a few of them
+		for (std::size_t i {}; i < IdxCount; ++i)
+			_contentsStack->addNew<Wt::WContainerWidget>();
+		_views.resize(IdxCount);
 
-		auto artist = std::make_unique<Artist>(filters, _playQueueController);
-		contentsStack->addWidget(std::move(artist));
+		wApp->internalPathChanged().connect(this, [this]
+		{
+			handleContentsPathChange();
+		});
 
-		auto trackLists {std::make_unique<TrackLists>(filters)};
-		auto trackList {std::make_unique<TrackList>(filters, _playQueueController)};
-		trackList->trackListDeleted.connect(trackLists.get(), &TrackLists::onTrackListDeleted);
-		contentsStack->addWidget(std::move(trackLists));
-		contentsStack->addWidget(std::move(trackList));
+		handleContentsPathChange();
+	}
 
-		auto releases = std::make_unique<Releases>(filters, _playQueueController);
-		contentsStack->addWidget(std::move(releases));
+	Explore::~Explore()
+	{
+		if (Metrics::Gauge* gauge {getViewCountGauge()})
+			gauge->dec(std::count_if(std::cbegin(_views), std::cend(_views), [](const Wt::WWidget* view) { return view != nullptr; }));
+	}
 
-		auto release = std::make_unique<Release>(filters, _playQueueController);
-		contentsStack->addWidget(std::move(release));
+	void
+	Explore::search(const Wt::WString& searchText)
+	{
+		getOrCreateView<SearchView>(IdxSearch).refreshView(searchText);
+	}
+
+	void
+	Explore::handleContentsPathChange()
+	{
+		const std::optional<Idx> index {getIndexFromContentsPath()};
+		if (!index)
+			return;
 
-		auto search = std::make_unique<SearchView>(filters, _playQueueController);
-		_search = search.get();
-		contentsStack->addWidget(std::move(search));
+		getOrCreateView(*index);
+		_contentsStack->setCurrentIndex(*index);
+	}
 
-		auto tracks = std::make_unique<Tracks>(filters, _playQueueController);
-		contentsStack->addWidget(std::move(tracks));
+	Wt::WWidget&
+	Explore::getOrCreateView(std::size_t index)
+	{
+		if (_views[index])
+			return *_views[index];
 
-		wApp->internalPathChanged().connect(this, [=]
+		std::unique_ptr<Wt::WWidget> view;
+		switch (index)
 		{
-			handleContentsPathChange(contentsStack);
-		});
+			case IdxArtists:
+				view = std::make_unique<Artists>(_filters);
+				break;
 
-		handleContentsPathChange(contentsStack);
-	}
+			case IdxArtist:
+				view = std::make_unique<Artist>(_filters, _playQueueController);
+				break;
 
-	void
-	Explore::search(const Wt::WString& searchText)
-	{
-		_search->refreshView(searchText);
+			case IdxTrackLists:
+			{
+				auto trackLists {std::make_unique<TrackLists>(_filters)};
+				if (auto* trackList {static_cast<TrackList*>(_views[IdxTrackList])})
+					trackList->trackListDeleted.connect(trackLists.get(), &TrackLists::onTrackListDeleted);
+				view = std::move(trackLists);
+				break;
+			}
+
+			case IdxTrackList:
+			{
+				auto trackList {std::make_unique<TrackList>(_filters, _playQueueController)};
+				if (auto* trackLists {static_cast<TrackLists*>(_views[IdxTrackLists])})
+					trackList->trackListDeleted.connect(trackLists, &TrackLists::onTrackListDeleted);
+				view = std::move(trackList);
+				break;
+			}
+
+			case IdxReleases:
+				view = std::make_unique<Releases>(_filters, _playQueueController);
+				break;
+
+			case IdxRelease:
+				view = std::make_unique<Release>(_filters, _playQueueController);
+				break;
+
+			case IdxSearch:
+				view = std::make_unique<SearchView>(_filters, _playQueueController);
+				break;
+
+			case IdxTracks:
+				view = std::make_unique<Tracks>(_filters, _playQueueController);
+				break;
+		}
+
+		assert(view);
+		_views[index] = view.get();
+
+		// replace the placeholder, keeping the current index
+		const int currentIndex {_contentsStack->currentIndex()};
+		_contentsStack->removeWidget(_contentsStack->widget(index));
+		_contentsStack->insertWidget(index, std::move(view));
+		if (currentIndex >= 0)
+			_contentsStack->setCurrentIndex(currentIndex);
+
+		if (Metrics::Gauge* gauge {getViewCountGauge()})
+			gauge->inc();
+
+		return *_views[index];
 	}
 
 } // namespace UserInterface
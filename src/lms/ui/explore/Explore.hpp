@@ -19,26 +19,44 @@
 
 #pragma once
 
+#include <vector>
+
 #include <Wt/WTemplate.h>
 #include "PlayQueueController.hpp"
 
+namespace Wt
+{
+	class WStackedWidget;
+}
+
 namespace UserInterface
 {
 	class Filters;
-	class SearchView;
 	class PlayQueue;
 
 	class Explore : public Wt::WTemplate
 	{
 		public:
 			Explore(Filters& filters, PlayQueue& playQueue);
+			~Explore();
 
 			void search(const Wt::WString& searchText);
 			PlayQueueController& getPlayQueueController() { return _playQueueController; }
 
 		private:
+			void handleContentsPathChange();
+			Wt::WWidget& getOrCreateView(std::size_t index);
+
+			template<typename View>
+			View& getOrCreateView(std::size_t index)
+			{
+				return static_cast<View&>(getOrCreateView(index));
+			}
+
+			Filters& _filters;
 			PlayQueueController _playQueueController;
-			SearchView* _search {};
+			Wt::WStackedWidget* _contentsStack {};
+			std::vector<Wt::WWidget*> _views; // indexed as the stack, null until displayed
 	};
 } // namespace UserInterface
 
@@ -32,19 +32,44 @@ namespace UserInterface
 {
     using namespace Database;
 
-    RangeResults<ReleaseId> ReleaseCollector::get(std::optional<Database::Range> requestedRange)
+    RangeResultsView<ReleaseId> ReleaseCollector::get(std::optional<Database::Range> requestedRange)
+    {
+        const Range range{ getActualRange(requestedRange) };
+
+        // the random results are kept by the collector, the other ones are shared with the cache
+        RangeResultsView<ReleaseId> releases;
+        if (getMode() == Mode::Random)
+            releases = getRandomReleases(range);
+        else
+        {
+            _results = getCachedResults<ReleaseId>("release", range, [&] { return findReleases(range); });
+            releases = _results->getView();
+        }
+
+        if (getMode() == Mode::All)
+        {
+            _nextCursor.reset();
+            if (releases.nextCursor)
+                _nextCursor = NextCursor{ range.offset + releases.results.size(), *releases.nextCursor };
+        }
+
+        if (range.offset + range.size == getMaxCount())
+            releases.moreResults = false;
+
+        return releases;
+    }
+
+    RangeResults<ReleaseId> ReleaseCollector::findReleases(Range range)
     {
         Feedback::IFeedbackService& feedbackService{ *Service<Feedback::IFeedbackService>::get() };
         Scrobbling::IScrobblingService& scrobblingService{ *Service<Scrobbling::IScrobblingService>::get() };
 
-        const Range range{ getActualRange(requestedRange) };
-
         RangeResults<ReleaseId> releases;
 
         switch (getMode())
         {
         case Mode::Random:
-            releases = getRandomReleases(range);
+            assert(false); // see getRandomReleases
             break;
 
         case Mode::Starred:
@@ -113,6 +138,8 @@ namespace UserInterface
             params.setClusters(getFilters().getClusterIds());
             params.setSortMethod(ReleaseSortMethod::Name);
             params.setRange(range);
+            if (_nextCursor && _nextCursor->offset == range.offset)
+                params.setCursor(_nextCursor->cursor);
 
             {
                 auto transaction{ LmsApp->getDbSession().createReadTransaction() };
@@ -122,13 +149,10 @@ namespace UserInterface
         }
         }
 
-        if (range.offset + range.size == getMaxCount())
-            releases.moreResults = false;
-
         return releases;
     }
 
-    RangeResults<ReleaseId> ReleaseCollector::getRandomReleases(Range range)
+    RangeResultsView<ReleaseId> ReleaseCollector::getRandomReleases(Range range)
     {
         assert(getMode() == Mode::Random);
 
@@ -145,7 +169,7 @@ namespace UserInterface
             }
         }
 
-        return _randomReleases->getSubRange(range);
+        return _randomReleases->getSubRangeView(range);
     }
 
 } // ns UserInterface
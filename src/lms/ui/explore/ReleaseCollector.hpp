@@ -39,12 +39,23 @@ namespace UserInterface
 		public:
 			using DatabaseCollectorBase::DatabaseCollectorBase;
 
-			Database::RangeResults<Database::ReleaseId>	get(std::optional<Database::Range> range = std::nullopt);
-			void reset() { _randomReleases.reset(); }
+			// the results are valid until the next call to get or reset
+			Database::RangeResultsView<Database::ReleaseId>	get(std::optional<Database::Range> range = std::nullopt);
+			void reset() { _randomReleases.reset(); _results.reset(); _nextCursor.reset(); }
 
 		private:
-			Database::RangeResults<Database::ReleaseId> getRandomReleases(Range range);
+			Database::RangeResults<Database::ReleaseId>	findReleases(Range range);
+			Database::RangeResultsView<Database::ReleaseId>	getRandomReleases(Range range);
 			std::optional<Database::RangeResults<Database::ReleaseId>> _randomReleases;
+			CollectorResultCache::Results<Database::ReleaseId> _results; // last non random results
+
+			// cursor to fetch the next batch of the "All" mode, to avoid having the database skip all the previous results
+			struct NextCursor
+			{
+				std::size_t offset;
+				Database::Cursor cursor;
+			};
+			std::optional<NextCursor> _nextCursor;
 	};
 } // ns UserInterface
 
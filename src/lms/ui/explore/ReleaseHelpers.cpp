@@ -24,8 +24,10 @@
 #include <Wt/WText.h>
 
 #include "database/Artist.hpp"
+#include "database/DirectReads.hpp"
 #include "database/Release.hpp"
 
+#include "LmsApplication.hpp"
 #include "Utils.hpp"
 
 using namespace Database;
@@ -57,7 +59,8 @@ namespace UserInterface::ReleaseListHelpers
 
             if (showYear)
             {
-                Wt::WString year{ ReleaseHelpers::buildReleaseYearString(release->getYear(), release->getOriginalYear()) };
+                const DirectReads::ReleaseYears years{ DirectReads::getReleaseYears(LmsApp->getDbSession(), release->getId()) };
+                Wt::WString year{ ReleaseHelpers::buildReleaseYearString(years.year, years.originalYear) };
                 if (!year.empty())
                 {
                     entry->setCondition("if-has-year", true);
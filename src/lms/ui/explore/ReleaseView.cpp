@@ -27,6 +27,7 @@
 #include "av/IAudioFile.hpp"
 #include "database/Artist.hpp"
 #include "database/Cluster.hpp"
+#include "database/DirectReads.hpp"
 #include "database/Release.hpp"
 #include "database/ScanSettings.hpp"
 #include "database/Session.hpp"
@@ -247,7 +248,8 @@ namespace UserInterface
 
         bindString("name", Wt::WString::fromUTF8(std::string{ release->getName() }), Wt::TextFormat::Plain);
 
-        Wt::WString year{ ReleaseHelpers::buildReleaseYearString(release->getYear(), release->getOriginalYear()) };
+        const DirectReads::ReleaseYears years{ DirectReads::getReleaseYears(LmsApp->getDbSession(), release->getId()) };
+        Wt::WString year{ ReleaseHelpers::buildReleaseYearString(years.year, years.originalYear) };
         if (!year.empty())
         {
             setCondition("if-has-year", true);
@@ -338,6 +340,14 @@ namespace UserInterface
         const std::size_t discCount{ release->getDiscCount() };
         const bool isReleaseMultiDisc{ (discCount > 1) || (totalDisc && *totalDisc > 1) };
 
+        // Disc subtitles are not part of the track rows (see Database::Track::ExtraInfo): fetch them all at once
+        std::map<std::size_t, std::string> discSubtitles;
+        if (isReleaseMultiDisc)
+        {
+            for (const Database::DiscInfo& discInfo : release->getDiscs())
+                discSubtitles.emplace(discInfo.position, discInfo.name);
+        }
+
         // Expect to be called in asc order
         std::map<std::size_t, Wt::WContainerWidget*> trackContainers;
         auto getOrAddDiscContainer = [&, releaseId = _releaseId](std::size_t discNumber, const std::string& discSubtitle) -> Wt::WContainerWidget*
@@ -404,100 +414,108 @@ namespace UserInterface
         params.setSortMethod(Database::TrackSortMethod::Release);
         params.setClusters(_filters.getClusterIds());
 
-        Database::Track::find(LmsApp->getDbSession(), params, [&](const Database::Track::pointer& track)
-            {
-                const Database::TrackId trackId{ track->getId() };
-                const auto discNumber{ track->getDiscNumber() };
+        // artist and starred lookups are done for all the tracks at once
+        const std::vector<Database::Track::pointer> tracks{ Database::Track::find(LmsApp->getDbSession(), params).results };
+        const TrackListHelpers::TrackEntryBatch batch{ tracks };
 
-                Wt::WContainerWidget* container;
-                if (isReleaseMultiDisc && discNumber)
-                    container = getOrAddDiscContainer(*discNumber, track->getDiscSubtitle());
-                else
-                    container = getOrAddNoDiscContainer();
+        for (const Database::Track::pointer& track : tracks)
+        {
+            const Database::TrackId trackId{ track->getId() };
+            const TrackListHelpers::TrackEntryBatch::TrackData& trackData{ batch.getTrackData(trackId) };
+            const auto discNumber{ track->getDiscNumber() };
 
-                Template* entry{ container->addNew<Template>(Wt::WString::tr("Lms.Explore.Release.template.entry")) };
-                entry->addFunction("id", &Wt::WTemplate::Functions::id);
+            Wt::WContainerWidget* container;
+            if (isReleaseMultiDisc && discNumber)
+            {
+                const auto itSubtitle{ discSubtitles.find(*discNumber) };
+                container = getOrAddDiscContainer(*discNumber, itSubtitle != std::cend(discSubtitles) ? itSubtitle->second : "");
+            }
+            else
+                container = getOrAddNoDiscContainer();
 
-                entry->bindString("name", Wt::WString::fromUTF8(track->getName()), Wt::TextFormat::Plain);
+            Template* entry{ container->addNew<Template>(Wt::WString::tr("Lms.Explore.Release.template.entry")) };
+            entry->addFunction("id", &Wt::WTemplate::Functions::id);
 
-                const auto artists{ track->getArtistIds({TrackArtistLinkType::Artist}) };
-                // TODO: display artist if it is single and not the one of the release (variousArtists is false in that case)
-                if (variousArtists && !artists.empty())
-                {
-                    entry->setCondition("if-has-artists", true);
-                    entry->bindWidget("artists", Utils::createArtistDisplayNameWithAnchors(track->getArtistDisplayName(), artists));
-                    entry->bindWidget("artists-md", Utils::createArtistDisplayNameWithAnchors(track->getArtistDisplayName(), artists));
-                }
+            entry->bindString("name", Wt::WString::fromUTF8(track->getName()), Wt::TextFormat::Plain);
 
-                auto trackNumber{ track->getTrackNumber() };
-                if (trackNumber)
-                {
-                    entry->setCondition("if-has-track-number", true);
-                    entry->bindInt("track-number", *trackNumber);
-                }
+            const std::vector<ArtistId>& artists{ trackData.artists };
+            // TODO: display artist if it is single and not the one of the release (variousArtists is false in that case)
+            if (variousArtists && !artists.empty())
+            {
+                entry->setCondition("if-has-artists", true);
+                entry->bindWidget("artists", Utils::createArtistDisplayNameWithAnchors(track->getArtistDisplayName(), artists));
+                entry->bindWidget("artists-md", Utils::createArtistDisplayNameWithAnchors(track->getArtistDisplayName(), artists));
+            }
 
-                Wt::WPushButton* playBtn{ entry->bindNew<Wt::WPushButton>("play-btn", Wt::WString::tr("Lms.template.play-btn"), Wt::TextFormat::XHTML) };
-                playBtn->clicked().connect([this, trackId]
-                    {
-                        _playQueueController.playTrackInRelease(trackId);
-                    });
+            auto trackNumber{ track->getTrackNumber() };
+            if (trackNumber)
+            {
+                entry->setCondition("if-has-track-number", true);
+                entry->bindInt("track-number", *trackNumber);
+            }
 
+            Wt::WPushButton* playBtn{ entry->bindNew<Wt::WPushButton>("play-btn", Wt::WString::tr("Lms.template.play-btn"), Wt::TextFormat::XHTML) };
+            playBtn->clicked().connect([this, trackId]
                 {
-                    entry->bindNew<Wt::WPushButton>("more-btn", Wt::WString::tr("Lms.template.more-btn"), Wt::TextFormat::XHTML);
-                    entry->bindNew<Wt::WPushButton>("play", Wt::WString::tr("Lms.Explore.play"))
-                        ->clicked().connect([this, trackId]
-                            {
-                                _playQueueController.playTrackInRelease(trackId);
-                            });
-                    entry->bindNew<Wt::WPushButton>("play-next", Wt::WString::tr("Lms.Explore.play-next"))
-                        ->clicked().connect([this, trackId]
-                            {
-                                _playQueueController.processCommand(PlayQueueController::Command::PlayNext, { trackId });
-                            });
-                    entry->bindNew<Wt::WPushButton>("play-last", Wt::WString::tr("Lms.Explore.play-last"))
-                        ->clicked().connect([this, trackId]
-                            {
-                                _playQueueController.processCommand(PlayQueueController::Command::PlayOrAddLast, { trackId });
-                            });
-
-                    auto isStarred{ [=] { return Service<Feedback::IFeedbackService>::get()->isStarred(LmsApp->getUserId(), trackId); } };
-
-                    Wt::WPushButton* starBtn{ entry->bindNew<Wt::WPushButton>("star", Wt::WString::tr(isStarred() ? "Lms.Explore.unstar" : "Lms.Explore.star")) };
-                    starBtn->clicked().connect([=, this]
+                    _playQueueController.playTrackInRelease(trackId);
+                });
+
+            {
+                entry->bindNew<Wt::WPushButton>("more-btn", Wt::WString::tr("Lms.template.more-btn"), Wt::TextFormat::XHTML);
+                entry->bindNew<Wt::WPushButton>("play", Wt::WString::tr("Lms.Explore.play"))
+                    ->clicked().connect([this, trackId]
                         {
-                            if (isStarred())
-                            {
-                                Service<Feedback::IFeedbackService>::get()->unstar(LmsApp->getUserId(), trackId);
-                                starBtn->setText(Wt::WString::tr("Lms.Explore.star"));
-                            }
-                            else
-                            {
-                                Service<Feedback::IFeedbackService>::get()->star(LmsApp->getUserId(), trackId);
-                                starBtn->setText(Wt::WString::tr("Lms.Explore.unstar"));
-                            }
+                            _playQueueController.playTrackInRelease(trackId);
+                        });
+                entry->bindNew<Wt::WPushButton>("play-next", Wt::WString::tr("Lms.Explore.play-next"))
+                    ->clicked().connect([this, trackId]
+                        {
+                            _playQueueController.processCommand(PlayQueueController::Command::PlayNext, { trackId });
+                        });
+                entry->bindNew<Wt::WPushButton>("play-last", Wt::WString::tr("Lms.Explore.play-last"))
+                    ->clicked().connect([this, trackId]
+                        {
+                            _playQueueController.processCommand(PlayQueueController::Command::PlayOrAddLast, { trackId });
                         });
 
-                    entry->bindNew<Wt::WPushButton>("download", Wt::WString::tr("Lms.Explore.download"))
-                        ->setLink(Wt::WLink{ std::make_unique<DownloadTrackResource>(trackId) });
-
-                    entry->bindNew<Wt::WPushButton>("track-info", Wt::WString::tr("Lms.Explore.track-info"))
-                        ->clicked().connect([this, trackId] { TrackListHelpers::showTrackInfoModal(trackId, _filters); });
-                }
-
-                entry->bindString("duration", Utils::durationToString(track->getDuration()), Wt::TextFormat::Plain);
+                auto isStarred{ [=] { return Service<Feedback::IFeedbackService>::get()->isStarred(LmsApp->getUserId(), trackId); } };
 
-                LmsApp->getMediaPlayer().trackLoaded.connect(entry, [=](TrackId loadedTrackId)
+                Wt::WPushButton* starBtn{ entry->bindNew<Wt::WPushButton>("star", Wt::WString::tr(trackData.starred ? "Lms.Explore.unstar" : "Lms.Explore.star")) };
+                starBtn->clicked().connect([=, this]
                     {
-                        entry->toggleStyleClass("Lms-entry-playing", loadedTrackId == trackId);
+                        if (isStarred())
+                        {
+                            Service<Feedback::IFeedbackService>::get()->unstar(LmsApp->getUserId(), trackId);
+                            starBtn->setText(Wt::WString::tr("Lms.Explore.star"));
+                        }
+                        else
+                        {
+                            Service<Feedback::IFeedbackService>::get()->star(LmsApp->getUserId(), trackId);
+                            starBtn->setText(Wt::WString::tr("Lms.Explore.unstar"));
+                        }
                     });
 
-                if (auto trackIdLoaded{ LmsApp->getMediaPlayer().getTrackLoaded() })
+                entry->bindNew<Wt::WPushButton>("download", Wt::WString::tr("Lms.Explore.download"))
+                    ->setLink(Wt::WLink{ std::make_unique<DownloadTrackResource>(trackId) });
+
+                entry->bindNew<Wt::WPushButton>("track-info", Wt::WString::tr("Lms.Explore.track-info"))
+                    ->clicked().connect([this, trackId] { TrackListHelpers::showTrackInfoModal(trackId, _filters); });
+            }
+
+            entry->bindString("duration", Utils::durationToString(track->getDuration()), Wt::TextFormat::Plain);
+
+            LmsApp->getMediaPlayer().trackLoaded.connect(entry, [=](TrackId loadedTrackId)
                 {
-                    entry->toggleStyleClass("Lms-entry-playing", *trackIdLoaded == trackId);
-                }
-                else
-                    entry->removeStyleClass("Lms-entry-playing");
-            });
+                    entry->toggleStyleClass("Lms-entry-playing", loadedTrackId == trackId);
+                });
+
+            if (auto trackIdLoaded{ LmsApp->getMediaPlayer().getTrackLoaded() })
+            {
+                entry->toggleStyleClass("Lms-entry-playing", *trackIdLoaded == trackId);
+            }
+            else
+                entry->removeStyleClass("Lms-entry-playing");
+        }
     }
 
     void Release::refreshReleaseArtists(const Database::Release::pointer& release)
@@ -92,6 +92,7 @@ namespace UserInterface
                 });
 
         _container = bindNew<InfiniteScrollingContainer>("releases", Wt::WString::tr("Lms.Explore.Releases.template.container"));
+        _container->trimWhenLeaving("/releases");
         _container->onRequestElements.connect([this]
             {
                 addSome();
@@ -134,8 +135,8 @@ namespace UserInterface
 
     std::vector<ReleaseId> Releases::getAllReleases()
     {
-        RangeResults<ReleaseId> releaseIds{ _releaseCollector.get() };
-        return std::move(releaseIds.results);
+        const RangeResultsView<ReleaseId> releaseIds{ _releaseCollector.get() };
+        return std::vector<ReleaseId>(std::cbegin(releaseIds.results), std::cend(releaseIds.results));
     }
 
 } // namespace UserInterface
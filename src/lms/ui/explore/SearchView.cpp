@@ -51,6 +51,7 @@ namespace UserInterface
 
         // releases
         _releases = _stack->addNew<InfiniteScrollingContainer>(Wt::WString::tr("Lms.Explore.Releases.template.container"));
+        _releases->trimWhenLeaving("/search");
         _releases->onRequestElements.connect([this] { addSomeReleases(); });
 
         // artists
@@ -66,11 +67,13 @@ namespace UserInterface
                 });
 
             _artists = artistResults->bindNew<InfiniteScrollingContainer>("artists", Wt::WString::tr("Lms.Explore.Artists.template.container"));
+            _artists->trimWhenLeaving("/search");
             _artists->onRequestElements.connect([this] { addSomeArtists(); });
         }
 
         // Tracks
         _tracks = _stack->addNew<InfiniteScrollingContainer>();
+        _tracks->trimWhenLeaving("/search");
         _tracks->onRequestElements.connect([this] { addSomeTracks(); });
 
         // Menu
@@ -101,7 +104,7 @@ namespace UserInterface
                 refreshView();
             });
 
-        LmsApp->getScannerEvents().scanComplete.connect(this, [this](const Scanner::ScanStats& stats)
+        LmsApp->getScannerEvents().scanComplete.connect(this, [this](const Scanner::ScanSummary& stats)
             {
                 if (stats.nbChanges())
                     _artistLinkType->setModel(ArtistListHelpers::createArtistLinkTypesModel());
@@ -148,7 +151,7 @@ namespace UserInterface
         using namespace Database;
 
         const Range range{ _artists->getCount(), getBatchSize(Mode::Artist) };
-        const RangeResults<ArtistId> artistIds{ _artistCollector.get(range) };
+        const RangeResultsView<ArtistId> artistIds{ _artistCollector.get(range) };
         {
             auto transaction{ LmsApp->getDbSession().createReadTransaction() };
 
@@ -166,7 +169,7 @@ namespace UserInterface
         using namespace Database;
 
         const Range range{ _releases->getCount(), getBatchSize(Mode::Release) };
-        const RangeResults<ReleaseId> releaseIds{ _releaseCollector.get(range) };
+        const RangeResultsView<ReleaseId> releaseIds{ _releaseCollector.get(range) };
         {
             auto transaction{ LmsApp->getDbSession().createReadTransaction() };
 
@@ -184,17 +187,15 @@ namespace UserInterface
         using namespace Database;
 
         const Range range{ _tracks->getCount(), getBatchSize(Mode::Track) };
-        const RangeResults<TrackId> trackIds{ _trackCollector.get(range) };
+        const RangeResultsView<TrackId> trackIds{ _trackCollector.get(range) };
 
         {
             auto transaction{ LmsApp->getDbSession().createReadTransaction() };
 
-            for (const TrackId trackId : trackIds.results)
-            {
-                const Track::pointer track{ Track::find(LmsApp->getDbSession(), trackId) };
-                if (track)
-                    _tracks->add(TrackListHelpers::createEntry(track, _playQueueController, _filters));
-            }
+            const std::vector<Track::pointer> tracks{ Track::find(LmsApp->getDbSession(), trackIds.results) };
+            const TrackListHelpers::TrackEntryBatch batch{ tracks };
+            for (const Track::pointer& track : tracks)
+                _tracks->add(TrackListHelpers::createEntry(track, _playQueueController, _filters, batch));
         }
     }
 } // namespace UserInterface
@@ -35,19 +35,37 @@ namespace UserInterface
 {
     using namespace Database;
 
-    RangeResults<TrackId> TrackCollector::get(std::optional<Range> requestedRange)
+    RangeResultsView<TrackId> TrackCollector::get(std::optional<Range> requestedRange)
+    {
+        const Range range{ getActualRange(requestedRange) };
+
+        // the random results are kept by the collector, the other ones are shared with the cache
+        RangeResultsView<TrackId> tracks;
+        if (getMode() == Mode::Random)
+            tracks = getRandomTracks(range);
+        else
+        {
+            _results = getCachedResults<TrackId>("track", range, [&] { return findTracks(range); });
+            tracks = _results->getView();
+        }
+
+        if (range.offset + range.size == getMaxCount())
+            tracks.moreResults = false;
+
+        return tracks;
+    }
+
+    RangeResults<TrackId> TrackCollector::findTracks(Range range)
     {
         Feedback::IFeedbackService& feedbackService{ *Service<Feedback::IFeedbackService>::get() };
         Scrobbling::IScrobblingService& scrobblingService{ *Service<Scrobbling::IScrobblingService>::get() };
 
-        const Range range{ getActualRange(requestedRange) };
-
         RangeResults<TrackId> tracks;
 
         switch (getMode())
         {
         case Mode::Random:
-            tracks = getRandomTracks(range);
+            assert(false); // see getRandomTracks
             break;
 
         case Mode::Starred:
@@ -124,13 +142,10 @@ namespace UserInterface
         }
         }
 
-        if (range.offset + range.size == getMaxCount())
-            tracks.moreResults = false;
-
         return tracks;
     }
 
-    RangeResults<TrackId> TrackCollector::getRandomTracks(Range range)
+    RangeResultsView<TrackId> TrackCollector::getRandomTracks(Range range)
     {
         assert(getMode() == Mode::Random);
 
@@ -147,7 +162,7 @@ namespace UserInterface
             }
         }
 
-        return _randomTracks->getSubRange(range);
+        return _randomTracks->getSubRangeView(range);
     }
 
 } // ns UserInterface
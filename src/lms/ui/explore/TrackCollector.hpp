@@ -37,12 +37,15 @@ namespace UserInterface
 		public:
 			using DatabaseCollectorBase::DatabaseCollectorBase;
 
-			Database::RangeResults<Database::TrackId>	get(std::optional<Database::Range> range = std::nullopt);
-			void reset() { _randomTracks.reset(); }
+			// the results are valid until the next call to get or reset
+			Database::RangeResultsView<Database::TrackId>	get(std::optional<Database::Range> range = std::nullopt);
+			void reset() { _randomTracks.reset(); _results.reset(); }
 
 		private:
-			Database::RangeResults<Database::TrackId> getRandomTracks(Range range);
+			Database::RangeResults<Database::TrackId>	findTracks(Range range);
+			Database::RangeResultsView<Database::TrackId>	getRandomTracks(Range range);
 			std::optional<Database::RangeResults<Database::TrackId>> _randomTracks;
+			CollectorResultCache::Results<Database::TrackId> _results; // last non random results
 	};
 } // ns UserInterface
 
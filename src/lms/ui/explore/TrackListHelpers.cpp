@@ -19,6 +19,7 @@
 
 #include "TrackListHelpers.hpp"
 
+#include <algorithm>
 #include <map>
 #include <Wt/WAnchor.h>
 #include <Wt/WImage.h>
@@ -49,6 +50,47 @@ namespace UserInterface::TrackListHelpers
 {
     using namespace Database;
 
+    TrackEntryBatch::TrackEntryBatch(std::span<const Track::pointer> tracks)
+    {
+        std::vector<TrackId> trackIds;
+        trackIds.reserve(tracks.size());
+        for (const Track::pointer& track : tracks)
+        {
+            trackIds.push_back(track->getId());
+            _trackData.try_emplace(track->getId());
+        }
+
+        std::vector<ReleaseId> releaseIds;
+        Track::findArtistLinkIds(LmsApp->getDbSession(), trackIds, [&](const Track::ArtistLinkIds& linkIds)
+            {
+                if (linkIds.releaseId.isValid() && std::find(std::cbegin(releaseIds), std::cend(releaseIds), linkIds.releaseId) == std::cend(releaseIds))
+                    releaseIds.push_back(linkIds.releaseId);
+
+                if (!linkIds.artistId.isValid() || linkIds.linkType != TrackArtistLinkType::Artist)
+                    return;
+
+                std::vector<ArtistId>& artists{ _trackData[linkIds.trackId].artists };
+                if (std::find(std::cbegin(artists), std::cend(artists), linkIds.artistId) == std::cend(artists))
+                    artists.push_back(linkIds.artistId);
+            });
+
+        if (!releaseIds.empty())
+            _releases = Release::find(LmsApp->getDbSession(), releaseIds);
+
+        for (const auto& [trackId, dateTime] : Service<Feedback::IFeedbackService>::get()->getStarredDateTimes(LmsApp->getUserId(), trackIds))
+            _trackData[trackId].starred = true;
+    }
+
+    TrackEntryBatch::~TrackEntryBatch() = default;
+
+    const TrackEntryBatch::TrackData& TrackEntryBatch::getTrackData(TrackId trackId) const
+    {
+        static const TrackData emptyTrackData;
+
+        auto it{ _trackData.find(trackId) };
+        return it != std::cend(_trackData) ? it->second : emptyTrackData;
+    }
+
     void showTrackInfoModal(Database::TrackId trackId, Filters& filters)
     {
         auto transaction{ LmsApp->getDbSession().createReadTransaction() };
@@ -160,6 +202,14 @@ namespace UserInterface::TrackListHelpers
 
     std::unique_ptr<Wt::WWidget> createEntry(const Database::ObjectPtr<Database::Track>& track, PlayQueueController& playQueueController, Filters& filters)
     {
+        const TrackEntryBatch batch{ std::span{ &track, 1 } };
+        return createEntry(track, playQueueController, filters, batch);
+    }
+
+    std::unique_ptr<Wt::WWidget> createEntry(const Database::ObjectPtr<Database::Track>& track, PlayQueueController& playQueueController, Filters& filters, const TrackEntryBatch& batch)
+    {
+        const TrackEntryBatch::TrackData& trackData{ batch.getTrackData(track->getId()) };
+
         auto entry{ std::make_unique<Template>(Wt::WString::tr("Lms.Explore.Tracks.template.entry")) };
         auto* entryPtr{ entry.get() };
 
@@ -168,7 +218,7 @@ namespace UserInterface::TrackListHelpers
         const Release::pointer release{ track->getRelease() };
         const TrackId trackId{ track->getId() };
 
-        const auto artists{ track->getArtistIds({TrackArtistLinkType::Artist}) };
+        const std::vector<ArtistId>& artists{ trackData.artists };
         if (!artists.empty())
         {
             entry->setCondition("if-has-artists", true);
@@ -220,7 +270,7 @@ namespace UserInterface::TrackListHelpers
         {
             auto isStarred{ [=] { return Service<Feedback::IFeedbackService>::get()->isStarred(LmsApp->getUserId(), trackId); } };
 
-            Wt::WPushButton* starBtn{ entry->bindNew<Wt::WPushButton>("star", Wt::WString::tr(isStarred() ? "Lms.Explore.unstar" : "Lms.Explore.star")) };
+            Wt::WPushButton* starBtn{ entry->bindNew<Wt::WPushButton>("star", Wt::WString::tr(trackData.starred ? "Lms.Explore.unstar" : "Lms.Explore.star")) };
             starBtn->clicked().connect([=]
                 {
                     auto transaction{ LmsApp->getDbSession().createWriteTransaction() };
@@ -20,13 +20,18 @@
 #pragma once
 
 #include <memory>
+#include <span>
+#include <unordered_map>
+#include <vector>
 
 #include <Wt/WWidget.h>
+#include "database/ArtistId.hpp"
 #include "database/Object.hpp"
 #include "database/TrackId.hpp"
 
 namespace Database
 {
+	class Release;
 	class Track;
 }
 
@@ -38,7 +43,31 @@ namespace UserInterface
 
 namespace UserInterface::TrackListHelpers
 {
+	// Per track data needed to create the entries of several tracks, fetched at once using a few set queries
+	// Must be created and used within the same transaction
+	class TrackEntryBatch
+	{
+	public:
+		TrackEntryBatch(std::span<const Database::ObjectPtr<Database::Track>> tracks);
+		~TrackEntryBatch();
+
+		TrackEntryBatch(const TrackEntryBatch&) = delete;
+		TrackEntryBatch& operator=(const TrackEntryBatch&) = delete;
+
+		struct TrackData
+		{
+			std::vector<Database::ArtistId> artists; // TrackArtistLinkType::Artist links only
+			bool starred{};
+		};
+		const TrackData& getTrackData(Database::TrackId trackId) const; // empty data if the track is not part of the batch
+
+	private:
+		std::unordered_map<Database::TrackId, TrackData> _trackData;
+		std::vector<Database::ObjectPtr<Database::Release>> _releases; // kept loaded in the session: the releases of the tracks are resolved without any query
+	};
+
 	void showTrackInfoModal(Database::TrackId trackId, Filters& filters);
 	std::unique_ptr<Wt::WWidget> createEntry(const Database::ObjectPtr<Database::Track>& track, PlayQueueController& playQueueController, Filters& filters);
+	std::unique_ptr<Wt::WWidget> createEntry(const Database::ObjectPtr<Database::Track>& track, PlayQueueController& playQueueController, Filters& filters, const TrackEntryBatch& batch);
 } // namespace UserInterface
 
@@ -19,6 +19,9 @@
 
 #include "TrackListView.hpp"
 
+#include <algorithm>
+#include <span>
+
 #include <Wt/WPushButton.h>
 
 #include "database/Cluster.hpp"
@@ -29,7 +32,6 @@
 #include "utils/ILogger.hpp"
 #include "utils/String.hpp"
 
-#include "common/InfiniteScrollingContainer.hpp"
 #include "explore/Filters.hpp"
 #include "explore/PlayQueueController.hpp"
 #include "explore/TrackListHelpers.hpp"
@@ -171,27 +173,43 @@ namespace UserInterface
                     LmsApp->getModalManager().show(std::move(modal));
                 });
 
-        _container = bindNew<InfiniteScrollingContainer>("tracks", Wt::WString::tr("Lms.Explore.TrackList.template.entry-container"));
-        _container->onRequestElements.connect([this]
-            {
-                addSome();
-            });
+        {
+            Database::Track::FindParameters params;
+            params.setClusters(_filters.getClusterIds());
+            params.setTrackList(_trackListId);
+            params.setSortMethod(Database::TrackSortMethod::TrackList);
+            params.setRange(Database::Range{ 0, _maxCount });
+
+            _trackIds = Database::Track::findIds(LmsApp->getDbSession(), params).results;
+        }
+
+        _container = bindNew<VirtualList>("tracks", *this, _pageSize, _estimatedRowHeight);
+        _container->reset();
     }
 
-    void TrackList::addSome()
+    std::size_t TrackList::getRowCount()
     {
+        return _trackIds.size();
+    }
+
+    std::vector<std::unique_ptr<Wt::WWidget>> TrackList::createRows(std::size_t offset, std::size_t count)
+    {
+        std::vector<std::unique_ptr<Wt::WWidget>> rows;
+        if (offset >= _trackIds.size())
+            return rows;
+
+        count = std::min(count, _trackIds.size() - offset);
+        rows.reserve(count);
+
         auto transaction{ LmsApp->getDbSession().createReadTransaction() };
 
-        Database::Track::FindParameters params;
-        params.setClusters(_filters.getClusterIds());
-        params.setTrackList(_trackListId);
-        params.setSortMethod(Database::TrackSortMethod::TrackList);
-        params.setRange(Database::Range{ static_cast<std::size_t>(_container->getCount()), _batchSize });
+        // some tracks may have been removed meanwhile
+        const std::vector<Database::Track::pointer> tracks{ Database::Track::find(LmsApp->getDbSession(), std::span{ _trackIds }.subspan(offset, count)) };
+        const TrackListHelpers::TrackEntryBatch batch{ tracks };
+        for (const Database::Track::pointer& track : tracks)
+            rows.push_back(TrackListHelpers::createEntry(track, _playQueueController, _filters, batch));
 
-        Database::Track::find(LmsApp->getDbSession(), params, [this](const Track::pointer& track)
-            {
-                _container->add(TrackListHelpers::createEntry(track, _playQueueController, _filters));
-            });
+        return rows;
     }
 } // namespace UserInterface
 
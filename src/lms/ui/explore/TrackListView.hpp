@@ -19,18 +19,21 @@
 
 #pragma once
 
+#include <vector>
+
+#include "database/TrackId.hpp"
 #include "database/TrackListId.hpp"
 #include "database/Types.hpp"
 
 #include "common/Template.hpp"
+#include "common/VirtualList.hpp"
 
 namespace UserInterface
 {
 	class Filters;
-	class InfiniteScrollingContainer;
 	class PlayQueueController;
 
-	class TrackList : public Template
+	class TrackList : public Template, private IVirtualListModel
 	{
 		public:
 			TrackList(Filters& filters, PlayQueueController& playQueueController);
@@ -39,15 +42,20 @@ namespace UserInterface
 
 		private:
 			void refreshView();
-			void addSome();
 
-			static constexpr std::size_t _batchSize {6};
+			// IVirtualListModel
+			std::size_t getRowCount() override;
+			std::vector<std::unique_ptr<Wt::WWidget>> createRows(std::size_t offset, std::size_t count) override;
+
+			static constexpr std::size_t _pageSize {20};
+			static constexpr int _estimatedRowHeight {80}; // px
 			static constexpr std::size_t _maxCount {8000};
 
 			Filters&					_filters;
 			PlayQueueController&		_playQueueController;
 			Database::TrackListId		_trackListId;
-			InfiniteScrollingContainer* _container {};
+			std::vector<Database::TrackId> _trackIds; // only the ids of the whole list are kept, rows are created when displayed
+			VirtualList*				_container {};
 	};
 } // namespace UserInterface
 
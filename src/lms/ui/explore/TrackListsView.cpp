@@ -64,6 +64,7 @@ namespace UserInterface
 		bindMenuItem("all", Wt::WString::tr("Lms.Explore.all"), Mode::All);
 
 		_container = bindNew<InfiniteScrollingContainer>("tracklists", Wt::WString::tr("Lms.Explore.TrackLists.template.container"));
+		_container->trimWhenLeaving("/tracklists");
 		_container->onRequestElements.connect([this]
 		{
 			addSome();
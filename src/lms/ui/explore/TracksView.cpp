@@ -92,6 +92,7 @@ namespace UserInterface
                 });
 
         _container = bindNew<InfiniteScrollingContainer>("tracks", Wt::WString::tr("Lms.Explore.Tracks.template.entry-container"));
+        _container->trimWhenLeaving("/tracks");
         _container->onRequestElements.connect([this]
             {
                 addSome();
@@ -123,16 +124,15 @@ namespace UserInterface
 
         const auto trackIds{ _trackCollector.get(Range {static_cast<std::size_t>(_container->getCount()), _batchSize}) };
 
-        for (const TrackId trackId : trackIds.results)
-        {
-            if (const Track::pointer track{ Track::find(LmsApp->getDbSession(), trackId) })
-                _container->add(TrackListHelpers::createEntry(track, _playQueueController, _filters));
-        }
+        const std::vector<Track::pointer> tracks{ Track::find(LmsApp->getDbSession(), trackIds.results) };
+        const TrackListHelpers::TrackEntryBatch batch{ tracks };
+        for (const Track::pointer& track : tracks)
+            _container->add(TrackListHelpers::createEntry(track, _playQueueController, _filters, batch));
     }
 
     std::vector<Database::TrackId> Tracks::getAllTracks()
     {
-        RangeResults<TrackId> trackIds{ _trackCollector.get() };
-        return std::move(trackIds.results);
+        const RangeResultsView<TrackId> trackIds{ _trackCollector.get() };
+        return std::vector<TrackId>(std::cbegin(trackIds.results), std::cend(trackIds.results));
     }
 } // namespace UserInterface
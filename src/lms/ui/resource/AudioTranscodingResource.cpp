@@ -20,8 +20,10 @@
 #include "AudioTranscodingResource.hpp"
 
 #include <optional>
+#include <vector>
 #include <Wt/Http/Response.h>
 
+#include "av/PreTranscoding.hpp"
 #include "av/TranscodingParameters.hpp"
 #include "av/TranscodingResourceHandlerCreator.hpp"
 #include "av/Types.hpp"
@@ -87,6 +89,19 @@ namespace UserInterface
             return std::nullopt;
         }
 
+        // Stream properties stored at scan time spare a probe of the file
+        void fillStreamParameters(const Database::Track::pointer& track, Av::Transcoding::InputParameters& inputParameters, Av::Transcoding::OutputParameters& outputParameters)
+        {
+            inputParameters.trackPath = track->getPath();
+            inputParameters.duration = track->getDuration();
+            if (!track->getCodec().empty())
+            {
+                inputParameters.codec = Av::getDecodingCodec(track->getCodec());
+                inputParameters.bitrate = track->getBitrate();
+            }
+            outputParameters.stream = track->getAudioStreamIndex();
+        }
+
         template<typename T>
         std::optional<T> readParameterAs(const Wt::Http::Request& request, const std::string& parameterName)
         {
@@ -146,8 +161,7 @@ namespace UserInterface
                     return std::nullopt;
                 }
 
-                parameters.inputParameters.trackPath = track->getPath();
-                parameters.inputParameters.duration = track->getDuration();
+                fillStreamParameters(track, parameters.inputParameters, parameters.outputParameters);
             }
 
             parameters.outputParameters.stripMetadata = true;
@@ -159,6 +173,34 @@ namespace UserInterface
         }
     }
 
+    void preTranscodeTracks(std::span<const Database::TrackId> trackIds, Database::TranscodingOutputFormat format, Database::Bitrate bitrate)
+    {
+        const std::optional<Av::Transcoding::OutputFormat> avFormat{ AudioFormatToAvFormat(format) };
+        if (!avFormat)
+            return;
+
+        std::vector<Av::Transcoding::PreTranscodeRequest> requests;
+        {
+            auto transaction{ LmsApp->getDbSession().createReadTransaction() };
+
+            for (const Database::TrackId trackId : trackIds)
+            {
+                const Database::Track::pointer track{ Database::Track::find(LmsApp->getDbSession(), trackId) };
+                if (!track)
+                    continue;
+
+                // must match the parameters used by the resource
+                Av::Transcoding::PreTranscodeRequest& request{ requests.emplace_back() };
+                fillStreamParameters(track, request.inputParameters, request.outputParameters);
+                request.outputParameters.stripMetadata = true;
+                request.outputParameters.format = *avFormat;
+                request.outputParameters.bitrate = bitrate;
+            }
+        }
+
+        Av::Transcoding::schedulePreTranscodes(LmsApp->getUserId().toString(), requests);
+    }
+
     AudioTranscodingResource:: ~AudioTranscodingResource()
     {
         beingDeleted();
@@ -179,7 +221,12 @@ namespace UserInterface
             if (!continuation)
             {
                 if (const auto& parameters{ readTranscodingParameters(request) })
-                    resourceHandler = Av::Transcoding::createResourceHandler(parameters->inputParameters, parameters->outputParameters, false /* estimate content length */);
+                {
+                    Av::Transcoding::SchedulingParameters schedulingParameters;
+                    schedulingParameters.clientId = LmsApp->getUserId().toString();
+                    schedulingParameters.deviceId = LmsApp->getUserId().toString() + "/" + request.clientAddress();
+                    resourceHandler = Av::Transcoding::createResourceHandler(parameters->inputParameters, parameters->outputParameters, schedulingParameters, false /* estimate content length */);
+                }
             }
             else
             {
@@ -19,10 +19,12 @@
 
 #pragma once
 
+#include <span>
 #include <Wt/Dbo/ptr.h>
 #include <Wt/WResource.h>
 
 #include "database/TrackId.hpp"
+#include "database/Types.hpp"
 
 namespace Database
 {
@@ -44,6 +46,9 @@ namespace UserInterface
 		private:
 			static constexpr std::size_t	_chunkSize {262144};
 	};
+
+	// Transcodes the tracks in background for the current user, so that they are ready to be served by the resource
+	void preTranscodeTracks(std::span<const Database::TrackId> trackIds, Database::TranscodingOutputFormat format, Database::Bitrate bitrate);
 } // namespace UserInterface
 
 
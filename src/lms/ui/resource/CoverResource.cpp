@@ -19,6 +19,8 @@
 
 #include "CoverResource.hpp"
 
+#include <optional>
+
 #include <Wt/WApplication.h>
 #include <Wt/Http/Response.h>
 
@@ -29,15 +31,18 @@
 #include "utils/Service.hpp"
 #include "utils/String.hpp"
 
+#include "ImmutableCoverResource.hpp"
 #include "LmsApplication.hpp"
 
 #define LOG(severity, message)	LMS_LOG(UI, severity, "Image resource: " << message)
 
 namespace UserInterface
 {
-    CoverResource::CoverResource()
+    CoverResource::CoverResource(ImmutableCoverResource& immutableCovers)
+        : _immutableCovers{ immutableCovers }
+        , _format{ Service<Cover::ICoverService>::get()->getPreferredFormat(LmsApp->environment().headerValue("Accept")) }
     {
-        LmsApp->getScannerEvents().scanComplete.connect(this, [this](const Scanner::ScanStats& stats)
+        LmsApp->getScannerEvents().scanComplete.connect(this, [this](const Scanner::ScanSummary& stats)
             {
                 if (stats.nbChanges())
                     setChanged();
@@ -51,16 +56,47 @@ namespace UserInterface
 
     std::string CoverResource::getReleaseUrl(Database::ReleaseId releaseId, Size size) const
     {
+        if (std::optional<std::string> immutableUrl{ _immutableCovers.getUrl({ ImmutableCoverResource::CoverKey::Type::Release, releaseId.getValue(), static_cast<Image::ImageSize>(size), _format }) })
+            return *immutableUrl;
+
         return url() + "&releaseid=" + releaseId.toString() + "&size=" + std::to_string(static_cast<std::size_t>(size));
     }
 
     std::string CoverResource::getTrackUrl(Database::TrackId trackId, Size size) const
     {
+        if (std::optional<std::string> immutableUrl{ _immutableCovers.getUrl({ ImmutableCoverResource::CoverKey::Type::Track, trackId.getValue(), static_cast<Image::ImageSize>(size), _format }) })
+            return *immutableUrl;
+
         return url() + "&trackid=" + trackId.toString() + "&size=" + std::to_string(static_cast<std::size_t>(size));
     }
 
+    namespace
+    {
+        // Shared between the initial request and its continuation
+        struct PendingCover
+        {
+            std::size_t size{};
+            Image::ImageFormat format{};
+            std::shared_ptr<Image::IEncodedImage> cover;
+        };
+    }
+
     void CoverResource::handleRequest(const Wt::Http::Request& request, Wt::Http::Response& response)
     {
+        if (Wt::Http::ResponseContinuation* continuation{ request.continuation() })
+        {
+            const auto pendingCover{ Wt::cpp17::any_cast<std::shared_ptr<PendingCover>>(continuation->data()) };
+
+            std::shared_ptr<Image::IEncodedImage> cover{ pendingCover->cover };
+            if (!cover)
+                cover = Service<Cover::ICoverService>::get()->getDefault(pendingCover->size, pendingCover->format);
+
+            response.addHeader("Vary", "Accept");
+            response.setMimeType(std::string{ cover->getMimeType() });
+            response.out().write(reinterpret_cast<const char*>(cover->getData()), cover->getDataSize());
+            return;
+        }
+
         // Retrieve parameters
         const std::string* trackIdStr = request.getParameter("trackid");
         const std::string* releaseIdStr = request.getParameter("releaseid");
@@ -80,34 +116,27 @@ namespace UserInterface
             return;
         }
 
-        std::shared_ptr<Image::IEncodedImage> cover;
+        std::optional<Database::TrackId> trackId;
+        std::optional<Database::ReleaseId> releaseId;
 
         if (trackIdStr)
         {
             LOG(DEBUG, "Requested cover for track " << *trackIdStr << ", size = " << *size);
 
-            const std::optional<Database::TrackId> trackId{ StringUtils::readAs<Database::TrackId::ValueType>(*trackIdStr) };
+            trackId = StringUtils::readAs<Database::TrackId::ValueType>(*trackIdStr);
             if (!trackId)
             {
                 LOG(DEBUG, "track not found");
                 return;
             }
-
-            cover = Service<Cover::ICoverService>::get()->getFromTrack(*trackId, *size);
-            if (!cover)
-                cover = Service<Cover::ICoverService>::get()->getDefault(*size);
         }
         else if (releaseIdStr)
         {
             LOG(DEBUG, "Requested cover for release " << *releaseIdStr << ", size = " << *size);
 
-            const std::optional<Database::ReleaseId> releaseId{ StringUtils::readAs<Database::ReleaseId::ValueType>(*releaseIdStr) };
+            releaseId = StringUtils::readAs<Database::ReleaseId::ValueType>(*releaseIdStr);
             if (!releaseId)
                 return;
-
-            cover = Service<Cover::ICoverService>::get()->getFromRelease(*releaseId, *size);
-            if (!cover)
-                cover = Service<Cover::ICoverService>::get()->getDefault(*size);
         }
         else
         {
@@ -115,8 +144,32 @@ namespace UserInterface
             return;
         }
 
-        response.setMimeType(std::string{ cover->getMimeType() });
+        // Covers are computed by the cover service's own threads, the response is sent in a continuation
+        auto pendingCover{ std::make_shared<PendingCover>() };
+        pendingCover->size = *size;
+        pendingCover->format = Service<Cover::ICoverService>::get()->getPreferredFormat(request.headerValue("Accept"));
 
-        response.out().write(reinterpret_cast<const char*>(cover->getData()), cover->getDataSize());
+        Wt::Http::ResponseContinuation* continuation{ response.createContinuation() };
+        continuation->setData(pendingCover);
+        continuation->waitForMoreData();
+
+        const ImmutableCoverResource::CoverKey key{ trackId ? ImmutableCoverResource::CoverKey::Type::Track : ImmutableCoverResource::CoverKey::Type::Release,
+                                                    trackId ? trackId->getValue() : releaseId->getValue(),
+                                                    *size,
+                                                    pendingCover->format };
+        auto onCover{ [pendingCover, continuation, key, &immutableCovers = _immutableCovers](std::shared_ptr<Image::IEncodedImage> cover)
+        {
+            // the next pages will use the immutable URL (default covers are not shared as they are replaced as soon as a cover is added)
+            if (cover)
+                immutableCovers.onCoverServed(key, *cover);
+
+            pendingCover->cover = std::move(cover);
+            continuation->haveMoreData();
+        } };
+
+        if (trackId)
+            Service<Cover::ICoverService>::get()->asyncGetFromTrack(*trackId, *size, pendingCover->format, std::move(onCover));
+        else
+            Service<Cover::ICoverService>::get()->asyncGetFromRelease(*releaseId, *size, pendingCover->format, std::move(onCover));
     }
 } // namespace UserInterface
@@ -22,15 +22,19 @@
 #include <Wt/WResource.h>
 #include "database/ReleaseId.hpp"
 #include "database/TrackId.hpp"
+#include "image/IEncodedImage.hpp"
 
 namespace UserInterface
 {
+	class ImmutableCoverResource;
+
+	// Session specific covers, only used until the immutable URL of a cover is known
 	class CoverResource : public Wt::WResource
 	{
 		public:
 			static const std::size_t maxSize {512};
 
-			CoverResource();
+			CoverResource(ImmutableCoverResource& immutableCovers);
 			~CoverResource();
 
 			enum class Size : std::size_t
@@ -44,6 +48,9 @@ namespace UserInterface
 
 		private:
 			void handleRequest(const Wt::Http::Request& request, Wt::Http::Response& response) override;
+
+			ImmutableCoverResource&	_immutableCovers;
+			const Image::ImageFormat	_format; // preferred by this session's browser
 	};
 } // namespace UserInterface
 
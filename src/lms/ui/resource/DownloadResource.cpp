@@ -45,23 +45,25 @@ namespace UserInterface
     {
         try
         {
-            std::shared_ptr<Zip::IZipper> zipper;
+            std::shared_ptr<IResourceHandler> resourceHandler;
 
             // First, see if this request is for a continuation
             if (Wt::Http::ResponseContinuation * continuation{ request.continuation() })
-                zipper = Wt::cpp17::any_cast<std::shared_ptr<Zip::IZipper>>(continuation->data());
+                resourceHandler = Wt::cpp17::any_cast<std::shared_ptr<IResourceHandler>>(continuation->data());
             else
             {
-                zipper = createZipper();
-                response.setMimeType("application/zip");
-            }
+                std::unique_ptr<Zip::IZipper> zipper{ createZipper() };
+                if (!zipper)
+                {
+                    response.setStatus(404);
+                    return;
+                }
 
-            zipper->writeSome(response.out());
-            if (!zipper->isComplete())
-            {
-                auto* continuation{ response.createContinuation() };
-                continuation->setData(zipper);
+                resourceHandler = createZipperResourceHandler(std::move(zipper));
             }
+
+            if (auto* continuation{ resourceHandler->processRequest(request, response) })
+                continuation->setData(resourceHandler);
         }
         catch (Zip::Exception& exception)
         {
@@ -155,7 +157,7 @@ namespace UserInterface
                 files.emplace_back(Zip::Entry{ fileName, track->getPath() });
             }
 
-            return Zip::createArchiveZipper(files);
+            return Zip::createZipper(files);
         }
     }
 
@@ -0,0 +1,181 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "HlsTranscodingResource.hpp"
+
+#include <optional>
+#include <Wt/Http/Response.h>
+
+#include "av/Hls.hpp"
+#include "av/TranscodingParameters.hpp"
+#include "av/TranscodingResourceHandlerCreator.hpp"
+#include "av/Types.hpp"
+#include "database/Session.hpp"
+#include "database/Track.hpp"
+#include "database/User.hpp"
+#include "utils/ILogger.hpp"
+#include "utils/String.hpp"
+
+#include "LmsApplication.hpp"
+
+#define LOG(severity, message)	LMS_LOG(UI, severity, "HLS transcode resource: " << message)
+
+namespace UserInterface
+{
+    namespace
+    {
+        // segments never change for given parameters, let the browser and the proxies keep them
+        constexpr std::string_view segmentCacheControl{ "max-age=86400" };
+
+        template<typename T>
+        std::optional<T> readParameterAs(const Wt::Http::Request& request, const std::string& parameterName)
+        {
+            auto paramStr{ request.getParameter(parameterName) };
+            if (!paramStr)
+                return std::nullopt;
+
+            auto res{ StringUtils::readAs<T>(*paramStr) };
+            if (!res)
+                LOG(ERROR, "Cannot parse parameter '" << parameterName << "' from value '" << *paramStr << "'");
+
+            return res;
+        }
+
+        struct TrackInfo
+        {
+            Av::Transcoding::InputParameters inputParameters;
+            std::optional<std::size_t> stream;
+        };
+
+        std::optional<TrackInfo> getTrackInfo(Database::TrackId trackId)
+        {
+            auto transaction{ LmsApp->getDbSession().createReadTransaction() };
+
+            const Database::Track::pointer track{ Database::Track::find(LmsApp->getDbSession(), trackId) };
+            if (!track)
+            {
+                LOG(ERROR, "Missing track");
+                return std::nullopt;
+            }
+
+            TrackInfo trackInfo;
+            trackInfo.inputParameters.trackPath = track->getPath();
+            trackInfo.inputParameters.duration = track->getDuration();
+            if (!track->getCodec().empty())
+            {
+                trackInfo.inputParameters.codec = Av::getDecodingCodec(track->getCodec());
+                trackInfo.inputParameters.bitrate = track->getBitrate();
+            }
+            trackInfo.stream = track->getAudioStreamIndex();
+
+            return trackInfo;
+        }
+
+        std::string getSegmentUrl(const std::string& playlistUrl, std::size_t segmentIndex)
+        {
+            return playlistUrl + "&segment=" + std::to_string(segmentIndex);
+        }
+    }
+
+    HlsTranscodingResource::~HlsTranscodingResource()
+    {
+        beingDeleted();
+    }
+
+    std::string HlsTranscodingResource::getUrl(Database::TrackId trackId) const
+    {
+        return url() + "&trackid=" + trackId.toString();
+    }
+
+    void HlsTranscodingResource::handleRequest(const Wt::Http::Request& request, Wt::Http::Response& response)
+    {
+        std::shared_ptr<IResourceHandler> resourceHandler;
+
+        try
+        {
+            Wt::Http::ResponseContinuation* continuation{ request.continuation() };
+            if (!continuation)
+            {
+                const std::optional<Database::TrackId> trackId{ readParameterAs<Database::TrackId::ValueType>(request, "trackid") };
+                const std::optional<Database::Bitrate> bitrate{ readParameterAs<Database::Bitrate>(request, "bitrate") };
+                if (!trackId || !bitrate)
+                {
+                    LOG(DEBUG, "Missing mandatory parameter");
+                    response.setStatus(400);
+                    return;
+                }
+
+                if (!Database::isAudioBitrateAllowed(*bitrate))
+                {
+                    LOG(ERROR, "Bitrate '" << *bitrate << "' is not allowed");
+                    response.setStatus(400);
+                    return;
+                }
+
+                const std::optional<TrackInfo> trackInfo{ getTrackInfo(*trackId) };
+                if (!trackInfo)
+                {
+                    response.setStatus(404);
+                    return;
+                }
+
+                const std::optional<std::size_t> segmentIndex{ readParameterAs<std::size_t>(request, "segment") };
+                if (!segmentIndex)
+                {
+                    const std::string playlistUrl{ getUrl(*trackId) + "&bitrate=" + std::to_string(*bitrate) };
+
+                    response.setMimeType(std::string{ Av::Transcoding::Hls::getPlaylistMimeType() });
+                    response.out() << Av::Transcoding::Hls::createPlaylist(trackInfo->inputParameters.duration, [&](std::size_t index) { return getSegmentUrl(playlistUrl, index); });
+                    return;
+                }
+
+                if (*segmentIndex >= Av::Transcoding::Hls::getSegmentCount(trackInfo->inputParameters.duration))
+                {
+                    LOG(ERROR, "Segment " << *segmentIndex << " is out of range");
+                    response.setStatus(404);
+                    return;
+                }
+
+                const Av::Transcoding::OutputParameters outputParameters{ Av::Transcoding::Hls::createSegmentOutputParameters(*bitrate, trackInfo->stream, *segmentIndex) };
+
+                Av::Transcoding::SchedulingParameters schedulingParameters;
+                schedulingParameters.clientId = LmsApp->getUserId().toString();
+                schedulingParameters.deviceId = LmsApp->getUserId().toString() + "/" + request.clientAddress();
+
+                response.addHeader("Cache-Control", std::string{ segmentCacheControl });
+                resourceHandler = Av::Transcoding::createResourceHandler(trackInfo->inputParameters, outputParameters, schedulingParameters, false /* estimate content length */);
+            }
+            else
+            {
+                resourceHandler = Wt::cpp17::any_cast<std::shared_ptr<IResourceHandler>>(continuation->data());
+            }
+
+            if (resourceHandler)
+            {
+                continuation = resourceHandler->processRequest(request, response);
+                if (continuation)
+                    continuation->setData(resourceHandler);
+            }
+        }
+        catch (const Av::Exception& e)
+        {
+            LOG(ERROR, "Caught Av exception: " << e.what());
+        }
+    }
+} // namespace UserInterface
@@ -0,0 +1,228 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ImmutableCoverResource.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <functional>
+#include <mutex>
+
+#include <Wt/Http/Request.h>
+#include <Wt/Http/Response.h>
+
+#include "services/cover/ICoverService.hpp"
+#include "utils/ILogger.hpp"
+#include "utils/Service.hpp"
+
+#define LOG(severity, message)	LMS_LOG(UI, severity, "Immutable cover resource: " << message)
+
+namespace UserInterface
+{
+    namespace
+    {
+        // FNV-1a, stable across runs so that the URLs remain valid after a restart if the covers do not change
+        std::uint64_t computeHash(const Image::IEncodedImage& image)
+        {
+            std::uint64_t hash{ 0xcbf29ce484222325ULL };
+            for (std::size_t i{}; i < image.getDataSize(); ++i)
+            {
+                hash ^= static_cast<std::uint64_t>(image.getData()[i]);
+                hash *= 0x100000001b3ULL;
+            }
+            return hash;
+        }
+
+        std::string hashToString(std::uint64_t hash)
+        {
+            std::string res(16, '0');
+            for (std::size_t i{}; i < res.size(); ++i)
+                res[res.size() - 1 - i] = "0123456789abcdef"[(hash >> (i * 4)) & 0xF];
+            return res;
+        }
+
+        std::optional<std::uint64_t> hashFromString(std::string_view str)
+        {
+            std::uint64_t hash{};
+            const auto [ptr, ec]{ std::from_chars(str.data(), str.data() + str.size(), hash, 16) };
+            if (ec != std::errc{} || ptr != str.data() + str.size())
+                return std::nullopt;
+            return hash;
+        }
+
+        struct PendingCover
+        {
+            std::uint64_t hash{};
+            std::shared_ptr<Image::IEncodedImage> cover;
+        };
+    }
+
+    std::size_t ImmutableCoverResource::CoverKeyHash::operator()(const CoverKey& key) const
+    {
+        std::size_t res{ std::hash<Database::IdType::ValueType>{}(key.id) };
+        res ^= std::hash<std::size_t>{}(key.size) + 0x9e3779b9 + (res << 6) + (res >> 2);
+        res ^= std::hash<int>{}(static_cast<int>(key.type) << 8 | static_cast<int>(key.format)) + 0x9e3779b9 + (res << 6) + (res >> 2);
+        return res;
+    }
+
+    ImmutableCoverResource::ImmutableCoverResource(std::size_t maxEntryCount)
+        : _maxEntryCount{ maxEntryCount }
+    {
+    }
+
+    ImmutableCoverResource::~ImmutableCoverResource()
+    {
+        beingDeleted();
+    }
+
+    std::optional<std::string> ImmutableCoverResource::getUrl(const CoverKey& key) const
+    {
+        std::shared_lock lock{ _mutex };
+
+        const auto it{ _hashesByKey.find(key) };
+        if (it == std::cend(_hashesByKey))
+            return std::nullopt;
+
+        return std::string{ path } + "/" + hashToString(it->second);
+    }
+
+    void ImmutableCoverResource::onCoverServed(const CoverKey& key, const Image::IEncodedImage& image)
+    {
+        const std::uint64_t hash{ computeHash(image) };
+
+        std::unique_lock lock{ _mutex };
+
+        if (auto it{ _hashesByKey.find(key) }; it != std::cend(_hashesByKey))
+        {
+            if (it->second == hash)
+                return;
+
+            _keysByHash.erase(it->second);
+            _hashesByKey.erase(it);
+        }
+
+        // entries are tiny, just start over when full
+        if (_hashesByKey.size() >= _maxEntryCount)
+        {
+            _hashesByKey.clear();
+            _keysByHash.clear();
+        }
+
+        _hashesByKey.emplace(key, hash);
+        _keysByHash.insert_or_assign(hash, key);
+    }
+
+    void ImmutableCoverResource::invalidate(std::span<const Database::TrackId> tracks, std::span<const Database::ReleaseId> releases)
+    {
+        std::unique_lock lock{ _mutex };
+
+        std::erase_if(_hashesByKey, [&](const auto& entry)
+            {
+                const CoverKey& key{ entry.first };
+
+                bool invalidated{};
+                switch (key.type)
+                {
+                case CoverKey::Type::Track:
+                    invalidated = std::any_of(std::cbegin(tracks), std::cend(tracks), [&](Database::TrackId trackId) { return trackId.getValue() == key.id; });
+                    break;
+                case CoverKey::Type::Release:
+                    invalidated = std::any_of(std::cbegin(releases), std::cend(releases), [&](Database::ReleaseId releaseId) { return releaseId.getValue() == key.id; });
+                    break;
+                }
+
+                if (invalidated)
+                    _keysByHash.erase(entry.second);
+                return invalidated;
+            });
+    }
+
+    void ImmutableCoverResource::clear()
+    {
+        std::unique_lock lock{ _mutex };
+
+        _hashesByKey.clear();
+        _keysByHash.clear();
+    }
+
+    void ImmutableCoverResource::handleRequest(const Wt::Http::Request& request, Wt::Http::Response& response)
+    {
+        if (Wt::Http::ResponseContinuation* continuation{ request.continuation() })
+        {
+            const auto pendingCover{ Wt::cpp17::any_cast<std::shared_ptr<PendingCover>>(continuation->data()) };
+
+            // the cover may have changed since its URL was handed out: let the browser get the new URL from the UI
+            if (!pendingCover->cover || computeHash(*pendingCover->cover) != pendingCover->hash)
+            {
+                response.setStatus(404);
+                response.addHeader("Cache-Control", "no-store");
+                return;
+            }
+
+            response.addHeader("Cache-Control", "public, max-age=31536000, immutable");
+            response.setMimeType(std::string{ pendingCover->cover->getMimeType() });
+            response.out().write(reinterpret_cast<const char*>(pendingCover->cover->getData()), pendingCover->cover->getDataSize());
+            return;
+        }
+
+        std::string_view pathInfo{ request.pathInfo() };
+        if (!pathInfo.empty() && pathInfo.front() == '/')
+            pathInfo.remove_prefix(1);
+
+        const std::optional<std::uint64_t> hash{ hashFromString(pathInfo) };
+        std::optional<CoverKey> key;
+        if (hash)
+        {
+            std::shared_lock lock{ _mutex };
+            if (const auto it{ _keysByHash.find(*hash) }; it != std::cend(_keysByHash))
+                key = it->second;
+        }
+
+        if (!key)
+        {
+            LOG(DEBUG, "Unknown cover '" << pathInfo << "'");
+            response.setStatus(404);
+            response.addHeader("Cache-Control", "no-store");
+            return;
+        }
+
+        auto pendingCover{ std::make_shared<PendingCover>() };
+        pendingCover->hash = *hash;
+
+        Wt::Http::ResponseContinuation* continuation{ response.createContinuation() };
+        continuation->setData(pendingCover);
+        continuation->waitForMoreData();
+
+        auto onCover{ [pendingCover, continuation](std::shared_ptr<Image::IEncodedImage> cover)
+        {
+            pendingCover->cover = std::move(cover);
+            continuation->haveMoreData();
+        } };
+
+        switch (key->type)
+        {
+        case CoverKey::Type::Track:
+            Service<Cover::ICoverService>::get()->asyncGetFromTrack(Database::TrackId{ key->id }, key->size, key->format, std::move(onCover));
+            break;
+        case CoverKey::Type::Release:
+            Service<Cover::ICoverService>::get()->asyncGetFromRelease(Database::ReleaseId{ key->id }, key->size, key->format, std::move(onCover));
+            break;
+        }
+    }
+} // namespace UserInterface
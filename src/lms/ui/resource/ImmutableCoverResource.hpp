@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <shared_mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include <Wt/WResource.h>
+
+#include "database/ReleaseId.hpp"
+#include "database/TrackId.hpp"
+#include "image/IEncodedImage.hpp"
+
+namespace UserInterface
+{
+    // Covers shared by all the sessions, using content addressed URLs (hash of the image bytes): they can be cached forever
+    // Hashes are only known once a cover has been served by a session: unknown hashes are not served
+    class ImmutableCoverResource final : public Wt::WResource
+    {
+    public:
+        static constexpr std::string_view path{ "/covers" };
+
+        ImmutableCoverResource(std::size_t maxEntryCount);
+        ~ImmutableCoverResource() override;
+
+        struct CoverKey
+        {
+            enum class Type
+            {
+                Track,
+                Release,
+            };
+            Type type;
+            Database::IdType::ValueType id;
+            Image::ImageSize size;
+            Image::ImageFormat format;
+
+            bool operator==(const CoverKey&) const = default;
+        };
+
+        // std::nullopt if the cover has not been served yet
+        std::optional<std::string> getUrl(const CoverKey& key) const;
+        // can be called from any thread
+        void onCoverServed(const CoverKey& key, const Image::IEncodedImage& image);
+        void invalidate(std::span<const Database::TrackId> tracks, std::span<const Database::ReleaseId> releases);
+        void clear();
+
+    private:
+        void handleRequest(const Wt::Http::Request& request, Wt::Http::Response& response) override;
+
+        struct CoverKeyHash
+        {
+            std::size_t operator()(const CoverKey& key) const;
+        };
+
+        const std::size_t _maxEntryCount;
+        mutable std::shared_mutex _mutex;
+        std::unordered_map<CoverKey, std::uint64_t, CoverKeyHash> _hashesByKey;
+        std::unordered_map<std::uint64_t, CoverKey> _keysByHash;
+    };
+} // namespace UserInterface
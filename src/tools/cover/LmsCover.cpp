@@ -17,22 +17,32 @@
  * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <filesystem>
+#include <iomanip>
 #include <iostream>
+#include <mutex>
 #include <stdexcept>
 #include <stdlib.h>
+#include <string_view>
+#include <vector>
 
 #include <boost/program_options.hpp>
 
+#include "database/Artist.hpp"
 #include "database/Db.hpp"
 #include "database/Release.hpp"
 #include "database/Session.hpp"
 #include "database/Track.hpp"
+#include "image/IRawImage.hpp"
 #include "services/cover/ICoverService.hpp"
 #include "utils/IConfig.hpp"
 #include "utils/ILogger.hpp"
 #include "utils/Service.hpp"
 #include "utils/StreamLogger.hpp"
+#include "utils/String.hpp"
 
 static
 void
@@ -49,10 +59,158 @@ dumpTrackCovers(Database::Session& session, Image::ImageSize width)
     for (const Database::TrackId trackId : trackIds.results)
     {
         std::cout << "Getting cover for track id " << trackId.toString() << std::endl;
-        Service<Cover::ICoverService>::get()->getFromTrack(trackId, width);
+        Service<Cover::ICoverService>::get()->getFromTrack(trackId, width, Image::ImageFormat::JPEG);
     }
 }
 
+namespace
+{
+    std::vector<Image::ImageSize> readCoverSizes(const std::string& sizes)
+    {
+        std::vector<Image::ImageSize> res;
+
+        auto addSize{ [&](std::string_view str)
+            {
+                if (const auto size{ StringUtils::readAs<Image::ImageSize>(StringUtils::stringTrim(str)) })
+                    res.push_back(*size);
+                else
+                    throw std::runtime_error{ "Invalid cover size '" + std::string{ str } + "'" };
+            } };
+
+        if (!sizes.empty())
+        {
+            for (std::string_view size : StringUtils::splitString(sizes, ','))
+                addSize(size);
+        }
+        else // same sizes as the ones generated by the scanner
+            Service<IConfig>::get()->visitStrings("cover-pregenerated-sizes", addSize, { "128", "512" });
+
+        return res;
+    }
+
+    // Bounds the number of requests queued in the cover service pool
+    class PendingRequests
+    {
+    public:
+        PendingRequests(std::size_t maxCount) : _maxCount{ maxCount } {}
+
+        void add()
+        {
+            std::unique_lock lock{ _mutex };
+            _cv.wait(lock, [this] { return _count < _maxCount; });
+            _count++;
+        }
+
+        void remove()
+        {
+            {
+                std::scoped_lock lock{ _mutex };
+                _count--;
+            }
+            _cv.notify_all();
+        }
+
+        void waitAll()
+        {
+            std::unique_lock lock{ _mutex };
+            _cv.wait(lock, [this] { return _count == 0; });
+        }
+
+    private:
+        const std::size_t _maxCount;
+        std::mutex _mutex;
+        std::condition_variable _cv;
+        std::size_t _count{};
+    };
+
+    struct GenerateStats
+    {
+        std::atomic<std::size_t> found{};
+        std::atomic<std::size_t> missing{};
+    };
+
+    template <typename IdType, typename AsyncGetFunc>
+    void generateCovers(std::string_view name, const std::vector<IdType>& ids, const std::vector<Image::ImageSize>& sizes, AsyncGetFunc asyncGetFunc)
+    {
+        Cover::ICoverService& coverService{ *Service<Cover::ICoverService>::get() };
+
+        const Cover::ICoverService::ProcessingStats embeddedStatsBefore{ coverService.getProcessingStats(Cover::ICoverService::SourceKind::Embedded) };
+        const Cover::ICoverService::ProcessingStats fileStatsBefore{ coverService.getProcessingStats(Cover::ICoverService::SourceKind::File) };
+
+        PendingRequests pendingRequests{ 64 };
+        GenerateStats stats;
+
+        const auto start{ std::chrono::steady_clock::now() };
+        for (const IdType id : ids)
+        {
+            for (const Image::ImageSize size : sizes)
+            {
+                pendingRequests.add();
+                asyncGetFunc(coverService, id, size, [&](std::shared_ptr<Image::IEncodedImage> image)
+                    {
+                        if (image)
+                            stats.found++;
+                        else
+                            stats.missing++;
+                        pendingRequests.remove();
+                    });
+            }
+        }
+        pendingRequests.waitAll();
+        const std::chrono::duration<double> duration{ std::chrono::steady_clock::now() - start };
+
+        std::cout << std::endl << "*** " << name << " (" << ids.size() << ") ***" << std::endl;
+        std::cout << std::fixed << std::setprecision(2)
+            << "Requests: " << (stats.found + stats.missing) << " (" << stats.missing << " without cover) in " << duration.count() << " s, "
+            << (duration.count() > 0 ? (stats.found + stats.missing) / duration.count() : 0.) << " covers/s" << std::endl;
+
+        auto printProcessingStats{ [](std::string_view sourceName, const Cover::ICoverService::ProcessingStats& before, const Cover::ICoverService::ProcessingStats& after)
+            {
+                const std::size_t count{ after.count - before.count };
+                const double seconds{ std::chrono::duration<double>(after.duration - before.duration).count() };
+
+                std::cout << "Processed from " << sourceName << ": " << count;
+                if (count > 0 && seconds > 0)
+                {
+                    std::cout << ", " << seconds * 1000 / count << " ms/cover, " << count / seconds << " covers/s per thread, "
+                        << (after.sourceSize - before.sourceSize) / 1024. / 1024. / seconds << " MiB/s of source pictures";
+                }
+                std::cout << std::endl;
+            } };
+
+        printProcessingStats("embedded pictures", embeddedStatsBefore, coverService.getProcessingStats(Cover::ICoverService::SourceKind::Embedded));
+        printProcessingStats("image files", fileStatsBefore, coverService.getProcessingStats(Cover::ICoverService::SourceKind::File));
+    }
+
+    void generateAllCovers(Database::Session& session, const std::vector<Image::ImageSize>& sizes)
+    {
+        using namespace Database;
+
+        std::vector<ReleaseId> releaseIds;
+        std::vector<ArtistId> artistIds;
+        {
+            auto transaction{ session.createReadTransaction() };
+            releaseIds = Release::findIds(session, Release::FindParameters{}).results;
+            artistIds = Artist::findIds(session, Artist::FindParameters{}).results;
+        }
+
+        std::cout << "Image backend: " << Image::getBackendName() << std::endl;
+        std::cout << "Sizes:";
+        for (const Image::ImageSize size : sizes)
+            std::cout << " " << size;
+        std::cout << std::endl;
+
+        // Covers already in the file cache are just looked up: pictures are only processed once
+        generateCovers("Releases", releaseIds, sizes, [](Cover::ICoverService& coverService, ReleaseId releaseId, Image::ImageSize size, Cover::ICoverService::CoverCallback callback)
+            {
+                coverService.asyncGetFromRelease(releaseId, size, Image::ImageFormat::JPEG, std::move(callback));
+            });
+        generateCovers("Artists", artistIds, sizes, [](Cover::ICoverService& coverService, ArtistId artistId, Image::ImageSize size, Cover::ICoverService::CoverCallback callback)
+            {
+                coverService.asyncGetFromArtist(artistId, size, Image::ImageFormat::JPEG, std::move(callback));
+            });
+    }
+}
 
 int main(int argc, char* argv[])
 {
@@ -69,6 +227,8 @@ int main(int argc, char* argv[])
             ("conf,c", po::value<std::string>()->default_value("/etc/lms.conf"), "LMS config file")
             ("default-cover,d", po::value<std::string>(), "Default cover path")
             ("tracks,t", "dump covers for tracks")
+            ("generate,g", "generate the covers of all the releases and artists into the cover file cache, and report the throughput")
+            ("sizes", po::value<std::string>()->default_value(""), "Comma separated cover sizes to generate (default is cover-pregenerated-sizes)")
             ("size,s", po::value<unsigned>()->default_value(512), "Requested cover size")
             ("quality,q", po::value<unsigned>()->default_value(75), "JPEG quality (1-100)")
             ;
@@ -92,6 +252,9 @@ int main(int argc, char* argv[])
 
         if (vm.count("tracks"))
             dumpTrackCovers(session, vm["size"].as<unsigned>());
+
+        if (vm.count("generate"))
+            generateAllCovers(session, readCoverSizes(vm["sizes"].as<std::string>()));
     }
     catch (std::exception& e)
     {
@@ -17,25 +17,41 @@
  * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <array>
 #include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
 #include <iostream>
 #include <iomanip>
 #include <filesystem>
+#include <limits>
+#include <mutex>
 #include <optional>
+#include <set>
 #include <stdexcept>
 #include <stdlib.h>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include <boost/program_options.hpp>
 
 #include "database/Db.hpp"
 #include "database/Artist.hpp"
 #include "database/Cluster.hpp"
+#include "database/Listen.hpp"
 #include "database/MediaLibrary.hpp"
 #include "database/Release.hpp"
 #include "database/Session.hpp"
+#include "database/StarredArtist.hpp"
+#include "database/StarredRelease.hpp"
+#include "database/StarredTrack.hpp"
 #include "database/Track.hpp"
 #include "database/TrackArtistLink.hpp"
+#include "database/TrackList.hpp"
+#include "database/User.hpp"
 
 #include "utils/IConfig.hpp"
 #include "utils/Random.hpp"
@@ -50,23 +66,156 @@ namespace
         std::size_t releaseCountPerBatch{ 1000 };
         std::size_t releaseCount{ 100 };
         std::size_t trackCountPerRelease{ 10 };
+        std::size_t artistCount{}; // 0 means computed from the release count
         float compilationRatio{ 0.1 };
+        float extraArtistLinkRatio{ 0.3 }; // ratio of tracks that have composer, producer, performer, ... links
         std::size_t genreCountPerTrack{ 3 };
         std::size_t moodCountPerTrack{ 3 };
         std::size_t genreCount{ 50 };
         std::size_t moodCount{ 25 };
-        std::filesystem::path trackPath;
+        double popularityExponent{ 1.0 }; // Zipf exponent used to pick artists, clusters and listened/starred items
+        std::size_t userCount{ 5 };
+        std::size_t maxListenCountPerUser{ 10000 }; // for the most active user, the next ones get less (power law)
+        std::size_t listenHistoryDays{ 365 * 3 };
+        std::size_t starredTrackCountPerUser{ 200 };
+        std::size_t starredReleaseCountPerUser{ 50 };
+        std::size_t starredArtistCountPerUser{ 20 };
+        std::size_t trackListCountPerUser{ 5 };
+        std::size_t trackCountPerTrackList{ 50 };
+        std::size_t threadCount{ 1 };
+        std::optional<std::filesystem::path> trackPath; // if not set, unique (non existing) paths are generated
     };
 
+    // Zipf distribution over [0, n): the lowest indexes are the most likely to be picked
+    class ZipfDistribution
+    {
+    public:
+        ZipfDistribution(std::size_t n, double exponent)
+            : _cumulativeWeights(n)
+        {
+            double sum{};
+            for (std::size_t i{}; i < n; ++i)
+            {
+                sum += 1.0 / std::pow(static_cast<double>(i + 1), exponent);
+                _cumulativeWeights[i] = sum;
+            }
+
+            for (double& weight : _cumulativeWeights)
+                weight /= sum;
+        }
+
+        std::size_t operator()() const
+        {
+            const double value{ Random::getRealRandom(0.0, 1.0) };
+            const auto it{ std::lower_bound(std::cbegin(_cumulativeWeights), std::cend(_cumulativeWeights), value) };
+            return std::min<std::size_t>(std::distance(std::cbegin(_cumulativeWeights), it), _cumulativeWeights.size() - 1);
+        }
+
+        // distinct values, may return less values than requested
+        std::vector<std::size_t> pickDistinct(std::size_t count) const
+        {
+            count = std::min(count, _cumulativeWeights.size());
+
+            std::set<std::size_t> values;
+            for (std::size_t attempt{}; attempt < count * 10 && values.size() < count; ++attempt)
+                values.insert((*this)());
+
+            return std::vector<std::size_t>(std::cbegin(values), std::cend(values));
+        }
+
+    private:
+        std::vector<double> _cumulativeWeights;
+    };
+
+    // Everything that can be computed outside of the write transaction, indexes refer to the entities created in prepareContext
+    struct ExtraArtistLink
+    {
+        Database::TrackArtistLinkType type;
+        std::string subType;
+        std::size_t artistIndex;
+    };
+
+    struct TrackDescription
+    {
+        std::string name;
+        std::filesystem::path path;
+        std::chrono::seconds duration;
+        UUID trackMBID;
+        UUID recordingMBID;
+        std::size_t artistIndex;
+        std::vector<ExtraArtistLink> extraArtistLinks;
+    };
+
+    struct ReleaseDescription
+    {
+        std::string name;
+        UUID mbid;
+        std::size_t artistIndex;
+        int year;
+        Wt::WDateTime addedTime;
+        std::size_t mediaLibraryIndex;
+        std::vector<std::size_t> genreIndexes;
+        std::vector<std::size_t> moodIndexes;
+        std::vector<TrackDescription> tracks;
+    };
+    using ReleaseBatch = std::vector<ReleaseDescription>;
+
     struct GenerationContext
     {
         Database::Session& session;
         std::vector<Database::MediaLibrary::pointer> mediaLibraries;
         std::vector<Database::Cluster::pointer> genres;
         std::vector<Database::Cluster::pointer> moods;
+        std::vector<Database::Artist::pointer> artists;
+        // filled during generation, sorted by decreasing popularity once the releases are generated
+        std::vector<Database::TrackId> tracks;
+        std::vector<Database::ReleaseId> releases;
         GenerationContext(Database::Session& _session) : session{ _session } {}
     };
 
+    // Release batches produced by the worker threads, consumed by the thread that owns the write transaction
+    class ReleaseBatchQueue
+    {
+    public:
+        ReleaseBatchQueue(std::size_t producerCount, std::size_t maxBatchCount) : _producerCount{ producerCount }, _maxBatchCount{ maxBatchCount } {}
+
+        void push(ReleaseBatch&& batch)
+        {
+            std::unique_lock lock{ _mutex };
+            _condVar.wait(lock, [this] { return _batches.size() < _maxBatchCount; });
+            _batches.push_back(std::move(batch));
+            _condVar.notify_all();
+        }
+
+        void onProducerDone()
+        {
+            std::scoped_lock lock{ _mutex };
+            _producerCount--;
+            _condVar.notify_all();
+        }
+
+        // returns std::nullopt once all producers are done
+        std::optional<ReleaseBatch> pop()
+        {
+            std::unique_lock lock{ _mutex };
+            _condVar.wait(lock, [this] { return !_batches.empty() || _producerCount == 0; });
+            if (_batches.empty())
+                return std::nullopt;
+
+            ReleaseBatch batch{ std::move(_batches.front()) };
+            _batches.pop_front();
+            _condVar.notify_all();
+            return batch;
+        }
+
+    private:
+        std::mutex _mutex;
+        std::condition_variable _condVar;
+        std::size_t _producerCount;
+        const std::size_t _maxBatchCount;
+        std::deque<ReleaseBatch> _batches;
+    };
+
     Database::Cluster::pointer generateCluster(Database::Session& session, Database::ClusterType::pointer clusterType)
     {
         const std::string clusterName{ std::string{ clusterType->getName() } + "-" + std::string{ UUID::generate().getAsString() } };
@@ -80,82 +229,319 @@ namespace
         return session.create<Database::Artist>(artistName, artistMBID);
     }
 
-    void generateRelease(const GeneratorParameters& params, GenerationContext& context)
+    std::size_t getArtistCount(const GeneratorParameters& params)
     {
-        using namespace Database;
+        return params.artistCount ? params.artistCount : std::max<std::size_t>(params.releaseCount / 3, 1);
+    }
 
-        const UUID releaseMBID{ UUID::generate() };
-        const std::string releaseName{ "Release-" + std::string{ UUID::generate().getAsString() } };
-        Release::pointer release{ context.session.create<Release>(releaseName, releaseMBID) };
+    ExtraArtistLink generateExtraArtistLink(const ZipfDistribution& artistDistribution)
+    {
+        using namespace Database;
 
-        Artist::pointer artist{ generateArtist(context.session) };
+        static constexpr std::array<std::string_view, 5> performerRoles{ "", "guitar", "drums", "vocals", "piano" };
+        static constexpr std::array<TrackArtistLinkType, 8> linkTypes{
+            TrackArtistLinkType::Composer,
+            TrackArtistLinkType::Composer,
+            TrackArtistLinkType::Performer,
+            TrackArtistLinkType::Producer,
+            TrackArtistLinkType::Lyricist,
+            TrackArtistLinkType::Mixer,
+            TrackArtistLinkType::Conductor,
+            TrackArtistLinkType::Remixer,
+        };
+
+        ExtraArtistLink link;
+        link.type = *Random::pickRandom(linkTypes);
+        link.artistIndex = artistDistribution();
+        if (link.type == TrackArtistLinkType::Performer)
+            link.subType = *Random::pickRandom(performerRoles);
+
+        return link;
+    }
 
+    ReleaseDescription generateReleaseDescription(const GeneratorParameters& params, const ZipfDistribution& artistDistribution, const ZipfDistribution& genreDistribution, const ZipfDistribution& moodDistribution)
+    {
+        const auto now{ Wt::WDateTime::currentDateTime() };
+
+        ReleaseDescription release;
+        release.name = "Release-" + std::string{ UUID::generate().getAsString() };
+        release.mbid = UUID::generate();
+        release.artistIndex = artistDistribution();
+        release.year = Random::getRandom(1960, 2024);
+        release.addedTime = now.addSecs(-Random::getRandom(0, static_cast<int>(params.listenHistoryDays) * 24 * 3600));
+        release.mediaLibraryIndex = params.mediaLibraryCount > 0 ? static_cast<std::size_t>(Random::getRandom(0, static_cast<int>(params.mediaLibraryCount) - 1)) : 0;
+        // most tracks of a release share the same genres and moods
+        if (params.genreCount > 0 && params.genreCountPerTrack > 0)
+            release.genreIndexes = genreDistribution.pickDistinct(static_cast<std::size_t>(Random::getRandom(1, static_cast<int>(params.genreCountPerTrack))));
+        if (params.moodCount > 0 && params.moodCountPerTrack > 0)
+            release.moodIndexes = moodDistribution.pickDistinct(static_cast<std::size_t>(Random::getRandom(1, static_cast<int>(params.moodCountPerTrack))));
+
+        const bool isCompilation{ Random::getRealRandom(0.f, 1.f) < params.compilationRatio };
+        const std::filesystem::path releasePath{ std::filesystem::path{ "/generated" } / ("Artist-" + std::to_string(release.artistIndex)) / release.name };
+
+        release.tracks.reserve(params.trackCountPerRelease);
         for (std::size_t i{}; i < params.trackCountPerRelease; ++i)
         {
-            Track::pointer track{ context.session.create<Track>(params.trackPath) };
+            TrackDescription track;
+            track.name = "Track-" + std::string{ UUID::generate().getAsString() };
+            track.path = params.trackPath ? *params.trackPath : releasePath / (std::to_string(i + 1) + " - " + track.name + ".flac");
+            track.duration = std::chrono::seconds{ Random::getRandom(30, 600) };
+            track.trackMBID = UUID::generate();
+            track.recordingMBID = UUID::generate();
+            track.artistIndex = isCompilation ? artistDistribution() : release.artistIndex;
+
+            if (Random::getRealRandom(0.f, 1.f) < params.extraArtistLinkRatio)
+            {
+                const int extraLinkCount{ Random::getRandom(1, 4) };
+                for (int link{}; link < extraLinkCount; ++link)
+                    track.extraArtistLinks.push_back(generateExtraArtistLink(artistDistribution));
+            }
+
+            release.tracks.push_back(std::move(track));
+        }
+
+        return release;
+    }
+
+    void writeRelease(GenerationContext& context, const ReleaseDescription& releaseDesc)
+    {
+        using namespace Database;
+
+        Release::pointer release{ context.session.create<Release>(releaseDesc.name, releaseDesc.mbid) };
+        context.releases.push_back(release->getId());
 
-            track.modify()->setName("Track-" + std::string{ UUID::generate().getAsString() });
+        const Artist::pointer& releaseArtist{ context.artists[releaseDesc.artistIndex] };
+
+        std::vector<ObjectPtr<Cluster>> clusters;
+        for (std::size_t genreIndex : releaseDesc.genreIndexes)
+            clusters.push_back(context.genres[genreIndex]);
+        for (std::size_t moodIndex : releaseDesc.moodIndexes)
+            clusters.push_back(context.moods[moodIndex]);
+
+        for (std::size_t i{}; i < releaseDesc.tracks.size(); ++i)
+        {
+            const TrackDescription& trackDesc{ releaseDesc.tracks[i] };
+
+            Track::pointer track{ context.session.create<Track>(trackDesc.path) };
+            context.tracks.push_back(track->getId());
+
+            track.modify()->setName(trackDesc.name);
             track.modify()->setDiscNumber(1);
-            track.modify()->setTrackNumber(i);
-            track.modify()->setDuration(std::chrono::seconds{ Random::getRandom(30, 300) });
+            track.modify()->setTrackNumber(i + 1);
+            track.modify()->setDuration(trackDesc.duration);
+            track.modify()->setYear(releaseDesc.year);
+            track.modify()->setAddedTime(releaseDesc.addedTime);
             track.modify()->setRelease(release);
-            track.modify()->setTrackMBID(UUID::generate());
-            track.modify()->setRecordingMBID(UUID::generate());
-            track.modify()->setTotalTrack(params.trackCountPerRelease);
+            track.modify()->setTrackMBID(trackDesc.trackMBID);
+            track.modify()->setRecordingMBID(trackDesc.recordingMBID);
+            track.modify()->setTotalTrack(releaseDesc.tracks.size());
             if (!context.mediaLibraries.empty())
-                track.modify()->setMediaLibrary(*Random::pickRandom(context.mediaLibraries));
+                track.modify()->setMediaLibrary(context.mediaLibraries[releaseDesc.mediaLibraryIndex]);
 
-            TrackArtistLink::create(context.session, track, artist, TrackArtistLinkType::Artist);
-            TrackArtistLink::create(context.session, track, artist, TrackArtistLinkType::ReleaseArtist);
+            TrackArtistLink::create(context.session, track, context.artists[trackDesc.artistIndex], TrackArtistLinkType::Artist);
+            TrackArtistLink::create(context.session, track, releaseArtist, TrackArtistLinkType::ReleaseArtist);
+            for (const ExtraArtistLink& link : trackDesc.extraArtistLinks)
+                TrackArtistLink::create(context.session, track, context.artists[link.artistIndex], link.type, link.subType);
 
-            std::vector<ObjectPtr<Cluster>> clusters;
-            if (!context.genres.empty())
-                clusters.push_back(*Random::pickRandom(context.genres));
-            if (!context.moods.empty())
-                clusters.push_back(*Random::pickRandom(context.moods));
             track.modify()->setClusters(clusters);
         }
     }
 
-    void generate(const GeneratorParameters& params, GenerationContext& context)
+    void generateReleases(const GeneratorParameters& params, GenerationContext& context)
     {
-        std::size_t remainingCount{ params.releaseCount };
+        const ZipfDistribution artistDistribution{ context.artists.size(), params.popularityExponent };
+        const ZipfDistribution genreDistribution{ std::max<std::size_t>(context.genres.size(), 1), params.popularityExponent };
+        const ZipfDistribution moodDistribution{ std::max<std::size_t>(context.moods.size(), 1), params.popularityExponent };
+
+        // The worker threads prepare the releases, while the current thread writes them using large transactions
+        ReleaseBatchQueue queue{ params.threadCount, params.threadCount * 2 };
 
-        while (remainingCount > 0)
+        std::vector<std::thread> threads;
+        for (std::size_t threadIndex{}; threadIndex < params.threadCount; ++threadIndex)
         {
+            const std::size_t releaseCount{ params.releaseCount / params.threadCount + (threadIndex < params.releaseCount % params.threadCount ? 1 : 0) };
+
+            threads.emplace_back([&, releaseCount]
+                {
+                    std::size_t remainingCount{ releaseCount };
+                    while (remainingCount > 0)
+                    {
+                        ReleaseBatch batch;
+                        for (; batch.size() < params.releaseCountPerBatch && remainingCount > 0; --remainingCount)
+                            batch.push_back(generateReleaseDescription(params, artistDistribution, genreDistribution, moodDistribution));
+
+                        queue.push(std::move(batch));
+                    }
+                    queue.onProducerDone();
+                });
+        }
+
+        std::size_t writtenCount{};
+        while (std::optional<ReleaseBatch> batch{ queue.pop() })
+        {
+            std::cout << "Generating album #" << writtenCount << " / " << params.releaseCount << std::endl;
+
             auto transaction{ context.session.createWriteTransaction() };
-            std::cout << "Generating album #" << params.releaseCount - remainingCount << " / " << params.releaseCount << std::endl;
+            for (const ReleaseDescription& release : *batch)
+                writeRelease(context, release);
 
-            for (std::size_t i{}; i < params.releaseCountPerBatch && remainingCount-- > 0; ++i)
-                generateRelease(params, context);
+            writtenCount += batch->size();
         }
+
+        for (std::thread& thread : threads)
+            thread.join();
     }
 
-    void prepareContext(const GeneratorParameters& params, GenerationContext& context)
+    // Most users listen a lot to a few tracks, the popularity of the tracks follows a Zipf distribution
+    void generateListens(const GeneratorParameters& params, GenerationContext& context, const std::vector<Database::UserId>& users)
+    {
+        using namespace Database;
+
+        if (context.tracks.empty())
+            return;
+
+        const ZipfDistribution trackDistribution{ context.tracks.size(), params.popularityExponent };
+        const auto now{ Wt::WDateTime::currentDateTime() };
+        const int historySecs{ static_cast<int>(std::min<std::size_t>(params.listenHistoryDays * 24 * 3600, std::numeric_limits<int>::max())) };
+
+        for (std::size_t userIndex{}; userIndex < users.size(); ++userIndex)
+        {
+            const std::size_t listenCount{ static_cast<std::size_t>(params.maxListenCountPerUser / std::pow(static_cast<double>(userIndex + 1), params.popularityExponent)) };
+            std::cout << "Generating " << listenCount << " listens for user #" << userIndex << std::endl;
+
+            constexpr std::size_t listenCountPerBatch{ 100000 };
+            for (std::size_t offset{}; offset < listenCount; offset += listenCountPerBatch)
+            {
+                std::vector<Listen::TimedTrack> listens;
+                listens.reserve(std::min(listenCountPerBatch, listenCount - offset));
+                while (listens.size() < std::min(listenCountPerBatch, listenCount - offset))
+                    listens.push_back(Listen::TimedTrack{ context.tracks[trackDistribution()], now.addSecs(-Random::getRandom(0, historySecs)) });
+
+                auto transaction{ context.session.createWriteTransaction() };
+                Listen::createIfNotExist(context.session, users[userIndex], ScrobblingBackend::Internal, SyncState::Synchronized, listens);
+            }
+        }
+    }
+
+    void generateUserData(const GeneratorParameters& params, GenerationContext& context, Database::UserId userId)
     {
+        using namespace Database;
+
         auto transaction{ context.session.createWriteTransaction() };
 
-        // create some random media libraries
-        for (std::size_t i{}; i < params.mediaLibraryCount; ++i)
-            context.mediaLibraries.push_back(context.session.create<Database::MediaLibrary>());
+        const User::pointer user{ User::find(context.session, userId) };
 
-        // create some random genres/moods
+        if (!context.tracks.empty())
         {
-            Database::ClusterType::pointer genre{ Database::ClusterType::find(context.session, "GENRE") };
-            if (!genre)
-                genre = context.session.create<Database::ClusterType>("GENRE");
+            const ZipfDistribution trackDistribution{ context.tracks.size(), params.popularityExponent };
+            for (std::size_t trackIndex : trackDistribution.pickDistinct(params.starredTrackCountPerUser))
+            {
+                const Track::pointer track{ Track::find(context.session, context.tracks[trackIndex]) };
+                if (!StarredTrack::exists(context.session, track->getId(), userId, FeedbackBackend::Internal))
+                    context.session.create<StarredTrack>(track, user, FeedbackBackend::Internal);
+            }
+
+            for (std::size_t i{}; i < params.trackListCountPerUser; ++i)
+            {
+                const std::string name{ "Playlist-" + std::string{ UUID::generate().getAsString() } };
+                const TrackList::pointer trackList{ context.session.create<TrackList>(name, TrackListType::Playlist, Random::getRandom(0, 1) == 1, user) };
+
+                for (std::size_t entry{}; entry < params.trackCountPerTrackList; ++entry)
+                    context.session.create<TrackListEntry>(Track::find(context.session, context.tracks[trackDistribution()]), trackList);
+            }
+        }
+
+        if (!context.releases.empty())
+        {
+            const ZipfDistribution releaseDistribution{ context.releases.size(), params.popularityExponent };
+            for (std::size_t releaseIndex : releaseDistribution.pickDistinct(params.starredReleaseCountPerUser))
+            {
+                const Release::pointer release{ Release::find(context.session, context.releases[releaseIndex]) };
+                if (!StarredRelease::find(context.session, release->getId(), userId, FeedbackBackend::Internal))
+                    context.session.create<StarredRelease>(release, user, FeedbackBackend::Internal);
+            }
+        }
 
-            for (std::size_t i{}; i < params.genreCount; ++i)
-                context.genres.push_back(generateCluster(context.session, genre));
+        const ZipfDistribution artistDistribution{ context.artists.size(), params.popularityExponent };
+        for (std::size_t artistIndex : artistDistribution.pickDistinct(params.starredArtistCountPerUser))
+        {
+            const Artist::pointer& artist{ context.artists[artistIndex] };
+            if (!StarredArtist::find(context.session, artist->getId(), userId, FeedbackBackend::Internal))
+                context.session.create<StarredArtist>(artist, user, FeedbackBackend::Internal);
         }
+    }
 
+    void generateUsers(const GeneratorParameters& params, GenerationContext& context)
+    {
+        using namespace Database;
+
+        std::vector<UserId> users;
         {
-            Database::ClusterType::pointer mood{ Database::ClusterType::find(context.session, "MOOD") };
-            if (!mood)
-                mood = context.session.create<Database::ClusterType>("MOOD");
+            auto transaction{ context.session.createWriteTransaction() };
+
+            for (std::size_t i{}; i < params.userCount; ++i)
+            {
+                const std::string loginName{ "gen-user-" + std::to_string(i) };
 
-            for (std::size_t i{}; i < params.moodCount; ++i)
-                context.moods.push_back(generateCluster(context.session, mood));
+                User::pointer user{ User::find(context.session, loginName) };
+                if (!user)
+                    user = context.session.create<User>(loginName);
+                users.push_back(user->getId());
+            }
+        }
+
+        // the most popular items are not the first created ones
+        Random::shuffleContainer(context.tracks);
+        Random::shuffleContainer(context.releases);
+        Random::shuffleContainer(context.artists);
+
+        generateListens(params, context, users);
+
+        for (std::size_t i{}; i < users.size(); ++i)
+        {
+            std::cout << "Generating stars and playlists for user #" << i << std::endl;
+            generateUserData(params, context, users[i]);
+        }
+    }
+
+    void prepareContext(const GeneratorParameters& params, GenerationContext& context)
+    {
+        {
+            auto transaction{ context.session.createWriteTransaction() };
+
+            // create some random media libraries
+            for (std::size_t i{}; i < params.mediaLibraryCount; ++i)
+                context.mediaLibraries.push_back(context.session.create<Database::MediaLibrary>());
+
+            // create some random genres/moods
+            {
+                Database::ClusterType::pointer genre{ Database::ClusterType::find(context.session, "GENRE") };
+                if (!genre)
+                    genre = context.session.create<Database::ClusterType>("GENRE");
+
+                for (std::size_t i{}; i < params.genreCount; ++i)
+                    context.genres.push_back(generateCluster(context.session, genre));
+            }
+
+            {
+                Database::ClusterType::pointer mood{ Database::ClusterType::find(context.session, "MOOD") };
+                if (!mood)
+                    mood = context.session.create<Database::ClusterType>("MOOD");
+
+                for (std::size_t i{}; i < params.moodCount; ++i)
+                    context.moods.push_back(generateCluster(context.session, mood));
+            }
+        }
+
+        // artists are shared by the releases
+        const std::size_t artistCount{ getArtistCount(params) };
+        while (context.artists.size() < artistCount)
+        {
+            auto transaction{ context.session.createWriteTransaction() };
+            std::cout << "Generating artist #" << context.artists.size() << " / " << artistCount << std::endl;
+
+            for (std::size_t i{}; i < params.releaseCountPerBatch * params.trackCountPerRelease && context.artists.size() < artistCount; ++i)
+                context.artists.push_back(generateArtist(context.session));
         }
     }
 }
@@ -178,12 +564,24 @@ int main(int argc, char* argv[])
             ("release-count-per-batch", po::value<unsigned>()->default_value(defaultParams.releaseCountPerBatch), "Number of releases to generate before committing transaction")
             ("release-count", po::value<unsigned>()->default_value(defaultParams.releaseCount), "Number of releases to generate")
             ("track-count-per-release", po::value<unsigned>()->default_value(defaultParams.trackCountPerRelease), "Number of tracks per release")
+            ("artist-count", po::value<unsigned>()->default_value(defaultParams.artistCount), "Number of artists to generate (0 means a third of the release count)")
             ("compilation-ratio", po::value<float>()->default_value(defaultParams.compilationRatio), "Compilation ratio (compilation means all tracks have a different artist)")
-            ("track-path", po::value<std::string>()->required(), "Path of a valid track file, that will be used for all generated tracks")
+            ("extra-artist-link-ratio", po::value<float>()->default_value(defaultParams.extraArtistLinkRatio), "Ratio of tracks that also have composers, performers, producers, etc.")
+            ("track-path", po::value<std::string>(), "Path of a valid track file, that will be used for all generated tracks. If not set, unique non existing paths are generated")
             ("genre-count", po::value<unsigned>()->default_value(defaultParams.genreCount), "Number of genres to generate")
-            ("genre-count-per-track", po::value<unsigned>()->default_value(defaultParams.genreCountPerTrack), "Number of genres to assign to each track")
+            ("genre-count-per-track", po::value<unsigned>()->default_value(defaultParams.genreCountPerTrack), "Max number of genres to assign to each track")
             ("mood-count", po::value<unsigned>()->default_value(defaultParams.moodCount), "Number of moods to generate")
-            ("mood-count-per-track", po::value<unsigned>()->default_value(defaultParams.moodCountPerTrack), "Number of moods to assign to each track")
+            ("mood-count-per-track", po::value<unsigned>()->default_value(defaultParams.moodCountPerTrack), "Max number of moods to assign to each track")
+            ("popularity-exponent", po::value<double>()->default_value(defaultParams.popularityExponent), "Zipf exponent used to pick artists, genres, moods, listened and starred items")
+            ("user-count", po::value<unsigned>()->default_value(defaultParams.userCount), "Number of users to generate")
+            ("max-listen-count-per-user", po::value<unsigned>()->default_value(defaultParams.maxListenCountPerUser), "Number of listens of the most active user, the other users get less")
+            ("listen-history-days", po::value<unsigned>()->default_value(defaultParams.listenHistoryDays), "Listens and additions are spread over this number of days")
+            ("starred-track-count-per-user", po::value<unsigned>()->default_value(defaultParams.starredTrackCountPerUser), "Number of starred tracks per user")
+            ("starred-release-count-per-user", po::value<unsigned>()->default_value(defaultParams.starredReleaseCountPerUser), "Number of starred releases per user")
+            ("starred-artist-count-per-user", po::value<unsigned>()->default_value(defaultParams.starredArtistCountPerUser), "Number of starred artists per user")
+            ("tracklist-count-per-user", po::value<unsigned>()->default_value(defaultParams.trackListCountPerUser), "Number of playlists per user")
+            ("track-count-per-tracklist", po::value<unsigned>()->default_value(defaultParams.trackCountPerTrackList), "Number of tracks per playlist")
+            ("threads,j", po::value<unsigned>()->default_value(std::max(std::thread::hardware_concurrency(), 1U)), "Number of threads used to prepare the releases")
             ("help,h", "produce help message")
             ;
 
@@ -200,25 +598,46 @@ int main(int argc, char* argv[])
 
         GeneratorParameters genParams;
         genParams.mediaLibraryCount = vm["media-library-count"].as<unsigned>();
-        genParams.releaseCountPerBatch = vm["release-count-per-batch"].as<unsigned>();
+        genParams.releaseCountPerBatch = std::max(vm["release-count-per-batch"].as<unsigned>(), 1U);
         genParams.releaseCount = vm["release-count"].as<unsigned>();
         genParams.trackCountPerRelease = vm["track-count-per-release"].as<unsigned>();
+        genParams.artistCount = vm["artist-count"].as<unsigned>();
         genParams.compilationRatio = vm["compilation-ratio"].as<float>();
-        genParams.trackPath = std::filesystem::path{ vm["track-path"].as<std::string>() };
-
-        if (!std::filesystem::exists(genParams.trackPath))
-            throw std::runtime_error{ "File '" + genParams.trackPath.string() + "' does not exist!" };
+        genParams.extraArtistLinkRatio = vm["extra-artist-link-ratio"].as<float>();
+        genParams.genreCount = vm["genre-count"].as<unsigned>();
+        genParams.genreCountPerTrack = vm["genre-count-per-track"].as<unsigned>();
+        genParams.moodCount = vm["mood-count"].as<unsigned>();
+        genParams.moodCountPerTrack = vm["mood-count-per-track"].as<unsigned>();
+        genParams.popularityExponent = vm["popularity-exponent"].as<double>();
+        genParams.userCount = vm["user-count"].as<unsigned>();
+        genParams.maxListenCountPerUser = vm["max-listen-count-per-user"].as<unsigned>();
+        genParams.listenHistoryDays = std::max(vm["listen-history-days"].as<unsigned>(), 1U);
+        genParams.starredTrackCountPerUser = vm["starred-track-count-per-user"].as<unsigned>();
+        genParams.starredReleaseCountPerUser = vm["starred-release-count-per-user"].as<unsigned>();
+        genParams.starredArtistCountPerUser = vm["starred-artist-count-per-user"].as<unsigned>();
+        genParams.trackListCountPerUser = vm["tracklist-count-per-user"].as<unsigned>();
+        genParams.trackCountPerTrackList = vm["track-count-per-tracklist"].as<unsigned>();
+        genParams.threadCount = std::max(vm["threads"].as<unsigned>(), 1U);
+        if (vm.count("track-path"))
+        {
+            genParams.trackPath = std::filesystem::path{ vm["track-path"].as<std::string>() };
+            if (!std::filesystem::exists(*genParams.trackPath))
+                throw std::runtime_error{ "File '" + genParams.trackPath->string() + "' does not exist!" };
+        }
 
         Service<IConfig> config{ createConfig(vm["conf"].as<std::string>()) };
         Database::Db db{ config->getPath("working-dir") / "lms.db" };
         Database::Session session{ db };
         std::cout << "Starting generation..." << std::endl;
 
+        const auto start{ std::chrono::steady_clock::now() };
+
         GenerationContext genContext{ session };
         prepareContext(genParams, genContext);
-        generate(genParams, genContext);
+        generateReleases(genParams, genContext);
+        generateUsers(genParams, genContext);
 
-        std::cout << "Generation complete!" << std::endl;
+        std::cout << "Generation complete in " << std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - start).count() << "s!" << std::endl;
     }
     catch (std::exception& e)
     {
@@ -227,4 +646,4 @@ int main(int argc, char* argv[])
     }
 
     return EXIT_SUCCESS;
-}
+}
\ No newline at end of file
@@ -0,0 +1,282 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include "metadata/Exception.hpp"
+#include "metadata/IParser.hpp"
+#include "utils/ILogger.hpp"
+#include "utils/Path.hpp"
+#include "utils/Service.hpp"
+#include "utils/StreamLogger.hpp"
+#include "utils/String.hpp"
+
+namespace
+{
+    struct File
+    {
+        std::filesystem::path path;
+        std::string format; // lower case extension
+        std::uintmax_t size{};
+    };
+
+    struct FormatStats
+    {
+        std::size_t fileCount{};
+        std::size_t failureCount{};
+        std::uintmax_t fileSize{};
+        std::chrono::nanoseconds parseDuration{}; // summed over all the threads
+
+        FormatStats& operator+=(const FormatStats& other)
+        {
+            fileCount += other.fileCount;
+            failureCount += other.failureCount;
+            fileSize += other.fileSize;
+            parseDuration += other.parseDuration;
+            return *this;
+        }
+    };
+
+    struct Backend
+    {
+        std::string_view name;
+        MetaData::ParserBackend backend;
+    };
+
+    constexpr Backend backends[]
+    {
+        { "taglib", MetaData::ParserBackend::TagLib },
+        { "avformat", MetaData::ParserBackend::AvFormat },
+        { "lightweight", MetaData::ParserBackend::Lightweight },
+    };
+
+    MetaData::ParserReadStyle readStyleFromString(std::string_view str)
+    {
+        if (str == "fast")
+            return MetaData::ParserReadStyle::Fast;
+        if (str == "average")
+            return MetaData::ParserReadStyle::Average;
+        if (str == "accurate")
+            return MetaData::ParserReadStyle::Accurate;
+
+        throw std::runtime_error{ "Invalid read style '" + std::string{ str } + "'" };
+    }
+
+    // Bytes read by this process using read syscalls, including the page cache hits (Linux only)
+    std::optional<std::uintmax_t> getReadByteCount()
+    {
+        std::ifstream ifs{ "/proc/self/io" };
+        std::string key;
+        std::uintmax_t value;
+        while (ifs >> key >> value)
+        {
+            if (key == "rchar:")
+                return value;
+        }
+
+        return std::nullopt;
+    }
+
+    std::vector<File> collectFiles(const std::filesystem::path& directory, const std::vector<std::filesystem::path>& extensions)
+    {
+        std::vector<File> files;
+
+        PathUtils::exploreFilesRecursive(directory, [&](std::error_code ec, const std::filesystem::path& path)
+            {
+                if (ec || !PathUtils::hasFileAnyExtension(path, extensions))
+                    return true;
+
+                std::error_code sizeEc;
+                const std::uintmax_t size{ std::filesystem::file_size(path, sizeEc) };
+                if (!sizeEc)
+                    files.push_back(File{ path, StringUtils::stringToLower(path.extension().string()), size });
+
+                return true;
+            });
+
+        // make runs comparable
+        std::sort(std::begin(files), std::end(files), [](const File& lhs, const File& rhs) { return lhs.path < rhs.path; });
+
+        return files;
+    }
+
+    std::map<std::string, FormatStats> parseFiles(MetaData::IParser& parser, const std::vector<File>& files, std::size_t threadCount)
+    {
+        std::atomic<std::size_t> nextFileIndex{};
+        std::mutex statsMutex;
+        std::map<std::string, FormatStats> stats;
+
+        auto worker{ [&]
+            {
+                std::map<std::string, FormatStats> threadStats;
+
+                for (std::size_t fileIndex{ nextFileIndex++ }; fileIndex < files.size(); fileIndex = nextFileIndex++)
+                {
+                    const File& file{ files[fileIndex] };
+                    FormatStats& formatStats{ threadStats[file.format] };
+
+                    const auto start{ std::chrono::steady_clock::now() };
+                    try
+                    {
+                        parser.parse(file.path);
+                    }
+                    catch (const MetaData::Exception&)
+                    {
+                        formatStats.failureCount++;
+                    }
+                    formatStats.parseDuration += std::chrono::steady_clock::now() - start;
+                    formatStats.fileCount++;
+                    formatStats.fileSize += file.size;
+                }
+
+                const std::scoped_lock lock{ statsMutex };
+                for (const auto& [format, formatStats] : threadStats)
+                    stats[format] += formatStats;
+            } };
+
+        std::vector<std::thread> threads;
+        for (std::size_t i{}; i < threadCount; ++i)
+            threads.emplace_back(worker);
+        for (std::thread& thread : threads)
+            thread.join();
+
+        return stats;
+    }
+
+    void printStats(std::string_view format, const FormatStats& stats)
+    {
+        const double parseSeconds{ std::chrono::duration<double>{ stats.parseDuration }.count() };
+
+        std::cout << "  " << std::left << std::setw(8) << format << std::right
+            << std::setw(8) << stats.fileCount << " files"
+            << std::setw(6) << stats.failureCount << " failures"
+            << std::setw(10) << std::fixed << std::setprecision(1) << (stats.fileSize / 1024. / 1024.) << " MB"
+            << std::setw(10) << std::setprecision(3) << (stats.fileCount ? parseSeconds * 1000. / stats.fileCount : 0.) << " ms/file (per thread)" << std::endl;
+    }
+
+    void runBenchmark(const Backend& backend, MetaData::ParserReadStyle readStyle, const std::vector<File>& files, std::size_t threadCount, bool warmup)
+    {
+        std::cout << "Backend '" << backend.name << "':" << std::endl;
+
+        const std::unique_ptr<MetaData::IParser> parser{ MetaData::createParser(backend.backend, readStyle) };
+        if (warmup)
+            parseFiles(*parser, files, threadCount);
+
+        const std::optional<std::uintmax_t> readByteCountBefore{ getReadByteCount() };
+        const auto start{ std::chrono::steady_clock::now() };
+        const std::map<std::string, FormatStats> stats{ parseFiles(*parser, files, threadCount) };
+        const double seconds{ std::chrono::duration<double>{ std::chrono::steady_clock::now() - start }.count() };
+        const std::optional<std::uintmax_t> readByteCountAfter{ getReadByteCount() };
+
+        FormatStats total;
+        for (const auto& [format, formatStats] : stats)
+        {
+            printStats(format, formatStats);
+            total += formatStats;
+        }
+        printStats("total", total);
+
+        std::cout << "  " << std::fixed << std::setprecision(1) << (seconds > 0 ? total.fileCount / seconds : 0.) << " files/s (" << std::setprecision(3) << seconds << " s)";
+        if (readByteCountBefore && readByteCountAfter)
+            std::cout << ", " << std::setprecision(1) << ((*readByteCountAfter - *readByteCountBefore) / 1024. / 1024.) << " MB read";
+        std::cout << std::endl << std::endl;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        namespace po = boost::program_options;
+
+        po::options_description desc{ "Allowed options" };
+        desc.add_options()
+            ("help,h", "print usage message")
+            ("directory,d", po::value<std::string>(), "corpus directory, recursively explored")
+            ("backends,b", po::value<std::vector<std::string>>()->multitoken()->default_value({ "taglib", "avformat" }, "taglib avformat"), "parser backends to benchmark: taglib, avformat, lightweight")
+            ("read-style,r", po::value<std::string>()->default_value("average"), "TagLib read style: fast, average or accurate")
+            ("threads,t", po::value<std::size_t>()->default_value(1), "number of parsing threads (0 means number of logical CPUs)")
+            ("extensions,e", po::value<std::vector<std::string>>()->multitoken()->default_value({ ".mp3", ".flac", ".ogg", ".oga", ".opus", ".m4a", ".m4b", ".wma", ".ape", ".mpc", ".wv", ".wav", ".aif", ".aiff", ".dsf" }, "common audio extensions"), "file extensions to parse")
+            ("warmup,w", "parse the corpus once before measuring, to fill the page cache")
+            ;
+
+        po::positional_options_description positional;
+        positional.add("directory", 1);
+
+        po::variables_map vm;
+        po::store(po::command_line_parser(argc, argv).options(desc).positional(positional).run(), vm);
+        po::notify(vm);
+
+        if (vm.count("help") || !vm.count("directory"))
+        {
+            std::cout << "Usage: " << argv[0] << " [options] <directory>" << std::endl << desc << std::endl;
+            return vm.count("help") ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+
+        // only report real problems, parse failures are counted
+        Service<ILogger> logger{ std::make_unique<StreamLogger>(std::cerr, EnumSet<Severity>{ Severity::FATAL }) };
+
+        const MetaData::ParserReadStyle readStyle{ readStyleFromString(vm["read-style"].as<std::string>()) };
+        std::size_t threadCount{ vm["threads"].as<std::size_t>() };
+        if (threadCount == 0)
+            threadCount = std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+
+        std::vector<std::filesystem::path> extensions;
+        for (const std::string& extension : vm["extensions"].as<std::vector<std::string>>())
+            extensions.push_back(StringUtils::stringToLower(extension));
+
+        std::vector<const Backend*> selectedBackends;
+        for (const std::string& backendName : vm["backends"].as<std::vector<std::string>>())
+        {
+            auto itBackend{ std::find_if(std::cbegin(backends), std::cend(backends), [&](const Backend& backend) { return backend.name == backendName; }) };
+            if (itBackend == std::cend(backends))
+                throw std::runtime_error{ "Invalid backend '" + backendName + "'" };
+            selectedBackends.push_back(&*itBackend);
+        }
+
+        const std::vector<File> files{ collectFiles(vm["directory"].as<std::string>(), extensions) };
+        std::cout << "Parsing " << files.size() << " files using " << threadCount << " thread(s), read style = " << vm["read-style"].as<std::string>() << std::endl << std::endl;
+
+        for (const Backend* backend : selectedBackends)
+            runBenchmark(*backend, readStyle, files, threadCount, vm.count("warmup") > 0);
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Caught exception: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -252,6 +252,17 @@ int main(int argc, char* argv[])
             {
                 std::cerr << "Parsing failed: " << e.what() << std::endl;
             }
+
+            try
+            {
+                std::cout << "Using lightweight:" << std::endl;
+                auto parser{ MetaData::createParser(MetaData::ParserBackend::Lightweight, MetaData::ParserReadStyle::Accurate) };
+                parse(*parser, file);
+            }
+            catch (MetaData::Exception& e)
+            {
+                std::cerr << "Parsing failed: " << e.what() << std::endl;
+            }
         }
     }
     catch (std::exception& e)
@@ -17,10 +17,19 @@
  * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <filesystem>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <optional>
 #include <stdexcept>
 #include <stdlib.h>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #include <boost/program_options.hpp>
 
@@ -33,11 +42,192 @@
 #include "database/Types.hpp"
 #include "services/recommendation/IRecommendationService.hpp"
 #include "utils/IConfig.hpp"
+#include "utils/Random.hpp"
 #include "utils/Service.hpp"
 #include "utils/StreamLogger.hpp"
+#include "utils/String.hpp"
 
 using namespace Database;
 
+namespace
+{
+    // Resident set size, in KiB (Linux only)
+    // VmRSS for the current value, VmHWM for the peak value since the last reset
+    std::optional<std::size_t> readRSS(std::string_view field)
+    {
+        std::ifstream ifs{ "/proc/self/status" };
+        std::string line;
+        while (std::getline(ifs, line))
+        {
+            if (line.starts_with(field) && line.size() > field.size() && line[field.size()] == ':')
+            {
+                const std::string_view sizeStr{ std::string_view{ line }.substr(field.size() + 1) };
+                for (std::string_view value : StringUtils::splitString(sizeStr, ' '))
+                {
+                    if (const auto size{ StringUtils::readAs<std::size_t>(value) })
+                        return size;
+                }
+            }
+        }
+        return std::nullopt;
+    }
+
+    void resetPeakRSS()
+    {
+        std::ofstream ofs{ "/proc/self/clear_refs" };
+        ofs << "5";
+    }
+
+    std::string_view getEngineName(Recommendation::EngineType engineType)
+    {
+        switch (engineType)
+        {
+        case Recommendation::EngineType::Clusters: return "clusters";
+        case Recommendation::EngineType::Features: return "features";
+        case Recommendation::EngineType::NearestNeighbours: return "nearest-neighbours";
+        }
+        return "";
+    }
+
+    std::vector<Recommendation::EngineType> parseEngineTypes(const std::string& str)
+    {
+        std::vector<Recommendation::EngineType> res;
+        for (std::string_view name : StringUtils::splitString(str, ','))
+        {
+            name = StringUtils::stringTrim(name);
+            if (name.empty())
+                continue;
+
+            if (name == "clusters")
+                res.push_back(Recommendation::EngineType::Clusters);
+            else if (name == "features")
+                res.push_back(Recommendation::EngineType::Features);
+            else if (name == "nearest-neighbours")
+                res.push_back(Recommendation::EngineType::NearestNeighbours);
+            else
+                throw std::runtime_error{ "Unknown engine '" + std::string{ name } + "'" };
+        }
+        return res;
+    }
+
+    // Distinct seeds, so that the results cache of the service is never hit
+    template <typename IdType>
+    std::vector<IdType> pickSeeds(std::vector<IdType> ids, std::size_t seedCount)
+    {
+        Random::shuffleContainer(ids);
+        if (ids.size() > seedCount)
+            ids.resize(seedCount);
+        return ids;
+    }
+
+    struct Latencies
+    {
+        std::vector<std::chrono::microseconds> values;
+        std::size_t resultCount{};
+    };
+
+    template <typename IdType, typename Func>
+    Latencies measure(const std::vector<IdType>& seeds, Func func)
+    {
+        Latencies latencies;
+        latencies.values.reserve(seeds.size());
+        for (const IdType seed : seeds)
+        {
+            const auto start{ std::chrono::steady_clock::now() };
+            latencies.resultCount += func(seed).size();
+            latencies.values.push_back(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start));
+        }
+        return latencies;
+    }
+
+    void printLatencies(std::string_view name, Latencies& latencies)
+    {
+        std::sort(std::begin(latencies.values), std::end(latencies.values));
+
+        // nearest rank
+        auto percentile{ [&](double p) -> double
+            {
+                if (latencies.values.empty())
+                    return 0;
+
+                const std::size_t rank{ static_cast<std::size_t>(std::ceil(p / 100 * latencies.values.size())) };
+                return latencies.values[std::clamp<std::size_t>(rank, 1, latencies.values.size()) - 1].count() / 1000.;
+            } };
+
+        double meanMs{};
+        for (std::chrono::microseconds latency : latencies.values)
+            meanMs += latency.count() / 1000.;
+        if (!latencies.values.empty())
+            meanMs /= latencies.values.size();
+
+        std::cout << std::left << std::setw(20) << name << std::right
+            << std::setw(8) << latencies.values.size()
+            << std::fixed << std::setprecision(1)
+            << std::setw(10) << (latencies.values.empty() ? 0. : static_cast<double>(latencies.resultCount) / latencies.values.size())
+            << std::setprecision(3)
+            << std::setw(10) << meanMs
+            << std::setw(10) << percentile(50)
+            << std::setw(10) << percentile(90)
+            << std::setw(10) << percentile(99)
+            << std::setw(10) << (latencies.values.empty() ? 0. : latencies.values.back().count() / 1000.) << std::endl;
+    }
+
+    void benchmarkEngines(Db& db, const std::vector<Recommendation::EngineType>& engineTypes, std::size_t seedCount, unsigned maxSimilarityCount)
+    {
+        Session session{ db };
+
+        std::vector<TrackId> trackIds;
+        std::vector<ReleaseId> releaseIds;
+        std::vector<ArtistId> artistIds;
+        {
+            auto transaction{ session.createReadTransaction() };
+            trackIds = pickSeeds(Track::findIds(session, Track::FindParameters{}).results, seedCount);
+            releaseIds = pickSeeds(Release::findIds(session, Release::FindParameters{}).results, seedCount);
+            artistIds = pickSeeds(Artist::findIds(session, Artist::FindParameters{}).results, seedCount);
+        }
+        std::cout << "Seeds: " << trackIds.size() << " tracks, " << releaseIds.size() << " releases, " << artistIds.size() << " artists" << std::endl;
+
+        for (const Recommendation::EngineType engineType : engineTypes)
+        {
+            std::cout << std::endl << "*** Engine '" << getEngineName(engineType) << "' ***" << std::endl;
+
+            const std::optional<std::size_t> rssBefore{ readRSS("VmRSS") };
+            resetPeakRSS();
+
+            // loading is started by the service creation, the engine caches are used if up to date
+            const auto loadStart{ std::chrono::steady_clock::now() };
+            auto recommendationService{ Recommendation::createRecommendationService(db, engineType) };
+            recommendationService->waitLoaded();
+            const std::chrono::duration<double> loadDuration{ std::chrono::steady_clock::now() - loadStart };
+
+            const std::optional<std::size_t> rssAfter{ readRSS("VmRSS") };
+            const std::optional<std::size_t> peakRSS{ readRSS("VmHWM") };
+
+            std::cout << "Load: " << std::fixed << std::setprecision(2) << loadDuration.count() << " s" << std::endl;
+            if (rssBefore && rssAfter)
+                std::cout << "Memory: " << (static_cast<double>(*rssAfter) - static_cast<double>(*rssBefore)) / 1024. << " MiB resident after load, " << (peakRSS ? *peakRSS / 1024. : 0.) << " MiB peak" << std::endl;
+
+            std::cout << std::left << std::setw(20) << "call" << std::right
+                << std::setw(8) << "count"
+                << std::setw(10) << "results"
+                << std::setw(10) << "mean ms"
+                << std::setw(10) << "p50 ms"
+                << std::setw(10) << "p90 ms"
+                << std::setw(10) << "p99 ms"
+                << std::setw(10) << "max ms" << std::endl;
+
+            Latencies trackLatencies{ measure(trackIds, [&](TrackId trackId) { return recommendationService->findSimilarTracks(std::vector<TrackId>{ trackId }, maxSimilarityCount); }) };
+            printLatencies("findSimilarTracks", trackLatencies);
+
+            Latencies releaseLatencies{ measure(releaseIds, [&](ReleaseId releaseId) { return recommendationService->getSimilarReleases(releaseId, maxSimilarityCount); }) };
+            printLatencies("getSimilarReleases", releaseLatencies);
+
+            Latencies artistLatencies{ measure(artistIds, [&](ArtistId artistId) { return recommendationService->getSimilarArtists(artistId, { TrackArtistLinkType::Artist, TrackArtistLinkType::ReleaseArtist }, maxSimilarityCount); }) };
+            printLatencies("getSimilarArtists", artistLatencies);
+        }
+    }
+}
+
 static void dumpTracksRecommendation(Session session, Recommendation::IRecommendationService& recommendationService, unsigned maxSimilarityCount)
 {
     const RangeResults<TrackId> trackIds{ [&]
@@ -141,6 +331,9 @@ int main(int argc, char* argv[])
             ("releases,r", "Display recommendation for releases")
             ("tracks,t", "Display recommendation for tracks")
             ("max,m", po::value<unsigned>()->default_value(3), "Max similarity result count")
+            ("bench,b", "Measure the load time, the memory usage and the lookup latencies of each engine")
+            ("engines", po::value<std::string>()->default_value("clusters,features,nearest-neighbours"), "Engines to benchmark, comma separated")
+            ("seeds", po::value<std::size_t>()->default_value(1000), "Number of random seeds looked up for each call, in bench mode")
             ;
 
         po::variables_map vm;
@@ -157,12 +350,18 @@ int main(int argc, char* argv[])
         Db db{ config->getPath("working-dir") / "lms.db" };
         Session session{ db };
 
+        if (vm.count("bench"))
+        {
+            benchmarkEngines(db, parseEngineTypes(vm["engines"].as<std::string>()), vm["seeds"].as<std::size_t>(), vm["max"].as<unsigned>());
+            return EXIT_SUCCESS;
+        }
+
         std::cout << "Creating recommendation service..." << std::endl;
         const auto recommendationService{ Recommendation::createRecommendationService(db) };
         std::cout << "Recommendation service created!" << std::endl;
 
         std::cout << "Loading recommendation service..." << std::endl;
-        recommendationService->load();
+        recommendationService->waitLoaded(); // loading is started by the service creation
 
         unsigned maxSimilarityCount{ vm["max"].as<unsigned>() };
 
@@ -0,0 +1,767 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include "database/Db.hpp"
+#include "database/MediaLibrary.hpp"
+#include "database/Session.hpp"
+#include "services/cover/ICoverService.hpp"
+#include "services/scanner/IScannerService.hpp"
+#include "utils/IConfig.hpp"
+#include "utils/Service.hpp"
+#include "utils/StreamLogger.hpp"
+#include "utils/String.hpp"
+
+// Generates a synthetic media library, then measures the initial scan, a scan without any change and a scan after some files are modified
+namespace
+{
+    using Bytes = std::vector<std::byte>;
+
+    void append(Bytes& bytes, std::string_view str)
+    {
+        for (char c : str)
+            bytes.push_back(static_cast<std::byte>(c));
+    }
+
+    void append(Bytes& bytes, const Bytes& other)
+    {
+        bytes.insert(std::cend(bytes), std::cbegin(other), std::cend(other));
+    }
+
+    void appendBE(Bytes& bytes, std::uint32_t value, std::size_t size)
+    {
+        for (std::size_t i{ size }; i-- > 0;)
+            bytes.push_back(static_cast<std::byte>((value >> (i * 8)) & 0xFF));
+    }
+
+    void appendLE(Bytes& bytes, std::uint64_t value, std::size_t size)
+    {
+        for (std::size_t i{}; i < size; ++i)
+            bytes.push_back(static_cast<std::byte>((value >> (i * 8)) & 0xFF));
+    }
+
+    void appendSyncSafe(Bytes& bytes, std::uint32_t value)
+    {
+        for (std::size_t i{ 4 }; i-- > 0;)
+            bytes.push_back(static_cast<std::byte>((value >> (i * 7)) & 0x7F));
+    }
+
+    std::uint32_t computeCrc32(std::span<const std::byte> data)
+    {
+        std::uint32_t crc{ 0xFFFFFFFF };
+        for (std::byte b : data)
+        {
+            crc ^= static_cast<std::uint32_t>(b);
+            for (int i{}; i < 8; ++i)
+                crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+        return ~crc;
+    }
+
+    // Ogg uses a non reflected CRC
+    std::uint32_t computeOggCrc(std::span<const std::byte> data)
+    {
+        std::uint32_t crc{};
+        for (std::byte b : data)
+        {
+            crc ^= static_cast<std::uint32_t>(b) << 24;
+            for (int i{}; i < 8; ++i)
+                crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04C11DB7 : crc << 1;
+        }
+        return crc;
+    }
+
+    struct Tag
+    {
+        std::string name; // vorbis comment name
+        std::string value;
+    };
+
+    struct TrackInfo
+    {
+        std::vector<Tag> tags;
+        std::chrono::seconds duration;
+        std::optional<Bytes> embeddedCover;
+    };
+
+    // Uncompressed PNG (stored deflate blocks), readable by all the image backends
+    Bytes generatePNG(std::size_t size, std::uint32_t seed)
+    {
+        Bytes raw;
+        for (std::size_t y{}; y < size; ++y)
+        {
+            raw.push_back(std::byte{ 0 }); // no filter
+            for (std::size_t x{}; x < size; ++x)
+            {
+                raw.push_back(static_cast<std::byte>((x + seed) & 0xFF));
+                raw.push_back(static_cast<std::byte>((y + seed * 3) & 0xFF));
+                raw.push_back(static_cast<std::byte>((x ^ y) & 0xFF));
+            }
+        }
+
+        Bytes zlib{ std::byte{ 0x78 }, std::byte{ 0x01 } };
+        for (std::size_t offset{}; offset < raw.size(); offset += 65535)
+        {
+            const std::size_t blockSize{ std::min<std::size_t>(65535, raw.size() - offset) };
+            zlib.push_back(offset + blockSize == raw.size() ? std::byte{ 1 } : std::byte{ 0 });
+            appendLE(zlib, blockSize, 2);
+            appendLE(zlib, ~blockSize & 0xFFFF, 2);
+            zlib.insert(std::cend(zlib), std::cbegin(raw) + offset, std::cbegin(raw) + offset + blockSize);
+        }
+        std::uint32_t a{ 1 };
+        std::uint32_t b{};
+        for (std::byte c : raw)
+        {
+            a = (a + static_cast<std::uint32_t>(c)) % 65521;
+            b = (b + a) % 65521;
+        }
+        appendBE(zlib, (b << 16) | a, 4);
+
+        auto appendChunk{ [](Bytes& png, std::string_view type, const Bytes& data)
+            {
+                appendBE(png, static_cast<std::uint32_t>(data.size()), 4);
+                const std::size_t crcStart{ png.size() };
+                append(png, type);
+                append(png, data);
+                appendBE(png, computeCrc32(std::span{ png }.subspan(crcStart)), 4);
+            } };
+
+        Bytes png{ std::byte{ 0x89 } };
+        append(png, "PNG\r\n\x1a\n");
+
+        Bytes header;
+        appendBE(header, static_cast<std::uint32_t>(size), 4);
+        appendBE(header, static_cast<std::uint32_t>(size), 4);
+        header.push_back(std::byte{ 8 }); // bit depth
+        header.push_back(std::byte{ 2 }); // RGB
+        header.resize(header.size() + 3); // compression, filter, interlace
+        appendChunk(png, "IHDR", header);
+        appendChunk(png, "IDAT", zlib);
+        appendChunk(png, "IEND", {});
+
+        return png;
+    }
+
+    Bytes createVorbisComment(const std::vector<Tag>& tags)
+    {
+        Bytes res;
+        appendLE(res, 9, 4);
+        append(res, "lms-bench");
+        appendLE(res, tags.size(), 4);
+        for (const Tag& tag : tags)
+        {
+            appendLE(res, tag.name.size() + 1 + tag.value.size(), 4);
+            append(res, tag.name);
+            append(res, "=");
+            append(res, tag.value);
+        }
+        return res;
+    }
+
+    Bytes createFlac(const TrackInfo& track)
+    {
+        Bytes file;
+        append(file, "fLaC");
+
+        // STREAMINFO: 44.1kHz, 2 channels, 16 bits
+        file.push_back(std::byte{ 0 });
+        appendBE(file, 34, 3);
+        appendBE(file, 4096, 2);
+        appendBE(file, 4096, 2);
+        appendBE(file, 0, 3);
+        appendBE(file, 0, 3);
+        appendBE(file, (44100 << 12) | (1 << 9) | (15 << 4), 4);
+        appendBE(file, static_cast<std::uint32_t>(44100 * track.duration.count()), 4);
+        file.resize(file.size() + 16); // md5
+
+        const Bytes vorbisComment{ createVorbisComment(track.tags) };
+        file.push_back(std::byte{ 4 });
+        appendBE(file, static_cast<std::uint32_t>(vorbisComment.size()), 3);
+        append(file, vorbisComment);
+
+        if (track.embeddedCover)
+        {
+            Bytes picture;
+            appendBE(picture, 3, 4); // front cover
+            appendBE(picture, 9, 4);
+            append(picture, "image/png");
+            appendBE(picture, 0, 4);
+            picture.resize(picture.size() + 16); // width, height, color depth, color count
+            appendBE(picture, static_cast<std::uint32_t>(track.embeddedCover->size()), 4);
+            append(picture, *track.embeddedCover);
+
+            file.push_back(std::byte{ 6 });
+            appendBE(file, static_cast<std::uint32_t>(picture.size()), 3);
+            append(file, picture);
+        }
+
+        // padding, last block
+        file.push_back(std::byte{ 0x80 | 1 });
+        appendBE(file, 1024, 3);
+        file.resize(file.size() + 1024);
+
+        file.resize(file.size() + 16 * 1024); // audio frames
+        return file;
+    }
+
+    Bytes createId3v2Frame(std::string_view id, const Bytes& content)
+    {
+        Bytes res;
+        append(res, id);
+        appendSyncSafe(res, static_cast<std::uint32_t>(content.size()));
+        appendBE(res, 0, 2);
+        append(res, content);
+        return res;
+    }
+
+    Bytes createMp3(const TrackInfo& track)
+    {
+        static const std::map<std::string, std::string> textFrames{
+            { "TITLE", "TIT2" },
+            { "ARTIST", "TPE1" },
+            { "ALBUM", "TALB" },
+            { "ALBUMARTIST", "TPE2" },
+            { "TRACKNUMBER", "TRCK" },
+            { "DISCNUMBER", "TPOS" },
+            { "DATE", "TDRC" },
+            { "GENRE", "TCON" },
+            { "COMPOSER", "TCOM" },
+        };
+        static const std::map<std::string, std::string> userTextFrames{
+            { "MUSICBRAINZ_ALBUMID", "MusicBrainz Album Id" },
+            { "MUSICBRAINZ_ARTISTID", "MusicBrainz Artist Id" },
+            { "MUSICBRAINZ_RELEASETRACKID", "MusicBrainz Release Track Id" },
+            { "REPLAYGAIN_TRACK_GAIN", "REPLAYGAIN_TRACK_GAIN" },
+        };
+
+        Bytes frames;
+        for (const Tag& tag : track.tags)
+        {
+            Bytes content{ std::byte{ 3 } }; // UTF-8
+            if (auto it{ textFrames.find(tag.name) }; it != std::cend(textFrames))
+            {
+                append(content, tag.value);
+                append(frames, createId3v2Frame(it->second, content));
+            }
+            else if (auto itUser{ userTextFrames.find(tag.name) }; itUser != std::cend(userTextFrames))
+            {
+                append(content, itUser->second);
+                content.push_back(std::byte{ 0 });
+                append(content, tag.value);
+                append(frames, createId3v2Frame("TXXX", content));
+            }
+        }
+
+        if (track.embeddedCover)
+        {
+            Bytes apic{ std::byte{ 0 } };
+            append(apic, "image/png");
+            apic.push_back(std::byte{ 0 });
+            apic.push_back(std::byte{ 3 }); // front cover
+            apic.push_back(std::byte{ 0 }); // empty description
+            append(apic, *track.embeddedCover);
+            append(frames, createId3v2Frame("APIC", apic));
+        }
+        frames.resize(frames.size() + 1024); // padding
+
+        Bytes file;
+        append(file, "ID3");
+        file.push_back(std::byte{ 4 });
+        file.push_back(std::byte{ 0 });
+        file.push_back(std::byte{ 0 });
+        appendSyncSafe(file, static_cast<std::uint32_t>(frames.size()));
+        append(file, frames);
+
+        // MPEG 1 layer III, 128 kbps, 44.1kHz: 417 bytes per frame, about 38 frames per second
+        // Only a few seconds are really written, the scanner estimates the duration from the file size anyway
+        for (std::size_t i{}; i < 200; ++i)
+        {
+            const std::size_t frameStart{ file.size() };
+            appendBE(file, 0xFFFB9000, 4);
+            file.resize(frameStart + 417);
+        }
+
+        return file;
+    }
+
+    void appendOggPage(Bytes& bytes, std::uint8_t flags, std::uint64_t granulePosition, std::uint32_t sequenceNumber, const Bytes& packet)
+    {
+        const std::size_t pageStart{ bytes.size() };
+
+        append(bytes, "OggS");
+        bytes.push_back(std::byte{ 0 }); // version
+        bytes.push_back(static_cast<std::byte>(flags));
+        appendLE(bytes, granulePosition, 8);
+        appendLE(bytes, 0x4C4D5300, 4); // serial number
+        appendLE(bytes, sequenceNumber, 4);
+        const std::size_t crcOffset{ bytes.size() };
+        appendLE(bytes, 0, 4);
+
+        const std::size_t segmentCount{ packet.size() / 255 + 1 };
+        if (segmentCount > 255)
+            throw std::runtime_error{ "Ogg packet too large" };
+        bytes.push_back(static_cast<std::byte>(segmentCount));
+        for (std::size_t i{}; i < segmentCount - 1; ++i)
+            bytes.push_back(std::byte{ 255 });
+        bytes.push_back(static_cast<std::byte>(packet.size() % 255));
+        append(bytes, packet);
+
+        const std::uint32_t crc{ computeOggCrc(std::span{ bytes }.subspan(pageStart)) };
+        for (std::size_t i{}; i < 4; ++i)
+            bytes[crcOffset + i] = static_cast<std::byte>((crc >> (i * 8)) & 0xFF);
+    }
+
+    // covers are never embedded in Opus files (they would need to be base64 encoded)
+    Bytes createOpus(const TrackInfo& track)
+    {
+        constexpr std::uint16_t preSkip{ 312 };
+
+        Bytes file;
+        {
+            Bytes header;
+            append(header, "OpusHead");
+            header.push_back(std::byte{ 1 }); // version
+            header.push_back(std::byte{ 2 }); // channels
+            appendLE(header, preSkip, 2);
+            appendLE(header, 48000, 4);
+            appendLE(header, 0, 2); // gain
+            header.push_back(std::byte{ 0 }); // mapping family
+            appendOggPage(file, 0x02, 0, 0, header);
+        }
+        {
+            Bytes tags;
+            append(tags, "OpusTags");
+            append(tags, createVorbisComment(track.tags));
+            appendOggPage(file, 0, 0, 1, tags);
+        }
+        {
+            // a single silent 20ms CELT frame, repeated
+            Bytes audio{ std::byte{ 0xFC } };
+            audio.resize(60, std::byte{ 0xFF });
+            appendOggPage(file, 0x04, preSkip + 48000 * static_cast<std::uint64_t>(track.duration.count()), 2, audio);
+        }
+
+        return file;
+    }
+
+    enum class Format
+    {
+        Flac,
+        Mp3,
+        Opus,
+    };
+
+    struct CorpusParameters
+    {
+        std::size_t artistCount{ 50 };
+        std::size_t releaseCountPerArtist{ 4 };
+        std::size_t trackCountPerRelease{ 10 };
+        std::size_t coverSize{ 300 };
+    };
+
+    std::string generateUUID(std::mt19937& randomEngine)
+    {
+        std::uniform_int_distribution<int> distrib{ 0, 15 };
+        std::string res{ "xxxxxxxx-xxxx-4xxx-axxx-xxxxxxxxxxxx" };
+        for (char& c : res)
+        {
+            if (c == 'x')
+                c = "0123456789abcdef"[distrib(randomEngine)];
+        }
+        return res;
+    }
+
+    // atomic replacement, like most taggers do: the parent directory is modified as well
+    void writeFile(const std::filesystem::path& path, const Bytes& content)
+    {
+        const std::filesystem::path tmpPath{ path.string() + ".tmp" };
+        {
+            std::ofstream ofs{ tmpPath, std::ios::binary | std::ios::trunc };
+            ofs.write(reinterpret_cast<const char*>(content.data()), static_cast<std::streamsize>(content.size()));
+            if (!ofs)
+                throw std::runtime_error{ "Cannot write file '" + tmpPath.string() + "'" };
+        }
+        std::filesystem::rename(tmpPath, path);
+    }
+
+    struct CorpusTrack
+    {
+        std::filesystem::path path;
+        Format format;
+        TrackInfo info;
+    };
+
+    Bytes createFile(const CorpusTrack& track)
+    {
+        switch (track.format)
+        {
+        case Format::Flac: return createFlac(track.info);
+        case Format::Mp3: return createMp3(track.info);
+        case Format::Opus: return createOpus(track.info);
+        }
+
+        throw std::runtime_error{ "Unhandled format" };
+    }
+
+    // Layout: <artist>/<year> - <release>/[CD <n>/]<track number> - <title>.<ext>
+    // Formats depend on the release, as do the covers (external cover.png file or embedded covers)
+    std::vector<CorpusTrack> generateCorpus(const std::filesystem::path& root, const CorpusParameters& params)
+    {
+        static constexpr std::array<std::string_view, 12> genres{ "Rock", "Pop", "Jazz", "Electronic", "Classical", "Metal", "Hip-Hop", "Folk", "Blues", "Reggae", "Soundtrack", "Ambient" };
+
+        std::mt19937 randomEngine{ 42 };
+        std::geometric_distribution<std::size_t> genreDistrib{ 0.3 }; // most releases use the first genres
+        std::uniform_int_distribution<int> durationDistrib{ 60, 480 };
+        std::uniform_int_distribution<int> yearDistrib{ 1960, 2024 };
+
+        std::vector<CorpusTrack> tracks;
+        for (std::size_t artistIndex{}; artistIndex < params.artistCount; ++artistIndex)
+        {
+            const std::string artistName{ "Artist " + std::to_string(artistIndex) };
+            const std::string artistMBID{ generateUUID(randomEngine) };
+
+            for (std::size_t releaseIndex{}; releaseIndex < params.releaseCountPerArtist; ++releaseIndex)
+            {
+                const std::size_t globalReleaseIndex{ artistIndex * params.releaseCountPerArtist + releaseIndex };
+                const std::string releaseName{ "Release " + std::to_string(globalReleaseIndex) };
+                const std::string releaseMBID{ generateUUID(randomEngine) };
+                const std::string year{ std::to_string(yearDistrib(randomEngine)) };
+                const std::string genre{ genres[genreDistrib(randomEngine) % genres.size()] };
+                const Format format{ static_cast<Format>(globalReleaseIndex % 3) };
+                const bool multiDisc{ globalReleaseIndex % 7 == 0 };
+                const bool embeddedCover{ format != Format::Opus && globalReleaseIndex % 2 == 0 };
+
+                const std::filesystem::path releasePath{ root / artistName / (year + " - " + releaseName) };
+                std::filesystem::create_directories(releasePath);
+
+                std::optional<Bytes> cover{ generatePNG(params.coverSize, static_cast<std::uint32_t>(globalReleaseIndex)) };
+                if (!embeddedCover)
+                {
+                    writeFile(releasePath / "cover.png", *cover);
+                    cover.reset();
+                }
+
+                for (std::size_t trackIndex{}; trackIndex < params.trackCountPerRelease; ++trackIndex)
+                {
+                    const std::size_t discNumber{ multiDisc ? 1 + trackIndex * 2 / params.trackCountPerRelease : 1 };
+                    const std::string trackNumber{ std::to_string(trackIndex + 1) };
+                    const std::string title{ "Track " + std::to_string(globalReleaseIndex * params.trackCountPerRelease + trackIndex) };
+
+                    std::filesystem::path directory{ releasePath };
+                    if (multiDisc)
+                        directory /= "CD " + std::to_string(discNumber);
+                    std::filesystem::create_directories(directory);
+
+                    static constexpr std::array<std::string_view, 3> extensions{ ".flac", ".mp3", ".opus" };
+                    CorpusTrack track{ directory / ((trackNumber.size() < 2 ? "0" : "") + trackNumber + " - " + title + std::string{ extensions[static_cast<std::size_t>(format)] }), format, {} };
+
+                    track.info.duration = std::chrono::seconds{ durationDistrib(randomEngine) };
+                    track.info.embeddedCover = cover;
+                    track.info.tags = {
+                        { "TITLE", title },
+                        { "ARTIST", artistName },
+                        { "ALBUM", releaseName },
+                        { "ALBUMARTIST", artistName },
+                        { "TRACKNUMBER", trackNumber },
+                        { "DISCNUMBER", std::to_string(discNumber) },
+                        { "DATE", year },
+                        { "GENRE", genre },
+                        { "MUSICBRAINZ_ALBUMID", releaseMBID },
+                        { "MUSICBRAINZ_ARTISTID", artistMBID },
+                        { "MUSICBRAINZ_RELEASETRACKID", generateUUID(randomEngine) },
+                        { "REPLAYGAIN_TRACK_GAIN", "-7.50 dB" },
+                    };
+                    if (genre == "Classical")
+                        track.info.tags.push_back({ "COMPOSER", "Composer " + std::to_string(trackIndex % 5) });
+
+                    writeFile(track.path, createFile(track));
+                    tracks.push_back(std::move(track));
+                }
+            }
+        }
+
+        return tracks;
+    }
+
+    // Peak resident set size since the last reset, in KiB (Linux only)
+    std::optional<std::size_t> readPeakRSS()
+    {
+        std::ifstream ifs{ "/proc/self/status" };
+        std::string line;
+        while (std::getline(ifs, line))
+        {
+            if (line.starts_with("VmHWM:"))
+            {
+                const std::string_view sizeStr{ std::string_view{ line }.substr(6) };
+                for (std::string_view value : StringUtils::splitString(sizeStr, ' '))
+                {
+                    if (const auto size{ StringUtils::readAs<std::size_t>(value) })
+                        return size;
+                }
+            }
+        }
+        return std::nullopt;
+    }
+
+    void resetPeakRSS()
+    {
+        std::ofstream ofs{ "/proc/self/clear_refs" };
+        ofs << "5";
+    }
+
+    std::string_view getScanStepName(Scanner::ScanStep step)
+    {
+        switch (step)
+        {
+        case Scanner::ScanStep::DiscoveringFiles: return "DiscoveringFiles";
+        case Scanner::ScanStep::ScanningFiles: return "ScanningFiles";
+        case Scanner::ScanStep::ChekingForMissingFiles: return "CheckingForMissingFiles";
+        case Scanner::ScanStep::CheckingForDuplicateFiles: return "CheckingForDuplicateFiles";
+        case Scanner::ScanStep::ComputingTrackFeatures: return "ComputingTrackFeatures";
+        case Scanner::ScanStep::ReloadingSimilarityEngine: return "ReloadingSimilarityEngine";
+        case Scanner::ScanStep::ComputeClusterStats: return "ComputeClusterStats";
+        case Scanner::ScanStep::ComputeSimilarities: return "ComputeSimilarities";
+        case Scanner::ScanStep::GeneratingCovers: return "GeneratingCovers";
+        case Scanner::ScanStep::RefiningDurations: return "RefiningDurations";
+        case Scanner::ScanStep::ComputingLoudness: return "ComputingLoudness";
+        case Scanner::ScanStep::FetchingTrackFeatures: return "FetchingTrackFeatures";
+        }
+        return "Unknown";
+    }
+
+    struct StepTiming
+    {
+        Scanner::ScanStep step;
+        std::chrono::steady_clock::time_point start;
+        std::chrono::steady_clock::time_point end;
+        std::size_t processedElems{};
+    };
+
+    // Runs scans and gathers the step timings using the scanner events
+    class ScanRunner
+    {
+    public:
+        ScanRunner(Scanner::IScannerService& scanner)
+            : _scanner{ scanner }
+        {
+            _scanner.getEvents().scanInProgress.connect([this](const Scanner::ScanStepStats& stepStats)
+                {
+                    const auto now{ std::chrono::steady_clock::now() };
+
+                    std::scoped_lock lock{ _mutex };
+                    if (_stepTimings.empty() || _stepTimings.back().step != stepStats.currentStep)
+                        _stepTimings.push_back(StepTiming{ stepStats.currentStep, now, now });
+
+                    _stepTimings.back().end = now;
+                    _stepTimings.back().processedElems = stepStats.processedElems;
+                });
+
+            _scanner.getEvents().scanComplete.connect([this](const Scanner::ScanSummary& stats)
+                {
+                    std::scoped_lock lock{ _mutex };
+                    if (_scanComplete)
+                    {
+                        _scanComplete->set_value(stats);
+                        _scanComplete.reset();
+                    }
+                });
+        }
+
+        void run(std::string_view phaseName)
+        {
+            std::future<Scanner::ScanSummary> scanStats;
+            {
+                std::scoped_lock lock{ _mutex };
+                _stepTimings.clear();
+                _scanComplete.emplace();
+                scanStats = _scanComplete->get_future();
+            }
+
+            resetPeakRSS();
+            const std::uint64_t statementCountBefore{ Database::Db::getTotalExecutedStatementCount() };
+            const auto start{ std::chrono::steady_clock::now() };
+
+            _scanner.requestImmediateScan(false);
+            const Scanner::ScanSummary stats{ scanStats.get() };
+
+            const double duration{ std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() };
+            const std::uint64_t statementCount{ Database::Db::getTotalExecutedStatementCount() - statementCountBefore };
+            const std::optional<std::size_t> peakRSS{ readPeakRSS() };
+
+            std::cout << std::endl << "=== " << phaseName << " ===" << std::endl;
+            std::cout << std::fixed << std::setprecision(2);
+            std::cout << "Duration: " << duration << "s" << std::endl;
+            std::cout << "Files: " << stats.nbFiles() << " (scanned = " << stats.scans << ", skipped = " << stats.skips << ", added = " << stats.additions << ", updated = " << stats.updates << ", removed = " << stats.deletions << ", errors = " << stats.errorCount << ")" << std::endl;
+            std::cout << "Files/s: " << (duration > 0 ? stats.nbFiles() / duration : 0) << std::endl;
+            std::cout << "SQL statements: " << statementCount << " (" << (stats.nbFiles() > 0 ? static_cast<double>(statementCount) / stats.nbFiles() : 0) << " per file)" << std::endl;
+            if (peakRSS)
+                std::cout << "Peak RSS: " << *peakRSS / 1024. << " MiB" << std::endl;
+
+            std::scoped_lock lock{ _mutex };
+            for (const StepTiming& timing : _stepTimings)
+            {
+                std::cout << "  " << std::left << std::setw(28) << getScanStepName(timing.step) << std::right
+                    << std::setw(10) << std::chrono::duration<double, std::milli>(timing.end - timing.start).count() << " ms"
+                    << std::setw(10) << timing.processedElems << " elems" << std::endl;
+            }
+        }
+
+    private:
+        Scanner::IScannerService& _scanner;
+
+        std::mutex _mutex;
+        std::vector<StepTiming> _stepTimings;
+        std::optional<std::promise<Scanner::ScanSummary>> _scanComplete;
+    };
+
+    void modifyTracks(std::vector<CorpusTrack>& tracks, double ratio)
+    {
+        std::mt19937 randomEngine{ 1234 };
+        std::shuffle(std::begin(tracks), std::end(tracks), randomEngine);
+
+        const std::size_t count{ static_cast<std::size_t>(tracks.size() * ratio) };
+        for (std::size_t i{}; i < count; ++i)
+        {
+            CorpusTrack& track{ tracks[i] };
+            for (Tag& tag : track.info.tags)
+            {
+                if (tag.name == "TITLE")
+                    tag.value += " (remastered)";
+            }
+            writeFile(track.path, createFile(track));
+        }
+
+        std::cout << "Modified " << count << " files" << std::endl;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        namespace po = boost::program_options;
+
+        const CorpusParameters defaultParams;
+
+        po::options_description desc{ "Allowed options" };
+        desc.add_options()
+            ("help,h", "print usage message")
+            ("conf,c", po::value<std::string>()->default_value("/etc/lms.conf"), "LMS config file (scanner settings)")
+            ("work-dir,w", po::value<std::string>(), "directory where the media library and the database are generated (defaults to a temporary directory, removed on exit)")
+            ("artist-count", po::value<unsigned>()->default_value(defaultParams.artistCount), "number of artists to generate")
+            ("release-count-per-artist", po::value<unsigned>()->default_value(defaultParams.releaseCountPerArtist), "number of releases per artist")
+            ("track-count-per-release", po::value<unsigned>()->default_value(defaultParams.trackCountPerRelease), "number of tracks per release")
+            ("cover-size", po::value<unsigned>()->default_value(defaultParams.coverSize), "width and height of the generated covers")
+            ("change-ratio", po::value<double>()->default_value(0.05), "ratio of files modified before the last scan")
+            ("default-cover,d", po::value<std::string>(), "default cover path, enables the cover service")
+            ("verbose,v", "log scanner messages")
+            ;
+
+        po::variables_map vm;
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+
+        if (vm.count("help"))
+        {
+            std::cout << desc << std::endl;
+            return EXIT_SUCCESS;
+        }
+
+        Service<ILogger> logger{ std::make_unique<StreamLogger>(std::cerr, vm.count("verbose") ? EnumSet<Severity>{ Severity::FATAL, Severity::ERROR, Severity::WARNING, Severity::INFO } : EnumSet<Severity>{ Severity::FATAL }) };
+        Service<IConfig> config{ createConfig(vm["conf"].as<std::string>()) };
+
+        CorpusParameters corpusParams;
+        corpusParams.artistCount = vm["artist-count"].as<unsigned>();
+        corpusParams.releaseCountPerArtist = vm["release-count-per-artist"].as<unsigned>();
+        corpusParams.trackCountPerRelease = std::max(vm["track-count-per-release"].as<unsigned>(), 1U);
+        corpusParams.coverSize = std::max(vm["cover-size"].as<unsigned>(), 1U);
+
+        const bool removeWorkDir{ vm.count("work-dir") == 0 };
+        const std::filesystem::path workDir{ vm.count("work-dir") ? std::filesystem::path{ vm["work-dir"].as<std::string>() } : std::filesystem::temp_directory_path() / ("lms-scanner-bench-" + std::to_string(std::random_device{}())) };
+        const std::filesystem::path mediaDir{ workDir / "media" };
+        if (std::filesystem::exists(mediaDir))
+            throw std::runtime_error{ "Directory '" + mediaDir.string() + "' already exists" };
+
+        int res{ EXIT_SUCCESS };
+        try
+        {
+            std::cout << "Generating corpus in '" << mediaDir.string() << "'..." << std::endl;
+            std::vector<CorpusTrack> tracks{ generateCorpus(mediaDir, corpusParams) };
+            std::cout << "Generated " << tracks.size() << " files" << std::endl;
+
+            Database::Db db{ workDir / "lms.db" };
+            {
+                Database::Session session{ db };
+                session.prepareTables();
+
+                auto transaction{ session.createWriteTransaction() };
+                session.create<Database::MediaLibrary>(mediaDir, "Bench");
+            }
+
+            Service<Cover::ICoverService> coverService;
+            if (vm.count("default-cover"))
+                coverService.assign(Cover::createCoverService(db, argv[0], vm["default-cover"].as<std::string>()));
+
+            {
+                std::unique_ptr<Scanner::IScannerService> scanner{ Scanner::createScannerService(db) };
+                ScanRunner runner{ *scanner };
+
+                runner.run("Initial scan");
+                runner.run("No-op rescan");
+                modifyTracks(tracks, vm["change-ratio"].as<double>());
+                runner.run("Rescan with changes");
+            }
+        }
+        catch (std::exception& e)
+        {
+            std::cerr << "Caught exception: " << e.what() << std::endl;
+            res = EXIT_FAILURE;
+        }
+
+        if (removeWorkDir)
+            std::filesystem::remove_all(workDir);
+
+        return res;
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Caught exception: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
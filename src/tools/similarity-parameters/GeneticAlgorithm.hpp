@@ -17,7 +17,12 @@
  * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <chrono>
+#include <functional>
 #include <numeric>
+#include <optional>
+#include <string>
+#include <unordered_map>
 
 #include "utils/Random.hpp"
 
@@ -32,6 +37,7 @@ class GeneticAlgorithm
 		using BreedFunction = std::function<Individual(const Individual&, const Individual&)>;
 		using MutateFunction = std::function<void(Individual&)>;
 		using ScoreFunction = std::function<Score(const Individual&)>;
+		using KeyFunction = std::function<std::string(const Individual&)>; // individuals with the same key are expected to have the same score
 
 		struct Params
 		{
@@ -42,6 +48,7 @@ class GeneticAlgorithm
 			BreedFunction	breedFunction;
 			MutateFunction		mutateFunction;
 			ScoreFunction		scoreFunction;
+			KeyFunction		keyFunction; // optional, used to reuse the score of already evaluated individuals
 		};
 
 		GeneticAlgorithm(const Params& params);
@@ -56,11 +63,18 @@ class GeneticAlgorithm
 			std::optional<Score> score {};
 		};
 
-		void scoreAndSortPopulation(std::vector<ScoredIndividual>& population);
+		struct ScoringStats
+		{
+			std::size_t evaluationCount {};
+			std::size_t cacheHitCount {};
+		};
+
+		ScoringStats scoreAndSortPopulation(std::vector<ScoredIndividual>& population);
 		Score getTotalScore(const std::vector<ScoredIndividual>& population) const;
 		typename std::vector<ScoredIndividual>::const_iterator pickRandomRouletteWheel(const std::vector<ScoredIndividual>& population, Score totalScore);
 
 		Params _params;
+		std::unordered_map<std::string, Score> _scoreCache; // per individual key
 };
 
 template<typename Individual>
@@ -88,6 +102,8 @@ GeneticAlgorithm<Individual>::simulate(const std::vector<Individual>& initialPop
 
 	for (std::size_t currentGeneration {}; currentGeneration  < _params.nbGenerations; ++currentGeneration)
 	{
+		const auto generationStart {std::chrono::steady_clock::now()};
+
 		assert(scoredPopulation.size() == initialPopulation.size());
 		std::cout << "Processing generation " << currentGeneration << "..." << std::endl;
 		std::cout << "Need to create " << childrenCountPerGeneration << " new children" << std::endl;
@@ -120,10 +136,15 @@ GeneticAlgorithm<Individual>::simulate(const std::vector<Individual>& initialPop
 		scoredPopulation.insert(std::end(scoredPopulation), std::make_move_iterator(std::begin(children)), std::make_move_iterator(std::end(children)));
 		assert(scoredPopulation.size() == initialPopulation.size());
 
-		scoreAndSortPopulation(scoredPopulation);
+		const auto scoringStart {std::chrono::steady_clock::now()};
+		const ScoringStats stats {scoreAndSortPopulation(scoredPopulation)};
+		const auto generationEnd {std::chrono::steady_clock::now()};
 
 		std::cout << "Mean score = " << getTotalScore(scoredPopulation) / scoredPopulation.size() << std::endl;
 		std::cout << "Current best score = " << *scoredPopulation.front().score << std::endl;
+		std::cout << "Generation " << currentGeneration << " took " << std::chrono::duration_cast<std::chrono::milliseconds>(generationEnd - generationStart).count() << " ms"
+			<< " (scoring: " << std::chrono::duration_cast<std::chrono::milliseconds>(generationEnd - scoringStart).count() << " ms"
+			<< ", " << stats.evaluationCount << " evaluations, " << stats.cacheHitCount << " cache hits)" << std::endl;
 	}
 
 	std::cout << "Best score = " << *scoredPopulation.front().score << std::endl;
@@ -132,17 +153,60 @@ GeneticAlgorithm<Individual>::simulate(const std::vector<Individual>& initialPop
 
 
 template<typename Individual>
-void
+typename GeneticAlgorithm<Individual>::ScoringStats
 GeneticAlgorithm<Individual>::scoreAndSortPopulation(std::vector<ScoredIndividual>& scoredPopulation)
 {
-	parallel_foreach(_params.nbWorkers, std::begin(scoredPopulation), std::end(scoredPopulation),
-			[&](ScoredIndividual& scoredIndividual)
+	ScoringStats stats;
+
+	// Only evaluate once the individuals that share the same key, in this generation or in the previous ones
+	std::vector<ScoredIndividual*> individualsToScore;
+	std::unordered_map<std::string, std::vector<ScoredIndividual*>> pendingIndividuals;
+	for (ScoredIndividual& scoredIndividual : scoredPopulation)
+	{
+		if (scoredIndividual.score)
+			continue;
+
+		if (!_params.keyFunction)
+		{
+			individualsToScore.push_back(&scoredIndividual);
+			continue;
+		}
+
+		std::string key {_params.keyFunction(scoredIndividual.individual)};
+		if (const auto itCachedScore {_scoreCache.find(key)}; itCachedScore != std::cend(_scoreCache))
+		{
+			scoredIndividual.score = itCachedScore->second;
+			stats.cacheHitCount++;
+			continue;
+		}
+
+		std::vector<ScoredIndividual*>& pending {pendingIndividuals[std::move(key)]};
+		if (pending.empty())
+			individualsToScore.push_back(&scoredIndividual);
+		else
+			stats.cacheHitCount++;
+		pending.push_back(&scoredIndividual);
+	}
+
+	parallel_foreach(_params.nbWorkers, std::begin(individualsToScore), std::end(individualsToScore),
+			[&](ScoredIndividual* scoredIndividual, std::size_t /* workerIndex */)
 			{
-				if (!scoredIndividual.score)
-					scoredIndividual.score = _params.scoreFunction(scoredIndividual.individual);
+				scoredIndividual->score = _params.scoreFunction(scoredIndividual->individual);
 			});
+	stats.evaluationCount = individualsToScore.size();
+
+	for (auto& [key, pending] : pendingIndividuals)
+	{
+		const Score score {*pending.front()->score};
+		for (ScoredIndividual* scoredIndividual : pending)
+			scoredIndividual->score = score;
+
+		_scoreCache.emplace(key, score);
+	}
 
 	std::sort(std::begin(scoredPopulation), std::end(scoredPopulation), [](const ScoredIndividual& a, const ScoredIndividual& b) { return a.score > b.score; });
+
+	return stats;
 }
 
 template<typename Individual>
@@ -17,9 +17,12 @@
  * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <iostream>
 #include <filesystem>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "database/Artist.hpp"
 #include "database/Cluster.hpp"
@@ -183,6 +186,49 @@ constructFeaturesCache(Database::Session& session, const FeatureSettingsMap& fea
 	return cache;
 }
 
+// What the scoring needs to know about a track, loaded once since it does not depend on the evaluated settings
+struct TrackInfo
+{
+	Database::IdType releaseId;
+	std::vector<Database::IdType> artistIds;	// sorted
+	std::vector<Database::IdType> clusterIds;	// sorted
+};
+
+struct TrackInfoCache
+{
+	std::vector<Database::IdType> trackIds; // tracks with features
+	std::unordered_map<Database::IdType, TrackInfo> trackInfos;
+};
+
+static
+TrackInfoCache
+constructTrackInfoCache(Database::Session& session)
+{
+	TrackInfoCache cache;
+
+	auto transaction {session.createReadTransaction()};
+
+	cache.trackIds = Database::Track::getAllIdsWithFeatures(session);
+	for (auto trackId : cache.trackIds)
+	{
+		const Database::Track::pointer track {Database::Track::getById(session, trackId)};
+
+		TrackInfo& trackInfo {cache.trackInfos[trackId]};
+		if (track->getRelease())
+			trackInfo.releaseId = track->getRelease().id();
+
+		for (auto artistId : track->getArtistIds())
+			trackInfo.artistIds.push_back(artistId);
+		std::sort(std::begin(trackInfo.artistIds), std::end(trackInfo.artistIds));
+
+		for (auto clusterId : track->getClusterIds())
+			trackInfo.clusterIds.push_back(clusterId);
+		std::sort(std::begin(trackInfo.clusterIds), std::end(trackInfo.clusterIds));
+	}
+
+	return cache;
+}
+
 static
 std::optional<FeatureValuesMap>
 getFeaturesFromCache(const std::unordered_map<Database::IdType, FeatureValuesMap>& cache, Database::IdType trackId, const FeatureNames& names)
@@ -239,52 +285,55 @@ trackToString(Database::Session& session, Database::IdType trackId)
 	return res;
 }
 
+static
+std::size_t
+countCommonIds(const std::vector<Database::IdType>& ids1, const std::vector<Database::IdType>& ids2)
+{
+	std::size_t count {};
+
+	auto it1 {std::cbegin(ids1)};
+	auto it2 {std::cbegin(ids2)};
+	while (it1 != std::cend(ids1) && it2 != std::cend(ids2))
+	{
+		if (*it1 < *it2)
+			++it1;
+		else if (*it2 < *it1)
+			++it2;
+		else
+		{
+			++count;
+			++it1;
+			++it2;
+		}
+	}
+
+	return count;
+}
+
 static
 SimilarityScore
-computeTrackScore(Database::Session& session, Database::IdType track1Id, Database::IdType track2Id)
+computeTrackScore(const TrackInfoCache& trackInfoCache, Database::IdType track1Id, Database::IdType track2Id)
 {
 	SimilarityScore score {};
 
-	auto transaction {session.createReadTransaction()};
+	const TrackInfo& track1 {trackInfoCache.trackInfos.at(track1Id)};
+	const TrackInfo& track2 {trackInfoCache.trackInfos.at(track2Id)};
 
-	auto track1 {Database::Track::getById(session, track1Id)};
-	auto track2 {Database::Track::getById(session, track2Id)};
-
-	if (track1->getRelease() == track2->getRelease())
+	if (track1.releaseId == track2.releaseId)
 		score += 1;
 
 	// Artists in common
-	{
-		auto track1ArtistIds {track1->getArtistIds()};
-		auto track2ArtistIds {track2->getArtistIds()};
-
-		std::vector<Database::IdType> commonArtistIds;
-		std::set_intersection(std::cbegin(track1ArtistIds), std::cend(track1ArtistIds),
-				std::cbegin(track2ArtistIds), std::cend(track2ArtistIds),
-				std::back_inserter(commonArtistIds));
-
-		score += commonArtistIds.size();
-	}
+	score += countCommonIds(track1.artistIds, track2.artistIds);
 
 	// Clusters in common
-	{
-		auto track1ClusterIds {track1->getClusterIds()};
-		auto track2ClusterIds {track2->getClusterIds()};
-
-		std::vector<Database::IdType> commonClusterIds;
-		std::set_intersection(std::cbegin(track1ClusterIds), std::cend(track1ClusterIds),
-				std::cbegin(track2ClusterIds), std::cend(track2ClusterIds),
-				std::back_inserter(commonClusterIds));
-
-		score += commonClusterIds.size();
-	}
+	score += countCommonIds(track1.clusterIds, track2.clusterIds);
 
 	return score;
 }
 
 static
 SimilarityScore
-computeSimilarityScore(Database::Session& session, FeaturesSearcher::TrainSettings trainSettings)
+computeSimilarityScore(Database::Session& session, const TrackInfoCache& trackInfoCache, FeaturesSearcher::TrainSettings trainSettings)
 {
 	std::cout << "Compute score of: ";
 	printFeatureSettingsMap(trainSettings.featureSettingsMap);
@@ -292,21 +341,15 @@ computeSimilarityScore(Database::Session& session, FeaturesSearcher::TrainSettin
 
 	FeaturesSearcher searcher {session, trainSettings};
 
-	const std::vector<Database::IdType> trackIds = std::invoke([&]()
-			{
-				auto transaction {session.createReadTransaction()};
-				return Database::Track::getAllIdsWithFeatures(session);
-			});
-
 	SimilarityScore score {};
-	for (Database::IdType trackId : trackIds)
+	for (Database::IdType trackId : trackInfoCache.trackIds)
 	{
 		constexpr std::size_t nbSimilarTracks {3};
 //		std::cout << "Processing track '" << trackToString(session, trackId) << "'" << std::endl;
 		SimilarityScore factor {1};		
 		for (Database::IdType similarTrackId : searcher.getSimilarTracks({trackId}, nbSimilarTracks))
 		{
-			SimilarityScore trackScore {computeTrackScore(session, trackId, similarTrackId)};
+			SimilarityScore trackScore {computeTrackScore(trackInfoCache, trackId, similarTrackId)};
 //			std::cout << "\tScore = " << trackScore << " (*" << factor << ") with track '" << trackToString(session, similarTrackId) << "'" << std::endl;
 			trackScore *= factor;
 			score += trackScore;
@@ -322,22 +365,16 @@ computeSimilarityScore(Database::Session& session, FeaturesSearcher::TrainSettin
 
 static
 void
-printBadlyClassifiedTracks(Database::Session& session, FeaturesSearcher::TrainSettings trainSettings)
+printBadlyClassifiedTracks(Database::Session& session, const TrackInfoCache& trackInfoCache, FeaturesSearcher::TrainSettings trainSettings)
 {
 	FeaturesSearcher searcher {session, trainSettings};
 
-	const std::vector<Database::IdType> trackIds = std::invoke([&]()
-			{
-				auto transaction {session.createReadTransaction()};
-				return Database::Track::getAllIdsWithFeatures(session);
-			});
-
-	for (Database::IdType trackId : trackIds)
+	for (Database::IdType trackId : trackInfoCache.trackIds)
 	{
 		constexpr std::size_t nbSimilarTracks {3};
 		for (Database::IdType similarTrackId : searcher.getSimilarTracks({trackId}, nbSimilarTracks))
 		{
-			SimilarityScore trackScore {computeTrackScore(session, trackId, similarTrackId)};
+			SimilarityScore trackScore {computeTrackScore(trackInfoCache, trackId, similarTrackId)};
 			if (trackScore == 0)
 				std::cout << "Badly classified tracks: '" << trackToString(session, trackId) << "'\n\twith track '" << trackToString(session, similarTrackId) << "'" <<std::endl;
 		}
@@ -405,6 +442,10 @@ int main(int argc, char *argv[])
 		const auto cachedFeatures { constructFeaturesCache(Database::SessionPool::ScopedSession {sessionPool}.get(), featuresSettings) };
 		std::cout << "Caching all features DONE" << std::endl;
 
+		std::cout << "Caching all track infos..." << std::endl;
+		const TrackInfoCache trackInfoCache { constructTrackInfoCache(Database::SessionPool::ScopedSession {sessionPool}.get()) };
+		std::cout << "Caching all track infos DONE" << std::endl;
+
 		FeaturesSearcher::setFeaturesFetchFunc(
 				[&](Database::IdType trackId, const FeatureNames& featureNames)
 				{
@@ -448,7 +489,22 @@ int main(int argc, char *argv[])
 				settings.featureSettingsMap = featureSettings;
 
 				Database::SessionPool::ScopedSession scopedSession {sessionPool};
-				return computeSimilarityScore(scopedSession.get(), settings);
+				return computeSimilarityScore(scopedSession.get(), trackInfoCache, settings);
+			};
+		// the individuals are only defined by their feature names, since all the weights are the same
+		params.keyFunction =
+			[](const FeatureSettingsMap& featureSettings)
+			{
+				std::vector<FeatureName> names;
+				for (const auto& [name, settings] : featureSettings)
+					names.push_back(name);
+				std::sort(std::begin(names), std::end(names));
+
+				std::string key;
+				for (const FeatureName& name : names)
+					key += name + ";";
+
+				return key;
 			};
 
 		GeneticAlgorithm<FeatureSettingsMap> geneticAlgorithm {params};
@@ -473,7 +529,7 @@ int main(int argc, char *argv[])
 			settings.featureSettingsMap = selectedSettings;
 
 			Database::SessionPool::ScopedSession scopedSession {sessionPool};
-			printBadlyClassifiedTracks(scopedSession.get(), settings);
+			printBadlyClassifiedTracks(scopedSession.get(), trackInfoCache, settings);
 		}
 	}
 	catch (std::exception& e)
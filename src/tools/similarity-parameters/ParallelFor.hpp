@@ -17,31 +17,38 @@
  * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <functional>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <iterator>
+#include <stdexcept>
 #include <thread>
-#include <boost/asio/io_context.hpp>
+#include <vector>
 
+// Calls func(value, workerIndex) for each value of the range, using nbWorkers threads (including the calling one)
+// Workers claim the next unprocessed value as soon as they are done with the previous one, so that long evaluations
+// do not hold up the others. workerIndex is in [0, nbWorkers) and can be used to select per-worker buffers
 template <typename It, typename Func>
 void parallel_foreach(std::size_t nbWorkers, It begin, It end, Func&& func)
 {
 	if (nbWorkers == 0)
 		throw std::runtime_error("Invalid worker count");
 
-	boost::asio::io_context ioContext;
+	const std::size_t count {static_cast<std::size_t>(std::distance(begin, end))};
+	std::atomic<std::size_t> nextIndex {};
 
-	for (It it {begin}; it != end; ++it)
+	auto worker {[&](std::size_t workerIndex)
 	{
-		auto refValue {std::ref<typename It::value_type>(*it)};
-		ioContext.post([refValue, &func]() { std::cout << "EXEC FROM WORKER" << std::endl; func(refValue); std::cout << "END EXEC FROM WORKER" << std::endl; });
-	}
+		for (std::size_t index {nextIndex++}; index < count; index = nextIndex++)
+			func(*std::next(begin, index), workerIndex);
+	}};
 
 	std::vector<std::thread> threads;
-	for (std::size_t i {}; i < nbWorkers - 1; ++i)
-		threads.emplace_back([&]() { ioContext.run(); });
+	for (std::size_t i {1}; i < std::min(nbWorkers, count); ++i)
+		threads.emplace_back(worker, i);
 
-	ioContext.run();
+	worker(0);
 
 	for (std::thread& t : threads)
 		t.join();
 }
-
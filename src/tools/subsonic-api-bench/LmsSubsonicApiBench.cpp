@@ -0,0 +1,620 @@
+/*
+ * Copyright (C) 2024 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/program_options.hpp>
+
+#include <Wt/Http/Client.h>
+#include <Wt/Json/Array.h>
+#include <Wt/Json/Object.h>
+#include <Wt/Json/Parser.h>
+#include <Wt/Json/Value.h>
+#include <Wt/Utils.h>
+#include <Wt/WException.h>
+
+#include "utils/Random.hpp"
+#include "utils/String.hpp"
+
+// Replays a mix of Subsonic API calls against a running server, using a fixed number of concurrent clients
+// Each client sends its next request as soon as the previous one is complete
+namespace
+{
+    enum class CallType
+    {
+        GetArtists,
+        GetAlbumList2,
+        GetAlbum,
+        Search3,
+        GetCoverArt,
+        Stream,
+    };
+
+    struct CallTypeInfo
+    {
+        std::string_view name;
+        CallType type;
+    };
+
+    constexpr CallTypeInfo callTypes[]
+    {
+        { "getArtists", CallType::GetArtists },
+        { "getAlbumList2", CallType::GetAlbumList2 },
+        { "getAlbum", CallType::GetAlbum },
+        { "search3", CallType::Search3 },
+        { "getCoverArt", CallType::GetCoverArt },
+        { "stream", CallType::Stream },
+    };
+
+    struct MixEntry
+    {
+        const CallTypeInfo* callType;
+        unsigned weight;
+    };
+
+    std::vector<MixEntry> parseMix(std::string_view str)
+    {
+        std::vector<MixEntry> mix;
+
+        for (std::string_view entry : StringUtils::splitString(str, ','))
+        {
+            const std::vector<std::string_view> values{ StringUtils::splitString(entry, ':') };
+            const std::optional<unsigned> weight{ values.size() == 2 ? StringUtils::readAs<unsigned>(values[1]) : std::nullopt };
+            auto itCallType{ std::find_if(std::cbegin(callTypes), std::cend(callTypes), [&](const CallTypeInfo& callType) { return !values.empty() && callType.name == values[0]; }) };
+            if (!weight || itCallType == std::cend(callTypes))
+                throw std::runtime_error{ "Invalid mix entry '" + std::string{ entry } + "', expected <call>:<weight>" };
+
+            if (*weight > 0)
+                mix.push_back(MixEntry{ &*itCallType, *weight });
+        }
+
+        if (mix.empty())
+            throw std::runtime_error{ "Empty call mix" };
+
+        return mix;
+    }
+
+    struct Parameters
+    {
+        std::string baseUrl; // up to /rest/
+        std::string authQuery; // user, password, client name, format
+        std::size_t listSize{};
+        std::size_t coverSize{};
+        std::string streamFormat; // "raw" means no transcoding
+        std::size_t streamBitrate{};
+        std::optional<std::string> musicFolderId;
+    };
+
+    // Ids gathered from the server before running the benchmark
+    struct Catalog
+    {
+        std::vector<std::string> albumIds;
+        std::vector<std::string> songIds;
+        std::vector<std::string> coverArtIds;
+        std::vector<std::string> searchTerms;
+    };
+
+    std::string toHex(std::string_view str)
+    {
+        std::ostringstream oss;
+        for (const unsigned char c : str)
+            oss << std::hex << std::setw(2) << std::setfill('0') << static_cast<unsigned>(c);
+        return oss.str();
+    }
+
+    template <typename Container>
+    const typename Container::value_type& pickRandom(const Container& container)
+    {
+        return *Random::pickRandom(container);
+    }
+
+    std::string buildRelativeUrl(const Parameters& parameters, const Catalog& catalog, CallType callType)
+    {
+        std::string musicFolderQuery{ parameters.musicFolderId ? "&musicFolderId=" + *parameters.musicFolderId : "" };
+
+        switch (callType)
+        {
+        case CallType::GetArtists:
+            return "getArtists.view?" + musicFolderQuery.substr(musicFolderQuery.empty() ? 0 : 1);
+
+        case CallType::GetAlbumList2:
+        {
+            static constexpr std::array<std::string_view, 9> types{ "random", "newest", "highest", "frequent", "recent", "alphabeticalByName", "alphabeticalByArtist", "starred", "byYear&fromYear=1970&toYear=2020" };
+            const std::string_view type{ pickRandom(types) };
+
+            // browse the whole collection for the sorted lists
+            std::size_t offset{};
+            if ((type == "alphabeticalByName" || type == "alphabeticalByArtist") && catalog.albumIds.size() > parameters.listSize)
+                offset = static_cast<std::size_t>(Random::getRandom(0, static_cast<int>(catalog.albumIds.size() / parameters.listSize))) * parameters.listSize;
+
+            return "getAlbumList2.view?type=" + std::string{ type } + "&size=" + std::to_string(parameters.listSize) + "&offset=" + std::to_string(offset) + musicFolderQuery;
+        }
+
+        case CallType::GetAlbum:
+            return "getAlbum.view?id=" + pickRandom(catalog.albumIds);
+
+        case CallType::Search3:
+            return "search3.view?query=" + Wt::Utils::urlEncode(pickRandom(catalog.searchTerms)) + "&artistCount=20&albumCount=20&songCount=20" + musicFolderQuery;
+
+        case CallType::GetCoverArt:
+            return "getCoverArt.view?id=" + pickRandom(catalog.coverArtIds) + "&size=" + std::to_string(parameters.coverSize);
+
+        case CallType::Stream:
+            if (parameters.streamFormat == "raw")
+                return "stream.view?format=raw&id=" + pickRandom(catalog.songIds);
+            return "stream.view?id=" + pickRandom(catalog.songIds) + "&format=" + parameters.streamFormat + "&maxBitRate=" + std::to_string(parameters.streamBitrate);
+        }
+
+        throw std::runtime_error{ "Unhandled call type" };
+    }
+
+    bool isCallAvailable(const Catalog& catalog, CallType callType)
+    {
+        switch (callType)
+        {
+        case CallType::GetArtists:
+        case CallType::GetAlbumList2:
+            return true;
+        case CallType::GetAlbum: return !catalog.albumIds.empty();
+        case CallType::Search3: return !catalog.searchTerms.empty();
+        case CallType::GetCoverArt: return !catalog.coverArtIds.empty();
+        case CallType::Stream: return !catalog.songIds.empty();
+        }
+
+        return false;
+    }
+
+    // Subsonic errors are reported using a regular response
+    bool isFailedResponse(const Wt::Http::Message& msg)
+    {
+        if (msg.status() != 200)
+            return true;
+
+        const std::string* contentType{ msg.getHeader("Content-Type") };
+        if (contentType && contentType->find("json") != std::string::npos)
+            return msg.body().find("\"status\":\"failed\"") != std::string::npos;
+
+        return false;
+    }
+
+    struct CallStats
+    {
+        std::vector<std::chrono::microseconds> latencies;
+        std::size_t errorCount{};
+        std::uint64_t byteCount{};
+
+        CallStats& operator+=(const CallStats& other)
+        {
+            latencies.insert(std::end(latencies), std::cbegin(other.latencies), std::cend(other.latencies));
+            errorCount += other.errorCount;
+            byteCount += other.byteCount;
+            return *this;
+        }
+    };
+    using Stats = std::vector<CallStats>; // indexed by mix entry
+
+    // Sends requests one after the other, until the deadline
+    class Client
+    {
+    public:
+        Client(boost::asio::io_context& ioContext, const Parameters& parameters, const Catalog& catalog, const std::vector<MixEntry>& mix, std::chrono::seconds timeout, bool verifyCertificates)
+            : _parameters{ parameters }
+            , _catalog{ catalog }
+            , _mix{ mix }
+            , _weightSum{ computeWeightSum(mix) }
+            , _client{ ioContext }
+            , _stats(mix.size())
+        {
+            _client.setTimeout(timeout);
+            _client.setMaximumResponseSize(1024 * 1024 * 1024);
+            _client.setSslCertificateVerificationEnabled(verifyCertificates);
+            _client.done().connect([this](Wt::AsioWrapper::error_code ec, const Wt::Http::Message& msg) { onDone(ec, msg); });
+        }
+
+        Client(const Client&) = delete;
+        Client& operator=(const Client&) = delete;
+
+        // Results are recorded once the warmup period is over
+        void start(std::chrono::steady_clock::time_point recordStart, std::chrono::steady_clock::time_point deadline, std::function<void()> onComplete)
+        {
+            _recordStart = recordStart;
+            _deadline = deadline;
+            _onComplete = std::move(onComplete);
+            sendNext();
+        }
+
+        const Stats& getStats() const { return _stats; }
+
+    private:
+        static unsigned computeWeightSum(const std::vector<MixEntry>& mix)
+        {
+            unsigned sum{};
+            for (const MixEntry& entry : mix)
+                sum += entry.weight;
+            return sum;
+        }
+
+        std::size_t pickMixEntry() const
+        {
+            unsigned value{ static_cast<unsigned>(Random::getRandom(0, static_cast<int>(_weightSum) - 1)) };
+            for (std::size_t i{}; i < _mix.size(); ++i)
+            {
+                if (value < _mix[i].weight)
+                    return i;
+                value -= _mix[i].weight;
+            }
+            return _mix.size() - 1;
+        }
+
+        void sendNext()
+        {
+            if (std::chrono::steady_clock::now() >= _deadline)
+            {
+                _onComplete();
+                return;
+            }
+
+            _currentMixEntry = pickMixEntry();
+            const std::string url{ _parameters.baseUrl + buildRelativeUrl(_parameters, _catalog, _mix[_currentMixEntry].callType->type) + "&" + _parameters.authQuery };
+
+            _requestStart = std::chrono::steady_clock::now();
+            if (!_client.get(url))
+                throw std::runtime_error{ "Cannot send request to '" + url + "', bad url or unsupported scheme?" };
+        }
+
+        void onDone(Wt::AsioWrapper::error_code ec, const Wt::Http::Message& msg)
+        {
+            const auto now{ std::chrono::steady_clock::now() };
+            if (_requestStart >= _recordStart && now <= _deadline)
+            {
+                CallStats& stats{ _stats[_currentMixEntry] };
+                stats.latencies.push_back(std::chrono::duration_cast<std::chrono::microseconds>(now - _requestStart));
+                if (ec || isFailedResponse(msg))
+                    stats.errorCount++;
+                stats.byteCount += msg.body().size();
+            }
+
+            sendNext();
+        }
+
+        const Parameters& _parameters;
+        const Catalog& _catalog;
+        const std::vector<MixEntry>& _mix;
+        const unsigned _weightSum;
+        Wt::Http::Client _client;
+
+        std::chrono::steady_clock::time_point _recordStart;
+        std::chrono::steady_clock::time_point _deadline;
+        std::function<void()> _onComplete;
+
+        std::size_t _currentMixEntry{};
+        std::chrono::steady_clock::time_point _requestStart;
+        Stats _stats;
+    };
+
+    // Blocking GET, used to gather the catalog
+    std::string fetch(boost::asio::io_context& ioContext, const std::string& url, bool verifyCertificates)
+    {
+        Wt::Http::Client client{ ioContext };
+        client.setTimeout(std::chrono::seconds{ 300 });
+        client.setMaximumResponseSize(256 * 1024 * 1024);
+        client.setSslCertificateVerificationEnabled(verifyCertificates);
+
+        std::optional<std::string> body;
+        std::string error;
+        client.done().connect([&](Wt::AsioWrapper::error_code ec, const Wt::Http::Message& msg)
+            {
+                if (ec)
+                    error = ec.message();
+                else if (isFailedResponse(msg))
+                    error = "status = " + std::to_string(msg.status()) + ", body = '" + msg.body() + "'";
+                else
+                    body = msg.body();
+            });
+
+        if (!client.get(url))
+            throw std::runtime_error{ "Cannot send request to '" + url + "', bad url or unsupported scheme?" };
+
+        ioContext.run();
+        ioContext.restart();
+
+        if (!body)
+            throw std::runtime_error{ "Request failed: " + error };
+
+        return *body;
+    }
+
+    void visitArray(const Wt::Json::Object& object, const std::string& name, const std::function<void(const Wt::Json::Object&)>& visitor)
+    {
+        auto it{ object.find(name) };
+        if (it == std::cend(object))
+            return;
+
+        const Wt::Json::Array& array = it->second;
+        for (const Wt::Json::Value& value : array)
+            visitor(value);
+    }
+
+    std::optional<std::string> getString(const Wt::Json::Object& object, const std::string& name)
+    {
+        auto it{ object.find(name) };
+        if (it == std::cend(object) || it->second.type() != Wt::Json::Type::String)
+            return std::nullopt;
+
+        return static_cast<std::string>(it->second);
+    }
+
+    void addSearchTerm(Catalog& catalog, std::string_view name)
+    {
+        // first word long enough to be matched by the full text search
+        for (std::string_view word : StringUtils::splitString(name, ' '))
+        {
+            if (word.size() >= 3)
+            {
+                catalog.searchTerms.emplace_back(word);
+                return;
+            }
+        }
+    }
+
+    Catalog fetchCatalog(boost::asio::io_context& ioContext, const Parameters& parameters, std::size_t catalogSize, bool verifyCertificates)
+    {
+        const std::string count{ std::to_string(catalogSize) };
+        std::string url{ parameters.baseUrl + "search3.view?query=&artistCount=" + count + "&albumCount=" + count + "&songCount=" + count + "&" + parameters.authQuery };
+        if (parameters.musicFolderId)
+            url += "&musicFolderId=" + *parameters.musicFolderId;
+
+        Catalog catalog;
+        try
+        {
+            Wt::Json::Object root;
+            Wt::Json::parse(fetch(ioContext, url, verifyCertificates), root);
+
+            const Wt::Json::Object& response = root.get("subsonic-response");
+            const Wt::Json::Object& searchResult = response.get("searchResult3");
+
+            visitArray(searchResult, "artist", [&](const Wt::Json::Object& artist)
+                {
+                    if (const auto name{ getString(artist, "name") })
+                        addSearchTerm(catalog, *name);
+                });
+            visitArray(searchResult, "album", [&](const Wt::Json::Object& album)
+                {
+                    if (const auto id{ getString(album, "id") })
+                        catalog.albumIds.push_back(*id);
+                    if (const auto coverArt{ getString(album, "coverArt") })
+                        catalog.coverArtIds.push_back(*coverArt);
+                    if (const auto name{ getString(album, "name") })
+                        addSearchTerm(catalog, *name);
+                });
+            visitArray(searchResult, "song", [&](const Wt::Json::Object& song)
+                {
+                    if (const auto id{ getString(song, "id") })
+                        catalog.songIds.push_back(*id);
+                });
+        }
+        catch (const Wt::WException& e)
+        {
+            throw std::runtime_error{ std::string{ "Cannot parse the search3 response: " } + e.what() };
+        }
+
+        return catalog;
+    }
+
+    void printRow(std::string_view name, CallStats& stats, double seconds)
+    {
+        std::sort(std::begin(stats.latencies), std::end(stats.latencies));
+
+        // nearest rank
+        auto percentile{ [&](double p) -> double
+            {
+                if (stats.latencies.empty())
+                    return 0;
+
+                const std::size_t rank{ static_cast<std::size_t>(std::ceil(p / 100 * stats.latencies.size())) };
+                return stats.latencies[std::clamp<std::size_t>(rank, 1, stats.latencies.size()) - 1].count() / 1000.;
+            } };
+
+        double meanMs{};
+        for (std::chrono::microseconds latency : stats.latencies)
+            meanMs += latency.count() / 1000.;
+        if (!stats.latencies.empty())
+            meanMs /= stats.latencies.size();
+
+        std::cout << std::left << std::setw(16) << name << std::right
+            << std::setw(9) << stats.latencies.size()
+            << std::setw(8) << stats.errorCount
+            << std::fixed << std::setprecision(1)
+            << std::setw(10) << stats.latencies.size() / seconds
+            << std::setprecision(2)
+            << std::setw(10) << meanMs
+            << std::setw(10) << percentile(50)
+            << std::setw(10) << percentile(90)
+            << std::setw(10) << percentile(99)
+            << std::setw(10) << (stats.latencies.empty() ? 0. : stats.latencies.back().count() / 1000.)
+            << std::setprecision(1)
+            << std::setw(10) << stats.byteCount / 1024. / 1024. << std::endl;
+    }
+
+    void printStats(const std::vector<MixEntry>& mix, Stats& stats, double seconds)
+    {
+        std::cout << std::left << std::setw(16) << "call" << std::right
+            << std::setw(9) << "count"
+            << std::setw(8) << "errors"
+            << std::setw(10) << "req/s"
+            << std::setw(10) << "mean ms"
+            << std::setw(10) << "p50 ms"
+            << std::setw(10) << "p90 ms"
+            << std::setw(10) << "p99 ms"
+            << std::setw(10) << "max ms"
+            << std::setw(10) << "MB" << std::endl;
+
+        CallStats total;
+        for (std::size_t i{}; i < mix.size(); ++i)
+        {
+            total += stats[i];
+            printRow(mix[i].callType->name, stats[i], seconds);
+        }
+        printRow("total", total, seconds);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        namespace po = boost::program_options;
+
+        po::options_description desc{ "Allowed options" };
+        desc.add_options()
+            ("help,h", "print usage message")
+            ("url", po::value<std::string>()->default_value("http://localhost:5082"), "server url")
+            ("user,u", po::value<std::string>(), "user name")
+            ("password,p", po::value<std::string>(), "password (defaults to the LMS_BENCH_PASSWORD environment variable)")
+            ("concurrency,c", po::value<std::size_t>()->default_value(8), "number of concurrent clients")
+            ("threads,t", po::value<std::size_t>()->default_value(2), "number of client threads")
+            ("duration,d", po::value<unsigned>()->default_value(30), "measure duration, in seconds")
+            ("warmup,w", po::value<unsigned>()->default_value(5), "warmup duration before measuring, in seconds")
+            ("mix,m", po::value<std::string>()->default_value("getArtists:1,getAlbumList2:4,getAlbum:4,search3:2,getCoverArt:4,stream:1"), "weighted call mix")
+            ("list-size", po::value<std::size_t>()->default_value(50), "size of the getAlbumList2 requests")
+            ("cover-size", po::value<std::size_t>()->default_value(256), "size of the getCoverArt requests")
+            ("stream-format", po::value<std::string>()->default_value("opus"), "transcoding format of the stream requests, \"raw\" to disable transcoding")
+            ("stream-bitrate", po::value<std::size_t>()->default_value(128), "transcoding bitrate of the stream requests, in kbps")
+            ("music-folder-id", po::value<std::string>(), "restrict the calls to a music folder")
+            ("catalog-size", po::value<std::size_t>()->default_value(1000), "number of artists, albums and songs fetched to build the requests")
+            ("timeout", po::value<unsigned>()->default_value(60), "request timeout, in seconds")
+            ("insecure,k", "do not verify the server certificates")
+            ;
+
+        po::variables_map vm;
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+        po::notify(vm);
+
+        if (vm.count("help") || !vm.count("user"))
+        {
+            std::cout << "Usage: " << argv[0] << " [options]" << std::endl << desc << std::endl;
+            return vm.count("help") ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+
+        std::string password;
+        if (vm.count("password"))
+            password = vm["password"].as<std::string>();
+        else if (const char* envPassword{ std::getenv("LMS_BENCH_PASSWORD") })
+            password = envPassword;
+
+        Parameters parameters;
+        parameters.baseUrl = vm["url"].as<std::string>();
+        if (parameters.baseUrl.empty() || parameters.baseUrl.back() != '/')
+            parameters.baseUrl += '/';
+        parameters.baseUrl += "rest/";
+        parameters.authQuery = "u=" + Wt::Utils::urlEncode(vm["user"].as<std::string>()) + "&p=enc:" + toHex(password) + "&v=1.16.1&c=lms-bench&f=json";
+        parameters.listSize = std::max<std::size_t>(vm["list-size"].as<std::size_t>(), 1);
+        parameters.coverSize = vm["cover-size"].as<std::size_t>();
+        parameters.streamFormat = vm["stream-format"].as<std::string>();
+        parameters.streamBitrate = vm["stream-bitrate"].as<std::size_t>();
+        if (vm.count("music-folder-id"))
+            parameters.musicFolderId = vm["music-folder-id"].as<std::string>();
+
+        const bool verifyCertificates{ vm.count("insecure") == 0 };
+        const std::size_t concurrency{ std::max<std::size_t>(vm["concurrency"].as<std::size_t>(), 1) };
+        const std::size_t threadCount{ std::max<std::size_t>(vm["threads"].as<std::size_t>(), 1) };
+        const std::chrono::seconds duration{ vm["duration"].as<unsigned>() };
+        const std::chrono::seconds warmup{ vm["warmup"].as<unsigned>() };
+        const std::chrono::seconds timeout{ vm["timeout"].as<unsigned>() };
+
+        boost::asio::io_context ioContext;
+
+        std::cout << "Fetching catalog..." << std::endl;
+        const Catalog catalog{ fetchCatalog(ioContext, parameters, vm["catalog-size"].as<std::size_t>(), verifyCertificates) };
+        std::cout << "Catalog: " << catalog.albumIds.size() << " albums, " << catalog.songIds.size() << " songs, " << catalog.coverArtIds.size() << " covers, " << catalog.searchTerms.size() << " search terms" << std::endl;
+
+        std::vector<MixEntry> mix;
+        for (const MixEntry& entry : parseMix(vm["mix"].as<std::string>()))
+        {
+            if (isCallAvailable(catalog, entry.callType->type))
+                mix.push_back(entry);
+            else
+                std::cout << "Skipping '" << entry.callType->name << "': nothing to request in the catalog" << std::endl;
+        }
+        if (mix.empty())
+            throw std::runtime_error{ "No call to run" };
+
+        std::cout << "Running " << concurrency << " concurrent client(s) for " << duration.count() << "s (warmup = " << warmup.count() << "s)..." << std::endl;
+
+        std::vector<std::unique_ptr<Client>> clients;
+        for (std::size_t i{}; i < concurrency; ++i)
+            clients.push_back(std::make_unique<Client>(ioContext, parameters, catalog, mix, timeout, verifyCertificates));
+
+        auto workGuard{ boost::asio::make_work_guard(ioContext) };
+        std::atomic<std::size_t> runningClientCount{ concurrency };
+
+        const auto recordStart{ std::chrono::steady_clock::now() + warmup };
+        const auto deadline{ recordStart + duration };
+        for (const std::unique_ptr<Client>& client : clients)
+        {
+            client->start(recordStart, deadline, [&]
+                {
+                    // the last client to complete lets the io context run out of work
+                    if (--runningClientCount == 0)
+                        workGuard.reset();
+                });
+        }
+
+        std::vector<std::thread> threads;
+        for (std::size_t i{}; i < threadCount; ++i)
+            threads.emplace_back([&] { ioContext.run(); });
+        for (std::thread& thread : threads)
+            thread.join();
+
+        Stats stats(mix.size());
+        for (const std::unique_ptr<Client>& client : clients)
+        {
+            for (std::size_t i{}; i < mix.size(); ++i)
+                stats[i] += client->getStats()[i];
+        }
+
+        std::cout << std::endl;
+        printStats(mix, stats, std::chrono::duration<double>{ duration }.count());
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Caught exception: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,63 @@
+#!/bin/bash
+
+if [ "$#" -lt 3 ] || [ "$#" -gt 4 ]; then
+    echo "Usage: $0 <base_url> <user> <iteration_count> [musicFolderId]"
+    exit 1
+fi
+
+# make any command failure exit
+set -e
+
+read -r -s -p "Enter password: " user_password
+echo
+
+# Retrieve the argument from the command line
+base_url="$1"
+user="$2"
+iteration_count="$3"
+
+music_folder_id=""
+if [ "$#" -eq 4 ]; then
+    music_folder_id="$4"
+fi
+
+append_music_folder() {
+    local url="$1"
+    if [ -n "$music_folder_id" ]; then
+        url="$url&musicFolderId=$music_folder_id"
+    fi
+    echo "$url"
+}
+
+# Compares the xml and json serialization of the same large responses
+# Responses are fetched once before measuring, so that both formats get the same cache state
+bench_request() {
+    local name="$1"
+    local query="$2"
+
+    for format in xml json; do
+        local url
+        url="$(append_music_folder "$base_url/rest/$query&u=$user&p=$user_password&v=1.16.0&c=benchmark&f=$format")"
+
+        local size
+        size=$(wget -q -O - "$url" | wc -c)
+
+        local start_time
+        start_time=$(date +%s.%3N)
+        for ((i = 0; i < iteration_count; ++i)); do
+            wget -q -O - "$url" > /dev/null
+        done
+        local end_time
+        end_time=$(date +%s.%3N)
+
+        local elapsed_time
+        elapsed_time=$(echo "$end_time - $start_time" | bc)
+        local mean_time
+        mean_time=$(echo "scale=3; $elapsed_time * 1000 / $iteration_count" | bc)
+
+        echo "$name ($format): $size bytes, $mean_time ms per request"
+    done
+}
+
+bench_request "getAlbumList2" "getAlbumList2.view?type=alphabeticalByName&size=500"
+bench_request "search3" "search3.view?query=&artistCount=500&albumCount=500&songCount=500"